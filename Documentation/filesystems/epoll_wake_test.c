@@ -0,0 +1,108 @@
+/*
+ * epoll_wake_test - check that an epoll_wait() sleeper which is woken but
+ * finds nothing to collect can still be woken by later events.
+ *
+ * Each round, the waiter blocks on an epoll set holding two pipes.  The
+ * main thread makes the first pipe readable, which wakes the waiter, and
+ * removes it with EPOLL_CTL_DEL before the waiter gets to run.  The waiter
+ * then finds the ready list empty and goes back to sleep.  The main thread
+ * finally makes the second pipe readable; the waiter must see it well
+ * before its timeout.  Both threads share one CPU so that the delete
+ * usually lands between the wakeup and the waiter running.
+ *
+ * Build: gcc -O2 -o epoll_wake_test epoll_wake_test.c -lpthread
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#define ROUNDS		1000
+#define TIMEOUT_MS	1000
+
+static int epfd;
+static int p1[2], p2[2];
+static sem_t go, done;
+static int timeouts;
+
+static void *waiter(void *unused)
+{
+	struct epoll_event ev[4];
+	char c;
+	int i, n;
+
+	for (i = 0; i < ROUNDS; i++) {
+		sem_wait(&go);
+		do {
+			n = epoll_wait(epfd, ev, 4, TIMEOUT_MS);
+		} while (n < 0 && errno == EINTR);
+		if (n == 0)
+			timeouts++;
+		while (read(p2[0], &c, 1) == 1)
+			;
+		sem_post(&done);
+	}
+	return NULL;
+}
+
+int main(void)
+{
+	struct epoll_event ev = { .events = EPOLLIN };
+	pthread_t thread;
+	cpu_set_t cpus;
+	char c = 0;
+	int i;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(0, &cpus);
+	sched_setaffinity(0, sizeof(cpus), &cpus);
+
+	if (pipe2(p1, O_NONBLOCK) || pipe2(p2, O_NONBLOCK)) {
+		perror("pipe2");
+		return 1;
+	}
+	epfd = epoll_create(1);
+	if (epfd < 0) {
+		perror("epoll_create");
+		return 1;
+	}
+	ev.data.fd = p2[0];
+	epoll_ctl(epfd, EPOLL_CTL_ADD, p2[0], &ev);
+
+	sem_init(&go, 0, 0);
+	sem_init(&done, 0, 0);
+	pthread_create(&thread, NULL, waiter, NULL);
+
+	for (i = 0; i < ROUNDS; i++) {
+		ev.data.fd = p1[0];
+		epoll_ctl(epfd, EPOLL_CTL_ADD, p1[0], &ev);
+		sem_post(&go);
+		/* let the waiter block in epoll_wait() */
+		usleep(2000);
+
+		if (write(p1[1], &c, 1) != 1 ||
+		    epoll_ctl(epfd, EPOLL_CTL_DEL, p1[0], NULL)) {
+			perror("p1");
+			return 1;
+		}
+		if (write(p2[1], &c, 1) != 1) {
+			perror("p2");
+			return 1;
+		}
+
+		sem_wait(&done);
+		while (read(p1[0], &c, 1) == 1)
+			;
+		c = 0;
+	}
+	pthread_join(thread, NULL);
+
+	printf("%d rounds, %d lost wakeups\n", ROUNDS, timeouts);
+	return timeouts ? 1 : 0;
+}
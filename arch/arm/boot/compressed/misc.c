@@ -33,6 +33,13 @@ extern void error(char *x);
 
 #include <mach/uncompress.h>
 
+#ifndef arch_decomp_timestamp
+#define arch_decomp_timestamp()	0
+#endif
+
+/* not static: the decompressor may not have local bss */
+u32 decomp_start_us, decomp_end_us;
+
 #ifdef CONFIG_DEBUG_ICEDCC
 
 #if defined(CONFIG_CPU_V6) || defined(CONFIG_CPU_V6K) || defined(CONFIG_CPU_V7)
@@ -186,8 +193,10 @@ decompress_kernel(unsigned long output_start, unsigned long free_mem_ptr_p,
 	arch_decomp_setup();
 
 	putstr("Uncompressing Linux...");
+	decomp_start_us = arch_decomp_timestamp();
 	ret = do_decompress(input_data, input_data_end - input_data,
 			    output_data, error);
+	decomp_end_us = arch_decomp_timestamp();
 	if (ret)
 		error("decompressor returned an error");
 	else
@@ -215,3 +224,35 @@ const struct tag *copy_atags(struct tag *dest, const struct tag *src,
 
 	return dest;
 }
+
+/*
+ * Appends the decompressor's timestamps to the tag list, in place.  Only
+ * a list that starts with ATAG_CORE and ends below the kernel's page
+ * tables is touched, where there is sure to be room after it.
+ */
+void add_boot_times_tag(struct tag *tags, unsigned long kernel_start)
+{
+	unsigned long limit = kernel_start - 0x4000;
+	struct tag *tag = tags;
+
+	if (!decomp_start_us || (unsigned long)tags >= limit ||
+	    tags->hdr.tag != ATAG_CORE)
+		return;
+
+	while (tag->hdr.tag != ATAG_NONE) {
+		if (!tag->hdr.size || (unsigned long)tag >= limit)
+			return;
+		tag = tag_next(tag);
+	}
+	if ((unsigned long)tag + sizeof(struct tag_header) +
+	    sizeof(struct tag_boot_times) + sizeof(struct tag_header) > limit)
+		return;
+
+	tag->hdr.tag = ATAG_BOOT_TIMES;
+	tag->hdr.size = tag_size(tag_boot_times);
+	tag->u.boot_times.decomp_start_us = decomp_start_us;
+	tag->u.boot_times.decomp_end_us = decomp_end_us;
+	tag = tag_next(tag);
+	tag->hdr.tag = ATAG_NONE;
+	tag->hdr.size = 0;
+}
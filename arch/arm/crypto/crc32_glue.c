@@ -0,0 +1,240 @@
+/*
+ * Cryptographic API.
+ *
+ * Glue code for the CRC32 and CRC32c slice-by-8 assembler implementation
+ * for ARM.
+ *
+ * "crc32" and "crc32c" keep the semantics of crypto/crc32.c and
+ * crypto/crc32c.c: the key is the seed, crc32 returns the raw crc and
+ * crc32c returns it inverted.  The tables are built at load time, 8K per
+ * polynomial.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+#include <crypto/internal/hash.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/types.h>
+#include <asm/byteorder.h>
+
+#define CHKSUM_BLOCK_SIZE	1
+#define CHKSUM_DIGEST_SIZE	4
+
+#define CRC32_POLY_LE		0xedb88320
+#define CRC32C_POLY_LE		0x82f63b78
+
+asmlinkage u32 crc32_armv4_le(u32 crc, const u8 *buf, unsigned int len,
+			      const u32 (*tab)[256]);
+
+static u32 crc32_tab[8][256];
+static u32 crc32c_tab[8][256];
+
+struct chksum_ctx {
+	u32 key;
+};
+
+struct chksum_desc_ctx {
+	u32 crc;
+};
+
+static void __init crc32_arm_init_tab(u32 (*tab)[256], u32 poly)
+{
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		u32 crc = i;
+
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) ? poly : 0);
+		tab[0][i] = crc;
+	}
+	for (j = 1; j < 8; j++)
+		for (i = 0; i < 256; i++)
+			tab[j][i] = (tab[j - 1][i] >> 8) ^
+				    tab[0][tab[j - 1][i] & 0xff];
+}
+
+static int chksum_init(struct shash_desc *desc)
+{
+	struct chksum_ctx *mctx = crypto_shash_ctx(desc->tfm);
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	ctx->crc = mctx->key;
+	return 0;
+}
+
+static int chksum_setkey(struct crypto_shash *tfm, const u8 *key,
+			 unsigned int keylen)
+{
+	struct chksum_ctx *mctx = crypto_shash_ctx(tfm);
+
+	if (keylen != sizeof(mctx->key)) {
+		crypto_shash_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+	mctx->key = le32_to_cpu(*(__le32 *)key);
+	return 0;
+}
+
+static int crc32_update(struct shash_desc *desc, const u8 *data,
+			unsigned int len)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	ctx->crc = crc32_armv4_le(ctx->crc, data, len, crc32_tab);
+	return 0;
+}
+
+static int crc32_final(struct shash_desc *desc, u8 *out)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	*(__le32 *)out = cpu_to_le32(ctx->crc);
+	return 0;
+}
+
+static int crc32_finup(struct shash_desc *desc, const u8 *data,
+		       unsigned int len, u8 *out)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	*(__le32 *)out = cpu_to_le32(crc32_armv4_le(ctx->crc, data, len,
+						    crc32_tab));
+	return 0;
+}
+
+static int crc32_digest(struct shash_desc *desc, const u8 *data,
+			unsigned int len, u8 *out)
+{
+	struct chksum_ctx *mctx = crypto_shash_ctx(desc->tfm);
+
+	*(__le32 *)out = cpu_to_le32(crc32_armv4_le(mctx->key, data, len,
+						    crc32_tab));
+	return 0;
+}
+
+static int crc32c_update(struct shash_desc *desc, const u8 *data,
+			 unsigned int len)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	ctx->crc = crc32_armv4_le(ctx->crc, data, len, crc32c_tab);
+	return 0;
+}
+
+static int crc32c_final(struct shash_desc *desc, u8 *out)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	*(__le32 *)out = ~cpu_to_le32(ctx->crc);
+	return 0;
+}
+
+static int crc32c_finup(struct shash_desc *desc, const u8 *data,
+			unsigned int len, u8 *out)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	*(__le32 *)out = ~cpu_to_le32(crc32_armv4_le(ctx->crc, data, len,
+						     crc32c_tab));
+	return 0;
+}
+
+static int crc32c_digest(struct shash_desc *desc, const u8 *data,
+			 unsigned int len, u8 *out)
+{
+	struct chksum_ctx *mctx = crypto_shash_ctx(desc->tfm);
+
+	*(__le32 *)out = ~cpu_to_le32(crc32_armv4_le(mctx->key, data, len,
+						     crc32c_tab));
+	return 0;
+}
+
+static int crc32_cra_init(struct crypto_tfm *tfm)
+{
+	struct chksum_ctx *mctx = crypto_tfm_ctx(tfm);
+
+	mctx->key = 0;
+	return 0;
+}
+
+static int crc32c_cra_init(struct crypto_tfm *tfm)
+{
+	struct chksum_ctx *mctx = crypto_tfm_ctx(tfm);
+
+	mctx->key = ~0;
+	return 0;
+}
+
+static struct shash_alg algs[] = { {
+	.digestsize	=	CHKSUM_DIGEST_SIZE,
+	.setkey		=	chksum_setkey,
+	.init		=	chksum_init,
+	.update		=	crc32_update,
+	.final		=	crc32_final,
+	.finup		=	crc32_finup,
+	.digest		=	crc32_digest,
+	.descsize	=	sizeof(struct chksum_desc_ctx),
+	.base		=	{
+		.cra_name		=	"crc32",
+		.cra_driver_name	=	"crc32-arm",
+		.cra_priority		=	200,
+		.cra_blocksize		=	CHKSUM_BLOCK_SIZE,
+		.cra_ctxsize		=	sizeof(struct chksum_ctx),
+		.cra_module		=	THIS_MODULE,
+		.cra_init		=	crc32_cra_init,
+	}
+}, {
+	.digestsize	=	CHKSUM_DIGEST_SIZE,
+	.setkey		=	chksum_setkey,
+	.init		=	chksum_init,
+	.update		=	crc32c_update,
+	.final		=	crc32c_final,
+	.finup		=	crc32c_finup,
+	.digest		=	crc32c_digest,
+	.descsize	=	sizeof(struct chksum_desc_ctx),
+	.base		=	{
+		.cra_name		=	"crc32c",
+		.cra_driver_name	=	"crc32c-arm",
+		.cra_priority		=	200,
+		.cra_blocksize		=	CHKSUM_BLOCK_SIZE,
+		.cra_ctxsize		=	sizeof(struct chksum_ctx),
+		.cra_module		=	THIS_MODULE,
+		.cra_init		=	crc32c_cra_init,
+	}
+} };
+
+static int __init crc32_arm_mod_init(void)
+{
+	int err;
+
+	crc32_arm_init_tab(crc32_tab, CRC32_POLY_LE);
+	crc32_arm_init_tab(crc32c_tab, CRC32C_POLY_LE);
+
+	err = crypto_register_shash(&algs[0]);
+	if (err)
+		return err;
+	err = crypto_register_shash(&algs[1]);
+	if (err)
+		crypto_unregister_shash(&algs[0]);
+	return err;
+}
+
+static void __exit crc32_arm_mod_fini(void)
+{
+	crypto_unregister_shash(&algs[1]);
+	crypto_unregister_shash(&algs[0]);
+}
+
+module_init(crc32_arm_mod_init);
+module_exit(crc32_arm_mod_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("CRC32 and CRC32c, ARM assembler");
+
+MODULE_ALIAS("crc32");
+MODULE_ALIAS("crc32c");
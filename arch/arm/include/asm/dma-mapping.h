@@ -350,6 +350,71 @@ static inline dma_addr_t dma_map_page(struct device *dev, struct page *page,
 	return addr;
 }
 
+/**
+ * dma_map_page_clean - map a buffer the CPU has not written for streaming DMA
+ * @dev: valid struct device pointer, or NULL for ISA and EISA-like devices
+ * @page: page that buffer resides in
+ * @offset: offset into page for start of buffer
+ * @size: size of buffer to map
+ * @dir: DMA transfer direction
+ *
+ * As dma_map_page(), for a buffer the CPU has not written since a device
+ * last handed it back, such as a camera frame passed on to an encoder.
+ * No line of it can be dirty, so the caches are left alone.  Unmapping
+ * still invalidates whatever the CPU read of it in the meantime.
+ */
+static inline dma_addr_t __dma_map_page_clean(struct device *dev,
+	struct page *page, unsigned long offset, size_t size,
+	enum dma_data_direction dir)
+{
+#ifdef CONFIG_DMABOUNCE
+	return __dma_map_page(dev, page, offset, size, dir);
+#else
+	return pfn_to_dma(dev, page_to_pfn(page)) + offset;
+#endif
+}
+
+static inline dma_addr_t dma_map_page_clean(struct device *dev,
+	struct page *page, unsigned long offset, size_t size,
+	enum dma_data_direction dir)
+{
+	dma_addr_t addr;
+
+	BUG_ON(!valid_dma_direction(dir));
+
+	addr = __dma_map_page_clean(dev, page, offset, size, dir);
+	debug_dma_map_page(dev, page, offset, size, dir, addr, false);
+
+	return addr;
+}
+
+/**
+ * dma_map_single_clean - dma_map_single() for a buffer the CPU has not written
+ * @dev: valid struct device pointer, or NULL for ISA and EISA-like devices
+ * @cpu_addr: CPU direct mapped address of buffer
+ * @size: size of buffer to map
+ * @dir: DMA transfer direction
+ *
+ * See dma_map_page_clean().
+ */
+static inline dma_addr_t dma_map_single_clean(struct device *dev,
+	void *cpu_addr, size_t size, enum dma_data_direction dir)
+{
+	unsigned long offset = (unsigned long)cpu_addr & ~PAGE_MASK;
+	struct page *page;
+	dma_addr_t addr;
+
+	BUG_ON(!virt_addr_valid(cpu_addr));
+	BUG_ON(!virt_addr_valid(cpu_addr + size - 1));
+	BUG_ON(!valid_dma_direction(dir));
+
+	page = virt_to_page(cpu_addr);
+	addr = __dma_map_page_clean(dev, page, offset, size, dir);
+	debug_dma_map_page(dev, page, offset, size, dir, addr, true);
+
+	return addr;
+}
+
 /**
  * dma_unmap_single - unmap a single buffer previously mapped
  * @dev: valid struct device pointer, or NULL for ISA and EISA-like devices
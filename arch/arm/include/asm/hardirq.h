@@ -14,6 +14,7 @@ typedef struct {
 #endif
 #ifdef CONFIG_SMP
 	unsigned int ipi_irqs[NR_IPI];
+	unsigned int tlb_ipi_irqs;
 #endif
 } ____cacheline_aligned irq_cpustat_t;
 
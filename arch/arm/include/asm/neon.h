@@ -0,0 +1,33 @@
+/*
+ *  linux/arch/arm/include/asm/neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_NEON_H
+#define __ASM_ARM_NEON_H
+
+/*
+ * memcpy, memset and __memzero hand requests of at least this many bytes
+ * to the NEON versions.  Must be a valid ARM immediate.
+ */
+#define NEON_STRING_MIN		1024
+
+#ifndef __ASSEMBLY__
+
+#include <linux/types.h>
+
+/*
+ * NEON may be used in kernel mode between these two calls.  They must
+ * not be called from interrupt context, and the code in between must not
+ * sleep.
+ */
+void kernel_neon_begin(void);
+void kernel_neon_end(void);
+
+extern bool neon_string_enable;
+
+#endif /* __ASSEMBLY__ */
+
+#endif /* __ASM_ARM_NEON_H */
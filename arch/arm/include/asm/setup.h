@@ -143,6 +143,14 @@ struct tag_memclk {
 	__u32 fmemclk;
 };
 
+/* decompressor timestamps, in us of the clock sched_clock runs from */
+#define ATAG_BOOT_TIMES	0x5441a001
+
+struct tag_boot_times {
+	__u32 decomp_start_us;
+	__u32 decomp_end_us;
+};
+
 struct tag {
 	struct tag_header hdr;
 	union {
@@ -165,6 +173,8 @@ struct tag {
 		 * DC21285 specific
 		 */
 		struct tag_memclk	memclk;
+
+		struct tag_boot_times	boot_times;
 	} u;
 };
 
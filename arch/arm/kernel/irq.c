@@ -28,6 +28,7 @@
 #include <linux/interrupt.h>
 #include <linux/irq.h>
 #include <linux/random.h>
+#include <linux/sched.h>
 #include <linux/smp.h>
 #include <linux/init.h>
 #include <linux/seq_file.h>
@@ -66,6 +67,27 @@ int arch_show_interrupts(struct seq_file *p, int prec)
 	return 0;
 }
 
+#ifdef CONFIG_IRQ_TIME_STATS
+/*
+ * Chained handlers are included, so the time of a GPIO bank is charged
+ * to the interrupt line that can actually be moved to another cpu.
+ */
+static inline void handle_irq_timed(unsigned int irq)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	u64 start = local_clock();
+
+	generic_handle_irq(irq);
+	if (desc)
+		desc->time_ns += (unsigned long)(local_clock() - start);
+}
+#else
+static inline void handle_irq_timed(unsigned int irq)
+{
+	generic_handle_irq(irq);
+}
+#endif
+
 /*
  * handle_IRQ handles all hardware IRQ's.  Decoded IRQs should
  * not come via this function.  Instead, they should provide their
@@ -87,7 +109,7 @@ void handle_IRQ(unsigned int irq, struct pt_regs *regs)
 			printk(KERN_WARNING "Bad IRQ%u\n", irq);
 		ack_bad_irq(irq);
 	} else {
-		generic_handle_irq(irq);
+		handle_irq_timed(irq);
 	}
 
 	/* AT91 specific workaround */
@@ -12,6 +12,7 @@
  */
 #define pr_fmt(fmt) "hw perfevents: " fmt
 
+#include <linux/cpu.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
@@ -20,6 +21,7 @@
 #include <linux/spinlock.h>
 #include <linux/uaccess.h>
 
+#include <asm/cpu_pm.h>
 #include <asm/cputype.h>
 #include <asm/irq.h>
 #include <asm/irq_regs.h>
@@ -64,6 +66,12 @@ struct cpu_hw_events {
 	 * used.
 	 */
 	unsigned long		active_mask[BITS_TO_LONGS(ARMPMU_MAX_HWEVENTS)];
+
+	/*
+	 * Counters stopped by armpmu_cpu_pm_notify() while the CPU is
+	 * power gated, to be restarted on the way out.
+	 */
+	unsigned long		pm_stopped_mask[BITS_TO_LONGS(ARMPMU_MAX_HWEVENTS)];
 };
 static DEFINE_PER_CPU(struct cpu_hw_events, cpu_hw_events);
 
@@ -427,6 +435,15 @@ armpmu_reserve_hardware(void)
 				"counters\n", irq);
 			break;
 		}
+
+		/*
+		 * With one interrupt per core, each must be taken on the
+		 * core whose counters raised it or the handler reads the
+		 * wrong PMU.  Cores that are offline now get theirs in
+		 * armpmu_cpu_notify().
+		 */
+		if (pmu_device->num_resources > 1 && cpu_online(i))
+			irq_set_affinity(irq, cpumask_of(i));
 	}
 
 	if (err) {
@@ -461,6 +478,90 @@ armpmu_release_hardware(void)
 static atomic_t active_events = ATOMIC_INIT(0);
 static DEFINE_MUTEX(pmu_reserve_mutex);
 
+static void armpmu_enable(struct pmu *pmu);
+
+/*
+ * A core that is power gated (LP2, or the whole CPU complex on a cluster
+ * switch) comes back with its PMU reset.  Fold the live counts into the
+ * events before going down and reprogram them on the way back up, so the
+ * totals and sampling periods carry on where they left off.
+ */
+static int armpmu_cpu_pm_notify(struct notifier_block *self,
+				unsigned long cmd, void *v)
+{
+	struct cpu_hw_events *cpuc = &__get_cpu_var(cpu_hw_events);
+	struct perf_event *event;
+	int idx;
+
+	if (!armpmu || !atomic_read(&active_events))
+		return NOTIFY_OK;
+
+	switch (cmd) {
+	case CPU_PM_ENTER:
+		armpmu->stop();
+		for (idx = 0; idx <= armpmu->num_events; ++idx) {
+			event = cpuc->events[idx];
+			if (!event || !test_bit(idx, cpuc->active_mask) ||
+			    (event->hw.state & PERF_HES_STOPPED))
+				continue;
+			armpmu_stop(event, PERF_EF_UPDATE);
+			set_bit(idx, cpuc->pm_stopped_mask);
+		}
+		break;
+	case CPU_PM_ENTER_FAILED:
+	case CPU_PM_EXIT:
+		if (armpmu->reset)
+			armpmu->reset(NULL);
+		for (idx = 0; idx <= armpmu->num_events; ++idx) {
+			if (!test_and_clear_bit(idx, cpuc->pm_stopped_mask))
+				continue;
+			event = cpuc->events[idx];
+			if (event)
+				armpmu_start(event, PERF_EF_RELOAD);
+		}
+		armpmu_enable(&pmu);
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block armpmu_cpu_pm_nb = {
+	.notifier_call = armpmu_cpu_pm_notify,
+};
+
+/*
+ * A core brought online starts with an unknown PMU state, and its PMU
+ * interrupt was moved to another core when it went down.
+ */
+static int __cpuinit armpmu_cpu_notify(struct notifier_block *self,
+				       unsigned long action, void *hcpu)
+{
+	unsigned int cpu = (unsigned long)hcpu;
+	int irq;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_STARTING:
+		if (armpmu && armpmu->reset)
+			armpmu->reset(NULL);
+		break;
+	case CPU_ONLINE:
+		mutex_lock(&pmu_reserve_mutex);
+		if (pmu_device && pmu_device->num_resources > 1 &&
+		    cpu < pmu_device->num_resources) {
+			irq = platform_get_irq(pmu_device, cpu);
+			if (irq >= 0)
+				irq_set_affinity(irq, cpumask_of(cpu));
+		}
+		mutex_unlock(&pmu_reserve_mutex);
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block __cpuinitdata armpmu_cpu_nb = {
+	.notifier_call = armpmu_cpu_notify,
+};
+
 static void
 hw_perf_event_destroy(struct perf_event *event)
 {
@@ -691,6 +792,11 @@ init_hw_perf_events(void)
 
 	perf_pmu_register(&pmu, "cpu", PERF_TYPE_RAW);
 
+	if (armpmu) {
+		cpu_pm_register_notifier(&armpmu_cpu_pm_nb);
+		register_cpu_notifier(&armpmu_cpu_nb);
+	}
+
 	return 0;
 }
 early_initcall(init_hw_perf_events);
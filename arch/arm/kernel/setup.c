@@ -29,6 +29,7 @@
 #include <linux/fs.h>
 #include <linux/proc_fs.h>
 #include <linux/memblock.h>
+#include <linux/boot_report.h>
 
 #include <asm/unified.h>
 #include <asm/cpu.h>
@@ -663,6 +664,30 @@ static int __init parse_tag_revision(const struct tag *tag)
 
 __tagtable(ATAG_REVISION, parse_tag_revision);
 
+static struct tag_boot_times boot_times __initdata;
+
+static int __init parse_tag_boot_times(const struct tag *tag)
+{
+	boot_times = tag->u.boot_times;
+	return 0;
+}
+
+__tagtable(ATAG_BOOT_TIMES, parse_tag_boot_times);
+
+static int __init boot_times_report(void)
+{
+	u32 start = boot_times.decomp_start_us, end = boot_times.decomp_end_us;
+
+	if (!start)
+		return 0;
+	pr_info("Kernel decompressed in %u us, started at %u us\n",
+		end - start, start);
+	boot_report_stage("decompress", (u64)start * NSEC_PER_USEC,
+			  (u64)end * NSEC_PER_USEC);
+	return 0;
+}
+early_initcall(boot_times_report);
+
 static int __init parse_tag_cmdline(const struct tag *tag)
 {
 #if defined(CONFIG_CMDLINE_EXTEND)
@@ -432,6 +432,12 @@ void show_ipi_list(struct seq_file *p, int prec)
 
 		seq_printf(p, " %s\n", ipi_types[i]);
 	}
+
+	/* the function calls above that were TLB shootdowns */
+	seq_printf(p, "%*s: ", prec, "TLB");
+	for_each_present_cpu(cpu)
+		seq_printf(p, "%10u ", __get_irq_stat(cpu, tlb_ipi_irqs));
+	seq_printf(p, " TLB shootdown interrupts\n");
 }
 
 u64 smp_irq_stat_cpu(unsigned int cpu)
@@ -9,6 +9,7 @@
  */
 #include <linux/preempt.h>
 #include <linux/smp.h>
+#include <linux/hardirq.h>
 
 #include <asm/smp_plat.h>
 #include <asm/tlbflush.h>
@@ -36,8 +37,16 @@ struct tlb_args {
 	unsigned long ta_end;
 };
 
+/* shown as "TLB" in /proc/interrupts; the sender's own call is not one */
+static inline void tlb_ipi_count(void)
+{
+	if (in_irq())
+		__inc_irq_stat(smp_processor_id(), tlb_ipi_irqs);
+}
+
 static inline void ipi_flush_tlb_all(void *ignored)
 {
+	tlb_ipi_count();
 	local_flush_tlb_all();
 }
 
@@ -45,6 +54,7 @@ static inline void ipi_flush_tlb_mm(void *arg)
 {
 	struct mm_struct *mm = (struct mm_struct *)arg;
 
+	tlb_ipi_count();
 	local_flush_tlb_mm(mm);
 }
 
@@ -52,6 +62,7 @@ static inline void ipi_flush_tlb_page(void *arg)
 {
 	struct tlb_args *ta = (struct tlb_args *)arg;
 
+	tlb_ipi_count();
 	local_flush_tlb_page(ta->ta_vma, ta->ta_start);
 }
 
@@ -59,6 +70,7 @@ static inline void ipi_flush_tlb_kernel_page(void *arg)
 {
 	struct tlb_args *ta = (struct tlb_args *)arg;
 
+	tlb_ipi_count();
 	local_flush_tlb_kernel_page(ta->ta_start);
 }
 
@@ -66,6 +78,7 @@ static inline void ipi_flush_tlb_range(void *arg)
 {
 	struct tlb_args *ta = (struct tlb_args *)arg;
 
+	tlb_ipi_count();
 	local_flush_tlb_range(ta->ta_vma, ta->ta_start, ta->ta_end);
 }
 
@@ -73,9 +86,51 @@ static inline void ipi_flush_tlb_kernel_range(void *arg)
 {
 	struct tlb_args *ta = (struct tlb_args *)arg;
 
+	tlb_ipi_count();
 	local_flush_tlb_kernel_range(ta->ta_start, ta->ta_end);
 }
 
+#if __LINUX_ARM_ARCH__ >= 7
+/*
+ * With the MP extensions the TLB ops used here are broadcast to the
+ * inner shareable domain, and every other core has to act on them.  An
+ * mm that no other cpu has run since it got its ASID has nothing in
+ * their TLBs, so the ops that only act on this cpu will do.  mm_cpumask
+ * only loses cpus when the mm gets a new ASID, see context.c, and the
+ * barrier pairs with the one there after a cpu adds itself.
+ */
+static inline int tlb_mm_local(struct mm_struct *mm)
+{
+	if (!is_smp())
+		return 0;
+	smp_mb();
+	return cpumask_equal(mm_cpumask(mm), cpumask_of(smp_processor_id()));
+}
+
+static void local_only_flush_tlb_mm(struct mm_struct *mm)
+{
+	dsb();
+	asm("mcr	p15, 0, %0, c8, c7, 2" : : "r" (ASID(mm)) : "cc");
+	dsb();
+}
+
+static void local_only_flush_tlb_range(struct mm_struct *mm,
+				       unsigned long start, unsigned long end)
+{
+	unsigned long addr;
+
+	dsb();
+	for (addr = start & PAGE_MASK; addr < end; addr += PAGE_SIZE)
+		asm("mcr	p15, 0, %0, c8, c7, 1"
+		    : : "r" (addr | ASID(mm)) : "cc");
+	dsb();
+}
+#else
+#define tlb_mm_local(mm)			0
+#define local_only_flush_tlb_mm(mm)		do { } while (0)
+#define local_only_flush_tlb_range(mm, s, e)	do { } while (0)
+#endif
+
 void flush_tlb_all(void)
 {
 	if (tlb_ops_need_broadcast())
@@ -88,8 +143,14 @@ void flush_tlb_mm(struct mm_struct *mm)
 {
 	if (tlb_ops_need_broadcast())
 		on_each_cpu_mask(ipi_flush_tlb_mm, mm, 1, mm_cpumask(mm));
-	else
-		local_flush_tlb_mm(mm);
+	else {
+		preempt_disable();
+		if (tlb_mm_local(mm))
+			local_only_flush_tlb_mm(mm);
+		else
+			local_flush_tlb_mm(mm);
+		preempt_enable();
+	}
 }
 
 void flush_tlb_page(struct vm_area_struct *vma, unsigned long uaddr)
@@ -99,8 +160,15 @@ void flush_tlb_page(struct vm_area_struct *vma, unsigned long uaddr)
 		ta.ta_vma = vma;
 		ta.ta_start = uaddr;
 		on_each_cpu_mask(ipi_flush_tlb_page, &ta, 1, mm_cpumask(vma->vm_mm));
-	} else
-		local_flush_tlb_page(vma, uaddr);
+	} else {
+		preempt_disable();
+		if (tlb_mm_local(vma->vm_mm))
+			local_only_flush_tlb_range(vma->vm_mm, uaddr,
+						   uaddr + 1);
+		else
+			local_flush_tlb_page(vma, uaddr);
+		preempt_enable();
+	}
 }
 
 void flush_tlb_kernel_page(unsigned long kaddr)
@@ -122,8 +190,14 @@ void flush_tlb_range(struct vm_area_struct *vma,
 		ta.ta_start = start;
 		ta.ta_end = end;
 		on_each_cpu_mask(ipi_flush_tlb_range, &ta, 1, mm_cpumask(vma->vm_mm));
-	} else
-		local_flush_tlb_range(vma, start, end);
+	} else {
+		preempt_disable();
+		if (tlb_mm_local(vma->vm_mm))
+			local_only_flush_tlb_range(vma->vm_mm, start, end);
+		else
+			local_flush_tlb_range(vma, start, end);
+		preempt_enable();
+	}
 }
 
 void flush_tlb_kernel_range(unsigned long start, unsigned long end)
@@ -0,0 +1,168 @@
+/*
+ *  linux/arch/arm/lib/neon_string.c
+ *
+ *  Dispatch of large memcpy, memset and copy_page calls to NEON.
+ *
+ *  memcpy.S, memset.S and memzero.S branch here for sizes of at least
+ *  NEON_STRING_MIN, copy_page.S always does.  NEON is used only from
+ *  process context, once the unit is enabled on the cpu, and outside
+ *  system suspend; everything else goes back to the ARM versions.  Long
+ *  copies are done in pieces so that preemption is never held off for
+ *  more than about 2 * NEON_STRING_CHUNK bytes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/hardirq.h>
+#include <linux/cpumask.h>
+#include <linux/smp.h>
+#include <linux/syscore_ops.h>
+
+#include <asm/hwcap.h>
+#include <asm/neon.h>
+
+#define NEON_STRING_CHUNK	4096
+
+void *__memcpy_arm(void *dest, const void *src, size_t n);
+void *__memset_arm(void *s, int c, size_t n);
+void __copy_page_arm(void *to, const void *from);
+
+void __memcpy_neon(void *dest, const void *src, size_t n);
+void __memset_neon(void *s, int c, size_t n);
+void __copy_page_neon(void *to, const void *from);
+
+void *neon_memcpy(void *dest, const void *src, size_t n);
+void *neon_memset(void *s, int c, size_t n);
+void neon_memzero(void *s, size_t n);
+void neon_copy_page(void *to, const void *from);
+
+bool neon_string_enable = true;
+EXPORT_SYMBOL(neon_string_enable);
+module_param_named(enable, neon_string_enable, bool, 0644);
+
+static bool neon_string_ready;
+
+static bool neon_string_begin(void)
+{
+	bool online;
+
+	if (!neon_string_ready || !neon_string_enable || in_interrupt())
+		return false;
+
+	/* a cpu being brought up copies before vfp_enable() has run on it */
+	preempt_disable();
+	online = cpu_online(smp_processor_id());
+	if (online)
+		kernel_neon_begin();
+	preempt_enable();
+
+	return online;
+}
+
+/* Piece of a long request to do before the next preemption point */
+static size_t neon_string_chunk(size_t n)
+{
+	return n >= 2 * NEON_STRING_CHUNK ? NEON_STRING_CHUNK : n;
+}
+
+void *neon_memcpy(void *dest, const void *src, size_t n)
+{
+	const char *s = src;
+	char *d = dest;
+
+	if (!neon_string_begin())
+		return __memcpy_arm(dest, src, n);
+
+	for (;;) {
+		size_t len = neon_string_chunk(n);
+
+		__memcpy_neon(d, s, len);
+		d += len;
+		s += len;
+		n -= len;
+		if (!n)
+			break;
+		kernel_neon_end();
+		kernel_neon_begin();
+	}
+	kernel_neon_end();
+
+	return dest;
+}
+
+void *neon_memset(void *p, int c, size_t n)
+{
+	char *d = p;
+
+	if (!neon_string_begin())
+		return __memset_arm(p, c, n);
+
+	for (;;) {
+		size_t len = neon_string_chunk(n);
+
+		__memset_neon(d, c, len);
+		d += len;
+		n -= len;
+		if (!n)
+			break;
+		kernel_neon_end();
+		kernel_neon_begin();
+	}
+	kernel_neon_end();
+
+	return p;
+}
+
+void neon_memzero(void *p, size_t n)
+{
+	neon_memset(p, 0, n);
+}
+
+void neon_copy_page(void *to, const void *from)
+{
+	if (!neon_string_begin()) {
+		__copy_page_arm(to, from);
+		return;
+	}
+
+	__copy_page_neon(to, from);
+	kernel_neon_end();
+}
+
+/*
+ * The VFP unit may be powered off and its access bits lost across
+ * suspend, so stay on the ARM versions from before the VFP state is
+ * saved until after it has been set up again.
+ */
+static int neon_string_suspend(void)
+{
+	neon_string_ready = false;
+	return 0;
+}
+
+static void neon_string_resume(void)
+{
+	neon_string_ready = true;
+}
+
+static struct syscore_ops neon_string_syscore_ops = {
+	.suspend	= neon_string_suspend,
+	.resume		= neon_string_resume,
+};
+
+static int __init neon_string_init(void)
+{
+	if (!(elf_hwcap & HWCAP_NEON))
+		return 0;
+
+	register_syscore_ops(&neon_string_syscore_ops);
+	neon_string_ready = true;
+	pr_info("NEON memcpy/memset/copy_page for %u bytes and up%s\n",
+		NEON_STRING_MIN, neon_string_enable ? "" : " (disabled)");
+	return 0;
+}
+late_initcall_sync(neon_string_init);
@@ -33,11 +33,19 @@
 #include <linux/sched.h>
 #include <linux/device.h>
 #include <linux/miscdevice.h>
+#include <linux/tick.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/spinlock.h>
+#include <linux/pm_qos_params.h>
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/earlysuspend.h>
 #endif
 
+#include "cpu-tegra.h"
+#include "periodic-work.h"
+
 #define CPUS_AVAILABLE		num_possible_cpus()
 #define SAMPLING_PERIODS 		18	
 #define INDEX_MAX_VALUE		(SAMPLING_PERIODS - 1)	
@@ -48,6 +56,12 @@
 #define MIN_CPU			1
 #define MAX_CPU			4
 #define SAMPLE_TIME		20
+#define PARK_TIME		2000
+
+/* Load sampling modes */
+#define LOAD_MODE_NR_RUNNING	0
+#define LOAD_MODE_CPU_BUSY	1
+#define LOAD_MODE_CPU_UTIL	2
 
 /* Control flags */
 unsigned char flags;
@@ -64,6 +78,10 @@ unsigned int min_cpu;
 unsigned int max_cpu;
 unsigned int sample_time;
 unsigned int sampling_period;
+unsigned int load_mode;
+unsigned int park;
+unsigned int park_time;
+unsigned int thermal_spread;
 } rev = {
 	.shift_all = SHIFT_ALL,
 	.shift_cpu = SHIFT_CPU,
@@ -72,6 +90,10 @@ unsigned int sampling_period;
 	.max_cpu = MAX_CPU,
 	.sample_time = SAMPLE_TIME,
 	.sampling_period = SAMPLING_PERIODS,
+	.load_mode = LOAD_MODE_NR_RUNNING,
+	.park = 0,
+	.park_time = PARK_TIME,
+	.thermal_spread = 0,
 };
 
 static unsigned int debug = 0;
@@ -83,30 +105,258 @@ do { 				\
 		pr_info(msg);	\
 } while (0)
 
-struct delayed_work hotplug_decision_work;
+struct tegra_periodic_work hotplug_decision_work;
 struct delayed_work hotplug_unpause_work;
 struct work_struct hotplug_online_all_work;
 struct work_struct hotplug_online_single_work;
+struct work_struct hotplug_boost_work;
 struct delayed_work hotplug_offline_work;
+struct delayed_work hotplug_park_offline_work;
 
 static unsigned int history[SAMPLING_PERIODS];
 static unsigned int index;
 
+/*
+ * Per-CPU idle accounting snapshot used by LOAD_MODE_CPU_BUSY.
+ * valid is cleared whenever the CPU has been seen offline so that
+ * the first sample after an online does not count the offline
+ * period as busy time.
+ */
+struct cpu_load_data {
+	u64 prev_idle;
+	u64 prev_wall;
+	bool valid;
+};
+static DEFINE_PER_CPU(struct cpu_load_data, load_data);
+
+/*
+ * Hotplug decision statistics. time_at_cpus[n] accumulates jiffies
+ * spent with n CPUs online, the *_us fields accumulate time spent
+ * inside cpu_up()/cpu_down().
+ */
+static struct {
+	unsigned int online_count;
+	unsigned int offline_count;
+	unsigned int park_count;
+	unsigned int unpark_count;
+	unsigned int thermal_count;
+	u64 online_time_us;
+	u64 offline_time_us;
+	u64 time_at_cpus[NR_CPUS + 1];
+	u64 last_update;
+	unsigned int last_cpus;
+} hp_stats;
+static DEFINE_SPINLOCK(hp_stats_lock);
+
+static void hotplug_stats_update(void)
+{
+	u64 now = get_jiffies_64();
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&hp_stats_lock, irqflags);
+	if (hp_stats.last_cpus <= NR_CPUS)
+		hp_stats.time_at_cpus[hp_stats.last_cpus] +=
+			now - hp_stats.last_update;
+	hp_stats.last_update = now;
+	hp_stats.last_cpus = num_online_cpus();
+	spin_unlock_irqrestore(&hp_stats_lock, irqflags);
+}
+
+static void __cpuinit hotplug_cpu_up(unsigned int cpu)
+{
+	ktime_t start = ktime_get();
+	unsigned long irqflags;
+
+	if (tegra_hp_cpu_up(cpu))
+		return;
+
+	spin_lock_irqsave(&hp_stats_lock, irqflags);
+	hp_stats.online_count++;
+	hp_stats.online_time_us += ktime_to_us(ktime_sub(ktime_get(), start));
+	spin_unlock_irqrestore(&hp_stats_lock, irqflags);
+	hotplug_stats_update();
+}
+
+static void hotplug_cpu_down(unsigned int cpu)
+{
+	ktime_t start = ktime_get();
+	unsigned long irqflags;
+
+	if (tegra_hp_cpu_down(cpu))
+		return;
+
+	spin_lock_irqsave(&hp_stats_lock, irqflags);
+	hp_stats.offline_count++;
+	hp_stats.offline_time_us += ktime_to_us(ktime_sub(ktime_get(), start));
+	spin_unlock_irqrestore(&hp_stats_lock, irqflags);
+	hotplug_stats_update();
+}
+
+/*
+ * Parking keeps a core online but out of the scheduler's reach, so it
+ * sits in LP2 and can be brought back in microseconds. Cores that stay
+ * parked for park_time are offlined for real by hotplug_park_offline_work.
+ */
+static unsigned int hotplug_active_cpus(void)
+{
+	return num_online_cpus() - cpumask_weight(cpu_parked_mask);
+}
+
+static void hotplug_park_cpu(unsigned int cpu)
+{
+	unsigned long irqflags;
+
+	set_cpu_parked(cpu, true);
+
+	spin_lock_irqsave(&hp_stats_lock, irqflags);
+	hp_stats.park_count++;
+	spin_unlock_irqrestore(&hp_stats_lock, irqflags);
+
+	schedule_delayed_work_on(0, &hotplug_park_offline_work,
+		msecs_to_jiffies(rev.park_time));
+}
+
+static bool hotplug_unpark_cpu(void)
+{
+	unsigned long irqflags;
+	unsigned int cpu;
+
+	for_each_cpu(cpu, cpu_parked_mask) {
+		set_cpu_parked(cpu, false);
+		wake_up_idle_cpu(cpu);
+
+		spin_lock_irqsave(&hp_stats_lock, irqflags);
+		hp_stats.unpark_count++;
+		spin_unlock_irqrestore(&hp_stats_lock, irqflags);
+		dprintk("auto_hotplug: CPU%d unparked.\n", cpu);
+		return true;
+	}
+	return false;
+}
+
+static void hotplug_unpark_all(void)
+{
+	cancel_delayed_work(&hotplug_park_offline_work);
+	while (hotplug_unpark_cpu())
+		;
+}
+
+/*
+ * Sum of the busy percentage of every online CPU since the previous
+ * sample. A single fully loaded CPU contributes 100, which keeps the
+ * result on the same scale as nr_running() * 100 so the existing
+ * thresholds apply to both modes.
+ */
+static unsigned int get_cpu_busy_load(void)
+{
+	unsigned int cpu, load = 0;
+
+	for_each_possible_cpu(cpu) {
+		struct cpu_load_data *data = &per_cpu(load_data, cpu);
+		u64 cur_idle, cur_wall, idle, wall;
+
+		if (!cpu_online(cpu)) {
+			data->valid = false;
+			continue;
+		}
+
+		cur_idle = get_cpu_idle_time_us(cpu, &cur_wall);
+		if (cur_idle == -1ULL) {
+			/* No NO_HZ idle accounting, fall back to a runqueue */
+			load += nr_running() * 100 / num_online_cpus();
+			continue;
+		}
+
+		idle = cur_idle - data->prev_idle;
+		wall = cur_wall - data->prev_wall;
+		data->prev_idle = cur_idle;
+		data->prev_wall = cur_wall;
+
+		if (!data->valid) {
+			data->valid = true;
+			continue;
+		}
+
+		if (unlikely(!wall || wall < idle))
+			continue;
+
+		load += div64_u64(100 * (wall - idle), wall);
+	}
+
+	return load;
+}
+
+/*
+ * Sum of the scheduler's runnable average of every online CPU, on the
+ * same scale as get_cpu_busy_load(). It already decays over ~32ms, so
+ * a sample does not depend on when the previous one was taken.
+ */
+static unsigned int get_cpu_util_load(void)
+{
+	unsigned int cpu, load = 0;
+
+	for_each_online_cpu(cpu)
+		load += sched_cpu_util(cpu) * 100 >> 10;
+
+	return load;
+}
+
+/*
+ * Lowest number of cores we may run with. Input boost raises this
+ * through PM_QOS_MIN_ONLINE_CPUS for the duration of a touch.
+ */
+static unsigned int hotplug_min_cpus(void)
+{
+	unsigned int qos_min = pm_qos_request(PM_QOS_MIN_ONLINE_CPUS);
+
+	return max(rev.min_cpu, min(qos_min, rev.max_cpu));
+}
+
+/*
+ * Under a thermal cap every core runs at the capped rate, and more
+ * cores at that rate get more done than fewer cores would. With
+ * thermal_spread set, the online and offline thresholds are lowered by
+ * thermal_spread percent of the thermal pressure.
+ */
+static unsigned int hotplug_thermal_scale(unsigned int load, bool up,
+					  unsigned int online_cpus)
+{
+	unsigned int pressure;
+
+	if (!rev.thermal_spread)
+		return load;
+
+	pressure = tegra_cpu_thermal_pressure();
+	if (!pressure || (up && !tegra_cpu_edp_favor_up(online_cpus, 0)))
+		return load;
+
+	return load - load * pressure * rev.thermal_spread / 10000;
+}
+
 static void hotplug_decision_work_fn(struct work_struct *work)
 {
 	unsigned int running, disable_load, sampling_rate, enable_load, avg_running = 0;
 	unsigned int online_cpus, available_cpus, i, j;
+	unsigned long irqflags;
 
-	online_cpus = num_online_cpus();
+	online_cpus = hotplug_active_cpus();
 	available_cpus = rev.max_cpu;
-	disable_load = rev.down_shift * online_cpus; 
-	enable_load = rev.shift_cpu * online_cpus;
+	disable_load = hotplug_thermal_scale(rev.down_shift * online_cpus,
+					     false, online_cpus);
+	enable_load = hotplug_thermal_scale(rev.shift_cpu * online_cpus,
+					    true, online_cpus);
 	/*
 	 * Multiply nr_running() by 100 so we don't have to
 	 * use fp division to get the average.
 	 */
-	running = nr_running() * 100;
+	if (rev.load_mode == LOAD_MODE_CPU_BUSY)
+		running = get_cpu_busy_load();
+	else if (rev.load_mode == LOAD_MODE_CPU_UTIL)
+		running = get_cpu_util_load();
+	else
+		running = nr_running() * 100;
 	history[index] = running;
+	hotplug_stats_update();
 
 	dprintk("online_cpus is: %d\n", online_cpus);
 	dprintk("enable_load is: %d\n", enable_load);
@@ -153,18 +403,31 @@ static void hotplug_decision_work_fn(struct work_struct *work)
 			schedule_work(&hotplug_online_all_work);
 			return;
 		} else if (flags & HOTPLUG_PAUSED) {
-			schedule_delayed_work_on(0, &hotplug_decision_work, msecs_to_jiffies(rev.sample_time));
+			tegra_periodic_work_schedule_on(0, &hotplug_decision_work,
+				msecs_to_jiffies(rev.sample_time));
 			return;
 		} else if ((avg_running >= enable_load) && (online_cpus < available_cpus)) {
 			pr_info("auto_hotplug: Onlining single CPU, avg running: %d\n", avg_running);
+			if (avg_running < rev.shift_cpu * online_cpus) {
+				spin_lock_irqsave(&hp_stats_lock, irqflags);
+				hp_stats.thermal_count++;
+				spin_unlock_irqrestore(&hp_stats_lock, irqflags);
+			}
 			schedule_work(&hotplug_online_single_work);
 			return;
-		} else if (avg_running <= disable_load) {
+		} else if (avg_running <= disable_load &&
+			   online_cpus > hotplug_min_cpus()) {
 			/* Only queue a cpu_down() if there isn't one already pending */
 			if (!(delayed_work_pending(&hotplug_offline_work))) {
 				pr_info("auto_hotplug: Offlining CPU, avg running: %d\n", avg_running);
 				schedule_delayed_work_on(0, &hotplug_offline_work, HZ);
 			}
+		} else if (avg_running <= disable_load && hotplug_min_cpus() == 1) {
+			/*
+			 * Down to the last core: try the LP companion instead.
+			 * This is refused while an online is still in flight.
+			 */
+			tegra_hp_cluster_switch(true);
 		}
 	}
 
@@ -173,16 +436,19 @@ static void hotplug_decision_work_fn(struct work_struct *work)
 	 */
 	sampling_rate = msecs_to_jiffies(rev.sample_time) * online_cpus;
 	dprintk("sampling_rate is: %d\n", jiffies_to_msecs(sampling_rate));
-	schedule_delayed_work_on(0, &hotplug_decision_work, sampling_rate);
+	tegra_periodic_work_schedule_on(0, &hotplug_decision_work,
+		sampling_rate);
 
 }
 
 static void __cpuinit hotplug_online_all_work_fn(struct work_struct *work)
 {
 	unsigned int cpu;
+
+	hotplug_unpark_all();
 	for_each_possible_cpu(cpu) {
 		if (likely(!cpu_online(cpu))) {
-			cpu_up(cpu);
+			hotplug_cpu_up(cpu);
 			dprintk("auto_hotplug: CPU%d up.\n", cpu);
 		}
 	}
@@ -190,40 +456,134 @@ static void __cpuinit hotplug_online_all_work_fn(struct work_struct *work)
 	 * Pause for 1 second before even considering offlining a CPU
 	 */
 	schedule_delayed_work(&hotplug_unpause_work, HZ);
-	schedule_delayed_work_on(0, &hotplug_decision_work, msecs_to_jiffies(rev.sample_time));
+	tegra_periodic_work_schedule_on(0, &hotplug_decision_work,
+		msecs_to_jiffies(rev.sample_time));
 }
 
 static void __cpuinit hotplug_online_single_work_fn(struct work_struct *work)
 {
 	unsigned int cpu;
 
+	if (hotplug_unpark_cpu())
+		goto out;
+
 	for_each_possible_cpu(cpu) {
 		if (cpu) {
 			if (!cpu_online(cpu)) {
-				cpu_up(cpu);
+				hotplug_cpu_up(cpu);
 				dprintk("auto_hotplug: CPU%d up.\n", cpu);
 				break;
 			}
 		}
 	}
-	schedule_delayed_work_on(0, &hotplug_decision_work, msecs_to_jiffies(rev.sample_time));
+out:
+	tegra_periodic_work_schedule_on(0, &hotplug_decision_work,
+		msecs_to_jiffies(rev.sample_time));
 }
 
 static void hotplug_offline_work_fn(struct work_struct *work)
 {
 	unsigned int cpu;
 
+	if (rev.park) {
+		for (cpu = nr_cpu_ids - 1; cpu > 0; cpu--) {
+			if (hotplug_active_cpus() <= hotplug_min_cpus())
+				break;
+			if (cpu_online(cpu) && !cpu_parked(cpu)) {
+				hotplug_park_cpu(cpu);
+				dprintk("auto_hotplug: CPU%d parked.\n", cpu);
+				break;
+			}
+		}
+		goto out;
+	}
+
 	for_each_online_cpu(cpu) {
-		if (num_online_cpus() > rev.min_cpu)
+		if (num_online_cpus() > hotplug_min_cpus())
 			if (cpu) {
-				cpu_down(num_online_cpus() - 1);
+				hotplug_cpu_down(num_online_cpus() - 1);
 				dprintk("auto_hotplug: CPU%d down.\n", cpu);
 				break;
 		}
 	}
-	schedule_delayed_work_on(0, &hotplug_decision_work, msecs_to_jiffies(rev.sample_time));
+out:
+	tegra_periodic_work_schedule_on(0, &hotplug_decision_work,
+		msecs_to_jiffies(rev.sample_time));
+}
+
+/*
+ * Load stayed low for park_time: pay for the real cpu_down() now.
+ */
+static void hotplug_park_offline_work_fn(struct work_struct *work)
+{
+	unsigned int cpu;
+
+	for_each_cpu(cpu, cpu_parked_mask) {
+		set_cpu_parked(cpu, false);
+		hotplug_cpu_down(cpu);
+		dprintk("auto_hotplug: parked CPU%d down.\n", cpu);
+	}
 }
 
+/*
+ * A parked core can also be taken down behind our back (sysfs, another
+ * hotplug policy). Drop it from cpu_parked_mask once it is really gone.
+ */
+static int hotplug_park_cpu_notify(struct notifier_block *nb,
+	unsigned long action, void *hcpu)
+{
+	unsigned int cpu = (unsigned long)hcpu;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_DEAD:
+		set_cpu_parked(cpu, false);
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block hotplug_park_cpu_notifier = {
+	.notifier_call = hotplug_park_cpu_notify,
+};
+
+/*
+ * Online cores up to the PM QoS minimum right away instead of waiting
+ * for the load average to catch up.
+ */
+static void __cpuinit hotplug_boost_work_fn(struct work_struct *work)
+{
+	unsigned int cpu;
+
+	while (hotplug_active_cpus() < hotplug_min_cpus())
+		if (!hotplug_unpark_cpu())
+			break;
+
+	for_each_possible_cpu(cpu) {
+		if (num_online_cpus() >= hotplug_min_cpus())
+			break;
+		if (!cpu_online(cpu)) {
+			hotplug_cpu_up(cpu);
+			dprintk("auto_hotplug: CPU%d up for input.\n", cpu);
+		}
+	}
+}
+
+static int hotplug_min_cpus_notify(struct notifier_block *nb,
+				   unsigned long n, void *p)
+{
+	if (flags & (HOTPLUG_DISABLED | EARLYSUSPEND_ACTIVE))
+		return NOTIFY_OK;
+
+	if (n > hotplug_active_cpus())
+		schedule_work(&hotplug_boost_work);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block hotplug_min_cpus_notifier = {
+	.notifier_call = hotplug_min_cpus_notify,
+};
+
 static void hotplug_unpause_work_fn(struct work_struct *work)
 {
 	dprintk("auto_hotplug: Clearing pause flag\n");
@@ -236,16 +596,34 @@ void hotplug_disable(bool flag)
 		flags &= ~HOTPLUG_DISABLED;
 		flags &= ~HOTPLUG_PAUSED;
 		dprintk("auto_hotplug: Clearing disable flag\n");
-		schedule_delayed_work_on(0, &hotplug_decision_work, 0);
+		tegra_periodic_work_schedule_on(0, &hotplug_decision_work, 0);
 	} else if (flag && (!(flags & HOTPLUG_DISABLED))) {
 		flags |= HOTPLUG_DISABLED;
 		dprintk("auto_hotplug: Setting disable flag\n");
 		cancel_delayed_work_sync(&hotplug_offline_work);
-		cancel_delayed_work_sync(&hotplug_decision_work);
+		cancel_delayed_work_sync(&hotplug_park_offline_work);
+		hotplug_unpark_all();
+		cancel_delayed_work_sync(&hotplug_decision_work.dwork);
 		cancel_delayed_work_sync(&hotplug_unpause_work);
 	}
 }
 
+static void auto_hotplug_policy_start(void)
+{
+	hotplug_disable(false);
+}
+
+static void auto_hotplug_policy_stop(void)
+{
+	hotplug_disable(true);
+}
+
+static struct tegra_hp_policy auto_hotplug_policy = {
+	.name	= "auto_hotplug",
+	.start	= auto_hotplug_policy_start,
+	.stop	= auto_hotplug_policy_stop,
+};
+
 /**************SYSFS*******************/
 
 static ssize_t shift_cpu_show(struct device * dev, struct device_attribute * attr, char * buf)
@@ -381,6 +759,108 @@ static ssize_t sampling_period_store(struct device * dev, struct device_attribut
 	return size;
 }
 
+static ssize_t load_mode_show(struct device * dev, struct device_attribute * attr, char * buf)
+{
+	return sprintf(buf, "%d\n", rev.load_mode);
+}
+
+static ssize_t load_mode_store(struct device * dev, struct device_attribute * attr, const char * buf, size_t size)
+{
+	unsigned int val;
+
+	sscanf(buf, "%u", &val);
+
+	if (val != rev.load_mode && val <= LOAD_MODE_CPU_UTIL)
+	{
+		rev.load_mode = val;
+	}
+
+	return size;
+}
+
+static ssize_t park_show(struct device * dev, struct device_attribute * attr, char * buf)
+{
+	return sprintf(buf, "%d\n", rev.park);
+}
+
+static ssize_t park_store(struct device * dev, struct device_attribute * attr, const char * buf, size_t size)
+{
+	unsigned int val;
+
+	sscanf(buf, "%u", &val);
+
+	if (val != rev.park && val <= 1)
+	{
+		rev.park = val;
+		if (!val)
+			hotplug_unpark_all();
+	}
+
+	return size;
+}
+
+static ssize_t park_time_show(struct device * dev, struct device_attribute * attr, char * buf)
+{
+	return sprintf(buf, "%d\n", rev.park_time);
+}
+
+static ssize_t park_time_store(struct device * dev, struct device_attribute * attr, const char * buf, size_t size)
+{
+	unsigned int val;
+
+	sscanf(buf, "%u", &val);
+
+	if (val != rev.park_time && val >= 100 && val <= 60000)
+	{
+		rev.park_time = val;
+	}
+
+	return size;
+}
+
+static ssize_t thermal_spread_show(struct device * dev, struct device_attribute * attr, char * buf)
+{
+	return sprintf(buf, "%d\n", rev.thermal_spread);
+}
+
+static ssize_t thermal_spread_store(struct device * dev, struct device_attribute * attr, const char * buf, size_t size)
+{
+	unsigned int val;
+
+	sscanf(buf, "%u", &val);
+
+	if (val != rev.thermal_spread && val <= 100)
+	{
+		rev.thermal_spread = val;
+	}
+
+	return size;
+}
+
+static ssize_t stats_show(struct device * dev, struct device_attribute * attr, char * buf)
+{
+	unsigned long irqflags;
+	ssize_t len;
+	int i;
+
+	hotplug_stats_update();
+
+	spin_lock_irqsave(&hp_stats_lock, irqflags);
+	len = sprintf(buf, "online: %u %llu us\noffline: %u %llu us\n",
+		hp_stats.online_count, hp_stats.online_time_us,
+		hp_stats.offline_count, hp_stats.offline_time_us);
+	len += sprintf(buf + len, "park: %u\nunpark: %u\n",
+		hp_stats.park_count, hp_stats.unpark_count);
+	len += sprintf(buf + len, "thermal online: %u\n",
+		hp_stats.thermal_count);
+	for (i = 1; i <= CPUS_AVAILABLE; i++)
+		len += sprintf(buf + len, "cpus%d: %u ms\n", i,
+			jiffies_to_msecs(hp_stats.time_at_cpus[i]));
+	spin_unlock_irqrestore(&hp_stats_lock, irqflags);
+
+	return len;
+}
+
 static DEVICE_ATTR(shift_cpu, 0644, shift_cpu_show, shift_cpu_store);
 static DEVICE_ATTR(shift_all, 0644, shift_all_show, shift_all_store);
 static DEVICE_ATTR(down_shift, 0644, down_shift_show, down_shift_store);
@@ -388,6 +868,11 @@ static DEVICE_ATTR(min_cpu, 0644, min_cpu_show, min_cpu_store);
 static DEVICE_ATTR(max_cpu, 0644, max_cpu_show, max_cpu_store);
 static DEVICE_ATTR(sample_time, 0644, sample_time_show, sample_time_store);
 static DEVICE_ATTR(sampling_period, 0644, sampling_period_show, sampling_period_store);
+static DEVICE_ATTR(load_mode, 0644, load_mode_show, load_mode_store);
+static DEVICE_ATTR(park, 0644, park_show, park_store);
+static DEVICE_ATTR(park_time, 0644, park_time_show, park_time_store);
+static DEVICE_ATTR(thermal_spread, 0644, thermal_spread_show, thermal_spread_store);
+static DEVICE_ATTR(stats, 0444, stats_show, NULL);
 
 static struct attribute *revshift_hotplug_attributes[] = 
     {
@@ -398,6 +883,11 @@ static struct attribute *revshift_hotplug_attributes[] =
 	&dev_attr_max_cpu.attr,
 	&dev_attr_sample_time.attr,	
 	&dev_attr_sampling_period.attr,
+	&dev_attr_load_mode.attr,
+	&dev_attr_park.attr,
+	&dev_attr_park_time.attr,
+	&dev_attr_thermal_spread.attr,
+	&dev_attr_stats.attr,
 	NULL
     };
 
@@ -418,16 +908,21 @@ static void auto_hotplug_early_suspend(struct early_suspend *handler)
 {
 	int cpu;
 
+	if (flags & HOTPLUG_DISABLED)
+		return;
+
+	cancel_delayed_work_sync(&hotplug_park_offline_work);
+	hotplug_unpark_all();
 	for_each_possible_cpu(cpu) {
 		if (cpu)
-			cpu_down(cpu);
+			hotplug_cpu_down(cpu);
 	dprintk("auto_hotplug: Offlining CPUs for early suspend\n");
 	}
 	flags |= EARLYSUSPEND_ACTIVE;
 
 	/* Cancel all scheduled delayed work to avoid races */
 	cancel_delayed_work_sync(&hotplug_offline_work);
-	cancel_delayed_work_sync(&hotplug_decision_work);
+	cancel_delayed_work_sync(&hotplug_decision_work.dwork);
 }
 
 static void auto_hotplug_late_resume(struct early_suspend *handler)
@@ -435,7 +930,8 @@ static void auto_hotplug_late_resume(struct early_suspend *handler)
 	dprintk("auto_hotplug: late resume handler\n");
 	flags &= ~EARLYSUSPEND_ACTIVE;
 
-	schedule_delayed_work_on(0, &hotplug_decision_work, HZ);
+	if (!(flags & HOTPLUG_DISABLED))
+		tegra_periodic_work_schedule_on(0, &hotplug_decision_work, HZ);
 }
 
 static struct early_suspend auto_hotplug_suspend = {
@@ -466,18 +962,37 @@ int __init auto_hotplug_init(void)
 		goto err;
 	}
 
-	INIT_DELAYED_WORK(&hotplug_decision_work, hotplug_decision_work_fn);
+	hp_stats.last_update = get_jiffies_64();
+	hp_stats.last_cpus = num_online_cpus();
+
+	tegra_periodic_work_init(&hotplug_decision_work,
+		"auto_hotplug_decision", hotplug_decision_work_fn, 10);
 	INIT_DELAYED_WORK_DEFERRABLE(&hotplug_unpause_work, hotplug_unpause_work_fn);
 	INIT_WORK(&hotplug_online_all_work, hotplug_online_all_work_fn);
 	INIT_WORK(&hotplug_online_single_work, hotplug_online_single_work_fn);
+	INIT_WORK(&hotplug_boost_work, hotplug_boost_work_fn);
 	INIT_DELAYED_WORK_DEFERRABLE(&hotplug_offline_work, hotplug_offline_work_fn);
+	INIT_DELAYED_WORK_DEFERRABLE(&hotplug_park_offline_work, hotplug_park_offline_work_fn);
+	register_hotcpu_notifier(&hotplug_park_cpu_notifier);
+
+	/*
+	 * Another hotplug policy already owns the cores. Stay idle until
+	 * we get selected through the tegra hotplug policy interface.
+	 */
+	if (tegra_hp_register_policy(&auto_hotplug_policy) == -EBUSY) {
+		flags |= HOTPLUG_DISABLED;
+		goto out;
+	}
 
 	/*
 	 * Give the system time to boot before fiddling with hotplugging.
 	 */
 	flags |= HOTPLUG_PAUSED;
-	schedule_delayed_work_on(0, &hotplug_decision_work, HZ * 10);
+	tegra_periodic_work_schedule_on(0, &hotplug_decision_work, HZ * 10);
 	schedule_delayed_work(&hotplug_unpause_work, HZ * 20);
+out:
+	if (pm_qos_add_notifier(PM_QOS_MIN_ONLINE_CPUS, &hotplug_min_cpus_notifier))
+		pr_err("auto_hotplug: Failed to register min cpus PM QoS notifier\n");
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	register_early_suspend(&auto_hotplug_suspend);
@@ -30,6 +30,10 @@
 #include <linux/spinlock.h>
 #include <linux/usb.h>
 #include <linux/pm_runtime.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <mach/usb_phy.h>
 #include "board.h"
 #include "devices.h"
@@ -62,6 +66,31 @@ module_param(enum_delay_ms, ulong, 0644);
 MODULE_PARM_DESC(enum_delay_ms,
 	"baseband xmm power - delay in ms between modem on and enumeration");
 
+/*
+ * The HSIC autosuspend delay follows the traffic.  A link that wakes
+ * again less than l2_breakeven_ms after entering L2 did not sleep long
+ * enough to pay for the wakeup, so the delay doubles, up to
+ * autosuspend_max_ms.  A link that stays in L2 for four times that has
+ * idle gaps between bursts, so the delay shrinks by a quarter, down to
+ * autosuspend_min_ms.
+ */
+static bool adaptive_autosuspend = 1;
+module_param(adaptive_autosuspend, bool, 0644);
+MODULE_PARM_DESC(adaptive_autosuspend,
+	"baseband xmm power - adapt the HSIC autosuspend delay to the traffic");
+static unsigned int autosuspend_min_ms = 100;
+module_param(autosuspend_min_ms, uint, 0644);
+static unsigned int autosuspend_max_ms = 4000;
+module_param(autosuspend_max_ms, uint, 0644);
+static unsigned int l2_breakeven_ms = 500;
+module_param(l2_breakeven_ms, uint, 0644);
+
+/* IPC_AP_WAKE is polled this often while waiting for the modem to wake */
+static unsigned int handshake_poll_us = 50;
+module_param(handshake_poll_us, uint, 0644);
+MODULE_PARM_DESC(handshake_poll_us,
+	"baseband xmm power - IPC_AP_WAKE poll interval during wakeup");
+
 static struct usb_device_id xmm_pm_ids[] = {
 	{ USB_DEVICE(VENDOR_ID, PRODUCT_ID),
 	.driver_info = 0 },
@@ -114,6 +143,45 @@ static DEFINE_MUTEX(xmm_onoff_mutex);
 static int modem_reset_flag = 0;
 bool resume_from_l3 = false;
 
+/* the USB core's default; adapted at each L2 exit */
+static unsigned int xmm_autosuspend_ms = 2000;
+static struct work_struct autosuspend_work;
+
+/* latency buckets: <1, <4, <16, <64 and >= 64 ms */
+#define XMM_HIST_BUCKETS	5
+
+enum {
+	XMM_LAT_HANDSHAKE,	/* IPC_BB_WAKE raised to IPC_AP_WAKE low */
+	XMM_LAT_AP_L2_L0,	/* L2TOL0 to L0, AP initiated */
+	XMM_LAT_CP_L2_L0,	/* L2TOL0 to L0, CP initiated */
+	XMM_LAT_L3_L0,		/* L3TOL0 to L0 */
+	XMM_LAT_NR,
+};
+
+static const char * const xmm_lat_names[XMM_LAT_NR] = {
+	"handshake", "AP L2->L0", "CP L2->L0", "L3->L0",
+};
+
+struct xmm_lat_stats {
+	unsigned long count;
+	u64 total_ns;
+	u64 max_ns;
+	unsigned long hist[XMM_HIST_BUCKETS];
+};
+
+/* under xmm_lock */
+static struct {
+	struct xmm_lat_stats lat[XMM_LAT_NR];
+	unsigned long handshakes_skipped;
+	unsigned long handshake_timeouts;
+	unsigned long l2_entries;
+	unsigned long l2_short;		/* woken before l2_breakeven_ms */
+	u64 l2_total_ns;
+	ktime_t l2_enter;
+	ktime_t wake_start;
+	int wake_kind;
+} xmm_stats;
+
 #define MOD_HANG        TEGRA_GPIO_PN2
 
 static void baseband_xmm_power_reset_on(void);
@@ -543,9 +611,60 @@ void baseband_xmm_L3_resume_check(void)
 }
 EXPORT_SYMBOL_GPL(baseband_xmm_L3_resume_check);
 
+/* Called with xmm_lock held */
+static void xmm_lat_account(int kind, u64 ns)
+{
+	struct xmm_lat_stats *st = &xmm_stats.lat[kind];
+	unsigned int us = div_u64(ns, NSEC_PER_USEC);
+	unsigned int bucket = 0;
+
+	while (bucket < XMM_HIST_BUCKETS - 1 &&
+	       us >= 1000U << (2 * bucket))
+		bucket++;
+	st->hist[bucket]++;
+	st->count++;
+	st->total_ns += ns;
+	st->max_ns = max(st->max_ns, ns);
+}
+
+static void baseband_xmm_power_autosuspend_work(struct work_struct *work)
+{
+	struct usb_device *udev = usbdev;
+
+	if (udev && adaptive_autosuspend)
+		pm_runtime_set_autosuspend_delay(&udev->dev,
+			ACCESS_ONCE(xmm_autosuspend_ms));
+}
+
+/*
+ * Called with xmm_lock held when the link leaves L2 after @l2_ns in it.
+ * The new delay is applied from the workqueue, this can run in the
+ * HSIC resume path.
+ */
+static void baseband_xmm_adapt_autosuspend(u64 l2_ns)
+{
+	unsigned int l2_ms = div_u64(l2_ns, NSEC_PER_MSEC);
+	unsigned int delay = xmm_autosuspend_ms;
+
+	xmm_stats.l2_total_ns += l2_ns;
+	if (l2_ms < l2_breakeven_ms) {
+		xmm_stats.l2_short++;
+		delay = min(delay * 2, autosuspend_max_ms);
+	} else if (l2_ms >= 4 * l2_breakeven_ms) {
+		delay = max(delay - delay / 4, autosuspend_min_ms);
+	}
+	if (!adaptive_autosuspend || delay == xmm_autosuspend_ms)
+		return;
+	xmm_autosuspend_ms = delay;
+	if (workqueue)
+		queue_work(workqueue, &autosuspend_work);
+}
+
 void baseband_xmm_set_power_status(unsigned int status)
 {
 	struct baseband_power_platform_data *data = baseband_power_driver_data;
+	enum baseband_xmm_powerstate_t prev = baseband_xmm_powerstate;
+	ktime_t now = ktime_get();
 	int value = 0;
 	unsigned long flags;
 
@@ -563,6 +682,13 @@ void baseband_xmm_set_power_status(unsigned int status)
 		}*/
 		pr_info("L0\n");
 		baseband_xmm_powerstate = status;
+		spin_lock_irqsave(&xmm_lock, flags);
+		if ((prev == BBXMM_PS_L2TOL0 || prev == BBXMM_PS_L3TOL0) &&
+		    xmm_stats.wake_kind >= 0)
+			xmm_lat_account(xmm_stats.wake_kind, ktime_to_ns(
+				ktime_sub(now, xmm_stats.wake_start)));
+		xmm_stats.wake_kind = -1;
+		spin_unlock_irqrestore(&xmm_lock, flags);
 		value = gpio_get_value(data->modem.xmm.ipc_hsic_active);
 		pr_debug("before L0 ipc_hsic_active=%d\n", value);
 		if (!value) {
@@ -582,6 +708,10 @@ void baseband_xmm_set_power_status(unsigned int status)
 	case BBXMM_PS_L2:
 		pr_info("L2\n");
 		baseband_xmm_powerstate = status;
+		spin_lock_irqsave(&xmm_lock, flags);
+		xmm_stats.l2_entries++;
+		xmm_stats.l2_enter = now;
+		spin_unlock_irqrestore(&xmm_lock, flags);
 		wake_unlock(&wakelock);
 		modem_sleep_flag = true;
 		break;
@@ -612,9 +742,24 @@ void baseband_xmm_set_power_status(unsigned int status)
 		if (baseband_xmm_powerstate == BBXMM_PS_L2) {
 			baseband_xmm_powerstate = status;
 			pr_debug("BB XMM POWER STATE = %d\n", status);
+			spin_lock_irqsave(&xmm_lock, flags);
+			xmm_stats.wake_start = now;
+			xmm_stats.wake_kind = CP_initiated_L2toL0 ?
+				XMM_LAT_CP_L2_L0 : XMM_LAT_AP_L2_L0;
+			baseband_xmm_adapt_autosuspend(ktime_to_ns(
+				ktime_sub(now, xmm_stats.l2_enter)));
+			spin_unlock_irqrestore(&xmm_lock, flags);
 			baseband_xmm_power_L2_resume();
 		} else
 			goto exit_without_state_change;
+		break;
+	case BBXMM_PS_L3TOL0:
+		baseband_xmm_powerstate = status;
+		spin_lock_irqsave(&xmm_lock, flags);
+		xmm_stats.wake_start = now;
+		xmm_stats.wake_kind = XMM_LAT_L3_L0;
+		spin_unlock_irqrestore(&xmm_lock, flags);
+		break;
 	default:
 		baseband_xmm_powerstate = status;
 		break;
@@ -831,12 +976,45 @@ static void baseband_xmm_power_autopm_resume(struct work_struct *work)
 }
 
 
+/*
+ * AP initiated wakeup: raise IPC_BB_WAKE and wait up to a second for the
+ * modem to answer by pulling IPC_AP_WAKE low.  The line is polled every
+ * handshake_poll_us rather than every millisecond, as the modem usually
+ * answers well within one.
+ */
+static int baseband_xmm_wake_modem(struct baseband_power_platform_data *data)
+{
+	ktime_t start = ktime_get();
+	ktime_t now = start;
+	unsigned long flags;
+	int ret = -ETIMEDOUT;
+
+	gpio_set_value(data->modem.xmm.ipc_bb_wake, 1);
+	pr_debug("waiting for host wakeup from CP...\n");
+	while (ktime_us_delta(now, start) < USEC_PER_SEC) {
+		udelay(max(handshake_poll_us, 1U));
+		now = ktime_get();
+		if (!gpio_get_value(data->modem.xmm.ipc_ap_wake)) {
+			ret = 0;
+			break;
+		}
+	}
+
+	spin_lock_irqsave(&xmm_lock, flags);
+	if (ret)
+		xmm_stats.handshake_timeouts++;
+	else
+		xmm_lat_account(XMM_LAT_HANDSHAKE,
+				ktime_to_ns(ktime_sub(now, start)));
+	spin_unlock_irqrestore(&xmm_lock, flags);
+	return ret;
+}
+
 /* Do the work for AP/CP initiated L2->L0 */
 static void baseband_xmm_power_L2_resume(void)
 {
 	struct baseband_power_platform_data *data = baseband_power_driver_data;
-	int value;
-	int delay = 1000; /* maxmum delay in msec */
+	unsigned long flags;
 
 	pr_debug("%s\n", __func__);
 
@@ -849,17 +1027,20 @@ static void baseband_xmm_power_L2_resume(void)
 		pr_info("CP L2->L0\n");
 		CP_initiated_L2toL0 = false;
 		queue_work(workqueue, &L2_resume_work);
+	} else if (!gpio_get_value(data->modem.xmm.ipc_ap_wake)) {
+		/*
+		 * The modem already pulled IPC_AP_WAKE low, its own wakeup
+		 * crossed ours and its interrupt is still on the way.  There
+		 * is nothing to ask it for.
+		 */
+		pr_info("AP L2->L0, CP awake\n");
+		spin_lock_irqsave(&xmm_lock, flags);
+		xmm_stats.handshakes_skipped++;
+		spin_unlock_irqrestore(&xmm_lock, flags);
 	} else {
 		/* set the slave wakeup request */
 		pr_info("AP L2->L0\n");
-		gpio_set_value(data->modem.xmm.ipc_bb_wake, 1);
-		pr_debug("waiting for host wakeup from CP...\n");
-		do {
-			mdelay(1);
-			value = gpio_get_value(data->modem.xmm.ipc_ap_wake);
-			delay--;
-		} while ((value) && (delay));
-		if (delay)
+		if (!baseband_xmm_wake_modem(data))
 			pr_debug("gpio host wakeup low <-\n");
 		else
 			pr_info("!!AP L2->L0 Failed\n");
@@ -1026,6 +1207,9 @@ static void baseband_xmm_device_add_handler(struct usb_device *udev)
 		pr_info("Add device %d <%s %s>\n", udev->devnum,
 			udev->manufacturer, udev->product);
 		usbdev = udev;
+		if (adaptive_autosuspend)
+			pm_runtime_set_autosuspend_delay(&udev->dev,
+				xmm_autosuspend_ms);
 		usb_enable_autosuspend(udev);
 		pr_info("enable autosuspend\n");
 		wake_unlock(&modem_recovery_wakelock);
@@ -1063,6 +1247,96 @@ static struct notifier_block usb_xmm_nb = {
 	.notifier_call = usb_xmm_notify,
 };
 
+#ifdef CONFIG_DEBUG_FS
+
+static struct dentry *xmm_debugfs;
+
+static int baseband_xmm_stats_show(struct seq_file *s, void *data)
+{
+	unsigned long flags;
+	typeof(xmm_stats) st;
+	int i;
+
+	spin_lock_irqsave(&xmm_lock, flags);
+	st = xmm_stats;
+	spin_unlock_irqrestore(&xmm_lock, flags);
+
+	seq_printf(s, "autosuspend %u ms%s\n", ACCESS_ONCE(xmm_autosuspend_ms),
+		   adaptive_autosuspend ? " (adaptive)" : "");
+	seq_printf(s, "L2 entries %lu short %lu avg %llu ms\n",
+		   st.l2_entries, st.l2_short, st.l2_entries ?
+		   div_u64(div_u64(st.l2_total_ns, st.l2_entries),
+			   NSEC_PER_MSEC) : 0);
+	seq_printf(s, "handshakes skipped %lu timeouts %lu\n",
+		   st.handshakes_skipped, st.handshake_timeouts);
+	for (i = 0; i < XMM_LAT_NR; i++) {
+		struct xmm_lat_stats *l = &st.lat[i];
+
+		seq_printf(s, "%s: %lu avg %llu us max %llu us\n",
+			   xmm_lat_names[i], l->count, l->count ?
+			   div_u64(div_u64(l->total_ns, l->count),
+				   NSEC_PER_USEC) : 0,
+			   div_u64(l->max_ns, NSEC_PER_USEC));
+		seq_printf(s, "  ms <1 %lu <4 %lu <16 %lu <64 %lu >=64 %lu\n",
+			   l->hist[0], l->hist[1], l->hist[2], l->hist[3],
+			   l->hist[4]);
+	}
+	return 0;
+}
+
+/* any write clears the counters */
+static ssize_t baseband_xmm_stats_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&xmm_lock, flags);
+	memset(xmm_stats.lat, 0, sizeof(xmm_stats.lat));
+	xmm_stats.handshakes_skipped = 0;
+	xmm_stats.handshake_timeouts = 0;
+	xmm_stats.l2_entries = 0;
+	xmm_stats.l2_short = 0;
+	xmm_stats.l2_total_ns = 0;
+	spin_unlock_irqrestore(&xmm_lock, flags);
+	return count;
+}
+
+static int baseband_xmm_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, baseband_xmm_stats_show, inode->i_private);
+}
+
+static const struct file_operations baseband_xmm_stats_fops = {
+	.open		= baseband_xmm_stats_open,
+	.read		= seq_read,
+	.write		= baseband_xmm_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void baseband_xmm_debugfs_init(void)
+{
+	xmm_debugfs = debugfs_create_file("baseband_xmm_power",
+		S_IRUGO | S_IWUSR, NULL, NULL, &baseband_xmm_stats_fops);
+}
+
+static void baseband_xmm_debugfs_exit(void)
+{
+	debugfs_remove(xmm_debugfs);
+}
+
+#else
+
+static inline void baseband_xmm_debugfs_init(void)
+{
+}
+
+static inline void baseband_xmm_debugfs_exit(void)
+{
+}
+
+#endif
+
 static int baseband_xmm_power_driver_probe(struct platform_device *device)
 {
 	struct baseband_power_platform_data *data
@@ -1201,6 +1475,7 @@ static int baseband_xmm_power_driver_probe(struct platform_device *device)
 	INIT_WORK(&init2_work, baseband_xmm_power_init2_work);
 	INIT_WORK(&L2_resume_work, baseband_xmm_power_L2_resume_work);
 	INIT_WORK(&autopm_resume_work, baseband_xmm_power_autopm_resume);
+	INIT_WORK(&autosuspend_work, baseband_xmm_power_autosuspend_work);
 
 	/* init state variables */
 	register_hsic_device = true;
@@ -1208,9 +1483,11 @@ static int baseband_xmm_power_driver_probe(struct platform_device *device)
 	spin_lock_irqsave(&xmm_lock, flags);
 	baseband_xmm_powerstate = BBXMM_PS_UNINIT;
 	wakeup_pending = false;
+	xmm_stats.wake_kind = -1;
 	spin_unlock_irqrestore(&xmm_lock, flags);
 
 	usb_register_notify(&usb_xmm_nb);
+	baseband_xmm_debugfs_init();
 
 	pr_debug("%s }\n", __func__);
 	return 0;
@@ -1236,6 +1513,7 @@ static int baseband_xmm_power_driver_remove(struct platform_device *device)
 		return 0;
 
 	usb_unregister_notify(&usb_xmm_nb);
+	baseband_xmm_debugfs_exit();
 
 	/* free work structure */
 	kfree(baseband_xmm_power_work);
@@ -1282,7 +1560,6 @@ static int baseband_xmm_power_driver_handle_resume(
 			struct baseband_power_platform_data *data)
 {
 	int value;
-	int delay = 1000; /* maxmum delay in msec */
 	unsigned long flags;
 
 	pr_debug("%s\n", __func__);
@@ -1304,15 +1581,7 @@ static int baseband_xmm_power_driver_handle_resume(
 	if (value) {
 		pr_info("AP L3 -> L0\n");
 		/* wake bb */
-		gpio_set_value(data->modem.xmm.ipc_bb_wake, 1);
-
-		pr_debug("waiting for host wakeup...\n");
-		do {
-			mdelay(1);
-			value = gpio_get_value(data->modem.xmm.ipc_ap_wake);
-			delay--;
-		} while ((value) && (delay));
-		if (delay)
+		if (!baseband_xmm_wake_modem(data))
 			pr_debug("gpio host wakeup low <-\n");
 	} else {
 		pr_info("CP L3 -> L0\n");
@@ -557,6 +557,7 @@ static struct tegra_dc_out grouper_disp1_out = {
 
 	.modes		= grouper_panel_modes,
 	.n_modes	= ARRAY_SIZE(grouper_panel_modes),
+	.idle_refresh_hz = 40,
 
 	.enable		= grouper_panel_enable,
 	.disable	= grouper_panel_disable,
@@ -597,6 +597,7 @@ static struct platform_device *grouper_devices[] __initdata = {
 	&tegra_spdif_device,
 	&spdif_dit_device,
 	&bluetooth_dit_device,
+	&baseband_dit_device,
 	&grouper_bcm4330_rfkill_device,
 	&tegra_pcm_device,
 	&grouper_audio_device,
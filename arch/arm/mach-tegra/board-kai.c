@@ -609,6 +609,7 @@ static struct platform_device *kai_devices[] __initdata = {
 	&tegra_spdif_device,
 	&spdif_dit_device,
 	&bluetooth_dit_device,
+	&baseband_dit_device,
 	&tegra_pcm_device,
 	&kai_audio_device,
 	&kai_leds_gpio_device,
@@ -24,6 +24,7 @@
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/init.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/module.h>
 #include <linux/seq_file.h>
@@ -31,6 +32,9 @@
 #include <linux/uaccess.h>
 #include <trace/events/power.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/tegra_clk.h>
+
 #include <mach/clk.h>
 
 #include "board.h"
@@ -102,17 +106,43 @@ struct clk *tegra_get_clock_by_name(const char *name)
 }
 EXPORT_SYMBOL(tegra_get_clock_by_name);
 
+/* Must be called with clk_lock(c) held */
 static void clk_stats_update(struct clk *c)
 {
 	u64 cur_jiffies = get_jiffies_64();
+	u64 now = ktime_to_ns(ktime_get());
+	struct clk_rate_residency *r;
+	int i;
 
 	if (c->refcnt) {
 		c->stats.time_on = c->stats.time_on +
 			(jiffies64_to_cputime64(cur_jiffies) -
 			 (c->stats.last_update));
+
+		/*
+		 * Charge the time since the last update to the rate the
+		 * clock had then. Rates past the table size go to the last
+		 * entry, reported as rate 0.
+		 */
+		for (i = 0; i < c->stats.nr_rates; i++)
+			if (c->stats.rates[i].rate == c->stats.cur_rate)
+				break;
+		if (i == c->stats.nr_rates) {
+			if (i < CLK_STATS_RATES) {
+				c->stats.nr_rates++;
+				c->stats.rates[i].rate = c->stats.cur_rate;
+			} else {
+				i = CLK_STATS_RATES - 1;
+				c->stats.rates[i].rate = 0;
+			}
+		}
+		r = &c->stats.rates[i];
+		r->time_ns += now - c->stats.rate_since;
 	}
 
 	c->stats.last_update = cur_jiffies;
+	c->stats.rate_since = now;
+	c->stats.cur_rate = clk_get_rate_locked(c);
 }
 
 /* Must be called with clk_lock(c) held */
@@ -230,6 +260,8 @@ void clk_init(struct clk *c)
 			c->state = ON;
 	}
 	c->stats.last_update = get_jiffies_64();
+	c->stats.rate_since = ktime_to_ns(ktime_get());
+	c->stats.cur_rate = clk_get_rate_locked(c);
 
 	mutex_lock(&clock_list_lock);
 	list_add(&c->node, &clocks);
@@ -279,6 +311,10 @@ int clk_enable(struct clk *c)
 
 	clk_lock_save(c, &flags);
 	ret = clk_enable_locked(c);
+	if (!ret) {
+		c->stats.enables++;
+		trace_tegra_clk_enable(c->name, c->refcnt, _RET_IP_);
+	}
 	clk_unlock_restore(c, &flags);
 	return ret;
 }
@@ -313,6 +349,7 @@ void clk_disable(struct clk *c)
 
 	clk_lock_save(c, &flags);
 	clk_disable_locked(c);
+	trace_tegra_clk_disable(c->name, c->refcnt, _RET_IP_);
 	clk_unlock_restore(c, &flags);
 }
 EXPORT_SYMBOL(clk_disable);
@@ -383,8 +420,10 @@ int clk_set_parent_locked(struct clk *c, struct clk *parent)
 			new_rate < old_rate)
 		ret = tegra_dvfs_set_rate(c, new_rate);
 
-	if (new_rate != old_rate)
+	if (new_rate != old_rate) {
+		clk_stats_update(c);
 		clk_rate_change_notify(c, new_rate);
+	}
 
 out:
 	if (disable)
@@ -465,8 +504,11 @@ int clk_set_rate_locked(struct clk *c, unsigned long rate)
 	if (clk_is_auto_dvfs(c) && rate < old_rate && c->refcnt > 0)
 		ret = tegra_dvfs_set_rate(c, rate);
 
-	if (rate != old_rate)
+	if (rate != old_rate) {
+		c->stats.rate_changes++;
+		clk_stats_update(c);
 		clk_rate_change_notify(c, rate);
+	}
 
 out:
 	if (disable)
@@ -476,7 +518,7 @@ out:
 
 int clk_set_rate(struct clk *c, unsigned long rate)
 {
-	unsigned long flags;
+	unsigned long flags, old_rate;
 	int ret;
 
 	if (!c->ops || !c->ops->set_rate)
@@ -484,7 +526,10 @@ int clk_set_rate(struct clk *c, unsigned long rate)
 
 	clk_lock_save(c, &flags);
 
+	old_rate = clk_get_rate_locked(c);
 	ret = clk_set_rate_locked(c, rate);
+	trace_tegra_clk_set_rate(c->name, old_rate, clk_get_rate_locked(c),
+				 rate, _RET_IP_);
 
 	clk_unlock_restore(c, &flags);
 
@@ -1046,6 +1091,55 @@ static const struct file_operations clock_tree_fops = {
 	.release	= single_release,
 };
 
+/*
+ * One line per clock: name, refcnt, rate, enables, rate changes, time on
+ * in ms, then rate:ms pairs for the time spent enabled at each rate.
+ */
+static int clock_stats_show(struct seq_file *s, void *data)
+{
+	struct clk_stats stats;
+	unsigned long flags;
+	unsigned int refcnt;
+	struct clk *c;
+	int i;
+
+	seq_printf(s, "# name refcnt rate enables rate_changes time_on_ms "
+		   "rate:ms...\n");
+
+	mutex_lock(&clock_list_lock);
+	list_for_each_entry(c, &clocks, node) {
+		clk_lock_save(c, &flags);
+		clk_stats_update(c);
+		stats = c->stats;
+		refcnt = c->refcnt;
+		clk_unlock_restore(c, &flags);
+
+		seq_printf(s, "%s %u %lu %lu %lu %llu", c->name, refcnt,
+			   stats.cur_rate, stats.enables, stats.rate_changes,
+			   (u64)cputime64_to_clock_t(stats.time_on) *
+			   MSEC_PER_SEC / USER_HZ);
+		for (i = 0; i < stats.nr_rates; i++)
+			seq_printf(s, " %lu:%llu", stats.rates[i].rate,
+				   div_u64(stats.rates[i].time_ns,
+					   NSEC_PER_MSEC));
+		seq_printf(s, "\n");
+	}
+	mutex_unlock(&clock_list_lock);
+	return 0;
+}
+
+static int clock_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, clock_stats_show, inode->i_private);
+}
+
+static const struct file_operations clock_stats_fops = {
+	.open		= clock_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static void syncevent_one(struct clk *c)
 {
 	struct clk *child;
@@ -1374,6 +1468,11 @@ static int __init clk_debugfs_init(void)
 	d = debugfs_create_file("syncevents", S_IRUGO|S_IWUSR, clk_debugfs_root, NULL,
 		&syncevent_fops);
 
+	d = debugfs_create_file("clock_stats", S_IRUGO, clk_debugfs_root, NULL,
+		&clock_stats_fops);
+	if (!d)
+		goto err_out;
+
 	if (dvfs_debugfs_init(clk_debugfs_root))
 		goto err_out;
 
@@ -97,9 +97,22 @@ struct clk_ops {
 	int		(*shared_bus_update)(struct clk *);
 };
 
+#define CLK_STATS_RATES		8
+
+struct clk_rate_residency {
+	unsigned long	rate;
+	u64		time_ns;	/* time enabled at this rate */
+};
+
 struct clk_stats {
 	cputime64_t 	time_on;
 	u64 		last_update;
+	u64		rate_since;	/* ns, start of current residency */
+	unsigned long	cur_rate;
+	unsigned long	enables;
+	unsigned long	rate_changes;
+	int		nr_rates;
+	struct clk_rate_residency rates[CLK_STATS_RATES];
 };
 
 enum cpu_mode {
@@ -112,6 +125,7 @@ enum shared_bus_users_mode {
 	SHARED_BW,
 	SHARED_CEILING,
 	SHARED_AUTO,
+	SHARED_HINT,	/* floor the EMC governor may trim, see tegra3_clocks.c */
 };
 
 enum clk_state {
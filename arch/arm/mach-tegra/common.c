@@ -27,6 +27,7 @@
 #include <linux/highmem.h>
 #include <linux/memblock.h>
 #include <linux/bitops.h>
+#include <linux/cma.h>
 #include <linux/sched.h>
 
 #include <asm/hardware/cache-l2x0.h>
@@ -803,6 +804,24 @@ out:
 #define SUPPORT_SMMU_BASE_FOR_TEGRA3_A01
 #endif
 
+/*
+ * End of the memory below what tegra_reserve() has set aside.  A carveout
+ * shared with the page allocator stays in the memory map, so this is not
+ * always the end of DRAM.
+ */
+static unsigned long __init tegra_reserve_top(void)
+{
+	unsigned long top = memblock_end_of_DRAM();
+
+	if (tegra_carveout_size && tegra_carveout_start < top)
+		top = tegra_carveout_start;
+	if (tegra_fb2_size && tegra_fb2_start < top)
+		top = tegra_fb2_start;
+	if (tegra_fb_size && tegra_fb_start < top)
+		top = tegra_fb_start;
+	return top;
+}
+
 void __init tegra_reserve(unsigned long carveout_size, unsigned long fb_size,
 	unsigned long fb2_size)
 {
@@ -813,7 +832,16 @@ void __init tegra_reserve(unsigned long carveout_size, unsigned long fb_size,
 
 	if (carveout_size) {
 		tegra_carveout_start = memblock_end_of_DRAM() - carveout_size;
-		if (memblock_remove(tegra_carveout_start, carveout_size)) {
+		/*
+		 * Lent to the page allocator until nvmap needs it.  Only
+		 * from highmem, which has no cacheable kernel mapping to
+		 * alias nvmap's uncached one.
+		 */
+		if (tegra_carveout_start >= lowmem_limit &&
+		    !cma_declare_contiguous(tegra_carveout_start,
+					    carveout_size, "carveout"))
+			tegra_carveout_size = carveout_size;
+		else if (memblock_remove(tegra_carveout_start, carveout_size)) {
 			pr_err("Failed to remove carveout %08lx@%08lx "
 				"from memory map\n",
 				carveout_size, tegra_carveout_start);
@@ -824,7 +852,7 @@ void __init tegra_reserve(unsigned long carveout_size, unsigned long fb_size,
 	}
 
 	if (fb2_size) {
-		tegra_fb2_start = memblock_end_of_DRAM() - fb2_size;
+		tegra_fb2_start = tegra_reserve_top() - fb2_size;
 		if (memblock_remove(tegra_fb2_start, fb2_size)) {
 			pr_err("Failed to remove second framebuffer "
 				"%08lx@%08lx from memory map\n",
@@ -836,7 +864,7 @@ void __init tegra_reserve(unsigned long carveout_size, unsigned long fb_size,
 	}
 
 	if (fb_size) {
-		tegra_fb_start = memblock_end_of_DRAM() - fb_size;
+		tegra_fb_start = tegra_reserve_top() - fb_size;
 		if (memblock_remove(tegra_fb_start, fb_size)) {
 			pr_err("Failed to remove framebuffer %08lx@%08lx "
 				"from memory map\n",
@@ -967,7 +995,7 @@ void __init tegra_ram_console_debug_reserve(unsigned long ram_console_size)
 	if (!res)
 		goto fail;
 
-	res->start = memblock_end_of_DRAM() - ram_console_size;
+	res->start = tegra_reserve_top() - ram_console_size;
 	res->end = res->start + ram_console_size - 1;
 
 	// Register an extra 1M before ramconsole to store kexec stuff
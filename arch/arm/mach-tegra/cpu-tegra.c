@@ -33,6 +33,8 @@
 #include <linux/suspend.h>
 #include <linux/debugfs.h>
 #include <linux/cpu.h>
+#include <linux/workqueue.h>
+#include <linux/frame_trace.h>
 
 #include <asm/system.h>
 
@@ -167,19 +169,23 @@ static int edp_thermal_index;
 static cpumask_t edp_cpumask;
 static unsigned int edp_limit;
 
+/* Soft ceiling derived from the predicted temperature, 0 if none */
+static unsigned int edp_predicted_limit;
+static BLOCKING_NOTIFIER_HEAD(edp_predict_notifier_list);
+
 unsigned int tegra_get_edp_limit(void)
 {
 	return edp_limit;
 }
 
-static unsigned int edp_predict_limit(unsigned int cpus)
+static unsigned int __edp_predict_limit(int index, unsigned int cpus)
 {
 	unsigned int limit = 0;
 
 	BUG_ON(cpus == 0);
 	if (cpu_edp_limits) {
-		BUG_ON(edp_thermal_index >= cpu_edp_limits_size);
-		limit = cpu_edp_limits[edp_thermal_index].freq_limits[cpus - 1];
+		BUG_ON(index >= cpu_edp_limits_size);
+		limit = cpu_edp_limits[index].freq_limits[cpus - 1];
 	}
 	if (system_edp_limits && system_edp_alarm)
 		limit = min(limit, system_edp_limits[cpus - 1]);
@@ -187,12 +193,15 @@ static unsigned int edp_predict_limit(unsigned int cpus)
 	return limit;
 }
 
-static void edp_update_limit(void)
+static unsigned int edp_predict_limit(unsigned int cpus)
 {
-	unsigned int limit = edp_predict_limit(cpumask_weight(&edp_cpumask));
+	return __edp_predict_limit(edp_thermal_index, cpus);
+}
 
+static unsigned int edp_round_limit(unsigned int limit)
+{
 #ifdef CONFIG_TEGRA_EDP_EXACT_FREQ
-	edp_limit = limit;
+	return limit;
 #else
 	unsigned int i;
 	for (i = 0; freq_table[i].frequency != CPUFREQ_TABLE_END; i++) {
@@ -201,17 +210,92 @@ static void edp_update_limit(void)
 		}
 	}
 	BUG_ON(i == 0);	/* min freq above the limit or table empty */
-	edp_limit = freq_table[i-1].frequency;
+	return freq_table[i-1].frequency;
 #endif
 }
 
+static void edp_update_limit(void)
+{
+	unsigned int limit = edp_predict_limit(cpumask_weight(&edp_cpumask));
+
+	edp_limit = edp_round_limit(limit);
+}
+
 static unsigned int edp_governor_speed(unsigned int requested_speed)
 {
-	if ((!edp_limit) || (requested_speed <= edp_limit))
+	unsigned int limit = edp_limit;
+
+	if (edp_predicted_limit && (!limit || edp_predicted_limit < limit))
+		limit = edp_predicted_limit;
+
+	if ((!limit) || (requested_speed <= limit))
 		return requested_speed;
 	else
-		return edp_limit;
+		return limit;
+}
+
+int tegra_edp_register_predict_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_register(&edp_predict_notifier_list, nb);
+}
+EXPORT_SYMBOL_GPL(tegra_edp_register_predict_notifier);
+
+int tegra_edp_unregister_predict_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(&edp_predict_notifier_list,
+						  nb);
 }
+EXPORT_SYMBOL_GPL(tegra_edp_unregister_predict_notifier);
+
+/*
+ * Lower the EDP ceiling gradually as the predicted temperature crosses
+ * the next EDP trip: the soft limit slides from the current zone limit
+ * towards the next zone limit as the distance to the trip shrinks
+ * relative to the predicted rise, so the hard step at the trip point
+ * becomes a ramp. Temperatures in millidegrees C.
+ */
+int tegra_edp_predict_thermal_zone(long temp, long predicted)
+{
+	unsigned int cur, next, limit = 0;
+	unsigned int cpus;
+	long trip;
+	int index;
+	bool changed;
+
+	if (!cpu_edp_limits)
+		return -EINVAL;
+
+	mutex_lock(&tegra_cpu_lock);
+	index = edp_thermal_index;
+	cpus = cpumask_weight(&edp_cpumask);
+
+	if (cpus && (predicted > temp) &&
+	    (index + 1 < cpu_edp_limits_size)) {
+		trip = cpu_edp_limits[index].temperature * 1000L;
+		if (predicted >= trip && temp < trip) {
+			cur = __edp_predict_limit(index, cpus);
+			next = __edp_predict_limit(index + 1, cpus);
+			if (next < cur)
+				limit = cur - (cur - next) *
+					(100 - 100 * (trip - temp) /
+					 (predicted - temp)) / 100;
+		}
+	}
+	if (limit)
+		limit = edp_round_limit(limit);
+
+	changed = limit != edp_predicted_limit;
+	edp_predicted_limit = limit;
+	if (changed && target_cpu_speed[0])
+		tegra_cpu_set_speed_cap(NULL);
+	mutex_unlock(&tegra_cpu_lock);
+
+	if (changed)
+		blocking_notifier_call_chain(&edp_predict_notifier_list,
+			limit ? limit : edp_limit, NULL);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(tegra_edp_predict_thermal_zone);
 
 int tegra_edp_update_thermal_zone(int temperature)
 {
@@ -484,6 +568,11 @@ int tegra_update_cpu_speed(unsigned long rate)
 	if (freqs.old == freqs.new)
 		return ret;
 
+	frame_trace_cpufreq(freqs.old, freqs.new);
+
+	/* cpu, emc and mselect rates move together: one voltage drop */
+	tegra_dvfs_batch_begin();
+
 	/*
 	 * Vote on memory bus frequency based on cpu frequency
 	 * This sets the minimum frequency, display or avp may request higher
@@ -493,13 +582,13 @@ int tegra_update_cpu_speed(unsigned long rate)
 		if (ret) {
 			pr_err("cpu-tegra: Failed to scale mselect for cpu"
 			       " frequency %u kHz\n", freqs.new);
-			return ret;
+			goto out;
 		}
 		ret = clk_set_rate(emc_clk, tegra_emc_to_cpu_ratio(freqs.new));
 		if (ret) {
 			pr_err("cpu-tegra: Failed to scale emc for cpu"
 			       " frequency %u kHz\n", freqs.new);
-			return ret;
+			goto out;
 		}
 	}
 
@@ -514,7 +603,7 @@ int tegra_update_cpu_speed(unsigned long rate)
 	if (ret) {
 		pr_err("cpu-tegra: Failed to set cpu frequency to %d kHz\n",
 			freqs.new);
-		return ret;
+		goto out;
 	}
 
 	for_each_online_cpu(freqs.cpu)
@@ -525,7 +614,9 @@ int tegra_update_cpu_speed(unsigned long rate)
 		tegra_update_mselect_rate(freqs.new);
 	}
 
-	return 0;
+out:
+	tegra_dvfs_batch_commit();
+	return ret;
 }
 
 unsigned int tegra_count_slow_cpus(unsigned long speed_limit)
@@ -575,6 +666,50 @@ unsigned long tegra_cpu_highest_speed(void) {
 	return rate;
 }
 
+/*
+ * Thermal pressure: the share of the top table rate, in percent, that
+ * the thermal caps (throttling and the EDP ceiling, including its
+ * predicted part) currently take away. All cores share one sensor, one
+ * clock and one rail, so the value is the same for every core.
+ */
+unsigned int tegra_cpu_thermal_pressure(void)
+{
+	unsigned int top, ceiling;
+	int i;
+
+	if (!freq_table)
+		return 0;
+
+	for (i = 0; freq_table[i + 1].frequency != CPUFREQ_TABLE_END; i++)
+		;
+	top = freq_table[i].frequency;
+
+	ceiling = tegra_throttle_governor_speed(top);
+	ceiling = edp_governor_speed(ceiling);
+	if (!top || ceiling >= top)
+		return 0;
+	return 100 - ceiling * 100 / top;
+}
+
+/*
+ * With thermal_sched_power set, the scheduler's cpu_power follows the
+ * thermal pressure, floored at half, so capacity estimates account for
+ * the capped rate.
+ */
+static bool thermal_sched_power;
+module_param(thermal_sched_power, bool, 0644);
+
+unsigned long arch_scale_freq_power(struct sched_domain *sd, int cpu)
+{
+	unsigned int pressure;
+
+	if (!thermal_sched_power)
+		return SCHED_POWER_SCALE;
+
+	pressure = min(tegra_cpu_thermal_pressure(), 50U);
+	return SCHED_POWER_SCALE * (100 - pressure) / 100;
+}
+
 int tegra_cpu_set_speed_cap(unsigned int *speed_cap)
 {
 	int ret = 0;
@@ -746,6 +881,46 @@ static struct cpufreq_driver tegra_cpufreq_driver = {
 	.attr		= tegra_cpufreq_attr,
 };
 
+/*
+ * cpu-boost calls arch_cpu_boost_prepare() from input event context just
+ * before it raises the cpu floor.  The vdd_cpu ramp for that frequency is
+ * started at once from a high priority work, so that it overlaps with the
+ * policy update and the governor instead of following them.
+ */
+static unsigned int boost_prepare_ms = 100;
+module_param(boost_prepare_ms, uint, 0644);
+
+static struct workqueue_struct *boost_prepare_wq;
+static unsigned long boost_prepare_khz;
+
+static void tegra_cpu_boost_prepare_work(struct work_struct *work)
+{
+	unsigned long khz = xchg(&boost_prepare_khz, 0);
+	struct clk *cpu_g = tegra_get_clock_by_name("cpu_g");
+	int i;
+
+	if (!khz || !cpu_g || !freq_table)
+		return;
+
+	for (i = 0; freq_table[i + 1].frequency != CPUFREQ_TABLE_END; i++)
+		;
+	khz = min_t(unsigned long, khz, freq_table[i].frequency);
+	if (khz <= tegra_getspeed(0))
+		return;
+
+	tegra_dvfs_rail_prepare(cpu_g, khz * 1000, boost_prepare_ms);
+}
+static DECLARE_WORK(boost_prepare_work, tegra_cpu_boost_prepare_work);
+
+void arch_cpu_boost_prepare(unsigned int khz)
+{
+	if (!boost_prepare_ms || !boost_prepare_wq)
+		return;
+
+	boost_prepare_khz = khz;
+	queue_work(boost_prepare_wq, &boost_prepare_work);
+}
+
 static int __init tegra_cpufreq_init(void)
 {
 	int ret = 0;
@@ -768,6 +943,8 @@ static int __init tegra_cpufreq_init(void)
 	freq_table = table_data->freq_table;
 	tegra_cpu_edp_init(false);
 
+	boost_prepare_wq = alloc_workqueue("tegra_cpu_prepare", WQ_HIGHPRI, 1);
+
 	ret = cpufreq_register_notifier(
 		&tegra_cpufreq_policy_nb, CPUFREQ_POLICY_NOTIFIER);
 	if (ret)
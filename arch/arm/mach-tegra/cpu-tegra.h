@@ -21,6 +21,9 @@
 #ifndef __MACH_TEGRA_CPU_TEGRA_H
 #define __MACH_TEGRA_CPU_TEGRA_H
 
+#include <linux/cpu.h>
+#include <linux/list.h>
+
 unsigned int tegra_getspeed(unsigned int cpu);
 int tegra_update_cpu_speed(unsigned long rate);
 int tegra_cpu_set_speed_cap(unsigned int *speed_cap);
@@ -28,6 +31,7 @@ unsigned int tegra_count_slow_cpus(unsigned long speed_limit);
 unsigned int tegra_get_slowest_cpu_n(void);
 unsigned long tegra_cpu_lowest_speed(void);
 unsigned long tegra_cpu_highest_speed(void);
+unsigned int tegra_cpu_thermal_pressure(void);
 
 #ifdef CONFIG_TEGRA_THERMAL_THROTTLE
 int tegra_throttle_init(struct mutex *cpu_lock);
@@ -53,10 +57,29 @@ static inline void tegra_throttling_enable(bool enable)
 {}
 #endif /* CONFIG_TEGRA_THERMAL_THROTTLE */
 
+/*
+ * Hotplug policy. Only one registered policy owns CPU hotplug and
+ * cluster switching at a time; the others are stopped. Policies must
+ * go through tegra_hp_cpu_up()/tegra_hp_cpu_down() and
+ * tegra_hp_cluster_switch() so that the hotplug statistics stay in
+ * sync and a switch to the LP cluster never races a pending online.
+ */
+struct tegra_hp_policy {
+	const char *name;
+	struct list_head node;
+	void (*start)(void);
+	void (*stop)(void);
+};
+
 #if defined(CONFIG_TEGRA_AUTO_HOTPLUG) && !defined(CONFIG_ARCH_TEGRA_2x_SOC)
 int tegra_auto_hotplug_init(struct mutex *cpu_lock);
 void tegra_auto_hotplug_exit(void);
 void tegra_auto_hotplug_governor(unsigned int cpu_freq, bool suspend);
+int tegra_hp_register_policy(struct tegra_hp_policy *policy);
+void tegra_hp_unregister_policy(struct tegra_hp_policy *policy);
+int tegra_hp_cpu_up(unsigned int cpu);
+int tegra_hp_cpu_down(unsigned int cpu);
+int tegra_hp_cluster_switch(bool to_lp);
 #else
 static inline int tegra_auto_hotplug_init(struct mutex *cpu_lock)
 { return 0; }
@@ -65,6 +88,18 @@ static inline void tegra_auto_hotplug_exit(void)
 static inline void tegra_auto_hotplug_governor(unsigned int cpu_freq,
 					       bool suspend)
 { }
+static inline int tegra_hp_register_policy(struct tegra_hp_policy *policy)
+{ return 0; }
+static inline void tegra_hp_unregister_policy(struct tegra_hp_policy *policy)
+{ }
+#ifdef CONFIG_HOTPLUG_CPU
+static inline int tegra_hp_cpu_up(unsigned int cpu)
+{ return cpu_up(cpu); }
+static inline int tegra_hp_cpu_down(unsigned int cpu)
+{ return cpu_down(cpu); }
+#endif
+static inline int tegra_hp_cluster_switch(bool to_lp)
+{ return -ENOSYS; }
 #endif
 
 #ifdef CONFIG_TEGRA_EDP_LIMITS
@@ -33,10 +33,14 @@
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
 #include <linux/pm_qos_params.h>
+#include <linux/list.h>
+#include <linux/string.h>
+#include <linux/frame_trace.h>
 
 #include "pm.h"
 #include "cpu-tegra.h"
 #include "clock.h"
+#include "tegra3_energy.h"
 
 #define INITIAL_STATE		TEGRA_HP_DISABLED
 #define UP2G0_DELAY_MS		70
@@ -121,6 +125,7 @@ static void hp_stats_update(unsigned int cpu, bool up)
 		}
 	}
 	hp_stats[cpu].last_update = cur_jiffies;
+	tegra_energy_hp_update(cpu, up);
 }
 
 
@@ -132,14 +137,154 @@ enum {
 };
 static int hp_state;
 
+/* Number of cpu_up() calls issued but not yet completed */
+static unsigned int hp_pending_up;
+
+static DEFINE_MUTEX(hp_policy_lock);
+static LIST_HEAD(hp_policies);
+static struct tegra_hp_policy *hp_active_policy;
+static struct tegra_hp_policy tegra_hp_policy;
+
+static struct tegra_hp_policy *hp_find_policy(const char *name)
+{
+	struct tegra_hp_policy *policy;
+
+	list_for_each_entry(policy, &hp_policies, node)
+		if (sysfs_streq(policy->name, name))
+			return policy;
+	return NULL;
+}
+
+static void hp_set_active_policy(struct tegra_hp_policy *policy)
+{
+	if (hp_active_policy == policy)
+		return;
+
+	if (hp_active_policy && hp_active_policy->stop)
+		hp_active_policy->stop();
+	hp_active_policy = policy;
+	if (policy && policy->start)
+		policy->start();
+
+	pr_info("Tegra hotplug policy: %s\n", policy ? policy->name : "none");
+}
+
+static int __tegra_hp_add_policy(struct tegra_hp_policy *policy, bool activate)
+{
+	int ret = 0;
+
+	mutex_lock(&hp_policy_lock);
+	if (hp_find_policy(policy->name)) {
+		ret = -EEXIST;
+		goto out;
+	}
+	list_add_tail(&policy->node, &hp_policies);
+
+	/*
+	 * The policy being registered is already running if activated.
+	 * Checked under the lock, as "policy" may be switching right now.
+	 */
+	if (activate && !hp_active_policy)
+		hp_active_policy = policy;
+	else
+		ret = -EBUSY;
+out:
+	mutex_unlock(&hp_policy_lock);
+	return ret;
+}
+
+/*
+ * Returns 0 if the new policy owns hotplug from now on, or -EBUSY if
+ * another policy is already active. In the latter case the policy stays
+ * registered (but must stay idle) until it is selected through the
+ * "policy" parameter.
+ */
+int tegra_hp_register_policy(struct tegra_hp_policy *policy)
+{
+	return __tegra_hp_add_policy(policy, true);
+}
+
+void tegra_hp_unregister_policy(struct tegra_hp_policy *policy)
+{
+	mutex_lock(&hp_policy_lock);
+	if (hp_active_policy == policy)
+		hp_set_active_policy(NULL);
+	list_del(&policy->node);
+	mutex_unlock(&hp_policy_lock);
+}
+
+static int hp_policy_set(const char *arg, const struct kernel_param *kp)
+{
+	struct tegra_hp_policy *policy;
+	int ret = 0;
+
+	mutex_lock(&hp_policy_lock);
+	policy = hp_find_policy(arg);
+	if (policy)
+		hp_set_active_policy(policy);
+	else
+		ret = -EINVAL;
+	mutex_unlock(&hp_policy_lock);
+	return ret;
+}
+
+static int hp_policy_get(char *buffer, const struct kernel_param *kp)
+{
+	int ret;
+
+	mutex_lock(&hp_policy_lock);
+	ret = sprintf(buffer, "%s",
+		      hp_active_policy ? hp_active_policy->name : "none");
+	mutex_unlock(&hp_policy_lock);
+	return ret;
+}
+
+static struct kernel_param_ops tegra_hp_policy_ops = {
+	.set = hp_policy_set,
+	.get = hp_policy_get,
+};
+module_param_cb(policy, &tegra_hp_policy_ops, NULL, 0644);
+
+static int hp_available_policies_get(char *buffer,
+				     const struct kernel_param *kp)
+{
+	struct tegra_hp_policy *policy;
+	int len = 0;
+
+	mutex_lock(&hp_policy_lock);
+	list_for_each_entry(policy, &hp_policies, node)
+		len += sprintf(buffer + len, "%s ", policy->name);
+	mutex_unlock(&hp_policy_lock);
+	if (len)
+		buffer[--len] = '\0';
+	return len;
+}
+
+static struct kernel_param_ops tegra_hp_available_policies_ops = {
+	.get = hp_available_policies_get,
+};
+module_param_cb(available_policies, &tegra_hp_available_policies_ops,
+		NULL, 0444);
+
 static int hp_state_set(const char *arg, const struct kernel_param *kp)
 {
 	int ret = 0;
 	int old_state;
+	bool active;
 
 	if (!tegra3_cpu_lock)
 		return ret;
 
+	mutex_lock(&hp_policy_lock);
+	active = hp_active_policy == &tegra_hp_policy;
+	mutex_unlock(&hp_policy_lock);
+
+	/* Another hotplug policy owns the cores, don't fight it */
+	if (!active) {
+		pr_warn("%s: tegra hotplug policy is not active\n", __func__);
+		return -EBUSY;
+	}
+
 	mutex_lock(tegra3_cpu_lock);
 
 	old_state = hp_state;
@@ -209,6 +354,110 @@ static noinline int tegra_cpu_speed_balance(void)
 
 	return TEGRA_CPU_SPEED_BALANCED;
 }
+/*
+ * Switch between the G and LP clusters. Must be called with
+ * tegra3_cpu_lock held. Entering LP is refused while secondary cores
+ * are online or an online is still in flight.
+ */
+static int __tegra_hp_cluster_switch(bool to_lp)
+{
+	if (to_lp == is_lp_cluster())
+		return 0;
+
+	if (to_lp) {
+		if (no_lp || hp_pending_up || (num_online_cpus() > 1) ||
+		    pm_qos_request(PM_QOS_MIN_ONLINE_CPUS) ||
+		    (tegra_getspeed(0) > idle_top_freq))
+			return -EBUSY;
+		if (clk_set_parent(cpu_clk, cpu_lp_clk))
+			return -EBUSY;
+		hp_stats_update(CONFIG_NR_CPUS, true);
+		hp_stats_update(0, false);
+	} else {
+		/* make sure cpu rate is within g-mode range before switching */
+		unsigned int speed = max(
+			tegra_getspeed(0), clk_get_min_rate(cpu_g_clk) / 1000);
+		tegra_update_cpu_speed(speed);
+
+		if (clk_set_parent(cpu_clk, cpu_g_clk))
+			return -EBUSY;
+		hp_stats_update(CONFIG_NR_CPUS, false);
+		hp_stats_update(0, true);
+	}
+
+	/* catch-up with governor target speed */
+	tegra_cpu_set_speed_cap(NULL);
+	return 0;
+}
+
+int tegra_hp_cluster_switch(bool to_lp)
+{
+	int ret;
+
+	if (!tegra3_cpu_lock)
+		return -ENODEV;
+
+	mutex_lock(tegra3_cpu_lock);
+	ret = __tegra_hp_cluster_switch(to_lp);
+	mutex_unlock(tegra3_cpu_lock);
+	return ret;
+}
+
+/* Bring a G core online, leaving the LP cluster first if needed */
+int tegra_hp_cpu_up(unsigned int cpu)
+{
+	int ret = 0;
+
+	if (!tegra3_cpu_lock)
+		return cpu_up(cpu);
+
+	mutex_lock(tegra3_cpu_lock);
+	if (cpu_online(cpu))
+		goto out;
+	if (is_lp_cluster()) {
+		ret = __tegra_hp_cluster_switch(false);
+		if (ret)
+			goto out;
+	}
+	hp_pending_up++;
+	hp_stats_update(cpu, true);
+	mutex_unlock(tegra3_cpu_lock);
+
+	ret = cpu_up(cpu);
+
+	mutex_lock(tegra3_cpu_lock);
+	hp_pending_up--;
+	if (ret)
+		hp_stats_update(cpu, false);
+out:
+	mutex_unlock(tegra3_cpu_lock);
+	return ret;
+}
+
+int tegra_hp_cpu_down(unsigned int cpu)
+{
+	int ret;
+
+	if (!tegra3_cpu_lock)
+		return cpu_down(cpu);
+
+	mutex_lock(tegra3_cpu_lock);
+	if (!cpu_online(cpu)) {
+		mutex_unlock(tegra3_cpu_lock);
+		return 0;
+	}
+	hp_stats_update(cpu, false);
+	mutex_unlock(tegra3_cpu_lock);
+
+	ret = cpu_down(cpu);
+	if (ret) {
+		mutex_lock(tegra3_cpu_lock);
+		hp_stats_update(cpu, true);
+		mutex_unlock(tegra3_cpu_lock);
+	}
+	return ret;
+}
+
 void disable_auto_hotplug(void)
 {
 	hp_state=TEGRA_HP_DISABLED;
@@ -231,27 +480,16 @@ static void tegra_auto_hotplug_work_func(struct work_struct *work)
 		cpu = tegra_get_slowest_cpu_n();
 		if (cpu < nr_cpu_ids) {
 			up = false;
-		} else if (!is_lp_cluster() && !no_lp &&
-			   !pm_qos_request(PM_QOS_MIN_ONLINE_CPUS)) {
-			if(!clk_set_parent(cpu_clk, cpu_lp_clk)) {
-				hp_stats_update(CONFIG_NR_CPUS, true);
-				hp_stats_update(0, false);
-				/* catch-up with governor target speed */
-				tegra_cpu_set_speed_cap(NULL);
-				break;
-			}
+		} else if (!is_lp_cluster() &&
+			   !__tegra_hp_cluster_switch(true)) {
+			break;
 		}
 		queue_delayed_work(
 			hotplug_wq, &hotplug_work, down_delay);
 		break;
 	case TEGRA_HP_UP:
 		if (is_lp_cluster() && !no_lp) {
-			if(!clk_set_parent(cpu_clk, cpu_g_clk)) {
-				hp_stats_update(CONFIG_NR_CPUS, false);
-				hp_stats_update(0, true);
-				/* catch-up with governor target speed */
-				tegra_cpu_set_speed_cap(NULL);
-			}
+			__tegra_hp_cluster_switch(false);
 		} else {
 			switch (tegra_cpu_speed_balance()) {
 			/* cpu speed is up and balanced - one more on-line */
@@ -283,40 +521,56 @@ static void tegra_auto_hotplug_work_func(struct work_struct *work)
 	if (!up && ((now - last_change_time) < down_delay))
 			cpu = nr_cpu_ids;
 
-	if (cpu < nr_cpu_ids) {
+	if (cpu < nr_cpu_ids)
 		last_change_time = now;
-		hp_stats_update(cpu, up);
-	}
 	mutex_unlock(tegra3_cpu_lock);
 
 	if (cpu < nr_cpu_ids) {
+		frame_trace_hotplug(cpu, up);
 		if (up){
 			printk("cpu_up(%u)+\n",cpu);
-			cpu_up(cpu);
+			tegra_hp_cpu_up(cpu);
 			printk("cpu_up(%u)-\n",cpu);
 		}else{
 			printk("cpu_down(%u)+\n",cpu);
-			cpu_down(cpu);
+			tegra_hp_cpu_down(cpu);
 			printk("cpu_down(%u)-\n",cpu);
 		}
 	}
 }
 
-static int min_cpus_notify(struct notifier_block *nb, unsigned long n, void *p)
+static void tegra_hp_policy_start(void)
 {
 	mutex_lock(tegra3_cpu_lock);
+	if (hp_state == TEGRA_HP_DISABLED) {
+		hp_state = TEGRA_HP_IDLE;
+		hp_init_stats();
+	}
+	/* catch-up with governor target speed */
+	tegra_cpu_set_speed_cap(NULL);
+	mutex_unlock(tegra3_cpu_lock);
+}
 
-	if ((n >= 1) && is_lp_cluster()) {
-		/* make sure cpu rate is within g-mode range before switching */
-		unsigned int speed = max(
-			tegra_getspeed(0), clk_get_min_rate(cpu_g_clk) / 1000);
-		tegra_update_cpu_speed(speed);
+static void tegra_hp_policy_stop(void)
+{
+	mutex_lock(tegra3_cpu_lock);
+	hp_state = TEGRA_HP_DISABLED;
+	mutex_unlock(tegra3_cpu_lock);
+	cancel_delayed_work_sync(&hotplug_work);
+}
 
-		if (!clk_set_parent(cpu_clk, cpu_g_clk)) {
-			hp_stats_update(CONFIG_NR_CPUS, false);
-			hp_stats_update(0, true);
-		}
-	}
+static struct tegra_hp_policy tegra_hp_policy = {
+	.name	= "tegra",
+	.start	= tegra_hp_policy_start,
+	.stop	= tegra_hp_policy_stop,
+};
+
+static int min_cpus_notify(struct notifier_block *nb, unsigned long n, void *p)
+{
+	mutex_lock(tegra3_cpu_lock);
+
+	if ((n >= 1) && is_lp_cluster())
+		__tegra_hp_cluster_switch(false);
 	/* update governor state machine */
 	tegra_cpu_set_speed_cap(NULL);
 	mutex_unlock(tegra3_cpu_lock);
@@ -434,6 +688,7 @@ int tegra_auto_hotplug_init(struct mutex *cpu_lock)
 	tegra3_cpu_lock = cpu_lock;
 	hp_state = INITIAL_STATE;
 	hp_init_stats();
+	__tegra_hp_add_policy(&tegra_hp_policy, hp_state != TEGRA_HP_DISABLED);
 	pr_info("Tegra auto-hotplug initialized: %s\n",
 		(hp_state == TEGRA_HP_DISABLED) ? "disabled" : "enabled");
 
@@ -457,7 +712,7 @@ static int hp_stats_show(struct seq_file *s, void *data)
 	u64 cur_jiffies = get_jiffies_64();
 
 	mutex_lock(tegra3_cpu_lock);
-	if (hp_state != TEGRA_HP_DISABLED) {
+	if (hp_active_policy) {
 		for (i = 0; i <= CONFIG_NR_CPUS; i++) {
 			bool was_up = (hp_stats[i].up_down_count & 0x1);
 			hp_stats_update(i, was_up);
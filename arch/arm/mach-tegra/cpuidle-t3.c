@@ -76,6 +76,15 @@ module_param(lp2_0_in_idle, bool, 0644);
 static bool lp2_n_in_idle = true;
 module_param(lp2_n_in_idle, bool, 0644);
 
+/*
+ * When set, LP2 is only entered if the recent wake-interval history also
+ * predicts that the CPU will stay idle for at least the LP2 target
+ * residency. The predictor is always evaluated so its hit rate can be
+ * compared against the timer-only policy in debugfs.
+ */
+static bool lp2_predictor;
+module_param(lp2_predictor, bool, 0644);
+
 static struct clk *cpu_clk_for_dvfs;
 static struct clk *twd_clk;
 
@@ -92,8 +101,38 @@ static struct {
 	unsigned int lp2_completed_count_bin[32];
 	unsigned int lp2_int_count[NR_IRQS];
 	unsigned int last_lp2_int_count[NR_IRQS];
+	unsigned int timer_hit[5];
+	unsigned int timer_early[5];
+	unsigned int timer_late[5];
+	unsigned int predict_hit[5];
+	unsigned int predict_early[5];
+	unsigned int predict_late[5];
 } idle_stats;
 
+#define LP2_PREDICT_DEPTH	8
+#define LP2_PREDICT_MAX_US	USEC_PER_SEC
+
+enum {
+	LP2_CHOICE_NONE,
+	LP2_CHOICE_LP3,
+	LP2_CHOICE_LP2,
+};
+
+/* Wake-interval history, indexed by cpu_number() */
+static struct {
+	unsigned int interval[LP2_PREDICT_DEPTH];
+	unsigned int next;
+	unsigned int count;
+} lp2_history[5];
+
+/* Decision pending evaluation on wake, indexed by cpu */
+static struct {
+	unsigned int idx;
+	unsigned int residency;
+	u8 timer;
+	u8 predict;
+} lp2_pending[4];
+
 static inline unsigned int time_to_bin(unsigned int time)
 {
 	return fls(time);
@@ -120,6 +159,108 @@ void tegra3_cpu_idle_stats_lp2_time(unsigned int cpu, s64 us)
 	idle_stats.cpu_wants_lp2_time[cpu_number(cpu)] += us;
 }
 
+/* Total time spent power gated in LP2 by a G core, or by the LP core */
+u64 tegra3_cpu_idle_lp2_time(unsigned int cpu, bool lp)
+{
+	return idle_stats.in_lp2_time[lp ? 4 : cpu];
+}
+
+/*
+ * Predict the next idle interval from the wake history, in the same way
+ * as the menu governor: take the average of the recent intervals and
+ * trust it only if the spread is small, discarding the largest sample
+ * (at most twice) as an outlier. Returns UINT_MAX if there is no usable
+ * prediction, leaving the decision to the next timer event.
+ */
+static unsigned int lp2_predict_interval(unsigned int idx)
+{
+	unsigned int thresh = UINT_MAX;
+	unsigned int max, v;
+	u64 avg, variance;
+	s64 diff;
+	int i, n, pass;
+
+	if (lp2_history[idx].count < LP2_PREDICT_DEPTH)
+		return UINT_MAX;
+
+	for (pass = 0; pass < 3; pass++) {
+		avg = 0;
+		max = 0;
+		n = 0;
+		for (i = 0; i < LP2_PREDICT_DEPTH; i++) {
+			v = lp2_history[idx].interval[i];
+			if (v > thresh)
+				continue;
+			avg += v;
+			n++;
+			if (v > max)
+				max = v;
+		}
+		if (!n)
+			break;
+		avg = div_u64(avg, n);
+
+		variance = 0;
+		for (i = 0; i < LP2_PREDICT_DEPTH; i++) {
+			v = lp2_history[idx].interval[i];
+			if (v > thresh)
+				continue;
+			diff = (s64)v - (s64)avg;
+			variance += diff * diff;
+		}
+		variance = div_u64(variance, n);
+
+		/* stddev within 1/6 of the average, or below 20us */
+		if (avg * avg > 36 * variance || variance <= 400)
+			return avg;
+
+		thresh = max - 1;
+	}
+
+	return UINT_MAX;
+}
+
+static void lp2_predict_account(unsigned int *hit, unsigned int *early,
+	unsigned int *late, u8 choice, bool long_enough)
+{
+	if (choice == LP2_CHOICE_LP2) {
+		if (long_enough)
+			(*hit)++;
+		else
+			(*early)++;
+	} else {
+		if (long_enough)
+			(*late)++;
+		else
+			(*hit)++;
+	}
+}
+
+void tegra3_cpu_idle_stats_wake(unsigned int cpu, s64 us)
+{
+	unsigned int idx = cpu_number(cpu);
+	unsigned int v = clamp_t(s64, us, 0, LP2_PREDICT_MAX_US);
+	bool long_enough;
+
+	lp2_history[idx].interval[lp2_history[idx].next] = v;
+	lp2_history[idx].next = (lp2_history[idx].next + 1) % LP2_PREDICT_DEPTH;
+	if (lp2_history[idx].count < LP2_PREDICT_DEPTH)
+		lp2_history[idx].count++;
+
+	if (lp2_pending[cpu].timer == LP2_CHOICE_NONE)
+		return;
+
+	idx = lp2_pending[cpu].idx;
+	long_enough = us >= lp2_pending[cpu].residency;
+	lp2_predict_account(&idle_stats.timer_hit[idx],
+		&idle_stats.timer_early[idx], &idle_stats.timer_late[idx],
+		lp2_pending[cpu].timer, long_enough);
+	lp2_predict_account(&idle_stats.predict_hit[idx],
+		&idle_stats.predict_early[idx], &idle_stats.predict_late[idx],
+		lp2_pending[cpu].predict, long_enough);
+	lp2_pending[cpu].timer = LP2_CHOICE_NONE;
+}
+
 /* Allow rail off only if all secondary CPUs are power gated, and no
    rail update is in progress */
 static bool tegra3_rail_off_is_allowed(void)
@@ -140,6 +281,8 @@ bool tegra3_lp2_is_allowed(struct cpuidle_device *dev,
 	struct cpuidle_state *state)
 {
 	s64 request;
+	unsigned int idx = cpu_number(dev->cpu);
+	bool timer_lp2, predict_lp2;
 
 	if (!tegra_all_cpus_booted)
 		return false;
@@ -170,11 +313,29 @@ bool tegra3_lp2_is_allowed(struct cpuidle_device *dev,
 		state->exit_latency = lp2_exit_latencies[cpu_number(dev->cpu)];
 		tegra_lp2_update_target_residency(state);
 	}
-	if (request < state->target_residency) {
+
+	timer_lp2 = request >= state->target_residency;
+	predict_lp2 = timer_lp2 &&
+		lp2_predict_interval(idx) >= state->target_residency;
+
+	lp2_pending[dev->cpu].idx = idx;
+	lp2_pending[dev->cpu].residency = state->target_residency;
+	lp2_pending[dev->cpu].timer =
+		timer_lp2 ? LP2_CHOICE_LP2 : LP2_CHOICE_LP3;
+	lp2_pending[dev->cpu].predict =
+		predict_lp2 ? LP2_CHOICE_LP2 : LP2_CHOICE_LP3;
+
+	if (!timer_lp2) {
 		/* Not enough time left to enter LP2 */
 		return false;
 	}
 
+	/* Parked cpus have nothing to wake for: always go deep */
+	if (lp2_predictor && !predict_lp2 && !cpu_parked(dev->cpu)) {
+		/* Recent wakeups suggest we will not stay idle long enough */
+		return false;
+	}
+
 	return true;
 }
 
@@ -500,6 +661,33 @@ int tegra3_lp2_debug_show(struct seq_file *s, void *data)
 			idle_stats.cpu_wants_lp2_time[4]) : 0));
 	seq_printf(s, "\n");
 
+	seq_printf(s, "lp2 predictor:  %s\n", lp2_predictor ? "on" : "off");
+	seq_printf(s, "timer hit:                      %8u %8u %8u %8u %8u\n",
+		idle_stats.timer_hit[0], idle_stats.timer_hit[1],
+		idle_stats.timer_hit[2], idle_stats.timer_hit[3],
+		idle_stats.timer_hit[4]);
+	seq_printf(s, "timer early wake:               %8u %8u %8u %8u %8u\n",
+		idle_stats.timer_early[0], idle_stats.timer_early[1],
+		idle_stats.timer_early[2], idle_stats.timer_early[3],
+		idle_stats.timer_early[4]);
+	seq_printf(s, "timer missed lp2:               %8u %8u %8u %8u %8u\n",
+		idle_stats.timer_late[0], idle_stats.timer_late[1],
+		idle_stats.timer_late[2], idle_stats.timer_late[3],
+		idle_stats.timer_late[4]);
+	seq_printf(s, "predict hit:                    %8u %8u %8u %8u %8u\n",
+		idle_stats.predict_hit[0], idle_stats.predict_hit[1],
+		idle_stats.predict_hit[2], idle_stats.predict_hit[3],
+		idle_stats.predict_hit[4]);
+	seq_printf(s, "predict early wake:             %8u %8u %8u %8u %8u\n",
+		idle_stats.predict_early[0], idle_stats.predict_early[1],
+		idle_stats.predict_early[2], idle_stats.predict_early[3],
+		idle_stats.predict_early[4]);
+	seq_printf(s, "predict missed lp2:             %8u %8u %8u %8u %8u\n",
+		idle_stats.predict_late[0], idle_stats.predict_late[1],
+		idle_stats.predict_late[2], idle_stats.predict_late[3],
+		idle_stats.predict_late[4]);
+	seq_printf(s, "\n");
+
 	seq_printf(s, "%19s %8s %8s %8s\n", "", "lp2", "comp", "%");
 	seq_printf(s, "-------------------------------------------------\n");
 	for (bin = 0; bin < 32; bin++) {
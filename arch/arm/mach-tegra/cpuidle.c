@@ -114,7 +114,9 @@ static int tegra_idle_enter_lp2(struct cpuidle_device *dev,
 	if (!lp2_in_idle || lp2_disabled_by_suspend ||
 	    !tegra_lp2_is_allowed(dev, state)) {
 		dev->last_state = &dev->states[0];
-		return tegra_idle_enter_lp3(dev, state);
+		us = tegra_idle_enter_lp3(dev, state);
+		tegra_cpu_idle_stats_wake(dev->cpu, us);
+		return (int)us;
 	}
 
 	local_irq_disable();
@@ -136,6 +138,7 @@ static int tegra_idle_enter_lp2(struct cpuidle_device *dev,
 		tegra_lp2_update_target_residency(state);
 	}
 	tegra_cpu_idle_stats_lp2_time(dev->cpu, us);
+	tegra_cpu_idle_stats_wake(dev->cpu, us);
 
 	return (int)us;
 }
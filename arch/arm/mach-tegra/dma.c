@@ -29,6 +29,8 @@
 #include <linux/delay.h>
 #include <linux/clk.h>
 #include <linux/syscore_ops.h>
+#include <linux/sched.h>
+#include <linux/math64.h>
 #include <mach/dma.h>
 #include <mach/irqs.h>
 #include <mach/iomap.h>
@@ -139,6 +141,15 @@ struct tegra_dma_channel {
 	dma_callback		callback;
 	struct tegra_dma_req	*cb_req;
 	dma_isr_handler		isr_handler;
+	bool			parked;		/* freed, kept for its client */
+
+	/* utilization, shown in debugfs tegra_dma */
+	unsigned long		reqs;
+	unsigned long		irqs;
+	u64			bytes;
+	u64			busy_ns;
+	u64			busy_since;	/* 0 while idle */
+	unsigned long		reuses;
 };
 
 #define  NV_DMA_MAX_CHANNELS  32
@@ -150,6 +161,8 @@ static DEFINE_SPINLOCK(enable_lock);
 static DECLARE_BITMAP(channel_usage, NV_DMA_MAX_CHANNELS);
 static struct tegra_dma_channel dma_channels[NV_DMA_MAX_CHANNELS];
 
+static int tegra_dma_prepare_req(struct tegra_dma_channel *ch,
+	struct tegra_dma_req *req);
 static void tegra_dma_update_hw(struct tegra_dma_channel *ch,
 	struct tegra_dma_req *req);
 static bool tegra_dma_update_hw_partial(struct tegra_dma_channel *ch,
@@ -164,6 +177,20 @@ void tegra_dma_flush(struct tegra_dma_channel *ch)
 }
 EXPORT_SYMBOL(tegra_dma_flush);
 
+static void tegra_dma_busy(struct tegra_dma_channel *ch)
+{
+	if (!ch->busy_since)
+		ch->busy_since = local_clock() ?: 1;
+}
+
+static void tegra_dma_idle(struct tegra_dma_channel *ch)
+{
+	if (ch->busy_since) {
+		ch->busy_ns += local_clock() - ch->busy_since;
+		ch->busy_since = 0;
+	}
+}
+
 static void tegra_dma_stop(struct tegra_dma_channel *ch)
 {
 	u32 csr;
@@ -179,6 +206,7 @@ static void tegra_dma_stop(struct tegra_dma_channel *ch)
 	status = readl(ch->addr + APB_DMA_CHAN_STA);
 	if (status & STA_ISE_EOC)
 		writel(status, ch->addr + APB_DMA_CHAN_STA);
+	tegra_dma_idle(ch);
 }
 
 static void pause_dma(bool wait_for_burst_complete)
@@ -209,6 +237,8 @@ static void start_head_req(struct tegra_dma_channel *ch)
 					typeof(*head_req), node);
 			next_req->status = TEGRA_DMA_REQ_PENDING;
 		}
+	} else {
+		tegra_dma_idle(ch);
 	}
 }
 
@@ -518,7 +548,13 @@ int tegra_dma_get_transfer_count(struct tegra_dma_channel *ch,
 		return req->bytes_transferred;
 	}
 
-	if (req->status != TEGRA_DMA_REQ_INFLIGHT) {
+	/*
+	 * A double buffered request stays at the head, still running, after
+	 * its first half completes; keep reading the hardware count for it.
+	 */
+	if (req->status != TEGRA_DMA_REQ_INFLIGHT &&
+	    !((ch->mode & TEGRA_DMA_MODE_CONTINUOUS_DOUBLE) &&
+	      req->buffer_status == TEGRA_DMA_REQ_BUF_STATUS_HALF_FULL)) {
 		spin_unlock_irqrestore(&ch->lock, irq_flags);
 		pr_debug("The dma request is not running\n");
 		return req->bytes_transferred;
@@ -531,14 +567,10 @@ int tegra_dma_get_transfer_count(struct tegra_dma_channel *ch,
 }
 EXPORT_SYMBOL(tegra_dma_get_transfer_count);
 
-int tegra_dma_enqueue_req(struct tegra_dma_channel *ch,
+/* Checks @req and works out its registers, without the channel lock */
+static int tegra_dma_check_req(struct tegra_dma_channel *ch,
 	struct tegra_dma_req *req)
 {
-	unsigned long irq_flags;
-	struct tegra_dma_req *_req;
-	int start_dma = 0;
-	struct tegra_dma_req *hreq, *hnreq;
-
 	if (req->size > TEGRA_DMA_MAX_TRANSFER_SIZE ||
 		req->source_addr & 0x3 || req->dest_addr & 0x3) {
 		pr_err("Invalid DMA request for channel %d\n", ch->id);
@@ -553,14 +585,27 @@ int tegra_dma_enqueue_req(struct tegra_dma_channel *ch,
 		return -EINVAL;
 	}
 
-	spin_lock_irqsave(&ch->lock, irq_flags);
+	return tegra_dma_prepare_req(ch, req);
+}
 
-	list_for_each_entry(_req, &ch->list, node) {
-		if (req == _req) {
-			spin_unlock_irqrestore(&ch->lock, irq_flags);
-			return -EEXIST;
-		}
-	}
+/* should be called with the channel lock held */
+static bool tegra_dma_req_queued(struct tegra_dma_channel *ch,
+	struct tegra_dma_req *req)
+{
+	struct tegra_dma_req *_req;
+
+	list_for_each_entry(_req, &ch->list, node)
+		if (req == _req)
+			return true;
+	return false;
+}
+
+/* should be called with the channel lock held */
+static void __tegra_dma_enqueue_req(struct tegra_dma_channel *ch,
+	struct tegra_dma_req *req)
+{
+	int start_dma = 0;
+	struct tegra_dma_req *hreq, *hnreq;
 
 	req->bytes_transferred = 0;
 	req->status = TEGRA_DMA_REQ_PENDING;
@@ -570,35 +615,85 @@ int tegra_dma_enqueue_req(struct tegra_dma_channel *ch,
 		start_dma = 1;
 
 	list_add_tail(&req->node, &ch->list);
+	ch->reqs++;
+	ch->bytes += req->size;
 
 	if (start_dma) {
 		tegra_dma_update_hw(ch, req);
-	} else {
-		/*
-		 * Check to see if this request needs to be configured
-		 * immediately in continuous mode.
-		 */
-		if (ch->mode & TEGRA_DMA_MODE_ONESHOT)
-			goto end;
+		return;
+	}
 
-		hreq = list_entry(ch->list.next, typeof(*hreq), node);
-		hnreq = list_entry(hreq->node.next, typeof(*hnreq), node);
-		if (hnreq != req)
-			goto end;
+	/*
+	 * Check to see if this request needs to be configured
+	 * immediately in continuous mode.
+	 */
+	if (ch->mode & TEGRA_DMA_MODE_ONESHOT)
+		return;
+
+	hreq = list_entry(ch->list.next, typeof(*hreq), node);
+	hnreq = list_entry(hreq->node.next, typeof(*hnreq), node);
+	if (hnreq != req)
+		return;
+
+	if ((ch->mode & TEGRA_DMA_MODE_CONTINUOUS_DOUBLE) &&
+	    (req->buffer_status != TEGRA_DMA_REQ_BUF_STATUS_HALF_FULL))
+		return;
+
+	/* Need to configure the new request now */
+	tegra_dma_update_hw_partial(ch, req);
+}
+
+int tegra_dma_enqueue_req(struct tegra_dma_channel *ch,
+	struct tegra_dma_req *req)
+{
+	unsigned long irq_flags;
+	int ret;
 
-		if ((ch->mode & TEGRA_DMA_MODE_CONTINUOUS_DOUBLE) &&
-		    (req->buffer_status != TEGRA_DMA_REQ_BUF_STATUS_HALF_FULL))
-			goto end;
+	ret = tegra_dma_check_req(ch, req);
+	if (ret)
+		return ret;
 
-		/* Need to configure the new request now */
-		tegra_dma_update_hw_partial(ch, req);
+	spin_lock_irqsave(&ch->lock, irq_flags);
+	if (tegra_dma_req_queued(ch, req))
+		ret = -EEXIST;
+	else
+		__tegra_dma_enqueue_req(ch, req);
+	spin_unlock_irqrestore(&ch->lock, irq_flags);
+	return ret;
+}
+EXPORT_SYMBOL(tegra_dma_enqueue_req);
+
+/*
+ * tegra_dma_enqueue_sg: queue the @nents requests of @reqs in one go.
+ * Their registers are worked out first, so the ISR starts each one as
+ * soon as the one before completes.  Either all of them are queued, or
+ * none is.
+ */
+int tegra_dma_enqueue_sg(struct tegra_dma_channel *ch,
+	struct tegra_dma_req *reqs, int nents)
+{
+	unsigned long irq_flags;
+	int i, ret;
+
+	for (i = 0; i < nents; i++) {
+		ret = tegra_dma_check_req(ch, &reqs[i]);
+		if (ret)
+			return ret;
 	}
 
-end:
+	spin_lock_irqsave(&ch->lock, irq_flags);
+	for (i = 0; i < nents; i++) {
+		if (tegra_dma_req_queued(ch, &reqs[i])) {
+			spin_unlock_irqrestore(&ch->lock, irq_flags);
+			return -EEXIST;
+		}
+	}
+	for (i = 0; i < nents; i++)
+		__tegra_dma_enqueue_req(ch, &reqs[i]);
 	spin_unlock_irqrestore(&ch->lock, irq_flags);
 	return 0;
 }
-EXPORT_SYMBOL(tegra_dma_enqueue_req);
+EXPORT_SYMBOL(tegra_dma_enqueue_sg);
 
 static void tegra_dma_dump_channel_usage(void)
 {
@@ -611,26 +706,58 @@ static void tegra_dma_dump_channel_usage(void)
 	return;
 }
 
+/*
+ * The channel @name had last if it is still parked, else a free one,
+ * else one that another client parked.  Should be called with
+ * tegra_dma_lock held.
+ */
+static int tegra_dma_find_channel(const char *name)
+{
+	int i, parked = -1;
+
+	for (i = TEGRA_SYSTEM_DMA_CH_MIN; i <= TEGRA_SYSTEM_DMA_CH_MAX; i++) {
+		struct tegra_dma_channel *ch = &dma_channels[i];
+
+		if (!ch->parked)
+			continue;
+		if (!strcmp(ch->client_name, name)) {
+			ch->reuses++;
+			return i;
+		}
+		if (parked < 0)
+			parked = i;
+	}
+
+	i = find_first_zero_bit(channel_usage, ARRAY_SIZE(dma_channels));
+	if (i < ARRAY_SIZE(dma_channels))
+		return i;
+	return parked;
+}
+
 struct tegra_dma_channel *tegra_dma_allocate_channel(int mode,
 		const char namefmt[], ...)
 {
 	int channel;
 	struct tegra_dma_channel *ch = NULL;
+	char name[TEGRA_DMA_NAME_SIZE];
 	va_list args;
 	dma_isr_handler isr_handler = NULL;
 
 	if (WARN_ON(!tegra_dma_initialized))
 		return NULL;
 
+	va_start(args, namefmt);
+	vsnprintf(name, sizeof(name), namefmt, args);
+	va_end(args);
+
 	mutex_lock(&tegra_dma_lock);
 
 	/* first channel is the shared channel */
 	if (mode & TEGRA_DMA_SHARED) {
 		channel = TEGRA_SYSTEM_DMA_CH_MIN;
 	} else {
-		channel = find_first_zero_bit(channel_usage,
-			ARRAY_SIZE(dma_channels));
-		if (channel >= ARRAY_SIZE(dma_channels)) {
+		channel = tegra_dma_find_channel(name);
+		if (channel < 0) {
 			tegra_dma_dump_channel_usage();
 			goto out;
 		}
@@ -650,12 +777,10 @@ struct tegra_dma_channel *tegra_dma_allocate_channel(int mode,
 
 	__set_bit(channel, channel_usage);
 	ch = &dma_channels[channel];
+	ch->parked = false;
 	ch->mode = mode;
 	ch->isr_handler = isr_handler;
-	va_start(args, namefmt);
-	vsnprintf(ch->client_name, sizeof(ch->client_name),
-		namefmt, args);
-	va_end(args);
+	strlcpy(ch->client_name, name, sizeof(ch->client_name));
 
 out:
 	mutex_unlock(&tegra_dma_lock);
@@ -669,8 +794,8 @@ void tegra_dma_free_channel(struct tegra_dma_channel *ch)
 		return;
 	tegra_dma_cancel(ch);
 	mutex_lock(&tegra_dma_lock);
-	__clear_bit(ch->id, channel_usage);
-	memset(ch->client_name, 0, sizeof(ch->client_name));
+	/* stays allocated to client_name, see tegra_dma_find_channel() */
+	ch->parked = true;
 	ch->isr_handler = NULL;
 	ch->callback = NULL;
 	ch->cb_req = NULL;
@@ -681,21 +806,10 @@ EXPORT_SYMBOL(tegra_dma_free_channel);
 static bool tegra_dma_update_hw_partial(struct tegra_dma_channel *ch,
 	struct tegra_dma_req *req)
 {
-	u32 apb_ptr;
-	u32 ahb_ptr;
 	u32 csr;
 	unsigned long status;
-	unsigned int req_transfer_count;
 	bool configure = false;
 
-	if (req->to_memory) {
-		apb_ptr = req->source_addr;
-		ahb_ptr = req->dest_addr;
-	} else {
-		apb_ptr = req->dest_addr;
-		ahb_ptr = req->source_addr;
-	}
-
 	/*
 	 * The dma controller reloads the new configuration for next transfer
 	 * after last burst of current transfer completes.
@@ -719,13 +833,12 @@ static bool tegra_dma_update_hw_partial(struct tegra_dma_channel *ch,
 	}
 
 	/* Safe to program new configuration */
-	writel(apb_ptr, ch->addr + APB_DMA_CHAN_APB_PTR);
-	writel(ahb_ptr, ch->addr + APB_DMA_CHAN_AHB_PTR);
+	writel(req->apb_ptr, ch->addr + APB_DMA_CHAN_APB_PTR);
+	writel(req->ahb_ptr, ch->addr + APB_DMA_CHAN_AHB_PTR);
 
-	req_transfer_count = get_req_xfer_word_count(ch, req);
 	csr = readl(ch->addr + APB_DMA_CHAN_CSR);
 	csr &= ~CSR_WCOUNT_MASK;
-	csr |= (req_transfer_count - 1) << CSR_WCOUNT_SHIFT;
+	csr |= req->csr & CSR_WCOUNT_MASK;
 	writel(csr, ch->addr + APB_DMA_CHAN_CSR);
 	req->status = TEGRA_DMA_REQ_INFLIGHT;
 	configure = true;
@@ -735,7 +848,8 @@ exit_config:
 	return configure;
 }
 
-static void tegra_dma_update_hw(struct tegra_dma_channel *ch,
+/* Works out the channel registers for @req, see tegra_dma_update_hw() */
+static int tegra_dma_prepare_req(struct tegra_dma_channel *ch,
 	struct tegra_dma_req *req)
 {
 	int ahb_addr_wrap;
@@ -849,7 +963,8 @@ static void tegra_dma_update_hw(struct tegra_dma_channel *ch,
 			break;
 		index++;
 	} while (index < ARRAY_SIZE(apb_addr_wrap_table));
-	BUG_ON(index == ARRAY_SIZE(apb_addr_wrap_table));
+	if (index == ARRAY_SIZE(apb_addr_wrap_table))
+		goto bad_req;
 	apb_seq |= index << APB_SEQ_WRAP_SHIFT;
 
 	/* set address wrap for AHB size */
@@ -859,33 +974,51 @@ static void tegra_dma_update_hw(struct tegra_dma_channel *ch,
 			break;
 		index++;
 	} while (index < ARRAY_SIZE(ahb_addr_wrap_table));
-	BUG_ON(index == ARRAY_SIZE(ahb_addr_wrap_table));
+	if (index == ARRAY_SIZE(ahb_addr_wrap_table))
+		goto bad_req;
 	ahb_seq |= index << AHB_SEQ_WRAP_SHIFT;
 
 	for (index = 0; index < ARRAY_SIZE(bus_width_table); index++) {
 		if (bus_width_table[index] == ahb_bus_width)
 			break;
 	}
-	BUG_ON(index == ARRAY_SIZE(bus_width_table));
+	if (index == ARRAY_SIZE(bus_width_table))
+		goto bad_req;
 	ahb_seq |= index << AHB_SEQ_BUS_WIDTH_SHIFT;
 
 	for (index = 0; index < ARRAY_SIZE(bus_width_table); index++) {
 		if (bus_width_table[index] == apb_bus_width)
 			break;
 	}
-	BUG_ON(index == ARRAY_SIZE(bus_width_table));
+	if (index == ARRAY_SIZE(bus_width_table))
+		goto bad_req;
 	apb_seq |= index << APB_SEQ_BUS_WIDTH_SHIFT;
 
-	writel(csr, ch->addr + APB_DMA_CHAN_CSR);
-	writel(apb_seq, ch->addr + APB_DMA_CHAN_APB_SEQ);
-	writel(apb_ptr, ch->addr + APB_DMA_CHAN_APB_PTR);
-	writel(ahb_seq, ch->addr + APB_DMA_CHAN_AHB_SEQ);
-	writel(ahb_ptr, ch->addr + APB_DMA_CHAN_AHB_PTR);
+	req->csr = csr;
+	req->apb_seq = apb_seq;
+	req->apb_ptr = apb_ptr;
+	req->ahb_seq = ahb_seq;
+	req->ahb_ptr = ahb_ptr;
+	return 0;
 
-	csr |= CSR_ENB;
-	writel(csr, ch->addr + APB_DMA_CHAN_CSR);
+bad_req:
+	pr_err("Invalid DMA wrap or bus width for channel %d\n", ch->id);
+	return -EINVAL;
+}
+
+/* should be called with the channel lock held */
+static void tegra_dma_update_hw(struct tegra_dma_channel *ch,
+	struct tegra_dma_req *req)
+{
+	writel(req->csr, ch->addr + APB_DMA_CHAN_CSR);
+	writel(req->apb_seq, ch->addr + APB_DMA_CHAN_APB_SEQ);
+	writel(req->apb_ptr, ch->addr + APB_DMA_CHAN_APB_PTR);
+	writel(req->ahb_seq, ch->addr + APB_DMA_CHAN_AHB_SEQ);
+	writel(req->ahb_ptr, ch->addr + APB_DMA_CHAN_AHB_PTR);
+	writel(req->csr | CSR_ENB, ch->addr + APB_DMA_CHAN_CSR);
 
 	req->status = TEGRA_DMA_REQ_INFLIGHT;
+	tegra_dma_busy(ch);
 }
 
 static void handle_oneshot_dma(struct tegra_dma_channel *ch)
@@ -1035,6 +1168,7 @@ static irqreturn_t dma_isr(int irq, void *data)
 	if (status & STA_ISE_EOC) {
 		/* Clear dma int status */
 		writel(status, ch->addr + APB_DMA_CHAN_STA);
+		ch->irqs++;
 		handle_dma_isr_locked(ch);
 		callback = ch->callback;
 		cb_req = ch->cb_req;
@@ -1208,6 +1342,7 @@ subsys_initcall(tegra_dma_syscore_init);
 static int dbg_dma_show(struct seq_file *s, void *unused)
 {
 	int i;
+	u64 now;
 
 	seq_printf(s, "    APBDMA global register\n");
 	seq_printf(s, "DMA_GEN:   0x%08x\n",
@@ -1235,10 +1370,28 @@ static int dbg_dma_show(struct seq_file *s, void *unused)
 	}
 	seq_printf(s, "\nAPB DMA users\n");
 	seq_printf(s, "-------------\n");
+	seq_printf(s, "%-6s %-16s %8s %10s %12s %10s %6s %6s\n", "chan",
+		   "client", "state", "reqs", "kbytes", "irqs", "busy%",
+		   "reuse");
+	now = local_clock();
 	for (i = TEGRA_SYSTEM_DMA_CH_MIN; i <= TEGRA_SYSTEM_DMA_CH_MAX; i++) {
 		struct tegra_dma_channel *ch = &dma_channels[i];
-		if (strlen(ch->client_name) > 0)
-			seq_printf(s, "dma %d -> %s\n", i, ch->client_name);
+		unsigned long irq_flags;
+		u64 busy_ns;
+
+		if (!strlen(ch->client_name))
+			continue;
+		spin_lock_irqsave(&ch->lock, irq_flags);
+		busy_ns = ch->busy_ns;
+		if (ch->busy_since)
+			busy_ns += now - ch->busy_since;
+		seq_printf(s, "dma %-2d %-16s %8s %10lu %12llu %10lu %6llu "
+			   "%6lu\n", i, ch->client_name,
+			   ch->parked ? "parked" : "in use", ch->reqs,
+			   ch->bytes >> 10, ch->irqs,
+			   div64_u64(busy_ns * 100, max_t(u64, now, 1)),
+			   ch->reuses);
+		spin_unlock_irqrestore(&ch->lock, irq_flags);
 	}
 	return 0;
 }
@@ -32,6 +32,7 @@
 #include <linux/suspend.h>
 #include <linux/delay.h>
 #include <linux/reboot.h>
+#include <linux/workqueue.h>
 
 #include <mach/clk.h>
 
@@ -39,6 +40,9 @@
 #include "clock.h"
 #include "dvfs.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/tegra_dvfs.h>
+
 #define DVFS_RAIL_STATS_BIN	25
 #define DVFS_RAIL_STATS_SCALE	2
 #define DVFS_RAIL_STATS_RANGE   ((DVFS_RAIL_STATS_TOP_BIN - 1) * \
@@ -47,6 +51,10 @@
 static LIST_HEAD(dvfs_rail_list);
 static DEFINE_MUTEX(dvfs_lock);
 static DEFINE_MUTEX(rail_disable_lock);
+static int dvfs_batch_depth;
+
+static void dvfs_prepare_expire(struct work_struct *work);
+static DECLARE_DELAYED_WORK(dvfs_prepare_work, dvfs_prepare_expire);
 
 static int dvfs_rail_update(struct dvfs_rail *rail);
 
@@ -209,11 +217,22 @@ static int dvfs_rail_set_voltage(struct dvfs_rail *rail, int millivolts)
 		}
 
 		if (!rail->disabled) {
+			ktime_t start = ktime_get();
+			s64 us;
+
 			rail->updating = true;
 			ret = regulator_set_voltage(rail->reg,
 				rail->new_millivolts * 1000,
 				rail->max_millivolts * 1000);
 			rail->updating = false;
+
+			us = ktime_us_delta(ktime_get(), start);
+			trace_tegra_dvfs_rail_set_voltage(rail->reg_id,
+				rail->new_millivolts, us);
+			rail->stats.reg_writes++;
+			rail->stats.reg_write_us += us;
+			rail->stats.reg_write_max_us =
+				max_t(u64, rail->stats.reg_write_max_us, us);
 		}
 		if (ret) {
 			pr_err("Failed to set dvfs regulator %s\n", rail->reg_id);
@@ -251,7 +270,7 @@ out:
  * dvfs_rail_update on any rails that depend on this rail. */
 static int dvfs_rail_update(struct dvfs_rail *rail)
 {
-	int millivolts = 0;
+	int millivolts = rail->prepare_millivolts;
 	struct dvfs *d;
 	struct dvfs_relationship *rel;
 	int ret = 0;
@@ -287,6 +306,15 @@ static int dvfs_rail_update(struct dvfs_rail *rail)
 		if (rail->new_millivolts == rail->millivolts)
 			break;
 
+		/* leave drops to tegra_dvfs_batch_commit() */
+		if (dvfs_batch_depth &&
+		    rail->new_millivolts < rail->millivolts) {
+			if (!rail->batch_pending)
+				rail->stats.batched++;
+			rail->batch_pending = true;
+			break;
+		}
+
 		ret = dvfs_rail_set_voltage(rail, rail->new_millivolts);
 	}
 
@@ -326,11 +354,20 @@ static inline unsigned long *dvfs_get_freqs(struct dvfs *d)
 		&d->alt_freqs[0] : &d->freqs[0];
 }
 
-static int
-__tegra_dvfs_set_rate(struct dvfs *d, unsigned long rate)
+/* Table voltage at step @i, less the per-device trim */
+static inline int dvfs_step_millivolts(struct dvfs *d, int i)
+{
+	int mv = d->millivolts[i];
+
+	if (!d->millivolts_trim[i])
+		return mv;
+	return max(mv - d->millivolts_trim[i], d->dvfs_rail->min_millivolts);
+}
+
+/* Voltage the clock of @d needs to run at @rate */
+static int dvfs_rate_millivolts(struct dvfs *d, unsigned long rate)
 {
 	int i = 0;
-	int ret;
 	unsigned long *freqs = dvfs_get_freqs(d);
 
 	if (freqs == NULL || d->millivolts == NULL)
@@ -342,21 +379,31 @@ __tegra_dvfs_set_rate(struct dvfs *d, unsigned long rate)
 		return -EINVAL;
 	}
 
-	if (rate == 0) {
-		d->cur_millivolts = 0;
-	} else {
-		while (i < d->num_freqs && rate > freqs[i])
-			i++;
+	if (rate == 0)
+		return 0;
 
-		if ((d->max_millivolts) &&
-		    (d->millivolts[i] > d->max_millivolts)) {
-			pr_warn("tegra_dvfs: voltage %d too high for dvfs on"
-				" %s\n", d->millivolts[i], d->clk_name);
-			return -EINVAL;
-		}
-		d->cur_millivolts = d->millivolts[i];
+	while (i < d->num_freqs && rate > freqs[i])
+		i++;
+
+	if ((d->max_millivolts) &&
+	    (d->millivolts[i] > d->max_millivolts)) {
+		pr_warn("tegra_dvfs: voltage %d too high for dvfs on"
+			" %s\n", d->millivolts[i], d->clk_name);
+		return -EINVAL;
 	}
+	return dvfs_step_millivolts(d, i);
+}
+
+static int
+__tegra_dvfs_set_rate(struct dvfs *d, unsigned long rate)
+{
+	int ret;
+	int mv = dvfs_rate_millivolts(d, rate);
 
+	if (mv < 0)
+		return mv;
+
+	d->cur_millivolts = mv;
 	d->cur_rate = rate;
 
 	ret = dvfs_rail_update(d->dvfs_rail);
@@ -418,7 +465,27 @@ int tegra_dvfs_predict_millivolts(struct clk *c, unsigned long rate)
 	if (i == c->dvfs->num_freqs)
 		return -EINVAL;
 
-	return c->dvfs->millivolts[i];
+	return dvfs_step_millivolts(c->dvfs, i);
+}
+
+/*
+ * Lower the voltage of step @index of @d by @millivolts below the table,
+ * for parts known to have margin. The rail is updated right away if the
+ * clock is running at that step.
+ */
+int tegra_dvfs_set_trim(struct dvfs *d, int index, int millivolts)
+{
+	int ret;
+
+	if ((index < 0) || (index >= d->num_freqs) ||
+	    (millivolts < 0) || (millivolts > MAX_DVFS_TRIM_MV))
+		return -EINVAL;
+
+	mutex_lock(&dvfs_lock);
+	d->millivolts_trim[index] = millivolts;
+	ret = __tegra_dvfs_set_rate(d, d->cur_rate);
+	mutex_unlock(&dvfs_lock);
+	return ret;
 }
 
 int tegra_dvfs_set_rate(struct clk *c, unsigned long rate)
@@ -436,6 +503,104 @@ int tegra_dvfs_set_rate(struct clk *c, unsigned long rate)
 }
 EXPORT_SYMBOL(tegra_dvfs_set_rate);
 
+/*
+ * Batched rate changes.  Between tegra_dvfs_batch_begin() and
+ * tegra_dvfs_batch_commit() voltage raises are still applied at once, as
+ * the clocks need them before running faster, but rails are not lowered:
+ * a sequence of rate changes that goes down and up again then steps each
+ * rail once, to its final level, at commit.  Batches may nest and overlap;
+ * rails are solved when the last one is committed.
+ */
+void tegra_dvfs_batch_begin(void)
+{
+	mutex_lock(&dvfs_lock);
+	dvfs_batch_depth++;
+	mutex_unlock(&dvfs_lock);
+}
+EXPORT_SYMBOL(tegra_dvfs_batch_begin);
+
+int tegra_dvfs_batch_commit(void)
+{
+	struct dvfs_rail *rail;
+	int ret = 0;
+
+	mutex_lock(&dvfs_lock);
+	if (!WARN_ON(dvfs_batch_depth <= 0) && !--dvfs_batch_depth) {
+		list_for_each_entry(rail, &dvfs_rail_list, node) {
+			if (!rail->batch_pending)
+				continue;
+			rail->batch_pending = false;
+			ret = dvfs_rail_update(rail) ? : ret;
+		}
+	}
+	mutex_unlock(&dvfs_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(tegra_dvfs_batch_commit);
+
+/*
+ * Speculative raise: bring the rail of @c up to the level @rate needs
+ * before the rate change is made, so that the change itself does not wait
+ * for the regulator.  The floor lapses after @ms unless renewed.  May
+ * sleep; callers in atomic context queue it on a work.
+ */
+int tegra_dvfs_rail_prepare(struct clk *c, unsigned long rate,
+			    unsigned int ms)
+{
+	struct dvfs_rail *rail;
+	ktime_t start;
+	int mv, ret;
+
+	if (!c->dvfs || !c->dvfs->dvfs_rail)
+		return -EINVAL;
+	rail = c->dvfs->dvfs_rail;
+
+	mutex_lock(&dvfs_lock);
+	mv = dvfs_rate_millivolts(c->dvfs, rate);
+	if (mv < 0) {
+		mutex_unlock(&dvfs_lock);
+		return mv;
+	}
+
+	rail->prepare_end = jiffies + msecs_to_jiffies(ms);
+	rail->prepare_millivolts = max(rail->prepare_millivolts, mv);
+
+	start = ktime_get();
+	ret = dvfs_rail_update(rail);
+	trace_tegra_dvfs_rail_prepare(rail->reg_id, rail->millivolts,
+				      ktime_us_delta(ktime_get(), start));
+	mutex_unlock(&dvfs_lock);
+
+	schedule_delayed_work(&dvfs_prepare_work, msecs_to_jiffies(ms));
+	return ret;
+}
+EXPORT_SYMBOL(tegra_dvfs_rail_prepare);
+
+static void dvfs_prepare_expire(struct work_struct *work)
+{
+	struct dvfs_rail *rail;
+	unsigned long next = 0;
+
+	mutex_lock(&dvfs_lock);
+	list_for_each_entry(rail, &dvfs_rail_list, node) {
+		if (!rail->prepare_millivolts)
+			continue;
+		if (time_before(jiffies, rail->prepare_end)) {
+			if (!next || time_before(rail->prepare_end, next))
+				next = rail->prepare_end;
+			continue;
+		}
+		rail->prepare_millivolts = 0;
+		dvfs_rail_update(rail);
+	}
+	mutex_unlock(&dvfs_lock);
+
+	if (next)
+		schedule_delayed_work(&dvfs_prepare_work,
+				      max_t(long, next - jiffies, 1));
+}
+
 /* May only be called during clock init, does not take any locks on clock c. */
 int __init tegra_enable_dvfs_on_clk(struct clk *c, struct dvfs *d)
 {
@@ -675,6 +840,23 @@ struct dvfs_rail *tegra_dvfs_get_rail_by_name(const char *reg_id)
 	return NULL;
 }
 
+/*
+ * The voltage the rail was last set to, for callers that cannot take
+ * dvfs_lock.  Rails are only added at init, so the list is walked without
+ * it; the value can be one transition out of date.
+ */
+int tegra_dvfs_rail_get_millivolts(const char *reg_id)
+{
+	struct dvfs_rail *rail;
+
+	list_for_each_entry(rail, &dvfs_rail_list, node) {
+		if (!strcmp(reg_id, rail->reg_id))
+			return ACCESS_ONCE(rail->millivolts);
+	}
+	return -EINVAL;
+}
+EXPORT_SYMBOL(tegra_dvfs_rail_get_millivolts);
+
 bool tegra_dvfs_rail_updating(struct clk *clk)
 {
 	return (!clk ? false :
@@ -794,6 +976,13 @@ static int rail_stats_show(struct seq_file *s, void *data)
 		seq_printf(s, "%s\n", rail->reg_id);
 		dvfs_rail_stats_update(rail, -1, ktime_get());
 
+		seq_printf(s, "regulator writes %llu, avg %llu us, max %llu us,"
+			   " batched drops %llu\n", rail->stats.reg_writes,
+			   rail->stats.reg_writes ?
+			   div64_u64(rail->stats.reg_write_us,
+				     rail->stats.reg_writes) : 0,
+			   rail->stats.reg_write_max_us, rail->stats.batched);
+
 		seq_printf(s, "%-12d %-10llu\n", 0,
 			cputime64_to_clock_t(msecs_to_jiffies(
 				ktime_to_ms(rail->stats.time_at_mv[0]))));
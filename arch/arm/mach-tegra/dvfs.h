@@ -22,6 +22,7 @@
 #define _TEGRA_DVFS_H_
 
 #define MAX_DVFS_FREQS	18
+#define MAX_DVFS_TRIM_MV	100
 #define DVFS_RAIL_STATS_TOP_BIN	40
 
 struct clk;
@@ -49,6 +50,10 @@ struct rail_stats {
 	ktime_t last_update;
 	int last_index;
 	bool off;
+	u64 reg_writes;
+	u64 reg_write_us;
+	u64 reg_write_max_us;
+	u64 batched;		/* drops deferred to a batch commit */
 };
 
 struct dvfs_rail {
@@ -70,6 +75,9 @@ struct dvfs_rail {
 	int millivolts;
 	int new_millivolts;
 	bool suspended;
+	bool batch_pending;
+	int prepare_millivolts;	/* see tegra_dvfs_rail_prepare() */
+	unsigned long prepare_end;
 	struct rail_stats stats;
 };
 
@@ -90,6 +98,7 @@ struct dvfs {
 	unsigned long freqs[MAX_DVFS_FREQS];
 	unsigned long alt_freqs[MAX_DVFS_FREQS];
 	const int *millivolts;
+	int millivolts_trim[MAX_DVFS_FREQS];	/* see tegra_dvfs_set_trim() */
 	struct dvfs_rail *dvfs_rail;
 	bool auto_dvfs;
 	enum dvfs_alt_freqs alt_freqs_state;
@@ -126,6 +135,11 @@ void tegra_dvfs_core_cap_enable(bool enable);
 void tegra_dvfs_core_cap_level_set(int level);
 int tegra_dvfs_alt_freqs_set(struct dvfs *d, bool enable);
 void tegra_cpu_dvfs_alter(int edp_thermal_index, bool before_clk_update);
+void tegra_dvfs_batch_begin(void);
+int tegra_dvfs_batch_commit(void);
+int tegra_dvfs_rail_prepare(struct clk *c, unsigned long rate,
+			    unsigned int ms);
+int tegra_dvfs_set_trim(struct dvfs *d, int index, int millivolts);
 #else
 static inline void tegra_soc_init_dvfs(void)
 {}
@@ -165,6 +179,16 @@ static inline int tegra_dvfs_alt_freqs_set(struct dvfs *d, bool enable)
 static inline void tegra_cpu_dvfs_alter(int edp_thermal_index,
 					bool before_clk_update)
 {}
+static inline void tegra_dvfs_batch_begin(void)
+{}
+static inline int tegra_dvfs_batch_commit(void)
+{ return 0; }
+static inline int tegra_dvfs_rail_prepare(struct clk *c, unsigned long rate,
+					  unsigned int ms)
+{ return 0; }
+static inline int tegra_dvfs_set_trim(struct dvfs *d, int index,
+				      int millivolts)
+{ return 0; }
 #endif
 
 #ifndef CONFIG_ARCH_TEGRA_2x_SOC
@@ -0,0 +1,36 @@
+/*
+ * arch/arm/mach-tegra/frame-trace.c
+ *
+ * Frame ids shared by the binder, nvhost, display and cpufreq
+ * tracepoints, so that a frame's critical path can be put back together
+ * from a single trace.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/frame_trace.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/frame_trace.h>
+
+/* number of flips queued since boot; frame ids start at 1 */
+atomic_t frame_trace_seq = ATOMIC_INIT(0);
+EXPORT_SYMBOL_GPL(frame_trace_seq);
+
+EXPORT_TRACEPOINT_SYMBOL_GPL(frame_binder_txn);
+EXPORT_TRACEPOINT_SYMBOL_GPL(frame_gpu_submit);
+EXPORT_TRACEPOINT_SYMBOL_GPL(frame_syncpt_done);
+EXPORT_TRACEPOINT_SYMBOL_GPL(frame_flip);
+EXPORT_TRACEPOINT_SYMBOL_GPL(frame_scanout);
+EXPORT_TRACEPOINT_SYMBOL_GPL(frame_cpufreq);
+EXPORT_TRACEPOINT_SYMBOL_GPL(frame_hotplug);
@@ -0,0 +1,256 @@
+/*
+ * arch/arm/mach-tegra/hotplug-latency.c
+ *
+ * Per-CPU hotplug transition latency, split by phase, reported through
+ * tracepoints and a debugfs histogram.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "hotplug-latency.h"
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/tegra_hotplug.h>
+
+#define HP_LATENCY_BINS		24	/* up to ~8s in log2(us) bins */
+
+static const char * const hp_phase_names[TEGRA_HP_NR_PHASES] = {
+	[TEGRA_HP_UP_PREPARE]	= "up prepare",
+	[TEGRA_HP_UP_UNGATE]	= "up ungate",
+	[TEGRA_HP_UP_RESET]	= "up reset",
+	[TEGRA_HP_UP_ONLINE]	= "up online",
+	[TEGRA_HP_DOWN_PREPARE]	= "down prepare",
+	[TEGRA_HP_DOWN_DIE]	= "down die",
+	[TEGRA_HP_DOWN_DEAD]	= "down dead",
+};
+
+struct hp_phase_stats {
+	unsigned int count;
+	unsigned long max_us;
+	unsigned long long total_us;
+	unsigned int bin[HP_LATENCY_BINS];
+};
+
+static DEFINE_SPINLOCK(hp_latency_lock);
+static struct hp_phase_stats hp_latency[CONFIG_NR_CPUS][TEGRA_HP_NR_PHASES];
+static ktime_t hp_last_mark[CONFIG_NR_CPUS];
+static bool hp_in_transition[CONFIG_NR_CPUS];
+
+static inline unsigned int latency_to_bin(unsigned long us)
+{
+	return min_t(unsigned int, fls(us), HP_LATENCY_BINS - 1);
+}
+
+static void hp_latency_trace(unsigned int cpu, enum tegra_hp_phase phase,
+	unsigned long us)
+{
+	switch (phase) {
+	case TEGRA_HP_UP_PREPARE:
+		trace_tegra_hotplug_up_prepare(cpu, us);
+		break;
+	case TEGRA_HP_UP_UNGATE:
+		trace_tegra_hotplug_up_ungate(cpu, us);
+		break;
+	case TEGRA_HP_UP_RESET:
+		trace_tegra_hotplug_up_reset(cpu, us);
+		break;
+	case TEGRA_HP_UP_ONLINE:
+		trace_tegra_hotplug_up_online(cpu, us);
+		break;
+	case TEGRA_HP_DOWN_PREPARE:
+		trace_tegra_hotplug_down_prepare(cpu, us);
+		break;
+	case TEGRA_HP_DOWN_DIE:
+		trace_tegra_hotplug_down_die(cpu, us);
+		break;
+	case TEGRA_HP_DOWN_DEAD:
+		trace_tegra_hotplug_down_dead(cpu, us);
+		break;
+	default:
+		break;
+	}
+}
+
+/* May be called from the dying or booting CPU itself, with irqs off */
+void tegra_hp_latency_mark(unsigned int cpu, enum tegra_hp_phase phase)
+{
+	struct hp_phase_stats *stats;
+	unsigned long irqflags;
+	unsigned long us;
+	ktime_t now;
+
+	if (cpu >= CONFIG_NR_CPUS || phase >= TEGRA_HP_NR_PHASES)
+		return;
+
+	now = ktime_get();
+
+	spin_lock_irqsave(&hp_latency_lock, irqflags);
+	if (!hp_in_transition[cpu]) {
+		spin_unlock_irqrestore(&hp_latency_lock, irqflags);
+		return;
+	}
+
+	us = (unsigned long)ktime_to_us(ktime_sub(now, hp_last_mark[cpu]));
+	hp_last_mark[cpu] = now;
+	if (phase == TEGRA_HP_UP_ONLINE || phase == TEGRA_HP_DOWN_DEAD)
+		hp_in_transition[cpu] = false;
+
+	stats = &hp_latency[cpu][phase];
+	stats->count++;
+	stats->total_us += us;
+	if (us > stats->max_us)
+		stats->max_us = us;
+	stats->bin[latency_to_bin(us)]++;
+	spin_unlock_irqrestore(&hp_latency_lock, irqflags);
+
+	hp_latency_trace(cpu, phase, us);
+}
+
+static void hp_latency_start(unsigned int cpu, bool start)
+{
+	unsigned long irqflags;
+
+	if (cpu >= CONFIG_NR_CPUS)
+		return;
+
+	spin_lock_irqsave(&hp_latency_lock, irqflags);
+	hp_in_transition[cpu] = start;
+	hp_last_mark[cpu] = ktime_get();
+	spin_unlock_irqrestore(&hp_latency_lock, irqflags);
+}
+
+/* Runs first in the prepare chains, so the chain itself is accounted */
+static int hp_latency_start_notify(struct notifier_block *nb,
+	unsigned long action, void *hcpu)
+{
+	unsigned int cpu = (unsigned long)hcpu;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_UP_PREPARE:
+	case CPU_DOWN_PREPARE:
+		hp_latency_start(cpu, true);
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+/* Runs last in the completion chains */
+static int hp_latency_end_notify(struct notifier_block *nb,
+	unsigned long action, void *hcpu)
+{
+	unsigned int cpu = (unsigned long)hcpu;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_ONLINE:
+		tegra_hp_latency_mark(cpu, TEGRA_HP_UP_ONLINE);
+		break;
+	case CPU_DEAD:
+		tegra_hp_latency_mark(cpu, TEGRA_HP_DOWN_DEAD);
+		break;
+	case CPU_UP_CANCELED:
+	case CPU_DOWN_FAILED:
+		hp_latency_start(cpu, false);
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block hp_latency_start_nb = {
+	.notifier_call = hp_latency_start_notify,
+	.priority = INT_MAX,
+};
+
+static struct notifier_block hp_latency_end_nb = {
+	.notifier_call = hp_latency_end_notify,
+	.priority = INT_MIN,
+};
+
+static int __init tegra_hp_latency_init(void)
+{
+	register_hotcpu_notifier(&hp_latency_start_nb);
+	register_hotcpu_notifier(&hp_latency_end_nb);
+	return 0;
+}
+early_initcall(tegra_hp_latency_init);
+
+#ifdef CONFIG_DEBUG_FS
+
+static int hp_latency_show(struct seq_file *s, void *data)
+{
+	struct hp_phase_stats snap[TEGRA_HP_NR_PHASES];
+	unsigned long irqflags;
+	unsigned int cpu;
+	int phase, bin;
+
+	for_each_possible_cpu(cpu) {
+		spin_lock_irqsave(&hp_latency_lock, irqflags);
+		memcpy(snap, hp_latency[cpu], sizeof(snap));
+		spin_unlock_irqrestore(&hp_latency_lock, irqflags);
+
+		seq_printf(s, "cpu%u\n", cpu);
+		seq_printf(s, "%-14s %8s %10s %10s\n",
+			"phase", "count", "avg us", "max us");
+		seq_printf(s, "---------------------------------------------\n");
+		for (phase = 0; phase < TEGRA_HP_NR_PHASES; phase++) {
+			seq_printf(s, "%-14s %8u %10llu %10lu\n",
+				hp_phase_names[phase], snap[phase].count,
+				div64_u64(snap[phase].total_us,
+					snap[phase].count ?: 1),
+				snap[phase].max_us);
+		}
+
+		for (phase = 0; phase < TEGRA_HP_NR_PHASES; phase++) {
+			if (!snap[phase].count)
+				continue;
+			seq_printf(s, "\n%s:\n", hp_phase_names[phase]);
+			for (bin = 0; bin < HP_LATENCY_BINS; bin++) {
+				if (!snap[phase].bin[bin])
+					continue;
+				seq_printf(s, "%8u - %8u us: %8u\n",
+					bin ? 1 << (bin - 1) : 0, 1 << bin,
+					snap[phase].bin[bin]);
+			}
+		}
+		seq_printf(s, "\n");
+	}
+	return 0;
+}
+
+static int hp_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, hp_latency_show, inode->i_private);
+}
+
+static const struct file_operations hp_latency_fops = {
+	.open		= hp_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init tegra_hp_latency_debug_init(void)
+{
+	if (!debugfs_create_file("tegra_hotplug_latency", S_IRUGO, NULL,
+				 NULL, &hp_latency_fops))
+		return -ENOMEM;
+	return 0;
+}
+late_initcall(tegra_hp_latency_debug_init);
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ * arch/arm/mach-tegra/hotplug-latency.h
+ *
+ * CPU hotplug transition latency accounting.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef __MACH_TEGRA_HOTPLUG_LATENCY_H
+#define __MACH_TEGRA_HOTPLUG_LATENCY_H
+
+/*
+ * Each phase ends when it is marked; it starts where the previous phase
+ * of the same transition ended.
+ */
+enum tegra_hp_phase {
+	TEGRA_HP_UP_PREPARE,	/* CPU_UP_PREPARE chain to boot_secondary */
+	TEGRA_HP_UP_UNGATE,	/* partition power-up and clamp removal */
+	TEGRA_HP_UP_RESET,	/* reset release to secondary init */
+	TEGRA_HP_UP_ONLINE,	/* secondary init to CPU_ONLINE chain done */
+	TEGRA_HP_DOWN_PREPARE,	/* CPU_DOWN_PREPARE chain and stop_machine */
+	TEGRA_HP_DOWN_DIE,	/* cpu disable until the core is in reset */
+	TEGRA_HP_DOWN_DEAD,	/* CPU_DEAD chain done */
+	TEGRA_HP_NR_PHASES,
+};
+
+#ifdef CONFIG_HOTPLUG_CPU
+void tegra_hp_latency_mark(unsigned int cpu, enum tegra_hp_phase phase);
+#else
+static inline void tegra_hp_latency_mark(unsigned int cpu,
+	enum tegra_hp_phase phase)
+{ }
+#endif
+
+#endif
@@ -17,6 +17,7 @@
 #include <mach/iomap.h>
 
 #include "gic.h"
+#include "hotplug-latency.h"
 #include "sleep.h"
 
 #define CPU_CLOCK(cpu) (0x1<<(8+cpu))
@@ -48,6 +49,8 @@ int platform_cpu_kill(unsigned int cpu)
 	reg = readl(CLK_RST_CONTROLLER_CLK_CPU_CMPLX);
 	writel(reg | CPU_CLOCK(cpu), CLK_RST_CONTROLLER_CLK_CPU_CMPLX);
 
+	tegra_hp_latency_mark(cpu, TEGRA_HP_DOWN_DIE);
+
 	return 1;
 }
 
@@ -86,5 +89,9 @@ int platform_cpu_disable(unsigned int cpu)
 	 * we don't allow CPU 0 to be shutdown (it is still too special
 	 * e.g. clock tick interrupts)
 	 */
-	return cpu == 0 ? -EPERM : 0;
+	if (cpu == 0)
+		return -EPERM;
+
+	tegra_hp_latency_mark(cpu, TEGRA_HP_DOWN_PREPARE);
+	return 0;
 }
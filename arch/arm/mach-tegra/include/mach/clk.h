@@ -22,6 +22,8 @@
 #ifndef __MACH_CLK_H
 #define __MACH_CLK_H
 
+#include <linux/errno.h>
+
 struct clk;
 struct dvfs;
 struct notifier_block;
@@ -53,6 +55,7 @@ static inline void tegra_sdmmc_tap_delay(struct clk *c, int delay)
 }
 #endif
 int tegra_dvfs_rail_disable_by_name(const char *reg_id);
+int tegra_dvfs_rail_get_millivolts(const char *reg_id);
 int tegra_clk_cfg_ex(struct clk *c, enum tegra_clk_ex_param p, u32 setting);
 int tegra_register_clk_rate_notifier(struct clk *c, struct notifier_block *nb);
 void tegra_unregister_clk_rate_notifier(
@@ -68,4 +71,11 @@ int tegra_is_clk_enabled(struct clk *clk);
 
 void tegra_cpu_user_cap_set(unsigned int speed_khz);
 
+#ifdef CONFIG_ARCH_TEGRA_3x_SOC
+int tegra_actmon_emc_load(void);
+#else
+static inline int tegra_actmon_emc_load(void)
+{ return -ENODEV; }
+#endif
+
 #endif
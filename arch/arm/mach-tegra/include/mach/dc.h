@@ -360,6 +360,9 @@ struct tegra_dc_out {
 	u8			*out_sel_configs;
 	unsigned		n_out_sel_configs;
 
+	/* refresh rate while the content is static, 0 to keep the mode's */
+	unsigned		idle_refresh_hz;
+
 	int	(*enable)(void);
 	int	(*postpoweron)(void);
 	int	(*disable)(void);
@@ -529,6 +532,9 @@ void tegra_dc_incr_syncpt_min(struct tegra_dc *dc, int i, u32 val);
 int tegra_dc_update_windows(struct tegra_dc_win *windows[], int n);
 int tegra_dc_sync_windows(struct tegra_dc_win *windows[], int n);
 
+/* dst scans out what is posted to src, scaled to its mode; src NULL stops */
+int tegra_dc_set_mirror(struct tegra_dc *dst, struct tegra_dc *src);
+
 int tegra_dc_set_mode(struct tegra_dc *dc, const struct tegra_dc_mode *mode);
 struct fb_videomode;
 int tegra_dc_set_fb_mode(struct tegra_dc *dc, const struct fb_videomode *fbmode,
@@ -172,10 +172,22 @@ struct tegra_dma_req {
 
 	/* Client specific data */
 	void *dev;
+
+	/*
+	 * Channel registers for the request, worked out when it is queued
+	 * so that the ISR only has to write them to start it.
+	 */
+	u32 csr;
+	u32 apb_seq;
+	u32 ahb_seq;
+	u32 apb_ptr;
+	u32 ahb_ptr;
 };
 
 int tegra_dma_enqueue_req(struct tegra_dma_channel *ch,
 	struct tegra_dma_req *req);
+int tegra_dma_enqueue_sg(struct tegra_dma_channel *ch,
+	struct tegra_dma_req *reqs, int nents);
 int tegra_dma_dequeue_req(struct tegra_dma_channel *ch,
 	struct tegra_dma_req *req);
 void tegra_dma_flush(struct tegra_dma_channel *ch);
@@ -188,6 +200,12 @@ bool tegra_dma_is_empty(struct tegra_dma_channel *ch);
 
 struct tegra_dma_channel *tegra_dma_allocate_channel(int mode,
 		const char namefmt[], ...);
+/*
+ * tegra_dma_free_channel: the channel stays reserved for the same client
+ * name, so that the next tegra_dma_allocate_channel() with that name gets
+ * it back straight away.  It is only given to another client when no
+ * channel is left free.
+ */
 void tegra_dma_free_channel(struct tegra_dma_channel *ch);
 
 /*
@@ -22,6 +22,7 @@
 #define __MACH_EDP_H
 
 #include <linux/debugfs.h>
+#include <linux/notifier.h>
 
 struct tegra_edp_entry {
 	char speedo_id;
@@ -51,6 +52,9 @@ void tegra_get_cpu_edp_limits(const struct tegra_edp_limits **limits, int *size)
 unsigned int tegra_get_edp_limit(void);
 void tegra_get_system_edp_limits(const unsigned int **limits);
 int tegra_system_edp_alarm(bool alarm);
+int tegra_edp_predict_thermal_zone(long temp, long predicted);
+int tegra_edp_register_predict_notifier(struct notifier_block *nb);
+int tegra_edp_unregister_predict_notifier(struct notifier_block *nb);
 
 #else
 static inline void tegra_init_cpu_edp_limits(int regulator_mA)
@@ -68,6 +72,14 @@ static inline void tegra_get_system_edp_limits(unsigned int **limits)
 {}
 static inline int tegra_system_edp_alarm(bool alarm)
 { return -1; }
+static inline int tegra_edp_predict_thermal_zone(long temp, long predicted)
+{ return -1; }
+static inline int tegra_edp_register_predict_notifier(
+	struct notifier_block *nb)
+{ return -ENODEV; }
+static inline int tegra_edp_unregister_predict_notifier(
+	struct notifier_block *nb)
+{ return -ENODEV; }
 #endif
 
 #ifdef CONFIG_ARCH_TEGRA_2x_SOC
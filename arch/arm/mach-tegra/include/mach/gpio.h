@@ -77,4 +77,10 @@ int tegra_gpio_resume_init(void);
 void tegra_gpio_init_configure(unsigned gpio, bool is_input, int value);
 void tegra_gpio_set_tristate(int gpio, enum tegra_tristate ts);
 int tegra_gpio_get_bank_int_nr(int gpio);
+
+/* Lockless, without gpiolib; see drivers/gpio/gpio-tegra.c */
+void tegra_gpio_set_port(unsigned gpio, u8 mask, u8 value);
+int tegra_gpio_set_multiple(const unsigned *gpios, const int *values, int n);
+u8 tegra_gpio_get_port(unsigned gpio);
+int tegra_gpio_get_value(unsigned gpio);
 #endif
@@ -32,6 +32,7 @@
 typedef u32 tegra_iovmm_addr_t;
 
 struct tegra_iovmm_device_ops;
+struct page;
 
 /*
  * each I/O virtual memory manager unit should register a device with
@@ -101,6 +102,10 @@ struct tegra_iovmm_device_ops {
 	void (*map_pfn)(struct tegra_iovmm_domain *domain,
 		struct tegra_iovmm_area *io_vma,
 		unsigned long offs, unsigned long pfn);
+	/* optional, maps count pages at once; map_pfn is used otherwise */
+	void (*map_pages)(struct tegra_iovmm_domain *domain,
+		struct tegra_iovmm_area *io_vma, tegra_iovmm_addr_t addr,
+		struct page **pages, unsigned long count);
 	/*
 	 * ensures that a domain is resident in the hardware's mapping region
 	 * so that it may be used by a client
@@ -195,6 +200,13 @@ size_t tegra_iovmm_get_max_free(struct tegra_iovmm_client *client);
 void tegra_iovmm_vm_insert_pfn(struct tegra_iovmm_area *area,
 	tegra_iovmm_addr_t vaddr, unsigned long pfn);
 
+/*
+ * as tegra_iovmm_vm_insert_pfn, for count pages mapped from vaddr on.
+ * devices which can, update their page tables for the whole range at once.
+ */
+void tegra_iovmm_vm_insert_pages(struct tegra_iovmm_area *area,
+	tegra_iovmm_addr_t vaddr, struct page **pages, unsigned long count);
+
 /*
  * called by clients to return the iovmm_area containing addr, or NULL if
  * addr has not been allocated. caller should call tegra_iovmm_area_put when
@@ -277,6 +289,11 @@ static inline void tegra_iovmm_vm_insert_pfn(struct tegra_iovmm_area *area,
 {
 }
 
+static inline void tegra_iovmm_vm_insert_pages(struct tegra_iovmm_area *area,
+	tegra_iovmm_addr_t vaddr, struct page **pages, unsigned long count)
+{
+}
+
 static inline struct tegra_iovmm_area *tegra_iovmm_find_area_get(
 	struct tegra_iovmm_client *client, tegra_iovmm_addr_t addr)
 {
@@ -117,6 +117,8 @@ void nvmap_munmap(struct nvmap_handle_ref *r, void *addr);
 
 struct nvmap_client *nvmap_client_get_file(int fd);
 
+struct nvmap_handle_ref *nvmap_import_fd(struct nvmap_client *client, int fd);
+
 struct nvmap_client *nvmap_client_get(struct nvmap_client *client);
 
 void nvmap_client_put(struct nvmap_client *c);
@@ -17,6 +17,8 @@
 #ifndef __MACH_THERMAL_H
 #define __MACH_THERMAL_H
 
+#include <linux/errno.h>
+
 /* All units in millicelsius */
 struct tegra_thermal_data {
 	long temp_throttle;
@@ -50,6 +52,7 @@ struct tegra_thermal_device {
 int tegra_thermal_init(struct tegra_thermal_data *data);
 int tegra_thermal_set_device(struct tegra_thermal_device *device);
 int tegra_thermal_exit(void);
+int tegra_thermal_get_last_tj(long *tj);
 #else
 static inline int tegra_thermal_init(struct tegra_thermal_data *data)
 { return 0; }
@@ -57,6 +60,8 @@ static inline int tegra_thermal_set_device(struct tegra_thermal_device *dev)
 { return 0; }
 static inline int tegra_thermal_exit(void)
 { return 0; }
+static inline int tegra_thermal_get_last_tj(long *tj)
+{ return -ENODATA; }
 #endif
 
 #endif	/* __MACH_THERMAL_H */
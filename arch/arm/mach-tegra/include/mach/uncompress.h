@@ -103,6 +103,9 @@ static inline void konk_delay(int delay)
 }
 
 
+/* the us timer sched_clock counts, for the boot report */
+#define arch_decomp_timestamp()	(*(volatile u32 *)TEGRA_TMRUS_BASE)
+
 static inline void arch_decomp_setup(void)
 {
 	volatile u8 *uart = (volatile u8 *)TEGRA_DEBUG_UART_BASE;
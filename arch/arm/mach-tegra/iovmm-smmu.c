@@ -451,6 +451,31 @@ static void flush_ptc_and_tlb(struct smmu_device *smmu,
 	FLUSH_SMMU_REGS(smmu);
 }
 
+/*
+ * After a run of PTEs in one page table has changed: the PTC is flushed
+ * as a whole instead of line by line, and the TLB for the whole section
+ * the page table covers.
+ */
+static void flush_ptc_and_tlb_section(struct smmu_device *smmu,
+		struct smmu_as *as, unsigned long iova)
+{
+	writel(MC_SMMU_PTC_FLUSH_0_PTC_FLUSH_TYPE_ALL,
+		smmu->regs + MC_SMMU_PTC_FLUSH_0);
+	FLUSH_SMMU_REGS(smmu);
+	writel(MC_SMMU_TLB_FLUSH_0_TLB_FLUSH_VA(iova, SECTION) |
+		MC_SMMU_TLB_FLUSH_0_TLB_FLUSH_ASID_MATCH__ENABLE |
+		(as->asid << MC_SMMU_TLB_FLUSH_0_TLB_FLUSH_ASID_SHIFT),
+		smmu->regs + MC_SMMU_TLB_FLUSH_0);
+	FLUSH_SMMU_REGS(smmu);
+}
+
+/* Number of PTEs from iova to the end of its page table, at most count */
+static unsigned long ptbl_run(unsigned long iova, unsigned long count)
+{
+	return min(count, SMMU_PTBL_COUNT -
+			(SMMU_ADDR_TO_PFN(iova) % SMMU_PTBL_COUNT));
+}
+
 static void free_ptbl(struct smmu_as *as, unsigned long iova)
 {
 	unsigned long pdn = SMMU_ADDR_TO_PDN(iova);
@@ -676,28 +701,46 @@ static void smmu_unmap(struct tegra_iovmm_domain *domain,
 		 addr, as - as->smmu->as);
 
 	mutex_lock(&as->lock);
-	for (i = 0; i < pcount; i++) {
+	for (i = 0; i < pcount; ) {
 		unsigned long *pte;
 		struct page *page;
+		unsigned int j, n, cleared = 0, last = 0;
 
+		n = ptbl_run(addr, pcount - i);
 		if (iovma->ops && iovma->ops->release)
-			iovma->ops->release(iovma, i << PAGE_SHIFT);
+			for (j = 0; j < n; j++)
+				iovma->ops->release(iovma, (i + j) << PAGE_SHIFT);
 
 		pte = locate_pte(as, addr, false, &page, &pte_counter);
 		if (pte) {
-			if (*pte != _PTE_VACANT(addr)) {
-				*pte = _PTE_VACANT(addr);
-				FLUSH_CPU_DCACHE(pte, page, sizeof *pte);
-				flush_ptc_and_tlb(as->smmu, as, addr, pte,
-						page, 0);
-				kunmap(page);
-				if (!--(*pte_counter) && decommit) {
-					free_ptbl(as, addr);
-					smmu_flush_regs(as->smmu, 0);
+			for (j = 0; j < n; j++) {
+				unsigned long va = addr + (j << SMMU_PAGE_SHIFT);
+
+				if (pte[j] != _PTE_VACANT(va)) {
+					pte[j] = _PTE_VACANT(va);
+					cleared++;
+					last = j;
 				}
 			}
+			if (cleared) {
+				FLUSH_CPU_DCACHE(pte, page, n * sizeof(*pte));
+				if (cleared == 1)
+					flush_ptc_and_tlb(as->smmu, as,
+						addr + (last << SMMU_PAGE_SHIFT),
+						&pte[last], page, 0);
+				else
+					flush_ptc_and_tlb_section(as->smmu, as,
+						addr);
+			}
+			kunmap(page);
+			*pte_counter -= cleared;
+			if (cleared && !*pte_counter && decommit) {
+				free_ptbl(as, addr);
+				smmu_flush_regs(as->smmu, 0);
+			}
 		}
-		addr += SMMU_PAGE_SIZE;
+		i += n;
+		addr += n << SMMU_PAGE_SHIFT;
 	}
 	mutex_unlock(&as->lock);
 }
@@ -732,6 +775,59 @@ static void smmu_map_pfn(struct tegra_iovmm_domain *domain,
 	mutex_unlock(&as->lock);
 }
 
+/*
+ * Map count pages from addr on, with one cache and TLB maintenance pass
+ * per page table instead of one per page.
+ */
+static void smmu_map_pages(struct tegra_iovmm_domain *domain,
+	struct tegra_iovmm_area *iovma, tegra_iovmm_addr_t addr,
+	struct page **pages, unsigned long count)
+{
+	struct smmu_as *as = container_of(domain, struct smmu_as, domain);
+	struct smmu_device *smmu = as->smmu;
+
+	pr_debug("%s:%d iova=%lx count=%lu asid=%d\n", __func__, __LINE__,
+		 (unsigned long)addr, count, as - as->smmu->as);
+
+	mutex_lock(&as->lock);
+	while (count) {
+		unsigned long *pte;
+		unsigned int *pte_counter;
+		struct page *ptpage;
+		unsigned long i, n = ptbl_run(addr, count);
+
+		pte = locate_pte(as, addr, true, &ptpage, &pte_counter);
+		if (!pte)
+			break;
+
+		for (i = 0; i < n; i++) {
+			unsigned long va = addr + (i << SMMU_PAGE_SHIFT);
+			unsigned long pfn = page_to_pfn(pages[i]);
+
+			BUG_ON(!pfn_valid(pfn));
+			if (pte[i] == _PTE_VACANT(va))
+				(*pte_counter)++;
+			pte[i] = SMMU_PFN_TO_PTE(pfn, as->pte_attr);
+			if (unlikely(pte[i] == _PTE_VACANT(va)))
+				(*pte_counter)--;
+		}
+		FLUSH_CPU_DCACHE(pte, ptpage, n * sizeof(*pte));
+		if (n == 1)
+			flush_ptc_and_tlb(smmu, as, addr, pte, ptpage, 0);
+		else
+			flush_ptc_and_tlb_section(smmu, as, addr);
+		kunmap(ptpage);
+
+		for (i = 0; i < n; i++)
+			put_signature(as, addr + (i << SMMU_PAGE_SHIFT),
+				      page_to_pfn(pages[i]));
+		addr += n << SMMU_PAGE_SHIFT;
+		pages += n;
+		count -= n;
+	}
+	mutex_unlock(&as->lock);
+}
+
 /*
  * Caller must lock/unlock as
  */
@@ -923,6 +1019,7 @@ static struct tegra_iovmm_device_ops tegra_iovmm_smmu_ops = {
 	.map = smmu_map,
 	.unmap = smmu_unmap,
 	.map_pfn = smmu_map_pfn,
+	.map_pages = smmu_map_pages,
 	.alloc_domain = smmu_alloc_domain,
 	.free_domain = smmu_free_domain,
 	.suspend = smmu_suspend,
@@ -27,6 +27,9 @@
 #include <linux/string.h>
 #include <linux/slab.h>
 #include <linux/syscore_ops.h>
+#include <linux/moduleparam.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 
 #include <mach/iovmm.h>
 
@@ -73,6 +76,30 @@ struct iovmm_share_group {
 	spinlock_t			lock; /* for client_list */
 };
 
+/*
+ * map and unmap times of areas, by log2 of their size in pages, shown in
+ * /proc/iovmminfo.  batch_map=0 maps page by page even where the device
+ * can do better, to compare.
+ */
+#define IOVMM_STAT_BUCKETS	16
+
+enum {
+	IOVMM_STAT_MAP,
+	IOVMM_STAT_UNMAP,
+	IOVMM_STAT_NR,
+};
+
+struct iovmm_stat {
+	unsigned long count;
+	u64 ns;
+};
+
+static struct iovmm_stat iovmm_stats[IOVMM_STAT_NR][IOVMM_STAT_BUCKETS];
+static DEFINE_SPINLOCK(iovmm_stats_lock);
+
+static bool batch_map = 1;
+module_param(batch_map, bool, 0644);
+
 static LIST_HEAD(iovmm_devices);
 static LIST_HEAD(iovmm_groups);
 static DEFINE_MUTEX(iovmm_group_list_lock);
@@ -131,14 +158,31 @@ static void tegra_iovmm_block_stats(struct tegra_iovmm_domain *domain,
 	spin_unlock(&domain->block_lock);
 }
 
+static void iovmm_account(int op, unsigned long pages, u64 start)
+{
+	u64 ns = local_clock() - start;
+	int bucket = pages ? min(ilog2(pages), IOVMM_STAT_BUCKETS - 1) : 0;
+
+	spin_lock(&iovmm_stats_lock);
+	iovmm_stats[op][bucket].count++;
+	iovmm_stats[op][bucket].ns += ns;
+	spin_unlock(&iovmm_stats_lock);
+}
+
+static u64 iovmm_stat_avg_us(struct iovmm_stat *st)
+{
+	if (!st->count)
+		return 0;
+	return div_u64(div_u64(st->ns, NSEC_PER_USEC), st->count);
+}
+
 static int tegra_iovmm_read_proc(char *page, char **start, off_t off,
 	int count, int *eof, void *data)
 {
 	struct iovmm_share_group *grp;
 	size_t max_free, total_free, total;
 	unsigned int num, num_free;
-
-	int len = 0;
+	int i, len = 0;
 
 	mutex_lock(&iovmm_group_list_lock);
 	len += snprintf(page + len, count - len, "\ngroups\n");
@@ -163,6 +207,24 @@ static int tegra_iovmm_read_proc(char *page, char **start, off_t off,
 	}
 	mutex_unlock(&iovmm_group_list_lock);
 
+	len += snprintf(page + len, count - len, "\nmap times\n");
+	spin_lock(&iovmm_stats_lock);
+	for (i = 0; i < IOVMM_STAT_BUCKETS; i++) {
+		struct iovmm_stat *map = &iovmm_stats[IOVMM_STAT_MAP][i];
+		struct iovmm_stat *unmap = &iovmm_stats[IOVMM_STAT_UNMAP][i];
+
+		if (!map->count && !unmap->count)
+			continue;
+		len += snprintf(page + len, count - len,
+			"\t%s%6luKiB maps: %lu avg %lluus "
+			"unmaps: %lu avg %lluus\n",
+			i == IOVMM_STAT_BUCKETS - 1 ? ">=" : "  ",
+			(PAGE_SIZE << i) >> 10,
+			map->count, iovmm_stat_avg_us(map),
+			unmap->count, iovmm_stat_avg_us(unmap));
+	}
+	spin_unlock(&iovmm_stats_lock);
+
 	*eof = 1;
 	return len;
 }
@@ -530,6 +592,29 @@ void tegra_iovmm_vm_insert_pfn(struct tegra_iovmm_area *vm,
 	domain->dev->ops->map_pfn(domain, vm, vaddr, pfn);
 }
 
+void tegra_iovmm_vm_insert_pages(struct tegra_iovmm_area *vm,
+	tegra_iovmm_addr_t vaddr, struct page **pages, unsigned long count)
+{
+	struct tegra_iovmm_domain *domain = vm->domain;
+	int shift = domain->dev->pgsize_bits;
+	u64 start = local_clock();
+	unsigned long i;
+
+	BUG_ON(vaddr & ((1 << shift) - 1));
+	BUG_ON(vaddr < vm->iovm_start);
+	BUG_ON(vaddr + (count << shift) > vm->iovm_start + vm->iovm_length);
+	BUG_ON(vm->ops);
+
+	if (batch_map && domain->dev->ops->map_pages)
+		domain->dev->ops->map_pages(domain, vm, vaddr, pages, count);
+	else
+		for (i = 0; i < count; i++)
+			domain->dev->ops->map_pfn(domain, vm,
+				vaddr + (i << shift), page_to_pfn(pages[i]));
+
+	iovmm_account(IOVMM_STAT_MAP, count, start);
+}
+
 void tegra_iovmm_zap_vm(struct tegra_iovmm_area *vm)
 {
 	struct tegra_iovmm_block *b;
@@ -542,8 +627,13 @@ void tegra_iovmm_zap_vm(struct tegra_iovmm_area *vm)
 	 * the memory for the page tables it uses may not be allocated
 	 */
 	down_read(&domain->map_lock);
-	if (!test_and_clear_bit(BK_MAP_DIRTY, &b->flags))
+	if (!test_and_clear_bit(BK_MAP_DIRTY, &b->flags)) {
+		u64 start = local_clock();
+
 		domain->dev->ops->unmap(domain, vm, false);
+		iovmm_account(IOVMM_STAT_UNMAP,
+			vm->iovm_length >> domain->dev->pgsize_bits, start);
+	}
 	up_read(&domain->map_lock);
 }
 
@@ -580,8 +670,13 @@ void tegra_iovmm_free_vm(struct tegra_iovmm_area *vm)
 	b = container_of(vm, struct tegra_iovmm_block, vm_area);
 	domain = vm->domain;
 	down_read(&domain->map_lock);
-	if (!test_and_clear_bit(BK_MAP_DIRTY, &b->flags))
+	if (!test_and_clear_bit(BK_MAP_DIRTY, &b->flags)) {
+		u64 start = local_clock();
+
 		domain->dev->ops->unmap(domain, vm, true);
+		iovmm_account(IOVMM_STAT_UNMAP,
+			vm->iovm_length >> domain->dev->pgsize_bits, start);
+	}
 	iovmm_free_block(domain, b);
 	up_read(&domain->map_lock);
 }
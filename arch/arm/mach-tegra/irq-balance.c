@@ -0,0 +1,335 @@
+/*
+ * arch/arm/mach-tegra/irq-balance.c
+ *
+ * Spreads peripheral interrupts over the online cpus by the time spent
+ * in their handlers.  Everything targets CPU0 at boot, which then has
+ * to wake for every sdhci, touch, i2c, usb, dma and host1x interrupt.
+ *
+ * Once per interval the handler time of every line is sampled and
+ * decayed into a load in us per second.  While the gap between the
+ * busiest and the least busy online cpu is above threshold_us, the
+ * biggest movable line on the busiest cpu that still fits in the gap
+ * is moved across, at most max_moves per pass.  Lines whose affinity
+ * was set by a driver or from /proc are left alone.  Before a cpu goes
+ * offline its lines are moved to the least busy of the others, and on
+ * the LP cluster, which only has CPU0, nothing is moved.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/cpu.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/kernel_stat.h>
+#include <linux/mutex.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include <mach/irqs.h>
+
+#include "periodic-work.h"
+#include "pm.h"
+
+static unsigned int enabled = 1;
+module_param(enabled, uint, 0644);
+
+static unsigned int interval_ms = 1000;
+module_param(interval_ms, uint, 0644);
+
+/* 2ms of handler time per second, 0.2% of a cpu */
+static unsigned int threshold_us = 2000;
+module_param(threshold_us, uint, 0644);
+
+static unsigned int max_moves = 2;
+module_param(max_moves, uint, 0644);
+
+struct irq_balance_stat {
+	unsigned long last_ns;		/* desc->time_ns at the last sample */
+	u64 total_ns;
+	unsigned int load;		/* us per second, decayed */
+	int cpu;			/* where we put it, -1 if never moved */
+	bool pinned;			/* affinity set by someone else */
+	unsigned int moves;
+};
+
+static DEFINE_MUTEX(irq_balance_lock);
+static struct irq_balance_stat irq_stats[INT_GIC_NR];
+static unsigned int cpu_load[CONFIG_NR_CPUS];
+static u64 last_sample;
+static struct tegra_periodic_work irq_balance_work;
+
+static unsigned int irq_current_cpu(struct irq_desc *desc)
+{
+	unsigned int cpu;
+
+	cpu = cpumask_first_and(desc->irq_data.affinity, cpu_online_mask);
+	return cpu < nr_cpu_ids ? cpu : 0;
+}
+
+static bool irq_movable(struct irq_desc *desc, struct irq_balance_stat *st)
+{
+	struct irq_data *d = &desc->irq_data;
+
+	if (!desc->action || irqd_is_per_cpu(d) || !irqd_can_balance(d))
+		return false;
+	if (st->pinned)
+		return false;
+
+	if (st->cpu < 0)
+		st->pinned = !cpumask_equal(d->affinity, irq_default_affinity);
+	else
+		st->pinned = !cpumask_equal(d->affinity, cpumask_of(st->cpu));
+	return !st->pinned;
+}
+
+static void irq_move(unsigned int irq, struct irq_balance_stat *st,
+	unsigned int cpu)
+{
+	if (irq_set_affinity(irq, cpumask_of(cpu)))
+		return;
+	st->cpu = cpu;
+	st->moves++;
+}
+
+/* Fold the handler time since the last sample into each line's load */
+static void irq_balance_sample(void)
+{
+	u64 now = local_clock();
+	u64 elapsed_us = div_u64(now - last_sample, NSEC_PER_USEC);
+	unsigned int irq;
+
+	last_sample = now;
+	memset(cpu_load, 0, sizeof(cpu_load));
+
+	for (irq = INT_PRI_BASE; irq < INT_GIC_NR; irq++) {
+		struct irq_desc *desc = irq_to_desc(irq);
+		struct irq_balance_stat *st = &irq_stats[irq];
+		unsigned long ns, delta;
+
+		if (!desc || !desc->action)
+			continue;
+
+		ns = ACCESS_ONCE(desc->time_ns);
+		delta = ns - st->last_ns;
+		st->last_ns = ns;
+		st->total_ns += delta;
+
+		/* us of handler per second of wall time */
+		if (elapsed_us)
+			st->load = (st->load + (unsigned int)div64_u64(
+				(u64)delta * 1000, elapsed_us)) / 2;
+		cpu_load[irq_current_cpu(desc)] += st->load;
+	}
+}
+
+static unsigned int least_busy_cpu(int skip)
+{
+	unsigned int cpu, best = 0, best_load = UINT_MAX;
+
+	for_each_online_cpu(cpu) {
+		if (cpu == skip)
+			continue;
+		if (cpu_load[cpu] < best_load) {
+			best = cpu;
+			best_load = cpu_load[cpu];
+		}
+	}
+	return best;
+}
+
+static void irq_balance_pass(void)
+{
+	unsigned int busiest, idlest, cpu, irq, n;
+
+	irq_balance_sample();
+
+	if (!enabled || is_lp_cluster() || num_online_cpus() < 2)
+		return;
+
+	for (n = 0; n < max_moves; n++) {
+		struct irq_balance_stat *best = NULL;
+		unsigned int best_irq = 0, gap;
+
+		busiest = idlest = least_busy_cpu(-1);
+		for_each_online_cpu(cpu)
+			if (cpu_load[cpu] > cpu_load[busiest])
+				busiest = cpu;
+
+		gap = cpu_load[busiest] - cpu_load[idlest];
+		if (gap < threshold_us)
+			break;
+
+		/* Only moves that shrink the gap, so lines cannot ping-pong */
+		for (irq = INT_PRI_BASE; irq < INT_GIC_NR; irq++) {
+			struct irq_desc *desc = irq_to_desc(irq);
+			struct irq_balance_stat *st = &irq_stats[irq];
+
+			if (!desc || !irq_movable(desc, st) ||
+			    irq_current_cpu(desc) != busiest ||
+			    !st->load || st->load >= gap)
+				continue;
+			if (!best || st->load > best->load) {
+				best = st;
+				best_irq = irq;
+			}
+		}
+		if (!best)
+			break;
+
+		irq_move(best_irq, best, idlest);
+		cpu_load[busiest] -= best->load;
+		cpu_load[idlest] += best->load;
+	}
+}
+
+static void irq_balance_work_func(struct work_struct *work)
+{
+	get_online_cpus();
+	mutex_lock(&irq_balance_lock);
+	irq_balance_pass();
+	mutex_unlock(&irq_balance_lock);
+	put_online_cpus();
+
+	tegra_periodic_work_schedule(&irq_balance_work,
+		msecs_to_jiffies(interval_ms));
+}
+
+/* Move the lines we placed on @dying before migrate_irqs() breaks them */
+static void irq_balance_evacuate(int dying)
+{
+	unsigned int irq;
+
+	mutex_lock(&irq_balance_lock);
+	for (irq = INT_PRI_BASE; irq < INT_GIC_NR; irq++) {
+		struct irq_balance_stat *st = &irq_stats[irq];
+		unsigned int cpu;
+
+		if (st->cpu != dying || st->pinned)
+			continue;
+		cpu = least_busy_cpu(dying);
+		irq_move(irq, st, cpu);
+		cpu_load[dying] -= min(cpu_load[dying], st->load);
+		cpu_load[cpu] += st->load;
+	}
+	mutex_unlock(&irq_balance_lock);
+}
+
+static int irq_balance_cpu_notify(struct notifier_block *nb,
+	unsigned long action, void *hcpu)
+{
+	unsigned int cpu = (unsigned long)hcpu;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_DOWN_PREPARE:
+		irq_balance_evacuate(cpu);
+		break;
+	case CPU_ONLINE:
+		/* spread onto the new cpu soon, not a whole interval later */
+		if (cancel_delayed_work(&irq_balance_work.dwork))
+			tegra_periodic_work_schedule(&irq_balance_work,
+				msecs_to_jiffies(100));
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block irq_balance_cpu_nb = {
+	.notifier_call = irq_balance_cpu_notify,
+};
+
+static int __init tegra_irq_balance_init(void)
+{
+	unsigned int irq;
+
+	for (irq = 0; irq < INT_GIC_NR; irq++)
+		irq_stats[irq].cpu = -1;
+	last_sample = local_clock();
+
+	tegra_periodic_work_init(&irq_balance_work, "irq_balance",
+		irq_balance_work_func, 100);
+	register_hotcpu_notifier(&irq_balance_cpu_nb);
+	tegra_periodic_work_schedule(&irq_balance_work,
+		msecs_to_jiffies(interval_ms));
+	return 0;
+}
+late_initcall(tegra_irq_balance_init);
+
+#ifdef CONFIG_DEBUG_FS
+
+static int irq_balance_show(struct seq_file *s, void *data)
+{
+	unsigned int cpu, irq;
+
+	mutex_lock(&irq_balance_lock);
+	for_each_online_cpu(cpu)
+		seq_printf(s, "cpu%u %8u us/s\n", cpu, cpu_load[cpu]);
+
+	seq_printf(s, "\n%4s %4s %10s %12s %8s %6s %7s  %s\n", "irq", "cpu",
+		   "count", "total_us", "us/s", "moves", "state", "name");
+	for (irq = INT_PRI_BASE; irq < INT_GIC_NR; irq++) {
+		struct irq_desc *desc = irq_to_desc(irq);
+		struct irq_balance_stat *st = &irq_stats[irq];
+		struct irqaction *action;
+		unsigned long flags;
+		const char *state;
+
+		if (!desc)
+			continue;
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		action = desc->action;
+		if (!action)
+			goto unlock;
+		if (irqd_is_per_cpu(&desc->irq_data) ||
+		    !irqd_can_balance(&desc->irq_data))
+			state = "fixed";
+		else if (st->pinned)
+			state = "pinned";
+		else
+			state = "auto";
+
+		seq_printf(s, "%4u %4u %10u %12llu %8u %6u %7s  %s\n", irq,
+			   irq_current_cpu(desc), kstat_irqs(irq),
+			   div_u64(st->total_ns, NSEC_PER_USEC), st->load,
+			   st->moves, state, action->name);
+unlock:
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+	}
+	mutex_unlock(&irq_balance_lock);
+	return 0;
+}
+
+static int irq_balance_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_balance_show, inode->i_private);
+}
+
+static const struct file_operations irq_balance_fops = {
+	.open		= irq_balance_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init tegra_irq_balance_debug_init(void)
+{
+	if (!debugfs_create_file("tegra_irq_balance", S_IRUGO, NULL,
+				 NULL, &irq_balance_fops))
+		return -ENOMEM;
+	return 0;
+}
+late_initcall(tegra_irq_balance_debug_init);
+
+#endif
@@ -18,6 +18,9 @@
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/debugfs.h>
+#include <linux/jiffies.h>
+#include <linux/module.h>
+#include <linux/workqueue.h>
 #include <linux/seq_file.h>
 #include <linux/err.h>
 #include <linux/spinlock_types.h>
@@ -222,6 +225,12 @@ struct la_scaling_info {
 	int scaling_ref_count;
 	int actual_la_to_set;
 	int la_set;
+	/* display feedback, see la_scale_display() */
+	int fb_pct;
+	unsigned long fb_last;
+	unsigned long fb_underflows;
+	unsigned long fb_tightened;
+	unsigned long fb_relaxed;
 };
 
 struct la_scaling_reg_info {
@@ -374,6 +383,119 @@ static void set_vi_latency_thresholds(enum tegra_la_id id)
 	set_thresholds(&vi_info[id - ID(VI_WSB)], id);
 }
 
+/*
+ * Feedback mode for the display clients.
+ *
+ * Without it, display clients are given a third of the LA computed from
+ * their bandwidth (Bug 862709). That is more than needed most of the time
+ * and still not always enough under heavy GPU load. With la_feedback set,
+ * a display client starts from the computed value. Each underflow the
+ * display controller reports through tegra_latency_allowance_underflow()
+ * takes la_fb_step percent off it, down to la_fb_min percent. After
+ * la_fb_relax_ms without an underflow, la_fb_step percent is given back,
+ * up to the computed value.
+ */
+static bool la_feedback = true;
+module_param(la_feedback, bool, 0644);
+
+static int la_fb_step = 20;
+module_param(la_fb_step, int, 0644);
+
+static int la_fb_min = 20;
+module_param(la_fb_min, int, 0644);
+
+static unsigned int la_fb_relax_ms = 2000;
+module_param(la_fb_relax_ms, uint, 0644);
+
+static void la_fb_relax(struct work_struct *work);
+static DECLARE_DELAYED_WORK(la_fb_work, la_fb_relax);
+
+static inline bool la_is_display(enum tegra_la_id id)
+{
+	return id >= ID(DISPLAY_0A) && id <= ID(DISPLAY_HCB);
+}
+
+static int la_scale_display(enum tegra_la_id id, int la)
+{
+	if (!la_is_display(id))
+		return la;
+	if (!la_feedback)
+		return la / 3;
+	return la * scaling_info[id].fb_pct / 100;
+}
+
+/* Must be called with safety_lock held */
+static void la_write(enum tegra_la_id id, int la_to_set)
+{
+	struct la_client_info *ci = &la_info[id];
+	unsigned long reg_read;
+	unsigned long reg_write;
+
+	reg_read = readl(ci->reg_addr);
+	reg_write = (reg_read & ~ci->mask) |
+			(la_to_set << ci->shift);
+	writel(reg_write, ci->reg_addr);
+	scaling_info[id].la_set = la_to_set;
+	la_debug("reg_addr=0x%x, read=0x%x, write=0x%x",
+		(u32)ci->reg_addr, (u32)reg_read, (u32)reg_write);
+
+	/* scaling thresholds are relative to the programmed value */
+	if (scaling_info[id].scaling_ref_count &&
+	    id >= ID(DISPLAY_0A) && id <= ID(DISPLAY_1BB))
+		set_disp_latency_thresholds(id);
+}
+
+/* Called by the display controller when @id ran out of data */
+void tegra_latency_allowance_underflow(enum tegra_la_id id)
+{
+	struct la_scaling_info *si;
+
+	if (id >= TEGRA_LA_MAX_ID || !la_is_display(id))
+		return;
+	si = &scaling_info[id];
+
+	spin_lock(&safety_lock);
+	si->fb_underflows++;
+	si->fb_last = jiffies;
+	if (la_feedback && si->fb_pct > la_fb_min) {
+		si->fb_pct = max(si->fb_pct - la_fb_step, la_fb_min);
+		si->fb_tightened++;
+		la_write(id, la_scale_display(id, si->actual_la_to_set));
+	}
+	spin_unlock(&safety_lock);
+
+	if (la_feedback)
+		schedule_delayed_work(&la_fb_work,
+				      msecs_to_jiffies(la_fb_relax_ms));
+}
+
+static void la_fb_relax(struct work_struct *work)
+{
+	unsigned long quiet = msecs_to_jiffies(la_fb_relax_ms);
+	bool pending = false;
+	enum tegra_la_id id;
+
+	spin_lock(&safety_lock);
+	for (id = ID(DISPLAY_0A); id <= ID(DISPLAY_HCB); id++) {
+		struct la_scaling_info *si = &scaling_info[id];
+
+		if (si->fb_pct >= 100)
+			continue;
+		if (la_feedback && time_after(jiffies, si->fb_last + quiet)) {
+			si->fb_pct = min(si->fb_pct + la_fb_step, 100);
+			si->fb_relaxed++;
+			si->fb_last = jiffies;
+			la_write(id, la_scale_display(id, si->actual_la_to_set));
+		}
+		if (si->fb_pct < 100)
+			pending = true;
+	}
+	spin_unlock(&safety_lock);
+
+	if (pending && la_feedback)
+		schedule_delayed_work(&la_fb_work, quiet);
+}
+
 /* Sets latency allowance based on clients memory bandwitdh requirement.
  * Bandwidth passed is in mega bytes per second.
  */
@@ -382,8 +504,6 @@ int tegra_set_latency_allowance(enum tegra_la_id id,
 {
 	int ideal_la;
 	int la_to_set;
-	unsigned long reg_read;
-	unsigned long reg_write;
 	int bytes_per_atom = normal_atom_size;
 	struct la_client_info *ci;
 
@@ -407,21 +527,13 @@ int tegra_set_latency_allowance(enum tegra_la_id id,
 		__func__, id, bandwidth_in_mbps, la_to_set);
 	la_to_set = (la_to_set < 0) ? 0 : la_to_set;
 	la_to_set = (la_to_set > MC_LA_MAX_VALUE) ? MC_LA_MAX_VALUE : la_to_set;
+
+	spin_lock(&safety_lock);
 	scaling_info[id].actual_la_to_set = la_to_set;
 
 	/* until display can use latency allowance scaling, use a more
-	 * aggressive LA setting. Bug 862709 */
-	if (id >= ID(DISPLAY_0A) && id <= ID(DISPLAY_HCB))
-		la_to_set /= 3;
-
-	spin_lock(&safety_lock);
-	reg_read = readl(ci->reg_addr);
-	reg_write = (reg_read & ~ci->mask) |
-			(la_to_set << ci->shift);
-	writel(reg_write, ci->reg_addr);
-	scaling_info[id].la_set = la_to_set;
-	la_debug("reg_addr=0x%x, read=0x%x, write=0x%x",
-		(u32)ci->reg_addr, (u32)reg_read, (u32)reg_write);
+	 * aggressive LA setting, or the one found by feedback. Bug 862709 */
+	la_write(id, la_scale_display(id, la_to_set));
 	spin_unlock(&safety_lock);
 	return 0;
 }
@@ -525,6 +637,38 @@ static const struct file_operations regs_fops = {
 	.release        = single_release,
 };
 
+static int la_feedback_show(struct seq_file *s, void *unused)
+{
+	enum tegra_la_id id;
+
+	seq_printf(s, "%-16s %8s %6s %5s %10s %9s %8s\n", "client",
+		   "computed", "set", "pct", "underflows", "tightened",
+		   "relaxed");
+	spin_lock(&safety_lock);
+	for (id = ID(DISPLAY_0A); id <= ID(DISPLAY_HCB); id++) {
+		struct la_scaling_info *si = &scaling_info[id];
+
+		seq_printf(s, "%-16s %8d %6d %5d %10lu %9lu %8lu\n",
+			   la_info[id].name, si->actual_la_to_set, si->la_set,
+			   si->fb_pct, si->fb_underflows, si->fb_tightened,
+			   si->fb_relaxed);
+	}
+	spin_unlock(&safety_lock);
+	return 0;
+}
+
+static int dbg_la_feedback_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, la_feedback_show, inode->i_private);
+}
+
+static const struct file_operations feedback_fops = {
+	.open           = dbg_la_feedback_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
 static int __init tegra_latency_allowance_debugfs_init(void)
 {
 	if (latency_debug_dir)
@@ -534,6 +678,8 @@ static int __init tegra_latency_allowance_debugfs_init(void)
 
 	debugfs_create_file("la_info", S_IRUGO, latency_debug_dir, NULL,
 		&regs_fops);
+	debugfs_create_file("la_feedback", S_IRUGO, latency_debug_dir, NULL,
+		&feedback_fops);
 
 	return 0;
 }
@@ -542,7 +688,11 @@ late_initcall(tegra_latency_allowance_debugfs_init);
 
 static int __init tegra_latency_allowance_init(void)
 {
+	enum tegra_la_id id;
+
 	la_scaling_enable_count = 0;
+	for (id = 0; id < TEGRA_LA_MAX_ID; id++)
+		scaling_info[id].fb_pct = 100;
 
 	tegra_set_latency_allowance(TEGRA_LA_G2PR, 20);
 	tegra_set_latency_allowance(TEGRA_LA_G2SR, 20);
@@ -0,0 +1,171 @@
+/*
+ * arch/arm/mach-tegra/periodic-work.c
+ *
+ * Deferrable, coalesced delayed work for periodic housekeeping.
+ *
+ * Polling work pinned to cpu0 with a plain timer pulls that cpu out of
+ * LP2 on every period even when nothing else is going on.  Users of
+ * struct tegra_periodic_work get a deferrable timer, which waits for the
+ * cpu to wake up for something else, and state how late they can stand
+ * to run; the expiry is rounded within that slack to a coarse jiffy
+ * boundary where it can share a wakeup with other timers.
+ *
+ * timer_stats attributes every delayed work to queue_delayed_work_on(),
+ * so the runs are accounted here per user instead: how often each one
+ * ran and how late, which is what to look at before choosing the next
+ * waker to go after.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/bitops.h>
+#include <linux/jiffies.h>
+#include <linux/mutex.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "periodic-work.h"
+
+static LIST_HEAD(periodic_works);
+static DEFINE_MUTEX(periodic_works_lock);
+
+static void tegra_periodic_work_fn(struct work_struct *work)
+{
+	struct tegra_periodic_work *pw = container_of(to_delayed_work(work),
+					struct tegra_periodic_work, dwork);
+	unsigned long late = 0;
+
+	if (time_after(jiffies, pw->due))
+		late = jiffies - pw->due;
+	pw->runs++;
+	pw->late_jiffies += late;
+	if (late > pw->max_late_jiffies)
+		pw->max_late_jiffies = late;
+	if (late > pw->slack)
+		pw->late++;
+
+	pw->func(work);
+}
+
+void tegra_periodic_work_init(struct tegra_periodic_work *pw,
+	const char *name, work_func_t func, unsigned int slack_ms)
+{
+	INIT_DELAYED_WORK_DEFERRABLE(&pw->dwork, tegra_periodic_work_fn);
+	pw->func = func;
+	pw->name = name;
+	pw->slack = msecs_to_jiffies(slack_ms);
+
+	mutex_lock(&periodic_works_lock);
+	list_add_tail(&pw->node, &periodic_works);
+	mutex_unlock(&periodic_works_lock);
+}
+
+/*
+ * Round the expiry up to the coarsest jiffy boundary within the slack,
+ * the way mod_timer() does for timers with slack set.  That is done here
+ * because add_timer_on(), used for work bound to a cpu, skips it.
+ */
+static unsigned long tegra_periodic_work_delay(struct tegra_periodic_work *pw,
+	unsigned long delay)
+{
+	unsigned long expires = jiffies + delay;
+	unsigned long limit = expires + pw->slack;
+	unsigned long mask = expires ^ limit;
+
+	if (!mask)
+		return delay;
+	mask = (1UL << __fls(mask)) - 1;
+	return (limit & ~mask) - (expires - delay);
+}
+
+int tegra_periodic_work_schedule_on(int cpu, struct tegra_periodic_work *pw,
+	unsigned long delay)
+{
+	if (delayed_work_pending(&pw->dwork))
+		return 0;
+
+	pw->due = jiffies + delay;
+	pw->site = __builtin_return_address(0);
+	if (delay)
+		delay = tegra_periodic_work_delay(pw, delay);
+	if (cpu < 0)
+		return schedule_delayed_work(&pw->dwork, delay);
+	return schedule_delayed_work_on(cpu, &pw->dwork, delay);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static unsigned long periodic_stats_start;
+
+static int periodic_work_show(struct seq_file *s, void *data)
+{
+	struct tegra_periodic_work *pw;
+	unsigned int secs;
+
+	secs = jiffies_to_msecs(jiffies - periodic_stats_start) / 1000;
+	seq_printf(s, "%-24s %6s %8s %6s %8s %8s %8s  %s\n", "work",
+		   "slack", "runs", "late", "avg_late", "max_late",
+		   "runs/min", "scheduled from");
+	mutex_lock(&periodic_works_lock);
+	list_for_each_entry(pw, &periodic_works, node) {
+		seq_printf(s, "%-24s %6u %8u %6u %8u %8u %8u  %pS\n",
+			   pw->name, jiffies_to_msecs(pw->slack), pw->runs,
+			   pw->late, pw->runs ? jiffies_to_msecs(
+				   pw->late_jiffies / pw->runs) : 0,
+			   jiffies_to_msecs(pw->max_late_jiffies),
+			   secs ? pw->runs * 60 / secs : 0, pw->site);
+	}
+	mutex_unlock(&periodic_works_lock);
+	seq_printf(s, "(times in ms, over the last %u s)\n", secs);
+	return 0;
+}
+
+static int periodic_work_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, periodic_work_show, inode->i_private);
+}
+
+static ssize_t periodic_work_write(struct file *file,
+	const char __user *userbuf, size_t count, loff_t *ppos)
+{
+	struct tegra_periodic_work *pw;
+
+	mutex_lock(&periodic_works_lock);
+	list_for_each_entry(pw, &periodic_works, node) {
+		pw->runs = 0;
+		pw->late = 0;
+		pw->late_jiffies = 0;
+		pw->max_late_jiffies = 0;
+	}
+	periodic_stats_start = jiffies;
+	mutex_unlock(&periodic_works_lock);
+	return count;
+}
+
+static const struct file_operations periodic_work_fops = {
+	.open		= periodic_work_open,
+	.read		= seq_read,
+	.write		= periodic_work_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init tegra_periodic_work_debugfs_init(void)
+{
+	periodic_stats_start = jiffies;
+	if (!debugfs_create_file("tegra_periodic_work", 0644, NULL, NULL,
+				 &periodic_work_fops))
+		return -ENOMEM;
+	return 0;
+}
+late_initcall(tegra_periodic_work_debugfs_init);
+#endif
@@ -0,0 +1,54 @@
+/*
+ * arch/arm/mach-tegra/periodic-work.h
+ *
+ * Deferrable, coalesced delayed work for periodic housekeeping.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef __MACH_TEGRA_PERIODIC_WORK_H
+#define __MACH_TEGRA_PERIODIC_WORK_H
+
+#include <linux/list.h>
+#include <linux/workqueue.h>
+
+/*
+ * The timer is deferrable, so an idle cpu is not woken for it, and each
+ * expiry is rounded up by at most slack_ms so that it lines up with
+ * other timers.  Every run is accounted against the time it was due;
+ * the results are in debugfs tegra_periodic_work.
+ */
+struct tegra_periodic_work {
+	struct delayed_work dwork;
+	work_func_t func;
+	const char *name;
+	unsigned long slack;		/* jiffies */
+	unsigned long due;
+	void *site;			/* last caller to schedule it */
+	unsigned int runs;
+	unsigned int late;		/* runs past due + slack */
+	unsigned long late_jiffies;
+	unsigned long max_late_jiffies;
+	struct list_head node;
+};
+
+void tegra_periodic_work_init(struct tegra_periodic_work *pw,
+	const char *name, work_func_t func, unsigned int slack_ms);
+int tegra_periodic_work_schedule_on(int cpu, struct tegra_periodic_work *pw,
+	unsigned long delay);
+
+static inline int tegra_periodic_work_schedule(struct tegra_periodic_work *pw,
+	unsigned long delay)
+{
+	return tegra_periodic_work_schedule_on(-1, pw, delay);
+}
+
+#endif
@@ -30,6 +30,7 @@
 
 #include "pm.h"
 #include "clock.h"
+#include "hotplug-latency.h"
 #include "reset.h"
 #include "sleep.h"
 
@@ -178,6 +179,8 @@ void __cpuinit platform_secondary_init(unsigned int cpu)
 {
 	gic_secondary_init(0);
 
+	tegra_hp_latency_mark(cpu, TEGRA_HP_UP_RESET);
+
 	cpumask_set_cpu(cpu, to_cpumask(tegra_cpu_init_bits));
 	if (!tegra_all_cpus_booted)
 		if (cpumask_equal(tegra_cpu_init_mask, cpu_present_mask))
@@ -188,6 +191,8 @@ int boot_secondary(unsigned int cpu, struct task_struct *idle)
 {
 	int status;
 
+	tegra_hp_latency_mark(cpu, TEGRA_HP_UP_PREPARE);
+
 	/* Avoid timer calibration on slave cpus. Use the value calibrated
 	 * on master cpu. This reduces the bringup time for each slave cpu
 	 * by around 260ms.
@@ -236,6 +241,8 @@ int boot_secondary(unsigned int cpu, struct task_struct *idle)
 	if (status)
 		goto done;
 
+	tegra_hp_latency_mark(cpu, TEGRA_HP_UP_UNGATE);
+
 	/* Take the CPU out of reset. */
 	writel(CPU_RESET(cpu), CLK_RST_CONTROLLER_RST_CPU_CMPLX_CLR);
 	wmb();
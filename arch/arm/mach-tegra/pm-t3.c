@@ -27,6 +27,9 @@
 #include <linux/device.h>
 #include <linux/module.h>
 #include <linux/clockchips.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <mach/gpio.h>
 #include <mach/iomap.h>
@@ -101,6 +104,36 @@
 #define CPU_CLOCK(cpu)	(0x1<<(8+cpu))
 #define CPU_RESET(cpu)	(0x1111ul<<(cpu))
 
+#define CLUSTER_SWITCH_HIST	16	/* log2(us) bins, up to ~32ms */
+#define GIC_TARGET_WORDS	(1024 / 4)
+
+/*
+ * Fast switch: the G cluster interrupt targets are saved on the way to
+ * LP and written back as they were, instead of being rebuilt from the
+ * irq descriptors; and the wait for the G rail to have been off long
+ * enough is taken after the cpu context save and cache flush rather
+ * than in front of them.  debugfs cluster_switch/fast turns it off, for
+ * comparison.
+ */
+u32 tegra_cluster_fast_switch = 1;
+
+static u32 gic_target_shadow[GIC_TARGET_WORDS];
+static bool gic_target_saved;
+
+/* earliest time the G rail may be powered again, 0 if no wait pending */
+static ktime_t g_rail_ready;
+
+struct cluster_switch_stats {
+	unsigned long count;
+	u64 total_us;
+	u64 max_us;
+	u64 rail_wait_us;	/* spent spinning for the rail off time */
+	unsigned long hist[CLUSTER_SWITCH_HIST];
+};
+
+/* [0] is G=>LP, [1] is LP=>G */
+static struct cluster_switch_stats cluster_stats[2];
+
 static int cluster_switch_prolog_clock(unsigned int flags)
 {
 	u32 reg;
@@ -188,6 +221,28 @@ static int cluster_switch_prolog_clock(unsigned int flags)
 	return 0;
 }
 
+/*
+ * Called on G, with only cpu0 online, right before switching to LP.  The
+ * targets cannot meaningfully change while on LP: cpu0 is the only cpu
+ * there, and it is already in every word saved here.
+ */
+static void cluster_switch_prolog_gic(void)
+{
+	unsigned int max_irq, i;
+	void __iomem *gic_base = IO_ADDRESS(TEGRA_ARM_INT_DIST_BASE);
+
+	gic_target_saved = false;
+	if (!tegra_cluster_fast_switch)
+		return;
+
+	max_irq = readl(gic_base + GIC_DIST_CTR) & 0x1f;
+	max_irq = (max_irq + 1) * 32;
+
+	for (i = 32; i < max_irq; i += 4)
+		gic_target_shadow[i / 4] = readl(gic_base + GIC_DIST_TARGET + i);
+	gic_target_saved = true;
+}
+
 void tegra_cluster_switch_prolog(unsigned int flags)
 {
 	unsigned int target_cluster = flags & TEGRA_POWER_CLUSTER_MASK;
@@ -222,6 +277,9 @@ void tegra_cluster_switch_prolog(unsigned int flags)
 
 			/* Set up the flow controller to switch CPUs. */
 			reg |= FLOW_CTRL_CPU_CSR_SWITCH_CLUSTER;
+
+			if (current_cluster == TEGRA_POWER_CLUSTER_G)
+				cluster_switch_prolog_gic();
 		}
 	}
 
@@ -265,6 +323,14 @@ static void cluster_switch_epilog_gic(void)
 	max_irq = readl(gic_base + GIC_DIST_CTR) & 0x1f;
 	max_irq = (max_irq + 1) * 32;
 
+	if (gic_target_saved) {
+		gic_target_saved = false;
+		for (i = 32; i < max_irq; i += 4)
+			writel(gic_target_shadow[i / 4],
+			       gic_base + GIC_DIST_TARGET + i);
+		return;
+	}
+
 	for (i = 32; i < max_irq; i += 4) {
 		u32 val = 0x01010101;
 #ifdef CONFIG_GIC_SET_MULTIPLE_CPUS
@@ -315,9 +381,43 @@ void tegra_cluster_switch_epilog(unsigned int flags)
 	#endif
 }
 
+static void cluster_switch_account(bool to_g, ktime_t start, s64 wait_us)
+{
+	struct cluster_switch_stats *st = &cluster_stats[to_g];
+	s64 us = ktime_us_delta(ktime_get(), start);
+	int bucket = us > 0 ? fls64(us) : 0;
+
+	st->count++;
+	st->total_us += us;
+	st->max_us = max_t(u64, st->max_us, us);
+	st->rail_wait_us += wait_us;
+	st->hist[min(bucket, CLUSTER_SWITCH_HIST - 1)]++;
+}
+
+/*
+ * Called by the LP2 switch path with the context saved and caches
+ * flushed, right before the flow controller powers the G rail back up.
+ */
+void tegra_cluster_switch_wait(void)
+{
+	s64 us;
+
+	if (!g_rail_ready.tv64)
+		return;
+
+	us = ktime_us_delta(g_rail_ready, ktime_get());
+	g_rail_ready.tv64 = 0;
+	if (us > 0) {
+		udelay((unsigned int)us);
+		cluster_stats[1].rail_wait_us += us;
+	}
+}
+
 int tegra_cluster_control(unsigned int us, unsigned int flags)
 {
 	static ktime_t last_g2lp;
+	ktime_t start = ktime_set(0, 0);
+	s64 wait_us = 0;
 
 	unsigned int target_cluster = flags & TEGRA_POWER_CLUSTER_MASK;
 	unsigned int current_cluster = is_lp_cluster()
@@ -356,11 +456,22 @@ int tegra_cluster_control(unsigned int us, unsigned int flags)
 
 	if (current_cluster != target_cluster && !timekeeping_suspended) {
 		ktime_t now = ktime_get();
+
+		start = now;
 		if (target_cluster == TEGRA_POWER_CLUSTER_G) {
 			s64 t = ktime_to_us(ktime_sub(now, last_g2lp));
 			s64 t_off = tegra_cpu_power_off_time();
-			if (t_off > t)
-				udelay((unsigned int)(t_off - t));
+			if (t_off > t) {
+				/* LP1 switches go through tegra_suspend_dram */
+				if (tegra_cluster_fast_switch &&
+				    !(flags & TEGRA_POWER_SDRAM_SELFREFRESH)) {
+					g_rail_ready = ktime_add_us(now,
+								    t_off - t);
+				} else {
+					wait_us = t_off - t;
+					udelay((unsigned int)wait_us);
+				}
+			}
 
 			tegra_dvfs_rail_on(tegra_cpu_rail, now);
 
@@ -395,12 +506,79 @@ int tegra_cluster_control(unsigned int us, unsigned int flags)
 		cpu_pm_exit();
 		tegra_clear_cpu_in_lp2(0);
 	}
+	/* a switch that did not happen leaves no wait behind */
+	g_rail_ready.tv64 = 0;
+	if (start.tv64 && !timekeeping_suspended)
+		cluster_switch_account(target_cluster == TEGRA_POWER_CLUSTER_G,
+				       start, wait_us);
 	local_irq_restore(irq_flags);
 
 	DEBUG_CLUSTER(("%s: %s\r\n", __func__, is_lp_cluster() ? "LP" : "G"));
 
 	return 0;
 }
+
+#ifdef CONFIG_DEBUG_FS
+static int cluster_switch_stats_show(struct seq_file *s, void *data)
+{
+	static const char * const names[] = { "G=>LP", "LP=>G" };
+	int i, b;
+
+	seq_printf(s, "fast: %u\n", tegra_cluster_fast_switch);
+	for (i = 0; i < ARRAY_SIZE(cluster_stats); i++) {
+		struct cluster_switch_stats *st = &cluster_stats[i];
+
+		seq_printf(s, "%s: count %lu avg_us %llu max_us %llu "
+			   "rail_wait_us %llu\n", names[i], st->count,
+			   st->count ? div_u64(st->total_us, st->count) : 0,
+			   st->max_us, st->rail_wait_us);
+		for (b = 0; b < CLUSTER_SWITCH_HIST; b++)
+			if (st->hist[b])
+				seq_printf(s, "  <%6u us: %lu\n", 1U << b,
+					   st->hist[b]);
+	}
+	return 0;
+}
+
+static int cluster_switch_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cluster_switch_stats_show, inode->i_private);
+}
+
+static ssize_t cluster_switch_stats_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	memset(cluster_stats, 0, sizeof(cluster_stats));
+	return count;
+}
+
+static const struct file_operations cluster_switch_stats_fops = {
+	.open		= cluster_switch_stats_open,
+	.read		= seq_read,
+	.write		= cluster_switch_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init cluster_switch_debug_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("cluster_switch", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	if (!debugfs_create_bool("fast", S_IRUGO | S_IWUSR, dir,
+				 &tegra_cluster_fast_switch) ||
+	    !debugfs_create_file("stats", S_IRUGO | S_IWUSR, dir, NULL,
+				 &cluster_switch_stats_fops)) {
+		debugfs_remove_recursive(dir);
+		return -ENOMEM;
+	}
+	return 0;
+}
+late_initcall(cluster_switch_debug_init);
+#endif
 #endif
 
 #ifdef CONFIG_PM_SLEEP
@@ -264,12 +264,37 @@ static __init int create_suspend_pgtable(void)
 	return 0;
 }
 
+#define PMC_32K_SETTLE_US	130
+
 /* ensures that sufficient time is passed for a register write to
  * serialize into the 32KHz domain */
 static void pmc_32kwritel(u32 val, unsigned long offs)
 {
 	writel(val, pmc + offs);
-	udelay(130);
+	udelay(PMC_32K_SETTLE_US);
+}
+
+/*
+ * Posted flavour for the resume path: waits only for the previous posted
+ * write to serialize, so the caller can get on with other work while this
+ * one does.  pmc_32k_settle() waits for the last one.  TMRUS restarts
+ * across LP0, which at worst costs one needless wait.
+ */
+static u32 pmc_32k_stamp;
+
+static void pmc_32k_settle(void)
+{
+	void __iomem *tmrus = IO_ADDRESS(TEGRA_TMRUS_BASE);
+
+	while (readl(tmrus) - pmc_32k_stamp < PMC_32K_SETTLE_US)
+		cpu_relax();
+}
+
+static void pmc_32kwritel_posted(u32 val, unsigned long offs)
+{
+	pmc_32k_settle();
+	writel(val, pmc + offs);
+	pmc_32k_stamp = readl(IO_ADDRESS(TEGRA_TMRUS_BASE));
 }
 
 static void set_power_timers(unsigned long us_on, unsigned long us_off,
@@ -562,6 +587,10 @@ unsigned int tegra_idle_lp2_last(unsigned int sleep_time, unsigned int flags)
 			  __pa(pgd + PTRS_PER_PGD));
 	outer_disable();
 
+	/* the G rail off time has been running behind the context save */
+	if (flags & TEGRA_POWER_CLUSTER_MASK)
+		tegra_cluster_switch_wait();
+
 	tegra_sleep_cpu(PLAT_PHYS_OFFSET - PAGE_OFFSET);
 
 	tegra_init_cache(false);
@@ -718,6 +747,130 @@ static const char *lp_state[TEGRA_MAX_SUSPEND_MODE] = {
 	[TEGRA_SUSPEND_LP0] = "LP0",
 };
 
+/*
+ * TMRUS readings taken by tegra_suspend_dram() on its way down, just
+ * before the core goes to sleep, and at each stage of the wakeup.  RESUME
+ * is stored by tegra_resume when CPU0 re-enters the kernel.  The timer
+ * does not run across LP0, so only the two halves can be timed; after LP0
+ * RESUME itself is the time the boot ROM and warmboot code took.
+ */
+enum {
+	TEGRA_SUSPEND_TIME_ENTER,
+	TEGRA_SUSPEND_TIME_SLEEP,
+	TEGRA_SUSPEND_TIME_RESUME,
+	TEGRA_SUSPEND_TIME_WAKE,
+	TEGRA_SUSPEND_TIME_CACHE,
+	TEGRA_SUSPEND_TIME_MC,
+	TEGRA_SUSPEND_TIME_CPU,
+	TEGRA_SUSPEND_TIME_EXIT,
+	TEGRA_SUSPEND_TIME_MAX
+};
+
+static u32 tegra_suspend_times[TEGRA_SUSPEND_TIME_MAX];
+
+static inline void tegra_suspend_time(int id)
+{
+	tegra_suspend_times[id] = readl(IO_ADDRESS(TEGRA_TMRUS_BASE));
+}
+
+/* Per stage of the last LP0/LP1 wakeup and the worst seen, in us */
+static const char * const tegra_resume_stage_names[] = {
+	"bootrom",		/* LP0 only: power up to tegra_resume */
+	"cpu_resume",		/* tegra_resume to back in C */
+	"l2_cache",
+	"mc_reset_handler",
+	"cpu_complex",
+	"exit",
+};
+#define TEGRA_RESUME_STAGES	ARRAY_SIZE(tegra_resume_stage_names)
+
+static u32 tegra_resume_stage_last[TEGRA_RESUME_STAGES];
+static u32 tegra_resume_stage_max[TEGRA_RESUME_STAGES];
+static unsigned int tegra_resume_count;
+
+static void tegra_resume_stages_account(enum tegra_suspend_mode mode)
+{
+	u32 *t = tegra_suspend_times;
+	int i;
+
+	if (mode != TEGRA_SUSPEND_LP0 && mode != TEGRA_SUSPEND_LP1)
+		return;
+
+	/* TMRUS ran through LP1, so there is no boot ROM time to show */
+	t[TEGRA_SUSPEND_TIME_RESUME] = tegra_resume_tmrus;
+	tegra_resume_stage_last[0] = mode == TEGRA_SUSPEND_LP0 ?
+		t[TEGRA_SUSPEND_TIME_RESUME] : 0;
+	for (i = 1; i < TEGRA_RESUME_STAGES; i++)
+		tegra_resume_stage_last[i] =
+			t[TEGRA_SUSPEND_TIME_RESUME + i] -
+			t[TEGRA_SUSPEND_TIME_RESUME + i - 1];
+
+	for (i = 0; i < TEGRA_RESUME_STAGES; i++)
+		tegra_resume_stage_max[i] = max(tegra_resume_stage_max[i],
+						tegra_resume_stage_last[i]);
+	tegra_resume_count++;
+}
+
+/*
+ * Resume fast path: the PMC writes the wakeup needs are posted one at a
+ * time between the other restore steps, so their settle time in the
+ * 32KHz domain overlaps with bringing up the L2, MC and CPU clocks rather
+ * than being spun away in pmc_32kwritel().
+ */
+static u32 tegra_resume_fast = 1;
+
+struct tegra_resume_pmc_write {
+	u32 val;
+	unsigned long offs;
+};
+
+static struct tegra_resume_pmc_write tegra_resume_pmc[3];
+static int tegra_resume_pmc_nr;
+static int tegra_resume_pmc_done;
+
+static void tegra_resume_pmc_queue(enum tegra_suspend_mode mode,
+				   u32 scratch37)
+{
+	u32 reg;
+
+	tegra_resume_pmc_nr = 0;
+	tegra_resume_pmc_done = 0;
+
+	/* if scratch37 was clobbered during LP1, restore it */
+	if (scratch37 != 0xDEADBEEF) {
+		tegra_resume_pmc[tegra_resume_pmc_nr].val = scratch37;
+		tegra_resume_pmc[tegra_resume_pmc_nr++].offs = PMC_SCRATCH37;
+	}
+
+	/* see the combined_req case in tegra_suspend_dram() */
+	if (mode == TEGRA_SUSPEND_LP0 && pdata->combined_req) {
+		reg = readl(pmc + PMC_CTRL);
+		reg |= TEGRA_POWER_CPU_PWRREQ_OE;
+		tegra_resume_pmc[tegra_resume_pmc_nr].val = reg;
+		tegra_resume_pmc[tegra_resume_pmc_nr++].offs = PMC_CTRL;
+		reg &= ~TEGRA_POWER_PWRREQ_OE;
+		tegra_resume_pmc[tegra_resume_pmc_nr].val = reg;
+		tegra_resume_pmc[tegra_resume_pmc_nr++].offs = PMC_CTRL;
+	}
+}
+
+static void tegra_resume_pmc_post(void)
+{
+	struct tegra_resume_pmc_write *w;
+
+	if (tegra_resume_pmc_done < tegra_resume_pmc_nr) {
+		w = &tegra_resume_pmc[tegra_resume_pmc_done++];
+		pmc_32kwritel_posted(w->val, w->offs);
+	}
+}
+
+static void tegra_resume_pmc_flush(void)
+{
+	while (tegra_resume_pmc_done < tegra_resume_pmc_nr)
+		tegra_resume_pmc_post();
+	pmc_32k_settle();
+}
+
 static int tegra_suspend_enter(suspend_state_t state)
 {
 	int ret;
@@ -735,6 +888,13 @@ static int tegra_suspend_enter(suspend_state_t state)
 		goto abort_suspend;
 	}
 
+	suspend_time_phase_us(SUSPEND_TIME_PLATFORM_ENTRY,
+			      tegra_suspend_times[TEGRA_SUSPEND_TIME_SLEEP] -
+			      tegra_suspend_times[TEGRA_SUSPEND_TIME_ENTER]);
+	suspend_time_phase_us(SUSPEND_TIME_PLATFORM_EXIT,
+			      tegra_suspend_times[TEGRA_SUSPEND_TIME_EXIT] -
+			      tegra_suspend_times[TEGRA_SUSPEND_TIME_WAKE]);
+
 	read_persistent_clock(&ts_exit);
 
 	if (timespec_compare(&ts_exit, &ts_entry) > 0) {
@@ -784,6 +944,7 @@ int tegra_suspend_dram(enum tegra_suspend_mode mode, unsigned int flags)
 {
 	int err = 0;
 	u32 scratch37 = 0xDEADBEEF;
+	bool fast = tegra_resume_fast;
 
 	if (WARN_ON(mode <= TEGRA_SUSPEND_NONE ||
 		mode >= TEGRA_MAX_SUSPEND_MODE)) {
@@ -791,6 +952,8 @@ int tegra_suspend_dram(enum tegra_suspend_mode mode, unsigned int flags)
 		goto fail;
 	}
 
+	tegra_suspend_time(TEGRA_SUSPEND_TIME_ENTER);
+
 	if (tegra_is_voice_call_active()) {
 		u32 reg;
 
@@ -844,30 +1007,50 @@ int tegra_suspend_dram(enum tegra_suspend_mode mode, unsigned int flags)
 	outer_flush_all();
 	outer_disable();
 
+	tegra_suspend_time(TEGRA_SUSPEND_TIME_SLEEP);
+
 	if (mode == TEGRA_SUSPEND_LP2)
 		tegra_sleep_cpu(PLAT_PHYS_OFFSET - PAGE_OFFSET);
 	else
 		tegra_sleep_core(mode, PLAT_PHYS_OFFSET - PAGE_OFFSET);
 
+	tegra_suspend_time(TEGRA_SUSPEND_TIME_WAKE);
+
+	if (fast) {
+		tegra_resume_pmc_queue(mode, scratch37);
+		tegra_resume_pmc_post();
+	}
+
 	tegra_init_cache(true);
 
+	tegra_suspend_time(TEGRA_SUSPEND_TIME_CACHE);
+
 	if (mode == TEGRA_SUSPEND_LP0) {
 		tegra_cpu_reset_handler_restore();
 		tegra_lp0_resume_mc();
 	} else if (mode == TEGRA_SUSPEND_LP1)
 		*iram_cpu_lp1_mask = 0;
 
-	/* if scratch37 was clobbered during LP1, restore it */
-	if (scratch37 != 0xDEADBEEF)
+	tegra_suspend_time(TEGRA_SUSPEND_TIME_MC);
+
+	if (fast) {
+		tegra_resume_pmc_post();
+	} else if (scratch37 != 0xDEADBEEF) {
+		/* if scratch37 was clobbered during LP1, restore it */
 		pmc_32kwritel(scratch37, PMC_SCRATCH37);
+	}
 
 	restore_cpu_complex(flags);
 
+	tegra_suspend_time(TEGRA_SUSPEND_TIME_CPU);
+
 	/* for platforms where the core & CPU power requests are
 	 * combined as a single request to the PMU, transition out
 	 * of LP0 state by temporarily enabling both requests
 	 */
-	if (mode == TEGRA_SUSPEND_LP0 && pdata->combined_req) {
+	if (fast) {
+		tegra_resume_pmc_post();
+	} else if (mode == TEGRA_SUSPEND_LP0 && pdata->combined_req) {
 		u32 reg;
 		reg = readl(pmc + PMC_CTRL);
 		reg |= TEGRA_POWER_CPU_PWRREQ_OE;
@@ -886,6 +1069,12 @@ int tegra_suspend_dram(enum tegra_suspend_mode mode, unsigned int flags)
 
 	tegra_common_resume();
 
+	if (fast)
+		tegra_resume_pmc_flush();
+
+	tegra_suspend_time(TEGRA_SUSPEND_TIME_EXIT);
+	tegra_resume_stages_account(mode);
+
 fail:
 	return err;
 }
@@ -1001,6 +1190,61 @@ static __init int tegra_pm_enter_syscore_init(void)
 	return 0;
 }
 subsys_initcall(tegra_pm_enter_syscore_init);
+
+#ifdef CONFIG_DEBUG_FS
+static int tegra_resume_stages_show(struct seq_file *s, void *data)
+{
+	int i;
+
+	seq_printf(s, "%u LP0/LP1 wakeups, fast path %s\n", tegra_resume_count,
+		   tegra_resume_fast ? "on" : "off");
+	seq_printf(s, "%-18s %8s %8s\n", "stage", "last us", "max us");
+	for (i = 0; i < TEGRA_RESUME_STAGES; i++)
+		seq_printf(s, "%-18s %8u %8u\n", tegra_resume_stage_names[i],
+			   tegra_resume_stage_last[i],
+			   tegra_resume_stage_max[i]);
+	return 0;
+}
+
+static int tegra_resume_stages_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tegra_resume_stages_show, inode->i_private);
+}
+
+static ssize_t tegra_resume_stages_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	memset(tegra_resume_stage_max, 0, sizeof(tegra_resume_stage_max));
+	return count;
+}
+
+static const struct file_operations tegra_resume_stages_fops = {
+	.open		= tegra_resume_stages_open,
+	.read		= seq_read,
+	.write		= tegra_resume_stages_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init tegra_resume_debug_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("tegra_resume", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	if (!debugfs_create_bool("fast", S_IRUGO | S_IWUSR, dir,
+				 &tegra_resume_fast) ||
+	    !debugfs_create_file("stages", S_IRUGO | S_IWUSR, dir, NULL,
+				 &tegra_resume_stages_fops)) {
+		debugfs_remove_recursive(dir);
+		return -ENOMEM;
+	}
+	return 0;
+}
+late_initcall(tegra_resume_debug_init);
+#endif
 #endif
 
 void __init tegra_init_suspend(struct tegra_suspend_platform_data *plat)
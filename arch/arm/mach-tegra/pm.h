@@ -131,9 +131,11 @@ static inline unsigned int is_lp_cluster(void)
 	reg = readl(FLOW_CTRL_CLUSTER_CONTROL);
 	return (reg & 1); /* 0 == G, 1 == LP*/
 }
+extern u32 tegra_cluster_fast_switch;
 int tegra_cluster_control(unsigned int us, unsigned int flags);
 void tegra_cluster_switch_prolog(unsigned int flags);
 void tegra_cluster_switch_epilog(unsigned int flags);
+void tegra_cluster_switch_wait(void);
 #else
 #define INSTRUMENT_CLUSTER_SWITCH 0	/* Must be zero for ARCH_TEGRA_2x_SOC */
 #define DEBUG_CLUSTER_SWITCH 0		/* Must be zero for ARCH_TEGRA_2x_SOC */
@@ -147,6 +149,7 @@ static inline int tegra_cluster_control(unsigned int us, unsigned int flags)
 }
 static inline void tegra_cluster_switch_prolog(unsigned int flags) {}
 static inline void tegra_cluster_switch_epilog(unsigned int flags) {}
+static inline void tegra_cluster_switch_wait(void) {}
 #endif
 
 #ifdef CONFIG_ARCH_TEGRA_2x_SOC
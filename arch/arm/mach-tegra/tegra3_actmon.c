@@ -516,6 +516,24 @@ static struct actmon_dev actmon_dev_emc = {
 	},
 };
 
+/*
+ * Average EMC utilization seen by the activity monitor, in percent of the
+ * current EMC clock, or -ENODEV while the monitor is not running.
+ */
+int tegra_actmon_emc_load(void)
+{
+	struct actmon_dev *dev = &actmon_dev_emc;
+	unsigned long flags;
+	int load = -ENODEV;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->state == ACTMON_ON && dev->cur_freq)
+		load = min(dev->avg_actv_freq * 100 / dev->cur_freq, 100UL);
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	return load;
+}
+
 /* AVP activity monitor: load sampling device:
  * activity counter is incremented on every actmon clock pulse while
  * AVP is not halted by flow controller; count_weight = 1.
@@ -28,6 +28,8 @@
 #include <linux/clk.h>
 #include <linux/cpufreq.h>
 #include <linux/syscore_ops.h>
+#include <linux/workqueue.h>
+#include <linux/seq_file.h>
 
 #include <asm/clkdev.h>
 
@@ -306,6 +308,8 @@
 
 static void tegra3_pllp_init_dependencies(unsigned long pllp_rate);
 static int tegra3_clk_shared_bus_update(struct clk *bus);
+static int tegra3_clk_emc_bus_update(struct clk *bus);
+static struct clk tegra_clk_emc;
 
 static unsigned long cpu_stay_on_backup_max;
 static struct clk *emc_bridge;
@@ -2606,7 +2610,7 @@ static struct clk_ops tegra_emc_clk_ops = {
 	.set_rate		= &tegra3_emc_clk_set_rate,
 	.round_rate		= &tegra3_emc_clk_round_rate,
 	.reset			= &tegra3_periph_clk_reset,
-	.shared_bus_update	= &tegra3_clk_shared_bus_update,
+	.shared_bus_update	= &tegra3_clk_emc_bus_update,
 };
 
 /* Clock doubler ops (non-atomic shared register access) */
@@ -3034,6 +3038,159 @@ static int tegra3_clk_shared_bus_update(struct clk *bus)
 	return shared_bus_set_rate(bus, rate, old_rate);
 };
 
+/*
+ * EMC governor.  Engine drivers (SHARED_HINT users) ask for a fixed EMC
+ * rate whenever they are busy, whatever memory traffic they generate.
+ * While the activity monitor is running these requests are trimmed to the
+ * rate it asks for plus emc_gov_headroom percent; bandwidth requests, the
+ * CPU frequency floor, actmon itself and all other floors are always met.
+ * Rate drops are held off until emc_gov_down_delay_ms after the last raise.
+ */
+static bool emc_gov_enable = true;
+module_param(emc_gov_enable, bool, 0644);
+
+static int emc_gov_headroom = 25;
+module_param(emc_gov_headroom, int, 0644);
+
+static int emc_gov_down_delay_ms = 100;
+module_param(emc_gov_down_delay_ms, int, 0644);
+
+/* the input that decided each rate change */
+enum {
+	EMC_GOV_BW,
+	EMC_GOV_FLOOR,
+	EMC_GOV_CPU,
+	EMC_GOV_ACTMON,
+	EMC_GOV_HINT,
+	EMC_GOV_CEILING,
+	EMC_GOV_INPUTS,
+};
+
+static struct {
+	unsigned long last_raise;
+	u64 decided_by[EMC_GOV_INPUTS];
+	u64 trimmed;
+	u64 held;
+} emc_gov;
+
+static void emc_gov_work_fn(struct work_struct *work)
+{
+	tegra_clk_shared_bus_update(&tegra_clk_emc);
+}
+static DECLARE_DELAYED_WORK(emc_gov_work, emc_gov_work_fn);
+
+static int tegra3_clk_emc_bus_update(struct clk *bus)
+{
+	struct clk *c;
+	unsigned long in[EMC_GOV_INPUTS] = { 0 };
+	unsigned long ceiling = bus->max_rate;
+	unsigned long old_rate, rate, hold;
+	bool actmon_on = false;
+	int i, input;
+	long r;
+
+	if (!emc_gov_enable)
+		return tegra3_clk_shared_bus_update(bus);
+	if (detach_shared_bus)
+		return 0;
+
+	in[EMC_GOV_FLOOR] = bus->min_rate;
+	list_for_each_entry(c, &bus->shared_bus_list,
+			u.shared_bus_user.node) {
+		unsigned long user_rate = c->u.shared_bus_user.rate;
+
+		if (!c->u.shared_bus_user.enabled)
+			continue;
+
+		switch (c->u.shared_bus_user.mode) {
+		case SHARED_BW:
+			in[EMC_GOV_BW] += user_rate;
+			break;
+		case SHARED_CEILING:
+			ceiling = min(user_rate, ceiling);
+			break;
+		case SHARED_HINT:
+			in[EMC_GOV_HINT] = max(user_rate, in[EMC_GOV_HINT]);
+			break;
+		default:
+			if (!strcmp(c->name, "cpu.emc")) {
+				i = EMC_GOV_CPU;
+			} else if (!strcmp(c->name, "mon.emc")) {
+				i = EMC_GOV_ACTMON;
+				actmon_on = true;
+			} else {
+				i = EMC_GOV_FLOOR;
+			}
+			in[i] = max(user_rate, in[i]);
+		}
+	}
+
+	/* without a measurement the requests are all there is to go by */
+	if (actmon_on) {
+		unsigned long trim = in[EMC_GOV_ACTMON] / 100 *
+			(100 + emc_gov_headroom);
+
+		if (in[EMC_GOV_HINT] > trim) {
+			in[EMC_GOV_HINT] = trim;
+			emc_gov.trimmed++;
+		}
+	}
+
+	rate = 0;
+	input = EMC_GOV_FLOOR;
+	for (i = 0; i < EMC_GOV_CEILING; i++) {
+		if (in[i] > rate) {
+			rate = in[i];
+			input = i;
+		}
+	}
+	if (rate > ceiling) {
+		rate = ceiling;
+		input = EMC_GOV_CEILING;
+	}
+
+	/* compare table rates, not requests */
+	r = bus->ops->round_rate(bus, rate);
+	if (r > 0)
+		rate = r;
+
+	old_rate = clk_get_rate_locked(bus);
+	if (rate == old_rate)
+		return 0;
+
+	if (rate > old_rate) {
+		emc_gov.last_raise = jiffies;
+	} else if (input != EMC_GOV_CEILING) {
+		hold = emc_gov.last_raise +
+			msecs_to_jiffies(emc_gov_down_delay_ms);
+		if (time_before(jiffies, hold)) {
+			emc_gov.held++;
+			schedule_delayed_work(&emc_gov_work, hold - jiffies);
+			return 0;
+		}
+	}
+
+	emc_gov.decided_by[input]++;
+	return shared_bus_set_rate(bus, rate, old_rate);
+}
+
+#ifdef CONFIG_DEBUG_FS
+void tegra_emc_gov_stats_show(struct seq_file *s)
+{
+	static const char * const names[EMC_GOV_INPUTS] = {
+		"bandwidth", "floor", "cpu", "actmon", "hint", "ceiling",
+	};
+	int i;
+
+	seq_printf(s, "%-15s %s\n", "governor:",
+		   emc_gov_enable ? "on" : "off");
+	for (i = 0; i < EMC_GOV_INPUTS; i++)
+		seq_printf(s, "%-15s %llu\n", names[i], emc_gov.decided_by[i]);
+	seq_printf(s, "%-15s %llu\n", "hints trimmed:", emc_gov.trimmed);
+	seq_printf(s, "%-15s %llu\n", "drops held:", emc_gov.held);
+}
+#endif
+
 static void tegra_clk_shared_bus_init(struct clk *c)
 {
 	c->max_rate = c->parent->max_rate;
@@ -4312,7 +4469,7 @@ struct clk tegra_list_clks[] = {
 	SHARED_CLK("sbc5.sclk", "spi_tegra.4",		"sclk", &tegra_clk_sbus_cmplx, NULL, 0, 0),
 	SHARED_CLK("sbc6.sclk", "spi_tegra.5",		"sclk", &tegra_clk_sbus_cmplx, NULL, 0, 0),
 
-	SHARED_CLK("avp.emc",	"tegra-avp",		"emc",	&tegra_clk_emc, NULL, 0, 0),
+	SHARED_CLK("avp.emc",	"tegra-avp",		"emc",	&tegra_clk_emc, NULL, 0, SHARED_HINT),
 	SHARED_CLK("cpu.emc",	"cpu",			"emc",	&tegra_clk_emc, NULL, 0, 0),
 	SHARED_CLK("disp1.emc",	"tegradc.0",		"emc",	&tegra_clk_emc, NULL, 0, SHARED_BW),
 	SHARED_CLK("disp1.min_emc",	"tegradc.0",	"min_emc",	&tegra_clk_emc, NULL, 0, 0),
@@ -4325,9 +4482,9 @@ struct clk tegra_list_clks[] = {
 	SHARED_CLK("usb3.emc",	"tegra-ehci.2",		"emc",	&tegra_clk_emc, NULL, 0, 0),
 	SHARED_CLK("mon.emc",	"tegra_actmon",		"emc",	&tegra_clk_emc, NULL, 0, 0),
 	SHARED_CLK("cap.emc",	"cap.emc",		NULL,	&tegra_clk_emc, NULL, 0, SHARED_CEILING),
-	SHARED_CLK("3d.emc",	"tegra_gr3d",		"emc",	&tegra_clk_emc, NULL, 0, 0),
-	SHARED_CLK("2d.emc",	"tegra_gr2d",		"emc",	&tegra_clk_emc, NULL, 0, 0),
-	SHARED_CLK("mpe.emc",	"tegra_mpe",		"emc",	&tegra_clk_emc, NULL, 0, 0),
+	SHARED_CLK("3d.emc",	"tegra_gr3d",		"emc",	&tegra_clk_emc, NULL, 0, SHARED_HINT),
+	SHARED_CLK("2d.emc",	"tegra_gr2d",		"emc",	&tegra_clk_emc, NULL, 0, SHARED_HINT),
+	SHARED_CLK("mpe.emc",	"tegra_mpe",		"emc",	&tegra_clk_emc, NULL, 0, SHARED_HINT),
 	SHARED_CLK("camera.emc", "tegra_camera",	"emc",	&tegra_clk_emc, NULL, 0, 0),
 	SHARED_CLK("floor.emc",	"floor.emc",		NULL,	&tegra_clk_emc, NULL, 0, 0),
 
@@ -0,0 +1,356 @@
+/*
+ * arch/arm/mach-tegra/tegra3_dvfs_margin.c
+ *
+ * Per-device vdd_cpu margin discovery and trimming for Tegra3.
+ *
+ * The cpu dvfs table is picked by speedo and process id, and must hold
+ * for the worst part of each bin. A better part can run each step at a
+ * lower voltage. This file steps the voltage of one cpu dvfs step down
+ * at a time, runs a checksummed load on every online core at that
+ * step's frequency, and keeps the lower voltage only if all checksums
+ * matched.
+ *
+ * A step that is too low may hang the system rather than fail a
+ * checksum. The tests are therefore driven one step at a time from user
+ * space, which records each step before it starts and stores the result
+ * when it returns. The stored trims are handed back at boot through the
+ * cpu_trim and cpu_trim_uid parameters; they are only applied on the
+ * chip they were found on.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/clk.h>
+#include <linux/cpu.h>
+#include <linux/delay.h>
+#include <linux/jiffies.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/pm_qos_params.h>
+#include <linux/power_supply.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+
+#include "clock.h"
+#include "cpu-tegra.h"
+#include "dvfs.h"
+#include "fuse.h"
+#include "pm.h"
+
+static int cpu_trim[MAX_DVFS_FREQS];
+static int cpu_trim_count;
+static char *cpu_trim_uid;
+module_param_array(cpu_trim, int, &cpu_trim_count, 0444);
+module_param(cpu_trim_uid, charp, 0444);
+
+static int margin_step_mv = 25;
+static int margin_max_mv = 75;
+static unsigned int margin_test_ms = 2000;
+static bool margin_need_charger = true;
+module_param(margin_step_mv, int, 0644);
+module_param(margin_max_mv, int, 0644);
+module_param(margin_test_ms, uint, 0644);
+module_param(margin_need_charger, bool, 0644);
+
+#define MARGIN_BUF_WORDS	4096	/* 16K, stays in L1 */
+
+static struct dvfs *cpu_dvfs;
+
+static int __init tegra3_dvfs_margin_init(void)
+{
+	struct clk *c = tegra_get_clock_by_name("cpu_g");
+	unsigned long long uid;
+	int i;
+
+	if (!c || !c->dvfs)
+		return -ENODEV;
+	cpu_dvfs = c->dvfs;
+
+	if (!cpu_trim_count)
+		return 0;
+
+	if (!cpu_trim_uid || kstrtoull(cpu_trim_uid, 16, &uid) ||
+	    (uid != tegra_chip_uid())) {
+		pr_warn("tegra3_dvfs_margin: cpu trims are for another chip,"
+			" ignored\n");
+		return 0;
+	}
+
+	for (i = 0; i < cpu_trim_count; i++) {
+		if (!cpu_trim[i])
+			continue;
+		if (tegra_dvfs_set_trim(cpu_dvfs, i, cpu_trim[i]))
+			pr_warn("tegra3_dvfs_margin: invalid trim %d mV at"
+				" step %d\n", cpu_trim[i], i);
+	}
+	pr_info("tegra3_dvfs_margin: applied %d cpu dvfs trims\n",
+		cpu_trim_count);
+	return 0;
+}
+late_initcall(tegra3_dvfs_margin_init);
+
+#ifdef CONFIG_DEBUG_FS
+
+static DEFINE_MUTEX(margin_lock);
+static struct pm_qos_request_list margin_min_req;
+static struct pm_qos_request_list margin_max_req;
+static unsigned int margin_passed[MAX_DVFS_FREQS];
+static unsigned int margin_failed[MAX_DVFS_FREQS];
+
+struct margin_worker {
+	u32 expect;
+	unsigned long end;
+	unsigned int loops;
+	unsigned int errors;
+	struct completion done;
+};
+
+/* Deterministic integer and load/store mix; same result every pass */
+static u32 margin_stress_pass(u32 *buf)
+{
+	u32 x = 0x2545f491;
+	u32 sum = 0;
+	int i, r;
+
+	for (i = 0; i < MARGIN_BUF_WORDS; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		buf[i] = x;
+	}
+
+	for (r = 0; r < 4; r++) {
+		for (i = 0; i < MARGIN_BUF_WORDS; i++) {
+			u32 v = buf[(i * 7 + r) & (MARGIN_BUF_WORDS - 1)];
+
+			sum = (sum * 31 + buf[i] * v) ^ (sum >> 7);
+			buf[i] = v + sum;
+		}
+	}
+	return sum;
+}
+
+static int margin_stress_thread(void *data)
+{
+	struct margin_worker *w = data;
+	u32 *buf = kmalloc(MARGIN_BUF_WORDS * sizeof(u32), GFP_KERNEL);
+
+	if (!buf) {
+		w->errors = UINT_MAX;
+		goto out;
+	}
+
+	do {
+		if (margin_stress_pass(buf) != w->expect)
+			w->errors++;
+		w->loops++;
+		cond_resched();
+	} while (time_before(jiffies, w->end));
+
+	kfree(buf);
+out:
+	complete(&w->done);
+	return 0;
+}
+
+/* Run the load on every online cpu; returns the number of bad passes */
+static unsigned int margin_stress_run(u32 expect, unsigned int ms)
+{
+	struct margin_worker w[CONFIG_NR_CPUS];
+	unsigned long end = jiffies + msecs_to_jiffies(ms);
+	unsigned int cpu, errors = 0;
+	bool started[CONFIG_NR_CPUS] = { };
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		struct task_struct *t;
+
+		w[cpu].expect = expect;
+		w[cpu].end = end;
+		w[cpu].loops = 0;
+		w[cpu].errors = 0;
+		init_completion(&w[cpu].done);
+
+		t = kthread_create(margin_stress_thread, &w[cpu],
+				   "dvfs_margin/%u", cpu);
+		if (IS_ERR(t)) {
+			errors++;
+			continue;
+		}
+		kthread_bind(t, cpu);
+		wake_up_process(t);
+		started[cpu] = true;
+	}
+	put_online_cpus();
+
+	for (cpu = 0; cpu < CONFIG_NR_CPUS; cpu++) {
+		if (!started[cpu])
+			continue;
+		wait_for_completion(&w[cpu].done);
+		errors += w[cpu].errors;
+	}
+	return errors;
+}
+
+/*
+ * Test one more margin_step_mv of trim at dvfs step @index. On success
+ * the lower voltage stays in effect; on a checksum error the previous
+ * trim is restored and -EIO is returned.
+ */
+static int margin_test_step(int index)
+{
+	unsigned long rate, low;
+	int old_trim, new_trim, ret;
+	u32 expect;
+	u32 *buf;
+
+	if (!cpu_dvfs || (index < 0) || (index >= cpu_dvfs->num_freqs))
+		return -EINVAL;
+	if (margin_need_charger && (power_supply_is_system_supplied() <= 0))
+		return -EBUSY;
+
+	old_trim = cpu_dvfs->millivolts_trim[index];
+	new_trim = old_trim + margin_step_mv;
+	if ((margin_step_mv <= 0) || (new_trim > margin_max_mv) ||
+	    (new_trim > MAX_DVFS_TRIM_MV) ||
+	    (cpu_dvfs->millivolts[index] - new_trim <
+	     cpu_dvfs->dvfs_rail->min_millivolts))
+		return -ENOSPC;
+
+	/* reference checksum, at the voltage already known to be good */
+	buf = kmalloc(MARGIN_BUF_WORDS * sizeof(u32), GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	expect = margin_stress_pass(buf);
+	kfree(buf);
+
+	rate = cpu_dvfs->freqs[index];
+	low = index ? cpu_dvfs->freqs[index - 1] : 0;
+	pm_qos_update_request(&margin_min_req, rate / 1000);
+	pm_qos_update_request(&margin_max_req, rate / 1000);
+	msleep(20);
+
+	/* the cpufreq table may have no rate that lands on this step */
+	if (is_lp_cluster() || (tegra_getspeed(0) * 1000 <= low) ||
+	    (tegra_getspeed(0) * 1000 > rate)) {
+		ret = -ERANGE;
+		goto out;
+	}
+
+	ret = tegra_dvfs_set_trim(cpu_dvfs, index, new_trim);
+	if (ret)
+		goto out;
+
+	pr_info("tegra3_dvfs_margin: testing %lu MHz at %d mV\n",
+		rate / 1000000, cpu_dvfs->millivolts[index] - new_trim);
+
+	if (margin_stress_run(expect, margin_test_ms)) {
+		tegra_dvfs_set_trim(cpu_dvfs, index, old_trim);
+		margin_failed[index]++;
+		ret = -EIO;
+	} else {
+		margin_passed[index]++;
+	}
+
+out:
+	pm_qos_update_request(&margin_max_req, PM_QOS_DEFAULT_VALUE);
+	pm_qos_update_request(&margin_min_req, PM_QOS_DEFAULT_VALUE);
+	return ret;
+}
+
+static int margin_show(struct seq_file *s, void *data)
+{
+	int i;
+
+	if (!cpu_dvfs)
+		return 0;
+
+	seq_printf(s, "uid %016llx cpu speedo %d process %d\n",
+		   tegra_chip_uid(), tegra_cpu_speedo_id(),
+		   tegra_cpu_process_id());
+	seq_printf(s, "%-5s %8s %8s %8s %8s %8s\n", "step", "MHz",
+		   "table mV", "trim mV", "passed", "failed");
+
+	mutex_lock(&margin_lock);
+	for (i = 0; i < cpu_dvfs->num_freqs; i++) {
+		seq_printf(s, "%-5d %8lu %8d %8d %8u %8u\n", i,
+			   cpu_dvfs->freqs[i] / 1000000,
+			   cpu_dvfs->millivolts[i],
+			   cpu_dvfs->millivolts_trim[i],
+			   margin_passed[i], margin_failed[i]);
+	}
+	mutex_unlock(&margin_lock);
+	return 0;
+}
+
+static int margin_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, margin_show, inode->i_private);
+}
+
+/*
+ * "test <step>" runs one more step down at <step>.
+ * "set <step> <mV>" sets a trim directly, e.g. to back off after a hang.
+ */
+static ssize_t margin_write(struct file *file, const char __user *userbuf,
+			    size_t count, loff_t *ppos)
+{
+	char buf[32];
+	int index, mv, ret;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, userbuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	mutex_lock(&margin_lock);
+	if (sscanf(buf, "test %d", &index) == 1)
+		ret = margin_test_step(index);
+	else if (sscanf(buf, "set %d %d", &index, &mv) == 2)
+		ret = cpu_dvfs ? tegra_dvfs_set_trim(cpu_dvfs, index, mv) :
+			-ENODEV;
+	else
+		ret = -EINVAL;
+	mutex_unlock(&margin_lock);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations margin_fops = {
+	.open		= margin_open,
+	.read		= seq_read,
+	.write		= margin_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init tegra3_dvfs_margin_debug_init(void)
+{
+	pm_qos_add_request(&margin_min_req, PM_QOS_CPU_FREQ_MIN,
+			   PM_QOS_DEFAULT_VALUE);
+	pm_qos_add_request(&margin_max_req, PM_QOS_CPU_FREQ_MAX,
+			   PM_QOS_DEFAULT_VALUE);
+
+	if (!debugfs_create_file("cpu_dvfs_margin", S_IRUGO | S_IWUSR, NULL,
+				 NULL, &margin_fops))
+		return -ENOMEM;
+	return 0;
+}
+late_initcall(tegra3_dvfs_margin_debug_init);
+
+#endif
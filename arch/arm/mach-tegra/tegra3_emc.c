@@ -28,6 +28,7 @@
 #include <linux/suspend.h>
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
+#include <linux/ktime.h>
 
 #include <asm/cputime.h>
 #include <asm/cacheflush.h>
@@ -205,6 +206,7 @@ static struct clk *bridge;
 
 static struct {
 	cputime64_t time_at_clock[TEGRA_EMC_TABLE_MAX_SIZE];
+	u64 entries[TEGRA_EMC_TABLE_MAX_SIZE];
 	int last_sel;
 	u64 last_update;
 	u64 clkchange_count;
@@ -213,6 +215,22 @@ static struct {
 
 static DEFINE_SPINLOCK(emc_access_lock);
 
+/*
+ * Burst registers written on a switch between two table entries: the ones
+ * whose value differs, plus the ones emc_set_clock() or the over-temp code
+ * also write outside of the table values.  The shadow registers hold the
+ * previous entry, so the rest need not be rewritten.
+ */
+static unsigned long emc_burst_delta[TEGRA_EMC_TABLE_MAX_SIZE]
+	[TEGRA_EMC_TABLE_MAX_SIZE][BITS_TO_LONGS(TEGRA_EMC_NUM_REGS)];
+
+/* switch latency, per (from, to) pair of table entries */
+static struct {
+	u32 count;
+	u32 max_ns;
+	u64 total_ns;
+} emc_switch_stats[TEGRA_EMC_TABLE_MAX_SIZE][TEGRA_EMC_TABLE_MAX_SIZE];
+
 static void __iomem *emc_base = IO_ADDRESS(TEGRA_EMC_BASE);
 static void __iomem *mc_base = IO_ADDRESS(TEGRA_MC_BASE);
 static void __iomem *clk_base = IO_ADDRESS(TEGRA_CLK_RESET_BASE);
@@ -252,6 +270,7 @@ static void emc_last_stats_update(int last_sel)
 
 	if (last_sel < TEGRA_EMC_TABLE_MAX_SIZE) {
 		emc_stats.clkchange_count++;
+		emc_stats.entries[last_sel]++;
 		emc_stats.last_sel = last_sel;
 	}
 	spin_unlock_irqrestore(&emc_stats.spinlock, flags);
@@ -506,7 +525,7 @@ static inline void do_clock_change(u32 clk_setting)
 
 static noinline void emc_set_clock(const struct tegra_emc_table *next_timing,
 				   const struct tegra_emc_table *last_timing,
-				   u32 clk_setting)
+				   const unsigned long *delta, u32 clk_setting)
 {
 	int i, dll_change, pre_wait;
 	bool dyn_sref_enabled, vref_cal_toggle, qrst_used, zcal_long;
@@ -558,11 +577,19 @@ static noinline void emc_set_clock(const struct tegra_emc_table *next_timing,
 	if (vref_cal_toggle)
 		auto_cal_disable();
 
-	/* 4. program burst shadow registers */
-	for (i = 0; i < emc_num_burst_regs; i++) {
-		if (!burst_reg_addr[i])
-			continue;
-		__raw_writel(next_timing->burst_regs[i], burst_reg_addr[i]);
+	/* 4. program burst shadow registers, only the changed ones if the
+	   shadow registers are known to hold last_timing */
+	if (delta) {
+		for_each_set_bit(i, delta, emc_num_burst_regs)
+			__raw_writel(next_timing->burst_regs[i],
+				     burst_reg_addr[i]);
+	} else {
+		for (i = 0; i < emc_num_burst_regs; i++) {
+			if (!burst_reg_addr[i])
+				continue;
+			__raw_writel(next_timing->burst_regs[i],
+				     burst_reg_addr[i]);
+		}
 	}
 	if ((dram_type == DRAM_TYPE_LPDDR2) &&
 	    (dram_over_temp_state != DRAM_OVER_TEMP_NONE))
@@ -710,10 +737,13 @@ static inline void emc_cfg_power_restore(void)
  * multiple frequency changes */
 int tegra_emc_set_rate(unsigned long rate)
 {
-	int i;
+	int i, last = -1;
 	u32 clk_setting;
 	const struct tegra_emc_table *last_timing;
+	const unsigned long *delta = NULL;
 	unsigned long flags;
+	ktime_t start;
+	u32 ns;
 
 	if (!tegra_emc_table)
 		return -EINVAL;
@@ -738,16 +768,27 @@ int tegra_emc_set_rate(unsigned long rate)
 		emc_get_timing(&start_timing);
 		last_timing = &start_timing;
 	}
-	else
+	else {
 		last_timing = emc_timing;
+		last = emc_timing - tegra_emc_table;
+		delta = emc_burst_delta[last][i];
+	}
 
 	clk_setting = tegra_emc_clk_sel[i].value;
 
 	spin_lock_irqsave(&emc_access_lock, flags);
-	emc_set_clock(&tegra_emc_table[i], last_timing, clk_setting);
+	start = ktime_get();
+	emc_set_clock(&tegra_emc_table[i], last_timing, delta, clk_setting);
 	if (!emc_timing)
 		emc_cfg_power_restore();
 	emc_timing = &tegra_emc_table[i];
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (last >= 0) {
+		emc_switch_stats[last][i].count++;
+		emc_switch_stats[last][i].total_ns += ns;
+		emc_switch_stats[last][i].max_ns =
+			max(emc_switch_stats[last][i].max_ns, ns);
+	}
 	spin_unlock_irqrestore(&emc_access_lock, flags);
 
 	emc_last_stats_update(i);
@@ -935,6 +976,28 @@ static struct notifier_block tegra_emc_resume_nb = {
 	.priority = -1,
 };
 
+static void emc_init_burst_delta(void)
+{
+	int from, to, i;
+
+	for (from = 0; from < tegra_emc_table_size; from++) {
+		for (to = 0; to < tegra_emc_table_size; to++) {
+			unsigned long *delta = emc_burst_delta[from][to];
+			const u32 *a = tegra_emc_table[from].burst_regs;
+			const u32 *b = tegra_emc_table[to].burst_regs;
+
+			for (i = 0; i < emc_num_burst_regs; i++) {
+				if (burst_reg_addr[i] && a[i] != b[i])
+					set_bit(i, delta);
+			}
+			set_bit(EMC_REFRESH_INDEX, delta);
+			set_bit(EMC_PRE_REFRESH_REQ_CNT_INDEX, delta);
+			set_bit(EMC_DYN_SELF_REF_CONTROL_INDEX, delta);
+			set_bit(EMC_MRS_WAIT_CNT_INDEX, delta);
+		}
+	}
+}
+
 void tegra_init_emc(const struct tegra_emc_table *table, int table_size)
 {
 	int i, mv;
@@ -1043,6 +1106,8 @@ void tegra_init_emc(const struct tegra_emc_table *table, int table_size)
 	}
 	pr_info("tegra: validated EMC DFS table\n");
 
+	emc_init_burst_delta();
+
 	/* Configure clock change mode according to dram type */
 	reg = emc_readl(EMC_CFG_2) & (~EMC_CFG_2_MODE_MASK);
 	reg |= ((dram_type == DRAM_TYPE_LPDDR2) ? EMC_CFG_2_PD_MODE :
@@ -1202,18 +1267,21 @@ static int emc_stats_show(struct seq_file *s, void *data)
 
 	emc_last_stats_update(TEGRA_EMC_TABLE_MAX_SIZE);
 
-	seq_printf(s, "%-10s %-10s \n", "rate kHz", "time");
+	seq_printf(s, "%-10s %-10s %-10s \n", "rate kHz", "time", "entries");
 	for (i = 0; i < tegra_emc_table_size; i++) {
 		if (tegra_emc_clk_sel[i].input == NULL)
 			continue;	/* invalid entry */
 
-		seq_printf(s, "%-10lu %-10llu \n", tegra_emc_table[i].rate,
-			   cputime64_to_clock_t(emc_stats.time_at_clock[i]));
+		seq_printf(s, "%-10lu %-10llu %-10llu \n",
+			   tegra_emc_table[i].rate,
+			   cputime64_to_clock_t(emc_stats.time_at_clock[i]),
+			   emc_stats.entries[i]);
 	}
 	seq_printf(s, "%-15s %llu\n", "transitions:",
 		   emc_stats.clkchange_count);
 	seq_printf(s, "%-15s %llu\n", "time-stamp:",
 		   cputime64_to_clock_t(emc_stats.last_update));
+	tegra_emc_gov_stats_show(s);
 
 	return 0;
 }
@@ -1230,6 +1298,62 @@ static const struct file_operations emc_stats_fops = {
 	.release	= single_release,
 };
 
+static int emc_switch_latency_show(struct seq_file *s, void *data)
+{
+	int from, to;
+	unsigned long flags;
+
+	seq_printf(s, "%-10s %-10s %-8s %-8s %-8s %-5s\n", "from kHz",
+		   "to kHz", "count", "avg ns", "max ns", "regs");
+	for (from = 0; from < tegra_emc_table_size; from++) {
+		for (to = 0; to < tegra_emc_table_size; to++) {
+			u32 count, max_ns;
+			u64 total_ns;
+
+			spin_lock_irqsave(&emc_access_lock, flags);
+			count = emc_switch_stats[from][to].count;
+			max_ns = emc_switch_stats[from][to].max_ns;
+			total_ns = emc_switch_stats[from][to].total_ns;
+			spin_unlock_irqrestore(&emc_access_lock, flags);
+
+			if (!count)
+				continue;
+			seq_printf(s, "%-10lu %-10lu %-8u %-8llu %-8u %-5d\n",
+				   tegra_emc_table[from].rate,
+				   tegra_emc_table[to].rate, count,
+				   div_u64(total_ns, count), max_ns,
+				   bitmap_weight(emc_burst_delta[from][to],
+						 emc_num_burst_regs));
+		}
+	}
+	return 0;
+}
+
+static int emc_switch_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, emc_switch_latency_show, inode->i_private);
+}
+
+/* any write clears the table */
+static ssize_t emc_switch_latency_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&emc_access_lock, flags);
+	memset(emc_switch_stats, 0, sizeof(emc_switch_stats));
+	spin_unlock_irqrestore(&emc_access_lock, flags);
+	return count;
+}
+
+static const struct file_operations emc_switch_latency_fops = {
+	.open		= emc_switch_latency_open,
+	.read		= seq_read,
+	.write		= emc_switch_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int dram_temperature_get(void *data, u64 *val)
 {
 	*val = tegra_emc_get_dram_temperature();
@@ -1286,6 +1410,11 @@ static int __init tegra_emc_debug_init(void)
 		"stats", S_IRUGO, emc_debugfs_root, NULL, &emc_stats_fops))
 		goto err_out;
 
+	if (!debugfs_create_file("switch_latency", S_IRUGO | S_IWUSR,
+				 emc_debugfs_root, NULL,
+				 &emc_switch_latency_fops))
+		goto err_out;
+
 	if (!debugfs_create_file("dram_temperature", S_IRUGO, emc_debugfs_root,
 				 NULL, &dram_temperature_fops))
 		goto err_out;
@@ -60,6 +60,9 @@ int tegra_emc_get_dram_type(void);
 int tegra_emc_get_dram_temperature(void);
 int tegra_emc_set_over_temp_state(unsigned long state);
 
+struct seq_file;
+void tegra_emc_gov_stats_show(struct seq_file *s);
+
 #ifdef CONFIG_PM_SLEEP
 void tegra_mc_timing_restore(void);
 #else
@@ -0,0 +1,472 @@
+/*
+ * arch/arm/mach-tegra/tegra3_energy.c
+ *
+ * Estimated CPU energy per core and per process, from the cluster
+ * frequency, the vdd_cpu voltage, the online cores and LP2 residency.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/ktime.h>
+#include <linux/tick.h>
+#include <linux/sched.h>
+#include <linux/hash.h>
+#include <linux/percpu.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include <trace/events/sched.h>
+
+#include "cpu-tegra.h"
+#include "cpuidle.h"
+#include "dvfs.h"
+#include "pm.h"
+#include "tegra3_energy.h"
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/tegra_energy.h>
+
+/*
+ * Power model, per core:
+ *   busy:	cdyn_pf * V^2 * f + leak_ua * V
+ *   idle:	leak_ua * V (clock gated in WFI)
+ *   LP2:	0 (power gated)
+ *   offline:	0 (power gated)
+ * The defaults are rough figures for a typical part, not measurements.
+ */
+static unsigned int g_cdyn_pf = 300;
+static unsigned int g_leak_ua = 30000;
+static unsigned int lp_cdyn_pf = 130;
+static unsigned int lp_leak_ua = 3000;
+module_param(g_cdyn_pf, uint, 0644);
+module_param(g_leak_ua, uint, 0644);
+module_param(lp_cdyn_pf, uint, 0644);
+module_param(lp_leak_ua, uint, 0644);
+
+#define ENERGY_NR_CORES		(CONFIG_NR_CPUS + 1)	/* LP core last */
+#define ENERGY_TASK_BITS	7
+#define ENERGY_NR_TASKS		(1 << ENERGY_TASK_BITS)
+
+struct energy_core {
+	bool online;
+	u64 online_us;
+	u64 busy_us;
+	u64 gated_us;
+	u64 dyn_nj;
+	u64 leak_nj;
+	u64 last_lp2_us;
+};
+
+struct energy_task {
+	pid_t tgid;
+	char comm[TASK_COMM_LEN];
+	u64 nj;
+};
+
+static DEFINE_SPINLOCK(energy_lock);
+static bool energy_ready;
+static struct energy_core energy_cores[ENERGY_NR_CORES];
+static u64 energy_last_idle_us[CONFIG_NR_CPUS];
+static ktime_t energy_last_update;
+static unsigned int energy_khz;
+static int energy_mv;
+
+/* Busy power of the core each cpu runs on, read by the switch probe */
+static DEFINE_PER_CPU(unsigned long, energy_busy_uw);
+static DEFINE_PER_CPU(u64, energy_last_switch);
+
+static DEFINE_SPINLOCK(energy_task_lock);
+static struct energy_task energy_tasks[ENERGY_NR_TASKS];
+static u64 energy_task_other_nj;
+static bool energy_task_enabled;
+static DEFINE_MUTEX(energy_task_mutex);
+
+static inline bool core_is_lp(unsigned int core)
+{
+	return core == CONFIG_NR_CPUS;
+}
+
+static inline unsigned int core_to_cpu(unsigned int core)
+{
+	return core_is_lp(core) ? 0 : core;
+}
+
+static unsigned long dyn_uw(unsigned int core, unsigned int khz, int mv)
+{
+	u64 cdyn = core_is_lp(core) ? lp_cdyn_pf : g_cdyn_pf;
+
+	/* pF * mV^2 * kHz is in 1e-9 uW */
+	return (unsigned long)div_u64(cdyn * mv * mv * khz, 1000000000);
+}
+
+static unsigned long leak_uw(unsigned int core, int mv)
+{
+	unsigned long ua = core_is_lp(core) ? lp_leak_ua : g_leak_ua;
+
+	return ua * mv / 1000;
+}
+
+static u64 cpu_idle_us(unsigned int cpu)
+{
+	u64 idle = get_cpu_idle_time_us(cpu, NULL);
+
+	return idle == -1ULL ? 0 : idle;
+}
+
+/*
+ * Close the interval since the last update at the operating point that
+ * was current during it, then sample the new operating point. Must be
+ * called with energy_lock held.
+ */
+static void energy_update(void)
+{
+	u64 idle_delta[CONFIG_NR_CPUS];
+	ktime_t now = ktime_get();
+	u64 dt = ktime_to_us(ktime_sub(now, energy_last_update));
+	unsigned int core, cpu;
+
+	for (cpu = 0; cpu < CONFIG_NR_CPUS; cpu++) {
+		u64 idle = cpu_idle_us(cpu);
+
+		idle_delta[cpu] = min(idle - energy_last_idle_us[cpu], dt);
+		energy_last_idle_us[cpu] = idle;
+	}
+
+	for (core = 0; core < ENERGY_NR_CORES; core++) {
+		struct energy_core *ec = &energy_cores[core];
+		u64 lp2 = tegra3_cpu_idle_lp2_time(core_to_cpu(core),
+						   core_is_lp(core));
+		u64 idle, busy, gated, dyn, leak;
+
+		gated = lp2 - ec->last_lp2_us;
+		ec->last_lp2_us = lp2;
+		if (!ec->online)
+			continue;
+
+		idle = idle_delta[core_to_cpu(core)];
+		busy = dt - idle;
+		gated = min(gated, idle);
+
+		/* uW * us is in pJ */
+		dyn = div_u64(busy * dyn_uw(core, energy_khz, energy_mv),
+			      1000);
+		leak = div_u64((dt - gated) * leak_uw(core, energy_mv), 1000);
+
+		ec->online_us += dt;
+		ec->busy_us += busy;
+		ec->gated_us += gated;
+		ec->dyn_nj += dyn;
+		ec->leak_nj += leak;
+
+		trace_tegra_energy_interval(core, energy_khz, energy_mv,
+			(unsigned long)busy, (unsigned long)gated,
+			(unsigned long)div_u64(dyn, 1000),
+			(unsigned long)div_u64(leak, 1000));
+	}
+
+	energy_last_update = now;
+	energy_khz = tegra_getspeed(0);
+	energy_mv = tegra_cpu_rail ? tegra_cpu_rail->millivolts : 0;
+
+	for_each_possible_cpu(cpu) {
+		core = (cpu == 0 && is_lp_cluster()) ? CONFIG_NR_CPUS : cpu;
+		per_cpu(energy_busy_uw, cpu) =
+			dyn_uw(core, energy_khz, energy_mv) +
+			leak_uw(core, energy_mv);
+	}
+}
+
+void tegra_energy_hp_update(unsigned int cpu, bool up)
+{
+	unsigned long flags;
+
+	if (cpu >= ENERGY_NR_CORES)
+		return;
+
+	spin_lock_irqsave(&energy_lock, flags);
+	if (energy_ready) {
+		energy_update();
+		energy_cores[cpu].online = up;
+	}
+	spin_unlock_irqrestore(&energy_lock, flags);
+}
+
+static int energy_cpufreq_notify(struct notifier_block *nb,
+	unsigned long event, void *data)
+{
+	struct cpufreq_freqs *freqs = data;
+	unsigned long flags;
+
+	/* all cores share one clock, so one update per change is enough */
+	if (event != CPUFREQ_POSTCHANGE || freqs->cpu != 0)
+		return NOTIFY_OK;
+
+	spin_lock_irqsave(&energy_lock, flags);
+	if (energy_ready)
+		energy_update();
+	spin_unlock_irqrestore(&energy_lock, flags);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block energy_cpufreq_nb = {
+	.notifier_call = energy_cpufreq_notify,
+};
+
+/*
+ * Per-process accounting charges the time each task ran since the
+ * previous switch on its cpu at that core's busy power. Processes are
+ * keyed by tgid; once the table is full, the rest go to "other".
+ */
+static struct energy_task *energy_task_find(struct task_struct *p)
+{
+	unsigned int i, idx = hash_32(p->tgid, ENERGY_TASK_BITS);
+
+	for (i = 0; i < ENERGY_NR_TASKS; i++) {
+		struct energy_task *et = &energy_tasks[idx];
+
+		if (et->tgid == p->tgid)
+			return et;
+		if (!et->tgid) {
+			et->tgid = p->tgid;
+			memcpy(et->comm, p->group_leader->comm,
+			       TASK_COMM_LEN);
+			return et;
+		}
+		idx = (idx + 1) & (ENERGY_NR_TASKS - 1);
+	}
+	return NULL;
+}
+
+static void energy_probe_sched_switch(void *ignore,
+	struct task_struct *prev, struct task_struct *next)
+{
+	int cpu = smp_processor_id();
+	u64 now = sched_clock();
+	u64 delta = now - per_cpu(energy_last_switch, cpu);
+	struct energy_task *et;
+	u64 nj;
+
+	per_cpu(energy_last_switch, cpu) = now;
+	if (!prev->pid)
+		return;
+
+	/* uW * ns is in fJ */
+	nj = div_u64(delta * per_cpu(energy_busy_uw, cpu), NSEC_PER_MSEC);
+
+	spin_lock(&energy_task_lock);
+	et = energy_task_find(prev);
+	if (et)
+		et->nj += nj;
+	else
+		energy_task_other_nj += nj;
+	spin_unlock(&energy_task_lock);
+}
+
+static int energy_task_enable(bool enable)
+{
+	u64 now = sched_clock();
+	int cpu, ret = 0;
+
+	mutex_lock(&energy_task_mutex);
+	if (enable == energy_task_enabled)
+		goto out;
+
+	if (enable) {
+		for_each_possible_cpu(cpu)
+			per_cpu(energy_last_switch, cpu) = now;
+		ret = register_trace_sched_switch(energy_probe_sched_switch,
+						  NULL);
+	} else {
+		unregister_trace_sched_switch(energy_probe_sched_switch,
+					      NULL);
+		tracepoint_synchronize_unregister();
+	}
+	if (!ret)
+		energy_task_enabled = enable;
+out:
+	mutex_unlock(&energy_task_mutex);
+	return ret;
+}
+
+static int __init tegra_energy_init(void)
+{
+	unsigned long flags;
+	unsigned int cpu;
+
+	spin_lock_irqsave(&energy_lock, flags);
+	for (cpu = 0; cpu < CONFIG_NR_CPUS; cpu++) {
+		energy_last_idle_us[cpu] = cpu_idle_us(cpu);
+		energy_cores[cpu].online = !is_lp_cluster() && cpu_online(cpu);
+	}
+	energy_cores[CONFIG_NR_CPUS].online = is_lp_cluster();
+	energy_last_update = ktime_get();
+	energy_update();
+	energy_ready = true;
+	spin_unlock_irqrestore(&energy_lock, flags);
+
+	return cpufreq_register_notifier(&energy_cpufreq_nb,
+					 CPUFREQ_TRANSITION_NOTIFIER);
+}
+late_initcall(tegra_energy_init);
+
+#ifdef CONFIG_DEBUG_FS
+
+static int energy_cores_show(struct seq_file *s, void *data)
+{
+	struct energy_core snap[ENERGY_NR_CORES];
+	unsigned long flags;
+	u64 total = 0;
+	int core;
+
+	spin_lock_irqsave(&energy_lock, flags);
+	energy_update();
+	memcpy(snap, energy_cores, sizeof(snap));
+	spin_unlock_irqrestore(&energy_lock, flags);
+
+	seq_printf(s, "%-6s %10s %10s %10s %10s %10s\n", "core", "online ms",
+		   "busy ms", "lp2 ms", "dyn mJ", "leak mJ");
+	for (core = 0; core < ENERGY_NR_CORES; core++) {
+		if (core_is_lp(core))
+			seq_printf(s, "%-6s ", "lp");
+		else
+			seq_printf(s, "g%-5d ", core);
+		seq_printf(s, "%10llu %10llu %10llu %10llu %10llu\n",
+			   div_u64(snap[core].online_us, 1000),
+			   div_u64(snap[core].busy_us, 1000),
+			   div_u64(snap[core].gated_us, 1000),
+			   div_u64(snap[core].dyn_nj, 1000000),
+			   div_u64(snap[core].leak_nj, 1000000));
+		total += snap[core].dyn_nj + snap[core].leak_nj;
+	}
+	seq_printf(s, "total %llu mJ\n", div_u64(total, 1000000));
+	return 0;
+}
+
+static int energy_cores_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, energy_cores_show, inode->i_private);
+}
+
+static const struct file_operations energy_cores_fops = {
+	.open		= energy_cores_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int energy_tasks_show(struct seq_file *s, void *data)
+{
+	struct energy_task et;
+	u64 other;
+	int i;
+
+	seq_printf(s, "%-8s %-16s %10s\n", "tgid", "comm", "mJ");
+	for (i = 0; i < ENERGY_NR_TASKS; i++) {
+		spin_lock_irq(&energy_task_lock);
+		et = energy_tasks[i];
+		spin_unlock_irq(&energy_task_lock);
+		if (!et.tgid)
+			continue;
+		seq_printf(s, "%-8d %-16s %10llu\n", et.tgid, et.comm,
+			   div_u64(et.nj, 1000000));
+	}
+
+	spin_lock_irq(&energy_task_lock);
+	other = energy_task_other_nj;
+	spin_unlock_irq(&energy_task_lock);
+	seq_printf(s, "%-8s %-16s %10llu\n", "-", "other",
+		   div_u64(other, 1000000));
+	return 0;
+}
+
+static int energy_tasks_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, energy_tasks_show, inode->i_private);
+}
+
+static const struct file_operations energy_tasks_fops = {
+	.open		= energy_tasks_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int task_accounting_get(void *data, u64 *val)
+{
+	*val = energy_task_enabled;
+	return 0;
+}
+
+static int task_accounting_set(void *data, u64 val)
+{
+	return energy_task_enable(!!val);
+}
+DEFINE_SIMPLE_ATTRIBUTE(task_accounting_fops, task_accounting_get,
+			task_accounting_set, "%llu\n");
+
+static int reset_set(void *data, u64 val)
+{
+	unsigned long flags;
+	int core;
+
+	spin_lock_irqsave(&energy_lock, flags);
+	energy_update();
+	for (core = 0; core < ENERGY_NR_CORES; core++) {
+		struct energy_core *ec = &energy_cores[core];
+
+		ec->online_us = ec->busy_us = ec->gated_us = 0;
+		ec->dyn_nj = ec->leak_nj = 0;
+	}
+	spin_unlock_irqrestore(&energy_lock, flags);
+
+	spin_lock_irq(&energy_task_lock);
+	memset(energy_tasks, 0, sizeof(energy_tasks));
+	energy_task_other_nj = 0;
+	spin_unlock_irq(&energy_task_lock);
+	return 0;
+}
+DEFINE_SIMPLE_ATTRIBUTE(reset_fops, NULL, reset_set, "%llu\n");
+
+static int __init tegra_energy_debug_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("tegra_energy", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	if (!debugfs_create_file("cores", S_IRUGO, dir, NULL,
+				 &energy_cores_fops))
+		goto err_out;
+	if (!debugfs_create_file("tasks", S_IRUGO, dir, NULL,
+				 &energy_tasks_fops))
+		goto err_out;
+	if (!debugfs_create_file("task_accounting", S_IRUGO | S_IWUSR, dir,
+				 NULL, &task_accounting_fops))
+		goto err_out;
+	if (!debugfs_create_file("reset", S_IWUSR, dir, NULL, &reset_fops))
+		goto err_out;
+	return 0;
+
+err_out:
+	debugfs_remove_recursive(dir);
+	return -ENOMEM;
+}
+late_initcall(tegra_energy_debug_init);
+
+#endif
@@ -0,0 +1,31 @@
+/*
+ * arch/arm/mach-tegra/tegra3_energy.h
+ *
+ * CPU energy estimation for Tegra3.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef __MACH_TEGRA3_ENERGY_H
+#define __MACH_TEGRA3_ENERGY_H
+
+/*
+ * Called from the hotplug statistics whenever a core changes state.
+ * cpu == CONFIG_NR_CPUS is the LP core, as in the hotplug statistics.
+ */
+#ifdef CONFIG_TEGRA_ENERGY_MODEL
+void tegra_energy_hp_update(unsigned int cpu, bool up);
+#else
+static inline void tegra_energy_hp_update(unsigned int cpu, bool up)
+{ }
+#endif
+
+#endif
@@ -0,0 +1,395 @@
+/*
+ * arch/arm/mach-tegra/tegra3_mc_stats.c
+ *
+ * Per-client memory bandwidth sampled from the memory controller
+ * statistics counters, reported through debugfs and tracepoints.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/types.h>
+#include <linux/io.h>
+#include <linux/clk.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include <mach/iomap.h>
+
+#include "clock.h"
+#include "tegra2_mc.h"
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/tegra3_mc_stats.h>
+
+#define MC_STATS_PERIOD_MS	10
+#define MC_STATS_RING_SIZE	128
+
+/* bandwidth mode counts emc clocks spent moving the client's data */
+#ifdef CONFIG_TEGRA_EMC_TO_DDR_CLOCK
+#define MC_STATS_BYTES_PER_CLK	(8 / CONFIG_TEGRA_EMC_TO_DDR_CLOCK)
+#else
+#define MC_STATS_BYTES_PER_CLK	4
+#endif
+
+enum mc_stats_group {
+	MC_GRP_CPU,
+	MC_GRP_GPU,
+	MC_GRP_DISPLAY,
+	MC_GRP_VIDEO,
+	MC_GRP_CAMERA,
+	MC_GRP_AVP,
+	MC_GRP_NR,
+};
+
+static const char * const mc_group_names[MC_GRP_NR] = {
+	[MC_GRP_CPU]		= "cpu",
+	[MC_GRP_GPU]		= "gpu",
+	[MC_GRP_DISPLAY]	= "display",
+	[MC_GRP_VIDEO]		= "video",
+	[MC_GRP_CAMERA]		= "camera",
+	[MC_GRP_AVP]		= "avp",
+};
+
+struct mc_stats_client {
+	const char	*name;
+	u8		id;		/* Tegra3 MC client id */
+	u8		group;
+};
+
+#define MC_CLIENT(_name, _id, _grp) \
+	{ .name = _name, .id = _id, .group = MC_GRP_##_grp }
+
+static const struct mc_stats_client mc_clients[] = {
+	MC_CLIENT("mpcorer",	0x27, CPU),
+	MC_CLIENT("mpcorew",	0x39, CPU),
+	MC_CLIENT("mpcorelpr",	0x26, CPU),
+	MC_CLIENT("mpcorelpw",	0x38, CPU),
+	MC_CLIENT("fdcdrd",	0x12, GPU),
+	MC_CLIENT("fdcdrd2",	0x13, GPU),
+	MC_CLIENT("fdcdwr",	0x33, GPU),
+	MC_CLIENT("fdcdwr2",	0x34, GPU),
+	MC_CLIENT("idxsrd",	0x18, GPU),
+	MC_CLIENT("idxsrd2",	0x19, GPU),
+	MC_CLIENT("texsrd",	0x20, GPU),
+	MC_CLIENT("texsrd2",	0x21, GPU),
+	MC_CLIENT("g2pr",	0x0a, GPU),
+	MC_CLIENT("g2sr",	0x0b, GPU),
+	MC_CLIENT("g2dr",	0x14, GPU),
+	MC_CLIENT("g2dw",	0x30, GPU),
+	MC_CLIENT("display0a",	0x01, DISPLAY),
+	MC_CLIENT("display0ab",	0x02, DISPLAY),
+	MC_CLIENT("display0b",	0x03, DISPLAY),
+	MC_CLIENT("display0bb",	0x04, DISPLAY),
+	MC_CLIENT("display0c",	0x05, DISPLAY),
+	MC_CLIENT("display0cb",	0x06, DISPLAY),
+	MC_CLIENT("display1b",	0x07, DISPLAY),
+	MC_CLIENT("display1bb",	0x08, DISPLAY),
+	MC_CLIENT("displayhc",	0x10, DISPLAY),
+	MC_CLIENT("displayhcb",	0x11, DISPLAY),
+	MC_CLIENT("vdebsevr",	0x22, VIDEO),
+	MC_CLIENT("vdember",	0x23, VIDEO),
+	MC_CLIENT("vdemcer",	0x24, VIDEO),
+	MC_CLIENT("vdetper",	0x25, VIDEO),
+	MC_CLIENT("vdebsevw",	0x3e, VIDEO),
+	MC_CLIENT("vdembew",	0x40, VIDEO),
+	MC_CLIENT("vdetpmw",	0x41, VIDEO),
+	MC_CLIENT("mpeunifbr",	0x0c, VIDEO),
+	MC_CLIENT("mpeamemrd",	0x1b, VIDEO),
+	MC_CLIENT("mpecsrd",	0x1c, VIDEO),
+	MC_CLIENT("mpeunifbw",	0x2b, VIDEO),
+	MC_CLIENT("mpecswr",	0x3a, VIDEO),
+	MC_CLIENT("viruv",	0x0d, CAMERA),
+	MC_CLIENT("viwsb",	0x2c, CAMERA),
+	MC_CLIENT("viwu",	0x2d, CAMERA),
+	MC_CLIENT("viwv",	0x2e, CAMERA),
+	MC_CLIENT("viwy",	0x2f, CAMERA),
+	MC_CLIENT("ispw",	0x37, CAMERA),
+	MC_CLIENT("avpcarm7r",	0x0f, AVP),
+	MC_CLIENT("avpcarm7w",	0x32, AVP),
+};
+
+struct mc_stats_sample {
+	s64		time_ms;
+	unsigned long	emc_khz;
+	u32		mbps[MC_GRP_NR];
+};
+
+static void __iomem *mc_base = IO_ADDRESS(TEGRA_MC_BASE);
+static struct clk *emc_clk;
+
+static DEFINE_MUTEX(mc_stats_mutex);
+static DEFINE_SPINLOCK(mc_stats_lock);
+static bool mc_stats_enabled;
+static u32 mc_stats_period_ms = MC_STATS_PERIOD_MS;
+
+/* the counter watches one client at a time; this is the one */
+static unsigned int mc_cur;
+static ktime_t mc_window_start;
+static u32 mc_client_mbps[ARRAY_SIZE(mc_clients)];
+
+static struct mc_stats_sample mc_ring[MC_STATS_RING_SIZE];
+static unsigned int mc_ring_head;
+static unsigned int mc_ring_count;
+
+static void mc_stats_sample_work(struct work_struct *work);
+static DECLARE_DELAYED_WORK(mc_stats_work, mc_stats_sample_work);
+
+static void mc_stats_arm(const struct mc_stats_client *c)
+{
+	u32 reg;
+
+	writel(MC_STAT_CONTROL_0_EMC_GATHER_DISABLE <<
+	       MC_STAT_CONTROL_0_EMC_GATHER_SHIFT, mc_base + MC_STAT_CONTROL_0);
+
+	reg = (ARMC_STAT_CONTROL_MODE_BANDWIDTH <<
+			ARMC_STAT_CONTROL_MODE_SHIFT) |
+		(ARMC_STAT_CONTROL_EVENT_QUALIFIED <<
+			ARMC_STAT_CONTROL_EVENT_SHIFT) |
+		(ARMC_STAT_CONTROL_FILTER_PRI_DISABLE <<
+			ARMC_STAT_CONTROL_FILTER_PRI_SHIFT) |
+		(ARMC_STAT_CONTROL_FILTER_COALESCED_DISABLE <<
+			ARMC_STAT_CONTROL_FILTER_COALESCED_SHIFT) |
+		(ARMC_STAT_CONTROL_FILTER_CLIENT_ENABLE <<
+			ARMC_STAT_CONTROL_FILTER_CLIENT_SHIFT) |
+		(ARMC_STAT_CONTROL_FILTER_ADDR_DISABLE <<
+			ARMC_STAT_CONTROL_FILTER_ADDR_SHIFT) |
+		(c->id << ARMC_STAT_CONTROL_CLIENT_ID_SHIFT);
+
+	writel(0xFFFFFFFF, mc_base + MC_STAT_EMC_CLOCK_LIMIT_0);
+	writel(reg, mc_base + MC_STAT_EMC_CONTROL_0_0);
+
+	writel(MC_STAT_CONTROL_0_EMC_GATHER_CLEAR <<
+	       MC_STAT_CONTROL_0_EMC_GATHER_SHIFT, mc_base + MC_STAT_CONTROL_0);
+	writel(MC_STAT_CONTROL_0_EMC_GATHER_ENABLE <<
+	       MC_STAT_CONTROL_0_EMC_GATHER_SHIFT, mc_base + MC_STAT_CONTROL_0);
+
+	mc_window_start = ktime_get();
+}
+
+static void mc_stats_disarm(void)
+{
+	writel(MC_STAT_CONTROL_0_EMC_GATHER_DISABLE <<
+	       MC_STAT_CONTROL_0_EMC_GATHER_SHIFT, mc_base + MC_STAT_CONTROL_0);
+}
+
+/* Called with mc_stats_lock held once every client has been sampled */
+static void mc_stats_publish(ktime_t now, unsigned long emc_khz)
+{
+	struct mc_stats_sample *s = &mc_ring[mc_ring_head];
+	int i;
+
+	memset(s->mbps, 0, sizeof(s->mbps));
+	for (i = 0; i < ARRAY_SIZE(mc_clients); i++)
+		s->mbps[mc_clients[i].group] += mc_client_mbps[i];
+	s->time_ms = ktime_to_ms(now);
+	s->emc_khz = emc_khz;
+
+	mc_ring_head = (mc_ring_head + 1) % MC_STATS_RING_SIZE;
+	if (mc_ring_count < MC_STATS_RING_SIZE)
+		mc_ring_count++;
+
+	trace_mc_bandwidth(s->emc_khz, s->mbps[MC_GRP_CPU],
+			   s->mbps[MC_GRP_GPU], s->mbps[MC_GRP_DISPLAY],
+			   s->mbps[MC_GRP_VIDEO], s->mbps[MC_GRP_CAMERA],
+			   s->mbps[MC_GRP_AVP]);
+}
+
+static void mc_stats_sample_work(struct work_struct *work)
+{
+	unsigned long emc_khz;
+	ktime_t now;
+	s64 us;
+	u32 count;
+
+	mutex_lock(&mc_stats_mutex);
+	if (!mc_stats_enabled)
+		goto out;
+
+	mc_stats_disarm();
+	count = readl(mc_base + MC_STAT_EMC_COUNT_0_0);
+	now = ktime_get();
+	us = ktime_us_delta(now, mc_window_start);
+	emc_khz = emc_clk ? clk_get_rate(emc_clk) / 1000 : 0;
+
+	spin_lock(&mc_stats_lock);
+	/* bytes per microsecond is MB/s */
+	if (us > 0)
+		mc_client_mbps[mc_cur] =
+			div64_u64((u64)count * MC_STATS_BYTES_PER_CLK, us);
+	if (++mc_cur == ARRAY_SIZE(mc_clients)) {
+		mc_cur = 0;
+		mc_stats_publish(now, emc_khz);
+	}
+	spin_unlock(&mc_stats_lock);
+
+	mc_stats_arm(&mc_clients[mc_cur]);
+	queue_delayed_work(system_freezable_wq, &mc_stats_work,
+			   msecs_to_jiffies(max(mc_stats_period_ms, 1U)));
+out:
+	mutex_unlock(&mc_stats_mutex);
+}
+
+static int mc_stats_enable_get(void *data, u64 *val)
+{
+	*val = mc_stats_enabled;
+	return 0;
+}
+
+static int mc_stats_enable_set(void *data, u64 val)
+{
+	bool enable = !!val;
+
+	mutex_lock(&mc_stats_mutex);
+	if (enable == mc_stats_enabled) {
+		mutex_unlock(&mc_stats_mutex);
+		return 0;
+	}
+	mc_stats_enabled = enable;
+	if (enable) {
+		spin_lock(&mc_stats_lock);
+		mc_cur = 0;
+		memset(mc_client_mbps, 0, sizeof(mc_client_mbps));
+		mc_ring_head = 0;
+		mc_ring_count = 0;
+		spin_unlock(&mc_stats_lock);
+		mc_stats_arm(&mc_clients[0]);
+		queue_delayed_work(system_freezable_wq, &mc_stats_work,
+				   msecs_to_jiffies(max(mc_stats_period_ms, 1U)));
+	} else {
+		mc_stats_disarm();
+	}
+	mutex_unlock(&mc_stats_mutex);
+
+	/* the worker sees the flag under the mutex and stops requeueing */
+	if (!enable)
+		cancel_delayed_work_sync(&mc_stats_work);
+	return 0;
+}
+DEFINE_SIMPLE_ATTRIBUTE(mc_stats_enable_fops, mc_stats_enable_get,
+			mc_stats_enable_set, "%llu\n");
+
+static int mc_stats_bandwidth_show(struct seq_file *s, void *data)
+{
+	u32 mbps[MC_GRP_NR] = { 0 };
+	u32 client_mbps[ARRAY_SIZE(mc_clients)];
+	int i, g;
+
+	spin_lock(&mc_stats_lock);
+	memcpy(client_mbps, mc_client_mbps, sizeof(client_mbps));
+	spin_unlock(&mc_stats_lock);
+
+	for (i = 0; i < ARRAY_SIZE(mc_clients); i++)
+		mbps[mc_clients[i].group] += client_mbps[i];
+
+	seq_printf(s, "emc: %lu kHz, %s\n",
+		   emc_clk ? clk_get_rate(emc_clk) / 1000 : 0,
+		   mc_stats_enabled ? "sampling" : "stopped");
+	for (g = 0; g < MC_GRP_NR; g++) {
+		seq_printf(s, "%-8s %6u MB/s\n", mc_group_names[g], mbps[g]);
+		for (i = 0; i < ARRAY_SIZE(mc_clients); i++)
+			if (mc_clients[i].group == g && client_mbps[i])
+				seq_printf(s, "  %-12s %6u MB/s\n",
+					   mc_clients[i].name, client_mbps[i]);
+	}
+	return 0;
+}
+
+static int mc_stats_bandwidth_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mc_stats_bandwidth_show, inode->i_private);
+}
+
+static const struct file_operations mc_stats_bandwidth_fops = {
+	.open		= mc_stats_bandwidth_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int mc_stats_samples_show(struct seq_file *s, void *data)
+{
+	struct mc_stats_sample *ring;
+	unsigned int i, n, first;
+	int g;
+
+	ring = kmalloc(sizeof(mc_ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	spin_lock(&mc_stats_lock);
+	memcpy(ring, mc_ring, sizeof(mc_ring));
+	n = mc_ring_count;
+	first = (mc_ring_head + MC_STATS_RING_SIZE - n) % MC_STATS_RING_SIZE;
+	spin_unlock(&mc_stats_lock);
+
+	seq_printf(s, "%10s %8s", "time_ms", "emc_khz");
+	for (g = 0; g < MC_GRP_NR; g++)
+		seq_printf(s, " %7s", mc_group_names[g]);
+	seq_printf(s, "\n");
+
+	for (i = 0; i < n; i++) {
+		struct mc_stats_sample *smp =
+			&ring[(first + i) % MC_STATS_RING_SIZE];
+
+		seq_printf(s, "%10lld %8lu", smp->time_ms, smp->emc_khz);
+		for (g = 0; g < MC_GRP_NR; g++)
+			seq_printf(s, " %7u", smp->mbps[g]);
+		seq_printf(s, "\n");
+	}
+
+	kfree(ring);
+	return 0;
+}
+
+static int mc_stats_samples_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mc_stats_samples_show, inode->i_private);
+}
+
+static const struct file_operations mc_stats_samples_fops = {
+	.open		= mc_stats_samples_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init tegra3_mc_stats_init(void)
+{
+	struct dentry *dir;
+
+	emc_clk = tegra_get_clock_by_name("emc");
+
+	dir = debugfs_create_dir("tegra3_mc_stats", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	if (!debugfs_create_file("enable", S_IRUGO | S_IWUSR, dir, NULL,
+				 &mc_stats_enable_fops) ||
+	    !debugfs_create_u32("period_ms", S_IRUGO | S_IWUSR, dir,
+				&mc_stats_period_ms) ||
+	    !debugfs_create_file("bandwidth", S_IRUGO, dir, NULL,
+				 &mc_stats_bandwidth_fops) ||
+	    !debugfs_create_file("samples", S_IRUGO, dir, NULL,
+				 &mc_stats_samples_fops)) {
+		debugfs_remove_recursive(dir);
+		return -ENOMEM;
+	}
+	return 0;
+}
+late_initcall(tegra3_mc_stats_init);
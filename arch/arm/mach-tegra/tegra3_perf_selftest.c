@@ -0,0 +1,782 @@
+/*
+ * arch/arm/mach-tegra/tegra3_perf_selftest.c
+ *
+ * Microbenchmarks of the Tegra3 hot paths, run on demand from debugfs.
+ *
+ *   echo all > /sys/kernel/debug/tegra3_perf_selftest/run
+ *   cat /sys/kernel/debug/tegra3_perf_selftest/results
+ *
+ * Each result is one line of space separated key=value pairs so that runs
+ * on different kernels can be collected and compared by a script.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/clk.h>
+#include <linux/err.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+#include <linux/lzo.h>
+#include <linux/crypto.h>
+#include <linux/scatterlist.h>
+#include <linux/completion.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/delay.h>
+#include <linux/sched.h>
+#include <linux/perf_event.h>
+#include <linux/memcontrol.h>
+
+#include <mach/clk.h>
+
+#include "clock.h"
+#include "cpu-tegra.h"
+#include "pm.h"
+
+#define PERF_BUF_PAGES		16	/* 64kB working set for the copy tests */
+#define PERF_VMAP_PAGES		64	/* a 256kB binder buffer */
+#define PERF_AES_LEN		(PERF_BUF_PAGES * PAGE_SIZE)
+
+/* repetitions of each measured operation, debugfs "iterations" */
+static u32 perf_iterations = 100;
+
+struct perf_result {
+	const char *name;
+	int err;
+	unsigned int iters;
+	u64 total_ns;
+	u64 max_ns;
+	u64 bytes;		/* per iteration, 0 if not a throughput test */
+};
+
+struct perf_test {
+	const char *name;
+	int (*run)(struct perf_result *r);
+};
+
+static DEFINE_MUTEX(perf_lock);
+static struct page *perf_src[PERF_BUF_PAGES];
+static struct page *perf_dst[PERF_BUF_PAGES];
+
+static inline void perf_account(struct perf_result *r, ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	r->total_ns += ns;
+	r->max_ns = max(r->max_ns, ns);
+	r->iters++;
+}
+
+/*
+ * Sample page contents: one page of zeroes, text-like runs and
+ * pseudo-random data in turn, roughly what zram sees.  The generator is
+ * seeded the same way on every run so results stay comparable.
+ */
+static void perf_fill_pages(void)
+{
+	u32 seed = 0x5eed1234;
+	int i, j;
+
+	for (i = 0; i < PERF_BUF_PAGES; i++) {
+		u8 *p = page_address(perf_src[i]);
+
+		switch (i % 3) {
+		case 0:
+			memset(p, 0, PAGE_SIZE);
+			break;
+		case 1:
+			for (j = 0; j < PAGE_SIZE; j++)
+				p[j] = "android.perf.selftest "[j % 22];
+			break;
+		default:
+			for (j = 0; j < PAGE_SIZE; j++) {
+				seed = seed * 1664525 + 1013904223;
+				p[j] = seed >> 24;
+			}
+		}
+	}
+}
+
+static int perf_alloc_pages(void)
+{
+	int i;
+
+	for (i = 0; i < PERF_BUF_PAGES; i++) {
+		perf_src[i] = alloc_page(GFP_KERNEL);
+		perf_dst[i] = alloc_page(GFP_KERNEL);
+		if (!perf_src[i] || !perf_dst[i])
+			return -ENOMEM;
+	}
+	perf_fill_pages();
+	return 0;
+}
+
+static void perf_free_pages(void)
+{
+	int i;
+
+	for (i = 0; i < PERF_BUF_PAGES; i++) {
+		if (perf_src[i])
+			__free_page(perf_src[i]);
+		if (perf_dst[i])
+			__free_page(perf_dst[i]);
+		perf_src[i] = perf_dst[i] = NULL;
+	}
+}
+
+static int perf_memcpy(struct perf_result *r)
+{
+	void *src, *dst;
+	ktime_t start;
+	int i;
+
+	src = vmap(perf_src, PERF_BUF_PAGES, VM_MAP, PAGE_KERNEL);
+	dst = vmap(perf_dst, PERF_BUF_PAGES, VM_MAP, PAGE_KERNEL);
+	if (!src || !dst) {
+		r->err = -ENOMEM;
+		goto out;
+	}
+
+	r->bytes = PERF_BUF_PAGES * PAGE_SIZE;
+	for (i = 0; i < perf_iterations; i++) {
+		start = ktime_get();
+		memcpy(dst, src, PERF_BUF_PAGES * PAGE_SIZE);
+		perf_account(r, start);
+	}
+out:
+	if (src)
+		vunmap(src);
+	if (dst)
+		vunmap(dst);
+	return r->err;
+}
+
+static int perf_copy_page(struct perf_result *r)
+{
+	ktime_t start;
+	int i, j;
+
+	r->bytes = PERF_BUF_PAGES * PAGE_SIZE;
+	for (i = 0; i < perf_iterations; i++) {
+		start = ktime_get();
+		for (j = 0; j < PERF_BUF_PAGES; j++)
+			copy_page(page_address(perf_dst[j]),
+				  page_address(perf_src[j]));
+		perf_account(r, start);
+	}
+	return 0;
+}
+
+static int perf_lzo(struct perf_result *r, bool decompress)
+{
+	size_t clen[PERF_BUF_PAGES], dlen;
+	u8 *wrkmem, *cbuf;
+	ktime_t start;
+	int i, j, ret = 0;
+
+	wrkmem = kmalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
+	cbuf = kmalloc(PERF_BUF_PAGES * lzo1x_worst_compress(PAGE_SIZE),
+		       GFP_KERNEL);
+	if (!wrkmem || !cbuf) {
+		r->err = -ENOMEM;
+		goto out;
+	}
+
+	/* compressed copies for the decompression side */
+	for (j = 0; j < PERF_BUF_PAGES && !ret; j++)
+		ret = lzo1x_1_compress(page_address(perf_src[j]), PAGE_SIZE,
+			cbuf + j * lzo1x_worst_compress(PAGE_SIZE),
+			&clen[j], wrkmem);
+	if (ret != LZO_E_OK) {
+		r->err = -EIO;
+		goto out;
+	}
+
+	r->bytes = PERF_BUF_PAGES * PAGE_SIZE;
+	for (i = 0; i < perf_iterations && !ret; i++) {
+		start = ktime_get();
+		for (j = 0; j < PERF_BUF_PAGES && !ret; j++) {
+			u8 *c = cbuf + j * lzo1x_worst_compress(PAGE_SIZE);
+
+			if (decompress) {
+				dlen = PAGE_SIZE;
+				ret = lzo1x_decompress_safe(c, clen[j],
+					page_address(perf_dst[j]), &dlen);
+			} else
+				ret = lzo1x_1_compress(
+					page_address(perf_src[j]), PAGE_SIZE,
+					c, &clen[j], wrkmem);
+		}
+		perf_account(r, start);
+	}
+	if (ret != LZO_E_OK)
+		r->err = -EIO;
+out:
+	kfree(cbuf);
+	kfree(wrkmem);
+	return r->err;
+}
+
+static int perf_lzo_compress(struct perf_result *r)
+{
+	return perf_lzo(r, false);
+}
+
+static int perf_lzo_decompress(struct perf_result *r)
+{
+	return perf_lzo(r, true);
+}
+
+struct perf_aes_wait {
+	struct completion done;
+	int err;
+};
+
+static void perf_aes_done(struct crypto_async_request *req, int err)
+{
+	struct perf_aes_wait *w = req->data;
+
+	if (err == -EINPROGRESS)
+		return;
+	w->err = err;
+	complete(&w->done);
+}
+
+static int perf_aes(struct perf_result *r, const char *driver)
+{
+	static const u8 key[16] = "tegra3perfselft";
+	struct crypto_ablkcipher *tfm;
+	struct ablkcipher_request *req = NULL;
+	struct scatterlist src[PERF_BUF_PAGES], dst[PERF_BUF_PAGES];
+	struct perf_aes_wait w;
+	u8 iv[16];
+	ktime_t start;
+	int i, ret;
+
+	tfm = crypto_alloc_ablkcipher(driver, 0, 0);
+	if (IS_ERR(tfm))
+		return r->err = PTR_ERR(tfm);
+
+	ret = crypto_ablkcipher_setkey(tfm, key, sizeof(key));
+	if (ret)
+		goto out;
+
+	req = ablkcipher_request_alloc(tfm, GFP_KERNEL);
+	if (!req) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	ablkcipher_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					perf_aes_done, &w);
+
+	sg_init_table(src, PERF_BUF_PAGES);
+	sg_init_table(dst, PERF_BUF_PAGES);
+	for (i = 0; i < PERF_BUF_PAGES; i++) {
+		sg_set_page(&src[i], perf_src[i], PAGE_SIZE, 0);
+		sg_set_page(&dst[i], perf_dst[i], PAGE_SIZE, 0);
+	}
+
+	r->bytes = PERF_AES_LEN;
+	for (i = 0; i < perf_iterations; i++) {
+		memset(iv, 0, sizeof(iv));
+		init_completion(&w.done);
+		ablkcipher_request_set_crypt(req, src, dst, PERF_AES_LEN, iv);
+
+		start = ktime_get();
+		ret = crypto_ablkcipher_encrypt(req);
+		if (ret == -EINPROGRESS || ret == -EBUSY) {
+			wait_for_completion(&w.done);
+			ret = w.err;
+		}
+		perf_account(r, start);
+		if (ret)
+			break;
+	}
+out:
+	if (req)
+		ablkcipher_request_free(req);
+	crypto_free_ablkcipher(tfm);
+	return r->err = ret;
+}
+
+static int perf_aes_tegra(struct perf_result *r)
+{
+	return perf_aes(r, "cbc-aes-tegra");
+}
+
+static int perf_aes_generic(struct perf_result *r)
+{
+	return perf_aes(r, "cbc(aes-generic)");
+}
+
+/* binder maps every transaction buffer into the kernel and back out */
+static int perf_vmap(struct perf_result *r)
+{
+	struct page *pages[PERF_VMAP_PAGES];
+	ktime_t start;
+	void *addr;
+	int i;
+
+	for (i = 0; i < PERF_VMAP_PAGES; i++)
+		pages[i] = perf_src[i % PERF_BUF_PAGES];
+
+	for (i = 0; i < perf_iterations; i++) {
+		start = ktime_get();
+		addr = vmap(pages, PERF_VMAP_PAGES, VM_MAP, PAGE_KERNEL);
+		if (!addr)
+			return r->err = -ENOMEM;
+		vunmap(addr);
+		perf_account(r, start);
+	}
+	return 0;
+}
+
+/* small object churn, the bulk of what a process start allocates */
+static int perf_slab_alloc(struct perf_result *r)
+{
+	ktime_t start;
+	void *obj;
+	int i;
+
+	for (i = 0; i < perf_iterations; i++) {
+		start = ktime_get();
+		obj = kmalloc(64, GFP_KERNEL);
+		if (!obj)
+			return r->err = -ENOMEM;
+		kfree(obj);
+		perf_account(r, start);
+	}
+	return 0;
+}
+
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR
+/*
+ * Charge and uncharge one page cache page to the memory cgroup of the
+ * caller, the cost every page fault and page cache insertion pays once
+ * the memory controller is built in.  Run from a task inside a limited
+ * group to include the res_counter hierarchy walk.
+ */
+static int perf_memcg_charge(struct perf_result *r)
+{
+	ktime_t start;
+	int i, ret;
+
+	for (i = 0; i < perf_iterations; i++) {
+		start = ktime_get();
+		ret = mem_cgroup_cache_charge(perf_dst[0], current->mm,
+					      GFP_KERNEL);
+		if (ret)
+			return r->err = ret;
+		mem_cgroup_uncharge_cache_page(perf_dst[0]);
+		perf_account(r, start);
+	}
+	return 0;
+}
+#endif
+
+/*
+ * Flip a floor request on the EMC between the top and bottom of the
+ * table.  Other floor holders may keep the bus up, so the result is only
+ * meaningful on an otherwise idle system.
+ */
+static int perf_emc_switch(struct perf_result *r)
+{
+	struct clk *floor, *emc;
+	unsigned long hi, lo;
+	ktime_t start;
+	int i, ret;
+
+	emc = tegra_get_clock_by_name("emc");
+	floor = tegra_get_clock_by_name("floor.emc");
+	if (!emc || !floor)
+		return r->err = -ENODEV;
+
+	hi = clk_round_rate(emc, ULONG_MAX);
+	lo = clk_round_rate(emc, 0);
+	ret = clk_enable(floor);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < perf_iterations && !ret; i++) {
+		start = ktime_get();
+		ret = clk_set_rate(floor, (i & 1) ? lo : hi);
+		perf_account(r, start);
+	}
+	clk_set_rate(floor, 0);
+	clk_disable(floor);
+out:
+	return r->err = ret;
+}
+
+/*
+ * Move the cbus floor across its range, which has to walk vdd_core up and
+ * down.  Only the iterations where the rail voltage actually changed are
+ * counted.
+ */
+static int perf_dvfs(struct perf_result *r)
+{
+	struct clk *floor, *cbus;
+	unsigned long hi, lo;
+	ktime_t start;
+	int i, mv, ret;
+
+	cbus = tegra_get_clock_by_name("cbus");
+	floor = tegra_get_clock_by_name("floor.cbus");
+	if (!cbus || !floor)
+		return r->err = -ENODEV;
+
+	hi = clk_round_rate(cbus, ULONG_MAX);
+	lo = clk_round_rate(cbus, 0);
+	ret = clk_enable(floor);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < perf_iterations && !ret; i++) {
+		mv = tegra_dvfs_rail_get_millivolts("vdd_core");
+		start = ktime_get();
+		ret = clk_set_rate(floor, (i & 1) ? lo : hi);
+		if (tegra_dvfs_rail_get_millivolts("vdd_core") != mv)
+			perf_account(r, start);
+	}
+	clk_set_rate(floor, 0);
+	clk_disable(floor);
+out:
+	if (!ret && !r->iters)
+		ret = -EAGAIN;	/* the rail never moved */
+	return r->err = ret;
+}
+
+/* offline and online the highest numbered secondary core */
+static int perf_hotplug(struct perf_result *r)
+{
+	unsigned int cpu = nr_cpu_ids;
+	ktime_t start;
+	int i, ret = 0;
+
+	if (is_lp_cluster())
+		return r->err = -EBUSY;
+
+	for (i = num_possible_cpus() - 1; i > 0; i--)
+		if (cpu_online(i)) {
+			cpu = i;
+			break;
+		}
+	if (cpu >= nr_cpu_ids)
+		return r->err = -ENODEV;
+
+	for (i = 0; i < perf_iterations && !ret; i++) {
+		start = ktime_get();
+		ret = cpu_down(cpu);
+		if (!ret)
+			ret = cpu_up(cpu);
+		perf_account(r, start);
+	}
+	if (!cpu_online(cpu))
+		cpu_up(cpu);
+	return r->err = ret;
+}
+
+#ifdef CONFIG_TEGRA_CLUSTER_CONTROL
+/*
+ * G=>LP=>G round trips with only cpu0 online, timed as a whole.  The
+ * switch to LP is refused while the cpu runs above the LP range, so only
+ * the round trips that completed are counted; run with the device idle.
+ * The _full and _fast variants differ only in tegra_cluster_fast_switch.
+ */
+static int perf_cluster_switch(struct perf_result *r, u32 fast)
+{
+	u32 saved_fast = tegra_cluster_fast_switch;
+	cpumask_t offlined;
+	ktime_t start;
+	int cpu, i, ret = 0;
+
+	if (is_lp_cluster())
+		return r->err = -EBUSY;
+
+	cpumask_clear(&offlined);
+	for_each_online_cpu(cpu) {
+		if (cpu && !tegra_hp_cpu_down(cpu))
+			cpumask_set_cpu(cpu, &offlined);
+	}
+	if (num_online_cpus() > 1) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	tegra_cluster_fast_switch = fast;
+	for (i = 0; i < perf_iterations && !ret; i++) {
+		start = ktime_get();
+		if (tegra_hp_cluster_switch(true) || !is_lp_cluster())
+			continue;
+		ret = tegra_hp_cluster_switch(false);
+		perf_account(r, start);
+	}
+	tegra_cluster_fast_switch = saved_fast;
+	if (!ret && !r->iters)
+		ret = -EAGAIN;	/* never got down to LP */
+out:
+	for_each_cpu(cpu, &offlined)
+		tegra_hp_cpu_up(cpu);
+	return r->err = ret;
+}
+
+static int perf_cluster_switch_full(struct perf_result *r)
+{
+	return perf_cluster_switch(r, 0);
+}
+
+static int perf_cluster_switch_fast(struct perf_result *r)
+{
+	return perf_cluster_switch(r, 1);
+}
+#endif
+
+#ifdef CONFIG_HW_PERF_EVENTS
+static noinline void perf_busy_loop(void)
+{
+	volatile unsigned int n;
+
+	for (n = 0; n < 100000; n++)
+		;
+}
+
+/*
+ * Count instructions on cpu0 with a pinned per-cpu event while the core
+ * is left idle long enough to enter LP2 (or be moved across clusters)
+ * between bursts of fixed work.  A count that goes backwards, or a burst
+ * that shows much less than the first one did, means the PMU state was
+ * lost while the core was power gated.  Each iteration's time is that of
+ * one burst.
+ */
+static int perf_pmu_continuity(struct perf_result *r)
+{
+	struct perf_event_attr attr = {
+		.type		= PERF_TYPE_HARDWARE,
+		.config		= PERF_COUNT_HW_INSTRUCTIONS,
+		.size		= sizeof(attr),
+		.pinned		= 1,
+	};
+	struct perf_event *event;
+	cpumask_t saved;
+	u64 prev, cur, delta, base, enabled, running;
+	ktime_t start;
+	int i, ret = 0;
+
+	cpumask_copy(&saved, tsk_cpus_allowed(current));
+	ret = set_cpus_allowed_ptr(current, cpumask_of(0));
+	if (ret)
+		return r->err = ret;
+
+	event = perf_event_create_kernel_counter(&attr, 0, NULL, NULL, NULL);
+	if (IS_ERR(event)) {
+		ret = PTR_ERR(event);
+		goto out;
+	}
+
+	/* reference burst, no idle time in between */
+	prev = perf_event_read_value(event, &enabled, &running);
+	perf_busy_loop();
+	cur = perf_event_read_value(event, &enabled, &running);
+	base = cur - prev;
+	if (!base) {
+		ret = -ENODATA;
+		goto release;
+	}
+
+	for (i = 0; i < perf_iterations; i++) {
+		prev = cur;
+		msleep(20);
+		start = ktime_get();
+		perf_busy_loop();
+		cur = perf_event_read_value(event, &enabled, &running);
+		perf_account(r, start);
+
+		delta = cur - prev;
+		if (cur < prev || delta < base / 2 || running != enabled) {
+			pr_err("%s: iteration %d: count %llu -> %llu, "
+			       "reference %llu\n", __func__, i, prev, cur, base);
+			ret = -EIO;
+			break;
+		}
+	}
+release:
+	perf_event_release_kernel(event);
+out:
+	set_cpus_allowed_ptr(current, &saved);
+	return r->err = ret;
+}
+#endif
+
+static const struct perf_test perf_tests[] = {
+	{ "memcpy",		perf_memcpy },
+	{ "copy_page",		perf_copy_page },
+	{ "lzo_compress",	perf_lzo_compress },
+	{ "lzo_decompress",	perf_lzo_decompress },
+	{ "aes_tegra",		perf_aes_tegra },
+	{ "aes_generic",	perf_aes_generic },
+	{ "vmap",		perf_vmap },
+	{ "slab_alloc",		perf_slab_alloc },
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR
+	{ "memcg_charge",	perf_memcg_charge },
+#endif
+	{ "emc_switch",		perf_emc_switch },
+	{ "dvfs_core",		perf_dvfs },
+	{ "hotplug",		perf_hotplug },
+#ifdef CONFIG_TEGRA_CLUSTER_CONTROL
+	{ "cluster_switch_full",	perf_cluster_switch_full },
+	{ "cluster_switch_fast",	perf_cluster_switch_fast },
+#endif
+#ifdef CONFIG_HW_PERF_EVENTS
+	{ "pmu_continuity",	perf_pmu_continuity },
+#endif
+};
+
+static struct perf_result perf_results[ARRAY_SIZE(perf_tests)];
+
+static void perf_run_one(int i)
+{
+	struct perf_result *r = &perf_results[i];
+
+	memset(r, 0, sizeof(*r));
+	r->name = perf_tests[i].name;
+	perf_tests[i].run(r);
+}
+
+static int perf_run(const char *name)
+{
+	bool all = !strcmp(name, "all");
+	int i, ret, found = 0;
+
+	mutex_lock(&perf_lock);
+	ret = perf_alloc_pages();
+	if (ret)
+		goto out;
+
+	for (i = 0; i < ARRAY_SIZE(perf_tests); i++) {
+		if (!all && strcmp(name, perf_tests[i].name))
+			continue;
+		perf_run_one(i);
+		found++;
+	}
+	if (!found)
+		ret = -EINVAL;
+out:
+	perf_free_pages();
+	mutex_unlock(&perf_lock);
+	return ret;
+}
+
+static int perf_results_show(struct seq_file *s, void *data)
+{
+	struct perf_result *r;
+	u64 avg;
+	int i;
+
+	mutex_lock(&perf_lock);
+	for (i = 0; i < ARRAY_SIZE(perf_results); i++) {
+		r = &perf_results[i];
+		if (!r->name)
+			continue;
+		avg = r->iters ? div_u64(r->total_ns, r->iters) : 0;
+		seq_printf(s, "test=%s err=%d iters=%u avg_ns=%llu max_ns=%llu",
+			   r->name, r->err, r->iters, avg, r->max_ns);
+		/* bytes per microsecond is MB/s, so this is kB/s */
+		if (r->bytes && r->total_ns)
+			seq_printf(s, " kbps=%llu",
+				   div64_u64(r->bytes * r->iters * 1000000,
+					     r->total_ns));
+		seq_printf(s, "\n");
+	}
+	mutex_unlock(&perf_lock);
+	return 0;
+}
+
+static int perf_results_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, perf_results_show, inode->i_private);
+}
+
+static const struct file_operations perf_results_fops = {
+	.open		= perf_results_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static ssize_t perf_run_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	char name[32];
+	int ret;
+
+	if (count >= sizeof(name))
+		return -EINVAL;
+	if (copy_from_user(name, buf, count))
+		return -EFAULT;
+	name[count] = '\0';
+	strim(name);
+
+	ret = perf_run(name);
+	return ret ? ret : count;
+}
+
+static int perf_tests_show(struct seq_file *s, void *data)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(perf_tests); i++)
+		seq_printf(s, "%s\n", perf_tests[i].name);
+	return 0;
+}
+
+static int perf_tests_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, perf_tests_show, inode->i_private);
+}
+
+static const struct file_operations perf_run_fops = {
+	.open		= perf_tests_open,
+	.read		= seq_read,
+	.write		= perf_run_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static struct dentry *perf_dir;
+
+static int __init tegra3_perf_selftest_init(void)
+{
+	perf_dir = debugfs_create_dir("tegra3_perf_selftest", NULL);
+	if (!perf_dir)
+		return -ENOMEM;
+
+	if (!debugfs_create_file("run", S_IRUGO | S_IWUSR, perf_dir, NULL,
+				 &perf_run_fops) ||
+	    !debugfs_create_file("results", S_IRUGO, perf_dir, NULL,
+				 &perf_results_fops) ||
+	    !debugfs_create_u32("iterations", S_IRUGO | S_IWUSR, perf_dir,
+				&perf_iterations)) {
+		debugfs_remove_recursive(perf_dir);
+		return -ENOMEM;
+	}
+	return 0;
+}
+late_initcall(tegra3_perf_selftest_init);
@@ -15,6 +15,7 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/module.h>
 #include <linux/cpufreq.h>
 #include <linux/delay.h>
 #include <linux/mutex.h>
@@ -28,13 +29,18 @@
 #include <mach/thermal.h>
 #include <mach/edp.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
 
 #include "clock.h"
 #include "cpu-tegra.h"
 #include "dvfs.h"
+#include "periodic-work.h"
 
 #define MAX_ZONES (16)
 
+#define EDP_PREDICT_POLL_MS	(1000)
+
 struct tegra_thermal {
 	struct tegra_thermal_device *device;
 	long temp_throttle_tj;
@@ -51,12 +57,21 @@ struct tegra_thermal {
 	int edp_thermal_zone_val;
 	long edp_offset;
 	long hysteresis_edp;
+	/* predictive EDP ceiling, disabled while predict_horizon_ms is 0 */
+	struct tegra_periodic_work predict_work;
+	unsigned long predict_horizon_ms;
+	unsigned long predict_poll_ms;
+	long predict_last_tj;
+	unsigned long predict_last_jiffies;
+	long predict_slope;	/* millidegrees C per second */
 #endif
+	long last_tj;		/* last reading, LONG_MIN before the first */
 	struct mutex mutex;
 };
 
 static struct tegra_thermal thermal_state = {
 	.device = NULL,
+	.last_tj = LONG_MIN,
 #ifdef CONFIG_TEGRA_EDP_LIMITS
 	.edp_thermal_zone_val = -1,
 #endif
@@ -203,6 +218,7 @@ void tegra_thermal_alert(void *data)
 	/* Convert all temps to tj and then do all work/logic in terms of
 	   tj in order to avoid confusion */
 	temp_tj = dev2tj(thermal->device, temp_dev);
+	thermal->last_tj = temp_tj;
 	thermal->device->get_temp_low(thermal->device, &temp_low_dev);
 	temp_low_tj = dev2tj(thermal->device, temp_low_dev);
 
@@ -286,6 +302,71 @@ done:
 	mutex_unlock(&thermal_state.mutex);
 }
 
+#ifdef CONFIG_TEGRA_EDP_LIMITS
+/*
+ * Sample the temperature periodically and extrapolate it over
+ * predict_horizon_ms from a smoothed slope, so that the EDP ceiling can
+ * be lowered before the next zone is actually entered.
+ */
+static void tegra_thermal_predict_work_func(struct work_struct *work)
+{
+	struct tegra_thermal *thermal = container_of(to_delayed_work(work),
+				struct tegra_thermal, predict_work.dwork);
+	unsigned long now = jiffies;
+	unsigned int elapsed_ms;
+	long temp_dev, temp_tj, predicted_tj, slope;
+
+	mutex_lock(&thermal->mutex);
+	if (!thermal->device || !thermal->predict_horizon_ms)
+		goto done;
+
+	if (thermal->device->get_temp(thermal->device->data, &temp_dev))
+		goto requeue;
+	temp_tj = dev2tj(thermal->device, temp_dev);
+	thermal->last_tj = temp_tj;
+
+	elapsed_ms = jiffies_to_msecs(now - thermal->predict_last_jiffies);
+	if (thermal->predict_last_jiffies && elapsed_ms) {
+		slope = (temp_tj - thermal->predict_last_tj) * 1000 /
+			(long)elapsed_ms;
+		/* Exponential average to filter sensor noise */
+		thermal->predict_slope = (thermal->predict_slope + slope) / 2;
+	}
+	thermal->predict_last_tj = temp_tj;
+	thermal->predict_last_jiffies = now;
+
+	predicted_tj = temp_tj + thermal->predict_slope *
+		(long)thermal->predict_horizon_ms / 1000;
+	mutex_unlock(&thermal->mutex);
+
+	tegra_edp_predict_thermal_zone(tj2edp(thermal, temp_tj),
+				       tj2edp(thermal, predicted_tj));
+
+	mutex_lock(&thermal->mutex);
+requeue:
+	tegra_periodic_work_schedule(&thermal->predict_work,
+		msecs_to_jiffies(thermal->predict_poll_ms));
+done:
+	mutex_unlock(&thermal->mutex);
+}
+#endif
+
+/*
+ * The junction temperature from the last alert or prediction sample, for
+ * callers that cannot wait for the sensor's bus.  The alert limits keep
+ * it within the current throttle or EDP zone.
+ */
+int tegra_thermal_get_last_tj(long *tj)
+{
+	long last = ACCESS_ONCE(thermal_state.last_tj);
+
+	if (last == LONG_MIN)
+		return -ENODATA;
+	*tj = last;
+	return 0;
+}
+EXPORT_SYMBOL(tegra_thermal_get_last_tj);
+
 int tegra_thermal_set_device(struct tegra_thermal_device *device)
 {
 #ifdef CONFIG_TEGRA_THERMAL_SYSFS
@@ -325,6 +406,11 @@ int tegra_thermal_set_device(struct tegra_thermal_device *device)
 	/* initialize limits */
 	tegra_thermal_alert(&thermal_state);
 
+#ifdef CONFIG_TEGRA_EDP_LIMITS
+	if (thermal_state.predict_horizon_ms)
+		tegra_periodic_work_schedule(&thermal_state.predict_work, 0);
+#endif
+
 	return 0;
 }
 
@@ -343,6 +429,10 @@ int __init tegra_thermal_init(struct tegra_thermal_data *data)
 #ifdef CONFIG_TEGRA_EDP_LIMITS
 	thermal_state.edp_offset = data->edp_offset;
 	thermal_state.hysteresis_edp = data->hysteresis_edp;
+	thermal_state.predict_poll_ms = EDP_PREDICT_POLL_MS;
+	tegra_periodic_work_init(&thermal_state.predict_work,
+				 "thermal_edp_predict",
+				 tegra_thermal_predict_work_func, 250);
 #endif
 	thermal_state.temp_throttle_tj = data->temp_throttle +
 						data->temp_offset;
@@ -354,6 +444,9 @@ int __init tegra_thermal_init(struct tegra_thermal_data *data)
 
 int tegra_thermal_exit(void)
 {
+#ifdef CONFIG_TEGRA_EDP_LIMITS
+	cancel_delayed_work_sync(&thermal_state.predict_work.dwork);
+#endif
 #ifdef CONFIG_TEGRA_THERMAL_SYSFS
 	if (thermal_state.thz)
 		thermal_zone_device_unregister(thermal_state.thz);
@@ -447,6 +540,69 @@ DEFINE_SIMPLE_ATTRIBUTE(temp_tj_fops,
 			NULL,
 			"%llu\n");
 
+#ifdef CONFIG_TEGRA_EDP_LIMITS
+static int tegra_thermal_predict_horizon_set(void *data, u64 val)
+{
+	bool start;
+
+	mutex_lock(&thermal_state.mutex);
+	start = !thermal_state.predict_horizon_ms && val;
+	thermal_state.predict_horizon_ms = val;
+	thermal_state.predict_last_jiffies = 0;
+	thermal_state.predict_slope = 0;
+	if (start && thermal_state.device)
+		tegra_periodic_work_schedule(&thermal_state.predict_work, 0);
+	mutex_unlock(&thermal_state.mutex);
+
+	/* drop any soft ceiling left behind when disabling */
+	if (!val)
+		tegra_edp_predict_thermal_zone(0, 0);
+
+	return 0;
+}
+
+static int tegra_thermal_predict_horizon_get(void *data, u64 *val)
+{
+	*val = (u64)thermal_state.predict_horizon_ms;
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(predict_horizon_fops,
+			tegra_thermal_predict_horizon_get,
+			tegra_thermal_predict_horizon_set,
+			"%llu\n");
+
+static int tegra_thermal_predict_poll_set(void *data, u64 val)
+{
+	if (!val)
+		return -EINVAL;
+	thermal_state.predict_poll_ms = val;
+	return 0;
+}
+
+static int tegra_thermal_predict_poll_get(void *data, u64 *val)
+{
+	*val = (u64)thermal_state.predict_poll_ms;
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(predict_poll_fops,
+			tegra_thermal_predict_poll_get,
+			tegra_thermal_predict_poll_set,
+			"%llu\n");
+
+static int tegra_thermal_predict_slope_get(void *data, u64 *val)
+{
+	*val = (u64)thermal_state.predict_slope;
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(predict_slope_fops,
+			tegra_thermal_predict_slope_get,
+			NULL,
+			"%lld\n");
+#endif
+
 #ifdef CONFIG_TEGRA_THERMAL_SYSFS
 static int tegra_thermal_tc1_set(void *data, u64 val)
 {
@@ -519,6 +675,23 @@ static int __init tegra_thermal_debug_init(void)
 				 NULL, &temp_tj_fops))
 		goto err_out;
 
+#ifdef CONFIG_TEGRA_EDP_LIMITS
+	if (!debugfs_create_file("edp_predict_horizon_ms", 0644,
+				 thermal_debugfs_root, NULL,
+				 &predict_horizon_fops))
+		goto err_out;
+
+	if (!debugfs_create_file("edp_predict_poll_ms", 0644,
+				 thermal_debugfs_root, NULL,
+				 &predict_poll_fops))
+		goto err_out;
+
+	if (!debugfs_create_file("edp_predict_slope", 0444,
+				 thermal_debugfs_root, NULL,
+				 &predict_slope_fops))
+		goto err_out;
+#endif
+
 #ifdef CONFIG_TEGRA_THERMAL_SYSFS
 	if (!debugfs_create_file("tc1", 0644, thermal_debugfs_root,
 				 NULL, &tc1_fops))
@@ -0,0 +1,335 @@
+/*
+ * arch/arm/mach-tegra/touch-latency.c
+ *
+ * Touch to display latency, split by stage, reported through tracepoints
+ * and a debugfs histogram.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/input.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/touch_latency.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/touch_latency.h>
+
+#define TOUCH_LAT_BINS		20	/* up to ~0.5s in log2(us) bins */
+/* a touch that has not reached the screen by then never will */
+#define TOUCH_LAT_TIMEOUT_US	250000
+
+/* the irq slot holds the whole touch to photon time */
+static const char * const touch_lat_names[TOUCH_LAT_NR_STAGES] = {
+	[TOUCH_LAT_IRQ]		= "touch to photon",
+	[TOUCH_LAT_INPUT]	= "irq to input",
+	[TOUCH_LAT_BOOST]	= "irq to boost",
+	[TOUCH_LAT_FLIP]	= "input to flip",
+	[TOUCH_LAT_SCANOUT]	= "flip to scanout",
+};
+
+static const enum touch_lat_stage touch_lat_parent[TOUCH_LAT_NR_STAGES] = {
+	[TOUCH_LAT_INPUT]	= TOUCH_LAT_IRQ,
+	[TOUCH_LAT_BOOST]	= TOUCH_LAT_IRQ,
+	[TOUCH_LAT_FLIP]	= TOUCH_LAT_INPUT,
+	[TOUCH_LAT_SCANOUT]	= TOUCH_LAT_FLIP,
+};
+
+struct touch_lat_stats {
+	unsigned int count;
+	unsigned long max_us;
+	unsigned long long total_us;
+	unsigned int bin[TOUCH_LAT_BINS];
+};
+
+static DEFINE_SPINLOCK(touch_lat_lock);
+static struct touch_lat_stats touch_lat[TOUCH_LAT_NR_STAGES];
+static ktime_t touch_lat_time[TOUCH_LAT_NR_STAGES];
+static unsigned long touch_lat_seen;
+static bool touch_lat_active;
+
+static inline unsigned int latency_to_bin(unsigned long us)
+{
+	return min_t(unsigned int, fls(us), TOUCH_LAT_BINS - 1);
+}
+
+static void touch_lat_account(enum touch_lat_stage stage, unsigned long us)
+{
+	struct touch_lat_stats *stats = &touch_lat[stage];
+
+	stats->count++;
+	stats->total_us += us;
+	if (us > stats->max_us)
+		stats->max_us = us;
+	stats->bin[latency_to_bin(us)]++;
+}
+
+static void touch_lat_trace(enum touch_lat_stage stage, unsigned long us,
+	unsigned long total_us)
+{
+	switch (stage) {
+	case TOUCH_LAT_IRQ:
+		trace_touch_latency_irq(us, total_us);
+		break;
+	case TOUCH_LAT_INPUT:
+		trace_touch_latency_input(us, total_us);
+		break;
+	case TOUCH_LAT_BOOST:
+		trace_touch_latency_boost(us, total_us);
+		break;
+	case TOUCH_LAT_FLIP:
+		trace_touch_latency_flip(us, total_us);
+		break;
+	case TOUCH_LAT_SCANOUT:
+		trace_touch_latency_scanout(us, total_us);
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Stamp @stage of the sample in flight at @now.  The scanout only counts
+ * for the flip that was stamped, which is identified by @now itself.
+ */
+static void touch_lat_mark_at(enum touch_lat_stage stage, ktime_t now)
+{
+	enum touch_lat_stage parent;
+	unsigned long irqflags;
+	unsigned long us, total_us;
+	s64 delta;
+
+	if (stage >= TOUCH_LAT_NR_STAGES)
+		return;
+	parent = touch_lat_parent[stage];
+
+	spin_lock_irqsave(&touch_lat_lock, irqflags);
+	if (stage == TOUCH_LAT_IRQ) {
+		/* later interrupts belong to the sample in flight */
+		if (touch_lat_active &&
+		    ktime_us_delta(now, touch_lat_time[TOUCH_LAT_IRQ]) <
+		    TOUCH_LAT_TIMEOUT_US) {
+			spin_unlock_irqrestore(&touch_lat_lock, irqflags);
+			return;
+		}
+		touch_lat_active = true;
+		touch_lat_time[TOUCH_LAT_IRQ] = now;
+		touch_lat_seen = BIT(TOUCH_LAT_IRQ);
+		spin_unlock_irqrestore(&touch_lat_lock, irqflags);
+		touch_lat_trace(stage, 0, 0);
+		return;
+	}
+
+	if (!touch_lat_active || (touch_lat_seen & BIT(stage)) ||
+	    !(touch_lat_seen & BIT(parent))) {
+		spin_unlock_irqrestore(&touch_lat_lock, irqflags);
+		return;
+	}
+	if (stage == TOUCH_LAT_SCANOUT &&
+	    !ktime_equal(now, touch_lat_time[TOUCH_LAT_FLIP])) {
+		spin_unlock_irqrestore(&touch_lat_lock, irqflags);
+		return;
+	}
+	if (stage == TOUCH_LAT_SCANOUT)
+		now = ktime_get();
+
+	delta = ktime_us_delta(now, touch_lat_time[TOUCH_LAT_IRQ]);
+	if (delta < 0 || delta >= TOUCH_LAT_TIMEOUT_US) {
+		touch_lat_active = false;
+		spin_unlock_irqrestore(&touch_lat_lock, irqflags);
+		return;
+	}
+	total_us = delta;
+	us = max_t(s64, ktime_us_delta(now, touch_lat_time[parent]), 0);
+
+	touch_lat_time[stage] = now;
+	touch_lat_seen |= BIT(stage);
+	touch_lat_account(stage, us);
+	if (stage == TOUCH_LAT_SCANOUT) {
+		touch_lat_account(TOUCH_LAT_IRQ, total_us);
+		touch_lat_active = false;
+	}
+	spin_unlock_irqrestore(&touch_lat_lock, irqflags);
+
+	touch_lat_trace(stage, us, total_us);
+}
+
+/* May be called from hard irq context */
+void touch_latency_mark(enum touch_lat_stage stage)
+{
+	touch_lat_mark_at(stage, ktime_get());
+}
+
+void touch_latency_flip_queued(ktime_t queued)
+{
+	touch_lat_mark_at(TOUCH_LAT_FLIP, queued);
+}
+
+/* Called once the windows of the flip queued at @queued are latched */
+void touch_latency_flip_shown(ktime_t queued)
+{
+	touch_lat_mark_at(TOUCH_LAT_SCANOUT, queued);
+}
+
+/*
+ * The input stage ends when a touchscreen's SYN_REPORT goes through the
+ * handlers, evdev among them, so it needs no hook in the drivers.
+ */
+static void touch_lat_input_event(struct input_handle *handle,
+	unsigned int type, unsigned int code, int value)
+{
+	if (type == EV_SYN && code == SYN_REPORT)
+		touch_latency_mark(TOUCH_LAT_INPUT);
+}
+
+static int touch_lat_input_connect(struct input_handler *handler,
+	struct input_dev *dev, const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "touch_latency";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err_free;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err_unregister;
+
+	return 0;
+
+err_unregister:
+	input_unregister_handle(handle);
+err_free:
+	kfree(handle);
+	return error;
+}
+
+static void touch_lat_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id touch_lat_ids[] = {
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			    BIT_MASK(ABS_MT_POSITION_X) },
+	},
+	{ },
+};
+
+static struct input_handler touch_lat_input_handler = {
+	.event		= touch_lat_input_event,
+	.connect	= touch_lat_input_connect,
+	.disconnect	= touch_lat_input_disconnect,
+	.name		= "touch_latency",
+	.id_table	= touch_lat_ids,
+};
+
+static int __init touch_latency_init(void)
+{
+	return input_register_handler(&touch_lat_input_handler);
+}
+late_initcall(touch_latency_init);
+
+#ifdef CONFIG_DEBUG_FS
+
+static int touch_lat_show(struct seq_file *s, void *data)
+{
+	struct touch_lat_stats snap[TOUCH_LAT_NR_STAGES];
+	unsigned long irqflags;
+	int stage, bin;
+
+	spin_lock_irqsave(&touch_lat_lock, irqflags);
+	memcpy(snap, touch_lat, sizeof(snap));
+	spin_unlock_irqrestore(&touch_lat_lock, irqflags);
+
+	seq_printf(s, "%-16s %8s %10s %10s\n",
+		"stage", "count", "avg us", "max us");
+	seq_printf(s, "-----------------------------------------------\n");
+	for (stage = 0; stage < TOUCH_LAT_NR_STAGES; stage++) {
+		seq_printf(s, "%-16s %8u %10llu %10lu\n",
+			touch_lat_names[stage], snap[stage].count,
+			div64_u64(snap[stage].total_us,
+				snap[stage].count ?: 1),
+			snap[stage].max_us);
+	}
+
+	for (stage = 0; stage < TOUCH_LAT_NR_STAGES; stage++) {
+		if (!snap[stage].count)
+			continue;
+		seq_printf(s, "\n%s:\n", touch_lat_names[stage]);
+		for (bin = 0; bin < TOUCH_LAT_BINS; bin++) {
+			if (!snap[stage].bin[bin])
+				continue;
+			seq_printf(s, "%8u - %8u us: %8u\n",
+				bin ? 1 << (bin - 1) : 0, 1 << bin,
+				snap[stage].bin[bin]);
+		}
+	}
+	return 0;
+}
+
+static int touch_lat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, touch_lat_show, inode->i_private);
+}
+
+/* any write clears the statistics */
+static ssize_t touch_lat_write(struct file *file, const char __user *buf,
+	size_t count, loff_t *ppos)
+{
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&touch_lat_lock, irqflags);
+	memset(touch_lat, 0, sizeof(touch_lat));
+	touch_lat_active = false;
+	spin_unlock_irqrestore(&touch_lat_lock, irqflags);
+	return count;
+}
+
+static const struct file_operations touch_lat_fops = {
+	.open		= touch_lat_open,
+	.read		= seq_read,
+	.write		= touch_lat_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init touch_latency_debug_init(void)
+{
+	if (!debugfs_create_file("touch_latency", S_IRUGO | S_IWUSR, NULL,
+				 NULL, &touch_lat_fops))
+		return -ENOMEM;
+	return 0;
+}
+late_initcall(touch_latency_debug_init);
+
+#endif
@@ -16,11 +16,22 @@
 #include <asm/mmu_context.h>
 #include <asm/tlbflush.h>
 
-static DEFINE_SPINLOCK(cpu_asid_lock);
-unsigned int cpu_last_asid = ASID_FIRST_VERSION;
-#ifdef CONFIG_SMP
-DEFINE_PER_CPU(struct mm_struct *, current_mm);
-#endif
+/*
+ * ASIDs are handed out in generations.  When a generation runs out, the
+ * ASIDs that are running on each cpu at that moment are reserved and
+ * carried over into the next one, so a multi-threaded mm keeps a single
+ * ASID on all the cpus it is running on, and every cpu flushes its TLB
+ * before it next switches mm.  No cpu is interrupted for the rollover.
+ *
+ * active_asids is what each cpu is running, or 0 once a rollover has
+ * taken it into reserved_asids; the switch fast path relies on that to
+ * see that it must take the lock.
+ */
+static DEFINE_RAW_SPINLOCK(cpu_asid_lock);
+static unsigned int cpu_last_asid = ASID_FIRST_VERSION;
+static DEFINE_PER_CPU(atomic_t, active_asids);
+static DEFINE_PER_CPU(unsigned int, reserved_asids);
+static cpumask_t tlb_flush_pending;
 
 /*
  * We fork()ed a process, and we need a new context for the child
@@ -31,127 +42,114 @@ DEFINE_PER_CPU(struct mm_struct *, current_mm);
 void __init_new_context(struct task_struct *tsk, struct mm_struct *mm)
 {
 	mm->context.id = 0;
-	spin_lock_init(&mm->context.id_lock);
 }
 
 static void flush_context(void)
 {
-	/* set the reserved ASID before flushing the TLB */
-	asm("mcr	p15, 0, %0, c13, c0, 1\n" : : "r" (0));
-	isb();
-	local_flush_tlb_all();
-	if (icache_is_vivt_asid_tagged()) {
-		__flush_icache_all();
-		dsb();
+	unsigned int asid;
+	int i;
+
+	for_each_possible_cpu(i) {
+		asid = atomic_xchg(&per_cpu(active_asids, i), 0);
+		/* a cpu that has not switched since the last rollover */
+		if (!asid)
+			asid = per_cpu(reserved_asids, i);
+		per_cpu(reserved_asids, i) = asid;
 	}
-}
 
-#ifdef CONFIG_SMP
+	/* each cpu flushes its TLB before it next uses a new ASID */
+	cpumask_setall(&tlb_flush_pending);
+}
 
-static void set_mm_context(struct mm_struct *mm, unsigned int asid)
+static int is_reserved_asid(unsigned int asid)
 {
-	unsigned long flags;
+	int cpu;
 
-	/*
-	 * Locking needed for multi-threaded applications where the
-	 * same mm->context.id could be set from different CPUs during
-	 * the broadcast. This function is also called via IPI so the
-	 * mm->context.id_lock has to be IRQ-safe.
-	 */
-	spin_lock_irqsave(&mm->context.id_lock, flags);
-	if (likely((mm->context.id ^ cpu_last_asid) >> ASID_BITS)) {
-		/*
-		 * Old version of ASID found. Set the new one and
-		 * reset mm_cpumask(mm).
-		 */
-		mm->context.id = asid;
-		cpumask_clear(mm_cpumask(mm));
-	}
-	spin_unlock_irqrestore(&mm->context.id_lock, flags);
-
-	/*
-	 * Set the mm_cpumask(mm) bit for the current CPU.
-	 */
-	cpumask_set_cpu(smp_processor_id(), mm_cpumask(mm));
+	for_each_possible_cpu(cpu)
+		if ((per_cpu(reserved_asids, cpu) & ~ASID_MASK) ==
+		    (asid & ~ASID_MASK))
+			return 1;
+	return 0;
 }
 
-/*
- * Reset the ASID on the current CPU. This function call is broadcast
- * from the CPU handling the ASID rollover and holding cpu_asid_lock.
- */
-static void reset_context(void *info)
+static unsigned int new_context(struct mm_struct *mm)
 {
-	unsigned int asid;
-	unsigned int cpu = smp_processor_id();
-	struct mm_struct *mm = per_cpu(current_mm, cpu);
+	unsigned int asid = mm->context.id;
+	unsigned int newasid;
+	int i, reserved = 0;
 
 	/*
-	 * Check if a current_mm was set on this CPU as it might still
-	 * be in the early booting stages and using the reserved ASID.
+	 * Still running somewhere when the generation rolled over: keep
+	 * the ASID, and the cpus whose TLBs may hold it.  The reservation
+	 * moves to the new generation too, in case that cpu is still
+	 * running it at the next rollover.
 	 */
-	if (!mm)
-		return;
-
-	smp_rmb();
-	asid = cpu_last_asid + cpu + 1;
-
-	flush_context();
-	set_mm_context(mm, asid);
-
-	/* set the new ASID */
-	asm("mcr	p15, 0, %0, c13, c0, 1\n" : : "r" (mm->context.id));
-	isb();
-}
-
-#else
+	newasid = (cpu_last_asid & ASID_MASK) | (asid & ~ASID_MASK);
+	for_each_possible_cpu(i) {
+		if (asid && per_cpu(reserved_asids, i) == asid) {
+			per_cpu(reserved_asids, i) = newasid;
+			reserved = 1;
+		}
+	}
+	if (reserved)
+		return newasid;
+
+	for (;;) {
+		asid = ++cpu_last_asid;
+		if (unlikely(!asid))
+			asid = cpu_last_asid = ASID_FIRST_VERSION;
+		/* ASID 0 is for changing TTBR0, see cpu_v7_switch_mm */
+		if ((asid & ~ASID_MASK) == 0) {
+			flush_context();
+			continue;
+		}
+		if (!is_reserved_asid(asid))
+			break;
+	}
 
-static inline void set_mm_context(struct mm_struct *mm, unsigned int asid)
-{
-	mm->context.id = asid;
-	cpumask_copy(mm_cpumask(mm), cpumask_of(smp_processor_id()));
+	/* no cpu has used the new ASID for this mm yet */
+	cpumask_clear(mm_cpumask(mm));
+	return asid;
 }
 
-#endif
-
-void __new_context(struct mm_struct *mm)
+void check_and_switch_context(struct mm_struct *mm, unsigned int cpu)
 {
+	unsigned long flags;
 	unsigned int asid;
 
-	spin_lock(&cpu_asid_lock);
-#ifdef CONFIG_SMP
+	if (unlikely(mm->context.kvm_seq != init_mm.context.kvm_seq))
+		__check_kvm_seq(mm);
+
 	/*
-	 * Check the ASID again, in case the change was broadcast from
-	 * another CPU before we acquired the lock.
+	 * The lock is only needed when the ASID is from an old generation,
+	 * or a rollover has happened since this cpu last switched.
 	 */
-	if (unlikely(((mm->context.id ^ cpu_last_asid) >> ASID_BITS) == 0)) {
-		cpumask_set_cpu(smp_processor_id(), mm_cpumask(mm));
-		spin_unlock(&cpu_asid_lock);
-		return;
+	asid = ACCESS_ONCE(mm->context.id);
+	if (!((asid ^ ACCESS_ONCE(cpu_last_asid)) >> ASID_BITS) &&
+	    atomic_xchg(&per_cpu(active_asids, cpu), asid))
+		goto switch_mm_fastpath;
+
+	raw_spin_lock_irqsave(&cpu_asid_lock, flags);
+	asid = mm->context.id;
+	if ((asid ^ cpu_last_asid) >> ASID_BITS) {
+		asid = new_context(mm);
+		mm->context.id = asid;
 	}
-#endif
-	/*
-	 * At this point, it is guaranteed that the current mm (with
-	 * an old ASID) isn't active on any other CPU since the ASIDs
-	 * are changed simultaneously via IPI.
-	 */
-	asid = ++cpu_last_asid;
-	if (asid == 0)
-		asid = cpu_last_asid = ASID_FIRST_VERSION;
 
-	/*
-	 * If we've used up all our ASIDs, we need
-	 * to start a new version and flush the TLB.
-	 */
-	if (unlikely((asid & ~ASID_MASK) == 0)) {
-		asid = cpu_last_asid + smp_processor_id() + 1;
-		flush_context();
-#ifdef CONFIG_SMP
-		smp_wmb();
-		smp_call_function(reset_context, NULL, 1);
-#endif
-		cpu_last_asid += NR_CPUS;
+	if (cpumask_test_and_clear_cpu(cpu, &tlb_flush_pending)) {
+		local_flush_tlb_all();
+		if (icache_is_vivt_asid_tagged()) {
+			__flush_icache_all();
+			dsb();
+		}
 	}
 
-	set_mm_context(mm, asid);
-	spin_unlock(&cpu_asid_lock);
+	atomic_set(&per_cpu(active_asids, cpu), asid);
+	cpumask_set_cpu(cpu, mm_cpumask(mm));
+	/* before the first table walk, see tlb_mm_local() */
+	smp_mb();
+	raw_spin_unlock_irqrestore(&cpu_asid_lock, flags);
+
+switch_mm_fastpath:
+	cpu_switch_mm(mm->pgd, mm);
 }
@@ -18,6 +18,7 @@
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
 #include <linux/highmem.h>
+#include <linux/hardirq.h>
 
 #include <asm/memory.h>
 #include <asm/highmem.h>
@@ -437,6 +438,48 @@ EXPORT_SYMBOL(dma_free_coherent);
  * platforms with CONFIG_DMABOUNCE.
  * Use the driver DMA support - see dma-mapping.h (dma_sync_*)
  */
+/*
+ * Cleaning or invalidating a buffer line by line costs time in proportion
+ * to its size, whole caches a fixed time.  From dma_l1_all_bytes on, each
+ * cpu cleans and invalidates its whole L1 by set/way instead, which needs
+ * an IPI to the others and so process context with interrupts enabled;
+ * bottom halves and irq handlers keep line by line maintenance.  From
+ * dma_l2_all_bytes on the outer cache is cleaned and invalidated by way.
+ * Either is safe for any direction: the buffer has no dirty lines the
+ * device may not see, and stale clean ones are gone afterwards.  0 turns
+ * a switch off.
+ */
+unsigned int dma_l1_all_bytes = SZ_256K;
+EXPORT_SYMBOL_GPL(dma_l1_all_bytes);
+module_param(dma_l1_all_bytes, uint, 0644);
+unsigned int dma_l2_all_bytes = SZ_256K;
+EXPORT_SYMBOL_GPL(dma_l2_all_bytes);
+module_param(dma_l2_all_bytes, uint, 0644);
+
+static void dma_flush_local_l1(void *unused)
+{
+	flush_cache_all();
+}
+
+static bool dma_l1_all(size_t size)
+{
+	if (!dma_l1_all_bytes || size < dma_l1_all_bytes)
+		return false;
+	/* smp_call_function_many() must not run from a bh or an irq */
+	if (in_interrupt() || irqs_disabled())
+		return false;
+	on_each_cpu(dma_flush_local_l1, NULL, 1);
+	return true;
+}
+
+static bool dma_l2_all(size_t size)
+{
+	if (!dma_l2_all_bytes || size < dma_l2_all_bytes)
+		return false;
+	outer_flush_all();
+	return true;
+}
+
 void ___dma_single_cpu_to_dev(const void *kaddr, size_t size,
 	enum dma_data_direction dir)
 {
@@ -444,9 +487,12 @@ void ___dma_single_cpu_to_dev(const void *kaddr, size_t size,
 
 	BUG_ON(!virt_addr_valid(kaddr) || !virt_addr_valid(kaddr + size - 1));
 
-	dmac_map_area(kaddr, size, dir);
+	if (!dma_l1_all(size))
+		dmac_map_area(kaddr, size, dir);
 
 	paddr = __pa(kaddr);
+	if (dma_l2_all(size))
+		return;
 	if (dir == DMA_FROM_DEVICE) {
 		outer_inv_range(paddr, paddr + size);
 	} else {
@@ -463,11 +509,15 @@ void ___dma_single_dev_to_cpu(const void *kaddr, size_t size,
 
 	/* FIXME: non-speculating: not required */
 	/* don't bother invalidating if DMA to device */
-	if (dir != DMA_TO_DEVICE) {
+	if (dir == DMA_TO_DEVICE)
+		goto inner;
+	if (!dma_l2_all(size)) {
 		unsigned long paddr = __pa(kaddr);
 		outer_inv_range(paddr, paddr + size);
 	}
-
+	if (dma_l1_all(size))
+		return;
+inner:
 	dmac_unmap_area(kaddr, size, dir);
 }
 EXPORT_SYMBOL(___dma_single_dev_to_cpu);
@@ -521,9 +571,12 @@ void ___dma_page_cpu_to_dev(struct page *page, unsigned long off,
 {
 	unsigned long paddr;
 
-	dma_cache_maint_page(page, off, size, dir, dmac_map_area);
+	if (!dma_l1_all(size))
+		dma_cache_maint_page(page, off, size, dir, dmac_map_area);
 
 	paddr = page_to_phys(page) + off;
+	if (dma_l2_all(size))
+		return;
 	if (dir == DMA_FROM_DEVICE) {
 		outer_inv_range(paddr, paddr + size);
 	} else {
@@ -540,10 +593,15 @@ void ___dma_page_dev_to_cpu(struct page *page, unsigned long off,
 
 	/* FIXME: non-speculating: not required */
 	/* don't bother invalidating if DMA to device */
-	if (dir != DMA_TO_DEVICE)
-		outer_inv_range(paddr, paddr + size);
+	if (dir != DMA_TO_DEVICE) {
+		if (!dma_l2_all(size))
+			outer_inv_range(paddr, paddr + size);
+		if (dma_l1_all(size))
+			goto done;
+	}
 
 	dma_cache_maint_page(page, off, size, dir, dmac_unmap_area);
+done:
 
 	/*
 	 * Mark the D-cache clean for this page to avoid extra flushing.
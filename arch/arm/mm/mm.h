@@ -29,5 +29,9 @@ extern u32 arm_dma_limit;
 #define arm_dma_limit ((u32)~0)
 #endif
 
+/* see dma-mapping.c */
+extern unsigned int dma_l1_all_bytes;
+extern unsigned int dma_l2_all_bytes;
+
 void __init bootmem_init(void);
 void arm_mm_memblock_reserve(void);
@@ -0,0 +1,114 @@
+/*
+ * Speed test for streaming DMA cache maintenance.
+ *
+ * Loading the module times dma_map_single() and dma_unmap_single() of a
+ * freshly written buffer, to and from the device, over a range of sizes.
+ * Each size is timed with the maintenance done line by line and with the
+ * whole L1 and outer cache cleaned instead, which shows where
+ * dma_l1_all_bytes and dma_l2_all_bytes are best set on this machine.
+ * The last column is dma_map_single_clean() from the device, which skips
+ * the maintenance on map.  The load fails on purpose so the module can be
+ * loaded again.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/dma-mapping.h>
+#include <linux/gfp.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+
+#include "mm.h"
+
+#define BUF_ORDER	10	/* 4MB */
+
+static unsigned int runs = 20;
+module_param(runs, uint, 0);
+MODULE_PARM_DESC(runs, "Map and unmap cycles timed per size");
+
+static const unsigned int sizes[] = {
+	4096, 16384, 65536, 131072, 262144, 524288, 1 << 20, 2 << 20, 4 << 20
+};
+
+enum { T_TO_DEVICE, T_FROM_DEVICE, T_FROM_DEVICE_CLEAN };
+
+/* ns for one map and unmap of @size bytes, averaged over @runs */
+static u64 measure(int test, char *buf, unsigned int size)
+{
+	enum dma_data_direction dir;
+	unsigned int i;
+	dma_addr_t addr;
+	ktime_t start;
+	u64 ns = 0;
+
+	dir = test == T_TO_DEVICE ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+	for (i = 0; i < runs; i++) {
+		/* the clean case is a buffer the cpu only read */
+		if (test == T_FROM_DEVICE_CLEAN)
+			dma_unmap_single(NULL, dma_map_single(NULL, buf, size,
+					 dir), size, dir);
+		else
+			memset(buf, i, size);
+
+		start = ktime_get();
+		if (test == T_FROM_DEVICE_CLEAN)
+			addr = dma_map_single_clean(NULL, buf, size, dir);
+		else
+			addr = dma_map_single(NULL, buf, size, dir);
+		dma_unmap_single(NULL, addr, size, dir);
+		ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+		cond_resched();
+	}
+	return div_u64(ns, runs);
+}
+
+static int __init dma_cache_speed_init(void)
+{
+	unsigned int l1 = dma_l1_all_bytes, l2 = dma_l2_all_bytes;
+	unsigned int i;
+	char *buf;
+
+	if (!runs)
+		return -EINVAL;
+	buf = (char *)__get_free_pages(GFP_KERNEL, BUF_ORDER);
+	if (!buf)
+		return -ENOMEM;
+
+	pr_info("test_dma_cache: us per map+unmap, by line / whole cache\n");
+	pr_info("test_dma_cache: %8s %15s %15s %8s\n", "size",
+		"to device", "from device", "clean");
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		unsigned int size = sizes[i];
+		u64 to_line, to_all, from_line, from_all, clean;
+
+		dma_l1_all_bytes = dma_l2_all_bytes = 0;
+		to_line = measure(T_TO_DEVICE, buf, size);
+		from_line = measure(T_FROM_DEVICE, buf, size);
+		clean = measure(T_FROM_DEVICE_CLEAN, buf, size);
+
+		dma_l1_all_bytes = dma_l2_all_bytes = 1;
+		to_all = measure(T_TO_DEVICE, buf, size);
+		from_all = measure(T_FROM_DEVICE, buf, size);
+
+		pr_info("test_dma_cache: %7uK %7llu/%-7llu %7llu/%-7llu %8llu\n",
+			size >> 10,
+			div_u64(to_line, NSEC_PER_USEC),
+			div_u64(to_all, NSEC_PER_USEC),
+			div_u64(from_line, NSEC_PER_USEC),
+			div_u64(from_all, NSEC_PER_USEC),
+			div_u64(clean, NSEC_PER_USEC));
+	}
+	dma_l1_all_bytes = l1;
+	dma_l2_all_bytes = l2;
+
+	free_pages((unsigned long)buf, BUF_ORDER);
+	return -EAGAIN;
+}
+module_init(dma_cache_speed_init);
+MODULE_LICENSE("GPL");
@@ -12,6 +12,7 @@
 #include <linux/types.h>
 #include <linux/cpu.h>
 #include <linux/kernel.h>
+#include <linux/hardirq.h>
 #include <linux/notifier.h>
 #include <linux/signal.h>
 #include <linux/sched.h>
@@ -19,6 +20,7 @@
 #include <linux/init.h>
 
 #include <asm/cputype.h>
+#include <asm/neon.h>
 #include <asm/thread_notify.h>
 #include <asm/vfp.h>
 #include <asm/cpu_pm.h>
@@ -544,6 +546,50 @@ void vfp_flush_hwstate(struct thread_info *thread)
 	put_cpu();
 }
 
+#ifdef CONFIG_KERNEL_MODE_NEON
+
+/*
+ * Kernel mode NEON is only allowed outside interrupt context, with
+ * preemption disabled, so the kernel's NEON registers never have to be
+ * preserved.  Only the user state that may still be live in the
+ * hardware is saved; it is reloaded lazily on the next VFP trap.
+ */
+void kernel_neon_begin(void)
+{
+	struct thread_info *thread = current_thread_info();
+	unsigned int cpu;
+	u32 fpexc;
+
+	BUG_ON(in_interrupt());
+	cpu = get_cpu();
+
+	fpexc = fmrx(FPEXC) | FPEXC_EN;
+	fmxr(FPEXC, fpexc);
+
+	if (vfp_current_hw_state[cpu] == &thread->vfpstate
+#ifdef CONFIG_SMP
+	    && thread->vfpstate.hard.cpu == cpu
+#endif
+	    )
+		vfp_save_state(&thread->vfpstate, fpexc);
+#ifndef CONFIG_SMP
+	/* on UP the owner may be a thread other than current */
+	else if (vfp_current_hw_state[cpu])
+		vfp_save_state(vfp_current_hw_state[cpu], fpexc);
+#endif
+	vfp_current_hw_state[cpu] = NULL;
+}
+EXPORT_SYMBOL(kernel_neon_begin);
+
+void kernel_neon_end(void)
+{
+	fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
+	put_cpu();
+}
+EXPORT_SYMBOL(kernel_neon_end);
+
+#endif /* CONFIG_KERNEL_MODE_NEON */
+
 /*
  * VFP hardware can lose all context when a CPU goes offline.
  * As we will be running in SMP mode with CPU hotplug, we will save the
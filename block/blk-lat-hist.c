@@ -0,0 +1,149 @@
+/*
+ * Per-queue request latency histograms
+ *
+ * For every request completed on a queue, the time it waited from
+ * allocation until the driver took it (queue) and the time from there to
+ * completion (service) are counted in log2 buckets of microseconds, per
+ * class of request.  The buckets are per-cpu and summed when read through
+ * /sys/block/<disk>/queue/latency_hist.  Writing 0 there clears them.
+ */
+#include <linux/kernel.h>
+#include <linux/blkdev.h>
+#include <linux/percpu.h>
+#include <linux/math64.h>
+
+#include "blk.h"
+
+struct blk_lat_hist {
+	unsigned int queue[BLK_LAT_NR_CLASSES][BLK_LAT_BUCKETS];
+	unsigned int service[BLK_LAT_NR_CLASSES][BLK_LAT_BUCKETS];
+};
+
+static const char *blk_lat_class_names[BLK_LAT_NR_CLASSES] = {
+	[BLK_LAT_READ]		= "read",
+	[BLK_LAT_WRITE]		= "write",
+	[BLK_LAT_SYNC_WRITE]	= "sync_write",
+	[BLK_LAT_DISCARD]	= "discard",
+	[BLK_LAT_FLUSH]		= "flush",
+};
+
+void blk_lat_hist_init(struct request_queue *q)
+{
+	/* Without the buckets the queue just isn't accounted */
+	q->lat_hist = alloc_percpu(struct blk_lat_hist);
+}
+
+void blk_lat_hist_exit(struct request_queue *q)
+{
+	free_percpu(q->lat_hist);
+}
+
+static int blk_lat_class(struct request *rq)
+{
+	if (rq == &rq->q->flush_rq)
+		return BLK_LAT_FLUSH;
+	if (rq->cmd_flags & REQ_DISCARD)
+		return BLK_LAT_DISCARD;
+	if (rq_data_dir(rq) == READ)
+		return BLK_LAT_READ;
+	if (rq->cmd_flags & REQ_SYNC)
+		return BLK_LAT_SYNC_WRITE;
+	return BLK_LAT_WRITE;
+}
+
+/* Bucket b holds [2^(b-1), 2^b) us, bucket 0 anything under 1us */
+static int blk_lat_bucket(u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+
+	if (us >= 1ULL << (BLK_LAT_BUCKETS - 2))
+		return BLK_LAT_BUCKETS - 1;
+	return fls((unsigned long)us);
+}
+
+/* Called with the queue lock held, from blk_account_io_done() */
+void blk_lat_hist_account(struct request *rq)
+{
+	struct request_queue *q = rq->q;
+	u64 start = rq_start_time_ns(rq);
+	u64 io_start = rq_io_start_time_ns(rq);
+	u64 now;
+	int class;
+
+	if (!q->lat_hist || rq->cmd_type != REQ_TYPE_FS)
+		return;
+	/* Requests that never reached the driver, like an empty preflush */
+	if (!start || !io_start || io_start < start)
+		return;
+
+	now = sched_clock();
+	if (now < io_start)
+		return;
+
+	class = blk_lat_class(rq);
+	this_cpu_inc(q->lat_hist->queue[class][blk_lat_bucket(io_start - start)]);
+	this_cpu_inc(q->lat_hist->service[class][blk_lat_bucket(now - io_start)]);
+}
+
+static int blk_lat_show_row(char *page, int len, const char *class,
+			    const char *stage, unsigned long *count)
+{
+	int b;
+
+	len += snprintf(page + len, PAGE_SIZE - len, "%s %s", class, stage);
+	for (b = 0; b < BLK_LAT_BUCKETS; b++)
+		len += snprintf(page + len, PAGE_SIZE - len, " %lu", count[b]);
+	len += snprintf(page + len, PAGE_SIZE - len, "\n");
+	return len;
+}
+
+ssize_t blk_lat_hist_show(struct request_queue *q, char *page)
+{
+	unsigned long queue[BLK_LAT_BUCKETS], service[BLK_LAT_BUCKETS];
+	int class, cpu, b, len;
+
+	if (!q->lat_hist)
+		return -ENOMEM;
+
+	len = snprintf(page, PAGE_SIZE, "usecs 0");
+	for (b = 1; b < BLK_LAT_BUCKETS; b++)
+		len += snprintf(page + len, PAGE_SIZE - len, " %lu",
+				1UL << (b - 1));
+	len += snprintf(page + len, PAGE_SIZE - len, "\n");
+
+	for (class = 0; class < BLK_LAT_NR_CLASSES; class++) {
+		memset(queue, 0, sizeof(queue));
+		memset(service, 0, sizeof(service));
+		for_each_possible_cpu(cpu) {
+			struct blk_lat_hist *h = per_cpu_ptr(q->lat_hist, cpu);
+
+			for (b = 0; b < BLK_LAT_BUCKETS; b++) {
+				queue[b] += h->queue[class][b];
+				service[b] += h->service[class][b];
+			}
+		}
+		len = blk_lat_show_row(page, len, blk_lat_class_names[class],
+				       "queue", queue);
+		len = blk_lat_show_row(page, len, blk_lat_class_names[class],
+				       "service", service);
+	}
+	return len;
+}
+
+ssize_t blk_lat_hist_store(struct request_queue *q, const char *page,
+			   size_t count)
+{
+	unsigned long val;
+	int cpu;
+
+	if (strict_strtoul(page, 10, &val) || val)
+		return -EINVAL;
+	if (!q->lat_hist)
+		return -ENOMEM;
+
+	/* Counts racing with the reset may survive it, that is fine */
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(q->lat_hist, cpu), 0,
+		       sizeof(struct blk_lat_hist));
+	return count;
+}
@@ -118,6 +118,31 @@ static inline int blk_should_fake_timeout(struct request_queue *q)
 }
 #endif
 
+#ifdef CONFIG_BLK_DEV_LATENCY_HIST
+enum {
+	BLK_LAT_READ,
+	BLK_LAT_WRITE,
+	BLK_LAT_SYNC_WRITE,
+	BLK_LAT_DISCARD,
+	BLK_LAT_FLUSH,
+	BLK_LAT_NR_CLASSES,
+};
+
+/* 1us .. 4s in powers of two */
+#define BLK_LAT_BUCKETS		24
+
+void blk_lat_hist_init(struct request_queue *q);
+void blk_lat_hist_exit(struct request_queue *q);
+void blk_lat_hist_account(struct request *rq);
+ssize_t blk_lat_hist_show(struct request_queue *q, char *page);
+ssize_t blk_lat_hist_store(struct request_queue *q, const char *page,
+			   size_t count);
+#else
+static inline void blk_lat_hist_init(struct request_queue *q) { }
+static inline void blk_lat_hist_exit(struct request_queue *q) { }
+static inline void blk_lat_hist_account(struct request *rq) { }
+#endif
+
 struct io_context *current_io_context(gfp_t gfp_flags, int node);
 
 int ll_back_merge_fn(struct request_queue *q, struct request *req,
@@ -0,0 +1,369 @@
+/*
+ *  Flash i/o scheduler.
+ *
+ *  Based on the deadline i/o scheduler, Copyright (C) 2002 Jens Axboe.
+ *
+ *  Flash storage has no seek penalty, so requests are not sorted by sector
+ *  and the queue is never idled.  Requests are kept in per-class fifos and
+ *  served by class priority, with both an expiry time and a starvation
+ *  count bounding how long a class can be passed over.
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/cgroup.h>
+
+/*
+ * See Documentation/block/flash-iosched.txt
+ */
+enum flash_class {
+	FLASH_FG_READ,		/* reads of the foreground cpu cgroup */
+	FLASH_READ,		/* other reads, which are always sync */
+	FLASH_SYNC_WRITE,	/* writes somebody waits on */
+	FLASH_ASYNC,		/* background writeback */
+	FLASH_NR_CLASSES,
+};
+
+static const int fifo_expire[FLASH_NR_CLASSES] = {
+	HZ / 10,		/* fg_read_expire */
+	HZ / 4,			/* read_expire */
+	HZ / 2,			/* sync_write_expire */
+	5 * HZ,			/* async_expire */
+};
+
+/* max times a class can be passed over while it has requests queued */
+static const int fifo_starved[FLASH_NR_CLASSES] = {
+	0,			/* nothing is above foreground reads */
+	4,			/* read_starved */
+	4,			/* sync_write_starved */
+	8,			/* async_starved */
+};
+
+struct flash_data {
+	/*
+	 * run time data
+	 */
+	struct list_head fifo_list[FLASH_NR_CLASSES];
+	unsigned int starved[FLASH_NR_CLASSES];
+
+	/*
+	 * settings that change how the i/o scheduler behaves
+	 */
+	int fifo_expire[FLASH_NR_CLASSES];
+	int fifo_starved[FLASH_NR_CLASSES];
+	int fg_boost;
+
+	/* last dispatch was an expired request below the first class */
+	int expired_last;
+};
+
+#define RQ_FG(rq)		((rq)->elevator_private[0])
+#define RQ_CLASS(rq)		((unsigned long) (rq)->elevator_private[1])
+#define RQ_SET_CLASS(rq, c)	((rq)->elevator_private[1] = (void *) (c))
+
+/*
+ * Android keeps the foreground app in the root cpu cgroup and moves the
+ * background ones to a child group, bg_non_interactive.
+ */
+static bool flash_task_is_fg(struct task_struct *tsk)
+{
+#ifdef CONFIG_CGROUP_SCHED
+	bool fg;
+
+	rcu_read_lock();
+	fg = !task_cgroup(tsk, cpu_cgroup_subsys_id)->parent;
+	rcu_read_unlock();
+	return fg;
+#else
+	return false;
+#endif
+}
+
+/*
+ * requests are allocated in the context of the submitter, so tag them here
+ */
+static int
+flash_set_request(struct request_queue *q, struct request *rq, gfp_t gfp_mask)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	RQ_FG(rq) = (fd->fg_boost && flash_task_is_fg(current)) ? rq : NULL;
+	return 0;
+}
+
+static enum flash_class flash_rq_class(struct request *rq)
+{
+	if (rq_data_dir(rq) == READ)
+		return RQ_FG(rq) ? FLASH_FG_READ : FLASH_READ;
+	if (rq_is_sync(rq))
+		return FLASH_SYNC_WRITE;
+	return FLASH_ASYNC;
+}
+
+/*
+ * add rq to the fifo of its class
+ */
+static void
+flash_add_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	enum flash_class class = flash_rq_class(rq);
+
+	RQ_SET_CLASS(rq, class);
+	rq_set_fifo_time(rq, jiffies + fd->fifo_expire[class]);
+	list_add_tail(&rq->queuelist, &fd->fifo_list[class]);
+}
+
+static void
+flash_merged_requests(struct request_queue *q, struct request *req,
+		      struct request *next)
+{
+	/*
+	 * if next expires before rq, assign its expire time to rq
+	 * and move into next position (next will be deleted) in fifo
+	 */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist) &&
+	    RQ_CLASS(req) == RQ_CLASS(next)) {
+		if (time_before(rq_fifo_time(next), rq_fifo_time(req))) {
+			list_move(&req->queuelist, &next->queuelist);
+			rq_set_fifo_time(req, rq_fifo_time(next));
+		}
+	}
+
+	/*
+	 * kill knowledge of next, this one is a goner
+	 */
+	rq_fifo_clear(next);
+}
+
+static inline int flash_check_fifo(struct flash_data *fd, int class)
+{
+	struct request *rq = rq_entry_fifo(fd->fifo_list[class].next);
+
+	return time_after(jiffies, rq_fifo_time(rq));
+}
+
+/*
+ * flash_dispatch_requests picks the class to serve:
+ *  1. the most important class with an expired request, though a lower
+ *     class jumps the queue this way only every other dispatch,
+ *  2. the most important class that has been starved too often,
+ *  3. the most important class with requests.
+ */
+static int flash_dispatch_requests(struct request_queue *q, int force)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct request *rq;
+	int class, first = -1, expired = -1;
+
+	for (class = 0; class < FLASH_NR_CLASSES; class++) {
+		if (list_empty(&fd->fifo_list[class]))
+			continue;
+		if (first < 0)
+			first = class;
+		if (flash_check_fifo(fd, class)) {
+			expired = class;
+			break;
+		}
+	}
+
+	if (first < 0)
+		return 0;
+
+	if (expired > first && !fd->expired_last) {
+		fd->expired_last = 1;
+		class = expired;
+		goto dispatch_request;
+	}
+	fd->expired_last = 0;
+
+	for (class = first + 1; class < FLASH_NR_CLASSES; class++) {
+		if (!list_empty(&fd->fifo_list[class]) &&
+		    fd->starved[class] >= fd->fifo_starved[class])
+			goto dispatch_request;
+	}
+	class = first;
+
+dispatch_request:
+	fd->starved[class] = 0;
+	for (first = class + 1; first < FLASH_NR_CLASSES; first++)
+		if (!list_empty(&fd->fifo_list[first]))
+			fd->starved[first]++;
+
+	rq = rq_entry_fifo(fd->fifo_list[class].next);
+	rq_fifo_clear(rq);
+	elv_dispatch_add_tail(q, rq);
+	return 1;
+}
+
+static struct request *
+flash_former_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	if (rq->queuelist.prev == &fd->fifo_list[RQ_CLASS(rq)])
+		return NULL;
+	return rq_entry_fifo(rq->queuelist.prev);
+}
+
+static struct request *
+flash_latter_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	if (rq->queuelist.next == &fd->fifo_list[RQ_CLASS(rq)])
+		return NULL;
+	return rq_entry_fifo(rq->queuelist.next);
+}
+
+static void flash_exit_queue(struct elevator_queue *e)
+{
+	struct flash_data *fd = e->elevator_data;
+	int class;
+
+	for (class = 0; class < FLASH_NR_CLASSES; class++)
+		BUG_ON(!list_empty(&fd->fifo_list[class]));
+
+	kfree(fd);
+}
+
+/*
+ * initialize elevator private data (flash_data).
+ */
+static void *flash_init_queue(struct request_queue *q)
+{
+	struct flash_data *fd;
+	int class;
+
+	fd = kmalloc_node(sizeof(*fd), GFP_KERNEL | __GFP_ZERO, q->node);
+	if (!fd)
+		return NULL;
+
+	for (class = 0; class < FLASH_NR_CLASSES; class++) {
+		INIT_LIST_HEAD(&fd->fifo_list[class]);
+		fd->fifo_expire[class] = fifo_expire[class];
+		fd->fifo_starved[class] = fifo_starved[class];
+	}
+	fd->fg_boost = 1;
+	return fd;
+}
+
+/*
+ * sysfs parts below
+ */
+
+static ssize_t
+flash_var_show(int var, char *page)
+{
+	return sprintf(page, "%d\n", var);
+}
+
+static ssize_t
+flash_var_store(int *var, const char *page, size_t count)
+{
+	char *p = (char *) page;
+
+	*var = simple_strtol(p, &p, 10);
+	return count;
+}
+
+#define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data = __VAR;						\
+	if (__CONV)							\
+		__data = jiffies_to_msecs(__data);			\
+	return flash_var_show(__data, (page));				\
+}
+SHOW_FUNCTION(flash_fg_read_expire_show, fd->fifo_expire[FLASH_FG_READ], 1);
+SHOW_FUNCTION(flash_read_expire_show, fd->fifo_expire[FLASH_READ], 1);
+SHOW_FUNCTION(flash_sync_write_expire_show, fd->fifo_expire[FLASH_SYNC_WRITE], 1);
+SHOW_FUNCTION(flash_async_expire_show, fd->fifo_expire[FLASH_ASYNC], 1);
+SHOW_FUNCTION(flash_read_starved_show, fd->fifo_starved[FLASH_READ], 0);
+SHOW_FUNCTION(flash_sync_write_starved_show, fd->fifo_starved[FLASH_SYNC_WRITE], 0);
+SHOW_FUNCTION(flash_async_starved_show, fd->fifo_starved[FLASH_ASYNC], 0);
+SHOW_FUNCTION(flash_fg_boost_show, fd->fg_boost, 0);
+#undef SHOW_FUNCTION
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)	\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data;							\
+	int ret = flash_var_store(&__data, (page), count);		\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	if (__CONV)							\
+		*(__PTR) = msecs_to_jiffies(__data);			\
+	else								\
+		*(__PTR) = __data;					\
+	return ret;							\
+}
+STORE_FUNCTION(flash_fg_read_expire_store, &fd->fifo_expire[FLASH_FG_READ], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_read_expire_store, &fd->fifo_expire[FLASH_READ], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_sync_write_expire_store, &fd->fifo_expire[FLASH_SYNC_WRITE], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_async_expire_store, &fd->fifo_expire[FLASH_ASYNC], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_read_starved_store, &fd->fifo_starved[FLASH_READ], 1, INT_MAX, 0);
+STORE_FUNCTION(flash_sync_write_starved_store, &fd->fifo_starved[FLASH_SYNC_WRITE], 1, INT_MAX, 0);
+STORE_FUNCTION(flash_async_starved_store, &fd->fifo_starved[FLASH_ASYNC], 1, INT_MAX, 0);
+STORE_FUNCTION(flash_fg_boost_store, &fd->fg_boost, 0, 1, 0);
+#undef STORE_FUNCTION
+
+#define FD_ATTR(name) \
+	__ATTR(name, S_IRUGO|S_IWUSR, flash_##name##_show, \
+				      flash_##name##_store)
+
+static struct elv_fs_entry flash_attrs[] = {
+	FD_ATTR(fg_read_expire),
+	FD_ATTR(read_expire),
+	FD_ATTR(sync_write_expire),
+	FD_ATTR(async_expire),
+	FD_ATTR(read_starved),
+	FD_ATTR(sync_write_starved),
+	FD_ATTR(async_starved),
+	FD_ATTR(fg_boost),
+	__ATTR_NULL
+};
+
+static struct elevator_type iosched_flash = {
+	.ops = {
+		.elevator_merge_req_fn =	flash_merged_requests,
+		.elevator_dispatch_fn =		flash_dispatch_requests,
+		.elevator_add_req_fn =		flash_add_request,
+		.elevator_former_req_fn =	flash_former_request,
+		.elevator_latter_req_fn =	flash_latter_request,
+		.elevator_set_req_fn =		flash_set_request,
+		.elevator_init_fn =		flash_init_queue,
+		.elevator_exit_fn =		flash_exit_queue,
+	},
+
+	.elevator_attrs = flash_attrs,
+	.elevator_name = "flash",
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init flash_init(void)
+{
+	elv_register(&iosched_flash);
+
+	return 0;
+}
+
+static void __exit flash_exit(void)
+{
+	elv_unregister(&iosched_flash);
+}
+
+module_init(flash_init);
+module_exit(flash_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("flash IO scheduler");
@@ -33,6 +33,9 @@
 #include <linux/jiffies.h>
 #include <linux/timex.h>
 #include <linux/interrupt.h>
+#include <linux/kthread.h>
+#include <linux/cpu.h>
+#include <linux/slab.h>
 #include "tcrypt.h"
 #include "internal.h"
 
@@ -52,6 +55,11 @@
  */
 static unsigned int sec;
 
+/*
+ * Used by test_dmcrypt_speed()
+ */
+static char *offload = "cbc-aes-tegra";
+
 static char *alg = NULL;
 static u32 type;
 static u32 mask;
@@ -719,6 +727,205 @@ out:
 	crypto_free_ahash(tfm);
 }
 
+/*
+ * dm-crypt shaped load: one request per 512 byte sector, each with its
+ * own plain64 IV, DMCRYPT_DEPTH of them in flight on one tfm, which is
+ * how kcryptd drives the cipher. Run from one thread, or from one
+ * thread per online cpu as the parallel kcryptd workers do.
+ */
+#define DMCRYPT_SECTOR	512
+#define DMCRYPT_DEPTH	32
+#define DMCRYPT_IV_MAX	16
+
+struct dmcrypt_speed {
+	struct crypto_ablkcipher *tfm;
+	int enc;
+	unsigned long end;
+	u64 bytes;
+	int err;
+	atomic_t pending;
+	struct completion batch;
+	struct completion done;
+};
+
+static void dmcrypt_speed_complete(struct crypto_async_request *req, int err)
+{
+	struct dmcrypt_speed *s = req->data;
+
+	if (err == -EINPROGRESS)
+		return;
+
+	if (err)
+		s->err = err;
+	if (atomic_dec_and_test(&s->pending))
+		complete(&s->batch);
+}
+
+static int dmcrypt_speed_thread(void *data)
+{
+	struct dmcrypt_speed *s = data;
+	struct ablkcipher_request *req[DMCRYPT_DEPTH] = { };
+	struct scatterlist sg[DMCRYPT_DEPTH];
+	u8 iv[DMCRYPT_DEPTH][DMCRYPT_IV_MAX];
+	unsigned int ivsize = crypto_ablkcipher_ivsize(s->tfm);
+	u64 sector = 0;
+	char *buf;
+	int i, ret;
+
+	buf = kmalloc(DMCRYPT_DEPTH * DMCRYPT_SECTOR, GFP_KERNEL);
+	if (!buf) {
+		s->err = -ENOMEM;
+		goto out;
+	}
+	memset(buf, 0xff, DMCRYPT_DEPTH * DMCRYPT_SECTOR);
+
+	for (i = 0; i < DMCRYPT_DEPTH; i++) {
+		req[i] = ablkcipher_request_alloc(s->tfm, GFP_KERNEL);
+		if (!req[i]) {
+			s->err = -ENOMEM;
+			goto out_free;
+		}
+		ablkcipher_request_set_callback(req[i],
+						CRYPTO_TFM_REQ_MAY_BACKLOG,
+						dmcrypt_speed_complete, s);
+		sg_init_one(&sg[i], buf + i * DMCRYPT_SECTOR, DMCRYPT_SECTOR);
+	}
+
+	while (time_before(jiffies, s->end) && !s->err) {
+		/* the bias keeps the batch open until all are submitted */
+		atomic_set(&s->pending, 1);
+
+		for (i = 0; i < DMCRYPT_DEPTH; i++) {
+			__le64 le = cpu_to_le64(sector++);
+
+			memset(iv[i], 0, ivsize);
+			memcpy(iv[i], &le, min_t(unsigned int, ivsize, 8));
+			ablkcipher_request_set_crypt(req[i], &sg[i], &sg[i],
+						     DMCRYPT_SECTOR, iv[i]);
+
+			atomic_inc(&s->pending);
+			if (s->enc == ENCRYPT)
+				ret = crypto_ablkcipher_encrypt(req[i]);
+			else
+				ret = crypto_ablkcipher_decrypt(req[i]);
+			if (ret == -EINPROGRESS || ret == -EBUSY)
+				continue;
+
+			atomic_dec(&s->pending);
+			if (ret) {
+				s->err = ret;
+				break;
+			}
+		}
+
+		if (!atomic_dec_and_test(&s->pending))
+			wait_for_completion(&s->batch);
+		INIT_COMPLETION(s->batch);
+
+		s->bytes += i * DMCRYPT_SECTOR;
+		cond_resched();
+	}
+
+out_free:
+	for (i = 0; i < DMCRYPT_DEPTH; i++)
+		ablkcipher_request_free(req[i]);
+	kfree(buf);
+out:
+	complete(&s->done);
+	return 0;
+}
+
+static void test_dmcrypt_speed(const char *algo, int enc, unsigned int sec,
+			       unsigned int keylen, bool all_cpus)
+{
+	struct crypto_ablkcipher *tfm;
+	struct dmcrypt_speed *s;
+	bool *started;
+	unsigned int cpu, threads = 0;
+	u64 bytes = 0;
+	int err = 0;
+
+	if (!sec)
+		sec = 1;
+
+	tfm = crypto_alloc_ablkcipher(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_err("failed to load transform for %s: %ld\n", algo,
+		       PTR_ERR(tfm));
+		return;
+	}
+
+	printk(KERN_INFO "\ntesting dm-crypt speed of %s (%s) %s, "
+	       "%u bit key, %s\n", algo,
+	       crypto_tfm_alg_driver_name(crypto_ablkcipher_tfm(tfm)),
+	       enc == ENCRYPT ? "encryption" : "decryption", keylen * 8,
+	       all_cpus ? "all cpus" : "one thread");
+
+	if (crypto_ablkcipher_ivsize(tfm) > DMCRYPT_IV_MAX) {
+		pr_err("ivsize %u too big\n", crypto_ablkcipher_ivsize(tfm));
+		goto out;
+	}
+
+	memset(tvmem[0], 0xff, PAGE_SIZE);
+	if (crypto_ablkcipher_setkey(tfm, tvmem[0], keylen)) {
+		pr_err("setkey() failed flags=%x\n",
+		       crypto_ablkcipher_get_flags(tfm));
+		goto out;
+	}
+
+	s = kcalloc(nr_cpu_ids, sizeof(*s), GFP_KERNEL);
+	started = kcalloc(nr_cpu_ids, sizeof(*started), GFP_KERNEL);
+	if (!s || !started)
+		goto out_free;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		struct task_struct *t;
+
+		s[cpu].tfm = tfm;
+		s[cpu].enc = enc;
+		s[cpu].end = jiffies + sec * HZ;
+		init_completion(&s[cpu].batch);
+		init_completion(&s[cpu].done);
+
+		t = kthread_create(dmcrypt_speed_thread, &s[cpu],
+				   "tcrypt/%u", cpu);
+		if (IS_ERR(t))
+			continue;
+		if (all_cpus)
+			kthread_bind(t, cpu);
+		wake_up_process(t);
+		started[cpu] = true;
+		threads++;
+		if (!all_cpus)
+			break;
+	}
+	put_online_cpus();
+
+	for (cpu = 0; cpu < nr_cpu_ids; cpu++) {
+		if (!started[cpu])
+			continue;
+		wait_for_completion(&s[cpu].done);
+		bytes += s[cpu].bytes;
+		if (s[cpu].err)
+			err = s[cpu].err;
+	}
+
+	if (err)
+		pr_err("%s() failed: %d\n",
+		       enc == ENCRYPT ? "encrypt" : "decrypt", err);
+	else
+		printk(KERN_INFO "%u threads, %llu bytes in %u seconds, "
+		       "%llu KB/s\n", threads, (unsigned long long)bytes, sec,
+		       (unsigned long long)div_u64(bytes, sec * 1024));
+
+out_free:
+	kfree(started);
+	kfree(s);
+out:
+	crypto_free_ablkcipher(tfm);
+}
+
 static void test_available(void)
 {
 	char **name = check;
@@ -1087,6 +1294,24 @@ static int do_test(int m)
 				  speed_template_16_32);
 		break;
 
+	case 210:
+		/* fall through */
+
+	case 211:
+		test_dmcrypt_speed("cbc(aes)", ENCRYPT, sec, 16, false);
+		test_dmcrypt_speed("cbc(aes)", DECRYPT, sec, 16, false);
+		test_dmcrypt_speed("cbc(aes)", ENCRYPT, sec, 16, true);
+		test_dmcrypt_speed("cbc(aes)", DECRYPT, sec, 16, true);
+		if (mode == 211)
+			break;
+
+	case 212:
+		test_dmcrypt_speed(offload, ENCRYPT, sec, 16, false);
+		test_dmcrypt_speed(offload, DECRYPT, sec, 16, false);
+		test_dmcrypt_speed(offload, ENCRYPT, sec, 16, true);
+		test_dmcrypt_speed(offload, DECRYPT, sec, 16, true);
+		break;
+
 	case 300:
 		/* fall through */
 
@@ -1305,6 +1530,9 @@ module_param(type, uint, 0);
 module_param(mask, uint, 0);
 module_param(mode, int, 0);
 module_param(sec, uint, 0);
+module_param(offload, charp, 0);
+MODULE_PARM_DESC(offload, "Cipher driver for the dm-crypt offload speed "
+			  "test (mode 212)");
 MODULE_PARM_DESC(sec, "Length in seconds of speed tests "
 		      "(defaults to zero which uses CPU cycles instead)");
 
@@ -1715,6 +1715,15 @@ static const struct alg_test_desc alg_test_descs[] = {
 				.count = CMAC_AES_TEST_VECTORS
 			}
 		}
+	}, {
+		.alg = "crc32",
+		.test = alg_test_hash,
+		.suite = {
+			.hash = {
+				.vecs = crc32_tv_template,
+				.count = CRC32_TEST_VECTORS
+			}
+		}
 	}, {
 		.alg = "crc32c",
 		.test = alg_test_crc32c,
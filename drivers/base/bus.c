@@ -16,6 +16,7 @@
 #include <linux/slab.h>
 #include <linux/init.h>
 #include <linux/string.h>
+#include <linux/async.h>
 #include "base.h"
 #include "power/power.h"
 
@@ -648,7 +649,7 @@ int bus_add_driver(struct device_driver *drv)
 	if (error)
 		goto out_unregister;
 
-	if (drv->bus->p->drivers_autoprobe) {
+	if (drv->bus->p->drivers_autoprobe && !driver_attach_async(drv)) {
 		error = driver_attach(drv);
 		if (error)
 			goto out_unregister;
@@ -708,6 +709,9 @@ void bus_remove_driver(struct device_driver *drv)
 	driver_remove_file(drv, &driver_attr_uevent);
 	klist_remove(&drv->p->knode_bus);
 	pr_debug("bus: '%s': remove driver %s\n", drv->bus->name, drv->name);
+	/* an attach from bus_add_driver() may still be running */
+	if (drv->async_probe)
+		async_synchronize_full();
 	driver_detach(drv);
 	module_remove_driver(drv);
 	kobject_put(&drv->p->kobj);
@@ -24,6 +24,7 @@
 #include <linux/wait.h>
 #include <linux/async.h>
 #include <linux/pm_runtime.h>
+#include <linux/boot_report.h>
 
 #include "base.h"
 #include "power/power.h"
@@ -107,6 +108,7 @@ static DECLARE_WAIT_QUEUE_HEAD(probe_waitqueue);
 
 static int really_probe(struct device *dev, struct device_driver *drv)
 {
+	u64 start = boot_report_clock();
 	int ret = 0;
 
 	atomic_inc(&probe_count);
@@ -121,15 +123,13 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 		goto probe_failed;
 	}
 
-	if (dev->bus->probe) {
+	if (dev->bus->probe)
 		ret = dev->bus->probe(dev);
-		if (ret)
-			goto probe_failed;
-	} else if (drv->probe) {
+	else if (drv->probe)
 		ret = drv->probe(dev);
-		if (ret)
-			goto probe_failed;
-	}
+	boot_report_probe(dev, drv, ret, start);
+	if (ret)
+		goto probe_failed;
 
 	driver_bound(dev);
 	ret = 1;
@@ -311,6 +311,33 @@ int driver_attach(struct device_driver *drv)
 }
 EXPORT_SYMBOL_GPL(driver_attach);
 
+static bool async_probe_enabled = true;
+core_param(async_probe, async_probe_enabled, bool, 0644);
+
+static void driver_attach_async_fn(void *data, async_cookie_t cookie)
+{
+	driver_attach(data);
+}
+
+/**
+ * driver_attach_async - bind a newly registered driver from an async thread
+ * @drv: driver.
+ *
+ * Only during boot, and only for drivers with async_probe set; returns
+ * false if the caller has to run driver_attach() itself.  The probes
+ * overlap the initcalls that follow and each other.  Init is not started
+ * before they are done, and neither is the root fs looked for, see
+ * wait_for_device_probe().
+ */
+bool driver_attach_async(struct device_driver *drv)
+{
+	if (!drv->async_probe || !async_probe_enabled ||
+	    system_state != SYSTEM_BOOTING)
+		return false;
+	async_schedule(driver_attach_async_fn, drv);
+	return true;
+}
+
 /*
  * __device_release_driver() must be called with @dev lock held.
  * When called for a USB interface, @dev->parent lock must be held as well.
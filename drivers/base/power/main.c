@@ -513,11 +513,13 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 {
 	int error = 0;
 	bool put = false;
+	ktime_t starttime;
 
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
 
 	dpm_wait(dev->parent, async);
+	starttime = ktime_get();
 	device_lock(dev);
 
 	/*
@@ -571,6 +573,8 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 
  Unlock:
 	device_unlock(dev);
+	if (put)
+		suspend_time_device(dev, true, starttime);
 	complete_all(&dev->power.completion);
 
 	TRACE_RESUME(error);
@@ -882,8 +886,10 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	int error = 0;
 	struct timer_list timer;
 	struct dpm_drv_wd_data data;
+	ktime_t starttime;
 
 	dpm_wait_for_children(dev, async);
+	starttime = ktime_get();
 
 	data.dev = dev;
 	data.tsk = get_current();
@@ -946,6 +952,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	dev->power.is_suspended = !error;
 
 	device_unlock(dev);
+	suspend_time_device(dev, false, starttime);
 
 	del_timer_sync(&timer);
 	destroy_timer_on_stack(&timer);
@@ -25,6 +25,11 @@
 #include <linux/slab.h>
 #include <linux/input.h>
 #include <linux/time.h>
+#include <linux/pm_qos_params.h>
+#include <linux/mutex.h>
+#include <linux/tick.h>
+#include <linux/math64.h>
+#include <linux/touch_latency.h>
 
 struct cpu_sync {
 	struct task_struct *thread;
@@ -34,9 +39,14 @@ struct cpu_sync {
 	int cpu;
 	spinlock_t lock;
 	bool pending;
-	int src_cpu;
+	unsigned long src_mask;
 	unsigned int boost_min;
 	unsigned int input_boost_min;
+	unsigned long input_boost_end;
+	unsigned int input_boost_step;
+	u64 prev_idle;
+	u64 prev_wall;
+	unsigned int load;
 };
 
 static DEFINE_PER_CPU(struct cpu_sync, sync_info);
@@ -50,13 +60,131 @@ module_param(boost_ms, uint, 0644);
 static unsigned int sync_threshold;
 module_param(sync_threshold, uint, 0644);
 
+/*
+ * Only sync the destination CPU when the source CPU was at least this
+ * busy (in percent) recently, so migrations of idle or trivial tasks
+ * don't raise the destination frequency. 0 syncs on every migration.
+ */
+static unsigned int migration_load_threshold;
+module_param(migration_load_threshold, uint, 0644);
+
+/* Coalesce migrations to one CPU within a tick into one policy update */
+static bool migration_batch;
+module_param(migration_batch, bool, 0644);
+
+#define MIN_LOAD_WINDOW (10 * USEC_PER_MSEC)
+
+/* Migration sync statistics, policy update time in us */
+static unsigned long sync_count;
+module_param(sync_count, ulong, 0444);
+static unsigned long sync_skip_count;
+module_param(sync_skip_count, ulong, 0444);
+static unsigned long sync_update_us;
+module_param(sync_update_us, ulong, 0444);
+static unsigned long sync_update_max_us;
+module_param(sync_update_max_us, ulong, 0444);
+static DEFINE_SPINLOCK(sync_stats_lock);
+
 static unsigned int input_boost_freq;
 module_param(input_boost_freq, uint, 0644);
 
 static unsigned int input_boost_ms = 40;
 module_param(input_boost_ms, uint, 0644);
 
-static u64 last_input_time;
+/*
+ * Minimum number of online CPUs requested for input_boost_cpus_ms
+ * after an input event, so that hotplug has cores ready before the
+ * frame has to be rendered.
+ */
+static unsigned int input_boost_cpus;
+module_param(input_boost_cpus, uint, 0644);
+
+static unsigned int input_boost_cpus_ms = 500;
+module_param(input_boost_cpus_ms, uint, 0644);
+
+static struct pm_qos_request_list input_boost_cpus_req;
+static struct delayed_work input_boost_cpus_rem;
+static DEFINE_MUTEX(input_boost_cpus_lock);
+static unsigned int input_boost_cpus_cur;
+static unsigned long input_boost_cpus_end;
+
+/*
+ * When an input boost expires the floor is lowered in
+ * input_boost_ramp_steps equal steps, input_boost_ramp_ms apart,
+ * instead of being dropped at once.
+ */
+static unsigned int input_boost_ramp_steps = 1;
+module_param(input_boost_ramp_steps, uint, 0644);
+
+static unsigned int input_boost_ramp_ms = 20;
+module_param(input_boost_ramp_ms, uint, 0644);
+
+enum {
+	INPUT_BOOST_TOUCH_DOWN,
+	INPUT_BOOST_TOUCH_MOVE,
+	INPUT_BOOST_KEY,
+	INPUT_BOOST_SENSOR,
+	INPUT_BOOST_CLASS_MAX,
+};
+
+struct input_boost_level {
+	unsigned int freq;
+	unsigned int ms;
+	unsigned int cpus;
+	unsigned int cpus_ms;
+};
+
+/*
+ * Per event class boost levels, written as "freq:ms:cpus" triples in
+ * the order touch-down, touch-move, key, sensor. A class left at 0:0:0
+ * uses input_boost_freq, input_boost_ms and input_boost_cpus.
+ */
+static struct input_boost_level input_boost_table[INPUT_BOOST_CLASS_MAX];
+
+static int input_boost_table_set(const char *buf, const struct kernel_param *kp)
+{
+	struct input_boost_level table[INPUT_BOOST_CLASS_MAX];
+	int i, n, pos = 0;
+
+	memset(table, 0, sizeof(table));
+	for (i = 0; i < INPUT_BOOST_CLASS_MAX; i++) {
+		if (sscanf(buf + pos, "%u:%u:%u%n", &table[i].freq,
+			   &table[i].ms, &table[i].cpus, &n) != 3)
+			break;
+		pos += n;
+	}
+	if (!i)
+		return -EINVAL;
+
+	memcpy(input_boost_table, table, sizeof(table));
+	return 0;
+}
+
+static int input_boost_table_get(char *buf, const struct kernel_param *kp)
+{
+	int i, len = 0;
+
+	for (i = 0; i < INPUT_BOOST_CLASS_MAX; i++)
+		len += sprintf(buf + len, "%u:%u:%u ",
+			       input_boost_table[i].freq,
+			       input_boost_table[i].ms,
+			       input_boost_table[i].cpus);
+	buf[--len] = '\0';
+	return len;
+}
+
+static struct kernel_param_ops input_boost_table_ops = {
+	.set = input_boost_table_set,
+	.get = input_boost_table_get,
+};
+module_param_cb(input_boost_table, &input_boost_table_ops, NULL, 0644);
+
+void __weak arch_cpu_boost_prepare(unsigned int khz)
+{
+}
+
+static unsigned long input_boost_pending;
+static u64 last_input_time[INPUT_BOOST_CLASS_MAX];
 #define MIN_INPUT_INTERVAL (100 * USEC_PER_MSEC)
 
 /*
@@ -112,11 +240,86 @@ static void do_input_boost_rem(struct work_struct *work)
 {
 	struct cpu_sync *s = container_of(work, struct cpu_sync,
 						input_boost_rem.work);
+	unsigned long flags, delay = 0;
+	unsigned int min;
+
+	spin_lock_irqsave(&s->lock, flags);
+	/* The boost was extended since this work was queued */
+	if (s->input_boost_min && time_before(jiffies, s->input_boost_end)) {
+		delay = s->input_boost_end - jiffies;
+		spin_unlock_irqrestore(&s->lock, flags);
+		queue_delayed_work_on(s->cpu, cpu_boost_wq,
+			&s->input_boost_rem, delay);
+		return;
+	}
+
+	if (input_boost_ramp_steps > 1) {
+		if (!s->input_boost_step)
+			s->input_boost_step =
+				s->input_boost_min / input_boost_ramp_steps;
+		min = s->input_boost_min > s->input_boost_step ?
+			s->input_boost_min - s->input_boost_step : 0;
+	} else {
+		min = 0;
+	}
+	s->input_boost_min = min;
+	if (!min)
+		s->input_boost_step = 0;
+	spin_unlock_irqrestore(&s->lock, flags);
 
-	pr_debug("Removing input boost for CPU%d\n", s->cpu);
-	s->input_boost_min = 0;
+	pr_debug("Input boost for CPU%d lowered to %u kHz\n", s->cpu, min);
 	/* Force policy re-evaluation to trigger adjust notifier. */
 	cpufreq_update_policy(s->cpu);
+
+	if (min)
+		queue_delayed_work_on(s->cpu, cpu_boost_wq, &s->input_boost_rem,
+			msecs_to_jiffies(input_boost_ramp_ms));
+}
+
+static void do_input_boost_cpus_rem(struct work_struct *work)
+{
+	mutex_lock(&input_boost_cpus_lock);
+	if (time_before(jiffies, input_boost_cpus_end)) {
+		queue_delayed_work(cpu_boost_wq, &input_boost_cpus_rem,
+			input_boost_cpus_end - jiffies);
+	} else {
+		pr_debug("Removing input min online CPUs request\n");
+		input_boost_cpus_cur = 0;
+		pm_qos_update_request(&input_boost_cpus_req,
+				      PM_QOS_DEFAULT_VALUE);
+	}
+	mutex_unlock(&input_boost_cpus_lock);
+}
+
+/*
+ * Busy percentage of @cpu since the last time it was sampled. Samples
+ * closer together than MIN_LOAD_WINDOW reuse the previous result.
+ */
+static unsigned int boost_get_cpu_load(unsigned int cpu)
+{
+	struct cpu_sync *s = &per_cpu(sync_info, cpu);
+	u64 cur_idle, cur_wall, idle, wall;
+	unsigned long flags;
+
+	spin_lock_irqsave(&s->lock, flags);
+	cur_idle = get_cpu_idle_time_us(cpu, &cur_wall);
+	if (cur_idle == -1ULL) {
+		/* No idle accounting: treat every migration as loaded */
+		s->load = 100;
+		goto out;
+	}
+
+	wall = cur_wall - s->prev_wall;
+	if (wall < MIN_LOAD_WINDOW)
+		goto out;
+
+	idle = cur_idle - s->prev_idle;
+	s->prev_idle = cur_idle;
+	s->prev_wall = cur_wall;
+	s->load = idle >= wall ? 0 : div64_u64(100 * (wall - idle), wall);
+out:
+	spin_unlock_irqrestore(&s->lock, flags);
+	return s->load;
 }
 
 static int boost_mig_sync_thread(void *data)
@@ -126,7 +329,10 @@ static int boost_mig_sync_thread(void *data)
 	struct cpu_sync *s = &per_cpu(sync_info, dest_cpu);
 	struct cpufreq_policy dest_policy;
 	struct cpufreq_policy src_policy;
-	unsigned long flags;
+	unsigned long flags, src_mask;
+	unsigned int boost_min;
+	ktime_t start;
+	u64 update_us;
 
 	while(1) {
 		wait_event(s->sync_wq, s->pending || kthread_should_stop());
@@ -134,46 +340,78 @@ static int boost_mig_sync_thread(void *data)
 		if (kthread_should_stop())
 			break;
 
+		/*
+		 * Let migrations arriving within the same tick pile up so
+		 * that they cost one policy update instead of several.
+		 */
+		if (migration_batch)
+			schedule_timeout_interruptible(1);
+
 		spin_lock_irqsave(&s->lock, flags);
 		s->pending = false;
-		src_cpu = s->src_cpu;
+		src_mask = s->src_mask;
+		s->src_mask = 0;
 		spin_unlock_irqrestore(&s->lock, flags);
 
-		ret = cpufreq_get_policy(&src_policy, src_cpu);
-		if (ret)
-			continue;
-
 		ret = cpufreq_get_policy(&dest_policy, dest_cpu);
 		if (ret)
 			continue;
 
-		if (src_policy.min == src_policy.cur &&
- 			src_policy.min <= dest_policy.min) {
- 		pr_debug("No sync. CPU%d@%dKHz == min freq@%dKHz\n",
- 			src_cpu, src_policy.cur,
- 			src_policy.min);
+		/* Sync to the fastest loaded source CPU of this batch */
+		boost_min = 0;
+		for_each_set_bit(src_cpu, &src_mask, NR_CPUS) {
+			ret = cpufreq_get_policy(&src_policy, src_cpu);
+			if (ret)
+				continue;
+
+			if (src_policy.min == src_policy.cur &&
+			    src_policy.min <= dest_policy.min) {
+				pr_debug("No sync. CPU%d@%dKHz == min freq@%dKHz\n",
+					src_cpu, src_policy.cur,
+					src_policy.min);
+				continue;
+			}
+
+			if (migration_load_threshold &&
+			    boost_get_cpu_load(src_cpu) <
+						migration_load_threshold) {
+				pr_debug("No sync. CPU%d load below %u%%\n",
+					src_cpu, migration_load_threshold);
+				continue;
+			}
+
+			boost_min = max(boost_min, src_policy.cur);
+		}
+
+		if (!boost_min) {
+			spin_lock_irqsave(&sync_stats_lock, flags);
+			sync_skip_count++;
+			spin_unlock_irqrestore(&sync_stats_lock, flags);
 			continue;
 		}
 
 		cancel_delayed_work_sync(&s->boost_rem);
-		if (sync_threshold) {
-			if (src_policy.cur >= sync_threshold)
-				s->boost_min = sync_threshold;
-			else
-				s->boost_min = src_policy.cur;
-		} else {
-			s->boost_min = src_policy.cur;
-		}
+		if (sync_threshold && boost_min >= sync_threshold)
+			boost_min = sync_threshold;
+		s->boost_min = boost_min;
 		/* Force policy re-evaluation to trigger adjust notifier. */
 		get_online_cpus();
- 	if (cpu_online(dest_cpu)) {
- 		cpufreq_update_policy(dest_cpu);
- 		queue_delayed_work_on(dest_cpu, cpu_boost_wq,
- 			&s->boost_rem, msecs_to_jiffies(boost_ms));
- 	} else {
- 		s->boost_min = 0;
- 	}
- 	put_online_cpus();
+		if (cpu_online(dest_cpu)) {
+			start = ktime_get();
+			cpufreq_update_policy(dest_cpu);
+			update_us = ktime_to_us(ktime_sub(ktime_get(), start));
+			spin_lock_irqsave(&sync_stats_lock, flags);
+			sync_count++;
+			sync_update_us += update_us;
+			if (update_us > sync_update_max_us)
+				sync_update_max_us = update_us;
+			spin_unlock_irqrestore(&sync_stats_lock, flags);
+			queue_delayed_work_on(dest_cpu, cpu_boost_wq,
+				&s->boost_rem, msecs_to_jiffies(boost_ms));
+		} else {
+			s->boost_min = 0;
+		}
+		put_online_cpus();
 	}
 
 	return 0;
@@ -191,7 +429,7 @@ static int boost_migration_notify(struct notifier_block *nb,
 	pr_debug("Migration: CPU%d --> CPU%d\n", (int) arg, (int) dest_cpu);
 	spin_lock_irqsave(&s->lock, flags);
 	s->pending = true;
-	s->src_cpu = (int) arg;
+	s->src_mask |= 1UL << (int) arg;
 	spin_unlock_irqrestore(&s->lock, flags);
 	wake_up(&s->sync_wq);
 
@@ -202,49 +440,142 @@ static struct notifier_block boost_migration_nb = {
 	.notifier_call = boost_migration_notify,
 };
 
+static void input_boost_get_level(unsigned int class,
+				  struct input_boost_level *lvl)
+{
+	if (input_boost_table[class].freq || input_boost_table[class].cpus) {
+		*lvl = input_boost_table[class];
+		lvl->cpus_ms = lvl->ms;
+		return;
+	}
+
+	/* Classes without an entry fall back to the single-level tunables */
+	lvl->freq = input_boost_freq;
+	lvl->ms = input_boost_ms;
+	lvl->cpus = input_boost_cpus;
+	lvl->cpus_ms = input_boost_cpus_ms;
+}
+
+static void do_input_boost_cpus(unsigned int cpus, unsigned int ms)
+{
+	unsigned long end = jiffies + msecs_to_jiffies(ms);
+
+	mutex_lock(&input_boost_cpus_lock);
+	if (time_after(end, input_boost_cpus_end))
+		input_boost_cpus_end = end;
+	if (cpus > input_boost_cpus_cur) {
+		input_boost_cpus_cur = cpus;
+		pm_qos_update_request(&input_boost_cpus_req, cpus);
+	}
+	mutex_unlock(&input_boost_cpus_lock);
+
+	if (!delayed_work_pending(&input_boost_cpus_rem))
+		queue_delayed_work(cpu_boost_wq, &input_boost_cpus_rem,
+			msecs_to_jiffies(ms));
+}
+
 static void do_input_boost(struct work_struct *work)
 {
-	unsigned int i, ret;
+	unsigned int i, class, freq = 0, ms = 0, cpus = 0, cpus_ms = 0;
+	unsigned long pending, end, flags;
+	struct input_boost_level lvl;
 	struct cpu_sync *i_sync_info;
-	struct cpufreq_policy policy;
+	bool raise;
+
+	pending = xchg(&input_boost_pending, 0);
+	for_each_set_bit(class, &pending, INPUT_BOOST_CLASS_MAX) {
+		input_boost_get_level(class, &lvl);
+		freq = max(freq, lvl.freq);
+		ms = max(ms, lvl.ms);
+		cpus = max(cpus, lvl.cpus);
+		cpus_ms = max(cpus_ms, lvl.cpus_ms);
+	}
+
+	if (cpus)
+		do_input_boost_cpus(cpus, cpus_ms);
+
+	if (!freq || !ms)
+		return;
 
+	/*
+	 * A new boost never shortens or lowers one already in progress: the
+	 * floor is raised to the highest requested frequency and the expiry
+	 * is pushed out to the latest requested end.
+	 */
+	end = jiffies + msecs_to_jiffies(ms);
 	get_online_cpus();
 	for_each_online_cpu(i) {
 
 		i_sync_info = &per_cpu(sync_info, i);
-		ret = cpufreq_get_policy(&policy, i);
-		if (ret)
-			continue;
-		if (policy.cur >= input_boost_freq)
-			continue;
 
-		cancel_delayed_work_sync(&i_sync_info->input_boost_rem);
-		i_sync_info->input_boost_min = input_boost_freq;
-		cpufreq_update_policy(i);
-		queue_delayed_work_on(i_sync_info->cpu, cpu_boost_wq,
-			&i_sync_info->input_boost_rem,
-			msecs_to_jiffies(input_boost_ms));
+		spin_lock_irqsave(&i_sync_info->lock, flags);
+		raise = freq > i_sync_info->input_boost_min;
+		if (raise) {
+			i_sync_info->input_boost_min = freq;
+			i_sync_info->input_boost_step = 0;
+		}
+		if (raise || time_after(end, i_sync_info->input_boost_end))
+			i_sync_info->input_boost_end = end;
+		spin_unlock_irqrestore(&i_sync_info->lock, flags);
+
+		if (raise)
+			cpufreq_update_policy(i);
+		if (!delayed_work_pending(&i_sync_info->input_boost_rem))
+			queue_delayed_work_on(i_sync_info->cpu, cpu_boost_wq,
+				&i_sync_info->input_boost_rem,
+				msecs_to_jiffies(ms));
 	}
 	put_online_cpus();
 }
 
+static int input_boost_classify(struct input_handle *handle,
+		unsigned int type, unsigned int code, int value)
+{
+	struct input_dev *dev = handle->dev;
+	bool touch = test_bit(ABS_MT_POSITION_X, dev->absbit) ||
+		test_bit(BTN_TOUCH, dev->keybit);
+
+	switch (type) {
+	case EV_KEY:
+		if (!value)
+			return -EINVAL;
+		if (code == BTN_TOUCH)
+			return INPUT_BOOST_TOUCH_DOWN;
+		return INPUT_BOOST_KEY;
+	case EV_ABS:
+		return touch ? INPUT_BOOST_TOUCH_MOVE : INPUT_BOOST_SENSOR;
+	case EV_SW:
+		return INPUT_BOOST_SENSOR;
+	default:
+		return -EINVAL;
+	}
+}
+
 static void cpuboost_input_event(struct input_handle *handle,
 		unsigned int type, unsigned int code, int value)
 {
+	struct input_boost_level lvl;
+	int class;
 	u64 now;
 
-	if (!input_boost_freq)
+	class = input_boost_classify(handle, type, code, value);
+	if (class < 0)
 		return;
 
-	now = ktime_to_us(ktime_get());
-	if (now - last_input_time < MIN_INPUT_INTERVAL)
+	input_boost_get_level(class, &lvl);
+	if (!lvl.freq && !lvl.cpus)
 		return;
 
-	if (work_pending(&input_boost_work))
+	now = ktime_to_us(ktime_get());
+	if (now - last_input_time[class] < MIN_INPUT_INTERVAL)
 		return;
 
+	last_input_time[class] = now;
+	set_bit(class, &input_boost_pending);
+	if (lvl.freq)
+		arch_cpu_boost_prepare(lvl.freq);
 	queue_work(cpu_boost_wq, &input_boost_work);
-	last_input_time = ktime_to_us(ktime_get());
+	touch_latency_mark(TOUCH_LAT_BOOST);
 }
 
 static int cpuboost_input_connect(struct input_handler *handler,
@@ -309,6 +640,9 @@ static int cpu_boost_init(void)
 		return -EFAULT;
 
 	INIT_WORK(&input_boost_work, do_input_boost);
+	INIT_DELAYED_WORK(&input_boost_cpus_rem, do_input_boost_cpus_rem);
+	pm_qos_add_request(&input_boost_cpus_req, PM_QOS_MIN_ONLINE_CPUS,
+			   PM_QOS_DEFAULT_VALUE);
 
 	for_each_possible_cpu(cpu) {
 		s = &per_cpu(sync_info, cpu);
@@ -39,6 +39,7 @@ static atomic_t active_count = ATOMIC_INIT(0);
 
 struct cpufreq_interactive_cpuinfo {
 	struct timer_list cpu_timer;
+	struct timer_list cpu_slack_timer;
 	int timer_idlecancel;
 	u64 time_in_idle;
 	u64 time_in_iowait;
@@ -54,6 +55,11 @@ struct cpufreq_interactive_cpuinfo {
 	unsigned int floor_freq;
 	u64 floor_validate_time;
 	int governor_enabled;
+	/* table entries behind the last decision, for the tracepoint */
+	unsigned int target_load;
+	int target_load_idx;
+	unsigned int hispeed_delay;
+	int hispeed_delay_idx;
 };
 
 static DEFINE_PER_CPU(struct cpufreq_interactive_cpuinfo, cpuinfo);
@@ -112,6 +118,14 @@ static unsigned long io_is_busy;
  */
 static unsigned long sustain_load;
 
+/*
+ * Scale measured load by cur_freq / max_freq before choosing a target, so
+ * the decision does not depend on the speed the load was sampled at (after
+ * a cluster switch or an EDP cap the current speed may be far from what the
+ * governor last asked for). Bursts are still detected on the raw load.
+ */
+static unsigned long freq_invariant_load;
+
 /*
  * The minimum amount of time to spend at a frequency before we can ramp down.
  */
@@ -126,10 +140,36 @@ static unsigned long timer_rate;
 
 /*
  * Wait this long before raising speed above hispeed, by default a single
- * timer interval.
+ * timer interval.  Written as "delay freq:delay ...", each delay applying
+ * from its frequency up; with more than one entry every step above
+ * hispeed_freq waits for the delay of the speed it is leaving.
  */
 #define DEFAULT_ABOVE_HISPEED_DELAY DEFAULT_TIMER_RATE
-static unsigned long above_hispeed_delay_val;
+static unsigned int default_above_hispeed_delay[] = {
+	DEFAULT_ABOVE_HISPEED_DELAY };
+static spinlock_t above_hispeed_delay_lock;
+static unsigned int *above_hispeed_delay = default_above_hispeed_delay;
+static int nabove_hispeed_delay = ARRAY_SIZE(default_above_hispeed_delay);
+
+/*
+ * Load to aim for at each speed, as "load freq:load ...".  The governor
+ * picks the lowest speed whose own target the load would stay under.
+ * A single 0 (the default) means 100 for the jump policy and
+ * go_hispeed_load for freq_invariant_load; the exponential boost_factor
+ * policy uses sustain_load and ignores the table.
+ */
+static spinlock_t target_loads_lock;
+static unsigned int *target_loads;
+static int ntarget_loads;
+
+/*
+ * The sampling timer is deferrable so it does not wake an idle cpu by
+ * itself.  A cpu left idle above the minimum speed is woken this much
+ * later than a sample was due, since on Tegra it may be holding the
+ * shared cpu clock up; -1 never wakes it.
+ */
+#define DEFAULT_TIMER_SLACK 0
+static long timer_slack_val;
 
 /*
  * Boost pulse to hispeed on touchscreen input.
@@ -161,12 +201,89 @@ struct cpufreq_governor cpufreq_gov_interactive = {
 	.owner = THIS_MODULE,
 };
 
+static inline int cpufreq_interactive_scale_load(int load,
+	struct cpufreq_interactive_cpuinfo *pcpu)
+{
+	unsigned int max_freq = pcpu->policy->cpuinfo.max_freq;
+
+	if (!max_freq)
+		return load;
+
+	return load * pcpu->policy->cur / max_freq;
+}
+
+/*
+ * Lowest speed that keeps work (load in percent of max_freq, times
+ * max_freq) within the target load of that speed.
+ */
+static unsigned int cpufreq_interactive_choose_freq(unsigned int work,
+	unsigned int dflt_load, struct cpufreq_interactive_cpuinfo *pcpu)
+{
+	unsigned long flags;
+	unsigned int freq;
+	int i;
+
+	spin_lock_irqsave(&target_loads_lock, flags);
+	if (!ntarget_loads) {
+		pcpu->target_load = dflt_load;
+		pcpu->target_load_idx = -1;
+		freq = work / dflt_load;
+		goto out;
+	}
+
+	for (i = 0; ; i += 2) {
+		freq = work / target_loads[i];
+		if (i + 1 >= ntarget_loads || freq < target_loads[i + 1])
+			break;
+	}
+	if (i)
+		freq = max(freq, target_loads[i - 1]);
+	pcpu->target_load = target_loads[i];
+	pcpu->target_load_idx = i / 2;
+out:
+	spin_unlock_irqrestore(&target_loads_lock, flags);
+	return freq;
+}
+
+/* Should a raise from at or above hispeed_freq to target_freq wait? */
+static bool cpufreq_interactive_hold_hispeed(
+	struct cpufreq_interactive_cpuinfo *pcpu, unsigned int target_freq)
+{
+	unsigned long flags;
+	int i;
+
+	if (pcpu->target_freq < hispeed_freq ||
+	    target_freq <= pcpu->target_freq)
+		return false;
+
+	spin_lock_irqsave(&above_hispeed_delay_lock, flags);
+	/* a lone delay only gates the step off hispeed_freq */
+	if (nabove_hispeed_delay == 1 && pcpu->target_freq != hispeed_freq) {
+		spin_unlock_irqrestore(&above_hispeed_delay_lock, flags);
+		return false;
+	}
+	for (i = 0; i < nabove_hispeed_delay - 1 &&
+		    pcpu->target_freq >= above_hispeed_delay[i + 1]; i += 2)
+		;
+	pcpu->hispeed_delay = above_hispeed_delay[i];
+	pcpu->hispeed_delay_idx = i / 2;
+	spin_unlock_irqrestore(&above_hispeed_delay_lock, flags);
+
+	return cputime64_sub(pcpu->timer_run_time, pcpu->freq_change_time)
+		< pcpu->hispeed_delay;
+}
+
 static unsigned int cpufreq_interactive_get_target(
 	int cpu_load, int load_since_change,
 	struct cpufreq_interactive_cpuinfo *pcpu)
 {
 	unsigned int target_freq;
 
+	pcpu->target_load = 0;
+	pcpu->target_load_idx = -1;
+	pcpu->hispeed_delay = 0;
+	pcpu->hispeed_delay_idx = -1;
+
 	/*
 	 * Choose greater of short-term load (since last idle timer
 	 * started or timer function re-armed itself) or long-term load
@@ -175,6 +292,38 @@ static unsigned int cpufreq_interactive_get_target(
 	if (load_since_change > cpu_load)
 		cpu_load = load_since_change;
 
+	/*
+	 * Frequency-invariant target: run at the speed where the scaled
+	 * load would sit at go_hispeed_load.
+	 */
+	if (freq_invariant_load) {
+		int scaled_load = cpufreq_interactive_scale_load(cpu_load, pcpu);
+
+		trace_cpufreq_interactive_load(smp_processor_id(), cpu_load,
+					       scaled_load, pcpu->policy->cur);
+
+		if ((cpu_load >= go_hispeed_load || boost_val) &&
+		    pcpu->target_freq < hispeed_freq) {
+			target_freq = hispeed_freq;
+		} else {
+			target_freq = cpufreq_interactive_choose_freq(
+				pcpu->policy->cpuinfo.max_freq * scaled_load,
+				go_hispeed_load ? : 100, pcpu);
+
+			if (cpufreq_interactive_hold_hispeed(pcpu,
+							     target_freq)) {
+				target_freq = pcpu->target_freq;
+				trace_cpufreq_interactive_notyet(
+							smp_processor_id(),
+							cpu_load,
+							pcpu->target_freq,
+							target_freq);
+			}
+		}
+
+		goto done;
+	}
+
 	/* Exponential boost policy */
 	if (boost_factor) {
 
@@ -202,17 +351,14 @@ static unsigned int cpufreq_interactive_get_target(
 		if (pcpu->target_freq <= pcpu->policy->min) {
 			target_freq = hispeed_freq;
 		} else {
-			target_freq = pcpu->policy->max * cpu_load / 100;
+			target_freq = cpufreq_interactive_choose_freq(
+				pcpu->policy->max * cpu_load, 100, pcpu);
 
 			if (target_freq < hispeed_freq)
 				target_freq = hispeed_freq;
 
-			if (pcpu->target_freq == hispeed_freq &&
-			    target_freq > hispeed_freq &&
-			    cputime64_sub(pcpu->timer_run_time,
-					  pcpu->freq_change_time)
-			    < above_hispeed_delay_val) {
-
+			if (cpufreq_interactive_hold_hispeed(pcpu,
+							     target_freq)) {
 				target_freq = pcpu->target_freq;
 				trace_cpufreq_interactive_notyet(
 							smp_processor_id(),
@@ -222,7 +368,8 @@ static unsigned int cpufreq_interactive_get_target(
 			}
 		}
 	} else {
-		target_freq = pcpu->policy->max * cpu_load / 100;
+		target_freq = cpufreq_interactive_choose_freq(
+			pcpu->policy->max * cpu_load, 100, pcpu);
 	}
 
 done:
@@ -241,6 +388,26 @@ static inline cputime64_t get_cpu_iowait_time(
 	return iowait_time;
 }
 
+static void cpufreq_interactive_timer_resched(
+	struct cpufreq_interactive_cpuinfo *pcpu)
+{
+	unsigned long expires = jiffies + usecs_to_jiffies(timer_rate);
+
+	mod_timer(&pcpu->cpu_timer, expires);
+	if (timer_slack_val >= 0 && pcpu->target_freq > pcpu->policy->min) {
+		expires += usecs_to_jiffies(timer_slack_val);
+		mod_timer_pinned(&pcpu->cpu_slack_timer, expires);
+	}
+}
+
+/*
+ * Nothing to do: waking the cpu is enough for the deferred cpu_timer,
+ * already expired by now, to run.
+ */
+static void cpufreq_interactive_slack_timer(unsigned long data)
+{
+}
+
 static void cpufreq_interactive_timer(unsigned long data)
 {
 	unsigned int delta_idle;
@@ -341,6 +508,12 @@ static void cpufreq_interactive_timer(unsigned long data)
 
 	new_freq = pcpu->freq_table[index].frequency;
 
+	trace_cpufreq_interactive_decision(data, cpu_load, pcpu->policy->cur,
+					   new_freq, pcpu->target_load,
+					   pcpu->target_load_idx,
+					   pcpu->hispeed_delay,
+					   pcpu->hispeed_delay_idx);
+
 	/*
 	 * Do not scale below floor_freq unless we have been at or above the
 	 * floor frequency for the minimum sample time since last validated.
@@ -411,8 +584,7 @@ rearm:
 		pcpu->time_in_iowait = get_cpu_iowait_time(
 			data, NULL);
 
-		mod_timer(&pcpu->cpu_timer,
-			  jiffies + usecs_to_jiffies(timer_rate));
+		cpufreq_interactive_timer_resched(pcpu);
 	}
 
 exit:
@@ -448,8 +620,7 @@ static void cpufreq_interactive_idle_start(void)
 			pcpu->time_in_iowait = get_cpu_iowait_time(
 				smp_processor_id(), NULL);
 			pcpu->timer_idlecancel = 0;
-			mod_timer(&pcpu->cpu_timer,
-				  jiffies + usecs_to_jiffies(timer_rate));
+			cpufreq_interactive_timer_resched(pcpu);
 		}
 #endif
 	} else {
@@ -461,6 +632,7 @@ static void cpufreq_interactive_idle_start(void)
 		 */
 		if (pending && pcpu->timer_idlecancel) {
 			del_timer(&pcpu->cpu_timer);
+			del_timer(&pcpu->cpu_slack_timer);
 			/*
 			 * Ensure last timer run time is after current idle
 			 * sample start time, so next idle exit will always
@@ -502,8 +674,7 @@ static void cpufreq_interactive_idle_end(void)
 			get_cpu_iowait_time(smp_processor_id(),
 						NULL);
 		pcpu->timer_idlecancel = 0;
-		mod_timer(&pcpu->cpu_timer,
-			  jiffies + usecs_to_jiffies(timer_rate));
+		cpufreq_interactive_timer_resched(pcpu);
 	}
 
 }
@@ -981,6 +1152,29 @@ static ssize_t store_go_hispeed_load(struct kobject *kobj,
 static struct global_attr go_hispeed_load_attr = __ATTR(go_hispeed_load, 0644,
 		show_go_hispeed_load, store_go_hispeed_load);
 
+static ssize_t show_freq_invariant_load(struct kobject *kobj,
+				     struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", freq_invariant_load);
+}
+
+static ssize_t store_freq_invariant_load(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	freq_invariant_load = !!val;
+	return count;
+}
+
+static struct global_attr freq_invariant_load_attr =
+	__ATTR(freq_invariant_load, 0644,
+		show_freq_invariant_load, store_freq_invariant_load);
+
 static ssize_t show_min_sample_time(struct kobject *kobj,
 				struct attribute *attr, char *buf)
 {
@@ -1003,27 +1197,159 @@ static ssize_t store_min_sample_time(struct kobject *kobj,
 static struct global_attr min_sample_time_attr = __ATTR(min_sample_time, 0644,
 		show_min_sample_time, store_min_sample_time);
 
+/*
+ * Parse "v0 f1:v1 f2:v2 ..." into { v0, f1, v1, f2, v2, ... }, with the
+ * frequencies strictly ascending.
+ */
+static unsigned int *get_tokenized_data(const char *buf, int *num_tokens)
+{
+	const char *cp;
+	unsigned int *tokens;
+	int i, ntokens = 1;
+
+	for (cp = buf; (cp = strpbrk(cp + 1, " :")); )
+		ntokens++;
+	if (!(ntokens & 1))
+		return ERR_PTR(-EINVAL);
+
+	tokens = kmalloc(ntokens * sizeof(*tokens), GFP_KERNEL);
+	if (!tokens)
+		return ERR_PTR(-ENOMEM);
+
+	for (i = 0, cp = buf; i < ntokens; i++) {
+		if (sscanf(cp, "%u", &tokens[i]) != 1)
+			goto err;
+		if ((i & 1) && i > 1 && tokens[i] <= tokens[i - 2])
+			goto err;
+		cp = strpbrk(cp, " :");
+		if (!cp)
+			break;
+		cp++;
+	}
+	if (i + 1 != ntokens)
+		goto err;
+
+	*num_tokens = ntokens;
+	return tokens;
+err:
+	kfree(tokens);
+	return ERR_PTR(-EINVAL);
+}
+
+static ssize_t show_tokenized_data(char *buf, spinlock_t *lock,
+				   unsigned int *tokens, int ntokens)
+{
+	unsigned long flags;
+	ssize_t ret = 0;
+	int i;
+
+	spin_lock_irqsave(lock, flags);
+	for (i = 0; i < ntokens; i++)
+		ret += sprintf(buf + ret, "%u%s", tokens[i],
+			       i & 1 ? ":" : " ");
+	spin_unlock_irqrestore(lock, flags);
+
+	if (!ret)
+		ret = sprintf(buf, "0 ");
+	buf[ret - 1] = '\n';
+	return ret;
+}
+
+static ssize_t show_target_loads(struct kobject *kobj,
+				 struct attribute *attr, char *buf)
+{
+	return show_tokenized_data(buf, &target_loads_lock, target_loads,
+				   ntarget_loads);
+}
+
+static ssize_t store_target_loads(struct kobject *kobj,
+				  struct attribute *attr,
+				  const char *buf, size_t count)
+{
+	unsigned int *new_target_loads, *old;
+	unsigned long flags;
+	int i, ntokens;
+
+	new_target_loads = get_tokenized_data(buf, &ntokens);
+	if (IS_ERR(new_target_loads))
+		return PTR_ERR(new_target_loads);
+
+	if (ntokens == 1 && !new_target_loads[0]) {
+		kfree(new_target_loads);
+		new_target_loads = NULL;
+		ntokens = 0;
+	}
+	for (i = 0; i < ntokens; i += 2)
+		if (!new_target_loads[i]) {
+			kfree(new_target_loads);
+			return -EINVAL;
+		}
+
+	spin_lock_irqsave(&target_loads_lock, flags);
+	old = target_loads;
+	target_loads = new_target_loads;
+	ntarget_loads = ntokens;
+	spin_unlock_irqrestore(&target_loads_lock, flags);
+	kfree(old);
+	return count;
+}
+
+define_one_global_rw(target_loads);
+
 static ssize_t show_above_hispeed_delay(struct kobject *kobj,
 					struct attribute *attr, char *buf)
 {
-	return sprintf(buf, "%lu\n", above_hispeed_delay_val);
+	return show_tokenized_data(buf, &above_hispeed_delay_lock,
+				   above_hispeed_delay, nabove_hispeed_delay);
 }
 
 static ssize_t store_above_hispeed_delay(struct kobject *kobj,
 					 struct attribute *attr,
 					 const char *buf, size_t count)
+{
+	unsigned int *new_above_hispeed_delay, *old;
+	unsigned long flags;
+	int ntokens;
+
+	new_above_hispeed_delay = get_tokenized_data(buf, &ntokens);
+	if (IS_ERR(new_above_hispeed_delay))
+		return PTR_ERR(new_above_hispeed_delay);
+
+	spin_lock_irqsave(&above_hispeed_delay_lock, flags);
+	old = above_hispeed_delay;
+	above_hispeed_delay = new_above_hispeed_delay;
+	nabove_hispeed_delay = ntokens;
+	spin_unlock_irqrestore(&above_hispeed_delay_lock, flags);
+	if (old != default_above_hispeed_delay)
+		kfree(old);
+	return count;
+}
+
+define_one_global_rw(above_hispeed_delay);
+
+static ssize_t show_timer_slack(struct kobject *kobj,
+				struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%ld\n", timer_slack_val);
+}
+
+static ssize_t store_timer_slack(struct kobject *kobj,
+				 struct attribute *attr,
+				 const char *buf, size_t count)
 {
 	int ret;
-	unsigned long val;
+	long val;
 
-	ret = strict_strtoul(buf, 0, &val);
+	ret = strict_strtol(buf, 0, &val);
 	if (ret < 0)
 		return ret;
-	above_hispeed_delay_val = val;
+	if (val < -1)
+		return -EINVAL;
+	timer_slack_val = val;
 	return count;
 }
 
-define_one_global_rw(above_hispeed_delay);
+define_one_global_rw(timer_slack);
 
 static ssize_t show_timer_rate(struct kobject *kobj,
 			struct attribute *attr, char *buf)
@@ -1147,9 +1473,12 @@ static struct attribute *interactive_attributes[] = {
 	&sustain_load_attr.attr,
 	&hispeed_freq_attr.attr,
 	&go_hispeed_load_attr.attr,
+	&freq_invariant_load_attr.attr,
+	&target_loads.attr,
 	&above_hispeed_delay.attr,
 	&min_sample_time_attr.attr,
 	&timer_rate_attr.attr,
+	&timer_slack.attr,
 	&input_boost.attr,
 	&boost.attr,
 	&core_lock_period.attr,
@@ -1228,6 +1557,7 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 			pcpu->governor_enabled = 0;
 			smp_wmb();
 			del_timer_sync(&pcpu->cpu_timer);
+			del_timer_sync(&pcpu->cpu_slack_timer);
 
 			/*
 			 * Reset idle exit time since we may cancel the timer
@@ -1289,15 +1619,21 @@ static int __init cpufreq_interactive_init(void)
 	go_maxspeed_load = DEFAULT_GO_MAXSPEED_LOAD;
 	go_hispeed_load = DEFAULT_GO_HISPEED_LOAD;
 	min_sample_time = DEFAULT_MIN_SAMPLE_TIME;
-	above_hispeed_delay_val = DEFAULT_ABOVE_HISPEED_DELAY;
 	timer_rate = DEFAULT_TIMER_RATE;
+	timer_slack_val = DEFAULT_TIMER_SLACK;
+	spin_lock_init(&target_loads_lock);
+	spin_lock_init(&above_hispeed_delay_lock);
 
 	/* Initalize per-cpu timers */
 	for_each_possible_cpu(i) {
 		pcpu = &per_cpu(cpuinfo, i);
-		init_timer(&pcpu->cpu_timer);
+		init_timer_deferrable(&pcpu->cpu_timer);
 		pcpu->cpu_timer.function = cpufreq_interactive_timer;
 		pcpu->cpu_timer.data = i;
+		init_timer(&pcpu->cpu_slack_timer);
+		pcpu->cpu_slack_timer.function =
+			cpufreq_interactive_slack_timer;
+		pcpu->cpu_slack_timer.data = i;
 	}
 
 	up_task = kthread_create(cpufreq_interactive_up_task, NULL,
@@ -34,6 +34,9 @@
 #include <linux/completion.h>
 #include <linux/workqueue.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <mach/arb_sema.h>
 #include <mach/clk.h>
@@ -126,6 +129,21 @@ enum {
 
 #define UCQCMD_KEYTABLEADDRMASK 0x1FFFF
 
+/*
+ * Requests shorter than hw_min_bytes are done in software when a
+ * fallback is available: for them the IV pass, interrupt and workqueue
+ * hop cost more than the cipher itself.
+ */
+static unsigned int hw_min_bytes = 256;
+module_param(hw_min_bytes, uint, 0644);
+MODULE_PARM_DESC(hw_min_bytes, "smallest request sent to the engine");
+
+/* up to batch_max queued requests on one key share an engine pass */
+#define TEGRA_AES_BATCH_MAX	32
+static unsigned int batch_max = 16;
+module_param(batch_max, uint, 0644);
+MODULE_PARM_DESC(batch_max, "most requests chained into one engine pass");
+
 #define AES_NR_KEYSLOTS	8
 #define SSK_SLOT_NUM	4
 
@@ -137,6 +155,19 @@ struct tegra_aes_slot {
 
 struct tegra_aes_reqctx {
 	unsigned long mode;
+	ktime_t queued;
+};
+
+struct tegra_aes_stats {
+	unsigned long hw_reqs;
+	unsigned long sw_reqs;
+	unsigned long passes;
+	unsigned long batched_reqs;
+	unsigned long slot_switches;
+	u64 hw_lat_us;
+	u64 sw_lat_us;
+	unsigned long hw_lat_max_us;
+	unsigned long sw_lat_max_us;
 };
 
 #define TEGRA_AES_QUEUE_LENGTH	500
@@ -165,6 +196,7 @@ struct tegra_aes_engine {
 	u32 *buf_in;
 	u32 *buf_out;
 	int res_id;
+	int cur_slot;
 	unsigned long busy;
 	u8 irq;
 	u32 status;
@@ -182,6 +214,8 @@ struct tegra_aes_dev {
 	u64 ctr;
 	unsigned long flags;
 	u8 dt[DEFAULT_RNG_BLK_SZ];
+	struct tegra_aes_stats stats;
+	struct dentry *debugfs;
 };
 
 static struct tegra_aes_dev *aes_dev;
@@ -194,6 +228,7 @@ struct tegra_aes_ctx {
 	int keylen;
 	bool use_ssk;
 	u8 dt[DEFAULT_RNG_BLK_SZ];
+	struct crypto_blkcipher *fallback;
 };
 
 static struct tegra_aes_ctx rng_ctx;
@@ -320,6 +355,9 @@ static int aes_hw_init(struct tegra_aes_engine *engine)
 
 static void aes_hw_deinit(struct tegra_aes_engine *engine)
 {
+	/* don't trust the slot selection across a clock gate */
+	engine->cur_slot = -1;
+
 	if (engine->pclk)
 		clk_disable(engine->pclk);
 
@@ -470,16 +508,9 @@ static struct tegra_aes_slot *aes_find_key_slot(struct tegra_aes_dev *dd)
 	return found ? slot : NULL;
 }
 
-static int aes_set_key(struct tegra_aes_engine *eng, int slot_num)
+static void aes_select_key_slot(struct tegra_aes_engine *eng, int slot_num)
 {
-	struct tegra_aes_dev *dd = aes_dev;
-	u32 value, cmdq[2];
-	int i, eng_busy, icq_empty, dma_busy;
-
-	if (!eng) {
-		dev_err(dd->dev, "%s: context invalid\n", __func__);
-		return -EINVAL;
-	}
+	u32 value;
 
 	/* enable key schedule generation in hardware */
 	value = aes_readl(eng, SECURE_CONFIG_EXT);
@@ -492,6 +523,22 @@ static int aes_set_key(struct tegra_aes_engine *eng, int slot_num)
 	value |= (slot_num << SECURE_KEY_INDEX_SHIFT);
 	aes_writel(eng, value, SECURE_CONFIG);
 
+	eng->cur_slot = slot_num;
+}
+
+static int aes_set_key(struct tegra_aes_engine *eng, int slot_num)
+{
+	struct tegra_aes_dev *dd = aes_dev;
+	u32 value, cmdq[2];
+	int i, eng_busy, icq_empty, dma_busy;
+
+	if (!eng) {
+		dev_err(dd->dev, "%s: context invalid\n", __func__);
+		return -EINVAL;
+	}
+
+	aes_select_key_slot(eng, slot_num);
+
 	if (slot_num == SSK_SLOT_NUM)
 		goto out;
 
@@ -557,6 +604,160 @@ out:
 	return 0;
 }
 
+/*
+ * Keys are loaded into their slot at setkey time; a request only has to
+ * point the engine at its context's slot, and not even that when the
+ * previous request on this engine used the same one.
+ */
+static void tegra_aes_use_slot(struct tegra_aes_engine *eng,
+	struct tegra_aes_ctx *ctx)
+{
+	int slot_num = ctx->use_ssk ? SSK_SLOT_NUM : ctx->slot->slot_num;
+
+	if (eng->cur_slot == slot_num)
+		return;
+
+	aes_select_key_slot(eng, slot_num);
+	aes_dev->stats.slot_switches++;
+}
+
+static void tegra_aes_account(struct tegra_aes_dev *dd,
+	struct ablkcipher_request *req, bool hw)
+{
+	struct tegra_aes_reqctx *rctx = ablkcipher_request_ctx(req);
+	unsigned long us = ktime_us_delta(ktime_get(), rctx->queued);
+	unsigned long flags;
+
+	spin_lock_irqsave(&dd->lock, flags);
+	if (hw) {
+		dd->stats.hw_reqs++;
+		dd->stats.hw_lat_us += us;
+		dd->stats.hw_lat_max_us = max(dd->stats.hw_lat_max_us, us);
+	} else {
+		dd->stats.sw_reqs++;
+		dd->stats.sw_lat_us += us;
+		dd->stats.sw_lat_max_us = max(dd->stats.sw_lat_max_us, us);
+	}
+	spin_unlock_irqrestore(&dd->lock, flags);
+}
+
+/*
+ * ECB requests, and CBC decryptions, can be chained in the bounce buffer
+ * and run as one engine pass.  For CBC decryption each request's IV goes
+ * in front of its data as an extra ciphertext block: the engine chains
+ * through it, so the next block is decrypted against the right IV, and
+ * its own output is dropped.  That also does away with the separate IV
+ * pass.  CBC encryption and OFB chain on the output, which can't be
+ * steered like this, and keep the per-request path.
+ */
+static size_t tegra_aes_batch_len(struct ablkcipher_request *req,
+	unsigned long mode)
+{
+	return req->nbytes + ((mode & FLAGS_CBC) ? AES_BLOCK_SIZE : 0);
+}
+
+static bool tegra_aes_can_batch(struct ablkcipher_request *req,
+	unsigned long mode)
+{
+	if ((mode & FLAGS_OFB) ||
+	    ((mode & FLAGS_CBC) && ((mode & FLAGS_ENCRYPT) || !req->info)))
+		return false;
+	if (!req->nbytes || (req->nbytes % AES_BLOCK_SIZE))
+		return false;
+	return tegra_aes_batch_len(req, mode) <= AES_HW_DMA_BUFFER_SIZE_BYTES;
+}
+
+/*
+ * Run @first together with the compatible requests queued right behind
+ * it.  Called with the hardware semaphore held; drops it before the
+ * requests are completed.
+ */
+static int tegra_aes_handle_batch(struct tegra_aes_engine *eng,
+	struct ablkcipher_request *first, unsigned long mode)
+{
+	struct tegra_aes_dev *dd = aes_dev;
+	struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(first);
+	struct ablkcipher_request *batch[TEGRA_AES_BATCH_MAX];
+	struct ablkcipher_request *req;
+	struct tegra_aes_reqctx *rctx;
+	u8 *in = (u8 *)eng->buf_in, *out = (u8 *)eng->buf_out;
+	bool cbc = mode & FLAGS_CBC;
+	unsigned int max = clamp_t(unsigned int, batch_max, 1,
+				   TEGRA_AES_BATCH_MAX);
+	unsigned long irq_flags;
+	size_t len;
+	int n = 0, i, ret;
+
+	batch[n++] = first;
+	len = tegra_aes_batch_len(first, mode);
+
+	/* leave backlogged requests to the normal dequeue path */
+	spin_lock_irqsave(&dd->lock, irq_flags);
+	while ((n < max) && !list_empty(&dd->queue.list) &&
+	       !crypto_get_backlog(&dd->queue)) {
+		req = ablkcipher_request_cast(list_first_entry(&dd->queue.list,
+			struct crypto_async_request, list));
+		rctx = ablkcipher_request_ctx(req);
+		if ((crypto_ablkcipher_reqtfm(req) != tfm) ||
+		    ((rctx->mode & FLAGS_MODE_MASK) != mode) ||
+		    !req->src || !req->dst || !tegra_aes_can_batch(req, mode) ||
+		    (len + tegra_aes_batch_len(req, mode) >
+		     AES_HW_DMA_BUFFER_SIZE_BYTES))
+			break;
+		crypto_dequeue_request(&dd->queue);
+		batch[n++] = req;
+		len += tegra_aes_batch_len(req, mode);
+	}
+	spin_unlock_irqrestore(&dd->lock, irq_flags);
+
+	len = 0;
+	for (i = 0; i < n; i++) {
+		req = batch[i];
+		if (cbc) {
+			memcpy(in + len, req->info, AES_BLOCK_SIZE);
+			len += AES_BLOCK_SIZE;
+		}
+		scatterwalk_map_and_copy(in + len, req->src, 0, req->nbytes, 0);
+		len += req->nbytes;
+	}
+
+	ret = aes_start_crypt(eng, (u32)eng->dma_buf_in,
+		(u32)eng->dma_buf_out, len / AES_BLOCK_SIZE, mode, true);
+	if (ret < 0)
+		dev_err(dd->dev, "aes_start_crypt fail(%d)\n", ret);
+
+	/* release the hardware semaphore */
+	tegra_arb_mutex_unlock(eng->res_id);
+
+	spin_lock_irqsave(&dd->lock, irq_flags);
+	dd->stats.passes++;
+	dd->stats.batched_reqs += n - 1;
+	spin_unlock_irqrestore(&dd->lock, irq_flags);
+
+	len = 0;
+	for (i = 0; i < n; i++) {
+		req = batch[i];
+		if (cbc)
+			len += AES_BLOCK_SIZE;
+		if (!ret) {
+			scatterwalk_map_and_copy(out + len, req->dst, 0,
+						 req->nbytes, 1);
+			/* chain value for a follow-on request */
+			if (cbc)
+				memcpy(req->info,
+				       in + len + req->nbytes - AES_BLOCK_SIZE,
+				       AES_BLOCK_SIZE);
+		}
+		len += req->nbytes;
+
+		tegra_aes_account(dd, req, true);
+		if (req->base.complete)
+			req->base.complete(&req->base, ret);
+	}
+
+	return ret;
+}
+
 static int tegra_aes_handle_req(struct tegra_aes_engine *eng)
 {
 	struct tegra_aes_dev *dd = aes_dev;
@@ -614,6 +815,10 @@ static int tegra_aes_handle_req(struct tegra_aes_engine *eng)
 	rctx->mode &= FLAGS_MODE_MASK;
 	dd->flags = (dd->flags & ~FLAGS_MODE_MASK) | rctx->mode;
 	eng->ctx = ctx;
+	tegra_aes_use_slot(eng, ctx);
+
+	if (tegra_aes_can_batch(req, rctx->mode))
+		return tegra_aes_handle_batch(eng, req, rctx->mode);
 
 	if (((dd->flags & FLAGS_CBC) || (dd->flags & FLAGS_OFB)) && req->info) {
 		/* set iv to the aes hw slot
@@ -654,6 +859,7 @@ static int tegra_aes_handle_req(struct tegra_aes_engine *eng)
 
 		ret = aes_start_crypt(eng, addr_in, addr_out, nblocks,
 			dd->flags, true);
+		dd->stats.passes++;
 
 		dma_unmap_sg(dd->dev, out_sg, 1, DMA_FROM_DEVICE);
 		dma_unmap_sg(dd->dev, in_sg, 1, DMA_TO_DEVICE);
@@ -674,6 +880,7 @@ out:
 	tegra_arb_mutex_unlock(eng->res_id);
 	eng->total = total;
 
+	tegra_aes_account(dd, eng->req, true);
 	if (eng->req->base.complete)
 		eng->req->base.complete(&eng->req->base, ret);
 
@@ -786,6 +993,13 @@ static int tegra_aes_setkey(struct crypto_ablkcipher *tfm, const u8 *key,
 		memcpy(ctx->key, key, keylen);
 		ctx->keylen = keylen;
 		ctx->use_ssk = false;
+
+		if (ctx->fallback &&
+		    crypto_blkcipher_setkey(ctx->fallback, key, keylen)) {
+			/* keep everything on the engine */
+			crypto_free_blkcipher(ctx->fallback);
+			ctx->fallback = NULL;
+		}
 	} else {
 		ctx->use_ssk = true;
 		ctx->keylen = AES_KEYSIZE_128;
@@ -872,9 +1086,27 @@ static irqreturn_t aes_bsea_irq(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+static int tegra_aes_crypt_fallback(struct ablkcipher_request *req,
+	struct tegra_aes_ctx *ctx, unsigned long mode)
+{
+	struct blkcipher_desc desc = {
+		.tfm = ctx->fallback,
+		.info = req->info,
+		.flags = req->base.flags,
+	};
+
+	if (mode & FLAGS_ENCRYPT)
+		return crypto_blkcipher_encrypt_iv(&desc, req->dst, req->src,
+						   req->nbytes);
+	return crypto_blkcipher_decrypt_iv(&desc, req->dst, req->src,
+					   req->nbytes);
+}
+
 static int tegra_aes_crypt(struct ablkcipher_request *req, unsigned long mode)
 {
 	struct tegra_aes_reqctx *rctx = ablkcipher_request_ctx(req);
+	struct tegra_aes_ctx *ctx =
+		crypto_ablkcipher_ctx(crypto_ablkcipher_reqtfm(req));
 	struct tegra_aes_dev *dd = aes_dev;
 	unsigned long flags;
 	int err = 0;
@@ -887,6 +1119,14 @@ static int tegra_aes_crypt(struct ablkcipher_request *req, unsigned long mode)
 		!!(mode & FLAGS_OFB));
 
 	rctx->mode = mode;
+	rctx->queued = ktime_get();
+
+	/* the secure storage key can't leave the engine */
+	if (ctx->fallback && !ctx->use_ssk && (req->nbytes < hw_min_bytes)) {
+		err = tegra_aes_crypt_fallback(req, ctx, mode);
+		tegra_aes_account(dd, req, false);
+		return err;
+	}
 
 	spin_lock_irqsave(&dd->lock, flags);
 	err = ablkcipher_enqueue_request(&dd->queue, req);
@@ -1089,10 +1329,41 @@ static int tegra_aes_cra_init(struct crypto_tfm *tfm)
 	return 0;
 }
 
+/*
+ * Small requests go to a software implementation of the same mode.
+ * Without one everything runs on the engine, as before.
+ */
+static int tegra_aes_cra_init_fallback(struct crypto_tfm *tfm,
+	const char *name)
+{
+	struct tegra_aes_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	ctx->fallback = crypto_alloc_blkcipher(name, 0, CRYPTO_ALG_ASYNC);
+	if (IS_ERR(ctx->fallback))
+		ctx->fallback = NULL;
+
+	return tegra_aes_cra_init(tfm);
+}
+
+static int tegra_aes_ecb_cra_init(struct crypto_tfm *tfm)
+{
+	return tegra_aes_cra_init_fallback(tfm, "ecb(aes)");
+}
+
+static int tegra_aes_cbc_cra_init(struct crypto_tfm *tfm)
+{
+	return tegra_aes_cra_init_fallback(tfm, "cbc(aes)");
+}
+
 void tegra_aes_cra_exit(struct crypto_tfm *tfm)
 {
 	struct tegra_aes_ctx *ctx = crypto_ablkcipher_ctx((struct crypto_ablkcipher *)tfm);
 
+	if (ctx && ctx->fallback) {
+		crypto_free_blkcipher(ctx->fallback);
+		ctx->fallback = NULL;
+	}
+
 	if (ctx && ctx->slot)
 		aes_release_key_slot(ctx);
 }
@@ -1108,7 +1379,7 @@ static struct crypto_alg algs[] = {
 		.cra_alignmask = 3,
 		.cra_type = &crypto_ablkcipher_type,
 		.cra_module = THIS_MODULE,
-		.cra_init = tegra_aes_cra_init,
+		.cra_init = tegra_aes_ecb_cra_init,
 		.cra_exit = tegra_aes_cra_exit,
 		.cra_u.ablkcipher = {
 			.min_keysize = AES_MIN_KEY_SIZE,
@@ -1127,7 +1398,7 @@ static struct crypto_alg algs[] = {
 		.cra_alignmask = 3,
 		.cra_type = &crypto_ablkcipher_type,
 		.cra_module = THIS_MODULE,
-		.cra_init = tegra_aes_cra_init,
+		.cra_init = tegra_aes_cbc_cra_init,
 		.cra_exit = tegra_aes_cra_exit,
 		.cra_u.ablkcipher = {
 			.min_keysize = AES_MIN_KEY_SIZE,
@@ -1175,6 +1446,58 @@ static struct crypto_alg algs[] = {
 	}
 };
 
+#ifdef CONFIG_DEBUG_FS
+static int tegra_aes_stats_show(struct seq_file *s, void *data)
+{
+	struct tegra_aes_dev *dd = s->private;
+	struct tegra_aes_stats st;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dd->lock, flags);
+	st = dd->stats;
+	spin_unlock_irqrestore(&dd->lock, flags);
+
+	seq_printf(s, "hw_requests %lu\n", st.hw_reqs);
+	seq_printf(s, "sw_requests %lu\n", st.sw_reqs);
+	seq_printf(s, "engine_passes %lu\n", st.passes);
+	seq_printf(s, "batched_requests %lu\n", st.batched_reqs);
+	seq_printf(s, "slot_switches %lu\n", st.slot_switches);
+	seq_printf(s, "hw_latency_avg_us %llu\n",
+		   st.hw_reqs ? div_u64(st.hw_lat_us, st.hw_reqs) : 0);
+	seq_printf(s, "hw_latency_max_us %lu\n", st.hw_lat_max_us);
+	seq_printf(s, "sw_latency_avg_us %llu\n",
+		   st.sw_reqs ? div_u64(st.sw_lat_us, st.sw_reqs) : 0);
+	seq_printf(s, "sw_latency_max_us %lu\n", st.sw_lat_max_us);
+	return 0;
+}
+
+static int tegra_aes_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tegra_aes_stats_show, inode->i_private);
+}
+
+static const struct file_operations tegra_aes_stats_fops = {
+	.open		= tegra_aes_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void tegra_aes_debugfs_init(struct tegra_aes_dev *dd)
+{
+	dd->debugfs = debugfs_create_file("tegra_aes", S_IRUGO, NULL, dd,
+					  &tegra_aes_stats_fops);
+}
+
+static void tegra_aes_debugfs_exit(struct tegra_aes_dev *dd)
+{
+	debugfs_remove(dd->debugfs);
+}
+#else
+static void tegra_aes_debugfs_init(struct tegra_aes_dev *dd) { }
+static void tegra_aes_debugfs_exit(struct tegra_aes_dev *dd) { }
+#endif
+
 static int tegra_aes_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
@@ -1230,6 +1553,8 @@ static int tegra_aes_probe(struct platform_device *pdev)
 
 	dd->bsev.res_id = TEGRA_ARB_BSEV;
 	dd->bsea.res_id = TEGRA_ARB_BSEA;
+	dd->bsev.cur_slot = -1;
+	dd->bsea.cur_slot = -1;
 
 	dd->bsev.pclk = clk_get(dev, "bsev");
 	if (IS_ERR(dd->bsev.pclk)) {
@@ -1356,6 +1681,8 @@ static int tegra_aes_probe(struct platform_device *pdev)
 			goto out;
 	}
 
+	tegra_aes_debugfs_init(dd);
+
 	dev_info(dev, "registered");
 	return 0;
 
@@ -1431,6 +1758,7 @@ static int __devexit tegra_aes_remove(struct platform_device *pdev)
 	if (!dd)
 		return -ENODEV;
 
+	tegra_aes_debugfs_exit(dd);
 	cancel_work_sync(&bsev_work);
 	cancel_work_sync(&bsea_work);
 	destroy_workqueue(bsev_wq);
@@ -188,6 +188,67 @@ static int tegra_gpio_get(struct gpio_chip *chip, unsigned offset)
 	return (__raw_readl(GPIO_IN(offset)) >> GPIO_BIT(offset)) & 0x1;
 }
 
+/*
+ * The fast paths below go to the registers without gpiolib.  They take no
+ * lock: a masked write changes only the pins in its mask, so writers of
+ * other pins in the same port cannot be undone.  The pins must have been
+ * requested and set up through gpiolib first.
+ */
+
+/*
+ * Sets the pins of @mask in the port of eight @gpio belongs to, pin
+ * (@gpio & ~7) + n being bit n, to @value in a single write.  The pins
+ * change together.
+ */
+void tegra_gpio_set_port(unsigned gpio, u8 mask, u8 value)
+{
+	__raw_writel((mask << 8) | (value & mask), GPIO_MSK_OUT(gpio));
+}
+EXPORT_SYMBOL_GPL(tegra_gpio_set_port);
+
+/* Sets @gpios[i] to @values[i], with one write per port they are in */
+int tegra_gpio_set_multiple(const unsigned *gpios, const int *values, int n)
+{
+	unsigned long done = 0;
+	int i, j;
+
+	if (n > BITS_PER_LONG)
+		return -EINVAL;
+	for (i = 0; i < n; i++) {
+		u8 mask = 0, value = 0;
+
+		if (test_bit(i, &done))
+			continue;
+		if (gpios[i] >= TEGRA_NR_GPIOS)
+			return -EINVAL;
+		for (j = i; j < n; j++) {
+			if (gpios[j] >> 3 != gpios[i] >> 3)
+				continue;
+			mask |= 1 << GPIO_BIT(gpios[j]);
+			if (values[j])
+				value |= 1 << GPIO_BIT(gpios[j]);
+			__set_bit(j, &done);
+		}
+		tegra_gpio_set_port(gpios[i], mask, value);
+	}
+	return 0;
+}
+EXPORT_SYMBOL_GPL(tegra_gpio_set_multiple);
+
+/* The level of the port's eight pins, as the pads see them */
+u8 tegra_gpio_get_port(unsigned gpio)
+{
+	return __raw_readl(GPIO_IN(gpio));
+}
+EXPORT_SYMBOL_GPL(tegra_gpio_get_port);
+
+/* Same as gpio_get_value() */
+int tegra_gpio_get_value(unsigned gpio)
+{
+	return tegra_gpio_get(NULL, gpio);
+}
+EXPORT_SYMBOL_GPL(tegra_gpio_get_value);
+
 static int tegra_gpio_direction_input(struct gpio_chip *chip, unsigned offset)
 {
 	tegra_gpio_mask_write(GPIO_MSK_OE(offset), offset, 0);
@@ -505,6 +566,9 @@ void __init tegra_gpio_config(struct tegra_gpio_table *table, int num)
 
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/uaccess.h>
 
 static int dbg_gpio_show(struct seq_file *s, void *unused)
 {
@@ -542,10 +606,118 @@ static const struct file_operations debug_fops = {
 	.release	= single_release,
 };
 
+/*
+ * Writing a GPIO number to tegra_gpio_bench and reading it back times
+ * each way of getting that pin, and of setting it if it is an output.
+ * It is only ever set to the level it already drives.
+ */
+#define BENCH_LOOPS	10000
+
+static int bench_gpio = -1;
+
+enum {
+	BENCH_GET, BENCH_GET_FAST, BENCH_SET, BENCH_SET_PORT,
+	BENCH_SET_MULTIPLE, BENCH_NR
+};
+
+static const char * const bench_names[BENCH_NR] = {
+	"gpio_get_value", "tegra_gpio_get_value", "gpio_set_value",
+	"tegra_gpio_set_port", "tegra_gpio_set_multiple(4)",
+};
+
+static u64 bench_run(int test, unsigned gpio, int value)
+{
+	unsigned gpios[4] = { gpio, gpio, gpio, gpio };
+	int values[4] = { value, value, value, value };
+	u8 bit = 1 << GPIO_BIT(gpio);
+	ktime_t start;
+	int i;
+
+	preempt_disable();
+	start = ktime_get();
+	for (i = 0; i < BENCH_LOOPS; i++) {
+		switch (test) {
+		case BENCH_GET:
+			gpio_get_value(gpio);
+			break;
+		case BENCH_GET_FAST:
+			tegra_gpio_get_value(gpio);
+			break;
+		case BENCH_SET:
+			gpio_set_value(gpio, value);
+			break;
+		case BENCH_SET_PORT:
+			tegra_gpio_set_port(gpio, bit, value ? bit : 0);
+			break;
+		case BENCH_SET_MULTIPLE:
+			tegra_gpio_set_multiple(gpios, values, 4);
+			break;
+		}
+	}
+	start = ktime_sub(ktime_get(), start);
+	preempt_enable();
+	return div_u64(ktime_to_ns(start), BENCH_LOOPS);
+}
+
+static int dbg_bench_show(struct seq_file *s, void *unused)
+{
+	unsigned gpio = bench_gpio;
+	bool output;
+	int test;
+
+	if (bench_gpio < 0) {
+		seq_printf(s, "write a gpio number first\n");
+		return 0;
+	}
+	output = ((__raw_readl(GPIO_CNF(gpio)) & __raw_readl(GPIO_OE(gpio))) >>
+		  GPIO_BIT(gpio)) & 1;
+
+	seq_printf(s, "gpio %u, ns per call\n", gpio);
+	for (test = 0; test < BENCH_NR; test++) {
+		if (test >= BENCH_SET && !output)
+			break;
+		seq_printf(s, "%-28s %llu\n", bench_names[test],
+			   bench_run(test, gpio, tegra_gpio_get_value(gpio)));
+	}
+	return 0;
+}
+
+static int dbg_bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dbg_bench_show, NULL);
+}
+
+static ssize_t dbg_bench_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	char str[16];
+	unsigned long gpio;
+
+	if (count >= sizeof(str))
+		return -EINVAL;
+	if (copy_from_user(str, buf, count))
+		return -EFAULT;
+	str[count] = 0;
+	if (strict_strtoul(strstrip(str), 0, &gpio) || gpio >= TEGRA_NR_GPIOS)
+		return -EINVAL;
+	bench_gpio = gpio;
+	return count;
+}
+
+static const struct file_operations bench_fops = {
+	.open		= dbg_bench_open,
+	.read		= seq_read,
+	.write		= dbg_bench_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init tegra_gpio_debuginit(void)
 {
 	(void) debugfs_create_file("tegra_gpio", S_IRUGO,
 					NULL, NULL, &debug_fops);
+	(void) debugfs_create_file("tegra_gpio_bench", S_IRUSR | S_IWUSR,
+					NULL, NULL, &bench_fops);
 	return 0;
 }
 late_initcall(tegra_gpio_debuginit);
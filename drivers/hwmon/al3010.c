@@ -708,6 +708,7 @@ static struct i2c_driver al3010_driver = {
 	.driver = {
 		.name	= AL3010_DRV_NAME,
 		.owner	= THIS_MODULE,
+		.async_probe = true,
 	},
 	.suspend = al3010_suspend,
 	.resume	= al3010_resume,
@@ -22,6 +22,7 @@
 
 #include <linux/kernel.h>
 #include <linux/init.h>
+#include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/clk.h>
 #include <linux/err.h>
@@ -33,6 +34,11 @@
 #include <linux/i2c-tegra.h>
 #include <linux/of_i2c.h>
 #include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/unaligned.h>
 
@@ -112,7 +118,25 @@
 #define SL_ADDR1(addr) (addr & 0xff)
 #define SL_ADDR2(addr) ((addr >> 8) & 0xff)
 
+/* transfer latency buckets: <32, <128, <512, <2048 and >= 2048 us */
+#define TEGRA_I2C_HIST_BUCKETS			5
 
+/*
+ * Keep the controller clocks on for clk_idle_ms after a transfer instead
+ * of gating them at the end of every one; sensors, the PMIC and the fuel
+ * gauge come back long before that.  0 gates after each transfer.
+ */
+static unsigned int clk_idle_ms = 10;
+module_param(clk_idle_ms, uint, 0644);
+
+/*
+ * Messages the bus should finish within poll_max_us are polled for with
+ * the interrupt line off, which is cheaper than taking the interrupt and
+ * waking the caller.  Polling gives up after twice that and falls back to
+ * the interrupt.  0 always waits for the interrupt.
+ */
+static unsigned int poll_max_us = 200;
+module_param(poll_max_us, uint, 0644);
 
 struct tegra_i2c_dev;
 
@@ -124,6 +148,14 @@ struct tegra_i2c_bus {
 	struct i2c_adapter adapter;
 	int scl_gpio;
 	int sda_gpio;
+
+	/* i2c_transfer() latency, under dev_lock */
+	unsigned long xfers;
+	unsigned long errors;
+	unsigned long polled;		/* messages that needed no interrupt */
+	u64 total_ns;
+	u64 max_ns;
+	unsigned long hist[TEGRA_I2C_HIST_BUCKETS];
 };
 
 /**
@@ -144,6 +176,10 @@ struct tegra_i2c_bus {
  * @msg_read: identifies read transfers
  * @bus_clk_rate: current i2c bus clock rate
  * @is_suspended: prevents i2c controller accesses after suspend is called
+ * @clk_held: clocks left on after the last transfer, under dev_lock
+ * @clk_last_use: jiffies at the end of the last transfer
+ * @clk_idle_work: gates the held clocks once they were idle for clk_idle_ms
+ * @debugfs: per controller latency counters
  */
 struct tegra_i2c_dev {
 	struct device *dev;
@@ -179,6 +215,10 @@ struct tegra_i2c_dev {
 	bool is_high_speed_enable;
 	u16 hs_master_code;
 	int (*arb_recovery)(int scl_gpio, int sda_gpio);
+	bool clk_held;
+	unsigned long clk_last_use;
+	struct delayed_work clk_idle_work;
+	struct dentry *debugfs;
 	struct tegra_i2c_bus busses[1];
 };
 
@@ -435,6 +475,53 @@ static inline void tegra_i2c_clock_disable(struct tegra_i2c_dev *i2c_dev)
 	clk_disable(i2c_dev->fast_clk);
 }
 
+/* Called with dev_lock held, before a transfer */
+static void tegra_i2c_clock_get(struct tegra_i2c_dev *i2c_dev)
+{
+	if (i2c_dev->is_clkon_always || i2c_dev->clk_held)
+		return;
+	if (!tegra_i2c_clock_enable(i2c_dev))
+		i2c_dev->clk_held = true;
+}
+
+/* Called with dev_lock held, after a transfer */
+static void tegra_i2c_clock_put(struct tegra_i2c_dev *i2c_dev)
+{
+	if (!i2c_dev->clk_held)
+		return;
+	if (!clk_idle_ms) {
+		tegra_i2c_clock_disable(i2c_dev);
+		i2c_dev->clk_held = false;
+		return;
+	}
+	i2c_dev->clk_last_use = jiffies;
+	if (!delayed_work_pending(&i2c_dev->clk_idle_work))
+		schedule_delayed_work(&i2c_dev->clk_idle_work,
+				      msecs_to_jiffies(clk_idle_ms));
+}
+
+static void tegra_i2c_clk_idle_work(struct work_struct *work)
+{
+	struct tegra_i2c_dev *i2c_dev = container_of(work,
+			struct tegra_i2c_dev, clk_idle_work.work);
+	unsigned long idle_at;
+
+	rt_mutex_lock(&i2c_dev->dev_lock);
+	idle_at = i2c_dev->clk_last_use + msecs_to_jiffies(clk_idle_ms);
+	if (!i2c_dev->clk_held)
+		goto out;
+	if (clk_idle_ms && time_before(jiffies, idle_at)) {
+		/* used again since this was queued */
+		schedule_delayed_work(&i2c_dev->clk_idle_work,
+				      idle_at - jiffies);
+		goto out;
+	}
+	tegra_i2c_clock_disable(i2c_dev);
+	i2c_dev->clk_held = false;
+out:
+	rt_mutex_unlock(&i2c_dev->dev_lock);
+}
+
 static int tegra_i2c_init(struct tegra_i2c_dev *i2c_dev)
 {
 	u32 val;
@@ -638,6 +725,45 @@ err:
 	return IRQ_HANDLED;
 }
 
+/*
+ * Whether the bus should be done with @msg within poll_max_us, counting
+ * nine clocks for the address and for each data byte.
+ */
+static bool tegra_i2c_can_poll(struct tegra_i2c_dev *i2c_dev,
+	struct i2c_msg *msg)
+{
+	u64 bus_ns;
+
+	if (!poll_max_us || !i2c_dev->last_bus_clk_rate)
+		return false;
+	bus_ns = div_u64((u64)(msg->len + 1) * 9 * NSEC_PER_SEC,
+			 i2c_dev->last_bus_clk_rate);
+	return bus_ns <= (u64)poll_max_us * NSEC_PER_USEC;
+}
+
+/*
+ * Runs the interrupt handler by hand while the status shows one of the
+ * interrupts in @int_mask, until the message completes.  The interrupt
+ * line is disabled by the caller.  Returns false if it took more than
+ * twice poll_max_us, the caller then waits for the interrupt as usual.
+ */
+static bool tegra_i2c_poll_completion(struct tegra_i2c_dev *i2c_dev,
+	u32 int_mask)
+{
+	ktime_t end = ktime_add_us(ktime_get(), 2 * poll_max_us);
+
+	int_mask |= I2C_INT_PACKET_XFER_COMPLETE;
+	do {
+		if (i2c_readl(i2c_dev, I2C_INT_STATUS) & int_mask)
+			tegra_i2c_isr(i2c_dev->irq, i2c_dev);
+		if (completion_done(&i2c_dev->msg_complete))
+			return true;
+		cpu_relax();
+	} while (ktime_to_ns(ktime_sub(end, ktime_get())) > 0);
+
+	return false;
+}
+
 static int tegra_i2c_xfer_msg(struct tegra_i2c_bus *i2c_bus,
 	struct i2c_msg *msg, int stop)
 {
@@ -645,6 +771,7 @@ static int tegra_i2c_xfer_msg(struct tegra_i2c_bus *i2c_bus,
 	u32 int_mask;
 	int ret;
 	int arb_stat;
+	bool poll;
 
 	if (msg->len == 0)
 		return -EINVAL;
@@ -662,6 +789,11 @@ static int tegra_i2c_xfer_msg(struct tegra_i2c_bus *i2c_bus,
 	INIT_COMPLETION(i2c_dev->msg_complete);
 	i2c_dev->msg_add = msg->addr;
 
+	/* the packet complete interrupt can come as soon as the header is in */
+	poll = tegra_i2c_can_poll(i2c_dev, msg);
+	if (poll)
+		disable_irq(i2c_dev->irq);
+
 	i2c_dev->packet_header = (0 << PACKET_HEADER0_HEADER_SIZE_SHIFT) |
 			PACKET_HEADER0_PROTOCOL_I2C |
 			(i2c_dev->cont_id << PACKET_HEADER0_CONT_ID_SHIFT) |
@@ -705,8 +837,17 @@ static int tegra_i2c_xfer_msg(struct tegra_i2c_bus *i2c_bus,
 	dev_dbg(i2c_dev->dev, "unmasked irq: %02x\n",
 		i2c_readl(i2c_dev, I2C_INT_MASK));
 
-	ret = wait_for_completion_timeout(&i2c_dev->msg_complete,
-					TEGRA_I2C_TIMEOUT);
+	ret = 0;
+	if (poll) {
+		if (tegra_i2c_poll_completion(i2c_dev, int_mask)) {
+			i2c_bus->polled++;
+			ret = 1;
+		}
+		enable_irq(i2c_dev->irq);
+	}
+	if (!ret)
+		ret = wait_for_completion_timeout(&i2c_dev->msg_complete,
+						  TEGRA_I2C_TIMEOUT);
 	tegra_i2c_mask_irq(i2c_dev, int_mask);
 
 	if (i2c_dev->is_dvc)
@@ -754,11 +895,30 @@ static int tegra_i2c_xfer_msg(struct tegra_i2c_bus *i2c_bus,
 	return -EIO;
 }
 
+static void tegra_i2c_account(struct tegra_i2c_bus *i2c_bus, int ret, u64 ns)
+{
+	unsigned int us = div_u64(ns, NSEC_PER_USEC);
+	unsigned int bucket = 0;
+
+	if (ret) {
+		i2c_bus->errors++;
+		return;
+	}
+	while (bucket < TEGRA_I2C_HIST_BUCKETS - 1 &&
+	       us >= 32U << (2 * bucket))
+		bucket++;
+	i2c_bus->hist[bucket]++;
+	i2c_bus->xfers++;
+	i2c_bus->total_ns += ns;
+	i2c_bus->max_ns = max(i2c_bus->max_ns, ns);
+}
+
 static int tegra_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[],
 	int num)
 {
 	struct tegra_i2c_bus *i2c_bus = i2c_get_adapdata(adap);
 	struct tegra_i2c_dev *i2c_dev = i2c_bus->dev;
+	ktime_t start = ktime_get();
 	int i;
 	int ret = 0;
 
@@ -786,8 +946,7 @@ static int tegra_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[],
 	i2c_dev->msgs = msgs;
 	i2c_dev->msgs_num = num;
 
-	if (!i2c_dev->is_clkon_always)
-		tegra_i2c_clock_enable(i2c_dev);
+	tegra_i2c_clock_get(i2c_dev);
 
 	for (i = 0; i < num; i++) {
 		int stop = (i == (num - 1)) ? 1  : 0;
@@ -796,8 +955,9 @@ static int tegra_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[],
 			break;
 	}
 
-	if (!i2c_dev->is_clkon_always)
-		tegra_i2c_clock_disable(i2c_dev);
+	tegra_i2c_clock_put(i2c_dev);
+	tegra_i2c_account(i2c_bus, ret,
+			  ktime_to_ns(ktime_sub(ktime_get(), start)));
 
 	rt_mutex_unlock(&i2c_dev->dev_lock);
 
@@ -818,6 +978,103 @@ static const struct i2c_algorithm tegra_i2c_algo = {
 	.functionality	= tegra_i2c_func,
 };
 
+#ifdef CONFIG_DEBUG_FS
+
+static struct dentry *tegra_i2c_debugfs_root;
+
+static int tegra_i2c_stats_show(struct seq_file *s, void *data)
+{
+	struct tegra_i2c_dev *i2c_dev = s->private;
+	int i;
+
+	rt_mutex_lock(&i2c_dev->dev_lock);
+	for (i = 0; i < i2c_dev->bus_count; i++) {
+		struct tegra_i2c_bus *i2c_bus = &i2c_dev->busses[i];
+		u64 avg = i2c_bus->xfers ?
+			div_u64(i2c_bus->total_ns, i2c_bus->xfers) : 0;
+
+		seq_printf(s, "i2c-%d: %lu Hz, xfers %lu errors %lu polled "
+			   "msgs %lu\n", i2c_bus->adapter.nr,
+			   i2c_bus->bus_clk_rate, i2c_bus->xfers,
+			   i2c_bus->errors, i2c_bus->polled);
+		seq_printf(s, "  avg %llu us max %llu us\n",
+			   div_u64(avg, NSEC_PER_USEC),
+			   div_u64(i2c_bus->max_ns, NSEC_PER_USEC));
+		seq_printf(s, "  us <32 %lu <128 %lu <512 %lu <2048 %lu "
+			   ">=2048 %lu\n", i2c_bus->hist[0], i2c_bus->hist[1],
+			   i2c_bus->hist[2], i2c_bus->hist[3],
+			   i2c_bus->hist[4]);
+	}
+	seq_printf(s, "clocks %s\n", i2c_dev->is_clkon_always ? "always on" :
+		   i2c_dev->clk_held ? "held" : "gated");
+	rt_mutex_unlock(&i2c_dev->dev_lock);
+	return 0;
+}
+
+/* any write clears the latency counters */
+static ssize_t tegra_i2c_stats_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct tegra_i2c_dev *i2c_dev = s->private;
+	int i;
+
+	rt_mutex_lock(&i2c_dev->dev_lock);
+	for (i = 0; i < i2c_dev->bus_count; i++) {
+		struct tegra_i2c_bus *i2c_bus = &i2c_dev->busses[i];
+
+		i2c_bus->xfers = 0;
+		i2c_bus->errors = 0;
+		i2c_bus->polled = 0;
+		i2c_bus->total_ns = 0;
+		i2c_bus->max_ns = 0;
+		memset(i2c_bus->hist, 0, sizeof(i2c_bus->hist));
+	}
+	rt_mutex_unlock(&i2c_dev->dev_lock);
+	return count;
+}
+
+static int tegra_i2c_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tegra_i2c_stats_show, inode->i_private);
+}
+
+static const struct file_operations tegra_i2c_stats_fops = {
+	.open		= tegra_i2c_stats_open,
+	.read		= seq_read,
+	.write		= tegra_i2c_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void tegra_i2c_debugfs_add(struct tegra_i2c_dev *i2c_dev)
+{
+	if (!tegra_i2c_debugfs_root)
+		tegra_i2c_debugfs_root = debugfs_create_dir("tegra_i2c", NULL);
+	if (!tegra_i2c_debugfs_root)
+		return;
+	i2c_dev->debugfs = debugfs_create_file(dev_name(i2c_dev->dev),
+		S_IRUGO | S_IWUSR, tegra_i2c_debugfs_root, i2c_dev,
+		&tegra_i2c_stats_fops);
+}
+
+static void tegra_i2c_debugfs_remove(struct tegra_i2c_dev *i2c_dev)
+{
+	debugfs_remove(i2c_dev->debugfs);
+}
+
+#else
+
+static inline void tegra_i2c_debugfs_add(struct tegra_i2c_dev *i2c_dev)
+{
+}
+
+static inline void tegra_i2c_debugfs_remove(struct tegra_i2c_dev *i2c_dev)
+{
+}
+
+#endif
+
 static int tegra_i2c_probe(struct platform_device *pdev)
 {
 	struct tegra_i2c_dev *i2c_dev;
@@ -919,6 +1176,7 @@ static int tegra_i2c_probe(struct platform_device *pdev)
 	i2c_dev->msgs_num = 0;
 	rt_mutex_init(&i2c_dev->dev_lock);
 	spin_lock_init(&i2c_dev->fifo_lock);
+	INIT_DELAYED_WORK(&i2c_dev->clk_idle_work, tegra_i2c_clk_idle_work);
 
 	i2c_dev->slave_addr = plat->slave_addr;
 	i2c_dev->hs_master_code = plat->hs_master_code;
@@ -986,6 +1244,7 @@ static int tegra_i2c_probe(struct platform_device *pdev)
 		i2c_dev->bus_count++;
 	}
 
+	tegra_i2c_debugfs_add(i2c_dev);
 	return 0;
 
 err_del_bus:
@@ -1008,10 +1267,13 @@ err_iounmap:
 static int tegra_i2c_remove(struct platform_device *pdev)
 {
 	struct tegra_i2c_dev *i2c_dev = platform_get_drvdata(pdev);
+
+	tegra_i2c_debugfs_remove(i2c_dev);
 	while (i2c_dev->bus_count--)
 		i2c_del_adapter(&i2c_dev->busses[i2c_dev->bus_count].adapter);
 
-	if (i2c_dev->is_clkon_always)
+	cancel_delayed_work_sync(&i2c_dev->clk_idle_work);
+	if (i2c_dev->is_clkon_always || i2c_dev->clk_held)
 		tegra_i2c_clock_disable(i2c_dev);
 
 	free_irq(i2c_dev->irq, i2c_dev);
@@ -1033,11 +1295,15 @@ static int tegra_i2c_suspend_noirq(struct device *dev)
 	rt_mutex_lock(&i2c_dev->dev_lock);
 
 	i2c_dev->is_suspended = true;
-	if (i2c_dev->is_clkon_always)
+	if (i2c_dev->is_clkon_always || i2c_dev->clk_held)
 		tegra_i2c_clock_disable(i2c_dev);
+	i2c_dev->clk_held = false;
 
 	rt_mutex_unlock(&i2c_dev->dev_lock);
 
+	/* finds nothing held if it still runs */
+	cancel_delayed_work(&i2c_dev->clk_idle_work);
+
 	return 0;
 }
 
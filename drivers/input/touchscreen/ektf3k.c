@@ -36,6 +36,9 @@
 #include <linux/switch.h>
 #include <linux/proc_fs.h>
 #include <linux/wakelock.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/touch_latency.h>
 
 #define PACKET_SIZE		40
 #define NEW_PACKET_SIZE 55
@@ -97,6 +100,11 @@ int Y_RESOLUTION=0x00;
 int FW_ID=0x00;
 static int work_lock=0x00;
 
+static bool combined_read = true;
+module_param(combined_read, bool, 0644);
+MODULE_PARM_DESC(combined_read,
+		 "Read all packets of a report in one i2c transfer");
+
 #define USB_NO_Cable 0
 #define USB_DETECT_CABLE 1 
 #define USB_SHIFT 0
@@ -133,8 +141,6 @@ static atomic_t touch_char_available = ATOMIC_INIT(1);
 struct elan_ktf3k_ts_data {
 	struct i2c_client *client;
 	struct input_dev *input_dev;
-	struct workqueue_struct *elan_wq;
-	struct work_struct work;
 	int (*power)(int on);
 	struct early_suspend early_suspend;
 	int intr_gpio;
@@ -155,6 +161,17 @@ struct elan_ktf3k_ts_data {
 #ifdef TOUCH_STRESS_TEST
       struct miscdevice  misc_dev;
 #endif 
+/* report statistics, see the stats attribute */
+	ktime_t attn_time;
+	unsigned int reports;
+	unsigned int packets;
+	unsigned int i2c_errors;
+	unsigned int lat_count;
+	u64 lat_total_us;
+	unsigned int lat_max_us;
+	ktime_t rate_start;
+	unsigned int rate_count;
+	unsigned int rate_hz;
 };
 
 static struct elan_ktf3k_ts_data *private_ts = NULL;
@@ -371,6 +388,39 @@ static ssize_t elan_show_status(struct device *dev, struct device_attribute *dev
 
 DEVICE_ATTR(elan_touchpanel_status, S_IRUGO, elan_show_status, NULL);
 
+static ssize_t elan_show_stats(struct device *dev,
+	struct device_attribute *devattr, char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct elan_ktf3k_ts_data *data = i2c_get_clientdata(client);
+
+	return sprintf(buf, "reports %u\npackets %u\nrate %u Hz\n"
+		"latency %u us avg, %u us max\ni2c errors %u\nchecksum errors %u\n",
+		data->reports, data->packets, data->rate_hz,
+		data->lat_count ? (unsigned int)div_u64(data->lat_total_us,
+							 data->lat_count) : 0,
+		data->lat_max_us, data->i2c_errors, checksum_err);
+}
+
+/* any write clears the counters */
+static ssize_t elan_clear_stats(struct device *dev,
+	struct device_attribute *devattr, const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct elan_ktf3k_ts_data *data = i2c_get_clientdata(client);
+
+	data->reports = 0;
+	data->packets = 0;
+	data->i2c_errors = 0;
+	data->lat_count = 0;
+	data->lat_total_us = 0;
+	data->lat_max_us = 0;
+	checksum_err = 0;
+	return count;
+}
+
+DEVICE_ATTR(stats, S_IRUGO | S_IWUSR, elan_show_stats, elan_clear_stats);
+
 static int check_fw_version(const unsigned char*firmware, unsigned int size, int fw_version){
        int id, version;
 	   
@@ -442,6 +492,7 @@ static struct attribute *elan_attr[] = {
 	&dev_attr_vendor.attr,
 	&dev_attr_gpio.attr,
 	&dev_attr_update_fw.attr,
+	&dev_attr_stats.attr,
 	NULL
 };
 
@@ -1060,116 +1111,139 @@ static void process_resp_message(struct elan_ktf3k_ts_data *ts, const unsigned c
       }
 }
 
-static void elan_ktf3k_ts_work_func(struct work_struct *work)
+/*
+ * Read the @pkts finger packets that follow a buffer mode header.  With
+ * combined_read they come in one transfer, which the controller streams
+ * back to back; otherwise one transfer per packet as before.
+ */
+static int elan_ktf3k_ts_read_report(struct elan_ktf3k_ts_data *ts,
+				     uint8_t *buf, int pkt_size, int pkts)
 {
-	int rc;
-	struct elan_ktf3k_ts_data *ts =
-		container_of(work, struct elan_ktf3k_ts_data, work);
-	uint8_t buf[NEW_PACKET_SIZE + 4] = { 0 };
-	uint8_t buf1[NEW_PACKET_SIZE] = { 0 };
-	uint8_t buf2[NEW_PACKET_SIZE] = { 0 };
+	int rc, i;
+
+	if (combined_read) {
+		rc = elan_ktf3k_ts_recv_data(ts->client, buf, pkt_size * pkts);
+		up(&pSem);
+		return rc;
+	}
+
+	rc = elan_ktf3k_ts_recv_data(ts->client, buf, pkt_size);
+	up(&pSem);
+	for (i = 1; i < pkts && rc >= 0; i++)
+		rc = elan_ktf3k_ts_recv_data(ts->client, buf + i * pkt_size,
+					     pkt_size);
+	return rc;
+}
+
+static void elan_ktf3k_ts_account(struct elan_ktf3k_ts_data *ts, int pkts)
+{
+	ktime_t now = ktime_get();
+	s64 us = ktime_us_delta(now, ts->attn_time);
+
+	ts->reports++;
+	ts->packets += pkts;
+	if (us >= 0 && us < USEC_PER_SEC) {
+		ts->lat_total_us += us;
+		ts->lat_count++;
+		if (us > ts->lat_max_us)
+			ts->lat_max_us = us;
+	}
+
+	/* the rate is over the last second with reports in it */
+	ts->rate_count++;
+	us = ktime_us_delta(now, ts->rate_start);
+	if (us >= USEC_PER_SEC) {
+		if (us < 2 * USEC_PER_SEC)
+			ts->rate_hz = div64_s64((s64)ts->rate_count *
+						USEC_PER_SEC, us);
+		ts->rate_start = now;
+		ts->rate_count = 0;
+	}
+}
+
+static irqreturn_t elan_ktf3k_ts_irq_thread(int irq, void *dev_id)
+{
+	int rc, i, pkts, pkt_size;
+	struct elan_ktf3k_ts_data *ts = dev_id;
+	uint8_t buf[4 + 3 * NEW_PACKET_SIZE] = { 0 };
 
+	dev_dbg(&ts->client->dev, "[elan] %s\n", __func__);
 	if(work_lock!=0) {
 		touch_debug(DEBUG_INFO, "Firmware update during touch event handling");
-		enable_irq(ts->client->irq);
-		return;
+		return IRQ_HANDLED;
 	}
-	      
+
 #ifndef ELAN_BUFFER_MODE
-		rc = elan_ktf3k_ts_recv_data(ts->client, buf, 40);
+	rc = elan_ktf3k_ts_recv_data(ts->client, buf, 40);
+	if (rc < 0) {
+		ts->i2c_errors++;
+		return IRQ_HANDLED;
+	}
+	elan_ktf3k_ts_report_data(ts->client, buf);
+	elan_ktf3k_ts_account(ts, 1);
 #else
-             down(&pSem);
-		rc = elan_ktf3k_ts_recv_data(ts->client, buf, 4); // read the first four bytes
-#endif 
-		if (rc < 0)
-		{
-                   up(&pSem);
-			enable_irq(ts->client->irq);
-			return;
+	down(&pSem);
+	/* the header, buf[1] is the number of packets that follow */
+	rc = elan_ktf3k_ts_recv_data(ts->client, buf, 4);
+	if (rc < 0) {
+		up(&pSem);
+		ts->i2c_errors++;
+		return IRQ_HANDLED;
+	}
+
+	switch (buf[0]) {
+	case NORMAL_PKT:
+	case NEW_NOMARL_PKT:
+		pkt_size = buf[0] == NORMAL_PKT ? PACKET_SIZE : NEW_PACKET_SIZE;
+		pkts = (buf[1] == 2 || buf[1] == 3) ? buf[1] : 1;
+		rc = elan_ktf3k_ts_read_report(ts, buf + 4, pkt_size, pkts);
+		if (rc < 0) {
+			ts->i2c_errors++;
+			break;
 		}
-#ifndef ELAN_BUFFER_MODE
-		elan_ktf3k_ts_report_data(ts->client, buf);
-#else
-             switch(buf[0]){
-             case NORMAL_PKT:
-		    rc = elan_ktf3k_ts_recv_data(ts->client, buf+4, 40); // read the finger report packet.
-		    up(&pSem);
-		    elan_ktf3k_ts_report_data(ts->client, buf+4);
-	           // Second package
-	 	    if ((buf[1] == 2) || (buf[1] == 3)) {
-		        rc = elan_ktf3k_ts_recv_data(ts->client, buf1,PACKET_SIZE);
-                     if (rc < 0){
-			      enable_irq(ts->client->irq);
-				return;
-			  }
-			  elan_ktf3k_ts_report_data(ts->client, buf1);
-		    }
-		
-	           // Final package
-		    if (buf[1] == 3) {
-		        rc = elan_ktf3k_ts_recv_data(ts->client, buf2, PACKET_SIZE);
-		        if (rc < 0){
-		            enable_irq(ts->client->irq);
-                         return;
-                     }
-                     elan_ktf3k_ts_report_data(ts->client, buf2);
-                 }
-		    break;
-		case NEW_NOMARL_PKT:
-		    rc = elan_ktf3k_ts_recv_data(ts->client, buf+4, NEW_PACKET_SIZE); // read the finger report packet.
-		    up(&pSem);
-		    elan_ktf3k_ts_report_data2(ts->client, buf+4);
-	           // Second package
-	 	    if ((buf[1] == 2) || (buf[1] == 3)) {
-		        rc = elan_ktf3k_ts_recv_data(ts->client, buf1,NEW_PACKET_SIZE);
-                     if (rc < 0){
-			      enable_irq(ts->client->irq);
-				return;
-			  }
-			  elan_ktf3k_ts_report_data2(ts->client, buf1);
-		    }
-		
-	           // Final package
-		    if (buf[1] == 3) {
-		        rc = elan_ktf3k_ts_recv_data(ts->client, buf2, NEW_PACKET_SIZE);
-		        if (rc < 0){
-		            enable_irq(ts->client->irq);
-                         return;
-                     }
-                     elan_ktf3k_ts_report_data2(ts->client, buf2);
-                 }
-		    break;
-             case CMD_S_PKT:
-		    up(&pSem);
-                 process_resp_message(ts, buf, 4);
-		    break;
-		default:
-		    up(&pSem);	
-		    touch_debug(DEBUG_INFO, "[elan] Get unknow packet {0x%02X, 0x%02X, 0x%02X, 0x%02X}\n", buf[0], buf[1], buf[2], buf[3]);
-	       }		 
+		for (i = 0; i < pkts; i++) {
+			if (buf[0] == NORMAL_PKT)
+				elan_ktf3k_ts_report_data(ts->client,
+						buf + 4 + i * pkt_size);
+			else
+				elan_ktf3k_ts_report_data2(ts->client,
+						buf + 4 + i * pkt_size);
+		}
+		elan_ktf3k_ts_account(ts, pkts);
+		break;
+	case CMD_S_PKT:
+		up(&pSem);
+		process_resp_message(ts, buf, 4);
+		break;
+	default:
+		up(&pSem);
+		touch_debug(DEBUG_INFO, "[elan] Get unknow packet {0x%02X, 0x%02X, 0x%02X, 0x%02X}\n", buf[0], buf[1], buf[2], buf[3]);
+	}
 #endif
-		enable_irq(ts->client->irq);
+	return IRQ_HANDLED;
 }
 
 static irqreturn_t elan_ktf3k_ts_irq_handler(int irq, void *dev_id)
 {
 	struct elan_ktf3k_ts_data *ts = dev_id;
-	struct i2c_client *client = ts->client;
-
-	dev_dbg(&client->dev, "[elan] %s\n", __func__);
-	disable_irq_nosync(ts->client->irq);
-	queue_work(ts->elan_wq, &ts->work);
 
-	return IRQ_HANDLED;
+	ts->attn_time = ktime_get();
+	touch_latency_mark(TOUCH_LAT_IRQ);
+	return IRQ_WAKE_THREAD;
 }
 
+/*
+ * The line is level triggered and stays masked until the thread is done,
+ * so each report is read exactly once without disabling the irq by hand.
+ */
 static int elan_ktf3k_ts_register_interrupt(struct i2c_client *client)
 {
 	struct elan_ktf3k_ts_data *ts = i2c_get_clientdata(client);
 	int err = 0;
 
-	err = request_irq(client->irq, elan_ktf3k_ts_irq_handler,
-			IRQF_TRIGGER_LOW, client->name, ts);
+	err = request_threaded_irq(client->irq, elan_ktf3k_ts_irq_handler,
+			elan_ktf3k_ts_irq_thread,
+			IRQF_TRIGGER_LOW | IRQF_ONESHOT, client->name, ts);
 	if (err)
 		dev_err(&client->dev, "[elan] %s: request_irq %d failed\n",
 				__func__, client->irq);
@@ -1502,14 +1576,6 @@ static int elan_ktf3k_ts_probe(struct i2c_client *client,
 		goto err_alloc_data_failed;
 	}
 
-	ts->elan_wq = create_singlethread_workqueue("elan_wq");
-	if (!ts->elan_wq) {
-		touch_debug(DEBUG_ERROR, "[elan] %s: create workqueue failed\n", __func__);
-		err = -ENOMEM;
-		goto err_create_wq_failed;
-	}
-
-	INIT_WORK(&ts->work, elan_ktf3k_ts_work_func);
 	ts->client = client;
 	i2c_set_clientdata(client, ts);
 	pdata = client->dev.platform_data;
@@ -1571,12 +1637,8 @@ static int elan_ktf3k_ts_probe(struct i2c_client *client,
 		goto err_input_register_device_failed;
 	}
 
+	/* level triggered: a pending report fires as soon as it is requested */
 	elan_ktf3k_ts_register_interrupt(ts->client);
-
-	if (gpio_get_value(ts->intr_gpio) == 0) {
-		touch_debug(DEBUG_INFO, "[elan]%s: handle missed interrupt\n", __func__);
-		elan_ktf3k_ts_irq_handler(client->irq, ts);
-	}
 	
 #ifdef FIRMWARE_UPDATE_WITH_HEADER	
       if(RECOVERY || check_fw_version(touch_firmware, sizeof(touch_firmware), ts->fw_ver) > 0)
@@ -1660,10 +1722,6 @@ err_input_register_device_failed:
 
 err_input_dev_alloc_failed:
 err_detect_failed:
-	if (ts->elan_wq)
-		destroy_workqueue(ts->elan_wq);
-
-err_create_wq_failed:
 	kfree(ts);
 
 err_alloc_data_failed:
@@ -1681,8 +1739,6 @@ static int elan_ktf3k_ts_remove(struct i2c_client *client)
 	unregister_early_suspend(&ts->early_suspend);
 	free_irq(client->irq, ts);
 
-	if (ts->elan_wq)
-		destroy_workqueue(ts->elan_wq);
 	input_unregister_device(ts->input_dev);
 	wake_lock_destroy(&ts->wakelock);
 #ifdef TOUCH_STRESS_TEST
@@ -1697,17 +1753,13 @@ static int elan_ktf3k_ts_remove(struct i2c_client *client)
 
 static int elan_ktf3k_ts_suspend(struct i2c_client *client, pm_message_t mesg)
 {
-	struct elan_ktf3k_ts_data *ts = i2c_get_clientdata(client);
 	int rc = 0;
 
 	touch_debug(DEBUG_INFO, "[elan] %s: enter\n", __func__);
 
+	/* waits for a report in progress */
 	disable_irq(client->irq);
 
-	rc = cancel_work_sync(&ts->work);
-	if (rc)
-		enable_irq(client->irq);
-
 	if(work_lock == 0)
 	    rc = elan_ktf3k_ts_set_power_state(client, PWR_STATE_DEEP_SLEEP);
 
@@ -1769,6 +1821,8 @@ static struct i2c_driver ektf3k_ts_driver = {
 	.id_table	= elan_ktf3k_ts_id,
 	.driver		= {
 		.name = ELAN_KTF3K_NAME,
+		/* the firmware handshake takes a while, nothing waits for it */
+		.async_probe = true,
 	},
 };
 
@@ -290,6 +290,7 @@ static int init_one_function(struct rmi_device *rmi_dev,
 			fc->fd.function_number);
 		goto error_exit;
 	}
+	rmi_get_driverdata(rmi_dev)->burst_checked = false;
 
 	return 0;
 
@@ -324,6 +325,10 @@ static void rmi_driver_fh_remove(struct rmi_device *rmi_dev,
 
 	list_for_each_entry(entry, &data->rmi_functions.list, list)
 		if (entry->fd.function_number == fh->func) {
+			if (data->burst_fc == entry) {
+				data->burst_fc = NULL;
+				data->burst_checked = false;
+			}
 			if (fh->remove)
 				fh->remove(entry);
 
@@ -339,22 +344,65 @@ static void construct_mask(u8 *mask, int num, int pos)
 		u8_set_bit(mask, pos+i);
 }
 
+/*
+ * Find a function whose data registers sit on the same page as the
+ * interrupt status and close enough behind it that one read can fetch
+ * both.  Typically that is F11 right after F01, which saves a transfer
+ * on each touch report.
+ */
+static void rmi_driver_find_burst(struct rmi_driver_data *data)
+{
+	struct rmi_function_container *entry;
+	u16 start = data->f01_container->fd.data_base_addr + 1;
+	u16 data_start = start + data->num_of_irq_regs;
+
+	data->burst_fc = NULL;
+	data->burst_checked = true;
+
+	list_for_each_entry(entry, &data->rmi_functions.list, list) {
+		u16 addr = entry->fd.data_base_addr;
+
+		if (!entry->fh || !entry->irq_data_size)
+			continue;
+		if (addr < data_start || (addr ^ start) >= RMI4_PAGE_SIZE ||
+		    addr + entry->irq_data_size - start > RMI_IRQ_BURST_MAX)
+			continue;
+		data->burst_fc = entry;
+		break;
+	}
+}
+
 static int process_interrupt_requests(struct rmi_device *rmi_dev)
 {
 	struct rmi_driver_data *data = rmi_get_driverdata(rmi_dev);
 	struct device *dev = &rmi_dev->dev;
 	struct rmi_function_container *entry;
+	struct rmi_function_container *burst_fc;
+	u16 start = data->f01_container->fd.data_base_addr + 1;
 	u8 irq_status[data->num_of_irq_regs];
 	u8 irq_bits[data->num_of_irq_regs];
 	int error;
 
-	error = rmi_read_block(rmi_dev,
-				data->f01_container->fd.data_base_addr + 1,
-				irq_status, data->num_of_irq_regs);
+	if (!data->burst_checked)
+		rmi_driver_find_burst(data);
+	burst_fc = data->burst_fc;
+
+	if (burst_fc)
+		error = rmi_read_block(rmi_dev, start, data->irq_burst,
+				burst_fc->fd.data_base_addr - start +
+				burst_fc->irq_data_size);
+	else
+		error = rmi_read_block(rmi_dev, start, irq_status,
+				data->num_of_irq_regs);
 	if (error < 0) {
 		dev_err(dev, "%s: failed to read irqs.", __func__);
 		return error;
 	}
+	if (burst_fc) {
+		memcpy(irq_status, data->irq_burst, data->num_of_irq_regs);
+		burst_fc->irq_data = data->irq_burst +
+				(burst_fc->fd.data_base_addr - start);
+	}
 	/* Device control (F01) is handled before anything else. */
 	u8_and(irq_bits, irq_status, data->f01_container->irq_mask,
 			data->num_of_irq_regs);
@@ -388,6 +436,8 @@ static int process_interrupt_requests(struct rmi_device *rmi_dev)
 			}
 		}
 	}
+	if (burst_fc)
+		burst_fc->irq_data = NULL;
 	return 0;
 }
 
@@ -33,6 +33,9 @@
 #define RMI_PRODUCT_INFO_LENGTH   2
 #define RMI_DATE_CODE_LENGTH      3
 
+/* Longest read of interrupt status plus function data done per interrupt */
+#define RMI_IRQ_BURST_MAX       128
+
 struct rmi_driver_data {
 	struct rmi_function_container rmi_functions;
 
@@ -45,6 +48,14 @@ struct rmi_driver_data {
 	struct mutex irq_mutex;
 	struct lock_class_key irq_key;
 
+	/*
+	 * Data registers of burst_fc that follow the interrupt status
+	 * closely enough to be read with it in one transfer.
+	 */
+	struct rmi_function_container *burst_fc;
+	bool burst_checked;
+	u8 irq_burst[RMI_IRQ_BURST_MAX];
+
 	unsigned char pdt_props;
 	unsigned char bsr;
 	bool enabled;
@@ -18,6 +18,9 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/delay.h>
+#include <linux/math64.h>
 #include <linux/slab.h>
 #include <linux/input.h>
 #include <linux/rmi.h>
@@ -26,6 +29,16 @@
 #define F11_MAX_NUM_OF_FINGERS		10
 #define F11_MAX_NUM_OF_TOUCH_SHAPES	16
 
+/*
+ * Minimum time between two reports, 0 to report every interrupt.  When
+ * the controller interrupts sooner than this after the last report, the
+ * read is held back to the end of the interval so that a whole frame's
+ * worth of motion goes up in one input_sync.
+ */
+static unsigned int frame_us;
+module_param(frame_us, uint, 0644);
+MODULE_PARM_DESC(frame_us, "Minimum interval between reports (us)");
+
 #define F11_REL_POS_MIN		-128
 #define F11_REL_POS_MAX		127
 
@@ -97,6 +110,12 @@ static ssize_t rmi_f11_rezero_store(struct device *dev,
 					 struct device_attribute *attr,
 					 const char *buf, size_t count);
 
+static ssize_t rmi_f11_latency_show(struct device *dev,
+				    struct device_attribute *attr, char *buf);
+
+static ssize_t rmi_f11_latency_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count);
 
 static struct device_attribute attrs[] = {
 	__ATTR(flip, RMI_RW_ATTR, rmi_fn_11_flip_show, rmi_fn_11_flip_store),
@@ -107,7 +126,9 @@ static struct device_attribute attrs[] = {
 	__ATTR(relreport, RMI_RW_ATTR,
 		rmi_fn_11_relreport_show, rmi_fn_11_relreport_store),
 	__ATTR(maxPos, RMI_RO_ATTR, rmi_fn_11_maxPos_show, rmi_store_error),
-	__ATTR(rezero, RMI_WO_ATTR, rmi_show_error, rmi_f11_rezero_store)
+	__ATTR(rezero, RMI_WO_ATTR, rmi_show_error, rmi_f11_rezero_store),
+	__ATTR(latency, RMI_RW_ATTR,
+		rmi_f11_latency_show, rmi_f11_latency_store)
 };
 
 
@@ -314,6 +335,12 @@ struct f11_data {
 	struct f11_2d_device_query dev_query;
 	struct rmi_f11_2d_ctrl dev_controls;
 	struct f11_2d_sensor sensors[F11_MAX_NUM_OF_SENSORS];
+
+	/* attention interrupt to input_sync, see the latency attribute */
+	ktime_t last_sync;
+	unsigned int lat_count;
+	u64 lat_total_us;
+	unsigned int lat_max_us;
 };
 
 enum finger_state_values {
@@ -1168,6 +1195,10 @@ static int rmi_f11_init(struct rmi_function_container *fc)
 
 	}
 
+	/* lets the core read our data together with the irq status */
+	for (i = 0; i < f11->dev_query.nbr_of_sensors + 1; i++)
+		fc->irq_data_size += f11->sensors[i].pkt_size;
+
 	dev_info(&fc->dev, "Creating sysfs files.");
 	dev_dbg(&fc->dev, "Creating fn11 sysfs files.");
 
@@ -1207,20 +1238,47 @@ int rmi_f11_attention(struct rmi_function_container *fc, u8 *irq_bits)
 	struct f11_data *f11 = fc->data;
 	u8 data_base_addr = fc->fd.data_base_addr;
 	int data_base_addr_offset = 0;
+	ktime_t now;
+	s64 us;
 	int error;
 	int i;
 
+	if (frame_us) {
+		us = ktime_us_delta(ktime_get(), f11->last_sync);
+		if (us >= 0 && us < frame_us) {
+			usleep_range(frame_us - us, frame_us - us + 500);
+			/* read again, the burst is stale by now */
+			fc->irq_data = NULL;
+		}
+	}
+
 	for (i = 0; i < f11->dev_query.nbr_of_sensors + 1; i++) {
-		error = rmi_read_block(rmi_dev,
-				data_base_addr + data_base_addr_offset,
-				f11->sensors[i].data_pkt,
-				f11->sensors[i].pkt_size);
-		if (error < 0)
-			return error;
+		if (fc->irq_data)
+			memcpy(f11->sensors[i].data_pkt,
+			       fc->irq_data + data_base_addr_offset,
+			       f11->sensors[i].pkt_size);
+		else {
+			error = rmi_read_block(rmi_dev,
+					data_base_addr + data_base_addr_offset,
+					f11->sensors[i].data_pkt,
+					f11->sensors[i].pkt_size);
+			if (error < 0)
+				return error;
+		}
 
 		rmi_f11_finger_handler(&f11->sensors[i]);
 		data_base_addr_offset += f11->sensors[i].pkt_size;
 	}
+
+	now = ktime_get();
+	us = ktime_us_delta(now, rmi_dev->phys->attn_time);
+	if (us >= 0 && us < USEC_PER_SEC) {
+		f11->lat_count++;
+		f11->lat_total_us += us;
+		if (us > f11->lat_max_us)
+			f11->lat_max_us = us;
+	}
+	f11->last_sync = now;
 	return 0;
 }
 
@@ -1504,6 +1562,34 @@ static ssize_t rmi_f11_rezero_store(struct device *dev,
 	return count;
 }
 
+static ssize_t rmi_f11_latency_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct rmi_function_container *fc = to_rmi_function_container(dev);
+	struct f11_data *data = fc->data;
+	unsigned int avg = 0;
+
+	if (data->lat_count)
+		avg = div_u64(data->lat_total_us, data->lat_count);
+
+	return snprintf(buf, PAGE_SIZE, "%u reports, %u us avg, %u us max\n",
+			data->lat_count, avg, data->lat_max_us);
+}
+
+/* any write clears the counters */
+static ssize_t rmi_f11_latency_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	struct rmi_function_container *fc = to_rmi_function_container(dev);
+	struct f11_data *data = fc->data;
+
+	data->lat_count = 0;
+	data->lat_total_us = 0;
+	data->lat_max_us = 0;
+	return count;
+}
+
 
 module_init(rmi_f11_module_init);
 module_exit(rmi_f11_module_exit);
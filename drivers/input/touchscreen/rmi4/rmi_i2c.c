@@ -26,6 +26,7 @@
 #include <linux/pm.h>
 #include <linux/gpio.h>
 #include <linux/rmi.h>
+#include <linux/touch_latency.h>
 
 #define COMMS_DEBUG 0
 
@@ -45,6 +46,16 @@ struct rmi_i2c_data {
 	struct rmi_phys_device *phys;
 };
 
+static irqreturn_t rmi_i2c_hard_irq(int irq, void *p)
+{
+	struct rmi_phys_device *phys = p;
+
+	phys->attn_time = ktime_get();
+	touch_latency_mark(TOUCH_LAT_IRQ);
+
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t rmi_i2c_irq_thread(int irq, void *p)
 {
 	struct rmi_phys_device *phys = p;
@@ -209,7 +220,8 @@ static int rmi_i2c_read(struct rmi_phys_device *phys, u16 addr, u8 *buf)
 
 static int acquire_attn_irq(struct rmi_i2c_data *data)
 {
-	return request_threaded_irq(data->irq, NULL, rmi_i2c_irq_thread,
+	return request_threaded_irq(data->irq, rmi_i2c_hard_irq,
+			rmi_i2c_irq_thread,
 			data->irq_flags, dev_name(data->phys->dev), data->phys);
 }
 
@@ -25,6 +25,7 @@
 #include <linux/sched.h>
 #include <linux/gpio.h>
 #include <linux/rmi.h>
+#include <linux/touch_latency.h>
 
 #define COMMS_DEBUG 0
 
@@ -64,6 +65,9 @@ static irqreturn_t rmi_spi_hard_irq(int irq, void *p)
 	struct rmi_spi_data *data = phys->data;
 	struct rmi_device_platform_data *pdata = phys->dev->platform_data;
 
+	phys->attn_time = ktime_get();
+	touch_latency_mark(TOUCH_LAT_IRQ);
+
 	if (data->split_read_pending &&
 		      gpio_get_value(irq_to_gpio(irq)) == pdata->irq_polarity) {
 		phys->info.attn_count++;
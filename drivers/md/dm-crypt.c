@@ -27,6 +27,25 @@
 
 #define DM_MSG_PREFIX "crypt"
 
+/*
+ * Optional second cipher driver for large bios, e.g. "cbc-aes-tegra".
+ * Bios of at least offload_min_bytes are converted with it and smaller
+ * ones with the default (cpu) implementation, whose per-request setup
+ * cost is lower.
+ */
+static char *offload_driver;
+module_param(offload_driver, charp, 0644);
+MODULE_PARM_DESC(offload_driver, "Cipher driver used for large bios");
+
+static unsigned int offload_min_bytes = 16384;
+module_param(offload_min_bytes, uint, 0644);
+MODULE_PARM_DESC(offload_min_bytes, "Smallest bio sent to offload_driver");
+
+static unsigned int crypt_workers;
+module_param(crypt_workers, uint, 0444);
+MODULE_PARM_DESC(crypt_workers,
+		 "Concurrent kcryptd workers per mapping, 0 for one per cpu");
+
 /*
  * context holding the current state of a multi-part conversion
  */
@@ -40,6 +59,8 @@ struct convert_context {
 	unsigned int idx_out;
 	sector_t sector;
 	atomic_t pending;
+	struct crypto_ablkcipher *tfm;
+	struct ablkcipher_request *req;
 };
 
 /*
@@ -131,9 +152,10 @@ struct crypt_config {
 	 * correctly aligned.
 	 */
 	unsigned int dmreq_start;
-	struct ablkcipher_request *req;
 
 	struct crypto_ablkcipher *tfm;
+	struct crypto_ablkcipher *offload_tfm;
+
 	unsigned long flags;
 	unsigned int key_size;
 	u8 key[0];
@@ -385,6 +407,11 @@ static void crypt_convert_init(struct crypt_config *cc,
 	ctx->idx_out = bio_out ? bio_out->bi_idx : 0;
 	ctx->sector = sector + cc->iv_offset;
 	init_completion(&ctx->restart);
+
+	ctx->req = NULL;
+	ctx->tfm = cc->tfm;
+	if (cc->offload_tfm && bio_in->bi_size >= offload_min_bytes)
+		ctx->tfm = cc->offload_tfm;
 }
 
 static struct dm_crypt_request *dmreq_of_req(struct crypt_config *cc,
@@ -411,7 +438,7 @@ static int crypt_convert_block(struct crypt_config *cc,
 
 	dmreq = dmreq_of_req(cc, req);
 	iv = (u8 *)ALIGN((unsigned long)(dmreq + 1),
-			 crypto_ablkcipher_alignmask(cc->tfm) + 1);
+			 crypto_ablkcipher_alignmask(ctx->tfm) + 1);
 
 	dmreq->ctx = ctx;
 	sg_init_table(&dmreq->sg_in, 1);
@@ -456,13 +483,26 @@ static void kcryptd_async_done(struct crypto_async_request *async_req,
 static void crypt_alloc_req(struct crypt_config *cc,
 			    struct convert_context *ctx)
 {
-	if (!cc->req)
-		cc->req = mempool_alloc(cc->req_pool, GFP_NOIO);
-	ablkcipher_request_set_tfm(cc->req, cc->tfm);
-	ablkcipher_request_set_callback(cc->req, CRYPTO_TFM_REQ_MAY_BACKLOG |
+	if (!ctx->req)
+		ctx->req = mempool_alloc(cc->req_pool, GFP_NOIO);
+	ablkcipher_request_set_tfm(ctx->req, ctx->tfm);
+	ablkcipher_request_set_callback(ctx->req, CRYPTO_TFM_REQ_MAY_BACKLOG |
 					CRYPTO_TFM_REQ_MAY_SLEEP,
 					kcryptd_async_done,
-					dmreq_of_req(cc, cc->req));
+					dmreq_of_req(cc, ctx->req));
+}
+
+/*
+ * The request is kept in the conversion context, not in crypt_config,
+ * so several kcryptd workers can convert bios at the same time.
+ */
+static void crypt_free_req(struct crypt_config *cc,
+			   struct convert_context *ctx)
+{
+	if (ctx->req) {
+		mempool_free(ctx->req, cc->req_pool);
+		ctx->req = NULL;
+	}
 }
 
 /*
@@ -482,7 +522,7 @@ static int crypt_convert(struct crypt_config *cc,
 
 		atomic_inc(&ctx->pending);
 
-		r = crypt_convert_block(cc, ctx, cc->req);
+		r = crypt_convert_block(cc, ctx, ctx->req);
 
 		switch (r) {
 		/* async */
@@ -491,7 +531,7 @@ static int crypt_convert(struct crypt_config *cc,
 			INIT_COMPLETION(ctx->restart);
 			/* fall through*/
 		case -EINPROGRESS:
-			cc->req = NULL;
+			ctx->req = NULL;
 			ctx->sector++;
 			continue;
 
@@ -505,10 +545,12 @@ static int crypt_convert(struct crypt_config *cc,
 		/* error */
 		default:
 			atomic_dec(&ctx->pending);
+			crypt_free_req(cc, ctx);
 			return r;
 		}
 	}
 
+	crypt_free_req(cc, ctx);
 	return 0;
 }
 
@@ -970,6 +1012,17 @@ static void crypt_encode_key(char *hex, u8 *key, unsigned int size)
 	}
 }
 
+static int crypt_setkey_tfms(struct crypt_config *cc)
+{
+	int r;
+
+	r = crypto_ablkcipher_setkey(cc->tfm, cc->key, cc->key_size);
+	if (!r && cc->offload_tfm)
+		r = crypto_ablkcipher_setkey(cc->offload_tfm, cc->key,
+					     cc->key_size);
+	return r;
+}
+
 static int crypt_set_key(struct crypt_config *cc, char *key)
 {
 	/* The key size may not be changed. */
@@ -985,14 +1038,14 @@ static int crypt_set_key(struct crypt_config *cc, char *key)
 
 	set_bit(DM_CRYPT_KEY_VALID, &cc->flags);
 
-	return crypto_ablkcipher_setkey(cc->tfm, cc->key, cc->key_size);
+	return crypt_setkey_tfms(cc);
 }
 
 static int crypt_wipe_key(struct crypt_config *cc)
 {
 	clear_bit(DM_CRYPT_KEY_VALID, &cc->flags);
 	memset(&cc->key, 0, cc->key_size * sizeof(u8));
-	return crypto_ablkcipher_setkey(cc->tfm, cc->key, cc->key_size);
+	return crypt_setkey_tfms(cc);
 }
 
 static void crypt_dtr(struct dm_target *ti)
@@ -1024,6 +1077,8 @@ static void crypt_dtr(struct dm_target *ti)
 
 	if (cc->tfm && !IS_ERR(cc->tfm))
 		crypto_free_ablkcipher(cc->tfm);
+	if (cc->offload_tfm)
+		crypto_free_ablkcipher(cc->offload_tfm);
 
 	if (cc->dev)
 		dm_put_device(ti, cc->dev);
@@ -1035,6 +1090,41 @@ static void crypt_dtr(struct dm_target *ti)
 	kzfree(cc);
 }
 
+/*
+ * The offload driver must implement the same mode as the mapping. Drivers
+ * kept out of normal lookups register under a prefixed name (tegra-aes
+ * uses "disabled_cbc(aes)"), so only the end of the name is compared.
+ * Called once the key is set; if anything does not match, all bios use
+ * the default tfm.
+ */
+static void crypt_alloc_offload(struct crypt_config *cc,
+				const char *cipher_api)
+{
+	struct crypto_ablkcipher *tfm;
+	const char *name;
+	size_t len, api_len = strlen(cipher_api);
+
+	tfm = crypto_alloc_ablkcipher(offload_driver, 0, 0);
+	if (IS_ERR(tfm)) {
+		DMWARN("Offload driver %s not available", offload_driver);
+		return;
+	}
+
+	name = crypto_tfm_alg_name(crypto_ablkcipher_tfm(tfm));
+	len = strlen(name);
+	if (len < api_len || strcmp(name + len - api_len, cipher_api) ||
+	    crypto_ablkcipher_ivsize(tfm) !=
+	    crypto_ablkcipher_ivsize(cc->tfm) ||
+	    crypto_ablkcipher_setkey(tfm, cc->key, cc->key_size)) {
+		DMWARN("Offload driver %s cannot handle %s", offload_driver,
+		       cipher_api);
+		crypto_free_ablkcipher(tfm);
+		return;
+	}
+
+	cc->offload_tfm = tfm;
+}
+
 static int crypt_ctr_cipher(struct dm_target *ti,
 			    char *cipher_in, char *key)
 {
@@ -1111,6 +1201,9 @@ static int crypt_ctr_cipher(struct dm_target *ti,
 		goto bad;
 	}
 
+	if (offload_driver && *offload_driver)
+		crypt_alloc_offload(cc, cipher_api);
+
 	/* Initialize IV */
 	cc->iv_size = crypto_ablkcipher_ivsize(cc->tfm);
 	if (cc->iv_size)
@@ -1181,6 +1274,7 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	int ret;
 	struct dm_arg_set as;
 	const char *opt_string;
+	unsigned int reqsize, alignmask;
 
 	static struct dm_arg _args[] = {
 		{0, 1, "Invalid number of feature args"},
@@ -1212,11 +1306,20 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad;
 	}
 
+	/* requests from the pool may be used with either tfm */
+	reqsize = crypto_ablkcipher_reqsize(cc->tfm);
+	alignmask = crypto_ablkcipher_alignmask(cc->tfm);
+	if (cc->offload_tfm) {
+		reqsize = max(reqsize,
+			      crypto_ablkcipher_reqsize(cc->offload_tfm));
+		alignmask = max(alignmask,
+				crypto_ablkcipher_alignmask(cc->offload_tfm));
+	}
+
 	cc->dmreq_start = sizeof(struct ablkcipher_request);
-	cc->dmreq_start += crypto_ablkcipher_reqsize(cc->tfm);
+	cc->dmreq_start += reqsize;
 	cc->dmreq_start = ALIGN(cc->dmreq_start, crypto_tfm_ctx_alignment());
-	cc->dmreq_start += crypto_ablkcipher_alignmask(cc->tfm) &
-			   ~(crypto_tfm_ctx_alignment() - 1);
+	cc->dmreq_start += alignmask & ~(crypto_tfm_ctx_alignment() - 1);
 
 	cc->req_pool = mempool_create_kmalloc_pool(MIN_IOS, cc->dmreq_start +
 			sizeof(struct dm_crypt_request) + cc->iv_size);
@@ -1224,7 +1327,6 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		ti->error = "Cannot allocate crypt request mempool";
 		goto bad;
 	}
-	cc->req = NULL;
 
 	cc->page_pool = mempool_create_page_pool(MIN_POOL_PAGES, 0);
 	if (!cc->page_pool) {
@@ -1287,7 +1389,16 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad;
 	}
 
-	cc->crypt_queue = create_singlethread_workqueue("kcryptd");
+	/*
+	 * Bios are converted in parallel on all cpus.  Each encrypted clone
+	 * is submitted as soon as it is ready: the block layer does not
+	 * promise any order between writes in flight, and holding finished
+	 * clones back would pin page_pool pages that earlier writes may be
+	 * waiting for.
+	 */
+	cc->crypt_queue = alloc_workqueue("kcryptd",
+					  WQ_UNBOUND | WQ_MEM_RECLAIM,
+					  crypt_workers ? : num_online_cpus());
 	if (!cc->crypt_queue) {
 		ti->error = "Couldn't create kcryptd queue";
 		goto bad;
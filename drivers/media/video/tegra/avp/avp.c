@@ -27,7 +27,9 @@
 #include <linux/ioctl.h>
 #include <linux/irq.h>
 #include <linux/kref.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
+#include <linux/math64.h>
 #include <linux/miscdevice.h>
 #include <linux/mutex.h>
 #include <linux/platform_device.h>
@@ -106,6 +108,10 @@ module_param_named(debug_mask, avp_debug_mask, uint, S_IWUSR | S_IRUGO);
 #define AVP_MSG_MAX_CMD_LEN	16
 #define AVP_MSG_AREA_SIZE	(AVP_MSG_MAX_CMD_LEN + TEGRA_RPC_MAX_MSG_LEN)
 
+/* the AVP usually takes a message within a few us, poll that long first */
+#define AVP_MSG_SPIN_US		20
+#define AVP_MSG_MAX_SLEEP_US	1000
+
 struct tegra_avp_info {
 	struct clk		*cop_clk;
 
@@ -161,6 +167,17 @@ struct remote_info {
 
 	struct trpc_endpoint	*trpc_ep;
 	struct rb_node		rb_node;
+
+	/* under state_lock, see avp_trpc_show */
+	u32			sent;
+	u32			recv;
+	u64			send_ns;	/* waiting for the mailbox */
+	u64			max_send_ns;
+	u32			replies;
+	u64			rtt_ns;		/* send to next message back */
+	u64			max_rtt_ns;
+	ktime_t			sent_at;
+	bool			awaiting;
 };
 
 struct lib_item {
@@ -292,6 +309,16 @@ static void avp_trpc_show(struct seq_file *s, struct trpc_endpoint *ep)
 	}
 	seq_printf(s, "    loc_id:0x%x\n	rem_id:0x%x\n",
 		   rinfo->loc_id, rinfo->rem_id);
+	seq_printf(s, "	sent:%u send_us avg:%llu max:%llu\n",
+		   rinfo->sent,
+		   rinfo->sent ? div_u64(rinfo->send_ns, rinfo->sent)
+				/ NSEC_PER_USEC : 0,
+		   div_u64(rinfo->max_send_ns, NSEC_PER_USEC));
+	seq_printf(s, "	recv:%u rtt_us avg:%llu max:%llu\n",
+		   rinfo->recv,
+		   rinfo->replies ? div_u64(rinfo->rtt_ns, rinfo->replies)
+				/ NSEC_PER_USEC : 0,
+		   div_u64(rinfo->max_rtt_ns, NSEC_PER_USEC));
 out:
 	spin_unlock_irqrestore(&avp->state_lock, flags);
 }
@@ -334,21 +361,40 @@ static inline int __msg_write(struct tegra_avp_info *avp, void *hdr,
 	return 0;
 }
 
-static inline int msg_write(struct tegra_avp_info *avp, void *hdr,
-			    size_t hdr_len, void *buf, size_t len)
+/*
+ * Wait up to @timeout jiffies for the first word of the message area to
+ * become @want (or anything else, if @equal is false).  Spins briefly,
+ * then sleeps for doubling intervals up to AVP_MSG_MAX_SLEEP_US.
+ */
+static bool msg_poll(struct tegra_avp_info *avp, u32 want, bool equal,
+		     unsigned long timeout)
 {
-	/* rem_ack is a pointer into shared memory that the AVP modifies */
-	volatile u32 *rem_ack = avp->msg_to_avp;
-	unsigned long endtime = jiffies + HZ;
+	/* word is a pointer into shared memory that the AVP modifies */
+	volatile u32 *word = avp->msg_to_avp;
+	unsigned long endtime = jiffies + timeout;
+	ktime_t start = ktime_get();
+	unsigned int us = 50;
 
-	/* the other side ack's the message by clearing the first word,
-	 * wait for it to do so */
 	rmb();
-	while (*rem_ack != 0 && time_before(jiffies, endtime)) {
-		usleep_range(100, 2000);
+	while ((*word == want) != equal &&
+	       ktime_us_delta(ktime_get(), start) < AVP_MSG_SPIN_US) {
+		cpu_relax();
 		rmb();
 	}
-	if (*rem_ack != 0)
+	while ((*word == want) != equal && time_before(jiffies, endtime)) {
+		usleep_range(us, us * 2);
+		us = min(us * 2, (unsigned int)AVP_MSG_MAX_SLEEP_US);
+		rmb();
+	}
+	return (*word == want) == equal;
+}
+
+static inline int msg_write(struct tegra_avp_info *avp, void *hdr,
+			    size_t hdr_len, void *buf, size_t len)
+{
+	/* the other side ack's the message by clearing the first word,
+	 * wait for it to do so */
+	if (!msg_poll(avp, 0, true, HZ))
 		return -ETIMEDOUT;
 	__msg_write(avp, hdr, hdr_len, buf, len);
 	return 0;
@@ -372,17 +418,10 @@ static int msg_wait_ack_locked(struct tegra_avp_info *avp, u32 cmd, u32 *arg)
 {
 	/* rem_ack is a pointer into shared memory that the AVP modifies */
 	volatile u32 *rem_ack = avp->msg_to_avp;
-	unsigned long endtime = jiffies + msecs_to_jiffies(400);
 	int ret;
 
-	do {
-		ret = msg_check_ack(avp, cmd, arg);
-		usleep_range(1000, 5000);
-	} while (ret && time_before(jiffies, endtime));
-
-	/* if we timed out, try one more time */
-	if (ret)
-		ret = msg_check_ack(avp, cmd, arg);
+	msg_poll(avp, cmd, true, msecs_to_jiffies(400));
+	ret = msg_check_ack(avp, cmd, arg);
 
 	/* clear out the ack */
 	*rem_ack = 0;
@@ -397,6 +436,8 @@ static int avp_trpc_send(struct trpc_endpoint *ep, void *buf, size_t len)
 	struct msg_port_data msg;
 	int ret;
 	unsigned long flags;
+	ktime_t start, now;
+	u64 ns;
 
 	DBG(AVP_DBG_TRACE_TRPC_MSG, "%s: ep=%p priv=%p buf=%p len=%d\n",
 		__func__, ep, trpc_priv(ep), buf, len);
@@ -422,9 +463,24 @@ static int avp_trpc_send(struct trpc_endpoint *ep, void *buf, size_t len)
 	msg.msg_len = len;
 
 	mutex_lock(&avp->to_avp_lock);
+	start = ktime_get();
 	ret = msg_write(avp, &msg, sizeof(msg), buf, len);
+	now = ktime_get();
 	mutex_unlock(&avp->to_avp_lock);
 
+	if (!ret) {
+		ns = ktime_to_ns(ktime_sub(now, start));
+		spin_lock_irqsave(&avp->state_lock, flags);
+		rinfo->sent++;
+		rinfo->send_ns += ns;
+		rinfo->max_send_ns = max(rinfo->max_send_ns, ns);
+		if (!rinfo->awaiting) {
+			rinfo->sent_at = now;
+			rinfo->awaiting = true;
+		}
+		spin_unlock_irqrestore(&avp->state_lock, flags);
+	}
+
 	DBG(AVP_DBG_TRACE_TRPC_MSG, "%s: msg sent for %s (%x->%x) (%d)\n",
 		__func__, trpc_name(ep), rinfo->loc_id, rinfo->rem_id, ret);
 	rinfo_put(rinfo);
@@ -788,6 +844,16 @@ static int process_message(struct tegra_avp_info *avp, struct msg_data *raw_msg,
 	if (rinfo) {
 		rinfo_get(rinfo);
 		trpc_get(rinfo->trpc_ep);
+		rinfo->recv++;
+		if (rinfo->awaiting) {
+			u64 ns = ktime_to_ns(ktime_sub(ktime_get(),
+						       rinfo->sent_at));
+
+			rinfo->replies++;
+			rinfo->rtt_ns += ns;
+			rinfo->max_rtt_ns = max(rinfo->max_rtt_ns, ns);
+			rinfo->awaiting = false;
+		}
 	} else {
 		pr_err("%s: port %x not found\n", __func__, port_msg->port_id);
 		spin_unlock_irqrestore(&avp->state_lock, flags);
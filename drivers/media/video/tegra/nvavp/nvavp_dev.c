@@ -11,6 +11,7 @@
 #include <linux/uaccess.h>
 #include <linux/clk.h>
 #include <linux/completion.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
@@ -21,12 +22,15 @@
 #include <linux/ioctl.h>
 #include <linux/irq.h>
 #include <linux/kref.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
+#include <linux/math64.h>
 #include <linux/miscdevice.h>
 #include <linux/mutex.h>
 #include <linux/nvhost.h>
 #include <linux/platform_device.h>
 #include <linux/rbtree.h>
+#include <linux/sched.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/string.h>
@@ -46,6 +50,7 @@
 #include "../../../../video/tegra/host/host1x/host1x_syncpt.h"
 #include "../../../../video/tegra/host/dev.h"
 #include "../../../../video/tegra/host/nvhost_acm.h"
+#include "../../../../video/tegra/host/nvhost_syncpt.h"
 
 #if defined(CONFIG_TEGRA_AVP_KERNEL_ON_MMU)
 #include "../avp/headavp.h"
@@ -73,6 +78,21 @@
 /* AVP behavior params */
 #define NVAVP_OS_IDLE_TIMEOUT		100 /* milli-seconds */
 
+/* scheduling, see nvavp_sched_admit() */
+#define NVAVP_SCHED_DEADLINE_US		20000	/* default deadline */
+#define NVAVP_SCHED_ACTIVE_US		100000	/* priority level in use */
+#define NVAVP_INFLIGHT			64	/* tracked to completion */
+#define NVAVP_COMPLETE_TIMEOUT_MS	1000
+#define NVAVP_SCHED_LEVELS		(NVAVP_SCHED_PRIORITY_MAX + 1)
+
+struct nvavp_clientctx;
+
+struct nvavp_inflight {
+	struct nvavp_clientctx	*client;
+	u32			fence;
+	ktime_t			submitted;
+};
+
 struct nvavp_info {
 	u32				clk_enabled;
 	struct clk			*bsev_clk;
@@ -118,6 +138,17 @@ struct nvavp_info {
 
 	struct nvhost_device		*nvhost_dev;
 	struct miscdevice		misc_dev;
+
+	/* clients, fences and in-flight submits, see nvavp_sched_admit() */
+	spinlock_t			sched_lock;
+	struct list_head		clients;
+	u32				prio_fence[NVAVP_SCHED_LEVELS];
+	ktime_t				prio_submit[NVAVP_SCHED_LEVELS];
+	struct nvavp_inflight		inflight[NVAVP_INFLIGHT];
+	unsigned int			inflight_head;
+	unsigned int			inflight_tail;
+	struct work_struct		complete_work;
+	struct dentry			*debugfs;
 };
 
 struct nvavp_clientctx {
@@ -128,6 +159,22 @@ struct nvavp_clientctx {
 	int num_relocs;
 	struct nvavp_info *nvavp;
 	u32 clk_reqs;
+
+	/* under nvavp->sched_lock */
+	struct list_head list;
+	pid_t pid;
+	u32 priority;
+	u32 deadline_us;
+	u32 fence;
+	bool has_fence;
+	u32 submits;
+	u32 yields;		/* submits held back for higher priority */
+	u64 yield_ns;
+	u64 max_yield_ns;
+	u32 done;		/* submits seen complete */
+	u32 missed;		/* of them, completed after the deadline */
+	u64 latency_ns;		/* submit to completion */
+	u64 max_latency_ns;
 };
 
 static struct clk *nvavp_clk_get(struct nvavp_info *nvavp, int id)
@@ -437,9 +484,167 @@ static void nvavp_pushbuffer_deinit(struct nvavp_info *nvavp)
 	nvavp_pushbuffer_free(nvavp);
 }
 
+static u32 nvavp_deadline_us(struct nvavp_clientctx *clientctx)
+{
+	return clientctx->deadline_us ?: NVAVP_SCHED_DEADLINE_US;
+}
+
+/*
+ * Returns true and the fence to wait for if @clientctx has to hold back
+ * its next submit.  That is the case while a higher priority level in
+ * use has work queued, so it never waits behind ours.  While such a
+ * level is in use but idle, we still keep at most one submit of ours
+ * queued, so that its next one waits for at most that.
+ */
+static bool nvavp_sched_blocked(struct nvavp_clientctx *clientctx,
+				u32 *fence)
+{
+	struct nvavp_info *nvavp = clientctx->nvavp;
+	struct nvhost_syncpt *sp = nvavp->nvhost_syncpt;
+	ktime_t now = ktime_get();
+	bool active = false;
+	u32 prio;
+
+	for (prio = clientctx->priority + 1;
+	     prio <= NVAVP_SCHED_PRIORITY_MAX; prio++) {
+		if (!nvavp->prio_submit[prio].tv64 ||
+		    ktime_us_delta(now, nvavp->prio_submit[prio]) >
+		    NVAVP_SCHED_ACTIVE_US)
+			continue;
+		if (!nvhost_syncpt_is_expired(sp, nvavp->syncpt_id,
+					      nvavp->prio_fence[prio])) {
+			*fence = nvavp->prio_fence[prio];
+			return true;
+		}
+		active = true;
+	}
+
+	if (active && clientctx->has_fence &&
+	    !nvhost_syncpt_is_expired(sp, nvavp->syncpt_id,
+				      clientctx->fence)) {
+		*fence = clientctx->fence;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * The AVP runs its pushbuffer in order, so priority can only act on
+ * what is let into it: a submit waits here at a pushbuffer boundary
+ * for at most the client's deadline while nvavp_sched_blocked().
+ */
+static void nvavp_sched_admit(struct nvavp_clientctx *clientctx)
+{
+	struct nvavp_info *nvavp = clientctx->nvavp;
+	unsigned long end;
+	ktime_t start;
+	bool blocked;
+	u32 fence;
+	u64 ns;
+
+	spin_lock(&nvavp->sched_lock);
+	blocked = nvavp_sched_blocked(clientctx, &fence);
+	spin_unlock(&nvavp->sched_lock);
+	if (!blocked)
+		return;
+
+	start = ktime_get();
+	end = jiffies + usecs_to_jiffies(nvavp_deadline_us(clientctx));
+	do {
+		if (!time_before(jiffies, end))
+			break;
+		nvhost_syncpt_wait_timeout(nvavp->nvhost_syncpt,
+					   nvavp->syncpt_id, fence,
+					   end - jiffies, NULL);
+		spin_lock(&nvavp->sched_lock);
+		blocked = nvavp_sched_blocked(clientctx, &fence);
+		spin_unlock(&nvavp->sched_lock);
+	} while (blocked);
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	spin_lock(&nvavp->sched_lock);
+	clientctx->yields++;
+	clientctx->yield_ns += ns;
+	clientctx->max_yield_ns = max(clientctx->max_yield_ns, ns);
+	spin_unlock(&nvavp->sched_lock);
+}
+
+/* called with pushbuffer_lock held, so fences are recorded in order */
+static void nvavp_sched_submitted(struct nvavp_clientctx *clientctx,
+				  u32 fence)
+{
+	struct nvavp_info *nvavp = clientctx->nvavp;
+	struct nvavp_inflight *f;
+	ktime_t now = ktime_get();
+
+	spin_lock(&nvavp->sched_lock);
+	clientctx->submits++;
+	clientctx->fence = fence;
+	clientctx->has_fence = true;
+	nvavp->prio_fence[clientctx->priority] = fence;
+	nvavp->prio_submit[clientctx->priority] = now;
+	if (nvavp->inflight_head - nvavp->inflight_tail < NVAVP_INFLIGHT) {
+		f = &nvavp->inflight[nvavp->inflight_head++ % NVAVP_INFLIGHT];
+		f->client = clientctx;
+		f->fence = fence;
+		f->submitted = now;
+	}
+	spin_unlock(&nvavp->sched_lock);
+
+	schedule_work(&nvavp->complete_work);
+}
+
+/* waits for in-flight submits in order and accounts their latency */
+static void nvavp_complete_handler(struct work_struct *work)
+{
+	struct nvavp_info *nvavp = container_of(work, struct nvavp_info,
+						complete_work);
+	struct nvavp_clientctx *client;
+	struct nvavp_inflight *f;
+	u32 fence;
+	u64 ns;
+	int err;
+
+	for (;;) {
+		spin_lock(&nvavp->sched_lock);
+		if (nvavp->inflight_head == nvavp->inflight_tail) {
+			spin_unlock(&nvavp->sched_lock);
+			return;
+		}
+		fence = nvavp->inflight[nvavp->inflight_tail %
+					NVAVP_INFLIGHT].fence;
+		spin_unlock(&nvavp->sched_lock);
+
+		err = nvhost_syncpt_wait_timeout(nvavp->nvhost_syncpt,
+				nvavp->syncpt_id, fence,
+				msecs_to_jiffies(NVAVP_COMPLETE_TIMEOUT_MS),
+				NULL);
+
+		spin_lock(&nvavp->sched_lock);
+		/* the ring may have been reset while we waited */
+		if (nvavp->inflight_head != nvavp->inflight_tail) {
+			f = &nvavp->inflight[nvavp->inflight_tail++ %
+					     NVAVP_INFLIGHT];
+			client = f->client;
+			if (!err && client) {
+				ns = ktime_to_ns(ktime_sub(ktime_get(),
+							   f->submitted));
+				client->done++;
+				client->latency_ns += ns;
+				client->max_latency_ns =
+					max(client->max_latency_ns, ns);
+				if (ns > (u64)nvavp_deadline_us(client) *
+					 NSEC_PER_USEC)
+					client->missed++;
+			}
+		}
+		spin_unlock(&nvavp->sched_lock);
+	}
+}
+
 static int nvavp_pushbuffer_update(struct nvavp_info *nvavp, u32 phys_addr,
 			u32 gather_count, struct nvavp_syncpt *syncpt,
-			u32 ext_ucode_flag)
+			u32 ext_ucode_flag, struct nvavp_clientctx *clientctx)
 {
 	struct nv_e276_control *control = nvavp->os_control;
 	u32 gather_cmd, setucode_cmd, sync = 0;
@@ -519,6 +724,8 @@ static int nvavp_pushbuffer_update(struct nvavp_info *nvavp, u32 phys_addr,
 	if (syncpt) {
 		syncpt->id = nvavp->syncpt_id;
 		syncpt->value = value;
+		if (clientctx)
+			nvavp_sched_submitted(clientctx, value);
 	}
 
 	mutex_unlock(&nvavp->pushbuffer_lock);
@@ -1006,22 +1213,20 @@ static int nvavp_pushbuffer_submit_ioctl(struct file *filp, unsigned int cmd,
 		writel(target_phys_addr, reloc_addr);
 	}
 
-	if (hdr.syncpt) {
-		ret = nvavp_pushbuffer_update(nvavp,
-					     (phys_addr + hdr.cmdbuf.offset),
-					      hdr.cmdbuf.words, &syncpt,
-					      (hdr.flags & NVAVP_UCODE_EXT));
+	nvavp_sched_admit(clientctx);
+
+	/* every submit gets a fence, the scheduler tracks it */
+	ret = nvavp_pushbuffer_update(nvavp,
+				     (phys_addr + hdr.cmdbuf.offset),
+				      hdr.cmdbuf.words, &syncpt,
+				      (hdr.flags & NVAVP_UCODE_EXT), clientctx);
 
+	if (hdr.syncpt) {
 		if (copy_to_user((void __user *)user_hdr->syncpt, &syncpt,
 				sizeof(struct nvavp_syncpt))) {
 			ret = -EFAULT;
 			goto err_reloc_info;
 		}
-	} else {
-		ret = nvavp_pushbuffer_update(nvavp,
-					     (phys_addr + hdr.cmdbuf.offset),
-					      hdr.cmdbuf.words, NULL,
-					      (hdr.flags & NVAVP_UCODE_EXT));
 	}
 
 err_reloc_info:
@@ -1041,6 +1246,30 @@ static int nvavp_wake_avp_ioctl(struct file *filp, unsigned int cmd,
 	return 0;
 }
 
+static int nvavp_set_sched_ioctl(struct file *filp, unsigned int cmd,
+							unsigned long arg)
+{
+	struct nvavp_clientctx *clientctx = filp->private_data;
+	struct nvavp_info *nvavp = clientctx->nvavp;
+	struct nvavp_sched_args sched;
+
+	if (copy_from_user(&sched, (void __user *)arg,
+			   sizeof(struct nvavp_sched_args)))
+		return -EFAULT;
+
+	if (sched.priority > NVAVP_SCHED_PRIORITY_MAX)
+		return -EINVAL;
+
+	dev_dbg(&nvavp->nvhost_dev->dev, "%s: priority=%u deadline=%uus\n",
+		__func__, sched.priority, sched.deadline_us);
+
+	spin_lock(&nvavp->sched_lock);
+	clientctx->priority = sched.priority;
+	clientctx->deadline_us = sched.deadline_us;
+	spin_unlock(&nvavp->sched_lock);
+	return 0;
+}
+
 static int nvavp_force_clock_stay_on_ioctl(struct file *filp, unsigned int cmd,
 							unsigned long arg)
 {
@@ -1099,6 +1328,13 @@ static int tegra_nvavp_open(struct inode *inode, struct file *filp)
 
 	clientctx->nvmap = nvavp->nvmap;
 	clientctx->nvavp = nvavp;
+	clientctx->pid = current->tgid;
+
+	if (!ret) {
+		spin_lock(&nvavp->sched_lock);
+		list_add_tail(&clientctx->list, &nvavp->clients);
+		spin_unlock(&nvavp->sched_lock);
+	}
 
 	filp->private_data = clientctx;
 
@@ -1111,12 +1347,20 @@ static int tegra_nvavp_release(struct inode *inode, struct file *filp)
 {
 	struct nvavp_clientctx *clientctx = filp->private_data;
 	struct nvavp_info *nvavp = clientctx->nvavp;
+	unsigned int i;
 	int ret = 0;
 
 	dev_dbg(&nvavp->nvhost_dev->dev, "%s: ++\n", __func__);
 
 	filp->private_data = NULL;
 
+	spin_lock(&nvavp->sched_lock);
+	list_del(&clientctx->list);
+	for (i = nvavp->inflight_tail; i != nvavp->inflight_head; i++)
+		if (nvavp->inflight[i % NVAVP_INFLIGHT].client == clientctx)
+			nvavp->inflight[i % NVAVP_INFLIGHT].client = NULL;
+	spin_unlock(&nvavp->sched_lock);
+
 	mutex_lock(&nvavp->open_lock);
 
 	if (!nvavp->refcount) {
@@ -1132,8 +1376,14 @@ static int tegra_nvavp_release(struct inode *inode, struct file *filp)
 
 	if (nvavp->refcount > 0)
 		nvavp->refcount--;
-	if (!nvavp->refcount)
+	if (!nvavp->refcount) {
+		/* nothing queued will complete once the AVP is halted */
+		spin_lock(&nvavp->sched_lock);
+		nvavp->inflight_tail = nvavp->inflight_head;
+		spin_unlock(&nvavp->sched_lock);
+		cancel_work_sync(&nvavp->complete_work);
 		nvavp_uninit(nvavp);
+	}
 
 out:
 	nvmap_client_put(clientctx->nvmap);
@@ -1176,6 +1426,9 @@ static long tegra_nvavp_ioctl(struct file *filp, unsigned int cmd,
 	case NVAVP_IOCTL_FORCE_CLOCK_STAY_ON:
 		ret = nvavp_force_clock_stay_on_ioctl(filp, cmd, arg);
 		break;
+	case NVAVP_IOCTL_SET_SCHED:
+		ret = nvavp_set_sched_ioctl(filp, cmd, arg);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -1190,6 +1443,42 @@ static const struct file_operations tegra_nvavp_fops = {
 	.unlocked_ioctl	= tegra_nvavp_ioctl,
 };
 
+static int nvavp_sched_show(struct seq_file *s, void *unused)
+{
+	struct nvavp_info *nvavp = s->private;
+	struct nvavp_clientctx *c;
+
+	seq_printf(s, "%-6s %4s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n",
+		   "pid", "prio", "deadline", "submits", "yields", "yield_av",
+		   "yield_mx", "done", "lat_avg", "lat_max", "missed");
+	spin_lock(&nvavp->sched_lock);
+	list_for_each_entry(c, &nvavp->clients, list)
+		seq_printf(s, "%-6d %4u %8u %8u %8u %8llu %8llu %8u %8llu "
+			   "%8llu %8u\n", c->pid, c->priority,
+			   nvavp_deadline_us(c), c->submits, c->yields,
+			   c->yields ? div_u64(c->yield_ns, c->yields)
+					/ NSEC_PER_USEC : 0,
+			   div_u64(c->max_yield_ns, NSEC_PER_USEC), c->done,
+			   c->done ? div_u64(c->latency_ns, c->done)
+					/ NSEC_PER_USEC : 0,
+			   div_u64(c->max_latency_ns, NSEC_PER_USEC),
+			   c->missed);
+	spin_unlock(&nvavp->sched_lock);
+	return 0;
+}
+
+static int nvavp_sched_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nvavp_sched_show, inode->i_private);
+}
+
+static const struct file_operations nvavp_sched_fops = {
+	.open		= nvavp_sched_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int tegra_nvavp_probe(struct nvhost_device *ndev)
 {
 	struct nvavp_info *nvavp;
@@ -1359,6 +1648,9 @@ static int tegra_nvavp_probe(struct nvhost_device *ndev)
 	nvavp_halt_avp(nvavp);
 
 	INIT_WORK(&nvavp->clock_disable_work, clock_disable_handler);
+	INIT_WORK(&nvavp->complete_work, nvavp_complete_handler);
+	spin_lock_init(&nvavp->sched_lock);
+	INIT_LIST_HEAD(&nvavp->clients);
 
 	nvavp->misc_dev.minor = MISC_DYNAMIC_MINOR;
 	nvavp->misc_dev.name = "tegra_avpchannel";
@@ -1383,6 +1675,9 @@ static int tegra_nvavp_probe(struct nvhost_device *ndev)
 	nvhost_set_drvdata(ndev, nvavp);
 	nvavp->nvhost_dev = ndev;
 
+	nvavp->debugfs = debugfs_create_file("nvavp_sched", S_IRUGO, NULL,
+					     nvavp, &nvavp_sched_fops);
+
 	return 0;
 
 err_req_irq_pend:
@@ -1429,6 +1724,7 @@ static int tegra_nvavp_remove(struct nvhost_device *ndev)
 	}
 	mutex_unlock(&nvavp->open_lock);
 
+	debugfs_remove(nvavp->debugfs);
 	nvavp_unload_ucode(nvavp);
 	nvavp_unload_os(nvavp);
 
@@ -28,6 +28,7 @@
 #include <mach/iomap.h>
 #include <mach/clk.h>
 #include <mach/powergate.h>
+#include <mach/nvmap.h>
 
 #include <media/tegra_camera.h>
 #include <mach/pinmux.h>
@@ -307,6 +308,33 @@ static int tegra_camera_power_off(struct tegra_camera_dev *dev)
 	return ret;
 }
 
+static int tegra_camera_buffer_alloc(struct tegra_camera_dev *dev,
+				     struct tegra_camera_buffer *buf)
+{
+	struct nvmap_client *client;
+	struct nvmap_handle_ref *ref;
+
+	if (buf->id != TEGRA_CAMERA_MODULE_VI || !buf->size)
+		return -EINVAL;
+
+	client = nvmap_client_get_file(buf->nvmap_fd);
+	if (IS_ERR(client))
+		return PTR_ERR(client);
+
+	ref = nvmap_alloc(client, PAGE_ALIGN(buf->size), PAGE_SIZE,
+			  NVMAP_HANDLE_WRITE_COMBINE,
+			  NVMAP_HEAP_IOVMM | NVMAP_HEAP_CARVEOUT_GENERIC);
+	nvmap_client_put(client);
+	if (IS_ERR(ref)) {
+		dev_err(dev->dev, "%s: failed to allocate %u bytes\n",
+				__func__, buf->size);
+		return PTR_ERR(ref);
+	}
+
+	buf->handle = (unsigned long)ref->handle;
+	return 0;
+}
+
 static long tegra_camera_ioctl(struct file *file,
 			       unsigned int cmd, unsigned long arg)
 {
@@ -389,6 +417,27 @@ static long tegra_camera_ioctl(struct file *file,
 	}
 	case TEGRA_CAMERA_IOCTL_RESET:
 		return tegra_camera_reset(dev, id);
+	case TEGRA_CAMERA_IOCTL_BUFFER_ALLOC:
+	{
+		struct tegra_camera_buffer buf;
+		int ret;
+
+		if (copy_from_user(&buf, (const void __user *)arg,
+				   sizeof(buf))) {
+			dev_err(dev->dev,
+				"%s: Failed to copy arg from user\n", __func__);
+			return -EFAULT;
+		}
+		ret = tegra_camera_buffer_alloc(dev, &buf);
+		if (ret)
+			return ret;
+		if (copy_to_user((void __user *)arg, &buf, sizeof(buf))) {
+			dev_err(dev->dev,
+				"%s: Failed to copy arg to user\n", __func__);
+			return -EFAULT;
+		}
+		return 0;
+	}
 	default:
 		dev_err(dev->dev,
 				"%s: Unknown tegra_camera ioctl.\n", __func__);
@@ -29,6 +29,10 @@
 #include <linux/i2c-dev.h>
 #include <linux/workqueue.h>
 #include <linux/poll.h>
+#include <linux/kfifo.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
 
 #include <linux/errno.h>
 #include <linux/fs.h>
@@ -42,8 +46,10 @@
 #include "mpuirq.h"
 #include "mldl_cfg.h"
 #include "mpu-i2c.h"
+#include "mlsl.h"
 
 #define MPUIRQ_NAME "mpuirq"
+#define MPUIRQ_BATCH_SAMPLES 256
 
 /* function which gets accel data and sends it to MPU */
 
@@ -58,12 +64,33 @@ struct mpuirq_dev_data {
 	int accel_divider;
 	int data_ready;
 	int timeout;
+
+	/* batch mode, see MPUIRQ_SET_BATCH */
+	struct delayed_work batch_work;
+	struct mutex batch_lock;
+	unsigned int batch_ms;
+	unsigned int record_size;
+	unsigned long drain_jiffies;
+	ktime_t last_drain;
+
+	/* wakeup accounting, see the stats attribute */
+	unsigned long irqs;
+	unsigned long drains;
+	unsigned long user_wakeups;
+	unsigned long samples;
+	unsigned long dropped;
+	unsigned long overflows;
+	ktime_t stats_start;
 };
 
 static struct mpuirq_dev_data mpuirq_dev_data;
 static struct mpuirq_data mpuirq_data;
 static char *interface = MPUIRQ_NAME;
 
+static DEFINE_KFIFO(mpuirq_samples, struct mpuirq_sample,
+		    MPUIRQ_BATCH_SAMPLES);
+static unsigned char mpuirq_fifo_buf[FIFO_HW_SIZE];
+
 static void mpu_accel_data_work_fcn(struct work_struct *work);
 
 static int mpuirq_open(struct inode *inode, struct file *file)
@@ -87,8 +114,23 @@ static ssize_t mpuirq_read(struct file *file,
 			   char *buf, size_t count, loff_t *ppos)
 {
 	int len, err;
+	unsigned int copied;
 	struct mpuirq_dev_data *p_mpuirq_dev_data = file->private_data;
 
+	if (mpuirq_dev_data.batch_ms) {
+		if (kfifo_is_empty(&mpuirq_samples)) {
+			if (file->f_flags & O_NONBLOCK)
+				return -EAGAIN;
+			err = wait_event_interruptible(mpuirq_wait,
+				!kfifo_is_empty(&mpuirq_samples) ||
+				!mpuirq_dev_data.batch_ms);
+			if (err)
+				return err;
+		}
+		err = kfifo_to_user(&mpuirq_samples, buf, count, &copied);
+		return err ? err : copied;
+	}
+
 	if (!mpuirq_dev_data.data_ready &&
 		mpuirq_dev_data.timeout &&
 		(!(file->f_flags & O_NONBLOCK))) {
@@ -120,17 +162,163 @@ unsigned int mpuirq_poll(struct file *file, struct poll_table_struct *poll)
 	int mask = 0;
 
 	poll_wait(file, &mpuirq_wait, poll);
-	if (mpuirq_dev_data.data_ready)
+	if (mpuirq_dev_data.batch_ms) {
+		if (!kfifo_is_empty(&mpuirq_samples))
+			mask |= POLLIN | POLLRDNORM;
+	} else if (mpuirq_dev_data.data_ready)
 		mask |= POLLIN | POLLRDNORM;
 	return mask;
 }
 
+static int mpuirq_fifo_reset(struct mldl_cfg *mldl_cfg,
+			     struct i2c_adapter *adapter)
+{
+	unsigned char reg;
+	int result;
+
+	result = MLSLSerialRead(adapter, mldl_cfg->addr,
+				MPUREG_USER_CTRL, 1, &reg);
+	if (result)
+		return result;
+	return MLSLSerialWriteSingle(adapter, mldl_cfg->addr,
+				     MPUREG_USER_CTRL, reg | BIT_FIFO_RST);
+}
+
+/* bytes per FIFO record when the FIFO is fed straight from the registers */
+static int mpuirq_raw_record_size(struct mldl_cfg *mldl_cfg,
+				  struct i2c_adapter *adapter)
+{
+	unsigned char reg[2];
+	int result;
+
+	result = MLSLSerialRead(adapter, mldl_cfg->addr,
+				MPUREG_FIFO_EN1, 2, reg);
+	if (result)
+		return 0;
+	return 2 * (hweight8(reg[0]) +
+		    hweight8(reg[1] & (BIT_AUX_2OUT | BIT_AUX_3OUT)));
+}
+
+static void mpu_batch_work_fcn(struct work_struct *work)
+{
+	struct mldl_cfg *mldl_cfg =
+	    (struct mldl_cfg *) i2c_get_clientdata(mpuirq_dev_data.mpu_client);
+	struct i2c_adapter *adapter = mpuirq_dev_data.mpu_client->adapter;
+	struct mpuirq_sample sample;
+	unsigned char cnt[2];
+	unsigned int count, n, ii;
+	s64 start, span;
+	ktime_t now;
+	int result;
+
+	mutex_lock(&mpuirq_dev_data.batch_lock);
+	if (!mpuirq_dev_data.batch_ms)
+		goto out;
+
+	mpuirq_dev_data.drains++;
+	result = MLSLSerialRead(adapter, mldl_cfg->addr,
+				MPUREG_FIFO_COUNTH, 2, cnt);
+	if (result)
+		goto resched;
+	now = ktime_get();
+	count = (cnt[0] << 8) | cnt[1];
+
+	/* records may have been cut short, start over */
+	if (count >= FIFO_HW_SIZE) {
+		mpuirq_dev_data.overflows++;
+		mpuirq_fifo_reset(mldl_cfg, adapter);
+		mpuirq_dev_data.last_drain = now;
+		goto resched;
+	}
+
+	n = count / mpuirq_dev_data.record_size;
+	if (!n)
+		goto resched;
+	result = MLSLSerialReadFifo(adapter, mldl_cfg->addr,
+				    n * mpuirq_dev_data.record_size,
+				    mpuirq_fifo_buf);
+	if (result)
+		goto resched;
+
+	start = ktime_to_ns(mpuirq_dev_data.last_drain);
+	span = ktime_to_ns(ktime_sub(now, mpuirq_dev_data.last_drain));
+	sample.len = mpuirq_dev_data.record_size;
+	for (ii = 0; ii < n; ii++) {
+		sample.timestamp = start + div_s64(span * (ii + 1), n);
+		memcpy(sample.data,
+		       mpuirq_fifo_buf + ii * mpuirq_dev_data.record_size,
+		       mpuirq_dev_data.record_size);
+		if (kfifo_put(&mpuirq_samples, &sample))
+			mpuirq_dev_data.samples++;
+		else
+			mpuirq_dev_data.dropped++;
+	}
+	mpuirq_dev_data.last_drain = now;
+	mpuirq_dev_data.user_wakeups++;
+	wake_up_interruptible(&mpuirq_wait);
+
+resched:
+	schedule_delayed_work(&mpuirq_dev_data.batch_work,
+			      mpuirq_dev_data.drain_jiffies);
+out:
+	mutex_unlock(&mpuirq_dev_data.batch_lock);
+}
+
+static int mpuirq_set_batch(struct mpuirq_batch *batch)
+{
+	struct mldl_cfg *mldl_cfg =
+	    (struct mldl_cfg *) i2c_get_clientdata(mpuirq_dev_data.mpu_client);
+	struct i2c_adapter *adapter = mpuirq_dev_data.mpu_client->adapter;
+	unsigned long fill_ms, ms;
+	unsigned int was;
+	int size;
+
+	mutex_lock(&mpuirq_dev_data.batch_lock);
+	was = mpuirq_dev_data.batch_ms;
+	mpuirq_dev_data.batch_ms = 0;
+	mutex_unlock(&mpuirq_dev_data.batch_lock);
+	if (was) {
+		cancel_delayed_work_sync(&mpuirq_dev_data.batch_work);
+		if (mpuirq_dev_data.irq)
+			enable_irq(mpuirq_dev_data.irq);
+	}
+	kfifo_reset(&mpuirq_samples);
+	wake_up_interruptible(&mpuirq_wait);
+
+	if (!batch->latency_ms)
+		return 0;
+
+	size = batch->record_size ? batch->record_size :
+		mpuirq_raw_record_size(mldl_cfg, adapter);
+	if (size <= 0 || size > MPUIRQ_SAMPLE_MAX)
+		return -EINVAL;
+
+	/* drain before the FIFO is three quarters full */
+	fill_ms = (FIFO_HW_SIZE / size) * SAMPLING_PERIOD_US(mldl_cfg) / 1000;
+	ms = clamp(min(batch->latency_ms, fill_ms * 3 / 4), 1UL, 10000UL);
+
+	if (mpuirq_dev_data.irq)
+		disable_irq(mpuirq_dev_data.irq);
+	mpuirq_fifo_reset(mldl_cfg, adapter);
+
+	mutex_lock(&mpuirq_dev_data.batch_lock);
+	mpuirq_dev_data.record_size = size;
+	mpuirq_dev_data.drain_jiffies = msecs_to_jiffies(ms);
+	mpuirq_dev_data.last_drain = ktime_get();
+	mpuirq_dev_data.batch_ms = ms;
+	schedule_delayed_work(&mpuirq_dev_data.batch_work,
+			      mpuirq_dev_data.drain_jiffies);
+	mutex_unlock(&mpuirq_dev_data.batch_lock);
+	return 0;
+}
+
 /* ioctl - I/O control */
 static long mpuirq_ioctl(struct file *file,
 			 unsigned int cmd, unsigned long arg)
 {
 	int retval = 0;
 	int data;
+	struct mpuirq_batch batch;
 
 	switch (cmd) {
 	case MPUIRQ_SET_TIMEOUT:
@@ -154,6 +342,11 @@ static long mpuirq_ioctl(struct file *file,
 	case MPUIRQ_SET_FREQUENCY_DIVIDER:
 		mpuirq_dev_data.accel_divider = arg;
 		break;
+	case MPUIRQ_SET_BATCH:
+		if (copy_from_user(&batch, (void __user *) arg, sizeof(batch)))
+			return -EFAULT;
+		retval = mpuirq_set_batch(&batch);
+		break;
 	default:
 		retval = -EINVAL;
 	}
@@ -202,6 +395,8 @@ static irqreturn_t mpuirq_handler(int irq, void *dev_id)
 	mycount++;
 
 	mpuirq_data.interruptcount++;
+	mpuirq_dev_data.irqs++;
+	mpuirq_dev_data.user_wakeups++;
 
 	/* wake up (unblock) for reading data from userspace */
 	/* and ignore first interrupt generated in module init */
@@ -245,6 +440,49 @@ static struct miscdevice mpuirq_device = {
 	.fops = &mpuirq_fops,
 };
 
+/* per second rate of @n since the counters were cleared, in tenths */
+static unsigned long mpuirq_rate(unsigned long n, s64 ms)
+{
+	return ms > 0 ? div64_s64((s64)n * 10000, ms) : 0;
+}
+
+static ssize_t mpuirq_stats_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct mpuirq_dev_data *d = &mpuirq_dev_data;
+	s64 ms = ktime_to_ms(ktime_sub(ktime_get(), d->stats_start));
+	unsigned long cpu = mpuirq_rate(d->irqs + d->drains, ms);
+	unsigned long user = mpuirq_rate(d->user_wakeups, ms);
+
+	return sprintf(buf, "batch %u ms\n"
+		       "interrupts %lu\ndrains %lu\n"
+		       "cpu wakeups/s %lu.%lu\nuser wakeups/s %lu.%lu\n"
+		       "samples %lu\ndropped %lu\noverflows %lu\n",
+		       d->batch_ms, d->irqs, d->drains,
+		       cpu / 10, cpu % 10, user / 10, user % 10,
+		       d->samples, d->dropped, d->overflows);
+}
+
+/* any write clears the counters */
+static ssize_t mpuirq_stats_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	struct mpuirq_dev_data *d = &mpuirq_dev_data;
+
+	d->irqs = 0;
+	d->drains = 0;
+	d->user_wakeups = 0;
+	d->samples = 0;
+	d->dropped = 0;
+	d->overflows = 0;
+	d->stats_start = ktime_get();
+	return count;
+}
+
+static DEVICE_ATTR(stats, S_IRUGO | S_IWUSR, mpuirq_stats_show,
+		   mpuirq_stats_store);
+
 int mpuirq_init(struct i2c_client *mpu_client)
 {
 
@@ -256,6 +494,9 @@ int mpuirq_init(struct i2c_client *mpu_client)
 	INIT_WORK((struct work_struct *) &mpuirq_dev_data,
 		  mpu_accel_data_work_fcn);
 	mpuirq_dev_data.mpu_client = mpu_client;
+	INIT_DELAYED_WORK(&mpuirq_dev_data.batch_work, mpu_batch_work_fcn);
+	mutex_init(&mpuirq_dev_data.batch_lock);
+	mpuirq_dev_data.stats_start = ktime_get();
 
 	dev_info(&mpu_client->adapter->dev,
 		 "Module Param interface = %s\n", interface);
@@ -290,7 +531,10 @@ int mpuirq_init(struct i2c_client *mpu_client)
 					res);
 				free_irq(mpuirq_dev_data.irq,
 					 &mpuirq_dev_data.irq);
-			}
+			} else if (device_create_file(mpuirq_device.this_device,
+						      &dev_attr_stats))
+				dev_warn(mpuirq_device.this_device,
+					 "cannot create stats\n");
 		}
 
 	} else {
@@ -303,6 +547,11 @@ int mpuirq_init(struct i2c_client *mpu_client)
 void mpuirq_exit(void)
 {
 	/* Free the IRQ first before flushing the work */
+	mutex_lock(&mpuirq_dev_data.batch_lock);
+	mpuirq_dev_data.batch_ms = 0;
+	mutex_unlock(&mpuirq_dev_data.batch_lock);
+	cancel_delayed_work_sync(&mpuirq_dev_data.batch_work);
+
 	if (mpuirq_dev_data.irq > 0)
 		free_irq(mpuirq_dev_data.irq, &mpuirq_dev_data.irq);
 
@@ -310,6 +559,7 @@ void mpuirq_exit(void)
 
 	dev_info(mpuirq_device.this_device, "Unregistering %s\n",
 		 MPUIRQ_NAME);
+	device_remove_file(mpuirq_device.this_device, &dev_attr_stats);
 	misc_deregister(&mpuirq_device);
 
 	return;
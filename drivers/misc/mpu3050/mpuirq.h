@@ -31,6 +31,31 @@
 #define MPUIRQ_GET_INTERRUPT_CNT     _IOR(MPU_IOCTL, 0x41, unsigned long)
 #define MPUIRQ_GET_IRQ_TIME          _IOR(MPU_IOCTL, 0x42, struct timeval)
 #define MPUIRQ_SET_FREQUENCY_DIVIDER _IOW(MPU_IOCTL, 0x43, unsigned long)
+#define MPUIRQ_SET_BATCH             _IOW(MPU_IOCTL, 0x44, struct mpuirq_batch)
+
+/*
+ * Batch mode.  The interrupt is masked and the kernel drains the MPU FIFO
+ * itself at least every latency_ms, so the cpu and the reader wake once
+ * per batch instead of once per sample.  Each FIFO record of record_size
+ * bytes (0: derived from FIFO_EN1/2, which only fits with the DMP off)
+ * comes back as one struct mpuirq_sample; a read returns as many whole
+ * samples as fit.  Timestamps are CLOCK_MONOTONIC in ns, spread evenly
+ * over the time since the previous drain.  latency_ms 0 goes back to one
+ * struct mpuirq_data per interrupt.  The reader owns the FIFO while this
+ * is on and must not read it through /dev/mpu as well.
+ */
+#define MPUIRQ_SAMPLE_MAX	32
+
+struct mpuirq_batch {
+	unsigned long latency_ms;
+	unsigned long record_size;
+};
+
+struct mpuirq_sample {
+	long long timestamp;
+	unsigned short len;
+	unsigned char data[MPUIRQ_SAMPLE_MAX];
+};
 
 #ifdef __KERNEL__
 
@@ -13,45 +13,71 @@
  *
  */
 
-#include <asm/atomic.h>
-
 #include <linux/err.h>
+#include <linux/hash.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
 #include <linux/proc_fs.h>
+#include <linux/rculist.h>
 #include <linux/slab.h>
-#include <linux/spinlock.h>
 #include <linux/stat.h>
 #include <linux/uid_stat.h>
 #include <net/activity_stats.h>
 
-static DEFINE_SPINLOCK(uid_lock);
-static LIST_HEAD(uid_list);
+/*
+ * Entries are never removed, so lookups walk the hash chains under RCU
+ * only and the counters are per cpu; nothing on the send or receive path
+ * takes a lock once a uid has been seen. The per cpu counters are summed
+ * when the proc files are read.
+ */
+#define UID_HASH_BITS	6
+
+static DEFINE_MUTEX(uid_lock);
+static struct hlist_head uid_hash[1 << UID_HASH_BITS];
 static struct proc_dir_entry *parent;
 
+static bool enable = true;
+module_param(enable, bool, 0644);
+
+struct uid_stat_cpu {
+	unsigned int tcp_rcv;
+	unsigned int tcp_snd;
+};
+
 struct uid_stat {
-	struct list_head link;
+	struct hlist_node link;
 	uid_t uid;
-	atomic_t tcp_rcv;
-	atomic_t tcp_snd;
+	struct uid_stat_cpu __percpu *cpu;
 };
 
 static struct uid_stat *find_uid_stat(uid_t uid) {
-	unsigned long flags;
 	struct uid_stat *entry;
+	struct hlist_node *pos;
 
-	spin_lock_irqsave(&uid_lock, flags);
-	list_for_each_entry(entry, &uid_list, link) {
-		if (entry->uid == uid) {
-			spin_unlock_irqrestore(&uid_lock, flags);
+	hlist_for_each_entry_rcu(entry, pos,
+				 &uid_hash[hash_32(uid, UID_HASH_BITS)], link) {
+		if (entry->uid == uid)
 			return entry;
-		}
 	}
-	spin_unlock_irqrestore(&uid_lock, flags);
 	return NULL;
 }
 
+/* Counters wrap at 4GB, as they always have. */
+static unsigned int uid_stat_sum(struct uid_stat *uid_entry, size_t offset)
+{
+	unsigned int bytes = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		bytes += *(unsigned int *)
+			((char *)per_cpu_ptr(uid_entry->cpu, cpu) + offset);
+	return bytes;
+}
+
 static int tcp_snd_read_proc(char *page, char **start, off_t off,
 				int count, int *eof, void *data)
 {
@@ -62,7 +88,7 @@ static int tcp_snd_read_proc(char *page, char **start, off_t off,
 	if (!data)
 		return 0;
 
-	bytes = (unsigned int) (atomic_read(&uid_entry->tcp_snd) + INT_MIN);
+	bytes = uid_stat_sum(uid_entry, offsetof(struct uid_stat_cpu, tcp_snd));
 	p += sprintf(p, "%u\n", bytes);
 	len = (p - page) - off;
 	*eof = (len <= count) ? 1 : 0;
@@ -80,7 +106,7 @@ static int tcp_rcv_read_proc(char *page, char **start, off_t off,
 	if (!data)
 		return 0;
 
-	bytes = (unsigned int) (atomic_read(&uid_entry->tcp_rcv) + INT_MIN);
+	bytes = uid_stat_sum(uid_entry, offsetof(struct uid_stat_cpu, tcp_rcv));
 	p += sprintf(p, "%u\n", bytes);
 	len = (p - page) - off;
 	*eof = (len <= count) ? 1 : 0;
@@ -90,23 +116,31 @@ static int tcp_rcv_read_proc(char *page, char **start, off_t off,
 
 /* Create a new entry for tracking the specified uid. */
 static struct uid_stat *create_stat(uid_t uid) {
-	unsigned long flags;
 	char uid_s[32];
 	struct uid_stat *new_uid;
 	struct proc_dir_entry *entry;
 
-	/* Create the uid stat struct and append it to the list. */
+	mutex_lock(&uid_lock);
+	/* Another task may have added it since our lookup. */
+	new_uid = find_uid_stat(uid);
+	if (new_uid) {
+		mutex_unlock(&uid_lock);
+		return new_uid;
+	}
+
+	/* Create the uid stat struct and add it to the hash. */
 	if ((new_uid = kmalloc(sizeof(struct uid_stat), GFP_KERNEL)) == NULL)
-		return NULL;
+		goto fail;
+	new_uid->cpu = alloc_percpu(struct uid_stat_cpu);
+	if (!new_uid->cpu) {
+		kfree(new_uid);
+		goto fail;
+	}
 
 	new_uid->uid = uid;
-	/* Counters start at INT_MIN, so we can track 4GB of network traffic. */
-	atomic_set(&new_uid->tcp_rcv, INT_MIN);
-	atomic_set(&new_uid->tcp_snd, INT_MIN);
-
-	spin_lock_irqsave(&uid_lock, flags);
-	list_add_tail(&new_uid->link, &uid_list);
-	spin_unlock_irqrestore(&uid_lock, flags);
+	hlist_add_head_rcu(&new_uid->link,
+			   &uid_hash[hash_32(uid, UID_HASH_BITS)]);
+	mutex_unlock(&uid_lock);
 
 	sprintf(uid_s, "%d", uid);
 	entry = proc_mkdir(uid_s, parent);
@@ -119,27 +153,43 @@ static struct uid_stat *create_stat(uid_t uid) {
 		(void *) new_uid);
 
 	return new_uid;
+
+fail:
+	mutex_unlock(&uid_lock);
+	return NULL;
+}
+
+static struct uid_stat *get_uid_stat(uid_t uid)
+{
+	struct uid_stat *entry;
+
+	rcu_read_lock();
+	entry = find_uid_stat(uid);
+	rcu_read_unlock();
+	if (!entry)
+		entry = create_stat(uid);
+	return entry;
 }
 
 int uid_stat_tcp_snd(uid_t uid, int size) {
 	struct uid_stat *entry;
+	if (!enable)
+		return 0;
 	activity_stats_update();
-	if ((entry = find_uid_stat(uid)) == NULL &&
-		((entry = create_stat(uid)) == NULL)) {
-			return -1;
-	}
-	atomic_add(size, &entry->tcp_snd);
+	if ((entry = get_uid_stat(uid)) == NULL)
+		return -1;
+	this_cpu_add(entry->cpu->tcp_snd, size);
 	return 0;
 }
 
 int uid_stat_tcp_rcv(uid_t uid, int size) {
 	struct uid_stat *entry;
+	if (!enable)
+		return 0;
 	activity_stats_update();
-	if ((entry = find_uid_stat(uid)) == NULL &&
-		((entry = create_stat(uid)) == NULL)) {
-			return -1;
-	}
-	atomic_add(size, &entry->tcp_rcv);
+	if ((entry = get_uid_stat(uid)) == NULL)
+		return -1;
+	this_cpu_add(entry->cpu->tcp_rcv, size);
 	return 0;
 }
 
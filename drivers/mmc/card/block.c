@@ -67,6 +67,12 @@ MODULE_ALIAS("mmc:block");
 
 #define MMC_CMD_RETRIES 	10
 
+#define mmc_req_rel_wr(req)	(((req->cmd_flags & REQ_FUA) || \
+				  (req->cmd_flags & REQ_META)) && \
+				 (rq_data_dir(req) == WRITE))
+#define PACKED_CMD_VER		0x01
+#define PACKED_CMD_WR		0x02
+
 static DEFINE_MUTEX(block_mutex);
 
 /*
@@ -85,6 +91,30 @@ static int max_devices;
 static DECLARE_BITMAP(dev_use, 256);
 static DECLARE_BITMAP(name_use, 256);
 
+/*
+ * Why collecting a packed group ended, as reported in packed_stats.
+ */
+enum mmc_blk_pack_stop {
+	MMC_BLK_PACK_STOP_EMPTY = 0,	/* no more requests queued */
+	MMC_BLK_PACK_STOP_MAX_REQS,	/* card limit on entries reached */
+	MMC_BLK_PACK_STOP_MAX_BLOCKS,	/* host transfer size reached */
+	MMC_BLK_PACK_STOP_MAX_SEGS,	/* host segment count reached */
+	MMC_BLK_PACK_STOP_DIR,		/* next request is a read */
+	MMC_BLK_PACK_STOP_SPECIAL,	/* next request is a discard/flush */
+	MMC_BLK_PACK_STOP_REL_WR,	/* legacy reliable write */
+	MMC_BLK_PACK_STOP_NR,
+};
+
+static const char *mmc_blk_pack_stop_names[MMC_BLK_PACK_STOP_NR] = {
+	[MMC_BLK_PACK_STOP_EMPTY]	= "empty",
+	[MMC_BLK_PACK_STOP_MAX_REQS]	= "max_reqs",
+	[MMC_BLK_PACK_STOP_MAX_BLOCKS]	= "max_blocks",
+	[MMC_BLK_PACK_STOP_MAX_SEGS]	= "max_segs",
+	[MMC_BLK_PACK_STOP_DIR]		= "read",
+	[MMC_BLK_PACK_STOP_SPECIAL]	= "discard_flush",
+	[MMC_BLK_PACK_STOP_REL_WR]	= "rel_wr",
+};
+
 /*
  * There is one mmc_blk_data per slot.
  */
@@ -97,6 +127,7 @@ struct mmc_blk_data {
 	unsigned int	flags;
 #define MMC_BLK_CMD23	(1 << 0)	/* Can do SET_BLOCK_COUNT for multiblock */
 #define MMC_BLK_REL_WR	(1 << 1)	/* MMC Reliable write support */
+#define MMC_BLK_PACKED_CMD	(1 << 2)	/* MMC packed command support */
 
 	unsigned int	usage;
 	unsigned int	read_only;
@@ -110,6 +141,18 @@ struct mmc_blk_data {
 	 */
 	unsigned int	part_curr;
 	struct device_attribute force_ro;
+	struct device_attribute packed_stats;
+
+	struct mmc_blk_packed_stats {
+		unsigned long	packs;		/* packed commands issued */
+		unsigned long	packed_reqs;	/* requests carried by them */
+		unsigned long	failures;	/* packed commands reported failed */
+		unsigned long	aborts;		/* groups failed after all retries */
+		unsigned long	reverts;	/* groups put back unissued */
+#define MMC_BLK_PACKED_HIST	32
+		unsigned long	entries[MMC_BLK_PACKED_HIST + 1];
+		unsigned long	stop[MMC_BLK_PACK_STOP_NR];
+	} pstats;
 };
 
 static DEFINE_MUTEX(open_lock);
@@ -196,6 +239,48 @@ out:
 	return ret;
 }
 
+static ssize_t packed_stats_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	struct mmc_blk_packed_stats *ps = &md->pstats;
+	int i, len;
+
+	len = snprintf(buf, PAGE_SIZE,
+		       "packs %lu\nrequests %lu\nfailures %lu\n"
+		       "aborts %lu\nreverts %lu\n",
+		       ps->packs, ps->packed_reqs, ps->failures,
+		       ps->aborts, ps->reverts);
+
+	/* Number of groups per entry count; 1 means the write went alone */
+	for (i = 1; i <= MMC_BLK_PACKED_HIST; i++) {
+		if (!ps->entries[i])
+			continue;
+		len += snprintf(buf + len, PAGE_SIZE - len, "entries_%d%s %lu\n",
+				i, i == MMC_BLK_PACKED_HIST ? "+" : "",
+				ps->entries[i]);
+	}
+
+	for (i = 0; i < MMC_BLK_PACK_STOP_NR; i++)
+		len += snprintf(buf + len, PAGE_SIZE - len, "stop_%s %lu\n",
+				mmc_blk_pack_stop_names[i], ps->stop[i]);
+
+	mmc_blk_put(md);
+	return len;
+}
+
+static ssize_t packed_stats_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+
+	/* Any write resets the counters */
+	memset(&md->pstats, 0, sizeof(md->pstats));
+	mmc_blk_put(md);
+	return count;
+}
+
 static int mmc_blk_open(struct block_device *bdev, fmode_t mode)
 {
 	struct mmc_blk_data *md = mmc_blk_get(bdev->bd_disk);
@@ -789,16 +874,22 @@ out:
 static int mmc_blk_issue_flush(struct mmc_queue *mq, struct request *req)
 {
 	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	int ret;
 
 	/*
-	 * No-op, only service this because we need REQ_FUA for reliable
-	 * writes.
+	 * Without a volatile cache this is a no-op, only serviced
+	 * because we need REQ_FUA for reliable writes.
 	 */
+	ret = mmc_flush_cache(card);
+	if (ret)
+		ret = -EIO;
+
 	spin_lock_irq(&md->lock);
-	__blk_end_request_all(req, 0);
+	__blk_end_request_all(req, ret);
 	spin_unlock_irq(&md->lock);
 
-	return 1;
+	return ret ? 0 : 1;
 }
 
 /*
@@ -940,10 +1031,7 @@ static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
 	 * XXX: this really needs a good explanation of why REQ_META
 	 * is treated special.
 	 */
-	bool do_rel_wr = ((req->cmd_flags & REQ_FUA) ||
-			  (req->cmd_flags & REQ_META)) &&
-		(rq_data_dir(req) == WRITE) &&
-		(md->flags & MMC_BLK_REL_WR);
+	bool do_rel_wr = mmc_req_rel_wr(req) && (md->flags & MMC_BLK_REL_WR);
 
 	memset(brq, 0, sizeof(struct mmc_blk_request));
 	brq->mrq.cmd = &brq->cmd;
@@ -1060,6 +1148,374 @@ static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
 	mmc_queue_bounce_pre(mqrq);
 }
 
+static inline void mmc_blk_clear_packed(struct mmc_queue_req *mqrq)
+{
+	struct mmc_packed *packed = mqrq->packed;
+
+	BUG_ON(!packed);
+
+	mqrq->cmd_type = MMC_PACKED_NONE;
+	packed->nr_entries = MMC_PACKED_NR_ZERO;
+	packed->idx_failure = MMC_PACKED_NR_IDX;
+	packed->retries = 0;
+	packed->blocks = 0;
+}
+
+static void mmc_blk_packed_stop(struct mmc_blk_data *md,
+				enum mmc_blk_pack_stop reason, u8 reqs)
+{
+	struct mmc_blk_packed_stats *ps = &md->pstats;
+
+	ps->stop[reason]++;
+	ps->entries[min_t(u8, reqs, MMC_BLK_PACKED_HIST)]++;
+	if (reqs > MMC_PACKED_NR_SINGLE) {
+		ps->packs++;
+		ps->packed_reqs += reqs;
+	}
+}
+
+/*
+ * Pull further writes off the queue behind @req for as long as they
+ * can share one packed command.  On return mq->mqrq_cur holds either
+ * the packed group, or just @req when nothing could be packed with it.
+ */
+static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
+{
+	struct request_queue *q = mq->queue;
+	struct mmc_card *card = mq->card;
+	struct request *cur = req, *next = NULL;
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_queue_req *mqrq = mq->mqrq_cur;
+	bool en_rel_wr = card->ext_csd.rel_param & EXT_CSD_WR_REL_PARAM_EN;
+	unsigned int req_sectors = 0, phys_segments = 0;
+	unsigned int max_blk_count, max_phys_segs;
+	enum mmc_blk_pack_stop reason;
+	bool put_back = true;
+	u8 max_packed_rw;
+	u8 reqs = 0;
+
+	if (!(md->flags & MMC_BLK_PACKED_CMD))
+		goto no_packed;
+
+	if (rq_data_dir(cur) != WRITE ||
+	    (cur->cmd_flags & (REQ_DISCARD | REQ_FLUSH)))
+		goto no_packed;
+
+	if (mmc_req_rel_wr(cur) &&
+	    (md->flags & MMC_BLK_REL_WR) && !en_rel_wr) {
+		mmc_blk_packed_stop(md, MMC_BLK_PACK_STOP_REL_WR, 1);
+		goto no_packed;
+	}
+
+	mmc_blk_clear_packed(mqrq);
+
+	max_packed_rw = card->ext_csd.max_packed_writes;
+	max_blk_count = min(card->host->max_blk_count,
+			    card->host->max_req_size >> 9);
+	/* CMD23 carries the block count in 16 bits */
+	if (unlikely(max_blk_count > 0xffff))
+		max_blk_count = 0xffff;
+
+	max_phys_segs = queue_max_segments(q);
+
+	/* The header block is part of the transfer too */
+	req_sectors += blk_rq_sectors(cur) + 1;
+	phys_segments += cur->nr_phys_segments + 1;
+
+	do {
+		if (reqs >= max_packed_rw - 1) {
+			reason = MMC_BLK_PACK_STOP_MAX_REQS;
+			put_back = false;
+			break;
+		}
+
+		spin_lock_irq(q->queue_lock);
+		next = blk_fetch_request(q);
+		spin_unlock_irq(q->queue_lock);
+		if (!next) {
+			reason = MMC_BLK_PACK_STOP_EMPTY;
+			put_back = false;
+			break;
+		}
+
+		if (next->cmd_flags & REQ_DISCARD ||
+		    next->cmd_flags & REQ_FLUSH) {
+			reason = MMC_BLK_PACK_STOP_SPECIAL;
+			break;
+		}
+
+		if (rq_data_dir(cur) != rq_data_dir(next)) {
+			reason = MMC_BLK_PACK_STOP_DIR;
+			break;
+		}
+
+		if (mmc_req_rel_wr(next) &&
+		    (md->flags & MMC_BLK_REL_WR) && !en_rel_wr) {
+			reason = MMC_BLK_PACK_STOP_REL_WR;
+			break;
+		}
+
+		req_sectors += blk_rq_sectors(next);
+		if (req_sectors > max_blk_count) {
+			reason = MMC_BLK_PACK_STOP_MAX_BLOCKS;
+			break;
+		}
+
+		phys_segments += next->nr_phys_segments;
+		if (phys_segments > max_phys_segs) {
+			reason = MMC_BLK_PACK_STOP_MAX_SEGS;
+			break;
+		}
+
+		list_add_tail(&next->queuelist, &mqrq->packed->list);
+		cur = next;
+		reqs++;
+	} while (1);
+
+	if (put_back) {
+		spin_lock_irq(q->queue_lock);
+		blk_requeue_request(q, next);
+		spin_unlock_irq(q->queue_lock);
+	}
+
+	mmc_blk_packed_stop(md, reason, reqs + 1);
+
+	if (reqs > 0) {
+		list_add(&req->queuelist, &mqrq->packed->list);
+		mqrq->packed->nr_entries = ++reqs;
+		mqrq->packed->retries = reqs;
+		return reqs;
+	}
+
+no_packed:
+	mqrq->cmd_type = MMC_PACKED_NONE;
+	return 0;
+}
+
+static int mmc_blk_packed_err_check(struct mmc_card *card,
+				    struct mmc_async_req *areq)
+{
+	struct mmc_queue_req *mq_rq = container_of(areq, struct mmc_queue_req,
+						   mmc_active);
+	struct request *req = mq_rq->req;
+	struct mmc_blk_data *md = req->rq_disk->private_data;
+	struct mmc_packed *packed = mq_rq->packed;
+	int err, check;
+	u32 status;
+	u8 *ext_csd;
+
+	BUG_ON(!packed);
+
+	packed->retries--;
+	check = mmc_blk_err_check(card, areq);
+	err = get_card_status(card, &status, 0);
+	if (err) {
+		pr_err("%s: error %d sending status command\n",
+		       req->rq_disk->disk_name, err);
+		return MMC_BLK_ABORT;
+	}
+
+	/*
+	 * A failed packed command is only reported through the exception
+	 * event; the transfer itself may well look successful.
+	 */
+	if (!(status & R1_EXCEPTION_EVENT))
+		return check;
+
+	ext_csd = kzalloc(512, GFP_KERNEL);
+	if (!ext_csd) {
+		pr_err("%s: unable to allocate buffer for ext_csd\n",
+		       req->rq_disk->disk_name);
+		return MMC_BLK_ABORT;
+	}
+
+	err = mmc_send_ext_csd(card, ext_csd);
+	if (err) {
+		pr_err("%s: error %d sending ext_csd\n",
+		       req->rq_disk->disk_name, err);
+		check = MMC_BLK_ABORT;
+		goto out;
+	}
+
+	if ((ext_csd[EXT_CSD_EXP_EVENTS_STATUS] & EXT_CSD_PACKED_FAILURE) &&
+	    (ext_csd[EXT_CSD_PACKED_CMD_STATUS] &
+	     EXT_CSD_PACKED_GENERIC_ERROR)) {
+		/* Without an index the whole group is sent again */
+		packed->idx_failure = 0;
+		if (ext_csd[EXT_CSD_PACKED_CMD_STATUS] &
+		    EXT_CSD_PACKED_INDEXED_ERROR)
+			packed->idx_failure =
+				ext_csd[EXT_CSD_PACKED_FAILURE_INDEX] - 1;
+		check = MMC_BLK_PARTIAL;
+		md->pstats.failures++;
+		pr_err("%s: packed cmd failed, nr %u, sectors %u, "
+		       "failure index: %d\n",
+		       req->rq_disk->disk_name, packed->nr_entries,
+		       packed->blocks, packed->idx_failure);
+	}
+out:
+	kfree(ext_csd);
+	return check;
+}
+
+static void mmc_blk_packed_hdr_wrq_prep(struct mmc_queue_req *mqrq,
+					struct mmc_card *card,
+					struct mmc_queue *mq)
+{
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct request *req = mqrq->req;
+	struct request *prq;
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_packed *packed = mqrq->packed;
+	bool do_rel_wr;
+	u32 *packed_cmd_hdr;
+	u8 i = 1;
+
+	BUG_ON(!packed);
+
+	mqrq->cmd_type = MMC_PACKED_WRITE;
+	packed->blocks = 0;
+	packed->idx_failure = MMC_PACKED_NR_IDX;
+
+	packed_cmd_hdr = packed->cmd_hdr;
+	memset(packed_cmd_hdr, 0, sizeof(packed->cmd_hdr));
+	packed_cmd_hdr[0] = (packed->nr_entries << 16) |
+		(PACKED_CMD_WR << 8) | PACKED_CMD_VER;
+
+	/*
+	 * Each entry of the header holds the CMD23 and the CMD25
+	 * argument the request would have been sent with on its own.
+	 */
+	list_for_each_entry(prq, &packed->list, queuelist) {
+		do_rel_wr = mmc_req_rel_wr(prq) && (md->flags & MMC_BLK_REL_WR);
+		packed_cmd_hdr[i * 2] =
+			(do_rel_wr ? (1 << 31) : 0) | blk_rq_sectors(prq);
+		packed_cmd_hdr[(i * 2) + 1] =
+			mmc_card_blockaddr(card) ?
+			blk_rq_pos(prq) : blk_rq_pos(prq) << 9;
+		packed->blocks += blk_rq_sectors(prq);
+		i++;
+	}
+
+	memset(brq, 0, sizeof(struct mmc_blk_request));
+	brq->mrq.cmd = &brq->cmd;
+	brq->mrq.data = &brq->data;
+	brq->mrq.sbc = &brq->sbc;
+	brq->mrq.stop = &brq->stop;
+
+	/* Bit 30 of the CMD23 argument flags the packed transfer */
+	brq->sbc.opcode = MMC_SET_BLOCK_COUNT;
+	brq->sbc.arg = (1 << 30) | (packed->blocks + 1);
+	brq->sbc.flags = MMC_RSP_R1 | MMC_CMD_AC;
+
+	brq->cmd.opcode = MMC_WRITE_MULTIPLE_BLOCK;
+	brq->cmd.arg = blk_rq_pos(req);
+	if (!mmc_card_blockaddr(card))
+		brq->cmd.arg <<= 9;
+	brq->cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+	brq->cmd.retries = MMC_CMD_RETRIES;
+
+	brq->data.blksz = 512;
+	brq->data.blocks = packed->blocks + 1;
+	brq->data.flags |= MMC_DATA_WRITE;
+
+	brq->stop.opcode = MMC_STOP_TRANSMISSION;
+	brq->stop.arg = 0;
+	brq->stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+
+	mmc_set_data_timeout(&brq->data, card);
+
+	brq->data.sg = mqrq->sg;
+	brq->data.sg_len = mmc_queue_map_sg(mq, mqrq);
+
+	mqrq->mmc_active.mrq = &brq->mrq;
+	mqrq->mmc_active.err_check = mmc_blk_packed_err_check;
+
+	mmc_queue_bounce_pre(mqrq);
+}
+
+/*
+ * Complete the requests of a packed group up to the failed entry, if
+ * any.  Returns 1 when the remainder starting at the failed entry has
+ * to be sent again; mq_rq->req then points at that entry.
+ */
+static int mmc_blk_end_packed_req(struct mmc_queue *mq,
+				  struct mmc_queue_req *mq_rq)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_packed *packed = mq_rq->packed;
+	struct request *prq;
+	int idx = packed->idx_failure, i = 0;
+
+	BUG_ON(!packed);
+
+	while (!list_empty(&packed->list)) {
+		prq = list_entry_rq(packed->list.next);
+		if (idx == i) {
+			/* retry from error index */
+			packed->nr_entries -= idx;
+			mq_rq->req = prq;
+
+			if (packed->nr_entries == MMC_PACKED_NR_SINGLE) {
+				list_del_init(&prq->queuelist);
+				mmc_blk_clear_packed(mq_rq);
+			}
+			return 1;
+		}
+		list_del_init(&prq->queuelist);
+		spin_lock_irq(&md->lock);
+		__blk_end_request(prq, 0, blk_rq_bytes(prq));
+		spin_unlock_irq(&md->lock);
+		i++;
+	}
+
+	mmc_blk_clear_packed(mq_rq);
+	return 0;
+}
+
+static void mmc_blk_abort_packed_req(struct mmc_queue *mq,
+				     struct mmc_queue_req *mq_rq)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_packed *packed = mq_rq->packed;
+	struct request *prq;
+
+	md->pstats.aborts++;
+	while (!list_empty(&packed->list)) {
+		prq = list_entry_rq(packed->list.next);
+		list_del_init(&prq->queuelist);
+		spin_lock_irq(&md->lock);
+		__blk_end_request(prq, -EIO, blk_rq_bytes(prq));
+		spin_unlock_irq(&md->lock);
+	}
+	mmc_blk_clear_packed(mq_rq);
+}
+
+/*
+ * Give all but the first request of an unissued packed group back to
+ * the block layer, in their original order.
+ */
+static void mmc_blk_revert_packed_req(struct mmc_queue *mq,
+				      struct mmc_queue_req *mq_rq)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct request_queue *q = mq->queue;
+	struct mmc_packed *packed = mq_rq->packed;
+	struct request *prq;
+
+	md->pstats.reverts++;
+	while (!list_empty(&packed->list)) {
+		prq = list_entry_rq(packed->list.prev);
+		list_del_init(&prq->queuelist);
+		if (prq != mq_rq->req) {
+			spin_lock_irq(q->queue_lock);
+			blk_requeue_request(q, prq);
+			spin_unlock_irq(q->queue_lock);
+		}
+	}
+	mmc_blk_clear_packed(mq_rq);
+}
+
 static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 {
 	struct mmc_blk_data *md = mq->data;
@@ -1070,13 +1526,21 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 	struct mmc_queue_req *mq_rq;
 	struct request *req;
 	struct mmc_async_req *areq;
+	u8 reqs = 0;
 
 	if (!rqc && !mq->mqrq_prev->req)
 		return 0;
 
+	if (rqc)
+		reqs = mmc_blk_prep_packed_list(mq, rqc);
+
 	do {
 		if (rqc) {
-			mmc_blk_rw_rq_prep(mq->mqrq_cur, card, 0, mq);
+			if (reqs > MMC_PACKED_NR_SINGLE)
+				mmc_blk_packed_hdr_wrq_prep(mq->mqrq_cur,
+							    card, mq);
+			else
+				mmc_blk_rw_rq_prep(mq->mqrq_cur, card, 0, mq);
 			areq = &mq->mqrq_cur->mmc_active;
 		} else
 			areq = NULL;
@@ -1095,6 +1559,16 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 			/*
 			 * A block was successfully transferred.
 			 */
+			if (mmc_packed_cmd(mq_rq->cmd_type)) {
+				ret = mmc_blk_end_packed_req(mq, mq_rq);
+				break;
+			}
+			if (status == MMC_BLK_SUCCESS &&
+			    brq->data.bytes_xfered == blk_rq_bytes(req) &&
+			    mmc_queue_complete_remote(mq, req)) {
+				ret = 0;
+				break;
+			}
 			spin_lock_irq(&md->lock);
 			ret = __blk_end_request(req, 0,
 						brq->data.bytes_xfered);
@@ -1114,6 +1588,11 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 			}
 			break;
 		case MMC_BLK_CMD_ERR:
+			/* A packed group is resent until its retries run out */
+			if (mmc_packed_cmd(mq_rq->cmd_type)) {
+				ret = 1;
+				break;
+			}
 			goto cmd_err;
 		case MMC_BLK_RETRY_SINGLE:
 			disable_multi = 1;
@@ -1143,7 +1622,14 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 			 * In case of a none complete request
 			 * prepare it again and resend.
 			 */
-			mmc_blk_rw_rq_prep(mq_rq, card, disable_multi, mq);
+			if (mmc_packed_cmd(mq_rq->cmd_type)) {
+				if (!mq_rq->packed->retries)
+					goto cmd_abort;
+				mmc_blk_packed_hdr_wrq_prep(mq_rq, card, mq);
+			} else {
+				mmc_blk_rw_rq_prep(mq_rq, card, disable_multi,
+						   mq);
+			}
 			mmc_start_req(card->host, &mq_rq->mmc_active, NULL);
 		}
 	} while (ret);
@@ -1178,13 +1664,25 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 	}
 
  cmd_abort:
-	spin_lock_irq(&md->lock);
-	while (ret)
-		ret = __blk_end_request(req, -EIO, blk_rq_cur_bytes(req));
-	spin_unlock_irq(&md->lock);
+	if (mmc_packed_cmd(mq_rq->cmd_type)) {
+		mmc_blk_abort_packed_req(mq, mq_rq);
+	} else {
+		spin_lock_irq(&md->lock);
+		while (ret)
+			ret = __blk_end_request(req, -EIO,
+						blk_rq_cur_bytes(req));
+		spin_unlock_irq(&md->lock);
+	}
 
  start_new_req:
 	if (rqc) {
+		/*
+		 * The new request was never started; if it is a packed
+		 * group, put its tail back and send the head on its own.
+		 */
+		if (mmc_packed_cmd(mq->mqrq_cur->cmd_type))
+			mmc_blk_revert_packed_req(mq, mq->mqrq_cur);
+
 		mmc_blk_rw_rq_prep(mq->mqrq_cur, card, 0, mq);
 		mmc_start_req(card->host, &mq->mqrq_cur->mmc_active, NULL);
 	}
@@ -1212,6 +1710,13 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 		/* claim host only for the first request */
 		mmc_claim_host(card->host);
 
+	/*
+	 * End any bk ops of the eMMC card, and wait for it, before the
+	 * partition switch or the request reach the card.
+	 */
+	if (req && mmc_card_mmc(card) && mmc_card_doing_bkops(card))
+		mmc_stop_bkops(card);
+
 	ret = mmc_blk_part_switch(card, md);
 	if (ret) {
 		ret = 0;
@@ -1229,10 +1734,6 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 			mmc_blk_issue_rw_rq(mq, NULL);
 		ret = mmc_blk_issue_flush(mq, req);
 	} else {
-		/* Abort any current bk ops of eMMC card by issuing HPI */
-		if (mmc_card_mmc(mq->card) && mmc_card_doing_bkops(mq->card))
-			mmc_interrupt_hpi(mq->card);
-
 		ret = mmc_blk_issue_rw_rq(mq, req);
 	}
 
@@ -1346,6 +1847,23 @@ static struct mmc_blk_data *mmc_blk_alloc_req(struct mmc_card *card,
 	     card->ext_csd.rel_sectors)) {
 		md->flags |= MMC_BLK_REL_WR;
 		blk_queue_flush(md->queue.queue, REQ_FLUSH | REQ_FUA);
+	} else if (mmc_card_mmc(card) && card->ext_csd.cache_ctrl) {
+		/* Volatile cache on: flushes have to reach the card */
+		blk_queue_flush(md->queue.queue, REQ_FLUSH);
+	}
+
+	/*
+	 * Packed writes need CMD23 and the packed failure event; they are
+	 * not used behind a bounce buffer, which only holds one request.
+	 */
+	if (mmc_card_mmc(card) &&
+	    md->flags & MMC_BLK_CMD23 &&
+	    card->ext_csd.packed_event_en &&
+	    card->ext_csd.max_packed_writes > MMC_PACKED_NR_SINGLE &&
+	    mmc_host_packed_wr(card->host) &&
+	    !md->queue.mqrq_cur->bounce_buf) {
+		if (!mmc_packed_init(&md->queue, card))
+			md->flags |= MMC_BLK_PACKED_CMD;
 	}
 
 	return md;
@@ -1454,6 +1972,9 @@ static void mmc_blk_remove_req(struct mmc_blk_data *md)
 	if (md) {
 		if (md->disk->flags & GENHD_FL_UP) {
 			device_remove_file(disk_to_dev(md->disk), &md->force_ro);
+			if (md->flags & MMC_BLK_PACKED_CMD)
+				device_remove_file(disk_to_dev(md->disk),
+						   &md->packed_stats);
 
 			/* Stop new requests from getting into the queue */
 			del_gendisk(md->disk);
@@ -1461,6 +1982,8 @@ static void mmc_blk_remove_req(struct mmc_blk_data *md)
 
 		/* Then flush out any already in there */
 		mmc_cleanup_queue(&md->queue);
+		if (md->flags & MMC_BLK_PACKED_CMD)
+			mmc_packed_clean(&md->queue);
 		mmc_blk_put(md);
 	}
 }
@@ -1491,7 +2014,26 @@ static int mmc_add_disk(struct mmc_blk_data *md)
 	md->force_ro.attr.mode = S_IRUGO | S_IWUSR;
 	ret = device_create_file(disk_to_dev(md->disk), &md->force_ro);
 	if (ret)
-		del_gendisk(md->disk);
+		goto force_ro_fail;
+
+	if (md->flags & MMC_BLK_PACKED_CMD) {
+		md->packed_stats.show = packed_stats_show;
+		md->packed_stats.store = packed_stats_store;
+		sysfs_attr_init(&md->packed_stats.attr);
+		md->packed_stats.attr.name = "packed_stats";
+		md->packed_stats.attr.mode = S_IRUGO | S_IWUSR;
+		ret = device_create_file(disk_to_dev(md->disk),
+					 &md->packed_stats);
+		if (ret)
+			goto packed_stats_fail;
+	}
+
+	return 0;
+
+packed_stats_fail:
+	device_remove_file(disk_to_dev(md->disk), &md->force_ro);
+force_ro_fail:
+	del_gendisk(md->disk);
 
 	return ret;
 }
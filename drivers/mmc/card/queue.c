@@ -64,14 +64,20 @@ static int mmc_queue_thread(void *d)
 
 		if (req || mq->mqrq_prev->req) {
 			set_current_state(TASK_RUNNING);
+			/*
+			 * Wait out a pending BKOPS start only while the
+			 * host is free, before the first request of a
+			 * batch; the issue path stops BKOPS that started.
+			 */
+			if (req && !mq->mqrq_prev->req)
+				mmc_cancel_bkops(mq->card);
 			mq->issue_fn(mq, req);
 		} else {
 			/*
-			 * Since the queue is empty, start synchronous
-			 * background ops if there is a request for it.
+			 * Since the queue is empty, let the core start
+			 * background ops once it has stayed idle.
 			 */
-			if (mmc_card_need_bkops(mq->card))
-				mmc_bkops_start(mq->card, true);
+			mmc_schedule_bkops(mq->card);
 			if (kthread_should_stop()) {
 				set_current_state(TASK_RUNNING);
 				break;
@@ -116,6 +122,30 @@ static void mmc_request(struct request_queue *q)
 		wake_up_process(mq->thread);
 }
 
+static void mmc_softirq_done(struct request *req)
+{
+	blk_end_request_all(req, 0);
+}
+
+/*
+ * With rq_affinity set to 2, a request that has been transferred whole is
+ * ended from the block softirq of the CPU that submitted it, which is
+ * kicked by IPI, instead of by mmcqd on whichever CPU took the interrupt.
+ * Returns false when the caller has to end the request itself.
+ */
+bool mmc_queue_complete_remote(struct mmc_queue *mq, struct request *req)
+{
+	int cpu = req->cpu;
+
+	if (!test_bit(QUEUE_FLAG_SAME_FORCE, &mq->queue->queue_flags))
+		return false;
+	if (cpu < 0 || cpu == raw_smp_processor_id() || !cpu_online(cpu))
+		return false;
+
+	blk_complete_request(req);
+	return true;
+}
+
 struct scatterlist *mmc_alloc_sg(int sg_len, int *err)
 {
 	struct scatterlist *sg;
@@ -185,6 +215,7 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 	mq->queue->queuedata = mq;
 
 	blk_queue_prep_rq(mq->queue, mmc_prep_request);
+	blk_queue_softirq_done(mq->queue, mmc_softirq_done);
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, mq->queue);
 	if (mmc_can_erase(card))
 		mmc_queue_setup_discard(mq->queue, card);
@@ -382,6 +413,80 @@ void mmc_queue_resume(struct mmc_queue *mq)
 	}
 }
 
+/**
+ * mmc_packed_init - allocate the packed command state of a queue
+ * @mq: MMC queue
+ * @card: card the queue belongs to
+ *
+ * Each of the two queue slots gets its own header block and request
+ * list, so that one packed group can be prepared while the other one
+ * is still in flight.
+ */
+int mmc_packed_init(struct mmc_queue *mq, struct mmc_card *card)
+{
+	struct mmc_queue_req *mqrq_cur = &mq->mqrq[0];
+	struct mmc_queue_req *mqrq_prev = &mq->mqrq[1];
+
+	mqrq_cur->packed = kzalloc(sizeof(struct mmc_packed), GFP_KERNEL);
+	if (!mqrq_cur->packed) {
+		printk(KERN_WARNING "%s: unable to allocate packed cmd "
+			"for mqrq_cur\n", mmc_card_name(card));
+		return -ENOMEM;
+	}
+
+	mqrq_prev->packed = kzalloc(sizeof(struct mmc_packed), GFP_KERNEL);
+	if (!mqrq_prev->packed) {
+		printk(KERN_WARNING "%s: unable to allocate packed cmd "
+			"for mqrq_prev\n", mmc_card_name(card));
+		kfree(mqrq_cur->packed);
+		mqrq_cur->packed = NULL;
+		return -ENOMEM;
+	}
+
+	INIT_LIST_HEAD(&mqrq_cur->packed->list);
+	INIT_LIST_HEAD(&mqrq_prev->packed->list);
+
+	return 0;
+}
+
+void mmc_packed_clean(struct mmc_queue *mq)
+{
+	struct mmc_queue_req *mqrq_cur = &mq->mqrq[0];
+	struct mmc_queue_req *mqrq_prev = &mq->mqrq[1];
+
+	kfree(mqrq_cur->packed);
+	mqrq_cur->packed = NULL;
+	kfree(mqrq_prev->packed);
+	mqrq_prev->packed = NULL;
+}
+
+/*
+ * Map a packed group: the header block goes first, followed by the
+ * data of every request in the group, in list order.
+ */
+static unsigned int mmc_queue_packed_map_sg(struct mmc_queue *mq,
+					    struct mmc_packed *packed,
+					    struct scatterlist *sg)
+{
+	struct scatterlist *__sg = sg;
+	unsigned int sg_len = 0;
+	struct request *req;
+
+	/* blk_rq_map_sg() marks its last entry, so clear it in between */
+	sg_set_buf(__sg, packed->cmd_hdr, sizeof(packed->cmd_hdr));
+	(__sg++)->page_link &= ~0x02;
+	sg_len++;
+
+	list_for_each_entry(req, &packed->list, queuelist) {
+		sg_len += blk_rq_map_sg(mq->queue, req, __sg);
+		__sg = sg + (sg_len - 1);
+		(__sg++)->page_link &= ~0x02;
+	}
+	sg_mark_end(sg + (sg_len - 1));
+
+	return sg_len;
+}
+
 /*
  * Prepare the sg list(s) to be handed of to the host driver
  */
@@ -392,6 +497,9 @@ unsigned int mmc_queue_map_sg(struct mmc_queue *mq, struct mmc_queue_req *mqrq)
 	struct scatterlist *sg;
 	int i;
 
+	if (mmc_packed_cmd(mqrq->cmd_type))
+		return mmc_queue_packed_map_sg(mq, mqrq->packed, mqrq->sg);
+
 	if (!mqrq->bounce_buf)
 		return blk_rq_map_sg(mq->queue, mqrq->req, mqrq->sg);
 
@@ -26,6 +26,7 @@
 #include <linux/pm_runtime.h>
 #include <linux/suspend.h>
 #include <linux/wakelock.h>
+#include <linux/slab.h>
 
 #include <trace/events/mmc.h>
 
@@ -71,6 +72,20 @@ MODULE_PARM_DESC(
 	removable,
 	"MMC/SD cards are removable and may be removed during suspend");
 
+/*
+ * Background operations are started once the request queue has been
+ * idle for bkops_idle_ms and the card reports at least bkops_idle_level
+ * in BKOPS_STATUS.  With the screen off, any outstanding level will do
+ * and there is no idle delay.
+ */
+static unsigned int bkops_idle_ms = 2000;
+module_param(bkops_idle_ms, uint, 0644);
+MODULE_PARM_DESC(bkops_idle_ms, "Queue idle time before starting BKOPS");
+
+static unsigned int bkops_idle_level = EXT_CSD_BKOPS_LEVEL_PERF;
+module_param(bkops_idle_level, uint, 0644);
+MODULE_PARM_DESC(bkops_idle_level, "Minimum BKOPS_STATUS to start BKOPS when idle");
+
 /*
  * Internal function. Schedule delayed work in the MMC work queue.
  */
@@ -240,7 +255,7 @@ static void mmc_wait_for_req_done(struct mmc_host *host,
 static void mmc_pre_req(struct mmc_host *host, struct mmc_request *mrq,
 		 bool is_first_req)
 {
-	if (host->ops->pre_req)
+	if (host->ops->pre_req && !host->skip_pre_req)
 		host->ops->pre_req(host, mrq, is_first_req);
 }
 
@@ -256,7 +271,7 @@ static void mmc_pre_req(struct mmc_host *host, struct mmc_request *mrq,
 static void mmc_post_req(struct mmc_host *host, struct mmc_request *mrq,
 			 int err)
 {
-	if (host->ops->post_req)
+	if (host->ops->post_req && !host->skip_pre_req)
 		host->ops->post_req(host, mrq, err);
 }
 
@@ -373,6 +388,151 @@ int mmc_bkops_start(struct mmc_card *card, bool is_synchronous)
 }
 EXPORT_SYMBOL(mmc_bkops_start);
 
+static int mmc_read_bkops_status(struct mmc_card *card, u8 *level)
+{
+	u8 *ext_csd;
+	int err;
+
+	ext_csd = kmalloc(512, GFP_KERNEL);
+	if (!ext_csd)
+		return -ENOMEM;
+
+	err = mmc_send_ext_csd(card, ext_csd);
+	if (!err)
+		*level = ext_csd[EXT_CSD_BKOPS_STATUS] & 0x3;
+
+	kfree(ext_csd);
+	return err;
+}
+
+/*
+ * Deferred BKOPS start.  Urgent requests from the card are served as
+ * they are, otherwise BKOPS_STATUS decides whether the card has enough
+ * outstanding work to be worth an HPI on the next request.
+ */
+static void mmc_bkops_work(struct work_struct *work)
+{
+	struct mmc_card *card = container_of(work, struct mmc_card,
+					     bkops.dwork.work);
+	struct mmc_host *host = card->host;
+	unsigned long flags;
+	unsigned int min_level;
+	bool urgent;
+	u8 level;
+	int err;
+
+	mmc_claim_host(host);
+
+	if (!card->ext_csd.bk_ops_en || mmc_card_doing_bkops(card))
+		goto out;
+
+	urgent = mmc_card_need_bkops(card);
+	if (!urgent) {
+		min_level = card->bkops.screen_off ?
+			EXT_CSD_BKOPS_LEVEL_NON_CRIT : bkops_idle_level;
+		if (mmc_read_bkops_status(card, &level) || level < min_level)
+			goto out;
+	}
+
+	err = mmc_send_bk_ops_cmd(card, false);
+	if (err) {
+		pr_err("%s: abort bk ops (%d error)\n",
+			mmc_hostname(host), err);
+		goto out;
+	}
+
+	spin_lock_irqsave(&host->lock, flags);
+	mmc_card_clr_need_bkops(card);
+	mmc_card_set_doing_bkops(card);
+	spin_unlock_irqrestore(&host->lock, flags);
+
+	if (urgent)
+		card->bkops.nr_urgent++;
+	else if (card->bkops.screen_off)
+		card->bkops.nr_screen_off++;
+	else
+		card->bkops.nr_idle++;
+out:
+	mmc_release_host(host);
+}
+
+/**
+ *	mmc_schedule_bkops - start background ops once the card is idle
+ *	@card: the MMC card associated with bkops
+ *
+ *	Called when the request queue has run empty.  Any new request
+ *	must call mmc_cancel_bkops() before it is issued.
+ */
+void mmc_schedule_bkops(struct mmc_card *card)
+{
+	unsigned long delay;
+
+	if (!mmc_card_mmc(card) || !card->ext_csd.bk_ops_en ||
+	    mmc_card_doing_bkops(card))
+		return;
+
+	if (mmc_card_need_bkops(card) || card->bkops.screen_off)
+		delay = 0;
+	else
+		delay = msecs_to_jiffies(bkops_idle_ms);
+
+	mmc_schedule_delayed_work(&card->bkops.dwork, delay);
+}
+EXPORT_SYMBOL(mmc_schedule_bkops);
+
+/**
+ *	mmc_cancel_bkops - drop a background ops start not yet issued
+ *	@card: the MMC card associated with bkops
+ *
+ *	Waits for a start already in progress, so the caller must not hold
+ *	the host.  BKOPS already running on the card are left to
+ *	mmc_stop_bkops().
+ */
+void mmc_cancel_bkops(struct mmc_card *card)
+{
+	if (mmc_card_mmc(card) && card->ext_csd.bk_ops_en)
+		cancel_delayed_work_sync(&card->bkops.dwork);
+}
+EXPORT_SYMBOL(mmc_cancel_bkops);
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void mmc_bkops_early_suspend(struct early_suspend *h)
+{
+	struct mmc_card *card = container_of(h, struct mmc_card,
+					     bkops.early_suspend);
+
+	card->bkops.screen_off = true;
+	mmc_schedule_bkops(card);
+}
+
+static void mmc_bkops_late_resume(struct early_suspend *h)
+{
+	struct mmc_card *card = container_of(h, struct mmc_card,
+					     bkops.early_suspend);
+
+	card->bkops.screen_off = false;
+}
+#endif
+
+void mmc_init_bkops(struct mmc_card *card)
+{
+	INIT_DELAYED_WORK(&card->bkops.dwork, mmc_bkops_work);
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	card->bkops.early_suspend.level = EARLY_SUSPEND_LEVEL_DISABLE_FB;
+	card->bkops.early_suspend.suspend = mmc_bkops_early_suspend;
+	card->bkops.early_suspend.resume = mmc_bkops_late_resume;
+	register_early_suspend(&card->bkops.early_suspend);
+#endif
+}
+
+void mmc_exit_bkops(struct mmc_card *card)
+{
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	unregister_early_suspend(&card->bkops.early_suspend);
+#endif
+	cancel_delayed_work_sync(&card->bkops.dwork);
+}
+
 /**
  *	mmc_interrupt_hpi - Issue for High priority Interrupt
  *	@card: the MMC card associated with the HPI transfer
@@ -407,6 +567,7 @@ int mmc_interrupt_hpi(struct mmc_card *card)
 	 * If the card status is in PRG-state, we can send the HPI command.
 	 */
 	if (R1_CURRENT_STATE(status) == R1_STATE_PRG) {
+		card->bkops.nr_hpi++;
 		do {
 			/*
 			 * We don't know when the HPI command will finish
@@ -437,6 +598,49 @@ out:
 }
 EXPORT_SYMBOL(mmc_interrupt_hpi);
 
+/* Longest a card without HPI is given to finish BKOPS on its own */
+#define MMC_BKOPS_STOP_TIMEOUT_MS	10000
+
+/**
+ *	mmc_stop_bkops - end background ops before the next command
+ *	@card: the MMC card doing bkops
+ *
+ *	Interrupts BKOPS with HPI when the card supports it, otherwise
+ *	waits for the card to leave prg-state.  Either way the card is
+ *	ready for a new command, including a partition switch, on return.
+ */
+int mmc_stop_bkops(struct mmc_card *card)
+{
+	unsigned long timeout, flags;
+	u32 status;
+	int err;
+
+	if (card->ext_csd.hpi_en)
+		return mmc_interrupt_hpi(card);
+
+	mmc_claim_host(card->host);
+	timeout = jiffies + msecs_to_jiffies(MMC_BKOPS_STOP_TIMEOUT_MS);
+	for (;;) {
+		err = mmc_send_status(card, &status);
+		if (err || R1_CURRENT_STATE(status) != R1_STATE_PRG)
+			break;
+		if (time_after(jiffies, timeout)) {
+			pr_err("%s: card stuck in bkops\n",
+			       mmc_hostname(card->host));
+			err = -ETIMEDOUT;
+			break;
+		}
+		usleep_range(1000, 2000);
+	}
+
+	spin_lock_irqsave(&card->host->lock, flags);
+	mmc_card_clr_doing_bkops(card);
+	spin_unlock_irqrestore(&card->host->lock, flags);
+	mmc_release_host(card->host);
+	return err;
+}
+EXPORT_SYMBOL(mmc_stop_bkops);
+
 /**
  *	mmc_wait_for_cmd - start a command and wait for completion
  *	@host: MMC host to start command
@@ -1892,6 +2096,62 @@ int mmc_set_blocklen(struct mmc_card *card, unsigned int blocklen)
 }
 EXPORT_SYMBOL(mmc_set_blocklen);
 
+/*
+ * Flush the volatile cache to the non-volatile storage.
+ */
+int mmc_flush_cache(struct mmc_card *card)
+{
+	struct mmc_host *host = card->host;
+	int err = 0;
+
+	if (!(host->caps2 & MMC_CAP2_CACHE_CTRL))
+		return err;
+
+	if (mmc_card_mmc(card) && card->ext_csd.cache_ctrl) {
+		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+				 EXT_CSD_FLUSH_CACHE, 1, 0);
+		if (err)
+			pr_err("%s: cache flush error %d\n",
+			       mmc_hostname(host), err);
+	}
+
+	return err;
+}
+EXPORT_SYMBOL(mmc_flush_cache);
+
+/*
+ * Turn the cache ON/OFF.  Turning the cache OFF shall trigger a flush
+ * of all the cached data to the non-volatile storage.  Must be called
+ * with the host claimed.
+ */
+int mmc_cache_ctrl(struct mmc_host *host, u8 enable)
+{
+	struct mmc_card *card = host->card;
+	int err = 0;
+
+	if (!(host->caps2 & MMC_CAP2_CACHE_CTRL) ||
+	    mmc_card_is_removable(host))
+		return err;
+
+	if (card && mmc_card_mmc(card) && card->ext_csd.cache_size > 0) {
+		enable = !!enable;
+
+		if (card->ext_csd.cache_ctrl ^ enable) {
+			err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+					 EXT_CSD_CACHE_CTRL, enable, 0);
+			if (err)
+				pr_err("%s: cache %s error %d\n",
+				       mmc_hostname(host),
+				       enable ? "on" : "off", err);
+			else
+				card->ext_csd.cache_ctrl = enable;
+		}
+	}
+
+	return err;
+}
+EXPORT_SYMBOL(mmc_cache_ctrl);
+
 static int mmc_rescan_try_freq(struct mmc_host *host, unsigned freq)
 {
 	host->f_init = freq;
@@ -2143,9 +2403,13 @@ int mmc_suspend_host(struct mmc_host *host)
 	if (mmc_bus_needs_resume(host))
 		return 0;
 
-	if (mmc_card_mmc(host->card) && mmc_card_doing_bkops(host->card))
-		mmc_interrupt_hpi(host->card);
-	mmc_card_clr_need_bkops(host->card);
+	if (host->card && mmc_card_mmc(host->card)) {
+		if (host->card->ext_csd.bk_ops_en)
+			cancel_delayed_work_sync(&host->card->bkops.dwork);
+		if (mmc_card_doing_bkops(host->card))
+			mmc_interrupt_hpi(host->card);
+		mmc_card_clr_need_bkops(host->card);
+	}
 
 	if (host->caps & MMC_CAP_DISABLE)
 		cancel_delayed_work(&host->disable);
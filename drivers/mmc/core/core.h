@@ -60,6 +60,8 @@ void mmc_start_host(struct mmc_host *host);
 void mmc_stop_host(struct mmc_host *host);
 
 int mmc_attach_mmc(struct mmc_host *host);
+void mmc_init_bkops(struct mmc_card *card);
+void mmc_exit_bkops(struct mmc_card *card);
 int mmc_attach_sdio(struct mmc_host *host);
 
 /* Module parameters */
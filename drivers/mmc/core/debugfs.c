@@ -9,12 +9,17 @@
  */
 #include <linux/debugfs.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/scatterlist.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/stat.h>
 
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
+#include <linux/mmc/mmc.h>
 
 #include "core.h"
 #include "mmc_ops.h"
@@ -284,6 +289,255 @@ static const struct file_operations mmc_dbg_ext_csd_fops = {
 	.llseek		= default_llseek,
 };
 
+static int mmc_bkops_stats_show(struct seq_file *s, void *data)
+{
+	struct mmc_card *card = s->private;
+	struct mmc_bkops_info *bkops = &card->bkops;
+
+	seq_printf(s, "enabled:\t%d\n", card->ext_csd.bk_ops_en);
+	seq_printf(s, "urgent:\t\t%u\n", bkops->nr_urgent);
+	seq_printf(s, "idle:\t\t%u\n", bkops->nr_idle);
+	seq_printf(s, "screen_off:\t%u\n", bkops->nr_screen_off);
+	seq_printf(s, "hpi:\t\t%u\n", bkops->nr_hpi);
+
+	return 0;
+}
+
+static int mmc_bkops_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_bkops_stats_show, inode->i_private);
+}
+
+static const struct file_operations mmc_bkops_stats_fops = {
+	.open		= mmc_bkops_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * async_bench: sequential read throughput from the start of the user
+ * area, once with the host's pre_req/post_req hooks bypassed and once
+ * with them in use, keeping two requests in flight through
+ * mmc_start_req() in both runs. Writing a size in MiB starts a run
+ * (0 picks the default), reading returns the result of the last one.
+ * The host is claimed for the whole run, so other I/O stalls meanwhile.
+ */
+#define MMC_BENCH_DEF_MB	16
+#define MMC_BENCH_CHUNK		(128 * 1024)
+#define MMC_BENCH_PAGES		(MMC_BENCH_CHUNK / PAGE_SIZE)
+
+struct mmc_bench_req {
+	struct mmc_async_req	areq;
+	struct mmc_request	mrq;
+	struct mmc_command	cmd;
+	struct mmc_command	stop;
+	struct mmc_data		data;
+	struct scatterlist	sg[MMC_BENCH_PAGES];
+	struct page		*pages[MMC_BENCH_PAGES];
+};
+
+static DEFINE_MUTEX(mmc_bench_lock);
+static struct {
+	unsigned int	mb;
+	unsigned int	sync_kbps;
+	unsigned int	async_kbps;
+	int		err;
+} mmc_bench_result;
+
+static int mmc_bench_err_check(struct mmc_card *card,
+			       struct mmc_async_req *areq)
+{
+	struct mmc_request *mrq = areq->mrq;
+
+	if (mrq->sbc && mrq->sbc->error)
+		return mrq->sbc->error;
+	if (mrq->cmd->error)
+		return mrq->cmd->error;
+	if (mrq->data->error)
+		return mrq->data->error;
+	if (mrq->stop && mrq->stop->error)
+		return mrq->stop->error;
+	return 0;
+}
+
+static void mmc_bench_prep(struct mmc_card *card, struct mmc_bench_req *br,
+			   unsigned int sector, unsigned int blocks)
+{
+	memset(&br->mrq, 0, sizeof(br->mrq));
+	memset(&br->cmd, 0, sizeof(br->cmd));
+	memset(&br->stop, 0, sizeof(br->stop));
+	memset(&br->data, 0, sizeof(br->data));
+
+	br->cmd.opcode = MMC_READ_MULTIPLE_BLOCK;
+	br->cmd.arg = mmc_card_blockaddr(card) ? sector : sector << 9;
+	br->cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+
+	br->stop.opcode = MMC_STOP_TRANSMISSION;
+	br->stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+
+	br->data.blksz = 512;
+	br->data.blocks = blocks;
+	br->data.flags = MMC_DATA_READ;
+	br->data.sg = br->sg;
+	br->data.sg_len = MMC_BENCH_PAGES;
+	mmc_set_data_timeout(&br->data, card);
+
+	br->mrq.cmd = &br->cmd;
+	br->mrq.data = &br->data;
+	br->mrq.stop = &br->stop;
+
+	br->areq.mrq = &br->mrq;
+	br->areq.err_check = mmc_bench_err_check;
+}
+
+static int mmc_bench_run(struct mmc_card *card, struct mmc_bench_req *br,
+			 unsigned int sectors, bool prep, unsigned int *kbps)
+{
+	struct mmc_host *host = card->host;
+	unsigned int blocks = MMC_BENCH_CHUNK >> 9;
+	unsigned int sector;
+	ktime_t start;
+	u64 ns;
+	int err = 0, err2 = 0, i = 0;
+
+	mmc_claim_host(host);
+
+	/* The block driver may have left a boot partition selected */
+	if (mmc_card_mmc(card) &&
+	    (card->ext_csd.part_config & EXT_CSD_PART_CONFIG_ACC_MASK)) {
+		mmc_release_host(host);
+		return -EBUSY;
+	}
+
+	host->skip_pre_req = !prep;
+	start = ktime_get();
+
+	for (sector = 0; sector < sectors; sector += blocks) {
+		mmc_bench_prep(card, &br[i], sector, blocks);
+		mmc_start_req(host, &br[i].areq, &err);
+		if (err)
+			break;
+		i ^= 1;
+	}
+	mmc_start_req(host, NULL, &err2);
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	host->skip_pre_req = false;
+
+	mmc_release_host(host);
+
+	if (err || err2)
+		return err ? err : err2;
+
+	*kbps = ns ? div64_u64((u64)(sectors >> 1) * NSEC_PER_SEC, ns) : 0;
+	return 0;
+}
+
+static int mmc_bench_show(struct seq_file *s, void *data)
+{
+	int gain = 0;
+
+	mutex_lock(&mmc_bench_lock);
+	if (mmc_bench_result.err) {
+		seq_printf(s, "error:\t\t%d\n", mmc_bench_result.err);
+	} else if (mmc_bench_result.mb) {
+		if (mmc_bench_result.sync_kbps)
+			gain = ((int)mmc_bench_result.async_kbps -
+				(int)mmc_bench_result.sync_kbps) * 100 /
+				(int)mmc_bench_result.sync_kbps;
+		seq_printf(s, "size:\t\t%u MiB\n", mmc_bench_result.mb);
+		seq_printf(s, "no pre_req:\t%u KiB/s\n",
+			   mmc_bench_result.sync_kbps);
+		seq_printf(s, "pre_req:\t%u KiB/s\n",
+			   mmc_bench_result.async_kbps);
+		seq_printf(s, "gain:\t\t%d%%\n", gain);
+	}
+	mutex_unlock(&mmc_bench_lock);
+
+	return 0;
+}
+
+static int mmc_bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_bench_show, inode->i_private);
+}
+
+static ssize_t mmc_bench_write(struct file *file, const char __user *ubuf,
+			       size_t cnt, loff_t *ppos)
+{
+	struct mmc_card *card = ((struct seq_file *)file->private_data)->private;
+	struct mmc_bench_req *br;
+	unsigned long mb;
+	unsigned int sectors, capacity;
+	int err, i, j;
+
+	err = kstrtoul_from_user(ubuf, cnt, 0, &mb);
+	if (err)
+		return err;
+	if (!mb)
+		mb = MMC_BENCH_DEF_MB;
+
+	if (card->host->max_req_size < MMC_BENCH_CHUNK ||
+	    card->host->max_blk_count < (MMC_BENCH_CHUNK >> 9) ||
+	    card->host->max_segs < MMC_BENCH_PAGES)
+		return -EINVAL;
+
+	if (!mmc_card_sd(card) && mmc_card_blockaddr(card))
+		capacity = card->ext_csd.sectors;
+	else
+		capacity = card->csd.capacity << (card->csd.read_blkbits - 9);
+	if (mb > capacity >> 11)
+		mb = capacity >> 11;
+	sectors = mb << 11;
+	if (!sectors)
+		return -EINVAL;
+
+	br = kzalloc(2 * sizeof(*br), GFP_KERNEL);
+	if (!br)
+		return -ENOMEM;
+
+	for (i = 0; i < 2; i++) {
+		sg_init_table(br[i].sg, MMC_BENCH_PAGES);
+		for (j = 0; j < MMC_BENCH_PAGES; j++) {
+			br[i].pages[j] = alloc_page(GFP_KERNEL);
+			if (!br[i].pages[j]) {
+				err = -ENOMEM;
+				goto out_free;
+			}
+			sg_set_page(&br[i].sg[j], br[i].pages[j], PAGE_SIZE, 0);
+		}
+	}
+
+	mutex_lock(&mmc_bench_lock);
+	memset(&mmc_bench_result, 0, sizeof(mmc_bench_result));
+	err = mmc_bench_run(card, br, sectors, false,
+			    &mmc_bench_result.sync_kbps);
+	if (!err)
+		err = mmc_bench_run(card, br, sectors, true,
+				    &mmc_bench_result.async_kbps);
+	mmc_bench_result.mb = mb;
+	mmc_bench_result.err = err;
+	mutex_unlock(&mmc_bench_lock);
+
+out_free:
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < MMC_BENCH_PAGES; j++)
+			if (br[i].pages[j])
+				__free_page(br[i].pages[j]);
+	kfree(br);
+
+	return err ? err : cnt;
+}
+
+static const struct file_operations mmc_bench_fops = {
+	.open		= mmc_bench_open,
+	.read		= seq_read,
+	.write		= mmc_bench_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 void mmc_add_card_debugfs(struct mmc_card *card)
 {
 	struct mmc_host	*host = card->host;
@@ -316,6 +570,16 @@ void mmc_add_card_debugfs(struct mmc_card *card)
 					&mmc_dbg_ext_csd_fops))
 			goto err;
 
+	if (mmc_card_mmc(card))
+		if (!debugfs_create_file("bkops_stats", S_IRUSR, root, card,
+					&mmc_bkops_stats_fops))
+			goto err;
+
+	if (mmc_card_mmc(card) || mmc_card_sd(card))
+		if (!debugfs_create_file("async_bench", S_IRUSR | S_IWUSR,
+					root, card, &mmc_bench_fops))
+			goto err;
+
 	return;
 
 err:
@@ -434,6 +434,18 @@ static int mmc_read_ext_csd(struct mmc_card *card, u8 *ext_csd)
 			card->ext_csd.bk_ops = 1;
 	}
 
+	if (card->ext_csd.rev >= 6) {
+		card->ext_csd.max_packed_writes =
+			ext_csd[EXT_CSD_MAX_PACKED_WRITES];
+		card->ext_csd.max_packed_reads =
+			ext_csd[EXT_CSD_MAX_PACKED_READS];
+		card->ext_csd.cache_size =
+			ext_csd[EXT_CSD_CACHE_SIZE + 0] << 0 |
+			ext_csd[EXT_CSD_CACHE_SIZE + 1] << 8 |
+			ext_csd[EXT_CSD_CACHE_SIZE + 2] << 16 |
+			ext_csd[EXT_CSD_CACHE_SIZE + 3] << 24;
+	}
+
 	if (ext_csd[EXT_CSD_ERASED_MEM_CONT])
 		card->erased_byte = 0xFF;
 	else
@@ -793,6 +805,48 @@ static int mmc_init_card(struct mmc_host *host, u32 ocr,
 		}
 	}
 
+	/*
+	 * If cache size is higher than 0, this indicates
+	 * the existence of cache and it can be turned on.
+	 */
+	if ((host->caps2 & MMC_CAP2_CACHE_CTRL) &&
+	    card->ext_csd.cache_size > 0) {
+		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+				 EXT_CSD_CACHE_CTRL, 1, 0);
+		if (err && err != -EBADMSG)
+			goto free_card;
+		if (err) {
+			pr_warning("%s: Cache is supported, "
+				   "but failed to turn on (%d)\n",
+				   mmc_hostname(card->host), err);
+			card->ext_csd.cache_ctrl = 0;
+			err = 0;
+		} else {
+			card->ext_csd.cache_ctrl = 1;
+		}
+	}
+
+	/*
+	 * The packed command failure index is reported through the
+	 * exception event status, so the event has to be enabled before
+	 * packed writes can be used.
+	 */
+	if (card->ext_csd.max_packed_writes && mmc_host_packed_wr(host) &&
+	    mmc_host_cmd23(host)) {
+		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+			EXT_CSD_EXP_EVENTS_CTRL, EXT_CSD_PACKED_EVENT_EN, 0);
+		if (err && err != -EBADMSG)
+			goto free_card;
+		if (err) {
+			pr_warning("%s: Enabling packed event failed\n",
+				   mmc_hostname(card->host));
+			card->ext_csd.packed_event_en = 0;
+			err = 0;
+		} else {
+			card->ext_csd.packed_event_en = 1;
+		}
+	}
+
 	/*
 	 * Compute bus speed.
 	 */
@@ -931,6 +985,7 @@ static void mmc_remove(struct mmc_host *host)
 	BUG_ON(!host);
 	BUG_ON(!host->card);
 
+	mmc_exit_bkops(host->card);
 	mmc_remove_card(host->card);
 	host->card = NULL;
 }
@@ -969,16 +1024,24 @@ static void mmc_detect(struct mmc_host *host)
  */
 static int mmc_suspend(struct mmc_host *host)
 {
+	int err;
+
 	BUG_ON(!host);
 	BUG_ON(!host->card);
 
 	mmc_claim_host(host);
+	/* Turning the cache off writes it back */
+	err = mmc_cache_ctrl(host, 0);
+	if (err)
+		goto out;
+
 	if (!mmc_host_is_spi(host))
 		mmc_deselect_cards(host);
 	host->card->state &= ~MMC_STATE_HIGHSPEED;
+out:
 	mmc_release_host(host);
 
-	return 0;
+	return err;
 }
 
 /*
@@ -1131,6 +1194,7 @@ int mmc_attach_mmc(struct mmc_host *host)
 		goto err;
 
 	mmc_release_host(host);
+	mmc_init_bkops(host->card);
 	err = mmc_add_card(host->card);
 	mmc_claim_host(host);
 	if (err)
@@ -1140,6 +1204,7 @@ int mmc_attach_mmc(struct mmc_host *host)
 
 remove_card:
 	mmc_release_host(host);
+	mmc_exit_bkops(host->card);
 	mmc_remove_card(host->card);
 	mmc_claim_host(host);
 	host->card = NULL;
@@ -334,6 +334,7 @@ int mmc_send_ext_csd(struct mmc_card *card, u8 *ext_csd)
 	return mmc_send_cxd_data(card, card->host, MMC_SEND_EXT_CSD,
 			ext_csd, 512);
 }
+EXPORT_SYMBOL_GPL(mmc_send_ext_csd);
 
 int mmc_spi_read_ocr(struct mmc_host *host, int highcap, u32 *ocrp)
 {
@@ -588,7 +589,7 @@ int mmc_send_bk_ops_cmd(struct mmc_card *card, bool is_synchronous)
 
 	cmd.opcode = MMC_SWITCH;
 	cmd.arg = (MMC_SWITCH_MODE_WRITE_BYTE << 24) |
-		(EXT_CSD_BKOPS_EN << 16) |
+		(EXT_CSD_BKOPS_START << 16) |
 		(1 << 8) |
 		EXT_CSD_CMD_SET_NORMAL;
 	if (is_synchronous)
@@ -600,14 +601,17 @@ int mmc_send_bk_ops_cmd(struct mmc_card *card, bool is_synchronous)
 	if (err)
 		return err;
 
-	/* Must check status to be sure of no errors */
+	/*
+	 * Must check status to be sure of no errors.  An asynchronous
+	 * start leaves the card in prg-state, to be ended by HPI.
+	 */
 	do {
 		err = mmc_send_status(card, &status);
 		if (err)
 			return err;
 		if (card->host->caps & MMC_CAP_WAIT_WHILE_BUSY)
 			break;
-	} while (R1_CURRENT_STATE(status) == 7);
+	} while (is_synchronous && R1_CURRENT_STATE(status) == 7);
 
 	if (status & 0xFDFFA000)
 		printk(KERN_ERR "%s: unexpected status %#x after "
@@ -26,10 +26,19 @@
 #include <linux/mmc/sd.h>
 #include <linux/regulator/consumer.h>
 #include <linux/delay.h>
-
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/bitmap.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include <mach/clk.h>
 #include <mach/gpio.h>
 #include <mach/sdhci.h>
 #include <mach/io_dpd.h>
+#include <mach/thermal.h>
 
 #include "sdhci-pltfm.h"
 #include <../gpio-names.h>
@@ -70,10 +79,23 @@
 #define SD_SEND_TUNING_PATTERN	19
 #define MAX_TAP_VALUES	256
 
+/* tuning results kept per host, and the width of their temperature bands */
+#define TUNING_CACHE_ENTRIES	8
+#define TUNING_TEMP_BAND_MC	20000
+
+/*
+ * Try the tap found for the same card clock, core voltage and
+ * temperature band before sweeping all of them again.  The sweep runs
+ * the tuning command 256 times, which SDIO and SD resume pay for.
+ */
+static bool cache_tuning = 1;
+module_param(cache_tuning, bool, 0644);
+
 static unsigned int tegra_sdhost_min_freq;
 static unsigned int tegra_sdhost_std_freq;
 static void tegra_3x_sdhci_set_card_clock(struct sdhci_host *sdhci, unsigned int clock);
 static void tegra3_sdhci_post_reset_init(struct sdhci_host *sdhci);
+static void sdhci_tegra_tuning_flush(struct sdhci_host *sdhci);
 
 static unsigned int tegra3_sdhost_max_clk[4] = {
 	208000000,	104000000,	208000000,	104000000 };
@@ -97,6 +119,14 @@ static struct tegra_sdhci_hw_ops tegra_3x_sdhci_ops = {
 };
 #endif
 
+struct tegra_tuning_entry {
+	unsigned int clock;	/* 0 for an empty entry */
+	int core_mv;
+	int temp_band;
+	u8 tap;
+	unsigned long used;	/* jiffies, the oldest entry is replaced */
+};
+
 struct tegra_sdhci_host {
 	bool	clk_enabled;
 	struct regulator *vdd_io_reg;
@@ -114,6 +144,15 @@ struct tegra_sdhci_host {
 	struct tegra_io_dpd *dpd;
 	bool card_present;
 	bool is_rail_enabled;
+	/* tuning results and their stats, under the sdhci lock */
+	struct tegra_tuning_entry tuning_cache[TUNING_CACHE_ENTRIES];
+	unsigned long tuning_hits;
+	unsigned long tuning_misses;	/* cached tap failed to verify */
+	unsigned long tuning_sweeps;
+	u64 tuning_hit_ns;
+	u64 tuning_sweep_ns;
+	u64 tuning_max_ns;
+	struct dentry *debugfs;
 };
 
 static u32 tegra_sdhci_readl(struct sdhci_host *host, int reg)
@@ -328,6 +367,8 @@ static irqreturn_t carddetect_irq(int irq, void *data)
 				regulator_disable(tegra_host->vdd_slot_reg);
 			tegra_host->is_rail_enabled = 0;
                 }
+		/* the next card needs its own taps */
+		sdhci_tegra_tuning_flush(sdhost);
 	}
 
 	tasklet_schedule(&sdhost->card_tasklet);
@@ -741,86 +782,159 @@ out:
 	return err;
 }
 
-static int sdhci_tegra_execute_tuning(struct sdhci_host *sdhci)
+/*
+ * Runs the tuning command at every tap and returns the tap 3/4 of the
+ * way into the widest window of passing ones.
+ */
+static unsigned int sdhci_tegra_sweep_taps(struct sdhci_host *sdhci)
 {
-	int err;
-	u16 ctrl_2;
-	u8 *tap_delay_status;
-	unsigned int i = 0;
-	unsigned int temp_low_pass_tap = 0;
-	unsigned int temp_pass_window = 0;
+	DECLARE_BITMAP(pass, MAX_TAP_VALUES);
+	unsigned int i, low_tap;
 	unsigned int best_low_pass_tap = 0;
 	unsigned int best_pass_window = 0;
 
-	/* Tuning is valid only in SDR104 and SDR50 modes */
-	ctrl_2 = sdhci_readw(sdhci, SDHCI_HOST_CONTROL2);
-	if (!(((ctrl_2 & SDHCI_CTRL_UHS_MASK) == SDHCI_CTRL_UHS_SDR104) ||
-		(((ctrl_2 & SDHCI_CTRL_UHS_MASK) == SDHCI_CTRL_UHS_SDR50) &&
-		(sdhci->flags & SDHCI_SDR50_NEEDS_TUNING))))
-			return 0;
-
-	tap_delay_status = kzalloc(MAX_TAP_VALUES, GFP_KERNEL);
-	if (tap_delay_status == NULL) {
-		dev_err(mmc_dev(sdhci->mmc), "failed to allocate memory"
-			"for storing tap_delay_status\n");
-		err = -ENOMEM;
-		goto out;
+	bitmap_zero(pass, MAX_TAP_VALUES);
+	for (i = 0; i < 0xFF; i++) {
+		sdhci_tegra_set_tap_delay(sdhci, i);
+		if (!sdhci_tegra_run_frequency_tuning(sdhci))
+			set_bit(i, pass);
 	}
 
-	/*
-	 * Set each tap delay value and run frequency tuning. After each
-	 * run, update the tap delay status as working or not working.
-	 */
-	do {
-		/* Set the tap delay */
-		sdhci_tegra_set_tap_delay(sdhci, i);
+	/* Find the best possible tap range */
+	for (i = 0; i < 0xFF; i++) {
+		if (!test_bit(i, pass))
+			continue;
+		low_tap = i;
+		while (i < 0xFF && test_bit(i, pass))
+			i++;
+		if ((i - low_tap > best_pass_window) && (i - low_tap > 1)) {
+			best_low_pass_tap = low_tap;
+			best_pass_window = i - low_tap;
+		}
+	}
 
-		/* Run frequency tuning */
-		err = sdhci_tegra_run_frequency_tuning(sdhci);
+	pr_debug("%s: best pass tap window: start %d, end %d\n",
+		mmc_hostname(sdhci->mmc), best_low_pass_tap,
+		(best_low_pass_tap + best_pass_window));
 
-		/* Update whether the tap delay worked or not */
-		tap_delay_status[i] = (err) ? 0: 1;
-		i++;
-	} while (i < 0xFF);
+	return best_low_pass_tap + ((best_pass_window * 3) / 4);
+}
 
-	/* Find the best possible tap range */
-	for (i = 0; i < 0xFF; i++) {
-		temp_pass_window = 0;
+/*
+ * The conditions a tap is valid for.  This runs under the sdhci lock,
+ * so the temperature is the thermal driver's last reading rather than a
+ * fresh one from the sensor.
+ */
+static void sdhci_tegra_tuning_key(struct sdhci_host *sdhci,
+	struct tegra_tuning_entry *key)
+{
+	long tj;
+
+	key->clock = sdhci->clock;
+	key->core_mv = tegra_dvfs_rail_get_millivolts("vdd_core");
+	if (tegra_thermal_get_last_tj(&tj))
+		key->temp_band = INT_MIN;
+	else
+		key->temp_band = tj / TUNING_TEMP_BAND_MC;
+}
 
-		/* Find the first passing tap in the current window */
-		if (tap_delay_status[i]) {
-			temp_low_pass_tap = i;
+static struct tegra_tuning_entry *sdhci_tegra_tuning_find(
+	struct tegra_sdhci_host *tegra_host, struct tegra_tuning_entry *key)
+{
+	struct tegra_tuning_entry *e;
+
+	for (e = tegra_host->tuning_cache;
+	     e < tegra_host->tuning_cache + TUNING_CACHE_ENTRIES; e++) {
+		if (e->clock && e->clock == key->clock &&
+		    e->core_mv == key->core_mv &&
+		    e->temp_band == key->temp_band)
+			return e;
+	}
+	return NULL;
+}
 
-			/* Find the pass window */
-			do {
-				temp_pass_window++;
-				i++;
-				if (i > 0xFF)
-					break;
-			} while (tap_delay_status[i]);
+static void sdhci_tegra_tuning_store(struct tegra_sdhci_host *tegra_host,
+	struct tegra_tuning_entry *key, unsigned int tap)
+{
+	struct tegra_tuning_entry *e, *victim = tegra_host->tuning_cache;
 
-			if ((temp_pass_window > best_pass_window) && (temp_pass_window > 1)){
-				best_low_pass_tap = temp_low_pass_tap;
-				best_pass_window = temp_pass_window;
-			}
+	for (e = tegra_host->tuning_cache;
+	     e < tegra_host->tuning_cache + TUNING_CACHE_ENTRIES; e++) {
+		if (!e->clock) {
+			victim = e;
+			break;
 		}
+		if (time_before(e->used, victim->used))
+			victim = e;
 	}
+	*victim = *key;
+	victim->tap = tap;
+	victim->used = jiffies;
+}
 
+static void sdhci_tegra_tuning_flush(struct sdhci_host *sdhci)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(sdhci);
+	struct tegra_sdhci_host *tegra_host = pltfm_host->priv;
+	unsigned long flags;
 
-	pr_debug("%s: best pass tap window: start %d, end %d\n",
-		mmc_hostname(sdhci->mmc), best_low_pass_tap,
-		(best_low_pass_tap + best_pass_window));
+	spin_lock_irqsave(&sdhci->lock, flags);
+	memset(tegra_host->tuning_cache, 0, sizeof(tegra_host->tuning_cache));
+	spin_unlock_irqrestore(&sdhci->lock, flags);
+}
 
-	/* Set the best tap */
-	sdhci_tegra_set_tap_delay(sdhci,
-		(best_low_pass_tap + ((best_pass_window * 3) / 4)));
+static int sdhci_tegra_execute_tuning(struct sdhci_host *sdhci)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(sdhci);
+	struct tegra_sdhci_host *tegra_host = pltfm_host->priv;
+	struct tegra_tuning_entry key, *cached;
+	ktime_t start = ktime_get();
+	unsigned int tap;
+	u64 ns;
+	int err;
+	u16 ctrl_2;
 
-	/* Run frequency tuning */
+	/* Tuning is valid only in SDR104 and SDR50 modes */
+	ctrl_2 = sdhci_readw(sdhci, SDHCI_HOST_CONTROL2);
+	if (!(((ctrl_2 & SDHCI_CTRL_UHS_MASK) == SDHCI_CTRL_UHS_SDR104) ||
+		(((ctrl_2 & SDHCI_CTRL_UHS_MASK) == SDHCI_CTRL_UHS_SDR50) &&
+		(sdhci->flags & SDHCI_SDR50_NEEDS_TUNING))))
+			return 0;
+
+	sdhci_tegra_tuning_key(sdhci, &key);
+	cached = cache_tuning ? sdhci_tegra_tuning_find(tegra_host, &key) :
+		NULL;
+	if (cached) {
+		/* A single tuning run at the cached tap verifies it */
+		sdhci_tegra_set_tap_delay(sdhci, cached->tap);
+		err = sdhci_tegra_run_frequency_tuning(sdhci);
+		if (!err) {
+			cached->used = jiffies;
+			ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+			tegra_host->tuning_hits++;
+			tegra_host->tuning_hit_ns += ns;
+			tegra_host->tuning_max_ns =
+				max(tegra_host->tuning_max_ns, ns);
+			return 0;
+		}
+		tegra_host->tuning_misses++;
+		cached->clock = 0;
+	}
+
+	/*
+	 * Set each tap delay value and run frequency tuning, then set the
+	 * best tap and run it once more.
+	 */
+	tap = sdhci_tegra_sweep_taps(sdhci);
+	sdhci_tegra_set_tap_delay(sdhci, tap);
 	err = sdhci_tegra_run_frequency_tuning(sdhci);
+	if (!err && cache_tuning)
+		sdhci_tegra_tuning_store(tegra_host, &key, tap);
 
-out:
-	if (tap_delay_status)
-		kfree(tap_delay_status);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	tegra_host->tuning_sweeps++;
+	tegra_host->tuning_sweep_ns += ns;
+	tegra_host->tuning_max_ns = max(tegra_host->tuning_max_ns, ns);
 
 	return err;
 }
@@ -954,6 +1068,116 @@ static struct sdhci_pltfm_data sdhci_tegra_pdata = {
 	.ops  = &tegra_sdhci_ops,
 };
 
+#ifdef CONFIG_DEBUG_FS
+
+static struct dentry *sdhci_tegra_debugfs_root;
+
+static int sdhci_tegra_tuning_show(struct seq_file *s, void *data)
+{
+	struct sdhci_host *sdhci = s->private;
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(sdhci);
+	struct tegra_sdhci_host *tegra_host = pltfm_host->priv;
+	struct tegra_tuning_entry cache[TUNING_CACHE_ENTRIES];
+	unsigned long hits, misses, sweeps;
+	u64 hit_ns, sweep_ns, max_ns;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&sdhci->lock, flags);
+	memcpy(cache, tegra_host->tuning_cache, sizeof(cache));
+	hits = tegra_host->tuning_hits;
+	misses = tegra_host->tuning_misses;
+	sweeps = tegra_host->tuning_sweeps;
+	hit_ns = tegra_host->tuning_hit_ns;
+	sweep_ns = tegra_host->tuning_sweep_ns;
+	max_ns = tegra_host->tuning_max_ns;
+	spin_unlock_irqrestore(&sdhci->lock, flags);
+
+	seq_printf(s, "cached hits %lu avg %llu us, verify failures %lu\n",
+		   hits, hits ? div_u64(div_u64(hit_ns, hits), NSEC_PER_USEC) : 0,
+		   misses);
+	seq_printf(s, "full sweeps %lu avg %llu us, max %llu us\n", sweeps,
+		   sweeps ? div_u64(div_u64(sweep_ns, sweeps), NSEC_PER_USEC) : 0,
+		   div_u64(max_ns, NSEC_PER_USEC));
+	for (i = 0; i < TUNING_CACHE_ENTRIES; i++) {
+		if (!cache[i].clock)
+			continue;
+		seq_printf(s, "%u Hz %d mV band %d: tap %u\n", cache[i].clock,
+			   cache[i].core_mv, cache[i].temp_band, cache[i].tap);
+	}
+	return 0;
+}
+
+/* any write clears the stats and the cached taps */
+static ssize_t sdhci_tegra_tuning_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct sdhci_host *sdhci = s->private;
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(sdhci);
+	struct tegra_sdhci_host *tegra_host = pltfm_host->priv;
+	unsigned long flags;
+
+	sdhci_tegra_tuning_flush(sdhci);
+	spin_lock_irqsave(&sdhci->lock, flags);
+	tegra_host->tuning_hits = 0;
+	tegra_host->tuning_misses = 0;
+	tegra_host->tuning_sweeps = 0;
+	tegra_host->tuning_hit_ns = 0;
+	tegra_host->tuning_sweep_ns = 0;
+	tegra_host->tuning_max_ns = 0;
+	spin_unlock_irqrestore(&sdhci->lock, flags);
+	return count;
+}
+
+static int sdhci_tegra_tuning_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sdhci_tegra_tuning_show, inode->i_private);
+}
+
+static const struct file_operations sdhci_tegra_tuning_fops = {
+	.open		= sdhci_tegra_tuning_open,
+	.read		= seq_read,
+	.write		= sdhci_tegra_tuning_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void sdhci_tegra_debugfs_add(struct sdhci_host *sdhci)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(sdhci);
+	struct tegra_sdhci_host *tegra_host = pltfm_host->priv;
+
+	if (!sdhci_tegra_debugfs_root)
+		sdhci_tegra_debugfs_root = debugfs_create_dir("sdhci_tegra",
+							      NULL);
+	if (!sdhci_tegra_debugfs_root)
+		return;
+	tegra_host->debugfs = debugfs_create_file(
+		dev_name(mmc_dev(sdhci->mmc)), S_IRUGO | S_IWUSR,
+		sdhci_tegra_debugfs_root, sdhci, &sdhci_tegra_tuning_fops);
+}
+
+static void sdhci_tegra_debugfs_remove(struct sdhci_host *sdhci)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(sdhci);
+	struct tegra_sdhci_host *tegra_host = pltfm_host->priv;
+
+	debugfs_remove(tegra_host->debugfs);
+}
+
+#else
+
+static inline void sdhci_tegra_debugfs_add(struct sdhci_host *sdhci)
+{
+}
+
+static inline void sdhci_tegra_debugfs_remove(struct sdhci_host *sdhci)
+{
+}
+
+#endif
+
 static int __devinit sdhci_tegra_probe(struct platform_device *pdev)
 {
 	struct sdhci_pltfm_host *pltfm_host;
@@ -1143,12 +1367,21 @@ static int __devinit sdhci_tegra_probe(struct platform_device *pdev)
 #else
 	tegra_host->hw_ops = &tegra_3x_sdhci_ops;
 	tegra_sdhost_std_freq = TEGRA3_SDHOST_STD_FREQ;
+	/*
+	 * eMMC 4.5 parts can take packed writes through Auto-CMD23, and
+	 * the built-in part gets its cache and background ops managed.
+	 */
+	if (plat->mmc_data.built_in) {
+		host->mmc->caps |= MMC_CAP_CMD23 | MMC_CAP_BKOPS;
+		host->mmc->caps2 |= MMC_CAP2_PACKED_WR | MMC_CAP2_CACHE_CTRL;
+	}
 #endif
 
 	rc = sdhci_add_host(host);
 	if (rc)
 		goto err_add_host;
 
+	sdhci_tegra_debugfs_add(host);
 	return 0;
 
 err_add_host:
@@ -1189,6 +1422,7 @@ static int __devexit sdhci_tegra_remove(struct platform_device *pdev)
 	struct tegra_sdhci_platform_data *plat;
 	int dead = (readl(host->ioaddr + SDHCI_INT_STATUS) == 0xffffffff);
 
+	sdhci_tegra_debugfs_remove(host);
 	sdhci_remove_host(host, dead);
 
 	plat = pdev->dev.platform_data;
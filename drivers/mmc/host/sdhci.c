@@ -43,12 +43,35 @@
 
 static unsigned int debug_quirks = 0;
 
+/*
+ * Every sdhci interrupt lands on the boot CPU.  When finish_cpu names an
+ * online CPU, requests are finished there from a workqueue rather than in
+ * a tasklet, which then also becomes where mmcqd is woken.
+ */
+static int finish_cpu = -1;
+module_param(finish_cpu, int, 0644);
+MODULE_PARM_DESC(finish_cpu, "CPU to finish requests on, -1 for the one interrupted");
+
+static struct workqueue_struct *sdhci_finish_wq;
+
 static void sdhci_finish_data(struct sdhci_host *);
 
 static void sdhci_send_command(struct sdhci_host *, struct mmc_command *);
 static void sdhci_finish_command(struct sdhci_host *);
 static int sdhci_execute_tuning(struct mmc_host *mmc);
 static void sdhci_tuning_timer(unsigned long data);
+static void sdhci_tasklet_finish(unsigned long param);
+
+/* Called with interrupts or preemption off, so finish_cpu stays online */
+static void sdhci_schedule_finish(struct sdhci_host *host)
+{
+	int cpu = finish_cpu;
+
+	if (sdhci_finish_wq && cpu >= 0 && cpu < nr_cpu_ids && cpu_online(cpu))
+		queue_work_on(cpu, sdhci_finish_wq, &host->finish_work);
+	else
+		tasklet_schedule(&host->finish_tasklet);
+}
 
 static void sdhci_dumpregs(struct sdhci_host *host)
 {
@@ -425,7 +448,7 @@ static void sdhci_set_adma_desc(u8 *desc, u32 addr, int len, unsigned cmd)
 }
 
 static int sdhci_adma_table_pre(struct sdhci_host *host,
-	struct mmc_data *data)
+	struct mmc_data *data, struct sdhci_adma_table *table)
 {
 	int direction;
 
@@ -455,23 +478,23 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 	 * need to fill it with data first.
 	 */
 
-	host->align_addr = dma_map_single(mmc_dev(host->mmc),
-		host->align_buffer, 128 * 4, direction);
-	if (dma_mapping_error(mmc_dev(host->mmc), host->align_addr))
+	table->align_addr = dma_map_single(mmc_dev(host->mmc),
+		table->align_buffer, 128 * 4, direction);
+	if (dma_mapping_error(mmc_dev(host->mmc), table->align_addr))
 		goto fail;
-	BUG_ON(host->align_addr & 0x3);
+	BUG_ON(table->align_addr & 0x3);
 
-	host->sg_count = dma_map_sg(mmc_dev(host->mmc),
+	table->sg_count = dma_map_sg(mmc_dev(host->mmc),
 		data->sg, data->sg_len, direction);
-	if (host->sg_count == 0)
+	if (table->sg_count == 0)
 		goto unmap_align;
 
-	desc = host->adma_desc;
-	align = host->align_buffer;
+	desc = table->desc;
+	align = table->align_buffer;
 
-	align_addr = host->align_addr;
+	align_addr = table->align_addr;
 
-	for_each_sg(data->sg, sg, host->sg_count, i) {
+	for_each_sg(data->sg, sg, table->sg_count, i) {
 		addr = sg_dma_address(sg);
 		len = sg_dma_len(sg);
 
@@ -515,14 +538,14 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 		 * If this triggers then we have a calculation bug
 		 * somewhere. :/
 		 */
-		WARN_ON((desc - host->adma_desc) > (128 * 2 + 1) * 4);
+		WARN_ON((desc - table->desc) > (128 * 2 + 1) * 4);
 	}
 
 	if (host->quirks & SDHCI_QUIRK_NO_ENDATTR_IN_NOPDESC) {
 		/*
 		* Mark the last descriptor as the terminating descriptor
 		*/
-		if (desc != host->adma_desc) {
+		if (desc != table->desc) {
 			desc -= 8;
 			desc[0] |= 0x2; /* end */
 		}
@@ -540,14 +563,14 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 	 */
 	if (data->flags & MMC_DATA_WRITE) {
 		dma_sync_single_for_device(mmc_dev(host->mmc),
-			host->align_addr, 128 * 4, direction);
+			table->align_addr, 128 * 4, direction);
 	}
 
-	host->adma_addr = dma_map_single(mmc_dev(host->mmc),
-		host->adma_desc, (128 * 2 + 1) * 4, DMA_TO_DEVICE);
-	if (dma_mapping_error(mmc_dev(host->mmc), host->adma_addr))
+	table->desc_addr = dma_map_single(mmc_dev(host->mmc),
+		table->desc, (128 * 2 + 1) * 4, DMA_TO_DEVICE);
+	if (dma_mapping_error(mmc_dev(host->mmc), table->desc_addr))
 		goto unmap_entries;
-	BUG_ON(host->adma_addr & 0x3);
+	BUG_ON(table->desc_addr & 0x3);
 
 	return 0;
 
@@ -555,14 +578,14 @@ unmap_entries:
 	dma_unmap_sg(mmc_dev(host->mmc), data->sg,
 		data->sg_len, direction);
 unmap_align:
-	dma_unmap_single(mmc_dev(host->mmc), host->align_addr,
+	dma_unmap_single(mmc_dev(host->mmc), table->align_addr,
 		128 * 4, direction);
 fail:
 	return -EINVAL;
 }
 
 static void sdhci_adma_table_post(struct sdhci_host *host,
-	struct mmc_data *data)
+	struct mmc_data *data, struct sdhci_adma_table *table)
 {
 	int direction;
 
@@ -577,19 +600,19 @@ static void sdhci_adma_table_post(struct sdhci_host *host,
 	else
 		direction = DMA_TO_DEVICE;
 
-	dma_unmap_single(mmc_dev(host->mmc), host->adma_addr,
+	dma_unmap_single(mmc_dev(host->mmc), table->desc_addr,
 		(128 * 2 + 1) * 4, DMA_TO_DEVICE);
 
-	dma_unmap_single(mmc_dev(host->mmc), host->align_addr,
+	dma_unmap_single(mmc_dev(host->mmc), table->align_addr,
 		128 * 4, direction);
 
 	if (data->flags & MMC_DATA_READ) {
 		dma_sync_sg_for_cpu(mmc_dev(host->mmc), data->sg,
 			data->sg_len, direction);
 
-		align = host->align_buffer;
+		align = table->align_buffer;
 
-		for_each_sg(data->sg, sg, host->sg_count, i) {
+		for_each_sg(data->sg, sg, table->sg_count, i) {
 			if (sg_dma_address(sg) & 0x3) {
 				size = 4 - (sg_dma_address(sg) & 0x3);
 
@@ -607,6 +630,39 @@ static void sdhci_adma_table_post(struct sdhci_host *host,
 		data->sg_len, direction);
 }
 
+static void sdhci_free_adma_tables(struct sdhci_host *host)
+{
+	int i;
+
+	for (i = 0; i < SDHCI_ADMA_TABLES; i++) {
+		kfree(host->adma[i].desc);
+		kfree(host->adma[i].align_buffer);
+
+		host->adma[i].desc = NULL;
+		host->adma[i].align_buffer = NULL;
+	}
+}
+
+/*
+ * Same test sdhci_prepare_data() uses to revert an ADMA request to
+ * PIO; there is no point in preparing a table for those.
+ */
+static bool sdhci_adma_ok(struct sdhci_host *host, struct mmc_data *data)
+{
+	struct scatterlist *sg;
+	int i;
+
+	if (!(host->quirks & SDHCI_QUIRK_32BIT_ADMA_SIZE))
+		return true;
+
+	for_each_sg(data->sg, sg, data->sg_len, i) {
+		if ((sg->length & 0x3) || (sg->offset & 0x3))
+			return false;
+	}
+
+	return true;
+}
+
 static u8 sdhci_calc_timeout(struct sdhci_host *host, struct mmc_command *cmd)
 {
 	u8 count;
@@ -769,7 +825,12 @@ static void sdhci_prepare_data(struct sdhci_host *host, struct mmc_command *cmd)
 
 	if (host->flags & SDHCI_REQ_USE_DMA) {
 		if (host->flags & SDHCI_USE_ADMA) {
-			ret = sdhci_adma_table_pre(host, data);
+			host->adma_cur = &host->adma[data->host_cookie];
+			if (data->host_cookie)
+				ret = 0;
+			else
+				ret = sdhci_adma_table_pre(host, data,
+							   host->adma_cur);
 			if (ret) {
 				/*
 				 * This only happens when someone fed
@@ -778,7 +839,7 @@ static void sdhci_prepare_data(struct sdhci_host *host, struct mmc_command *cmd)
 				WARN_ON(1);
 				host->flags &= ~SDHCI_REQ_USE_DMA;
 			} else {
-				sdhci_writel(host, host->adma_addr,
+				sdhci_writel(host, host->adma_cur->desc_addr,
 					SDHCI_ADMA_ADDRESS);
 			}
 		} else {
@@ -884,9 +945,12 @@ static void sdhci_finish_data(struct sdhci_host *host)
 	host->data = NULL;
 
 	if (host->flags & SDHCI_REQ_USE_DMA) {
-		if (host->flags & SDHCI_USE_ADMA)
-			sdhci_adma_table_post(host, data);
-		else {
+		if (host->flags & SDHCI_USE_ADMA) {
+			/* Prepared tables are released in post_req */
+			if (!data->host_cookie)
+				sdhci_adma_table_post(host, data,
+						      host->adma_cur);
+		} else {
 			dma_unmap_sg(mmc_dev(host->mmc), data->sg,
 				data->sg_len, (data->flags & MMC_DATA_READ) ?
 					DMA_FROM_DEVICE : DMA_TO_DEVICE);
@@ -925,7 +989,7 @@ static void sdhci_finish_data(struct sdhci_host *host)
 
 		sdhci_send_command(host, data->stop);
 	} else
-		tasklet_schedule(&host->finish_tasklet);
+		sdhci_schedule_finish(host);
 }
 
 static void sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
@@ -954,7 +1018,7 @@ static void sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
 				"inhibit bit(s).\n", mmc_hostname(host->mmc));
 			sdhci_dumpregs(host);
 			cmd->error = -EIO;
-			tasklet_schedule(&host->finish_tasklet);
+			sdhci_schedule_finish(host);
 			return;
 		}
 		timeout--;
@@ -975,7 +1039,7 @@ static void sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
 		printk(KERN_ERR "%s: Unsupported response type!\n",
 			mmc_hostname(host->mmc));
 		cmd->error = -EINVAL;
-		tasklet_schedule(&host->finish_tasklet);
+		sdhci_schedule_finish(host);
 		return;
 	}
 
@@ -1035,7 +1099,7 @@ static void sdhci_finish_command(struct sdhci_host *host)
 			sdhci_finish_data(host);
 
 		if (!host->cmd->data)
-			tasklet_schedule(&host->finish_tasklet);
+			sdhci_schedule_finish(host);
 
 		host->cmd = NULL;
 	}
@@ -1199,6 +1263,58 @@ static void sdhci_set_power(struct sdhci_host *host, unsigned short power)
  *                                                                           *
 \*****************************************************************************/
 
+/*
+ * Map the scatterlist and build the ADMA table for a request while the
+ * previous one is still running, so that sdhci_request() only has to
+ * point the controller at it. data->host_cookie holds the index of the
+ * table used; 0 means nothing was prepared and the request goes through
+ * table 0 at issue time.
+ */
+static void sdhci_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			  bool is_first_req)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+	int i;
+
+	if (!data)
+		return;
+
+	data->host_cookie = 0;
+
+	if (!(host->flags & SDHCI_USE_ADMA) || !sdhci_adma_ok(host, data))
+		return;
+
+	for (i = 1; i < SDHCI_ADMA_TABLES; i++)
+		if (!test_and_set_bit(i, &host->adma_busy))
+			break;
+	if (i == SDHCI_ADMA_TABLES)
+		return;
+
+	if (sdhci_adma_table_pre(host, data, &host->adma[i])) {
+		clear_bit(i, &host->adma_busy);
+		return;
+	}
+
+	data->host_cookie = i;
+}
+
+static void sdhci_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			   int err)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+	int i;
+
+	if (!data || !data->host_cookie)
+		return;
+
+	i = data->host_cookie;
+	sdhci_adma_table_post(host, data, &host->adma[i]);
+	clear_bit(i, &host->adma_busy);
+	data->host_cookie = 0;
+}
+
 static void sdhci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 {
 	struct sdhci_host *host;
@@ -1241,7 +1357,7 @@ static void sdhci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 
 	if (!present || host->flags & SDHCI_DEVICE_DEAD) {
 		host->mrq->cmd->error = -ENOMEDIUM;
-		tasklet_schedule(&host->finish_tasklet);
+		sdhci_schedule_finish(host);
 	} else {
 		u32 present_state;
 
@@ -1878,6 +1994,8 @@ int sdhci_disable(struct mmc_host *mmc, int lazy)
 }
 
 static const struct mmc_host_ops sdhci_ops = {
+	.pre_req	= sdhci_pre_req,
+	.post_req	= sdhci_post_req,
 	.request	= sdhci_request,
 	.set_ios	= sdhci_set_ios,
 	.get_ro		= sdhci_get_ro,
@@ -1915,7 +2033,7 @@ static void sdhci_tasklet_card(unsigned long param)
 			sdhci_reset(host, SDHCI_RESET_DATA);
 
 			host->mrq->cmd->error = -ENOMEDIUM;
-			tasklet_schedule(&host->finish_tasklet);
+			sdhci_schedule_finish(host);
 		}
 	}
 
@@ -1924,6 +2042,14 @@ static void sdhci_tasklet_card(unsigned long param)
 	mmc_detect_change(host->mmc, msecs_to_jiffies(200));
 }
 
+static void sdhci_finish_work(struct work_struct *work)
+{
+	struct sdhci_host *host = container_of(work, struct sdhci_host,
+					       finish_work);
+
+	sdhci_tasklet_finish((unsigned long)host);
+}
+
 static void sdhci_tasklet_finish(unsigned long param)
 {
 	struct sdhci_host *host;
@@ -2010,7 +2136,7 @@ static void sdhci_timeout_timer(unsigned long data)
 			else
 				host->mrq->cmd->error = -ETIMEDOUT;
 
-			tasklet_schedule(&host->finish_tasklet);
+			sdhci_schedule_finish(host);
 		}
 	}
 
@@ -2057,7 +2183,7 @@ static void sdhci_cmd_irq(struct sdhci_host *host, u32 intmask)
 		host->cmd->error = -EILSEQ;
 
 	if (host->cmd->error) {
-		tasklet_schedule(&host->finish_tasklet);
+		sdhci_schedule_finish(host);
 		return;
 	}
 
@@ -2091,7 +2217,7 @@ static void sdhci_cmd_irq(struct sdhci_host *host, u32 intmask)
 static void sdhci_show_adma_error(struct sdhci_host *host)
 {
 	const char *name = mmc_hostname(host->mmc);
-	u8 *desc = host->adma_desc;
+	u8 *desc = host->adma_cur->desc;
 	__le32 *dma;
 	__le16 *len;
 	u8 attr;
@@ -2526,11 +2652,19 @@ int sdhci_add_host(struct sdhci_host *host)
 		 * (128) and potentially one alignment transfer for
 		 * each of those entries.
 		 */
-		host->adma_desc = kmalloc((128 * 2 + 1) * 4, GFP_KERNEL);
-		host->align_buffer = kmalloc(128 * 4, GFP_KERNEL);
-		if (!host->adma_desc || !host->align_buffer) {
-			kfree(host->adma_desc);
-			kfree(host->align_buffer);
+		bool failed = false;
+		int i;
+
+		for (i = 0; i < SDHCI_ADMA_TABLES; i++) {
+			struct sdhci_adma_table *table = &host->adma[i];
+
+			table->desc = kmalloc((128 * 2 + 1) * 4, GFP_KERNEL);
+			table->align_buffer = kmalloc(128 * 4, GFP_KERNEL);
+			if (!table->desc || !table->align_buffer)
+				failed = true;
+		}
+		if (failed) {
+			sdhci_free_adma_tables(host);
 			printk(KERN_WARNING "%s: Unable to allocate ADMA "
 				"buffers. Falling back to standard DMA.\n",
 				mmc_hostname(mmc));
@@ -2833,6 +2967,7 @@ int sdhci_add_host(struct sdhci_host *host)
 		sdhci_tasklet_card, (unsigned long)host);
 	tasklet_init(&host->finish_tasklet,
 		sdhci_tasklet_finish, (unsigned long)host);
+	INIT_WORK(&host->finish_work, sdhci_finish_work);
 
 	setup_timer(&host->timer, sdhci_timeout_timer, (unsigned long)host);
 
@@ -2904,6 +3039,7 @@ reset:
 untasklet:
 	tasklet_kill(&host->card_tasklet);
 	tasklet_kill(&host->finish_tasklet);
+	cancel_work_sync(&host->finish_work);
 
 	return ret;
 }
@@ -2924,7 +3060,7 @@ void sdhci_remove_host(struct sdhci_host *host, int dead)
 				" transfer!\n", mmc_hostname(host->mmc));
 
 			host->mrq->cmd->error = -ENOMEDIUM;
-			tasklet_schedule(&host->finish_tasklet);
+			sdhci_schedule_finish(host);
 		}
 
 		spin_unlock_irqrestore(&host->lock, flags);
@@ -2949,17 +3085,14 @@ void sdhci_remove_host(struct sdhci_host *host, int dead)
 
 	tasklet_kill(&host->card_tasklet);
 	tasklet_kill(&host->finish_tasklet);
+	cancel_work_sync(&host->finish_work);
 
 	if (host->vmmc) {
 		regulator_disable(host->vmmc);
 		regulator_put(host->vmmc);
 	}
 
-	kfree(host->adma_desc);
-	kfree(host->align_buffer);
-
-	host->adma_desc = NULL;
-	host->align_buffer = NULL;
+	sdhci_free_adma_tables(host);
 }
 
 EXPORT_SYMBOL_GPL(sdhci_remove_host);
@@ -2983,11 +3116,15 @@ static int __init sdhci_drv_init(void)
 		": Secure Digital Host Controller Interface driver\n");
 	printk(KERN_INFO DRIVER_NAME ": Copyright(c) Pierre Ossman\n");
 
+	sdhci_finish_wq = alloc_workqueue("sdhci_finish",
+					  WQ_HIGHPRI | WQ_MEM_RECLAIM, 0);
 	return 0;
 }
 
 static void __exit sdhci_drv_exit(void)
 {
+	if (sdhci_finish_wq)
+		destroy_workqueue(sdhci_finish_wq);
 }
 
 module_init(sdhci_drv_init);
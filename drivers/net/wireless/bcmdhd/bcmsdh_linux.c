@@ -43,6 +43,7 @@
 
 #if defined(OOB_INTR_ONLY)
 #include <linux/irq.h>
+#include <linux/wakeup_reason.h>
 extern void dhdsdio_isr(void * args);
 #include <bcmutils.h>
 #include <dngl_stats.h>
@@ -592,6 +593,10 @@ static irqreturn_t wlan_oob_irq(int irq, void *dev_id)
 		return IRQ_HANDLED;
 	}
 
+	/* First interrupt after a resume this irq caused */
+	if (wakeup_reason_claim(irq))
+		dhd_os_wake_irq(dhdp);
+
 	dhdsdio_isr((void *)dhdp->bus);
 
 	return IRQ_HANDLED;
@@ -683,6 +688,9 @@ module_param(sd_hiok, uint, 0);
 extern uint sd_f2_blocksize;
 module_param(sd_f2_blocksize, int, 0);
 
+extern uint sd_rxchain;	/* Read glom superframes straight into the packet chain */
+module_param(sd_rxchain, uint, 0);
+
 #ifdef BCMSDIOH_STD
 extern int sd_uhsimode;
 module_param(sd_uhsimode, int, 0);
@@ -72,6 +72,7 @@ uint sd_clock = 1;		/* Default to SD Clock turned ON */
 uint sd_hiok = FALSE;	/* Don't use hi-speed mode by default */
 uint sd_msglevel = 0x01;
 uint sd_use_dma = TRUE;
+uint sd_rxchain = FALSE;	/* Read packet chains with one scatter-gather CMD53 */
 DHD_PM_RESUME_WAIT_INIT(sdioh_request_byte_wait);
 DHD_PM_RESUME_WAIT_INIT(sdioh_request_word_wait);
 DHD_PM_RESUME_WAIT_INIT(sdioh_request_packet_wait);
@@ -149,7 +150,7 @@ sdioh_attach(osl_t *osh, void *bar0, uint irq)
 	sd->sd_blockmode = TRUE;
 	sd->use_client_ints = TRUE;
 	sd->client_block_size[0] = 64;
-	sd->use_rxchain = FALSE;
+	sd->use_rxchain = (bool)sd_rxchain;
 
 	gInstance->sd = sd;
 
@@ -383,7 +384,8 @@ enum {
 	IOV_HCIREGS,
 	IOV_POWER,
 	IOV_CLOCK,
-	IOV_RXCHAIN
+	IOV_RXCHAIN,
+	IOV_BOUNCE
 };
 
 const bcm_iovar_t sdioh_iovars[] = {
@@ -402,6 +404,7 @@ const bcm_iovar_t sdioh_iovars[] = {
 	{"sd_mode", 	IOV_SDMODE, 	0,	IOVT_UINT32,	100},
 	{"sd_highspeed", IOV_HISPEED,	0,	IOVT_UINT32,	0 },
 	{"sd_rxchain",  IOV_RXCHAIN,    0, 	IOVT_BOOL,	0 },
+	{"sd_bounce",	IOV_BOUNCE,	0,	IOVT_UINT32,	0 },
 	{NULL, 0, 0, 0, 0 }
 };
 
@@ -518,6 +521,11 @@ sdioh_iovar_op(sdioh_info_t *si, const char *name,
 		bcopy(&int_val, arg, val_size);
 		break;
 
+	case IOV_GVAL(IOV_BOUNCE):
+		int_val = (int32)si->bounce_copies;
+		bcopy(&int_val, arg, val_size);
+		break;
+
 	case IOV_GVAL(IOV_DMA):
 		int_val = (int32)si->sd_use_dma;
 		bcopy(&int_val, arg, val_size);
@@ -1131,6 +1139,7 @@ sdioh_request_buffer(sdioh_info_t *sd, uint pio_dma, uint fix_inc, uint write, u
 
 		/* In this case, we cannot have a chain. */
 		ASSERT(PKTNEXT(sd->osh, pkt) == NULL);
+		sd->bounce_copies++;
 
 		sd_data(("%s: Creating aligned %s Packet, len=%d\n",
 		         __FUNCTION__, write ? "TX" : "RX", PKTLEN(sd->osh, pkt)));
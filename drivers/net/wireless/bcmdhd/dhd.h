@@ -148,6 +148,20 @@ void dhd_os_prefree(void *osh, void *addr, uint size);
 #define DHD_SDALIGN	32
 #endif
 
+/* NAPI receive batch histogram: 1, 2-3, 4-7, ... 64 and up */
+#define DHD_RX_BATCH_BINS	7
+
+/* Host wakes from the WLAN host-wake irq, by the first frame that followed */
+#define DHD_WAKE_EVENT		0	/* dongle event */
+#define DHD_WAKE_IPV4		1	/* unicast IPv4 */
+#define DHD_WAKE_ARP		2
+#define DHD_WAKE_ND		3	/* ICMPv6 neighbour discovery */
+#define DHD_WAKE_IPV6		4	/* other unicast IPv6 */
+#define DHD_WAKE_MCAST		5	/* broadcast or multicast */
+#define DHD_WAKE_OTHER		6
+#define DHD_WAKE_TYPES		7
+#define DHD_WAKE_NONE		DHD_WAKE_TYPES	/* no frame within the window */
+
 /* Common structure for module and instance linkage */
 typedef struct dhd_pub {
 	/* Linkage ponters */
@@ -191,6 +205,13 @@ typedef struct dhd_pub {
 	ulong rx_readahead_cnt;	/* Number of packets where header read-ahead was used. */
 	ulong tx_realloc;	/* Number of tx packets we had to realloc for headroom */
 	ulong fc_packets;       /* Number of flow control pkts recvd */
+	ulong rx_napi_polls;	/* NAPI polls that delivered packets */
+	ulong rx_napi_batch[DHD_RX_BATCH_BINS];	/* Polls by log2 of packets delivered */
+	ulong rxf_full;		/* Times the DPC waited on a full rxf ring */
+	ulong rx_wake;		/* Resumes caused by the WLAN host-wake irq */
+	ulong rx_wake_type[DHD_WAKE_TYPES + 1];	/* Those wakes by DHD_WAKE_* */
+	ulong wake_jiffies;	/* When the last wake was claimed */
+	bool wake_pending;	/* Next frame is the cause of that wake */
 
 	/* Last error return */
 	int bcmerror;
@@ -429,6 +450,9 @@ extern void * dhd_os_open_image(char * filename);
 extern int dhd_os_get_image_block(char * buf, int len, void * image);
 extern void dhd_os_close_image(void * image);
 extern void dhd_os_wd_timer(void *bus, uint wdtick);
+extern uint32 dhd_os_time_usec(void);
+extern void dhd_os_txhold_timer(dhd_pub_t *pub, uint msec);
+extern void dhd_os_wake_irq(dhd_pub_t *pub);
 extern void dhd_os_sdlock(dhd_pub_t * pub);
 extern void dhd_os_sdunlock(dhd_pub_t * pub);
 extern void dhd_os_sdlock_txq(dhd_pub_t * pub);
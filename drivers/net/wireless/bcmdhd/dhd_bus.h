@@ -56,6 +56,9 @@ extern void dhd_bus_setidletime(dhd_pub_t *dhdp, int idle_time);
 /* Send a data frame to the dongle.  Callee disposes of txp. */
 extern int dhd_bus_txdata(struct dhd_bus *bus, void *txp);
 
+/* Send the data frames held back by screen-off tx coalescing */
+extern void dhd_bus_txhold_flush(struct dhd_bus *bus);
+
 /* Send/receive a control message to/from the dongle.
  * Expects caller to enforce a single outstanding transaction.
  */
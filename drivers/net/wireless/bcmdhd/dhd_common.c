@@ -229,6 +229,7 @@ static int
 dhd_dump(dhd_pub_t *dhdp, char *buf, int buflen)
 {
 	char eabuf[ETHER_ADDR_STR_LEN];
+	int i;
 
 	struct bcmstrbuf b;
 	struct bcmstrbuf *strbuf = &b;
@@ -266,6 +267,17 @@ dhd_dump(dhd_pub_t *dhdp, char *buf, int buflen)
 	            dhdp->rx_ctlpkts, dhdp->rx_ctlerrs, dhdp->rx_dropped);
 	bcm_bprintf(strbuf, "rx_readahead_cnt %ld tx_realloc %ld\n",
 	            dhdp->rx_readahead_cnt, dhdp->tx_realloc);
+	bcm_bprintf(strbuf, "rx_napi_polls %ld batch", dhdp->rx_napi_polls);
+	for (i = 0; i < DHD_RX_BATCH_BINS; i++)
+		bcm_bprintf(strbuf, " %d+:%ld", 1 << i, dhdp->rx_napi_batch[i]);
+	bcm_bprintf(strbuf, "\n");
+	bcm_bprintf(strbuf, "rxf_full %ld\n", dhdp->rxf_full);
+	bcm_bprintf(strbuf, "rx_wake %ld event %ld ipv4 %ld arp %ld nd %ld ipv6 %ld"
+	            " mcast %ld other %ld none %ld\n", dhdp->rx_wake,
+	            dhdp->rx_wake_type[DHD_WAKE_EVENT], dhdp->rx_wake_type[DHD_WAKE_IPV4],
+	            dhdp->rx_wake_type[DHD_WAKE_ARP], dhdp->rx_wake_type[DHD_WAKE_ND],
+	            dhdp->rx_wake_type[DHD_WAKE_IPV6], dhdp->rx_wake_type[DHD_WAKE_MCAST],
+	            dhdp->rx_wake_type[DHD_WAKE_OTHER], dhdp->rx_wake_type[DHD_WAKE_NONE]);
 	bcm_bprintf(strbuf, "\n");
 
 	/* Add any prot info */
@@ -394,6 +406,11 @@ dhd_doiovar(dhd_pub_t *dhd_pub, const bcm_iovar_t *vi, uint32 actionid, const ch
 		dhd_pub->rx_readahead_cnt = 0;
 		dhd_pub->tx_realloc = 0;
 		dhd_pub->wd_dpc_sched = 0;
+		dhd_pub->rx_napi_polls = 0;
+		memset(dhd_pub->rx_napi_batch, 0, sizeof(dhd_pub->rx_napi_batch));
+		dhd_pub->rxf_full = 0;
+		dhd_pub->rx_wake = 0;
+		memset(dhd_pub->rx_wake_type, 0, sizeof(dhd_pub->rx_wake_type));
 		memset(&dhd_pub->dstats, 0, sizeof(dhd_pub->dstats));
 		dhd_bus_clearcounts(dhd_pub);
 #ifdef PROP_TXSTATUS
@@ -42,6 +42,7 @@
 #include <linux/ethtool.h>
 #include <linux/fcntl.h>
 #include <linux/fs.h>
+#include <linux/delay.h>
 
 #include <asm/uaccess.h>
 #include <asm/unaligned.h>
@@ -52,6 +53,7 @@
 #include <bcmdevs.h>
 
 #include <proto/ethernet.h>
+#include <proto/bcmip.h>
 #include <dngl_stats.h>
 #include <dhd.h>
 #include <dhd_bus.h>
@@ -70,6 +72,13 @@
 
 #define DYNAMIC_DTIM_SKIP 1
 
+#define DHD_RXF_RING	256	/* frames in flight to the rxf thread, power of 2 */
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 29))
+#define DHD_RX_NAPI	1
+#define DHD_RX_NAPI_WEIGHT	64
+#endif
+
 #ifdef WLMEDIA_HTSF
 #include <linux/time.h>
 #include <htsf.h>
@@ -236,6 +245,7 @@ typedef struct dhd_info {
 	wait_queue_head_t ioctl_resp_wait;
 	struct timer_list timer;
 	bool wd_timer_valid;
+	struct timer_list txhold_timer;	/* Deadline for held tx frames */
 	struct tasklet_struct tasklet;
 	spinlock_t	sdlock;
 	spinlock_t	txqlock;
@@ -248,6 +258,12 @@ typedef struct dhd_info {
 	tsk_ctl_t	thr_dpc_ctl;
 	tsk_ctl_t	thr_wdt_ctl;
 
+	/* RX frame thread, fed by the DPC through a single-producer ring */
+	tsk_ctl_t	thr_rxf_ctl;
+	struct sk_buff	*rxf_ring[DHD_RXF_RING];
+	uint32		rxf_store_idx;	/* written by the DPC only */
+	uint32		rxf_sent_idx;	/* written by the rxf thread only */
+
 #else
 	bool dhd_tasklet_create;
 #endif /* DHDTHREAD */
@@ -292,6 +308,14 @@ typedef struct dhd_info {
 	u32 pend_ipaddr;
 #endif /* ARP_OFFLOAD_SUPPORT */
 
+#ifdef PKT_FILTER_SUPPORT
+#define DHD_SUS_FILTERS		4
+#define DHD_SUS_FILTER_LEN	256
+	/* Suspend filters built from our own addresses, see dhd_sus_filter_build */
+	char sus_filter[DHD_SUS_FILTERS][DHD_SUS_FILTER_LEN];
+	int sus_filter_count;
+#endif /* PKT_FILTER_SUPPORT */
+
 #ifdef DYNAMIC_DTIM_SKIP
 #define DYNAMIC_TIME 900 //900ms
 #define DYNAMIC_RX_DIFF 5
@@ -299,6 +323,14 @@ typedef struct dhd_info {
 	struct timer_list dtim_timer;
 	tsk_ctl_t dtim_tsk;
 #endif
+
+#ifdef DHD_RX_NAPI
+	/* Batched receive: the DPC queues frames, the NAPI poll delivers them */
+	struct net_device rx_napi_dev;	/* dummy, NAPI needs a device to hang on */
+	struct napi_struct rx_napi;
+	struct sk_buff_head rx_napi_queue;
+	bool rx_napi_on;
+#endif /* DHD_RX_NAPI */
 } dhd_info_t;
 
 
@@ -356,6 +388,10 @@ module_param(dhd_pkt_filter_enable, uint, 0);
 uint dhd_pkt_filter_init = 0;
 module_param(dhd_pkt_filter_init, uint, 0);
 
+/* Suspend filters match our own IPv4 address, ARP and ND (0 = any unicast) */
+uint dhd_suspend_filter = TRUE;
+module_param(dhd_suspend_filter, uint, 0644);
+
 /* Pkt filter mode control */
 uint dhd_master_mode = TRUE;
 module_param(dhd_master_mode, uint, 0);
@@ -365,9 +401,22 @@ module_param(dhd_master_mode, uint, 0);
 int dhd_watchdog_prio = 0;
 module_param(dhd_watchdog_prio, int, 0);
 
-/* DPC thread priority, -1 to use tasklet */
+static int dhd_sched_prio_set(const char *val, struct kernel_param *kp);
+static int dhd_sched_cpus_set(const char *val, struct kernel_param *kp);
+
+/* DPC thread priority, -1 to use tasklet; only the RT priority changes at runtime */
 int dhd_dpc_prio = 1;
-module_param(dhd_dpc_prio, int, 0);
+module_param_call(dhd_dpc_prio, dhd_sched_prio_set, param_get_int, &dhd_dpc_prio, 0644);
+
+/* RX frame thread priority, -1 to deliver frames from the DPC thread */
+int dhd_rxf_prio = -1;
+module_param_call(dhd_rxf_prio, dhd_sched_prio_set, param_get_int, &dhd_rxf_prio, 0644);
+
+/* CPU masks for the DPC and rxf threads, 0 for any CPU */
+uint dhd_dpc_cpus = 0;
+module_param_call(dhd_dpc_cpus, dhd_sched_cpus_set, param_get_uint, &dhd_dpc_cpus, 0644);
+uint dhd_rxf_cpus = 0;
+module_param_call(dhd_rxf_cpus, dhd_sched_cpus_set, param_get_uint, &dhd_rxf_cpus, 0644);
 
 extern int dhd_dongle_memsize;
 module_param(dhd_dongle_memsize, int, 0);
@@ -409,10 +458,40 @@ extern uint dhd_rxbound;
 module_param(dhd_txbound, uint, 0);
 module_param(dhd_rxbound, uint, 0);
 
+/* Adaptive Tx/Rx bounds */
+extern uint dhd_adapt_bound;
+module_param(dhd_adapt_bound, uint, 0644);
+
+/* Screen-off tx coalescing: max hold time (0 = off) and batch size */
+extern uint dhd_txhold_ms;
+extern uint dhd_txhold_pkts;
+module_param(dhd_txhold_ms, uint, 0644);
+module_param(dhd_txhold_pkts, uint, 0644);
+
+/* Byte queue limits on the bus tx queue */
+extern uint dhd_tx_bql;
+module_param(dhd_tx_bql, uint, 0644);
+
 /* Deferred transmits */
 extern uint dhd_deferred_tx;
 module_param(dhd_deferred_tx, uint, 0);
 
+#ifdef DHD_RX_NAPI
+/* Deliver received frames in NAPI batches with GRO instead of netif_rx_ni() */
+uint dhd_rx_napi = FALSE;
+module_param(dhd_rx_napi, uint, 0644);
+#endif /* DHD_RX_NAPI */
+
+#ifdef CONFIG_RPS
+/* Receive steering set on each interface when it registers: cpu bitmask
+ * for RPS and flows per queue for RFS. 0 leaves both to user space.
+ */
+uint dhd_rps_cpus = 0xf;
+module_param(dhd_rps_cpus, uint, 0644);
+uint dhd_rps_flow_cnt = 256;
+module_param(dhd_rps_flow_cnt, uint, 0644);
+#endif /* CONFIG_RPS */
+
 #ifdef BCMDBGFS
 extern void dhd_dbg_init(dhd_pub_t *dhdp);
 extern void dhd_dbg_remove(void);
@@ -475,6 +554,7 @@ struct iw_statistics *dhd_get_wireless_stats(struct net_device *dev);
 #endif /* defined(WL_WIRELESS_EXT) */
 
 static void dhd_dpc(ulong data);
+static void dhd_txhold_timer_func(ulong data);
 /* forward decl */
 extern int dhd_wait_pend8021x(struct net_device *dev);
 
@@ -520,6 +600,133 @@ extern int register_pm_notifier(struct notifier_block *nb);
 extern int unregister_pm_notifier(struct notifier_block *nb);
 #endif /* (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 27)) && defined(CONFIG_PM_SLEEP) */
 
+#define DHD_ARP_TGT_IP_OFFSET	24	/* in the ARP payload */
+#define DHD_ETHER_TYPE_IPV6	0x86dd
+#define DHD_IPV6_HDR_LEN	40
+#define DHD_IP_PROT_ICMPV6	58
+#define DHD_ICMPV6_RS		133	/* first ND type, router solicitation */
+#define DHD_ICMPV6_NS		135
+#define DHD_ICMPV6_REDIRECT	137	/* last ND type */
+
+#ifdef PKT_FILTER_SUPPORT
+#define DHD_SUS_FILTER_IPV4	110
+#define DHD_SUS_FILTER_ARP	111
+#define DHD_SUS_FILTER_IPV6	112
+#define DHD_SUS_FILTER_ND	113
+#define DHD_SUS_FILTER_MAXLEN	56	/* pattern bytes, fits DHD_SUS_FILTER_LEN */
+
+/* Add pattern filter @id, matching @len bytes of @pattern under @mask at @offset */
+static void
+dhd_sus_filter_add(dhd_info_t *dhd, int id, int offset, uint8 *mask, uint8 *pattern, int len)
+{
+	char *p = dhd->sus_filter[dhd->sus_filter_count++];
+	int i;
+
+	p += sprintf(p, "%d 0 0 %d 0x", id, offset);
+	for (i = 0; i < len; i++)
+		p += sprintf(p, "%02X", mask[i]);
+	p += sprintf(p, " 0x");
+	for (i = 0; i < len; i++)
+		p += sprintf(p, "%02X", pattern[i]);
+}
+
+static void
+dhd_sus_filter_type(uint8 *mask, uint8 *pattern, int offset, uint16 type)
+{
+	mask[offset] = mask[offset + 1] = 0xff;
+	pattern[offset] = type >> 8;
+	pattern[offset + 1] = type & 0xff;
+}
+
+/*
+ * Build the suspend filters for the current address of the primary interface:
+ * unicast IPv4 to that address, ARP whose target is that address, unicast IPv6
+ * and neighbour solicitations to a solicited-node group. Returns FALSE, with no
+ * filters, while we have no IPv4 address; the plain unicast filter is used then.
+ */
+static bool
+dhd_sus_filter_build(dhd_info_t *dhd)
+{
+	uint8 mask[DHD_SUS_FILTER_MAXLEN], pattern[DHD_SUS_FILTER_MAXLEN];
+	struct in_device *in_dev;
+	__be32 ipa = 0;
+	int len;
+
+	dhd->sus_filter_count = 0;
+	if (!dhd->iflist[0] || !dhd->iflist[0]->net)
+		return FALSE;
+
+	rcu_read_lock();
+	in_dev = __in_dev_get_rcu(dhd->iflist[0]->net);
+	if (in_dev && in_dev->ifa_list)
+		ipa = in_dev->ifa_list->ifa_local;
+	rcu_read_unlock();
+	if (!ipa)
+		return FALSE;
+
+	/* Unicast IPv4 to our address: DA group bit, ethertype, IP destination */
+	len = ETHER_HDR_LEN + IPV4_DEST_IP_OFFSET + IPV4_ADDR_LEN;
+	bzero(mask, len);
+	bzero(pattern, len);
+	mask[0] = 0x01;
+	dhd_sus_filter_type(mask, pattern, ETHER_TYPE_OFFSET, ETHER_TYPE_IP);
+	memset(&mask[len - IPV4_ADDR_LEN], 0xff, IPV4_ADDR_LEN);
+	memcpy(&pattern[len - IPV4_ADDR_LEN], &ipa, IPV4_ADDR_LEN);
+	dhd_sus_filter_add(dhd, DHD_SUS_FILTER_IPV4, 0, mask, pattern, len);
+
+	/* ARP for our address, matched from the ethertype to the target IP */
+	len = ETHER_TYPE_LEN + DHD_ARP_TGT_IP_OFFSET + IPV4_ADDR_LEN;
+	bzero(mask, len);
+	bzero(pattern, len);
+	dhd_sus_filter_type(mask, pattern, 0, ETHER_TYPE_ARP);
+	memset(&mask[len - IPV4_ADDR_LEN], 0xff, IPV4_ADDR_LEN);
+	memcpy(&pattern[len - IPV4_ADDR_LEN], &ipa, IPV4_ADDR_LEN);
+	dhd_sus_filter_add(dhd, DHD_SUS_FILTER_ARP, ETHER_TYPE_OFFSET, mask, pattern, len);
+
+	/* Unicast IPv6 */
+	len = ETHER_HDR_LEN;
+	bzero(mask, len);
+	bzero(pattern, len);
+	mask[0] = 0x01;
+	dhd_sus_filter_type(mask, pattern, ETHER_TYPE_OFFSET, DHD_ETHER_TYPE_IPV6);
+	dhd_sus_filter_add(dhd, DHD_SUS_FILTER_IPV6, 0, mask, pattern, len);
+
+	/* Neighbour solicitation to a solicited-node group, 33:33:ff:xx:xx:xx */
+	len = ETHER_HDR_LEN + DHD_IPV6_HDR_LEN + 1;
+	bzero(mask, len);
+	bzero(pattern, len);
+	mask[0] = mask[1] = mask[2] = 0xff;
+	pattern[0] = pattern[1] = 0x33;
+	pattern[2] = 0xff;
+	dhd_sus_filter_type(mask, pattern, ETHER_TYPE_OFFSET, DHD_ETHER_TYPE_IPV6);
+	mask[ETHER_HDR_LEN + IPV6_NEXT_HDR_OFFSET] = 0xff;
+	pattern[ETHER_HDR_LEN + IPV6_NEXT_HDR_OFFSET] = DHD_IP_PROT_ICMPV6;
+	mask[len - 1] = 0xff;
+	pattern[len - 1] = DHD_ICMPV6_NS;
+	dhd_sus_filter_add(dhd, DHD_SUS_FILTER_ND, 0, mask, pattern, len);
+
+	return TRUE;
+}
+
+/* Disable and remove the suspend filters so the next build starts clean */
+static void
+dhd_sus_filter_clear(dhd_pub_t *dhdp)
+{
+	dhd_info_t *dhd = (dhd_info_t *)dhdp->info;
+	char iovbuf[32];
+	uint32 id;
+	int i;
+
+	for (i = 0; i < dhd->sus_filter_count; i++) {
+		dhd_pktfilter_offload_enable(dhdp, dhd->sus_filter[i], 0, dhd_master_mode);
+		id = htod32(bcm_strtoul(dhd->sus_filter[i], NULL, 0));
+		bcm_mkiovar("pkt_filter_delete", (char *)&id, 4, iovbuf, sizeof(iovbuf));
+		dhd_wl_ioctl_cmd(dhdp, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0);
+	}
+	dhd->sus_filter_count = 0;
+}
+#endif /* PKT_FILTER_SUPPORT */
+
 static void dhd_set_packet_filter(int value, dhd_pub_t *dhd)
 {
 #ifdef PKT_FILTER_SUPPORT
@@ -528,13 +735,32 @@ static void dhd_set_packet_filter(int value, dhd_pub_t *dhd)
 	/* 0 - Disable packet filter */
 	if (dhd_pkt_filter_enable && (!value ||
 	    (dhd_check_ap_wfd_mode_set(dhd) == FALSE))) {
+		dhd_info_t *dhdi = (dhd_info_t *)dhd->info;
+		bool own = FALSE;
 		int i;
 
+		dhd_sus_filter_clear(dhd);
+		if (value && dhd_suspend_filter)
+			own = dhd_sus_filter_build(dhdi);
+
 		for (i = 0; i < dhd->pktfilter_count; i++) {
+			/* Our own filters replace the any-unicast and mDNS ones */
+			if (own && ((i == DHD_UNICAST_FILTER_NUM) ||
+			    (i == DHD_MDNS_FILTER_NUM))) {
+				dhd_pktfilter_offload_enable(dhd, dhd->pktfilter[i],
+					0, dhd_master_mode);
+				continue;
+			}
 			dhd_pktfilter_offload_set(dhd, dhd->pktfilter[i]);
 			dhd_pktfilter_offload_enable(dhd, dhd->pktfilter[i],
 				value, dhd_master_mode);
 		}
+
+		for (i = 0; i < dhdi->sus_filter_count; i++) {
+			dhd_pktfilter_offload_set(dhd, dhdi->sus_filter[i]);
+			dhd_pktfilter_offload_enable(dhd, dhdi->sus_filter[i],
+				1, dhd_master_mode);
+		}
 	}
 #endif
 }
@@ -722,6 +948,9 @@ static int dhd_suspend_resume_helper(struct dhd_info *dhd, int val, int force)
 	    (dhd_check_ap_wfd_mode_set(dhdp) == FALSE)) {
 		ret = dhd_set_suspend(val, dhdp);
 	}
+	/* Screen on: do not wait for the hold deadline */
+	if (!val && dhdp->up)
+		dhd_bus_txhold_flush(dhdp->bus);
 	DHD_OS_WAKE_UNLOCK(dhdp);
 	return ret;
 }
@@ -1528,6 +1757,79 @@ dhd_txflowcontrol(dhd_pub_t *dhdp, int ifidx, bool state)
 	}
 }
 
+#ifdef DHD_RX_NAPI
+static int
+dhd_rx_napi_poll(struct napi_struct *napi, int budget)
+{
+	dhd_info_t *dhd = container_of(napi, dhd_info_t, rx_napi);
+	struct sk_buff *skb;
+	int work = 0;
+
+	while (work < budget && (skb = skb_dequeue(&dhd->rx_napi_queue))) {
+		napi_gro_receive(napi, skb);
+		work++;
+	}
+
+	if (work) {
+		dhd->pub.rx_napi_polls++;
+		dhd->pub.rx_napi_batch[min(fls(work) - 1, DHD_RX_BATCH_BINS - 1)]++;
+	}
+
+	if (work < budget) {
+		napi_complete(napi);
+		/* Frames queued by the DPC after the last dequeue */
+		if (!skb_queue_empty(&dhd->rx_napi_queue))
+			napi_schedule(napi);
+	}
+
+	return work;
+}
+#endif /* DHD_RX_NAPI */
+
+#define DHD_WAKE_WINDOW		HZ	/* wake to first frame, longer counts as none */
+
+/* The WLAN host-wake irq resumed the system; the next frame is the cause */
+void
+dhd_os_wake_irq(dhd_pub_t *pub)
+{
+	if (pub->wake_pending)
+		pub->rx_wake_type[DHD_WAKE_NONE]++;
+	pub->rx_wake++;
+	pub->wake_jiffies = jiffies;
+	pub->wake_pending = TRUE;
+}
+
+/* Count the frame that followed a host wake, after eth_type_trans() */
+static void
+dhd_wake_classify(dhd_pub_t *dhdp, struct sk_buff *skb, uchar *eth, uint len)
+{
+	uint16 type = ntoh16(skb->protocol);
+	int wake;
+
+	dhdp->wake_pending = FALSE;
+	if (time_after(jiffies, dhdp->wake_jiffies + DHD_WAKE_WINDOW))
+		wake = DHD_WAKE_NONE;
+	else if (type == ETHER_TYPE_BRCM)
+		wake = DHD_WAKE_EVENT;
+	else if (type == ETHER_TYPE_ARP)
+		wake = DHD_WAKE_ARP;
+	else if ((type == DHD_ETHER_TYPE_IPV6) &&
+	         (len > ETHER_HDR_LEN + DHD_IPV6_HDR_LEN) &&
+	         (eth[ETHER_HDR_LEN + IPV6_NEXT_HDR_OFFSET] == DHD_IP_PROT_ICMPV6) &&
+	         (eth[ETHER_HDR_LEN + DHD_IPV6_HDR_LEN] >= DHD_ICMPV6_RS) &&
+	         (eth[ETHER_HDR_LEN + DHD_IPV6_HDR_LEN] <= DHD_ICMPV6_REDIRECT))
+		wake = DHD_WAKE_ND;
+	else if (skb->pkt_type == PACKET_BROADCAST || skb->pkt_type == PACKET_MULTICAST)
+		wake = DHD_WAKE_MCAST;
+	else if (type == ETHER_TYPE_IP)
+		wake = DHD_WAKE_IPV4;
+	else if (type == DHD_ETHER_TYPE_IPV6)
+		wake = DHD_WAKE_IPV6;
+	else
+		wake = DHD_WAKE_OTHER;
+	dhdp->rx_wake_type[wake]++;
+}
+
 void
 dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 {
@@ -1541,6 +1843,14 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 	wl_event_msg_t event;
 	int tout_rx = 0;
 	int tout_ctrl = 0;
+#ifdef DHD_RX_NAPI
+	bool napi = dhd_rx_napi && dhd->rx_napi_on;
+	int queued = 0;
+#endif /* DHD_RX_NAPI */
+#ifdef DHDTHREAD
+	bool rxf = (dhd->thr_rxf_ctl.thr_pid >= 0) && !in_interrupt();
+	int rxf_queued = 0;
+#endif /* DHDTHREAD */
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
@@ -1625,6 +1935,9 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 		skb->data = eth;
 		skb->len = len;
 
+		if (dhdp->wake_pending)
+			dhd_wake_classify(dhdp, skb, eth, len);
+
 #ifdef WLMEDIA_HTSF
 	dhd_htsf_addrxts(dhdp, pktbuf);
 #endif
@@ -1667,6 +1980,20 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 		dhdp->dstats.rx_bytes += skb->len;
 		dhdp->rx_packets++; /* Local count */
 
+#ifdef DHD_RX_NAPI
+		if (napi) {
+			skb_queue_tail(&dhd->rx_napi_queue, skb);
+			queued++;
+			continue;
+		}
+#endif /* DHD_RX_NAPI */
+#ifdef DHDTHREAD
+		if (rxf && dhd_rxf_sched(dhd, skb)) {
+			rxf_queued++;
+			continue;
+		}
+#endif /* DHDTHREAD */
+
 		if (in_interrupt()) {
 			netif_rx(skb);
 		} else {
@@ -1688,6 +2015,19 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 		}
 	}
 
+#ifdef DHD_RX_NAPI
+	/* One softirq raise for the whole batch */
+	if (queued) {
+		local_bh_disable();
+		napi_schedule(&dhd->rx_napi);
+		local_bh_enable();
+	}
+#endif /* DHD_RX_NAPI */
+#ifdef DHDTHREAD
+	if (rxf_queued)
+		up(&dhd->thr_rxf_ctl.sema);
+#endif /* DHDTHREAD */
+
 	DHD_OS_WAKE_LOCK_RX_TIMEOUT_ENABLE(dhdp, tout_rx);
 	DHD_OS_WAKE_LOCK_CTRL_TIMEOUT_ENABLE(dhdp, tout_ctrl);
 }
@@ -1908,6 +2248,170 @@ dhd_dpc_thread(void *data)
 
 	complete_and_exit(&tsk->completed, 0);
 }
+
+static bool
+dhd_rxf_enqueue(dhd_info_t *dhd, struct sk_buff *skb)
+{
+	uint32 store = dhd->rxf_store_idx;
+
+	if (store - ACCESS_ONCE(dhd->rxf_sent_idx) >= DHD_RXF_RING)
+		return FALSE;
+
+	dhd->rxf_ring[store & (DHD_RXF_RING - 1)] = skb;
+	/* Publish the slot before the index */
+	smp_wmb();
+	dhd->rxf_store_idx = store + 1;
+	return TRUE;
+}
+
+static struct sk_buff *
+dhd_rxf_dequeue(dhd_info_t *dhd)
+{
+	uint32 sent = dhd->rxf_sent_idx;
+	struct sk_buff *skb;
+
+	if (sent == ACCESS_ONCE(dhd->rxf_store_idx))
+		return NULL;
+
+	smp_rmb();
+	skb = dhd->rxf_ring[sent & (DHD_RXF_RING - 1)];
+	/* Done with the slot before the DPC may reuse it */
+	smp_mb();
+	dhd->rxf_sent_idx = sent + 1;
+	return skb;
+}
+
+static void
+dhd_rxf_purge(dhd_info_t *dhd)
+{
+	struct sk_buff *skb;
+
+	while ((skb = dhd_rxf_dequeue(dhd)) != NULL)
+		dev_kfree_skb_any(skb);
+}
+
+/* Hand a frame to the rxf thread; FALSE if the thread is gone */
+static bool
+dhd_rxf_sched(dhd_info_t *dhd, struct sk_buff *skb)
+{
+	while (!dhd_rxf_enqueue(dhd, skb)) {
+		/* Ring full: let the rxf thread catch up */
+		dhd->pub.rxf_full++;
+		up(&dhd->thr_rxf_ctl.sema);
+		usleep_range(100, 200);
+		if (dhd->thr_rxf_ctl.thr_pid < 0)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static int
+dhd_rxf_thread(void *data)
+{
+	tsk_ctl_t *tsk = (tsk_ctl_t *)data;
+	dhd_info_t *dhd = (dhd_info_t *)tsk->parent;
+	struct sk_buff *skb;
+
+	DAEMONIZE("dhd_rxf");
+
+	/*  signal: thread has started */
+	complete(&tsk->completed);
+
+	/* Run until signal received */
+	while (1) {
+		if (down_interruptible(&tsk->sema) == 0) {
+
+			SMP_RD_BARRIER_DEPENDS();
+			if (tsk->terminated) {
+				break;
+			}
+
+			while ((skb = dhd_rxf_dequeue(dhd)) != NULL)
+				netif_rx_ni(skb);
+		}
+		else
+			break;
+	}
+
+	dhd_rxf_purge(dhd);
+	complete_and_exit(&tsk->completed, 0);
+}
+
+/* Owner of the DPC and rxf threads, for the scheduling parameters */
+static dhd_info_t *dhd_sched_owner;
+static DEFINE_MUTEX(dhd_sched_lock);
+
+static void
+dhd_thread_sched_apply(tsk_ctl_t *tsk, int prio, uint cpus)
+{
+	struct task_struct *p;
+	struct sched_param param;
+	cpumask_t mask;
+	int cpu;
+
+	if (tsk->thr_pid <= 0)
+		return;
+
+	rcu_read_lock();
+	p = pid_task(find_vpid(tsk->thr_pid), PIDTYPE_PID);
+	if (p)
+		get_task_struct(p);
+	rcu_read_unlock();
+	if (!p)
+		return;
+
+	if (prio > 0) {
+		param.sched_priority = (prio < MAX_RT_PRIO) ? prio : (MAX_RT_PRIO - 1);
+		setScheduler(p, SCHED_FIFO, &param);
+	} else {
+		param.sched_priority = 0;
+		setScheduler(p, SCHED_NORMAL, &param);
+	}
+
+	/* The scheduler widens the mask again if all of its cores go offline */
+	cpumask_clear(&mask);
+	for (cpu = 0; cpu < nr_cpu_ids && cpu < 32; cpu++)
+		if (cpus & (1 << cpu))
+			cpumask_set_cpu(cpu, &mask);
+	if (!cpus || set_cpus_allowed_ptr(p, &mask))
+		set_cpus_allowed_ptr(p, cpu_possible_mask);
+
+	put_task_struct(p);
+}
+
+static void
+dhd_sched_apply(void)
+{
+	dhd_info_t *dhd;
+
+	mutex_lock(&dhd_sched_lock);
+	dhd = dhd_sched_owner;
+	if (dhd) {
+		dhd_thread_sched_apply(&dhd->thr_dpc_ctl, dhd_dpc_prio, dhd_dpc_cpus);
+		dhd_thread_sched_apply(&dhd->thr_rxf_ctl, dhd_rxf_prio, dhd_rxf_cpus);
+	}
+	mutex_unlock(&dhd_sched_lock);
+}
+
+static int
+dhd_sched_prio_set(const char *val, struct kernel_param *kp)
+{
+	int ret = param_set_int(val, kp);
+
+	if (!ret)
+		dhd_sched_apply();
+	return ret;
+}
+
+static int
+dhd_sched_cpus_set(const char *val, struct kernel_param *kp)
+{
+	int ret = param_set_uint(val, kp);
+
+	if (!ret)
+		dhd_sched_apply();
+	return ret;
+}
 #endif /* DHDTHREAD */
 
 static void
@@ -2734,12 +3238,26 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 #ifdef DHDTHREAD
 	dhd->thr_dpc_ctl.thr_pid = DHD_PID_KT_TL_INVALID;
 	dhd->thr_wdt_ctl.thr_pid = DHD_PID_KT_INVALID;
+	dhd->thr_rxf_ctl.thr_pid = DHD_PID_KT_INVALID;
 #else
 	dhd->dhd_tasklet_create = FALSE;
 #endif /* DHDTHREAD */
 	dhd->thr_sysioc_ctl.thr_pid = DHD_PID_KT_INVALID;
 	dhd_state |= DHD_ATTACH_STATE_DHD_ALLOC;
 
+	init_timer(&dhd->txhold_timer);
+	dhd->txhold_timer.data = (ulong)dhd;
+	dhd->txhold_timer.function = dhd_txhold_timer_func;
+
+#ifdef DHD_RX_NAPI
+	skb_queue_head_init(&dhd->rx_napi_queue);
+	init_dummy_netdev(&dhd->rx_napi_dev);
+	netif_napi_add(&dhd->rx_napi_dev, &dhd->rx_napi, dhd_rx_napi_poll,
+		DHD_RX_NAPI_WEIGHT);
+	napi_enable(&dhd->rx_napi);
+	dhd->rx_napi_on = TRUE;
+#endif /* DHD_RX_NAPI */
+
 	/*
 	 * Save the dhd_info into the priv
 	 */
@@ -2871,6 +3389,18 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 		tasklet_init(&dhd->tasklet, dhd_dpc, (ulong)dhd);
 		dhd->thr_dpc_ctl.thr_pid = -1;
 	}
+
+	/* Network stack delivery off the DPC, so bus reads keep going */
+	if (dhd_rxf_prio >= 0) {
+		PROC_START(dhd_rxf_thread, dhd, &dhd->thr_rxf_ctl, 0);
+	} else {
+		dhd->thr_rxf_ctl.thr_pid = -1;
+	}
+
+	mutex_lock(&dhd_sched_lock);
+	dhd_sched_owner = dhd;
+	mutex_unlock(&dhd_sched_lock);
+	dhd_sched_apply();
 #else
 	/* Set up the bottom half handler */
 	tasklet_init(&dhd->tasklet, dhd_dpc, (ulong)dhd);
@@ -3652,6 +4182,30 @@ static int dhd_device_event(struct notifier_block *this,
 }
 #endif /* ARP_OFFLOAD_SUPPORT */
 
+#ifdef CONFIG_RPS
+/* All receive processing starts on the DPC thread's cpu; let the stack
+ * spread it by flow hash over dhd_rps_cpus.
+ */
+static void
+dhd_rps_init(struct net_device *net)
+{
+	cpumask_var_t mask;
+	int cpu;
+
+	if (!dhd_rps_cpus || !alloc_cpumask_var(&mask, GFP_KERNEL))
+		return;
+
+	cpumask_clear(mask);
+	for_each_possible_cpu(cpu) {
+		if (cpu < 32 && (dhd_rps_cpus & (1U << cpu)))
+			cpumask_set_cpu(cpu, mask);
+	}
+	if (netif_set_rps_cpus(net, mask, dhd_rps_flow_cnt))
+		DHD_ERROR(("%s: failed to set up rps on %s\n", __FUNCTION__, net->name));
+	free_cpumask_var(mask);
+}
+#endif /* CONFIG_RPS */
+
 int
 dhd_net_attach(dhd_pub_t *dhdp, int ifidx)
 {
@@ -3731,6 +4285,9 @@ dhd_net_attach(dhd_pub_t *dhdp, int ifidx)
 		DHD_ERROR(("couldn't register the net device, err %d\n", err));
 		goto fail;
 	}
+#ifdef CONFIG_RPS
+	dhd_rps_init(net);
+#endif /* CONFIG_RPS */
 	printf("Broadcom Dongle Host Driver: register interface [%s]"
 		" MAC: %.2x:%.2x:%.2x:%.2x:%.2x:%.2x\n",
 		net->name,
@@ -3837,6 +4394,27 @@ void dhd_detach(dhd_pub_t *dhdp)
 		PROC_STOP(&dhd->thr_sysioc_ctl);
 	}
 
+#ifdef DHDTHREAD
+	mutex_lock(&dhd_sched_lock);
+	if (dhd_sched_owner == dhd)
+		dhd_sched_owner = NULL;
+	mutex_unlock(&dhd_sched_lock);
+
+	/* Stop delivering before the interfaces the queued frames point at go */
+	if (dhd->thr_rxf_ctl.thr_pid >= 0) {
+		PROC_STOP(&dhd->thr_rxf_ctl);
+	}
+#endif /* DHDTHREAD */
+
+#ifdef DHD_RX_NAPI
+	/* Stop delivering before the interfaces the queued frames point at go */
+	if (dhd->rx_napi_on) {
+		dhd->rx_napi_on = FALSE;
+		napi_disable(&dhd->rx_napi);
+		skb_queue_purge(&dhd->rx_napi_queue);
+	}
+#endif /* DHD_RX_NAPI */
+
 	/* delete all interfaces, start with virtual  */
 	if (dhd->dhd_state & DHD_ATTACH_STATE_ADD_IF) {
 		int i = 1;
@@ -3872,6 +4450,8 @@ void dhd_detach(dhd_pub_t *dhdp)
 		}
 	}
 
+	del_timer_sync(&dhd->txhold_timer);
+
 	/* Clear the watchdog timer */
 	flags = dhd_os_spin_lock(&dhd->pub);
 	timer_valid = dhd->wd_timer_valid;
@@ -3890,8 +4470,13 @@ void dhd_detach(dhd_pub_t *dhdp)
 			PROC_STOP(&dhd->thr_dpc_ctl);
 		}
 		else
-#endif /* DHDTHREAD */
+			tasklet_kill(&dhd->tasklet);
+
+		/* Anything the DPC queued while the rxf thread was being stopped */
+		dhd_rxf_purge(dhd);
+#else
 		tasklet_kill(&dhd->tasklet);
+#endif /* DHDTHREAD */
 
 #ifdef DYNAMIC_DTIM_SKIP
 		if( dhd->dtim_tsk.thr_pid >= 0) {
@@ -3899,6 +4484,14 @@ void dhd_detach(dhd_pub_t *dhdp)
 		}
 #endif
 	}
+
+#ifdef DHD_RX_NAPI
+	/* Anything the DPC queued while it was being stopped */
+	if (dhd->dhd_state & DHD_ATTACH_STATE_DHD_ALLOC) {
+		skb_queue_purge(&dhd->rx_napi_queue);
+		netif_napi_del(&dhd->rx_napi);
+	}
+#endif /* DHD_RX_NAPI */
 	if (dhd->dhd_state & DHD_ATTACH_STATE_PROT_ATTACH) {
 		dhd_bus_detach(dhdp);
 
@@ -4074,6 +4667,30 @@ dhd_os_proto_unblock(dhd_pub_t *pub)
 	return 0;
 }
 
+static void
+dhd_txhold_timer_func(ulong data)
+{
+	dhd_info_t *dhd = (dhd_info_t *)data;
+
+	if (dhd->pub.up)
+		dhd_bus_txhold_flush(dhd->pub.bus);
+}
+
+void
+dhd_os_txhold_timer(dhd_pub_t *pub, uint msec)
+{
+	dhd_info_t *dhd = (dhd_info_t *)pub->info;
+
+	if (!timer_pending(&dhd->txhold_timer))
+		mod_timer(&dhd->txhold_timer, jiffies + msecs_to_jiffies(msec));
+}
+
+uint32
+dhd_os_time_usec(void)
+{
+	return (uint32)ktime_to_us(ktime_get());
+}
+
 unsigned int
 dhd_os_get_ioctl_resp_timeout(void)
 {
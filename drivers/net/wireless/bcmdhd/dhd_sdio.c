@@ -65,6 +65,7 @@
 #include <dhd_dbg.h>
 #include <dhdioctl.h>
 #include <sdiovar.h>
+#include <linux/dynamic_queue_limits.h>
 
 #ifndef DHDSDIO_MEM_DUMP_FNAME
 #define DHDSDIO_MEM_DUMP_FNAME         "mem_dump"
@@ -83,6 +84,10 @@
 
 #define DHD_TXMINMAX	1	/* Max tx frames if rx still pending */
 
+#define DHD_BOUND_SCALE	4	/* Max adaptive tx/rx bound, in multiples of the default */
+
+#define SDIO_BATCH_BINS	7	/* Frame count histograms: 1, 2-3, 4-7, ... 64 and up */
+
 #define MEMBLOCK	2048		/* Block size used for downloading of dongle image */
 #define MAX_NVRAMBUF_SIZE	4096	/* max nvram buf size */
 #define MAX_DATA_BUF	(32 * 1024)	/* Must be large enough to hold biggest possible glom */
@@ -292,10 +297,23 @@ typedef struct dhd_bus {
 	uint		rxglomfail;		/* Failed deglom attempts */
 	uint		rxglomframes;		/* Number of glom frames (superframes) */
 	uint		rxglompkts;		/* Number of packets from glom frames */
+	uint		rxglomcopy;		/* Glom frames copied from databuf into the chain */
 	uint		f2rxhdrs;		/* Number of header reads */
 	uint		f2rxdata;		/* Number of frame data reads */
 	uint		f2txdata;		/* Number of f2 frame writes */
 	uint		f1regdata;		/* Number of f1 register accesses */
+	uint		rxglomhist[SDIO_BATCH_BINS];	/* Superframes by frames in them */
+	uint		rxbatch[SDIO_BATCH_BINS];	/* DPC rx passes by frames read */
+	uint		txbatch[SDIO_BATCH_BINS];	/* DPC tx passes by frames sent */
+	uint		rxbound_cur;		/* Adaptive rx frames per DPC pass */
+	uint32		sd_busy_ms;		/* Time spent in F2 data transfers */
+	uint32		sd_busy_us;		/* ... and the sub-millisecond rest */
+	uint32		sd_util_start;		/* OSL_SYSUPTIME() at last counter clear */
+	uint		clkwake;		/* Backplane clock requests from idle */
+	uint		clkwake_suspend;	/* ... of which while in suspend */
+	uint		txhold;			/* Tx frames held back for coalescing */
+	uint		txhold_expired;		/* Held frames flushed at deadline or resume */
+	struct dql	txdql;			/* Bytes in txq, see dhdsdio_txq_over() */
 
 	uint8		*ctrl_frame_buf;
 	uint32		ctrl_frame_len;
@@ -327,6 +345,17 @@ uint dhd_txbound;
 uint dhd_rxbound;
 uint dhd_txminmax = DHD_TXMINMAX;
 
+/* Scale the tx/rx bounds with tx queue depth and rx backlog */
+uint dhd_adapt_bound = FALSE;
+
+/* Screen-off tx coalescing: hold non-urgent frames up to this long... */
+uint dhd_txhold_ms = 0;
+/* ... or until this many are queued */
+uint dhd_txhold_pkts = 8;
+
+/* Flow-control the stack on txq bytes as well as frames (byte queue limits) */
+uint dhd_tx_bql = TRUE;
+
 /* override the RAM size if possible */
 #define DONGLE_MIN_MEMSIZE (128 *1024)
 int dhd_dongle_memsize;
@@ -774,6 +803,9 @@ dhdsdio_clkctl(dhd_bus_t *bus, uint target, bool pendok)
 
 	switch (target) {
 	case CLK_AVAIL:
+		bus->clkwake++;
+		if (bus->dhd->in_suspend)
+			bus->clkwake_suspend++;
 		/* Make sure SD clock is available */
 		if (bus->clkstate == CLK_NONE)
 			dhdsdio_sdclk(bus, TRUE);
@@ -1114,17 +1146,72 @@ done:
 	return ret;
 }
 
+/*
+ * While the screen is off, leave a non-urgent frame queued instead of waking
+ * the bus for it, unless the bus is awake anyway or the batch is full. The
+ * DPC sends it with the next rx or tx work, or dhd_bus_txhold_flush() does
+ * at the deadline.
+ */
+static bool
+dhdsdio_txhold(dhd_bus_t *bus, void *pkt)
+{
+	if (!dhd_txhold_ms || !bus->dhd->in_suspend)
+		return FALSE;
+	if (bus->clkstate == CLK_AVAIL || bus->dpc_sched)
+		return FALSE;
+	if (PKTPRIO(pkt) >= PRIO_8021D_VI)
+		return FALSE;
+	return (pktq_len(&bus->txq) + 1 < dhd_txhold_pkts);
+}
+
+/*
+ * The stack is flow-controlled when the tx queue reaches FCHI frames or, with
+ * dhd_tx_bql, when its bytes exceed a limit that txdql adapts to what the bus
+ * drains between DPC passes. Either keeps it stopped; it restarts below FCLOW
+ * frames and within the byte limit.
+ */
+static bool
+dhdsdio_txq_over(dhd_bus_t *bus)
+{
+	if (pktq_len(&bus->txq) >= FCHI)
+		return TRUE;
+	return (dhd_tx_bql && (dql_avail(&bus->txdql) < 0));
+}
+
+static bool
+dhdsdio_txq_under(dhd_bus_t *bus)
+{
+	if (pktq_len(&bus->txq) >= FCLOW)
+		return FALSE;
+	return (!dhd_tx_bql || (dql_avail(&bus->txdql) >= 0));
+}
+
+void
+dhd_bus_txhold_flush(struct dhd_bus *bus)
+{
+	if ((bus->dhd->busstate == DHD_BUS_DOWN) || !pktq_len(&bus->txq))
+		return;
+
+	if (!bus->dpc_sched) {
+		bus->txhold_expired++;
+		bus->dpc_sched = TRUE;
+		dhd_sched_dpc(bus->dhd);
+	}
+}
+
 int
 dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 {
 	int ret = BCME_ERROR;
 	osl_t *osh;
 	uint datalen, prec;
+	bool hold;
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
 	osh = bus->dhd->osh;
 	datalen = PKTLEN(osh, pkt);
+	hold = dhdsdio_txhold(bus, pkt);
 
 #ifdef SDTEST
 	/* Push the test header if doing loopback */
@@ -1188,11 +1275,13 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 			PKTFREE(osh, pkt, TRUE);
 			ret = BCME_NORESOURCE;
 		}
-		else
+		else {
+			dql_queued(&bus->txdql, datalen);
 			ret = BCME_OK;
+		}
 		dhd_os_sdunlock_txq(bus->dhd);
 
-		if ((pktq_len(&bus->txq) >= FCHI) && dhd_doflow)
+		if (dhdsdio_txq_over(bus) && dhd_doflow)
 			dhd_txflowcontrol(bus->dhd, ALL_INTERFACES, ON);
 
 #ifdef DHD_DEBUG
@@ -1200,7 +1289,10 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 			qcount[prec] = pktq_plen(&bus->txq, prec);
 #endif
 		/* Schedule DPC if needed to send queued packet(s) */
-		if (dhd_deferred_tx && !bus->dpc_sched) {
+		if (hold) {
+			bus->txhold++;
+			dhd_os_txhold_timer(bus->dhd, dhd_txhold_ms);
+		} else if (dhd_deferred_tx && !bus->dpc_sched) {
 			bus->dpc_sched = TRUE;
 			dhd_sched_dpc(bus->dhd);
 		}
@@ -1250,7 +1342,7 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 	uint retries = 0;
 	int ret = 0, prec_out;
 	uint cnt = 0;
-	uint datalen;
+	uint datalen, bytes = 0;
 	uint8 tx_prec_map;
 
 	dhd_pub_t *dhd = bus->dhd;
@@ -1269,6 +1361,7 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 		}
 		dhd_os_sdunlock_txq(bus->dhd);
 		datalen = PKTLEN(bus->dhd->osh, pkt) - SDPCM_HDRLEN;
+		bytes += datalen;
 
 #ifndef SDTEST
 		ret = dhdsdio_txpkt(bus, pkt, SDPCM_DATA_CHANNEL, TRUE);
@@ -1294,9 +1387,18 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 		}
 	}
 
+	/* Retire the bytes sent; an empty queue also retires any evicted from it */
+	dhd_os_sdlock_txq(bus->dhd);
+	if (!pktq_len(&bus->txq))
+		bytes = bus->txdql.num_queued - bus->txdql.num_completed;
+	if (bytes)
+		dql_completed(&bus->txdql,
+			MIN(bytes, bus->txdql.num_queued - bus->txdql.num_completed));
+	dhd_os_sdunlock_txq(bus->dhd);
+
 	/* Deflow-control stack if needed */
 	if (dhd_doflow && dhd->up && (dhd->busstate == DHD_BUS_DATA) &&
-	    dhd->txoff && (pktq_len(&bus->txq) < FCLOW))
+	    dhd->txoff && dhdsdio_txq_under(bus))
 		dhd_txflowcontrol(dhd, ALL_INTERFACES, OFF);
 
 	return cnt;
@@ -1622,6 +1724,29 @@ dhd_dump_pct(struct bcmstrbuf *strbuf, char *desc, uint num, uint div)
 	}
 }
 
+static void
+dhdsdio_count_batch(uint *hist, uint frames)
+{
+	uint bin = 0;
+
+	if (!frames)
+		return;
+	while ((frames >>= 1) && (bin < SDIO_BATCH_BINS - 1))
+		bin++;
+	hist[bin]++;
+}
+
+static void
+dhdsdio_dump_batch(struct bcmstrbuf *strbuf, char *desc, uint *hist)
+{
+	int i;
+
+	bcm_bprintf(strbuf, "%s", desc);
+	for (i = 0; i < SDIO_BATCH_BINS; i++)
+		bcm_bprintf(strbuf, " %d+:%d", 1 << i, hist[i]);
+	bcm_bprintf(strbuf, "\n");
+}
+
 void
 dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 {
@@ -1646,11 +1771,23 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 	            bus->rx_hdrfail, bus->rx_badhdr, bus->rx_badseq);
 	bcm_bprintf(strbuf, "fc_rcvd %d, fc_xoff %d, fc_xon %d\n",
 	            bus->fc_rcvd, bus->fc_xoff, bus->fc_xon);
-	bcm_bprintf(strbuf, "rxglomfail %d, rxglomframes %d, rxglompkts %d\n",
-	            bus->rxglomfail, bus->rxglomframes, bus->rxglompkts);
+	bcm_bprintf(strbuf, "rxglomfail %d, rxglomframes %d, rxglompkts %d, rxglomcopy %d\n",
+	            bus->rxglomfail, bus->rxglomframes, bus->rxglompkts, bus->rxglomcopy);
 	bcm_bprintf(strbuf, "f2rx (hdrs/data) %d (%d/%d), f2tx %d f1regs %d\n",
 	            (bus->f2rxhdrs + bus->f2rxdata), bus->f2rxhdrs, bus->f2rxdata,
 	            bus->f2txdata, bus->f1regdata);
+	dhdsdio_dump_batch(strbuf, "frames/glom", bus->rxglomhist);
+	dhdsdio_dump_batch(strbuf, "rx frames/dpc", bus->rxbatch);
+	dhdsdio_dump_batch(strbuf, "tx frames/dpc", bus->txbatch);
+	bcm_bprintf(strbuf, "adapt_bound %d rxbound %d", dhd_adapt_bound,
+	            dhd_adapt_bound ? bus->rxbound_cur : dhd_rxbound);
+	dhd_dump_pct(strbuf, ", f2 busy pct", 100 * bus->sd_busy_ms,
+	             (OSL_SYSUPTIME() - bus->sd_util_start));
+	bcm_bprintf(strbuf, "\n");
+	bcm_bprintf(strbuf, "clkwake %d (suspend %d) txhold %d txhold_expired %d\n",
+	            bus->clkwake, bus->clkwake_suspend, bus->txhold, bus->txhold_expired);
+	bcm_bprintf(strbuf, "tx_bql %d txq bytes %u limit %u\n", dhd_tx_bql,
+	            bus->txdql.num_queued - bus->txdql.num_completed, bus->txdql.limit);
 	{
 		dhd_dump_pct(strbuf, "\nRx: pkts/f2rd", bus->dhd->rx_packets,
 		             (bus->f2rxhdrs + bus->f2rxdata));
@@ -1713,8 +1850,15 @@ dhd_bus_clearcounts(dhd_pub_t *dhdp)
 	bus->rxrtx = bus->rx_toolong = bus->rxc_errors = 0;
 	bus->rx_hdrfail = bus->rx_badhdr = bus->rx_badseq = 0;
 	bus->tx_sderrs = bus->fc_rcvd = bus->fc_xoff = bus->fc_xon = 0;
-	bus->rxglomfail = bus->rxglomframes = bus->rxglompkts = 0;
+	bus->rxglomfail = bus->rxglomframes = bus->rxglompkts = bus->rxglomcopy = 0;
 	bus->f2rxhdrs = bus->f2rxdata = bus->f2txdata = bus->f1regdata = 0;
+	bzero(bus->rxglomhist, sizeof(bus->rxglomhist));
+	bzero(bus->rxbatch, sizeof(bus->rxbatch));
+	bzero(bus->txbatch, sizeof(bus->txbatch));
+	bus->sd_busy_ms = bus->sd_busy_us = 0;
+	bus->clkwake = bus->clkwake_suspend = 0;
+	bus->txhold = bus->txhold_expired = 0;
+	bus->sd_util_start = OSL_SYSUPTIME();
 }
 
 #ifdef SDTEST
@@ -3058,6 +3202,7 @@ dhd_bus_stop(struct dhd_bus *bus, bool enforce_mutex)
 
 	/* Clear the data packet queues */
 	pktq_flush(osh, &bus->txq, TRUE, NULL, 0);
+	dql_reset(&bus->txdql);
 
 	/* Clear any held glomming stuff */
 	if (bus->glomd)
@@ -3498,6 +3643,7 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 			                              F2SYNC, bus->dataptr,
 			                              dlen, NULL, NULL, NULL);
 			sublen = (uint16)pktfrombuf(osh, pfirst, 0, dlen, bus->dataptr);
+			bus->rxglomcopy++;
 			if (sublen != dlen) {
 				DHD_ERROR(("%s: FAILED TO COPY, dlen %d sublen %d\n",
 				           __FUNCTION__, dlen, sublen));
@@ -3739,6 +3885,7 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 
 		bus->rxglomframes++;
 		bus->rxglompkts += num;
+		dhdsdio_count_batch(bus->rxglomhist, num);
 	}
 	return num;
 }
@@ -4430,6 +4577,43 @@ dhdsdio_hostmail(dhd_bus_t *bus)
 	return intstatus;
 }
 
+/* Tx frames per DPC pass: enough to drain the queue, within DHD_BOUND_SCALE */
+static uint
+dhdsdio_txbound(dhd_bus_t *bus)
+{
+	uint qlen;
+
+	if (!dhd_adapt_bound)
+		return dhd_txbound;
+
+	qlen = pktq_mlen(&bus->txq, ~bus->flowcontrol);
+	return MIN(MAX(qlen, dhd_txbound), dhd_txbound * DHD_BOUND_SCALE);
+}
+
+static uint
+dhdsdio_rxbound(dhd_bus_t *bus)
+{
+	if (!dhd_adapt_bound)
+		return dhd_rxbound;
+
+	bus->rxbound_cur = MAX(bus->rxbound_cur, dhd_rxbound);
+	bus->rxbound_cur = MIN(bus->rxbound_cur, dhd_rxbound * DHD_BOUND_SCALE);
+	return bus->rxbound_cur;
+}
+
+/* Grow the rx bound while reads hit it, shrink it back once the backlog is gone */
+static void
+dhdsdio_adapt_rxbound(dhd_bus_t *bus, uint framecnt, uint rxlimit, bool rxdone)
+{
+	if (!dhd_adapt_bound)
+		return;
+
+	if (!rxdone && (framecnt >= rxlimit))
+		bus->rxbound_cur = MIN(bus->rxbound_cur * 2, dhd_rxbound * DHD_BOUND_SCALE);
+	else if (rxdone && (framecnt < bus->rxbound_cur / 4))
+		bus->rxbound_cur = MAX(bus->rxbound_cur / 2, dhd_rxbound);
+}
+
 static bool
 dhdsdio_dpc(dhd_bus_t *bus)
 {
@@ -4437,8 +4621,8 @@ dhdsdio_dpc(dhd_bus_t *bus)
 	sdpcmd_regs_t *regs = bus->regs;
 	uint32 intstatus, newstatus = 0;
 	uint retries = 0;
-	uint rxlimit = dhd_rxbound; /* Rx frames to read before resched */
-	uint txlimit = dhd_txbound; /* Tx frames to send before resched */
+	uint rxlimit = dhdsdio_rxbound(bus); /* Rx frames to read before resched */
+	uint txlimit = dhdsdio_txbound(bus); /* Tx frames to send before resched */
 	uint framecnt = 0;		  /* Temporary counter of tx/rx frames */
 	bool rxdone = TRUE;		  /* Flag for no more read data */
 	bool resched = FALSE;	  /* Flag indicating resched wanted */
@@ -4588,6 +4772,8 @@ dhdsdio_dpc(dhd_bus_t *bus)
 		framecnt = dhdsdio_readframes(bus, rxlimit, &rxdone);
 		if (rxdone || bus->rxskip)
 			intstatus  &= ~FRAME_AVAIL_MASK(bus);
+		dhdsdio_count_batch(bus->rxbatch, framecnt);
+		dhdsdio_adapt_rxbound(bus, framecnt, rxlimit, rxdone);
 		rxlimit -= MIN(framecnt, rxlimit);
 	}
 
@@ -4676,6 +4862,7 @@ clkwait:
 	    pktq_mlen(&bus->txq, ~bus->flowcontrol) && txlimit && DATAOK(bus)) {
 		framecnt = rxdone ? txlimit : MIN(txlimit, dhd_txminmax);
 		framecnt = dhdsdio_sendfromq(bus, framecnt);
+		dhdsdio_count_batch(bus->txbatch, framecnt);
 		txlimit -= framecnt;
 	}
 	/* Resched the DPC if ctrl cmd is pending on bus credit */
@@ -5356,6 +5543,7 @@ dhdsdio_probe(uint16 venid, uint16 devid, uint16 bus_no, uint16 slot,
 		goto fail;
 	}
 	bzero(bus, sizeof(dhd_bus_t));
+	bus->sd_util_start = OSL_SYSUPTIME();
 	bus->sdh = sdh;
 	bus->cl_devid = (uint16)devid;
 	bus->bus = DHD_BUS;
@@ -5591,6 +5779,7 @@ dhdsdio_probe_attach(struct dhd_bus *bus, osl_t *osh, void *sdh, void *regsva,
 
 
 	pktq_init(&bus->txq, (PRIOMASK + 1), QLEN);
+	dql_init(&bus->txdql, HZ);
 
 	/* Locate an appropriately-aligned portion of hdrbuf */
 	bus->rxhdr = (uint8 *)ROUNDUP((uintptr)&bus->hdrbuf[0], DHD_SDALIGN);
@@ -6181,13 +6370,25 @@ err:
 	return bcmerror;
 }
 
+static void
+dhdsdio_busy_add(dhd_bus_t *bus, uint32 start)
+{
+	bus->sd_busy_us += dhd_os_time_usec() - start;
+	if (bus->sd_busy_us >= 1000) {
+		bus->sd_busy_ms += bus->sd_busy_us / 1000;
+		bus->sd_busy_us %= 1000;
+	}
+}
+
 static int
 dhd_bcmsdh_recv_buf(dhd_bus_t *bus, uint32 addr, uint fn, uint flags, uint8 *buf, uint nbytes,
 	void *pkt, bcmsdh_cmplt_fn_t complete, void *handle)
 {
 	int status;
+	uint32 start = dhd_os_time_usec();
 
 	status = bcmsdh_recv_buf(bus->sdh, addr, fn, flags, buf, nbytes, pkt, complete, handle);
+	dhdsdio_busy_add(bus, start);
 
 	return status;
 }
@@ -6196,7 +6397,13 @@ static int
 dhd_bcmsdh_send_buf(dhd_bus_t *bus, uint32 addr, uint fn, uint flags, uint8 *buf, uint nbytes,
 	void *pkt, bcmsdh_cmplt_fn_t complete, void *handle)
 {
-	return (bcmsdh_send_buf(bus->sdh, addr, fn, flags, buf, nbytes, pkt, complete, handle));
+	int status;
+	uint32 start = dhd_os_time_usec();
+
+	status = bcmsdh_send_buf(bus->sdh, addr, fn, flags, buf, nbytes, pkt, complete, handle);
+	dhdsdio_busy_add(bus, start);
+
+	return status;
 }
 
 uint
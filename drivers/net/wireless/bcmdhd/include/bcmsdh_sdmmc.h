@@ -86,6 +86,7 @@ struct sdioh_info {
 #define SDIOH_SDMMC_MAX_SG_ENTRIES	32
 	struct scatterlist sg_list[SDIOH_SDMMC_MAX_SG_ENTRIES];
 	bool		use_rxchain;
+	uint		bounce_copies;		/* Unaligned packets copied for DMA */
 };
 
 /************************************************************
@@ -32,6 +32,8 @@
 #include <linux/delay.h>
 #include <linux/timer.h>
 #include <linux/interrupt.h>
+#include <linux/mutex.h>
+#include <linux/earlysuspend.h>
 #include <asm/unaligned.h>
 #include <linux/miscdevice.h>
 #include <mach/gpio.h>
@@ -87,12 +89,30 @@ struct workqueue_struct *battery_work_queue = NULL;
 static int bq27541_get_psp(int reg_offset, enum power_supply_property psp,union power_supply_propval *val);
 static int bq27541_get_property(struct power_supply *psy,
 	enum power_supply_property psp, union power_supply_propval *val);
+static bool bq27541_snapshot_poll(void);
+static unsigned int bq27541_poll_interval(void);
 extern unsigned  get_usb_cable_status(void);
 extern int smb347_charger_enable(bool enable);
 
 module_param(battery_current, uint, 0644);
 module_param(battery_remaining_capacity, uint, 0644);
 
+/* Poll interval in seconds with the screen off and the capacity steady */
+static unsigned int idle_poll_interval = 300;
+module_param(idle_poll_interval, uint, 0644);
+
+/* A change smaller than these alone sends no uevent (0.1 C, mV) */
+static unsigned int temp_hysteresis = 10;
+module_param(temp_hysteresis, uint, 0644);
+static unsigned int volt_hysteresis = 50;
+module_param(volt_hysteresis, uint, 0644);
+
+/* Property reads answered from the snapshot, and snapshots taken */
+static unsigned int snapshot_hits;
+module_param(snapshot_hits, uint, 0444);
+static unsigned int snapshot_reads;
+module_param(snapshot_reads, uint, 0444);
+
 #define BQ27541_DATA(_psp, _addr, _min_value, _max_value)	\
 	{								\
 		.psp = POWER_SUPPLY_PROP_##_psp,	\
@@ -229,6 +249,26 @@ static struct power_supply bq27541_supply[] = {
 #endif
 };
 
+/*
+ * What the gauge said at the last poll.  Property reads, from the uevent
+ * power_supply_changed() sends and from healthd reading sysfs after it,
+ * are answered from here while it is younger than the poll interval.
+ */
+enum {
+	SNAP_STATUS,
+	SNAP_VOLTAGE,
+	SNAP_CAPACITY,
+	SNAP_TEMP,
+	SNAP_NR
+};
+
+struct bq27541_snapshot {
+	int val[SNAP_NR];
+	int ret[SNAP_NR];
+	unsigned long stamp;
+	bool valid;
+};
+
 static struct bq27541_device_info {
 	struct i2c_client *client;
 	struct delayed_work battery_stress_test;
@@ -259,6 +299,14 @@ static struct bq27541_device_info {
 	unsigned int temp_err;
 	unsigned int prj_id;
 	spinlock_t lock;
+	struct mutex snap_lock;
+	struct bq27541_snapshot snap;
+	struct bq27541_snapshot reported;
+	bool steady;
+	bool screen_off;
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	struct early_suspend early_suspend;
+#endif
 } *bq27541_device;
 
 static int bq27541_read_i2c(u8 reg, int *rt_value, int b_single)
@@ -351,10 +399,12 @@ static void battery_status_poll(struct work_struct *work)
 	if(!battery_driver_ready)
 		BAT_NOTICE("battery driver not ready\n");
 
-	power_supply_changed(&bq27541_supply[Charger_Type_Battery]);
+	if (bq27541_snapshot_poll())
+		power_supply_changed(&bq27541_supply[Charger_Type_Battery]);
 
 	/* Schedule next polling */
-	queue_delayed_work(battery_work_queue, &batt_dev->status_poll_work, bat_check_interval*HZ);
+	queue_delayed_work(battery_work_queue, &batt_dev->status_poll_work,
+			   bq27541_poll_interval() * HZ);
 }
 
 static void low_low_battery_check(struct work_struct *work)
@@ -442,6 +492,8 @@ int battery_callback(unsigned usb_cable_state)
 		wake_lock_timeout(&bq27541_device->cable_wake_lock, 5*HZ);
 	}
 	check_cabe_type();
+	/* the status changes with the cable, don't wait for the poll */
+	bq27541_device->snap.valid = false;
 
 	if(!battery_cable_status) {
 		if (old_cable_status == USB_AC_Adapter) {
@@ -700,8 +752,7 @@ static int bq27541_get_capacity(union power_supply_propval *val)
 	return 0;
 }
 
-static int bq27541_get_property(struct power_supply *psy,
-	enum power_supply_property psp,
+static int bq27541_read_property(enum power_supply_property psp,
 	union power_supply_propval *val)
 {
 	u8 count;
@@ -750,6 +801,117 @@ error:
 	return -EINVAL;
 }
 
+static const enum power_supply_property snap_psp[SNAP_NR] = {
+	[SNAP_STATUS]	= POWER_SUPPLY_PROP_STATUS,
+	[SNAP_VOLTAGE]	= POWER_SUPPLY_PROP_VOLTAGE_NOW,
+	[SNAP_CAPACITY]	= POWER_SUPPLY_PROP_CAPACITY,
+	[SNAP_TEMP]	= POWER_SUPPLY_PROP_TEMP,
+};
+
+/* Reads the gauge into the snapshot, status first, with snap_lock held */
+static void bq27541_snapshot_read(void)
+{
+	struct bq27541_snapshot *s = &bq27541_device->snap;
+	union power_supply_propval val;
+	int i;
+
+	for (i = 0; i < SNAP_NR; i++) {
+		val.intval = 0;
+		s->ret[i] = bq27541_read_property(snap_psp[i], &val);
+		s->val[i] = val.intval;
+	}
+	s->stamp = jiffies;
+	s->valid = true;
+	snapshot_reads++;
+}
+
+/* bat_check_interval, stretched while nothing is happening */
+static unsigned int bq27541_poll_interval(void)
+{
+	if (bq27541_device->screen_off && bq27541_device->steady &&
+	    bat_check_interval == BATTERY_POLLING_RATE &&
+	    idle_poll_interval > bat_check_interval)
+		return idle_poll_interval;
+	return bat_check_interval;
+}
+
+/*
+ * Takes the poll's snapshot.  Returns true if it moved far enough from
+ * the one last sent out to be worth a uevent.
+ */
+static bool bq27541_snapshot_poll(void)
+{
+	struct bq27541_device_info *di = bq27541_device;
+	struct bq27541_snapshot *s = &di->snap, *r = &di->reported;
+	bool changed;
+	int i;
+
+	mutex_lock(&di->snap_lock);
+	bq27541_snapshot_read();
+
+	/* a capacity change is always sent, so r has the last one */
+	di->steady = r->valid &&
+		s->val[SNAP_STATUS] == POWER_SUPPLY_STATUS_DISCHARGING &&
+		s->val[SNAP_CAPACITY] == r->val[SNAP_CAPACITY];
+
+	changed = !r->valid ||
+		s->val[SNAP_STATUS] != r->val[SNAP_STATUS] ||
+		s->val[SNAP_CAPACITY] != r->val[SNAP_CAPACITY] ||
+		abs(s->val[SNAP_TEMP] - r->val[SNAP_TEMP]) >=
+			(int)temp_hysteresis ||
+		abs(s->val[SNAP_VOLTAGE] - r->val[SNAP_VOLTAGE]) >=
+			(int)volt_hysteresis * 1000;
+	for (i = 0; i < SNAP_NR; i++)
+		if (s->ret[i] != r->ret[i])
+			changed = true;
+	if (changed)
+		*r = *s;
+	mutex_unlock(&di->snap_lock);
+	return changed;
+}
+
+static int bq27541_get_property(struct power_supply *psy,
+	enum power_supply_property psp,
+	union power_supply_propval *val)
+{
+	struct bq27541_device_info *di = bq27541_device;
+	int i, ret;
+
+	for (i = 0; i < SNAP_NR; i++)
+		if (snap_psp[i] == psp)
+			break;
+	if (i == SNAP_NR)
+		return bq27541_read_property(psp, val);
+
+	mutex_lock(&di->snap_lock);
+	if (di->snap.valid && time_before(jiffies,
+			di->snap.stamp + bq27541_poll_interval() * HZ))
+		snapshot_hits++;
+	else
+		bq27541_snapshot_read();
+	val->intval = di->snap.val[i];
+	ret = di->snap.ret[i];
+	mutex_unlock(&di->snap_lock);
+	return ret;
+}
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void bq27541_early_suspend(struct early_suspend *h)
+{
+	bq27541_device->screen_off = true;
+}
+
+static void bq27541_late_resume(struct early_suspend *h)
+{
+	bq27541_device->screen_off = false;
+	/* back from a stretched interval to the usual one */
+	cancel_delayed_work(&bq27541_device->status_poll_work);
+	queue_delayed_work(battery_work_queue,
+			   &bq27541_device->status_poll_work,
+			   bat_check_interval * HZ);
+}
+#endif
+
 static int is_legal_pack(void)
 {
 	char data[7];
@@ -818,6 +980,7 @@ static int bq27541_probe(struct i2c_client *client,
 	cancel_delayed_work(&bq27541_device->status_poll_work);
 
 	spin_lock_init(&bq27541_device->lock);
+	mutex_init(&bq27541_device->snap_lock);
 	wake_lock_init(&bq27541_device->low_battery_wake_lock, WAKE_LOCK_SUSPEND, "low_battery_detection");
 	wake_lock_init(&bq27541_device->cable_wake_lock, WAKE_LOCK_SUSPEND, "cable_state_changed");
 
@@ -838,6 +1001,13 @@ static int bq27541_probe(struct i2c_client *client,
 
 	setup_low_battery_irq();
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	bq27541_device->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN;
+	bq27541_device->early_suspend.suspend = bq27541_early_suspend;
+	bq27541_device->early_suspend.resume = bq27541_late_resume;
+	register_early_suspend(&bq27541_device->early_suspend);
+#endif
+
 	battery_driver_ready = 1;
 
 	battery_cable_status = get_usb_cable_status();
@@ -858,6 +1028,9 @@ static int bq27541_remove(struct i2c_client *client)
 		power_supply_unregister(&bq27541_supply[i]);
 	}
 	if (bq27541_device) {
+#ifdef CONFIG_HAS_EARLYSUSPEND
+		unregister_early_suspend(&bq27541_device->early_suspend);
+#endif
 		wake_lock_destroy(&bq27541_device->low_battery_wake_lock);
 		wake_lock_destroy(&bq27541_device->cable_wake_lock);
 		kfree(bq27541_device);
@@ -877,6 +1050,8 @@ static int bq27541_suspend(struct i2c_client *client, pm_message_t state)
 /* any smbus transaction will wake up pad */
 static int bq27541_resume(struct i2c_client *client)
 {
+	/* jiffies stood still in suspend, the snapshot only looks fresh */
+	bq27541_device->snap.valid = false;
 	cancel_delayed_work(&bq27541_device->status_poll_work);
 	queue_delayed_work(battery_work_queue,&bq27541_device->status_poll_work, 5*HZ);
 
@@ -35,6 +35,8 @@
 #include <linux/completion.h>
 #include <linux/kthread.h>
 #include <linux/pm_runtime.h>
+#include <linux/module.h>
+#include <linux/ktime.h>
 
 #include <linux/spi/spi.h>
 #include <linux/spi-tegra.h>
@@ -42,6 +44,9 @@
 #include <mach/dma.h>
 #include <mach/clk.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/spi_tegra.h>
+
 #define SLINK_COMMAND		0x000
 #define   SLINK_BIT_LENGTH(x)		(((x) & 0x1f) << 0)
 #define   SLINK_WORD_SIZE(x)		(((x) & 0x1f) << 5)
@@ -146,6 +151,17 @@
 
 #define SPI_FIFO_DEPTH		32
 #define SLINK_DMA_TIMEOUT (msecs_to_jiffies(1000))
+#define SLINK_POLL_TIMEOUT_US	10000
+
+/*
+ * A message whose transfers each fit in the FIFO, and that moves no more
+ * than this many bytes in all, is run by the transfer work polling the
+ * controller, with no interrupt per transfer.  The touch controller's
+ * reads are of this kind: many one byte transfers with short delays in
+ * between.  0 turns polling off.
+ */
+static unsigned int poll_max_bytes = 64;
+module_param(poll_max_bytes, uint, 0644);
 
 
 static const unsigned long spi_tegra_req_sels[] = {
@@ -245,6 +261,11 @@ struct spi_tegra_data {
 	int			min_div;
 	struct workqueue_struct *spi_workqueue;
 	struct work_struct spi_transfer_work;
+
+	bool			is_polled;	/* current message, no irqs */
+	ktime_t			msg_start;
+	unsigned		msg_xfers;
+	unsigned		msg_irqs;
 };
 
 static inline unsigned long spi_tegra_readl(struct spi_tegra_data *tspi,
@@ -291,6 +312,19 @@ static void spi_tegra_clear_status(struct spi_tegra_data *tspi)
 	spi_tegra_writel(tspi, val_write, SLINK_STATUS);
 }
 
+static bool spi_tegra_can_poll(struct spi_message *m)
+{
+	struct spi_transfer *t;
+	unsigned total = 0;
+
+	list_for_each_entry(t, &m->transfers, transfer_list) {
+		if (t->len > SPI_FIFO_DEPTH)
+			return false;
+		total += t->len;
+	}
+	return total <= poll_max_bytes;
+}
+
 static unsigned long spi_tegra_get_packed_size(struct spi_tegra_data *tspi,
 				  struct spi_transfer *t)
 {
@@ -598,10 +632,10 @@ static int spi_tegra_start_cpu_based_transfer(
 	unsigned curr_words;
 
 	val = tspi->packed_size;
-	if (tspi->cur_direction & DATA_DIR_TX)
+	if ((tspi->cur_direction & DATA_DIR_TX) && !tspi->is_polled)
 		val |= SLINK_IE_TXC;
 
-	if (tspi->cur_direction & DATA_DIR_RX)
+	if ((tspi->cur_direction & DATA_DIR_RX) && !tspi->is_polled)
 		val |= SLINK_IE_RXC;
 
 	spi_tegra_writel(tspi, val, SLINK_DMA_CTL);
@@ -695,6 +729,7 @@ static void spi_tegra_start_transfer(struct spi_device *spi,
 	unsigned total_fifo_words;
 	int ret;
 	struct tegra_spi_device_controller_data *cdata = spi->controller_data;
+	struct spi_message *m;
 	unsigned long command;
 	unsigned long command2;
 #ifndef CONFIG_ARCH_TEGRA_2x_SOC
@@ -731,6 +766,12 @@ static void spi_tegra_start_transfer(struct spi_device *spi,
 
 	command2 = tspi->def_command2_reg;
 	if (is_first_of_msg) {
+		m = list_first_entry(&tspi->queue, struct spi_message, queue);
+		tspi->is_polled = spi_tegra_can_poll(m);
+		tspi->msg_start = ktime_get();
+		tspi->msg_xfers = 0;
+		tspi->msg_irqs = 0;
+
 		if (!tspi->is_clkon_always) {
 			if (!tspi->clk_state) {
 				pm_runtime_get_sync(&tspi->pdev->dev);
@@ -872,6 +913,8 @@ static int spi_tegra_setup(struct spi_device *spi)
 	return 0;
 }
 
+static void spi_tegra_run_polled(struct spi_tegra_data *tspi);
+
 static void tegra_spi_transfer_work(struct work_struct *work)
 {
 	struct spi_tegra_data *tspi;
@@ -904,6 +947,7 @@ static void tegra_spi_transfer_work(struct work_struct *work)
 
 	spin_unlock_irqrestore(&tspi->lock, flags);
 	spi_tegra_start_transfer(spi, t, true, single_xfer);
+	spi_tegra_run_polled(tspi);
 }
 
 static int spi_tegra_transfer(struct spi_device *spi, struct spi_message *m)
@@ -974,6 +1018,7 @@ static void spi_tegra_curr_transfer_complete(struct spi_tegra_data *tspi,
 	spi = m->state;
 
 	m->actual_length += cur_xfer_size;
+	tspi->msg_xfers++;
 
 	if (!list_is_last(&tspi->cur->transfer_list, &m->transfers)) {
 		tspi->cur = list_first_entry(&tspi->cur->transfer_list,
@@ -983,6 +1028,10 @@ static void spi_tegra_curr_transfer_complete(struct spi_tegra_data *tspi,
 		spin_lock_irqsave(&tspi->lock, *irq_flags);
 	} else {
 		list_del(&m->queue);
+		trace_spi_tegra_message(tspi->master->bus_num,
+			spi->chip_select, m->actual_length, tspi->msg_xfers,
+			tspi->msg_irqs, tspi->is_polled,
+			ktime_us_delta(ktime_get(), tspi->msg_start));
 		m->complete(m->context);
 		if (!list_empty(&tspi->queue)) {
 			if (tspi->is_suspended) {
@@ -995,6 +1044,13 @@ static void spi_tegra_curr_transfer_complete(struct spi_tegra_data *tspi,
 			}
 			m = list_first_entry(&tspi->queue, struct spi_message,
 				queue);
+			/* only the transfer work polls, hand it over */
+			if (!tspi->is_polled && spi_tegra_can_poll(m)) {
+				tspi->is_transfer_in_progress = false;
+				queue_work(tspi->spi_workqueue,
+					&tspi->spi_transfer_work);
+				return;
+			}
 			spi = m->state;
 			single_xfer = list_is_singular(&m->transfers);
 			m->actual_length = 0;
@@ -1093,6 +1149,42 @@ exit:
 	return;
 }
 
+/*
+ * Waits for the polled transfer started last to finish, then does what
+ * spi_tegra_isr() and its thread would have done for it.
+ */
+static void spi_tegra_poll_xfer(struct spi_tegra_data *tspi)
+{
+	unsigned long status;
+	int us;
+
+	for (us = 0; us < SLINK_POLL_TIMEOUT_US; us++) {
+		status = spi_tegra_readl(tspi, SLINK_STATUS);
+		if (status & SLINK_RDY)
+			break;
+		udelay(1);
+	}
+	/* one that never finished is handled as a busy error */
+	if (us == SLINK_POLL_TIMEOUT_US)
+		status |= SLINK_BSY;
+
+	tspi->status_reg = status;
+	if (tspi->cur_direction & DATA_DIR_TX)
+		tspi->tx_status = status & (SLINK_TX_OVF | SLINK_TX_UNF);
+	if (tspi->cur_direction & DATA_DIR_RX)
+		tspi->rx_status = status & (SLINK_RX_OVF | SLINK_RX_UNF);
+	spi_tegra_clear_status(tspi);
+
+	handle_cpu_based_xfer(tspi);
+}
+
+/* Runs polled messages to the end, called from the transfer work only */
+static void spi_tegra_run_polled(struct spi_tegra_data *tspi)
+{
+	while (tspi->is_polled && tspi->is_transfer_in_progress)
+		spi_tegra_poll_xfer(tspi);
+}
+
 static irqreturn_t spi_tegra_isr_thread(int irq, void *context_data)
 {
 	struct spi_tegra_data *tspi = context_data;
@@ -1187,6 +1279,7 @@ static irqreturn_t spi_tegra_isr(int irq, void *context_data)
 {
 	struct spi_tegra_data *tspi = context_data;
 
+	tspi->msg_irqs++;
 	tspi->status_reg = spi_tegra_readl(tspi, SLINK_STATUS);
 	if (tspi->cur_direction & DATA_DIR_TX)
 		tspi->tx_status = tspi->status_reg &
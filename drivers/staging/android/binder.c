@@ -34,10 +34,12 @@
 #include <linux/uaccess.h>
 #include <linux/vmalloc.h>
 #include <linux/security.h>
+#include <linux/frame_trace.h>
 
 #include "binder.h"
+#include "binder_trace.h"
 
-static DEFINE_MUTEX(binder_lock);
+static DEFINE_MUTEX(binder_main_lock);
 static DEFINE_MUTEX(binder_deferred_lock);
 
 static HLIST_HEAD(binder_procs);
@@ -68,6 +70,84 @@ static const struct file_operations binder_##name##_fops = { \
 static int binder_proc_show(struct seq_file *m, void *unused);
 BINDER_DEBUG_ENTRY(proc);
 
+/*
+ * binder_main_lock still serializes all of binder.  It is taken through
+ * binder_lock(), which records per call site how often the lock was
+ * contended, how long it was waited for and how long it was held, for
+ * debugfs "lock_stats".
+ */
+enum binder_lock_site {
+	BINDER_LOCK_IOCTL,
+	BINDER_LOCK_READ,	/* taken again after waiting for work */
+	BINDER_LOCK_POLL,
+	BINDER_LOCK_OPEN,
+	BINDER_LOCK_DEFERRED,
+	BINDER_LOCK_DEBUGFS,
+	BINDER_LOCK_NR_SITES,
+};
+
+static const char * const binder_lock_site_names[] = {
+	"ioctl",
+	"read",
+	"poll",
+	"open",
+	"deferred",
+	"debugfs",
+};
+
+struct binder_lock_stats {
+	u64 acquired;
+	u64 contended;
+	u64 wait_ns;
+	u64 max_wait_ns;
+	u64 hold_ns;
+	u64 max_hold_ns;
+};
+
+/* These are only written with binder_main_lock held */
+static struct binder_lock_stats binder_lock_stats[BINDER_LOCK_NR_SITES];
+static enum binder_lock_site binder_lock_site;
+static u64 binder_lock_time;
+
+static void binder_lock(enum binder_lock_site site)
+{
+	struct binder_lock_stats *stats = &binder_lock_stats[site];
+	u64 start, now;
+
+	trace_binder_lock(binder_lock_site_names[site]);
+	if (mutex_trylock(&binder_main_lock)) {
+		now = local_clock();
+	} else {
+		start = local_clock();
+		mutex_lock(&binder_main_lock);
+		now = local_clock();
+		stats->contended++;
+		if (now > start) {
+			stats->wait_ns += now - start;
+			if (now - start > stats->max_wait_ns)
+				stats->max_wait_ns = now - start;
+		}
+	}
+	stats->acquired++;
+	binder_lock_site = site;
+	binder_lock_time = now;
+	trace_binder_locked(binder_lock_site_names[site]);
+}
+
+static void binder_unlock(void)
+{
+	struct binder_lock_stats *stats = &binder_lock_stats[binder_lock_site];
+	u64 now = local_clock();
+
+	trace_binder_unlock(binder_lock_site_names[binder_lock_site]);
+	if (now > binder_lock_time) {
+		stats->hold_ns += now - binder_lock_time;
+		if (now - binder_lock_time > stats->max_hold_ns)
+			stats->max_hold_ns = now - binder_lock_time;
+	}
+	mutex_unlock(&binder_main_lock);
+}
+
 /* This is only defined in include/asm-arm/sizes.h */
 #ifndef SZ_1K
 #define SZ_1K                               0x400
@@ -106,6 +186,10 @@ module_param_named(debug_mask, binder_debug_mask, uint, S_IWUSR | S_IRUGO);
 static int binder_debug_no_lock;
 module_param_named(proc_no_lock, binder_debug_no_lock, bool, S_IWUSR | S_IRUGO);
 
+/* Let SCHED_FIFO and SCHED_RR callers pass their policy on to the callee */
+static int binder_inherit_rt = 1;
+module_param_named(inherit_rt, binder_inherit_rt, bool, S_IWUSR | S_IRUGO);
+
 static DECLARE_WAIT_QUEUE_HEAD(binder_user_error_wait);
 static int binder_stop_on_user_error;
 
@@ -151,6 +235,8 @@ struct binder_stats {
 	int bc[_IOC_NR(BC_DEAD_BINDER_DONE) + 1];
 	int obj_created[BINDER_STAT_COUNT];
 	int obj_deleted[BINDER_STAT_COUNT];
+	int wakeups;		/* looper woken up for process work */
+	int spurious_wakeups;	/* ... and found none left */
 };
 
 static struct binder_stats binder_stats;
@@ -211,6 +297,20 @@ struct binder_work {
 	} type;
 };
 
+/*
+ * Log2 histograms of how long transactions wait in a todo list before a
+ * thread picks them up, and of how long that thread takes to reply, in
+ * microseconds: bucket 0 is under 1us, bucket n is [2^(n-1), 2^n) us and
+ * the last one holds everything longer.  Only updated with
+ * binder_main_lock held.
+ */
+#define BINDER_LAT_BUCKETS	20
+
+struct binder_latency {
+	u32 queue[BINDER_LAT_BUCKETS];
+	u32 service[BINDER_LAT_BUCKETS];
+};
+
 struct binder_node {
 	int debug_id;
 	struct binder_work work;
@@ -231,8 +331,10 @@ struct binder_node {
 	unsigned pending_weak_ref:1;
 	unsigned has_async_transaction:1;
 	unsigned accept_fds:1;
-	unsigned min_priority:8;
+	unsigned sched_policy:2;
+	int min_priority;	/* kernel priority */
 	struct list_head async_todo;
+	struct binder_latency *latency;	/* allocated on first use */
 };
 
 struct binder_ref_death {
@@ -280,6 +382,21 @@ enum binder_deferred_state {
 	BINDER_DEFERRED_RELEASE      = 0x04,
 };
 
+/*
+ * A scheduling policy with a kernel priority, as in task->normal_prio,
+ * so that lower is more important whatever the policy.
+ */
+struct binder_priority {
+	unsigned int sched_policy;
+	int prio;
+};
+
+struct binder_lru_page {
+	struct list_head lru;		/* on binder_lru while unused */
+	struct page *page_ptr;
+	struct binder_proc *proc;
+};
+
 struct binder_proc {
 	struct hlist_node proc_node;
 	struct rb_root threads;
@@ -295,23 +412,32 @@ struct binder_proc {
 	void *buffer;
 	ptrdiff_t user_buffer_offset;
 
+	/*
+	 * The buffer allocator state below is changed only with alloc_lock
+	 * held, besides binder_main_lock, in binder_alloc_buf() and
+	 * binder_free_buf().  Holding either of the two is enough to read it.
+	 */
+	struct mutex alloc_lock;
 	struct list_head buffers;
 	struct rb_root free_buffers;
 	struct rb_root allocated_buffers;
 	size_t free_async_space;
 
-	struct page **pages;
+	struct binder_lru_page *pages;
+	struct mm_struct *vma_vm_mm;
 	size_t buffer_size;
 	uint32_t buffer_free;
 	struct list_head todo;
-	wait_queue_head_t wait;
+	wait_queue_head_t wait;		/* for poll() */
+	struct list_head waiting_threads;
 	struct binder_stats stats;
 	struct list_head delivered_death;
 	int max_threads;
 	int requested_threads;
 	int requested_threads_started;
 	int ready_threads;
-	long default_priority;
+	struct binder_priority default_priority;
+	struct binder_latency latency;
 	struct dentry *debugfs_entry;
 };
 
@@ -331,6 +457,7 @@ struct binder_thread {
 	int looper;
 	struct binder_transaction *transaction_stack;
 	struct list_head todo;
+	struct list_head waiting_thread_node;	/* on proc->waiting_threads */
 	uint32_t return_error; /* Write failed, return error code in read buf */
 	uint32_t return_error2; /* Write failed, return error code in read */
 		/* buffer. Used when sending a reply to a dead process that */
@@ -353,9 +480,11 @@ struct binder_transaction {
 	struct binder_buffer *buffer;
 	unsigned int	code;
 	unsigned int	flags;
-	long	priority;
-	long	saved_priority;
+	struct binder_priority	priority;
+	struct binder_priority	saved_priority;
 	uid_t	sender_euid;
+	u64	send_ns;	/* local_clock() when queued */
+	u64	recv_ns;	/* local_clock() when picked up */
 };
 
 static void
@@ -499,21 +628,123 @@ out_unlock:
 	return -EBADF;
 }
 
-static void binder_set_nice(long nice)
+#define BINDER_NICE_TO_PRIO(nice)	(MAX_RT_PRIO + (nice) + 20)
+#define BINDER_PRIO_TO_NICE(prio)	((prio) - MAX_RT_PRIO - 20)
+
+static bool binder_is_rt_policy(int policy)
+{
+	return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+static int to_userspace_prio(int policy, int kernel_priority)
 {
-	long min_nice;
-	if (can_nice(current, nice)) {
-		set_user_nice(current, nice);
+	if (binder_is_rt_policy(policy))
+		return MAX_USER_RT_PRIO - 1 - kernel_priority;
+	return BINDER_PRIO_TO_NICE(kernel_priority);
+}
+
+static int to_kernel_prio(int policy, int user_priority)
+{
+	if (binder_is_rt_policy(policy))
+		return MAX_USER_RT_PRIO - 1 - user_priority;
+	return BINDER_NICE_TO_PRIO(user_priority);
+}
+
+static struct binder_priority binder_current_priority(void)
+{
+	struct binder_priority prio;
+
+	prio.sched_policy = current->policy;
+	prio.prio = current->normal_prio;
+	if (!binder_is_rt_policy(prio.sched_policy) || !binder_inherit_rt) {
+		/* SCHED_IDLE, and RT unless inherited, pass on as a nice value */
+		if (prio.sched_policy != SCHED_BATCH)
+			prio.sched_policy = SCHED_NORMAL;
+		prio.prio = current->static_prio;
+	}
+	return prio;
+}
+
+/*
+ * Switch current to a policy and priority, within what its RLIMIT_RTPRIO
+ * and RLIMIT_NICE allow unless it has CAP_SYS_NICE.
+ */
+static void binder_set_priority(struct binder_priority desired)
+{
+	unsigned int policy = desired.sched_policy;
+	int priority = to_userspace_prio(policy, desired.prio);
+	bool has_cap_nice;
+
+	if (current->policy == policy && current->normal_prio == desired.prio)
 		return;
+
+	has_cap_nice = has_capability_noaudit(current, CAP_SYS_NICE);
+
+	if (binder_is_rt_policy(policy) && !has_cap_nice) {
+		unsigned long max_rtprio = rlimit(RLIMIT_RTPRIO);
+
+		if (max_rtprio == 0) {
+			policy = SCHED_NORMAL;
+			priority = -20;
+		} else if (priority > max_rtprio) {
+			priority = max_rtprio;
+		}
 	}
-	min_nice = 20 - current->signal->rlim[RLIMIT_NICE].rlim_cur;
-	binder_debug(BINDER_DEBUG_PRIORITY_CAP,
-		     "binder: %d: nice value %ld not allowed use "
-		     "%ld instead\n", current->pid, nice, min_nice);
-	set_user_nice(current, min_nice);
-	if (min_nice < 20)
+
+	if (!binder_is_rt_policy(policy) && !has_cap_nice) {
+		long min_nice = 20 - (long)rlimit(RLIMIT_NICE);
+
+		if (min_nice > 19) {
+			binder_user_error("binder: %d RLIMIT_NICE not set\n",
+					  current->pid);
+			return;
+		}
+		if (priority < min_nice)
+			priority = min_nice;
+	}
+
+	if (policy != desired.sched_policy ||
+	    to_kernel_prio(policy, priority) != desired.prio)
+		binder_debug(BINDER_DEBUG_PRIORITY_CAP,
+			     "binder: %d: priority %d not allowed, "
+			     "using %d instead\n", current->pid, desired.prio,
+			     to_kernel_prio(policy, priority));
+
+	if (current->policy != policy || binder_is_rt_policy(policy)) {
+		struct sched_param params;
+
+		params.sched_priority = binder_is_rt_policy(policy) ?
+			priority : 0;
+		sched_setscheduler_nocheck(current,
+					   policy | SCHED_RESET_ON_FORK,
+					   &params);
+	}
+	if (!binder_is_rt_policy(policy))
+		set_user_nice(current, priority);
+}
+
+/*
+ * Called by the thread that picked up t.  A synchronous call runs at the
+ * priority of its caller, or of the node minimum if that is higher.  An
+ * asynchronous one only gets the node minimum.
+ */
+static void binder_transaction_priority(struct binder_transaction *t,
+					struct binder_node *node)
+{
+	struct binder_priority desired = t->priority;
+	struct binder_priority node_prio;
+
+	node_prio.sched_policy = node->sched_policy;
+	node_prio.prio = node->min_priority;
+
+	if (t->flags & TF_ONE_WAY) {
+		if (node_prio.prio < t->saved_priority.prio)
+			binder_set_priority(node_prio);
 		return;
-	binder_user_error("binder: %d RLIMIT_NICE not set\n", current->pid);
+	}
+	if (node_prio.prio < desired.prio)
+		desired = node_prio;
+	binder_set_priority(desired);
 }
 
 static size_t binder_buffer_size(struct binder_proc *proc,
@@ -608,6 +839,50 @@ static struct binder_buffer *binder_buffer_lookup(struct binder_proc *proc,
 	return NULL;
 }
 
+/*
+ * Pages of a freed buffer stay mapped, in the kernel and in the process,
+ * and go on binder_lru instead.  Allocating a buffer over them again just
+ * takes them off the list, so that small transactions, which keep reusing
+ * the start of the buffer space, allocate and map nothing.  The shrinker
+ * unmaps and frees pages from the cold end of the list under memory
+ * pressure.
+ *
+ * Lock ordering:
+ *  ->proc->alloc_lock
+ *   ->mm->mmap_sem
+ *   ->binder_lru_lock
+ * The shrinker takes binder_lru_lock first, so it only trylocks the others.
+ */
+static DEFINE_SPINLOCK(binder_lru_lock);
+static LIST_HEAD(binder_lru);
+static unsigned long binder_lru_count;
+
+/* Called with binder_lru_lock held */
+static void binder_lru_del(struct binder_lru_page *page)
+{
+	if (!list_empty(&page->lru)) {
+		list_del_init(&page->lru);
+		binder_lru_count--;
+	}
+}
+
+static void binder_lru_add_range(struct binder_proc *proc,
+				 void *start, void *end)
+{
+	struct binder_lru_page *page;
+	void *page_addr;
+
+	spin_lock(&binder_lru_lock);
+	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
+		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		if (page->page_ptr && list_empty(&page->lru)) {
+			list_add_tail(&page->lru, &binder_lru);
+			binder_lru_count++;
+		}
+	}
+	spin_unlock(&binder_lru_lock);
+}
+
 static int binder_update_page_range(struct binder_proc *proc, int allocate,
 				    void *start, void *end,
 				    struct vm_area_struct *vma)
@@ -615,8 +890,9 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	void *page_addr;
 	unsigned long user_page_addr;
 	struct vm_struct tmp_area;
-	struct page **page;
+	struct binder_lru_page *page;
 	struct mm_struct *mm;
+	int need_map = 0;
 
 	binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "binder: %d: %s pages %p-%p\n", proc->pid,
@@ -625,6 +901,23 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	if (end <= start)
 		return 0;
 
+	if (allocate == 0) {
+		binder_lru_add_range(proc, start, end);
+		return 0;
+	}
+
+	spin_lock(&binder_lru_lock);
+	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
+		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		if (page->page_ptr)
+			binder_lru_del(page);
+		else
+			need_map = 1;
+	}
+	spin_unlock(&binder_lru_lock);
+	if (!need_map)
+		return 0;
+
 	if (vma)
 		mm = NULL;
 	else
@@ -635,9 +928,6 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		vma = proc->vma;
 	}
 
-	if (allocate == 0)
-		goto free_range;
-
 	if (vma == NULL) {
 		printk(KERN_ERR "binder: %d: binder_alloc_buf failed to "
 		       "map pages in userspace, no vma\n", proc->pid);
@@ -649,16 +939,17 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		struct page **page_array_ptr;
 		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
 
-		BUG_ON(*page);
-		*page = alloc_page(GFP_KERNEL | __GFP_ZERO);
-		if (*page == NULL) {
+		if (page->page_ptr)
+			continue;
+		page->page_ptr = alloc_page(GFP_KERNEL | __GFP_ZERO);
+		if (page->page_ptr == NULL) {
 			printk(KERN_ERR "binder: %d: binder_alloc_buf failed "
 			       "for page at %p\n", proc->pid, page_addr);
 			goto err_alloc_page_failed;
 		}
 		tmp_area.addr = page_addr;
 		tmp_area.size = PAGE_SIZE + PAGE_SIZE /* guard page? */;
-		page_array_ptr = page;
+		page_array_ptr = &page->page_ptr;
 		ret = map_vm_area(&tmp_area, PAGE_KERNEL, &page_array_ptr);
 		if (ret) {
 			printk(KERN_ERR "binder: %d: binder_alloc_buf failed "
@@ -668,7 +959,7 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		}
 		user_page_addr =
 			(uintptr_t)page_addr + proc->user_buffer_offset;
-		ret = vm_insert_page(vma, user_page_addr, page[0]);
+		ret = vm_insert_page(vma, user_page_addr, page->page_ptr);
 		if (ret) {
 			printk(KERN_ERR "binder: %d: binder_alloc_buf failed "
 			       "to map page at %lx in userspace\n",
@@ -683,32 +974,96 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	}
 	return 0;
 
-free_range:
-	for (page_addr = end - PAGE_SIZE; page_addr >= start;
-	     page_addr -= PAGE_SIZE) {
-		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
-		if (vma)
-			zap_page_range(vma, (uintptr_t)page_addr +
-				proc->user_buffer_offset, PAGE_SIZE, NULL);
 err_vm_insert_page_failed:
-		unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
+	unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
 err_map_kernel_failed:
-		__free_page(*page);
-		*page = NULL;
+	__free_page(page->page_ptr);
+	page->page_ptr = NULL;
 err_alloc_page_failed:
-		;
-	}
 err_no_vma:
 	if (mm) {
 		up_write(&mm->mmap_sem);
 		mmput(mm);
 	}
+	/* The pages that did get mapped are free for the next buffer */
+	binder_lru_add_range(proc, start, end);
 	return -ENOMEM;
 }
 
-static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
-					      size_t data_size,
-					      size_t offsets_size, int is_async)
+/*
+ * Called with proc->alloc_lock held, and the page off the lru.  Returns
+ * false if the page is still mapped in userspace and could not be
+ * unmapped without waiting.
+ */
+static bool binder_free_lru_page(struct binder_proc *proc,
+				 struct binder_lru_page *page)
+{
+	void *page_addr = proc->buffer +
+		(page - proc->pages) * PAGE_SIZE;
+	struct mm_struct *mm = proc->vma_vm_mm;
+
+	if (mm && atomic_inc_not_zero(&mm->mm_users)) {
+		if (!down_read_trylock(&mm->mmap_sem)) {
+			mmput(mm);
+			return false;
+		}
+		if (proc->vma)
+			zap_page_range(proc->vma, (uintptr_t)page_addr +
+				proc->user_buffer_offset, PAGE_SIZE, NULL);
+		up_read(&mm->mmap_sem);
+		mmput(mm);
+	}
+	unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
+	__free_page(page->page_ptr);
+	page->page_ptr = NULL;
+	return true;
+}
+
+static int binder_shrink(struct shrinker *shrink, struct shrink_control *sc)
+{
+	int nr_to_scan = sc->nr_to_scan;
+	struct binder_lru_page *page;
+	struct binder_proc *proc;
+
+	if (!nr_to_scan)
+		goto out;
+
+	spin_lock(&binder_lru_lock);
+	while (nr_to_scan-- && !list_empty(&binder_lru)) {
+		page = list_first_entry(&binder_lru, struct binder_lru_page,
+					lru);
+		proc = page->proc;
+		if (!mutex_trylock(&proc->alloc_lock)) {
+			/* the owner is allocating, try it next round */
+			list_move_tail(&page->lru, &binder_lru);
+			continue;
+		}
+		binder_lru_del(page);
+		spin_unlock(&binder_lru_lock);
+
+		if (!binder_free_lru_page(proc, page)) {
+			spin_lock(&binder_lru_lock);
+			list_add_tail(&page->lru, &binder_lru);
+			binder_lru_count++;
+			spin_unlock(&binder_lru_lock);
+		}
+		mutex_unlock(&proc->alloc_lock);
+		spin_lock(&binder_lru_lock);
+	}
+	spin_unlock(&binder_lru_lock);
+out:
+	return binder_lru_count;
+}
+
+static struct shrinker binder_shrinker = {
+	.shrink = binder_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static struct binder_buffer *__binder_alloc_buf(struct binder_proc *proc,
+						size_t data_size,
+						size_t offsets_size,
+						int is_async)
 {
 	struct rb_node *n = proc->free_buffers.rb_node;
 	struct binder_buffer *buffer;
@@ -869,8 +1224,20 @@ static void binder_delete_free_buffer(struct binder_proc *proc,
 	}
 }
 
-static void binder_free_buf(struct binder_proc *proc,
-			    struct binder_buffer *buffer)
+static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
+					      size_t data_size,
+					      size_t offsets_size, int is_async)
+{
+	struct binder_buffer *buffer;
+
+	mutex_lock(&proc->alloc_lock);
+	buffer = __binder_alloc_buf(proc, data_size, offsets_size, is_async);
+	mutex_unlock(&proc->alloc_lock);
+	return buffer;
+}
+
+static void __binder_free_buf(struct binder_proc *proc,
+			      struct binder_buffer *buffer)
 {
 	size_t size, buffer_size;
 
@@ -924,6 +1291,14 @@ static void binder_free_buf(struct binder_proc *proc,
 	binder_insert_free_buffer(proc, buffer);
 }
 
+static void binder_free_buf(struct binder_proc *proc,
+			    struct binder_buffer *buffer)
+{
+	mutex_lock(&proc->alloc_lock);
+	__binder_free_buf(proc, buffer);
+	mutex_unlock(&proc->alloc_lock);
+}
+
 static struct binder_node *binder_get_node(struct binder_proc *proc,
 					   void __user *ptr)
 {
@@ -943,6 +1318,103 @@ static struct binder_node *binder_get_node(struct binder_proc *proc,
 	return NULL;
 }
 
+/*
+ * The low byte of the flags is the minimum priority of the node, a nice
+ * value or, with an RT policy in FLAT_BINDER_FLAG_SCHED_POLICY_MASK, an RT
+ * priority.
+ */
+static void binder_init_node_priority(struct binder_node *node, u32 flags)
+{
+	int policy = (flags & FLAT_BINDER_FLAG_SCHED_POLICY_MASK) >>
+		FLAT_BINDER_FLAG_SCHED_POLICY_SHIFT;
+	int priority = flags & FLAT_BINDER_FLAG_PRIORITY_MASK;
+
+	if (binder_is_rt_policy(policy)) {
+		priority = clamp(priority, 1, MAX_USER_RT_PRIO - 1);
+	} else {
+		policy = SCHED_NORMAL;
+		priority = (s8)priority;
+	}
+	node->sched_policy = policy;
+	node->min_priority = to_kernel_prio(policy, priority);
+}
+
+/*
+ * Loopers blocked waiting for process work sleep on their own wait queue
+ * and are listed in proc->waiting_threads, the most recently idle one
+ * first.  Wake only that one, since its cache is the warmest and the rest
+ * would only go back to sleep, and take it off the list so that the next
+ * piece of work goes to another thread.  Pollers are only woken when no
+ * looper is waiting.
+ */
+static void binder_wakeup_proc(struct binder_proc *proc)
+{
+	struct binder_thread *thread;
+
+	if (list_empty(&proc->waiting_threads)) {
+		wake_up_interruptible(&proc->wait);
+		return;
+	}
+	thread = list_first_entry(&proc->waiting_threads, struct binder_thread,
+				  waiting_thread_node);
+	list_del_init(&thread->waiting_thread_node);
+	wake_up_interruptible(&thread->wait);
+}
+
+static void binder_free_node(struct binder_node *node)
+{
+	kfree(node->latency);
+	kfree(node);
+	binder_stats_deleted(BINDER_STAT_NODE);
+}
+
+static void binder_latency_add(u32 *hist, u64 start, u64 end)
+{
+	u64 us = end > start ? div_u64(end - start, NSEC_PER_USEC) : 0;
+	int bucket = us >> 32 ? BINDER_LAT_BUCKETS - 1 : fls((u32)us);
+
+	hist[min(bucket, BINDER_LAT_BUCKETS - 1)]++;
+}
+
+static struct binder_latency *binder_node_latency(struct binder_node *node)
+{
+	if (!node->latency)
+		node->latency = kzalloc(sizeof(*node->latency), GFP_KERNEL);
+	return node->latency;
+}
+
+/* A thread of proc has just taken t off a todo list */
+static void binder_account_queue_time(struct binder_proc *proc,
+				      struct binder_transaction *t)
+{
+	struct binder_node *node = t->buffer->target_node;
+	struct binder_latency *lat;
+
+	t->recv_ns = local_clock();
+	if (!node)
+		return;
+	binder_latency_add(proc->latency.queue, t->send_ns, t->recv_ns);
+	lat = binder_node_latency(node);
+	if (lat)
+		binder_latency_add(lat->queue, t->send_ns, t->recv_ns);
+}
+
+/* A thread of proc is sending the reply to t */
+static void binder_account_service_time(struct binder_proc *proc,
+					struct binder_transaction *t)
+{
+	struct binder_latency *lat;
+	u64 now = local_clock();
+
+	binder_latency_add(proc->latency.service, t->recv_ns, now);
+	/* The buffer, and its node reference, may already be freed */
+	if (!t->buffer || !t->buffer->target_node)
+		return;
+	lat = binder_node_latency(t->buffer->target_node);
+	if (lat)
+		binder_latency_add(lat->service, t->recv_ns, now);
+}
+
 static struct binder_node *binder_new_node(struct binder_proc *proc,
 					   void __user *ptr,
 					   void __user *cookie)
@@ -973,6 +1445,8 @@ static struct binder_node *binder_new_node(struct binder_proc *proc,
 	node->proc = proc;
 	node->ptr = ptr;
 	node->cookie = cookie;
+	node->sched_policy = SCHED_NORMAL;
+	node->min_priority = BINDER_NICE_TO_PRIO(0);
 	node->work.type = BINDER_WORK_NODE;
 	INIT_LIST_HEAD(&node->work.entry);
 	INIT_LIST_HEAD(&node->async_todo);
@@ -1036,7 +1510,7 @@ static int binder_dec_node(struct binder_node *node, int strong, int internal)
 	if (node->proc && (node->has_strong_ref || node->has_weak_ref)) {
 		if (list_empty(&node->work.entry)) {
 			list_add_tail(&node->work.entry, &node->proc->todo);
-			wake_up_interruptible(&node->proc->wait);
+			binder_wakeup_proc(node->proc);
 		}
 	} else {
 		if (hlist_empty(&node->refs) && !node->local_strong_refs &&
@@ -1053,8 +1527,7 @@ static int binder_dec_node(struct binder_node *node, int strong, int internal)
 					     "binder: dead node %d deleted\n",
 					     node->debug_id);
 			}
-			kfree(node);
-			binder_stats_deleted(BINDER_STAT_NODE);
+			binder_free_node(node);
 		}
 	}
 
@@ -1409,7 +1882,7 @@ static void binder_transaction(struct binder_proc *proc,
 			return_error = BR_FAILED_REPLY;
 			goto err_empty_call_stack;
 		}
-		binder_set_nice(in_reply_to->saved_priority);
+		binder_set_priority(in_reply_to->saved_priority);
 		if (in_reply_to->to_thread != thread) {
 			binder_user_error("binder: %d:%d got reply transaction "
 				"with bad transaction stack,"
@@ -1547,7 +2020,7 @@ static void binder_transaction(struct binder_proc *proc,
 	t->to_thread = target_thread;
 	t->code = tr->code;
 	t->flags = tr->flags;
-	t->priority = task_nice(current);
+	t->priority = binder_current_priority();
 	t->buffer = binder_alloc_buf(target_proc, tr->data_size,
 		tr->offsets_size, !reply && (t->flags & TF_ONE_WAY));
 	if (t->buffer == NULL) {
@@ -1558,6 +2031,7 @@ static void binder_transaction(struct binder_proc *proc,
 	t->buffer->debug_id = t->debug_id;
 	t->buffer->transaction = t;
 	t->buffer->target_node = target_node;
+	trace_binder_transaction_alloc_buf(t->buffer);
 	if (target_node)
 		binder_inc_node(target_node, 1, 0, NULL);
 
@@ -1606,7 +2080,7 @@ static void binder_transaction(struct binder_proc *proc,
 					return_error = BR_FAILED_REPLY;
 					goto err_binder_new_node_failed;
 				}
-				node->min_priority = fp->flags & FLAT_BINDER_FLAG_PRIORITY_MASK;
+				binder_init_node_priority(node, fp->flags);
 				node->accept_fds = !!(fp->flags & FLAT_BINDER_FLAG_ACCEPTS_FDS);
 			}
 			if (fp->cookie != node->cookie) {
@@ -1735,6 +2209,7 @@ static void binder_transaction(struct binder_proc *proc,
 	}
 	if (reply) {
 		BUG_ON(t->buffer->async_transaction != 0);
+		binder_account_service_time(proc, in_reply_to);
 		binder_pop_transaction(target_thread, in_reply_to);
 	} else if (!(t->flags & TF_ONE_WAY)) {
 		BUG_ON(t->buffer->async_transaction != 0);
@@ -1751,11 +2226,19 @@ static void binder_transaction(struct binder_proc *proc,
 			target_node->has_async_transaction = 1;
 	}
 	t->work.type = BINDER_WORK_TRANSACTION;
+	t->send_ns = local_clock();
+	trace_binder_transaction(reply, t, target_node);
+	frame_trace_binder(t->debug_id, thread->pid, target_proc->pid,
+			   t->code, reply);
 	list_add_tail(&t->work.entry, target_list);
 	tcomplete->type = BINDER_WORK_TRANSACTION_COMPLETE;
 	list_add_tail(&tcomplete->entry, &thread->todo);
-	if (target_wait)
-		wake_up_interruptible(target_wait);
+	if (target_wait) {
+		if (target_thread)
+			wake_up_interruptible(target_wait);
+		else
+			binder_wakeup_proc(target_proc);
+	}
 	return;
 
 err_get_unused_fd_failed:
@@ -2101,7 +2584,7 @@ int binder_thread_write(struct binder_proc *proc, struct binder_thread *thread,
 						list_add_tail(&ref->death->work.entry, &thread->todo);
 					} else {
 						list_add_tail(&ref->death->work.entry, &proc->todo);
-						wake_up_interruptible(&proc->wait);
+						binder_wakeup_proc(proc);
 					}
 				}
 			} else {
@@ -2131,7 +2614,7 @@ int binder_thread_write(struct binder_proc *proc, struct binder_thread *thread,
 						list_add_tail(&death->work.entry, &thread->todo);
 					} else {
 						list_add_tail(&death->work.entry, &proc->todo);
-						wake_up_interruptible(&proc->wait);
+						binder_wakeup_proc(proc);
 					}
 				} else {
 					BUG_ON(death->work.type != BINDER_WORK_DEAD_BINDER);
@@ -2171,7 +2654,7 @@ int binder_thread_write(struct binder_proc *proc, struct binder_thread *thread,
 					list_add_tail(&death->work.entry, &thread->todo);
 				} else {
 					list_add_tail(&death->work.entry, &proc->todo);
-					wake_up_interruptible(&proc->wait);
+					binder_wakeup_proc(proc);
 				}
 			}
 		} break;
@@ -2248,9 +2731,13 @@ retry:
 
 
 	thread->looper |= BINDER_LOOPER_STATE_WAITING;
-	if (wait_for_proc_work)
+	if (wait_for_proc_work) {
 		proc->ready_threads++;
-	mutex_unlock(&binder_lock);
+		if (!non_block)
+			list_add(&thread->waiting_thread_node,
+				 &proc->waiting_threads);
+	}
+	binder_unlock();
 	if (wait_for_proc_work) {
 		if (!(thread->looper & (BINDER_LOOPER_STATE_REGISTERED |
 					BINDER_LOOPER_STATE_ENTERED))) {
@@ -2261,12 +2748,12 @@ retry:
 			wait_event_interruptible(binder_user_error_wait,
 						 binder_stop_on_user_error < 2);
 		}
-		binder_set_nice(proc->default_priority);
+		binder_set_priority(proc->default_priority);
 		if (non_block) {
 			if (!binder_has_proc_work(proc, thread))
 				ret = -EAGAIN;
 		} else
-			ret = wait_event_interruptible_exclusive(proc->wait, binder_has_proc_work(proc, thread));
+			ret = wait_event_interruptible(thread->wait, binder_has_proc_work(proc, thread));
 	} else {
 		if (non_block) {
 			if (!binder_has_thread_work(thread))
@@ -2274,9 +2761,17 @@ retry:
 		} else
 			ret = wait_event_interruptible(thread->wait, binder_has_thread_work(thread));
 	}
-	mutex_lock(&binder_lock);
-	if (wait_for_proc_work)
+	binder_lock(BINDER_LOCK_READ);
+	if (wait_for_proc_work) {
 		proc->ready_threads--;
+		/* Still listed if a signal or flush woke us */
+		list_del_init(&thread->waiting_thread_node);
+		if (!non_block && !ret) {
+			binder_stats.wakeups++;
+			proc->stats.wakeups++;
+			thread->stats.wakeups++;
+		}
+	}
 	thread->looper &= ~BINDER_LOOPER_STATE_WAITING;
 
 	if (ret)
@@ -2293,8 +2788,14 @@ retry:
 		else if (!list_empty(&proc->todo) && wait_for_proc_work)
 			w = list_first_entry(&proc->todo, struct binder_work, entry);
 		else {
-			if (ptr - buffer == 4 && !(thread->looper & BINDER_LOOPER_STATE_NEED_RETURN)) /* no data added */
+			if (ptr - buffer == 4 && !(thread->looper & BINDER_LOOPER_STATE_NEED_RETURN)) { /* no data added */
+				if (wait_for_proc_work && !non_block) {
+					binder_stats.spurious_wakeups++;
+					proc->stats.spurious_wakeups++;
+					thread->stats.spurious_wakeups++;
+				}
 				goto retry;
+			}
 			break;
 		}
 
@@ -2370,8 +2871,7 @@ retry:
 						     proc->pid, thread->pid, node->debug_id,
 						     node->ptr, node->cookie);
 					rb_erase(&node->rb_node, &proc->nodes);
-					kfree(node);
-					binder_stats_deleted(BINDER_STAT_NODE);
+					binder_free_node(node);
 				} else {
 					binder_debug(BINDER_DEBUG_INTERNAL_REFS,
 						     "binder: %d:%d node %d u%p c%p state unchanged\n",
@@ -2420,17 +2920,13 @@ retry:
 			continue;
 
 		BUG_ON(t->buffer == NULL);
+		binder_account_queue_time(proc, t);
 		if (t->buffer->target_node) {
 			struct binder_node *target_node = t->buffer->target_node;
 			tr.target.ptr = target_node->ptr;
 			tr.cookie =  target_node->cookie;
-			t->saved_priority = task_nice(current);
-			if (t->priority < target_node->min_priority &&
-			    !(t->flags & TF_ONE_WAY))
-				binder_set_nice(t->priority);
-			else if (!(t->flags & TF_ONE_WAY) ||
-				 t->saved_priority > target_node->min_priority)
-				binder_set_nice(target_node->min_priority);
+			t->saved_priority = binder_current_priority();
+			binder_transaction_priority(t, target_node);
 			cmd = BR_TRANSACTION;
 		} else {
 			tr.target.ptr = NULL;
@@ -2465,6 +2961,7 @@ retry:
 		ptr += sizeof(tr);
 
 		binder_stat_br(proc, thread, cmd);
+		trace_binder_transaction_received(t);
 		binder_debug(BINDER_DEBUG_TRANSACTION,
 			     "binder: %d:%d %s %d %d:%d, cmd %d"
 			     "size %zd-%zd ptr %p-%p\n",
@@ -2559,6 +3056,7 @@ static struct binder_thread *binder_get_thread(struct binder_proc *proc)
 		thread->pid = current->pid;
 		init_waitqueue_head(&thread->wait);
 		INIT_LIST_HEAD(&thread->todo);
+		INIT_LIST_HEAD(&thread->waiting_thread_node);
 		rb_link_node(&thread->rb_node, parent, p);
 		rb_insert_color(&thread->rb_node, &proc->threads);
 		thread->looper |= BINDER_LOOPER_STATE_NEED_RETURN;
@@ -2616,12 +3114,12 @@ static unsigned int binder_poll(struct file *filp,
 	struct binder_thread *thread = NULL;
 	int wait_for_proc_work;
 
-	mutex_lock(&binder_lock);
+	binder_lock(BINDER_LOCK_POLL);
 	thread = binder_get_thread(proc);
 
 	wait_for_proc_work = thread->transaction_stack == NULL &&
 		list_empty(&thread->todo) && thread->return_error == BR_OK;
-	mutex_unlock(&binder_lock);
+	binder_unlock();
 
 	if (wait_for_proc_work) {
 		if (binder_has_proc_work(proc, thread))
@@ -2653,7 +3151,7 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	if (ret)
 		return ret;
 
-	mutex_lock(&binder_lock);
+	binder_lock(BINDER_LOCK_IOCTL);
 	thread = binder_get_thread(proc);
 	if (thread == NULL) {
 		ret = -ENOMEM;
@@ -2688,7 +3186,7 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		if (bwr.read_size > 0) {
 			ret = binder_thread_read(proc, thread, (void __user *)bwr.read_buffer, bwr.read_size, &bwr.read_consumed, filp->f_flags & O_NONBLOCK);
 			if (!list_empty(&proc->todo))
-				wake_up_interruptible(&proc->wait);
+				binder_wakeup_proc(proc);
 			if (ret < 0) {
 				if (copy_to_user(ubuf, &bwr, sizeof(bwr)))
 					ret = -EFAULT;
@@ -2765,7 +3263,7 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 err:
 	if (thread)
 		thread->looper &= ~BINDER_LOOPER_STATE_NEED_RETURN;
-	mutex_unlock(&binder_lock);
+	binder_unlock();
 	wait_event_interruptible(binder_user_error_wait, binder_stop_on_user_error < 2);
 	if (ret && ret != -ERESTARTSYS)
 		printk(KERN_INFO "binder: %d:%d ioctl %x %lx returned %d\n", proc->pid, current->pid, cmd, arg, ret);
@@ -2807,6 +3305,7 @@ static int binder_mmap(struct file *filp, struct vm_area_struct *vma)
 	struct binder_proc *proc = filp->private_data;
 	const char *failure_string;
 	struct binder_buffer *buffer;
+	int i;
 
 	if ((vma->vm_end - vma->vm_start) > SZ_4M)
 		vma->vm_end = vma->vm_start + SZ_4M;
@@ -2854,6 +3353,10 @@ static int binder_mmap(struct file *filp, struct vm_area_struct *vma)
 		goto err_alloc_pages_failed;
 	}
 	proc->buffer_size = vma->vm_end - vma->vm_start;
+	for (i = 0; i < proc->buffer_size / PAGE_SIZE; i++) {
+		INIT_LIST_HEAD(&proc->pages[i].lru);
+		proc->pages[i].proc = proc;
+	}
 
 	vma->vm_ops = &binder_vm_ops;
 	vma->vm_private_data = proc;
@@ -2871,6 +3374,9 @@ static int binder_mmap(struct file *filp, struct vm_area_struct *vma)
 	proc->free_async_space = proc->buffer_size / 2;
 	barrier();
 	proc->files = get_files_struct(current);
+	/* The shrinker needs the mm to drop pages from the mapping */
+	atomic_inc(&vma->vm_mm->mm_count);
+	proc->vma_vm_mm = vma->vm_mm;
 	proc->vma = vma;
 
 	/*printk(KERN_INFO "binder_mmap: %d %lx-%lx maps %p\n",
@@ -2904,15 +3410,17 @@ static int binder_open(struct inode *nodp, struct file *filp)
 	get_task_struct(current);
 	proc->tsk = current;
 	INIT_LIST_HEAD(&proc->todo);
+	INIT_LIST_HEAD(&proc->waiting_threads);
 	init_waitqueue_head(&proc->wait);
-	proc->default_priority = task_nice(current);
-	mutex_lock(&binder_lock);
+	mutex_init(&proc->alloc_lock);
+	proc->default_priority = binder_current_priority();
+	binder_lock(BINDER_LOCK_OPEN);
 	binder_stats_created(BINDER_STAT_PROC);
 	hlist_add_head(&proc->proc_node, &binder_procs);
 	proc->pid = current->group_leader->pid;
 	INIT_LIST_HEAD(&proc->delivered_death);
 	filp->private_data = proc;
-	mutex_unlock(&binder_lock);
+	binder_unlock();
 
 	if (binder_debugfs_dir_entry_proc) {
 		char strbuf[11];
@@ -2995,8 +3503,7 @@ static void binder_deferred_release(struct binder_proc *proc)
 		rb_erase(&node->rb_node, &proc->nodes);
 		list_del_init(&node->work.entry);
 		if (hlist_empty(&node->refs)) {
-			kfree(node);
-			binder_stats_deleted(BINDER_STAT_NODE);
+			binder_free_node(node);
 		} else {
 			struct binder_ref *ref;
 			int death = 0;
@@ -3013,7 +3520,7 @@ static void binder_deferred_release(struct binder_proc *proc)
 					if (list_empty(&ref->death->work.entry)) {
 						ref->death->work.type = BINDER_WORK_DEAD_BINDER;
 						list_add_tail(&ref->death->work.entry, &ref->proc->todo);
-						wake_up_interruptible(&ref->proc->wait);
+						binder_wakeup_proc(ref->proc);
 					} else
 						BUG();
 				}
@@ -3034,6 +3541,7 @@ static void binder_deferred_release(struct binder_proc *proc)
 	binder_release_work(&proc->todo);
 	buffers = 0;
 
+	mutex_lock(&proc->alloc_lock);
 	while ((n = rb_first(&proc->allocated_buffers))) {
 		struct binder_buffer *buffer = rb_entry(n, struct binder_buffer,
 							rb_node);
@@ -3046,7 +3554,7 @@ static void binder_deferred_release(struct binder_proc *proc)
 			       proc->pid, t->debug_id);
 			/*BUG();*/
 		}
-		binder_free_buf(proc, buffer);
+		__binder_free_buf(proc, buffer);
 		buffers++;
 	}
 
@@ -3056,22 +3564,29 @@ static void binder_deferred_release(struct binder_proc *proc)
 	if (proc->pages) {
 		int i;
 		for (i = 0; i < proc->buffer_size / PAGE_SIZE; i++) {
-			if (proc->pages[i]) {
+			if (proc->pages[i].page_ptr) {
 				void *page_addr = proc->buffer + i * PAGE_SIZE;
 				binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
 					     "binder_release: %d: "
-					     "page %d at %p not freed\n",
+					     "page %d at %p still mapped\n",
 					     proc->pid, i,
 					     page_addr);
+				spin_lock(&binder_lru_lock);
+				binder_lru_del(&proc->pages[i]);
+				spin_unlock(&binder_lru_lock);
 				unmap_kernel_range((unsigned long)page_addr,
 					PAGE_SIZE);
-				__free_page(proc->pages[i]);
+				__free_page(proc->pages[i].page_ptr);
 				page_count++;
 			}
 		}
 		kfree(proc->pages);
 		vfree(proc->buffer);
 	}
+	mutex_unlock(&proc->alloc_lock);
+
+	if (proc->vma_vm_mm)
+		mmdrop(proc->vma_vm_mm);
 
 	put_task_struct(proc->tsk);
 
@@ -3092,7 +3607,7 @@ static void binder_deferred_func(struct work_struct *work)
 
 	int defer;
 	do {
-		mutex_lock(&binder_lock);
+		binder_lock(BINDER_LOCK_DEFERRED);
 		mutex_lock(&binder_deferred_lock);
 		if (!hlist_empty(&binder_deferred_list)) {
 			proc = hlist_entry(binder_deferred_list.first,
@@ -3119,7 +3634,7 @@ static void binder_deferred_func(struct work_struct *work)
 		if (defer & BINDER_DEFERRED_RELEASE)
 			binder_deferred_release(proc); /* frees proc */
 
-		mutex_unlock(&binder_lock);
+		binder_unlock();
 		if (files)
 			put_files_struct(files);
 	} while (proc);
@@ -3143,13 +3658,15 @@ static void print_binder_transaction(struct seq_file *m, const char *prefix,
 				     struct binder_transaction *t)
 {
 	seq_printf(m,
-		   "%s %d: %p from %d:%d to %d:%d code %x flags %x pri %ld r%d",
+		   "%s %d: %p from %d:%d to %d:%d code %x flags %x pri %d:%d r%d",
 		   prefix, t->debug_id, t,
 		   t->from ? t->from->proc->pid : 0,
 		   t->from ? t->from->pid : 0,
 		   t->to_proc ? t->to_proc->pid : 0,
 		   t->to_thread ? t->to_thread->pid : 0,
-		   t->code, t->flags, t->priority, t->need_reply);
+		   t->code, t->flags, t->priority.sched_policy,
+		   to_userspace_prio(t->priority.sched_policy, t->priority.prio),
+		   t->need_reply);
 	if (t->buffer == NULL) {
 		seq_puts(m, " buffer free\n");
 		return;
@@ -3396,6 +3913,10 @@ static void print_binder_stats(struct seq_file *m, const char *prefix,
 				stats->obj_created[i] - stats->obj_deleted[i],
 				stats->obj_created[i]);
 	}
+
+	if (stats->wakeups)
+		seq_printf(m, "%swakeups: %d spurious %d\n", prefix,
+			   stats->wakeups, stats->spurious_wakeups);
 }
 
 static void print_binder_proc_stats(struct seq_file *m,
@@ -3403,7 +3924,7 @@ static void print_binder_proc_stats(struct seq_file *m,
 {
 	struct binder_work *w;
 	struct rb_node *n;
-	int count, strong, weak;
+	int count, strong, weak, unused;
 
 	seq_printf(m, "proc %d\n", proc->pid);
 	count = 0;
@@ -3436,6 +3957,23 @@ static void print_binder_proc_stats(struct seq_file *m,
 		count++;
 	seq_printf(m, "  buffers: %d\n", count);
 
+	count = 0;
+	unused = 0;
+	if (proc->pages) {
+		int i;
+
+		spin_lock(&binder_lru_lock);
+		for (i = 0; i < proc->buffer_size / PAGE_SIZE; i++) {
+			if (!proc->pages[i].page_ptr)
+				continue;
+			count++;
+			if (!list_empty(&proc->pages[i].lru))
+				unused++;
+		}
+		spin_unlock(&binder_lru_lock);
+	}
+	seq_printf(m, "  pages: %d mapped, %d unused\n", count, unused);
+
 	count = 0;
 	list_for_each_entry(w, &proc->todo, entry) {
 		switch (w->type) {
@@ -3460,7 +3998,7 @@ static int binder_state_show(struct seq_file *m, void *unused)
 	int do_lock = !binder_debug_no_lock;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		binder_lock(BINDER_LOCK_DEBUGFS);
 
 	seq_puts(m, "binder state:\n");
 
@@ -3472,7 +4010,7 @@ static int binder_state_show(struct seq_file *m, void *unused)
 	hlist_for_each_entry(proc, pos, &binder_procs, proc_node)
 		print_binder_proc(m, proc, 1);
 	if (do_lock)
-		mutex_unlock(&binder_lock);
+		binder_unlock();
 	return 0;
 }
 
@@ -3483,7 +4021,7 @@ static int binder_stats_show(struct seq_file *m, void *unused)
 	int do_lock = !binder_debug_no_lock;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		binder_lock(BINDER_LOCK_DEBUGFS);
 
 	seq_puts(m, "binder stats:\n");
 
@@ -3492,7 +4030,7 @@ static int binder_stats_show(struct seq_file *m, void *unused)
 	hlist_for_each_entry(proc, pos, &binder_procs, proc_node)
 		print_binder_proc_stats(m, proc);
 	if (do_lock)
-		mutex_unlock(&binder_lock);
+		binder_unlock();
 	return 0;
 }
 
@@ -3503,13 +4041,13 @@ static int binder_transactions_show(struct seq_file *m, void *unused)
 	int do_lock = !binder_debug_no_lock;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		binder_lock(BINDER_LOCK_DEBUGFS);
 
 	seq_puts(m, "binder transactions:\n");
 	hlist_for_each_entry(proc, pos, &binder_procs, proc_node)
 		print_binder_proc(m, proc, 0);
 	if (do_lock)
-		mutex_unlock(&binder_lock);
+		binder_unlock();
 	return 0;
 }
 
@@ -3519,11 +4057,11 @@ static int binder_proc_show(struct seq_file *m, void *unused)
 	int do_lock = !binder_debug_no_lock;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		binder_lock(BINDER_LOCK_DEBUGFS);
 	seq_puts(m, "binder proc state:\n");
 	print_binder_proc(m, proc, 1);
 	if (do_lock)
-		mutex_unlock(&binder_lock);
+		binder_unlock();
 	return 0;
 }
 
@@ -3552,6 +4090,89 @@ static int binder_transaction_log_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static int binder_lock_stats_show(struct seq_file *m, void *unused)
+{
+	struct binder_lock_stats stats[BINDER_LOCK_NR_SITES];
+	int i;
+
+	binder_lock(BINDER_LOCK_DEBUGFS);
+	memcpy(stats, binder_lock_stats, sizeof(stats));
+	binder_unlock();
+
+	seq_puts(m, "site acquired contended wait_us max_wait_us "
+		 "hold_us max_hold_us\n");
+	for (i = 0; i < BINDER_LOCK_NR_SITES; i++)
+		seq_printf(m, "%s %llu %llu %llu %llu %llu %llu\n",
+			   binder_lock_site_names[i],
+			   stats[i].acquired, stats[i].contended,
+			   div_u64(stats[i].wait_ns, NSEC_PER_USEC),
+			   div_u64(stats[i].max_wait_ns, NSEC_PER_USEC),
+			   div_u64(stats[i].hold_ns, NSEC_PER_USEC),
+			   div_u64(stats[i].max_hold_ns, NSEC_PER_USEC));
+	return 0;
+}
+
+static void print_binder_latency_hist(struct seq_file *m, const char *prefix,
+				      int id, const char *name, u32 *hist)
+{
+	int i;
+
+	seq_printf(m, "%s %d %s", prefix, id, name);
+	for (i = 0; i < BINDER_LAT_BUCKETS; i++)
+		seq_printf(m, " %u", hist[i]);
+	seq_puts(m, "\n");
+}
+
+static bool binder_latency_empty(struct binder_latency *lat)
+{
+	int i;
+
+	for (i = 0; i < BINDER_LAT_BUCKETS; i++)
+		if (lat->queue[i] || lat->service[i])
+			return false;
+	return true;
+}
+
+static void print_binder_latency(struct seq_file *m, const char *prefix,
+				 int id, struct binder_latency *lat)
+{
+	print_binder_latency_hist(m, prefix, id, "queue", lat->queue);
+	print_binder_latency_hist(m, prefix, id, "service", lat->service);
+}
+
+static int binder_latency_show(struct seq_file *m, void *unused)
+{
+	struct binder_proc *proc;
+	struct hlist_node *pos;
+	struct rb_node *n;
+	int do_lock = !binder_debug_no_lock;
+	int i;
+
+	if (do_lock)
+		binder_lock(BINDER_LOCK_DEBUGFS);
+
+	seq_puts(m, "usecs 0");
+	for (i = 1; i < BINDER_LAT_BUCKETS; i++)
+		seq_printf(m, " %u", 1U << (i - 1));
+	seq_puts(m, "\n");
+
+	hlist_for_each_entry(proc, pos, &binder_procs, proc_node) {
+		if (binder_latency_empty(&proc->latency))
+			continue;
+		print_binder_latency(m, "proc", proc->pid, &proc->latency);
+		for (n = rb_first(&proc->nodes); n != NULL; n = rb_next(n)) {
+			struct binder_node *node = rb_entry(n, struct binder_node,
+							    rb_node);
+			if (node->latency && !binder_latency_empty(node->latency))
+				print_binder_latency(m, "  node", node->debug_id,
+						     node->latency);
+		}
+	}
+	if (do_lock)
+		binder_unlock();
+	return 0;
+}
+
 static const struct file_operations binder_fops = {
 	.owner = THIS_MODULE,
 	.poll = binder_poll,
@@ -3572,6 +4193,8 @@ BINDER_DEBUG_ENTRY(state);
 BINDER_DEBUG_ENTRY(stats);
 BINDER_DEBUG_ENTRY(transactions);
 BINDER_DEBUG_ENTRY(transaction_log);
+BINDER_DEBUG_ENTRY(lock_stats);
+BINDER_DEBUG_ENTRY(latency);
 
 static int __init binder_init(void)
 {
@@ -3580,6 +4203,7 @@ static int __init binder_init(void)
 	binder_deferred_workqueue = create_singlethread_workqueue("binder");
 	if (!binder_deferred_workqueue)
 		return -ENOMEM;
+	register_shrinker(&binder_shrinker);
 
 	binder_debugfs_dir_entry_root = debugfs_create_dir("binder", NULL);
 	if (binder_debugfs_dir_entry_root)
@@ -3612,10 +4236,23 @@ static int __init binder_init(void)
 				    binder_debugfs_dir_entry_root,
 				    &binder_transaction_log_failed,
 				    &binder_transaction_log_fops);
+		debugfs_create_file("lock_stats",
+				    S_IRUGO,
+				    binder_debugfs_dir_entry_root,
+				    NULL,
+				    &binder_lock_stats_fops);
+		debugfs_create_file("latency",
+				    S_IRUGO,
+				    binder_debugfs_dir_entry_root,
+				    NULL,
+				    &binder_latency_fops);
 	}
 	return ret;
 }
 
 device_initcall(binder_init);
 
+#define CREATE_TRACE_POINTS
+#include "binder_trace.h"
+
 MODULE_LICENSE("GPL v2");
@@ -20,11 +20,14 @@
 #include <linux/sched.h>
 #include <linux/module.h>
 #include <linux/fs.h>
+#include <linux/mm.h>
 #include <linux/miscdevice.h>
 #include <linux/uaccess.h>
 #include <linux/poll.h>
 #include <linux/slab.h>
 #include <linux/time.h>
+#include <linux/spinlock.h>
+#include <linux/percpu.h>
 #include "logger.h"
 
 #include <asm/ioctls.h>
@@ -34,14 +37,15 @@
  *
  * This structure lives from module insertion until module removal, so it does
  * not need additional reference counting. The structure is protected by the
- * mutex 'mutex'.
+ * spinlock 'lock', which is never held across a user copy: writers stage the
+ * payload first, and readers copy an entry out to their own buffer.
  */
 struct logger_log {
 	unsigned char 		*buffer;/* the ring buffer itself */
 	struct miscdevice	misc;	/* misc device representing the log */
 	wait_queue_head_t	wq;	/* wait queue for readers */
 	struct list_head	readers; /* this log's readers */
-	struct mutex		mutex;	/* mutex protecting buffer */
+	spinlock_t		lock;	/* lock protecting buffer */
 	size_t			w_off;	/* current write head offset */
 	size_t			head;	/* new readers start here */
 	size_t			size;	/* size of the log */
@@ -51,7 +55,7 @@ struct logger_log {
  * struct logger_reader - a logging device open for reading
  *
  * This object lives from open to release, so we don't need additional
- * reference counting. The structure is protected by log->mutex.
+ * reference counting. The structure is protected by log->lock.
  */
 struct logger_reader {
 	struct logger_log	*log;	/* associated log */
@@ -59,8 +63,22 @@ struct logger_reader {
 	size_t			r_off;	/* current read head offset */
 	bool			r_all;	/* reader can read all entries */
 	int			r_ver;	/* reader ABI version */
+	unsigned char		*entry;	/* the entry being read out */
 };
 
+#define LOGGER_ENTRY_MAX_LEN \
+	(sizeof(struct logger_entry) + LOGGER_ENTRY_MAX_PAYLOAD)
+
+/*
+ * Each CPU has a buffer that writers fill from user space with page faults
+ * disabled, so that the log itself is only locked for a memcpy().
+ */
+struct logger_staging {
+	unsigned char		payload[LOGGER_ENTRY_MAX_PAYLOAD];
+};
+
+static DEFINE_PER_CPU(struct logger_staging, logger_staging);
+
 /* logger_offset - returns index 'n' into the log via (optimized) modulus */
 #define logger_offset(n)	((n) & (log->size - 1))
 
@@ -112,7 +130,7 @@ static struct logger_entry *get_entry_header(struct logger_log *log,
  * get_entry_msg_len - Grabs the length of the message of the entry
  * starting from from 'off'.
  *
- * Caller needs to hold log->mutex.
+ * Caller needs to hold log->lock.
  */
 static __u32 get_entry_msg_len(struct logger_log *log, size_t off)
 {
@@ -156,54 +174,50 @@ static ssize_t copy_header_to_user(int ver, struct logger_entry *entry,
 }
 
 /*
- * do_read_log_to_user - reads exactly 'count' bytes from 'log' into the
- * user-space buffer 'buf'. Returns 'count' on success.
+ * do_read_log - copies the next 'count' bytes of 'log' at the read head of
+ * 'reader' into reader->entry, and moves the read head past them.
  *
- * Caller must hold log->mutex.
+ * Caller must hold log->lock.
  */
-static ssize_t do_read_log_to_user(struct logger_log *log,
-				   struct logger_reader *reader,
-				   char __user *buf,
-				   size_t count)
+static void do_read_log(struct logger_log *log, struct logger_reader *reader,
+			size_t count)
 {
-	struct logger_entry scratch;
-	struct logger_entry *entry;
 	size_t len;
-	size_t msg_start;
 
 	/*
-	 * First, copy the header to userspace, using the version of
-	 * the header requested
+	 * We read in two disjoint operations. First, we read from the current
+	 * read head up to 'count' bytes or to the end of the log, whichever
+	 * comes first.  Second, we read any remaining bytes, starting back at
+	 * the head of the log.
 	 */
-	entry = get_entry_header(log, reader->r_off, &scratch);
-	if (copy_header_to_user(reader->r_ver, entry, buf))
-		return -EFAULT;
+	len = min(count, log->size - reader->r_off);
+	memcpy(reader->entry, log->buffer + reader->r_off, len);
 
-	count -= get_user_hdr_len(reader->r_ver);
-	buf += get_user_hdr_len(reader->r_ver);
-	msg_start = logger_offset(reader->r_off + sizeof(struct logger_entry));
+	if (count != len)
+		memcpy(reader->entry + len, log->buffer, count - len);
 
-	/*
-	 * We read from the msg in two disjoint operations. First, we read from
-	 * the current msg head offset up to 'count' bytes or to the end of
-	 * the log, whichever comes first.
-	 */
-	len = min(count, log->size - msg_start);
-	if (copy_to_user(buf, log->buffer + msg_start, len))
-		return -EFAULT;
+	reader->r_off = logger_offset(reader->r_off + count);
+}
 
-	/*
-	 * Second, we read any remaining bytes, starting back at the head of
-	 * the log.
-	 */
-	if (count != len)
-		if (copy_to_user(buf + len, log->buffer, count - len))
-			return -EFAULT;
+/*
+ * do_read_log_to_user - copies the entry in reader->entry to the user-space
+ * buffer 'buf', using the version of the header requested.  Returns the
+ * number of bytes copied on success.
+ */
+static ssize_t do_read_log_to_user(struct logger_reader *reader,
+				   char __user *buf)
+{
+	struct logger_entry *entry = (struct logger_entry *)reader->entry;
+	size_t hdr_len = get_user_hdr_len(reader->r_ver);
 
-	reader->r_off = logger_offset(reader->r_off +
-		sizeof(struct logger_entry) + count);
+	if (copy_header_to_user(reader->r_ver, entry, buf))
+		return -EFAULT;
+
+	if (copy_to_user(buf + hdr_len,
+			 reader->entry + sizeof(struct logger_entry), entry->len))
+		return -EFAULT;
 
-	return count + get_user_hdr_len(reader->r_ver);
+	return hdr_len + entry->len;
 }
 
 /*
@@ -230,6 +244,43 @@ static size_t get_next_entry_by_uid(struct logger_log *log,
 	return off;
 }
 
+/*
+ * read_next_entry - takes the next entry readable by 'reader' out of 'log'
+ * and copies it to 'buf'.  Returns the number of bytes copied, zero if
+ * there is no entry left, or -EINVAL if it does not fit in 'count' bytes.
+ */
+static ssize_t read_next_entry(struct logger_log *log,
+			       struct logger_reader *reader,
+			       char __user *buf, size_t count)
+{
+	size_t len;
+
+	spin_lock(&log->lock);
+
+	if (!reader->r_all)
+		reader->r_off = get_next_entry_by_uid(log,
+			reader->r_off, current_euid());
+
+	if (log->w_off == reader->r_off) {
+		spin_unlock(&log->lock);
+		return 0;
+	}
+
+	/* get the size of the next entry */
+	len = get_entry_msg_len(log, reader->r_off);
+	if (count < get_user_hdr_len(reader->r_ver) + len) {
+		spin_unlock(&log->lock);
+		return -EINVAL;
+	}
+
+	/* take exactly one entry out of the log */
+	do_read_log(log, reader, sizeof(struct logger_entry) + len);
+
+	spin_unlock(&log->lock);
+
+	return do_read_log_to_user(reader, buf);
+}
+
 /*
  * logger_read - our log's read() method
  *
@@ -237,7 +288,8 @@ static size_t get_next_entry_by_uid(struct logger_log *log,
  *
  * 	- O_NONBLOCK works
  * 	- If there are no log entries to read, blocks until log is written to
- * 	- Atomically reads exactly one log entry
+ * 	- Atomically reads exactly one log entry, or for version 3 readers
+ * 	  as many whole entries as fit, without blocking for more
  *
  * Will set errno to EINVAL if read
  * buffer is insufficient to hold next entry.
@@ -254,9 +306,9 @@ start:
 	while (1) {
 		prepare_to_wait(&log->wq, &wait, TASK_INTERRUPTIBLE);
 
-		mutex_lock(&log->mutex);
+		spin_lock(&log->lock);
 		ret = (log->w_off == reader->r_off);
-		mutex_unlock(&log->mutex);
+		spin_unlock(&log->lock);
 		if (!ret)
 			break;
 
@@ -277,32 +329,20 @@ start:
 	if (ret)
 		return ret;
 
-	mutex_lock(&log->mutex);
-
-	if (!reader->r_all)
-		reader->r_off = get_next_entry_by_uid(log,
-			reader->r_off, current_euid());
+	ret = read_next_entry(log, reader, buf, count);
 
 	/* is there still something to read or did we race? */
-	if (unlikely(log->w_off == reader->r_off)) {
-		mutex_unlock(&log->mutex);
+	if (unlikely(!ret))
 		goto start;
-	}
 
-	/* get the size of the next entry */
-	ret = get_user_hdr_len(reader->r_ver) +
-		get_entry_msg_len(log, reader->r_off);
-	if (count < ret) {
-		ret = -EINVAL;
-		goto out;
+	while (ret > 0 && reader->r_ver >= 3) {
+		ssize_t nr = read_next_entry(log, reader, buf + ret,
+					     count - ret);
+		if (nr <= 0)
+			break;
+		ret += nr;
 	}
 
-	/* get exactly one entry from the log */
-	ret = do_read_log_to_user(log, reader, buf, ret);
-
-out:
-	mutex_unlock(&log->mutex);
-
 	return ret;
 }
 
@@ -310,7 +350,7 @@ out:
  * get_next_entry - return the offset of the first valid entry at least 'len'
  * bytes after 'off'.
  *
- * Caller must hold log->mutex.
+ * Caller must hold log->lock.
  */
 static size_t get_next_entry(struct logger_log *log, size_t off, size_t len)
 {
@@ -349,7 +389,7 @@ static inline int clock_interval(size_t a, size_t b, size_t c)
  * We do this by "pulling forward" the readers and start head to the first
  * entry after the new write head.
  *
- * The caller needs to hold log->mutex.
+ * The caller needs to hold log->lock.
  */
 static void fix_up_readers(struct logger_log *log, size_t len)
 {
@@ -368,7 +408,7 @@ static void fix_up_readers(struct logger_log *log, size_t len)
 /*
  * do_write_log - writes 'len' bytes from 'buf' to 'log'
  *
- * The caller needs to hold log->mutex.
+ * The caller needs to hold log->lock.
  */
 static void do_write_log(struct logger_log *log, const void *buf, size_t count)
 {
@@ -385,29 +425,32 @@ static void do_write_log(struct logger_log *log, const void *buf, size_t count)
 }
 
 /*
- * do_write_log_user - writes 'len' bytes from the user-space buffer 'buf' to
- * the log 'log'
- *
- * The caller needs to hold log->mutex.
+ * copy_payload_from_user - gathers the first 'count' bytes of the vectors
+ * 'iov' into 'buf'.  With 'atomic' set this does not sleep, and fails
+ * instead of faulting pages in.
  *
- * Returns 'count' on success, negative error code on failure.
+ * Returns zero on success, -EFAULT on failure.
  */
-static ssize_t do_write_log_from_user(struct logger_log *log,
-				      const void __user *buf, size_t count)
+static int copy_payload_from_user(void *buf, const struct iovec *iov,
+				  unsigned long nr_segs, size_t count,
+				  bool atomic)
 {
-	size_t len;
-
-	len = min(count, log->size - log->w_off);
-	if (len && copy_from_user(log->buffer + log->w_off, buf, len))
-		return -EFAULT;
-
-	if (count != len)
-		if (copy_from_user(log->buffer, buf + len, count - len))
+	while (count && nr_segs-- > 0) {
+		size_t len = min_t(size_t, iov->iov_len, count);
+
+		if (atomic) {
+			if (!access_ok(VERIFY_READ, iov->iov_base, len) ||
+			    __copy_from_user_inatomic(buf, iov->iov_base, len))
+				return -EFAULT;
+		} else if (copy_from_user(buf, iov->iov_base, len))
 			return -EFAULT;
 
-	log->w_off = logger_offset(log->w_off + count);
+		buf += len;
+		count -= len;
+		iov++;
+	}
 
-	return count;
+	return 0;
 }
 
 /*
@@ -419,10 +462,10 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 			 unsigned long nr_segs, loff_t ppos)
 {
 	struct logger_log *log = file_get_log(iocb->ki_filp);
-	size_t orig = log->w_off;
 	struct logger_entry header;
 	struct timespec now;
-	ssize_t ret = 0;
+	void *payload, *slow = NULL;
+	int ret;
 
 	now = current_kernel_time();
 
@@ -438,43 +481,55 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 	if (unlikely(!header.len))
 		return 0;
 
-	mutex_lock(&log->mutex);
+	/*
+	 * Stage the payload in this CPU's buffer.  Log lines come from memory
+	 * the writer has just touched, so faulting is rare; if it happens,
+	 * fall back to a buffer of our own and a copy that may sleep.
+	 */
+	payload = get_cpu_var(logger_staging).payload;
+	pagefault_disable();
+	ret = copy_payload_from_user(payload, iov, nr_segs, header.len, true);
+	pagefault_enable();
+	if (unlikely(ret)) {
+		put_cpu_var(logger_staging);
+		slow = kmalloc(header.len, GFP_KERNEL);
+		if (!slow)
+			return -ENOMEM;
+		ret = copy_payload_from_user(slow, iov, nr_segs, header.len,
+					     false);
+		if (ret) {
+			kfree(slow);
+			return ret;
+		}
+		payload = slow;
+	}
+
+	/*
+	 * Entries are published whole, in the order writers get the lock, so
+	 * readers never see a partial entry.
+	 */
+	spin_lock(&log->lock);
 
 	/*
 	 * Fix up any readers, pulling them forward to the first readable
-	 * entry after (what will be) the new write offset. We do this now
-	 * because if we partially fail, we can end up with clobbered log
-	 * entries that encroach on readable buffer.
+	 * entry after (what will be) the new write offset.
 	 */
 	fix_up_readers(log, sizeof(struct logger_entry) + header.len);
 
 	do_write_log(log, &header, sizeof(struct logger_entry));
+	do_write_log(log, payload, header.len);
 
-	while (nr_segs-- > 0) {
-		size_t len;
-		ssize_t nr;
-
-		/* figure out how much of this vector we can keep */
-		len = min_t(size_t, iov->iov_len, header.len - ret);
+	spin_unlock(&log->lock);
 
-		/* write out this segment's payload */
-		nr = do_write_log_from_user(log, iov->iov_base, len);
-		if (unlikely(nr < 0)) {
-			log->w_off = orig;
-			mutex_unlock(&log->mutex);
-			return nr;
-		}
-
-		iov++;
-		ret += nr;
-	}
-
-	mutex_unlock(&log->mutex);
+	if (slow)
+		kfree(slow);
+	else
+		put_cpu_var(logger_staging);
 
 	/* wake up any blocked readers */
 	wake_up_interruptible(&log->wq);
 
-	return ret;
+	return header.len;
 }
 
 static struct logger_log *get_log_from_minor(int);
@@ -504,6 +559,12 @@ static int logger_open(struct inode *inode, struct file *file)
 		if (!reader)
 			return -ENOMEM;
 
+		reader->entry = kmalloc(LOGGER_ENTRY_MAX_LEN, GFP_KERNEL);
+		if (!reader->entry) {
+			kfree(reader);
+			return -ENOMEM;
+		}
+
 		reader->log = log;
 		reader->r_ver = 1;
 		reader->r_all = in_egroup_p(inode->i_gid) ||
@@ -511,10 +572,10 @@ static int logger_open(struct inode *inode, struct file *file)
 
 		INIT_LIST_HEAD(&reader->list);
 
-		mutex_lock(&log->mutex);
+		spin_lock(&log->lock);
 		reader->r_off = log->head;
 		list_add_tail(&reader->list, &log->readers);
-		mutex_unlock(&log->mutex);
+		spin_unlock(&log->lock);
 
 		file->private_data = reader;
 	} else
@@ -532,7 +593,12 @@ static int logger_release(struct inode *ignored, struct file *file)
 {
 	if (file->f_mode & FMODE_READ) {
 		struct logger_reader *reader = file->private_data;
+		struct logger_log *log = reader->log;
+
+		spin_lock(&log->lock);
 		list_del(&reader->list);
+		spin_unlock(&log->lock);
+		kfree(reader->entry);
 		kfree(reader);
 	}
 
@@ -562,25 +628,86 @@ static unsigned int logger_poll(struct file *file, poll_table *wait)
 
 	poll_wait(file, &log->wq, wait);
 
-	mutex_lock(&log->mutex);
+	spin_lock(&log->lock);
 	if (!reader->r_all)
 		reader->r_off = get_next_entry_by_uid(log,
 			reader->r_off, current_euid());
 
 	if (log->w_off != reader->r_off)
 		ret |= POLLIN | POLLRDNORM;
-	mutex_unlock(&log->mutex);
+	spin_unlock(&log->lock);
 
 	return ret;
 }
 
+/*
+ * logger_mmap - the log's mmap file operation
+ *
+ * Maps the whole ring read-only, so that a consumer can parse entries in
+ * place.  It learns where to start and stop with LOGGER_GET_READ_OFFSET and
+ * LOGGER_GET_WRITE_OFFSET, and hands back what it has consumed with
+ * LOGGER_SET_READ_OFFSET.  Writers that lap the reader pull its read offset
+ * forward as for read(), so if the read offset has not moved by the time
+ * the consumer is done parsing, nothing it parsed was overwritten.
+ *
+ * This bypasses the per-uid filtering, so it is only for readers that may
+ * read all entries.
+ */
+static int logger_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct logger_reader *reader;
+	struct logger_log *log;
+
+	if (!(file->f_mode & FMODE_READ))
+		return -EBADF;
+
+	reader = file->private_data;
+	log = reader->log;
+
+	if (!reader->r_all)
+		return -EPERM;
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != log->size)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       __pa(log->buffer) >> PAGE_SHIFT,
+			       log->size, vma->vm_page_prot);
+}
+
+/*
+ * set_read_offset - moves the read head of 'reader' forward to 'off', which
+ * must be the start of an entry between the read and the write heads.
+ *
+ * Caller must hold log->lock.
+ */
+static long set_read_offset(struct logger_log *log,
+			    struct logger_reader *reader, size_t off)
+{
+	size_t r_off = reader->r_off;
+
+	while (r_off != off) {
+		if (r_off == log->w_off)
+			return -EINVAL;
+		r_off = logger_offset(r_off + sizeof(struct logger_entry) +
+				      get_entry_msg_len(log, r_off));
+	}
+
+	reader->r_off = r_off;
+	return 0;
+}
+
 static long logger_set_version(struct logger_reader *reader, void __user *arg)
 {
 	int version;
 	if (copy_from_user(&version, arg, sizeof(int)))
 		return -EFAULT;
 
-	if ((version < 1) || (version > 2))
+	if ((version < 1) || (version > 3))
 		return -EINVAL;
 
 	reader->r_ver = version;
@@ -594,7 +721,15 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	long ret = -EINVAL;
 	void __user *argp = (void __user *) arg;
 
-	mutex_lock(&log->mutex);
+	/* The only command that copies from user space, and it is per-reader */
+	if (cmd == LOGGER_SET_VERSION) {
+		if (!(file->f_mode & FMODE_READ))
+			return -EBADF;
+		reader = file->private_data;
+		return logger_set_version(reader, argp);
+	}
+
+	spin_lock(&log->lock);
 
 	switch (cmd) {
 	case LOGGER_GET_LOG_BUF_SIZE:
@@ -646,17 +781,36 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		reader = file->private_data;
 		ret = reader->r_ver;
 		break;
-	case LOGGER_SET_VERSION:
+	case LOGGER_GET_READ_OFFSET:
 		if (!(file->f_mode & FMODE_READ)) {
 			ret = -EBADF;
 			break;
 		}
 		reader = file->private_data;
-		ret = logger_set_version(reader, argp);
+		ret = reader->r_off;
+		break;
+	case LOGGER_GET_WRITE_OFFSET:
+		if (!(file->f_mode & FMODE_READ)) {
+			ret = -EBADF;
+			break;
+		}
+		ret = log->w_off;
+		break;
+	case LOGGER_SET_READ_OFFSET:
+		if (!(file->f_mode & FMODE_READ)) {
+			ret = -EBADF;
+			break;
+		}
+		reader = file->private_data;
+		if (!reader->r_all) {
+			ret = -EPERM;
+			break;
+		}
+		ret = set_read_offset(log, reader, arg);
 		break;
 	}
 
-	mutex_unlock(&log->mutex);
+	spin_unlock(&log->lock);
 
 	return ret;
 }
@@ -666,6 +820,7 @@ static const struct file_operations logger_fops = {
 	.read = logger_read,
 	.aio_write = logger_aio_write,
 	.poll = logger_poll,
+	.mmap = logger_mmap,
 	.unlocked_ioctl = logger_ioctl,
 	.compat_ioctl = logger_ioctl,
 	.open = logger_open,
@@ -674,11 +829,11 @@ static const struct file_operations logger_fops = {
 
 /*
  * Defines a log structure with name 'NAME' and a size of 'SIZE' bytes, which
- * must be a power of two, and greater than
- * (LOGGER_ENTRY_MAX_PAYLOAD + sizeof(struct logger_entry)).
+ * must be a power of two, a multiple of PAGE_SIZE for mmap(), and greater
+ * than (LOGGER_ENTRY_MAX_PAYLOAD + sizeof(struct logger_entry)).
  */
 #define DEFINE_LOGGER_DEVICE(VAR, NAME, SIZE) \
-static unsigned char _buf_ ## VAR[SIZE]; \
+static unsigned char _buf_ ## VAR[SIZE] __page_aligned_bss; \
 static struct logger_log VAR = { \
 	.buffer = _buf_ ## VAR, \
 	.misc = { \
@@ -689,7 +844,7 @@ static struct logger_log VAR = { \
 	}, \
 	.wq = __WAIT_QUEUE_HEAD_INITIALIZER(VAR .wq), \
 	.readers = LIST_HEAD_INIT(VAR .readers), \
-	.mutex = __MUTEX_INITIALIZER(VAR .mutex), \
+	.lock = __SPIN_LOCK_UNLOCKED(VAR .lock), \
 	.w_off = 0, \
 	.head = 0, \
 	.size = SIZE, \
@@ -38,7 +38,11 @@ struct user_logger_entry_compat {
 /*
  * The structure for version 2 of the logger_entry ABI.
  * This structure is returned to userspace if ioctl(LOGGER_SET_VERSION)
- * is called with version >= 2
+ * is called with version >= 2.  It is also how entries are laid out in
+ * the ring that mmap() maps, each followed by its payload.
+ *
+ * Version 3 uses the same header, but read() returns as many whole entries
+ * as fit in the buffer instead of exactly one.
  */
 struct logger_entry {
 	__u16		len;		/* length of the payload */
@@ -66,5 +70,8 @@ struct logger_entry {
 #define LOGGER_FLUSH_LOG		_IO(__LOGGERIO, 4) /* flush log */
 #define LOGGER_GET_VERSION		_IO(__LOGGERIO, 5) /* abi version */
 #define LOGGER_SET_VERSION		_IO(__LOGGERIO, 6) /* abi version */
+#define LOGGER_GET_READ_OFFSET		_IO(__LOGGERIO, 7) /* mmap reader */
+#define LOGGER_GET_WRITE_OFFSET		_IO(__LOGGERIO, 8) /* mmap reader */
+#define LOGGER_SET_READ_OFFSET		_IO(__LOGGERIO, 9) /* mmap reader */
 
 #endif /* _LINUX_LOGGER_H */
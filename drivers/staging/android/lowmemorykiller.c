@@ -36,12 +36,17 @@
 #include <linux/sched.h>
 #include <linux/rcupdate.h>
 #include <linux/notifier.h>
-#ifdef CONFIG_ZRAM_FOR_ANDROID
-#include <linux/swap.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
 #include <linux/device.h>
 #include <linux/err.h>
-#include <linux/mm_inline.h>
-#endif /* CONFIG_ZRAM_FOR_ANDROID */
+#include <linux/workqueue.h>
+#include <linux/swap.h>
+#include <linux/memcontrol.h>
+#ifdef CONFIG_DEBUG_FS
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#endif
 #define ENHANCED_LMK_ROUTINE
 
 #ifdef ENHANCED_LMK_ROUTINE
@@ -63,20 +68,14 @@ static int lowmem_minfree[6] = {
 	16 * 1024,	/* 64MB */
 };
 static int lowmem_minfree_size = 4;
-#ifdef CONFIG_ZRAM_FOR_ANDROID
 static struct class *lmk_class;
 static struct device *lmk_dev;
+#ifdef CONFIG_ZRAM_FOR_ANDROID
 static int lmk_kill_pid = 0;
 static int lmk_kill_ok = 0;
 
 extern atomic_t optimize_comp_on;
 
-extern int isolate_lru_page_compcache(struct page *page);
-extern void putback_lru_page(struct page *page);
-extern unsigned int zone_id_shrink_pagelist(struct zone *zone_id,struct list_head *page_list);
-
-#define lru_to_page(_head) (list_entry((_head)->prev, struct page, lru))
-
 #define SWAP_PROCESS_DEBUG_LOG 0
 /* free RAM 8M(2048 pages) */
 #define CHECK_FREE_MEMORY 2048
@@ -85,12 +84,6 @@ extern unsigned int zone_id_shrink_pagelist(struct zone *zone_id,struct list_hea
 
 static unsigned int check_free_memory = 0;
 
-enum pageout_io {
-	PAGEOUT_IO_ASYNC,
-	PAGEOUT_IO_SYNC,
-};
-
-
 #endif /* CONFIG_ZRAM_FOR_ANDROID */
 
 #ifdef ENHANCED_LMK_ROUTINE
@@ -107,6 +100,245 @@ static unsigned long lowmem_deathpending_timeout;
 			printk(x);			\
 	} while (0)
 
+/*
+ * Kill cost accounting, per lowmem_adj tier: how long victim selection
+ * took and how long a victim took to be freed after SIGKILL.
+ */
+#define LOWMEM_NR_TIERS		ARRAY_SIZE(lowmem_adj)
+#define LOWMEM_HIST_BINS	22	/* up to ~2s in log2(us) bins */
+
+struct lowmem_tier_stats {
+	unsigned long scans;
+	unsigned long kills;
+	unsigned long pages;		/* rss of the tasks killed */
+	unsigned long select_hist[LOWMEM_HIST_BINS];
+	unsigned long reap_hist[LOWMEM_HIST_BINS];
+};
+
+static struct lowmem_tier_stats lowmem_stats[LOWMEM_NR_TIERS];
+static DEFINE_SPINLOCK(lowmem_stats_lock);
+
+#ifdef CONFIG_ANDROID_LMK_MEMCG
+static bool lowmem_memcg = true;
+static unsigned long lowmem_memcg_picks;	/* scans served by a memcg */
+#endif
+
+#ifdef ENHANCED_LMK_ROUTINE
+static ktime_t lowmem_deathpending_start[LOWMEM_DEATHPENDING_DEPTH];
+static int lowmem_deathpending_tier[LOWMEM_DEATHPENDING_DEPTH];
+#else
+static ktime_t lowmem_deathpending_start;
+static int lowmem_deathpending_tier;
+#endif
+
+static unsigned int lowmem_hist_bin(ktime_t start)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+
+	if (us <= 0)
+		return 0;
+	return min_t(unsigned int, fls64(us), LOWMEM_HIST_BINS - 1);
+}
+
+static void lowmem_account_reap(int tier, ktime_t start)
+{
+	unsigned int bin = lowmem_hist_bin(start);
+	unsigned long flags;
+
+	spin_lock_irqsave(&lowmem_stats_lock, flags);
+	lowmem_stats[tier].reap_hist[bin]++;
+	spin_unlock_irqrestore(&lowmem_stats_lock, flags);
+}
+
+#ifdef CONFIG_ANDROID_LMK_PRESSURE
+/*
+ * Memory pressure level for userspace, exported as the pollable
+ * pressure_level attribute of the lowmemorykiller device. vmscan reports
+ * scanned/reclaimed pages through lowmem_vmpressure(); once a window of
+ * pages has been scanned the reclaim efficiency gives a level. The tier
+ * lowmem_shrink() is about to kill from raises it further.
+ */
+enum lowmem_pressure_level {
+	LOWMEM_PRESSURE_NONE,
+	LOWMEM_PRESSURE_LOW,
+	LOWMEM_PRESSURE_MEDIUM,
+	LOWMEM_PRESSURE_CRITICAL,
+};
+
+static const char * const lowmem_pressure_names[] = {
+	"none", "low", "medium", "critical",
+};
+
+static unsigned int lowmem_pressure_window = SWAP_CLUSTER_MAX * 16;
+static unsigned int lowmem_pressure_medium = 60;	/* % not reclaimed */
+static unsigned int lowmem_pressure_critical = 95;
+static unsigned int lowmem_pressure_hold_ms = 1000;
+
+static unsigned long lowmem_pressure_scanned;
+static unsigned long lowmem_pressure_reclaimed;
+static enum lowmem_pressure_level lowmem_pressure_level;
+static unsigned long lowmem_pressure_stamp;
+static DEFINE_SPINLOCK(lowmem_pressure_lock);
+
+/* sysfs_notify() may sleep on sysfs_mutex, so never call it from reclaim */
+static void lowmem_pressure_notify_fn(struct work_struct *work)
+{
+	if (lmk_dev)
+		sysfs_notify(&lmk_dev->kobj, NULL, "pressure_level");
+}
+static DECLARE_WORK(lowmem_pressure_work, lowmem_pressure_notify_fn);
+
+static enum lowmem_pressure_level lowmem_pressure_get(void)
+{
+	unsigned long hold = msecs_to_jiffies(lowmem_pressure_hold_ms);
+
+	if (time_after(jiffies, lowmem_pressure_stamp + hold))
+		return LOWMEM_PRESSURE_NONE;
+	return lowmem_pressure_level;
+}
+
+/* Called with lowmem_pressure_lock held */
+static void lowmem_pressure_set(enum lowmem_pressure_level level)
+{
+	/*
+	 * Wake pollers on every change, and on every event at medium and
+	 * above so userspace keeps trimming while pressure persists.
+	 */
+	bool notify = level != lowmem_pressure_get() ||
+		level >= LOWMEM_PRESSURE_MEDIUM;
+
+	lowmem_pressure_level = level;
+	lowmem_pressure_stamp = jiffies;
+	if (notify)
+		schedule_work(&lowmem_pressure_work);
+}
+
+void lowmem_vmpressure(gfp_t gfp_mask, unsigned long scanned,
+		       unsigned long reclaimed)
+{
+	enum lowmem_pressure_level level;
+	unsigned long flags;
+	unsigned long pressure;
+
+	/* Only pressure that userspace can relieve by freeing memory */
+	if (!(gfp_mask & (__GFP_HIGHMEM | __GFP_MOVABLE | __GFP_IO | __GFP_FS)))
+		return;
+	if (!scanned)
+		return;
+
+	spin_lock_irqsave(&lowmem_pressure_lock, flags);
+	lowmem_pressure_scanned += scanned;
+	lowmem_pressure_reclaimed += reclaimed;
+	if (lowmem_pressure_scanned < lowmem_pressure_window) {
+		spin_unlock_irqrestore(&lowmem_pressure_lock, flags);
+		return;
+	}
+
+	scanned = lowmem_pressure_scanned;
+	reclaimed = min(lowmem_pressure_reclaimed, scanned);
+	lowmem_pressure_scanned = 0;
+	lowmem_pressure_reclaimed = 0;
+
+	pressure = 100 - reclaimed * 100 / scanned;
+	if (pressure >= lowmem_pressure_critical)
+		level = LOWMEM_PRESSURE_CRITICAL;
+	else if (pressure >= lowmem_pressure_medium)
+		level = LOWMEM_PRESSURE_MEDIUM;
+	else
+		level = LOWMEM_PRESSURE_LOW;
+
+	lowmem_pressure_set(level);
+	spin_unlock_irqrestore(&lowmem_pressure_lock, flags);
+}
+
+/*
+ * The lowest tier guards the foreground app, the upper half only
+ * cached and empty processes.
+ */
+static void lowmem_pressure_tier(int tier, int nr_tiers)
+{
+	enum lowmem_pressure_level level;
+	unsigned long flags;
+
+	if (tier == 0)
+		level = LOWMEM_PRESSURE_CRITICAL;
+	else if (tier < nr_tiers / 2)
+		level = LOWMEM_PRESSURE_MEDIUM;
+	else
+		level = LOWMEM_PRESSURE_LOW;
+
+	spin_lock_irqsave(&lowmem_pressure_lock, flags);
+	/* Never lower what reclaim efficiency already reported */
+	lowmem_pressure_set(max(level, lowmem_pressure_get()));
+	spin_unlock_irqrestore(&lowmem_pressure_lock, flags);
+}
+
+static ssize_t pressure_level_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%s\n", lowmem_pressure_names[lowmem_pressure_get()]);
+}
+
+static DEVICE_ATTR(pressure_level, 0444, pressure_level_show, NULL);
+
+module_param_named(pressure_window, lowmem_pressure_window, uint,
+		   S_IRUGO | S_IWUSR);
+module_param_named(pressure_medium, lowmem_pressure_medium, uint,
+		   S_IRUGO | S_IWUSR);
+module_param_named(pressure_critical, lowmem_pressure_critical, uint,
+		   S_IRUGO | S_IWUSR);
+module_param_named(pressure_hold_ms, lowmem_pressure_hold_ms, uint,
+		   S_IRUGO | S_IWUSR);
+#else
+static inline void lowmem_pressure_tier(int tier, int nr_tiers) {}
+#endif
+
+#ifdef CONFIG_ANDROID_LMK_ADJ_BUCKETS
+/*
+ * Thread group leaders with an mm, hashed by their signal->oom_adj.
+ * Maintained from fork, exit, exec and the /proc oom_adj writers, so
+ * lowmem_shrink() only looks at the buckets it may kill from.  The lock
+ * is never taken from interrupts, so it leaves them alone; some updaters
+ * already run with them disabled under tasklist_lock or siglock.
+ */
+#define LOWMEM_NR_BUCKETS	(OOM_ADJUST_MAX - OOM_DISABLE + 1)
+
+static struct hlist_head lowmem_buckets[LOWMEM_NR_BUCKETS];
+static DEFINE_SPINLOCK(lowmem_bucket_lock);
+
+void lowmem_adj_update(struct task_struct *task)
+{
+	struct task_struct *leader = task->group_leader;
+	int adj;
+
+	if (leader->flags & PF_KTHREAD)
+		return;
+
+	adj = clamp_t(int, leader->signal->oom_adj, OOM_DISABLE,
+		      OOM_ADJUST_MAX);
+
+	spin_lock(&lowmem_bucket_lock);
+	if (!hlist_unhashed(&leader->lmk_node))
+		hlist_del(&leader->lmk_node);
+	/* Never re-add a task __unhash_process() has already dropped */
+	if (pid_alive(leader))
+		hlist_add_head(&leader->lmk_node,
+			       &lowmem_buckets[adj - OOM_DISABLE]);
+	else
+		INIT_HLIST_NODE(&leader->lmk_node);
+	spin_unlock(&lowmem_bucket_lock);
+}
+
+void lowmem_adj_remove(struct task_struct *task)
+{
+	/* lowmem_adj_update() may be hashing the task right now */
+	spin_lock(&lowmem_bucket_lock);
+	if (!hlist_unhashed(&task->lmk_node))
+		hlist_del_init(&task->lmk_node);
+	spin_unlock(&lowmem_bucket_lock);
+}
+#endif
+
 static int
 task_notify_func(struct notifier_block *self, unsigned long val, void *data);
 
@@ -118,42 +350,219 @@ static int
 task_notify_func(struct notifier_block *self, unsigned long val, void *data)
 {
 	struct task_struct *task = data;
-
 #ifdef ENHANCED_LMK_ROUTINE
 	int i = 0;
+#endif
+
+	lowmem_adj_remove(task);
+
+#ifdef ENHANCED_LMK_ROUTINE
 	for (i = 0; i < LOWMEM_DEATHPENDING_DEPTH; i++)
 		if (task == lowmem_deathpending[i]) {
 			lowmem_deathpending[i] = NULL;
+			lowmem_account_reap(lowmem_deathpending_tier[i],
+					    lowmem_deathpending_start[i]);
 		break;
 	}
 #else
-	if (task == lowmem_deathpending)
+	if (task == lowmem_deathpending) {
 		lowmem_deathpending = NULL;
+		lowmem_account_reap(lowmem_deathpending_tier,
+				    lowmem_deathpending_start);
+	}
 #endif
 	return NOTIFY_OK;
 }
 
-static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
-{
-	struct task_struct *tsk;
+struct lowmem_selection {
 #ifdef ENHANCED_LMK_ROUTINE
-	struct task_struct *selected[LOWMEM_DEATHPENDING_DEPTH] = {NULL,};
+	struct task_struct *task[LOWMEM_DEATHPENDING_DEPTH];
+	int tasksize[LOWMEM_DEATHPENDING_DEPTH];
+	int oom_adj[LOWMEM_DEATHPENDING_DEPTH];
+	int nr;
+	int max_idx;	/* the slot the next better task replaces */
 #else
-	struct task_struct *selected = NULL;
+	struct task_struct *task;
+	int tasksize;
+	int oom_adj;
 #endif
-	int rem = 0;
+};
+
+static void lowmem_select(struct task_struct *tsk, int min_adj,
+			  struct lowmem_selection *sel)
+{
+	struct task_struct *p;
+	int oom_adj;
 	int tasksize;
+#ifdef ENHANCED_LMK_ROUTINE
+	int is_exist_oom_task = 0;
 	int i;
-	int min_adj = OOM_ADJUST_MAX + 1;
+#endif
+
+	if (tsk->flags & PF_KTHREAD)
+		return;
+
+	p = find_lock_task_mm(tsk);
+	if (!p)
+		return;
+
+	oom_adj = p->signal->oom_adj;
+	if (oom_adj < min_adj) {
+		task_unlock(p);
+		return;
+	}
+	tasksize = get_mm_rss(p->mm);
+	task_unlock(p);
+	if (tasksize <= 0)
+		return;
 #ifdef ENHANCED_LMK_ROUTINE
-	int selected_tasksize[LOWMEM_DEATHPENDING_DEPTH] = {0,};
-	int selected_oom_adj[LOWMEM_DEATHPENDING_DEPTH] = {OOM_ADJUST_MAX,};
-	int all_selected_oom = 0;
-	int max_selected_oom_idx = 0;
+	if (sel->nr < LOWMEM_DEATHPENDING_DEPTH) {
+		for (i = 0; i < LOWMEM_DEATHPENDING_DEPTH; i++) {
+			if (!sel->task[i]) {
+				is_exist_oom_task = 1;
+				sel->max_idx = i;
+				break;
+			}
+		}
+	} else if (sel->oom_adj[sel->max_idx] < oom_adj ||
+		(sel->oom_adj[sel->max_idx] == oom_adj &&
+		sel->tasksize[sel->max_idx] < tasksize)) {
+		is_exist_oom_task = 1;
+	}
+
+	if (is_exist_oom_task) {
+		sel->task[sel->max_idx] = p;
+		sel->tasksize[sel->max_idx] = tasksize;
+		sel->oom_adj[sel->max_idx] = oom_adj;
+
+		if (sel->nr < LOWMEM_DEATHPENDING_DEPTH)
+			sel->nr++;
+
+		if (sel->nr == LOWMEM_DEATHPENDING_DEPTH) {
+			for (i = 0; i < LOWMEM_DEATHPENDING_DEPTH; i++) {
+				if (sel->oom_adj[i] < sel->oom_adj[sel->max_idx])
+					sel->max_idx = i;
+				else if (sel->oom_adj[i] == sel->oom_adj[sel->max_idx] &&
+					sel->tasksize[i] < sel->tasksize[sel->max_idx])
+					sel->max_idx = i;
+			}
+		}
+
+		lowmem_print(2, "select %d (%s), adj %d, size %d, to kill\n",
+			p->pid, p->comm, oom_adj, tasksize);
+	}
+#else
+	if (sel->task) {
+		if (oom_adj < sel->oom_adj)
+			return;
+		if (oom_adj == sel->oom_adj &&
+		    tasksize <= sel->tasksize)
+			return;
+	}
+	sel->task = p;
+	sel->tasksize = tasksize;
+	sel->oom_adj = oom_adj;
+	lowmem_print(2, "select %d (%s), adj %d, size %d, to kill\n",
+		     p->pid, p->comm, oom_adj, tasksize);
+#endif
+}
+
+#ifdef CONFIG_ANDROID_LMK_ADJ_BUCKETS
+/* True once no task with the given oom_adj can improve the selection */
+static int lowmem_selection_done(struct lowmem_selection *sel, int adj)
+{
+#ifdef ENHANCED_LMK_ROUTINE
+	return sel->nr == LOWMEM_DEATHPENDING_DEPTH &&
+		sel->oom_adj[sel->max_idx] > adj;
 #else
-	int selected_tasksize = 0;
-	int selected_oom_adj;
+	return sel->task && sel->oom_adj > adj;
 #endif
+}
+
+/* Walks the buckets from the highest oom_adj down to min_adj */
+static void lowmem_select_tasks(int min_adj, struct lowmem_selection *sel)
+{
+	struct task_struct *tsk;
+	struct hlist_node *pos;
+	int adj;
+
+	spin_lock(&lowmem_bucket_lock);
+	for (adj = OOM_ADJUST_MAX; adj >= min_adj; adj--) {
+		if (lowmem_selection_done(sel, adj))
+			break;
+		hlist_for_each_entry(tsk, pos,
+				     &lowmem_buckets[adj - OOM_DISABLE],
+				     lmk_node)
+			lowmem_select(tsk, min_adj, sel);
+	}
+	spin_unlock(&lowmem_bucket_lock);
+}
+#else
+static void lowmem_select_tasks(int min_adj, struct lowmem_selection *sel)
+{
+	struct task_struct *tsk;
+
+	for_each_process(tsk)
+		lowmem_select(tsk, min_adj, sel);
+}
+#endif
+
+#ifdef CONFIG_ANDROID_LMK_MEMCG
+struct lowmem_memcg_scan {
+	int min_adj;
+	struct lowmem_selection *sel;
+};
+
+static void lowmem_memcg_task(struct task_struct *tsk, void *data)
+{
+	struct lowmem_memcg_scan *scan = data;
+
+	if (thread_group_leader(tsk))
+		lowmem_select(tsk, scan->min_adj, scan->sel);
+}
+
+/*
+ * Look for victims in the memory cgroup furthest over its soft limit
+ * first; per-app groups that keep growing past what userspace budgeted
+ * for them go before well-behaved apps of the same oom_adj.  Falls back
+ * to the global walk when no group is over its soft limit or none of its
+ * tasks is eligible at min_adj.
+ */
+static void lowmem_memcg_select(int min_adj, struct lowmem_selection *sel)
+{
+	struct lowmem_memcg_scan scan = { min_adj, sel };
+	struct mem_cgroup *mem;
+	int found;
+
+	mem = lowmem_memcg ? mem_cgroup_lmk_victim() : NULL;
+	if (mem) {
+		mem_cgroup_lmk_scan_tasks(mem, lowmem_memcg_task, &scan);
+		mem_cgroup_lmk_put(mem);
+#ifdef ENHANCED_LMK_ROUTINE
+		found = sel->nr;
+#else
+		found = sel->task != NULL;
+#endif
+		if (found) {
+			lowmem_memcg_picks++;
+			return;
+		}
+	}
+	lowmem_select_tasks(min_adj, sel);
+}
+#else
+#define lowmem_memcg_select	lowmem_select_tasks
+#endif
+
+static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
+{
+	struct lowmem_selection sel = { };
+	int rem = 0;
+	int i;
+	int min_adj = OOM_ADJUST_MAX + 1;
+	int tier = 0;
+	ktime_t start;
+	unsigned long flags;
 	int array_size = ARRAY_SIZE(lowmem_adj);
 	int other_free = global_page_state(NR_FREE_PAGES);
 	int other_file = global_page_state(NR_FILE_PAGES) -
@@ -186,6 +595,7 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 		if (other_free < lowmem_minfree[i] &&
 		    other_file < lowmem_minfree[i]) {
 			min_adj = lowmem_adj[i];
+			tier = i;
 			break;
 		}
 	}
@@ -193,6 +603,8 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 		lowmem_print(3, "lowmem_shrink %lu, %x, ofree %d %d, ma %d\n",
 			     sc->nr_to_scan, sc->gfp_mask, other_free, other_file,
 			     min_adj);
+	if (sc->nr_to_scan > 0 && min_adj != OOM_ADJUST_MAX + 1)
+		lowmem_pressure_tier(tier, array_size);
 	rem = global_page_state(NR_ACTIVE_ANON) +
 		global_page_state(NR_ACTIVE_FILE) +
 		global_page_state(NR_INACTIVE_ANON) +
@@ -204,107 +616,55 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	}
 #ifdef ENHANCED_LMK_ROUTINE
 	for (i = 0; i < LOWMEM_DEATHPENDING_DEPTH; i++)
-		selected_oom_adj[i] = min_adj;
+		sel.oom_adj[i] = min_adj;
 #else
-	selected_oom_adj = min_adj;
+	sel.oom_adj = min_adj;
 #endif
 
+	start = ktime_get();
 	rcu_read_lock();
-	for_each_process(tsk) {
-		struct task_struct *p;
-		int oom_adj;
-#ifdef ENHANCED_LMK_ROUTINE
-		int is_exist_oom_task = 0;
-#endif
-
-		if (tsk->flags & PF_KTHREAD)
-			continue;
-
-		p = find_lock_task_mm(tsk);
-		if (!p)
-			continue;
-
-		oom_adj = p->signal->oom_adj;
-		if (oom_adj < min_adj) {
-			task_unlock(p);
-			continue;
-		}
-		tasksize = get_mm_rss(p->mm);
-		task_unlock(p);
-		if (tasksize <= 0)
-			continue;
-#ifdef ENHANCED_LMK_ROUTINE
-		if (all_selected_oom < LOWMEM_DEATHPENDING_DEPTH) {
-			for (i = 0; i < LOWMEM_DEATHPENDING_DEPTH; i++) {
-				if (!selected[i]) {
-					is_exist_oom_task = 1;
-					max_selected_oom_idx = i;
-					break;
-				}
-			}
-		} else if (selected_oom_adj[max_selected_oom_idx] < oom_adj ||
-			(selected_oom_adj[max_selected_oom_idx] == oom_adj &&
-			selected_tasksize[max_selected_oom_idx] < tasksize)) {
-			is_exist_oom_task = 1;
-		}
+	lowmem_memcg_select(min_adj, &sel);
 
-		if (is_exist_oom_task) {
-			selected[max_selected_oom_idx] = p;
-			selected_tasksize[max_selected_oom_idx] = tasksize;
-			selected_oom_adj[max_selected_oom_idx] = oom_adj;
-
-			if (all_selected_oom < LOWMEM_DEATHPENDING_DEPTH)
-				all_selected_oom++;
-
-			if (all_selected_oom == LOWMEM_DEATHPENDING_DEPTH) {
-				for (i = 0; i < LOWMEM_DEATHPENDING_DEPTH; i++) {
-					if (selected_oom_adj[i] < selected_oom_adj[max_selected_oom_idx])
-						max_selected_oom_idx = i;
-					else if (selected_oom_adj[i] == selected_oom_adj[max_selected_oom_idx] &&
-						selected_tasksize[i] < selected_tasksize[max_selected_oom_idx])
-						max_selected_oom_idx = i;
-				}
-			}
+	spin_lock_irqsave(&lowmem_stats_lock, flags);
+	lowmem_stats[tier].scans++;
+	lowmem_stats[tier].select_hist[lowmem_hist_bin(start)]++;
+	spin_unlock_irqrestore(&lowmem_stats_lock, flags);
 
-			lowmem_print(2, "select %d (%s), adj %d, size %d, to kill\n",
-				p->pid, p->comm, oom_adj, tasksize);
-		}
-#else
-		if (selected) {
-			if (oom_adj < selected_oom_adj)
-				continue;
-			if (oom_adj == selected_oom_adj &&
-			    tasksize <= selected_tasksize)
-				continue;
-		}
-		selected = p;
-		selected_tasksize = tasksize;
-		selected_oom_adj = oom_adj;
-		lowmem_print(2, "select %d (%s), adj %d, size %d, to kill\n",
-			     p->pid, p->comm, oom_adj, tasksize);a
-#endif
-	}
 #ifdef ENHANCED_LMK_ROUTINE
 	for (i = 0; i < LOWMEM_DEATHPENDING_DEPTH; i++) {
-		if (selected[i]) {
+		if (sel.task[i]) {
 			lowmem_print(1, "send sigkill to %d (%s), adj %d, size %d\n",
-				selected[i]->pid, selected[i]->comm,
-				selected_oom_adj[i], selected_tasksize[i]);
-			lowmem_deathpending[i] = selected[i];
+				sel.task[i]->pid, sel.task[i]->comm,
+				sel.oom_adj[i], sel.tasksize[i]);
+			lowmem_deathpending[i] = sel.task[i];
 			lowmem_deathpending_timeout = jiffies + HZ;
-			force_sig(SIGKILL, selected[i]);
-			rem -= selected_tasksize[i];
+			lowmem_deathpending_start[i] = ktime_get();
+			lowmem_deathpending_tier[i] = tier;
+			force_sig(SIGKILL, sel.task[i]);
+			rem -= sel.tasksize[i];
+
+			spin_lock_irqsave(&lowmem_stats_lock, flags);
+			lowmem_stats[tier].kills++;
+			lowmem_stats[tier].pages += sel.tasksize[i];
+			spin_unlock_irqrestore(&lowmem_stats_lock, flags);
 		}
 	}
 #else
-	if (selected) {
+	if (sel.task) {
 		lowmem_print(1, "send sigkill to %d (%s), adj %d, size %d\n",
-			     selected->pid, selected->comm,
-			     selected_oom_adj, selected_tasksize);
-		lowmem_deathpending = selected;
+			     sel.task->pid, sel.task->comm,
+			     sel.oom_adj, sel.tasksize);
+		lowmem_deathpending = sel.task;
 		lowmem_deathpending_timeout = jiffies + HZ;
-		send_sig(SIGKILL, selected, 0);
-		rem -= selected_tasksize;
+		lowmem_deathpending_start = ktime_get();
+		lowmem_deathpending_tier = tier;
+		send_sig(SIGKILL, sel.task, 0);
+		rem -= sel.tasksize;
+
+		spin_lock_irqsave(&lowmem_stats_lock, flags);
+		lowmem_stats[tier].kills++;
+		lowmem_stats[tier].pages += sel.tasksize;
+		spin_unlock_irqrestore(&lowmem_stats_lock, flags);
 	}
 #endif
 	lowmem_print(4, "lowmem_shrink %lu, %x, return %d\n",
@@ -313,100 +673,75 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	return rem;
 }
 
-static struct shrinker lowmem_shrinker = {
-	.shrink = lowmem_shrink,
-	.seeks = DEFAULT_SEEKS * 16
-};
-
-#ifdef CONFIG_ZRAM_FOR_ANDROID
-/*
- * zone_id_shrink_pagelist() clear page flags,
- * update the memory zone status, and swap pagelist
- */
-
-static unsigned int shrink_pages(struct mm_struct *mm,
-				 struct list_head *zone0_page_list,
-				 struct list_head *zone1_page_list,
-				 unsigned int num_to_scan)
+#ifdef CONFIG_DEBUG_FS
+static int lowmem_stats_show(struct seq_file *s, void *data)
 {
-	unsigned long addr;
-	unsigned int isolate_pages_countter = 0;
-
-	struct vm_area_struct *vma = mm->mmap;
-	while (vma != NULL) {
-
-		for (addr = vma->vm_start; addr < vma->vm_end;
-		     addr += PAGE_SIZE) {
-			struct page *page;
-			/*get the page address from virtual memory address */
-			page = follow_page(vma, addr, FOLL_GET);
-
-			if (page && !IS_ERR(page)) {
-
-				put_page(page);
-				/* only moveable, anonymous and not dirty pages can be swapped  */
-				if ((!PageUnevictable(page))
-				    && (!PageDirty(page)) && ((PageAnon(page)))
-				    && (0 == page_is_file_cache(page))) {
-					switch (page_zone_id(page)) {
-					case 0:
-						if (!isolate_lru_page_compcache(page)) {
-							/* isolate page from LRU and add to temp list  */
-							/*create new page list, it will be used in shrink_page_list */
-							list_add_tail(&page->lru, zone0_page_list);
-							isolate_pages_countter++;
-						}
-						break;
-					case 1:
-						if (!isolate_lru_page_compcache(page)) {
-							/* isolate page from LRU and add to temp list  */
-							/*create new page list, it will be used in shrink_page_list */
-							list_add_tail(&page->lru, zone1_page_list);
-							isolate_pages_countter++;
-						}
-						break;
-					default:
-						break;
-					}
-				}
-			}
+	struct lowmem_tier_stats snap[LOWMEM_NR_TIERS];
+	unsigned long flags;
+	int tier, bin;
+
+	spin_lock_irqsave(&lowmem_stats_lock, flags);
+	memcpy(snap, lowmem_stats, sizeof(snap));
+	spin_unlock_irqrestore(&lowmem_stats_lock, flags);
+
+	seq_printf(s, "%-4s %4s %8s %8s %8s %10s\n",
+		   "tier", "adj", "minfree", "scans", "kills", "pages");
+	for (tier = 0; tier < lowmem_adj_size && tier < lowmem_minfree_size;
+	     tier++) {
+		seq_printf(s, "%-4d %4d %8d %8lu %8lu %10lu\n", tier,
+			   lowmem_adj[tier], lowmem_minfree[tier],
+			   snap[tier].scans, snap[tier].kills, snap[tier].pages);
+	}
 
-			if (isolate_pages_countter >= num_to_scan) {
-				return isolate_pages_countter;
-			}
+	for (tier = 0; tier < LOWMEM_NR_TIERS; tier++) {
+		if (!snap[tier].scans)
+			continue;
+		seq_printf(s, "\ntier %d select / reap:\n", tier);
+		for (bin = 0; bin < LOWMEM_HIST_BINS; bin++) {
+			if (!snap[tier].select_hist[bin] &&
+			    !snap[tier].reap_hist[bin])
+				continue;
+			seq_printf(s, "%8u - %8u us: %8lu %8lu\n",
+				   bin ? 1 << (bin - 1) : 0, 1 << bin,
+				   snap[tier].select_hist[bin],
+				   snap[tier].reap_hist[bin]);
 		}
-
-		vma = vma->vm_next;
 	}
+#ifdef CONFIG_ANDROID_LMK_MEMCG
+	seq_printf(s, "\nmemcg picks: %lu\n", lowmem_memcg_picks);
+#endif
 
-	return isolate_pages_countter;
+	return 0;
 }
 
-/*
- * swap_application_pages() will search the
- * pages which can be swapped, then call
- * zone_id_shrink_pagelist to update zone
- * status
- */
-static unsigned int swap_pages(struct list_head *zone0_page_list,
-			       struct list_head *zone1_page_list)
+static int lowmem_stats_open(struct inode *inode, struct file *file)
 {
-	struct zone *zone_id_0 = &NODE_DATA(0)->node_zones[0];
-	struct zone *zone_id_1 = &NODE_DATA(0)->node_zones[1];
-	unsigned int pages_counter = 0;
-
-	/*if the page list is not empty, call zone_id_shrink_pagelist to update zone status */
-	if ((zone_id_0) && (!list_empty(zone0_page_list))) {
-		pages_counter +=
-			zone_id_shrink_pagelist(zone_id_0, zone0_page_list);
-	}
-	if ((zone_id_1) && (!list_empty(zone1_page_list))) {
-		pages_counter +=
-			zone_id_shrink_pagelist(zone_id_1, zone1_page_list);
-	}
-	return pages_counter;
+	return single_open(file, lowmem_stats_show, inode->i_private);
+}
+
+static const struct file_operations lowmem_stats_fops = {
+	.open		= lowmem_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init lowmem_debug_init(void)
+{
+	if (!debugfs_create_file("lowmemorykiller", S_IRUGO, NULL, NULL,
+				 &lowmem_stats_fops))
+		return -ENOMEM;
+	return 0;
 }
+late_initcall(lowmem_debug_init);
+#endif
+
+static struct shrinker lowmem_shrinker = {
+	.shrink = lowmem_shrink,
+	.seeks = DEFAULT_SEEKS * 16
+};
 
+#ifdef CONFIG_ZRAM_FOR_ANDROID
 static ssize_t lmk_state_show(struct device *dev,
 			      struct device_attribute *attr, char *buf)
 {
@@ -483,19 +818,8 @@ static ssize_t lmk_state_store(struct device *dev,
 		read_unlock(&tasklist_lock);
 
 		if (mm_scan) {
-			LIST_HEAD(zone0_page_list);
-			LIST_HEAD(zone1_page_list);
-			int pages_tofree = 0, pages_freed = 0;
-
-			down_read(&mm_scan->mmap_sem);
-			pages_tofree =
-			shrink_pages(mm_scan, &zone0_page_list,
-					&zone1_page_list, 0x7FFFFFFF);
-			up_read(&mm_scan->mmap_sem);
+			reclaim_mm(mm_scan, RECLAIM_ANON);
 			mmput(mm_scan);
-			pages_freed =
-				swap_pages(&zone0_page_list,
-					&zone1_page_list);
 			lmk_kill_ok = 0;
 		}
 	}
@@ -522,6 +846,7 @@ static int __init lowmem_init(void)
 			high_wmark = zone->watermark[WMARK_HIGH];
 	}
 	check_free_memory = (high_wmark != 0) ? high_wmark : CHECK_FREE_MEMORY;
+#endif /* CONFIG_ZRAM_FOR_ANDROID */
 
 	lmk_class = class_create(THIS_MODULE, "lmk");
 	if (IS_ERR(lmk_class)) {
@@ -533,12 +858,19 @@ static int __init lowmem_init(void)
 		printk(KERN_ERR
 			"Failed to create device(lowmemorykiller)!= %ld\n",
 			IS_ERR(lmk_dev));
+		lmk_dev = NULL;
 		return 0;
 	}
+#ifdef CONFIG_ZRAM_FOR_ANDROID
 	if (device_create_file(lmk_dev, &dev_attr_lmk_state) < 0)
 		printk(KERN_ERR "Failed to create device file(%s)!\n",
 			dev_attr_lmk_state.attr.name);
 #endif /* CONFIG_ZRAM_FOR_ANDROID */
+#ifdef CONFIG_ANDROID_LMK_PRESSURE
+	if (device_create_file(lmk_dev, &dev_attr_pressure_level) < 0)
+		printk(KERN_ERR "Failed to create device file(%s)!\n",
+			dev_attr_pressure_level.attr.name);
+#endif
 
 	return 0;
 }
@@ -555,6 +887,9 @@ module_param_array_named(adj, lowmem_adj, int, &lowmem_adj_size,
 module_param_array_named(minfree, lowmem_minfree, uint, &lowmem_minfree_size,
 			 S_IRUGO | S_IWUSR);
 module_param_named(debug_level, lowmem_debug_level, uint, S_IRUGO | S_IWUSR);
+#ifdef CONFIG_ANDROID_LMK_MEMCG
+module_param_named(memcg, lowmem_memcg, bool, S_IRUGO | S_IWUSR);
+#endif
 
 module_init(lowmem_init);
 module_exit(lowmem_exit);
@@ -26,6 +26,9 @@
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
 #include <linux/rslib.h>
 #endif
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_FAST
+#include <linux/crc32.h>
+#endif
 
 struct ram_console_buffer {
 	uint32_t    sig;
@@ -34,7 +37,11 @@ struct ram_console_buffer {
 	uint8_t     data[0];
 };
 
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_FAST
+#define RAM_CONSOLE_SIG (0x43474252) /* RBGC */
+#else
 #define RAM_CONSOLE_SIG (0x43474244) /* DBGC */
+#endif
 
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_EARLY_INIT
 static char __initdata
@@ -79,6 +86,80 @@ static int ram_console_decode_rs8(void *data, size_t len, uint8_t *ecc)
 }
 #endif
 
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_FAST
+/*
+ * Records follow each other in the buffer, and whoever holds the console
+ * lock appends the next one at buffer->start.  A record that does not fit
+ * before the end goes at the start, after a wrap marker if there is room
+ * for one.  Only the text being written is checksummed, from where printk
+ * has it; nothing is read back from the uncached buffer.
+ */
+#define RAM_CONSOLE_REC_MAGIC	0x6b6c
+#define RAM_CONSOLE_REC_WRAP	0x7770
+#define RAM_CONSOLE_REC_MAX	1024
+
+struct ram_console_record {
+	uint16_t    magic;
+	uint16_t    len;
+	uint32_t    seq;
+	uint32_t    crc;
+	uint8_t     data[0];
+};
+
+static uint32_t ram_console_seq;
+
+static uint32_t ram_console_record_crc(struct ram_console_record *rec,
+				       const void *data)
+{
+	uint32_t crc;
+
+	crc = crc32_le(~0, (unsigned char *)rec,
+		       offsetof(struct ram_console_record, crc));
+	return crc32_le(crc, data, rec->len);
+}
+
+static void ram_console_put_record(uint16_t magic, const char *s,
+				   unsigned int len)
+{
+	struct ram_console_buffer *buffer = ram_console_buffer;
+	struct ram_console_record rec;
+	uint8_t *dst = buffer->data + buffer->start;
+
+	rec.magic = magic;
+	rec.len = len;
+	rec.seq = ++ram_console_seq;
+	rec.crc = ram_console_record_crc(&rec, s);
+	memcpy(dst + sizeof(rec), s, len);
+	memcpy(dst, &rec, sizeof(rec));
+}
+
+static void
+ram_console_write(struct console *console, const char *s, unsigned int count)
+{
+	struct ram_console_buffer *buffer = ram_console_buffer;
+
+	while (count) {
+		unsigned int len = min_t(unsigned int, count,
+					 RAM_CONSOLE_REC_MAX);
+		size_t need = sizeof(struct ram_console_record) + ALIGN(len, 4);
+
+		if (buffer->start + need > ram_console_buffer_size) {
+			if (buffer->start + sizeof(struct ram_console_record)
+			    <= ram_console_buffer_size)
+				ram_console_put_record(RAM_CONSOLE_REC_WRAP,
+						       NULL, 0);
+			buffer->size = ram_console_buffer_size;
+			buffer->start = 0;
+		}
+		ram_console_put_record(RAM_CONSOLE_REC_MAGIC, s, len);
+		buffer->start += need;
+		if (buffer->size < buffer->start)
+			buffer->size = buffer->start;
+		s += len;
+		count -= len;
+	}
+}
+#else
 static void ram_console_update(const char *s, unsigned int count)
 {
 	struct ram_console_buffer *buffer = ram_console_buffer;
@@ -139,6 +220,7 @@ ram_console_write(struct console *console, const char *s, unsigned int count)
 		buffer->size += count;
 	ram_console_update_header();
 }
+#endif
 
 static struct console ram_console = {
 	.name	= "ram",
@@ -155,6 +237,106 @@ void ram_console_enable_console(int enabled)
 		ram_console.flags &= ~CON_ENABLED;
 }
 
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_FAST
+/* Returns the record at @off if it is whole and newer than @seq */
+static struct ram_console_record * __init
+ram_console_check_record(struct ram_console_buffer *buffer, size_t off,
+			 uint32_t seq)
+{
+	struct ram_console_record *rec = (void *)(buffer->data + off);
+
+	if (off + sizeof(*rec) > ram_console_buffer_size)
+		return NULL;
+	if (rec->magic != RAM_CONSOLE_REC_MAGIC &&
+	    (rec->magic != RAM_CONSOLE_REC_WRAP || rec->len))
+		return NULL;
+	if (off + sizeof(*rec) + rec->len > ram_console_buffer_size)
+		return NULL;
+	if (seq && (int32_t)(rec->seq - seq) <= 0)
+		return NULL;
+	if (ram_console_record_crc(rec, rec->data) != rec->crc)
+		return NULL;
+	return rec;
+}
+
+/*
+ * Decodes the records, oldest first: from buffer->start to the wrap
+ * marker once the buffer has filled, then from 0 up to buffer->start.
+ * Whatever does not check out is skipped, four bytes at a time until a
+ * record does again.
+ */
+static void __init
+ram_console_save_old(struct ram_console_buffer *buffer, const char *bootinfo,
+	char *dest)
+{
+	struct ram_console_record *rec;
+	size_t off, end, total_size;
+	const char *bootinfo_label = "Boot info:\n";
+	size_t bootinfo_size = 0;
+	bool in_record = false;
+	int records = 0, damaged = 0;
+	uint32_t seq = 0;
+	char *ptr;
+	int lap, n;
+
+	if (bootinfo)
+		bootinfo_size = strlen(bootinfo) + strlen(bootinfo_label);
+
+	if (dest == NULL) {
+		/* the text, the line about damage, and the boot info */
+		total_size = buffer->size + 80 + bootinfo_size;
+		dest = kmalloc(total_size, GFP_KERNEL);
+		if (dest == NULL) {
+			printk(KERN_ERR
+			       "ram_console: failed to allocate buffer\n");
+			return;
+		}
+	} else {
+		/* early, where @dest is only as big as the buffer */
+		total_size = buffer->size;
+	}
+	ptr = dest;
+
+	for (lap = 0; lap < 2; lap++) {
+		if (lap == 0 && buffer->size < ram_console_buffer_size)
+			continue;
+		off = lap ? 0 : buffer->start;
+		end = lap ? buffer->start : ram_console_buffer_size;
+		while (off < end) {
+			rec = ram_console_check_record(buffer, off, seq);
+			if (!rec) {
+				/* not counted before the first good one */
+				if (in_record)
+					damaged++;
+				in_record = false;
+				off += 4;
+				continue;
+			}
+			in_record = true;
+			seq = rec->seq;
+			if (rec->magic == RAM_CONSOLE_REC_WRAP)
+				break;
+			memcpy(ptr, rec->data, rec->len);
+			ptr += rec->len;
+			records++;
+			off += sizeof(*rec) + ALIGN(rec->len, 4);
+		}
+	}
+
+	n = snprintf(ptr, total_size - (ptr - dest),
+		     "\n%d records, %d damaged spans skipped\n",
+		     records, damaged);
+	ptr += min_t(size_t, n, total_size - (ptr - dest) - 1);
+	if (bootinfo) {
+		memcpy(ptr, bootinfo_label, strlen(bootinfo_label));
+		ptr += strlen(bootinfo_label);
+		memcpy(ptr, bootinfo, strlen(bootinfo));
+		ptr += strlen(bootinfo);
+	}
+	ram_console_old_log = dest;
+	ram_console_old_log_size = ptr - dest;
+}
+#else
 static void __init
 ram_console_save_old(struct ram_console_buffer *buffer, const char *bootinfo,
 	char *dest)
@@ -238,6 +420,7 @@ ram_console_save_old(struct ram_console_buffer *buffer, const char *bootinfo,
 		ptr += bootinfo_size;
 	}
 }
+#endif
 
 static int __init ram_console_init(struct ram_console_buffer *buffer,
 				   size_t buffer_size, const char *bootinfo,
@@ -258,6 +441,16 @@ static int __init ram_console_init(struct ram_console_buffer *buffer,
 		return 0;
 	}
 
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_FAST
+	ram_console_buffer_size &= ~3;
+	if (ram_console_buffer_size <
+	    2 * (sizeof(struct ram_console_record) + RAM_CONSOLE_REC_MAX)) {
+		pr_err("ram_console: buffer %p, size %zu too small\n",
+		       buffer, buffer_size);
+		return 0;
+	}
+#endif
+
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
 	ram_console_buffer_size -= (DIV_ROUND_UP(ram_console_buffer_size,
 						ECC_BLOCK_SIZE) + 1) * ECC_SIZE;
@@ -300,7 +493,11 @@ static int __init ram_console_init(struct ram_console_buffer *buffer,
 
 	if (buffer->sig == RAM_CONSOLE_SIG) {
 		if (buffer->size > ram_console_buffer_size
-		    || buffer->start > buffer->size)
+		    || buffer->start > buffer->size
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_FAST
+		    || buffer->start % 4
+#endif
+		    )
 			printk(KERN_INFO "ram_console: found existing invalid "
 			       "buffer, size %d, start %d\n",
 			       buffer->size, buffer->start);
@@ -10,10 +10,9 @@
  * 1) "compression buddies" ("zbud") is used for ephemeral pages
  * 2) xvmalloc is used for persistent pages.
  * Xvmalloc (based on the TLSF allocator) has very low fragmentation
- * so maximizes space efficiency, while zbud allows pairs (and potentially,
- * in the future, more than a pair of) compressed pages to be closely linked
- * so that reclaiming can be done via the kernel's physical-page-oriented
- * "shrinker" interface.
+ * so maximizes space efficiency, while zbud allows up to three compressed
+ * pages to be closely linked so that reclaiming can be done via the
+ * kernel's physical-page-oriented "shrinker" interface.
  *
  * [1] For a definition of page-accessible memory (aka PAM), see:
  *   http://marc.info/?l=linux-mm&m=127811271605009
@@ -29,6 +28,7 @@
 #include <linux/types.h>
 #include <linux/atomic.h>
 #include <linux/math64.h>
+#include <linux/ktime.h>
 #include "tmem.h"
 
 #include "../zram/xvmalloc.h" /* if built in drivers/staging */
@@ -58,8 +58,27 @@
 
 MODULE_LICENSE("GPL");
 
+/*
+ * Per-pool counters, so the cost of each cleancache filesystem or
+ * frontswap can be weighed against its hit rate.  Like the global
+ * counters below they are updated without locks and are approximate.
+ */
+struct zcache_pool_stats {
+	unsigned long puts;
+	unsigned long failed_puts;
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long flushes;
+	unsigned long evictions;
+	u64 put_ns;
+	u64 hit_ns;
+	u64 miss_ns;
+	u64 evict_ns;
+};
+
 struct zcache_client {
 	struct tmem_pool *tmem_pools[MAX_POOLS_PER_CLIENT];
+	struct zcache_pool_stats pool_stats[MAX_POOLS_PER_CLIENT];
 	struct xv_pool *xvpool;
 	bool allocated;
 	atomic_t refcount;
@@ -81,27 +100,47 @@ static inline bool is_local_client(struct zcache_client *cli)
 	return cli == &zcache_host;
 }
 
+static inline struct zcache_pool_stats *zcache_pool_stats(
+						struct tmem_pool *pool)
+{
+	struct zcache_client *cli = pool->client;
+
+	return &cli->pool_stats[pool->pool_id];
+}
+
+static inline u64 zcache_ns_since(ktime_t start)
+{
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
 /**********
- * Compression buddies ("zbud") provides for packing two (or, possibly
- * in the future, more) compressed ephemeral pages into a single "raw"
- * (physical) page and tracking them with data structures so that
- * the raw pages can be easily reclaimed.
+ * Compression buddies ("zbud") provides for packing up to three compressed
+ * ephemeral pages into a single "raw" (physical) page and tracking them
+ * with data structures so that the raw pages can be easily reclaimed.
  *
  * A zbud page ("zbpg") is an aligned page containing a list_head,
- * a lock, and two "zbud headers".  The remainder of the physical
+ * a lock, and three "zbud headers".  The remainder of the physical
  * page is divided up into aligned 64-byte "chunks" which contain
- * the compressed data for zero, one, or two zbuds.  Each zbpg
- * resides on: (1) an "unused list" if it has no zbuds; (2) a
- * "buddied" list if it is fully populated  with two zbuds; or
- * (3) one of PAGE_SIZE/64 "unbuddied" lists indexed by how many chunks
- * the one unbuddied zbud uses.  The data inside a zbpg cannot be
- * read or written unless the zbpg's lock is held.
+ * the compressed data for zero to three zbuds.  Buddy 0 starts at the
+ * first chunk, buddy 1 ends at the last one and buddy 2, the "middle"
+ * buddy, sits in between at middle_chunk; data is never moved once
+ * stored.  Each zbpg resides on: (1) an "unused list" if it has no zbuds;
+ * (2) a "buddied" list if it has no room left for another zbud; or
+ * (3) one of PAGE_SIZE/64 "unbuddied" lists indexed by NCHUNKS minus the
+ * largest number of free chunks a new zbud could use.  The data inside a
+ * zbpg cannot be read or written unless the zbpg's lock is held.
+ *
+ * zbud_max_buds (sysfs) set to 2 restores the original pairs-only packing.
  */
 
 #define ZBH_SENTINEL  0x43214321
 #define ZBPG_SENTINEL  0xdeadbeef
 
-#define ZBUD_MAX_BUDS 2
+#define ZBUD_MAX_BUDS 3
+
+#define ZBUD_FIRST	0
+#define ZBUD_LAST	1
+#define ZBUD_MIDDLE	2
 
 struct zbud_hdr {
 	uint16_t client_id;
@@ -116,6 +155,8 @@ struct zbud_page {
 	struct list_head bud_list;
 	spinlock_t lock;
 	struct zbud_hdr buddy[ZBUD_MAX_BUDS];
+	uint16_t middle_chunk; /* first chunk of the middle buddy */
+	uint16_t list_index; /* unbuddied list, or NCHUNKS if buddied */
 	DECL_SENTINEL
 	/* followed by NUM_CHUNK aligned CHUNK_SIZE-byte chunks */
 };
@@ -131,7 +172,7 @@ static struct {
 	struct list_head list;
 	unsigned count;
 } zbud_unbuddied[NCHUNKS];
-/* list N contains pages with N chunks USED and NCHUNKS-N unused */
+/* list N contains pages with NCHUNKS-N chunks usable by a new zbud */
 /* element 0 is never used but optimizing that isn't worth it */
 static unsigned long zbud_cumul_chunk_counts[NCHUNKS];
 
@@ -152,9 +193,13 @@ static atomic_t zcache_zbud_curr_zpages;
 static unsigned long zcache_zbud_curr_zbytes;
 static unsigned long zcache_zbud_cumul_zpages;
 static unsigned long zcache_zbud_cumul_zbytes;
+static unsigned long zcache_zbud_middle_zpages;
 static unsigned long zcache_compress_poor;
 static unsigned long zcache_mean_compress_poor;
 
+/* 2 packs pairs like the original zbud, 3 also uses the middle buddy */
+static unsigned int zbud_max_buds = ZBUD_MAX_BUDS;
+
 /* forward references */
 static void *zcache_get_free_page(void);
 static void zcache_free_page(void *p);
@@ -174,6 +219,11 @@ static inline unsigned zbud_size_to_chunks(unsigned size)
 	return (size + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
 }
 
+static inline unsigned zbud_chunks(struct zbud_hdr *zh)
+{
+	return zh->size ? zbud_size_to_chunks(zh->size) : 0;
+}
+
 static inline int zbud_budnum(struct zbud_hdr *zh)
 {
 	unsigned offset = (unsigned long)zh & (PAGE_SIZE - 1);
@@ -202,14 +252,106 @@ static char *zbud_data(struct zbud_hdr *zh, unsigned size)
 	zbpg = container_of(zh, struct zbud_page, buddy[budnum]);
 	ASSERT_SPINLOCK(&zbpg->lock);
 	p = (char *)zbpg;
-	if (budnum == 0)
+	if (budnum == ZBUD_FIRST)
 		p += ((sizeof(struct zbud_page) + CHUNK_SIZE - 1) &
 							CHUNK_MASK);
-	else if (budnum == 1)
+	else if (budnum == ZBUD_LAST)
 		p += PAGE_SIZE - ((size + CHUNK_SIZE - 1) & CHUNK_MASK);
+	else
+		p += ((sizeof(struct zbud_page) + CHUNK_SIZE - 1) &
+			CHUNK_MASK) + (zbpg->middle_chunk << CHUNK_SHIFT);
 	return p;
 }
 
+static inline bool zbud_page_empty(struct zbud_page *zbpg)
+{
+	int i;
+
+	for (i = 0; i < ZBUD_MAX_BUDS; i++)
+		if (zbpg->buddy[i].size)
+			return false;
+	return true;
+}
+
+/*
+ * Largest number of chunks a new zbud could be given in this zbpg,
+ * zbpg lock held.
+ */
+static unsigned zbud_free_chunks(struct zbud_page *zbpg)
+{
+	struct zbud_hdr *first = &zbpg->buddy[ZBUD_FIRST];
+	struct zbud_hdr *last = &zbpg->buddy[ZBUD_LAST];
+	struct zbud_hdr *middle = &zbpg->buddy[ZBUD_MIDDLE];
+	unsigned lo = 0, hi = 0;
+
+	if (middle->size == 0) {
+		if (first->size && last->size && zbud_max_buds < 3)
+			return 0;
+		return NCHUNKS - zbud_chunks(first) - zbud_chunks(last);
+	}
+	if (first->size == 0)
+		lo = zbpg->middle_chunk;
+	if (last->size == 0)
+		hi = NCHUNKS - zbpg->middle_chunk - zbud_chunks(middle);
+	return max(lo, hi);
+}
+
+/*
+ * Pick the vacant buddy that can hold nchunks, or NULL; zbpg lock held.
+ * The middle buddy is only started as the third zbud of a page.
+ */
+static struct zbud_hdr *zbud_pick_buddy(struct zbud_page *zbpg,
+					unsigned nchunks)
+{
+	struct zbud_hdr *first = &zbpg->buddy[ZBUD_FIRST];
+	struct zbud_hdr *last = &zbpg->buddy[ZBUD_LAST];
+	struct zbud_hdr *middle = &zbpg->buddy[ZBUD_MIDDLE];
+
+	if (zbud_free_chunks(zbpg) < nchunks)
+		return NULL;
+	if (middle->size == 0) {
+		if (first->size == 0)
+			return first;
+		if (last->size == 0)
+			return last;
+		zbpg->middle_chunk = zbud_chunks(first);
+		return middle;
+	}
+	if (first->size == 0 && zbpg->middle_chunk >= nchunks)
+		return first;
+	if (last->size == 0)
+		return last;
+	return NULL;
+}
+
+/* zbud_budlists_spinlock and the zbpg lock held, zbpg on no list */
+static void zbud_list_add(struct zbud_page *zbpg)
+{
+	unsigned free = zbud_free_chunks(zbpg);
+
+	if (free == 0) {
+		zbpg->list_index = NCHUNKS;
+		list_add_tail(&zbpg->bud_list, &zbud_buddied_list);
+		zcache_zbud_buddied_count++;
+	} else {
+		zbpg->list_index = NCHUNKS - free;
+		list_add_tail(&zbpg->bud_list,
+			      &zbud_unbuddied[zbpg->list_index].list);
+		zbud_unbuddied[zbpg->list_index].count++;
+	}
+}
+
+/* zbud_budlists_spinlock held */
+static void zbud_list_del(struct zbud_page *zbpg)
+{
+	BUG_ON(list_empty(&zbpg->bud_list));
+	list_del_init(&zbpg->bud_list);
+	if (zbpg->list_index == NCHUNKS)
+		zcache_zbud_buddied_count--;
+	else
+		zbud_unbuddied[zbpg->list_index].count--;
+}
+
 /*
  * zbud raw page management
  */
@@ -217,8 +359,8 @@ static char *zbud_data(struct zbud_hdr *zh, unsigned size)
 static struct zbud_page *zbud_alloc_raw_page(void)
 {
 	struct zbud_page *zbpg = NULL;
-	struct zbud_hdr *zh0, *zh1;
 	bool recycled = 0;
+	int i;
 
 	/* if any pages on the zbpg list, use one */
 	spin_lock(&zbpg_unused_list_spinlock);
@@ -235,20 +377,22 @@ static struct zbud_page *zbud_alloc_raw_page(void)
 		zbpg = zcache_get_free_page();
 	if (likely(zbpg != NULL)) {
 		INIT_LIST_HEAD(&zbpg->bud_list);
-		zh0 = &zbpg->buddy[0]; zh1 = &zbpg->buddy[1];
 		spin_lock_init(&zbpg->lock);
+		zbpg->middle_chunk = 0;
 		if (recycled) {
 			ASSERT_INVERTED_SENTINEL(zbpg, ZBPG);
 			SET_SENTINEL(zbpg, ZBPG);
-			BUG_ON(zh0->size != 0 || tmem_oid_valid(&zh0->oid));
-			BUG_ON(zh1->size != 0 || tmem_oid_valid(&zh1->oid));
+			for (i = 0; i < ZBUD_MAX_BUDS; i++)
+				BUG_ON(zbpg->buddy[i].size != 0 ||
+				       tmem_oid_valid(&zbpg->buddy[i].oid));
 		} else {
 			atomic_inc(&zcache_zbud_curr_raw_pages);
 			INIT_LIST_HEAD(&zbpg->bud_list);
 			SET_SENTINEL(zbpg, ZBPG);
-			zh0->size = 0; zh1->size = 0;
-			tmem_oid_set_invalid(&zh0->oid);
-			tmem_oid_set_invalid(&zh1->oid);
+			for (i = 0; i < ZBUD_MAX_BUDS; i++) {
+				zbpg->buddy[i].size = 0;
+				tmem_oid_set_invalid(&zbpg->buddy[i].oid);
+			}
 		}
 	}
 	return zbpg;
@@ -256,13 +400,14 @@ static struct zbud_page *zbud_alloc_raw_page(void)
 
 static void zbud_free_raw_page(struct zbud_page *zbpg)
 {
-	struct zbud_hdr *zh0 = &zbpg->buddy[0], *zh1 = &zbpg->buddy[1];
+	int i;
 
 	ASSERT_SENTINEL(zbpg, ZBPG);
 	BUG_ON(!list_empty(&zbpg->bud_list));
 	ASSERT_SPINLOCK(&zbpg->lock);
-	BUG_ON(zh0->size != 0 || tmem_oid_valid(&zh0->oid));
-	BUG_ON(zh1->size != 0 || tmem_oid_valid(&zh1->oid));
+	for (i = 0; i < ZBUD_MAX_BUDS; i++)
+		BUG_ON(zbpg->buddy[i].size != 0 ||
+		       tmem_oid_valid(&zbpg->buddy[i].oid));
 	INVERT_SENTINEL(zbpg, ZBPG);
 	spin_unlock(&zbpg->lock);
 	spin_lock(&zbpg_unused_list_spinlock);
@@ -293,9 +438,7 @@ static unsigned zbud_free(struct zbud_hdr *zh)
 
 static void zbud_free_and_delist(struct zbud_hdr *zh)
 {
-	unsigned chunks;
-	struct zbud_hdr *zh_other;
-	unsigned budnum = zbud_budnum(zh), size;
+	unsigned budnum = zbud_budnum(zh);
 	struct zbud_page *zbpg =
 		container_of(zh, struct zbud_page, buddy[budnum]);
 
@@ -305,24 +448,15 @@ static void zbud_free_and_delist(struct zbud_hdr *zh)
 		spin_unlock(&zbpg->lock);
 		return;
 	}
-	size = zbud_free(zh);
+	zbud_free(zh);
 	ASSERT_SPINLOCK(&zbpg->lock);
-	zh_other = &zbpg->buddy[(budnum == 0) ? 1 : 0];
-	if (zh_other->size == 0) { /* was unbuddied: unlist and free */
-		chunks = zbud_size_to_chunks(size) ;
-		spin_lock(&zbud_budlists_spinlock);
-		BUG_ON(list_empty(&zbud_unbuddied[chunks].list));
-		list_del_init(&zbpg->bud_list);
-		zbud_unbuddied[chunks].count--;
+	spin_lock(&zbud_budlists_spinlock);
+	zbud_list_del(zbpg);
+	if (zbud_page_empty(zbpg)) { /* was the last zbud: free the page */
 		spin_unlock(&zbud_budlists_spinlock);
 		zbud_free_raw_page(zbpg);
-	} else { /* was buddied: move remaining buddy to unbuddied list */
-		chunks = zbud_size_to_chunks(zh_other->size) ;
-		spin_lock(&zbud_budlists_spinlock);
-		list_del_init(&zbpg->bud_list);
-		zcache_zbud_buddied_count--;
-		list_add_tail(&zbpg->bud_list, &zbud_unbuddied[chunks].list);
-		zbud_unbuddied[chunks].count++;
+	} else { /* relist by the space the remaining zbuds leave */
+		zbud_list_add(zbpg);
 		spin_unlock(&zbud_budlists_spinlock);
 		spin_unlock(&zbpg->lock);
 	}
@@ -333,23 +467,23 @@ static struct zbud_hdr *zbud_create(uint16_t client_id, uint16_t pool_id,
 					uint32_t index, struct page *page,
 					void *cdata, unsigned size)
 {
-	struct zbud_hdr *zh0, *zh1, *zh = NULL;
-	struct zbud_page *zbpg = NULL, *ztmp;
+	struct zbud_hdr *zh = NULL;
+	struct zbud_page *zbpg = NULL;
 	unsigned nchunks;
 	char *to;
-	int i, found_good_buddy = 0;
+	int i;
 
 	nchunks = zbud_size_to_chunks(size) ;
 	for (i = MAX_CHUNK - nchunks + 1; i > 0; i--) {
 		spin_lock(&zbud_budlists_spinlock);
-		if (!list_empty(&zbud_unbuddied[i].list)) {
-			list_for_each_entry_safe(zbpg, ztmp,
-				    &zbud_unbuddied[i].list, bud_list) {
-				if (spin_trylock(&zbpg->lock)) {
-					found_good_buddy = i;
-					goto found_unbuddied;
-				}
-			}
+		list_for_each_entry(zbpg, &zbud_unbuddied[i].list, bud_list) {
+			if (!spin_trylock(&zbpg->lock))
+				continue;
+			zh = zbud_pick_buddy(zbpg, nchunks);
+			if (zh != NULL)
+				goto found_unbuddied;
+			/* zbud_max_buds was lowered since it was listed */
+			spin_unlock(&zbpg->lock);
 		}
 		spin_unlock(&zbud_budlists_spinlock);
 	}
@@ -360,27 +494,15 @@ static struct zbud_hdr *zbud_create(uint16_t client_id, uint16_t pool_id,
 	/* ok, have a page, now compress the data before taking locks */
 	spin_lock(&zbpg->lock);
 	spin_lock(&zbud_budlists_spinlock);
-	list_add_tail(&zbpg->bud_list, &zbud_unbuddied[nchunks].list);
-	zbud_unbuddied[nchunks].count++;
-	zh = &zbpg->buddy[0];
+	zh = &zbpg->buddy[ZBUD_FIRST];
 	goto init_zh;
 
 found_unbuddied:
 	ASSERT_SPINLOCK(&zbpg->lock);
-	zh0 = &zbpg->buddy[0]; zh1 = &zbpg->buddy[1];
-	BUG_ON(!((zh0->size == 0) ^ (zh1->size == 0)));
-	if (zh0->size != 0) { /* buddy0 in use, buddy1 is vacant */
-		ASSERT_SENTINEL(zh0, ZBH);
-		zh = zh1;
-	} else if (zh1->size != 0) { /* buddy1 in use, buddy0 is vacant */
-		ASSERT_SENTINEL(zh1, ZBH);
-		zh = zh0;
-	} else
-		BUG();
-	list_del_init(&zbpg->bud_list);
-	zbud_unbuddied[found_good_buddy].count--;
-	list_add_tail(&zbpg->bud_list, &zbud_buddied_list);
-	zcache_zbud_buddied_count++;
+	BUG_ON(zh->size != 0);
+	zbud_list_del(zbpg);
+	if (zh == &zbpg->buddy[ZBUD_MIDDLE])
+		zcache_zbud_middle_zpages++;
 
 init_zh:
 	SET_SENTINEL(zh, ZBH);
@@ -389,6 +511,7 @@ init_zh:
 	zh->oid = *oid;
 	zh->pool_id = pool_id;
 	zh->client_id = client_id;
+	zbud_list_add(zbpg);
 	/* can wait to copy the data until the list locks are dropped */
 	spin_unlock(&zbud_budlists_spinlock);
 
@@ -476,7 +599,12 @@ static void zbud_evict_zbpg(struct zbud_page *zbpg)
 	for (i = 0; i < j; i++) {
 		pool = zcache_get_pool_by_id(client_id[i], pool_id[i]);
 		if (pool != NULL) {
+			struct zcache_pool_stats *st = zcache_pool_stats(pool);
+			ktime_t start = ktime_get();
+
 			tmem_flush_page(pool, &oid[i], index[i]);
+			st->evictions++;
+			st->evict_ns += zcache_ns_since(start);
 			zcache_put_pool(pool);
 		}
 	}
@@ -528,8 +656,7 @@ retry_unbud_list_i:
 		list_for_each_entry(zbpg, &zbud_unbuddied[i].list, bud_list) {
 			if (unlikely(!spin_trylock(&zbpg->lock)))
 				continue;
-			list_del_init(&zbpg->bud_list);
-			zbud_unbuddied[i].count--;
+			zbud_list_del(zbpg);
 			spin_unlock(&zbud_budlists_spinlock);
 			zcache_evicted_unbuddied_pages++;
 			/* want budlists unlocked when doing zbpg eviction */
@@ -552,8 +679,7 @@ retry_bud_list:
 	list_for_each_entry(zbpg, &zbud_buddied_list, bud_list) {
 		if (unlikely(!spin_trylock(&zbpg->lock)))
 			continue;
-		list_del_init(&zbpg->bud_list);
-		zcache_zbud_buddied_count--;
+		zbud_list_del(zbpg);
 		spin_unlock(&zbud_budlists_spinlock);
 		zcache_evicted_buddied_pages++;
 		/* want budlists unlocked when doing zbpg eviction */
@@ -860,6 +986,40 @@ static ssize_t zv_page_count_policy_percent_store(struct kobject *kobj,
 	return count;
 }
 
+/*
+ * zbud_max_buds is 3 to pack up to three zbuds per page, or 2 for the
+ * original pairs.  Lowering it does not split pages already holding
+ * three zbuds; they simply are not offered a third one again.
+ */
+static ssize_t zbud_max_buds_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", zbud_max_buds);
+}
+
+static ssize_t zbud_max_buds_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	unsigned long val;
+	int err;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	err = strict_strtoul(buf, 10, &val);
+	if (err || val < 2 || val > ZBUD_MAX_BUDS)
+		return -EINVAL;
+	zbud_max_buds = val;
+	return count;
+}
+
+static struct kobj_attribute zcache_zbud_max_buds_attr = {
+		.attr = { .name = "zbud_max_buds", .mode = 0644 },
+		.show = zbud_max_buds_show,
+		.store = zbud_max_buds_store,
+};
+
 static struct kobj_attribute zcache_zv_max_zsize_attr = {
 		.attr = { .name = "zv_max_zsize", .mode = 0644 },
 		.show = zv_max_zsize_show,
@@ -1439,6 +1599,54 @@ ZCACHE_SYSFS_RO_CUSTOM(zv_curr_dist_counts,
 			zv_curr_dist_counts_show);
 ZCACHE_SYSFS_RO_CUSTOM(zv_cumul_dist_counts,
 			zv_cumul_dist_counts_show);
+ZCACHE_SYSFS_RO(zbud_middle_zpages);
+
+static inline unsigned long zcache_avg_ns(u64 total, unsigned long count)
+{
+	return count ? (unsigned long)div64_u64(total, count) : 0;
+}
+
+/*
+ * One line per pool: the counters, then the mean time in ns of a put,
+ * a hit, a miss and an eviction.
+ */
+static int zcache_show_pool_stats(char *buf)
+{
+	struct zcache_client *cli;
+	struct zcache_pool_stats *st;
+	char *p = buf;
+	int c, i;
+
+	p += sprintf(p, "client pool type puts failed_puts hits misses "
+		     "flushes evictions put_ns hit_ns miss_ns evict_ns\n");
+	for (c = -1; c < MAX_CLIENTS; c++) {
+		cli = c < 0 ? &zcache_host : &zcache_clients[c];
+		if (!cli->allocated)
+			continue;
+		for (i = 0; i < MAX_POOLS_PER_CLIENT; i++) {
+			struct tmem_pool *pool = cli->tmem_pools[i];
+
+			if (pool == NULL)
+				continue;
+			if (p - buf > PAGE_SIZE - 160)
+				goto out;
+			st = &cli->pool_stats[i];
+			p += sprintf(p, "%d %d %s %lu %lu %lu %lu %lu %lu "
+				     "%lu %lu %lu %lu\n", c, i,
+				     is_ephemeral(pool) ? "eph" : "pers",
+				     st->puts, st->failed_puts, st->hits,
+				     st->misses, st->flushes, st->evictions,
+				     zcache_avg_ns(st->put_ns, st->puts),
+				     zcache_avg_ns(st->hit_ns, st->hits),
+				     zcache_avg_ns(st->miss_ns, st->misses),
+				     zcache_avg_ns(st->evict_ns,
+						   st->evictions));
+		}
+	}
+out:
+	return p - buf;
+}
+ZCACHE_SYSFS_RO_CUSTOM(pool_stats, zcache_show_pool_stats);
 
 static struct attribute *zcache_attrs[] = {
 	&zcache_curr_obj_count_attr.attr,
@@ -1475,6 +1683,9 @@ static struct attribute *zcache_attrs[] = {
 	&zcache_zv_max_zsize_attr.attr,
 	&zcache_zv_max_mean_zsize_attr.attr,
 	&zcache_zv_page_count_policy_percent_attr.attr,
+	&zcache_zbud_max_buds_attr.attr,
+	&zcache_zbud_middle_zpages_attr.attr,
+	&zcache_pool_stats_attr.attr,
 	NULL,
 };
 
@@ -1538,10 +1749,16 @@ static int zcache_put_page(int cli_id, int pool_id, struct tmem_oid *oidp,
 	if (unlikely(pool == NULL))
 		goto out;
 	if (!zcache_freeze && zcache_do_preload(pool) == 0) {
+		struct zcache_pool_stats *st = zcache_pool_stats(pool);
+		ktime_t start = ktime_get();
+
 		/* preload does preempt_disable on success */
 		ret = tmem_put(pool, oidp, index, (char *)(page),
 				PAGE_SIZE, 0, is_ephemeral(pool));
+		st->puts++;
+		st->put_ns += zcache_ns_since(start);
 		if (ret < 0) {
+			st->failed_puts++;
 			if (is_ephemeral(pool))
 				zcache_failed_eph_puts++;
 			else
@@ -1571,9 +1788,19 @@ static int zcache_get_page(int cli_id, int pool_id, struct tmem_oid *oidp,
 	local_irq_save(flags);
 	pool = zcache_get_pool_by_id(cli_id, pool_id);
 	if (likely(pool != NULL)) {
+		struct zcache_pool_stats *st = zcache_pool_stats(pool);
+		ktime_t start = ktime_get();
+
 		if (atomic_read(&pool->obj_count) > 0)
 			ret = tmem_get(pool, oidp, index, (char *)(page),
 					&size, 0, is_ephemeral(pool));
+		if (ret >= 0) {
+			st->hits++;
+			st->hit_ns += zcache_ns_since(start);
+		} else {
+			st->misses++;
+			st->miss_ns += zcache_ns_since(start);
+		}
 		zcache_put_pool(pool);
 	}
 	local_irq_restore(flags);
@@ -1593,6 +1820,8 @@ static int zcache_flush_page(int cli_id, int pool_id,
 	if (likely(pool != NULL)) {
 		if (atomic_read(&pool->obj_count) > 0)
 			ret = tmem_flush_page(pool, oidp, index);
+		if (ret >= 0)
+			zcache_pool_stats(pool)->flushes++;
 		zcache_put_pool(pool);
 	}
 	if (ret >= 0)
@@ -1686,6 +1915,7 @@ static int zcache_new_pool(uint16_t cli_id, uint32_t flags)
 	atomic_set(&pool->refcount, 0);
 	pool->client = cli;
 	pool->pool_id = poolid;
+	memset(&cli->pool_stats[poolid], 0, sizeof(cli->pool_stats[poolid]));
 	tmem_new_pool(pool, flags);
 	cli->tmem_pools[poolid] = pool;
 	pr_info("zcache: created %s tmem pool, id=%d, client=%d\n",
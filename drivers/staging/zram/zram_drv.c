@@ -25,13 +25,18 @@
 #include <linux/bitops.h>
 #include <linux/blkdev.h>
 #include <linux/buffer_head.h>
+#include <linux/completion.h>
 #include <linux/device.h>
 #include <linux/genhd.h>
+#include <linux/hash.h>
 #include <linux/highmem.h>
+#include <linux/jhash.h>
 #include <linux/slab.h>
-#include <linux/lzo.h>
+#include <linux/ktime.h>
+#include <linux/percpu.h>
 #include <linux/string.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 #include "zram_drv.h"
 
@@ -42,6 +47,16 @@ struct zram *devices;
 /* Module params (documentation at end) */
 unsigned int num_devices;
 
+const char * const zram_backend_names[ZRAM_NR_BACKENDS] = {
+	[ZRAM_BACKEND_LZO]	= "lzo",
+	[ZRAM_BACKEND_LZ4]	= "lz4",
+};
+
+const char * const zram_allocator_names[ZRAM_NR_ALLOCATORS] = {
+	[ZRAM_ALLOC_XVMALLOC]	= "xvmalloc",
+	[ZRAM_ALLOC_ZSMALLOC]	= "zsmalloc",
+};
+
 static void zram_stat_inc(u32 *v)
 {
 	*v = *v + 1;
@@ -89,21 +104,470 @@ static void zram_clear_flag(struct zram *zram, u32 index,
 	zram->table[index].flags &= ~BIT(flag);
 }
 
-static int page_zero_filled(void *ptr)
+/* Same filled and written back pages may have a zero page/element */
+static int zram_allocated(struct zram *zram, u32 index)
+{
+	return zram->table[index].page ||
+	       zram_test_flag(zram, index, ZRAM_SAME) ||
+	       zram_test_flag(zram, index, ZRAM_WB);
+}
+
+static int page_same_filled(void *ptr, unsigned long *element)
 {
-	unsigned int pos;
+	unsigned int pos, last;
 	unsigned long *page;
+	unsigned long val;
 
 	page = (unsigned long *)ptr;
+	val = page[0];
+	last = PAGE_SIZE / sizeof(*page) - 1;
 
-	for (pos = 0; pos != PAGE_SIZE / sizeof(*page); pos++) {
-		if (page[pos])
+	/* Mismatches tend to show up at the end of the page first */
+	if (val != page[last])
+		return 0;
+
+	for (pos = 1; pos < last; pos++) {
+		if (page[pos] != val)
 			return 0;
 	}
 
+	*element = val;
+
 	return 1;
 }
 
+static void zram_fill_page(void *ptr, unsigned long len,
+			   unsigned long element)
+{
+	unsigned long *page = ptr;
+	unsigned long pos;
+
+	if (likely(!element)) {
+		memset(ptr, 0, len);
+		return;
+	}
+
+	for (pos = 0; pos < len / sizeof(*page); pos++)
+		page[pos] = element;
+}
+
+static struct zram_stream *zram_stream_get(struct zram *zram)
+{
+	struct zram_stream *zstrm;
+
+	zstrm = per_cpu_ptr(zram->streams, raw_smp_processor_id());
+	mutex_lock(&zstrm->lock);
+
+	return zstrm;
+}
+
+static void zram_stream_put(struct zram_stream *zstrm)
+{
+	mutex_unlock(&zstrm->lock);
+}
+
+static void zram_free_streams(struct zram *zram)
+{
+	unsigned int cpu;
+
+	if (!zram->streams)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct zram_stream *zstrm = per_cpu_ptr(zram->streams, cpu);
+
+		if (!IS_ERR_OR_NULL(zstrm->tfm))
+			crypto_free_comp(zstrm->tfm);
+		if (!IS_ERR_OR_NULL(zstrm->dtfm))
+			crypto_free_comp(zstrm->dtfm);
+		free_pages((unsigned long)zstrm->buffer, 1);
+	}
+
+	free_percpu(zram->streams);
+	zram->streams = NULL;
+}
+
+static int zram_alloc_streams(struct zram *zram)
+{
+	const char *name = zram_backend_names[zram->backend];
+	unsigned int cpu;
+
+	zram->streams = alloc_percpu(struct zram_stream);
+	if (!zram->streams)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct zram_stream *zstrm = per_cpu_ptr(zram->streams, cpu);
+
+		mutex_init(&zstrm->lock);
+
+		zstrm->tfm = crypto_alloc_comp(name, 0, 0);
+		zstrm->dtfm = crypto_alloc_comp(name, 0, 0);
+		if (IS_ERR(zstrm->tfm) || IS_ERR(zstrm->dtfm)) {
+			pr_err("Error allocating %s compressor!\n", name);
+			goto fail;
+		}
+
+		/* Compressed output may exceed PAGE_SIZE, so use 2 pages */
+		zstrm->buffer = (void *)__get_free_pages(__GFP_ZERO, 1);
+		if (!zstrm->buffer) {
+			pr_err("Error allocating compressor buffer space\n");
+			goto fail;
+		}
+	}
+
+	return 0;
+
+fail:
+	zram_free_streams(zram);
+	return -ENOMEM;
+}
+
+/*
+ * Tell reclaim what swapping a page out to us and back in costs, so it
+ * can weigh that against dropping page cache.  Called with stat64_lock.
+ */
+static void zram_update_cost(struct zram *zram, u32 *avg, u64 ns)
+{
+	s32 delta = (s32)min_t(u64, ns, S32_MAX) - (s32)*avg;
+
+	*avg += delta / 8;
+	zram->queue->backing_dev_info.io_cost_us =
+		(zram->compress_avg_ns + zram->decompress_avg_ns) /
+		NSEC_PER_USEC;
+}
+
+static int zram_compress(struct zram *zram, struct zram_stream *zstrm,
+			 const unsigned char *src, size_t *clen)
+{
+	struct zram_backend_stats *bs = &zram->backend_stats[zram->backend];
+	unsigned int dlen = 2 * PAGE_SIZE;
+	ktime_t start = ktime_get();
+	u64 ns;
+	int ret;
+
+	ret = crypto_comp_compress(zstrm->tfm, src, PAGE_SIZE,
+				   zstrm->buffer, &dlen);
+	*clen = dlen;
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	spin_lock(&zram->stat64_lock);
+	bs->compress++;
+	bs->compress_ns += ns;
+	zram_update_cost(zram, &zram->compress_avg_ns, ns);
+	if (!ret) {
+		bs->orig_size += PAGE_SIZE;
+		bs->compr_size += dlen;
+	}
+	spin_unlock(&zram->stat64_lock);
+
+	return ret;
+}
+
+/* Called with the source object kmapped atomically */
+static int zram_decompress(struct zram *zram, const unsigned char *cmem,
+			   size_t clen, unsigned char *mem)
+{
+	struct zram_backend_stats *bs = &zram->backend_stats[zram->backend];
+	struct zram_stream *zstrm;
+	unsigned int dlen = PAGE_SIZE;
+	ktime_t start = ktime_get();
+	u64 ns;
+	int ret;
+
+	zstrm = get_cpu_ptr(zram->streams);
+	ret = crypto_comp_decompress(zstrm->dtfm, cmem, clen, mem, &dlen);
+	put_cpu_ptr(zram->streams);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (!ret && dlen != PAGE_SIZE)
+		ret = -EINVAL;
+
+	spin_lock(&zram->stat64_lock);
+	bs->decompress++;
+	bs->decompress_ns += ns;
+	zram_update_cost(zram, &zram->decompress_avg_ns, ns);
+	spin_unlock(&zram->stat64_lock);
+
+	return ret;
+}
+
+static struct hlist_head *zram_dedup_bucket(struct zram *zram, u32 checksum)
+{
+	return &zram->dedup_table[hash_32(checksum, zram->dedup_bits)];
+}
+
+/*
+ * Looks for a stored object with the same compressed bytes as @src and
+ * takes a reference on it. Called with zram->lock held for write, so
+ * the mapped objects cannot be moved by compaction.
+ */
+static struct zram_dedup_entry *zram_dedup_get(struct zram *zram,
+		const unsigned char *src, size_t clen, u32 checksum)
+{
+	struct zram_dedup_entry *dedup;
+	struct hlist_node *pos;
+
+	spin_lock(&zram->dedup_lock);
+	hlist_for_each_entry(dedup, pos, zram_dedup_bucket(zram, checksum),
+			     node) {
+		unsigned char *cmem;
+		int match;
+
+		if (dedup->checksum != checksum || dedup->size != clen ||
+		    dedup->refcount == USHRT_MAX)
+			continue;
+
+		cmem = zs_map_object(zram->zs_pool, dedup->handle, ZS_MM_RO);
+		match = !memcmp(cmem, src, clen);
+		zs_unmap_object(zram->zs_pool, dedup->handle);
+
+		if (match) {
+			dedup->refcount++;
+			spin_unlock(&zram->dedup_lock);
+			return dedup;
+		}
+	}
+	spin_unlock(&zram->dedup_lock);
+
+	return NULL;
+}
+
+static void zram_dedup_insert(struct zram *zram,
+			      struct zram_dedup_entry *dedup)
+{
+	spin_lock(&zram->dedup_lock);
+	hlist_add_head(&dedup->node, zram_dedup_bucket(zram, dedup->checksum));
+	spin_unlock(&zram->dedup_lock);
+}
+
+/* Drops a reference; returns true if the shared object was freed */
+static bool zram_dedup_put(struct zram *zram, struct zram_dedup_entry *dedup)
+{
+	spin_lock(&zram->dedup_lock);
+	if (--dedup->refcount) {
+		spin_unlock(&zram->dedup_lock);
+		return false;
+	}
+	hlist_del(&dedup->node);
+	spin_unlock(&zram->dedup_lock);
+
+	zs_free(zram->zs_pool, dedup->handle);
+	kfree(dedup);
+
+	return true;
+}
+
+static unsigned long zram_obj_handle(struct zram *zram, u32 index)
+{
+	struct zram_dedup_entry *dedup;
+
+	if (!zram_test_flag(zram, index, ZRAM_DEDUP))
+		return zram->table[index].handle;
+
+	dedup = (struct zram_dedup_entry *)zram->table[index].handle;
+	return dedup->handle;
+}
+
+static int zram_obj_alloc(struct zram *zram, u32 index, size_t clen)
+{
+	u32 offset;
+
+	if (zram->allocator == ZRAM_ALLOC_ZSMALLOC) {
+		unsigned long handle = zs_malloc(zram->zs_pool, clen);
+
+		if (!handle)
+			return -ENOMEM;
+		zram->table[index].handle = handle;
+		zram->table[index].size = clen;
+		return 0;
+	}
+
+	if (xv_malloc(zram->mem_pool, clen + sizeof(struct zobj_header),
+		      &zram->table[index].page, &offset,
+		      GFP_NOIO | __GFP_HIGHMEM))
+		return -ENOMEM;
+	zram->table[index].offset = offset;
+
+	return 0;
+}
+
+/* Returns false if the object is still shared with other entries */
+static bool zram_obj_free(struct zram *zram, u32 index)
+{
+	if (zram_test_flag(zram, index, ZRAM_DEDUP)) {
+		zram_clear_flag(zram, index, ZRAM_DEDUP);
+		return zram_dedup_put(zram, (struct zram_dedup_entry *)
+				      zram->table[index].handle);
+	}
+
+	if (zram->allocator == ZRAM_ALLOC_ZSMALLOC)
+		zs_free(zram->zs_pool, zram->table[index].handle);
+	else
+		xv_free(zram->mem_pool, zram->table[index].page,
+			zram->table[index].offset);
+
+	return true;
+}
+
+/*
+ * Maps the payload of a compressed object. Atomic until the matching
+ * zram_obj_unmap(); zsmalloc additionally requires zram->lock so that
+ * compaction cannot move the object meanwhile.
+ */
+static unsigned char *zram_obj_map(struct zram *zram, u32 index,
+				   enum zs_mapmode mm)
+{
+	if (zram->allocator == ZRAM_ALLOC_ZSMALLOC)
+		return zs_map_object(zram->zs_pool,
+				     zram_obj_handle(zram, index), mm);
+
+	return kmap_atomic(zram->table[index].page, KM_USER1) +
+		zram->table[index].offset + sizeof(struct zobj_header);
+}
+
+static void zram_obj_unmap(struct zram *zram, u32 index, unsigned char *cmem)
+{
+	if (zram->allocator == ZRAM_ALLOC_ZSMALLOC)
+		zs_unmap_object(zram->zs_pool, zram_obj_handle(zram, index));
+	else
+		kunmap_atomic(cmem, KM_USER1);
+}
+
+/* Compressed size of a mapped object */
+static size_t zram_obj_size(struct zram *zram, u32 index, unsigned char *cmem)
+{
+	if (zram->allocator == ZRAM_ALLOC_ZSMALLOC)
+		return zram->table[index].size;
+
+	return xv_get_object_size(cmem - sizeof(struct zobj_header)) -
+		sizeof(struct zobj_header);
+}
+
+#ifdef CONFIG_ZRAM_WRITEBACK
+static void zram_bdev_end_io(struct bio *bio, int err)
+{
+	complete(bio->bi_private);
+}
+
+/* Synchronous single page I/O to the backing device */
+static int zram_bdev_rw(struct zram *zram, int rw, unsigned long blk,
+			struct page *page)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct bio *bio;
+	int ret;
+
+	bio = bio_alloc(GFP_NOIO, 1);
+	if (!bio)
+		return -ENOMEM;
+
+	bio->bi_sector = blk << SECTORS_PER_PAGE_SHIFT;
+	bio->bi_bdev = zram->backing_dev;
+	if (!bio_add_page(bio, page, PAGE_SIZE, 0)) {
+		bio_put(bio);
+		return -EIO;
+	}
+	bio->bi_end_io = zram_bdev_end_io;
+	bio->bi_private = &done;
+
+	submit_bio(rw, bio);
+	wait_for_completion(&done);
+
+	ret = test_bit(BIO_UPTODATE, &bio->bi_flags) ? 0 : -EIO;
+	bio_put(bio);
+
+	zram_stat64_inc(zram, rw & WRITE ? &zram->stats.bd_writes :
+			&zram->stats.bd_reads);
+
+	return ret;
+}
+
+static struct workqueue_struct *zram_bdev_wq;
+
+struct zram_bdev_work {
+	struct work_struct work;
+	struct zram *zram;
+	unsigned long blk;
+	struct page *page;
+	int ret;
+};
+
+static void zram_bdev_read_fn(struct work_struct *work)
+{
+	struct zram_bdev_work *zw = container_of(work, struct zram_bdev_work,
+						 work);
+
+	zw->ret = zram_bdev_rw(zw->zram, READ_SYNC, zw->blk, zw->page);
+}
+
+/*
+ * Bios submitted from our own make_request function are only issued
+ * once it returns, so waiting for one there would hang. Have a worker
+ * do the read instead. Swap-ins reach here from reclaim, so the worker
+ * comes from zram_bdev_wq, whose rescuer keeps it going when no new
+ * worker can be created.
+ */
+static int zram_bdev_read_sync(struct zram *zram, unsigned long blk,
+			       struct page *page)
+{
+	struct zram_bdev_work zw;
+
+	zw.zram = zram;
+	zw.blk = blk;
+	zw.page = page;
+
+	INIT_WORK_ONSTACK(&zw.work, zram_bdev_read_fn);
+	queue_work(zram_bdev_wq, &zw.work);
+	flush_work(&zw.work);
+	destroy_work_on_stack(&zw.work);
+
+	return zw.ret;
+}
+
+static unsigned long zram_bdev_alloc_block(struct zram *zram)
+{
+	unsigned long blk;
+
+	do {
+		blk = find_first_zero_bit(zram->bitmap, zram->nr_pages);
+		if (blk >= zram->nr_pages)
+			return ULONG_MAX;
+	} while (test_and_set_bit(blk, zram->bitmap));
+
+	return blk;
+}
+
+static void zram_wb_free(struct zram *zram, u32 index)
+{
+	clear_bit(zram->table[index].element, zram->bitmap);
+	zram_clear_flag(zram, index, ZRAM_WB);
+	zram->table[index].element = 0;
+	zram_stat_dec(&zram->stats.pages_wb);
+}
+
+static void zram_reset_backing_dev(struct zram *zram)
+{
+	if (!zram->backing_dev)
+		return;
+
+	blkdev_put(zram->backing_dev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+	zram->backing_dev = NULL;
+	vfree(zram->bitmap);
+	zram->bitmap = NULL;
+	zram->nr_pages = 0;
+}
+#else
+static inline int zram_bdev_read_sync(struct zram *zram, unsigned long blk,
+				      struct page *page)
+{
+	return -EIO;
+}
+
+static inline void zram_wb_free(struct zram *zram, u32 index) {}
+static inline void zram_reset_backing_dev(struct zram *zram) {}
+#endif
+
 static void zram_set_disksize(struct zram *zram, size_t totalram_bytes)
 {
 	if (!zram->disksize) {
@@ -141,18 +605,31 @@ static void zram_free_page(struct zram *zram, size_t index)
 	struct page *page = zram->table[index].page;
 	u32 offset = zram->table[index].offset;
 
-	if (unlikely(!page)) {
-		/*
-		 * No memory is allocated for zero filled pages.
-		 * Simply clear zero page flag.
-		 */
-		if (zram_test_flag(zram, index, ZRAM_ZERO)) {
-			zram_clear_flag(zram, index, ZRAM_ZERO);
+	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+
+	if (zram_test_flag(zram, index, ZRAM_WB)) {
+		zram_wb_free(zram, index);
+		return;
+	}
+
+	/*
+	 * No memory is allocated for same filled pages.
+	 * Simply clear the flag and the pattern.
+	 */
+	if (zram_test_flag(zram, index, ZRAM_SAME)) {
+		zram_clear_flag(zram, index, ZRAM_SAME);
+		if (zram->table[index].element)
+			zram_stat_dec(&zram->stats.pages_same);
+		else
 			zram_stat_dec(&zram->stats.pages_zero);
-		}
+		zram->table[index].element = 0;
 		return;
 	}
 
+	if (unlikely(!page))
+		return;
+
 	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))) {
 		clen = PAGE_SIZE;
 		__free_page(page);
@@ -161,14 +638,23 @@ static void zram_free_page(struct zram *zram, size_t index)
 		goto out;
 	}
 
-	obj = kmap_atomic(page, KM_USER0) + offset;
-	clen = xv_get_object_size(obj) - sizeof(struct zobj_header);
-	kunmap_atomic(obj, KM_USER0);
+	if (zram->allocator == ZRAM_ALLOC_ZSMALLOC) {
+		clen = zram->table[index].size;
+	} else {
+		obj = kmap_atomic(page, KM_USER0) + offset;
+		clen = xv_get_object_size(obj) - sizeof(struct zobj_header);
+		kunmap_atomic(obj, KM_USER0);
+	}
 
-	xv_free(zram->mem_pool, page, offset);
 	if (clen <= PAGE_SIZE / 2)
 		zram_stat_dec(&zram->stats.good_compress);
 
+	/* The data stays accounted while other entries still use it */
+	if (!zram_obj_free(zram, index)) {
+		zram_stat_dec(&zram->stats.pages_dedup);
+		clen = 0;
+	}
+
 out:
 	zram_stat64_sub(zram, &zram->stats.compr_size, clen);
 	zram_stat_dec(&zram->stats.pages_stored);
@@ -177,13 +663,14 @@ out:
 	zram->table[index].offset = 0;
 }
 
-static void handle_zero_page(struct bio_vec *bvec)
+/* Partial I/O is sector aligned, so the pattern stays word aligned */
+static void handle_same_page(struct bio_vec *bvec, unsigned long element)
 {
 	struct page *page = bvec->bv_page;
 	void *user_mem;
 
 	user_mem = kmap_atomic(page, KM_USER0);
-	memset(user_mem + bvec->bv_offset, 0, bvec->bv_len);
+	zram_fill_page(user_mem + bvec->bv_offset, bvec->bv_len, element);
 	kunmap_atomic(user_mem, KM_USER0);
 
 	flush_dcache_page(page);
@@ -210,27 +697,75 @@ static inline int is_partial_io(struct bio_vec *bvec)
 	return bvec->bv_len != PAGE_SIZE;
 }
 
+static int handle_wb_page(struct zram *zram, struct bio_vec *bvec,
+			  u32 index, int offset)
+{
+	struct page *page = bvec->bv_page;
+	unsigned char *user_mem, *mem;
+	int ret;
+
+	if (!is_partial_io(bvec)) {
+		ret = zram_bdev_read_sync(zram, zram->table[index].element,
+					  page);
+		if (!ret)
+			flush_dcache_page(page);
+		return ret;
+	}
+
+	page = alloc_page(GFP_NOIO);
+	if (!page)
+		return -ENOMEM;
+
+	ret = zram_bdev_read_sync(zram, zram->table[index].element, page);
+	if (!ret) {
+		user_mem = kmap_atomic(bvec->bv_page, KM_USER0);
+		mem = kmap_atomic(page, KM_USER1);
+		memcpy(user_mem + bvec->bv_offset, mem + offset, bvec->bv_len);
+		kunmap_atomic(mem, KM_USER1);
+		kunmap_atomic(user_mem, KM_USER0);
+		flush_dcache_page(bvec->bv_page);
+	}
+	__free_page(page);
+
+	return ret;
+}
+
 static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 			  u32 index, int offset, struct bio *bio)
 {
 	int ret;
-	size_t clen;
 	struct page *page;
-	struct zobj_header *zheader;
 	unsigned char *user_mem, *cmem, *uncmem = NULL;
 
 	page = bvec->bv_page;
 
-	if (zram_test_flag(zram, index, ZRAM_ZERO)) {
-		handle_zero_page(bvec);
+	/*
+	 * Readers only ever clear this bit, so racing with each other
+	 * under the read lock is harmless.
+	 */
+	if (zram_test_flag(zram, index, ZRAM_IDLE))
+		zram_clear_flag(zram, index, ZRAM_IDLE);
+
+	if (zram_test_flag(zram, index, ZRAM_SAME)) {
+		handle_same_page(bvec, zram->table[index].element);
 		return 0;
 	}
 
+	if (zram_test_flag(zram, index, ZRAM_WB)) {
+		ret = handle_wb_page(zram, bvec, index, offset);
+		if (unlikely(ret)) {
+			pr_err("Backing device read failed! err=%d, page=%u\n",
+			       ret, index);
+			zram_stat64_inc(zram, &zram->stats.failed_reads);
+		}
+		return ret;
+	}
+
 	/* Requested page is not present in compressed area */
 	if (unlikely(!zram->table[index].page)) {
 		pr_debug("Read before write: sector=%lu, size=%u",
 			 (ulong)(bio->bi_sector), bio->bi_size);
-		handle_zero_page(bvec);
+		handle_same_page(bvec, 0);
 		return 0;
 	}
 
@@ -252,14 +787,11 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	user_mem = kmap_atomic(page, KM_USER0);
 	if (!is_partial_io(bvec))
 		uncmem = user_mem;
-	clen = PAGE_SIZE;
 
-	cmem = kmap_atomic(zram->table[index].page, KM_USER1) +
-		zram->table[index].offset;
+	cmem = zram_obj_map(zram, index, ZS_MM_RO);
 
-	ret = lzo1x_decompress_safe(cmem + sizeof(*zheader),
-				    xv_get_object_size(cmem) - sizeof(*zheader),
-				    uncmem, &clen);
+	ret = zram_decompress(zram, cmem, zram_obj_size(zram, index, cmem),
+			      uncmem);
 
 	if (is_partial_io(bvec)) {
 		memcpy(user_mem + bvec->bv_offset, uncmem + offset,
@@ -267,11 +799,11 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 		kfree(uncmem);
 	}
 
-	kunmap_atomic(cmem, KM_USER1);
+	zram_obj_unmap(zram, index, cmem);
 	kunmap_atomic(user_mem, KM_USER0);
 
 	/* Should NEVER happen. Return bio error if it does. */
-	if (unlikely(ret != LZO_E_OK)) {
+	if (unlikely(ret)) {
 		pr_err("Decompression failed! err=%d, page=%u\n", ret, index);
 		zram_stat64_inc(zram, &zram->stats.failed_reads);
 		return ret;
@@ -285,33 +817,49 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 static int zram_read_before_write(struct zram *zram, char *mem, u32 index)
 {
 	int ret;
-	size_t clen = PAGE_SIZE;
-	struct zobj_header *zheader;
 	unsigned char *cmem;
 
-	if (zram_test_flag(zram, index, ZRAM_ZERO) ||
-	    !zram->table[index].page) {
-		memset(mem, 0, PAGE_SIZE);
+	if (zram_test_flag(zram, index, ZRAM_SAME)) {
+		zram_fill_page(mem, PAGE_SIZE, zram->table[index].element);
 		return 0;
 	}
 
-	cmem = kmap_atomic(zram->table[index].page, KM_USER0) +
-		zram->table[index].offset;
+	if (zram_test_flag(zram, index, ZRAM_WB)) {
+		struct page *page = alloc_page(GFP_NOIO);
+
+		if (!page)
+			return -ENOMEM;
+		ret = zram_bdev_read_sync(zram, zram->table[index].element,
+					  page);
+		if (!ret) {
+			cmem = kmap_atomic(page, KM_USER0);
+			memcpy(mem, cmem, PAGE_SIZE);
+			kunmap_atomic(cmem, KM_USER0);
+		}
+		__free_page(page);
+		return ret;
+	}
+
+	if (!zram->table[index].page) {
+		memset(mem, 0, PAGE_SIZE);
+		return 0;
+	}
 
 	/* Page is stored uncompressed since it's incompressible */
 	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))) {
+		cmem = kmap_atomic(zram->table[index].page, KM_USER0);
 		memcpy(mem, cmem, PAGE_SIZE);
 		kunmap_atomic(cmem, KM_USER0);
 		return 0;
 	}
 
-	ret = lzo1x_decompress_safe(cmem + sizeof(*zheader),
-				    xv_get_object_size(cmem) - sizeof(*zheader),
-				    mem, &clen);
-	kunmap_atomic(cmem, KM_USER0);
+	cmem = zram_obj_map(zram, index, ZS_MM_RO);
+	ret = zram_decompress(zram, cmem, zram_obj_size(zram, index, cmem),
+			      mem);
+	zram_obj_unmap(zram, index, cmem);
 
 	/* Should NEVER happen. Return bio error if it does. */
-	if (unlikely(ret != LZO_E_OK)) {
+	if (unlikely(ret)) {
 		pr_err("Decompression failed! err=%d, page=%u\n", ret, index);
 		zram_stat64_inc(zram, &zram->stats.failed_reads);
 		return ret;
@@ -324,14 +872,15 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 			   int offset)
 {
 	int ret;
-	u32 store_offset;
 	size_t clen;
-	struct zobj_header *zheader;
-	struct page *page, *page_store;
+	u32 checksum = 0;
+	unsigned long element;
+	struct page *page, *page_store = NULL;
+	struct zram_dedup_entry *dedup = NULL, *shared = NULL;
+	struct zram_stream *zstrm;
 	unsigned char *user_mem, *cmem, *src, *uncmem = NULL;
 
 	page = bvec->bv_page;
-	src = zram->compress_buffer;
 
 	if (is_partial_io(bvec)) {
 		/*
@@ -344,7 +893,9 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 			ret = -ENOMEM;
 			goto out;
 		}
+		down_read(&zram->lock);
 		ret = zram_read_before_write(zram, uncmem, index);
+		up_read(&zram->lock);
 		if (ret) {
 			kfree(uncmem);
 			goto out;
@@ -352,12 +903,11 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	}
 
 	/*
-	 * System overwrites unused sectors. Free memory associated
-	 * with this sector now.
+	 * Compression runs outside zram->lock on this CPU's stream, so
+	 * concurrent writers only serialize on the table update below.
 	 */
-	if (zram->table[index].page ||
-	    zram_test_flag(zram, index, ZRAM_ZERO))
-		zram_free_page(zram, index);
+	zstrm = zram_stream_get(zram);
+	src = zstrm->buffer;
 
 	user_mem = kmap_atomic(page, KM_USER0);
 
@@ -367,89 +917,133 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	else
 		uncmem = user_mem;
 
-	if (page_zero_filled(uncmem)) {
+	/* Only the repeated word is kept, no compression or allocation */
+	if (page_same_filled(uncmem, &element)) {
 		kunmap_atomic(user_mem, KM_USER0);
 		if (is_partial_io(bvec))
 			kfree(uncmem);
-		zram_stat_inc(&zram->stats.pages_zero);
-		zram_set_flag(zram, index, ZRAM_ZERO);
+		zram_stream_put(zstrm);
+
+		down_write(&zram->lock);
+		if (zram_allocated(zram, index))
+			zram_free_page(zram, index);
+		if (element)
+			zram_stat_inc(&zram->stats.pages_same);
+		else
+			zram_stat_inc(&zram->stats.pages_zero);
+		zram_set_flag(zram, index, ZRAM_SAME);
+		zram->table[index].element = element;
+		up_write(&zram->lock);
 		ret = 0;
 		goto out;
 	}
 
-	ret = lzo1x_1_compress(uncmem, PAGE_SIZE, src, &clen,
-			       zram->compress_workmem);
+	ret = zram_compress(zram, zstrm, uncmem, &clen);
+
+	/*
+	 * Page is incompressible. Store it as-is (uncompressed)
+	 * since we do not want to return too many disk write
+	 * errors which has side effect of hanging the system.
+	 */
+	if (!ret && unlikely(clen > zram->max_zpage_size)) {
+		clen = PAGE_SIZE;
+		memcpy(src, uncmem, PAGE_SIZE);
+	}
 
 	kunmap_atomic(user_mem, KM_USER0);
 	if (is_partial_io(bvec))
 			kfree(uncmem);
 
-	if (unlikely(ret != LZO_E_OK)) {
+	if (unlikely(ret)) {
 		pr_err("Compression failed! err=%d\n", ret);
-		goto out;
+		goto out_put;
 	}
 
-	/*
-	 * Page is incompressible. Store it as-is (uncompressed)
-	 * since we do not want to return too many disk write
-	 * errors which has side effect of hanging the system.
-	 */
-	if (unlikely(clen > max_zpage_size)) {
-		clen = PAGE_SIZE;
+	if (unlikely(clen == PAGE_SIZE)) {
 		page_store = alloc_page(GFP_NOIO | __GFP_HIGHMEM);
 		if (unlikely(!page_store)) {
 			pr_info("Error allocating memory for "
 				"incompressible page: %u\n", index);
 			ret = -ENOMEM;
-			goto out;
+			goto out_put;
 		}
+	} else if (zram->dedup_table) {
+		/* Without an entry the page is simply stored unshared */
+		checksum = jhash(src, clen, 0);
+		dedup = kmalloc(sizeof(*dedup), GFP_NOIO);
+	}
+
+	down_write(&zram->lock);
+
+	/*
+	 * System overwrites unused sectors. Free memory associated
+	 * with this sector now.
+	 */
+	if (zram_allocated(zram, index))
+		zram_free_page(zram, index);
 
-		store_offset = 0;
+	if (page_store) {
 		zram_set_flag(zram, index, ZRAM_UNCOMPRESSED);
 		zram_stat_inc(&zram->stats.pages_expand);
 		zram->table[index].page = page_store;
-		src = kmap_atomic(page, KM_USER0);
-		goto memstore;
+		zram->table[index].offset = 0;
+
+		cmem = kmap_atomic(page_store, KM_USER1);
+		memcpy(cmem, src, clen);
+		kunmap_atomic(cmem, KM_USER1);
+		goto update_stats;
+	}
+
+	if (dedup) {
+		shared = zram_dedup_get(zram, src, clen, checksum);
+		if (shared) {
+			kfree(dedup);
+			zram->table[index].handle = (unsigned long)shared;
+			zram->table[index].size = clen;
+			zram_set_flag(zram, index, ZRAM_DEDUP);
+			zram_stat_inc(&zram->stats.pages_dedup);
+			goto update_stats;
+		}
 	}
 
-	if (xv_malloc(zram->mem_pool, clen + sizeof(*zheader),
-		      &zram->table[index].page, &store_offset,
-		      GFP_NOIO | __GFP_HIGHMEM)) {
+	if (zram_obj_alloc(zram, index, clen)) {
+		up_write(&zram->lock);
+		kfree(dedup);
 		pr_info("Error allocating memory for compressed "
 			"page: %u, size=%zu\n", index, clen);
 		ret = -ENOMEM;
-		goto out;
+		goto out_put;
 	}
 
-memstore:
-	zram->table[index].offset = store_offset;
-
-	cmem = kmap_atomic(zram->table[index].page, KM_USER1) +
-		zram->table[index].offset;
-
-#if 0
-	/* Back-reference needed for memory defragmentation */
-	if (!zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)) {
-		zheader = (struct zobj_header *)cmem;
-		zheader->table_idx = index;
-		cmem += sizeof(*zheader);
-	}
-#endif
-
+	cmem = zram_obj_map(zram, index, ZS_MM_WO);
 	memcpy(cmem, src, clen);
+	zram_obj_unmap(zram, index, cmem);
+
+	if (dedup) {
+		dedup->handle = zram->table[index].handle;
+		dedup->checksum = checksum;
+		dedup->size = clen;
+		dedup->refcount = 1;
+		zram_dedup_insert(zram, dedup);
+		zram->table[index].handle = (unsigned long)dedup;
+		zram_set_flag(zram, index, ZRAM_DEDUP);
+	}
 
-	kunmap_atomic(cmem, KM_USER1);
-	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)))
-		kunmap_atomic(src, KM_USER0);
-
+update_stats:
 	/* Update stats */
-	zram_stat64_add(zram, &zram->stats.compr_size, clen);
+	if (!shared)
+		zram_stat64_add(zram, &zram->stats.compr_size, clen);
 	zram_stat_inc(&zram->stats.pages_stored);
 	if (clen <= PAGE_SIZE / 2)
 		zram_stat_inc(&zram->stats.good_compress);
 
+	up_write(&zram->lock);
+	zram_stream_put(zstrm);
+
 	return 0;
 
+out_put:
+	zram_stream_put(zstrm);
 out:
 	if (ret)
 		zram_stat64_inc(zram, &zram->stats.failed_writes);
@@ -466,9 +1060,7 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 		ret = zram_bvec_read(zram, bvec, index, offset, bio);
 		up_read(&zram->lock);
 	} else {
-		down_write(&zram->lock);
 		ret = zram_bvec_write(zram, bvec, index, offset);
-		up_write(&zram->lock);
 	}
 
 	return ret;
@@ -556,10 +1148,33 @@ static inline int valid_io_request(struct zram *zram, struct bio *bio)
 /*
  * Handler function for all zram I/O requests.
  */
+/* Free the slots queued by zram_slot_free_notify(), with zram->lock held */
+static void zram_free_pending_slots(struct zram *zram, bool free)
+{
+	struct zram_slot_free *rq;
+
+	spin_lock(&zram->slot_free_lock);
+	while ((rq = zram->slot_free_rq)) {
+		zram->slot_free_rq = rq->next;
+		spin_unlock(&zram->slot_free_lock);
+		if (free)
+			zram_free_page(zram, rq->index);
+		kfree(rq);
+		spin_lock(&zram->slot_free_lock);
+	}
+	spin_unlock(&zram->slot_free_lock);
+}
+
 static int zram_make_request(struct request_queue *queue, struct bio *bio)
 {
 	struct zram *zram = queue->queuedata;
 
+	if (unlikely(zram->slot_free_rq)) {
+		down_write(&zram->lock);
+		zram_free_pending_slots(zram, true);
+		up_write(&zram->lock);
+	}
+
 	if (!valid_io_request(zram, bio)) {
 		zram_stat64_inc(zram, &zram->stats.invalid_io);
 		bio_io_error(bio);
@@ -583,35 +1198,42 @@ void zram_reset_device(struct zram *zram)
 	mutex_lock(&zram->init_lock);
 	zram->init_done = 0;
 
-	/* Free various per-device buffers */
-	kfree(zram->compress_workmem);
-	free_pages((unsigned long)zram->compress_buffer, 1);
+	/* The table goes away, so pending slot frees are moot */
+	zram_free_pending_slots(zram, false);
 
-	zram->compress_workmem = NULL;
-	zram->compress_buffer = NULL;
+	/* Free various per-device buffers */
+	zram_free_streams(zram);
 
 	/* Free all pages that are still in this zram device */
 	for (index = 0; index < zram->disksize >> PAGE_SHIFT; index++) {
-		struct page *page;
-		u16 offset;
-
-		page = zram->table[index].page;
-		offset = zram->table[index].offset;
+		struct page *page = zram->table[index].page;
 
-		if (!page)
+		if (!page || zram_test_flag(zram, index, ZRAM_SAME) ||
+		    zram_test_flag(zram, index, ZRAM_WB))
 			continue;
 
 		if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)))
 			__free_page(page);
 		else
-			xv_free(zram->mem_pool, page, offset);
+			zram_obj_free(zram, index);
 	}
 
 	vfree(zram->table);
 	zram->table = NULL;
 
-	xv_destroy_pool(zram->mem_pool);
-	zram->mem_pool = NULL;
+	vfree(zram->dedup_table);
+	zram->dedup_table = NULL;
+
+	zram_reset_backing_dev(zram);
+
+	if (zram->mem_pool) {
+		xv_destroy_pool(zram->mem_pool);
+		zram->mem_pool = NULL;
+	}
+	if (zram->zs_pool) {
+		zs_destroy_pool(zram->zs_pool);
+		zram->zs_pool = NULL;
+	}
 
 	/* Reset stats */
 	memset(&zram->stats, 0, sizeof(zram->stats));
@@ -634,19 +1256,9 @@ int zram_init_device(struct zram *zram)
 
 	zram_set_disksize(zram, totalram_pages << PAGE_SHIFT);
 
-	zram->compress_workmem = kzalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
-	if (!zram->compress_workmem) {
-		pr_err("Error allocating compressor working memory!\n");
-		ret = -ENOMEM;
-		goto fail;
-	}
-
-	zram->compress_buffer = (void *)__get_free_pages(__GFP_ZERO, 1);
-	if (!zram->compress_buffer) {
-		pr_err("Error allocating compressor buffer space\n");
-		ret = -ENOMEM;
+	ret = zram_alloc_streams(zram);
+	if (ret)
 		goto fail;
-	}
 
 	num_pages = zram->disksize >> PAGE_SHIFT;
 	zram->table = vzalloc(num_pages * sizeof(*zram->table));
@@ -663,13 +1275,27 @@ int zram_init_device(struct zram *zram)
 	/* zram devices sort of resembles non-rotational disks */
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, zram->disk->queue);
 
-	zram->mem_pool = xv_create_pool();
-	if (!zram->mem_pool) {
+	if (zram->allocator == ZRAM_ALLOC_ZSMALLOC)
+		zram->zs_pool = zs_create_pool(GFP_NOIO | __GFP_HIGHMEM);
+	else
+		zram->mem_pool = xv_create_pool();
+	if (!zram->mem_pool && !zram->zs_pool) {
 		pr_err("Error creating memory pool\n");
 		ret = -ENOMEM;
 		goto fail;
 	}
 
+	if (zram->dedup && zram->allocator == ZRAM_ALLOC_ZSMALLOC) {
+		/* About one bucket per four pages of disk */
+		zram->dedup_bits = clamp_t(int, ilog2(num_pages) - 2,
+					   8, 16);
+		zram->dedup_table = vzalloc(sizeof(struct hlist_head) <<
+					    zram->dedup_bits);
+		if (!zram->dedup_table)
+			pr_warning("Error allocating dedup table, "
+				   "dedup disabled\n");
+	}
+
 	zram->init_done = 1;
 	mutex_unlock(&zram->init_lock);
 
@@ -684,12 +1310,211 @@ fail:
 	return ret;
 }
 
+/*
+ * Frees zspages left sparse by overwritten and discarded pages.
+ * Readers and writers are held off for the duration, since they may
+ * have objects mapped. Returns the number of pages released.
+ */
+unsigned long zram_compact(struct zram *zram)
+{
+	unsigned long freed = 0;
+
+	mutex_lock(&zram->init_lock);
+	if (zram->init_done && zram->allocator == ZRAM_ALLOC_ZSMALLOC) {
+		down_write(&zram->lock);
+		freed = zs_compact(zram->zs_pool);
+		up_write(&zram->lock);
+
+		zram_stat64_add(zram, &zram->stats.pages_compacted, freed);
+	}
+	mutex_unlock(&zram->init_lock);
+
+	return freed;
+}
+
+#ifdef CONFIG_ZRAM_WRITEBACK
+int zram_set_backing_dev(struct zram *zram, const char *path)
+{
+	struct block_device *bdev;
+	unsigned long nr_pages;
+	unsigned long *bitmap;
+	char b[BDEVNAME_SIZE];
+	int ret;
+
+	bdev = blkdev_get_by_path(path, FMODE_READ | FMODE_WRITE | FMODE_EXCL,
+				  zram);
+	if (IS_ERR(bdev))
+		return PTR_ERR(bdev);
+
+	nr_pages = i_size_read(bdev->bd_inode) >> PAGE_SHIFT;
+	if (!nr_pages) {
+		ret = -EINVAL;
+		goto fail;
+	}
+
+	ret = set_blocksize(bdev, PAGE_SIZE);
+	if (ret)
+		goto fail;
+
+	bitmap = vzalloc(BITS_TO_LONGS(nr_pages) * sizeof(long));
+	if (!bitmap) {
+		ret = -ENOMEM;
+		goto fail;
+	}
+
+	zram_reset_backing_dev(zram);
+	zram->backing_dev = bdev;
+	zram->bitmap = bitmap;
+	zram->nr_pages = nr_pages;
+
+	pr_info("Using %s as backing device, %lu pages\n",
+		bdevname(bdev, b), nr_pages);
+	return 0;
+
+fail:
+	blkdev_put(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+	return ret;
+}
+
+/*
+ * Marks every page in RAM idle. Pages still idle at the next
+ * zram_writeback(zram, false) have not been touched in between.
+ */
+void zram_mark_idle(struct zram *zram)
+{
+	size_t index;
+
+	mutex_lock(&zram->init_lock);
+	if (!zram->init_done)
+		goto out;
+
+	down_write(&zram->lock);
+	for (index = 0; index < zram->disksize >> PAGE_SHIFT; index++) {
+		if (zram->table[index].page &&
+		    !zram_test_flag(zram, index, ZRAM_SAME) &&
+		    !zram_test_flag(zram, index, ZRAM_WB))
+			zram_set_flag(zram, index, ZRAM_IDLE);
+	}
+	up_write(&zram->lock);
+out:
+	mutex_unlock(&zram->init_lock);
+}
+
+static int zram_wb_candidate(struct zram *zram, u32 index, bool huge)
+{
+	if (!zram->table[index].page ||
+	    zram_test_flag(zram, index, ZRAM_SAME) ||
+	    zram_test_flag(zram, index, ZRAM_WB) ||
+	    zram_test_flag(zram, index, ZRAM_UNDER_WB))
+		return 0;
+
+	if (huge)
+		return zram_test_flag(zram, index, ZRAM_UNCOMPRESSED);
+	return zram_test_flag(zram, index, ZRAM_IDLE);
+}
+
+/*
+ * Moves incompressible (@huge) or idle pages to the backing device.
+ * The lock is dropped around each write; a page rewritten meanwhile
+ * loses ZRAM_UNDER_WB in zram_free_page() and keeps its new data.
+ * Returns the number of pages written back.
+ */
+int zram_writeback(struct zram *zram, bool huge)
+{
+	struct page *page;
+	size_t index;
+	int ret = 0, count = 0;
+
+	mutex_lock(&zram->init_lock);
+	if (!zram->init_done || !zram->backing_dev) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (index = 0; index < zram->disksize >> PAGE_SHIFT; index++) {
+		unsigned long blk;
+		void *mem;
+
+		down_write(&zram->lock);
+		if (!zram_wb_candidate(zram, index, huge)) {
+			up_write(&zram->lock);
+			continue;
+		}
+
+		mem = kmap(page);
+		ret = zram_read_before_write(zram, mem, index);
+		kunmap(page);
+		if (ret) {
+			up_write(&zram->lock);
+			break;
+		}
+		zram_set_flag(zram, index, ZRAM_UNDER_WB);
+		up_write(&zram->lock);
+
+		blk = zram_bdev_alloc_block(zram);
+		if (blk != ULONG_MAX)
+			ret = zram_bdev_rw(zram, WRITE, blk, page);
+		else
+			ret = -ENOSPC;
+
+		down_write(&zram->lock);
+		if (ret || !zram_test_flag(zram, index, ZRAM_UNDER_WB)) {
+			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+			if (blk != ULONG_MAX)
+				clear_bit(blk, zram->bitmap);
+			up_write(&zram->lock);
+			if (ret)
+				break;
+			continue;
+		}
+
+		zram_free_page(zram, index);
+		zram_set_flag(zram, index, ZRAM_WB);
+		zram->table[index].element = blk;
+		zram_stat_inc(&zram->stats.pages_wb);
+		up_write(&zram->lock);
+		count++;
+	}
+
+	__free_page(page);
+out:
+	mutex_unlock(&zram->init_lock);
+
+	return ret ? ret : count;
+}
+#endif
+
+/*
+ * Called with swap_lock held, so zram->lock can only be tried. When a
+ * reader or writer holds it, the slot is queued and freed on the next
+ * request; if even that allocation fails, the slot keeps its data until
+ * it is written again, as before notify existed.
+ */
 void zram_slot_free_notify(struct block_device *bdev, unsigned long index)
 {
 	struct zram *zram;
+	struct zram_slot_free *rq;
 
 	zram = bdev->bd_disk->private_data;
-	zram_free_page(zram, index);
+	if (down_write_trylock(&zram->lock)) {
+		zram_free_page(zram, index);
+		up_write(&zram->lock);
+	} else {
+		rq = kmalloc(sizeof(*rq), GFP_ATOMIC);
+		if (!rq)
+			return;
+		rq->index = index;
+		spin_lock(&zram->slot_free_lock);
+		rq->next = zram->slot_free_rq;
+		zram->slot_free_rq = rq;
+		spin_unlock(&zram->slot_free_lock);
+	}
 	zram_stat64_inc(zram, &zram->stats.notify_free);
 }
 
@@ -705,6 +1530,12 @@ static int create_device(struct zram *zram, int device_id)
 	init_rwsem(&zram->lock);
 	mutex_init(&zram->init_lock);
 	spin_lock_init(&zram->stat64_lock);
+	spin_lock_init(&zram->slot_free_lock);
+	spin_lock_init(&zram->dedup_lock);
+
+	zram->backend = ZRAM_BACKEND_LZO;
+	zram->allocator = ZRAM_ALLOC_ZSMALLOC;
+	zram->max_zpage_size = ZRAM_DEFAULT_MAX_ZPAGE_SIZE;
 
 	zram->queue = blk_alloc_queue(GFP_KERNEL);
 	if (!zram->queue) {
@@ -717,6 +1548,12 @@ static int create_device(struct zram *zram, int device_id)
 	blk_queue_make_request(zram->queue, zram_make_request);
 	zram->queue->queuedata = zram;
 
+	/*
+	 * Neighbouring slots hold unrelated pages, reading them ahead only
+	 * costs decompressions.  Swap reads ahead within the vma instead.
+	 */
+	zram->queue->backing_dev_info.ra_pages = 0;
+
 	 /* gendisk structure */
 	zram->disk = alloc_disk(1);
 	if (!zram->disk) {
@@ -787,11 +1624,19 @@ static int __init zram_init(void)
 		goto out;
 	}
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+	zram_bdev_wq = alloc_workqueue("zram_bdev", WQ_MEM_RECLAIM, 1);
+	if (!zram_bdev_wq) {
+		ret = -ENOMEM;
+		goto out;
+	}
+#endif
+
 	zram_major = register_blkdev(0, "zram");
 	if (zram_major <= 0) {
 		pr_warning("Unable to get major number\n");
 		ret = -EBUSY;
-		goto out;
+		goto destroy_wq;
 	}
 
 	if (!num_devices) {
@@ -821,6 +1666,10 @@ free_devices:
 	kfree(devices);
 unregister:
 	unregister_blkdev(zram_major, "zram");
+destroy_wq:
+#ifdef CONFIG_ZRAM_WRITEBACK
+	destroy_workqueue(zram_bdev_wq);
+#endif
 out:
 	return ret;
 }
@@ -841,6 +1690,9 @@ static void __exit zram_exit(void)
 	unregister_blkdev(zram_major, "zram");
 
 	kfree(devices);
+#ifdef CONFIG_ZRAM_WRITEBACK
+	destroy_workqueue(zram_bdev_wq);
+#endif
 	pr_debug("Cleanup done!\n");
 }
 
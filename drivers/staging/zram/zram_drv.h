@@ -17,8 +17,10 @@
 
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
+#include <linux/crypto.h>
 
 #include "xvmalloc.h"
+#include "zsmalloc.h"
 
 /*
  * Some arbitrary value. This is just to catch
@@ -45,15 +47,16 @@ static const unsigned default_disksize_perc_ram = 25;
 
 /*
  * Pages that compress to size greater than this are stored
- * uncompressed in memory.
+ * uncompressed in memory. Tunable per device through sysfs.
  */
-static const unsigned max_zpage_size = PAGE_SIZE / 4 * 3;
+#define ZRAM_DEFAULT_MAX_ZPAGE_SIZE	(PAGE_SIZE / 4 * 3)
 
 /*
  * NOTE: max_zpage_size must be less than or equal to:
  *   XV_MAX_ALLOC_SIZE - sizeof(struct zobj_header)
  * otherwise, xv_malloc() would always return failure.
  */
+#define ZRAM_MAX_ZPAGE_SIZE_LIMIT	(PAGE_SIZE / 8 * 7)
 
 /*-- End of configurable params */
 
@@ -71,18 +74,71 @@ enum zram_pageflags {
 	/* Page is stored uncompressed */
 	ZRAM_UNCOMPRESSED,
 
-	/* Page consists entirely of zeros */
-	ZRAM_ZERO,
+	/*
+	 * Page consists of a single repeated word, kept in
+	 * table[page_no].element. Zero pages are the common case.
+	 */
+	ZRAM_SAME,
+
+	/* Entry points at a shared struct zram_dedup_entry */
+	ZRAM_DEDUP,
+
+	/* Page lives on the backing device, block no. in element */
+	ZRAM_WB,
+
+	/* Page is being written to the backing device */
+	ZRAM_UNDER_WB,
+
+	/* Page was not accessed since the last idle marking */
+	ZRAM_IDLE,
 
 	__NR_ZRAM_PAGEFLAGS,
 };
 
+/* Compression backends, routed through the crypto compress API */
+enum zram_backend {
+	ZRAM_BACKEND_LZO,
+	ZRAM_BACKEND_LZ4,
+	ZRAM_NR_BACKENDS,
+};
+
+/* Object allocators for compressed pages */
+enum zram_allocator {
+	ZRAM_ALLOC_XVMALLOC,
+	ZRAM_ALLOC_ZSMALLOC,
+	ZRAM_NR_ALLOCATORS,
+};
+
 /*-- Data structures */
 
-/* Allocated for each disk page */
+/*
+ * Per-CPU compression workspace. The mutex is taken by whichever writer
+ * is using it: the write path may sleep in the allocator and migrate off
+ * its CPU while still holding the buffer.
+ */
+struct zram_stream {
+	struct crypto_comp *tfm;
+	struct crypto_comp *dtfm;	/* used with preemption disabled */
+	void *buffer;
+	struct mutex lock;
+};
+
+/*
+ * Allocated for each disk page. Incompressible pages and xvmalloc
+ * objects are found through page/offset; zsmalloc objects through
+ * their handle, with the exact compressed size kept alongside. For
+ * ZRAM_DEDUP entries the handle is a struct zram_dedup_entry pointer.
+ */
 struct table {
-	struct page *page;
-	u16 offset;
+	union {
+		struct page *page;
+		unsigned long handle;
+		unsigned long element;
+	};
+	union {
+		u16 offset;
+		u16 size;
+	};
 	u8 count;	/* object ref count (not yet used) */
 	u8 flags;
 } __attribute__((aligned(4)));
@@ -96,19 +152,55 @@ struct zram_stats {
 	u64 invalid_io;		/* non-page-aligned I/O requests */
 	u64 notify_free;	/* no. of swap slot free notifications */
 	u32 pages_zero;		/* no. of zero filled pages */
+	u32 pages_same;		/* no. of other same filled pages */
+	u32 pages_dedup;	/* no. of pages sharing another's object */
 	u32 pages_stored;	/* no. of pages currently stored */
 	u32 good_compress;	/* % of pages with compression ratio<=50% */
 	u32 pages_expand;	/* % of incompressible pages */
+	u64 pages_compacted;	/* pages freed by compaction */
+	u32 pages_wb;		/* no. of pages on the backing device */
+	u64 bd_reads;		/* reads from the backing device */
+	u64 bd_writes;		/* writes to the backing device */
+};
+
+/* Kept across device resets so backends can be compared */
+struct zram_backend_stats {
+	u64 compress;		/* no. of compress calls */
+	u64 compress_ns;	/* time spent compressing */
+	u64 decompress;		/* no. of decompress calls */
+	u64 decompress_ns;	/* time spent decompressing */
+	u64 orig_size;		/* bytes fed to the compressor */
+	u64 compr_size;		/* bytes it produced */
+};
+
+/*
+ * A zsmalloc object shared by every table entry whose compressed data
+ * is identical. Hashed on the compressed bytes.
+ */
+struct zram_dedup_entry {
+	struct hlist_node node;
+	unsigned long handle;
+	u32 checksum;
+	u16 size;
+	u16 refcount;
+};
+
+/* Swap slot frees that could not take zram->lock, see zram_slot_free_notify */
+struct zram_slot_free {
+	unsigned long index;
+	struct zram_slot_free *next;
 };
 
 struct zram {
 	struct xv_pool *mem_pool;
-	void *compress_workmem;
-	void *compress_buffer;
+	struct zs_pool *zs_pool;
+	struct zram_stream __percpu *streams;
 	struct table *table;
 	spinlock_t stat64_lock;	/* protect 64-bit stats */
-	struct rw_semaphore lock; /* protect compression buffers and table
-				   * against concurrent read and writes */
+	struct rw_semaphore lock; /* protect table and allocations against
+				   * concurrent read and writes */
+	spinlock_t slot_free_lock;
+	struct zram_slot_free *slot_free_rq;
 	struct request_queue *queue;
 	struct gendisk *disk;
 	int init_done;
@@ -119,17 +211,45 @@ struct zram {
 	 * we can store in a disk.
 	 */
 	u64 disksize;	/* bytes */
+	unsigned int backend;		/* enum zram_backend */
+	unsigned int allocator;		/* enum zram_allocator */
+	unsigned int max_zpage_size;
+
+	/* Content-hash dedup of compressed pages, zsmalloc only */
+	int dedup;
+	struct hlist_head *dedup_table;
+	unsigned int dedup_bits;
+	spinlock_t dedup_lock;
+
+#ifdef CONFIG_ZRAM_WRITEBACK
+	struct block_device *backing_dev;
+	unsigned long *bitmap;		/* used blocks of backing_dev */
+	unsigned long nr_pages;		/* size of backing_dev in pages */
+#endif
+
+	/* moving averages behind the reclaim cost hint, under stat64_lock */
+	u32 compress_avg_ns;
+	u32 decompress_avg_ns;
 
 	struct zram_stats stats;
+	struct zram_backend_stats backend_stats[ZRAM_NR_BACKENDS];
 };
 
 extern struct zram *devices;
 extern unsigned int num_devices;
+extern const char * const zram_backend_names[ZRAM_NR_BACKENDS];
+extern const char * const zram_allocator_names[ZRAM_NR_ALLOCATORS];
 #ifdef CONFIG_SYSFS
 extern struct attribute_group zram_disk_attr_group;
 #endif
 
 extern int zram_init_device(struct zram *zram);
 extern void zram_reset_device(struct zram *zram);
+extern unsigned long zram_compact(struct zram *zram);
+#ifdef CONFIG_ZRAM_WRITEBACK
+extern int zram_set_backing_dev(struct zram *zram, const char *path);
+extern void zram_mark_idle(struct zram *zram);
+extern int zram_writeback(struct zram *zram, bool huge);
+#endif
 
 #endif
@@ -15,6 +15,8 @@
 #include <linux/device.h>
 #include <linux/genhd.h>
 #include <linux/mm.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
 
 #include "zram_drv.h"
 
@@ -156,6 +158,51 @@ static ssize_t zero_pages_show(struct device *dev,
 	return sprintf(buf, "%u\n", zram->stats.pages_zero);
 }
 
+static ssize_t same_pages_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sprintf(buf, "%u\n", zram->stats.pages_same);
+}
+
+static ssize_t dedup_pages_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sprintf(buf, "%u\n", zram->stats.pages_dedup);
+}
+
+static ssize_t dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sprintf(buf, "%d\n", zram->dedup);
+}
+
+static ssize_t dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	int ret;
+	unsigned long val;
+	struct zram *zram = dev_to_zram(dev);
+
+	if (zram->init_done) {
+		pr_info("Cannot change dedup for initialized device\n");
+		return -EBUSY;
+	}
+
+	ret = strict_strtoul(buf, 10, &val);
+	if (ret)
+		return ret;
+
+	zram->dedup = !!val;
+
+	return len;
+}
+
 static ssize_t orig_data_size_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -181,13 +228,323 @@ static ssize_t mem_used_total_show(struct device *dev,
 	struct zram *zram = dev_to_zram(dev);
 
 	if (zram->init_done) {
-		val = xv_get_total_size_bytes(zram->mem_pool) +
-			((u64)(zram->stats.pages_expand) << PAGE_SHIFT);
+		if (zram->allocator == ZRAM_ALLOC_ZSMALLOC)
+			val = zs_get_total_size_bytes(zram->zs_pool);
+		else
+			val = xv_get_total_size_bytes(zram->mem_pool);
+		val += (u64)(zram->stats.pages_expand) << PAGE_SHIFT;
 	}
 
 	return sprintf(buf, "%llu\n", val);
 }
 
+static ssize_t comp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < ZRAM_NR_BACKENDS; i++) {
+		if (!crypto_has_comp(zram_backend_names[i], 0, 0))
+			continue;
+		len += sprintf(buf + len, i == zram->backend ? "[%s] " : "%s ",
+			       zram_backend_names[i]);
+	}
+	if (len)
+		buf[len - 1] = '\n';
+
+	return len;
+}
+
+static ssize_t comp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	size_t sz = len;
+	int i;
+
+	if (zram->init_done) {
+		pr_info("Cannot change backend for initialized device\n");
+		return -EBUSY;
+	}
+
+	if (sz && buf[sz - 1] == '\n')
+		sz--;
+
+	for (i = 0; i < ZRAM_NR_BACKENDS; i++) {
+		if (strlen(zram_backend_names[i]) == sz &&
+		    !strncmp(buf, zram_backend_names[i], sz))
+			break;
+	}
+
+	if (i == ZRAM_NR_BACKENDS ||
+	    !crypto_has_comp(zram_backend_names[i], 0, 0))
+		return -EINVAL;
+
+	zram->backend = i;
+
+	return len;
+}
+
+static ssize_t max_zpage_size_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sprintf(buf, "%u\n", zram->max_zpage_size);
+}
+
+static ssize_t max_zpage_size_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	int ret;
+	unsigned long val;
+	struct zram *zram = dev_to_zram(dev);
+
+	ret = strict_strtoul(buf, 10, &val);
+	if (ret)
+		return ret;
+
+	if (val < PAGE_SIZE / 8 || val > ZRAM_MAX_ZPAGE_SIZE_LIMIT)
+		return -EINVAL;
+
+	zram->max_zpage_size = val;
+
+	return len;
+}
+
+static ssize_t backend_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_backend_stats bs;
+	ssize_t len;
+	int i;
+
+	len = sprintf(buf, "%-4s %10s %10s %10s %10s %6s\n", "name",
+		      "comp", "comp_ns", "decomp", "decomp_ns", "ratio%");
+
+	for (i = 0; i < ZRAM_NR_BACKENDS; i++) {
+		spin_lock(&zram->stat64_lock);
+		bs = zram->backend_stats[i];
+		spin_unlock(&zram->stat64_lock);
+
+		len += sprintf(buf + len, "%-4s %10llu %10llu %10llu %10llu %6llu\n",
+			zram_backend_names[i], bs.compress,
+			div64_u64(bs.compress_ns, bs.compress ?: 1),
+			bs.decompress,
+			div64_u64(bs.decompress_ns, bs.decompress ?: 1),
+			div64_u64(bs.compr_size * 100, bs.orig_size ?: 1));
+	}
+
+	return len;
+}
+
+static ssize_t allocator_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < ZRAM_NR_ALLOCATORS; i++)
+		len += sprintf(buf + len, i == zram->allocator ? "[%s] " : "%s ",
+			       zram_allocator_names[i]);
+	buf[len - 1] = '\n';
+
+	return len;
+}
+
+static ssize_t allocator_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	size_t sz = len;
+	int i;
+
+	if (zram->init_done) {
+		pr_info("Cannot change allocator for initialized device\n");
+		return -EBUSY;
+	}
+
+	if (sz && buf[sz - 1] == '\n')
+		sz--;
+
+	for (i = 0; i < ZRAM_NR_ALLOCATORS; i++) {
+		if (strlen(zram_allocator_names[i]) == sz &&
+		    !strncmp(buf, zram_allocator_names[i], sz))
+			break;
+	}
+
+	if (i == ZRAM_NR_ALLOCATORS)
+		return -EINVAL;
+
+	zram->allocator = i;
+
+	return len;
+}
+
+static ssize_t compact_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	zram_compact(zram);
+
+	return len;
+}
+
+#ifdef CONFIG_ZRAM_WRITEBACK
+static ssize_t backing_dev_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char b[BDEVNAME_SIZE];
+	ssize_t len;
+
+	mutex_lock(&zram->init_lock);
+	if (zram->backing_dev)
+		len = sprintf(buf, "%s\n", bdevname(zram->backing_dev, b));
+	else
+		len = sprintf(buf, "none\n");
+	mutex_unlock(&zram->init_lock);
+
+	return len;
+}
+
+static ssize_t backing_dev_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char *path;
+	size_t sz;
+	int ret;
+
+	path = kstrndup(buf, len, GFP_KERNEL);
+	if (!path)
+		return -ENOMEM;
+
+	sz = strlen(path);
+	if (sz && path[sz - 1] == '\n')
+		path[sz - 1] = '\0';
+
+	mutex_lock(&zram->init_lock);
+	if (zram->init_done) {
+		pr_info("Cannot change backing device for initialized "
+			"device\n");
+		ret = -EBUSY;
+	} else {
+		ret = zram_set_backing_dev(zram, path);
+	}
+	mutex_unlock(&zram->init_lock);
+
+	kfree(path);
+
+	return ret ? ret : len;
+}
+
+static ssize_t idle_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	if (!sysfs_streq(buf, "all"))
+		return -EINVAL;
+
+	zram_mark_idle(zram);
+
+	return len;
+}
+
+static ssize_t writeback_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	int ret;
+
+	if (sysfs_streq(buf, "huge"))
+		ret = zram_writeback(zram, true);
+	else if (sysfs_streq(buf, "idle"))
+		ret = zram_writeback(zram, false);
+	else
+		return -EINVAL;
+
+	return ret < 0 ? ret : len;
+}
+
+static ssize_t bd_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sprintf(buf, "%8u %8llu %8llu\n", zram->stats.pages_wb,
+		zram_stat64_read(zram, &zram->stats.bd_reads),
+		zram_stat64_read(zram, &zram->stats.bd_writes));
+}
+#endif
+
+/*
+ * Per size class usage of the zsmalloc pool, followed by the overall
+ * fragmentation: the share of allocator memory not holding data.
+ */
+static ssize_t alloc_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zs_class_stats cs;
+	u64 used, compr;
+	ssize_t len = 0;
+	int i;
+
+	mutex_lock(&zram->init_lock);
+	if (!zram->init_done) {
+		mutex_unlock(&zram->init_lock);
+		return 0;
+	}
+
+	if (zram->allocator == ZRAM_ALLOC_ZSMALLOC) {
+		len += sprintf(buf + len, "%5s %5s %4s %8s %8s %8s\n",
+			       "size", "pages", "objs", "zspages",
+			       "obj_used", "obj_free");
+
+		for (i = 0; !zs_get_class_stats(zram->zs_pool, i, &cs); i++) {
+			if (!cs.zspages)
+				continue;
+			/* Keep the tail lines inside the sysfs page */
+			if (len > PAGE_SIZE - 256)
+				break;
+			len += sprintf(buf + len,
+				       "%5u %5u %4u %8lu %8lu %8lu\n",
+				       cs.size, cs.pages_per_zspage,
+				       cs.objs_per_zspage, cs.zspages,
+				       cs.obj_used,
+				       cs.zspages * cs.objs_per_zspage -
+				       cs.obj_used);
+		}
+
+		used = zs_get_total_size_bytes(zram->zs_pool);
+	} else {
+		used = xv_get_total_size_bytes(zram->mem_pool);
+	}
+
+	/* Incompressible pages are accounted in full on both sides */
+	compr = zram_stat64_read(zram, &zram->stats.compr_size) -
+		((u64)zram->stats.pages_expand << PAGE_SHIFT);
+
+	len += sprintf(buf + len, "allocator: %s\n",
+		       zram_allocator_names[zram->allocator]);
+	len += sprintf(buf + len, "pool_bytes: %llu\n", used);
+	len += sprintf(buf + len, "data_bytes: %llu\n", compr);
+	len += sprintf(buf + len, "fragmentation: %llu%%\n", used > compr ?
+		       div64_u64((used - compr) * 100, used) : 0);
+	len += sprintf(buf + len, "pages_compacted: %llu\n",
+		       zram_stat64_read(zram, &zram->stats.pages_compacted));
+	mutex_unlock(&zram->init_lock);
+
+	return len;
+}
+
 static DEVICE_ATTR(disksize, S_IRUGO | S_IWUSR,
 		disksize_show, disksize_store);
 static DEVICE_ATTR(initstate, S_IRUGO, initstate_show, NULL);
@@ -197,9 +554,28 @@ static DEVICE_ATTR(num_writes, S_IRUGO, num_writes_show, NULL);
 static DEVICE_ATTR(invalid_io, S_IRUGO, invalid_io_show, NULL);
 static DEVICE_ATTR(notify_free, S_IRUGO, notify_free_show, NULL);
 static DEVICE_ATTR(zero_pages, S_IRUGO, zero_pages_show, NULL);
+static DEVICE_ATTR(same_pages, S_IRUGO, same_pages_show, NULL);
+static DEVICE_ATTR(dedup_pages, S_IRUGO, dedup_pages_show, NULL);
+static DEVICE_ATTR(dedup, S_IRUGO | S_IWUSR, dedup_show, dedup_store);
 static DEVICE_ATTR(orig_data_size, S_IRUGO, orig_data_size_show, NULL);
 static DEVICE_ATTR(compr_data_size, S_IRUGO, compr_data_size_show, NULL);
 static DEVICE_ATTR(mem_used_total, S_IRUGO, mem_used_total_show, NULL);
+static DEVICE_ATTR(comp_algorithm, S_IRUGO | S_IWUSR,
+		comp_algorithm_show, comp_algorithm_store);
+static DEVICE_ATTR(max_zpage_size, S_IRUGO | S_IWUSR,
+		max_zpage_size_show, max_zpage_size_store);
+static DEVICE_ATTR(backend_stats, S_IRUGO, backend_stats_show, NULL);
+static DEVICE_ATTR(allocator, S_IRUGO | S_IWUSR,
+		allocator_show, allocator_store);
+static DEVICE_ATTR(compact, S_IWUSR, NULL, compact_store);
+static DEVICE_ATTR(alloc_stats, S_IRUGO, alloc_stats_show, NULL);
+#ifdef CONFIG_ZRAM_WRITEBACK
+static DEVICE_ATTR(backing_dev, S_IRUGO | S_IWUSR,
+		backing_dev_show, backing_dev_store);
+static DEVICE_ATTR(idle, S_IWUSR, NULL, idle_store);
+static DEVICE_ATTR(writeback, S_IWUSR, NULL, writeback_store);
+static DEVICE_ATTR(bd_stat, S_IRUGO, bd_stat_show, NULL);
+#endif
 
 static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_disksize.attr,
@@ -210,9 +586,24 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_invalid_io.attr,
 	&dev_attr_notify_free.attr,
 	&dev_attr_zero_pages.attr,
+	&dev_attr_same_pages.attr,
+	&dev_attr_dedup_pages.attr,
+	&dev_attr_dedup.attr,
 	&dev_attr_orig_data_size.attr,
 	&dev_attr_compr_data_size.attr,
 	&dev_attr_mem_used_total.attr,
+	&dev_attr_comp_algorithm.attr,
+	&dev_attr_max_zpage_size.attr,
+	&dev_attr_backend_stats.attr,
+	&dev_attr_allocator.attr,
+	&dev_attr_compact.attr,
+	&dev_attr_alloc_stats.attr,
+#ifdef CONFIG_ZRAM_WRITEBACK
+	&dev_attr_backing_dev.attr,
+	&dev_attr_idle.attr,
+	&dev_attr_writeback.attr,
+	&dev_attr_bd_stat.attr,
+#endif
 	NULL,
 };
 
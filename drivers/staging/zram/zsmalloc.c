@@ -0,0 +1,655 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * Objects are grouped in size classes ZS_SIZE_CLASS_DELTA bytes apart.
+ * Each class carves its objects out of "zspages": runs of 1 to
+ * ZS_MAX_PAGES_PER_ZSPAGE order-0 pages, sized so that the tail left
+ * over after the last object is as small as possible. Objects are laid
+ * out back to back in the zspage and may straddle a page boundary;
+ * zs_map_object() bounces those through a per-CPU buffer.
+ *
+ * Every object begins with a one word header. Allocated objects store
+ * the address of their handle there, free objects store the index of
+ * the next free object tagged with ZS_OBJ_FREE. The header lets
+ * zs_compact() walk a sparse zspage, move its objects elsewhere and
+ * patch up their handles, so the whole zspage can be freed.
+ *
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifdef CONFIG_ZRAM_DEBUG
+#define DEBUG
+#endif
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/highmem.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "zsmalloc.h"
+#include "zsmalloc_int.h"
+
+/* Handles are shared by all pools */
+static DEFINE_MUTEX(zs_handle_mutex);
+static struct kmem_cache *zs_handle_cache;
+static int zs_handle_users;
+
+static int get_size_class_index(size_t size)
+{
+	if (size <= ZS_MIN_ALLOC_SIZE)
+		return 0;
+
+	return DIV_ROUND_UP(size - ZS_MIN_ALLOC_SIZE, ZS_SIZE_CLASS_DELTA);
+}
+
+/*
+ * Pick the zspage size, in pages, that wastes the smallest fraction
+ * of its memory for objects of the given size.
+ */
+static unsigned int get_pages_per_zspage(unsigned int size)
+{
+	unsigned int i, best = 1, best_usage = 0;
+
+	for (i = 1; i <= ZS_MAX_PAGES_PER_ZSPAGE; i++) {
+		unsigned int bytes = i * PAGE_SIZE;
+		unsigned int usage = (bytes / size) * size * 100 / bytes;
+
+		if (usage > best_usage) {
+			best_usage = usage;
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+static void obj_location(struct zspage *zspage, unsigned int idx,
+			struct page **page, unsigned int *offset)
+{
+	unsigned long off = (unsigned long)idx * zspage->class->size;
+
+	*page = zspage->pages[off >> PAGE_SHIFT];
+	*offset = off & ~PAGE_MASK;
+}
+
+/*
+ * Object offsets are multiples of ZS_SIZE_CLASS_DELTA, so the header
+ * of an object never crosses a page boundary.
+ */
+static unsigned long obj_get_header(struct zspage *zspage, unsigned int idx)
+{
+	struct page *page;
+	unsigned int offset;
+	unsigned long *obj, val;
+
+	obj_location(zspage, idx, &page, &offset);
+	obj = kmap_atomic(page, KM_USER0) + offset;
+	val = *obj;
+	kunmap_atomic(obj, KM_USER0);
+
+	return val;
+}
+
+static void obj_set_header(struct zspage *zspage, unsigned int idx,
+			unsigned long val)
+{
+	struct page *page;
+	unsigned int offset;
+	unsigned long *obj;
+
+	obj_location(zspage, idx, &page, &offset);
+	obj = kmap_atomic(page, KM_USER0) + offset;
+	*obj = val;
+	kunmap_atomic(obj, KM_USER0);
+}
+
+static enum zs_fullness_group get_fullness_group(struct zspage *zspage)
+{
+	unsigned int objs = zspage->class->objs_per_zspage;
+
+	if (zspage->inuse == objs)
+		return ZS_FULL;
+	if (zspage->inuse * 100 > objs * ZS_ALMOST_FULL_PERCENT)
+		return ZS_ALMOST_FULL;
+	return ZS_ALMOST_EMPTY;
+}
+
+static void fix_fullness_group(struct size_class *class, struct zspage *zspage)
+{
+	enum zs_fullness_group fg = get_fullness_group(zspage);
+
+	if (fg == zspage->fullness)
+		return;
+
+	zspage->fullness = fg;
+	list_move(&zspage->list, &class->fullness_list[fg]);
+}
+
+static void free_zspage(struct zs_pool *pool, struct zspage *zspage)
+{
+	struct size_class *class = zspage->class;
+	unsigned int i;
+
+	for (i = 0; i < class->pages_per_zspage; i++)
+		__free_page(zspage->pages[i]);
+
+	atomic_long_sub(class->pages_per_zspage, &pool->pages_allocated);
+	class->zspages--;
+	kfree(zspage);
+}
+
+static struct zspage *alloc_zspage(struct zs_pool *pool,
+				struct size_class *class)
+{
+	struct zspage *zspage;
+	unsigned int i;
+
+	zspage = kzalloc(sizeof(*zspage), pool->flags & ~__GFP_HIGHMEM);
+	if (!zspage)
+		return NULL;
+
+	zspage->class = class;
+	for (i = 0; i < class->pages_per_zspage; i++) {
+		zspage->pages[i] = alloc_page(pool->flags);
+		if (!zspage->pages[i])
+			goto out_free;
+	}
+
+	/* Thread all objects onto the free list */
+	for (i = 0; i < class->objs_per_zspage; i++) {
+		unsigned long next = i + 1;
+
+		if (next == class->objs_per_zspage)
+			next = ZS_OBJ_END;
+		obj_set_header(zspage, i, (next << 1) | ZS_OBJ_FREE);
+	}
+	zspage->freeobj = 0;
+	zspage->inuse = 0;
+	zspage->fullness = ZS_ALMOST_EMPTY;
+	INIT_LIST_HEAD(&zspage->list);
+
+	atomic_long_add(class->pages_per_zspage, &pool->pages_allocated);
+	return zspage;
+
+out_free:
+	while (i--)
+		__free_page(zspage->pages[i]);
+	kfree(zspage);
+	return NULL;
+}
+
+/* Take the first free object of a zspage; called with class->lock held */
+static unsigned int obj_take(struct zspage *zspage, struct zs_handle *handle)
+{
+	unsigned int idx = zspage->freeobj;
+
+	zspage->freeobj = obj_get_header(zspage, idx) >> 1;
+	obj_set_header(zspage, idx, (unsigned long)handle);
+	zspage->inuse++;
+	zspage->class->obj_used++;
+
+	return idx;
+}
+
+/* Return an object to its zspage; called with class->lock held */
+static void obj_put(struct zspage *zspage, unsigned int idx)
+{
+	obj_set_header(zspage, idx, (zspage->freeobj << 1) | ZS_OBJ_FREE);
+	zspage->freeobj = idx;
+	zspage->inuse--;
+	zspage->class->obj_used--;
+}
+
+static struct zspage *find_zspage(struct size_class *class)
+{
+	int fg;
+
+	for (fg = ZS_ALMOST_FULL; fg >= ZS_ALMOST_EMPTY; fg--) {
+		if (!list_empty(&class->fullness_list[fg]))
+			return list_first_entry(&class->fullness_list[fg],
+						struct zspage, list);
+	}
+
+	return NULL;
+}
+
+/**
+ * zs_create_pool - Creates an allocation pool to work from.
+ * @flags: allocation flags used for zspage pages
+ *
+ * Returns NULL if any of the per-pool structures cannot be allocated.
+ */
+struct zs_pool *zs_create_pool(gfp_t flags)
+{
+	struct zs_pool *pool;
+	unsigned int cpu;
+	int i;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+		int fg;
+
+		class->size = ZS_MIN_ALLOC_SIZE + i * ZS_SIZE_CLASS_DELTA;
+		class->pages_per_zspage = get_pages_per_zspage(class->size);
+		class->objs_per_zspage = class->pages_per_zspage * PAGE_SIZE /
+					class->size;
+		spin_lock_init(&class->lock);
+		for (fg = 0; fg < ZS_NR_FULLNESS; fg++)
+			INIT_LIST_HEAD(&class->fullness_list[fg]);
+	}
+
+	pool->map_area = alloc_percpu(struct zs_map_area);
+	if (!pool->map_area)
+		goto out_free_pool;
+
+	for_each_possible_cpu(cpu) {
+		struct zs_map_area *area = per_cpu_ptr(pool->map_area, cpu);
+
+		area->buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+		if (!area->buf)
+			goto out_free_area;
+	}
+
+	mutex_lock(&zs_handle_mutex);
+	if (!zs_handle_users) {
+		zs_handle_cache = kmem_cache_create("zs_handle",
+					sizeof(struct zs_handle), 0, 0, NULL);
+	}
+	if (zs_handle_cache)
+		zs_handle_users++;
+	mutex_unlock(&zs_handle_mutex);
+	if (!zs_handle_cache)
+		goto out_free_area;
+
+	pool->handle_cache = zs_handle_cache;
+	pool->flags = flags;
+	atomic_long_set(&pool->pages_allocated, 0);
+
+	return pool;
+
+out_free_area:
+	for_each_possible_cpu(cpu)
+		kfree(per_cpu_ptr(pool->map_area, cpu)->buf);
+	free_percpu(pool->map_area);
+out_free_pool:
+	kfree(pool);
+	return NULL;
+}
+EXPORT_SYMBOL_GPL(zs_create_pool);
+
+/*
+ * Frees whatever zspages are still around; the handles of objects
+ * left in the pool must not be used afterwards.
+ */
+void zs_destroy_pool(struct zs_pool *pool)
+{
+	unsigned int cpu;
+	int i;
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+		struct zspage *zspage, *tmp;
+		int fg;
+
+		for (fg = 0; fg < ZS_NR_FULLNESS; fg++) {
+			list_for_each_entry_safe(zspage, tmp,
+					&class->fullness_list[fg], list) {
+				unsigned int idx;
+
+				for (idx = 0; idx < class->objs_per_zspage;
+						idx++) {
+					unsigned long hdr;
+
+					hdr = obj_get_header(zspage, idx);
+					if (!(hdr & ZS_OBJ_FREE))
+						kmem_cache_free(pool->handle_cache,
+							(void *)hdr);
+				}
+				list_del(&zspage->list);
+				free_zspage(pool, zspage);
+			}
+		}
+	}
+
+	for_each_possible_cpu(cpu)
+		kfree(per_cpu_ptr(pool->map_area, cpu)->buf);
+	free_percpu(pool->map_area);
+
+	mutex_lock(&zs_handle_mutex);
+	if (!--zs_handle_users) {
+		kmem_cache_destroy(zs_handle_cache);
+		zs_handle_cache = NULL;
+	}
+	mutex_unlock(&zs_handle_mutex);
+
+	kfree(pool);
+}
+EXPORT_SYMBOL_GPL(zs_destroy_pool);
+
+/**
+ * zs_malloc - Allocate an object from the pool.
+ * @pool: pool to allocate from
+ * @size: size of the object, at most ZS_MAX_ALLOC_SIZE - ZS_HANDLE_SIZE
+ *
+ * Returns an opaque handle, or 0 if the allocation failed. The object
+ * is only accessible through zs_map_object().
+ */
+unsigned long zs_malloc(struct zs_pool *pool, size_t size)
+{
+	struct zs_handle *handle;
+	struct size_class *class;
+	struct zspage *zspage;
+
+	size += ZS_HANDLE_SIZE;
+	if (unlikely(!size || size > ZS_MAX_ALLOC_SIZE))
+		return 0;
+
+	handle = kmem_cache_alloc(pool->handle_cache,
+				pool->flags & ~__GFP_HIGHMEM);
+	if (!handle)
+		return 0;
+
+	class = &pool->size_class[get_size_class_index(size)];
+
+	spin_lock(&class->lock);
+	zspage = find_zspage(class);
+	if (!zspage) {
+		spin_unlock(&class->lock);
+		zspage = alloc_zspage(pool, class);
+		if (!zspage) {
+			kmem_cache_free(pool->handle_cache, handle);
+			return 0;
+		}
+		spin_lock(&class->lock);
+		class->zspages++;
+		list_add(&zspage->list,
+			&class->fullness_list[ZS_ALMOST_EMPTY]);
+	}
+
+	handle->class = class;
+	handle->zspage = zspage;
+	handle->idx = obj_take(zspage, handle);
+	fix_fullness_group(class, zspage);
+	spin_unlock(&class->lock);
+
+	return (unsigned long)handle;
+}
+EXPORT_SYMBOL_GPL(zs_malloc);
+
+void zs_free(struct zs_pool *pool, unsigned long obj)
+{
+	struct zs_handle *handle = (struct zs_handle *)obj;
+	struct size_class *class = handle->class;
+	struct zspage *zspage;
+
+	spin_lock(&class->lock);
+	zspage = handle->zspage;
+	obj_put(zspage, handle->idx);
+	if (!zspage->inuse) {
+		list_del(&zspage->list);
+		free_zspage(pool, zspage);
+	} else {
+		fix_fullness_group(class, zspage);
+	}
+	spin_unlock(&class->lock);
+
+	kmem_cache_free(pool->handle_cache, handle);
+}
+EXPORT_SYMBOL_GPL(zs_free);
+
+/**
+ * zs_map_object - Get a pointer to the payload of an object.
+ * @pool: pool the object belongs to
+ * @obj: handle returned by zs_malloc()
+ * @mm: whether the payload is read, written or both
+ *
+ * Disables preemption until the matching zs_unmap_object(). For
+ * ZS_MM_WO the returned buffer may hold stale data.
+ */
+void *zs_map_object(struct zs_pool *pool, unsigned long obj,
+			enum zs_mapmode mm)
+{
+	struct zs_handle *handle = (struct zs_handle *)obj;
+	struct zspage *zspage = handle->zspage;
+	unsigned int size = zspage->class->size;
+	struct zs_map_area *area;
+	struct page *page;
+	unsigned int offset, first;
+	void *addr;
+
+	obj_location(zspage, handle->idx, &page, &offset);
+	area = get_cpu_ptr(pool->map_area);
+	area->mm = mm;
+
+	if (offset + size <= PAGE_SIZE) {
+		area->bounced = false;
+		area->vaddr = kmap_atomic(page, KM_USER0);
+		return area->vaddr + offset + ZS_HANDLE_SIZE;
+	}
+
+	area->bounced = true;
+	if (mm != ZS_MM_WO) {
+		unsigned long off = (unsigned long)handle->idx * size;
+
+		first = PAGE_SIZE - offset;
+		addr = kmap_atomic(page, KM_USER0);
+		memcpy(area->buf, addr + offset, first);
+		kunmap_atomic(addr, KM_USER0);
+
+		page = zspage->pages[(off >> PAGE_SHIFT) + 1];
+		addr = kmap_atomic(page, KM_USER0);
+		memcpy(area->buf + first, addr, size - first);
+		kunmap_atomic(addr, KM_USER0);
+	}
+
+	return area->buf + ZS_HANDLE_SIZE;
+}
+EXPORT_SYMBOL_GPL(zs_map_object);
+
+void zs_unmap_object(struct zs_pool *pool, unsigned long obj)
+{
+	struct zs_handle *handle = (struct zs_handle *)obj;
+	struct zspage *zspage = handle->zspage;
+	unsigned int size = zspage->class->size;
+	struct zs_map_area *area = this_cpu_ptr(pool->map_area);
+	struct page *page;
+	unsigned int offset, first;
+	unsigned long off;
+	void *addr;
+
+	if (!area->bounced) {
+		kunmap_atomic(area->vaddr, KM_USER0);
+		goto out;
+	}
+
+	if (area->mm == ZS_MM_RO)
+		goto out;
+
+	/* Write back everything but the header, which we never touched */
+	obj_location(zspage, handle->idx, &page, &offset);
+	first = PAGE_SIZE - offset;
+	addr = kmap_atomic(page, KM_USER0);
+	memcpy(addr + offset + ZS_HANDLE_SIZE, area->buf + ZS_HANDLE_SIZE,
+		first - ZS_HANDLE_SIZE);
+	kunmap_atomic(addr, KM_USER0);
+
+	off = (unsigned long)handle->idx * size;
+	page = zspage->pages[(off >> PAGE_SHIFT) + 1];
+	addr = kmap_atomic(page, KM_USER0);
+	memcpy(addr, area->buf + first, size - first);
+	kunmap_atomic(addr, KM_USER0);
+
+out:
+	put_cpu_ptr(pool->map_area);
+}
+EXPORT_SYMBOL_GPL(zs_unmap_object);
+
+/* Copy one object between zspages of the same class, page by page */
+static void obj_copy(struct zspage *dst, unsigned int didx,
+			struct zspage *src, unsigned int sidx)
+{
+	unsigned int size = src->class->size;
+	unsigned long s_off = (unsigned long)sidx * size;
+	unsigned long d_off = (unsigned long)didx * size;
+
+	while (size) {
+		unsigned int s_poff = s_off & ~PAGE_MASK;
+		unsigned int d_poff = d_off & ~PAGE_MASK;
+		unsigned int len = size;
+		void *s_addr, *d_addr;
+
+		len = min_t(unsigned int, len, PAGE_SIZE - s_poff);
+		len = min_t(unsigned int, len, PAGE_SIZE - d_poff);
+
+		s_addr = kmap_atomic(src->pages[s_off >> PAGE_SHIFT], KM_USER0);
+		d_addr = kmap_atomic(dst->pages[d_off >> PAGE_SHIFT], KM_USER1);
+		memcpy(d_addr + d_poff, s_addr + s_poff, len);
+		kunmap_atomic(d_addr, KM_USER1);
+		kunmap_atomic(s_addr, KM_USER0);
+
+		s_off += len;
+		d_off += len;
+		size -= len;
+	}
+}
+
+static unsigned long zs_can_compact(struct size_class *class)
+{
+	unsigned long needed;
+
+	needed = DIV_ROUND_UP(class->obj_used, class->objs_per_zspage);
+	return class->zspages > needed ? class->zspages - needed : 0;
+}
+
+/* The emptiest zspage is the cheapest one to drain */
+static struct zspage *isolate_source_zspage(struct size_class *class)
+{
+	struct zspage *zspage, *src = NULL;
+
+	list_for_each_entry(zspage, &class->fullness_list[ZS_ALMOST_EMPTY],
+			list) {
+		if (!src || zspage->inuse < src->inuse)
+			src = zspage;
+	}
+	if (src)
+		list_del_init(&src->list);
+
+	return src;
+}
+
+/*
+ * Moves every object out of @src into the fullest other zspages of
+ * the class. Returns true if @src was drained and freed.
+ */
+static bool migrate_zspage(struct zs_pool *pool, struct size_class *class,
+			struct zspage *src)
+{
+	unsigned int idx;
+
+	for (idx = 0; idx < class->objs_per_zspage && src->inuse; idx++) {
+		struct zs_handle *handle;
+		struct zspage *dst;
+		unsigned long hdr;
+
+		hdr = obj_get_header(src, idx);
+		if (hdr & ZS_OBJ_FREE)
+			continue;
+
+		dst = find_zspage(class);
+		if (!dst)
+			break;
+
+		handle = (struct zs_handle *)hdr;
+		handle->idx = obj_take(dst, handle);
+		handle->zspage = dst;
+		obj_copy(dst, handle->idx, src, idx);
+		obj_put(src, idx);
+		fix_fullness_group(class, dst);
+	}
+
+	if (!src->inuse) {
+		free_zspage(pool, src);
+		return true;
+	}
+
+	src->fullness = get_fullness_group(src);
+	list_add(&src->list, &class->fullness_list[src->fullness]);
+	return false;
+}
+
+/**
+ * zs_compact - Move objects around to free sparsely used zspages.
+ * @pool: pool to compact
+ *
+ * Must not run concurrently with zs_map_object() on the same pool,
+ * since the mapped object could move underneath the caller. zs_free()
+ * is fine. Returns the number of pages released.
+ */
+unsigned long zs_compact(struct zs_pool *pool)
+{
+	unsigned long freed = 0;
+	int i;
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+
+		spin_lock(&class->lock);
+		while (zs_can_compact(class)) {
+			struct zspage *src = isolate_source_zspage(class);
+
+			if (!src)
+				break;
+			if (!migrate_zspage(pool, class, src))
+				break;
+			freed += class->pages_per_zspage;
+
+			spin_unlock(&class->lock);
+			cond_resched();
+			spin_lock(&class->lock);
+		}
+		spin_unlock(&class->lock);
+	}
+
+	return freed;
+}
+EXPORT_SYMBOL_GPL(zs_compact);
+
+u64 zs_get_total_size_bytes(struct zs_pool *pool)
+{
+	return (u64)atomic_long_read(&pool->pages_allocated) << PAGE_SHIFT;
+}
+EXPORT_SYMBOL_GPL(zs_get_total_size_bytes);
+
+/*
+ * Fills in stats for size class @index. Returns -EINVAL once @index
+ * runs past the last class, which makes it easy to iterate.
+ */
+int zs_get_class_stats(struct zs_pool *pool, int index,
+			struct zs_class_stats *stats)
+{
+	struct size_class *class;
+
+	if (index < 0 || index >= ZS_SIZE_CLASSES)
+		return -EINVAL;
+
+	class = &pool->size_class[index];
+	spin_lock(&class->lock);
+	stats->size = class->size;
+	stats->pages_per_zspage = class->pages_per_zspage;
+	stats->objs_per_zspage = class->objs_per_zspage;
+	stats->zspages = class->zspages;
+	stats->obj_used = class->obj_used;
+	spin_unlock(&class->lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(zs_get_class_stats);
@@ -0,0 +1,56 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * Size class based object allocator for compressed pages. Objects of
+ * similar size share "zspages" of up to ZS_MAX_PAGES_PER_ZSPAGE pages
+ * and may straddle page boundaries, so little memory is lost to
+ * internal fragmentation. Objects are referred to by opaque handles,
+ * which lets zs_compact() move them to free whole zspages.
+ *
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifndef _ZS_MALLOC_H_
+#define _ZS_MALLOC_H_
+
+#include <linux/types.h>
+
+struct zs_pool;
+
+enum zs_mapmode {
+	ZS_MM_RW,	/* read back on map, write back on unmap */
+	ZS_MM_RO,	/* read back on map only */
+	ZS_MM_WO,	/* write back on unmap only */
+};
+
+struct zs_class_stats {
+	unsigned int size;		/* object size of this class */
+	unsigned int pages_per_zspage;
+	unsigned int objs_per_zspage;
+	unsigned long zspages;		/* zspages allocated */
+	unsigned long obj_used;		/* objects in use */
+};
+
+struct zs_pool *zs_create_pool(gfp_t flags);
+void zs_destroy_pool(struct zs_pool *pool);
+
+unsigned long zs_malloc(struct zs_pool *pool, size_t size);
+void zs_free(struct zs_pool *pool, unsigned long handle);
+
+/*
+ * Mappings are per-CPU and atomic: no sleeping between map and unmap,
+ * and at most one object mapped at a time. Callers must serialize
+ * mapping against zs_compact(); zs_malloc() and zs_free() need no
+ * outside locking.
+ */
+void *zs_map_object(struct zs_pool *pool, unsigned long handle,
+			enum zs_mapmode mm);
+void zs_unmap_object(struct zs_pool *pool, unsigned long handle);
+
+unsigned long zs_compact(struct zs_pool *pool);
+
+u64 zs_get_total_size_bytes(struct zs_pool *pool);
+int zs_get_class_stats(struct zs_pool *pool, int index,
+			struct zs_class_stats *stats);
+
+#endif
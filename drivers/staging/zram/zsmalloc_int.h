@@ -0,0 +1,88 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifndef _ZS_MALLOC_INT_H_
+#define _ZS_MALLOC_INT_H_
+
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/types.h>
+
+/* Each allocated object starts with a back-reference to its handle */
+#define ZS_HANDLE_SIZE		sizeof(unsigned long)
+
+#define ZS_MIN_ALLOC_SIZE	32
+#define ZS_MAX_ALLOC_SIZE	PAGE_SIZE
+#define ZS_SIZE_CLASS_DELTA	(PAGE_SIZE >> 8)
+#define ZS_SIZE_CLASSES		((ZS_MAX_ALLOC_SIZE - ZS_MIN_ALLOC_SIZE) / \
+				 ZS_SIZE_CLASS_DELTA + 1)
+
+#define ZS_MAX_PAGES_PER_ZSPAGE	4
+
+/* Free objects hold the index of the next free one, tagged with bit 0 */
+#define ZS_OBJ_FREE		1UL
+#define ZS_OBJ_END		(~0UL >> 1)
+
+/* zspages above this fraction of used objects count as almost full */
+#define ZS_ALMOST_FULL_PERCENT	75
+
+enum zs_fullness_group {
+	ZS_ALMOST_EMPTY,
+	ZS_ALMOST_FULL,
+	ZS_FULL,
+	ZS_NR_FULLNESS,
+};
+
+struct size_class;
+
+struct zspage {
+	struct list_head list;
+	struct size_class *class;
+	struct page *pages[ZS_MAX_PAGES_PER_ZSPAGE];
+	unsigned long freeobj;		/* first free object or ZS_OBJ_END */
+	unsigned int inuse;
+	enum zs_fullness_group fullness;
+};
+
+/*
+ * What a handle points to. The class never changes for the life of an
+ * object, which lets zs_free() find the right lock before looking at
+ * fields that compaction may be rewriting.
+ */
+struct zs_handle {
+	struct size_class *class;
+	struct zspage *zspage;
+	unsigned int idx;
+};
+
+struct size_class {
+	spinlock_t lock;
+	unsigned int size;
+	unsigned int pages_per_zspage;
+	unsigned int objs_per_zspage;
+	struct list_head fullness_list[ZS_NR_FULLNESS];
+
+	unsigned long zspages;
+	unsigned long obj_used;
+};
+
+/* Per-CPU state for the object currently mapped */
+struct zs_map_area {
+	char *buf;		/* bounce buffer for objects that straddle */
+	void *vaddr;		/* kmap address when not bounced */
+	enum zs_mapmode mm;
+	bool bounced;
+};
+
+struct zs_pool {
+	struct size_class size_class[ZS_SIZE_CLASSES];
+	struct zs_map_area __percpu *map_area;
+	struct kmem_cache *handle_cache;
+	gfp_t flags;
+	atomic_long_t pages_allocated;
+};
+
+#endif
@@ -38,6 +38,8 @@
 #include <linux/debugfs.h>
 #include <linux/slab.h>
 #include <linux/workqueue.h>
+#include <linux/seq_file.h>
+#include <linux/timer.h>
 #include <linux/tegra_uart.h>
 
 #include <mach/dma.h>
@@ -82,6 +84,25 @@ const int dma_req_sel[] = {
 #define TEGRA_UART_CLOCK_OFF 2
 #define TEGRA_UART_SUSPEND   3
 
+/* Window over which the Rx data rate is measured */
+#define TEGRA_UART_RX_RATE_WINDOW	(HZ / 10)
+
+/*
+ * Above this Rx rate (bytes/s) the DMA ring is drained from a timer
+ * every rx_flush_us instead of on every end-of-data interrupt, so a
+ * stream of small packets (A2DP over the BT HCI UART) costs one wakeup
+ * per period rather than an interrupt and a DMA restart per packet.  The
+ * timer hands back to interrupts after one period with no data.
+ * 0 disables coalescing.
+ */
+static unsigned int rx_coalesce_rate = 32768;
+module_param(rx_coalesce_rate, uint, 0644);
+MODULE_PARM_DESC(rx_coalesce_rate, "Rx bytes/s above which Rx is polled");
+
+static unsigned int rx_flush_us = 10000;
+module_param(rx_flush_us, uint, 0644);
+MODULE_PARM_DESC(rx_flush_us, "Rx poll period and idle timeout in us");
+
 /* Tx fifo trigger level setting in tegra uart is in
  * reverse way then conventional uart */
 #define TEGRA_UART_TX_TRIG_16B 0x00
@@ -89,6 +110,15 @@ const int dma_req_sel[] = {
 #define TEGRA_UART_TX_TRIG_4B  0x20
 #define TEGRA_UART_TX_TRIG_1B  0x30
 
+struct tegra_uart_rx_stats {
+	u64			bytes;
+	unsigned long		irqs;		/* Rx interrupts, DMA ones too */
+	unsigned long		flush_ticks;	/* coalescing timer runs */
+	unsigned long		dma_restarts;
+	unsigned long		pushes;		/* tty flip buffer pushes */
+	unsigned long		coalesce;	/* times Rx went to polling */
+};
+
 struct tegra_uart_port {
 	struct uart_port	uport;
 	char			port_name[32];
@@ -124,6 +154,16 @@ struct tegra_uart_port {
 	int			uart_state;
 	bool			rx_timeout;
 	int			rx_in_progress;
+
+	/* bytes of rx_dma_req already handed to the tty layer */
+	int			rx_dma_tail;
+	bool			rx_coalesce;
+	struct timer_list	rx_flush_timer;
+	unsigned long		rx_window_start;
+	unsigned int		rx_window_bytes;
+	unsigned int		rx_rate;	/* bytes/s, last window */
+	struct tegra_uart_rx_stats rx_stats;
+	struct dentry		*debugfs;
 };
 
 static void tegra_set_baudrate(struct tegra_uart_port *t, unsigned int baud);
@@ -271,9 +311,96 @@ static int tegra_start_dma_rx(struct tegra_uart_port *t)
 		dev_err(t->uport.dev, "Could not enqueue Rx DMA req\n");
 		return -EINVAL;
 	}
+	t->rx_dma_tail = 0;
 	return 0;
 }
 
+static void tegra_uart_rx_account(struct tegra_uart_port *t, int bytes)
+{
+	unsigned long elapsed = jiffies - t->rx_window_start;
+
+	t->uport.icount.rx += bytes;
+	t->rx_stats.bytes += bytes;
+	t->rx_window_bytes += bytes;
+
+	if (elapsed >= TEGRA_UART_RX_RATE_WINDOW) {
+		t->rx_rate = t->rx_window_bytes * HZ / elapsed;
+		t->rx_window_bytes = 0;
+		t->rx_window_start = jiffies;
+	}
+}
+
+/*
+ * Hand what the DMA has written to the ring since the last call to the
+ * tty layer, leaving the DMA running.  Bytes that have not made up a
+ * whole word yet stay in the FIFO.  Lock already taken.
+ */
+static int tegra_uart_rx_dma_sync(struct tegra_uart_port *t)
+{
+	struct tty_struct *tty = t->uport.state->port.tty;
+	int count, copied;
+
+	count = tegra_dma_get_transfer_count(t->rx_dma, &t->rx_dma_req);
+	count -= t->rx_dma_tail;
+	if (count <= 0)
+		return 0;
+
+	dma_sync_single_range_for_cpu(t->uport.dev, t->rx_dma_req.dest_addr,
+		t->rx_dma_tail, count, DMA_FROM_DEVICE);
+	copied = tty_insert_flip_string(tty,
+		(unsigned char *)t->rx_dma_req.virt_addr + t->rx_dma_tail,
+		count);
+	if (copied != count)
+		dev_err(t->uport.dev, "Not able to copy uart data "
+			"to tty layer Req %d and coped %d\n", count, copied);
+	t->rx_dma_tail += count;
+	tegra_uart_rx_account(t, count);
+	return count;
+}
+
+static bool tegra_uart_rx_should_coalesce(struct tegra_uart_port *t)
+{
+	/* a rate measured before a pause says nothing about now */
+	return rx_coalesce_rate && t->rx_rate >= rx_coalesce_rate &&
+		time_before(jiffies,
+			    t->rx_window_start + 2 * TEGRA_UART_RX_RATE_WINDOW);
+}
+
+static void tegra_uart_rx_flush_timer(unsigned long data)
+{
+	struct tegra_uart_port *t = (struct tegra_uart_port *)data;
+	struct uart_port *u = &t->uport;
+	unsigned long flags;
+	unsigned char ier;
+
+	spin_lock_irqsave(&u->lock, flags);
+	if (!t->rx_coalesce || !t->rx_in_progress)
+		goto out;
+
+	t->rx_stats.flush_ticks++;
+	if (tegra_uart_rx_dma_sync(t) && tegra_uart_rx_should_coalesce(t)) {
+		t->rx_stats.pushes++;
+		mod_timer(&t->rx_flush_timer,
+			  jiffies + usecs_to_jiffies(rx_flush_us));
+		spin_unlock_irqrestore(&u->lock, flags);
+		tty_flip_buffer_push(u->state->port.tty);
+		return;
+	}
+
+	/*
+	 * The stream paused or slowed down: collect what is left in the
+	 * FIFO and go back to the end-of-data interrupt.
+	 */
+	do_handle_rx_dma(t);
+	t->rx_coalesce = false;
+	ier = t->ier_shadow;
+	ier |= UART_IER_RLSI | UART_IER_RTOIE | UART_IER_EORD;
+	t->ier_shadow = ier;
+	uart_writeb(t, ier, UART_IER);
+out:
+	spin_unlock_irqrestore(&u->lock, flags);
+}
+
 static void tegra_rx_dma_threshold_callback(struct tegra_dma_req *req)
 {
 	struct tegra_uart_port *t = req->dev;
@@ -281,6 +408,7 @@ static void tegra_rx_dma_threshold_callback(struct tegra_dma_req *req)
 	unsigned long flags;
 
 	spin_lock_irqsave(&u->lock, flags);
+	t->rx_stats.irqs++;
 
 	do_handle_rx_dma(t);
 
@@ -304,28 +432,31 @@ static void tegra_rx_dma_complete_callback(struct tegra_dma_req *req)
 	struct tegra_uart_port *t = req->dev;
 	struct uart_port *u = &t->uport;
 	struct tty_struct *tty = u->state->port.tty;
+	int count = req->bytes_transferred - t->rx_dma_tail;
 	int copied;
 
 	/* If we are here, DMA is stopped */
 
 	dev_dbg(t->uport.dev, "%s: %d %d\n", __func__, req->bytes_transferred,
 		req->status);
-	if (req->bytes_transferred) {
-		t->uport.icount.rx += req->bytes_transferred;
+	/* The part before rx_dma_tail went up while the DMA was running */
+	if (count > 0) {
+		tegra_uart_rx_account(t, count);
 		dma_sync_single_for_cpu(t->uport.dev, req->dest_addr,
 				req->size, DMA_FROM_DEVICE);
 		copied = tty_insert_flip_string(tty,
-			((unsigned char *)(req->virt_addr)),
-			req->bytes_transferred);
-		if (copied != req->bytes_transferred) {
+			((unsigned char *)(req->virt_addr)) + t->rx_dma_tail,
+			count);
+		if (copied != count) {
 			WARN_ON(1);
 			dev_err(t->uport.dev, "Not able to copy uart data "
 				"to tty layer Req %d and coped %d\n",
-				req->bytes_transferred, copied);
+				count, copied);
 		}
 		dma_sync_single_for_device(t->uport.dev, req->dest_addr,
 				req->size, DMA_TO_DEVICE);
 	}
+	t->rx_dma_tail = req->bytes_transferred;
 
 	do_handle_rx_pio(t);
 
@@ -335,6 +466,7 @@ static void tegra_rx_dma_complete_callback(struct tegra_dma_req *req)
 
 	spin_unlock(&u->lock);
 	tty_flip_buffer_push(u->state->port.tty);
+	t->rx_stats.pushes++;
 	spin_lock(&u->lock);
 }
 
@@ -346,6 +478,8 @@ static void do_handle_rx_dma(struct tegra_uart_port *t)
 		set_rts(t, false);
 	tegra_dma_dequeue_req(t->rx_dma, &t->rx_dma_req);
 	tty_flip_buffer_push(u->state->port.tty);
+	t->rx_stats.pushes++;
+	t->rx_stats.dma_restarts++;
 	/* enqueue the request again */
 	tegra_start_dma_rx(t);
 	if (t->rts_active)
@@ -540,9 +674,30 @@ static irqreturn_t tegra_uart_isr(int irq, void *data)
 		iir = uart_readb(t, UART_IIR);
 		if (iir & UART_IIR_NO_INT) {
 			if (likely(t->use_rx_dma) && is_rx_int) {
-				do_handle_rx_dma(t);
+				t->rx_stats.irqs++;
+				tegra_uart_rx_dma_sync(t);
+
+				/*
+				 * Stopping the DMA is only needed to pick up
+				 * bytes left in the FIFO short of a word.
+				 */
+				if (uart_readb(t, UART_LSR) & UART_LSR_DR) {
+					do_handle_rx_dma(t);
+				} else {
+					t->rx_stats.pushes++;
+					spin_unlock_irqrestore(&u->lock, flags);
+					tty_flip_buffer_push(u->state->port.tty);
+					spin_lock_irqsave(&u->lock, flags);
+				}
 
-				if (t->rx_in_progress) {
+				if (t->rx_in_progress &&
+				    tegra_uart_rx_should_coalesce(t)) {
+					/* leave Rx interrupts off, poll */
+					t->rx_coalesce = true;
+					t->rx_stats.coalesce++;
+					mod_timer(&t->rx_flush_timer, jiffies +
+						usecs_to_jiffies(rx_flush_us));
+				} else if (t->rx_in_progress) {
 					ier = t->ier_shadow;
 					ier |= (UART_IER_RLSI | UART_IER_RTOIE |
 								UART_IER_EORD);
@@ -609,6 +764,9 @@ static void tegra_stop_rx(struct uart_port *u)
 	if (t->rts_active)
 		set_rts(t, false);
 
+	/* the flush timer sees this and stops */
+	t->rx_coalesce = false;
+
 	if (t->rx_in_progress) {
 		wait_sym_time(t, 1); /* wait a character interval */
 
@@ -723,6 +881,10 @@ static int tegra_uart_hw_init(struct tegra_uart_port *t)
 	udelay(100);
 
 	t->rx_in_progress = 0;
+	t->rx_coalesce = false;
+	t->rx_rate = 0;
+	t->rx_window_bytes = 0;
+	t->rx_window_start = jiffies;
 
 	/*
 	 * Set the trigger level
@@ -920,6 +1082,8 @@ static void tegra_shutdown(struct uart_port *u)
 	t = container_of(u, struct tegra_uart_port, uport);
 	dev_vdbg(u->dev, "+tegra_shutdown\n");
 
+	t->rx_coalesce = false;
+	del_timer_sync(&t->rx_flush_timer);
 	tegra_uart_hw_deinit(t);
 
 	t->rx_in_progress = 0;
@@ -1401,6 +1565,44 @@ static struct uart_driver tegra_uart_driver = {
 	.nr		= 5,
 };
 
+static int tegra_uart_rx_stats_show(struct seq_file *s, void *data)
+{
+	struct tegra_uart_port *t = s->private;
+	struct tegra_uart_rx_stats st;
+	unsigned long flags, kb, per_kb;
+
+	spin_lock_irqsave(&t->uport.lock, flags);
+	st = t->rx_stats;
+	spin_unlock_irqrestore(&t->uport.lock, flags);
+
+	kb = max_t(unsigned long, st.bytes >> 10, 1);
+	seq_printf(s, "rx_bytes: %llu\n", st.bytes);
+	seq_printf(s, "rx_rate: %u B/s%s\n", t->rx_rate,
+		   t->rx_coalesce ? " (polling)" : "");
+	per_kb = st.irqs * 100 / kb;
+	seq_printf(s, "irqs: %lu (%lu.%02lu/KB)\n", st.irqs,
+		   per_kb / 100, per_kb % 100);
+	per_kb = (st.irqs + st.flush_ticks) * 100 / kb;
+	seq_printf(s, "flush_ticks: %lu (wakeups %lu.%02lu/KB)\n",
+		   st.flush_ticks, per_kb / 100, per_kb % 100);
+	seq_printf(s, "dma_restarts: %lu\n", st.dma_restarts);
+	seq_printf(s, "pushes: %lu\n", st.pushes);
+	seq_printf(s, "coalesce: %lu\n", st.coalesce);
+	return 0;
+}
+
+static int tegra_uart_rx_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tegra_uart_rx_stats_show, inode->i_private);
+}
+
+static const struct file_operations tegra_uart_rx_stats_fops = {
+	.open		= tegra_uart_rx_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int tegra_uart_probe(struct platform_device *pdev)
 {
 	struct tegra_uart_port *t;
@@ -1448,6 +1650,9 @@ static int tegra_uart_probe(struct platform_device *pdev)
 
 	u->regshift = 2;
 
+	setup_timer(&t->rx_flush_timer, tegra_uart_rx_flush_timer,
+		    (unsigned long)t);
+
 	t->clk = clk_get(&pdev->dev, NULL);
 	if (IS_ERR_OR_NULL(t->clk)) {
 		dev_err(&pdev->dev, "Couldn't get the clock\n");
@@ -1476,6 +1681,8 @@ static int tegra_uart_probe(struct platform_device *pdev)
 			goto rx_dma_buff_fail;
 		}
 	}
+	t->debugfs = debugfs_create_file(name, S_IRUGO, NULL, t,
+					 &tegra_uart_rx_stats_fops);
 	return ret;
 
 rx_dma_buff_fail:
@@ -1497,6 +1704,7 @@ static int __devexit tegra_uart_remove(struct platform_device *pdev)
 		pr_err("Invalid Uart instance (%d)\n", pdev->id);
 
 	u = &t->uport;
+	debugfs_remove(t->debugfs);
 	uart_remove_one_port(&tegra_uart_driver, u);
 
 	tegra_uart_free_rx_dma_buffer(t);
@@ -24,13 +24,37 @@
 #include <linux/interrupt.h>
 #include <linux/sched.h>
 #include <linux/types.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/device.h>
 #include <linux/miscdevice.h>
+#include <linux/highmem.h>
+#include <linux/pipe_fs_i.h>
+#include <linux/splice.h>
 
 #define ADB_BULK_BUFFER_SIZE           4096
 
 /* number of tx requests to allocate */
 #define TX_REQ_MAX 4
+#define TX_REQS_LIMIT 32
+
+/* request size and tx queue depth, applied when the function is bound;
+ * if the larger buffers cannot be allocated we fall back to the defaults
+ */
+static unsigned int adb_req_len = 16384;
+module_param(adb_req_len, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(adb_req_len, "size of each bulk request");
+
+static unsigned int adb_tx_reqs = 8;
+module_param(adb_tx_reqs, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(adb_tx_reqs, "number of bulk IN requests");
+
+/* pipe buffers at least this long are sent from their own page by
+ * splice(), shorter ones are packed into the request buffers
+ */
+static unsigned int adb_gift_min = 2048;
+module_param(adb_gift_min, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(adb_gift_min, "smallest spliced buffer sent without a copy");
 
 static const char adb_shortname[] = "android_adb";
 
@@ -55,6 +79,13 @@ struct adb_dev {
 	wait_queue_head_t write_wq;
 	struct usb_request *rx_req;
 	int rx_done;
+	unsigned req_len;
+
+	/* per session (open to release) totals */
+	ktime_t session_start;
+	u64 rx_bytes;
+	u64 tx_bytes;
+	u64 tx_gifted;
 };
 
 static struct usb_interface_descriptor adb_interface_desc = {
@@ -194,6 +225,17 @@ struct usb_request *adb_req_get(struct adb_dev *dev, struct list_head *head)
 	return req;
 }
 
+/* IN requests keep their own buffer in req->context; a spliced page lent
+ * to the request is released and the buffer restored on completion
+ */
+static void adb_req_return_page(struct usb_request *req)
+{
+	if (req->buf != req->context) {
+		put_page(virt_to_page(req->buf));
+		req->buf = req->context;
+	}
+}
+
 static void adb_complete_in(struct usb_ep *ep, struct usb_request *req)
 {
 	struct adb_dev *dev = _adb_dev;
@@ -201,6 +243,8 @@ static void adb_complete_in(struct usb_ep *ep, struct usb_request *req)
 	if (req->status != 0)
 		dev->error = 1;
 
+	adb_req_return_page(req);
+
 	adb_req_put(dev, &dev->tx_idle, req);
 
 	wake_up(&dev->write_wq);
@@ -224,6 +268,7 @@ static int adb_create_bulk_endpoints(struct adb_dev *dev,
 	struct usb_composite_dev *cdev = dev->cdev;
 	struct usb_request *req;
 	struct usb_ep *ep;
+	unsigned tx_reqs;
 	int i;
 
 	DBG(cdev, "create_bulk_endpoints dev: %p\n", dev);
@@ -247,23 +292,36 @@ static int adb_create_bulk_endpoints(struct adb_dev *dev,
 	dev->ep_out = ep;
 
 	/* now allocate requests for our endpoints */
-	req = adb_request_new(dev->ep_out, ADB_BULK_BUFFER_SIZE);
+	dev->req_len = max_t(unsigned, adb_req_len, ADB_BULK_BUFFER_SIZE);
+	tx_reqs = clamp_t(unsigned, adb_tx_reqs, 2, TX_REQS_LIMIT);
+retry_alloc:
+	req = adb_request_new(dev->ep_out, dev->req_len);
 	if (!req)
-		goto fail;
+		goto fallback;
 	req->complete = adb_complete_out;
 	dev->rx_req = req;
 
-	for (i = 0; i < TX_REQ_MAX; i++) {
-		req = adb_request_new(dev->ep_in, ADB_BULK_BUFFER_SIZE);
+	for (i = 0; i < tx_reqs; i++) {
+		req = adb_request_new(dev->ep_in, dev->req_len);
 		if (!req)
-			goto fail;
+			goto fallback;
 		req->complete = adb_complete_in;
+		req->context = req->buf;
 		adb_req_put(dev, &dev->tx_idle, req);
 	}
 
 	return 0;
 
-fail:
+fallback:
+	adb_request_free(dev->rx_req, dev->ep_out);
+	dev->rx_req = NULL;
+	while ((req = adb_req_get(dev, &dev->tx_idle)))
+		adb_request_free(req, dev->ep_in);
+	if (dev->req_len != ADB_BULK_BUFFER_SIZE) {
+		dev->req_len = ADB_BULK_BUFFER_SIZE;
+		tx_reqs = TX_REQ_MAX;
+		goto retry_alloc;
+	}
 	printk(KERN_ERR "adb_bind() could not allocate requests\n");
 	return -1;
 }
@@ -280,8 +338,12 @@ static ssize_t adb_read(struct file *fp, char __user *buf,
 	if (!_adb_dev)
 		return -ENODEV;
 
-	if (count > ADB_BULK_BUFFER_SIZE)
-		return -EINVAL;
+	/* the request is sized by the reader, not read ahead: the host
+	 * sends no zero length packet after a payload that fills its last
+	 * packet, so a longer request would wait for the next message
+	 */
+	if (count > dev->req_len)
+		count = dev->req_len;
 
 	if (adb_lock(&dev->read_excl))
 		return -EBUSY;
@@ -333,6 +395,9 @@ requeue_req:
 		xfer = (req->actual < count) ? req->actual : count;
 		if (copy_to_user(buf, req->buf, xfer))
 			r = -EFAULT;
+		else
+			r = xfer;
+		dev->rx_bytes += xfer;
 
 	} else
 		r = -EIO;
@@ -376,8 +441,8 @@ static ssize_t adb_write(struct file *fp, const char __user *buf,
 		}
 
 		if (req != 0) {
-			if (count > ADB_BULK_BUFFER_SIZE)
-				xfer = ADB_BULK_BUFFER_SIZE;
+			if (count > dev->req_len)
+				xfer = dev->req_len;
 			else
 				xfer = count;
 			if (copy_from_user(req->buf, buf, xfer)) {
@@ -396,6 +461,7 @@ static ssize_t adb_write(struct file *fp, const char __user *buf,
 
 			buf += xfer;
 			count -= xfer;
+			dev->tx_bytes += xfer;
 
 			/* zero this so we don't try to free it on error exit */
 			req = 0;
@@ -410,6 +476,151 @@ static ssize_t adb_write(struct file *fp, const char __user *buf,
 	return r;
 }
 
+struct adb_splice_state {
+	struct adb_dev *dev;
+	struct usb_request *req;	/* request being packed, if any */
+};
+
+static struct usb_request *adb_get_tx_req(struct adb_dev *dev, int *err)
+{
+	struct usb_request *req = NULL;
+
+	*err = wait_event_interruptible(dev->write_wq,
+		(req = adb_req_get(dev, &dev->tx_idle)) || dev->error);
+	if (!*err && !req)
+		*err = -EIO;
+	return req;
+}
+
+static int adb_queue_tx(struct adb_dev *dev, struct usb_request *req)
+{
+	int ret;
+
+	ret = usb_ep_queue(dev->ep_in, req, GFP_ATOMIC);
+	if (ret < 0) {
+		pr_debug("adb_splice_write: xfer error %d\n", ret);
+		adb_req_return_page(req);
+		adb_req_put(dev, &dev->tx_idle, req);
+		dev->error = 1;
+		return -EIO;
+	}
+	dev->tx_bytes += req->length;
+	return 0;
+}
+
+static int adb_pipe_to_usb(struct pipe_inode_info *pipe,
+			   struct pipe_buffer *buf, struct splice_desc *sd)
+{
+	struct adb_splice_state *st = sd->u.data;
+	struct adb_dev *dev = st->dev;
+	struct usb_request *req;
+	unsigned int n;
+	void *addr;
+	int ret;
+
+	if (dev->error)
+		return -EIO;
+
+	ret = buf->ops->confirm(pipe, buf);
+	if (ret)
+		return ret;
+
+	/* lend the page itself to the controller */
+	if (!st->req && sd->len >= adb_gift_min &&
+	    !PageHighMem(buf->page)) {
+		req = adb_get_tx_req(dev, &ret);
+		if (!req)
+			return ret;
+		get_page(buf->page);
+		req->buf = page_address(buf->page) + buf->offset;
+		req->length = sd->len;
+		ret = adb_queue_tx(dev, req);
+		if (ret)
+			return ret;
+		dev->tx_gifted += sd->len;
+		return sd->len;
+	}
+
+	if (!st->req) {
+		st->req = adb_get_tx_req(dev, &ret);
+		if (!st->req)
+			return ret;
+		st->req->length = 0;
+	}
+	req = st->req;
+
+	n = min_t(unsigned int, sd->len, dev->req_len - req->length);
+	addr = buf->ops->map(pipe, buf, 1);
+	memcpy(req->buf + req->length, addr + buf->offset, n);
+	buf->ops->unmap(pipe, buf, addr);
+	req->length += n;
+
+	if (req->length == dev->req_len) {
+		st->req = NULL;
+		ret = adb_queue_tx(dev, req);
+		if (ret)
+			return ret;
+	}
+	return n;
+}
+
+static ssize_t adb_splice_write(struct pipe_inode_info *pipe, struct file *fp,
+				loff_t *ppos, size_t len, unsigned int flags)
+{
+	struct adb_dev *dev = fp->private_data;
+	struct adb_splice_state st = { .dev = dev };
+	struct splice_desc sd = {
+		.total_len = len,
+		.flags = flags,
+		.pos = *ppos,
+		.u.data = &st,
+	};
+	ssize_t r;
+	int ret;
+
+	if (!_adb_dev)
+		return -ENODEV;
+	pr_debug("adb_splice_write(%d)\n", len);
+
+	if (adb_lock(&dev->write_excl))
+		return -EBUSY;
+
+	pipe_lock(pipe);
+	r = __splice_from_pipe(pipe, &sd, adb_pipe_to_usb);
+	pipe_unlock(pipe);
+
+	/* send whatever was packed into the last request */
+	if (st.req) {
+		if (st.req->length && !dev->error) {
+			ret = adb_queue_tx(dev, st.req);
+			if (ret && r >= 0)
+				r = ret;
+		} else
+			adb_req_put(dev, &dev->tx_idle, st.req);
+	}
+
+	adb_unlock(&dev->write_excl);
+	pr_debug("adb_splice_write returning %d\n", r);
+	return r;
+}
+
+static unsigned adb_kbps(u64 bytes, s64 us)
+{
+	/* bytes per microsecond is MB/s, so this is kB/s */
+	return us > 0 ? div64_u64(bytes * 1000, us) : 0;
+}
+
+static void adb_print_session(struct adb_dev *dev)
+{
+	s64 us = ktime_us_delta(ktime_get(), dev->session_start);
+
+	pr_info("adb: session %lld ms, rx %llu bytes %u kB/s, "
+		"tx %llu bytes %u kB/s, %llu bytes without copy\n",
+		div_s64(us, 1000),
+		dev->rx_bytes, adb_kbps(dev->rx_bytes, us),
+		dev->tx_bytes, adb_kbps(dev->tx_bytes, us), dev->tx_gifted);
+}
+
 static int adb_open(struct inode *ip, struct file *fp)
 {
 	static unsigned long last_print;
@@ -442,6 +653,11 @@ static int adb_open(struct inode *ip, struct file *fp)
 	/* clear the error latch */
 	_adb_dev->error = 0;
 
+	_adb_dev->session_start = ktime_get();
+	_adb_dev->rx_bytes = 0;
+	_adb_dev->tx_bytes = 0;
+	_adb_dev->tx_gifted = 0;
+
 	adb_ready_callback();
 
 	return 0;
@@ -465,6 +681,8 @@ static int adb_release(struct inode *ip, struct file *fp)
 	if (count < 5)
 		printk(KERN_INFO "adb_release\n");
 
+	adb_print_session(_adb_dev);
+
 	adb_closed_callback();
 
 	adb_unlock(&_adb_dev->open_excl);
@@ -476,6 +694,7 @@ static struct file_operations adb_fops = {
 	.owner = THIS_MODULE,
 	.read = adb_read,
 	.write = adb_write,
+	.splice_write = adb_splice_write,
 	.open = adb_open,
 	.release = adb_release,
 };
@@ -27,7 +27,11 @@
 #include <linux/interrupt.h>
 
 #include <linux/types.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/file.h>
+#include <linux/pagemap.h>
+#include <linux/scatterlist.h>
 #include <linux/device.h>
 #include <linux/miscdevice.h>
 
@@ -39,6 +43,28 @@
 #define MTP_BULK_BUFFER_SIZE       16384
 #define INTR_BUFFER_SIZE           28
 
+/* request sizes and tx queue depth, applied when the function is bound;
+ * if the larger buffers cannot be allocated we fall back to the defaults
+ */
+static unsigned int mtp_rx_req_len = 131072;
+module_param(mtp_rx_req_len, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(mtp_rx_req_len, "size of each bulk OUT request");
+
+static unsigned int mtp_tx_req_len = 131072;
+module_param(mtp_tx_req_len, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(mtp_tx_req_len, "size of each bulk IN request");
+
+static unsigned int mtp_tx_reqs = 8;
+module_param(mtp_tx_reqs, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(mtp_tx_reqs, "number of bulk IN requests");
+
+/* send file data straight from the page cache when the udc can do
+ * scatter-gather, instead of copying it into the request buffer
+ */
+static bool mtp_zero_copy = true;
+module_param(mtp_zero_copy, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(mtp_zero_copy, "send files from the page cache");
+
 /* String IDs */
 #define INTERFACE_STRING_INDEX	0
 
@@ -49,9 +75,10 @@
 #define STATE_CANCELED              3   /* transaction canceled by host */
 #define STATE_ERROR                 4   /* error from completion routine */
 
-/* number of tx and rx requests to allocate */
+/* number of tx and rx requests to allocate, by default */
 #define TX_REQ_MAX 4
 #define RX_REQ_MAX 2
+#define TX_REQS_LIMIT 32
 #define INTR_REQ_MAX 5
 
 /* ID for Microsoft MTP OS String */
@@ -69,6 +96,15 @@
 
 static const char mtp_shortname[] = "mtp_usb";
 
+/* req->context of a tx request when the udc supports scatter-gather;
+ * sg[first] onwards hold references to page cache pages
+ */
+struct mtp_tx_sg {
+	unsigned first;
+	unsigned npages;
+	struct scatterlist sg[0];
+};
+
 struct mtp_dev {
 	struct usb_function function;
 	struct usb_composite_dev *cdev;
@@ -93,6 +129,18 @@ struct mtp_dev {
 	wait_queue_head_t intr_wq;
 	struct usb_request *rx_req[RX_REQ_MAX];
 	int rx_done;
+	unsigned rx_req_len;
+	unsigned tx_req_len;
+	unsigned tx_reqs;
+
+	/* totals for send_file and receive_file, see mtp_stats_show() */
+	struct mtp_xfer_stats {
+		unsigned files;
+		u64 bytes;
+		u64 us;		/* wall time of whole transfers */
+		u64 file_us;	/* of which in vfs_read / vfs_write */
+		unsigned last_kbps;
+	} tx_stats, rx_stats;
 
 	/* for processing MTP_SEND_FILE, MTP_RECEIVE_FILE and
 	 * MTP_SEND_FILE_WITH_HEADER ioctls on a work queue
@@ -296,6 +344,7 @@ static struct usb_request *mtp_request_new(struct usb_ep *ep, int buffer_size)
 static void mtp_request_free(struct usb_request *req, struct usb_ep *ep)
 {
 	if (req) {
+		kfree(req->context);
 		kfree(req->buf);
 		usb_ep_free_request(ep, req);
 	}
@@ -345,6 +394,21 @@ static struct usb_request
 	return req;
 }
 
+/* drop the page cache pages a tx request was sent from, if any */
+static void mtp_tx_sg_release(struct usb_request *req)
+{
+	struct mtp_tx_sg *s = req->context;
+	unsigned i;
+
+	if (!req->num_sgs)
+		return;
+	for (i = 0; i < s->npages; i++)
+		put_page(sg_page(&s->sg[s->first + i]));
+	s->npages = 0;
+	req->sg = NULL;
+	req->num_sgs = 0;
+}
+
 static void mtp_complete_in(struct usb_ep *ep, struct usb_request *req)
 {
 	struct mtp_dev *dev = _mtp_dev;
@@ -352,6 +416,8 @@ static void mtp_complete_in(struct usb_ep *ep, struct usb_request *req)
 	if (req->status != 0)
 		dev->state = STATE_ERROR;
 
+	mtp_tx_sg_release(req);
+
 	mtp_req_put(dev, &dev->tx_idle, req);
 
 	wake_up(&dev->write_wq);
@@ -388,6 +454,7 @@ static int mtp_create_bulk_endpoints(struct mtp_dev *dev,
 	struct usb_composite_dev *cdev = dev->cdev;
 	struct usb_request *req;
 	struct usb_ep *ep;
+	unsigned tx_reqs;
 	int i;
 
 	DBG(cdev, "create_bulk_endpoints dev: %p\n", dev);
@@ -429,17 +496,42 @@ static int mtp_create_bulk_endpoints(struct mtp_dev *dev,
 	dev->ep_intr = ep;
 
 	/* now allocate requests for our endpoints */
-	for (i = 0; i < TX_REQ_MAX; i++) {
-		req = mtp_request_new(dev->ep_in, MTP_BULK_BUFFER_SIZE);
-		if (!req)
-			goto fail;
+	dev->tx_req_len = max_t(unsigned, mtp_tx_req_len, MTP_BULK_BUFFER_SIZE);
+	tx_reqs = clamp_t(unsigned, mtp_tx_reqs, 2, TX_REQS_LIMIT);
+retry_tx_alloc:
+	for (i = 0; i < tx_reqs; i++) {
+		req = mtp_request_new(dev->ep_in, dev->tx_req_len);
+		if (!req) {
+			if (dev->tx_req_len == MTP_BULK_BUFFER_SIZE)
+				goto fail;
+			while ((req = mtp_req_get(dev, &dev->tx_idle)))
+				mtp_request_free(req, dev->ep_in);
+			dev->tx_req_len = MTP_BULK_BUFFER_SIZE;
+			tx_reqs = TX_REQ_MAX;
+			goto retry_tx_alloc;
+		}
 		req->complete = mtp_complete_in;
+		/* header entry, plus a partial page at each end */
+		if (cdev->gadget->sg_supported)
+			req->context = kmalloc(sizeof(struct mtp_tx_sg) +
+				(dev->tx_req_len / PAGE_SIZE + 2) *
+				sizeof(struct scatterlist), GFP_KERNEL);
 		mtp_req_put(dev, &dev->tx_idle, req);
 	}
+	dev->tx_reqs = tx_reqs;
+
+	dev->rx_req_len = max_t(unsigned, mtp_rx_req_len, MTP_BULK_BUFFER_SIZE);
+retry_rx_alloc:
 	for (i = 0; i < RX_REQ_MAX; i++) {
-		req = mtp_request_new(dev->ep_out, MTP_BULK_BUFFER_SIZE);
-		if (!req)
-			goto fail;
+		req = mtp_request_new(dev->ep_out, dev->rx_req_len);
+		if (!req) {
+			if (dev->rx_req_len == MTP_BULK_BUFFER_SIZE)
+				goto fail;
+			while (i-- > 0)
+				mtp_request_free(dev->rx_req[i], dev->ep_out);
+			dev->rx_req_len = MTP_BULK_BUFFER_SIZE;
+			goto retry_rx_alloc;
+		}
 		req->complete = mtp_complete_out;
 		dev->rx_req[i] = req;
 	}
@@ -469,7 +561,7 @@ static ssize_t mtp_read(struct file *fp, char __user *buf,
 
 	DBG(cdev, "mtp_read(%d)\n", count);
 
-	if (count > MTP_BULK_BUFFER_SIZE)
+	if (count > dev->rx_req_len)
 		return -EINVAL;
 
 	/* we will block until we're online */
@@ -589,8 +681,8 @@ static ssize_t mtp_write(struct file *fp, const char __user *buf,
 			break;
 		}
 
-		if (count > MTP_BULK_BUFFER_SIZE)
-			xfer = MTP_BULK_BUFFER_SIZE;
+		if (count > dev->tx_req_len)
+			xfer = dev->tx_req_len;
 		else
 			xfer = count;
 		if (xfer && copy_from_user(req->buf, buf, xfer)) {
@@ -627,6 +719,85 @@ static ssize_t mtp_write(struct file *fp, const char __user *buf,
 	return r;
 }
 
+static void mtp_xfer_account(struct mtp_xfer_stats *stats, int64_t bytes,
+			     ktime_t start, s64 file_us)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+
+	stats->files++;
+	stats->bytes += bytes;
+	stats->us += us;
+	stats->file_us += file_us;
+	/* bytes per microsecond is MB/s, so this is kB/s */
+	stats->last_kbps = us > 0 ? div64_u64(bytes * 1000, us) : 0;
+}
+
+/*
+ * Point a tx request at the page cache pages holding the next @len bytes
+ * of @filp rather than copying them into req->buf. The udc wants every
+ * entry but the first to start at a page boundary, so a data header goes
+ * into the tail of a page of req->buf and is only sent this way when the
+ * file offset is page aligned. Returns 0 if any page is not cached and up
+ * to date; the caller then uses vfs_read(), which also runs readahead.
+ */
+static int mtp_send_pages(struct usb_request *req, struct file *filp,
+		loff_t offset, int hdr_size, int len)
+{
+	struct mtp_tx_sg *s = req->context;
+	struct address_space *mapping = filp->f_mapping;
+	pgoff_t index = offset >> PAGE_SHIFT;
+	unsigned poff = offset & ~PAGE_MASK;
+	unsigned i, chunk, npages;
+	struct page *page;
+	void *hdr;
+
+	if (!s || !mtp_zero_copy || (hdr_size && poff) || len <= 0)
+		return 0;
+	if (!S_ISREG(mapping->host->i_mode) ||
+			offset + len > i_size_read(mapping->host))
+		return 0;
+
+	npages = DIV_ROUND_UP(poff + len, PAGE_SIZE);
+	s->first = hdr_size ? 1 : 0;
+	s->npages = 0;
+	sg_init_table(s->sg, s->first + npages);
+	if (hdr_size) {
+		hdr = (void *)PAGE_ALIGN((unsigned long)req->buf + 2 * hdr_size)
+			- hdr_size;
+		memcpy(hdr, req->buf, hdr_size);
+		sg_set_buf(&s->sg[0], hdr, hdr_size);
+	}
+
+	for (i = 0; i < npages; i++) {
+		page = find_get_page(mapping, index + i);
+		if (!page)
+			goto fail;
+		if (!PageUptodate(page)) {
+			put_page(page);
+			goto fail;
+		}
+		if (PageReadahead(page))
+			page_cache_async_readahead(mapping, &filp->f_ra, filp,
+					page, index + i, npages - i);
+
+		chunk = min_t(unsigned, len, PAGE_SIZE - poff);
+		sg_set_page(&s->sg[s->first + i], page, chunk, poff);
+		s->npages++;
+		len -= chunk;
+		poff = 0;
+	}
+
+	req->sg = s->sg;
+	req->num_sgs = s->first + npages;
+	return 1;
+
+fail:
+	for (i = 0; i < s->npages; i++)
+		put_page(sg_page(&s->sg[s->first + i]));
+	s->npages = 0;
+	return 0;
+}
+
 /* read from a local file and write to USB */
 static void send_file_work(struct work_struct *data) {
 	struct mtp_dev	*dev = container_of(data, struct mtp_dev, send_file_work);
@@ -639,6 +810,8 @@ static void send_file_work(struct work_struct *data) {
 	int xfer, ret, hdr_size;
 	int r = 0;
 	int sendZLP = 0;
+	ktime_t start = ktime_get(), t;
+	s64 file_us = 0;
 
 	/* read our parameters */
 	smp_rmb();
@@ -681,8 +854,8 @@ static void send_file_work(struct work_struct *data) {
 			break;
 		}
 
-		if (count > MTP_BULK_BUFFER_SIZE)
-			xfer = MTP_BULK_BUFFER_SIZE;
+		if (count > dev->tx_req_len)
+			xfer = dev->tx_req_len;
 		else
 			xfer = count;
 
@@ -695,7 +868,15 @@ static void send_file_work(struct work_struct *data) {
 			header->transaction_id = __cpu_to_le32(dev->xfer_transaction_id);
 		}
 
-		ret = vfs_read(filp, req->buf + hdr_size, xfer - hdr_size, &offset);
+		t = ktime_get();
+		if (mtp_send_pages(req, filp, offset, hdr_size, xfer - hdr_size)) {
+			ret = xfer - hdr_size;
+			offset += ret;
+		} else {
+			ret = vfs_read(filp, req->buf + hdr_size, xfer - hdr_size,
+				       &offset);
+		}
+		file_us += ktime_us_delta(ktime_get(), t);
 		if (ret < 0) {
 			r = ret;
 			break;
@@ -718,8 +899,14 @@ static void send_file_work(struct work_struct *data) {
 		req = 0;
 	}
 
-	if (req)
+	if (req) {
+		mtp_tx_sg_release(req);
 		mtp_req_put(dev, &dev->tx_idle, req);
+	}
+
+	if (!r)
+		mtp_xfer_account(&dev->tx_stats, offset - dev->xfer_file_offset,
+				 start, file_us);
 
 	DBG(cdev, "send_file_work returning %d\n", r);
 	/* write the result */
@@ -738,6 +925,8 @@ static void receive_file_work(struct work_struct *data)
 	int64_t count;
 	int ret, cur_buf = 0;
 	int r = 0;
+	ktime_t start = ktime_get(), t;
+	s64 file_us = 0;
 
 	/* read our parameters */
 	smp_rmb();
@@ -753,8 +942,8 @@ static void receive_file_work(struct work_struct *data)
 			read_req = dev->rx_req[cur_buf];
 			cur_buf = (cur_buf + 1) % RX_REQ_MAX;
 
-			read_req->length = (count > MTP_BULK_BUFFER_SIZE
-					? MTP_BULK_BUFFER_SIZE : count);
+			read_req->length = (count > dev->rx_req_len
+					? dev->rx_req_len : count);
 			dev->rx_done = 0;
 			ret = usb_ep_queue(dev->ep_out, read_req, GFP_KERNEL);
 			if (ret < 0) {
@@ -766,8 +955,10 @@ static void receive_file_work(struct work_struct *data)
 
 		if (write_req) {
 			DBG(cdev, "rx %p %d\n", write_req, write_req->actual);
+			t = ktime_get();
 			ret = vfs_write(filp, write_req->buf, write_req->actual,
 				&offset);
+			file_us += ktime_us_delta(ktime_get(), t);
 			DBG(cdev, "vfs_write %d\n", ret);
 			if (ret != write_req->actual) {
 				r = -EIO;
@@ -803,12 +994,41 @@ static void receive_file_work(struct work_struct *data)
 		}
 	}
 
+	if (!r)
+		mtp_xfer_account(&dev->rx_stats, offset - dev->xfer_file_offset,
+				 start, file_us);
+
 	DBG(cdev, "receive_file_work returning %d\n", r);
 	/* write the result */
 	dev->xfer_result = r;
 	smp_wmb();
 }
 
+static int mtp_print_xfer_stats(char *buf, const char *name,
+				struct mtp_xfer_stats *stats)
+{
+	return sprintf(buf, "%s: files %u bytes %llu ms %llu file_ms %llu "
+		       "last_kBps %u\n", name, stats->files, stats->bytes,
+		       div_u64(stats->us, 1000), div_u64(stats->file_us, 1000),
+		       stats->last_kbps);
+}
+
+/* for the f_mtp/stats attribute in android.c */
+static ssize_t mtp_print_stats(char *buf)
+{
+	struct mtp_dev *dev = _mtp_dev;
+	int len = 0;
+
+	if (!dev)
+		return 0;
+
+	len += sprintf(buf + len, "tx_req_len %u tx_reqs %u rx_req_len %u\n",
+		       dev->tx_req_len, dev->tx_reqs, dev->rx_req_len);
+	len += mtp_print_xfer_stats(buf + len, "send_file", &dev->tx_stats);
+	len += mtp_print_xfer_stats(buf + len, "receive_file", &dev->rx_stats);
+	return len;
+}
+
 static int mtp_send_event(struct mtp_dev *dev, struct mtp_event *event)
 {
 	struct usb_request *req= NULL;
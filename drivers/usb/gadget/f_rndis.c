@@ -76,6 +76,28 @@
  *   - MS-Windows drivers sometimes emit undocumented requests.
  */
 
+/* Multi-packet transfers.  The host is told it may pack up to
+ * rndis_ul_max_pkt_per_xfer messages into each OUT transfer; u_ether
+ * packs up to rndis_dl_max_pkt_per_xfer frames into each IN transfer of
+ * at most rndis_dl_max_xfer_size bytes, or less if the host asked for it.
+ */
+static unsigned int rndis_ul_max_pkt_per_xfer = 3;
+module_param(rndis_ul_max_pkt_per_xfer, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rndis_ul_max_pkt_per_xfer,
+	"packet messages per OUT transfer, 1 to disable");
+
+static unsigned int rndis_dl_max_pkt_per_xfer = 10;
+module_param(rndis_dl_max_pkt_per_xfer, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rndis_dl_max_pkt_per_xfer,
+	"packet messages per IN transfer, 1 to disable");
+
+static unsigned int rndis_dl_max_xfer_size = 16384;
+module_param(rndis_dl_max_xfer_size, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rndis_dl_max_xfer_size, "largest IN transfer");
+
+/* messages in a multi-packet IN transfer start on this boundary */
+#define RNDIS_DL_ALIGN		4
+
 struct f_rndis {
 	struct gether			port;
 	u8				ctrl_id, data_id;
@@ -380,9 +402,18 @@ static struct sk_buff *rndis_add_header(struct gether *port,
 	struct sk_buff *skb2;
 
 	skb2 = skb_realloc_headroom(skb, sizeof(struct rndis_packet_msg_type));
-	if (skb2)
+	if (skb2) {
 		rndis_add_hdr(skb2);
 
+		/* u_ether pads each frame of a multi-packet transfer */
+		if (port->dl_max_pkts_per_xfer > 1) {
+			struct rndis_packet_msg_type *hdr = (void *)skb2->data;
+
+			hdr->MessageLength =
+				cpu_to_le32(ALIGN(skb2->len, port->dl_align));
+		}
+	}
+
 	dev_kfree_skb_any(skb);
 	return skb2;
 }
@@ -461,6 +492,10 @@ static void rndis_command_complete(struct usb_ep *ep, struct usb_request *req)
 	if (status < 0)
 		pr_err("RNDIS command error %d, %d/%d\n",
 			status, req->actual, req->length);
+
+	/* learnt from REMOTE_NDIS_INITIALIZE_MSG */
+	rndis->port.dl_host_max_xfer =
+		rndis_get_dl_max_xfer_size(rndis->config);
 //	spin_unlock(&dev->lock);
 }
 
@@ -773,6 +808,7 @@ rndis_bind(struct usb_configuration *c, struct usb_function *f)
 
 	rndis_set_param_medium(rndis->config, NDIS_MEDIUM_802_3, 0);
 	rndis_set_host_mac(rndis->config, rndis->ethaddr);
+	rndis_set_max_pkt_xfer(rndis->config, rndis_ul_max_pkt_per_xfer);
 
 	if (rndis_set_param_vendor(rndis->config, rndis->vendorID,
 				   rndis->manufacturer))
@@ -913,6 +949,10 @@ rndis_bind_config(struct usb_configuration *c, u8 ethaddr[ETH_ALEN],
 	rndis->port.header_len = sizeof(struct rndis_packet_msg_type);
 	rndis->port.wrap = rndis_add_header;
 	rndis->port.unwrap = rndis_rm_hdr;
+	rndis->port.ul_max_pkts_per_xfer = max(rndis_ul_max_pkt_per_xfer, 1U);
+	rndis->port.dl_max_pkts_per_xfer = rndis_dl_max_pkt_per_xfer;
+	rndis->port.dl_max_xfer_size = rndis_dl_max_xfer_size;
+	rndis->port.dl_align = RNDIS_DL_ALIGN;
 
 	rndis->port.func.name = "rndis";
 	rndis->port.func.strings = rndis_strings;
@@ -392,7 +392,14 @@ static void done(struct fsl_ep *ep, struct fsl_req *req, int status)
 		dma_pool_free(udc->td_pool, curr_td, curr_td->td_dma);
 	}
 
-	if (req->mapped) {
+	if (req->req.num_mapped_sgs) {
+		dma_unmap_sg(ep->udc->gadget.dev.parent,
+			req->req.sg, req->req.num_sgs,
+			ep_is_in(ep)
+				? DMA_TO_DEVICE
+				: DMA_FROM_DEVICE);
+		req->req.num_mapped_sgs = 0;
+	} else if (req->mapped) {
 		dma_unmap_single(ep->udc->gadget.dev.parent,
 			req->req.dma, req->req.length,
 			ep_is_in(ep)
@@ -1042,6 +1049,44 @@ out:
 	return;
 }
 
+/* Check that a scatterlist has the layout fsl_req_dma() relies on:
+ * single-page entries, only the first starting inside its page and
+ * all but the last ending at a page boundary.
+ */
+static int fsl_sg_valid(struct usb_request *req)
+{
+	struct scatterlist *sg = req->sg;
+	unsigned i, len = 0;
+
+	for (i = 0; i < req->num_sgs; i++) {
+		if (i && sg[i].offset)
+			return 0;
+		if (sg[i].offset + sg[i].length > PAGE_SIZE)
+			return 0;
+		if (i != req->num_sgs - 1 &&
+				sg[i].offset + sg[i].length != PAGE_SIZE)
+			return 0;
+		len += sg[i].length;
+	}
+	return len == req->length;
+}
+
+/* DMA address of byte @pos of the request. A dTD takes one address plus
+ * four page pointers, so a scatterlist of pages maps onto it directly.
+ */
+static dma_addr_t fsl_req_dma(struct fsl_req *req, unsigned pos)
+{
+	struct scatterlist *sg = req->req.sg;
+	unsigned i;
+
+	if (!req->req.num_mapped_sgs)
+		return req->req.dma + pos;
+
+	pos += sg[0].offset;
+	i = min(pos >> PAGE_SHIFT, req->req.num_mapped_sgs - 1);
+	return sg_dma_address(&sg[i]) - sg[i].offset + (pos & ~PAGE_MASK);
+}
+
 /* Fill in the dTD structure
  * @req: request that the transfer belongs to
  * @length: return actually data length of the dTD
@@ -1069,12 +1114,15 @@ static struct ep_td_struct *fsl_build_dtd(struct fsl_req *req, unsigned *length,
 	dtd->size_ioc_sts = cpu_to_hc32(swap_temp);
 
 	/* Init all of buffer page pointers */
-	swap_temp = (u32) (req->req.dma + req->req.actual);
-	dtd->buff_ptr0 = cpu_to_hc32(swap_temp);
-	dtd->buff_ptr1 = cpu_to_hc32(swap_temp + 0x1000);
-	dtd->buff_ptr2 = cpu_to_hc32(swap_temp + 0x2000);
-	dtd->buff_ptr3 = cpu_to_hc32(swap_temp + 0x3000);
-	dtd->buff_ptr4 = cpu_to_hc32(swap_temp + 0x4000);
+	dtd->buff_ptr0 = cpu_to_hc32((u32) fsl_req_dma(req, req->req.actual));
+	dtd->buff_ptr1 = cpu_to_hc32((u32)
+			fsl_req_dma(req, req->req.actual + 0x1000));
+	dtd->buff_ptr2 = cpu_to_hc32((u32)
+			fsl_req_dma(req, req->req.actual + 0x2000));
+	dtd->buff_ptr3 = cpu_to_hc32((u32)
+			fsl_req_dma(req, req->req.actual + 0x3000));
+	dtd->buff_ptr4 = cpu_to_hc32((u32)
+			fsl_req_dma(req, req->req.actual + 0x4000));
 
 	req->req.actual += *length;
 
@@ -1156,11 +1204,16 @@ fsl_ep_queue(struct usb_ep *_ep, struct usb_request *_req, gfp_t gfp_flags)
 	int status;
 
 	/* catch various bogus parameters */
-	if (!_req || !req->req.complete || !req->req.buf
+	if (!_req || !req->req.complete
+			|| (!req->req.buf && !req->req.num_sgs)
 			|| !list_empty(&req->queue)) {
 		VDBG("%s, bad params", __func__);
 		return -EINVAL;
 	}
+	if (req->req.num_sgs && !fsl_sg_valid(&req->req)) {
+		VDBG("%s, bad scatterlist", __func__);
+		return -EINVAL;
+	}
 
 	spin_lock_irqsave(&udc->lock, flags);
 
@@ -1193,7 +1246,12 @@ fsl_ep_queue(struct usb_ep *_ep, struct usb_request *_req, gfp_t gfp_flags)
 	req->ep = ep;
 
 	/* map virtual address to hardware */
-	if (req->req.dma == DMA_ADDR_INVALID) {
+	if (req->req.num_sgs) {
+		if (dma_map_sg(udc->gadget.dev.parent, req->req.sg,
+				req->req.num_sgs, dir) != req->req.num_sgs)
+			return -ENOMEM;
+		req->req.num_mapped_sgs = req->req.num_sgs;
+	} else if (req->req.dma == DMA_ADDR_INVALID) {
 		req->req.dma = dma_map_single(udc->gadget.dev.parent,
 					req->req.buf, req->req.length, dir);
 		req->mapped = 1;
@@ -1236,7 +1294,11 @@ fsl_ep_queue(struct usb_ep *_ep, struct usb_request *_req, gfp_t gfp_flags)
 	return 0;
 
 err_unmap:
-	if (req->mapped) {
+	if (req->req.num_mapped_sgs) {
+		dma_unmap_sg(udc->gadget.dev.parent, req->req.sg,
+			req->req.num_sgs, dir);
+		req->req.num_mapped_sgs = 0;
+	} else if (req->mapped) {
 		dma_unmap_single(udc->gadget.dev.parent,
 			req->req.dma, req->req.length, dir);
 		req->req.dma = DMA_ADDR_INVALID;
@@ -3209,6 +3271,7 @@ static int __init fsl_udc_probe(struct platform_device *pdev)
 	/* Setup gadget structure */
 	udc_controller->gadget.ops = &fsl_gadget_ops;
 	udc_controller->gadget.is_dualspeed = 1;
+	udc_controller->gadget.sg_supported = 1;
 	udc_controller->gadget.ep0 = &udc_controller->eps[0].ep;
 	INIT_LIST_HEAD(&udc_controller->gadget.ep_list);
 	udc_controller->gadget.speed = USB_SPEED_UNKNOWN;
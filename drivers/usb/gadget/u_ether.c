@@ -28,6 +28,7 @@
 #include <linux/ctype.h>
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
+#include <linux/hrtimer.h>
 
 #include "u_ether.h"
 
@@ -84,6 +85,17 @@ struct eth_dev {
 
 	bool			zlp;
 	u8			host_mac[ETH_ALEN];
+
+	/* multi-packet IN transfers, see eth_xmit_aggr() */
+	unsigned		dl_max_pkts;	/* 0: one frame per transfer */
+	unsigned		tx_buf_len;
+	struct usb_request	*tx_held;	/* being filled, req_lock */
+	unsigned		tx_held_pkts;
+	struct hrtimer		tx_timer;
+
+	/* frames per USB transfer, reported by ethtool -S */
+	unsigned long		tx_xfers, tx_xfer_frames;
+	unsigned long		rx_xfers, rx_xfer_frames;
 };
 
 /*-------------------------------------------------------------------------*/
@@ -103,6 +115,11 @@ MODULE_PARM_DESC(qmult, "queue length multiplier at high/super speed");
 #define qmult		1
 #endif
 
+/* longest a partly filled multi-packet IN transfer is held back */
+static unsigned tx_aggr_usecs = 500;
+module_param(tx_aggr_usecs, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(tx_aggr_usecs, "multi-packet tx timeout in microseconds");
+
 /* for dual-speed hardware, use deeper queues at high/super speed */
 static inline int qlen(struct usb_gadget *gadget)
 {
@@ -187,9 +204,43 @@ static void eth_get_drvinfo(struct net_device *net, struct ethtool_drvinfo *p)
  *   - ... probably more ethtool ops
  */
 
+static const char eth_stat_names[][ETH_GSTRING_LEN] = {
+	"tx_usb_transfers",
+	"tx_usb_frames",
+	"rx_usb_transfers",
+	"rx_usb_frames",
+};
+
+static int eth_get_sset_count(struct net_device *net, int sset)
+{
+	if (sset != ETH_SS_STATS)
+		return -EOPNOTSUPP;
+	return ARRAY_SIZE(eth_stat_names);
+}
+
+static void eth_get_strings(struct net_device *net, u32 sset, u8 *data)
+{
+	if (sset == ETH_SS_STATS)
+		memcpy(data, eth_stat_names, sizeof eth_stat_names);
+}
+
+static void eth_get_ethtool_stats(struct net_device *net,
+		struct ethtool_stats *stats, u64 *data)
+{
+	struct eth_dev	*dev = netdev_priv(net);
+
+	data[0] = dev->tx_xfers;
+	data[1] = dev->tx_xfer_frames;
+	data[2] = dev->rx_xfers;
+	data[3] = dev->rx_xfer_frames;
+}
+
 static const struct ethtool_ops ops = {
 	.get_drvinfo = eth_get_drvinfo,
 	.get_link = ethtool_op_get_link,
+	.get_sset_count = eth_get_sset_count,
+	.get_strings = eth_get_strings,
+	.get_ethtool_stats = eth_get_ethtool_stats,
 };
 
 static void defer_kevent(struct eth_dev *dev, int flag)
@@ -238,6 +289,7 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	 */
 	size += sizeof(struct ethhdr) + dev->net->mtu + RX_EXTRA;
 	size += dev->port_usb->header_len;
+	size *= max_t(unsigned, dev->port_usb->ul_max_pkts_per_xfer, 1);
 	size += out->maxpacket - 1;
 	size -= size % out->maxpacket;
 
@@ -281,6 +333,7 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 	struct sk_buff	*skb = req->context, *skb2;
 	struct eth_dev	*dev = ep->driver_data;
 	int		status = req->status;
+	unsigned	frames = 0;
 
 	switch (status) {
 
@@ -325,9 +378,12 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 			 * use skb buffers.
 			 */
 			status = netif_rx(skb2);
+			frames++;
 next_frame:
 			skb2 = skb_dequeue(&dev->rx_frames);
 		}
+		dev->rx_xfers++;
+		dev->rx_xfer_frames += frames;
 		break;
 
 	/* software-driven interface shutdown */
@@ -462,6 +518,62 @@ static void eth_work(struct work_struct *work)
 		DBG(dev, "work done, flags = 0x%lx\n", dev->todo);
 }
 
+static void tx_complete(struct usb_ep *ep, struct usb_request *req);
+
+/* Queue the multi-packet transfer being filled.  Called with req_lock
+ * held, so transfers go out in the order they were filled.
+ */
+static void tx_queue_held(struct eth_dev *dev, struct usb_ep *in)
+{
+	struct usb_request	*req = dev->tx_held;
+
+	dev->tx_held = NULL;
+
+	req->context = NULL;
+	req->complete = tx_complete;
+	req->zero = 1;
+	req->no_interrupt = 0;
+	if (!dev->zlp && (req->length % in->maxpacket) == 0)
+		req->length++;
+
+	if (usb_ep_queue(in, req, GFP_ATOMIC)) {
+		dev->net->stats.tx_dropped += dev->tx_held_pkts;
+		if (list_empty(&dev->tx_reqs))
+			netif_start_queue(dev->net);
+		list_add(&req->list, &dev->tx_reqs);
+		return;
+	}
+	atomic_inc(&dev->tx_qlen);
+	dev->tx_xfers++;
+	dev->tx_xfer_frames += dev->tx_held_pkts;
+}
+
+static void tx_flush_held(struct eth_dev *dev, struct usb_ep *in)
+{
+	unsigned long	flags;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	if (dev->tx_held)
+		tx_queue_held(dev, in);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+}
+
+static enum hrtimer_restart tx_aggr_timeout(struct hrtimer *timer)
+{
+	struct eth_dev	*dev = container_of(timer, struct eth_dev, tx_timer);
+	struct usb_ep	*in = NULL;
+	unsigned long	flags;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->port_usb)
+		in = dev->port_usb->in_ep;
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	if (in)
+		tx_flush_held(dev, in);
+	return HRTIMER_NORESTART;
+}
+
 static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context;
@@ -476,25 +588,151 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 	case -ESHUTDOWN:		/* disconnect etc */
 		break;
 	case 0:
-		dev->net->stats.tx_bytes += skb->len;
+		if (skb)
+			dev->net->stats.tx_bytes += skb->len;
 	}
-	dev->net->stats.tx_packets++;
+	/* frames of multi-packet transfers are counted as they're copied */
+	if (skb)
+		dev->net->stats.tx_packets++;
 
 	spin_lock(&dev->req_lock);
 	list_add(&req->list, &dev->tx_reqs);
 	spin_unlock(&dev->req_lock);
-	dev_kfree_skb_any(skb);
+	if (skb)
+		dev_kfree_skb_any(skb);
 
 	atomic_dec(&dev->tx_qlen);
+
+	/* don't hold back a partly filled transfer once the link is idle */
+	if (dev->tx_held && !atomic_read(&dev->tx_qlen))
+		tx_flush_held(dev, ep);
+
 	if (netif_carrier_ok(dev->net))
 		netif_wake_queue(dev->net);
 }
 
+/* buffers for multi-packet IN transfers; without them, one frame each */
+static void tx_alloc_bufs(struct eth_dev *dev, struct gether *link)
+{
+	struct usb_request	*req;
+	unsigned		len = link->dl_max_xfer_size;
+
+	dev->dl_max_pkts = 0;
+	if (!link->wrap || link->dl_max_pkts_per_xfer < 2 ||
+			len <= ETH_FRAME_LEN + link->header_len)
+		return;
+
+	spin_lock(&dev->req_lock);
+	list_for_each_entry(req, &dev->tx_reqs, list) {
+		req->buf = kmalloc(len, GFP_ATOMIC);
+		if (!req->buf)
+			break;
+	}
+	if (&req->list != &dev->tx_reqs) {
+		list_for_each_entry_continue_reverse(req, &dev->tx_reqs, list) {
+			kfree(req->buf);
+			req->buf = NULL;
+		}
+		DBG(dev, "no memory for multi-packet tx\n");
+	} else {
+		/* room for the byte added when zlps are avoided */
+		dev->tx_buf_len = len - 1;
+		dev->dl_max_pkts = link->dl_max_pkts_per_xfer;
+	}
+	spin_unlock(&dev->req_lock);
+}
+
 static inline int is_promisc(u16 cdc_filter)
 {
 	return cdc_filter & USB_CDC_PACKET_TYPE_PROMISCUOUS;
 }
 
+/*
+ * Multi-packet transmit: frames are copied, framing and all, into the IN
+ * request being filled while earlier transfers are in flight.  It is sent
+ * when full, when the link goes idle (see tx_complete) or tx_aggr_usecs
+ * after its first frame; a frame arriving on an idle link goes at once.
+ */
+static netdev_tx_t eth_xmit_aggr(struct eth_dev *dev, struct sk_buff *skb,
+		struct usb_ep *in)
+{
+	struct usb_request	*req;
+	unsigned long		flags;
+	unsigned		max_len = dev->tx_buf_len;
+	unsigned		align = 1;
+	unsigned		len;
+	bool			arm = false;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->port_usb) {
+		struct gether	*port = dev->port_usb;
+
+		if (port->dl_host_max_xfer && port->dl_host_max_xfer < max_len)
+			max_len = port->dl_host_max_xfer;
+		align = max(port->dl_align, 1U);
+		skb = dev->wrap(port, skb);
+	} else {
+		dev_kfree_skb_any(skb);
+		skb = NULL;
+	}
+	spin_unlock_irqrestore(&dev->lock, flags);
+	if (!skb)
+		goto drop;
+
+	len = ALIGN(skb->len, align);
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	req = dev->tx_held;
+	if (req && (dev->tx_held_pkts >= dev->dl_max_pkts ||
+		    req->length + len > max_len)) {
+		tx_queue_held(dev, in);
+		req = NULL;
+	}
+	if (!req) {
+		/* as in eth_start_xmit(), empty only if racing disconnect */
+		if (list_empty(&dev->tx_reqs) || len > max_len) {
+			spin_unlock_irqrestore(&dev->req_lock, flags);
+			dev_kfree_skb_any(skb);
+			goto drop;
+		}
+		req = container_of(dev->tx_reqs.next, struct usb_request, list);
+		list_del(&req->list);
+		if (list_empty(&dev->tx_reqs))
+			netif_stop_queue(dev->net);
+
+		req->length = 0;
+		dev->tx_held = req;
+		dev->tx_held_pkts = 0;
+		arm = true;
+	}
+
+	memcpy(req->buf + req->length, skb->data, skb->len);
+	memset(req->buf + req->length + skb->len, 0, len - skb->len);
+	req->length += len;
+	dev->tx_held_pkts++;
+	dev->net->stats.tx_packets++;
+	dev->net->stats.tx_bytes += skb->len;
+
+	if (!atomic_read(&dev->tx_qlen) ||
+			dev->tx_held_pkts >= dev->dl_max_pkts) {
+		tx_queue_held(dev, in);
+		arm = false;
+	}
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	dev_kfree_skb_any(skb);
+	if (arm)
+		hrtimer_start(&dev->tx_timer,
+			ktime_set(0, tx_aggr_usecs * NSEC_PER_USEC),
+			HRTIMER_MODE_REL);
+	dev->net->trans_start = jiffies;
+	return NETDEV_TX_OK;
+
+drop:
+	dev->net->stats.tx_dropped++;
+	return NETDEV_TX_OK;
+}
+
 static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 					struct net_device *net)
 {
@@ -543,6 +781,9 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		/* ignores USB_CDC_PACKET_TYPE_DIRECTED */
 	}
 
+	if (dev->dl_max_pkts)
+		return eth_xmit_aggr(dev, skb, in);
+
 	spin_lock_irqsave(&dev->req_lock, flags);
 	/*
 	 * this freelist can be empty if an interrupt triggered disconnect()
@@ -614,6 +855,8 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 	case 0:
 		net->trans_start = jiffies;
 		atomic_inc(&dev->tx_qlen);
+		dev->tx_xfers++;
+		dev->tx_xfer_frames++;
 	}
 
 	if (retval) {
@@ -716,6 +959,37 @@ static char *host_addr;
 module_param(host_addr, charp, S_IRUGO);
 MODULE_PARM_DESC(host_addr, "Host Ethernet Address");
 
+#ifdef CONFIG_RPS
+/* frames all arrive on the cpu taking the USB irq; spread them by flow */
+static unsigned rps_cpus = 0xf;
+module_param(rps_cpus, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(rps_cpus, "RPS cpu bitmask set at registration, 0 for none");
+
+static unsigned rps_flow_cnt = 256;
+module_param(rps_flow_cnt, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(rps_flow_cnt, "RFS flow table entries set at registration");
+
+static void gether_rps_init(struct eth_dev *dev)
+{
+	cpumask_var_t	mask;
+	int		cpu;
+
+	if (!rps_cpus || !alloc_cpumask_var(&mask, GFP_KERNEL))
+		return;
+
+	cpumask_clear(mask);
+	for_each_possible_cpu(cpu) {
+		if (cpu < 32 && (rps_cpus & (1U << cpu)))
+			cpumask_set_cpu(cpu, mask);
+	}
+	if (netif_set_rps_cpus(dev->net, mask, rps_flow_cnt))
+		ERROR(dev, "failed to set up rps\n");
+	free_cpumask_var(mask);
+}
+#else
+static inline void gether_rps_init(struct eth_dev *dev) { }
+#endif
+
 static int get_ether_addr(const char *str, u8 *dev_addr)
 {
 	if (str) {
@@ -804,6 +1078,8 @@ int gether_setup_name(struct usb_gadget *g, u8 ethaddr[ETH_ALEN],
 	INIT_WORK(&dev->work, eth_work);
 	INIT_LIST_HEAD(&dev->tx_reqs);
 	INIT_LIST_HEAD(&dev->rx_reqs);
+	hrtimer_init(&dev->tx_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dev->tx_timer.function = tx_aggr_timeout;
 
 	skb_queue_head_init(&dev->rx_frames);
 
@@ -843,6 +1119,7 @@ int gether_setup_name(struct usb_gadget *g, u8 ethaddr[ETH_ALEN],
 		INFO(dev, "MAC %pM\n", net->dev_addr);
 		INFO(dev, "HOST MAC %pM\n", dev->host_mac);
 
+		gether_rps_init(dev);
 		the_dev = dev;
 	}
 
@@ -918,6 +1195,7 @@ struct net_device *gether_connect(struct gether *link)
 		dev->header_len = link->header_len;
 		dev->unwrap = link->unwrap;
 		dev->wrap = link->wrap;
+		tx_alloc_bufs(dev, link);
 
 		spin_lock(&dev->lock);
 		dev->port_usb = link;
@@ -972,6 +1250,7 @@ void gether_disconnect(struct gether *link)
 
 	netif_stop_queue(dev->net);
 	netif_carrier_off(dev->net);
+	hrtimer_cancel(&dev->tx_timer);
 
 	/* disable endpoints, forcing (synchronous) completion
 	 * of all pending i/o.  then free the request objects
@@ -979,15 +1258,22 @@ void gether_disconnect(struct gether *link)
 	 */
 	usb_ep_disable(link->in_ep);
 	spin_lock(&dev->req_lock);
+	if (dev->tx_held) {
+		list_add(&dev->tx_held->list, &dev->tx_reqs);
+		dev->tx_held = NULL;
+	}
 	while (!list_empty(&dev->tx_reqs)) {
 		req = container_of(dev->tx_reqs.next,
 					struct usb_request, list);
 		list_del(&req->list);
 
 		spin_unlock(&dev->req_lock);
+		if (dev->dl_max_pkts)
+			kfree(req->buf);
 		usb_ep_free_request(link->in_ep, req);
 		spin_lock(&dev->req_lock);
 	}
+	dev->dl_max_pkts = 0;
 	spin_unlock(&dev->req_lock);
 	link->in_ep->driver_data = NULL;
 	link->in_ep->desc = NULL;
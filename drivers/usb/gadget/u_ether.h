@@ -68,6 +68,18 @@ struct gether {
 						struct sk_buff *skb,
 						struct sk_buff_head *list);
 
+	/* several frames per transfer, when the framing allows it.
+	 * ul: OUT transfers are sized for this many frames.
+	 * dl: u_ether copies up to this many frames into one IN transfer
+	 * of up to dl_max_xfer_size bytes, or dl_host_max_xfer if that is
+	 * nonzero and smaller, each frame padded to dl_align bytes.
+	 */
+	unsigned			ul_max_pkts_per_xfer;
+	unsigned			dl_max_pkts_per_xfer;
+	unsigned			dl_max_xfer_size;
+	unsigned			dl_host_max_xfer;
+	unsigned			dl_align;
+
 	/* called on network open/close */
 	void				(*open)(struct gether *);
 	void				(*close)(struct gether *);
@@ -76,6 +76,40 @@ static int use_dynamic_emc = 1;
 
 module_param_named(use_dynamic_emc, use_dynamic_emc, int, S_IRUGO | S_IWUSR);
 
+/*
+ * The EMC floor requested for scanout is the bandwidth the active windows
+ * fetch, times a margin for the efficiency the memory controller reaches.
+ * The margin goes from emc_margin_idle when the activity monitor sees an
+ * idle EMC to emc_margin_busy under full load, both in percent.
+ */
+static int emc_margin_idle = 200;
+module_param_named(emc_margin_idle, emc_margin_idle, int, S_IRUGO | S_IWUSR);
+
+static int emc_margin_busy = 290;
+module_param_named(emc_margin_busy, emc_margin_busy, int, S_IRUGO | S_IWUSR);
+
+/*
+ * Each underflow raises the floor by emc_underflow_boost percent, up to
+ * emc_boost_max; the boost is halved after emc_boost_decay_ms without one.
+ */
+static int emc_underflow_boost = 25;
+module_param_named(emc_underflow_boost, emc_underflow_boost, int,
+		   S_IRUGO | S_IWUSR);
+
+static int emc_boost_max = 100;
+module_param_named(emc_boost_max, emc_boost_max, int, S_IRUGO | S_IWUSR);
+
+static int emc_boost_decay_ms = 5000;
+module_param_named(emc_boost_decay_ms, emc_boost_decay_ms, int,
+		   S_IRUGO | S_IWUSR);
+
+/*
+ * Outputs with an idle_refresh_hz drop to that refresh rate after this
+ * many frames without a window update; 0 disables idle mode.
+ */
+static int idle_frames = 60;
+module_param_named(idle_frames, idle_frames, int, S_IRUGO | S_IWUSR);
+
 struct tegra_dc *tegra_dcs[TEGRA_MAX_DC];
 
 DEFINE_MUTEX(tegra_dc_lock);
@@ -435,11 +469,43 @@ static int dbg_dc_stats_show(struct seq_file *s, void *unused)
 		"underflows: %llu\n"
 		"underflows_a: %llu\n"
 		"underflows_b: %llu\n"
-		"underflows_c: %llu\n",
+		"underflows_c: %llu\n"
+		"flips: %llu\n"
+		"flips_shown: %llu\n"
+		"flips_dropped: %llu\n"
+		"missed_vblanks: %llu\n"
+		"flip_latency_avg_us: %llu\n"
+		"flip_latency_max_us: %llu\n"
+		"emc_floor_khz: %lu\n"
+		"emc_model_khz: %lu\n"
+		"emc_boost_pct: %d\n"
+		"emc_boosts: %llu\n"
+		"idle: %d\n"
+		"idle_entries: %llu\n"
+		"mirror_of: %d\n"
+		"mirror_flips: %llu\n"
+		"mirror_bw_rejects: %llu\n",
 		dc->stats.underflows,
 		dc->stats.underflows_a,
 		dc->stats.underflows_b,
-		dc->stats.underflows_c);
+		dc->stats.underflows_c,
+		dc->stats.flips,
+		dc->stats.flips_shown,
+		dc->stats.flips_dropped,
+		dc->stats.missed_vblanks,
+		dc->stats.flips_shown ?
+			div64_u64(dc->stats.flip_latency_us,
+				  dc->stats.flips_shown) : 0,
+		dc->stats.flip_latency_max_us,
+		(unsigned long)dc->emc_clk_rate / 1000,
+		dc->emc_model_rate / 1000,
+		dc->emc_boost,
+		dc->stats.emc_boosts,
+		dc->idle,
+		dc->stats.idle_entries,
+		dc->mirror_src ? dc->mirror_src->ndev->id : -1,
+		dc->stats.mirror_flips,
+		dc->stats.mirror_bw_rejects);
 	mutex_unlock(&dc->lock);
 
 	return 0;
@@ -802,22 +868,23 @@ static void tegra_dc_set_scaling_filter(struct tegra_dc *dc)
 	}
 }
 
+/* windows A, B, C for first and second display */
+static const enum tegra_la_id la_id_tab[2][3] = {
+	/* first display */
+	{ TEGRA_LA_DISPLAY_0A, TEGRA_LA_DISPLAY_0B,
+		TEGRA_LA_DISPLAY_0C },
+	/* second display */
+	{ TEGRA_LA_DISPLAY_0AB, TEGRA_LA_DISPLAY_0BB,
+		TEGRA_LA_DISPLAY_0CB },
+};
+/* window B V-filter tap for first and second display. */
+static const enum tegra_la_id vfilter_tab[2] = {
+	TEGRA_LA_DISPLAY_1B, TEGRA_LA_DISPLAY_1BB,
+};
+
 static void tegra_dc_set_latency_allowance(struct tegra_dc *dc,
 	struct tegra_dc_win *w)
 {
-	/* windows A, B, C for first and second display */
-	static const enum tegra_la_id la_id_tab[2][3] = {
-		/* first display */
-		{ TEGRA_LA_DISPLAY_0A, TEGRA_LA_DISPLAY_0B,
-			TEGRA_LA_DISPLAY_0C },
-		/* second display */
-		{ TEGRA_LA_DISPLAY_0AB, TEGRA_LA_DISPLAY_0BB,
-			TEGRA_LA_DISPLAY_0CB },
-	};
-	/* window B V-filter tap for first and second display. */
-	static const enum tegra_la_id vfilter_tab[2] = {
-		TEGRA_LA_DISPLAY_1B, TEGRA_LA_DISPLAY_1BB,
-	};
 	unsigned long bw;
 
 	BUG_ON(dc->ndev->id >= ARRAY_SIZE(la_id_tab));
@@ -912,14 +979,30 @@ static unsigned long tegra_dc_find_max_bandwidth(struct tegra_dc_win *wins[],
 	return max_bw;
 }
 
+/*
+ * Margin over the fetched bandwidth, in percent: worst case while the EMC
+ * is busy with other clients, less while scanout has it mostly to itself.
+ */
+static unsigned long tegra_dc_emc_margin(void)
+{
+	int load = tegra_actmon_emc_load();
+	int idle = min(emc_margin_idle, emc_margin_busy);
+
+	if (load < 0)
+		return emc_margin_busy;
+	return idle + (emc_margin_busy - idle) * load / 100;
+}
+
 /*
  * Calculate peak EMC bandwidth for each enabled window =
  * pixel_clock * win_bpp * (use_v_filter ? 2 : 1)) * H_scale_factor *
- * (windows_tiling ? 2 : 1)
+ * V_downscale_factor * (windows_tiling ? 2 : 1)
  *
  * note:
  * (*) We use 2 tap V filter, so need double BW if use V filter
+ * (*) Vertical downscaling fetches more than one line per output line
  * (*) Tiling mode on T30 and DDR3 requires double BW
+ * (*) The result includes the margin of tegra_dc_emc_margin()
  *
  * return:
  * bandwidth in kBps
@@ -927,9 +1010,10 @@ static unsigned long tegra_dc_find_max_bandwidth(struct tegra_dc_win *wins[],
 static unsigned long tegra_dc_calc_win_bandwidth(struct tegra_dc *dc,
 	struct tegra_dc_win *w)
 {
-	unsigned long ret;
+	u64 ret;
 	int tiled_windows_bw_multiplier;
 	unsigned long bpp;
+	unsigned in_h;
 
 	if (!WIN_IS_ENABLED(w))
 		return 0;
@@ -946,16 +1030,40 @@ static unsigned long tegra_dc_calc_win_bandwidth(struct tegra_dc *dc,
 	 * is of the luma plane's size only. */
 	bpp = tegra_dc_is_yuv_planar(w->fmt) ?
 		2 * tegra_dc_fmt_bpp(w->fmt) : tegra_dc_fmt_bpp(w->fmt);
-	ret = dc->mode.pclk / 1000UL * bpp / 8 * (win_use_v_filter(w) ? 2 : 1)
-		* dfixed_trunc(w->w) / w->out_w *
+	in_h = max_t(unsigned, dfixed_trunc(w->h), w->out_h);
+	ret = (u64)(dc->mode.pclk / 1000UL) * bpp / 8 *
+		(win_use_v_filter(w) ? 2 : 1) *
 		(WIN_IS_TILED(w) ? tiled_windows_bw_multiplier : 1);
-	/*
-	 * Assuming ~35% efficiency: i.e. if we calculate we need 70MBps, we
-	 * will request 200MBps from EMC.
-	 */
-	ret = ret * 29 / 10;
+	ret = div_u64(ret * dfixed_trunc(w->w), w->out_w);
+	ret = div_u64(ret * in_h, w->out_h);
+	ret = div_u64(ret * tegra_dc_emc_margin(), 100);
 
-	return ret;
+	return min_t(u64, ret, ULONG_MAX);
+}
+
+/* Called with dc->lock held */
+static void tegra_dc_apply_emc_boost(struct tegra_dc *dc)
+{
+	unsigned long rate = dc->emc_model_rate;
+
+	if (!use_dynamic_emc || !rate)
+		return;
+
+	if (dc->emc_boost && time_after(jiffies, dc->emc_boost_time +
+			msecs_to_jiffies(emc_boost_decay_ms))) {
+		dc->emc_boost /= 2;
+		dc->emc_boost_time = jiffies;
+	}
+
+	if (rate != ULONG_MAX && dc->emc_boost) {
+		u64 boosted = div_u64((u64)rate * (100 + dc->emc_boost), 100);
+		rate = min_t(u64, boosted, ULONG_MAX);
+	}
+	/* in idle mode the same frame is fetched less often */
+	if (rate != ULONG_MAX && dc->idle)
+		rate = div_u64((u64)rate * tegra_dc_frame_us(dc) *
+			       dc->out->idle_refresh_hz, USEC_PER_SEC);
+	dc->new_emc_clk_rate = rate;
 }
 
 static unsigned long tegra_dc_get_bandwidth(
@@ -1030,11 +1138,106 @@ static int tegra_dc_set_dynamic_emc(struct tegra_dc_win *windows[], int n)
 	if (tegra_dc_has_multiple_dc())
 		new_rate = ULONG_MAX;
 
-	dc->new_emc_clk_rate = new_rate;
+	dc->emc_model_rate = new_rate;
+	tegra_dc_apply_emc_boost(dc);
 
 	return 0;
 }
 
+/* Length of a frame of the current mode, in microseconds */
+s64 tegra_dc_frame_us(struct tegra_dc *dc)
+{
+	struct tegra_dc_mode *m = &dc->mode;
+	s64 htotal = m->h_sync_width + m->h_back_porch + m->h_active +
+		m->h_front_porch;
+	s64 vtotal = m->v_sync_width + m->v_back_porch + m->v_active +
+		m->v_front_porch;
+
+	if (m->pclk <= 0 || !htotal || !vtotal)
+		return USEC_PER_SEC / 60;
+	return div_s64(htotal * vtotal * USEC_PER_SEC, m->pclk);
+}
+
+static bool tegra_dc_can_idle(struct tegra_dc *dc)
+{
+	return idle_frames && dc->out->idle_refresh_hz &&
+		!(dc->out->flags & TEGRA_DC_OUT_ONE_SHOT_MODE);
+}
+
+/* Called with dc->lock held, after every window update */
+static void tegra_dc_idle_schedule(struct tegra_dc *dc)
+{
+	if (!tegra_dc_can_idle(dc))
+		return;
+
+	dc->idle_update_time = jiffies;
+	cancel_delayed_work(&dc->idle_work);
+	schedule_delayed_work(&dc->idle_work,
+		usecs_to_jiffies(tegra_dc_frame_us(dc) * idle_frames));
+}
+
+/*
+ * Static content: stretch the vertical front porch so that the panel is
+ * refreshed at idle_refresh_hz.  The new timing is latched at the end of
+ * the current frame.  Called with dc->lock held.
+ */
+static void tegra_dc_idle_enter(struct tegra_dc *dc)
+{
+	struct tegra_dc_mode *m = &dc->mode;
+	unsigned htotal = m->h_sync_width + m->h_back_porch + m->h_active +
+		m->h_front_porch;
+	unsigned vblank = m->v_sync_width + m->v_back_porch + m->v_active;
+	unsigned vtotal, v_front_porch;
+
+	if (m->pclk <= 0 || !htotal)
+		return;
+
+	vtotal = m->pclk / htotal / dc->out->idle_refresh_hz;
+	if (vtotal <= vblank + m->v_front_porch)
+		return;
+	v_front_porch = min(vtotal - vblank, 0x7fffU);
+
+	tegra_dc_writel(dc, m->h_front_porch | (v_front_porch << 16),
+			DC_DISP_FRONT_PORCH);
+	tegra_dc_writel(dc, GENERAL_UPDATE, DC_CMD_STATE_CONTROL);
+	tegra_dc_writel(dc, GENERAL_ACT_REQ, DC_CMD_STATE_CONTROL);
+
+	dc->idle = true;
+	dc->stats.idle_entries++;
+
+	/* scanout needs proportionally less memory bandwidth */
+	tegra_dc_apply_emc_boost(dc);
+	tegra_dc_program_bandwidth(dc);
+}
+
+/*
+ * Back to the mode's refresh rate.  The caller latches the timing with its
+ * own GENERAL_UPDATE.  Called with dc->lock held.
+ */
+static void tegra_dc_idle_exit(struct tegra_dc *dc)
+{
+	if (!dc->idle)
+		return;
+
+	tegra_dc_writel(dc, dc->mode.h_front_porch |
+			(dc->mode.v_front_porch << 16), DC_DISP_FRONT_PORCH);
+	dc->idle = false;
+}
+
+static void tegra_dc_idle_worker(struct work_struct *work)
+{
+	struct tegra_dc *dc = container_of(
+		to_delayed_work(work), struct tegra_dc, idle_work);
+
+	mutex_lock(&dc->lock);
+	/* skip if a window update raced with us and rescheduled the work */
+	if (dc->enabled && !dc->idle && tegra_dc_can_idle(dc) &&
+	    !time_before(jiffies, dc->idle_update_time +
+			usecs_to_jiffies(tegra_dc_frame_us(dc) * idle_frames)))
+		tegra_dc_idle_enter(dc);
+	mutex_unlock(&dc->lock);
+}
+
 static inline u32 compute_dda_inc(fixed20_12 in, unsigned out_int,
 				  bool v, unsigned Bpp)
 {
@@ -1083,7 +1286,7 @@ static inline u32 compute_initial_dda(fixed20_12 in)
 }
 
 /* does not support updating windows on multiple dcs in one call */
-int tegra_dc_update_windows(struct tegra_dc_win *windows[], int n)
+static int _tegra_dc_update_windows(struct tegra_dc_win *windows[], int n)
 {
 	struct tegra_dc *dc;
 	unsigned long update_mask = GENERAL_ACT_REQ;
@@ -1109,6 +1312,8 @@ int tegra_dc_update_windows(struct tegra_dc_win *windows[], int n)
 		return -EFAULT;
 	}
 
+	tegra_dc_idle_exit(dc);
+
 	val = tegra_dc_readl(dc, DC_CMD_INT_MASK);
 	val &= ~(FRAME_END_INT | V_BLANK_INT | ALL_UF_INT);
 	tegra_dc_writel(dc, val, DC_CMD_INT_MASK);
@@ -1294,6 +1499,8 @@ int tegra_dc_update_windows(struct tegra_dc_win *windows[], int n)
 	/* update EMC clock if calculated bandwidth has changed */
 	tegra_dc_program_bandwidth(dc);
 
+	tegra_dc_idle_schedule(dc);
+
 	if (dc->out->flags & TEGRA_DC_OUT_ONE_SHOT_MODE)
 		update_mask |= NC_HOST_TRIG;
 
@@ -1315,7 +1522,6 @@ int tegra_dc_update_windows(struct tegra_dc_win *windows[], int n)
 
 	return 0;
 }
-EXPORT_SYMBOL(tegra_dc_update_windows);
 
 u32 tegra_dc_get_syncpt_id(const struct tegra_dc *dc, int i)
 {
@@ -1383,6 +1589,226 @@ int tegra_dc_sync_windows(struct tegra_dc_win *windows[], int n)
 }
 EXPORT_SYMBOL(tegra_dc_sync_windows);
 
+/*
+ * Hardware mirror: a second head (HDMI) scans out the buffers posted to
+ * the first through its own windows, scaled to its mode by the window
+ * filters, so nobody has to compose a copy for it every frame.  Each
+ * flip on the source is replayed on the mirror and waited for, so the
+ * source's buffers are not released while the mirror still fetches them.
+ * Windows posted to a mirroring head directly are dropped.
+ *
+ * tegra_dc_mirror_lock covers the mirror links and the saved geometry;
+ * it is taken outside of dc->lock.
+ */
+static DEFINE_MUTEX(tegra_dc_mirror_lock);
+
+/* Called with tegra_dc_mirror_lock held, before the windows are programmed */
+static void tegra_dc_mirror_save(struct tegra_dc *dc,
+				 struct tegra_dc_win *windows[], int n)
+{
+	int i;
+
+	/* _tegra_dc_update_windows() disables any window not passed in */
+	for (i = 0; i < DC_N_WINDOWS; i++)
+		dc->mirror_wins[i].flags = 0;
+
+	for (i = 0; i < n; i++) {
+		struct tegra_dc_win *w = windows[i];
+		struct tegra_dc_mirror_win *m = &dc->mirror_wins[w->idx];
+
+		m->flags = w->flags;
+		m->fmt = w->fmt;
+		m->phys_addr = w->phys_addr;
+		m->phys_addr_u = w->phys_addr_u;
+		m->phys_addr_v = w->phys_addr_v;
+		m->stride = w->stride;
+		m->stride_uv = w->stride_uv;
+		m->x = w->x;
+		m->y = w->y;
+		m->w = w->w;
+		m->h = w->h;
+		m->out_x = w->out_x;
+		m->out_y = w->out_y;
+		m->out_w = w->out_w;
+		m->out_h = w->out_h;
+		m->z = w->z;
+	}
+}
+
+/*
+ * Both heads scan out of the same EMC: refuse a mirror frame that, on top
+ * of what the source fetches, would need more than the EMC can run at.
+ */
+static bool tegra_dc_mirror_bw_ok(struct tegra_dc *src, struct tegra_dc *dst,
+				  struct tegra_dc_win *wins[])
+{
+	long max_rate = clk_round_rate(dst->emc_clk, ULONG_MAX);
+	u64 bw;
+	int i;
+
+	if (max_rate <= 0)
+		return true;
+
+	bw = tegra_dc_get_bandwidth(wins, DC_N_WINDOWS);
+	for (i = 0; i < DC_N_WINDOWS; i++)
+		bw += tegra_dc_calc_win_bandwidth(src, &src->windows[i]);
+
+	return EMC_BW_TO_FREQ(bw * 1000) <= max_rate;
+}
+
+/* Called with tegra_dc_mirror_lock held */
+static int tegra_dc_mirror_flip(struct tegra_dc *src, struct tegra_dc *dst)
+{
+	struct tegra_dc_win *wins[DC_N_WINDOWS];
+	unsigned sw = src->mode.h_active, sh = src->mode.v_active;
+	unsigned dw = dst->mode.h_active, dh = dst->mode.v_active;
+	unsigned aw, ah, ox, oy;
+	int i, nr_on = 0, ret;
+
+	for (i = 0; i < DC_N_WINDOWS; i++) {
+		wins[i] = tegra_dc_get_window(dst, i);
+		wins[i]->flags = 0;
+		if (src->mirror_wins[i].flags & TEGRA_WIN_FLAG_ENABLED)
+			nr_on++;
+	}
+
+	if (!sw || !sh || !dw || !dh)
+		goto update;
+
+	/* largest area of the source's aspect ratio, centered */
+	if ((u64)dw * sh <= (u64)dh * sw) {
+		aw = dw;
+		ah = sh * dw / sw;
+	} else {
+		ah = dh;
+		aw = sw * dh / sh;
+	}
+	ox = (dw - aw) / 2;
+	oy = (dh - ah) / 2;
+
+	for (i = 0; i < DC_N_WINDOWS; i++) {
+		struct tegra_dc_mirror_win *m = &src->mirror_wins[i];
+		struct tegra_dc_win *w;
+
+		if (!(m->flags & TEGRA_WIN_FLAG_ENABLED))
+			continue;
+
+		/* a lone window goes to B, which filters both ways */
+		w = wins[nr_on == 1 ? 1 : i];
+		w->flags = m->flags;
+		w->fmt = m->fmt;
+		w->ppflags = 0;
+		w->phys_addr = m->phys_addr;
+		w->phys_addr_u = m->phys_addr_u;
+		w->phys_addr_v = m->phys_addr_v;
+		w->stride = m->stride;
+		w->stride_uv = m->stride_uv;
+		w->x = m->x;
+		w->y = m->y;
+		w->w = m->w;
+		w->h = m->h;
+		w->z = m->z;
+		w->out_x = ox + m->out_x * aw / sw;
+		w->out_y = oy + m->out_y * ah / sh;
+		w->out_w = ox + (m->out_x + m->out_w) * aw / sw - w->out_x;
+		w->out_h = oy + (m->out_y + m->out_h) * ah / sh - w->out_y;
+		if (!w->out_w || !w->out_h)
+			w->flags = 0;
+	}
+
+	if (!tegra_dc_mirror_bw_ok(src, dst, wins)) {
+		dst->stats.mirror_bw_rejects++;
+		for (i = 0; i < DC_N_WINDOWS; i++)
+			wins[i]->flags = 0;
+	}
+
+update:
+	ret = _tegra_dc_update_windows(wins, DC_N_WINDOWS);
+	if (ret)
+		return ret;
+
+	dst->stats.mirror_flips++;
+	tegra_dc_sync_windows(wins, DC_N_WINDOWS);
+	return 0;
+}
+
+int tegra_dc_update_windows(struct tegra_dc_win *windows[], int n)
+{
+	struct tegra_dc *dc = windows[0]->dc;
+	int ret;
+
+	mutex_lock(&tegra_dc_mirror_lock);
+	if (dc->mirror_src) {
+		mutex_unlock(&tegra_dc_mirror_lock);
+		return 0;
+	}
+	tegra_dc_mirror_save(dc, windows, n);
+	mutex_unlock(&tegra_dc_mirror_lock);
+
+	ret = _tegra_dc_update_windows(windows, n);
+
+	mutex_lock(&tegra_dc_mirror_lock);
+	if (!ret && dc->mirror)
+		tegra_dc_mirror_flip(dc, dc->mirror);
+	mutex_unlock(&tegra_dc_mirror_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(tegra_dc_update_windows);
+
+int tegra_dc_set_mirror(struct tegra_dc *dst, struct tegra_dc *src)
+{
+	struct tegra_dc_win *wins[DC_N_WINDOWS];
+	struct tegra_dc *old;
+	int i, ret = 0;
+
+	if (src == dst)
+		return -EINVAL;
+
+	mutex_lock(&tegra_dc_mirror_lock);
+	old = dst->mirror_src;
+	if (old == src)
+		goto out;
+
+	/* no chains, and one mirror per source */
+	if (src && (src->mirror_src || src->mirror || dst->mirror)) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	if (old) {
+		old->mirror = NULL;
+		dst->mirror_src = NULL;
+
+		/* the source may release its buffers as soon as we return */
+		for (i = 0; i < DC_N_WINDOWS; i++) {
+			wins[i] = tegra_dc_get_window(dst, i);
+			wins[i]->flags = 0;
+		}
+		if (!_tegra_dc_update_windows(wins, DC_N_WINDOWS))
+			tegra_dc_sync_windows(wins, DC_N_WINDOWS);
+	}
+
+	if (src) {
+		src->mirror = dst;
+		dst->mirror_src = src;
+		tegra_dc_mirror_flip(src, dst);
+	}
+out:
+	mutex_unlock(&tegra_dc_mirror_lock);
+	return ret;
+}
+EXPORT_SYMBOL(tegra_dc_set_mirror);
+
+/* A mirroring head that comes up shows the source's current frame */
+static void tegra_dc_mirror_refresh(struct tegra_dc *dst)
+{
+	mutex_lock(&tegra_dc_mirror_lock);
+	if (dst->mirror_src)
+		tegra_dc_mirror_flip(dst->mirror_src, dst);
+	mutex_unlock(&tegra_dc_mirror_lock);
+}
+
 static unsigned long tegra_dc_clk_get_rate(struct tegra_dc *dc)
 {
 #ifdef CONFIG_TEGRA_SILICON_PLATFORM
@@ -1700,6 +2126,8 @@ static int tegra_dc_program_mode(struct tegra_dc *dc, struct tegra_dc_mode *mode
 
 	print_mode(dc, mode, __func__);
 
+	dc->idle = false;
+
 	/* use default EMC rate when switching modes */
 	dc->new_emc_clk_rate = tegra_dc_get_default_emc_clk_rate(dc);
 	tegra_dc_program_bandwidth(dc);
@@ -2129,12 +2557,29 @@ static u64 tegra_dc_underflow_count(struct tegra_dc *dc, unsigned reg)
 	return ((count & 0x80000000) == 0) ? count : 10000000000ll;
 }
 
+/* Scanout ran short of memory bandwidth: raise the EMC floor */
+static void tegra_dc_underflow_boost_emc(struct tegra_dc *dc)
+{
+	if (!use_dynamic_emc || !emc_underflow_boost)
+		return;
+
+	if (dc->emc_boost < emc_boost_max) {
+		dc->emc_boost = min(dc->emc_boost + emc_underflow_boost,
+				    emc_boost_max);
+		dc->stats.emc_boosts++;
+	}
+	dc->emc_boost_time = jiffies;
+	tegra_dc_apply_emc_boost(dc);
+	tegra_dc_program_bandwidth(dc);
+}
+
 static void tegra_dc_underflow_handler(struct tegra_dc *dc)
 {
 	u32 val;
 	int i;
 
 	dc->stats.underflows++;
+	tegra_dc_underflow_boost_emc(dc);
 	if (dc->underflow_mask & WIN_A_UF_INT)
 		dc->stats.underflows_a += tegra_dc_underflow_count(dc,
 			DC_WINBUF_AD_UFLOW_STATUS);
@@ -2150,6 +2595,17 @@ static void tegra_dc_underflow_handler(struct tegra_dc *dc)
 		if (dc->underflow_mask & (WIN_A_UF_INT << i)) {
 			dc->windows[i].underflows++;
 
+#ifdef CONFIG_TEGRA_SILICON_PLATFORM
+			/* let LA feedback give the window more priority */
+			if (dc->ndev->id < ARRAY_SIZE(la_id_tab)) {
+				tegra_latency_allowance_underflow(
+					la_id_tab[dc->ndev->id][i]);
+				if (i == 1)
+					tegra_latency_allowance_underflow(
+						vfilter_tab[dc->ndev->id]);
+			}
+#endif
+
 #ifdef CONFIG_ARCH_TEGRA_2x_SOC
 			if (dc->windows[i].underflows > 4) {
 				schedule_work(&dc->reset_work);
@@ -2644,6 +3100,8 @@ void tegra_dc_enable(struct tegra_dc *dc)
 		dc->enabled = _tegra_dc_enable(dc);
 
 	mutex_unlock(&dc->lock);
+
+	tegra_dc_mirror_refresh(dc);
 }
 
 static void _tegra_dc_controller_disable(struct tegra_dc *dc)
@@ -2767,6 +3225,7 @@ void tegra_dc_disable(struct tegra_dc *dc)
 	/* it's important that new underflow work isn't scheduled before the
 	 * lock is acquired. */
 	cancel_delayed_work_sync(&dc->underflow_work);
+	cancel_delayed_work_sync(&dc->idle_work);
 	if (dc->out->flags & TEGRA_DC_OUT_ONE_SHOT_MODE) {
 		mutex_lock(&dc->one_shot_lock);
 		cancel_delayed_work_sync(&dc->one_shot_work);
@@ -2979,6 +3438,7 @@ static int tegra_dc_probe(struct nvhost_device *ndev)
 	dc->vblank_ref_count = 0;
 	INIT_DELAYED_WORK(&dc->underflow_work, tegra_dc_underflow_worker);
 	INIT_DELAYED_WORK(&dc->one_shot_work, tegra_dc_one_shot_worker);
+	INIT_DELAYED_WORK(&dc->idle_work, tegra_dc_idle_worker);
 
 	tegra_dc_init_lut_defaults(&dc->fb_lut);
 
@@ -3132,6 +3592,7 @@ static int tegra_dc_suspend(struct nvhost_device *ndev, pm_message_t state)
 	dev_info(&ndev->dev, "suspend\n");
 
 	tegra_dc_ext_disable(dc->ext);
+	cancel_delayed_work_sync(&dc->idle_work);
 
 	mutex_lock(&dc->lock);
 
@@ -52,6 +52,26 @@ struct tegra_dc_blend {
 	unsigned flags[DC_N_WINDOWS];
 };
 
+/* Window geometry as last posted, replayed on a mirroring head */
+struct tegra_dc_mirror_win {
+	u32			flags;
+	u8			fmt;
+	dma_addr_t		phys_addr;
+	dma_addr_t		phys_addr_u;
+	dma_addr_t		phys_addr_v;
+	unsigned		stride;
+	unsigned		stride_uv;
+	fixed20_12		x;
+	fixed20_12		y;
+	fixed20_12		w;
+	fixed20_12		h;
+	unsigned		out_x;
+	unsigned		out_y;
+	unsigned		out_w;
+	unsigned		out_h;
+	unsigned		z;
+};
+
 struct tegra_dc_out_ops {
 	/* initialize output.  dc clocks are not on at this point */
 	int (*init)(struct tegra_dc *dc);
@@ -83,6 +103,10 @@ struct tegra_dc {
 	struct clk			*min_emc_clk;
 	int				emc_clk_rate;
 	int				new_emc_clk_rate;
+	/* EMC rate the window model asks for, before any underflow boost */
+	unsigned long			emc_model_rate;
+	int				emc_boost;	/* percent */
+	unsigned long			emc_boost_time;
 	u32				shift_clk_div;
 
 	bool				connected;
@@ -131,6 +155,17 @@ struct tegra_dc {
 		u64			underflows_a;
 		u64			underflows_b;
 		u64			underflows_c;
+		/* flips through tegra_dc_ext, see ext/dev.c */
+		u64			flips;
+		u64			flips_shown;
+		u64			flips_dropped;
+		u64			missed_vblanks;
+		u64			flip_latency_us;
+		u64			flip_latency_max_us;
+		u64			emc_boosts;
+		u64			idle_entries;
+		u64			mirror_flips;
+		u64			mirror_bw_rejects;
 	} stats;
 
 	struct tegra_dc_ext		*ext;
@@ -142,6 +177,16 @@ struct tegra_dc {
 	struct delayed_work		underflow_work;
 	u32				one_shot_delay_ms;
 	struct delayed_work		one_shot_work;
+
+	/* lower refresh rate while the content is static */
+	struct delayed_work		idle_work;
+	unsigned long			idle_update_time;
+	bool				idle;
+
+	/* hardware mirror, see tegra_dc_set_mirror() */
+	struct tegra_dc			*mirror;	/* head showing ours */
+	struct tegra_dc			*mirror_src;	/* head we show */
+	struct tegra_dc_mirror_win	mirror_wins[DC_N_WINDOWS];
 };
 
 static inline void tegra_dc_io_start(struct tegra_dc *dc)
@@ -202,6 +247,8 @@ static bool tegra_dc_windows_are_dirty(struct tegra_dc *dc);
 
 void tegra_dc_setup_clk(struct tegra_dc *dc, struct clk *clk);
 
+s64 tegra_dc_frame_us(struct tegra_dc *dc);
+
 extern struct tegra_dc_out_ops tegra_dc_rgb_ops;
 extern struct tegra_dc_out_ops tegra_dc_hdmi_ops;
 extern struct tegra_dc_out_ops tegra_dc_dsi_ops;
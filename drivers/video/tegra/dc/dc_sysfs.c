@@ -135,6 +135,41 @@ static ssize_t enable_store(struct device *dev,
 
 static DEVICE_ATTR(enable, S_IRUGO|S_IWUSR, enable_show, enable_store);
 
+static ssize_t mirror_show(struct device *device,
+	struct device_attribute *attr, char *buf)
+{
+	struct nvhost_device *ndev = to_nvhost_device(device);
+	struct tegra_dc *dc = nvhost_get_drvdata(ndev);
+	struct tegra_dc *src = dc->mirror_src;
+
+	return snprintf(buf, PAGE_SIZE, "%d\n", src ? src->ndev->id : -1);
+}
+
+/* index of the head to mirror, -1 to show our own windows again */
+static ssize_t mirror_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct nvhost_device *ndev = to_nvhost_device(dev);
+	struct tegra_dc *dc = nvhost_get_drvdata(ndev);
+	struct tegra_dc *src = NULL;
+	long val;
+	int ret;
+
+	if (strict_strtol(buf, 10, &val) < 0)
+		return -EINVAL;
+
+	if (val >= 0) {
+		src = tegra_dc_get_dc(val);
+		if (!src)
+			return -EINVAL;
+	}
+
+	ret = tegra_dc_set_mirror(dc, src);
+	return ret ? ret : count;
+}
+
+static DEVICE_ATTR(mirror, S_IRUGO|S_IWUSR, mirror_show, mirror_store);
+
 static ssize_t crc_checksum_latched_show(struct device *device,
 	struct device_attribute *attr, char *buf)
 {
@@ -322,6 +357,7 @@ void __devexit tegra_dc_remove_sysfs(struct device *dev)
 	device_remove_file(dev, &dev_attr_mode);
 	device_remove_file(dev, &dev_attr_nvdps);
 	device_remove_file(dev, &dev_attr_enable);
+	device_remove_file(dev, &dev_attr_mirror);
 	device_remove_file(dev, &dev_attr_stats_enable);
 	device_remove_file(dev, &dev_attr_crc_checksum_latched);
 
@@ -344,6 +380,7 @@ void tegra_dc_create_sysfs(struct device *dev)
 	error |= device_create_file(dev, &dev_attr_mode);
 	error |= device_create_file(dev, &dev_attr_nvdps);
 	error |= device_create_file(dev, &dev_attr_enable);
+	error |= device_create_file(dev, &dev_attr_mirror);
 	error |= device_create_file(dev, &dev_attr_stats_enable);
 	error |= device_create_file(dev, &dev_attr_crc_checksum_latched);
 
@@ -23,6 +23,8 @@
 #include <linux/uaccess.h>
 #include <linux/slab.h>
 #include <linux/workqueue.h>
+#include <linux/touch_latency.h>
+#include <linux/frame_trace.h>
 
 #include <video/tegra_dc_ext.h>
 
@@ -34,6 +36,7 @@
 #include "../dc_priv.h"
 /* XXX ew 2 */
 #include "../../host/dev.h"
+#include "../../host/nvhost_fence.h"
 /* XXX ew 3 */
 #include "../../nvmap/nvmap.h"
 #include "tegra_dc_ext_priv.h"
@@ -42,6 +45,11 @@ int tegra_dc_ext_devno;
 struct class *tegra_dc_ext_class;
 static int head_count;
 
+static bool drop_late_flips = true;
+module_param(drop_late_flips, bool, 0644);
+MODULE_PARM_DESC(drop_late_flips,
+	"Drop a flip which missed its vblank when a newer one is queued");
+
 struct tegra_dc_ext_flip_win {
 	struct tegra_dc_ext_flip_windowattr	attr;
 	struct nvmap_handle_ref			*handle[TEGRA_DC_NUM_PLANES];
@@ -49,11 +57,16 @@ struct tegra_dc_ext_flip_win {
 	dma_addr_t				phys_addr_u;
 	dma_addr_t				phys_addr_v;
 	u32					syncpt_max;
+	struct nvhost_fence			*pre_fence;
 };
 
 struct tegra_dc_ext_flip_data {
 	struct tegra_dc_ext		*ext;
 	struct work_struct		work;
+	ktime_t				queued;
+	u32				frame;
+	u32				post_syncpt_id;
+	u32				post_syncpt_val;
 	struct tegra_dc_ext_flip_win	win[DC_N_WINDOWS];
 };
 
@@ -172,6 +185,22 @@ void tegra_dc_ext_disable(struct tegra_dc_ext *ext)
 	}
 }
 
+/* Wait until the buffers of a flip have been rendered */
+static void tegra_dc_ext_wait_pre_flip(struct tegra_dc_ext *ext,
+			       const struct tegra_dc_ext_flip_win *flip_win)
+{
+	if ((s32)flip_win->attr.pre_syncpt_id >= 0) {
+		nvhost_syncpt_wait_timeout(
+				&nvhost_get_host(ext->dc->ndev)->syncpt,
+				flip_win->attr.pre_syncpt_id,
+				flip_win->attr.pre_syncpt_val,
+				msecs_to_jiffies(500), NULL);
+	}
+
+	if (flip_win->pre_fence)
+		nvhost_fence_wait(flip_win->pre_fence, msecs_to_jiffies(500));
+}
+
 static int tegra_dc_ext_set_windowattr(struct tegra_dc_ext *ext,
 			       struct tegra_dc_win *win,
 			       const struct tegra_dc_ext_flip_win *flip_win)
@@ -223,18 +252,33 @@ static int tegra_dc_ext_set_windowattr(struct tegra_dc_ext *ext,
 	win->stride = flip_win->attr.stride;
 	win->stride_uv = flip_win->attr.stride_uv;
 
-	if ((s32)flip_win->attr.pre_syncpt_id >= 0) {
-		nvhost_syncpt_wait_timeout(
-				&nvhost_get_host(ext->dc->ndev)->syncpt,
-				flip_win->attr.pre_syncpt_id,
-				flip_win->attr.pre_syncpt_val,
-				msecs_to_jiffies(500), NULL);
-	}
-
+	tegra_dc_ext_wait_pre_flip(ext, flip_win);
 
 	return 0;
 }
 
+static void tegra_dc_ext_flip_account(struct tegra_dc_ext *ext,
+				      ktime_t queued, bool dropped)
+{
+	struct tegra_dc *dc = ext->dc;
+	s64 frame_us = tegra_dc_frame_us(dc);
+	s64 us = ktime_us_delta(ktime_get(), queued);
+
+	mutex_lock(&dc->lock);
+	if (dropped) {
+		dc->stats.flips_dropped++;
+	} else {
+		dc->stats.flips_shown++;
+		dc->stats.flip_latency_us += us;
+		dc->stats.flip_latency_max_us =
+			max_t(u64, dc->stats.flip_latency_max_us, us);
+		/* scanout within two frames of the flip is on time */
+		if (us >= 2 * frame_us)
+			dc->stats.missed_vblanks += div64_s64(us, frame_us) - 1;
+	}
+	mutex_unlock(&dc->lock);
+}
+
 static void tegra_dc_ext_flip_worker(struct work_struct *work)
 {
 	struct tegra_dc_ext_flip_data *data =
@@ -246,6 +290,29 @@ static void tegra_dc_ext_flip_worker(struct work_struct *work)
 	struct nvmap_handle_ref *old_handle;
 	int i, nr_unpin = 0, nr_win = 0;
 	bool skip_flip = false;
+	bool late;
+
+	/* the flip has missed the vblank following its queueing */
+	late = ktime_us_delta(ktime_get(), data->queued) >
+		tegra_dc_frame_us(ext->dc);
+
+	/*
+	 * A flip superseded by a newer one on the same window is dropped if
+	 * it is a cursor update, or if it is late: showing it now would only
+	 * push the newer flip back by another frame.
+	 */
+	for (i = 0; i < DC_N_WINDOWS; i++) {
+		struct tegra_dc_ext_flip_win *flip_win = &data->win[i];
+		int index = flip_win->attr.index;
+
+		if (index < 0)
+			continue;
+
+		if (!atomic_dec_and_test(&ext->win[index].nr_pending_flips) &&
+		    ((flip_win->attr.flags & TEGRA_DC_EXT_FLIP_FLAG_CURSOR) ||
+		     (late && drop_late_flips)))
+			skip_flip = true;
+	}
 
 	for (i = 0; i < DC_N_WINDOWS; i++) {
 		struct tegra_dc_ext_flip_win *flip_win = &data->win[i];
@@ -259,10 +326,6 @@ static void tegra_dc_ext_flip_worker(struct work_struct *work)
 		win = tegra_dc_get_window(ext->dc, index);
 		ext_win = &ext->win[index];
 
-		if (!(atomic_dec_and_test(&ext_win->nr_pending_flips)) &&
-			(flip_win->attr.flags & TEGRA_DC_EXT_FLIP_FLAG_CURSOR))
-			skip_flip = true;
-
 		if (win->flags & TEGRA_WIN_FLAG_ENABLED) {
 			int j;
 			for (j = 0; j < TEGRA_DC_NUM_PLANES; j++) {
@@ -280,6 +343,9 @@ static void tegra_dc_ext_flip_worker(struct work_struct *work)
 
 		if (!skip_flip)
 			tegra_dc_ext_set_windowattr(ext, win, &data->win[i]);
+		else
+			/* don't hand the buffer back while it is rendered to */
+			tegra_dc_ext_wait_pre_flip(ext, flip_win);
 
 		wins[nr_win++] = win;
 	}
@@ -288,8 +354,13 @@ static void tegra_dc_ext_flip_worker(struct work_struct *work)
 		tegra_dc_update_windows(wins, nr_win);
 		/* TODO: implement swapinterval here */
 		tegra_dc_sync_windows(wins, nr_win);
+		touch_latency_flip_shown(data->queued);
+		frame_trace_scanout(data->frame, ext->dc->ndev->id,
+				    data->post_syncpt_id, data->post_syncpt_val);
 	}
 
+	tegra_dc_ext_flip_account(ext, data->queued, skip_flip);
+
 	for (i = 0; i < DC_N_WINDOWS; i++) {
 		struct tegra_dc_ext_flip_win *flip_win = &data->win[i];
 		int index = flip_win->attr.index;
@@ -299,6 +370,9 @@ static void tegra_dc_ext_flip_worker(struct work_struct *work)
 
 		tegra_dc_incr_syncpt_min(ext->dc, index,
 			flip_win->syncpt_max);
+
+		if (flip_win->pre_fence)
+			nvhost_fence_put(flip_win->pre_fence);
 	}
 
 	/* unpin and deref previous front buffers */
@@ -483,6 +557,16 @@ static int tegra_dc_ext_flip(struct tegra_dc_ext_user *user,
 			flip_win->handle[TEGRA_DC_V] = NULL;
 			flip_win->phys_addr_v = 0;
 		}
+
+		/* the fd is only meaningful in the context of the caller */
+		if (flip_win->attr.flags & TEGRA_DC_EXT_FLIP_FLAG_PRE_FENCE) {
+			flip_win->pre_fence =
+				nvhost_fence_get(flip_win->attr.pre_fence_fd);
+			if (!flip_win->pre_fence) {
+				ret = -EINVAL;
+				goto fail_pin;
+			}
+		}
 	}
 
 	ret = lock_windows_for_flip(user, args);
@@ -494,6 +578,8 @@ static int tegra_dc_ext_flip(struct tegra_dc_ext_user *user,
 		goto unlock;
 	}
 
+	data->frame = frame_trace_flip_queued();
+
 	for (i = 0; i < DC_N_WINDOWS; i++) {
 		u32 syncpt_max;
 		int index = args->win[i].index;
@@ -506,6 +592,11 @@ static int tegra_dc_ext_flip(struct tegra_dc_ext_user *user,
 		win = tegra_dc_get_window(ext->dc, index);
 		ext_win = &ext->win[index];
 
+		/* the render fence ties the flip to the gpu submit */
+		frame_trace_flip(data->frame, ext->dc->ndev->id,
+				 args->win[i].pre_syncpt_id,
+				 args->win[i].pre_syncpt_val);
+
 		syncpt_max = tegra_dc_incr_syncpt_max(ext->dc, index);
 
 		data->win[i].syncpt_max = syncpt_max;
@@ -517,13 +608,20 @@ static int tegra_dc_ext_flip(struct tegra_dc_ext_user *user,
 		args->post_syncpt_val = syncpt_max;
 		args->post_syncpt_id = tegra_dc_get_syncpt_id(ext->dc, index);
 		work_index = index;
+		data->post_syncpt_id = args->post_syncpt_id;
+		data->post_syncpt_val = syncpt_max;
 
 		atomic_inc(&ext->win[work_index].nr_pending_flips);
 	}
 
-	if (work_index >= 0)
+	if (work_index >= 0) {
+		data->queued = ktime_get();
+		touch_latency_flip_queued(data->queued);
+		mutex_lock(&ext->dc->lock);
+		ext->dc->stats.flips++;
+		mutex_unlock(&ext->dc->lock);
 		queue_work(ext->win[work_index].flip_wq, &data->work);
-	else {
+	} else {
 		pr_err("%s: work_index was not calculated\n", __func__);
 		goto fail_pin;
 	}
@@ -545,6 +643,8 @@ fail_pin:
 			nvmap_unpin(ext->nvmap, data->win[i].handle[j]);
 			nvmap_free(ext->nvmap, data->win[i].handle[j]);
 		}
+		if (data->win[i].pre_fence)
+			nvhost_fence_put(data->win[i].pre_fence);
 	}
 	kfree(data);
 
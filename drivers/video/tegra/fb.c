@@ -37,6 +37,7 @@
 #include <mach/dc.h>
 #include <mach/fb.h>
 #include <linux/nvhost.h>
+#include <linux/nvhost_gr2d.h>
 #include <mach/nvmap.h>
 
 #include "host/dev.h"
@@ -340,15 +341,60 @@ static int tegra_fb_pan_display(struct fb_var_screeninfo *var,
 	return 0;
 }
 
+#define TEGRA_FB_GR2D_TIMEOUT_MS	100
+
+/*
+ * Large fills and copies on the linear scanout buffer go to the 2D engine
+ * when it is available; small ones, XOR fills and anything issued from
+ * atomic context (console printk) stay on the CPU.
+ */
+static bool tegra_fb_gr2d_ok(struct fb_info *info, u32 w, u32 h)
+{
+	u32 bpp = info->var.bits_per_pixel;
+
+	if (info->state != FBINFO_STATE_RUNNING || !info->fix.smem_start)
+		return false;
+	if (bpp != 16 && bpp != 32)
+		return false;
+	return w * h * (bpp / 8) >= nvhost_gr2d_threshold;
+}
+
 static void tegra_fb_fillrect(struct fb_info *info,
 			      const struct fb_fillrect *rect)
 {
+	u32 color = rect->color;
+	u32 fence;
+
+	if (rect->rop == ROP_COPY &&
+	    tegra_fb_gr2d_ok(info, rect->width, rect->height)) {
+		if (info->fix.visual == FB_VISUAL_TRUECOLOR ||
+		    info->fix.visual == FB_VISUAL_DIRECTCOLOR)
+			color = ((u32 *)info->pseudo_palette)[color];
+
+		if (!nvhost_gr2d_fill(info->fix.smem_start,
+				info->fix.line_length,
+				info->var.bits_per_pixel, rect->dx, rect->dy,
+				rect->width, rect->height, color, &fence) &&
+		    !nvhost_gr2d_wait(fence, TEGRA_FB_GR2D_TIMEOUT_MS))
+			return;
+	}
+
 	cfb_fillrect(info, rect);
 }
 
 static void tegra_fb_copyarea(struct fb_info *info,
 			      const struct fb_copyarea *region)
 {
+	u32 fence;
+
+	if (tegra_fb_gr2d_ok(info, region->width, region->height) &&
+	    !nvhost_gr2d_copy(info->fix.smem_start, info->fix.line_length,
+			info->var.bits_per_pixel, region->sx, region->sy,
+			region->dx, region->dy, region->width, region->height,
+			&fence) &&
+	    !nvhost_gr2d_wait(fence, TEGRA_FB_GR2D_TIMEOUT_MS))
+		return;
+
 	cfb_copyarea(info, region);
 }
 
@@ -407,6 +407,142 @@ static int nvhost_ioctl_channel_flush(
 	return err;
 }
 
+static int copy_multi_job(struct nvhost_channel_userctx *ctx,
+	struct nvhost_submit_multi_job *desc,
+	struct nvhost_job **jobp)
+{
+	struct nvhost_master *host = nvhost_get_host(ctx->ch->dev);
+	struct nvhost_submit_hdr_ext *hdr = &desc->hdr;
+	struct nvhost_cmdbuf __user *cmdbufs =
+		(void __user *)(uintptr_t)desc->cmdbufs;
+	struct nvhost_reloc __user *relocs =
+		(void __user *)(uintptr_t)desc->relocs;
+	struct nvhost_reloc_shift __user *shifts =
+		(void __user *)(uintptr_t)desc->reloc_shifts;
+	struct nvhost_job *job;
+	int i;
+
+	if (hdr->submit_version > NVHOST_SUBMIT_VERSION_MAX_SUPPORTED ||
+	    !hdr->num_cmdbufs ||
+	    hdr->num_cmdbufs > NVHOST_MAX_GATHERS ||
+	    hdr->num_relocs > NVHOST_MAX_HANDLES ||
+	    hdr->num_waitchks > NVHOST_MAX_WAIT_CHECKS ||
+	    !nvhost_syncpt_is_valid(&host->syncpt, hdr->syncpt_id))
+		return -EINVAL;
+
+	job = nvhost_job_alloc(ctx->ch, ctx->hwctx, hdr, ctx->nvmap,
+			ctx->priority, ctx->clientid);
+	if (!job)
+		return -ENOMEM;
+	job->timeout = ctx->timeout;
+	*jobp = job;
+
+	/* same order as nvhost_channelwrite(): gathers, then relocs */
+	for (i = 0; i < hdr->num_cmdbufs; i++) {
+		struct nvhost_cmdbuf cmdbuf;
+
+		if (copy_from_user(&cmdbuf, &cmdbufs[i], sizeof(cmdbuf)))
+			return -EFAULT;
+		nvhost_job_add_gather(job,
+			cmdbuf.mem, cmdbuf.words, cmdbuf.offset);
+	}
+
+	for (i = 0; i < hdr->num_relocs; i++) {
+		struct nvmap_pinarray_elem *pin = &job->pinarray[job->num_pins];
+
+		if (copy_from_user(pin, &relocs[i], sizeof(*relocs)))
+			return -EFAULT;
+		if (hdr->submit_version >= NVHOST_SUBMIT_VERSION_V2 &&
+		    copy_from_user(&pin->reloc_shift, &shifts[i],
+				    sizeof(*shifts)))
+			return -EFAULT;
+		job->num_pins++;
+	}
+
+	if (copy_from_user(job->waitchk,
+			(void __user *)(uintptr_t)desc->waitchks,
+			hdr->num_waitchks * sizeof(struct nvhost_waitchk)))
+		return -EFAULT;
+	job->num_waitchk = hdr->num_waitchks;
+
+	job->null_kickoff = nvhost_debug_null_kickoff_pid == current->tgid;
+	return 0;
+}
+
+/*
+ * Submit several jobs with one call: all of them are pinned first, and
+ * then pushed to the channel under one hold of its submit lock, with a
+ * single DMAPUT update at the end.
+ */
+static int nvhost_ioctl_channel_submit_multi(
+	struct nvhost_channel_userctx *ctx,
+	struct nvhost_submit_multi_args *args)
+{
+	struct device *device = &ctx->ch->dev->dev;
+	struct nvhost_submit_multi_job __user *ujobs =
+		(void __user *)(uintptr_t)args->jobs;
+	struct nvhost_submit_multi_job *descs;
+	struct nvhost_job *jobs[NVHOST_SUBMIT_MULTI_MAX_JOBS] = { NULL };
+	int num_jobs = args->num_jobs;
+	int i, num_pinned = 0, submitted = 0;
+	int err = 0;
+
+	if (!num_jobs || num_jobs > NVHOST_SUBMIT_MULTI_MAX_JOBS)
+		return -EINVAL;
+
+	if (!ctx->nvmap) {
+		dev_err(device, "no nvmap context set\n");
+		return -EFAULT;
+	}
+
+	descs = kmalloc(num_jobs * sizeof(*descs), GFP_KERNEL);
+	if (!descs)
+		return -ENOMEM;
+
+	if (copy_from_user(descs, ujobs, num_jobs * sizeof(*descs))) {
+		err = -EFAULT;
+		goto out;
+	}
+
+	for (i = 0; i < num_jobs; i++) {
+		err = copy_multi_job(ctx, &descs[i], &jobs[i]);
+		if (err)
+			goto out;
+	}
+
+	for (i = 0; i < num_jobs; i++) {
+		err = nvhost_job_pin(jobs[i]);
+		if (err) {
+			dev_warn(device, "nvhost_job_pin failed: %d\n", err);
+			goto unpin;
+		}
+		num_pinned++;
+		trace_write_cmdbufs(jobs[i]);
+	}
+
+	submitted = nvhost_channel_submit_multi(jobs, num_jobs);
+	if (submitted < 0) {
+		err = submitted;
+		submitted = 0;
+	}
+
+	for (i = 0; i < submitted; i++)
+		if (put_user(jobs[i]->syncpt_end, &ujobs[i].syncpt_end))
+			err = -EFAULT;
+	args->num_submitted = submitted;
+
+unpin:
+	/* the sync queue unpins what has been submitted */
+	for (i = submitted; i < num_pinned; i++)
+		nvhost_job_unpin(jobs[i]);
+out:
+	for (i = 0; i < num_jobs; i++)
+		if (jobs[i])
+			nvhost_job_put(jobs[i]);
+	kfree(descs);
+	return err;
+}
+
 static int nvhost_ioctl_channel_read_3d_reg(
 	struct nvhost_channel_userctx *ctx,
 	struct nvhost_read_3d_reg_args *args)
@@ -507,6 +643,9 @@ static long nvhost_channelctl(struct file *filp,
 	case NVHOST_IOCTL_CHANNEL_READ_3D_REG:
 		err = nvhost_ioctl_channel_read_3d_reg(priv, (void *)buf);
 		break;
+	case NVHOST_IOCTL_CHANNEL_SUBMIT_MULTI:
+		err = nvhost_ioctl_channel_submit_multi(priv, (void *)buf);
+		break;
 	case NVHOST_IOCTL_CHANNEL_GET_CLK_RATE:
 	{
 		unsigned long rate;
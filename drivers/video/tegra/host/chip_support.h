@@ -43,6 +43,7 @@ struct nvhost_chip_support {
 			    struct nvhost_master *,
 			    int chid);
 		int (*submit)(struct nvhost_job *job);
+		int (*submit_multi)(struct nvhost_job **jobs, int num_jobs);
 		int (*read3dreg)(struct nvhost_channel *channel,
 				struct nvhost_hwctx *hwctx,
 				u32 offset,
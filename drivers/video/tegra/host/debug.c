@@ -130,12 +130,99 @@ static const struct file_operations nvhost_debug_fops = {
 	.release	= single_release,
 };
 
+static int show_channel_stats(struct device *dev, void *data)
+{
+	struct nvhost_device *nvdev = to_nvhost_device(dev);
+	struct nvhost_channel *ch = nvdev ? nvdev->channel : NULL;
+	struct nvhost_channel_stats stats;
+	struct seq_file *s = data;
+	unsigned int kicks;
+
+	if (!ch)
+		return 0;
+
+	spin_lock(&ch->stats.lock);
+	stats = ch->stats;
+	spin_unlock(&ch->stats.lock);
+	mutex_lock(&ch->cdma.lock);
+	kicks = ch->cdma.kicks;
+	mutex_unlock(&ch->cdma.lock);
+
+	seq_printf(s, "%-8s %8u %8u %8u %8u %8u %10llu %10llu %8u %10llu "
+		   "%10llu\n",
+		   nvdev->name, stats.calls, stats.jobs, kicks,
+		   stats.gathers, stats.max_gathers,
+		   stats.calls ? div_u64(stats.submit_ns, stats.calls)
+				/ NSEC_PER_USEC : 0,
+		   div_u64(stats.max_submit_ns, NSEC_PER_USEC),
+		   stats.done,
+		   stats.done ? div_u64(stats.done_ns, stats.done)
+				/ NSEC_PER_USEC : 0,
+		   div_u64(stats.max_done_ns, NSEC_PER_USEC));
+	return 0;
+}
+
+static int nvhost_debug_stats_show(struct seq_file *s, void *unused)
+{
+	seq_printf(s, "%-8s %8s %8s %8s %8s %8s %10s %10s %8s %10s %10s\n",
+		   "channel", "calls", "jobs", "kicks", "gathers", "max_gath",
+		   "avg_us", "max_us", "done", "done_avg", "done_max");
+	bus_for_each_dev(&nvhost_bus_type, NULL, s, show_channel_stats);
+	return 0;
+}
+
+static int nvhost_debug_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nvhost_debug_stats_show, inode->i_private);
+}
+
+static const struct file_operations nvhost_debug_stats_fops = {
+	.open		= nvhost_debug_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int nvhost_debug_intr_latency_show(struct seq_file *s, void *unused)
+{
+	struct nvhost_intr *intr = &((struct nvhost_master *)s->private)->intr;
+	const int last = NVHOST_INTR_HIST_BUCKETS - 1;
+	int i;
+
+	seq_printf(s, "%8s %10s %10s\n", "us", "wakeup", "deferred");
+	for (i = 0; i <= last; i++)
+		seq_printf(s, "%2s%6u %10u %10u\n",
+			   i < last ? "<" : ">=",
+			   i < last ? 1U << i : 1U << (i - 1),
+			   atomic_read(&intr->wakeup_hist[i]),
+			   atomic_read(&intr->deferred_hist[i]));
+	return 0;
+}
+
+static int nvhost_debug_intr_latency_open(struct inode *inode,
+					  struct file *file)
+{
+	return single_open(file, nvhost_debug_intr_latency_show,
+			   inode->i_private);
+}
+
+static const struct file_operations nvhost_debug_intr_latency_fops = {
+	.open		= nvhost_debug_intr_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 void nvhost_debug_init(struct nvhost_master *master)
 {
 	struct dentry *de = debugfs_create_dir("tegra_host", NULL);
 
 	debugfs_create_file("status", S_IRUGO, de,
 			master, &nvhost_debug_fops);
+	debugfs_create_file("submit_stats", S_IRUGO, de,
+			master, &nvhost_debug_stats_fops);
+	debugfs_create_file("intr_latency", S_IRUGO, de,
+			master, &nvhost_debug_intr_latency_fops);
 
 	debugfs_create_u32("null_kickoff_pid", S_IRUGO|S_IWUSR, de,
 			&nvhost_debug_null_kickoff_pid);
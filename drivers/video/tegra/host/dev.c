@@ -46,6 +46,7 @@
 #include "t20/t20.h"
 #include "t30/t30.h"
 #include "bus_client.h"
+#include "nvhost_fence.h"
 
 #define DRIVER_NAME		"host1x"
 
@@ -242,6 +243,28 @@ static int nvhost_ioctl_ctrl_module_regrdwr(struct nvhost_ctrl_userctx *ctx,
 	return 0;
 }
 
+static int nvhost_ioctl_ctrl_fence_create(struct nvhost_ctrl_userctx *ctx,
+	struct nvhost_ctrl_fence_create_args *args)
+{
+	int fd = nvhost_fence_create_fd(ctx->dev, args->id, args->thresh);
+
+	if (fd < 0)
+		return fd;
+	args->fence_fd = fd;
+	return 0;
+}
+
+static int nvhost_ioctl_ctrl_fence_merge(struct nvhost_ctrl_userctx *ctx,
+	struct nvhost_ctrl_fence_merge_args *args)
+{
+	int fd = nvhost_fence_merge_fd(args->fd1, args->fd2);
+
+	if (fd < 0)
+		return fd;
+	args->fence_fd = fd;
+	return 0;
+}
+
 static int nvhost_ioctl_ctrl_get_version(struct nvhost_ctrl_userctx *ctx,
 	struct nvhost_get_param_args *args)
 {
@@ -289,6 +312,12 @@ static long nvhost_ctrlctl(struct file *filp,
 	case NVHOST_IOCTL_CTRL_GET_VERSION:
 		err = nvhost_ioctl_ctrl_get_version(priv, (void *)buf);
 		break;
+	case NVHOST_IOCTL_CTRL_FENCE_CREATE:
+		err = nvhost_ioctl_ctrl_fence_create(priv, (void *)buf);
+		break;
+	case NVHOST_IOCTL_CTRL_FENCE_MERGE:
+		err = nvhost_ioctl_ctrl_fence_merge(priv, (void *)buf);
+		break;
 	default:
 		err = -ENOTTY;
 		break;
@@ -20,10 +20,17 @@
 
 #include "dev.h"
 #include "bus_client.h"
+#include "gr2d.h"
 
 static int __devinit gr2d_probe(struct nvhost_device *dev)
 {
-	return nvhost_client_device_init(dev);
+	int err;
+
+	err = nvhost_client_device_init(dev);
+	if (err)
+		return err;
+
+	return nvhost_gr2d_kernel_init(dev);
 }
 
 static int __exit gr2d_remove(struct nvhost_device *dev)
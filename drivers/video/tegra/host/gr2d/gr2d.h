@@ -0,0 +1,30 @@
+/*
+ * drivers/video/tegra/host/gr2d/gr2d.h
+ *
+ * Tegra Graphics 2D
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ */
+
+#ifndef __NVHOST_GR2D_GR2D_H
+#define __NVHOST_GR2D_GR2D_H
+
+struct nvhost_device;
+
+#ifdef CONFIG_TEGRA_GR2D_KERNEL
+int nvhost_gr2d_kernel_init(struct nvhost_device *dev);
+#else
+static inline int nvhost_gr2d_kernel_init(struct nvhost_device *dev)
+{
+	return 0;
+}
+#endif
+
+#endif
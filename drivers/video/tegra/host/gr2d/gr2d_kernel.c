@@ -0,0 +1,468 @@
+/*
+ * drivers/video/tegra/host/gr2d/gr2d_kernel.c
+ *
+ * Tegra Graphics 2D in-kernel fill/copy service
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ */
+
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/err.h>
+#include <linux/hardirq.h>
+#include <linux/jiffies.h>
+#include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/nvhost.h>
+#include <linux/nvhost_ioctl.h>
+#include <linux/nvhost_gr2d.h>
+#include <mach/nvmap.h>
+
+#include "host1x/host1x_hardware.h"
+#include "host1x/host1x_syncpt.h"
+#include "nvhost_channel.h"
+#include "nvhost_job.h"
+#include "nvhost_acm.h"
+#include "dev.h"
+#include "gr2d.h"
+
+#define NV_GRAPHICS_2D_CLASS_ID		0x51
+
+/* G2 registers */
+#define AR2D_TRIGGER			0x09
+#define AR2D_CMDSEL			0x0c
+#define AR2D_CONTROLSECOND		0x1e
+#define AR2D_CONTROLMAIN		0x1f
+#define AR2D_ROPFADE			0x20
+#define AR2D_DSTBA			0x2b
+#define AR2D_DSTST			0x2e
+#define AR2D_SRCBA			0x31
+#define AR2D_SRCST			0x33
+#define AR2D_SRCFGC			0x35
+#define AR2D_DSTSIZE			0x38
+#define AR2D_SRCPS			0x39
+#define AR2D_DSTPS			0x3a
+#define AR2D_TILEMODE			0x46
+
+#define CONTROLMAIN_TURBOFILL		(1 << 2)
+#define CONTROLMAIN_SRCSLD		(1 << 6)
+#define CONTROLMAIN_DSTCD_SHIFT		16
+#define ROPFADE_SRCCOPY			0xcc
+
+/* Largest width/height/position accepted by the engine */
+#define GR2D_MAX_DIM			16383
+/* Surface shape used to clear linear memory: 1024 x 32bpp rows */
+#define GR2D_CLEAR_PITCH		4096
+
+#define GR2D_CMDBUF_SIZE		4096
+#define GR2D_SLOTS			8
+#define GR2D_SLOT_WORDS			(GR2D_CMDBUF_SIZE / 4 / GR2D_SLOTS)
+#define GR2D_WAIT_TIMEOUT_MS		1000
+
+struct gr2d_kernel {
+	struct nvhost_device *dev;
+	struct nvhost_channel *ch;
+	struct nvhost_syncpt *sp;
+	struct nvmap_client *nvmap;
+	struct nvmap_handle_ref *cmdbuf;
+	u32 *cmdbuf_virt;
+	struct nvhost_job *job;
+	struct nvhost_submit_hdr_ext hdr;
+	int clientid;
+	u32 syncpt_id;
+
+	/* Protects everything below and the channel state above */
+	struct mutex lock;
+	bool opened;
+	unsigned int slot;
+	u32 slot_fence[GR2D_SLOTS];
+
+	unsigned long fills;
+	unsigned long copies;
+	unsigned long clears;
+	unsigned long errors;
+	u64 bytes;
+};
+
+static struct gr2d_kernel *gr2d_kernel;
+
+unsigned int nvhost_gr2d_threshold = 256 * 1024;
+module_param_named(threshold, nvhost_gr2d_threshold, uint, 0644);
+
+static int gr2d_bpp_code(u32 bpp)
+{
+	switch (bpp) {
+	case 8:
+		return 0;
+	case 16:
+		return 1;
+	case 32:
+		return 2;
+	default:
+		return -EINVAL;
+	}
+}
+
+/* Bring up the channel, command buffer and job on first use */
+static int gr2d_kernel_open(struct gr2d_kernel *k)
+{
+	int i;
+
+	if (k->opened)
+		return 0;
+
+	k->ch = nvhost_getchannel(k->dev->channel);
+	if (!k->ch)
+		return -ENOMEM;
+
+	if (nvhost_module_add_client(k->dev, k))
+		goto fail_channel;
+
+	k->nvmap = nvmap_create_client(nvmap_dev, "gr2d_kernel");
+	if (IS_ERR_OR_NULL(k->nvmap)) {
+		k->nvmap = NULL;
+		goto fail_client;
+	}
+
+	k->cmdbuf = nvmap_alloc(k->nvmap, GR2D_CMDBUF_SIZE, 32,
+				NVMAP_HANDLE_WRITE_COMBINE, 0);
+	if (IS_ERR_OR_NULL(k->cmdbuf)) {
+		k->cmdbuf = NULL;
+		goto fail_nvmap;
+	}
+
+	k->cmdbuf_virt = nvmap_mmap(k->cmdbuf);
+	if (!k->cmdbuf_virt)
+		goto fail_cmdbuf;
+
+	k->sp = &nvhost_get_host(k->dev)->syncpt;
+	k->syncpt_id = NVSYNCPT_2D_0;
+	k->clientid = atomic_add_return(1,
+			&nvhost_get_host(k->dev)->clientid);
+
+	k->hdr.syncpt_id = k->syncpt_id;
+	k->hdr.syncpt_incrs = 1;
+	k->hdr.num_cmdbufs = 1;
+	k->job = nvhost_job_alloc(k->ch, NULL, &k->hdr, k->nvmap,
+			NVHOST_PRIORITY_MEDIUM, k->clientid);
+	if (!k->job)
+		goto fail_mmap;
+
+	for (i = 0; i < GR2D_SLOTS; i++)
+		k->slot_fence[i] = nvhost_syncpt_read(k->sp, k->syncpt_id);
+	k->slot = 0;
+	k->opened = true;
+	return 0;
+
+fail_mmap:
+	nvmap_munmap(k->cmdbuf, k->cmdbuf_virt);
+fail_cmdbuf:
+	nvmap_free(k->nvmap, k->cmdbuf);
+fail_nvmap:
+	nvmap_client_put(k->nvmap);
+fail_client:
+	nvhost_module_remove_client(k->dev, k);
+fail_channel:
+	nvhost_putchannel(k->ch, NULL);
+	return -ENOMEM;
+}
+
+/*
+ * Claim the next command buffer slot, waiting for the job that last used
+ * it to retire.
+ */
+static u32 *gr2d_kernel_get_slot(struct gr2d_kernel *k)
+{
+	int err;
+
+	err = nvhost_syncpt_wait_timeout(k->sp, k->syncpt_id,
+			k->slot_fence[k->slot],
+			msecs_to_jiffies(GR2D_WAIT_TIMEOUT_MS), NULL);
+	if (err)
+		return ERR_PTR(err);
+
+	return k->cmdbuf_virt + k->slot * GR2D_SLOT_WORDS;
+}
+
+static int gr2d_kernel_submit(struct gr2d_kernel *k, u32 *cmd, u32 *end,
+			      u32 *fence)
+{
+	struct nvhost_job *job;
+	u32 words = end - cmd;
+	int err;
+
+	BUG_ON(words > GR2D_SLOT_WORDS);
+	wmb();
+
+	/* a failed realloc drops the old job too, start over next time */
+	if (k->job)
+		job = nvhost_job_realloc(k->job, NULL, &k->hdr, k->nvmap,
+				NVHOST_PRIORITY_MEDIUM, k->clientid);
+	else
+		job = nvhost_job_alloc(k->ch, NULL, &k->hdr, k->nvmap,
+				NVHOST_PRIORITY_MEDIUM, k->clientid);
+	k->job = job;
+	if (!job)
+		return -ENOMEM;
+
+	nvhost_job_add_gather(k->job, (u32)nvmap_ref_to_handle(k->cmdbuf),
+			words, k->slot * GR2D_SLOT_WORDS * 4);
+
+	err = nvhost_job_pin(k->job);
+	if (err)
+		return err;
+
+	err = nvhost_channel_submit(k->job);
+	if (err) {
+		nvhost_job_unpin(k->job);
+		return err;
+	}
+
+	k->slot_fence[k->slot] = k->job->syncpt_end;
+	k->slot = (k->slot + 1) % GR2D_SLOTS;
+	if (fence)
+		*fence = k->job->syncpt_end;
+	return 0;
+}
+
+static u32 *gr2d_kernel_setup(u32 *cmd, u32 controlmain)
+{
+	*cmd++ = nvhost_opcode_setclass(NV_GRAPHICS_2D_CLASS_ID, 0, 0);
+	*cmd++ = nvhost_opcode_mask(AR2D_TRIGGER, 0x9);
+	*cmd++ = AR2D_DSTPS;
+	*cmd++ = 0;
+	*cmd++ = nvhost_opcode_mask(AR2D_CONTROLSECOND, 0x7);
+	*cmd++ = 0;
+	*cmd++ = controlmain;
+	*cmd++ = ROPFADE_SRCCOPY;
+	*cmd++ = nvhost_opcode_nonincr(AR2D_TILEMODE, 1);
+	*cmd++ = 0;
+	return cmd;
+}
+
+static u32 *gr2d_kernel_emit_fill(u32 *cmd, phys_addr_t base, u32 pitch,
+		u32 x, u32 y, u32 w, u32 h)
+{
+	*cmd++ = nvhost_opcode_mask(AR2D_DSTBA, 0x9);
+	*cmd++ = base;
+	*cmd++ = pitch;
+	*cmd++ = nvhost_opcode_mask(AR2D_DSTSIZE, 0x5);
+	*cmd++ = (h << 16) | w;
+	*cmd++ = (y << 16) | x;
+	return cmd;
+}
+
+static struct gr2d_kernel *gr2d_kernel_get(void)
+{
+	struct gr2d_kernel *k = gr2d_kernel;
+
+	if (!k)
+		return ERR_PTR(-ENODEV);
+	if (in_atomic() || irqs_disabled())
+		return ERR_PTR(-EWOULDBLOCK);
+	return k;
+}
+
+int nvhost_gr2d_fill(phys_addr_t base, u32 pitch, u32 bpp,
+		u32 x, u32 y, u32 w, u32 h, u32 color, u32 *fence)
+{
+	struct gr2d_kernel *k = gr2d_kernel_get();
+	int code = gr2d_bpp_code(bpp);
+	u32 *start, *cmd;
+	int err;
+
+	if (IS_ERR(k))
+		return PTR_ERR(k);
+	if (code < 0 || !pitch || !w || !h || w > GR2D_MAX_DIM ||
+	    h > GR2D_MAX_DIM || x > GR2D_MAX_DIM || y > GR2D_MAX_DIM)
+		return -EINVAL;
+
+	mutex_lock(&k->lock);
+	err = gr2d_kernel_open(k);
+	if (err)
+		goto out;
+
+	start = gr2d_kernel_get_slot(k);
+	if (IS_ERR(start)) {
+		err = PTR_ERR(start);
+		goto out;
+	}
+
+	cmd = gr2d_kernel_setup(start, (code << CONTROLMAIN_DSTCD_SHIFT) |
+			CONTROLMAIN_SRCSLD | CONTROLMAIN_TURBOFILL);
+	*cmd++ = nvhost_opcode_nonincr(AR2D_SRCFGC, 1);
+	*cmd++ = color;
+	cmd = gr2d_kernel_emit_fill(cmd, base, pitch, x, y, w, h);
+	*cmd++ = nvhost_opcode_imm_incr_syncpt(NV_SYNCPT_OP_DONE,
+			k->syncpt_id);
+
+	err = gr2d_kernel_submit(k, start, cmd, fence);
+	if (!err) {
+		k->fills++;
+		k->bytes += (u64)w * h * (bpp / 8);
+	}
+out:
+	if (err)
+		k->errors++;
+	mutex_unlock(&k->lock);
+	return err;
+}
+EXPORT_SYMBOL(nvhost_gr2d_fill);
+
+/*
+ * The engine is programmed with a single pass, so overlapping source and
+ * destination rectangles are refused and left to the caller.
+ */
+int nvhost_gr2d_copy(phys_addr_t base, u32 pitch, u32 bpp,
+		u32 sx, u32 sy, u32 dx, u32 dy, u32 w, u32 h, u32 *fence)
+{
+	struct gr2d_kernel *k = gr2d_kernel_get();
+	int code = gr2d_bpp_code(bpp);
+	u32 *start, *cmd;
+	int err;
+
+	if (IS_ERR(k))
+		return PTR_ERR(k);
+	if (code < 0 || !pitch || !w || !h || w > GR2D_MAX_DIM ||
+	    h > GR2D_MAX_DIM || sx > GR2D_MAX_DIM || sy > GR2D_MAX_DIM ||
+	    dx > GR2D_MAX_DIM || dy > GR2D_MAX_DIM)
+		return -EINVAL;
+	if (sx < dx + w && dx < sx + w && sy < dy + h && dy < sy + h)
+		return -EINVAL;
+
+	mutex_lock(&k->lock);
+	err = gr2d_kernel_open(k);
+	if (err)
+		goto out;
+
+	start = gr2d_kernel_get_slot(k);
+	if (IS_ERR(start)) {
+		err = PTR_ERR(start);
+		goto out;
+	}
+
+	cmd = gr2d_kernel_setup(start, code << CONTROLMAIN_DSTCD_SHIFT);
+	*cmd++ = nvhost_opcode_mask(AR2D_DSTBA, 0xe149);
+	*cmd++ = base;				/* dstba */
+	*cmd++ = pitch;				/* dstst */
+	*cmd++ = base;				/* srcba */
+	*cmd++ = pitch;				/* srcst */
+	*cmd++ = (h << 16) | w;			/* dstsize */
+	*cmd++ = (sy << 16) | sx;		/* srcps */
+	*cmd++ = (dy << 16) | dx;		/* dstps */
+	*cmd++ = nvhost_opcode_imm_incr_syncpt(NV_SYNCPT_OP_DONE,
+			k->syncpt_id);
+
+	err = gr2d_kernel_submit(k, start, cmd, fence);
+	if (!err) {
+		k->copies++;
+		k->bytes += (u64)w * h * (bpp / 8);
+	}
+out:
+	if (err)
+		k->errors++;
+	mutex_unlock(&k->lock);
+	return err;
+}
+EXPORT_SYMBOL(nvhost_gr2d_copy);
+
+int nvhost_gr2d_wait(u32 fence, u32 timeout_ms)
+{
+	struct gr2d_kernel *k = gr2d_kernel_get();
+
+	if (IS_ERR(k))
+		return PTR_ERR(k);
+	if (!k->opened)
+		return 0;
+
+	return nvhost_syncpt_wait_timeout(k->sp, k->syncpt_id, fence,
+			msecs_to_jiffies(timeout_ms), NULL);
+}
+EXPORT_SYMBOL(nvhost_gr2d_wait);
+
+/*
+ * Linear memory is cleared as a stack of GR2D_CLEAR_PITCH wide 32bpp
+ * rows, GR2D_MAX_DIM rows per job.
+ */
+int nvhost_gr2d_clear(phys_addr_t base, size_t size)
+{
+	u32 rows = size / GR2D_CLEAR_PITCH;
+	u32 fence = 0;
+	int err = 0;
+
+	if (!rows || size % GR2D_CLEAR_PITCH || base & 0xf)
+		return -EINVAL;
+
+	while (rows && !err) {
+		u32 h = min_t(u32, rows, GR2D_MAX_DIM);
+
+		err = nvhost_gr2d_fill(base, GR2D_CLEAR_PITCH, 32, 0, 0,
+				GR2D_CLEAR_PITCH / 4, h, 0, &fence);
+		base += h * GR2D_CLEAR_PITCH;
+		rows -= h;
+	}
+	if (!err)
+		err = nvhost_gr2d_wait(fence, GR2D_WAIT_TIMEOUT_MS);
+	if (!err) {
+		mutex_lock(&gr2d_kernel->lock);
+		gr2d_kernel->clears++;
+		mutex_unlock(&gr2d_kernel->lock);
+	}
+
+	return err;
+}
+EXPORT_SYMBOL(nvhost_gr2d_clear);
+
+static int gr2d_kernel_stats_show(struct seq_file *s, void *data)
+{
+	struct gr2d_kernel *k = s->private;
+
+	mutex_lock(&k->lock);
+	seq_printf(s, "threshold: %u\n", nvhost_gr2d_threshold);
+	seq_printf(s, "fills:     %lu\n", k->fills);
+	seq_printf(s, "copies:    %lu\n", k->copies);
+	seq_printf(s, "clears:    %lu\n", k->clears);
+	seq_printf(s, "errors:    %lu\n", k->errors);
+	seq_printf(s, "bytes:     %llu\n", k->bytes);
+	mutex_unlock(&k->lock);
+	return 0;
+}
+
+static int gr2d_kernel_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, gr2d_kernel_stats_show, inode->i_private);
+}
+
+static const struct file_operations gr2d_kernel_stats_fops = {
+	.open		= gr2d_kernel_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+int nvhost_gr2d_kernel_init(struct nvhost_device *dev)
+{
+	struct gr2d_kernel *k;
+
+	if (gr2d_kernel)
+		return 0;
+
+	k = kzalloc(sizeof(*k), GFP_KERNEL);
+	if (!k)
+		return -ENOMEM;
+
+	k->dev = dev;
+	mutex_init(&k->lock);
+	debugfs_create_file("gr2d_kernel", S_IRUGO, NULL, k,
+			    &gr2d_kernel_stats_fops);
+	gr2d_kernel = k;
+	return 0;
+}
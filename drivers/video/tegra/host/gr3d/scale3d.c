@@ -32,9 +32,17 @@
  *
  * 3d.emc clock is scaled proportionately to 3d clock, with a quadratic-
  * bezier-like factor added to pull 3d.emc rate a bit lower.
+ *
+ * In frame mode (scale3d.p_frame_mode) the idle percentage is not used.
+ * nvhost_scale3d_notify_job_done() is called as each submit completes, and
+ * the time the 3d unit spent on submits is added up over a frame budget
+ * (scale3d.p_frame_budget). The 3d clock is then set straight to the rate
+ * that would have fit that work into p_frame_target percent of the budget.
+ * The rate goes up at once, and comes down over a few frames.
  */
 
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/types.h>
 #include <linux/clk.h>
 #include <mach/clk.h>
@@ -47,6 +55,8 @@ static void scale3d_enable(int enable);
 
 #define POW2(x) ((x) * (x))
 
+#define SCALE3D_MAX_LEVELS 16
+
 /*
  * debugfs parameters to control 3d clock scaling test
  *
@@ -59,6 +69,9 @@ static void scale3d_enable(int enable);
  * max_scale     - limits rate changes to no less than (100 - max_scale)% or
  *                 (100 + 2 * max_scale)% of current clock rate
  * verbosity     - set above 5 for debug printouts
+ * frame_mode    - scale on completed submits against a frame budget
+ * frame_budget  - frame time in microseconds
+ * frame_target  - percent of frame_budget the 3d work should take
  */
 
 struct scale3d_info_rec {
@@ -100,26 +113,68 @@ struct scale3d_info_rec {
 	unsigned int p_scale_emc;
 	unsigned int p_emc_dip;
 	unsigned int p_verbosity;
+	unsigned int p_frame_mode;
+	unsigned int p_frame_budget;
+	unsigned int p_frame_target;
+	ktime_t frame_start;
+	ktime_t last_done;
+	unsigned long frame_busy;
+	unsigned long frame_rate;
+	unsigned long frames;
+	unsigned long deadline_misses;
 	struct clk *clk_3d;
 	struct clk *clk_3d2;
 	struct clk *clk_3d_emc;
+	/* residency, protected by stats_lock */
+	spinlock_t stats_lock;
+	int nr_levels;
+	int cur_level;
+	ktime_t level_since;
+	unsigned long levels[SCALE3D_MAX_LEVELS];
+	u64 residency_us[SCALE3D_MAX_LEVELS];
 };
 
 static struct scale3d_info_rec scale3d;
 
-static void scale3d_clocks(unsigned long percent)
+/* charge the time since the last change to the current level */
+static void scale3d_account_level(void)
 {
-	unsigned long hz, curr;
+	unsigned long rate = clk_get_rate(scale3d.clk_3d);
+	unsigned long flags;
+	ktime_t t;
+	int i;
 
-	if (!tegra_is_clk_enabled(scale3d.clk_3d))
+	if (!scale3d.nr_levels)
 		return;
 
+	for (i = 0; i < scale3d.nr_levels - 1; i++)
+		if (scale3d.levels[i] >= rate)
+			break;
+
+	spin_lock_irqsave(&scale3d.stats_lock, flags);
+	t = ktime_get();
+	scale3d.residency_us[scale3d.cur_level] +=
+		ktime_us_delta(t, scale3d.level_since);
+	scale3d.level_since = t;
+	scale3d.cur_level = i;
+	spin_unlock_irqrestore(&scale3d.stats_lock, flags);
+}
+
+static int scale3d_clocks_enabled(void)
+{
+	if (!tegra_is_clk_enabled(scale3d.clk_3d))
+		return 0;
+
 	if (tegra_get_chipid() == TEGRA_CHIPID_TEGRA3)
 		if (!tegra_is_clk_enabled(scale3d.clk_3d2))
-			return;
+			return 0;
 
-	curr = clk_get_rate(scale3d.clk_3d);
-	hz = percent * (curr / 100);
+	return 1;
+}
+
+static void scale3d_set_rate(unsigned long hz)
+{
+	unsigned long curr = clk_get_rate(scale3d.clk_3d);
 
 	if (!(hz >= scale3d.max_rate_3d && curr == scale3d.max_rate_3d)) {
 		if (tegra_get_chipid() == TEGRA_CHIPID_TEGRA3)
@@ -136,18 +191,36 @@ static void scale3d_clocks(unsigned long percent)
 					scale3d.emc_dip_offset);
 			clk_set_rate(scale3d.clk_3d_emc, hz);
 		}
+		scale3d_account_level();
 	}
 }
 
+static void scale3d_clocks(unsigned long percent)
+{
+	unsigned long curr;
+
+	if (!scale3d_clocks_enabled())
+		return;
+
+	curr = clk_get_rate(scale3d.clk_3d);
+	scale3d_set_rate(percent * (curr / 100));
+}
+
 static void scale3d_clocks_handler(struct work_struct *work)
 {
+	unsigned long rate = 0;
 	unsigned int scale;
 
 	mutex_lock(&scale3d.lock);
 	scale = scale3d.scale;
+	if (scale3d.p_frame_mode)
+		rate = scale3d.frame_rate;
 	mutex_unlock(&scale3d.lock);
 
-	if (scale != 0)
+	if (rate) {
+		if (scale3d_clocks_enabled())
+			scale3d_set_rate(rate);
+	} else if (scale != 0)
 		scale3d_clocks(scale);
 }
 
@@ -170,6 +243,7 @@ static void reset_3d_clocks(void)
 		if (scale3d.p_scale_emc)
 			clk_set_rate(scale3d.clk_3d_emc,
 				clk_round_rate(scale3d.clk_3d_emc, UINT_MAX));
+		scale3d_account_level();
 	}
 }
 
@@ -379,7 +453,7 @@ void nvhost_scale3d_notify_idle(struct nvhost_device *dev)
 	ktime_t t;
 	unsigned long dt;
 
-	if (!scale3d.enable)
+	if (!scale3d.enable || scale3d.p_frame_mode)
 		return;
 
 	mutex_lock(&scale3d.lock);
@@ -413,7 +487,7 @@ void nvhost_scale3d_notify_busy(struct nvhost_device *dev)
 	unsigned long short_term_idle;
 	ktime_t t;
 
-	if (!scale3d.enable)
+	if (!scale3d.enable || scale3d.p_frame_mode)
 		return;
 
 	mutex_lock(&scale3d.lock);
@@ -437,6 +511,64 @@ void nvhost_scale3d_notify_busy(struct nvhost_device *dev)
 	mutex_unlock(&scale3d.lock);
 }
 
+/*
+ * A submit has completed. The time the 3d unit spent on it runs from the
+ * later of its submission and the completion of the previous submit, as
+ * submits are executed in order.
+ */
+void nvhost_scale3d_notify_job_done(struct nvhost_device *dev,
+				    ktime_t submitted)
+{
+	unsigned long budget, curr, need;
+	ktime_t t, start;
+	s64 busy;
+
+	if (!scale3d.enable || !scale3d.p_frame_mode)
+		return;
+
+	mutex_lock(&scale3d.lock);
+
+	t = ktime_get();
+	start = ktime_to_ns(submitted) > ktime_to_ns(scale3d.last_done) ?
+		submitted : scale3d.last_done;
+	busy = ktime_us_delta(t, start);
+	scale3d.last_done = t;
+
+	scale3d.frames++;
+	if (ktime_us_delta(t, submitted) > scale3d.p_frame_budget)
+		scale3d.deadline_misses++;
+
+	if (busy > 0)
+		scale3d.frame_busy += busy;
+
+	/*
+	 * Predict once per frame budget, or as soon as the work done so far
+	 * no longer fits the target.
+	 */
+	budget = max(scale3d.p_frame_budget * scale3d.p_frame_target / 100, 1U);
+	if (scale3d.frame_busy <= budget &&
+	    ktime_us_delta(t, scale3d.frame_start) < scale3d.p_frame_budget)
+		goto done;
+
+	curr = clk_get_rate(scale3d.clk_3d);
+	need = div_u64((u64)curr * scale3d.frame_busy, budget);
+	if (need < scale3d.frame_rate)
+		need = scale3d.frame_rate - (scale3d.frame_rate - need) / 4;
+	need = clamp(need, scale3d.min_rate_3d, scale3d.max_rate_3d);
+
+	if (scale3d.p_verbosity >= 5)
+		pr_info("scale3d: frame busy %lu us at %lu, want %lu\n",
+			scale3d.frame_busy, curr, need);
+
+	scale3d.frame_rate = need;
+	scale3d.frame_busy = 0;
+	scale3d.frame_start = t;
+	if (clk_round_rate(scale3d.clk_3d, need) != curr)
+		schedule_work(&scale3d.work);
+done:
+	mutex_unlock(&scale3d.lock);
+}
+
 static void scale3d_idle_handler(struct work_struct *work)
 {
 	int notify_idle = 0;
@@ -468,9 +600,44 @@ void nvhost_scale3d_reset()
 	t = ktime_get();
 	mutex_lock(&scale3d.lock);
 	reset_scaling_counters(t);
+	scale3d.frame_start = t;
+	scale3d.frame_busy = 0;
 	mutex_unlock(&scale3d.lock);
 }
 
+static int scale3d_frame_stats_show(struct seq_file *s, void *unused)
+{
+	unsigned long flags;
+	int i;
+
+	scale3d_account_level();
+
+	mutex_lock(&scale3d.lock);
+	seq_printf(s, "frames: %lu\ndeadline_misses: %lu\nframe_rate: %lu\n",
+		   scale3d.frames, scale3d.deadline_misses, scale3d.frame_rate);
+	mutex_unlock(&scale3d.lock);
+
+	seq_printf(s, "%10s %12s\n", "rate(kHz)", "time(ms)");
+	spin_lock_irqsave(&scale3d.stats_lock, flags);
+	for (i = 0; i < scale3d.nr_levels; i++)
+		seq_printf(s, "%10lu %12llu\n", scale3d.levels[i] / 1000,
+			   div_u64(scale3d.residency_us[i], 1000));
+	spin_unlock_irqrestore(&scale3d.stats_lock, flags);
+	return 0;
+}
+
+static int scale3d_frame_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, scale3d_frame_stats_show, NULL);
+}
+
+static const struct file_operations scale3d_frame_stats_fops = {
+	.open		= scale3d_frame_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /*
  * debugfs parameters to control 3d clock scaling
  */
@@ -503,7 +670,15 @@ void nvhost_scale3d_debug_init(struct dentry *de)
 	CREATE_SCALE3D_FILE(scale_emc);
 	CREATE_SCALE3D_FILE(emc_dip);
 	CREATE_SCALE3D_FILE(verbosity);
+	CREATE_SCALE3D_FILE(frame_mode);
+	CREATE_SCALE3D_FILE(frame_budget);
+	CREATE_SCALE3D_FILE(frame_target);
 #undef CREATE_SCALE3D_FILE
+
+	f = debugfs_create_file("frame_stats", S_IRUGO, d, NULL,
+				&scale3d_frame_stats_fops);
+	if (NULL == f)
+		pr_err("scale3d: can\'t create file frame_stats\n");
 }
 
 static ssize_t enable_3d_scaling_show(struct device *device,
@@ -536,7 +711,7 @@ void nvhost_scale3d_init(struct nvhost_device *d)
 {
 	if (!scale3d.init) {
 		int error;
-		unsigned long max_emc, min_emc;
+		unsigned long max_emc, min_emc, rate;
 		long correction;
 		mutex_init(&scale3d.lock);
 
@@ -560,6 +735,23 @@ void nvhost_scale3d_init(struct nvhost_device *d)
 			return;
 		}
 
+		/* the 3d rates the clock rounds to, for residency */
+		spin_lock_init(&scale3d.stats_lock);
+		rate = scale3d.min_rate_3d;
+		while (scale3d.nr_levels < SCALE3D_MAX_LEVELS) {
+			unsigned long next;
+
+			scale3d.levels[scale3d.nr_levels++] = rate;
+			if (rate >= scale3d.max_rate_3d)
+				break;
+			next = clk_round_rate(scale3d.clk_3d, rate + 1);
+			if (next <= rate)
+				break;
+			rate = next;
+		}
+		scale3d.level_since = ktime_get();
+		scale3d_account_level();
+
 		/* emc scaling:
 		 *
 		 * Remc = S * R3d + O - (Sd * (R3d - Rm)^2 + Od)
@@ -642,6 +834,9 @@ void nvhost_scale3d_init(struct nvhost_device *d)
 		scale3d.p_emc_dip = 1;
 		scale3d.p_verbosity = 0;
 		scale3d.p_adjust = 1;
+		scale3d.p_frame_mode = 1;
+		scale3d.p_frame_budget = 16667;
+		scale3d.p_frame_target = 80;
 
 		error = device_create_file(&d->dev,
 				&dev_attr_enable_3d_scaling);
@@ -21,6 +21,8 @@
 #ifndef NVHOST_T30_SCALE3D_H
 #define NVHOST_T30_SCALE3D_H
 
+#include <linux/ktime.h>
+
 struct nvhost_device;
 struct device;
 struct dentry;
@@ -42,6 +44,9 @@ void nvhost_scale3d_reset(void);
 void nvhost_scale3d_notify_busy(struct nvhost_device *);
 void nvhost_scale3d_notify_idle(struct nvhost_device *);
 
+/* call when a submit made at the given time has completed */
+void nvhost_scale3d_notify_job_done(struct nvhost_device *, ktime_t);
+
 void nvhost_scale3d_debug_init(struct dentry *de);
 
 #endif
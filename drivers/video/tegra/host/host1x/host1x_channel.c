@@ -189,7 +189,8 @@ void submit_gathers(struct nvhost_job *job)
 	}
 }
 
-int host1x_channel_submit(struct nvhost_job *job)
+/* Called with the channel submit lock held */
+static int channel_submit_locked(struct nvhost_job *job)
 {
 	struct nvhost_channel *ch = job->ch;
 	struct nvhost_syncpt *sp = &nvhost_get_host(job->ch->dev)->syncpt;
@@ -203,6 +204,8 @@ int host1x_channel_submit(struct nvhost_job *job)
 	if (job->hwctx && job->hwctx->has_timedout)
 		return -ETIMEDOUT;
 
+	job->submit_time = ktime_get();
+
 	/* Turn on the client module and host1x */
 	nvhost_module_busy(ch->dev);
 	if (ch->dev->busy)
@@ -212,26 +215,18 @@ int host1x_channel_submit(struct nvhost_job *job)
 	prev_max = job->syncpt_end =
 		nvhost_syncpt_read_max(sp, job->syncpt_id);
 
-	/* get submit lock */
-	err = mutex_lock_interruptible(&ch->submitlock);
-	if (err) {
-		nvhost_module_idle(ch->dev);
-		goto error;
-	}
-
 	/* Do the needed allocations */
 	ctxsave_waiter = pre_submit_ctxsave(job, ch->cur_ctx);
 	if (IS_ERR(ctxsave_waiter)) {
 		err = PTR_ERR(ctxsave_waiter);
+		ctxsave_waiter = NULL;
 		nvhost_module_idle(ch->dev);
-		mutex_unlock(&ch->submitlock);
 		goto error;
 	}
 
 	completed_waiter = nvhost_intr_alloc_waiter();
 	if (!completed_waiter) {
 		nvhost_module_idle(ch->dev);
-		mutex_unlock(&ch->submitlock);
 		err = -ENOMEM;
 		goto error;
 	}
@@ -246,7 +241,6 @@ int host1x_channel_submit(struct nvhost_job *job)
 		if (err) {
 			dev_warn(&ch->dev->dev,
 				 "nvhost_syncpt_wait_check failed: %d\n", err);
-			mutex_unlock(&ch->submitlock);
 			nvhost_module_idle(ch->dev);
 			goto error;
 		}
@@ -255,7 +249,6 @@ int host1x_channel_submit(struct nvhost_job *job)
 	/* begin a CDMA submit */
 	err = nvhost_cdma_begin(&ch->cdma, job);
 	if (err) {
-		mutex_unlock(&ch->submitlock);
 		nvhost_module_idle(ch->dev);
 		goto error;
 	}
@@ -297,8 +290,6 @@ int host1x_channel_submit(struct nvhost_job *job)
 	completed_waiter = NULL;
 	WARN(err, "Failed to set submit complete interrupt");
 
-	mutex_unlock(&ch->submitlock);
-
 	return 0;
 
 error:
@@ -307,6 +298,48 @@ error:
 	return err;
 }
 
+int host1x_channel_submit(struct nvhost_job *job)
+{
+	struct nvhost_channel *ch = job->ch;
+	int err;
+
+	/* get submit lock */
+	err = mutex_lock_interruptible(&ch->submitlock);
+	if (err)
+		return err;
+
+	err = channel_submit_locked(job);
+
+	mutex_unlock(&ch->submitlock);
+	return err;
+}
+
+/*
+ * Submit several jobs of one channel under a single hold of the submit
+ * lock. DMAPUT is only written once, after the last job is in the push
+ * buffer, unless the push buffer fills up on the way.
+ */
+int host1x_channel_submit_multi(struct nvhost_job **jobs, int num_jobs)
+{
+	struct nvhost_channel *ch = jobs[0]->ch;
+	int i, err;
+
+	err = mutex_lock_interruptible(&ch->submitlock);
+	if (err)
+		return err;
+
+	nvhost_cdma_hold_kick(&ch->cdma);
+	for (i = 0; i < num_jobs; i++) {
+		err = channel_submit_locked(jobs[i]);
+		if (err)
+			break;
+	}
+	nvhost_cdma_release_kick(&ch->cdma);
+
+	mutex_unlock(&ch->submitlock);
+	return i ? i : err;
+}
+
 int host1x_channel_read_3d_reg(
 	struct nvhost_channel *channel,
 	struct nvhost_hwctx *hwctx,
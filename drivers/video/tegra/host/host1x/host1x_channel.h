@@ -29,6 +29,9 @@ struct nvhost_device;
 /*  Submit job to a host1x client */
 int host1x_channel_submit(struct nvhost_job *job);
 
+/*  Submit several jobs to a host1x client with one DMAPUT update */
+int host1x_channel_submit_multi(struct nvhost_job **jobs, int num_jobs);
+
 /*  Read 3d register via FIFO */
 int host1x_channel_read_3d_reg(
 	struct nvhost_channel *channel,
@@ -93,6 +93,8 @@ irqreturn_t t20_intr_syncpt_thresh_isr(int irq, void *dev_id)
 
 	void __iomem *sync_regs = intr_to_dev(intr)->sync_aperture;
 
+	syncpt->isr_time = ktime_get();
+
 	writel(BIT(id),
 		sync_regs + HOST1X_SYNC_SYNCPT_THRESH_INT_DISABLE);
 	writel(BIT(id),
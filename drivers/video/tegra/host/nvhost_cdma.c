@@ -26,6 +26,7 @@
 #include <linux/kfifo.h>
 #include <trace/events/nvhost.h>
 #include <linux/interrupt.h>
+#include <linux/frame_trace.h>
 
 /*
  * TODO:
@@ -187,6 +188,9 @@ static void update_cdma_locked(struct nvhost_cdma *cdma)
 				signal = true;
 		}
 
+		if (job->ch->dev->job_done)
+			job->ch->dev->job_done(job->ch->dev, job->submit_time);
+
 		list_del(&job->list);
 		nvhost_job_put(job);
 	}
@@ -437,10 +441,16 @@ void nvhost_cdma_end(struct nvhost_cdma *cdma,
 	bool was_idle = list_empty(&cdma->sync_queue);
 
 	BUG_ON(!cdma_op(cdma).kick);
-	cdma_op(cdma).kick(cdma);
+	if (!cdma->hold_kick) {
+		cdma_op(cdma).kick(cdma);
+		cdma->kicks++;
+	}
 
 	BUG_ON(job->syncpt_id == NVSYNCPT_INVALID);
 
+	frame_trace_gpu_submit(cdma_to_channel(cdma)->dev->name,
+			       job->syncpt_id, job->syncpt_end);
+
 	add_to_sync_queue(cdma,
 			job,
 			cdma->slots_used,
@@ -453,6 +463,30 @@ void nvhost_cdma_end(struct nvhost_cdma *cdma,
 	mutex_unlock(&cdma->lock);
 }
 
+/**
+ * Make nvhost_cdma_end() leave DMAPUT alone, so that several submits can
+ * be started with a single update by nvhost_cdma_release_kick(). Pushes
+ * still kick the DMA when they run out of push buffer space.
+ * Must be called with the channel submit lock held.
+ */
+void nvhost_cdma_hold_kick(struct nvhost_cdma *cdma)
+{
+	mutex_lock(&cdma->lock);
+	cdma->hold_kick = true;
+	mutex_unlock(&cdma->lock);
+}
+
+void nvhost_cdma_release_kick(struct nvhost_cdma *cdma)
+{
+	mutex_lock(&cdma->lock);
+	cdma->hold_kick = false;
+	if (cdma->running) {
+		cdma_op(cdma).kick(cdma);
+		cdma->kicks++;
+	}
+	mutex_unlock(&cdma->lock);
+}
+
 /**
  * Update cdma state according to current sync point values
  */
@@ -100,6 +100,8 @@ struct nvhost_cdma {
 	struct syncpt_buffer syncpt_buffer; /* syncpt incr buffer */
 	struct list_head sync_queue;	/* job queue */
 	struct buffer_timeout timeout;	/* channel's timeout state/wq */
+	unsigned int kicks;		/* DMAPUT updates at end of submits */
+	bool hold_kick;			/* end defers DMAPUT update */
 	bool running;
 	bool torndown;
 };
@@ -114,6 +116,8 @@ struct nvhost_cdma {
 int	nvhost_cdma_init(struct nvhost_cdma *cdma);
 void	nvhost_cdma_deinit(struct nvhost_cdma *cdma);
 void	nvhost_cdma_stop(struct nvhost_cdma *cdma);
+void	nvhost_cdma_hold_kick(struct nvhost_cdma *cdma);
+void	nvhost_cdma_release_kick(struct nvhost_cdma *cdma);
 int	nvhost_cdma_begin(struct nvhost_cdma *cdma, struct nvhost_job *job);
 void	nvhost_cdma_push(struct nvhost_cdma *cdma, u32 op1, u32 op2);
 #define NVHOST_CDMA_PUSH_GATHER_CTXSAVE 0xffffffff
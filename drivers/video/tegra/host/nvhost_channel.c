@@ -26,6 +26,7 @@
 #include <linux/slab.h>
 
 #include <linux/platform_device.h>
+#include <linux/ktime.h>
 
 #define NVHOST_CHANNEL_LOW_PRIO_MAX_WAIT 50
 
@@ -44,12 +45,53 @@ int nvhost_channel_init(struct nvhost_channel *ch,
 	}
 	ndev = ch->dev;
 	ndev->channel = ch;
+	spin_lock_init(&ch->stats.lock);
 
 	return 0;
 }
 
+static void channel_account(struct nvhost_channel *ch,
+		struct nvhost_job **jobs, int num_jobs, ktime_t start)
+{
+	struct nvhost_channel_stats *stats = &ch->stats;
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	int i;
+
+	spin_lock(&stats->lock);
+	stats->calls++;
+	stats->jobs += num_jobs;
+	for (i = 0; i < num_jobs; i++) {
+		stats->gathers += jobs[i]->num_gathers;
+		stats->max_gathers = max_t(u32, stats->max_gathers,
+				jobs[i]->num_gathers);
+	}
+	stats->submit_ns += ns;
+	stats->max_submit_ns = max(stats->max_submit_ns, ns);
+	spin_unlock(&stats->lock);
+}
+
+/*
+ * Called from the sync point interrupt thread for every job that has
+ * completed.  For VI this is the time from queueing a capture to the
+ * frame landing in memory.
+ */
+void nvhost_channel_account_job(struct nvhost_channel *ch, ktime_t queued)
+{
+	struct nvhost_channel_stats *stats = &ch->stats;
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), queued));
+
+	spin_lock(&stats->lock);
+	stats->done++;
+	stats->done_ns += ns;
+	stats->max_done_ns = max(stats->max_done_ns, ns);
+	spin_unlock(&stats->lock);
+}
+
 int nvhost_channel_submit(struct nvhost_job *job)
 {
+	ktime_t start;
+	int err;
+
 	/* Low priority submits wait until sync queue is empty. Ignores result
 	 * from nvhost_cdma_flush, as we submit either when push buffer is
 	 * empty or when we reach the timeout. */
@@ -57,7 +99,35 @@ int nvhost_channel_submit(struct nvhost_job *job)
 		(void)nvhost_cdma_flush(&job->ch->cdma,
 				NVHOST_CHANNEL_LOW_PRIO_MAX_WAIT);
 
-	return channel_op(job->ch).submit(job);
+	start = ktime_get();
+	err = channel_op(job->ch).submit(job);
+	if (!err)
+		channel_account(job->ch, &job, 1, start);
+
+	return err;
+}
+
+/*
+ * Submit jobs of the same channel in one go. Returns the number of jobs
+ * submitted, which may be short of num_jobs, or an error if there were
+ * none.
+ */
+int nvhost_channel_submit_multi(struct nvhost_job **jobs, int num_jobs)
+{
+	struct nvhost_channel *ch = jobs[0]->ch;
+	ktime_t start;
+	int ret;
+
+	if (jobs[0]->priority < NVHOST_PRIORITY_MEDIUM)
+		(void)nvhost_cdma_flush(&ch->cdma,
+				NVHOST_CHANNEL_LOW_PRIO_MAX_WAIT);
+
+	start = ktime_get();
+	ret = channel_op(ch).submit_multi(jobs, num_jobs);
+	if (ret > 0)
+		channel_account(ch, jobs, ret, start);
+
+	return ret;
 }
 
 struct nvhost_channel *nvhost_getchannel(struct nvhost_channel *ch)
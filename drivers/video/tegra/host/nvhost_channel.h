@@ -45,6 +45,20 @@ struct nvhost_channel_gather {
 	int offset;
 };
 
+/* Submit statistics of a channel, see tegra_host/submit_stats in debugfs */
+struct nvhost_channel_stats {
+	spinlock_t lock;
+	u32 calls;		/* submit and submit_multi calls */
+	u32 jobs;		/* jobs submitted by them */
+	u32 gathers;
+	u32 max_gathers;	/* most gathers in one job */
+	u64 submit_ns;		/* time spent in the calls */
+	u64 max_submit_ns;
+	u32 done;		/* jobs seen complete by the interrupt */
+	u64 done_ns;		/* submit to sync point completion */
+	u64 max_done_ns;
+};
+
 struct nvhost_channel {
 	int refcount;
 	int chid;
@@ -58,6 +72,7 @@ struct nvhost_channel {
 	struct cdev cdev;
 	struct nvhost_hwctx_handler *ctxhandler;
 	struct nvhost_cdma cdma;
+	struct nvhost_channel_stats stats;
 };
 
 int nvhost_channel_init(
@@ -65,6 +80,8 @@ int nvhost_channel_init(
 	struct nvhost_master *dev, int index);
 
 int nvhost_channel_submit(struct nvhost_job *job);
+int nvhost_channel_submit_multi(struct nvhost_job **jobs, int num_jobs);
+void nvhost_channel_account_job(struct nvhost_channel *ch, ktime_t queued);
 
 struct nvhost_channel *nvhost_getchannel(struct nvhost_channel *ch);
 void nvhost_putchannel(struct nvhost_channel *ch, struct nvhost_hwctx *ctx);
@@ -0,0 +1,264 @@
+/*
+ * drivers/video/tegra/host/nvhost_fence.c
+ *
+ * Tegra Graphics Host Sync Point Fences
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <linux/anon_inodes.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/kref.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/wait.h>
+
+#include "dev.h"
+#include "nvhost_fence.h"
+
+/*
+ * A fence is a set of (sync point, threshold) pairs, at most one per sync
+ * point.  It is signaled once every sync point has reached its threshold.
+ * Each pending pair has a waiter queued with nvhost_intr, which wakes the
+ * fence's wait queue from the threshold interrupt, so userspace can poll
+ * the fence's file descriptor and hand it on to other drivers instead of
+ * tracking and waiting for sync point values itself.
+ */
+
+#define NVHOST_FENCE_MAX_PTS	8
+
+struct nvhost_fence_pt {
+	u32 id;
+	u32 thresh;
+	void *ref;		/* queued waiter, if not expired when armed */
+};
+
+struct nvhost_fence {
+	struct kref kref;
+	struct nvhost_master *host;
+	wait_queue_head_t wq;
+	int num_pts;
+	struct nvhost_fence_pt pts[NVHOST_FENCE_MAX_PTS];
+};
+
+static const struct file_operations nvhost_fence_fops;
+
+static struct nvhost_fence *fence_alloc(struct nvhost_master *host)
+{
+	struct nvhost_fence *fence;
+
+	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	if (!fence)
+		return NULL;
+
+	kref_init(&fence->kref);
+	init_waitqueue_head(&fence->wq);
+	fence->host = host;
+	return fence;
+}
+
+static void fence_release(struct kref *kref)
+{
+	struct nvhost_fence *fence =
+		container_of(kref, struct nvhost_fence, kref);
+	int i;
+
+	for (i = 0; i < fence->num_pts; i++)
+		if (fence->pts[i].ref)
+			nvhost_intr_put_ref(&fence->host->intr,
+					    fence->pts[i].ref);
+	kfree(fence);
+}
+
+void nvhost_fence_put(struct nvhost_fence *fence)
+{
+	kref_put(&fence->kref, fence_release);
+}
+
+/* add a sync point to a fence which is not armed yet */
+static int fence_add_pt(struct nvhost_fence *fence, u32 id, u32 thresh)
+{
+	int i;
+
+	for (i = 0; i < fence->num_pts; i++) {
+		if (fence->pts[i].id != id)
+			continue;
+		/* the later threshold of the two implies the other */
+		if ((s32)(thresh - fence->pts[i].thresh) > 0)
+			fence->pts[i].thresh = thresh;
+		return 0;
+	}
+
+	if (fence->num_pts == NVHOST_FENCE_MAX_PTS)
+		return -E2BIG;
+
+	fence->pts[fence->num_pts].id = id;
+	fence->pts[fence->num_pts].thresh = thresh;
+	fence->num_pts++;
+	return 0;
+}
+
+/* queue a waiter for each sync point which has not expired yet */
+static int fence_arm(struct nvhost_fence *fence)
+{
+	struct nvhost_syncpt *sp = &fence->host->syncpt;
+	int i, err;
+
+	for (i = 0; i < fence->num_pts; i++) {
+		struct nvhost_fence_pt *pt = &fence->pts[i];
+		void *waiter;
+
+		if (nvhost_syncpt_is_expired(sp, pt->id, pt->thresh))
+			continue;
+
+		waiter = nvhost_intr_alloc_waiter();
+		if (!waiter)
+			return -ENOMEM;
+
+		err = nvhost_intr_add_action(&fence->host->intr, pt->id,
+				pt->thresh,
+				NVHOST_INTR_ACTION_WAKEUP_INTERRUPTIBLE,
+				&fence->wq, waiter, &pt->ref);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+static int fence_install(struct nvhost_fence *fence)
+{
+	int fd, err;
+
+	err = fence_arm(fence);
+	if (err) {
+		nvhost_fence_put(fence);
+		return err;
+	}
+
+	fd = anon_inode_getfd("nvhost_fence", &nvhost_fence_fops, fence,
+			      O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		nvhost_fence_put(fence);
+	return fd;
+}
+
+int nvhost_fence_create_fd(struct nvhost_master *host, u32 id, u32 thresh)
+{
+	struct nvhost_fence *fence;
+
+	if (id >= host->syncpt.nb_pts)
+		return -EINVAL;
+
+	fence = fence_alloc(host);
+	if (!fence)
+		return -ENOMEM;
+
+	fence_add_pt(fence, id, thresh);
+	return fence_install(fence);
+}
+
+int nvhost_fence_merge_fd(int fd1, int fd2)
+{
+	struct nvhost_fence *a, *b, *fence = NULL;
+	int i, err = -EINVAL;
+
+	a = nvhost_fence_get(fd1);
+	b = nvhost_fence_get(fd2);
+	if (!a || !b)
+		goto out;
+
+	err = -ENOMEM;
+	fence = fence_alloc(a->host);
+	if (!fence)
+		goto out;
+
+	for (i = 0, err = 0; i < a->num_pts && !err; i++)
+		err = fence_add_pt(fence, a->pts[i].id, a->pts[i].thresh);
+	for (i = 0; i < b->num_pts && !err; i++)
+		err = fence_add_pt(fence, b->pts[i].id, b->pts[i].thresh);
+	if (err) {
+		nvhost_fence_put(fence);
+		goto out;
+	}
+
+	err = fence_install(fence);
+out:
+	if (a)
+		nvhost_fence_put(a);
+	if (b)
+		nvhost_fence_put(b);
+	return err;
+}
+
+struct nvhost_fence *nvhost_fence_get(int fd)
+{
+	struct nvhost_fence *fence = NULL;
+	struct file *file = fget(fd);
+
+	if (!file)
+		return NULL;
+
+	if (file->f_op == &nvhost_fence_fops) {
+		fence = file->private_data;
+		kref_get(&fence->kref);
+	}
+	fput(file);
+	return fence;
+}
+
+bool nvhost_fence_is_signaled(struct nvhost_fence *fence)
+{
+	int i;
+
+	for (i = 0; i < fence->num_pts; i++)
+		if (!nvhost_syncpt_is_expired(&fence->host->syncpt,
+					      fence->pts[i].id,
+					      fence->pts[i].thresh))
+			return false;
+	return true;
+}
+
+int nvhost_fence_wait(struct nvhost_fence *fence, u32 timeout)
+{
+	int i, err;
+
+	for (i = 0; i < fence->num_pts; i++) {
+		err = nvhost_syncpt_wait_timeout(&fence->host->syncpt,
+				fence->pts[i].id, fence->pts[i].thresh,
+				timeout, NULL);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+static unsigned int nvhost_fence_poll(struct file *file, poll_table *wait)
+{
+	struct nvhost_fence *fence = file->private_data;
+
+	poll_wait(file, &fence->wq, wait);
+	return nvhost_fence_is_signaled(fence) ? POLLIN | POLLRDNORM : 0;
+}
+
+static int nvhost_fence_release(struct inode *inode, struct file *file)
+{
+	nvhost_fence_put(file->private_data);
+	return 0;
+}
+
+static const struct file_operations nvhost_fence_fops = {
+	.owner = THIS_MODULE,
+	.poll = nvhost_fence_poll,
+	.release = nvhost_fence_release,
+};
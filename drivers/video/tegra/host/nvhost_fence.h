@@ -0,0 +1,53 @@
+/*
+ * drivers/video/tegra/host/nvhost_fence.h
+ *
+ * Tegra Graphics Host Sync Point Fences
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __NVHOST_FENCE_H
+#define __NVHOST_FENCE_H
+
+#include <linux/types.h>
+
+struct nvhost_master;
+struct nvhost_fence;
+
+/**
+ * Create a fence that signals once sync point id reaches thresh, and
+ * return a new file descriptor for it.
+ */
+int nvhost_fence_create_fd(struct nvhost_master *host, u32 id, u32 thresh);
+
+/**
+ * Create a fence that signals once both fences fd1 and fd2 have, and
+ * return a new file descriptor for it.
+ */
+int nvhost_fence_merge_fd(int fd1, int fd2);
+
+/**
+ * Get a reference to the fence behind fd, NULL if fd is not a fence.
+ */
+struct nvhost_fence *nvhost_fence_get(int fd);
+void nvhost_fence_put(struct nvhost_fence *fence);
+
+bool nvhost_fence_is_signaled(struct nvhost_fence *fence);
+
+/**
+ * Wait for the fence, at most timeout jiffies for each of its sync
+ * points.
+ */
+int nvhost_fence_wait(struct nvhost_fence *fence, u32 timeout);
+
+#endif
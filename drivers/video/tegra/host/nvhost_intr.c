@@ -23,6 +23,7 @@
 #include <linux/interrupt.h>
 #include <linux/slab.h>
 #include <linux/irq.h>
+#include <linux/frame_trace.h>
 #include <trace/events/nvhost.h>
 
 
@@ -39,6 +40,7 @@ struct nvhost_waitlist {
 	atomic_t state;
 	void *data;
 	int count;
+	ktime_t queued;
 };
 
 enum waitlist_state {
@@ -89,6 +91,10 @@ static void remove_completed_waiters(struct list_head *head, u32 sync,
 
 		dest = completed + waiter->action;
 
+		if (waiter->action == NVHOST_INTR_ACTION_SUBMIT_COMPLETE)
+			nvhost_channel_account_job(waiter->data,
+						   waiter->queued);
+
 		/* consolidate submit cleanups */
 		if (waiter->action == NVHOST_INTR_ACTION_SUBMIT_COMPLETE
 			&& !list_empty(dest)) {
@@ -169,6 +175,26 @@ static action_handler action_handlers[NVHOST_INTR_ACTION_COUNT] = {
 	action_wakeup_interruptible,
 };
 
+/*
+ * Wakeups are run straight from the threshold interrupt thread. Submit
+ * cleanups unpin memory and context saves copy registers, so they are
+ * left to a worker, where they neither hold up wakeups of other waiters
+ * nor run at the real-time priority of the interrupt threads.
+ */
+static bool action_is_urgent(int action)
+{
+	return action == NVHOST_INTR_ACTION_WAKEUP ||
+		action == NVHOST_INTR_ACTION_WAKEUP_INTERRUPTIBLE;
+}
+
+static void account_latency(atomic_t *hist, ktime_t since)
+{
+	s64 us = ktime_us_delta(ktime_get(), since);
+	int bucket = us > 0 ? fls64(us) : 0;
+
+	atomic_inc(&hist[min(bucket, NVHOST_INTR_HIST_BUCKETS - 1)]);
+}
+
 static void run_handlers(struct list_head completed[NVHOST_INTR_ACTION_COUNT])
 {
 	struct list_head *head = completed;
@@ -195,12 +221,15 @@ static int process_wait_list(struct nvhost_intr *intr,
 			     u32 threshold)
 {
 	struct list_head completed[NVHOST_INTR_ACTION_COUNT];
+	bool wakeups = false, deferred = false, was_idle = true;
 	unsigned int i;
 	int empty;
 
 	for (i = 0; i < NVHOST_INTR_ACTION_COUNT; ++i)
 		INIT_LIST_HEAD(completed + i);
 
+	frame_trace_syncpt_done(syncpt->id, threshold);
+
 	spin_lock(&syncpt->lock);
 
 	remove_completed_waiters(&syncpt->wait_head, threshold, completed);
@@ -210,13 +239,53 @@ static int process_wait_list(struct nvhost_intr *intr,
 		reset_threshold_interrupt(intr, &syncpt->wait_head,
 					  syncpt->id);
 
+	for (i = 0; i < NVHOST_INTR_ACTION_COUNT; ++i) {
+		if (!list_empty(syncpt->deferred + i))
+			was_idle = false;
+		if (list_empty(completed + i))
+			continue;
+		if (action_is_urgent(i)) {
+			wakeups = true;
+			continue;
+		}
+		list_splice_tail_init(completed + i, syncpt->deferred + i);
+		deferred = true;
+	}
+	if (deferred && was_idle)
+		syncpt->deferred_time = syncpt->isr_time;
+
 	spin_unlock(&syncpt->lock);
 
+	if (deferred)
+		queue_work(intr->wq, &syncpt->work);
+
 	run_handlers(completed);
+	if (wakeups)
+		account_latency(intr->wakeup_hist, syncpt->isr_time);
 
 	return empty;
 }
 
+static void syncpt_deferred_work(struct work_struct *work)
+{
+	struct nvhost_intr_syncpt *syncpt =
+		container_of(work, struct nvhost_intr_syncpt, work);
+	struct list_head completed[NVHOST_INTR_ACTION_COUNT];
+	ktime_t since;
+	unsigned int i;
+
+	spin_lock(&syncpt->lock);
+	for (i = 0; i < NVHOST_INTR_ACTION_COUNT; ++i) {
+		INIT_LIST_HEAD(completed + i);
+		list_splice_init(syncpt->deferred + i, completed + i);
+	}
+	since = syncpt->deferred_time;
+	spin_unlock(&syncpt->lock);
+
+	account_latency(syncpt->intr->deferred_hist, since);
+	run_handlers(completed);
+}
+
 /*** host syncpt interrupt service functions ***/
 /**
  * Sync point threshold interrupt service thread function
@@ -277,6 +346,7 @@ int nvhost_intr_add_action(struct nvhost_intr *intr, u32 id, u32 thresh,
 	atomic_set(&waiter->state, WLS_PENDING);
 	waiter->data = data;
 	waiter->count = 1;
+	waiter->queued = ktime_get();
 
 	BUG_ON(id >= intr_to_dev(intr)->syncpt.nb_pts);
 	syncpt = intr->syncpt + id;
@@ -340,7 +410,7 @@ void nvhost_intr_put_ref(struct nvhost_intr *intr, void *ref)
 
 int nvhost_intr_init(struct nvhost_intr *intr, u32 irq_gen, u32 irq_sync)
 {
-	unsigned int id;
+	unsigned int id, i;
 	struct nvhost_intr_syncpt *syncpt;
 	struct nvhost_master *host =
 		container_of(intr, struct nvhost_master, intr);
@@ -350,6 +420,11 @@ int nvhost_intr_init(struct nvhost_intr *intr, u32 irq_gen, u32 irq_sync)
 	intr->host_general_irq = irq_gen;
 	intr->host_general_irq_requested = false;
 
+	intr->wq = alloc_workqueue("nvhost_intr",
+			WQ_NON_REENTRANT | WQ_MEM_RECLAIM, 0);
+	if (!intr->wq)
+		return -ENOMEM;
+
 	for (id = 0, syncpt = intr->syncpt;
 	     id < nb_pts;
 	     ++id, ++syncpt) {
@@ -359,6 +434,9 @@ int nvhost_intr_init(struct nvhost_intr *intr, u32 irq_gen, u32 irq_sync)
 		syncpt->irq_requested = 0;
 		spin_lock_init(&syncpt->lock);
 		INIT_LIST_HEAD(&syncpt->wait_head);
+		for (i = 0; i < NVHOST_INTR_ACTION_COUNT; ++i)
+			INIT_LIST_HEAD(syncpt->deferred + i);
+		INIT_WORK(&syncpt->work, syncpt_deferred_work);
 		snprintf(syncpt->thresh_irq_name,
 			sizeof(syncpt->thresh_irq_name),
 			"host_sp_%02d", id);
@@ -370,6 +448,7 @@ int nvhost_intr_init(struct nvhost_intr *intr, u32 irq_gen, u32 irq_sync)
 void nvhost_intr_deinit(struct nvhost_intr *intr)
 {
 	nvhost_intr_stop(intr);
+	destroy_workqueue(intr->wq);
 }
 
 void nvhost_intr_start(struct nvhost_intr *intr, u32 hz)
@@ -398,6 +477,10 @@ void nvhost_intr_stop(struct nvhost_intr *intr)
 	BUG_ON(!(intr_op(intr).disable_all_syncpt_intrs &&
 		 intr_op(intr).free_host_general_irq));
 
+	/*
+	 * Deferred actions are not waited for here: a submit cleanup still
+	 * pending keeps the host busy, so it is not powered off under it.
+	 */
 	mutex_lock(&intr->mutex);
 
 	intr_op(intr).disable_all_syncpt_intrs(intr);
@@ -24,6 +24,8 @@
 #include <linux/kthread.h>
 #include <linux/semaphore.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
 
 struct nvhost_channel;
 
@@ -57,6 +59,13 @@ enum nvhost_intr_action {
 
 struct nvhost_intr;
 
+/*
+ * Latency histograms have log2 buckets of microseconds: bucket 0 counts
+ * latencies below 1us, bucket n those in [2^(n-1), 2^n) us, and the last
+ * bucket everything longer.
+ */
+#define NVHOST_INTR_HIST_BUCKETS	16
+
 struct nvhost_intr_syncpt {
 	struct  nvhost_intr *intr;
 	u8 id;
@@ -65,6 +74,11 @@ struct nvhost_intr_syncpt {
 	spinlock_t lock;
 	struct list_head wait_head;
 	char thresh_irq_name[12];
+	ktime_t isr_time;		/* last threshold interrupt */
+	/* completed waiters whose actions are left to the worker */
+	struct list_head deferred[NVHOST_INTR_ACTION_COUNT];
+	ktime_t deferred_time;		/* interrupt of the oldest of them */
+	struct work_struct work;
 };
 
 struct nvhost_intr {
@@ -72,6 +86,10 @@ struct nvhost_intr {
 	struct mutex mutex;
 	int host_general_irq;
 	bool host_general_irq_requested;
+	struct workqueue_struct *wq;	/* runs deferred actions */
+	/* interrupt to wakeup, and interrupt to start of deferred actions */
+	atomic_t wakeup_hist[NVHOST_INTR_HIST_BUCKETS];
+	atomic_t deferred_hist[NVHOST_INTR_HIST_BUCKETS];
 };
 #define intr_to_dev(x) container_of(x, struct nvhost_master, intr)
 #define intr_op(intr) (intr_to_dev(intr)->op.intr)
@@ -21,6 +21,7 @@
 #ifndef __NVHOST_JOB_H
 #define __NVHOST_JOB_H
 
+#include <linux/ktime.h>
 #include <linux/nvhost_ioctl.h>
 
 struct nvhost_channel;
@@ -86,6 +87,9 @@ struct nvhost_job {
 
 	/* Context to be freed */
 	struct nvhost_hwctx *hwctxref;
+
+	/* Time the job was handed to the channel */
+	ktime_t submit_time;
 };
 
 /*
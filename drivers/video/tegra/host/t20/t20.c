@@ -190,6 +190,7 @@ int nvhost_init_t20_channel_support(struct nvhost_master *host)
 
 	host->op.channel.init = t20_channel_init;
 	host->op.channel.submit = host1x_channel_submit;
+	host->op.channel.submit_multi = host1x_channel_submit_multi;
 	host->op.channel.read3dreg = host1x_channel_read_3d_reg;
 
 	return 0;
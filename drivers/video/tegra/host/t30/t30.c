@@ -72,6 +72,7 @@ struct nvhost_device t30_devices[] = {
 	.prepare_poweroff = nvhost_gr3d_prepare_power_off,
 	.busy		= nvhost_scale3d_notify_busy,
 	.idle		= nvhost_scale3d_notify_idle,
+	.job_done	= nvhost_scale3d_notify_job_done,
 	.init		= nvhost_scale3d_init,
 	.deinit		= nvhost_scale3d_deinit,
 	.suspend 	= nvhost_scale3d_suspend,
@@ -43,20 +43,13 @@
 /* map the backing pages for a heap_pgalloc handle into its IOVMM area */
 static void map_iovmm_area(struct nvmap_handle *h)
 {
-	tegra_iovmm_addr_t va;
-	unsigned long i;
-
 	BUG_ON(!h->heap_pgalloc || !h->pgalloc.area);
 	BUG_ON(h->size & ~PAGE_MASK);
 	WARN_ON(!h->pgalloc.dirty);
 
-	for (va = h->pgalloc.area->iovm_start, i = 0;
-	     va < (h->pgalloc.area->iovm_start + h->size);
-	     i++, va += PAGE_SIZE) {
-		BUG_ON(!pfn_valid(page_to_pfn(h->pgalloc.pages[i])));
-		tegra_iovmm_vm_insert_pfn(h->pgalloc.area, va,
-					  page_to_pfn(h->pgalloc.pages[i]));
-	}
+	tegra_iovmm_vm_insert_pages(h->pgalloc.area,
+				    h->pgalloc.area->iovm_start,
+				    h->pgalloc.pages, h->size >> PAGE_SHIFT);
 	h->pgalloc.dirty = false;
 }
 
@@ -69,6 +62,12 @@ static int pin_locked(struct nvmap_client *client, struct nvmap_handle *h)
 	struct tegra_iovmm_area *area;
 	BUG_ON(!h->alloc);
 
+	/* already pinned, so it has its area: the MRU is not involved. the
+	 * pin count only drops to 0 with the MRU lock held, and only goes up
+	 * from 0 with the pin lock and the MRU lock held. */
+	if (atomic_inc_not_zero(&h->pin))
+		return 0;
+
 	nvmap_mru_lock(client->share);
 	if (atomic_inc_return(&h->pin) == 1) {
 		if (h->heap_pgalloc && !h->pgalloc.contig) {
@@ -88,12 +87,32 @@ static int pin_locked(struct nvmap_client *client, struct nvmap_handle *h)
 	return 0;
 }
 
+/* drops a pin which is not the last one, returns false if it would be */
+static bool pin_dec_not_last(atomic_t *pin)
+{
+	int old, val = atomic_read(pin);
+
+	while (val > 1) {
+		old = atomic_cmpxchg(pin, val, val - 1);
+		if (old == val)
+			return true;
+		val = old;
+	}
+	return false;
+}
+
 /* doesn't need to be called inside nvmap_pin_lock, since this will only
  * expand the available VM area */
 static int handle_unpin(struct nvmap_client *client,
 		struct nvmap_handle *h, int free_vm)
 {
 	int ret = 0;
+
+	if (pin_dec_not_last(&h->pin)) {
+		nvmap_handle_put(h);
+		return 0;
+	}
+
 	nvmap_mru_lock(client->share);
 
 	if (atomic_read(&h->pin) == 0) {
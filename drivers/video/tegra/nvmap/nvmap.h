@@ -100,6 +100,13 @@ struct nvmap_page_pool {
 	struct page **shrink_array;
 	int max_pages;
 	int flags;
+	/* statistics, under lock */
+	unsigned long hits;		/* pages handed out from the pool */
+	unsigned long misses;		/* pages that had to be allocated */
+	unsigned long refilled;		/* pages added by the refill thread */
+	unsigned long allocs;		/* handles allocated with this pool */
+	u64 alloc_ns;			/* time spent in those allocations */
+	u64 max_alloc_ns;
 };
 
 int nvmap_page_pool_init(struct nvmap_page_pool *pool, int flags);
@@ -121,6 +128,10 @@ struct nvmap_share {
 	struct mutex mru_lock;
 	struct list_head *mru_lists;
 	int nr_mru;
+	unsigned long mru_nonempty;	/* bitmap of non-empty mru_lists */
+	u32 mru_contended;		/* mru_lock found already held */
+	u32 mru_reused;			/* areas taken over from a handle */
+	u32 mru_evicted;		/* areas freed to make room */
 #endif
 };
 
@@ -204,6 +215,9 @@ struct nvmap_handle_ref *nvmap_create_handle(struct nvmap_client *client,
 struct nvmap_handle_ref *nvmap_duplicate_handle_id(struct nvmap_client *client,
 						   unsigned long id);
 
+struct nvmap_handle_ref *nvmap_duplicate_handle(struct nvmap_client *client,
+						struct nvmap_handle *h);
+
 int nvmap_alloc_handle_id(struct nvmap_client *client,
 			  unsigned long id, unsigned int heap_mask,
 			  size_t align, unsigned int flags);
@@ -263,6 +277,8 @@ pgprot_t nvmap_pgprot(struct nvmap_handle *h, pgprot_t prot);
 
 int is_nvmap_vma(struct vm_area_struct *vma);
 
+struct file *nvmap_share_file(struct nvmap_handle *h);
+
 struct nvmap_handle_ref *nvmap_alloc_iovm(struct nvmap_client *client,
 	size_t size, size_t align, unsigned int flags, unsigned int iova_start);
 
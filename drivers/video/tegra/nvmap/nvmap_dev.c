@@ -20,6 +20,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <linux/anon_inodes.h>
+#include <linux/ashmem.h>
 #include <linux/backing-dev.h>
 #include <linux/bitmap.h>
 #include <linux/debugfs.h>
@@ -27,6 +29,7 @@
 #include <linux/kernel.h>
 #include <linux/miscdevice.h>
 #include <linux/mm.h>
+#include <linux/mman.h>
 #include <linux/oom.h>
 #include <linux/platform_device.h>
 #include <linux/seq_file.h>
@@ -98,6 +101,8 @@ static int nvmap_map(struct file *filp, struct vm_area_struct *vma);
 static void nvmap_vma_open(struct vm_area_struct *vma);
 static void nvmap_vma_close(struct vm_area_struct *vma);
 static int nvmap_vma_fault(struct vm_area_struct *vma, struct vm_fault *vmf);
+static void nvmap_export_vma_open(struct vm_area_struct *vma);
+static void nvmap_export_vma_close(struct vm_area_struct *vma);
 
 static const struct file_operations nvmap_user_fops = {
 	.owner		= THIS_MODULE,
@@ -121,9 +126,30 @@ static struct vm_operations_struct nvmap_vma_ops = {
 	.fault		= nvmap_vma_fault,
 };
 
+/* mappings made directly on a shared handle fd; see nvmap_share_file */
+static struct vm_operations_struct nvmap_export_vma_ops = {
+	.open		= nvmap_export_vma_open,
+	.close		= nvmap_export_vma_close,
+	.fault		= nvmap_vma_fault,
+};
+
+struct nvmap_export {
+	struct list_head	list;
+	struct nvmap_handle	*handle;
+	pid_t			pid;
+	char			comm[TASK_COMM_LEN];
+	atomic_t		imports;	/* refs created from the fd */
+	atomic_t		mmaps;		/* mmap() calls on the fd */
+	atomic_t		maps;		/* live VMAs, including forks */
+};
+
+static LIST_HEAD(nvmap_exports);
+static DEFINE_SPINLOCK(nvmap_exports_lock);
+
 int is_nvmap_vma(struct vm_area_struct *vma)
 {
-	return vma->vm_ops == &nvmap_vma_ops;
+	return vma->vm_ops == &nvmap_vma_ops ||
+		vma->vm_ops == &nvmap_export_vma_ops;
 }
 
 struct device *nvmap_client_to_device(struct nvmap_client *client)
@@ -828,6 +854,7 @@ static long nvmap_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		break;
 	case NVMAP_IOC_CREATE:
 	case NVMAP_IOC_FROM_ID:
+	case NVMAP_IOC_FROM_FD:
 		err = nvmap_ioctl_create(filp, cmd, uarg);
 		break;
 
@@ -835,6 +862,10 @@ static long nvmap_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		err = nvmap_ioctl_getid(filp, uarg);
 		break;
 
+	case NVMAP_IOC_SHARE:
+		err = nvmap_ioctl_share(filp, uarg);
+		break;
+
 	case NVMAP_IOC_PARAM:
 		err = nvmap_ioctl_get_param(filp, uarg);
 		break;
@@ -940,6 +971,181 @@ static int nvmap_vma_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	}
 }
 
+/* a shared handle fd behaves like an ashmem region towards its consumers:
+ * any process that receives it (e.g. as a BINDER_TYPE_FD object) can mmap
+ * it with the handle's own cache attributes, or turn it back into a handle
+ * reference in its nvmap client for pinning by nvhost, without a copy.
+ * the export holds a handle reference until the last fd and VMA are gone.
+ */
+static void nvmap_export_vma_open(struct vm_area_struct *vma)
+{
+	struct nvmap_export *exp = vma->vm_file->private_data;
+	struct nvmap_vma_priv *priv = vma->vm_private_data;
+
+	nvmap_vma_open(vma);
+	/* nvmap_vma_close drops a use count for every VMA it closes */
+	nvmap_usecount_inc(priv->handle);
+	atomic_inc(&exp->maps);
+}
+
+static void nvmap_export_vma_close(struct vm_area_struct *vma)
+{
+	struct nvmap_export *exp = vma->vm_file->private_data;
+
+	atomic_dec(&exp->maps);
+	nvmap_vma_close(vma);
+}
+
+static int nvmap_export_map(struct file *filp, struct vm_area_struct *vma)
+{
+	struct nvmap_export *exp = filp->private_data;
+	struct nvmap_handle *h = exp->handle;
+	struct nvmap_vma_priv *priv;
+	unsigned long offs = vma->vm_pgoff << PAGE_SHIFT;
+
+	if (offs >= h->size || vma->vm_end - vma->vm_start > h->size - offs)
+		return -EINVAL;
+
+	if (!h->heap_pgalloc && (h->carveout->base & ~PAGE_MASK))
+		return -EFAULT;
+
+	priv = kzalloc(sizeof(*priv), GFP_KERNEL);
+	if (!priv)
+		return -ENOMEM;
+
+	priv->handle = nvmap_handle_get(h);
+	if (!priv->handle) {
+		kfree(priv);
+		return -EINVAL;
+	}
+	/* the fault handler adds vm_pgoff itself */
+	priv->offs = 0;
+	atomic_set(&priv->count, 1);
+	nvmap_usecount_inc(h);
+
+	vma->vm_flags |= VM_SHARED;
+	vma->vm_flags |= (VM_IO | VM_DONTEXPAND | VM_MIXEDMAP | VM_RESERVED);
+	vma->vm_page_prot = nvmap_pgprot(h, vma->vm_page_prot);
+	vma->vm_ops = &nvmap_export_vma_ops;
+	vma->vm_private_data = priv;
+
+	atomic_inc(&exp->mmaps);
+	atomic_inc(&exp->maps);
+	return 0;
+}
+
+/* answers the queries ashmem consumers make on a region they were handed;
+ * the backing store is never purged, so pinning always succeeds */
+static long nvmap_export_ioctl(struct file *filp, unsigned int cmd,
+			       unsigned long arg)
+{
+	static const char name[] = "nvmap-share";
+	struct nvmap_export *exp = filp->private_data;
+
+	switch (cmd) {
+	case ASHMEM_GET_SIZE:
+		return exp->handle->size;
+	case ASHMEM_GET_NAME:
+		if (copy_to_user((void __user *)arg, name, sizeof(name)))
+			return -EFAULT;
+		return 0;
+	case ASHMEM_GET_PROT_MASK:
+		return PROT_READ | PROT_WRITE;
+	case ASHMEM_PIN:
+		return ASHMEM_NOT_PURGED;
+	case ASHMEM_UNPIN:
+		return 0;
+	case ASHMEM_GET_PIN_STATUS:
+		return ASHMEM_IS_PINNED;
+	}
+	return -ENOTTY;
+}
+
+static int nvmap_export_release(struct inode *inode, struct file *filp)
+{
+	struct nvmap_export *exp = filp->private_data;
+
+	spin_lock(&nvmap_exports_lock);
+	list_del(&exp->list);
+	spin_unlock(&nvmap_exports_lock);
+
+	nvmap_handle_put(exp->handle);
+	kfree(exp);
+	return 0;
+}
+
+static const struct file_operations nvmap_export_fops = {
+	.owner		= THIS_MODULE,
+	.release	= nvmap_export_release,
+	.unlocked_ioctl	= nvmap_export_ioctl,
+	.mmap		= nvmap_export_map,
+};
+
+struct file *nvmap_share_file(struct nvmap_handle *h)
+{
+	struct nvmap_export *exp;
+	struct file *file;
+
+	exp = kzalloc(sizeof(*exp), GFP_KERNEL);
+	if (!exp)
+		return ERR_PTR(-ENOMEM);
+
+	exp->handle = nvmap_handle_get(h);
+	if (!exp->handle) {
+		kfree(exp);
+		return ERR_PTR(-EINVAL);
+	}
+	exp->pid = current->group_leader->pid;
+	get_task_comm(exp->comm, current->group_leader);
+	atomic_set(&exp->imports, 0);
+	atomic_set(&exp->mmaps, 0);
+	atomic_set(&exp->maps, 0);
+
+	file = anon_inode_getfile("nvmap-share", &nvmap_export_fops, exp,
+				  O_RDWR);
+	if (IS_ERR(file)) {
+		nvmap_handle_put(exp->handle);
+		kfree(exp);
+		return file;
+	}
+
+	spin_lock(&nvmap_exports_lock);
+	list_add_tail(&exp->list, &nvmap_exports);
+	spin_unlock(&nvmap_exports_lock);
+
+	return file;
+}
+
+struct nvmap_handle_ref *nvmap_import_fd(struct nvmap_client *client, int fd)
+{
+	struct nvmap_handle_ref *ref;
+	struct nvmap_handle *h;
+	struct nvmap_export *exp;
+	struct file *f = fget(fd);
+
+	if (!f)
+		return ERR_PTR(-EBADF);
+
+	if (f->f_op != &nvmap_export_fops) {
+		fput(f);
+		return ERR_PTR(-EINVAL);
+	}
+
+	/* holding the fd is the permission; the handle id is not checked */
+	exp = f->private_data;
+	h = nvmap_handle_get(exp->handle);
+	if (!h) {
+		fput(f);
+		return ERR_PTR(-EINVAL);
+	}
+	ref = nvmap_duplicate_handle(client, h);
+	if (!IS_ERR(ref))
+		atomic_inc(&exp->imports);
+
+	fput(f);
+	return ref;
+}
+
 static ssize_t attr_show_usage(struct device *dev,
 			       struct device_attribute *attr, char *buf)
 {
@@ -1142,6 +1348,39 @@ static const struct file_operations debug_iovmm_allocations_fops = {
 	.release = single_release,
 };
 
+static int nvmap_debug_exports_show(struct seq_file *s, void *unused)
+{
+	struct nvmap_export *exp;
+
+	seq_printf(s, "%-18s %8s %8s %10s %8s %6s %8s %8s %6s\n", "PROCESS",
+		"PID", "HANDLE", "SIZE", "FLAGS", "REFS", "IMPORTS", "MMAPS",
+		"MAPS");
+	spin_lock(&nvmap_exports_lock);
+	list_for_each_entry(exp, &nvmap_exports, list) {
+		struct nvmap_handle *h = exp->handle;
+		seq_printf(s, "%-18s %8u %08lx %10u %8lx %6d %8d %8d %6d\n",
+			   exp->comm, exp->pid, (unsigned long)h, h->size,
+			   h->flags, atomic_read(&h->ref),
+			   atomic_read(&exp->imports),
+			   atomic_read(&exp->mmaps), atomic_read(&exp->maps));
+	}
+	spin_unlock(&nvmap_exports_lock);
+
+	return 0;
+}
+
+static int nvmap_debug_exports_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nvmap_debug_exports_show, inode->i_private);
+}
+
+static const struct file_operations debug_exports_fops = {
+	.open = nvmap_debug_exports_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int nvmap_probe(struct platform_device *pdev)
 {
 	struct nvmap_platform_data *plat = pdev->dev.platform_data;
@@ -1266,6 +1505,9 @@ static int nvmap_probe(struct platform_device *pdev)
 	nvmap_debug_root = debugfs_create_dir("nvmap", NULL);
 	if (IS_ERR_OR_NULL(nvmap_debug_root))
 		dev_err(&pdev->dev, "couldn't create debug files\n");
+	else
+		debugfs_create_file("exports", S_IRUGO, nvmap_debug_root,
+				    NULL, &debug_exports_fops);
 
 	for (i = 0; i < plat->nr_carveouts; i++) {
 		struct nvmap_carveout_node *node = &dev->heaps[dev->nr_carveouts];
@@ -1321,6 +1563,14 @@ static int nvmap_probe(struct platform_device *pdev)
 					iovmm_root,
 					&dev->iovmm_master.pools[i].npages);
 			}
+#ifdef CONFIG_NVMAP_RECLAIM_UNPINNED_VM
+			debugfs_create_u32("mru_contended", S_IRUGO, iovmm_root,
+					&dev->iovmm_master.mru_contended);
+			debugfs_create_u32("mru_reused", S_IRUGO, iovmm_root,
+					&dev->iovmm_master.mru_reused);
+			debugfs_create_u32("mru_evicted", S_IRUGO, iovmm_root,
+					&dev->iovmm_master.mru_evicted);
+#endif
 		}
 	}
 
@@ -42,6 +42,11 @@
 #include <linux/swap.h>
 #include <linux/shrinker.h>
 #include <linux/moduleparam.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/jiffies.h>
+#include <linux/sched.h>
+#include <linux/nvhost_gr2d.h>
 
 #include "nvmap.h"
 #include "nvmap_mru.h"
@@ -77,6 +82,36 @@ static char *s_memtype_str[] = {
 	"wb",
 };
 
+typedef int (*set_pages_array) (struct page **pages, int addrinarray);
+static set_pages_array s_cpa[] = {
+	set_pages_array_uc,
+	set_pages_array_wc,
+	set_pages_array_iwb,
+	set_pages_array_wb
+};
+
+/*
+ * Pools which drop below pool_low_watermark percent of their size are
+ * topped up to pool_high_watermark percent by a background thread, with
+ * pages that are already zeroed and have the pool's attributes, so that
+ * allocations do not pay for the zeroing and the cache maintenance of the
+ * attribute change.  The thread stays off for pool_refill_backoff_ms after
+ * the shrinker has taken pages away.
+ */
+#define NVMAP_PP_REFILL_BATCH	32
+
+static int pool_low_watermark = 25;
+module_param(pool_low_watermark, int, 0644);
+static int pool_high_watermark = 50;
+module_param(pool_high_watermark, int, 0644);
+static unsigned int pool_refill_backoff_ms = 1000;
+module_param(pool_refill_backoff_ms, uint, 0644);
+
+static struct task_struct *pp_refill_task;
+static DECLARE_WAIT_QUEUE_HEAD(pp_refill_wait);
+static bool pp_refill_pending;
+static unsigned long pp_last_shrink;
+
 static inline void nvmap_page_pool_lock(struct nvmap_page_pool *pool)
 {
 	mutex_lock(&pool->lock);
@@ -96,16 +131,20 @@ static struct page *nvmap_page_pool_alloc_locked(struct nvmap_page_pool *pool)
 	return page;
 }
 
-static struct page *nvmap_page_pool_alloc(struct nvmap_page_pool *pool)
+/* Take up to nr pages from the pool, returns the number taken */
+static unsigned int nvmap_page_pool_alloc_pages(struct nvmap_page_pool *pool,
+					struct page **pages, unsigned int nr)
 {
-	struct page *page = NULL;
+	unsigned int i = 0;
 
-	if (pool) {
-		nvmap_page_pool_lock(pool);
-		page = nvmap_page_pool_alloc_locked(pool);
-		nvmap_page_pool_unlock(pool);
-	}
-	return page;
+	if (!pool)
+		return 0;
+
+	nvmap_page_pool_lock(pool);
+	while (i < nr && pool->npages > 0)
+		pages[i++] = pool->page_array[--pool->npages];
+	nvmap_page_pool_unlock(pool);
+	return i;
 }
 
 static bool nvmap_page_pool_release_locked(struct nvmap_page_pool *pool,
@@ -138,6 +177,112 @@ static int nvmap_page_pool_get_available_count(struct nvmap_page_pool *pool)
 	return pool->npages;
 }
 
+static int nvmap_page_pool_watermark(struct nvmap_page_pool *pool, int pct)
+{
+	return pool->max_pages * clamp(pct, 0, 100) / 100;
+}
+
+static void nvmap_page_pool_kick(struct nvmap_page_pool *pool)
+{
+	/* unlocked, this is only a hint */
+	if (!pp_refill_task || !enable_pp || pp_refill_pending)
+		return;
+	if (pool->npages < nvmap_page_pool_watermark(pool, pool_low_watermark)) {
+		pp_refill_pending = true;
+		wake_up(&pp_refill_wait);
+	}
+}
+
+static void nvmap_page_pool_account(struct nvmap_page_pool *pool,
+				    unsigned int hits, unsigned int misses,
+				    u64 ns)
+{
+	if (!pool)
+		return;
+
+	nvmap_page_pool_lock(pool);
+	pool->hits += hits;
+	pool->misses += misses;
+	pool->allocs++;
+	pool->alloc_ns += ns;
+	if (ns > pool->max_alloc_ns)
+		pool->max_alloc_ns = ns;
+	nvmap_page_pool_unlock(pool);
+
+	nvmap_page_pool_kick(pool);
+}
+
+static void nvmap_page_pool_refill(struct nvmap_page_pool *pool)
+{
+	struct page *pages[NVMAP_PP_REFILL_BATCH];
+	int i, n, want;
+
+	while (enable_pp && !kthread_should_stop()) {
+		if (time_before(jiffies, pp_last_shrink +
+				msecs_to_jiffies(pool_refill_backoff_ms)))
+			break;
+
+		nvmap_page_pool_lock(pool);
+		want = max(nvmap_page_pool_watermark(pool, pool_high_watermark),
+			   nvmap_page_pool_watermark(pool, pool_low_watermark));
+		want -= pool->npages;
+		nvmap_page_pool_unlock(pool);
+		if (want <= 0)
+			break;
+		want = min(want, NVMAP_PP_REFILL_BATCH);
+
+		for (n = 0; n < want; n++) {
+			pages[n] = alloc_page(GFP_NVMAP | __GFP_ZERO |
+					      __GFP_NORETRY);
+			if (!pages[n])
+				break;
+		}
+		if (!n)
+			break;
+		(*s_cpa[pool->flags])(pages, n);
+
+		nvmap_page_pool_lock(pool);
+		for (i = 0; i < n; i++)
+			if (!nvmap_page_pool_release_locked(pool, pages[i]))
+				break;
+		pool->refilled += i;
+		nvmap_page_pool_unlock(pool);
+
+		if (i < n) {
+			/* the pool was resized or disabled meanwhile */
+			set_pages_array_wb(&pages[i], n - i);
+			while (i < n)
+				__free_page(pages[i++]);
+			break;
+		}
+		if (n < want)
+			break;
+		cond_resched();
+	}
+}
+
+static int nvmap_page_pool_refill_thread(void *data)
+{
+	struct nvmap_share *share;
+	int i;
+
+	set_freezable();
+	set_user_nice(current, 10);
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(pp_refill_wait,
+				pp_refill_pending || kthread_should_stop());
+		pp_refill_pending = false;
+		if (!nvmap_dev)
+			continue;
+
+		share = nvmap_get_share_from_dev(nvmap_dev);
+		for (i = 0; i < NVMAP_NUM_POOLS; i++)
+			nvmap_page_pool_refill(&share->pools[i]);
+	}
+	return 0;
+}
+
 static int nvmap_page_pool_free(struct nvmap_page_pool *pool, int nr_free)
 {
 	int i = nr_free;
@@ -239,6 +384,7 @@ static int nvmap_page_pool_shrink(struct shrinker *shrinker,
 		goto out;
 
 	pr_debug("sh_pages=%d", shrink_pages);
+	pp_last_shrink = jiffies;
 
 	for (i = 0; i < NVMAP_NUM_POOLS && shrink_pages; i++) {
 		pool_offset = atomic_add_return(1, &start_pool) %
@@ -327,6 +473,37 @@ static struct kernel_param_ops enable_pp_ops = {
 
 module_param_cb(enable_page_pools, &enable_pp_ops, &enable_pp, 0644);
 
+static int pool_stats_get(char *buff, const struct kernel_param *kp)
+{
+	struct nvmap_share *share;
+	struct nvmap_page_pool *pool;
+	int i, len = 0;
+
+	if (!nvmap_dev)
+		return 0;
+
+	share = nvmap_get_share_from_dev(nvmap_dev);
+	for (i = 0; i < NVMAP_NUM_POOLS; i++) {
+		pool = &share->pools[i];
+		nvmap_page_pool_lock(pool);
+		len += sprintf(buff + len, "%s: pages %d/%d hits %lu misses %lu "
+			"refilled %lu allocs %lu avg_us %llu max_us %llu\n",
+			s_memtype_str[i], pool->npages, pool->max_pages,
+			pool->hits, pool->misses, pool->refilled, pool->allocs,
+			pool->allocs ? div_u64(div_u64(pool->alloc_ns,
+					NSEC_PER_USEC), pool->allocs) : 0,
+			div_u64(pool->max_alloc_ns, NSEC_PER_USEC));
+		nvmap_page_pool_unlock(pool);
+	}
+	return len;
+}
+
+static struct kernel_param_ops pool_stats_ops = {
+	.get = pool_stats_get,
+};
+
+module_param_cb(page_pool_stats, &pool_stats_ops, NULL, 0444);
+
 #define POOL_SIZE_SET(m, i) \
 static int pool_size_##m##_set(const char *arg, const struct kernel_param *kp) \
 { \
@@ -377,13 +554,6 @@ int nvmap_page_pool_init(struct nvmap_page_pool *pool, int flags)
 	int i;
 	static int reg = 1;
 	struct sysinfo info;
-	typedef int (*set_pages_array) (struct page **pages, int addrinarray);
-	set_pages_array s_cpa[] = {
-		set_pages_array_uc,
-		set_pages_array_wc,
-		set_pages_array_iwb,
-		set_pages_array_wb
-	};
 
 	BUG_ON(flags >= NVMAP_NUM_POOLS);
 	memset(pool, 0x0, sizeof(*pool));
@@ -414,6 +584,12 @@ int nvmap_page_pool_init(struct nvmap_page_pool *pool, int flags)
 	if (reg) {
 		reg = 0;
 		register_shrinker(&nvmap_page_pool_shrinker);
+		pp_refill_task = kthread_run(nvmap_page_pool_refill_thread,
+					     NULL, "nvmap-pp-refill");
+		if (IS_ERR(pp_refill_task)) {
+			pr_err("failed to start the page pool refill thread");
+			pp_refill_task = NULL;
+		}
 	}
 
 	nvmap_page_pool_lock(pool);
@@ -514,6 +690,25 @@ out:
 	kfree(h);
 }
 
+/*
+ * Pages that do not come from a pool are first tried in chunks of
+ * 1 << chunk_order, without reclaim, which saves allocator calls and
+ * keeps runs of the handle physically contiguous.  0 disables it.
+ */
+static int chunk_order = 4;
+module_param(chunk_order, int, 0644);
+
+static struct page *nvmap_alloc_chunk(unsigned int order)
+{
+	struct page *page;
+
+	page = alloc_pages((GFP_NVMAP | __GFP_NORETRY | __GFP_NOMEMALLOC) &
+			   ~__GFP_WAIT, order);
+	if (page)
+		split_page(page, order);
+	return page;
+}
+
 static struct page *nvmap_alloc_pages_exact(gfp_t gfp, size_t size)
 {
 	struct page *page, *p, *e;
@@ -544,6 +739,8 @@ static int handle_page_alloc(struct nvmap_client *client,
 	unsigned int i = 0, page_index = 0;
 	struct page **pages;
 	struct nvmap_page_pool *pool = NULL;
+	u64 start = local_clock();
+	int order = clamp(chunk_order, 0, MAX_ORDER - 1);
 
 	pages = altalloc(nr_page * sizeof(*pages));
 	if (!pages)
@@ -565,19 +762,28 @@ static int handle_page_alloc(struct nvmap_client *client,
 		if (h->flags < NVMAP_NUM_POOLS)
 			pool = &share->pools[h->flags];
 
-		for (i = 0; i < nr_page; i++) {
-			/* Get pages from pool, if available. */
-			pages[i] = nvmap_page_pool_alloc(pool);
-			if (!pages[i])
-				break;
-			page_index++;
-		}
+		/* Get pages from pool, if available. */
+		page_index = nvmap_page_pool_alloc_pages(pool, pages, nr_page);
+
+		for (i = page_index; i < nr_page; ) {
+			if (order && nr_page - i >= (1 << order)) {
+				struct page *page = nvmap_alloc_chunk(order);
 
-		for (; i < nr_page; i++) {
+				if (page) {
+					unsigned int j;
+
+					for (j = 0; j < (1 << order); j++)
+						pages[i++] = nth_page(page, j);
+					continue;
+				}
+				/* fragmented, don't try again for this one */
+				order = 0;
+			}
 			pages[i] = nvmap_alloc_pages_exact(GFP_NVMAP,
 				PAGE_SIZE);
 			if (!pages[i])
 				goto fail;
+			i++;
 		}
 
 #ifndef CONFIG_NVMAP_RECLAIM_UNPINNED_VM
@@ -606,6 +812,9 @@ static int handle_page_alloc(struct nvmap_client *client,
 				nr_page - page_index);
 
 skip_attr_change:
+	if (!contiguous)
+		nvmap_page_pool_account(pool, page_index, nr_page - page_index,
+					local_clock() - start);
 	h->size = size;
 	h->pgalloc.pages = pages;
 	h->pgalloc.contig = contiguous;
@@ -622,6 +831,26 @@ fail:
 	return -ENOMEM;
 }
 
+/*
+ * Carveout blocks are handed out with whatever the previous owner left in
+ * them.  Large, page-sized, non-cacheable generic carveout allocations are
+ * cleared by the 2D engine instead, which costs no CPU time and leaves no
+ * stale lines to write back over the result.  Anything the engine refuses
+ * is left as before.
+ */
+static void carveout_gr2d_clear(struct nvmap_handle *h, unsigned int type)
+{
+	if (!(type & NVMAP_HEAP_CARVEOUT_GENERIC) || h->secure)
+		return;
+	if (h->flags != NVMAP_HANDLE_UNCACHEABLE &&
+	    h->flags != NVMAP_HANDLE_WRITE_COMBINE)
+		return;
+	if (h->size < nvhost_gr2d_threshold || (h->size & ~PAGE_MASK))
+		return;
+
+	nvhost_gr2d_clear(h->carveout->base, h->size);
+}
+
 static void alloc_handle(struct nvmap_client *client,
 			 struct nvmap_handle *h, unsigned int type)
 {
@@ -665,6 +894,7 @@ static void alloc_handle(struct nvmap_client *client,
 			nvmap_carveout_commit_add(client,
 				nvmap_heap_to_arg(nvmap_block_to_heap(b)),
 				h->size);
+			carveout_gr2d_clear(h, type);
 		}
 		nvmap_usecount_dec(h);
 
@@ -949,7 +1179,6 @@ struct nvmap_handle_ref *nvmap_create_handle(struct nvmap_client *client,
 struct nvmap_handle_ref *nvmap_duplicate_handle_id(struct nvmap_client *client,
 						   unsigned long id)
 {
-	struct nvmap_handle_ref *ref = NULL;
 	struct nvmap_handle *h = NULL;
 
 	BUG_ON(!client || client->dev != nvmap_dev);
@@ -963,6 +1192,16 @@ struct nvmap_handle_ref *nvmap_duplicate_handle_id(struct nvmap_client *client,
 		return ERR_PTR(-EPERM);
 	}
 
+	return nvmap_duplicate_handle(client, h);
+}
+
+/* adds h to the client; the caller's reference on h is handed over to
+ * the new handle ref, or dropped on failure */
+struct nvmap_handle_ref *nvmap_duplicate_handle(struct nvmap_client *client,
+						struct nvmap_handle *h)
+{
+	struct nvmap_handle_ref *ref = NULL;
+
 	if (!h->alloc) {
 		nvmap_err(client, "%s duplicating unallocated handle\n",
 			  current->group_leader->comm);
@@ -992,7 +1231,7 @@ struct nvmap_handle_ref *nvmap_duplicate_handle_id(struct nvmap_client *client,
 			atomic_sub(h->size, &client->iovm_commit);
 			nvmap_handle_put(h);
 			nvmap_err(client, "duplicating %p in %s over-commits"
-				  " IOVMM space\n", (void *)id,
+				  " IOVMM space\n", h,
 				  current->group_leader->comm);
 			return ERR_PTR(-ENOMEM);
 		}
@@ -27,6 +27,11 @@
 #include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/err.h>
+#include <linux/workqueue.h>
+#include <linux/moduleparam.h>
+#include <linux/jiffies.h>
+#include <linux/math64.h>
+#include <linux/cma.h>
 
 #include <mach/nvmap.h>
 #include "nvmap.h"
@@ -94,6 +99,10 @@ struct heap_stat {
 	unsigned int compaction_count_fast;
 	/* full compaction attempt counter */
 	unsigned int compaction_count_full;
+	/* background compaction pass counter */
+	unsigned int compaction_count_bg;
+	/* blocks relocated by all compactions */
+	unsigned int relocated;
 };
 
 struct buddy_heap;
@@ -144,6 +153,16 @@ struct nvmap_heap {
 	const char *name;
 	void *arg;
 	struct device dev;
+	unsigned int compaction_count_fast;
+	unsigned int compaction_count_full;
+	unsigned int compaction_count_bg;
+	unsigned int relocated;
+	bool cma;			/* shared with the page allocator */
+#ifdef CONFIG_NVMAP_CARVEOUT_COMPACTOR
+	struct delayed_work compact_work;
+	unsigned long last_activity;	/* jiffies of the last alloc or free */
+	atomic_t alloc_waiting;		/* allocations waiting for the lock */
+#endif
 };
 
 static struct kmem_cache *buddy_heap_cache;
@@ -215,6 +234,10 @@ static unsigned long heap_stat(struct nvmap_heap *heap, struct heap_stat *stat)
 		stat->free_count++;
 		stat->free_largest = max(l->size, stat->free_largest);
 	}
+	stat->compaction_count_fast = heap->compaction_count_fast;
+	stat->compaction_count_full = heap->compaction_count_full;
+	stat->compaction_count_bg = heap->compaction_count_bg;
+	stat->relocated = heap->relocated;
 	mutex_unlock(&heap->lock);
 
 	return base;
@@ -247,6 +270,12 @@ static struct device_attribute heap_stat_free_size =
 static struct device_attribute heap_stat_base =
 	__ATTR(base, S_IRUGO, heap_stat_show, NULL);
 
+static struct device_attribute heap_stat_fragmentation =
+	__ATTR(fragmentation, S_IRUGO, heap_stat_show, NULL);
+
+static struct device_attribute heap_stat_compactions =
+	__ATTR(compactions, S_IRUGO, heap_stat_show, NULL);
+
 static struct device_attribute heap_attr_name =
 	__ATTR(name, S_IRUGO, heap_name_show, NULL);
 
@@ -258,6 +287,8 @@ static struct attribute *heap_stat_attrs[] = {
 	&heap_stat_free_count.attr,
 	&heap_stat_free_size.attr,
 	&heap_stat_base.attr,
+	&heap_stat_fragmentation.attr,
+	&heap_stat_compactions.attr,
 	&heap_attr_name.attr,
 	NULL,
 };
@@ -297,6 +328,15 @@ static ssize_t heap_stat_show(struct device *dev,
 		return sprintf(buf, "%u\n", stat.free);
 	else if (attr == &heap_stat_base)
 		return sprintf(buf, "%08lx\n", base);
+	else if (attr == &heap_stat_fragmentation)
+		/* percentage of the free space outside the largest free block */
+		return sprintf(buf, "%u\n", stat.free ? 100 - (unsigned int)
+			div_u64((u64)stat.free_largest * 100, stat.free) : 0);
+	else if (attr == &heap_stat_compactions)
+		return sprintf(buf, "fast %u full %u background %u "
+			       "relocated %u\n", stat.compaction_count_fast,
+			       stat.compaction_count_full,
+			       stat.compaction_count_bg, stat.relocated);
 	else
 		return -EINVAL;
 }
@@ -384,6 +424,33 @@ static struct buddy_heap *do_buddy_free(struct nvmap_heap_block *block)
 }
 
 
+/*
+ * A carveout shared through CMA only holds the pages under its allocated
+ * blocks.  They are claimed when a block is carved out of the free space,
+ * which migrates whatever the page allocator put there, and released when
+ * the block is freed.
+ */
+static struct list_block *do_heap_free(struct nvmap_heap_block *block);
+
+static int heap_claim_block(struct nvmap_heap *heap, struct list_block *b)
+{
+	if (!heap->cma)
+		return 0;
+	if (cma_claim(b->block.base, b->size))
+		return -ENOMEM;
+	/* the previous users of the pages may have left dirty lines */
+	nvmap_flush_heap_block(NULL, &b->block, b->size,
+			       NVMAP_HANDLE_CACHEABLE);
+	return 0;
+}
+
+static void heap_release_range(struct nvmap_heap *heap, unsigned long base,
+			       size_t len)
+{
+	if (heap->cma)
+		cma_release(base, len);
+}
+
 /*
  * base_max limits position of allocated chunk in memory.
  * if base_max is 0 then there is no such limitation.
@@ -403,9 +470,10 @@ static struct nvmap_heap_block *do_heap_alloc(struct nvmap_heap *heap,
 	 * and most allocations from carveout heaps are DMA coherent
 	 * (i.e., non-cacheable), round cacheable allocations up to
 	 * a page boundary to ensure that the physical pages will
-	 * only be mapped one way. */
+	 * only be mapped one way.  blocks of a shared carveout are
+	 * claimed in whole pages, so round those up as well. */
 	if (mem_prot == NVMAP_HANDLE_CACHEABLE ||
-	    mem_prot == NVMAP_HANDLE_INNER_CACHEABLE) {
+	    mem_prot == NVMAP_HANDLE_INNER_CACHEABLE || heap->cma) {
 		align = max_t(size_t, align, PAGE_SIZE);
 		len = PAGE_ALIGN(len);
 	}
@@ -496,6 +564,12 @@ out:
 	b->heap = heap;
 	b->mem_prot = mem_prot;
 	b->align = align;
+
+	if (heap_claim_block(heap, b)) {
+		/* pages pinned by someone else: undo the split */
+		do_heap_free(&b->block);
+		return NULL;
+	}
 	return &b->block;
 }
 
@@ -720,7 +794,9 @@ static struct nvmap_heap_block *do_heap_relocate_listblock(
 	if (handle->usecount)
 		goto fail;
 
-	if (fast) {
+	/* freeing first would give a shared carveout's pages back to the
+	 * page allocator before they are copied */
+	if (fast || heap->cma) {
 		/* Fast compaction path - first allocate, then free. */
 		heap_block_new = do_heap_alloc(heap, src_size, src_align,
 				src_prot, src_base);
@@ -751,6 +827,7 @@ static struct nvmap_heap_block *do_heap_relocate_listblock(
 	error = do_heap_copy_listblock(handle->dev,
 				dst_base, src_base, src_size);
 	BUG_ON(error);
+	heap_release_range(heap, src_base, src_size);
 
 fail:
 	mutex_unlock(&share->pin_lock);
@@ -758,8 +835,14 @@ fail:
 	return heap_block_new;
 }
 
-static void nvmap_heap_compact(struct nvmap_heap *heap,
-				size_t requested_size, bool fast)
+/*
+ * Moves allocated blocks down into the free blocks below them, until a
+ * free block of requested_size exists.  With a budget, at most that many
+ * blocks are moved, and the walk stops as soon as an allocation waits for
+ * the heap lock.  Returns the number of blocks moved.
+ */
+static int nvmap_heap_compact(struct nvmap_heap *heap,
+				size_t requested_size, bool fast, int budget)
 {
 	struct list_block *block_current = NULL;
 	struct list_block *block_prev = NULL;
@@ -772,6 +855,10 @@ static void nvmap_heap_compact(struct nvmap_heap *heap,
 
 	/* walk through all blocks */
 	while (ptr != &heap->all_list) {
+		if (budget && (relocation_count >= budget ||
+			       atomic_read(&heap->alloc_waiting)))
+			break;
+
 		block_current = list_entry(ptr, struct list_block, all_list);
 
 		ptr_prev = ptr->prev;
@@ -820,8 +907,85 @@ static void nvmap_heap_compact(struct nvmap_heap *heap,
 		}
 		ptr = ptr_next;
 	}
-	pr_err("Relocated %d chunks\n", relocation_count);
+	heap->relocated += relocation_count;
+	if (!budget)
+		pr_err("Relocated %d chunks\n", relocation_count);
+	return relocation_count;
 }
+
+/*
+ * Background compaction: once a heap has seen no allocation or free for
+ * bg_compact_idle_ms and more than bg_compact_frag percent of its free
+ * space is outside the largest free block, blocks are moved down
+ * bg_compact_relocs at a time, so that a later large allocation does not
+ * have to wait for the compaction.
+ */
+static bool bg_compact = 1;
+module_param(bg_compact, bool, 0644);
+static unsigned int bg_compact_idle_ms = 2000;
+module_param(bg_compact_idle_ms, uint, 0644);
+static unsigned int bg_compact_frag = 25;
+module_param(bg_compact_frag, uint, 0644);
+static unsigned int bg_compact_relocs = 4;
+module_param(bg_compact_relocs, uint, 0644);
+
+/* must be called while holding the heap's lock */
+static unsigned int heap_fragmentation_locked(struct nvmap_heap *heap)
+{
+	struct list_block *l;
+	size_t free = 0, largest = 0;
+
+	list_for_each_entry(l, &heap->free_list, free_list) {
+		free += l->size;
+		largest = max(l->size, largest);
+	}
+	if (!free)
+		return 0;
+	return 100 - (unsigned int)div_u64((u64)largest * 100, free);
+}
+
+static void heap_compact_work(struct work_struct *work)
+{
+	struct nvmap_heap *heap = container_of(to_delayed_work(work),
+					struct nvmap_heap, compact_work);
+	unsigned long idle_end;
+	int moved;
+
+	mutex_lock(&heap->lock);
+	idle_end = heap->last_activity + msecs_to_jiffies(bg_compact_idle_ms);
+	if (time_before(jiffies, idle_end)) {
+		mutex_unlock(&heap->lock);
+		schedule_delayed_work(&heap->compact_work, idle_end - jiffies);
+		return;
+	}
+
+	if (!bg_compact || !bg_compact_relocs ||
+	    heap_fragmentation_locked(heap) <= bg_compact_frag) {
+		mutex_unlock(&heap->lock);
+		return;
+	}
+
+	moved = nvmap_heap_compact(heap, ~(size_t)0, true,
+				   bg_compact_relocs);
+	heap->compaction_count_bg++;
+	mutex_unlock(&heap->lock);
+
+	dev_dbg(&heap->dev, "background compaction moved %d blocks\n", moved);
+	/* more to do, unless nothing could be moved at all */
+	if (moved)
+		schedule_delayed_work(&heap->compact_work, HZ / 10);
+}
+
+/* must be called while holding the heap's lock */
+static void heap_activity_locked(struct nvmap_heap *heap)
+{
+	heap->last_activity = jiffies;
+	if (bg_compact)
+		schedule_delayed_work(&heap->compact_work,
+				msecs_to_jiffies(bg_compact_idle_ms));
+}
+#else
+#define heap_activity_locked(_heap)	do { } while (0)
 #endif
 
 void nvmap_usecount_inc(struct nvmap_handle *h)
@@ -851,24 +1015,32 @@ struct nvmap_heap_block *nvmap_heap_alloc(struct nvmap_heap *h,
 	size_t align      = handle->align;
 	unsigned int prot = handle->flags;
 
+#ifdef CONFIG_NVMAP_CARVEOUT_COMPACTOR
+	/* makes a background compaction holding the lock give up */
+	atomic_inc(&h->alloc_waiting);
 	mutex_lock(&h->lock);
+	atomic_dec(&h->alloc_waiting);
+	heap_activity_locked(h);
 
-#ifdef CONFIG_NVMAP_CARVEOUT_COMPACTOR
 	/* Align to page size */
 	align = ALIGN(align, PAGE_SIZE);
 	len = ALIGN(len, PAGE_SIZE);
 	b = do_heap_alloc(h, len, align, prot, 0);
 	if (!b) {
 		pr_err("Compaction triggered!\n");
-		nvmap_heap_compact(h, len, true);
+		h->compaction_count_fast++;
+		nvmap_heap_compact(h, len, true, 0);
 		b = do_heap_alloc(h, len, align, prot, 0);
 		if (!b) {
 			pr_err("Full compaction triggered!\n");
-			nvmap_heap_compact(h, len, false);
+			h->compaction_count_full++;
+			nvmap_heap_compact(h, len, false, 0);
 			b = do_heap_alloc(h, len, align, prot, 0);
 		}
 	}
 #else
+	mutex_lock(&h->lock);
+
 	if (len <= h->buddy_heap_size / 2) {
 		b = do_buddy_alloc(h, len, align, prot);
 	} else {
@@ -908,11 +1080,13 @@ void nvmap_heap_free(struct nvmap_heap_block *b)
 	struct list_block *lb;
 
 	mutex_lock(&h->lock);
+	heap_activity_locked(h);
 	if (b->type == BLOCK_BUDDY)
 		bh = do_buddy_free(b);
 	else {
 		lb = container_of(b, struct list_block, block);
 		nvmap_flush_heap_block(NULL, b, lb->size, lb->mem_prot);
+		heap_release_range(h, b->base, lb->size);
 		do_heap_free(b);
 	}
 
@@ -1000,6 +1174,7 @@ struct nvmap_heap *nvmap_heap_create(struct device *parent, const char *name,
 		dev_err(&h->dev, "%s: failed to create attributes\n", __func__);
 		goto fail_register;
 	}
+	h->cma = cma_region_contains(base, len);
 	h->small_alloc = max(2 * buddy_size, len / 256);
 	h->buddy_heap_size = buddy_size;
 	if (buddy_size)
@@ -1008,6 +1183,10 @@ struct nvmap_heap *nvmap_heap_create(struct device *parent, const char *name,
 	INIT_LIST_HEAD(&h->buddy_list);
 	INIT_LIST_HEAD(&h->all_list);
 	mutex_init(&h->lock);
+#ifdef CONFIG_NVMAP_CARVEOUT_COMPACTOR
+	INIT_DELAYED_WORK(&h->compact_work, heap_compact_work);
+	atomic_set(&h->alloc_waiting, 0);
+#endif
 	l->block.base = base;
 	l->block.type = BLOCK_EMPTY;
 	l->size = len;
@@ -1045,6 +1224,9 @@ void nvmap_heap_destroy(struct nvmap_heap *heap)
 {
 	WARN_ON(!list_empty(&heap->buddy_list));
 
+#ifdef CONFIG_NVMAP_CARVEOUT_COMPACTOR
+	cancel_delayed_work_sync(&heap->compact_work);
+#endif
 	sysfs_remove_group(&heap->dev.kobj, &heap_stat_attr_group);
 	device_unregister(&heap->dev);
 
@@ -156,6 +156,55 @@ int nvmap_ioctl_getid(struct file *filp, void __user *arg)
 	return copy_to_user(arg, &op, sizeof(op)) ? -EFAULT : 0;
 }
 
+int nvmap_ioctl_share(struct file *filp, void __user *arg)
+{
+	struct nvmap_client *client = filp->private_data;
+	struct nvmap_create_handle op;
+	struct nvmap_handle *h = NULL;
+	struct file *file;
+	int fd;
+
+	if (copy_from_user(&op, arg, sizeof(op)))
+		return -EFAULT;
+
+	if (!op.handle)
+		return -EINVAL;
+
+	h = nvmap_get_handle_id(client, op.handle);
+
+	if (!h)
+		return -EPERM;
+
+	if (!h->alloc) {
+		nvmap_handle_put(h);
+		return -EINVAL;
+	}
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		nvmap_handle_put(h);
+		return fd;
+	}
+
+	file = nvmap_share_file(h);
+	nvmap_handle_put(h);
+	if (IS_ERR(file)) {
+		put_unused_fd(fd);
+		return PTR_ERR(file);
+	}
+
+	/* the descriptor is only published once the caller can see it */
+	op.fd = fd;
+	if (copy_to_user(arg, &op, sizeof(op))) {
+		fput(file);
+		put_unused_fd(fd);
+		return -EFAULT;
+	}
+	fd_install(fd, file);
+
+	return 0;
+}
+
 int nvmap_ioctl_alloc(struct file *filp, void __user *arg)
 {
 	struct nvmap_alloc_handle op;
@@ -197,6 +246,8 @@ int nvmap_ioctl_create(struct file *filp, unsigned int cmd, void __user *arg)
 			ref->handle->orig_size = op.size;
 	} else if (cmd == NVMAP_IOC_FROM_ID) {
 		ref = nvmap_duplicate_handle_id(client, op.id);
+	} else if (cmd == NVMAP_IOC_FROM_FD) {
+		ref = nvmap_import_fd(client, op.fd);
 	} else {
 		return -EINVAL;
 	}
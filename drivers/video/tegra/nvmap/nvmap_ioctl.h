@@ -49,6 +49,7 @@ struct nvmap_create_handle {
 		__u32 key;	/* ClaimPreservedHandle */
 		__u32 id;	/* FromId */
 		__u32 size;	/* CreateHandle */
+		__s32 fd;	/* Share / FromFd */
 	};
 	__u32 handle;
 };
@@ -136,7 +137,15 @@ struct nvmap_cache_op {
  * reference to the same handle */
 #define NVMAP_IOC_GET_ID  _IOWR(NVMAP_IOC_MAGIC, 13, struct nvmap_create_handle)
 
-#define NVMAP_IOC_MAXNR (_IOC_NR(NVMAP_IOC_GET_ID))
+/* Exports a handle as a file descriptor which may be mmapped directly by
+ * any process holding it and passed between processes like any other fd
+ * (e.g. over binder); on return, fd holds the new descriptor */
+#define NVMAP_IOC_SHARE   _IOWR(NVMAP_IOC_MAGIC, 14, struct nvmap_create_handle)
+
+/* Creates a handle reference from a descriptor returned by NVMAP_IOC_SHARE */
+#define NVMAP_IOC_FROM_FD _IOWR(NVMAP_IOC_MAGIC, 15, struct nvmap_create_handle)
+
+#define NVMAP_IOC_MAXNR (_IOC_NR(NVMAP_IOC_FROM_FD))
 
 #ifdef  __KERNEL__
 int nvmap_ioctl_pinop(struct file *filp, bool is_pin, void __user *arg);
@@ -145,6 +154,8 @@ int nvmap_ioctl_get_param(struct file *filp, void __user* arg);
 
 int nvmap_ioctl_getid(struct file *filp, void __user *arg);
 
+int nvmap_ioctl_share(struct file *filp, void __user *arg);
+
 int nvmap_ioctl_alloc(struct file *filp, void __user *arg);
 
 int nvmap_ioctl_free(struct file *filp, unsigned long arg);
@@ -22,6 +22,7 @@
 
 #include <linux/list.h>
 #include <linux/slab.h>
+#include <linux/bitops.h>
 
 #include <asm/pgtable.h>
 
@@ -31,9 +32,12 @@
 #include "nvmap_mru.h"
 
 /* if IOVMM reclamation is enabled (CONFIG_NVMAP_RECLAIM_UNPINNED_VM),
- * unpinned handles are placed onto a most-recently-used eviction list;
- * multiple lists are maintained, segmented by size (sizes were chosen to
- * roughly correspond with common sizes for graphics surfaces).
+ * unpinned handles are placed at the tail of an eviction list, so that
+ * the head is the least recently unpinned one; multiple lists are
+ * maintained, segmented by size (sizes were chosen to roughly correspond
+ * with common sizes for graphics surfaces). share->mru_nonempty has a bit
+ * set for each list which is not empty, so that a victim is found without
+ * walking empty lists.
  *
  * if a handle is located on the MRU list, then the code below may
  * steal its IOVMM area at any time to satisfy a pin operation if no
@@ -44,16 +48,31 @@ static const size_t mru_cutoff[] = {
 	262144, 393216, 786432, 1048576, 1572864
 };
 
-static inline struct list_head *mru_list(struct nvmap_share *share, size_t size)
+static inline unsigned int mru_index(size_t size)
 {
 	unsigned int i;
 
-	BUG_ON(!share->mru_lists);
 	for (i = 0; i < ARRAY_SIZE(mru_cutoff); i++)
 		if (size <= mru_cutoff[i])
 			break;
 
-	return &share->mru_lists[i];
+	return i;
+}
+
+static inline struct list_head *mru_list(struct nvmap_share *share, size_t size)
+{
+	BUG_ON(!share->mru_lists);
+	return &share->mru_lists[mru_index(size)];
+}
+
+/* takes h off its MRU list, h must be on one. caller holds the mru lock */
+static void mru_del_locked(struct nvmap_share *share, struct nvmap_handle *h)
+{
+	unsigned int idx = mru_index(h->pgalloc.area->iovm_length);
+
+	list_del_init(&h->pgalloc.mru_list);
+	if (list_empty(&share->mru_lists[idx]))
+		clear_bit(idx, &share->mru_nonempty);
 }
 
 size_t nvmap_mru_vm_size(struct tegra_iovmm_client *iovmm)
@@ -65,15 +84,17 @@ size_t nvmap_mru_vm_size(struct tegra_iovmm_client *iovmm)
 /*  nvmap_mru_vma_lock should be acquired by the caller before calling this */
 void nvmap_mru_insert_locked(struct nvmap_share *share, struct nvmap_handle *h)
 {
-	size_t len = h->pgalloc.area->iovm_length;
-	list_add(&h->pgalloc.mru_list, mru_list(share, len));
+	unsigned int idx = mru_index(h->pgalloc.area->iovm_length);
+
+	list_add_tail(&h->pgalloc.mru_list, &share->mru_lists[idx]);
+	set_bit(idx, &share->mru_nonempty);
 }
 
 void nvmap_mru_remove(struct nvmap_share *s, struct nvmap_handle *h)
 {
 	nvmap_mru_lock(s);
 	if (!list_empty(&h->pgalloc.mru_list))
-		list_del(&h->pgalloc.mru_list);
+		mru_del_locked(s, h);
 	nvmap_mru_unlock(s);
 	INIT_LIST_HEAD(&h->pgalloc.mru_list);
 }
@@ -84,11 +105,12 @@ void nvmap_mru_remove(struct nvmap_share *s, struct nvmap_handle *h)
  *
  * if no existing allocation exists, try to allocate a new IOVMM area.
  *
- * if a new area can not be allocated, try to re-use the most-recently-unpinned
- * handle's allocation.
+ * if a new area can not be allocated, try to re-use the least recently
+ * unpinned allocation of the same size bin.
  *
- * and if that fails, iteratively evict handles from the MRU lists and free
- * their allocations, until the new allocation succeeds.
+ * and if that fails, iteratively evict the least recently unpinned handles
+ * of the non-empty MRU lists and free their allocations, until the new
+ * allocation succeeds.
  */
 struct tegra_iovmm_area *nvmap_handle_iovmm_locked(struct nvmap_client *c,
 					    struct nvmap_handle *h)
@@ -96,7 +118,7 @@ struct tegra_iovmm_area *nvmap_handle_iovmm_locked(struct nvmap_client *c,
 	struct list_head *mru;
 	struct nvmap_handle *evict = NULL;
 	struct tegra_iovmm_area *vm = NULL;
-	unsigned int i, idx;
+	unsigned int idx;
 	pgprot_t prot;
 
 	BUG_ON(!h || !c || !c->share);
@@ -105,8 +127,7 @@ struct tegra_iovmm_area *nvmap_handle_iovmm_locked(struct nvmap_client *c,
 
 	if (h->pgalloc.area) {
 		BUG_ON(list_empty(&h->pgalloc.mru_list));
-		list_del(&h->pgalloc.mru_list);
-		INIT_LIST_HEAD(&h->pgalloc.mru_list);
+		mru_del_locked(c->share, h);
 		return h->pgalloc.area;
 	}
 
@@ -121,7 +142,7 @@ struct tegra_iovmm_area *nvmap_handle_iovmm_locked(struct nvmap_client *c,
 	/* if client is looking for specific iovm address, return from here. */
 	if ((vm == NULL) && (h->pgalloc.iovm_addr != 0))
 		return NULL;
-	/* attempt to re-use the most recently unpinned IOVMM area in the
+	/* attempt to re-use the least recently unpinned IOVMM area in the
 	 * same size bin as the current handle. If that fails, iteratively
 	 * evict handles (starting from the current bin) until an allocation
 	 * succeeds or no more areas can be evicted */
@@ -131,33 +152,36 @@ struct tegra_iovmm_area *nvmap_handle_iovmm_locked(struct nvmap_client *c,
 					 pgalloc.mru_list);
 
 	if (evict && evict->pgalloc.area->iovm_length >= h->size) {
-		list_del(&evict->pgalloc.mru_list);
+		mru_del_locked(c->share, evict);
 		vm = evict->pgalloc.area;
 		evict->pgalloc.area = NULL;
-		INIT_LIST_HEAD(&evict->pgalloc.mru_list);
+		c->share->mru_reused++;
 		return vm;
 	}
 
 	idx = mru - c->share->mru_lists;
 
-	for (i = 0; i < c->share->nr_mru && !vm; i++, idx++) {
+	while (!vm) {
+		idx = find_next_bit(&c->share->mru_nonempty,
+				    c->share->nr_mru, idx);
+		if (idx >= c->share->nr_mru)
+			idx = find_first_bit(&c->share->mru_nonempty,
+					     c->share->nr_mru);
 		if (idx >= c->share->nr_mru)
-			idx = 0;
-		mru = &c->share->mru_lists[idx];
-		while (!list_empty(mru) && !vm) {
-			evict = list_first_entry(mru, struct nvmap_handle,
-						 pgalloc.mru_list);
-
-			BUG_ON(atomic_read(&evict->pin) != 0);
-			BUG_ON(!evict->pgalloc.area);
-			list_del(&evict->pgalloc.mru_list);
-			INIT_LIST_HEAD(&evict->pgalloc.mru_list);
-			tegra_iovmm_free_vm(evict->pgalloc.area);
-			evict->pgalloc.area = NULL;
-			vm = tegra_iovmm_create_vm(c->share->iovmm,
-					NULL, h->size, h->align,
-					prot, h->pgalloc.iovm_addr);
-		}
+			break;
+
+		evict = list_first_entry(&c->share->mru_lists[idx],
+					 struct nvmap_handle, pgalloc.mru_list);
+
+		BUG_ON(atomic_read(&evict->pin) != 0);
+		BUG_ON(!evict->pgalloc.area);
+		mru_del_locked(c->share, evict);
+		tegra_iovmm_free_vm(evict->pgalloc.area);
+		evict->pgalloc.area = NULL;
+		c->share->mru_evicted++;
+		vm = tegra_iovmm_create_vm(c->share->iovmm,
+				NULL, h->size, h->align,
+				prot, h->pgalloc.iovm_addr);
 	}
 	return vm;
 }
@@ -167,6 +191,8 @@ int nvmap_mru_init(struct nvmap_share *share)
 	int i;
 	mutex_init(&share->mru_lock);
 	share->nr_mru = ARRAY_SIZE(mru_cutoff) + 1;
+	BUILD_BUG_ON(ARRAY_SIZE(mru_cutoff) + 1 > BITS_PER_LONG);
+	share->mru_nonempty = 0;
 
 	share->mru_lists = kzalloc(sizeof(struct list_head) * share->nr_mru,
 				   GFP_KERNEL);
@@ -35,7 +35,10 @@ struct tegra_iovmm_client;
 
 static inline void nvmap_mru_lock(struct nvmap_share *share)
 {
-	mutex_lock(&share->mru_lock);
+	if (!mutex_trylock(&share->mru_lock)) {
+		mutex_lock(&share->mru_lock);
+		share->mru_contended++;
+	}
 }
 
 static inline void nvmap_mru_unlock(struct nvmap_share *share)
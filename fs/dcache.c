@@ -36,6 +36,8 @@
 #include <linux/bit_spinlock.h>
 #include <linux/rculist_bl.h>
 #include <linux/prefetch.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include "internal.h"
 
 /*
@@ -79,6 +81,12 @@
 int sysctl_vfs_cache_pressure __read_mostly = 100;
 EXPORT_SYMBOL_GPL(sysctl_vfs_cache_pressure);
 
+/*
+ * Upper bound, per superblock, on negative dentries that may carry
+ * DCACHE_NEG_HOT at once.  Zero disables the reserve.
+ */
+int sysctl_neg_dentry_reserve __read_mostly = 1024;
+
 static __cacheline_aligned_in_smp DEFINE_SPINLOCK(dcache_lru_lock);
 __cacheline_aligned_in_smp DEFINE_SEQLOCK(rename_lock);
 
@@ -117,6 +125,8 @@ struct dentry_stat_t dentry_stat = {
 
 static DEFINE_PER_CPU(unsigned int, nr_dentry);
 
+DEFINE_PER_CPU(struct dcache_lookup_stats, dcache_lookup_stats);
+
 #if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
 static int get_nr_dentry(void)
 {
@@ -152,6 +162,8 @@ static void d_free(struct dentry *dentry)
 {
 	BUG_ON(dentry->d_count);
 	this_cpu_dec(nr_dentry);
+	if (unlikely(dentry->d_flags & DCACHE_NEG_HOT))
+		atomic_dec(&dentry->d_sb->s_nr_neg_hot);
 	if (dentry->d_op && dentry->d_op->d_release)
 		dentry->d_op->d_release(dentry);
 
@@ -778,7 +790,21 @@ relock:
 			dentry->d_flags &= ~DCACHE_REFERENCED;
 			list_move(&dentry->d_lru, &referenced);
 			spin_unlock(&dentry->d_lock);
+		} else if (flags & DCACHE_REFERENCED &&
+				dentry->d_flags & DCACHE_NEG_HOT) {
+			/*
+			 * Same second chance for negative dentries that were
+			 * hit by rcu-walk, which never dputs and so never sets
+			 * DCACHE_REFERENCED.
+			 */
+			dentry->d_flags &= ~DCACHE_NEG_HOT;
+			atomic_dec(&sb->s_nr_neg_hot);
+			dcache_stat_inc(neg_kept);
+			list_move(&dentry->d_lru, &referenced);
+			spin_unlock(&dentry->d_lock);
 		} else {
+			if (!dentry->d_inode)
+				dcache_stat_inc(neg_pruned);
 			list_move_tail(&dentry->d_lru, &tmp);
 			spin_unlock(&dentry->d_lock);
 			if (!--count)
@@ -1287,6 +1313,38 @@ void d_set_d_op(struct dentry *dentry, const struct dentry_operations *op)
 }
 EXPORT_SYMBOL(d_set_d_op);
 
+/**
+ * d_negative_hit - note a lookup that ended on a negative dentry
+ * @dentry: the negative dentry
+ *
+ * Lookups of files that do not exist (the same config and library paths
+ * probed over and over) are answered by negative dentries.  Under rcu-walk
+ * those hits take no reference, so the dentry never gets DCACHE_REFERENCED
+ * and looks cold to the LRU.  Mark it DCACHE_NEG_HOT instead, up to
+ * sysctl_neg_dentry_reserve per superblock, so the shrinker passes it over
+ * once.  Safe to call in rcu-walk mode.
+ */
+void d_negative_hit(struct dentry *dentry)
+{
+	struct super_block *sb = dentry->d_sb;
+
+	dcache_stat_inc(neg_hits);
+	/* racy pre-checks keep the common case off d_lock */
+	if (dentry->d_flags & DCACHE_NEG_HOT)
+		return;
+	if (atomic_read(&sb->s_nr_neg_hot) >= sysctl_neg_dentry_reserve)
+		return;
+
+	spin_lock(&dentry->d_lock);
+	if (!dentry->d_inode && !d_unhashed(dentry) &&
+	    !(dentry->d_flags & DCACHE_NEG_HOT)) {
+		dentry->d_flags |= DCACHE_NEG_HOT;
+		atomic_inc(&sb->s_nr_neg_hot);
+		dcache_stat_inc(neg_marked);
+	}
+	spin_unlock(&dentry->d_lock);
+}
+
 static void __d_instantiate(struct dentry *dentry, struct inode *inode)
 {
 	spin_lock(&dentry->d_lock);
@@ -1294,6 +1352,10 @@ static void __d_instantiate(struct dentry *dentry, struct inode *inode)
 		if (unlikely(IS_AUTOMOUNT(inode)))
 			dentry->d_flags |= DCACHE_NEED_AUTOMOUNT;
 		list_add(&dentry->d_alias, &inode->i_dentry);
+		if (dentry->d_flags & DCACHE_NEG_HOT) {
+			dentry->d_flags &= ~DCACHE_NEG_HOT;
+			atomic_dec(&dentry->d_sb->s_nr_neg_hot);
+		}
 	}
 	dentry->d_inode = inode;
 	dentry_rcuwalk_barrier(dentry);
@@ -2992,6 +3054,69 @@ static void __init dcache_init(void)
 		INIT_HLIST_BL_HEAD(dentry_hashtable + loop);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int dcache_stats_show(struct seq_file *s, void *data)
+{
+	struct dcache_lookup_stats sum;
+	int cpu;
+
+	memset(&sum, 0, sizeof(sum));
+	for_each_possible_cpu(cpu) {
+		struct dcache_lookup_stats *st = &per_cpu(dcache_lookup_stats, cpu);
+
+		sum.rcu_walks += st->rcu_walks;
+		sum.rcu_fallbacks += st->rcu_fallbacks;
+		sum.estale_retries += st->estale_retries;
+		sum.neg_hits += st->neg_hits;
+		sum.neg_marked += st->neg_marked;
+		sum.neg_kept += st->neg_kept;
+		sum.neg_pruned += st->neg_pruned;
+	}
+
+	seq_printf(s, "rcu_walks:      %lu\n", sum.rcu_walks);
+	seq_printf(s, "rcu_fallbacks:  %lu\n", sum.rcu_fallbacks);
+	seq_printf(s, "estale_retries: %lu\n", sum.estale_retries);
+	seq_printf(s, "neg_hits:       %lu\n", sum.neg_hits);
+	seq_printf(s, "neg_marked:     %lu\n", sum.neg_marked);
+	seq_printf(s, "neg_kept:       %lu\n", sum.neg_kept);
+	seq_printf(s, "neg_pruned:     %lu\n", sum.neg_pruned);
+	seq_printf(s, "neg_reserve:    %d\n", sysctl_neg_dentry_reserve);
+	return 0;
+}
+
+static int dcache_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dcache_stats_show, inode->i_private);
+}
+
+static ssize_t dcache_stats_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(&per_cpu(dcache_lookup_stats, cpu), 0,
+		       sizeof(struct dcache_lookup_stats));
+	return count;
+}
+
+static const struct file_operations dcache_stats_fops = {
+	.open		= dcache_stats_open,
+	.read		= seq_read,
+	.write		= dcache_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dcache_stats_init(void)
+{
+	debugfs_create_file("dcache_stats", S_IRUGO | S_IWUSR, NULL, NULL,
+			    &dcache_stats_fops);
+	return 0;
+}
+late_initcall(dcache_stats_init);
+#endif
+
 /* SLAB cache for __getname() consumers */
 struct kmem_cache *names_cachep __read_mostly;
 EXPORT_SYMBOL(names_cachep);
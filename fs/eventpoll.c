@@ -33,6 +33,9 @@
 #include <linux/bitops.h>
 #include <linux/mutex.h>
 #include <linux/anon_inodes.h>
+#include <linux/percpu.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <asm/uaccess.h>
 #include <asm/system.h>
 #include <asm/io.h>
@@ -197,6 +200,13 @@ struct eventpoll {
 
 	/* The user that created the eventpoll descriptor */
 	struct user_struct *user;
+
+	/*
+	 * Set, under ->lock, once a waiter on ->wq has been woken and cleared
+	 * when it takes itself off the queue.  Until then further wakeups
+	 * would only hit the same, already runnable, task.
+	 */
+	int wake_pending;
 };
 
 /* Wait structure used by the poll hooks */
@@ -229,6 +239,32 @@ struct ep_send_events_data {
 	struct epoll_event __user *events;
 };
 
+/*
+ * Ready events are gathered on the stack and copied to userspace this many
+ * at a time, instead of two __put_user() calls per event.
+ */
+#define EP_SEND_BATCH	16
+
+struct ep_send_batch {
+	int nr;
+	struct epitem *epi[EP_SEND_BATCH];
+	struct epoll_event ev[EP_SEND_BATCH];
+};
+
+/* Wakeup and delivery counters, see /sys/kernel/debug/epoll_stats */
+struct ep_stats {
+	unsigned long callbacks;	/* ep_poll_callback() invocations */
+	unsigned long wakeups;		/* waiters actually woken */
+	unsigned long coalesced;	/* wakeups skipped, waiter already woken */
+	unsigned long harvests;		/* ready-list scans for epoll_wait() */
+	unsigned long events;		/* events delivered to userspace */
+	unsigned long batches;		/* copy_to_user() calls for them */
+};
+static DEFINE_PER_CPU(struct ep_stats, ep_stats);
+
+#define ep_stat_inc(field)	this_cpu_inc(ep_stats.field)
+#define ep_stat_add(field, n)	this_cpu_add(ep_stats.field, n)
+
 /*
  * Configuration options available inside /proc/sys/fs/epoll/
  */
@@ -337,6 +373,24 @@ static inline int ep_events_available(struct eventpoll *ep)
 	return !list_empty(&ep->rdllist) || ep->ovflist != EP_UNACTIVE_PTR;
 }
 
+/*
+ * Wake one epoll_wait() sleeper, unless one has already been woken and has
+ * not yet got round to collecting the ready list.  Must be called with
+ * "ep->lock" held.
+ */
+static inline void ep_wake_locked(struct eventpoll *ep)
+{
+	if (!waitqueue_active(&ep->wq))
+		return;
+	if (ep->wake_pending) {
+		ep_stat_inc(coalesced);
+		return;
+	}
+	ep->wake_pending = 1;
+	ep_stat_inc(wakeups);
+	wake_up_locked(&ep->wq);
+}
+
 /**
  * ep_call_nested - Perform a bound (possibly) nested call, by checking
  *                  that the recursion limit is not exceeded, and that
@@ -546,8 +600,7 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 		 * Wake up (if active) both the eventpoll wait list and
 		 * the ->poll() wait list (delayed after we release the lock).
 		 */
-		if (waitqueue_active(&ep->wq))
-			wake_up_locked(&ep->wq);
+		ep_wake_locked(ep);
 		if (waitqueue_active(&ep->poll_wait))
 			pwake++;
 	}
@@ -828,6 +881,7 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	struct eventpoll *ep = epi->ep;
 
 	spin_lock_irqsave(&ep->lock, flags);
+	ep_stat_inc(callbacks);
 
 	/*
 	 * If the event mask does not contain any poll(2) event, we consider the
@@ -869,8 +923,7 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
 	 * wait list.
 	 */
-	if (waitqueue_active(&ep->wq))
-		wake_up_locked(&ep->wq);
+	ep_wake_locked(ep);
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
 
@@ -1078,14 +1131,65 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 	return 0;
 }
 
+/*
+ * Copy the gathered events to userspace and only then finish off their
+ * items.  On a fault the whole batch goes back to the head of @head, in
+ * order, so nothing is lost.
+ */
+static int ep_send_batch_flush(struct eventpoll *ep, struct list_head *head,
+			       struct ep_send_batch *b,
+			       struct epoll_event __user *uevent)
+{
+	struct epitem *epi;
+	int i;
+
+	if (!b->nr)
+		return 0;
+
+	if (__copy_to_user(uevent, b->ev, b->nr * sizeof(struct epoll_event))) {
+		for (i = b->nr - 1; i >= 0; i--)
+			list_add(&b->epi[i]->rdllink, head);
+		b->nr = 0;
+		return -EFAULT;
+	}
+	ep_stat_inc(batches);
+
+	for (i = 0; i < b->nr; i++) {
+		epi = b->epi[i];
+		if (epi->event.events & EPOLLONESHOT)
+			epi->event.events &= EP_PRIVATE_BITS;
+		else if (!(epi->event.events & EPOLLET)) {
+			/*
+			 * If this file has been added with Level
+			 * Trigger mode, we need to insert back inside
+			 * the ready list, so that the next call to
+			 * epoll_wait() will check again the events
+			 * availability. At this point, no one can insert
+			 * into ep->rdllist besides us. The epoll_ctl()
+			 * callers are locked out by
+			 * ep_scan_ready_list() holding "mtx" and the
+			 * poll callback will queue them in ep->ovflist.
+			 */
+			list_add_tail(&epi->rdllink, &ep->rdllist);
+		}
+	}
+	i = b->nr;
+	b->nr = 0;
+	return i;
+}
+
 static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 			       void *priv)
 {
 	struct ep_send_events_data *esed = priv;
-	int eventcnt;
+	int eventcnt, sent;
 	unsigned int revents;
 	struct epitem *epi;
 	struct epoll_event __user *uevent;
+	struct ep_send_batch batch;
+
+	ep_stat_inc(harvests);
+	batch.nr = 0;
 
 	/*
 	 * We can loop without lock because we are passed a task private list.
@@ -1093,7 +1197,7 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 	 * holding "mtx" during this call.
 	 */
 	for (eventcnt = 0, uevent = esed->events;
-	     !list_empty(head) && eventcnt < esed->maxevents;) {
+	     !list_empty(head) && eventcnt + batch.nr < esed->maxevents;) {
 		epi = list_first_entry(head, struct epitem, rdllink);
 
 		list_del_init(&epi->rdllink);
@@ -1107,33 +1211,28 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 		 * is holding "mtx", so no operations coming from userspace
 		 * can change the item.
 		 */
-		if (revents) {
-			if (__put_user(revents, &uevent->events) ||
-			    __put_user(epi->event.data, &uevent->data)) {
-				list_add(&epi->rdllink, head);
-				return eventcnt ? eventcnt : -EFAULT;
-			}
-			eventcnt++;
-			uevent++;
-			if (epi->event.events & EPOLLONESHOT)
-				epi->event.events &= EP_PRIVATE_BITS;
-			else if (!(epi->event.events & EPOLLET)) {
-				/*
-				 * If this file has been added with Level
-				 * Trigger mode, we need to insert back inside
-				 * the ready list, so that the next call to
-				 * epoll_wait() will check again the events
-				 * availability. At this point, no one can insert
-				 * into ep->rdllist besides us. The epoll_ctl()
-				 * callers are locked out by
-				 * ep_scan_ready_list() holding "mtx" and the
-				 * poll callback will queue them in ep->ovflist.
-				 */
-				list_add_tail(&epi->rdllink, &ep->rdllist);
-			}
-		}
+		if (!revents)
+			continue;
+
+		batch.epi[batch.nr] = epi;
+		batch.ev[batch.nr].events = revents;
+		batch.ev[batch.nr].data = epi->event.data;
+		if (++batch.nr < EP_SEND_BATCH)
+			continue;
+
+		sent = ep_send_batch_flush(ep, head, &batch, uevent);
+		if (sent < 0)
+			return eventcnt ? eventcnt : sent;
+		eventcnt += sent;
+		uevent += sent;
 	}
 
+	sent = ep_send_batch_flush(ep, head, &batch, uevent);
+	if (sent < 0)
+		return eventcnt ? eventcnt : sent;
+	eventcnt += sent;
+	ep_stat_add(events, eventcnt);
+
 	return eventcnt;
 }
 
@@ -1232,8 +1331,15 @@ fetch_events:
 				timed_out = 1;
 
 			spin_lock_irqsave(&ep->lock, flags);
+			/*
+			 * Whatever woke us has now been seen.  If the events
+			 * were taken by another thread or removed in between,
+			 * we go back to sleep and must be wakeable again.
+			 */
+			ep->wake_pending = 0;
 		}
 		__remove_wait_queue(&ep->wq, &wait);
+		ep->wake_pending = 0;
 
 		set_current_state(TASK_RUNNING);
 	}
@@ -1600,3 +1706,70 @@ static int __init eventpoll_init(void)
 	return 0;
 }
 fs_initcall(eventpoll_init);
+
+#ifdef CONFIG_DEBUG_FS
+static int ep_stats_show(struct seq_file *m, void *unused)
+{
+	struct ep_stats sum;
+	int cpu;
+
+	memset(&sum, 0, sizeof(sum));
+	for_each_possible_cpu(cpu) {
+		struct ep_stats *st = &per_cpu(ep_stats, cpu);
+
+		sum.callbacks += st->callbacks;
+		sum.wakeups += st->wakeups;
+		sum.coalesced += st->coalesced;
+		sum.harvests += st->harvests;
+		sum.events += st->events;
+		sum.batches += st->batches;
+	}
+
+	seq_printf(m, "callbacks:  %lu\n", sum.callbacks);
+	seq_printf(m, "wakeups:    %lu\n", sum.wakeups);
+	seq_printf(m, "coalesced:  %lu\n", sum.coalesced);
+	seq_printf(m, "harvests:   %lu\n", sum.harvests);
+	seq_printf(m, "events:     %lu\n", sum.events);
+	seq_printf(m, "batches:    %lu\n", sum.batches);
+	if (sum.wakeups)
+		seq_printf(m, "callbacks/wakeup: %lu.%02lu\n",
+			   sum.callbacks / sum.wakeups,
+			   (sum.callbacks % sum.wakeups) * 100 / sum.wakeups);
+	if (sum.harvests)
+		seq_printf(m, "events/harvest:   %lu.%02lu\n",
+			   sum.events / sum.harvests,
+			   (sum.events % sum.harvests) * 100 / sum.harvests);
+	return 0;
+}
+
+static int ep_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ep_stats_show, NULL);
+}
+
+static ssize_t ep_stats_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(&per_cpu(ep_stats, cpu), 0, sizeof(struct ep_stats));
+	return count;
+}
+
+static const struct file_operations ep_stats_fops = {
+	.open		= ep_stats_open,
+	.read		= seq_read,
+	.write		= ep_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init ep_stats_init(void)
+{
+	debugfs_create_file("epoll_stats", S_IRUGO | S_IWUSR, NULL, NULL,
+			    &ep_stats_fops);
+	return 0;
+}
+late_initcall(ep_stats_init);
+#endif
@@ -1174,6 +1174,7 @@ struct ext4_sb_info {
 	unsigned int s_mb_stats;
 	unsigned int s_mb_order2_reqs;
 	unsigned int s_mb_group_prealloc;
+	unsigned int s_mb_pack_small;
 	unsigned int s_max_writeback_mb_bump;
 	/* where last allocation was done - for stream allocation */
 	unsigned long s_mb_last_group;
@@ -1195,6 +1196,12 @@ struct ext4_sb_info {
 	atomic_t s_mb_discarded;
 	atomic_t s_lock_busy;
 
+	/* data allocation layout, see mb_frag_stats in sysfs */
+	atomic_t s_mb_frag_allocs;	/* allocs following a mapped block */
+	atomic_t s_mb_frag_contig;	/* ... that extended it physically */
+	atomic_t s_mb_pack_allocs;	/* allocs through a packing group */
+	atomic_t s_mb_pack_pa_skips;	/* group pa skipped, not in goal group */
+
 	/* locality groups */
 	struct ext4_locality_group __percpu *s_locality_groups;
 
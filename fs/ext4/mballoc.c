@@ -2474,6 +2474,7 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 	sbi->s_mb_stream_request = MB_DEFAULT_STREAM_THRESHOLD;
 	sbi->s_mb_order2_reqs = MB_DEFAULT_ORDER2_REQS;
 	sbi->s_mb_group_prealloc = MB_DEFAULT_GROUP_PREALLOC;
+	sbi->s_mb_pack_small = MB_DEFAULT_PACK_SMALL;
 	/*
 	 * If there is a s_stripe > 1, then we set the s_mb_group_prealloc
 	 * to the lowest multiple of s_stripe which is bigger than
@@ -3065,6 +3066,23 @@ ext4_mb_normalize_request(struct ext4_allocation_context *ac,
 		(unsigned) orig_size, (unsigned) start);
 }
 
+/*
+ * Count data allocations that follow an already mapped logical block and
+ * how many of them continued it physically; the rest start a new extent.
+ */
+static void ext4_mb_frag_stats(struct ext4_sb_info *sbi,
+			       struct ext4_allocation_request *ar,
+			       ext4_fsblk_t block)
+{
+	if (!(ar->flags & EXT4_MB_HINT_DATA) || !ar->pleft ||
+	    ar->lleft + 1 != ar->logical)
+		return;
+
+	atomic_inc(&sbi->s_mb_frag_allocs);
+	if (ar->pleft + 1 == block)
+		atomic_inc(&sbi->s_mb_frag_contig);
+}
+
 static void ext4_mb_collect_stats(struct ext4_allocation_context *ac)
 {
 	struct ext4_sb_info *sbi = EXT4_SB(ac->ac_sb);
@@ -3265,6 +3283,22 @@ ext4_mb_use_preallocated(struct ext4_allocation_context *ac)
 		}
 		rcu_read_unlock();
 	}
+	if (cpa && EXT4_SB(ac->ac_sb)->s_mb_pack_small) {
+		ext4_group_t grp;
+
+		/*
+		 * When packing, a pa left behind in another block group
+		 * by a different directory is not worth following: start a
+		 * new one at the goal instead.
+		 */
+		ext4_get_group_no_and_offset(ac->ac_sb, cpa->pa_pstart,
+					     &grp, NULL);
+		if (grp != ac->ac_g_ex.fe_group) {
+			atomic_dec(&cpa->pa_count);
+			atomic_inc(&EXT4_SB(ac->ac_sb)->s_mb_pack_pa_skips);
+			cpa = NULL;
+		}
+	}
 	if (cpa) {
 		ext4_mb_use_group_pa(ac, cpa);
 		ac->ac_criteria = 20;
@@ -3939,6 +3973,26 @@ static inline void ext4_mb_show_ac(struct ext4_allocation_context *ac)
 }
 #endif
 
+/*
+ * In packing mode the locality group is picked from the inode's block
+ * group, which the inode allocator chose near its parent directory, so
+ * small files of one directory share a group and its preallocation no
+ * matter which CPU writes them back.  lg_mutex already serializes users
+ * of a group, sharing it across CPUs only costs contention.
+ */
+static struct ext4_locality_group *
+ext4_mb_pack_lg(struct ext4_sb_info *sbi, ext4_group_t group)
+{
+	unsigned int n = group % num_possible_cpus();
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		if (n-- == 0)
+			break;
+
+	return per_cpu_ptr(sbi->s_locality_groups, cpu);
+}
+
 /*
  * We use locality group preallocation for small size file. The size of the
  * file is determined by the current size or the resulting size after
@@ -3962,7 +4016,12 @@ static void ext4_mb_group_or_file(struct ext4_allocation_context *ac)
 	isize = (i_size_read(ac->ac_inode) + ac->ac_sb->s_blocksize - 1)
 		>> bsbits;
 
-	if ((size == isize) &&
+	/*
+	 * A small file written and closed in one go would otherwise get a
+	 * best-fit extent of its own; when packing, keep it in the group
+	 * preallocation so consecutive files land back to back.
+	 */
+	if ((size == isize) && !sbi->s_mb_pack_small &&
 	    !ext4_fs_is_busy(sbi) &&
 	    (atomic_read(&ac->ac_inode->i_writecount) == 0)) {
 		ac->ac_flags |= EXT4_MB_HINT_NOPREALLOC;
@@ -3982,7 +4041,12 @@ static void ext4_mb_group_or_file(struct ext4_allocation_context *ac)
 	 * per cpu locality group is to reduce the contention between block
 	 * request from multiple CPUs.
 	 */
-	ac->ac_lg = __this_cpu_ptr(sbi->s_locality_groups);
+	if (sbi->s_mb_pack_small) {
+		ac->ac_lg = ext4_mb_pack_lg(sbi,
+				EXT4_I(ac->ac_inode)->i_block_group);
+		atomic_inc(&sbi->s_mb_pack_allocs);
+	} else
+		ac->ac_lg = __this_cpu_ptr(sbi->s_locality_groups);
 
 	/* we're going to use group allocation */
 	ac->ac_flags |= EXT4_MB_HINT_GROUP_ALLOC;
@@ -4346,6 +4410,7 @@ repeat:
 		else {
 			block = ext4_grp_offs_to_block(sb, &ac->ac_b_ex);
 			ar->len = ac->ac_b_ex.fe_len;
+			ext4_mb_frag_stats(sbi, ar, block);
 		}
 	} else {
 		freed  = ext4_mb_discard_preallocations(sb, ac->ac_o_ex.fe_len);
@@ -94,6 +94,13 @@ extern u8 mb_enable_debug;
  */
 #define MB_DEFAULT_GROUP_PREALLOC	512
 
+/*
+ * small file packing: pick the locality group by directory instead of
+ * by CPU and keep closed small files in group preallocation, off by
+ * default.  Tunable via /sys/fs/ext4/<partition>/mb_pack_small
+ */
+#define MB_DEFAULT_PACK_SMALL		0
+
 
 struct ext4_free_data {
 	/* this links the free block information from group_info */
@@ -16,6 +16,8 @@
 #include <linux/f2fs_fs.h>
 #include <linux/pagevec.h>
 #include <linux/swap.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
 
 #include "f2fs.h"
 #include "node.h"
@@ -392,7 +394,7 @@ static struct page *validate_checkpoint(struct f2fs_sb_info *sbi,
 		goto invalid_cp1;
 
 	crc = le32_to_cpu(*((__u32 *)((unsigned char *)cp_block + crc_offset)));
-	if (!f2fs_crc_valid(crc, cp_block, crc_offset))
+	if (!f2fs_crc_valid(sbi, crc, cp_block, crc_offset))
 		goto invalid_cp1;
 
 	pre_version = cur_cp_version(cp_block);
@@ -407,7 +409,7 @@ static struct page *validate_checkpoint(struct f2fs_sb_info *sbi,
 		goto invalid_cp2;
 
 	crc = le32_to_cpu(*((__u32 *)((unsigned char *)cp_block + crc_offset)));
-	if (!f2fs_crc_valid(crc, cp_block, crc_offset))
+	if (!f2fs_crc_valid(sbi, crc, cp_block, crc_offset))
 		goto invalid_cp2;
 
 	cur_version = cur_cp_version(cp_block);
@@ -621,6 +623,32 @@ retry:
 /*
  * Freeze all the FS-operations for checkpoint.
  */
+/*
+ * Write back what is already dirty while writers can still run, so that
+ * block_operations() and do_checkpoint() only have to deal with what was
+ * dirtied in the meantime.
+ */
+static void prepare_checkpoint(struct f2fs_sb_info *sbi)
+{
+	struct writeback_control wbc = {
+		.sync_mode = WB_SYNC_ALL,
+		.nr_to_write = LONG_MAX,
+		.for_reclaim = 0,
+	};
+	struct blk_plug plug;
+
+	blk_start_plug(&plug);
+
+	if (get_pages(sbi, F2FS_DIRTY_DENTS))
+		sync_dirty_dir_inodes(sbi);
+	if (get_pages(sbi, F2FS_DIRTY_NODES))
+		sync_node_pages(sbi, 0, &wbc);
+	if (get_pages(sbi, F2FS_DIRTY_META))
+		sync_meta_pages(sbi, META, LONG_MAX);
+
+	blk_finish_plug(&plug);
+}
+
 static void block_operations(struct f2fs_sb_info *sbi)
 {
 	struct writeback_control wbc = {
@@ -738,7 +766,7 @@ static void do_checkpoint(struct f2fs_sb_info *sbi, bool is_umount)
 	get_sit_bitmap(sbi, __bitmap_ptr(sbi, SIT_BITMAP));
 	get_nat_bitmap(sbi, __bitmap_ptr(sbi, NAT_BITMAP));
 
-	crc32 = f2fs_crc32(ckpt, le32_to_cpu(ckpt->checksum_offset));
+	crc32 = f2fs_crc32(sbi, ckpt, le32_to_cpu(ckpt->checksum_offset));
 	*((__le32 *)((unsigned char *)ckpt +
 				le32_to_cpu(ckpt->checksum_offset)))
 				= cpu_to_le32(crc32);
@@ -794,14 +822,64 @@ static void do_checkpoint(struct f2fs_sb_info *sbi, bool is_umount)
 /*
  * We guarantee that this checkpoint procedure should not fail.
  */
+struct sit_flush_work {
+	struct work_struct work;
+	struct f2fs_sb_info *sbi;
+};
+
+static void sit_flush_workfn(struct work_struct *work)
+{
+	struct sit_flush_work *sw =
+		container_of(work, struct sit_flush_work, work);
+
+	flush_sit_entries(sw->sbi);
+}
+
+/*
+ * NAT entries go to the HOT_DATA journal and NAT blocks, SIT entries to
+ * the COLD_DATA journal and SIT blocks, each under its own curseg mutex,
+ * so the SIT side is built on sbi->cp_wq while this thread does the NAT
+ * side.  Every fs operation is blocked meanwhile and this can be reached
+ * from writeback, so the queue is WQ_MEM_RECLAIM.
+ */
+static void flush_nat_sit_entries(struct f2fs_sb_info *sbi)
+{
+	struct sit_flush_work sw;
+
+	sw.sbi = sbi;
+	INIT_WORK_ONSTACK(&sw.work, sit_flush_workfn);
+	queue_work(sbi->cp_wq, &sw.work);
+
+	flush_nat_entries(sbi);
+
+	flush_work(&sw.work);
+	destroy_work_on_stack(&sw.work);
+}
+
+static inline unsigned int cp_phase_us(ktime_t *start)
+{
+	ktime_t now = ktime_get();
+	unsigned int us = ktime_to_us(ktime_sub(now, *start));
+
+	*start = now;
+	return us;
+}
+
 void write_checkpoint(struct f2fs_sb_info *sbi, bool is_umount)
 {
 	struct f2fs_checkpoint *ckpt = F2FS_CKPT(sbi);
 	unsigned long long ckpt_ver;
+	unsigned int blocked_us, us;
+	ktime_t t;
+
+	mutex_lock(&sbi->cp_mutex);
+
+	t = ktime_get();
+	prepare_checkpoint(sbi);
+	stat_cp_phase(sbi, CP_PHASE_PREFLUSH, cp_phase_us(&t));
 
 	trace_f2fs_write_checkpoint(sbi->sb, is_umount, "start block_ops");
 
-	mutex_lock(&sbi->cp_mutex);
 	block_operations(sbi);
 
 	trace_f2fs_write_checkpoint(sbi->sb, is_umount, "finish block_ops");
@@ -810,6 +888,9 @@ void write_checkpoint(struct f2fs_sb_info *sbi, bool is_umount)
 	f2fs_submit_bio(sbi, NODE, true);
 	f2fs_submit_bio(sbi, META, true);
 
+	blocked_us = us = cp_phase_us(&t);
+	stat_cp_phase(sbi, CP_PHASE_BLOCK, us);
+
 	/*
 	 * update checkpoint pack index
 	 * Increase the version number so that
@@ -819,13 +900,22 @@ void write_checkpoint(struct f2fs_sb_info *sbi, bool is_umount)
 	ckpt->checkpoint_ver = cpu_to_le64(++ckpt_ver);
 
 	/* write cached NAT/SIT entries to NAT/SIT area */
-	flush_nat_entries(sbi);
-	flush_sit_entries(sbi);
+	flush_nat_sit_entries(sbi);
+
+	us = cp_phase_us(&t);
+	blocked_us += us;
+	stat_cp_phase(sbi, CP_PHASE_NAT_SIT, us);
 
 	/* unlock all the fs_lock[] in do_checkpoint() */
 	do_checkpoint(sbi, is_umount);
 
 	unblock_operations(sbi);
+
+	us = cp_phase_us(&t);
+	blocked_us += us;
+	stat_cp_phase(sbi, CP_PHASE_WRITE, us);
+	stat_cp_done(sbi, blocked_us);
+
 	mutex_unlock(&sbi->cp_mutex);
 
 	trace_f2fs_write_checkpoint(sbi->sb, is_umount, "finish checkpoint");
@@ -15,6 +15,7 @@
 #include <linux/backing-dev.h>
 #include <linux/f2fs_fs.h>
 #include <linux/blkdev.h>
+#include <linux/math64.h>
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
 
@@ -27,6 +28,13 @@ static LIST_HEAD(f2fs_stat_list);
 static struct dentry *debugfs_root;
 static DEFINE_MUTEX(f2fs_stat_mutex);
 
+static const char * const cp_phase_names[NR_CP_PHASES] = {
+	[CP_PHASE_PREFLUSH]	= "preflush",
+	[CP_PHASE_BLOCK]	= "block ops",
+	[CP_PHASE_NAT_SIT]	= "NAT/SIT",
+	[CP_PHASE_WRITE]	= "cp write",
+};
+
 static void update_general_status(struct f2fs_sb_info *sbi)
 {
 	struct f2fs_stat_info *si = F2FS_STAT(sbi);
@@ -35,6 +43,7 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	/* valid check of the segment numbers */
 	si->hit_ext = sbi->read_hit_ext;
 	si->total_ext = sbi->total_hit_ext;
+	si->ext_node = atomic_read(&sbi->total_ext_node);
 	si->ndirty_node = get_pages(sbi, F2FS_DIRTY_NODES);
 	si->ndirty_dent = get_pages(sbi, F2FS_DIRTY_DENTS);
 	si->ndirty_dirs = sbi->n_dirty_dirs;
@@ -57,6 +66,22 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->sits = SIT_I(sbi)->dirty_sentries;
 	si->fnids = NM_I(sbi)->fcnt;
 	si->bg_gc = sbi->bg_gc;
+	si->bggc_kicks = sbi->bggc_kicks;
+	si->discard_segs = SM_I(sbi)->nr_discard_segs;
+	si->discard_cmds = SM_I(sbi)->nr_discard_cmds;
+	si->fggc_bailouts = sbi->fggc_bailouts;
+	for (i = 0; i < F2FS_STALL_BUCKETS; i++)
+		si->fggc_stall[i] = sbi->fggc_stall[i];
+	for (i = 0; i < NR_FSYNC_TYPES; i++)
+		si->fsync_count[i] = sbi->fsync_count[i];
+	si->cp_count = sbi->cp_count;
+	si->cp_blocked_max = sbi->cp_blocked_max;
+	for (i = 0; i < NR_CP_PHASES; i++) {
+		si->cp_phase_last[i] = sbi->cp_phase_last[i];
+		si->cp_phase_max[i] = sbi->cp_phase_max[i];
+		si->cp_phase_avg[i] = sbi->cp_count ?
+			div_u64(sbi->cp_phase_total[i], sbi->cp_count) : 0;
+	}
 	si->util_free = (int)(free_user_blocks(sbi) >> sbi->log_blocks_per_seg)
 		* 100 / (int)(sbi->user_block_count >> sbi->log_blocks_per_seg)
 		/ 2;
@@ -138,6 +163,7 @@ static void update_mem_info(struct f2fs_sb_info *sbi)
 	si->base_mem += 2 * SIT_VBLOCK_MAP_SIZE * TOTAL_SEGS(sbi);
 	if (sbi->segs_per_sec > 1)
 		si->base_mem += TOTAL_SECS(sbi) * sizeof(struct sec_entry);
+	si->base_mem += TOTAL_SECS(sbi) * sizeof(struct list_head);
 	si->base_mem += __bitmap_size(sbi, SIT_BITMAP);
 
 	/* build free segmap */
@@ -171,6 +197,8 @@ get_cache:
 	si->cache_mem += npages << PAGE_CACHE_SHIFT;
 	si->cache_mem += sbi->n_orphans * sizeof(struct orphan_inode_entry);
 	si->cache_mem += sbi->n_dirty_dirs * sizeof(struct dir_inode_entry);
+	si->cache_mem += atomic_read(&sbi->total_ext_node) *
+						sizeof(struct extent_node);
 }
 
 static int stat_show(struct seq_file *s, void *v)
@@ -233,15 +261,46 @@ static int stat_show(struct seq_file *s, void *v)
 			   si->dirty_count);
 		seq_printf(s, "  - Prefree: %d\n  - Free: %d (%d)\n\n",
 			   si->prefree_count, si->free_segs, si->free_secs);
+		seq_printf(s, "Discard: %u segs queued, %u cmds issued\n\n",
+			   si->discard_segs, si->discard_cmds);
+		seq_printf(s, "fsync: %u skipped, %u flush only, "
+			   "%u roll-forward\n",
+			   si->fsync_count[FSYNC_SKIP],
+			   si->fsync_count[FSYNC_FLUSH],
+			   si->fsync_count[FSYNC_ROLL_FORWARD]);
+		seq_printf(s, "  - checkpoint: non-regular %u, hardlink %u, "
+			   "wrong pino %u, no roll-forward space %u, "
+			   "parent %u, xattr %u\n\n",
+			   si->fsync_count[FSYNC_CP_NON_REGULAR],
+			   si->fsync_count[FSYNC_CP_HARDLINK],
+			   si->fsync_count[FSYNC_CP_WRONG_PINO],
+			   si->fsync_count[FSYNC_CP_NO_SPC_ROLL],
+			   si->fsync_count[FSYNC_CP_PARENT],
+			   si->fsync_count[FSYNC_CP_XATTR]);
+		seq_printf(s, "Checkpoints: %u, longest block: %u us\n",
+			   si->cp_count, si->cp_blocked_max);
+		seq_puts(s, "  - phase (us)  :  last   avg   max\n");
+		for (j = 0; j < NR_CP_PHASES; j++)
+			seq_printf(s, "  - %-11s : %5u %5u %5u\n",
+				   cp_phase_names[j], si->cp_phase_last[j],
+				   si->cp_phase_avg[j], si->cp_phase_max[j]);
+		seq_putc(s, '\n');
 		seq_printf(s, "GC calls: %d (BG: %d)\n",
 			   si->call_count, si->bg_gc);
 		seq_printf(s, "  - data segments : %d\n", si->data_segs);
 		seq_printf(s, "  - node segments : %d\n", si->node_segs);
+		seq_printf(s, "  - urgent BG wakeups : %u\n", si->bggc_kicks);
+		seq_printf(s, "  - FG budget bailouts : %u\n", si->fggc_bailouts);
+		seq_puts(s, "FG GC stalls (ms):");
+		for (j = 0; j < F2FS_STALL_BUCKETS - 1; j++)
+			seq_printf(s, " <%d: %u", 1 << j, si->fggc_stall[j]);
+		seq_printf(s, " >=%d: %u\n", 1 << j, si->fggc_stall[j]);
 		seq_printf(s, "Try to move %d blocks\n", si->tot_blks);
 		seq_printf(s, "  - data blocks : %d\n", si->data_blks);
 		seq_printf(s, "  - node blocks : %d\n", si->node_blks);
 		seq_printf(s, "\nExtent Hit Ratio: %d / %d\n",
 			   si->hit_ext, si->total_ext);
+		seq_printf(s, "  - cached extents : %d\n", si->ext_node);
 		seq_printf(s, "\nBalancing F2FS Async:\n");
 		seq_printf(s, "  - nodes %4d in %4d\n",
 			   si->ndirty_node, si->node_pages);
@@ -59,7 +59,7 @@ static unsigned char f2fs_type_by_mode[S_IFMT >> S_SHIFT] = {
 	[S_IFLNK >> S_SHIFT]	= F2FS_FT_SYMLINK,
 };
 
-static void set_de_type(struct f2fs_dir_entry *de, struct inode *inode)
+void set_de_type(struct f2fs_dir_entry *de, struct inode *inode)
 {
 	mode_t mode = inode->i_mode;
 	de->file_type = f2fs_type_by_mode[(mode & S_IFMT) >> S_SHIFT];
@@ -94,45 +94,59 @@ static struct f2fs_dir_entry *find_in_block(struct page *dentry_page,
 			bool nocase)
 {
 	struct f2fs_dir_entry *de;
-	unsigned long bit_pos, end_pos, next_pos;
+	struct f2fs_dentry_ptr d;
 	struct f2fs_dentry_block *dentry_blk = kmap(dentry_page);
+
+	make_dentry_ptr(&d, (void *)dentry_blk, false);
+	de = find_target_dentry(name, namelen, namehash, max_slots, &d, nocase);
+	if (de)
+		*res_page = dentry_page;
+	else
+		kunmap(dentry_page);
+	return de;
+}
+
+struct f2fs_dir_entry *find_target_dentry(const char *name, size_t namelen,
+			f2fs_hash_t namehash, int *max_slots,
+			struct f2fs_dentry_ptr *d, bool nocase)
+{
+	struct f2fs_dir_entry *de;
+	unsigned long bit_pos, end_pos, next_pos;
 	int slots;
 
-	bit_pos = find_next_bit_le(&dentry_blk->dentry_bitmap,
-					NR_DENTRY_IN_BLOCK, 0);
-	while (bit_pos < NR_DENTRY_IN_BLOCK) {
-		de = &dentry_blk->dentry[bit_pos];
+	bit_pos = find_next_bit_le(d->bitmap, d->max, 0);
+	while (bit_pos < d->max) {
+		de = &d->dentry[bit_pos];
 		slots = GET_DENTRY_SLOTS(le16_to_cpu(de->name_len));
 
 		if (nocase) {
 			if ((le16_to_cpu(de->name_len) == namelen) &&
-			    !strncasecmp(dentry_blk->filename[bit_pos],
-				name, namelen)) {
-				*res_page = dentry_page;
-				goto found;
-			}
+			    !strncasecmp(d->filename[bit_pos],
+				name, namelen))
+				return de;
 		} else if (early_match_name(name, namelen, namehash, de)) {
-			if (!memcmp(dentry_blk->filename[bit_pos],
-							name, namelen)) {
-				*res_page = dentry_page;
-				goto found;
-			}
+			if (!memcmp(d->filename[bit_pos], name, namelen))
+				return de;
 		}
 		next_pos = bit_pos + slots;
-		bit_pos = find_next_bit_le(&dentry_blk->dentry_bitmap,
-				NR_DENTRY_IN_BLOCK, next_pos);
-		if (bit_pos >= NR_DENTRY_IN_BLOCK)
-			end_pos = NR_DENTRY_IN_BLOCK;
+		bit_pos = find_next_bit_le(d->bitmap, d->max, next_pos);
+		if (bit_pos >= d->max)
+			end_pos = d->max;
 		else
 			end_pos = bit_pos;
 		if (*max_slots < end_pos - next_pos)
 			*max_slots = end_pos - next_pos;
 	}
+	return NULL;
+}
 
-	de = NULL;
-	kunmap(dentry_page);
-found:
-	return de;
+bool f2fs_dir_nocase(struct inode *dir)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(dir->i_sb);
+
+	return test_opt(sbi, ANDROID_EMU) &&
+		(sbi->android_emu_flags & F2FS_ANDROID_EMU_NOCASE) &&
+		(F2FS_I(dir)->i_advise & FADVISE_ANDROID_EMU);
 }
 
 static struct f2fs_dir_entry *find_in_level(struct inode *dir,
@@ -144,7 +158,7 @@ static struct f2fs_dir_entry *find_in_level(struct inode *dir,
 	unsigned int bidx, end_block;
 	struct page *dentry_page;
 	struct f2fs_dir_entry *de = NULL;
-	struct f2fs_sb_info *sbi = F2FS_SB(dir->i_sb);
+	bool nocase = f2fs_dir_nocase(dir);
 	bool room = false;
 	int max_slots = 0;
 
@@ -157,8 +171,6 @@ static struct f2fs_dir_entry *find_in_level(struct inode *dir,
 	end_block = bidx + nblock;
 
 	for (; bidx < end_block; bidx++) {
-		bool nocase = false;
-
 		/* no need to allocate new dentry pages to all the indices */
 		dentry_page = find_data_page(dir, bidx, true);
 		if (IS_ERR(dentry_page)) {
@@ -166,11 +178,6 @@ static struct f2fs_dir_entry *find_in_level(struct inode *dir,
 			continue;
 		}
 
-		if (test_opt(sbi, ANDROID_EMU) &&
-		    (sbi->android_emu_flags & F2FS_ANDROID_EMU_NOCASE) &&
-		    F2FS_I(dir)->i_advise & FADVISE_ANDROID_EMU)
-			nocase = true;
-
 		de = find_in_block(dentry_page, name, namelen,
 					&max_slots, namehash, res_page,
 					nocase);
@@ -210,6 +217,9 @@ struct f2fs_dir_entry *f2fs_find_entry(struct inode *dir,
 	if (namelen > F2FS_NAME_LEN)
 		return NULL;
 
+	if (f2fs_has_inline_dentry(dir))
+		return find_in_inline_dir(dir, child, res_page);
+
 	if (npages == 0)
 		return NULL;
 
@@ -237,6 +247,9 @@ struct f2fs_dir_entry *f2fs_parent_dir(struct inode *dir, struct page **p)
 	struct f2fs_dir_entry *de;
 	struct f2fs_dentry_block *dentry_blk;
 
+	if (f2fs_has_inline_dentry(dir))
+		return f2fs_parent_inline_dir(dir, p);
+
 	page = get_lock_data_page(dir, 0);
 	if (IS_ERR(page))
 		return NULL;
@@ -305,40 +318,50 @@ int update_dent_inode(struct inode *inode, const struct qstr *name)
 	init_dent_inode(name, page);
 	f2fs_put_page(page, 1);
 
+	F2FS_I(inode)->inode_ver = cur_cp_version(F2FS_CKPT(sbi));
 	return 0;
 }
 
-static int make_empty_dir(struct inode *inode,
-		struct inode *parent, struct page *page)
+void do_make_empty_dir(struct inode *inode, struct inode *parent,
+					struct f2fs_dentry_ptr *d)
 {
-	struct page *dentry_page;
-	struct f2fs_dentry_block *dentry_blk;
 	struct f2fs_dir_entry *de;
-	void *kaddr;
-
-	dentry_page = get_new_data_page(inode, page, 0, true);
-	if (IS_ERR(dentry_page))
-		return PTR_ERR(dentry_page);
-
-	kaddr = kmap_atomic(dentry_page);
-	dentry_blk = (struct f2fs_dentry_block *)kaddr;
 
-	de = &dentry_blk->dentry[0];
+	de = &d->dentry[0];
 	de->name_len = cpu_to_le16(1);
 	de->hash_code = 0;
 	de->ino = cpu_to_le32(inode->i_ino);
-	memcpy(dentry_blk->filename[0], ".", 1);
+	memcpy(d->filename[0], ".", 1);
 	set_de_type(de, inode);
 
-	de = &dentry_blk->dentry[1];
+	de = &d->dentry[1];
 	de->hash_code = 0;
 	de->name_len = cpu_to_le16(2);
 	de->ino = cpu_to_le32(parent->i_ino);
-	memcpy(dentry_blk->filename[1], "..", 2);
+	memcpy(d->filename[1], "..", 2);
 	set_de_type(de, inode);
 
-	test_and_set_bit_le(0, &dentry_blk->dentry_bitmap);
-	test_and_set_bit_le(1, &dentry_blk->dentry_bitmap);
+	test_and_set_bit_le(0, d->bitmap);
+	test_and_set_bit_le(1, d->bitmap);
+}
+
+static int make_empty_dir(struct inode *inode,
+		struct inode *parent, struct page *page)
+{
+	struct page *dentry_page;
+	struct f2fs_dentry_ptr d;
+	void *kaddr;
+
+	if (f2fs_has_inline_dentry(inode))
+		return make_empty_inline_dir(inode, parent, page);
+
+	dentry_page = get_new_data_page(inode, page, 0, true);
+	if (IS_ERR(dentry_page))
+		return PTR_ERR(dentry_page);
+
+	kaddr = kmap_atomic(dentry_page);
+	make_dentry_ptr(&d, kaddr, false);
+	do_make_empty_dir(inode, parent, &d);
 	kunmap_atomic(kaddr);
 
 	set_page_dirty(dentry_page);
@@ -346,7 +369,7 @@ static int make_empty_dir(struct inode *inode,
 	return 0;
 }
 
-static struct page *init_inode_metadata(struct inode *inode,
+struct page *init_inode_metadata(struct inode *inode,
 		struct inode *dir, const struct qstr *name)
 {
 	struct page *page;
@@ -399,7 +422,7 @@ error:
 	return ERR_PTR(err);
 }
 
-static void update_parent_metadata(struct inode *dir, struct inode *inode,
+void update_parent_metadata(struct inode *dir, struct inode *inode,
 						unsigned int current_depth)
 {
 	if (is_inode_flag_set(F2FS_I(inode), FI_NEW_INODE)) {
@@ -424,30 +447,44 @@ static void update_parent_metadata(struct inode *dir, struct inode *inode,
 		clear_inode_flag(F2FS_I(inode), FI_INC_LINK);
 }
 
-static int room_for_filename(struct f2fs_dentry_block *dentry_blk, int slots)
+int room_for_filename(const void *bitmap, int slots, int max_slots)
 {
 	int bit_start = 0;
 	int zero_start, zero_end;
 next:
-	zero_start = find_next_zero_bit_le(&dentry_blk->dentry_bitmap,
-						NR_DENTRY_IN_BLOCK,
-						bit_start);
-	if (zero_start >= NR_DENTRY_IN_BLOCK)
-		return NR_DENTRY_IN_BLOCK;
+	zero_start = find_next_zero_bit_le(bitmap, max_slots, bit_start);
+	if (zero_start >= max_slots)
+		return max_slots;
 
-	zero_end = find_next_bit_le(&dentry_blk->dentry_bitmap,
-						NR_DENTRY_IN_BLOCK,
-						zero_start);
+	zero_end = find_next_bit_le(bitmap, max_slots, zero_start);
 	if (zero_end - zero_start >= slots)
 		return zero_start;
 
 	bit_start = zero_end + 1;
 
-	if (zero_end + 1 >= NR_DENTRY_IN_BLOCK)
-		return NR_DENTRY_IN_BLOCK;
+	if (zero_end + 1 >= max_slots)
+		return max_slots;
 	goto next;
 }
 
+void f2fs_update_dentry(struct inode *inode, const struct qstr *name,
+			f2fs_hash_t name_hash, struct f2fs_dentry_ptr *d,
+			unsigned int bit_pos)
+{
+	struct f2fs_dir_entry *de;
+	int slots = GET_DENTRY_SLOTS(name->len);
+	int i;
+
+	de = &d->dentry[bit_pos];
+	de->hash_code = name_hash;
+	de->name_len = cpu_to_le16(name->len);
+	memcpy(d->filename[bit_pos], name->name, name->len);
+	de->ino = cpu_to_le32(inode->i_ino);
+	set_de_type(de, inode);
+	for (i = 0; i < slots; i++)
+		test_and_set_bit_le(bit_pos + i, d->bitmap);
+}
+
 /*
  * Caller should grab and release a mutex by calling mutex_lock_op() and
  * mutex_unlock_op().
@@ -459,15 +496,22 @@ int __f2fs_add_link(struct inode *dir, const struct qstr *name, struct inode *in
 	unsigned int current_depth;
 	unsigned long bidx, block;
 	f2fs_hash_t dentry_hash;
-	struct f2fs_dir_entry *de;
 	unsigned int nbucket, nblock;
 	size_t namelen = name->len;
 	struct page *dentry_page = NULL;
 	struct f2fs_dentry_block *dentry_blk = NULL;
+	struct f2fs_dentry_ptr d;
 	int slots = GET_DENTRY_SLOTS(namelen);
 	struct page *page;
 	int err = 0;
-	int i;
+
+	if (f2fs_has_inline_dentry(dir)) {
+		err = f2fs_add_inline_entry(dir, name, inode);
+		/* -EAGAIN: the dentries were just moved out to block 0 */
+		if (err != -EAGAIN)
+			return err;
+		err = 0;
+	}
 
 	dentry_hash = f2fs_dentry_hash(name->name, name->len);
 	level = 0;
@@ -496,7 +540,8 @@ start:
 			return PTR_ERR(dentry_page);
 
 		dentry_blk = kmap(dentry_page);
-		bit_pos = room_for_filename(dentry_blk, slots);
+		bit_pos = room_for_filename(&dentry_blk->dentry_bitmap,
+						slots, NR_DENTRY_IN_BLOCK);
 		if (bit_pos < NR_DENTRY_IN_BLOCK)
 			goto add_dentry;
 
@@ -515,14 +560,8 @@ add_dentry:
 		err = PTR_ERR(page);
 		goto fail;
 	}
-	de = &dentry_blk->dentry[bit_pos];
-	de->hash_code = dentry_hash;
-	de->name_len = cpu_to_le16(namelen);
-	memcpy(dentry_blk->filename[bit_pos], name->name, name->len);
-	de->ino = cpu_to_le32(inode->i_ino);
-	set_de_type(de, inode);
-	for (i = 0; i < slots; i++)
-		test_and_set_bit_le(bit_pos + i, &dentry_blk->dentry_bitmap);
+	make_dentry_ptr(&d, (void *)dentry_blk, false);
+	f2fs_update_dentry(inode, name, dentry_hash, &d, bit_pos);
 	set_page_dirty(dentry_page);
 
 	/* we don't need to mark_inode_dirty now */
@@ -538,22 +577,53 @@ fail:
 	return err;
 }
 
+void f2fs_drop_nlink(struct inode *dir, struct inode *inode,
+						struct page *page)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(dir->i_sb);
+
+	if (S_ISDIR(inode->i_mode)) {
+		drop_nlink(dir);
+		if (page)
+			update_inode(dir, page);
+		else
+			update_inode_page(dir);
+	} else {
+		mark_inode_dirty(dir);
+	}
+	inode->i_ctime = CURRENT_TIME;
+	drop_nlink(inode);
+	if (S_ISDIR(inode->i_mode)) {
+		drop_nlink(inode);
+		i_size_write(inode, 0);
+	}
+	update_inode_page(inode);
+
+	if (inode->i_nlink == 0)
+		add_orphan_inode(sbi, inode->i_ino);
+	else
+		release_orphan_inode(sbi);
+}
+
 /*
  * It only removes the dentry from the dentry page,corresponding name
  * entry in name page does not need to be touched during deletion.
  */
 void f2fs_delete_entry(struct f2fs_dir_entry *dentry, struct page *page,
-						struct inode *inode)
+					struct inode *dir, struct inode *inode)
 {
 	struct	f2fs_dentry_block *dentry_blk;
 	unsigned int bit_pos;
-	struct address_space *mapping = page->mapping;
-	struct inode *dir = mapping->host;
 	struct f2fs_sb_info *sbi = F2FS_SB(dir->i_sb);
 	int slots = GET_DENTRY_SLOTS(le16_to_cpu(dentry->name_len));
 	void *kaddr = page_address(page);
 	int i;
 
+	if (f2fs_has_inline_dentry(dir)) {
+		f2fs_delete_inline_entry(dentry, page, dir, inode);
+		return;
+	}
+
 	lock_page(page);
 	wait_on_page_writeback(page);
 
@@ -571,27 +641,10 @@ void f2fs_delete_entry(struct f2fs_dir_entry *dentry, struct page *page,
 
 	dir->i_ctime = dir->i_mtime = CURRENT_TIME;
 
-	if (inode && S_ISDIR(inode->i_mode)) {
-		drop_nlink(dir);
-		update_inode_page(dir);
-	} else {
+	if (inode)
+		f2fs_drop_nlink(dir, inode, NULL);
+	else
 		mark_inode_dirty(dir);
-	}
-
-	if (inode) {
-		inode->i_ctime = CURRENT_TIME;
-		drop_nlink(inode);
-		if (S_ISDIR(inode->i_mode)) {
-			drop_nlink(inode);
-			i_size_write(inode, 0);
-		}
-		update_inode_page(inode);
-
-		if (inode->i_nlink == 0)
-			add_orphan_inode(sbi, inode->i_ino);
-		else
-			release_orphan_inode(sbi);
-	}
 
 	if (bit_pos == NR_DENTRY_IN_BLOCK) {
 		truncate_hole(dir, page->index, page->index + 1);
@@ -611,6 +664,9 @@ bool f2fs_empty_dir(struct inode *dir)
 	struct	f2fs_dentry_block *dentry_blk;
 	unsigned long nblock = dir_blocks(dir);
 
+	if (f2fs_has_inline_dentry(dir))
+		return f2fs_empty_inline_dir(dir);
+
 	for (bidx = 0; bidx < nblock; bidx++) {
 		void *kaddr;
 		dentry_page = get_lock_data_page(dir, bidx);
@@ -640,22 +696,56 @@ bool f2fs_empty_dir(struct inode *dir)
 	return true;
 }
 
+/*
+ * Feed the dentries of @d from *bit_pos on to filldir. Directory offsets
+ * are n * NR_DENTRY_IN_BLOCK + bit_pos. Returns 1 when filldir is full and
+ * leaves *bit_pos at the dentry that did not fit.
+ */
+int f2fs_fill_dentries(void *dirent, filldir_t filldir,
+			struct f2fs_dentry_ptr *d, unsigned int n,
+			unsigned int *bit_pos)
+{
+	unsigned char *types = f2fs_filetype_table;
+	unsigned char d_type;
+	struct f2fs_dir_entry *de;
+	int slots;
+
+	while (*bit_pos < d->max) {
+		d_type = DT_UNKNOWN;
+		*bit_pos = find_next_bit_le(d->bitmap, d->max, *bit_pos);
+		if (*bit_pos >= d->max)
+			break;
+
+		de = &d->dentry[*bit_pos];
+		if (de->file_type < F2FS_FT_MAX)
+			d_type = types[de->file_type];
+
+		if (filldir(dirent, d->filename[*bit_pos],
+				le16_to_cpu(de->name_len),
+				(n * NR_DENTRY_IN_BLOCK) + *bit_pos,
+				le32_to_cpu(de->ino), d_type))
+			return 1;
+
+		slots = GET_DENTRY_SLOTS(le16_to_cpu(de->name_len));
+		*bit_pos += slots;
+	}
+	return 0;
+}
+
 static int f2fs_readdir(struct file *file, void *dirent, filldir_t filldir)
 {
 	unsigned long pos = file->f_pos;
 	struct inode *inode = file->f_dentry->d_inode;
 	unsigned long npages = dir_blocks(inode);
-	unsigned char *types = NULL;
-	unsigned int bit_pos = 0, start_bit_pos = 0;
-	int over = 0;
+	unsigned int bit_pos = 0;
 	struct f2fs_dentry_block *dentry_blk = NULL;
-	struct f2fs_dir_entry *de = NULL;
 	struct page *dentry_page = NULL;
+	struct f2fs_dentry_ptr d;
 	unsigned int n = 0;
-	unsigned char d_type = DT_UNKNOWN;
-	int slots;
 
-	types = f2fs_filetype_table;
+	if (f2fs_has_inline_dentry(inode))
+		return f2fs_read_inline_dir(file, dirent, filldir);
+
 	bit_pos = (pos % NR_DENTRY_IN_BLOCK);
 	n = (pos / NR_DENTRY_IN_BLOCK);
 
@@ -664,31 +754,11 @@ static int f2fs_readdir(struct file *file, void *dirent, filldir_t filldir)
 		if (IS_ERR(dentry_page))
 			continue;
 
-		start_bit_pos = bit_pos;
 		dentry_blk = kmap(dentry_page);
-		while (bit_pos < NR_DENTRY_IN_BLOCK) {
-			d_type = DT_UNKNOWN;
-			bit_pos = find_next_bit_le(&dentry_blk->dentry_bitmap,
-							NR_DENTRY_IN_BLOCK,
-							bit_pos);
-			if (bit_pos >= NR_DENTRY_IN_BLOCK)
-				break;
-
-			de = &dentry_blk->dentry[bit_pos];
-			if (types && de->file_type < F2FS_FT_MAX)
-				d_type = types[de->file_type];
-
-			over = filldir(dirent,
-					dentry_blk->filename[bit_pos],
-					le16_to_cpu(de->name_len),
-					(n * NR_DENTRY_IN_BLOCK) + bit_pos,
-					le32_to_cpu(de->ino), d_type);
-			if (over) {
-				file->f_pos += bit_pos - start_bit_pos;
-				goto success;
-			}
-			slots = GET_DENTRY_SLOTS(le16_to_cpu(de->name_len));
-			bit_pos += slots;
+		make_dentry_ptr(&d, (void *)dentry_blk, false);
+		if (f2fs_fill_dentries(dirent, filldir, &d, n, &bit_pos)) {
+			file->f_pos = (n * NR_DENTRY_IN_BLOCK) + bit_pos;
+			goto success;
 		}
 		bit_pos = 0;
 		file->f_pos = (n + 1) * NR_DENTRY_IN_BLOCK;
@@ -0,0 +1,353 @@
+/*
+ * fs/f2fs/extent_cache.c
+ *
+ * Copyright (c) 2012 Samsung Electronics Co., Ltd.
+ *             http://www.samsung.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/fs.h>
+#include <linux/f2fs_fs.h>
+
+#include "f2fs.h"
+#include "node.h"
+
+static struct kmem_cache *extent_node_slab;
+
+/*
+ * Each inode keeps the data block mappings it has seen in an rb-tree of
+ * non-overlapping extents, so that most reads resolve their block address
+ * without walking the node tree.  All the extent nodes of a partition are
+ * also linked in one LRU list, which the shrinker trims from its tail.
+ * Dropping an extent is always safe, since node pages stay the authority.
+ *
+ * fi->ext mirrors the largest extent seen so far.  It is stored in the
+ * inode block as i_ext, and seeds the tree when the inode is read back.
+ *
+ * Lock ordering:
+ *  ->fi->ext_lock
+ *   ->sbi->extent_lock
+ * The shrinker walks the LRU with sbi->extent_lock held, so it only
+ * trylocks the ext_lock of the owner inode.
+ */
+
+static struct extent_node *__insert_extent_node(struct f2fs_sb_info *sbi,
+			struct f2fs_inode_info *fi, struct extent_info *ei)
+{
+	struct rb_node **p = &fi->ext_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct extent_node *en;
+
+	while (*p) {
+		parent = *p;
+		en = rb_entry(parent, struct extent_node, rb_node);
+		if (ei->fofs < en->ei.fofs)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+
+	/* we are under ext_lock, and losing an extent costs a node lookup */
+	en = kmem_cache_alloc(extent_node_slab, GFP_ATOMIC);
+	if (!en)
+		return NULL;
+
+	en->ei = *ei;
+	en->fi = fi;
+	rb_link_node(&en->rb_node, parent, p);
+	rb_insert_color(&en->rb_node, &fi->ext_tree);
+
+	spin_lock(&sbi->extent_lock);
+	list_add(&en->list, &sbi->extent_list);
+	spin_unlock(&sbi->extent_lock);
+	atomic_inc(&sbi->total_ext_node);
+	return en;
+}
+
+/* caller should hold fi->ext_lock for write and sbi->extent_lock */
+static void __detach_extent_node(struct f2fs_sb_info *sbi,
+			struct f2fs_inode_info *fi, struct extent_node *en)
+{
+	rb_erase(&en->rb_node, &fi->ext_tree);
+	list_del(&en->list);
+	atomic_dec(&sbi->total_ext_node);
+	kmem_cache_free(extent_node_slab, en);
+}
+
+static void __release_extent_node(struct f2fs_sb_info *sbi,
+			struct f2fs_inode_info *fi, struct extent_node *en)
+{
+	spin_lock(&sbi->extent_lock);
+	__detach_extent_node(sbi, fi, en);
+	spin_unlock(&sbi->extent_lock);
+}
+
+/*
+ * Return the extent holding fofs, or else the first one after fofs.
+ */
+static struct extent_node *__lookup_extent_node(struct rb_root *root,
+							pgoff_t fofs)
+{
+	struct rb_node *node = root->rb_node;
+	struct extent_node *en, *next = NULL;
+
+	while (node) {
+		en = rb_entry(node, struct extent_node, rb_node);
+		if (fofs < en->ei.fofs) {
+			next = en;
+			node = node->rb_left;
+		} else if (fofs >= en->ei.fofs + en->ei.len) {
+			node = node->rb_right;
+		} else {
+			return en;
+		}
+	}
+	return next;
+}
+
+static bool __try_update_largest(struct f2fs_inode_info *fi,
+						struct extent_info *ei)
+{
+	if (ei->len <= fi->ext.len)
+		return false;
+	fi->ext = *ei;
+	return true;
+}
+
+bool f2fs_lookup_extent_cache(struct inode *inode, pgoff_t pgofs,
+						struct extent_info *ei)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	struct extent_node *en;
+	bool ret = false;
+
+	read_lock(&fi->ext_lock);
+	if (RB_EMPTY_ROOT(&fi->ext_tree) && !fi->ext.len)
+		goto out;
+
+#ifdef CONFIG_F2FS_STAT_FS
+	sbi->total_hit_ext++;
+#endif
+	en = __lookup_extent_node(&fi->ext_tree, pgofs);
+	if (en && pgofs >= en->ei.fofs) {
+		*ei = en->ei;
+		spin_lock(&sbi->extent_lock);
+		list_move(&en->list, &sbi->extent_list);
+		spin_unlock(&sbi->extent_lock);
+		ret = true;
+	} else if (pgofs >= fi->ext.fofs &&
+			pgofs < fi->ext.fofs + fi->ext.len) {
+		/* the largest extent outlives the shrinker */
+		*ei = fi->ext;
+		ret = true;
+	}
+#ifdef CONFIG_F2FS_STAT_FS
+	if (ret)
+		sbi->read_hit_ext++;
+#endif
+out:
+	read_unlock(&fi->ext_lock);
+	return ret;
+}
+
+/*
+ * Map [fofs, fofs + len) to the blocks starting at blkaddr, or forget the
+ * range when blkaddr is NULL_ADDR.  The caller should hold the locked node
+ * page holding these addresses, which orders updates from data writes
+ * against the extents that readers build from the same node page.
+ * fi->ext is only touched when @largest is set, since whoever changes it
+ * must also write it back to i_ext.
+ * Return true if the largest extent kept in the inode has changed.
+ */
+static bool __update_extent_range(struct inode *inode, pgoff_t fofs,
+			block_t blkaddr, unsigned int len, bool largest)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	struct extent_node *en, *prev, *next;
+	struct rb_node *node;
+	struct extent_info ei;
+	pgoff_t end = fofs + len;
+	bool updated = false;
+
+	write_lock(&fi->ext_lock);
+
+	/* the largest extent goes stale once any part of it is remapped */
+	if (largest && fi->ext.len && fofs < fi->ext.fofs + fi->ext.len &&
+						end > fi->ext.fofs) {
+		fi->ext.len = 0;
+		updated = true;
+	}
+
+	/* 1. cut the range out of the cached extents */
+	en = __lookup_extent_node(&fi->ext_tree, fofs);
+	while (en && en->ei.fofs < end) {
+		pgoff_t en_end = en->ei.fofs + en->ei.len;
+
+		node = rb_next(&en->rb_node);
+		next = node ? rb_entry(node, struct extent_node, rb_node) : NULL;
+
+		if (en->ei.fofs < fofs && en_end > end) {
+			/* split in two, the front part stays in place */
+			ei.fofs = end;
+			ei.blk_addr = en->ei.blk_addr + end - en->ei.fofs;
+			ei.len = en_end - end;
+			en->ei.len = fofs - en->ei.fofs;
+			if (__insert_extent_node(sbi, fi, &ei) && largest)
+				updated |= __try_update_largest(fi, &ei);
+		} else if (en->ei.fofs < fofs) {
+			en->ei.len = fofs - en->ei.fofs;
+		} else if (en_end > end) {
+			en->ei.blk_addr += end - en->ei.fofs;
+			en->ei.fofs = end;
+			en->ei.len = en_end - end;
+		} else {
+			__release_extent_node(sbi, fi, en);
+			en = next;
+			continue;
+		}
+		if (largest)
+			updated |= __try_update_largest(fi, &en->ei);
+		en = next;
+	}
+
+	if (blkaddr == NULL_ADDR)
+		goto out;
+
+	/* 2. merge the new mapping into its neighbours, or add an extent */
+	next = __lookup_extent_node(&fi->ext_tree, fofs);
+	node = next ? rb_prev(&next->rb_node) : rb_last(&fi->ext_tree);
+	prev = node ? rb_entry(node, struct extent_node, rb_node) : NULL;
+
+	en = NULL;
+	if (prev && prev->ei.fofs + prev->ei.len == fofs &&
+			prev->ei.blk_addr + prev->ei.len == blkaddr) {
+		prev->ei.len += len;
+		en = prev;
+	}
+	if (next && next->ei.fofs == end &&
+			next->ei.blk_addr == blkaddr + len) {
+		if (en) {
+			en->ei.len += next->ei.len;
+			__release_extent_node(sbi, fi, next);
+		} else {
+			next->ei.fofs = fofs;
+			next->ei.blk_addr = blkaddr;
+			next->ei.len += len;
+			en = next;
+		}
+	}
+
+	if (en) {
+		spin_lock(&sbi->extent_lock);
+		list_move(&en->list, &sbi->extent_list);
+		spin_unlock(&sbi->extent_lock);
+	} else {
+		ei.fofs = fofs;
+		ei.blk_addr = blkaddr;
+		ei.len = len;
+		en = __insert_extent_node(sbi, fi, &ei);
+	}
+	if (en && largest)
+		updated |= __try_update_largest(fi, &en->ei);
+out:
+	write_unlock(&fi->ext_lock);
+	return updated;
+}
+
+bool f2fs_update_extent_range(struct inode *inode, pgoff_t fofs,
+				block_t blkaddr, unsigned int len)
+{
+	return __update_extent_range(inode, fofs, blkaddr, len, true);
+}
+
+/*
+ * Cache a mapping found on a read.  The node page agrees with any valid
+ * fi->ext, so it is left alone and the inode page stays clean.
+ */
+void f2fs_cache_extent_range(struct inode *inode, pgoff_t fofs,
+				block_t blkaddr, unsigned int len)
+{
+	__update_extent_range(inode, fofs, blkaddr, len, false);
+}
+
+void f2fs_init_extent_tree(struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+
+	write_lock(&fi->ext_lock);
+	if (fi->ext.len && RB_EMPTY_ROOT(&fi->ext_tree))
+		__insert_extent_node(sbi, fi, &fi->ext);
+	write_unlock(&fi->ext_lock);
+}
+
+void f2fs_destroy_extent_tree(struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	struct rb_node *node;
+
+	write_lock(&fi->ext_lock);
+	spin_lock(&sbi->extent_lock);
+	while ((node = rb_first(&fi->ext_tree)))
+		__detach_extent_node(sbi, fi,
+			rb_entry(node, struct extent_node, rb_node));
+	spin_unlock(&sbi->extent_lock);
+	write_unlock(&fi->ext_lock);
+}
+
+static int f2fs_shrink_extent_cache(struct shrinker *shrink,
+					struct shrink_control *sc)
+{
+	struct f2fs_sb_info *sbi = container_of(shrink,
+				struct f2fs_sb_info, extent_shrinker);
+	int nr_to_scan = sc->nr_to_scan;
+
+	if (!nr_to_scan)
+		goto out;
+
+	spin_lock(&sbi->extent_lock);
+	while (nr_to_scan-- && !list_empty(&sbi->extent_list)) {
+		struct extent_node *en = list_entry(sbi->extent_list.prev,
+						struct extent_node, list);
+		struct f2fs_inode_info *fi = en->fi;
+
+		if (!write_trylock(&fi->ext_lock)) {
+			/* the owner is busy with it, try it next round */
+			list_move(&en->list, &sbi->extent_list);
+			continue;
+		}
+		__detach_extent_node(sbi, fi, en);
+		write_unlock(&fi->ext_lock);
+	}
+	spin_unlock(&sbi->extent_lock);
+out:
+	return atomic_read(&sbi->total_ext_node);
+}
+
+void init_extent_cache_info(struct f2fs_sb_info *sbi)
+{
+	spin_lock_init(&sbi->extent_lock);
+	INIT_LIST_HEAD(&sbi->extent_list);
+	atomic_set(&sbi->total_ext_node, 0);
+	sbi->extent_shrinker.shrink = f2fs_shrink_extent_cache;
+	sbi->extent_shrinker.seeks = DEFAULT_SEEKS;
+}
+
+int __init create_extent_caches(void)
+{
+	extent_node_slab = f2fs_kmem_cache_create("f2fs_extent_node",
+			sizeof(struct extent_node), NULL);
+	if (unlikely(!extent_node_slab))
+		return -ENOMEM;
+	return 0;
+}
+
+void destroy_extent_caches(void)
+{
+	kmem_cache_destroy(extent_node_slab);
+}
@@ -18,6 +18,8 @@
 #include <linux/crc32.h>
 #include <linux/magic.h>
 #include <linux/kobject.h>
+#include <linux/rbtree.h>
+#include <crypto/hash.h>
 
 /*
  * For mount options
@@ -30,6 +32,8 @@
 #define F2FS_MOUNT_POSIX_ACL		0x00000020
 #define F2FS_MOUNT_DISABLE_EXT_IDENTIFY	0x00000040
 #define F2FS_MOUNT_INLINE_XATTR		0x00000080
+#define F2FS_MOUNT_INLINE_DATA		0x00000100
+#define F2FS_MOUNT_INLINE_DENTRY	0x00000200
 #define F2FS_MOUNT_ANDROID_EMU		0x00001000
 #define F2FS_MOUNT_ERRORS_PANIC		0x00002000
 #define F2FS_MOUNT_ERRORS_RECOVER	0x00004000
@@ -52,27 +56,6 @@ struct f2fs_mount_info {
 	unsigned int	opt;
 };
 
-#define CRCPOLY_LE 0xedb88320
-
-static inline __u32 f2fs_crc32(void *buf, size_t len)
-{
-	unsigned char *p = (unsigned char *)buf;
-	__u32 crc = F2FS_SUPER_MAGIC;
-	int i;
-
-	while (len--) {
-		crc ^= *p++;
-		for (i = 0; i < 8; i++)
-			crc = (crc >> 1) ^ ((crc & 1) ? CRCPOLY_LE : 0);
-	}
-	return crc;
-}
-
-static inline bool f2fs_crc_valid(__u32 blk_crc, void *buf, size_t buf_size)
-{
-	return f2fs_crc32(buf, buf_size) == blk_crc;
-}
-
 /*
  * For checkpoint manager
  */
@@ -159,17 +142,25 @@ enum {
 
 /* for in-memory extent cache entry */
 struct extent_info {
-	rwlock_t ext_lock;	/* rwlock for consistency */
 	unsigned int fofs;	/* start offset in a file */
 	u32 blk_addr;		/* start block address of the extent */
 	unsigned int len;	/* length of the extent */
 };
 
+/* a cached extent in the per-inode extent tree */
+struct extent_node {
+	struct rb_node rb_node;		/* rb node located in fi->ext_tree */
+	struct list_head list;		/* node in sbi->extent_list (LRU) */
+	struct extent_info ei;		/* extent info */
+	struct f2fs_inode_info *fi;	/* owner of this extent */
+};
+
 /*
  * i_advise uses FADVISE_XXX_BIT. We can add additional hints later.
  */
 #define FADVISE_COLD_BIT	0x01
 #define FADVISE_LOST_PINO_BIT	0x02
+#define FADVISE_HOT_BIT		0x04
 #define FADVISE_ANDROID_EMU	0x10
 #define FADVISE_ANDROID_EMU_ROOT 0x20
 
@@ -188,27 +179,30 @@ struct f2fs_inode_info {
 	unsigned int clevel;		/* maximum level of given file name */
 	nid_t i_xattr_nid;		/* node id that contains xattrs */
 	unsigned long long xattr_ver;	/* cp version of xattr modification */
-	struct extent_info ext;		/* in-memory extent cache entry */
+	unsigned long long data_ver;	/* cp version of out-of-place data write */
+	unsigned long long inode_ver;	/* cp version of inode block update */
+	rwlock_t ext_lock;		/* protects ext_tree and ext */
+	struct rb_root ext_tree;	/* cached extents of data blocks */
+	struct extent_info ext;		/* largest extent, kept in the inode */
+	unsigned int i_wtemp;		/* decaying count of data rewrites */
+	unsigned long i_wtemp_stamp;	/* jiffies of the current window */
 };
 
 static inline void get_extent_info(struct extent_info *ext,
 					struct f2fs_extent i_ext)
 {
-	write_lock(&ext->ext_lock);
 	ext->fofs = le32_to_cpu(i_ext.fofs);
 	ext->blk_addr = le32_to_cpu(i_ext.blk_addr);
 	ext->len = le32_to_cpu(i_ext.len);
-	write_unlock(&ext->ext_lock);
 }
 
+/* caller should hold fi->ext_lock */
 static inline void set_raw_extent(struct extent_info *ext,
 					struct f2fs_extent *i_ext)
 {
-	read_lock(&ext->ext_lock);
 	i_ext->fofs = cpu_to_le32(ext->fofs);
 	i_ext->blk_addr = cpu_to_le32(ext->blk_addr);
 	i_ext->len = cpu_to_le32(ext->len);
-	read_unlock(&ext->ext_lock);
 }
 
 struct f2fs_nm_info {
@@ -303,6 +297,27 @@ struct f2fs_sm_info {
 	unsigned int main_segments;	/* # of segments in main area */
 	unsigned int reserved_segments;	/* # of reserved segments */
 	unsigned int ovp_segments;	/* # of overprovision segments */
+
+	/* free space policy, see the tiers in segment.h */
+	unsigned int min_ssr_sections;	/* data logs go SSR below this */
+	unsigned int bggc_urgent_sections; /* margin waking GC thread early */
+	unsigned int fggc_budget_ms;	/* time bound of one foreground GC */
+
+	/* for asynchronous discard of prefree segments */
+	struct task_struct *f2fs_issue_discard;	/* discard thread */
+	wait_queue_head_t discard_wait_queue;	/* wakes the discard thread */
+	wait_queue_head_t discard_cmpl_queue;	/* waiters on issued discard */
+	struct mutex discard_lock;		/* protects the fields below */
+	struct list_head discard_list;		/* queued ranges by segno */
+	unsigned int issuing_segno;		/* range under discard now */
+	unsigned int issuing_len;		/* 0 when nothing is issued */
+	unsigned int nr_discard_segs;		/* # of queued segments */
+	unsigned int nr_discard_cmds;		/* # of issued discards */
+	int discard_wake;			/* new ranges were queued */
+	unsigned int discard_granularity;	/* min. segments per discard */
+
+	/* for hot data separation */
+	unsigned int hot_wtemp_threshold;	/* rewrites making a file hot */
 };
 
 /*
@@ -349,11 +364,49 @@ enum page_type {
 	META_FLUSH,
 };
 
+/*
+ * Histogram of writer stalls in f2fs_balance_fs(): bucket 0 counts stalls
+ * below 1ms, bucket i those of [2^(i-1), 2^i) ms and the last one the rest.
+ */
+#define F2FS_STALL_BUCKETS	12
+
+/*
+ * What f2fs_sync_file() did: nothing, a cache flush, a roll-forward node
+ * chain, or a checkpoint for one of the FSYNC_CP_* reasons.
+ */
+enum {
+	FSYNC_SKIP,		/* nothing changed since the last cp or fsync */
+	FSYNC_FLUSH,		/* only in-place data writes, flush the cache */
+	FSYNC_ROLL_FORWARD,	/* wrote the dnode chain with the fsync mark */
+	FSYNC_CP_NON_REGULAR,	/* directories and special files */
+	FSYNC_CP_HARDLINK,	/* i_nlink != 1 */
+	FSYNC_CP_WRONG_PINO,	/* i_pino does not name the parent */
+	FSYNC_CP_NO_SPC_ROLL,	/* no room for roll-forward blocks */
+	FSYNC_CP_PARENT,	/* parent inode is not checkpointed yet */
+	FSYNC_CP_XATTR,		/* xattr node block changed */
+	NR_FSYNC_TYPES,
+};
+
+/*
+ * Phases of write_checkpoint(), timed for the debugfs status file.  Only
+ * PREFLUSH runs with filesystem operations still allowed.
+ */
+enum {
+	CP_PHASE_PREFLUSH,	/* dentry/node/meta writeback before blocking */
+	CP_PHASE_BLOCK,		/* block_operations() and bio submission */
+	CP_PHASE_NAT_SIT,	/* NAT and SIT journal/area flush */
+	CP_PHASE_WRITE,		/* checkpoint pack write in do_checkpoint() */
+	NR_CP_PHASES,
+};
+
 /*
  * Android sdcard emulation flags
  */
 #define F2FS_ANDROID_EMU_NOCASE		0x00000001
 
+#define F2FS_MAX_HOT_EXT	16	/* # of hot extension entries */
+#define F2FS_HOT_EXT_LEN	16	/* max. length of a hot extension */
+
 struct f2fs_sb_info {
 	struct super_block *sb;			/* pointer to VFS super block */
 	struct proc_dir_entry *s_proc;		/* proc entry */
@@ -375,6 +428,7 @@ struct f2fs_sb_info {
 	struct f2fs_checkpoint *ckpt;		/* raw checkpoint pointer */
 	struct inode *meta_inode;		/* cache meta blocks */
 	struct mutex cp_mutex;			/* checkpoint procedure lock */
+	struct workqueue_struct *cp_wq;		/* SIT flush during checkpoint */
 	struct mutex fs_lock[NR_GLOBAL_LOCKS];	/* blocking FS operations */
 	struct mutex node_write;		/* locking node writes */
 	struct mutex writepages;		/* mutex for writepages() */
@@ -413,11 +467,23 @@ struct f2fs_sb_info {
 	block_t alloc_valid_block_count;	/* # of allocated blocks */
 	block_t last_valid_block_count;		/* for recovery */
 	u32 s_next_generation;			/* for NFS support */
+	struct crypto_shash *s_chksum_driver;	/* checkpoint crc32 */
 	atomic_t nr_pages[NR_COUNT_TYPE];	/* # of pages, see count_type */
 
 	struct f2fs_mount_info mount_opt;	/* mount options */
 
 	/* for cleaning operations */
+	/* for hot data separation by file name, set through sysfs */
+	spinlock_t hot_ext_lock;		/* protects hot_ext_list */
+	int hot_ext_count;			/* # of hot extensions */
+	char hot_ext_list[F2FS_MAX_HOT_EXT][F2FS_HOT_EXT_LEN];
+
+	/* for the extent cache of data block addresses */
+	spinlock_t extent_lock;			/* protects extent_list */
+	struct list_head extent_list;		/* LRU list of extent nodes */
+	atomic_t total_ext_node;		/* # of cached extent nodes */
+	struct shrinker extent_shrinker;	/* reclaims extent nodes */
+
 	struct mutex gc_mutex;			/* mutex for GC */
 	struct f2fs_gc_kthread	*gc_thread;	/* GC thread */
 	unsigned int cur_victim_sec;		/* current victim section num */
@@ -433,6 +499,15 @@ struct f2fs_sb_info {
 	int total_hit_ext, read_hit_ext;	/* extent cache hit ratio */
 	int bg_gc;				/* background gc calls */
 	unsigned int n_dirty_dirs;		/* # of dir inodes */
+	unsigned int bggc_kicks;		/* urgent wakeups of GC thread */
+	unsigned int fggc_bailouts;		/* FG GCs ended by time budget */
+	unsigned int fggc_stall[F2FS_STALL_BUCKETS]; /* f2fs_balance_fs stalls */
+	unsigned int fsync_count[NR_FSYNC_TYPES]; /* f2fs_sync_file outcomes */
+	unsigned int cp_count;			/* # of timed checkpoints */
+	unsigned int cp_phase_last[NR_CP_PHASES]; /* last phase times (us) */
+	unsigned int cp_phase_max[NR_CP_PHASES];  /* worst phase times (us) */
+	u64 cp_phase_total[NR_CP_PHASES];	  /* summed phase times (us) */
+	unsigned int cp_blocked_max;		/* longest writer freeze (us) */
 #endif
 	unsigned int last_victim[2];		/* last victim segment # */
 	spinlock_t stat_lock;			/* lock for stat operations */
@@ -461,6 +536,31 @@ static inline struct f2fs_sb_info *F2FS_SB(struct super_block *sb)
 	return sb->s_fs_info;
 }
 
+/* crc32_le seeded with F2FS_SUPER_MAGIC, see init_chksum_driver() */
+static inline __u32 f2fs_crc32(struct f2fs_sb_info *sbi, void *buf,
+			       size_t len)
+{
+	struct {
+		struct shash_desc shash;
+		char ctx[4];
+	} desc;
+	__le32 crc;
+	int err;
+
+	desc.shash.tfm = sbi->s_chksum_driver;
+	desc.shash.flags = 0;
+
+	err = crypto_shash_digest(&desc.shash, buf, len, (u8 *)&crc);
+	BUG_ON(err);
+	return le32_to_cpu(crc);
+}
+
+static inline bool f2fs_crc_valid(struct f2fs_sb_info *sbi, __u32 blk_crc,
+				  void *buf, size_t buf_size)
+{
+	return f2fs_crc32(sbi, buf, buf_size) == blk_crc;
+}
+
 static inline struct f2fs_super_block *F2FS_RAW_SUPER(struct f2fs_sb_info *sbi)
 {
 	return (struct f2fs_super_block *)(sbi->raw_super);
@@ -937,6 +1037,10 @@ enum {
 	FI_UPDATE_DIR,		/* should update inode block for consistency */
 	FI_DELAY_IPUT,		/* used for the recovery */
 	FI_INLINE_XATTR,	/* used for inline xattr */
+	FI_INLINE_DATA,		/* used for inline data */
+	FI_INLINE_DENTRY,	/* used for inline dentry */
+	FI_DIRTY_DSYNC,		/* dirty inode fields matter to fdatasync */
+	FI_UPDATE_WRITE,	/* in-place data write since the last fsync */
 };
 
 static inline void set_inode_flag(struct f2fs_inode_info *fi, int flag)
@@ -982,6 +1086,10 @@ static inline void get_inline_info(struct f2fs_inode_info *fi,
 {
 	if (ri->i_inline & F2FS_INLINE_XATTR)
 		set_inode_flag(fi, FI_INLINE_XATTR);
+	if (ri->i_inline & F2FS_INLINE_DATA)
+		set_inode_flag(fi, FI_INLINE_DATA);
+	if (ri->i_inline & F2FS_INLINE_DENTRY)
+		set_inode_flag(fi, FI_INLINE_DENTRY);
 }
 
 static inline void set_raw_inline(struct f2fs_inode_info *fi,
@@ -991,6 +1099,10 @@ static inline void set_raw_inline(struct f2fs_inode_info *fi,
 
 	if (is_inode_flag_set(fi, FI_INLINE_XATTR))
 		ri->i_inline |= F2FS_INLINE_XATTR;
+	if (is_inode_flag_set(fi, FI_INLINE_DATA))
+		ri->i_inline |= F2FS_INLINE_DATA;
+	if (is_inode_flag_set(fi, FI_INLINE_DENTRY))
+		ri->i_inline |= F2FS_INLINE_DENTRY;
 }
 
 static inline unsigned int addrs_per_inode(struct f2fs_inode_info *fi)
@@ -1016,6 +1128,52 @@ static inline int inline_xattr_size(struct inode *inode)
 		return 0;
 }
 
+static inline int f2fs_has_inline_data(struct inode *inode)
+{
+	return is_inode_flag_set(F2FS_I(inode), FI_INLINE_DATA);
+}
+
+static inline int f2fs_has_inline_dentry(struct inode *inode)
+{
+	return is_inode_flag_set(F2FS_I(inode), FI_INLINE_DENTRY);
+}
+
+static inline void *inline_data_addr(struct page *page)
+{
+	struct f2fs_inode *ri;
+	ri = (struct f2fs_inode *)page_address(page);
+	return (void *)&(ri->i_addr[1]);
+}
+
+/*
+ * A view of the dentry slots of either a dentry block or an inline
+ * dentry area, so that the lookup/insert/readdir code can serve both.
+ */
+struct f2fs_dentry_ptr {
+	void *bitmap;
+	struct f2fs_dir_entry *dentry;
+	__u8 (*filename)[F2FS_SLOT_LEN];
+	int max;
+};
+
+static inline void make_dentry_ptr(struct f2fs_dentry_ptr *d,
+					void *src, bool is_inline)
+{
+	if (!is_inline) {
+		struct f2fs_dentry_block *t = (struct f2fs_dentry_block *)src;
+		d->max = NR_DENTRY_IN_BLOCK;
+		d->bitmap = &t->dentry_bitmap;
+		d->dentry = t->dentry;
+		d->filename = t->filename;
+	} else {
+		struct f2fs_inline_dentry *t = (struct f2fs_inline_dentry *)src;
+		d->max = NR_INLINE_DENTRY;
+		d->bitmap = &t->dentry_bitmap;
+		d->dentry = t->dentry;
+		d->filename = t->filename;
+	}
+}
+
 static inline int f2fs_readonly(struct super_block *sb)
 {
 	return sb->s_flags & MS_RDONLY;
@@ -1060,9 +1218,25 @@ void f2fs_set_link(struct inode *, struct f2fs_dir_entry *,
 				struct page *, struct inode *);
 int update_dent_inode(struct inode *, const struct qstr *);
 int __f2fs_add_link(struct inode *, const struct qstr *, struct inode *);
-void f2fs_delete_entry(struct f2fs_dir_entry *, struct page *, struct inode *);
+void f2fs_delete_entry(struct f2fs_dir_entry *, struct page *,
+			struct inode *, struct inode *);
 int f2fs_make_empty(struct inode *, struct inode *);
 bool f2fs_empty_dir(struct inode *);
+void set_de_type(struct f2fs_dir_entry *, struct inode *);
+bool f2fs_dir_nocase(struct inode *);
+struct f2fs_dir_entry *find_target_dentry(const char *, size_t, f2fs_hash_t,
+			int *, struct f2fs_dentry_ptr *, bool);
+int room_for_filename(const void *, int, int);
+void f2fs_update_dentry(struct inode *, const struct qstr *, f2fs_hash_t,
+			struct f2fs_dentry_ptr *, unsigned int);
+void do_make_empty_dir(struct inode *, struct inode *,
+			struct f2fs_dentry_ptr *);
+struct page *init_inode_metadata(struct inode *, struct inode *,
+			const struct qstr *);
+void update_parent_metadata(struct inode *, struct inode *, unsigned int);
+void f2fs_drop_nlink(struct inode *, struct inode *, struct page *);
+int f2fs_fill_dentries(void *, filldir_t, struct f2fs_dentry_ptr *,
+			unsigned int, unsigned int *);
 
 static inline int f2fs_add_link(struct dentry *dentry, struct inode *inode)
 {
@@ -1089,6 +1263,7 @@ struct dnode_of_data;
 struct node_info;
 
 int is_checkpointed_node(struct f2fs_sb_info *, nid_t);
+bool need_inode_page_update(struct f2fs_sb_info *, nid_t);
 void get_node_info(struct f2fs_sb_info *, nid_t, struct node_info *);
 int get_dnode_of_data(struct dnode_of_data *, pgoff_t, int);
 int truncate_inode_blocks(struct inode *, pgoff_t);
@@ -1121,6 +1296,7 @@ void destroy_node_manager_caches(void);
 void f2fs_balance_fs(struct f2fs_sb_info *);
 void invalidate_blocks(struct f2fs_sb_info *, block_t);
 void clear_prefree_segments(struct f2fs_sb_info *);
+void f2fs_wait_discard(struct f2fs_sb_info *, unsigned int);
 int npages_for_summary_flush(struct f2fs_sb_info *);
 void allocate_new_segments(struct f2fs_sb_info *);
 struct page *get_sum_page(struct f2fs_sb_info *, unsigned int);
@@ -1178,6 +1354,18 @@ struct page *get_new_data_page(struct inode *, struct page *, pgoff_t, bool);
 int f2fs_readpage(struct f2fs_sb_info *, struct page *, block_t, int);
 int do_write_data_page(struct page *);
 
+/*
+ * extent_cache.c
+ */
+bool f2fs_lookup_extent_cache(struct inode *, pgoff_t, struct extent_info *);
+bool f2fs_update_extent_range(struct inode *, pgoff_t, block_t, unsigned int);
+void f2fs_cache_extent_range(struct inode *, pgoff_t, block_t, unsigned int);
+void f2fs_init_extent_tree(struct inode *);
+void f2fs_destroy_extent_tree(struct inode *);
+void init_extent_cache_info(struct f2fs_sb_info *);
+int __init create_extent_caches(void);
+void destroy_extent_caches(void);
+
 /*
  * gc.c
  */
@@ -1185,10 +1373,31 @@ int start_gc_thread(struct f2fs_sb_info *);
 void stop_gc_thread(struct f2fs_sb_info *);
 block_t start_bidx_of_node(unsigned int, struct f2fs_inode_info *);
 int f2fs_gc(struct f2fs_sb_info *);
+void f2fs_kick_gc_thread(struct f2fs_sb_info *);
 void build_gc_manager(struct f2fs_sb_info *);
 int __init create_gc_caches(void);
 void destroy_gc_caches(void);
 
+/*
+ * inline.c
+ */
+int f2fs_read_inline_data(struct inode *, struct page *);
+int f2fs_convert_inline_data(struct inode *, loff_t);
+int f2fs_write_inline_data(struct inode *, struct page *, unsigned int);
+void truncate_inline_data(struct inode *, u64);
+int recover_inline_data(struct inode *, struct page *);
+struct f2fs_dir_entry *find_in_inline_dir(struct inode *, struct qstr *,
+			struct page **);
+struct f2fs_dir_entry *f2fs_parent_inline_dir(struct inode *,
+			struct page **);
+int make_empty_inline_dir(struct inode *, struct inode *, struct page *);
+int f2fs_add_inline_entry(struct inode *, const struct qstr *,
+			struct inode *);
+void f2fs_delete_inline_entry(struct f2fs_dir_entry *, struct page *,
+			struct inode *, struct inode *);
+bool f2fs_empty_inline_dir(struct inode *);
+int f2fs_read_inline_dir(struct file *, void *, filldir_t);
+
 /*
  * recovery.c
  */
@@ -1205,11 +1414,19 @@ struct f2fs_stat_info {
 	struct mutex stat_lock;
 	int all_area_segs, sit_area_segs, nat_area_segs, ssa_area_segs;
 	int main_area_segs, main_area_sections, main_area_zones;
-	int hit_ext, total_ext;
+	int hit_ext, total_ext, ext_node;
 	int ndirty_node, ndirty_dent, ndirty_dirs, ndirty_meta;
 	int nats, sits, fnids;
 	int total_count, utilization;
 	int bg_gc;
+	unsigned int bggc_kicks, fggc_bailouts;
+	unsigned int discard_segs, discard_cmds;
+	unsigned int fggc_stall[F2FS_STALL_BUCKETS];
+	unsigned int fsync_count[NR_FSYNC_TYPES];
+	unsigned int cp_count, cp_blocked_max;
+	unsigned int cp_phase_last[NR_CP_PHASES];
+	unsigned int cp_phase_max[NR_CP_PHASES];
+	unsigned int cp_phase_avg[NR_CP_PHASES];
 	unsigned int valid_count, valid_node_count, valid_inode_count;
 	unsigned int bimodal, avg_vblocks;
 	int util_free, util_valid, util_invalid;
@@ -1261,6 +1478,26 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 		si->node_blks += (blks);				\
 	} while (0)
 
+#define stat_inc_fggc_stall(sbi, ms)					\
+	((sbi)->fggc_stall[min_t(unsigned int, fls(ms),		\
+					F2FS_STALL_BUCKETS - 1)]++)
+#define stat_inc_bggc_kick(sbi)		((sbi)->bggc_kicks++)
+#define stat_inc_fggc_bailout(sbi)	((sbi)->fggc_bailouts++)
+#define stat_inc_fsync(sbi, type)	((sbi)->fsync_count[type]++)
+#define stat_cp_phase(sbi, phase, us)					\
+	do {								\
+		(sbi)->cp_phase_last[phase] = (us);			\
+		(sbi)->cp_phase_total[phase] += (us);			\
+		if ((us) > (sbi)->cp_phase_max[phase])			\
+			(sbi)->cp_phase_max[phase] = (us);		\
+	} while (0)
+#define stat_cp_done(sbi, blocked_us)					\
+	do {								\
+		(sbi)->cp_count++;					\
+		if ((blocked_us) > (sbi)->cp_blocked_max)		\
+			(sbi)->cp_blocked_max = (blocked_us);		\
+	} while (0)
+
 int f2fs_build_stats(struct f2fs_sb_info *);
 void f2fs_destroy_stats(struct f2fs_sb_info *);
 void __init f2fs_create_root_stats(void);
@@ -1271,6 +1508,12 @@ void f2fs_destroy_root_stats(void);
 #define stat_inc_tot_blk_count(si, blks)
 #define stat_inc_data_blk_count(si, blks)
 #define stat_inc_node_blk_count(sbi, blks)
+#define stat_inc_fggc_stall(sbi, ms)	((void)(ms))
+#define stat_inc_bggc_kick(sbi)
+#define stat_inc_fggc_bailout(sbi)
+#define stat_inc_fsync(sbi, type)
+#define stat_cp_phase(sbi, phase, us)	((void)(us))
+#define stat_cp_done(sbi, blocked_us)	((void)(blocked_us))
 
 static inline int f2fs_build_stats(struct f2fs_sb_info *sbi) { return 0; }
 static inline void f2fs_destroy_stats(struct f2fs_sb_info *sbi) { }
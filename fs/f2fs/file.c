@@ -45,6 +45,11 @@ static int f2fs_vm_page_mkwrite(struct vm_area_struct *vma,
 	 */
 	vfs_check_frozen(inode->i_sb, SB_FREEZE_WRITE);
 
+	/* force to convert with normal data indices */
+	err = f2fs_convert_inline_data(inode, MAX_INLINE_DATA + 1);
+	if (err)
+		goto out;
+
 	/* block allocation */
 	ilock = mutex_lock_op(sbi);
 	set_new_dnode(&dn, inode, NULL, NULL, 0);
@@ -134,11 +139,58 @@ static int get_parent_ino(struct inode *inode, nid_t *pino)
 	return 1;
 }
 
+/*
+ * Whether fsync can be served without a checkpoint, i.e. roll-forward
+ * recovery will find this inode and its dentry from the fsynced node
+ * chain alone. Returns 0 if so, or the FSYNC_CP_* reason if not.
+ */
+static int fsync_cp_reason(struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+
+	if (!S_ISREG(inode->i_mode))
+		return FSYNC_CP_NON_REGULAR;
+	if (inode->i_nlink != 1)
+		return FSYNC_CP_HARDLINK;
+	if (file_wrong_pino(inode))
+		return FSYNC_CP_WRONG_PINO;
+	if (!space_for_roll_forward(sbi))
+		return FSYNC_CP_NO_SPC_ROLL;
+	if (!is_checkpointed_node(sbi, F2FS_I(inode)->i_pino))
+		return FSYNC_CP_PARENT;
+	if (F2FS_I(inode)->xattr_ver == cur_cp_version(F2FS_CKPT(sbi)))
+		return FSYNC_CP_XATTR;
+	return 0;
+}
+
+/*
+ * Nothing reached the disk since the last checkpoint or fsync that only
+ * the fsync mark would make recoverable: no out-of-place data write, no
+ * inode block update and no dirty inode block.
+ */
+static bool fsync_nothing_to_roll(struct inode *inode, int datasync)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	unsigned long long cp_ver = cur_cp_version(F2FS_CKPT(sbi));
+
+	/* fdatasync can leave timestamp-only updates to write_inode */
+	if (is_inode_flag_set(fi, FI_DIRTY_INODE) &&
+			(!datasync || is_inode_flag_set(fi, FI_DIRTY_DSYNC)))
+		update_inode_page(inode);
+
+	if (fi->data_ver == cp_ver || fi->inode_ver == cp_ver)
+		return false;
+	return !need_inode_page_update(sbi, inode->i_ino);
+}
+
 int f2fs_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
 {
 	struct inode *inode = file->f_mapping->host;
 	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
 	int ret = 0;
+	int reason;
 	bool need_cp = false;
 	struct writeback_control wbc = {
 		.sync_mode = WB_SYNC_ALL,
@@ -161,24 +213,30 @@ int f2fs_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
 
 	mutex_lock(&inode->i_mutex);
 
+	if (fsync_nothing_to_roll(inode, datasync)) {
+		if (is_inode_flag_set(fi, FI_UPDATE_WRITE)) {
+			clear_inode_flag(fi, FI_UPDATE_WRITE);
+			stat_inc_fsync(sbi, FSYNC_FLUSH);
+			ret = blkdev_issue_flush(inode->i_sb->s_bdev,
+							GFP_KERNEL, NULL);
+		} else {
+			stat_inc_fsync(sbi, FSYNC_SKIP);
+		}
+		goto out;
+	}
+
 	/*
 	 * Both of fdatasync() and fsync() are able to be recovered from
 	 * sudden-power-off.
 	 */
-	if (!S_ISREG(inode->i_mode) || inode->i_nlink != 1)
-		need_cp = true;
-	else if (file_wrong_pino(inode))
-		need_cp = true;
-	else if (!space_for_roll_forward(sbi))
-		need_cp = true;
-	else if (!is_checkpointed_node(sbi, F2FS_I(inode)->i_pino))
-		need_cp = true;
-	else if (F2FS_I(inode)->xattr_ver == cur_cp_version(F2FS_CKPT(sbi)))
+	reason = fsync_cp_reason(inode);
+	if (reason)
 		need_cp = true;
 
 	if (need_cp) {
 		nid_t pino;
 
+		stat_inc_fsync(sbi, reason);
 		F2FS_I(inode)->xattr_ver = 0;
 
 		/* all the dirty node pages should be flushed for POR */
@@ -193,6 +251,12 @@ int f2fs_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
 				goto out;
 		}
 	} else {
+		stat_inc_fsync(sbi, FSYNC_ROLL_FORWARD);
+
+		/* writes from now on are for the next fsync */
+		fi->data_ver = fi->inode_ver = 0;
+		clear_inode_flag(fi, FI_UPDATE_WRITE);
+
 		/* if there is no written node page, write its inode page */
 		while (!sync_node_pages(sbi, inode->i_ino, &wbc)) {
 			mark_inode_dirty_sync(inode);
@@ -291,6 +355,15 @@ static int truncate_blocks(struct inode *inode, u64 from)
 			((from + blocksize - 1) >> (sbi->log_blocksize));
 
 	ilock = mutex_lock_op(sbi);
+
+	/* there are no data blocks behind i_addr of an inline inode */
+	if (f2fs_has_inline_data(inode) || f2fs_has_inline_dentry(inode)) {
+		if (f2fs_has_inline_data(inode))
+			truncate_inline_data(inode, from);
+		mutex_unlock_op(sbi, ilock);
+		trace_f2fs_truncate_blocks_exit(inode, 0);
+		return 0;
+	}
 	set_new_dnode(&dn, inode, NULL, NULL, 0);
 	err = get_dnode_of_data(&dn, free_from, LOOKUP_NODE);
 	if (err) {
@@ -405,6 +478,10 @@ int f2fs_setattr(struct dentry *dentry, struct iattr *attr)
 
 	if ((attr->ia_valid & ATTR_SIZE) &&
 			attr->ia_size != i_size_read(inode)) {
+		err = f2fs_convert_inline_data(inode, attr->ia_size);
+		if (err)
+			return err;
+
 		truncate_setsize(inode, attr->ia_size);
 		f2fs_truncate(inode);
 		f2fs_balance_fs(F2FS_SB(inode->i_sb));
@@ -603,6 +680,11 @@ static long f2fs_fallocate(struct file *file, int mode,
 	if (mode & ~(FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE))
 		return -EOPNOTSUPP;
 
+	/* both paths work on block addresses */
+	ret = f2fs_convert_inline_data(inode, MAX_INLINE_DATA + 1);
+	if (ret)
+		return ret;
+
 	if (mode & FALLOC_FL_PUNCH_HOLE)
 		ret = punch_hole(inode, offset, len, mode);
 	else
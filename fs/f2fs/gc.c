@@ -32,6 +32,7 @@ static int gc_thread_func(void *data)
 	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
 	wait_queue_head_t *wq = &sbi->gc_thread->gc_wait_queue_head;
 	long wait_ms;
+	bool urgent;
 
 	wait_ms = gc_th->min_sleep_time;
 
@@ -40,11 +41,14 @@ static int gc_thread_func(void *data)
 			continue;
 		else
 			wait_event_interruptible_timeout(*wq,
-						kthread_should_stop(),
-						msecs_to_jiffies(wait_ms));
+					kthread_should_stop() || gc_th->gc_urgent,
+					msecs_to_jiffies(wait_ms));
 		if (kthread_should_stop())
 			break;
 
+		urgent = gc_th->gc_urgent;
+		gc_th->gc_urgent = 0;
+
 		/*
 		 * [GC triggering condition]
 		 * 0. GC is not conducted currently.
@@ -57,11 +61,14 @@ static int gc_thread_func(void *data)
 		 * Because it is possible that some segments can be
 		 * invalidated soon after by user update or deletion.
 		 * So, I'd like to wait some time to collect dirty segments.
+		 *
+		 * A wakeup from f2fs_kick_gc_thread() skips the idle check:
+		 * cleaning now is cheaper than a writer doing it later.
 		 */
 		if (!mutex_trylock(&sbi->gc_mutex))
 			continue;
 
-		if (!is_idle(sbi)) {
+		if (!urgent && !is_idle(sbi)) {
 			wait_ms = increase_sleep_time(gc_th, wait_ms);
 			mutex_unlock(&sbi->gc_mutex);
 			continue;
@@ -102,6 +109,8 @@ int start_gc_thread(struct f2fs_sb_info *sbi)
 	gc_th->no_gc_sleep_time = DEF_GC_THREAD_NOGC_SLEEP_TIME;
 
 	gc_th->gc_idle = 0;
+	gc_th->gc_urgent = 0;
+	gc_th->urgent_stamp = jiffies;
 
 	sbi->gc_thread = gc_th;
 	init_waitqueue_head(&sbi->gc_thread->gc_wait_queue_head);
@@ -127,6 +136,26 @@ void stop_gc_thread(struct f2fs_sb_info *sbi)
 	sbi->gc_thread = NULL;
 }
 
+/*
+ * Called by writers once free sections get close to the foreground GC
+ * threshold, so that background GC gets to run before they stall.
+ */
+void f2fs_kick_gc_thread(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
+
+	if (!gc_th || gc_th->gc_urgent)
+		return;
+	if (time_before(jiffies, gc_th->urgent_stamp +
+				msecs_to_jiffies(GC_URGENT_INTERVAL)))
+		return;
+
+	gc_th->urgent_stamp = jiffies;
+	gc_th->gc_urgent = 1;
+	stat_inc_bggc_kick(sbi);
+	wake_up_interruptible(&gc_th->gc_wait_queue_head);
+}
+
 static int select_gc_type(struct f2fs_gc_kthread *gc_th, int gc_type)
 {
 	int gc_mode = (gc_type == BG_GC) ? GC_CB : GC_GREEDY;
@@ -225,6 +254,45 @@ static unsigned int get_cb_cost(struct f2fs_sb_info *sbi, unsigned int segno)
 	return UINT_MAX - ((100 * (100 - u) * age) / (100 + u));
 }
 
+/*
+ * The head of each cost-benefit bucket is the oldest section of its
+ * utilization class and therefore the best candidate in it, so only the
+ * first eligible section of every bucket needs to be costed. This keeps
+ * victim selection independent of the number of dirty segments.
+ */
+static void get_cb_victim(struct f2fs_sb_info *sbi,
+			struct victim_sel_policy *p, int gc_type)
+{
+	struct sit_info *sit_i = SIT_I(sbi);
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	int bucket;
+
+	for (bucket = 0; bucket < NR_CB_BUCKETS; bucket++) {
+		struct list_head *pos;
+		int nskipped = 0;
+
+		list_for_each(pos, &sit_i->cb_buckets[bucket]) {
+			unsigned int secno = pos - sit_i->cb_entries;
+			unsigned int segno = secno * sbi->segs_per_sec;
+			unsigned int cost;
+
+			if (sec_usage_check(sbi, secno) || (gc_type == BG_GC &&
+				    test_bit(secno, dirty_i->victim_secmap))) {
+				if (++nskipped >= MAX_VICTIM_SEARCH)
+					break;
+				continue;
+			}
+
+			cost = get_cb_cost(sbi, segno);
+			if (p->min_cost > cost) {
+				p->min_segno = segno;
+				p->min_cost = cost;
+			}
+			break;
+		}
+	}
+}
+
 static unsigned int get_gc_cost(struct f2fs_sb_info *sbi, unsigned int segno,
 					struct victim_sel_policy *p)
 {
@@ -268,6 +336,11 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 			goto got_it;
 	}
 
+	if (p.alloc_mode == LFS && p.gc_mode == GC_CB) {
+		get_cb_victim(sbi, &p, gc_type);
+		goto selected;
+	}
+
 	while (1) {
 		unsigned long cost;
 		unsigned int segno;
@@ -305,6 +378,7 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 			break;
 		}
 	}
+selected:
 	if (p.min_segno != NULL_SEGNO) {
 got_it:
 		if (p.alloc_mode == LFS) {
@@ -675,6 +749,26 @@ static void do_garbage_collect(struct f2fs_sb_info *sbi, unsigned int segno,
 	f2fs_put_page(sum_page, 1);
 }
 
+/*
+ * A writer doing foreground GC from f2fs_balance_fs() may stop once its
+ * time budget is spent, provided it freed a section and the checkpoint
+ * fits without using up the reserved sections. The GC thread is then
+ * kicked to carry on in the background.
+ */
+static bool fg_gc_budget_spent(struct f2fs_sb_info *sbi, ktime_t start,
+								int nfree)
+{
+	unsigned int budget = SM_I(sbi)->fggc_budget_ms;
+
+	if (!budget || !nfree)
+		return false;
+	if (sbi->gc_thread && current == sbi->gc_thread->f2fs_gc_task)
+		return false;
+	if (ktime_to_ms(ktime_sub(ktime_get(), start)) < budget)
+		return false;
+	return !has_not_enough_free_secs(sbi, nfree + reserved_sections(sbi));
+}
+
 int f2fs_gc(struct f2fs_sb_info *sbi)
 {
 	struct list_head ilist;
@@ -682,6 +776,7 @@ int f2fs_gc(struct f2fs_sb_info *sbi)
 	int gc_type = BG_GC;
 	int nfree = 0;
 	int ret = -1;
+	ktime_t start = ktime_get();
 
 	INIT_LIST_HEAD(&ilist);
 gc_more:
@@ -706,8 +801,11 @@ gc_more:
 		WARN_ON(get_valid_blocks(sbi, segno, sbi->segs_per_sec));
 	}
 
-	if (has_not_enough_free_secs(sbi, nfree))
-		goto gc_more;
+	if (has_not_enough_free_secs(sbi, nfree)) {
+		if (gc_type != FG_GC || !fg_gc_budget_spent(sbi, start, nfree))
+			goto gc_more;
+		stat_inc_fggc_bailout(sbi);
+	}
 
 	if (gc_type == FG_GC)
 		write_checkpoint(sbi, false);
@@ -715,6 +813,11 @@ stop:
 	mutex_unlock(&sbi->gc_mutex);
 
 	put_gc_inode(&ilist);
+
+	if (gc_type == FG_GC && !ret && has_not_enough_free_secs(sbi, 0) &&
+			!(sbi->gc_thread &&
+				current == sbi->gc_thread->f2fs_gc_task))
+		f2fs_kick_gc_thread(sbi);
 	return ret;
 }
 
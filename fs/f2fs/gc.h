@@ -16,6 +16,7 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define GC_URGENT_INTERVAL		100	/* ms between urgent wakeups */
 #define LIMIT_INVALID_BLOCK	40 /* percentage over total user space */
 #define LIMIT_FREE_BLOCK	40 /* percentage over invalid + free space */
 
@@ -33,6 +34,10 @@ struct f2fs_gc_kthread {
 
 	/* for changing gc mode */
 	unsigned int gc_idle;
+
+	/* set by writers running short of free sections */
+	unsigned int gc_urgent;
+	unsigned long urgent_stamp;	/* jiffies of the last such wakeup */
 };
 
 struct inode_entry {
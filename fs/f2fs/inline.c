@@ -0,0 +1,475 @@
+/*
+ * fs/f2fs/inline.c
+ *
+ * Copyright (c) 2013, Intel Corporation
+ * Authors: Huajun Li <huajun.li@intel.com>
+ *          Haicheng Li <haicheng.li@intel.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/fs.h>
+#include <linux/f2fs_fs.h>
+
+#include "f2fs.h"
+#include "node.h"
+
+/*
+ * Small regular files keep i_size bytes of data in the inode block, right
+ * after i_addr[0], and directories keep a struct f2fs_inline_dentry there.
+ * Both are converted to normal data blocks once they outgrow that area,
+ * and never go back.
+ */
+
+int f2fs_read_inline_data(struct inode *inode, struct page *page)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct page *ipage;
+	void *src_addr, *dst_addr;
+
+	if (page->index) {
+		zero_user_segment(page, 0, PAGE_CACHE_SIZE);
+		goto out;
+	}
+
+	ipage = get_node_page(sbi, inode->i_ino);
+	if (IS_ERR(ipage))
+		return PTR_ERR(ipage);
+
+	zero_user_segment(page, MAX_INLINE_DATA, PAGE_CACHE_SIZE);
+
+	/* Copy the whole inline data block */
+	src_addr = inline_data_addr(ipage);
+	dst_addr = kmap(page);
+	memcpy(dst_addr, src_addr, MAX_INLINE_DATA);
+	kunmap(page);
+	f2fs_put_page(ipage, 1);
+out:
+	SetPageUptodate(page);
+	return 0;
+}
+
+static int __f2fs_convert_inline_data(struct inode *inode, struct page *page)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct dnode_of_data dn;
+	block_t new_blk_addr;
+	void *src_addr, *dst_addr;
+	int err, ilock;
+
+	ilock = mutex_lock_op(sbi);
+	set_new_dnode(&dn, inode, NULL, NULL, 0);
+	err = get_dnode_of_data(&dn, 0, ALLOC_NODE);
+	if (err)
+		goto out;
+
+	/*
+	 * i_addr[0] is not used for inline data,
+	 * so reserving new block will not destroy inline data
+	 */
+	if (dn.data_blkaddr == NULL_ADDR) {
+		err = reserve_new_block(&dn);
+		if (err) {
+			f2fs_put_dnode(&dn);
+			goto out;
+		}
+	}
+
+	/* an uptodate page may hold writes that are newer than the inode */
+	if (!PageUptodate(page)) {
+		zero_user_segment(page, MAX_INLINE_DATA, PAGE_CACHE_SIZE);
+		src_addr = inline_data_addr(dn.inode_page);
+		dst_addr = kmap(page);
+		memcpy(dst_addr, src_addr, MAX_INLINE_DATA);
+		kunmap(page);
+		SetPageUptodate(page);
+	}
+	clear_page_dirty_for_io(page);
+
+	/* write data page to try to make data consistent */
+	set_page_writeback(page);
+	write_data_page(inode, page, &dn, dn.data_blkaddr, &new_blk_addr);
+	update_extent_cache(new_blk_addr, &dn);
+	f2fs_wait_on_page_writeback(page, DATA, true);
+
+	/* clear inline data and flag after data writeback */
+	f2fs_wait_on_page_writeback(dn.inode_page, NODE, false);
+	memset(inline_data_addr(dn.inode_page), 0, MAX_INLINE_DATA);
+	clear_inode_flag(F2FS_I(inode), FI_INLINE_DATA);
+
+	sync_inode_page(&dn);
+	f2fs_put_dnode(&dn);
+out:
+	mutex_unlock_op(sbi, ilock);
+	return err;
+}
+
+/*
+ * Move the inline data of @inode out to a data block if the file is about
+ * to grow to @to_size bytes, which the inode block cannot hold.
+ */
+int f2fs_convert_inline_data(struct inode *inode, loff_t to_size)
+{
+	struct page *page;
+	int err;
+
+	if (!f2fs_has_inline_data(inode))
+		return 0;
+	else if (to_size <= MAX_INLINE_DATA)
+		return 0;
+
+	page = grab_cache_page_write_begin(inode->i_mapping, 0, AOP_FLAG_NOFS);
+	if (!page)
+		return -ENOMEM;
+
+	/* someone else may have converted it while we waited for the page */
+	err = 0;
+	if (f2fs_has_inline_data(inode))
+		err = __f2fs_convert_inline_data(inode, page);
+	f2fs_put_page(page, 1);
+	return err;
+}
+
+/*
+ * Called from writepage with mutex_lock_op() held instead of allocating a
+ * block for page 0.
+ */
+int f2fs_write_inline_data(struct inode *inode,
+				struct page *page, unsigned int size)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct page *ipage;
+	void *src_addr, *dst_addr;
+
+	ipage = get_node_page(sbi, inode->i_ino);
+	if (IS_ERR(ipage))
+		return PTR_ERR(ipage);
+
+	f2fs_wait_on_page_writeback(ipage, NODE, false);
+	dst_addr = inline_data_addr(ipage);
+	memset(dst_addr, 0, MAX_INLINE_DATA);
+	src_addr = kmap(page);
+	memcpy(dst_addr, src_addr, size);
+	kunmap(page);
+
+	set_page_dirty(ipage);
+	f2fs_put_page(ipage, 1);
+
+	F2FS_I(inode)->data_ver = cur_cp_version(F2FS_CKPT(sbi));
+	return 0;
+}
+
+void truncate_inline_data(struct inode *inode, u64 from)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct page *ipage;
+
+	if (from >= MAX_INLINE_DATA)
+		return;
+
+	ipage = get_node_page(sbi, inode->i_ino);
+	if (IS_ERR(ipage))
+		return;
+
+	f2fs_wait_on_page_writeback(ipage, NODE, false);
+	memset(inline_data_addr(ipage) + from, 0, MAX_INLINE_DATA - from);
+	set_page_dirty(ipage);
+	f2fs_put_page(ipage, 1);
+}
+
+/*
+ * Roll-forward of an fsynced node page @npage of an inline inode.
+ * [checkpointed] [fsynced] inline_data flag
+ *       o            o     -> copy the inline data, no data blocks
+ *       o            x     -> drop the inline data, recover data blocks
+ *       x            x     -> recover data blocks
+ * Conversion never goes back to inline, so "x o" does not happen.
+ * Returns 1 if there are no data blocks left to recover.
+ */
+int recover_inline_data(struct inode *inode, struct page *npage)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	struct f2fs_inode *ri = NULL;
+	struct page *ipage;
+
+	if (!f2fs_has_inline_data(inode))
+		return 0;
+
+	if (IS_INODE(npage))
+		ri = &F2FS_NODE(npage)->i;
+
+	ipage = get_node_page(sbi, inode->i_ino);
+	if (IS_ERR(ipage))
+		return PTR_ERR(ipage);
+
+	f2fs_wait_on_page_writeback(ipage, NODE, false);
+	if (ri && (ri->i_inline & F2FS_INLINE_DATA)) {
+		memcpy(inline_data_addr(ipage), inline_data_addr(npage),
+							MAX_INLINE_DATA);
+		update_inode(inode, ipage);
+		f2fs_put_page(ipage, 1);
+		return 1;
+	}
+
+	memset(inline_data_addr(ipage), 0, MAX_INLINE_DATA);
+	clear_inode_flag(F2FS_I(inode), FI_INLINE_DATA);
+	update_inode(inode, ipage);
+	f2fs_put_page(ipage, 1);
+	return 0;
+}
+
+/*
+ * The returned page is the inode page of @dir, mapped and unlocked, so
+ * that callers treat it like any dentry page from f2fs_find_entry().
+ */
+struct f2fs_dir_entry *find_in_inline_dir(struct inode *dir,
+			struct qstr *name, struct page **res_page)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(dir->i_sb);
+	struct f2fs_dir_entry *de;
+	struct f2fs_dentry_ptr d;
+	struct page *ipage;
+	int max_slots = 0;
+
+	if (name->len > F2FS_NAME_LEN)
+		return NULL;
+
+	ipage = get_node_page(sbi, dir->i_ino);
+	if (IS_ERR(ipage))
+		return NULL;
+
+	make_dentry_ptr(&d, inline_data_addr(ipage), true);
+	de = find_target_dentry(name->name, name->len,
+			f2fs_dentry_hash(name->name, name->len),
+			&max_slots, &d, f2fs_dir_nocase(dir));
+	unlock_page(ipage);
+	if (de) {
+		kmap(ipage);
+		*res_page = ipage;
+	} else {
+		*res_page = NULL;
+		f2fs_put_page(ipage, 0);
+	}
+	return de;
+}
+
+struct f2fs_dir_entry *f2fs_parent_inline_dir(struct inode *dir,
+							struct page **p)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(dir->i_sb);
+	struct f2fs_inline_dentry *dentry_blk;
+	struct page *ipage;
+
+	ipage = get_node_page(sbi, dir->i_ino);
+	if (IS_ERR(ipage))
+		return NULL;
+
+	dentry_blk = inline_data_addr(ipage);
+	kmap(ipage);
+	*p = ipage;
+	unlock_page(ipage);
+	return &dentry_blk->dentry[1];
+}
+
+int make_empty_inline_dir(struct inode *inode, struct inode *parent,
+							struct page *ipage)
+{
+	struct f2fs_dentry_ptr d;
+
+	make_dentry_ptr(&d, inline_data_addr(ipage), true);
+	do_make_empty_dir(inode, parent, &d);
+	set_page_dirty(ipage);
+
+	/* update_inode() of the new inode in __f2fs_add_link() stores it */
+	if (i_size_read(inode) < MAX_INLINE_DATA)
+		i_size_write(inode, MAX_INLINE_DATA);
+	return 0;
+}
+
+/*
+ * Move the inline dentries of @dir into a new dentry block 0. Each dentry
+ * keeps its bit position, so readdir offsets stay valid. @ipage is locked.
+ */
+static int f2fs_convert_inline_dir(struct inode *dir, struct page *ipage,
+				struct f2fs_inline_dentry *inline_dentry)
+{
+	struct page *page;
+	struct f2fs_dentry_block *dentry_blk;
+
+	page = get_new_data_page(dir, ipage, 0, true);
+	if (IS_ERR(page))
+		return PTR_ERR(page);
+
+	wait_on_page_writeback(page);
+
+	dentry_blk = kmap_atomic(page);
+	memcpy(dentry_blk->dentry_bitmap, inline_dentry->dentry_bitmap,
+					INLINE_DENTRY_BITMAP_SIZE);
+	memcpy(dentry_blk->dentry, inline_dentry->dentry,
+			sizeof(struct f2fs_dir_entry) * NR_INLINE_DENTRY);
+	memcpy(dentry_blk->filename, inline_dentry->filename,
+					NR_INLINE_DENTRY * F2FS_SLOT_LEN);
+	kunmap_atomic(dentry_blk);
+
+	set_page_dirty(page);
+	f2fs_put_page(page, 1);
+
+	/* block 0 carries the dentries from now on */
+	f2fs_wait_on_page_writeback(ipage, NODE, false);
+	memset(inline_dentry, 0, MAX_INLINE_DATA);
+	clear_inode_flag(F2FS_I(dir), FI_INLINE_DENTRY);
+
+	if (i_size_read(dir) < PAGE_CACHE_SIZE)
+		i_size_write(dir, PAGE_CACHE_SIZE);
+	update_inode(dir, ipage);
+	return 0;
+}
+
+/*
+ * Caller holds mutex_lock_op(). Returns -EAGAIN once the inline dentries
+ * had no room and were converted; the caller then uses the dentry blocks.
+ */
+int f2fs_add_inline_entry(struct inode *dir, const struct qstr *name,
+						struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(dir->i_sb);
+	struct page *ipage, *page;
+	struct f2fs_inline_dentry *dentry_blk;
+	struct f2fs_dentry_ptr d;
+	unsigned int bit_pos;
+	f2fs_hash_t name_hash;
+	int slots = GET_DENTRY_SLOTS(name->len);
+	int err = 0;
+
+	ipage = get_node_page(sbi, dir->i_ino);
+	if (IS_ERR(ipage))
+		return PTR_ERR(ipage);
+
+	dentry_blk = inline_data_addr(ipage);
+	bit_pos = room_for_filename(&dentry_blk->dentry_bitmap,
+					slots, NR_INLINE_DENTRY);
+	if (bit_pos >= NR_INLINE_DENTRY) {
+		err = f2fs_convert_inline_dir(dir, ipage, dentry_blk);
+		if (!err)
+			err = -EAGAIN;
+		goto out;
+	}
+
+	/*
+	 * Setting up acls and security labels reads the xattrs of @dir,
+	 * which may live in this very inode page. i_mutex of @dir keeps
+	 * the free slot ours in the meantime.
+	 */
+	unlock_page(ipage);
+	page = init_inode_metadata(inode, dir, name);
+	lock_page(ipage);
+	if (IS_ERR(page)) {
+		err = PTR_ERR(page);
+		goto fail;
+	}
+
+	f2fs_wait_on_page_writeback(ipage, NODE, false);
+
+	name_hash = f2fs_dentry_hash(name->name, name->len);
+	make_dentry_ptr(&d, (void *)dentry_blk, true);
+	f2fs_update_dentry(inode, name, name_hash, &d, bit_pos);
+	set_page_dirty(ipage);
+
+	/* we don't need to mark_inode_dirty now */
+	F2FS_I(inode)->i_pino = dir->i_ino;
+	update_inode(inode, page);
+	f2fs_put_page(page, 1);
+
+	/* the parent update below locks this inode page again */
+	f2fs_put_page(ipage, 1);
+	update_parent_metadata(dir, inode, F2FS_I(dir)->i_current_depth);
+	clear_inode_flag(F2FS_I(dir), FI_UPDATE_DIR);
+	return 0;
+fail:
+	clear_inode_flag(F2FS_I(dir), FI_UPDATE_DIR);
+out:
+	f2fs_put_page(ipage, 1);
+	return err;
+}
+
+void f2fs_delete_inline_entry(struct f2fs_dir_entry *dentry, struct page *page,
+					struct inode *dir, struct inode *inode)
+{
+	struct f2fs_inline_dentry *inline_dentry;
+	int slots = GET_DENTRY_SLOTS(le16_to_cpu(dentry->name_len));
+	unsigned int bit_pos;
+	int i;
+
+	lock_page(page);
+	f2fs_wait_on_page_writeback(page, NODE, false);
+
+	inline_dentry = inline_data_addr(page);
+	bit_pos = dentry - inline_dentry->dentry;
+	for (i = 0; i < slots; i++)
+		test_and_clear_bit_le(bit_pos + i,
+				&inline_dentry->dentry_bitmap);
+
+	kunmap(page); /* kunmap - pair of f2fs_find_entry */
+	set_page_dirty(page);
+
+	dir->i_ctime = dir->i_mtime = CURRENT_TIME;
+
+	if (inode)
+		f2fs_drop_nlink(dir, inode, page);
+	else
+		mark_inode_dirty(dir);
+
+	f2fs_put_page(page, 1);
+}
+
+bool f2fs_empty_inline_dir(struct inode *dir)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(dir->i_sb);
+	struct page *ipage;
+	unsigned int bit_pos = 2;
+	struct f2fs_inline_dentry *dentry_blk;
+
+	ipage = get_node_page(sbi, dir->i_ino);
+	if (IS_ERR(ipage))
+		return false;
+
+	dentry_blk = inline_data_addr(ipage);
+	bit_pos = find_next_bit_le(&dentry_blk->dentry_bitmap,
+					NR_INLINE_DENTRY,
+					bit_pos);
+
+	f2fs_put_page(ipage, 1);
+
+	if (bit_pos < NR_INLINE_DENTRY)
+		return false;
+
+	return true;
+}
+
+int f2fs_read_inline_dir(struct file *file, void *dirent, filldir_t filldir)
+{
+	struct inode *inode = file->f_dentry->d_inode;
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	unsigned int bit_pos = file->f_pos;
+	struct f2fs_dentry_ptr d;
+	struct page *ipage;
+
+	if (file->f_pos >= NR_INLINE_DENTRY)
+		return 0;
+
+	ipage = get_node_page(sbi, inode->i_ino);
+	if (IS_ERR(ipage))
+		return PTR_ERR(ipage);
+
+	/* filldir may fault on user memory, so do not hold the page lock */
+	unlock_page(ipage);
+
+	make_dentry_ptr(&d, inline_data_addr(ipage), true);
+	if (!f2fs_fill_dentries(dirent, filldir, &d, 0, &bit_pos))
+		bit_pos = NR_INLINE_DENTRY;
+	file->f_pos = bit_pos;
+
+	f2fs_put_page(ipage, 0);
+	return 0;
+}
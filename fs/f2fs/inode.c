@@ -87,6 +87,8 @@ static int do_read_inode(struct inode *inode)
 	get_extent_info(&fi->ext, ri->i_ext);
 	get_inline_info(fi, ri);
 	f2fs_put_page(node_page, 1);
+
+	f2fs_init_extent_tree(inode);
 	return 0;
 }
 
@@ -164,7 +166,9 @@ void update_inode(struct inode *inode, struct page *node_page)
 	ri->i_links = cpu_to_le32(inode->i_nlink);
 	ri->i_size = cpu_to_le64(i_size_read(inode));
 	ri->i_blocks = cpu_to_le64(inode->i_blocks);
+	read_lock(&F2FS_I(inode)->ext_lock);
 	set_raw_extent(&F2FS_I(inode)->ext, &ri->i_ext);
+	read_unlock(&F2FS_I(inode)->ext_lock);
 	set_raw_inline(F2FS_I(inode), ri);
 
 	ri->i_atime = cpu_to_le64(inode->i_atime.tv_sec);
@@ -195,6 +199,11 @@ void update_inode(struct inode *inode, struct page *node_page)
 	set_cold_node(inode, node_page);
 	set_page_dirty(node_page);
 	clear_inode_flag(F2FS_I(inode), FI_DIRTY_INODE);
+	clear_inode_flag(F2FS_I(inode), FI_DIRTY_DSYNC);
+
+	/* fsync has to roll this update forward */
+	F2FS_I(inode)->inode_ver =
+			cur_cp_version(F2FS_CKPT(F2FS_SB(inode->i_sb)));
 }
 
 int update_inode_page(struct inode *inode)
@@ -269,5 +278,6 @@ void f2fs_evict_inode(struct inode *inode)
 	mutex_unlock_op(sbi, ilock);
 
 no_delete:
+	f2fs_destroy_extent_tree(inode);
 	end_writeback(inode);
 }
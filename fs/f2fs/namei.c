@@ -62,6 +62,11 @@ static struct inode *f2fs_new_inode(struct inode *dir, umode_t mode)
 	inode->i_mtime = inode->i_atime = inode->i_ctime = CURRENT_TIME;
 	inode->i_generation = sbi->s_next_generation++;
 
+	if (test_opt(sbi, INLINE_DATA) && S_ISREG(inode->i_mode))
+		set_inode_flag(F2FS_I(inode), FI_INLINE_DATA);
+	if (test_opt(sbi, INLINE_DENTRY) && S_ISDIR(inode->i_mode))
+		set_inode_flag(F2FS_I(inode), FI_INLINE_DENTRY);
+
 	err = insert_inode_locked(inode);
 	if (err) {
 		err = -EINVAL;
@@ -113,6 +118,27 @@ static inline void set_cold_files(struct f2fs_sb_info *sbi, struct inode *inode,
 	}
 }
 
+/*
+ * Set database and journal files as hot files, see hot_extensions in sysfs
+ */
+static inline void set_hot_files(struct f2fs_sb_info *sbi, struct inode *inode,
+		const unsigned char *name)
+{
+	int i;
+
+	if (file_is_cold(inode))
+		return;
+
+	spin_lock(&sbi->hot_ext_lock);
+	for (i = 0; i < sbi->hot_ext_count; i++) {
+		if (is_multimedia_file(name, sbi->hot_ext_list[i])) {
+			file_set_hot(inode);
+			break;
+		}
+	}
+	spin_unlock(&sbi->hot_ext_lock);
+}
+
 static int f2fs_create(struct inode *dir, struct dentry *dentry, int mode,
 						struct nameidata *nd)
 {
@@ -128,8 +154,10 @@ static int f2fs_create(struct inode *dir, struct dentry *dentry, int mode,
 	if (IS_ERR(inode))
 		return PTR_ERR(inode);
 
-	if (!test_opt(sbi, DISABLE_EXT_IDENTIFY))
+	if (!test_opt(sbi, DISABLE_EXT_IDENTIFY)) {
 		set_cold_files(sbi, inode, dentry->d_name.name);
+		set_hot_files(sbi, inode, dentry->d_name.name);
+	}
 
 	inode->i_op = &f2fs_file_inode_operations;
 	inode->i_fop = &f2fs_file_operations;
@@ -248,7 +276,7 @@ static int f2fs_unlink(struct inode *dir, struct dentry *dentry)
 	}
 
 	ilock = mutex_lock_op(sbi);
-	f2fs_delete_entry(de, page, inode);
+	f2fs_delete_entry(de, page, dir, inode);
 	mutex_unlock_op(sbi, ilock);
 
 	/* In order to evict this inode,  we set it dirty */
@@ -402,6 +430,7 @@ static int f2fs_rename(struct inode *old_dir, struct dentry *old_dentry,
 	struct f2fs_dir_entry *old_dir_entry = NULL;
 	struct f2fs_dir_entry *old_entry;
 	struct f2fs_dir_entry *new_entry;
+	bool old_page_is_inline;
 	int err = -ENOENT, ilock = -1;
 
 	f2fs_balance_fs(sbi);
@@ -409,6 +438,7 @@ static int f2fs_rename(struct inode *old_dir, struct dentry *old_dentry,
 	old_entry = f2fs_find_entry(old_dir, &old_dentry->d_name, &old_page);
 	if (!old_entry)
 		goto out;
+	old_page_is_inline = f2fs_has_inline_dentry(old_dir);
 
 	if (S_ISDIR(old_inode->i_mode)) {
 		err = -EIO;
@@ -465,6 +495,17 @@ static int f2fs_rename(struct inode *old_dir, struct dentry *old_dentry,
 		if (err)
 			goto out_dir;
 
+		/* adding the link may have moved old_entry out of the inode */
+		if (old_dir == new_dir && old_page_is_inline &&
+				!f2fs_has_inline_dentry(old_dir)) {
+			kunmap(old_page);
+			f2fs_put_page(old_page, 0);
+			old_entry = f2fs_find_entry(old_dir,
+					&old_dentry->d_name, &old_page);
+			/* i_mutex of old_dir keeps it there */
+			BUG_ON(!old_entry);
+		}
+
 		if (old_dir_entry) {
 			inc_nlink(new_dir);
 			update_inode_page(new_dir);
@@ -474,7 +515,7 @@ static int f2fs_rename(struct inode *old_dir, struct dentry *old_dentry,
 	old_inode->i_ctime = CURRENT_TIME;
 	mark_inode_dirty(old_inode);
 
-	f2fs_delete_entry(old_entry, old_page, NULL);
+	f2fs_delete_entry(old_entry, old_page, old_dir, NULL);
 
 	if (old_dir_entry) {
 		if (old_dir != new_dir) {
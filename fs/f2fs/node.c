@@ -149,6 +149,22 @@ int is_checkpointed_node(struct f2fs_sb_info *sbi, nid_t nid)
 	return is_cp;
 }
 
+/*
+ * The inode block is dirty in the node cache, so fsync has something to
+ * write even if no data page was written.
+ */
+bool need_inode_page_update(struct f2fs_sb_info *sbi, nid_t ino)
+{
+	struct page *page;
+	bool ret = false;
+
+	page = find_get_page(sbi->node_inode->i_mapping, ino);
+	if (page && PageDirty(page))
+		ret = true;
+	f2fs_put_page(page, 0);
+	return ret;
+}
+
 static struct nat_entry *grab_nat_entry(struct f2fs_nm_info *nm_i, nid_t nid)
 {
 	struct nat_entry *new;
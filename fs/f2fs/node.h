@@ -288,8 +288,10 @@ static inline void clear_file(struct inode *inode, int type)
 }
 
 #define file_is_cold(inode)	is_file(inode, FADVISE_COLD_BIT)
+#define file_is_hot(inode)	is_file(inode, FADVISE_HOT_BIT)
 #define file_wrong_pino(inode)	is_file(inode, FADVISE_LOST_PINO_BIT)
 #define file_set_cold(inode)	set_file(inode, FADVISE_COLD_BIT)
+#define file_set_hot(inode)	set_file(inode, FADVISE_HOT_BIT)
 #define file_lost_pino(inode)	set_file(inode, FADVISE_LOST_PINO_BIT)
 #define file_clear_cold(inode)	clear_file(inode, FADVISE_COLD_BIT)
 #define file_got_pino(inode)	clear_file(inode, FADVISE_LOST_PINO_BIT)
@@ -82,7 +82,7 @@ retry:
 			iput(einode);
 			goto out_unmap_put;
 		}
-		f2fs_delete_entry(de, page, einode);
+		f2fs_delete_entry(de, page, dir, einode);
 		iput(einode);
 		goto retry;
 	}
@@ -316,6 +316,15 @@ static int do_recover_data(struct f2fs_sb_info *sbi, struct inode *inode,
 	int err = 0, recovered = 0;
 	int ilock;
 
+	/* inline data lives in the inode page, there are no blocks to copy */
+	err = recover_inline_data(inode, page);
+	if (err < 0)
+		return err;
+	if (err) {
+		err = 0;
+		goto out;
+	}
+
 	start = start_bidx_of_node(ofs_of_node(page), fi);
 	if (IS_INODE(page))
 		end = start + ADDRS_PER_INODE(fi);
@@ -385,7 +394,7 @@ static int do_recover_data(struct f2fs_sb_info *sbi, struct inode *inode,
 err:
 	f2fs_put_dnode(&dn);
 	mutex_unlock_op(sbi, ilock);
-
+out:
 	f2fs_msg(sbi->sb, KERN_DEBUG, "recover_data: ino = %lx, "
 			"recovered_data = %d blocks, err = %d",
 			inode->i_ino, recovered, err);
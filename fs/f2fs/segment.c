@@ -13,11 +13,17 @@
 #include <linux/bio.h>
 #include <linux/blkdev.h>
 #include <linux/prefetch.h>
+#include <linux/ktime.h>
 #include <linux/vmalloc.h>
+#include <linux/sort.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/task_io_accounting_ops.h>
 
 #include "f2fs.h"
 #include "segment.h"
 #include "node.h"
+#include "gc.h"
 #include <trace/events/f2fs.h>
 
 /*
@@ -31,8 +37,20 @@ void f2fs_balance_fs(struct f2fs_sb_info *sbi)
 	 * dir/node pages without enough free segments.
 	 */
 	if (has_not_enough_free_secs(sbi, 0)) {
+		ktime_t start = ktime_get();
+		s64 stall_ns;
+
 		mutex_lock(&sbi->gc_mutex);
 		f2fs_gc(sbi);
+
+		/* charged to the writer that had to wait for the space */
+		stall_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		task_io_account_fs_gc(stall_ns);
+		stat_inc_fggc_stall(sbi, (unsigned int)div_u64(stall_ns,
+				NSEC_PER_MSEC));
+	} else if (need_urgent_bg_gc(sbi)) {
+		/* let the GC thread make room before writers have to */
+		f2fs_kick_gc_thread(sbi);
 	}
 }
 
@@ -139,34 +157,258 @@ static void set_prefree_as_free_segments(struct f2fs_sb_info *sbi)
 	mutex_unlock(&dirty_i->seglist_lock);
 }
 
+static void f2fs_issue_discard(struct f2fs_sb_info *sbi,
+				unsigned int segno, unsigned int len)
+{
+	blkdev_issue_discard(sbi->sb->s_bdev,
+			START_BLOCK(sbi, segno) << sbi->log_sectors_per_block,
+			(sector_t)len << (sbi->log_sectors_per_block +
+						sbi->log_blocks_per_seg),
+			GFP_NOFS, 0);
+}
+
+/*
+ * Queue [segno, segno + len) for the discard thread, merging it with the
+ * adjacent queued ranges. Without the thread or memory, trim it right away.
+ */
+static void queue_discard(struct f2fs_sb_info *sbi,
+				unsigned int segno, unsigned int len)
+{
+	struct f2fs_sm_info *sm_i = SM_I(sbi);
+	struct discard_cmd *dc, *prev = NULL, *next = NULL;
+
+	if (!sm_i->f2fs_issue_discard)
+		goto issue;
+
+	mutex_lock(&sm_i->discard_lock);
+	list_for_each_entry(dc, &sm_i->discard_list, list) {
+		if (dc->segno > segno) {
+			next = dc;
+			break;
+		}
+		prev = dc;
+	}
+
+	if (prev && prev->segno + prev->len == segno) {
+		prev->len += len;
+		if (next && segno + len == next->segno) {
+			prev->len += next->len;
+			list_del(&next->list);
+			kfree(next);
+		}
+	} else if (next && segno + len == next->segno) {
+		next->segno = segno;
+		next->len += len;
+	} else {
+		dc = kmalloc(sizeof(struct discard_cmd), GFP_NOFS);
+		if (!dc) {
+			mutex_unlock(&sm_i->discard_lock);
+			goto issue;
+		}
+		dc->segno = segno;
+		dc->len = len;
+		list_add(&dc->list, prev ? &prev->list : &sm_i->discard_list);
+	}
+	sm_i->nr_discard_segs += len;
+	sm_i->discard_wake = 1;
+	mutex_unlock(&sm_i->discard_lock);
+
+	wake_up_interruptible(&sm_i->discard_wait_queue);
+	return;
+issue:
+	f2fs_issue_discard(sbi, segno, len);
+}
+
 void clear_prefree_segments(struct f2fs_sb_info *sbi)
 {
 	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
 	unsigned int segno = -1;
 	unsigned int total_segs = TOTAL_SEGS(sbi);
+	unsigned int start = NULL_SEGNO, len = 0;
 
 	mutex_lock(&dirty_i->seglist_lock);
 	while (1) {
 		segno = find_next_bit(dirty_i->dirty_segmap[PRE], total_segs,
 				segno + 1);
+
+		/* Let's use trim, on every run of prefree segments */
+		if (len && segno != start + len) {
+			queue_discard(sbi, start, len);
+			len = 0;
+		}
 		if (segno >= total_segs)
 			break;
 
 		if (test_and_clear_bit(segno, dirty_i->dirty_segmap[PRE]))
 			dirty_i->nr_dirty[PRE]--;
 
-		/* Let's use trim */
-		if (test_opt(sbi, DISCARD))
-			blkdev_issue_discard(sbi->sb->s_bdev,
-					START_BLOCK(sbi, segno) <<
-					sbi->log_sectors_per_block,
-					1 << (sbi->log_sectors_per_block +
-						sbi->log_blocks_per_seg),
-					GFP_NOFS, 0);
+		if (test_opt(sbi, DISCARD)) {
+			if (!len)
+				start = segno;
+			len++;
+		}
 	}
 	mutex_unlock(&dirty_i->seglist_lock);
 }
 
+static bool __discard_issuing(struct f2fs_sm_info *sm_i, unsigned int segno)
+{
+	return sm_i->issuing_len && segno >= sm_i->issuing_segno &&
+			segno < sm_i->issuing_segno + sm_i->issuing_len;
+}
+
+/*
+ * A free segment is about to be written: drop it from the queued ranges,
+ * and wait if the discard thread is trimming it right now.
+ */
+void f2fs_wait_discard(struct f2fs_sb_info *sbi, unsigned int segno)
+{
+	struct f2fs_sm_info *sm_i = SM_I(sbi);
+	struct discard_cmd *dc, *tail;
+
+	mutex_lock(&sm_i->discard_lock);
+	list_for_each_entry(dc, &sm_i->discard_list, list) {
+		if (dc->segno > segno)
+			break;
+		if (segno >= dc->segno + dc->len)
+			continue;
+
+		sm_i->nr_discard_segs--;
+		if (dc->len == 1) {
+			list_del(&dc->list);
+			kfree(dc);
+		} else if (segno == dc->segno) {
+			dc->segno++;
+			dc->len--;
+		} else if (segno == dc->segno + dc->len - 1) {
+			dc->len--;
+		} else {
+			/* on failure, the tail is simply not discarded */
+			tail = kmalloc(sizeof(struct discard_cmd), GFP_NOFS);
+			if (tail) {
+				tail->segno = segno + 1;
+				tail->len = dc->segno + dc->len - tail->segno;
+				list_add(&tail->list, &dc->list);
+			} else {
+				sm_i->nr_discard_segs -=
+					dc->segno + dc->len - segno - 1;
+			}
+			dc->len = segno - dc->segno;
+		}
+		break;
+	}
+
+	while (__discard_issuing(sm_i, segno)) {
+		mutex_unlock(&sm_i->discard_lock);
+		wait_event(sm_i->discard_cmpl_queue,
+				!__discard_issuing(sm_i, segno));
+		mutex_lock(&sm_i->discard_lock);
+	}
+	mutex_unlock(&sm_i->discard_lock);
+}
+
+/* Trim the first queued range of discard_granularity segments or more */
+static bool issue_discard_cmd(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_sm_info *sm_i = SM_I(sbi);
+	struct discard_cmd *dc;
+	bool issued = false;
+
+	mutex_lock(&sm_i->discard_lock);
+	list_for_each_entry(dc, &sm_i->discard_list, list) {
+		if (dc->len < sm_i->discard_granularity)
+			continue;
+
+		list_del(&dc->list);
+		sm_i->nr_discard_segs -= dc->len;
+		sm_i->issuing_segno = dc->segno;
+		sm_i->issuing_len = dc->len;
+		mutex_unlock(&sm_i->discard_lock);
+
+		f2fs_issue_discard(sbi, dc->segno, dc->len);
+		kfree(dc);
+
+		mutex_lock(&sm_i->discard_lock);
+		sm_i->issuing_len = 0;
+		sm_i->nr_discard_cmds++;
+		issued = true;
+		break;
+	}
+	mutex_unlock(&sm_i->discard_lock);
+
+	if (issued)
+		wake_up(&sm_i->discard_cmpl_queue);
+	return issued;
+}
+
+static int issue_discard_thread(void *data)
+{
+	struct f2fs_sb_info *sbi = data;
+	struct f2fs_sm_info *sm_i = SM_I(sbi);
+	long wait = MAX_SCHEDULE_TIMEOUT;
+
+	do {
+		if (try_to_freeze())
+			continue;
+		else
+			wait_event_interruptible_timeout(
+					sm_i->discard_wait_queue,
+					kthread_should_stop() ||
+					sm_i->discard_wake, wait);
+		if (kthread_should_stop())
+			break;
+
+		sm_i->discard_wake = 0;
+
+		/* leave the device to the foreground while it is busy */
+		if (!is_idle(sbi)) {
+			wait = msecs_to_jiffies(DISCARD_BUSY_WAIT_MS);
+			continue;
+		}
+
+		if (issue_discard_cmd(sbi))
+			wait = 0;
+		else
+			wait = MAX_SCHEDULE_TIMEOUT;
+	} while (!kthread_should_stop());
+	return 0;
+}
+
+static int start_discard_thread(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_sm_info *sm_i = SM_I(sbi);
+	dev_t dev = sbi->sb->s_bdev->bd_dev;
+	struct task_struct *task;
+
+	task = kthread_run(issue_discard_thread, sbi,
+			"f2fs_discard-%u:%u", MAJOR(dev), MINOR(dev));
+	if (IS_ERR(task))
+		return PTR_ERR(task);
+	sm_i->f2fs_issue_discard = task;
+	return 0;
+}
+
+/*
+ * Queued ranges are only an optimization, so the ones left at umount are
+ * dropped rather than delaying it.
+ */
+static void stop_discard_thread(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_sm_info *sm_i = SM_I(sbi);
+	struct discard_cmd *dc, *tmp;
+
+	if (sm_i->f2fs_issue_discard) {
+		kthread_stop(sm_i->f2fs_issue_discard);
+		sm_i->f2fs_issue_discard = NULL;
+	}
+
+	list_for_each_entry_safe(dc, tmp, &sm_i->discard_list, list) {
+		list_del(&dc->list);
+		kfree(dc);
+	}
+	sm_i->nr_discard_segs = 0;
+}
+
 static void __mark_sit_entry_dirty(struct f2fs_sb_info *sbi, unsigned int segno)
 {
 	struct sit_info *sit_i = SIT_I(sbi);
@@ -183,6 +425,24 @@ static void __set_sit_entry_type(struct f2fs_sb_info *sbi, int type,
 		__mark_sit_entry_dirty(sbi, segno);
 }
 
+/*
+ * update_sit_entry() stamps the segment with the current time, so moving
+ * its section to the tail of the bucket for its new valid block count
+ * keeps every bucket sorted by age. Called with sentry_lock held.
+ */
+static void __update_cb_entry(struct f2fs_sb_info *sbi, unsigned int segno)
+{
+	struct sit_info *sit_i = SIT_I(sbi);
+	struct list_head *entry = &sit_i->cb_entries[GET_SECNO(sbi, segno)];
+	int bucket;
+
+	bucket = cb_bucket(sbi, get_valid_blocks(sbi, segno, sbi->segs_per_sec));
+	if (bucket < 0)
+		list_del_init(entry);
+	else
+		list_move_tail(entry, &sit_i->cb_buckets[bucket]);
+}
+
 static void update_sit_entry(struct f2fs_sb_info *sbi, block_t blkaddr, int del)
 {
 	struct seg_entry *se;
@@ -248,6 +508,8 @@ static void update_sit_entry(struct f2fs_sb_info *sbi, block_t blkaddr, int del)
 
 	if (sbi->segs_per_sec > 1)
 		get_sec_entry(sbi, segno)->valid_blocks += del;
+
+	__update_cb_entry(sbi, segno);
 }
 
 static void refresh_sit_entry(struct f2fs_sb_info *sbi,
@@ -483,6 +745,7 @@ static void new_curseg(struct f2fs_sb_info *sbi, int type, bool new_sec)
 		dir = ALLOC_RIGHT;
 
 	get_new_segment(sbi, &segno, new_sec, dir);
+	f2fs_wait_discard(sbi, segno);
 	curseg->next_segno = segno;
 	reset_curseg(sbi, type, 1);
 	curseg->alloc_type = LFS;
@@ -580,7 +843,8 @@ static void allocate_segment_by_default(struct f2fs_sb_info *sbi,
 		new_curseg(sbi, type, false);
 	else if (curseg->alloc_type == LFS && is_next_segment_free(sbi, type))
 		new_curseg(sbi, type, false);
-	else if (need_SSR(sbi) && get_ssr_segment(sbi, type))
+	else if ((need_SSR(sbi) || (IS_DATASEG(type) && need_data_SSR(sbi)))
+					&& get_ssr_segment(sbi, type))
 		change_curseg(sbi, type, true);
 	else
 		new_curseg(sbi, type, false);
@@ -765,6 +1029,9 @@ static int __get_segment_type_4(struct page *page, enum page_type p_type)
 
 		if (S_ISDIR(inode->i_mode))
 			return CURSEG_HOT_DATA;
+		else if (!is_cold_data(page) && !file_is_cold(inode) &&
+				is_hot_file(F2FS_SB(inode->i_sb), inode))
+			return CURSEG_HOT_DATA;
 		else
 			return CURSEG_COLD_DATA;
 	} else {
@@ -784,6 +1051,8 @@ static int __get_segment_type_6(struct page *page, enum page_type p_type)
 			return CURSEG_HOT_DATA;
 		else if (is_cold_data(page) || file_is_cold(inode))
 			return CURSEG_COLD_DATA;
+		else if (is_hot_file(F2FS_SB(inode->i_sb), inode))
+			return CURSEG_HOT_DATA;
 		else
 			return CURSEG_WARM_DATA;
 	} else {
@@ -1423,6 +1692,14 @@ static int build_sit_info(struct f2fs_sb_info *sbi)
 			return -ENOMEM;
 	}
 
+	sit_i->cb_entries = vmalloc(TOTAL_SECS(sbi) * sizeof(struct list_head));
+	if (!sit_i->cb_entries)
+		return -ENOMEM;
+	for (start = 0; start < TOTAL_SECS(sbi); start++)
+		INIT_LIST_HEAD(&sit_i->cb_entries[start]);
+	for (start = 0; start < NR_CB_BUCKETS; start++)
+		INIT_LIST_HEAD(&sit_i->cb_buckets[start]);
+
 	/* get information related with SIT */
 	sit_segs = le32_to_cpu(raw_super->segment_count_sit) >> 1;
 
@@ -1621,6 +1898,53 @@ static int build_dirty_segmap(struct f2fs_sb_info *sbi)
 	return init_victim_secmap(sbi);
 }
 
+struct cb_sort_entry {
+	unsigned long long mtime;
+	unsigned int secno;
+};
+
+static int cb_sort_cmp(const void *a, const void *b)
+{
+	const struct cb_sort_entry *ea = a, *eb = b;
+
+	if (ea->mtime == eb->mtime)
+		return 0;
+	return ea->mtime < eb->mtime ? -1 : 1;
+}
+
+/* Fill the cost-benefit buckets from the SIT entries, oldest first */
+static int build_cb_buckets(struct f2fs_sb_info *sbi)
+{
+	struct cb_sort_entry *ents;
+	unsigned int secno, i;
+
+	ents = vmalloc(TOTAL_SECS(sbi) * sizeof(struct cb_sort_entry));
+	if (!ents)
+		return -ENOMEM;
+
+	for (secno = 0; secno < TOTAL_SECS(sbi); secno++) {
+		unsigned int start = secno * sbi->segs_per_sec;
+		unsigned long long mtime = 0;
+
+		for (i = 0; i < sbi->segs_per_sec; i++)
+			mtime += get_seg_entry(sbi, start + i)->mtime;
+
+		ents[secno].mtime = div_u64(mtime, sbi->segs_per_sec);
+		ents[secno].secno = secno;
+	}
+
+	sort(ents, TOTAL_SECS(sbi), sizeof(struct cb_sort_entry),
+							cb_sort_cmp, NULL);
+
+	mutex_lock(&SIT_I(sbi)->sentry_lock);
+	for (i = 0; i < TOTAL_SECS(sbi); i++)
+		__update_cb_entry(sbi, ents[i].secno * sbi->segs_per_sec);
+	mutex_unlock(&SIT_I(sbi)->sentry_lock);
+
+	vfree(ents);
+	return 0;
+}
+
 /*
  * Update min, max modified time for cost-benefit GC algorithm
  */
@@ -1672,6 +1996,19 @@ int build_segment_manager(struct f2fs_sb_info *sbi)
 	sm_info->main_segments = le32_to_cpu(raw_super->segment_count_main);
 	sm_info->ssa_blkaddr = le32_to_cpu(raw_super->ssa_blkaddr);
 
+	sm_info->min_ssr_sections = (sm_info->ovp_segments +
+			sm_info->reserved_segments) / sbi->segs_per_sec;
+	sm_info->bggc_urgent_sections =
+			sm_info->reserved_segments / sbi->segs_per_sec;
+	sm_info->fggc_budget_ms = DEF_FGGC_BUDGET_MS;
+
+	init_waitqueue_head(&sm_info->discard_wait_queue);
+	init_waitqueue_head(&sm_info->discard_cmpl_queue);
+	mutex_init(&sm_info->discard_lock);
+	INIT_LIST_HEAD(&sm_info->discard_list);
+	sm_info->discard_granularity = DEF_DISCARD_GRANULARITY;
+	sm_info->hot_wtemp_threshold = DEF_HOT_WTEMP_THRESHOLD;
+
 	err = build_sit_info(sbi);
 	if (err)
 		return err;
@@ -1685,13 +2022,17 @@ int build_segment_manager(struct f2fs_sb_info *sbi)
 	/* reinit free segmap based on SIT */
 	build_sit_entries(sbi);
 
+	err = build_cb_buckets(sbi);
+	if (err)
+		return err;
+
 	init_free_segmap(sbi);
 	err = build_dirty_segmap(sbi);
 	if (err)
 		return err;
 
 	init_min_max_mtime(sbi);
-	return 0;
+	return start_discard_thread(sbi);
 }
 
 static void discard_dirty_segmap(struct f2fs_sb_info *sbi,
@@ -1768,6 +2109,7 @@ static void destroy_sit_info(struct f2fs_sb_info *sbi)
 	}
 	vfree(sit_i->sentries);
 	vfree(sit_i->sec_entries);
+	vfree(sit_i->cb_entries);
 	kfree(sit_i->dirty_sentries_bitmap);
 
 	SM_I(sbi)->sit_info = NULL;
@@ -1778,6 +2120,9 @@ static void destroy_sit_info(struct f2fs_sb_info *sbi)
 void destroy_segment_manager(struct f2fs_sb_info *sbi)
 {
 	struct f2fs_sm_info *sm_info = SM_I(sbi);
+	if (!sm_info)
+		return;
+	stop_discard_thread(sbi);
 	destroy_dirty_segmap(sbi);
 	destroy_curseg(sbi);
 	destroy_free_segmap(sbi);
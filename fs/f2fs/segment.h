@@ -165,6 +165,13 @@ struct sec_entry {
 	unsigned int valid_blocks;	/* # of valid blocks in a section */
 };
 
+/*
+ * Partially valid sections are kept on NR_CB_BUCKETS lists by their valid
+ * block count, each list ordered from the least to the most recently
+ * modified section, so cost-benefit GC only has to look at list heads.
+ */
+#define NR_CB_BUCKETS		32
+
 struct segment_allocation {
 	void (*allocate_segment)(struct f2fs_sb_info *, int, bool);
 };
@@ -190,6 +197,8 @@ struct sit_info {
 	unsigned long long mounted_time;	/* mount time */
 	unsigned long long min_mtime;		/* min. modification time */
 	unsigned long long max_mtime;		/* max. modification time */
+	struct list_head cb_buckets[NR_CB_BUCKETS]; /* victims by utilization */
+	struct list_head *cb_entries;		/* bucket entry of each section */
 };
 
 struct free_segmap_info {
@@ -274,6 +283,64 @@ static inline unsigned int get_valid_blocks(struct f2fs_sb_info *sbi,
 		return get_seg_entry(sbi, segno)->valid_blocks;
 }
 
+/*
+ * With -o discard, the segments freed by a checkpoint are queued as merged
+ * ranges, which the discard thread trims whenever the device is idle.
+ * Ranges shorter than discard_granularity segments stay queued until they
+ * grow or are reused.
+ */
+#define DEF_DISCARD_GRANULARITY		1	/* segments */
+#define DISCARD_BUSY_WAIT_MS		100	/* retry interval when busy */
+
+struct discard_cmd {
+	struct list_head list;
+	unsigned int segno;		/* first segment of the range */
+	unsigned int len;		/* # of segments */
+};
+
+/*
+ * Rewrites of a file's data are counted per window of HOT_WTEMP_WINDOW_MS,
+ * the count halving with each window passed. Regular files reaching
+ * hot_wtemp_threshold go to the hot data log, where their short-lived
+ * blocks do not mix with the warm ones. 0 disables the promotion.
+ */
+#define DEF_HOT_WTEMP_THRESHOLD		32
+#define HOT_WTEMP_WINDOW_MS		5000
+
+static inline void f2fs_update_wtemp(struct inode *inode)
+{
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	unsigned long window = msecs_to_jiffies(HOT_WTEMP_WINDOW_MS);
+	unsigned long passed = (jiffies - fi->i_wtemp_stamp) / window;
+
+	/* racing writeback of the same inode only makes it approximate */
+	if (passed) {
+		fi->i_wtemp = passed < 32 ? fi->i_wtemp >> passed : 0;
+		fi->i_wtemp_stamp += passed * window;
+	}
+	if (fi->i_wtemp < UINT_MAX)
+		fi->i_wtemp++;
+}
+
+static inline bool is_hot_file(struct f2fs_sb_info *sbi, struct inode *inode)
+{
+	unsigned int threshold = SM_I(sbi)->hot_wtemp_threshold;
+
+	if (file_is_hot(inode))
+		return true;
+	return threshold && F2FS_I(inode)->i_wtemp >= threshold;
+}
+
+/* cost-benefit bucket of a section, -1 when it is either free or full */
+static inline int cb_bucket(struct f2fs_sb_info *sbi, unsigned int vblocks)
+{
+	unsigned int blks_per_sec = sbi->segs_per_sec << sbi->log_blocks_per_seg;
+
+	if (!vblocks || vblocks >= blks_per_sec)
+		return -1;
+	return (vblocks - 1) * NR_CB_BUCKETS / (blks_per_sec - 1);
+}
+
 static inline void seg_info_from_raw_sit(struct seg_entry *se,
 					struct f2fs_sit_entry *rs)
 {
@@ -456,16 +523,51 @@ static inline bool need_SSR(struct f2fs_sb_info *sbi)
 	return (free_sections(sbi) < overprovision_sections(sbi));
 }
 
-static inline bool has_not_enough_free_secs(struct f2fs_sb_info *sbi, int freed)
+/*
+ * Free sections left above the point where foreground GC is required,
+ * i.e. what remains once the next checkpoint and the reserved sections
+ * are accounted for.
+ */
+static inline int free_secs_margin(struct f2fs_sb_info *sbi)
 {
 	int node_secs = get_blocktype_secs(sbi, F2FS_DIRTY_NODES);
 	int dent_secs = get_blocktype_secs(sbi, F2FS_DIRTY_DENTS);
 
+	return (int)free_sections(sbi) - (node_secs + 2 * dent_secs +
+						reserved_sections(sbi));
+}
+
+static inline bool has_not_enough_free_secs(struct f2fs_sb_info *sbi, int freed)
+{
+	if (sbi->por_doing)
+		return false;
+
+	return free_secs_margin(sbi) + freed <= 0;
+}
+
+/*
+ * As free space runs out, f2fs steps through three tiers so that writers
+ * stall as late and as briefly as possible:
+ * 1. below min_ssr_sections free sections, data logs switch to SSR and
+ *    start filling the holes of dirty segments,
+ * 2. within bggc_urgent_sections of the foreground threshold, writers
+ *    wake the GC thread, which then cleans without waiting for idle,
+ * 3. at the threshold itself, the writer runs foreground GC, which it
+ *    leaves after fggc_budget_ms once the checkpoint is sure to fit.
+ */
+#define DEF_FGGC_BUDGET_MS	100
+
+static inline bool need_data_SSR(struct f2fs_sb_info *sbi)
+{
+	return free_sections(sbi) < SM_I(sbi)->min_ssr_sections;
+}
+
+static inline bool need_urgent_bg_gc(struct f2fs_sb_info *sbi)
+{
 	if (sbi->por_doing)
 		return false;
 
-	return ((free_sections(sbi) + freed) <= (node_secs + 2 * dent_secs +
-						reserved_sections(sbi)));
+	return free_secs_margin(sbi) <= (int)SM_I(sbi)->bggc_urgent_sections;
 }
 
 static inline int utilization(struct f2fs_sb_info *sbi)
@@ -24,6 +24,7 @@
 #include <linux/blkdev.h>
 #include <linux/f2fs_fs.h>
 #include <linux/sysfs.h>
+#include <linux/workqueue.h>
 
 #include "f2fs.h"
 #include "node.h"
@@ -48,6 +49,8 @@ enum {
 	Opt_active_logs,
 	Opt_disable_ext_identify,
 	Opt_inline_xattr,
+	Opt_inline_data,
+	Opt_inline_dentry,
 	Opt_android_emu,
 	Opt_err_continue,
 	Opt_err_panic,
@@ -65,6 +68,8 @@ static match_table_t f2fs_tokens = {
 	{Opt_active_logs, "active_logs=%u"},
 	{Opt_disable_ext_identify, "disable_ext_identify"},
 	{Opt_inline_xattr, "inline_xattr"},
+	{Opt_inline_data, "inline_data"},
+	{Opt_inline_dentry, "inline_dentry"},
 	{Opt_android_emu, "android_emu=%s"},
 	{Opt_err_continue, "errors=continue"},
 	{Opt_err_panic, "errors=panic"},
@@ -73,24 +78,39 @@ static match_table_t f2fs_tokens = {
 };
 
 /* Sysfs support for f2fs */
+enum {
+	GC_THREAD,	/* struct f2fs_gc_kthread */
+	SM_INFO,	/* struct f2fs_sm_info */
+};
+
 struct f2fs_attr {
 	struct attribute attr;
 	ssize_t (*show)(struct f2fs_attr *, struct f2fs_sb_info *, char *);
 	ssize_t (*store)(struct f2fs_attr *, struct f2fs_sb_info *,
 			 const char *, size_t);
+	int struct_type;
 	int offset;
 };
 
+static unsigned char *__struct_ptr(struct f2fs_sb_info *sbi, int struct_type)
+{
+	if (struct_type == GC_THREAD)
+		return (unsigned char *)sbi->gc_thread;
+	else if (struct_type == SM_INFO)
+		return (unsigned char *)SM_I(sbi);
+	return NULL;
+}
+
 static ssize_t f2fs_sbi_show(struct f2fs_attr *a,
 			struct f2fs_sb_info *sbi, char *buf)
 {
-	struct f2fs_gc_kthread *gc_kth = sbi->gc_thread;
+	unsigned char *ptr = __struct_ptr(sbi, a->struct_type);
 	unsigned int *ui;
 
-	if (!gc_kth)
+	if (!ptr)
 		return -EINVAL;
 
-	ui = (unsigned int *)(((char *)gc_kth) + a->offset);
+	ui = (unsigned int *)(ptr + a->offset);
 
 	return snprintf(buf, PAGE_SIZE, "%u\n", *ui);
 }
@@ -99,15 +119,15 @@ static ssize_t f2fs_sbi_store(struct f2fs_attr *a,
 			struct f2fs_sb_info *sbi,
 			const char *buf, size_t count)
 {
-	struct f2fs_gc_kthread *gc_kth = sbi->gc_thread;
+	unsigned char *ptr = __struct_ptr(sbi, a->struct_type);
 	unsigned long t;
 	unsigned int *ui;
 	ssize_t ret;
 
-	if (!gc_kth)
+	if (!ptr)
 		return -EINVAL;
 
-	ui = (unsigned int *)(((char *)gc_kth) + a->offset);
+	ui = (unsigned int *)(ptr + a->offset);
 
 	ret = kstrtoul(skip_spaces(buf), 0, &t);
 	if (ret < 0)
@@ -143,21 +163,92 @@ static void f2fs_sb_release(struct kobject *kobj)
 	complete(&sbi->s_kobj_unregister);
 }
 
-#define F2FS_ATTR_OFFSET(_name, _mode, _show, _store, _elname) \
+#define F2FS_ATTR_OFFSET(_struct_type, _name, _mode, _show, _store, _offset) \
 static struct f2fs_attr f2fs_attr_##_name = {			\
 	.attr = {.name = __stringify(_name), .mode = _mode },	\
 	.show	= _show,					\
 	.store	= _store,					\
-	.offset = offsetof(struct f2fs_gc_kthread, _elname),	\
+	.struct_type = _struct_type,				\
+	.offset = _offset					\
 }
 
-#define F2FS_RW_ATTR(name, elname)	\
-	F2FS_ATTR_OFFSET(name, 0644, f2fs_sbi_show, f2fs_sbi_store, elname)
+#define F2FS_RW_ATTR(struct_type, struct_name, name, elname)	\
+	F2FS_ATTR_OFFSET(struct_type, name, 0644,		\
+		f2fs_sbi_show, f2fs_sbi_store,			\
+		offsetof(struct struct_name, elname))
+
+static ssize_t f2fs_hot_ext_show(struct f2fs_attr *a,
+			struct f2fs_sb_info *sbi, char *buf)
+{
+	ssize_t len = 0;
+	int i;
 
-F2FS_RW_ATTR(gc_min_sleep_time, min_sleep_time);
-F2FS_RW_ATTR(gc_max_sleep_time, max_sleep_time);
-F2FS_RW_ATTR(gc_no_gc_sleep_time, no_gc_sleep_time);
-F2FS_RW_ATTR(gc_idle, gc_idle);
+	spin_lock(&sbi->hot_ext_lock);
+	for (i = 0; i < sbi->hot_ext_count; i++)
+		len += snprintf(buf + len, PAGE_SIZE - len, "%s\n",
+						sbi->hot_ext_list[i]);
+	spin_unlock(&sbi->hot_ext_lock);
+	return len;
+}
+
+/* "ext" adds a hot extension, "!ext" removes it */
+static ssize_t f2fs_hot_ext_store(struct f2fs_attr *a,
+			struct f2fs_sb_info *sbi,
+			const char *buf, size_t count)
+{
+	char name[F2FS_HOT_EXT_LEN];
+	bool remove = false;
+	size_t len;
+	int i, err = 0;
+
+	buf = skip_spaces(buf);
+	if (*buf == '!') {
+		remove = true;
+		buf++;
+	}
+	len = strcspn(buf, " \t\n");
+	if (!len || len >= F2FS_HOT_EXT_LEN)
+		return -EINVAL;
+	memcpy(name, buf, len);
+	name[len] = '\0';
+
+	spin_lock(&sbi->hot_ext_lock);
+	for (i = 0; i < sbi->hot_ext_count; i++)
+		if (!strcasecmp(sbi->hot_ext_list[i], name))
+			break;
+
+	if (remove) {
+		if (i == sbi->hot_ext_count) {
+			err = -ENOENT;
+			goto out;
+		}
+		sbi->hot_ext_count--;
+		memmove(sbi->hot_ext_list[i], sbi->hot_ext_list[i + 1],
+			(sbi->hot_ext_count - i) * F2FS_HOT_EXT_LEN);
+	} else if (i == sbi->hot_ext_count) {
+		if (i == F2FS_MAX_HOT_EXT) {
+			err = -ENOSPC;
+			goto out;
+		}
+		strcpy(sbi->hot_ext_list[i], name);
+		sbi->hot_ext_count++;
+	}
+out:
+	spin_unlock(&sbi->hot_ext_lock);
+	return err ? err : count;
+}
+
+F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_min_sleep_time, min_sleep_time);
+F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_max_sleep_time, max_sleep_time);
+F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_no_gc_sleep_time, no_gc_sleep_time);
+F2FS_RW_ATTR(GC_THREAD, f2fs_gc_kthread, gc_idle, gc_idle);
+F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, min_ssr_sections, min_ssr_sections);
+F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, bggc_urgent_sections, bggc_urgent_sections);
+F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, fggc_budget_ms, fggc_budget_ms);
+F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, discard_granularity, discard_granularity);
+F2FS_RW_ATTR(SM_INFO, f2fs_sm_info, hot_wtemp_threshold, hot_wtemp_threshold);
+F2FS_ATTR_OFFSET(SM_INFO, hot_extensions, 0644,
+		f2fs_hot_ext_show, f2fs_hot_ext_store, 0);
 
 #define ATTR_LIST(name) (&f2fs_attr_##name.attr)
 static struct attribute *f2fs_attrs[] = {
@@ -165,6 +256,12 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(gc_max_sleep_time),
 	ATTR_LIST(gc_no_gc_sleep_time),
 	ATTR_LIST(gc_idle),
+	ATTR_LIST(min_ssr_sections),
+	ATTR_LIST(bggc_urgent_sections),
+	ATTR_LIST(fggc_budget_ms),
+	ATTR_LIST(discard_granularity),
+	ATTR_LIST(hot_wtemp_threshold),
+	ATTR_LIST(hot_extensions),
 	NULL,
 };
 
@@ -295,6 +392,12 @@ static int parse_options(struct super_block *sb, char *options)
 				"inline_xattr options not supported");
 			break;
 #endif
+		case Opt_inline_data:
+			set_opt(sbi, INLINE_DATA);
+			break;
+		case Opt_inline_dentry:
+			set_opt(sbi, INLINE_DENTRY);
+			break;
 #ifdef CONFIG_F2FS_FS_POSIX_ACL
 		case Opt_noacl:
 			clear_opt(sbi, POSIX_ACL);
@@ -367,7 +470,9 @@ static struct inode *f2fs_alloc_inode(struct super_block *sb)
 	atomic_set(&fi->dirty_dents, 0);
 	fi->i_current_depth = 1;
 	fi->i_advise = 0;
-	rwlock_init(&fi->ext.ext_lock);
+	rwlock_init(&fi->ext_lock);
+	fi->ext_tree = RB_ROOT;
+	fi->i_wtemp_stamp = jiffies;
 
 	set_inode_flag(fi, FI_NEW_INODE);
 
@@ -399,6 +504,10 @@ static int f2fs_drop_inode(struct inode *inode)
 static void f2fs_dirty_inode(struct inode *inode, int flags)
 {
 	set_inode_flag(F2FS_I(inode), FI_DIRTY_INODE);
+
+	/* timestamp updates come with I_DIRTY_SYNC only */
+	if (flags & I_DIRTY_DATASYNC)
+		set_inode_flag(F2FS_I(inode), FI_DIRTY_DSYNC);
 }
 
 static void f2fs_i_callback(struct rcu_head *head)
@@ -416,6 +525,8 @@ static void f2fs_put_super(struct super_block *sb)
 {
 	struct f2fs_sb_info *sbi = F2FS_SB(sb);
 
+	unregister_shrinker(&sbi->extent_shrinker);
+
 	if (sbi->s_proc) {
 		remove_proc_entry("segment_info", sbi->s_proc);
 		remove_proc_entry(sb->s_id, f2fs_proc_root);
@@ -435,6 +546,8 @@ static void f2fs_put_super(struct super_block *sb)
 	destroy_segment_manager(sbi);
 
 	kfree(sbi->ckpt);
+	destroy_workqueue(sbi->cp_wq);
+	crypto_free_shash(sbi->s_chksum_driver);
 	kobject_put(&sbi->s_kobj);
 	wait_for_completion(&sbi->s_kobj_unregister);
 
@@ -513,6 +626,10 @@ static int f2fs_show_options(struct seq_file *seq, struct vfsmount *vfs)
 	if (test_opt(sbi, INLINE_XATTR))
 		seq_puts(seq, ",inline_xattr");
 #endif
+	if (test_opt(sbi, INLINE_DATA))
+		seq_puts(seq, ",inline_data");
+	if (test_opt(sbi, INLINE_DENTRY))
+		seq_puts(seq, ",inline_dentry");
 #ifdef CONFIG_F2FS_FS_POSIX_ACL
 	if (test_opt(sbi, POSIX_ACL))
 		seq_puts(seq, ",acl");
@@ -769,6 +886,11 @@ static int sanity_check_ckpt(struct f2fs_sb_info *sbi)
 	return 0;
 }
 
+/* SQLite databases and their rollback and write-ahead logs */
+static const char default_hot_ext[][F2FS_HOT_EXT_LEN] = {
+	"db", "-journal", "-wal",
+};
+
 static void init_sb_info(struct f2fs_sb_info *sbi)
 {
 	struct f2fs_super_block *raw_super = sbi->raw_super;
@@ -793,6 +915,13 @@ static void init_sb_info(struct f2fs_sb_info *sbi)
 
 	for (i = 0; i < NR_COUNT_TYPE; i++)
 		atomic_set(&sbi->nr_pages[i], 0);
+
+	spin_lock_init(&sbi->hot_ext_lock);
+	for (i = 0; i < ARRAY_SIZE(default_hot_ext); i++)
+		strcpy(sbi->hot_ext_list[i], default_hot_ext[i]);
+	sbi->hot_ext_count = ARRAY_SIZE(default_hot_ext);
+
+	init_extent_cache_info(sbi);
 }
 
 static int validate_superblock(struct super_block *sb,
@@ -821,6 +950,29 @@ static int validate_superblock(struct super_block *sb,
 	return -EINVAL;
 }
 
+/*
+ * Checkpoint crcs are crc32_le seeded with F2FS_SUPER_MAGIC and not
+ * inverted, which is the "crc32" hash keyed with the magic.  Going through
+ * the crypto API lets an accelerated driver take over.
+ */
+static int init_chksum_driver(struct f2fs_sb_info *sbi)
+{
+	__le32 seed = cpu_to_le32(F2FS_SUPER_MAGIC);
+	int err;
+
+	sbi->s_chksum_driver = crypto_alloc_shash("crc32", 0, 0);
+	if (IS_ERR(sbi->s_chksum_driver))
+		return PTR_ERR(sbi->s_chksum_driver);
+
+	err = crypto_shash_setkey(sbi->s_chksum_driver, (u8 *)&seed,
+				  sizeof(seed));
+	if (!err && crypto_shash_descsize(sbi->s_chksum_driver) > sizeof(u32))
+		err = -EINVAL;
+	if (err)
+		crypto_free_shash(sbi->s_chksum_driver);
+	return err;
+}
+
 static int f2fs_fill_super(struct super_block *sb, void *data, int silent)
 {
 	struct f2fs_sb_info *sbi;
@@ -895,12 +1047,25 @@ static int f2fs_fill_super(struct super_block *sb, void *data, int silent)
 	init_rwsem(&sbi->bio_sem);
 	init_sb_info(sbi);
 
+	err = init_chksum_driver(sbi);
+	if (err) {
+		f2fs_msg(sb, KERN_ERR, "Cannot load crc32 driver");
+		goto free_sb_buf;
+	}
+
+	/* checkpoints run from writeback, so it needs a rescuer */
+	sbi->cp_wq = alloc_workqueue("f2fs_cp", WQ_MEM_RECLAIM | WQ_UNBOUND, 1);
+	if (!sbi->cp_wq) {
+		err = -ENOMEM;
+		goto free_chksum;
+	}
+
 	/* get an inode for meta space */
 	sbi->meta_inode = f2fs_iget(sb, F2FS_META_INO(sbi));
 	if (IS_ERR(sbi->meta_inode)) {
 		f2fs_msg(sb, KERN_ERR, "Failed to read F2FS meta data inode");
 		err = PTR_ERR(sbi->meta_inode);
-		goto free_sb_buf;
+		goto free_cp_wq;
 	}
 
 get_cp:
@@ -1035,6 +1200,7 @@ get_cp:
 	if (err)
 		goto fail;
 
+	register_shrinker(&sbi->extent_shrinker);
 	return 0;
 fail:
 	stop_gc_thread(sbi);
@@ -1051,6 +1217,10 @@ free_cp:
 free_meta_inode:
 	make_bad_inode(sbi->meta_inode);
 	iput(sbi->meta_inode);
+free_cp_wq:
+	destroy_workqueue(sbi->cp_wq);
+free_chksum:
+	crypto_free_shash(sbi->s_chksum_driver);
 free_sb_buf:
 	brelse(raw_super_buf);
 free_sbi:
@@ -1108,10 +1278,13 @@ static int __init init_f2fs_fs(void)
 	err = create_checkpoint_caches();
 	if (err)
 		goto free_gc_caches;
+	err = create_extent_caches();
+	if (err)
+		goto free_checkpoint_caches;
 	f2fs_kset = kset_create_and_add("f2fs", NULL, fs_kobj);
 	if (!f2fs_kset) {
 		err = -ENOMEM;
-		goto free_checkpoint_caches;
+		goto free_extent_caches;
 	}
 	err = register_filesystem(&f2fs_fs_type);
 	if (err)
@@ -1122,6 +1295,8 @@ static int __init init_f2fs_fs(void)
 
 free_kset:
 	kset_unregister(f2fs_kset);
+free_extent_caches:
+	destroy_extent_caches();
 free_checkpoint_caches:
 	destroy_checkpoint_caches();
 free_gc_caches:
@@ -1139,6 +1314,7 @@ static void __exit exit_f2fs_fs(void)
 	remove_proc_entry("fs/f2fs", NULL);
 	f2fs_destroy_root_stats();
 	unregister_filesystem(&f2fs_fs_type);
+	destroy_extent_caches();
 	destroy_checkpoint_caches();
 	destroy_gc_caches();
 	destroy_node_manager_caches();
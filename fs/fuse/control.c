@@ -176,6 +176,48 @@ static ssize_t fuse_conn_congestion_threshold_write(struct file *file,
 	return ret;
 }
 
+static ssize_t fuse_conn_stats_read(struct file *file, char __user *buf,
+				    size_t len, loff_t *ppos)
+{
+	struct fuse_conn *fc;
+	struct fuse_io_stats st;
+	unsigned max_write;
+	char tmp[512];
+	size_t size;
+
+	fc = fuse_ctl_file_conn_get(file);
+	if (!fc)
+		return 0;
+
+	spin_lock(&fc->lock);
+	st = fc->io_stats;
+	max_write = fc->max_write;
+	spin_unlock(&fc->lock);
+	fuse_conn_put(fc);
+
+	size = scnprintf(tmp, sizeof(tmp),
+			 "max_write: %u\n"
+			 "read_reqs: %llu\n"
+			 "read_bytes: %llu\n"
+			 "write_reqs: %llu\n"
+			 "write_bytes: %llu\n"
+			 "spliced_pages: %llu\n"
+			 "moved_pages: %llu\n"
+			 "passthrough_read_bytes: %llu\n"
+			 "passthrough_write_bytes: %llu\n",
+			 max_write,
+			 (unsigned long long)st.read_reqs,
+			 (unsigned long long)st.read_bytes,
+			 (unsigned long long)st.write_reqs,
+			 (unsigned long long)st.write_bytes,
+			 (unsigned long long)st.spliced_pages,
+			 (unsigned long long)st.moved_pages,
+			 (unsigned long long)st.passthrough_read_bytes,
+			 (unsigned long long)st.passthrough_write_bytes);
+
+	return simple_read_from_buffer(buf, len, ppos, tmp, size);
+}
+
 static const struct file_operations fuse_ctl_abort_ops = {
 	.open = nonseekable_open,
 	.write = fuse_conn_abort_write,
@@ -188,6 +230,12 @@ static const struct file_operations fuse_ctl_waiting_ops = {
 	.llseek = no_llseek,
 };
 
+static const struct file_operations fuse_conn_stats_ops = {
+	.open = nonseekable_open,
+	.read = fuse_conn_stats_read,
+	.llseek = no_llseek,
+};
+
 static const struct file_operations fuse_conn_max_background_ops = {
 	.open = nonseekable_open,
 	.read = fuse_conn_max_background_read,
@@ -266,7 +314,9 @@ int fuse_ctl_add_conn(struct fuse_conn *fc)
 				 1, NULL, &fuse_conn_max_background_ops) ||
 	    !fuse_ctl_add_dentry(parent, fc, "congestion_threshold",
 				 S_IFREG | 0600, 1, NULL,
-				 &fuse_conn_congestion_threshold_ops))
+				 &fuse_conn_congestion_threshold_ops) ||
+	    !fuse_ctl_add_dentry(parent, fc, "stats", S_IFREG | 0400, 1,
+				 NULL, &fuse_conn_stats_ops))
 		goto err;
 
 	return 0;
@@ -209,6 +209,10 @@ void fuse_put_request(struct fuse_conn *fc, struct fuse_req *req)
 		if (req->waiting)
 			atomic_dec(&fc->num_waiting);
 
+		/* The open failed or was interrupted after the reply */
+		if (req->passthrough_filp)
+			fput(req->passthrough_filp);
+
 		if (req->stolen_file)
 			put_reserved_req(fc, req);
 		else
@@ -294,11 +298,32 @@ static void flush_bg_queue(struct fuse_conn *fc)
  *
  * Called with fc->lock, unlocks it
  */
+/* Called with fc->lock held */
+static void fuse_account_io(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_io_stats *st = &fc->io_stats;
+
+	if (req->out.h.error)
+		return;
+
+	switch (req->in.h.opcode) {
+	case FUSE_READ:
+		st->read_reqs++;
+		st->read_bytes += req->out.args[0].size;
+		break;
+	case FUSE_WRITE:
+		st->write_reqs++;
+		st->write_bytes += req->misc.write.out.size;
+		break;
+	}
+}
+
 static void request_end(struct fuse_conn *fc, struct fuse_req *req)
 __releases(fc->lock)
 {
 	void (*end) (struct fuse_conn *, struct fuse_req *) = req->end;
 	req->end = NULL;
+	fuse_account_io(fc, req);
 	list_del(&req->list);
 	list_del(&req->intr_entry);
 	req->state = FUSE_REQ_FINISHED;
@@ -546,6 +571,7 @@ struct fuse_copy_state {
 	void *mapaddr;
 	void *buf;
 	unsigned len;
+	unsigned ref_pages;
 	unsigned move_pages:1;
 };
 
@@ -758,10 +784,12 @@ static int fuse_try_move_page(struct fuse_copy_state *cs, struct page **pagep)
 
 	err = 0;
 	spin_lock(&cs->fc->lock);
-	if (cs->req->aborted)
+	if (cs->req->aborted) {
 		err = -ENOENT;
-	else
+	} else {
 		*pagep = newpage;
+		cs->fc->io_stats.moved_pages++;
+	}
 	spin_unlock(&cs->fc->lock);
 
 	if (err) {
@@ -808,6 +836,7 @@ static int fuse_ref_page(struct fuse_copy_state *cs, struct page *page,
 
 	cs->pipebufs++;
 	cs->nr_segs++;
+	cs->ref_pages++;
 	cs->len = 0;
 
 	return 0;
@@ -1243,6 +1272,12 @@ static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
 	if (ret < 0)
 		goto out;
 
+	if (cs.ref_pages) {
+		spin_lock(&fc->lock);
+		fc->io_stats.spliced_pages += cs.ref_pages;
+		spin_unlock(&fc->lock);
+	}
+
 	ret = 0;
 	pipe_lock(pipe);
 
@@ -1726,6 +1761,10 @@ static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
 	err = copy_out_args(cs, &req->out, nbytes);
 	fuse_copy_finish(cs);
 
+	/* Only here can the daemon's fd be resolved */
+	if (!err)
+		fuse_passthrough_prepare(fc, req);
+
 	spin_lock(&fc->lock);
 	req->locked = 0;
 	if (!err) {
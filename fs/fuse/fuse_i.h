@@ -26,6 +26,9 @@
 /** Max number of pages that can be used in a single read request */
 #define FUSE_MAX_PAGES_PER_REQ 32
 
+/** Max number of pages in a write request, if max_write allows for it */
+#define FUSE_MAX_WRITE_PAGES 64
+
 /** Bias for fi->writectr, meaning new writepages must not be sent */
 #define FUSE_NOWRITE INT_MIN
 
@@ -33,7 +36,10 @@
 #define FUSE_NAME_MAX 1024
 
 /** Number of dentries for each connection in the control filesystem */
-#define FUSE_CTL_NUM_DENTRIES 5
+#define FUSE_CTL_NUM_DENTRIES 6
+
+/** The magic of fuse superblocks */
+#define FUSE_SUPER_MAGIC 0x65735546
 
 /** If the FUSE_DEFAULT_PERMISSIONS flag is given, the filesystem
     module will check permissions based on the file mode.  Otherwise no
@@ -138,6 +144,9 @@ struct fuse_file {
 
 	/** Has flock been performed on this file? */
 	bool flock:1;
+
+	/** Lower file serving read, write and mmap, if any */
+	struct file *passthrough_filp;
 };
 
 /** One input argument of a request */
@@ -288,7 +297,7 @@ struct fuse_req {
 	} misc;
 
 	/** page vector */
-	struct page *pages[FUSE_MAX_PAGES_PER_REQ];
+	struct page *pages[FUSE_MAX_WRITE_PAGES];
 
 	/** number of pages in vector */
 	unsigned num_pages;
@@ -310,6 +319,30 @@ struct fuse_req {
 
 	/** Request is stolen from fuse_file->reserved_req */
 	struct file *stolen_file;
+
+	/** Lower file handed over by the reply to an open */
+	struct file *passthrough_filp;
+};
+
+/**
+ * Data moved through a connection, protected by fuse_conn->lock
+ */
+struct fuse_io_stats {
+	/** Completed READ and WRITE requests, and their bytes */
+	u64 read_reqs;
+	u64 read_bytes;
+	u64 write_reqs;
+	u64 write_bytes;
+
+	/** Pages handed to the daemon by reference with splice */
+	u64 spliced_pages;
+
+	/** Reply pages moved into the page cache with splice */
+	u64 moved_pages;
+
+	/** Bytes read and written straight to the lower files */
+	u64 passthrough_read_bytes;
+	u64 passthrough_write_bytes;
 };
 
 /**
@@ -475,6 +508,9 @@ struct fuse_conn {
 	/** Don't apply umask to creation modes */
 	unsigned dont_mask:1;
 
+	/** May open hand over a lower file for data i/o? */
+	unsigned passthrough:1;
+
 	/** Are BSD file locking primitives not implemented by fs? */
 	unsigned no_flock:1;
 
@@ -499,6 +535,9 @@ struct fuse_conn {
 	/** number of dentries used in the above array */
 	int ctl_ndents;
 
+	/** Throughput counters */
+	struct fuse_io_stats io_stats;
+
 	/** O_ASYNC requests */
 	struct fasync_struct *fasync;
 
@@ -770,4 +809,15 @@ int fuse_dev_release(struct inode *inode, struct file *file);
 
 void fuse_write_update_size(struct inode *inode, loff_t pos);
 
+/* passthrough.c */
+void fuse_passthrough_prepare(struct fuse_conn *fc, struct fuse_req *req);
+void fuse_passthrough_setup(struct fuse_file *ff, struct fuse_req *req,
+			    int flags);
+void fuse_passthrough_release(struct fuse_file *ff);
+ssize_t fuse_passthrough_aio_read(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos);
+ssize_t fuse_passthrough_aio_write(struct kiocb *iocb, const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+
 #endif /* _FS_FUSE_I_H */
@@ -0,0 +1,206 @@
+/*
+  FUSE: Filesystem in Userspace
+
+  This program can be distributed under the terms of the GNU GPL.
+  See the file COPYING.
+*/
+
+#include "fuse_i.h"
+
+#include <linux/file.h>
+#include <linux/fsnotify.h>
+#include <linux/pagemap.h>
+#include <linux/cred.h>
+#include <linux/uio.h>
+#include <linux/aio.h>
+
+/*
+ * A filesystem that negotiated FUSE_PASSTHROUGH may answer OPEN and CREATE
+ * with FOPEN_PASSTHROUGH and passthrough_fd, the number of a file it has
+ * opened on the backing filesystem.  The reference is taken while the reply
+ * is being written, i.e. in the context of the daemon, and from then on
+ * read, write and mmap of the fuse file go straight to that lower file.
+ * Open, permission checks, attributes and everything else still go to the
+ * daemon.
+ *
+ * The lower file is accessed with the credentials it was opened with.
+ */
+
+void fuse_passthrough_prepare(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_open_out *outarg;
+	struct file *lower;
+
+	if (!fc->passthrough || req->out.h.error)
+		return;
+
+	if (req->in.h.opcode == FUSE_OPEN && req->out.numargs == 1)
+		outarg = req->out.args[0].value;
+	else if (req->in.h.opcode == FUSE_CREATE && req->out.numargs == 2)
+		outarg = req->out.args[1].value;
+	else
+		return;
+
+	if (!(outarg->open_flags & FOPEN_PASSTHROUGH))
+		return;
+
+	lower = fget(outarg->passthrough_fd);
+	if (!lower)
+		return;
+
+	/* Don't stack on ourselves, and only regular files will do */
+	if (lower->f_path.dentry->d_sb->s_magic == FUSE_SUPER_MAGIC ||
+	    !S_ISREG(lower->f_path.dentry->d_inode->i_mode) ||
+	    !lower->f_op || !lower->f_op->aio_read ||
+	    !lower->f_op->aio_write) {
+		fput(lower);
+		return;
+	}
+
+	req->passthrough_filp = lower;
+}
+
+/*
+ * Move the lower file from an answered open request to its fuse_file.  It
+ * is only kept if it was opened for all the access the fuse file needs.
+ */
+void fuse_passthrough_setup(struct fuse_file *ff, struct fuse_req *req,
+			    int flags)
+{
+	struct file *lower = req->passthrough_filp;
+	int accmode = flags & O_ACCMODE;
+
+	if (!lower)
+		return;
+	req->passthrough_filp = NULL;
+
+	if ((accmode != O_WRONLY && !(lower->f_mode & FMODE_READ)) ||
+	    (accmode != O_RDONLY && !(lower->f_mode & FMODE_WRITE))) {
+		fput(lower);
+		return;
+	}
+
+	ff->passthrough_filp = lower;
+}
+
+void fuse_passthrough_release(struct fuse_file *ff)
+{
+	if (ff->passthrough_filp) {
+		fput(ff->passthrough_filp);
+		ff->passthrough_filp = NULL;
+	}
+}
+
+static ssize_t fuse_passthrough_rw(struct file *lower, int rw,
+				   const struct iovec *iov,
+				   unsigned long nr_segs, loff_t *ppos)
+{
+	size_t count = iov_length(iov, nr_segs);
+	const struct cred *old_cred;
+	struct kiocb kiocb;
+	ssize_t ret;
+
+	init_sync_kiocb(&kiocb, lower);
+	kiocb.ki_pos = *ppos;
+	kiocb.ki_left = count;
+	kiocb.ki_nbytes = count;
+
+	old_cred = override_creds(lower->f_cred);
+	if (rw == WRITE)
+		ret = lower->f_op->aio_write(&kiocb, iov, nr_segs, kiocb.ki_pos);
+	else
+		ret = lower->f_op->aio_read(&kiocb, iov, nr_segs, kiocb.ki_pos);
+	if (ret == -EIOCBQUEUED)
+		ret = wait_on_sync_kiocb(&kiocb);
+	revert_creds(old_cred);
+
+	if (ret > 0) {
+		if (rw == WRITE)
+			fsnotify_modify(lower);
+		else
+			fsnotify_access(lower);
+	}
+	*ppos = kiocb.ki_pos;
+	return ret;
+}
+
+static void fuse_passthrough_account(struct fuse_conn *fc, int rw,
+				     ssize_t bytes)
+{
+	spin_lock(&fc->lock);
+	if (rw == WRITE)
+		fc->io_stats.passthrough_write_bytes += bytes;
+	else
+		fc->io_stats.passthrough_read_bytes += bytes;
+	spin_unlock(&fc->lock);
+}
+
+ssize_t fuse_passthrough_aio_read(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos)
+{
+	struct fuse_file *ff = iocb->ki_filp->private_data;
+	ssize_t ret;
+
+	ret = fuse_passthrough_rw(ff->passthrough_filp, READ, iov, nr_segs,
+				  &pos);
+	if (ret >= 0)
+		iocb->ki_pos = pos;
+	if (ret > 0)
+		fuse_passthrough_account(ff->fc, READ, ret);
+	return ret;
+}
+
+ssize_t fuse_passthrough_aio_write(struct kiocb *iocb, const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos)
+{
+	struct file *file = iocb->ki_filp;
+	struct fuse_file *ff = file->private_data;
+	struct file *lower = ff->passthrough_filp;
+	struct inode *inode = file->f_mapping->host;
+	loff_t start;
+	ssize_t ret;
+
+	/* Serialize with other writers of the fuse inode, for O_APPEND */
+	mutex_lock(&inode->i_mutex);
+	if (file->f_flags & O_APPEND)
+		pos = i_size_read(lower->f_mapping->host);
+	start = pos;
+
+	ret = fuse_passthrough_rw(lower, WRITE, iov, nr_segs, &pos);
+	if (ret > 0) {
+		iocb->ki_pos = pos;
+		fuse_write_update_size(inode, pos);
+		/* Pages cached by other openers no longer match the file */
+		if (inode->i_mapping->nrpages)
+			invalidate_inode_pages2_range(inode->i_mapping,
+					start >> PAGE_CACHE_SHIFT,
+					(pos - 1) >> PAGE_CACHE_SHIFT);
+	}
+	mutex_unlock(&inode->i_mutex);
+
+	if (ret > 0)
+		fuse_passthrough_account(ff->fc, WRITE, ret);
+	fuse_invalidate_attr(inode);
+	return ret;
+}
+
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *lower = ff->passthrough_filp;
+	int err;
+
+	if (!lower->f_op->mmap)
+		return -ENODEV;
+
+	err = lower->f_op->mmap(lower, vma);
+	if (err)
+		return err;
+
+	/* The mapping is backed by the lower file from now on */
+	get_file(lower);
+	fput(vma->vm_file);
+	vma->vm_file = lower;
+	file_accessed(file);
+	return 0;
+}
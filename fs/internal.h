@@ -141,3 +141,16 @@ extern int invalidate_inodes(struct super_block *, bool);
  * dcache.c
  */
 extern struct dentry *__d_alloc(struct super_block *, const struct qstr *);
+extern void d_negative_hit(struct dentry *);
+
+struct dcache_lookup_stats {
+	unsigned long rcu_walks;	/* lookups started in rcu-walk */
+	unsigned long rcu_fallbacks;	/* ... that had to redo in ref-walk */
+	unsigned long estale_retries;	/* LOOKUP_REVAL re-walks */
+	unsigned long neg_hits;		/* lookups ending on a negative dentry */
+	unsigned long neg_marked;	/* negative dentries marked hot */
+	unsigned long neg_kept;		/* hot negatives spared by the shrinker */
+	unsigned long neg_pruned;	/* negatives handed to the shrinker */
+};
+DECLARE_PER_CPU(struct dcache_lookup_stats, dcache_lookup_stats);
+#define dcache_stat_inc(field)	this_cpu_inc(dcache_lookup_stats.field)
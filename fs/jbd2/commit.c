@@ -320,6 +320,7 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	unsigned long long blocknr;
 	ktime_t start_time;
 	u64 commit_time;
+	struct jbd2_commit_record *hist;
 	char *tagp = NULL;
 	journal_header_t *header;
 	journal_block_tag_t *tag = NULL;
@@ -978,6 +979,8 @@ restart_loop:
 	stats.ts_tid = commit_transaction->t_tid;
 	stats.run.rs_handle_count =
 		atomic_read(&commit_transaction->t_handle_count);
+	stats.run.rs_sync_count =
+		atomic_read(&commit_transaction->t_sync_count);
 	trace_jbd2_run_stats(journal->j_fs_dev->bd_dev,
 			     commit_transaction->t_tid, &stats.run);
 
@@ -994,6 +997,7 @@ restart_loop:
 	journal->j_stats.run.rs_handle_count += stats.run.rs_handle_count;
 	journal->j_stats.run.rs_blocks += stats.run.rs_blocks;
 	journal->j_stats.run.rs_blocks_logged += stats.run.rs_blocks_logged;
+	journal->j_stats.run.rs_sync_count += stats.run.rs_sync_count;
 	spin_unlock(&journal->j_history_lock);
 
 	commit_transaction->t_state = T_FINISHED;
@@ -1013,6 +1017,15 @@ restart_loop:
 		journal->j_average_commit_time = commit_time;
 	write_unlock(&journal->j_state_lock);
 
+	spin_lock(&journal->j_history_lock);
+	hist = &journal->j_history[journal->j_history_cur++ % JBD2_HISTORY_SIZE];
+	hist->cr_tid = commit_transaction->t_tid;
+	hist->cr_commit_us = div_u64(commit_time, NSEC_PER_USEC);
+	hist->cr_sync_count = stats.run.rs_sync_count;
+	hist->cr_handle_count = stats.run.rs_handle_count;
+	hist->cr_blocks = stats.run.rs_blocks;
+	spin_unlock(&journal->j_history_lock);
+
 	if (commit_transaction->t_checkpoint_list == NULL &&
 	    commit_transaction->t_checkpoint_io_list == NULL) {
 		__jbd2_journal_drop_transaction(journal, commit_transaction);
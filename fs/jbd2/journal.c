@@ -54,6 +54,7 @@
 
 EXPORT_SYMBOL(jbd2_journal_extend);
 EXPORT_SYMBOL(jbd2_journal_stop);
+EXPORT_SYMBOL(jbd2_journal_batch_sync);
 EXPORT_SYMBOL(jbd2_journal_lock_updates);
 EXPORT_SYMBOL(jbd2_journal_unlock_updates);
 EXPORT_SYMBOL(jbd2_journal_get_write_access);
@@ -790,6 +791,10 @@ static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 	    s->stats->run.rs_blocks / s->stats->ts_tid);
 	seq_printf(seq, "  %lu logged blocks per transaction\n",
 	    s->stats->run.rs_blocks_logged / s->stats->ts_tid);
+	seq_printf(seq, "  %lu syncs per transaction\n",
+	    s->stats->run.rs_sync_count / s->stats->ts_tid);
+	seq_printf(seq, "%lu fsyncs waited for others to join\n",
+	    s->stats->ts_batch_waits);
 	return 0;
 }
 
@@ -853,6 +858,48 @@ static const struct file_operations jbd2_seq_info_fops = {
 	.release        = jbd2_seq_info_release,
 };
 
+static int jbd2_seq_history_show(struct seq_file *seq, void *v)
+{
+	journal_t *journal = seq->private;
+	struct jbd2_commit_record *hist;
+	unsigned int i, cur, n;
+
+	hist = kmalloc(sizeof(journal->j_history), GFP_KERNEL);
+	if (!hist)
+		return -ENOMEM;
+
+	spin_lock(&journal->j_history_lock);
+	memcpy(hist, journal->j_history, sizeof(journal->j_history));
+	cur = journal->j_history_cur;
+	spin_unlock(&journal->j_history_lock);
+
+	seq_printf(seq, "%-10s %10s %6s %8s %8s\n",
+		   "tid", "commit_us", "syncs", "handles", "blocks");
+	n = min_t(unsigned int, cur, JBD2_HISTORY_SIZE);
+	for (i = cur - n; i != cur; i++) {
+		struct jbd2_commit_record *r = &hist[i % JBD2_HISTORY_SIZE];
+
+		seq_printf(seq, "%-10u %10u %6u %8u %8u\n", r->cr_tid,
+			   r->cr_commit_us, r->cr_sync_count,
+			   r->cr_handle_count, r->cr_blocks);
+	}
+	kfree(hist);
+	return 0;
+}
+
+static int jbd2_seq_history_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, jbd2_seq_history_show, PDE(inode)->data);
+}
+
+static const struct file_operations jbd2_seq_history_fops = {
+	.owner		= THIS_MODULE,
+	.open           = jbd2_seq_history_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
 static struct proc_dir_entry *proc_jbd2_stats;
 
 static void jbd2_stats_proc_init(journal_t *journal)
@@ -861,11 +908,14 @@ static void jbd2_stats_proc_init(journal_t *journal)
 	if (journal->j_proc_entry) {
 		proc_create_data("info", S_IRUGO, journal->j_proc_entry,
 				 &jbd2_seq_info_fops, journal);
+		proc_create_data("history", S_IRUGO, journal->j_proc_entry,
+				 &jbd2_seq_history_fops, journal);
 	}
 }
 
 static void jbd2_stats_proc_exit(journal_t *journal)
 {
+	remove_proc_entry("history", journal->j_proc_entry);
 	remove_proc_entry("info", journal->j_proc_entry);
 	remove_proc_entry(journal->j_devname, proc_jbd2_stats);
 }
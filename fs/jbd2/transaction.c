@@ -59,6 +59,7 @@ jbd2_get_transaction(journal_t *journal, transaction_t *transaction)
 	atomic_set(&transaction->t_updates, 0);
 	atomic_set(&transaction->t_outstanding_credits, 0);
 	atomic_set(&transaction->t_handle_count, 0);
+	atomic_set(&transaction->t_sync_count, 0);
 	INIT_LIST_HEAD(&transaction->t_inode_list);
 	INIT_LIST_HEAD(&transaction->t_private_list);
 
@@ -1269,6 +1270,78 @@ drop:
 	return err;
 }
 
+/*
+ * How long a synchronous operation may wait for others to join its
+ * transaction: about as long as a commit takes, within the batch time
+ * limits of the journal.  Called with j_state_lock held.
+ */
+static u64 jbd2_batch_time(journal_t *journal)
+{
+	u64 commit_time = journal->j_average_commit_time;
+
+	commit_time = max_t(u64, commit_time,
+			    1000*journal->j_min_batch_time);
+	commit_time = min_t(u64, commit_time,
+			    1000*journal->j_max_batch_time);
+	return commit_time;
+}
+
+/**
+ * void jbd2_journal_batch_sync() - let other fsyncs join a commit
+ * @journal: journal to be committed
+ * @tid: transaction the caller is about to commit and wait for
+ *
+ * fsync commits the transaction holding the inode without going
+ * through a handle, so it misses the batching done for synchronous
+ * handles in jbd2_journal_stop().  Bursts of fsyncs from different
+ * processes then cost one commit, and one cache flush, each.
+ *
+ * If @tid is still running and nobody asked for its commit yet, sleep
+ * until it has been running for about as long as a commit takes, so
+ * that the fsyncs arriving meanwhile share a single commit.  A process
+ * doing a stream of fsyncs on its own is not delayed.
+ */
+void jbd2_journal_batch_sync(journal_t *journal, tid_t tid)
+{
+	transaction_t *transaction;
+	u64 commit_time, trans_time;
+	pid_t pid = current->pid;
+
+	read_lock(&journal->j_state_lock);
+	transaction = journal->j_running_transaction;
+	if (!transaction || transaction->t_tid != tid) {
+		transaction = journal->j_committing_transaction;
+		if (transaction && transaction->t_tid == tid)
+			atomic_inc(&transaction->t_sync_count);
+		read_unlock(&journal->j_state_lock);
+		return;
+	}
+	atomic_inc(&transaction->t_sync_count);
+
+	if (tid_geq(journal->j_commit_request, tid) ||
+	    journal->j_last_sync_writer == pid) {
+		read_unlock(&journal->j_state_lock);
+		return;
+	}
+	journal->j_last_sync_writer = pid;
+	commit_time = jbd2_batch_time(journal);
+	trans_time = ktime_to_ns(ktime_sub(ktime_get(),
+					   transaction->t_start_time));
+	read_unlock(&journal->j_state_lock);
+
+	if (trans_time < commit_time) {
+		ktime_t expires = ktime_add_ns(ktime_get(),
+					       commit_time - trans_time);
+
+		spin_lock(&journal->j_history_lock);
+		journal->j_stats.ts_batch_waits++;
+		spin_unlock(&journal->j_history_lock);
+
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		schedule_hrtimeout(&expires, HRTIMER_MODE_ABS);
+	}
+}
+
 /**
  * int jbd2_journal_stop() - complete a transaction
  * @handle: tranaction to complete.
@@ -1338,23 +1411,20 @@ int jbd2_journal_stop(handle_t *handle)
 	 * writes.  No point in waiting for joiners in that case.
 	 */
 	pid = current->pid;
+	if (handle->h_sync)
+		atomic_inc(&transaction->t_sync_count);
 	if (handle->h_sync && journal->j_last_sync_writer != pid) {
 		u64 commit_time, trans_time;
 
 		journal->j_last_sync_writer = pid;
 
 		read_lock(&journal->j_state_lock);
-		commit_time = journal->j_average_commit_time;
+		commit_time = jbd2_batch_time(journal);
 		read_unlock(&journal->j_state_lock);
 
 		trans_time = ktime_to_ns(ktime_sub(ktime_get(),
 						   transaction->t_start_time));
 
-		commit_time = max_t(u64, commit_time,
-				    1000*journal->j_min_batch_time);
-		commit_time = min_t(u64, commit_time,
-				    1000*journal->j_max_batch_time);
-
 		if (trans_time < commit_time) {
 			ktime_t expires = ktime_add_ns(ktime_get(),
 						       commit_time);
@@ -345,6 +345,29 @@ static const struct pipe_buf_operations anon_pipe_buf_ops = {
 	.get = generic_pipe_buf_get,
 };
 
+/*
+ * With a wake_lowat set on the pipe (F_SETPIPE_LOWAT), a writer leaves the
+ * readers asleep until that many bytes are queued, so a stream of small
+ * writes costs one reader wakeup per batch instead of one per write.  The
+ * readers are still woken whenever the pipe fills, since the writer is then
+ * about to block or fail with -EAGAIN.  Called with the pipe mutex held.
+ */
+static bool pipe_defer_reader_wakeup(struct pipe_inode_info *pipe)
+{
+	unsigned int i, bytes = 0;
+
+	if (!pipe->wake_lowat || pipe->nrbufs >= pipe->buffers)
+		return false;
+
+	for (i = 0; i < pipe->nrbufs; i++) {
+		bytes += pipe->bufs[(pipe->curbuf + i) & (pipe->buffers - 1)].len;
+		if (bytes >= pipe->wake_lowat)
+			return false;
+	}
+	pipe->r_deferred++;
+	return true;
+}
+
 static ssize_t
 pipe_read(struct kiocb *iocb, const struct iovec *_iov,
 	   unsigned long nr_segs, loff_t pos)
@@ -441,11 +464,14 @@ redo:
 			break;
 		}
 		if (do_wakeup) {
+			pipe->w_wakeups++;
 			wake_up_interruptible_sync_poll(&pipe->wait, POLLOUT | POLLWRNORM);
  			kill_fasync(&pipe->fasync_writers, SIGIO, POLL_OUT);
 		}
 		pipe_wait(pipe);
 	}
+	if (do_wakeup)
+		pipe->w_wakeups++;
 	mutex_unlock(&inode->i_mutex);
 
 	/* Signal writers asynchronously that there is more room. */
@@ -612,6 +638,7 @@ redo2:
 			break;
 		}
 		if (do_wakeup) {
+			pipe->r_wakeups++;
 			wake_up_interruptible_sync_poll(&pipe->wait, POLLIN | POLLRDNORM);
 			kill_fasync(&pipe->fasync_readers, SIGIO, POLL_IN);
 			do_wakeup = 0;
@@ -621,6 +648,12 @@ redo2:
 		pipe->waiting_writers--;
 	}
 out:
+	if (do_wakeup) {
+		if (pipe_defer_reader_wakeup(pipe))
+			do_wakeup = 0;
+		else
+			pipe->r_wakeups++;
+	}
 	mutex_unlock(&inode->i_mutex);
 	if (do_wakeup) {
 		wake_up_interruptible_sync_poll(&pipe->wait, POLLIN | POLLRDNORM);
@@ -1166,6 +1199,8 @@ static long pipe_set_size(struct pipe_inode_info *pipe, unsigned long nr_pages)
 	kfree(pipe->bufs);
 	pipe->bufs = bufs;
 	pipe->buffers = nr_pages;
+	pipe->wake_lowat = min_t(unsigned int, pipe->wake_lowat,
+				 nr_pages * PAGE_SIZE);
 	return nr_pages * PAGE_SIZE;
 }
 
@@ -1242,6 +1277,15 @@ long pipe_fcntl(struct file *file, unsigned int cmd, unsigned long arg)
 	case F_GETPIPE_SZ:
 		ret = pipe->buffers * PAGE_SIZE;
 		break;
+	case F_SETPIPE_LOWAT:
+		/* 0 restores waking the readers on every write */
+		pipe->wake_lowat = min_t(unsigned long, arg,
+					 pipe->buffers * PAGE_SIZE);
+		ret = pipe->wake_lowat;
+		break;
+	case F_GETPIPE_LOWAT:
+		ret = pipe->wake_lowat;
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -83,6 +83,7 @@
 #include <linux/pid_namespace.h>
 #include <linux/fs_struct.h>
 #include <linux/slab.h>
+#include <linux/pipe_fs_i.h>
 #ifdef CONFIG_HARDWALL
 #include <asm/hardwall.h>
 #endif
@@ -1140,6 +1141,9 @@ err_sighand:
 	unlock_task_sighand(task, &flags);
 err_task_lock:
 	task_unlock(task);
+	/* lowmemorykiller takes task_lock() under its bucket lock */
+	if (!err)
+		lowmem_adj_update(task);
 	put_task_struct(task);
 out:
 	return err < 0 ? err : count;
@@ -1268,6 +1272,9 @@ err_sighand:
 	unlock_task_sighand(task, &flags);
 err_task_lock:
 	task_unlock(task);
+	/* lowmemorykiller takes task_lock() under its bucket lock */
+	if (!err)
+		lowmem_adj_update(task);
 	put_task_struct(task);
 out:
 	return err < 0 ? err : count;
@@ -1929,7 +1936,7 @@ out:
 	return ~0U;
 }
 
-#define PROC_FDINFO_MAX 64
+#define PROC_FDINFO_MAX 160
 
 static int proc_fd_info(struct inode *inode, struct path *path, char *info)
 {
@@ -1962,12 +1969,26 @@ static int proc_fd_info(struct inode *inode, struct path *path, char *info)
 				*path = file->f_path;
 				path_get(&file->f_path);
 			}
-			if (info)
-				snprintf(info, PROC_FDINFO_MAX,
-					 "pos:\t%lli\n"
-					 "flags:\t0%o\n",
-					 (long long) file->f_pos,
-					 f_flags);
+			if (info) {
+				struct pipe_inode_info *pipe;
+				int len;
+
+				len = snprintf(info, PROC_FDINFO_MAX,
+					       "pos:\t%lli\n"
+					       "flags:\t0%o\n",
+					       (long long) file->f_pos,
+					       f_flags);
+				pipe = get_pipe_info(file);
+				if (pipe)
+					snprintf(info + len,
+						 PROC_FDINFO_MAX - len,
+						 "pipe_wakeups:\t%lu %lu %lu\n"
+						 "pipe_lowat:\t%u\n",
+						 pipe->r_wakeups,
+						 pipe->w_wakeups,
+						 pipe->r_deferred,
+						 pipe->wake_lowat);
+			}
 			spin_unlock(&files->file_lock);
 			put_files_struct(files);
 			return 0;
@@ -2772,14 +2793,28 @@ static int do_io_accounting(struct task_struct *task, char *buffer, int whole)
 			"syscw: %llu\n"
 			"read_bytes: %llu\n"
 			"write_bytes: %llu\n"
-			"cancelled_write_bytes: %llu\n",
+			"cancelled_write_bytes: %llu\n"
+			"pgcache_hits: %llu\n"
+			"pgcache_misses: %llu\n"
+			"pgcache_ra_hits: %llu\n"
+			"fsync_count: %llu\n"
+			"fsync_delay_ns: %llu\n"
+			"fs_gc_count: %llu\n"
+			"fs_gc_delay_ns: %llu\n",
 			(unsigned long long)acct.rchar,
 			(unsigned long long)acct.wchar,
 			(unsigned long long)acct.syscr,
 			(unsigned long long)acct.syscw,
 			(unsigned long long)acct.read_bytes,
 			(unsigned long long)acct.write_bytes,
-			(unsigned long long)acct.cancelled_write_bytes);
+			(unsigned long long)acct.cancelled_write_bytes,
+			(unsigned long long)acct.pgcache_hits,
+			(unsigned long long)acct.pgcache_misses,
+			(unsigned long long)acct.pgcache_ra_hits,
+			(unsigned long long)acct.fsync_count,
+			(unsigned long long)acct.fsync_delay_total,
+			(unsigned long long)acct.fs_gc_count,
+			(unsigned long long)acct.fs_gc_delay_total);
 out_unlock:
 	mutex_unlock(&task->signal->cred_guard_mutex);
 	return result;
@@ -2807,6 +2842,39 @@ static int proc_pid_personality(struct seq_file *m, struct pid_namespace *ns,
 	return err;
 }
 
+#ifdef CONFIG_KSM
+static int proc_pid_ksm_stat(struct seq_file *m, struct pid_namespace *ns,
+				struct pid *pid, struct task_struct *task)
+{
+	struct mm_struct *mm = get_task_mm(task);
+
+	if (mm) {
+		seq_printf(m, "merging_pages %lu\n", mm->ksm_merging_pages);
+		seq_printf(m, "scan_us %llu\n",
+			   div_u64(mm->ksm_scan_ns, NSEC_PER_USEC));
+		mmput(mm);
+	}
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_FUTEX
+static int proc_pid_futex_stat(struct seq_file *m, struct pid_namespace *ns,
+				struct pid *pid, struct task_struct *task)
+{
+	struct signal_struct *sig = task->signal;
+
+	seq_printf(m, "spin_acquired %ld\n",
+		   atomic_long_read(&sig->futex_spin_acquired));
+	seq_printf(m, "spin_failed %ld\n",
+		   atomic_long_read(&sig->futex_spin_failed));
+	seq_printf(m, "sleeps %ld\n", atomic_long_read(&sig->futex_sleeps));
+	seq_printf(m, "spin_us %llu\n",
+		   div_u64(atomic64_read(&sig->futex_spin_ns), NSEC_PER_USEC));
+	return 0;
+}
+#endif
+
 /*
  * Thread groups
  */
@@ -2855,6 +2923,15 @@ static const struct pid_entry tgid_base_stuff[] = {
 	REG("smaps",      S_IRUGO, proc_smaps_operations),
 	REG("pagemap",    S_IRUGO, proc_pagemap_operations),
 #endif
+#ifdef CONFIG_PROCESS_RECLAIM
+	REG("reclaim",    S_IWUSR, proc_reclaim_operations),
+#endif
+#ifdef CONFIG_KSM
+	ONE("ksm_stat",   S_IRUGO, proc_pid_ksm_stat),
+#endif
+#ifdef CONFIG_FUTEX
+	ONE("futex_stat", S_IRUGO, proc_pid_futex_stat),
+#endif
 #ifdef CONFIG_SECURITY
 	DIR("attr",       S_IRUGO|S_IXUGO, proc_attr_dir_inode_operations, proc_attr_dir_operations),
 #endif
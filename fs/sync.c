@@ -16,6 +16,8 @@
 #include <linux/quotaops.h>
 #include <linux/buffer_head.h>
 #include <linux/backing-dev.h>
+#include <linux/ktime.h>
+#include <linux/task_io_accounting_ops.h>
 #include "internal.h"
 
 #define VALID_FLAGS (SYNC_FILE_RANGE_WAIT_BEFORE|SYNC_FILE_RANGE_WRITE| \
@@ -165,9 +167,15 @@ SYSCALL_DEFINE1(syncfs, int, fd)
  */
 int vfs_fsync_range(struct file *file, loff_t start, loff_t end, int datasync)
 {
+	ktime_t start_time;
+	int ret;
+
 	if (!file->f_op || !file->f_op->fsync)
 		return -EINVAL;
-	return file->f_op->fsync(file, start, end, datasync);
+	start_time = ktime_get();
+	ret = file->f_op->fsync(file, start, end, datasync);
+	task_io_account_fsync(ktime_to_ns(ktime_sub(ktime_get(), start_time)));
+	return ret;
 }
 EXPORT_SYMBOL(vfs_fsync_range);
 
@@ -0,0 +1,56 @@
+#ifndef _LINUX_BOOT_REPORT_H
+#define _LINUX_BOOT_REPORT_H
+
+#include <linux/init.h>
+#include <linux/sched.h>
+
+/*
+ * Boot time report.  Every initcall and every driver probe up to the
+ * start of init is timed, and the list is kept in debugfs "boot_report",
+ * along with stages timed before the kernel ran, such as decompression.
+ */
+
+struct device;
+struct device_driver;
+
+#ifdef CONFIG_BOOT_REPORT
+
+extern void boot_report_initcall(initcall_t fn, int ret, u64 start);
+extern void boot_report_probe(struct device *dev, struct device_driver *drv,
+			      int ret, u64 start);
+extern void boot_report_stage(const char *name, u64 start, u64 end);
+extern void boot_report_init_started(void);
+
+static inline u64 boot_report_clock(void)
+{
+	return local_clock();
+}
+
+#else
+
+static inline void boot_report_initcall(initcall_t fn, int ret, u64 start)
+{
+}
+
+static inline void boot_report_probe(struct device *dev,
+				     struct device_driver *drv,
+				     int ret, u64 start)
+{
+}
+
+static inline void boot_report_stage(const char *name, u64 start, u64 end)
+{
+}
+
+static inline void boot_report_init_started(void)
+{
+}
+
+static inline u64 boot_report_clock(void)
+{
+	return 0;
+}
+
+#endif
+
+#endif /* _LINUX_BOOT_REPORT_H */
@@ -0,0 +1,49 @@
+#ifndef __LINUX_CMA_H
+#define __LINUX_CMA_H
+
+#include <linux/types.h>
+#include <linux/errno.h>
+
+/*
+ * Contiguous memory regions.  The owner reserves a region at boot, the
+ * page allocator lends it out for movable pages meanwhile, and the owner
+ * claims ranges back when it needs them, which migrates those pages out.
+ *
+ * A region must be aligned to MAX_ORDER pages, lie in a single zone, and
+ * have no cacheable kernel mapping that the device's own mapping could
+ * alias; on ARM that means highmem.
+ */
+
+#ifdef CONFIG_CMA
+
+extern int cma_declare_contiguous(phys_addr_t base, phys_addr_t size,
+				  const char *name);
+extern bool cma_region_contains(phys_addr_t base, size_t size);
+extern int cma_claim(phys_addr_t base, size_t size);
+extern void cma_release(phys_addr_t base, size_t size);
+
+#else
+
+static inline int cma_declare_contiguous(phys_addr_t base, phys_addr_t size,
+					 const char *name)
+{
+	return -ENOSYS;
+}
+
+static inline bool cma_region_contains(phys_addr_t base, size_t size)
+{
+	return false;
+}
+
+static inline int cma_claim(phys_addr_t base, size_t size)
+{
+	return -ENOSYS;
+}
+
+static inline void cma_release(phys_addr_t base, size_t size)
+{
+}
+
+#endif
+
+#endif /* __LINUX_CMA_H */
@@ -19,7 +19,11 @@ extern int sysctl_extfrag_threshold;
 extern int sysctl_extfrag_handler(struct ctl_table *table, int write,
 			void __user *buffer, size_t *length, loff_t *ppos);
 
+extern int sysctl_kcompactd_order;
+
 extern int fragmentation_index(struct zone *zone, unsigned int order);
+extern void wakeup_kcompactd(struct zone *zone, int order);
+extern bool kcompactd_running(struct zone *zone);
 extern unsigned long try_to_compact_pages(struct zonelist *zonelist,
 			int order, gfp_t gfp_mask, nodemask_t *mask,
 			bool sync);
@@ -67,6 +71,15 @@ static inline unsigned long compaction_suitable(struct zone *zone, int order)
 	return COMPACT_SKIPPED;
 }
 
+static inline void wakeup_kcompactd(struct zone *zone, int order)
+{
+}
+
+static inline bool kcompactd_running(struct zone *zone)
+{
+	return false;
+}
+
 static inline void defer_compaction(struct zone *zone)
 {
 }
@@ -411,5 +411,7 @@ void cpufreq_frequency_table_get_attr(struct cpufreq_frequency_table *table,
 
 void cpufreq_frequency_table_put_attr(unsigned int cpu);
 
+/* cpu-boost: the platform may start raising voltage for @khz early */
+void arch_cpu_boost_prepare(unsigned int khz);
 
 #endif /* _LINUX_CPUFREQ_H */
@@ -213,6 +213,7 @@ struct dentry_operations {
 #define DCACHE_NEED_AUTOMOUNT	0x20000	/* handle automount on this dir */
 #define DCACHE_MANAGE_TRANSIT	0x40000	/* manage transit from this dirent */
 #define DCACHE_NEED_LOOKUP	0x80000 /* dentry requires i_op->lookup */
+#define DCACHE_NEG_HOT		0x100000 /* negative, hit since the last shrink */
 #define DCACHE_MANAGED_DENTRY \
 	(DCACHE_MOUNTED|DCACHE_NEED_AUTOMOUNT|DCACHE_MANAGE_TRANSIT)
 
@@ -423,5 +424,6 @@ static inline bool d_need_lookup(struct dentry *dentry)
 extern void d_clear_need_lookup(struct dentry *dentry);
 
 extern int sysctl_vfs_cache_pressure;
+extern int sysctl_neg_dentry_reserve;
 
 #endif	/* __LINUX_DCACHE_H */
@@ -164,6 +164,9 @@ extern struct klist *bus_get_device_klist(struct bus_type *bus);
  * @owner:	The module owner.
  * @mod_name:	Used for built-in modules.
  * @suppress_bind_attrs: Disables bind/unbind via sysfs.
+ * @async_probe: Probe the devices present at registration from an async
+ *		thread during boot.  Only for drivers that nothing else
+ *		waits for, and whose probe needs nothing registered later.
  * @of_match_table: The open firmware table.
  * @probe:	Called to query the existence of a specific device,
  *		whether this driver can work with it, and bind the driver
@@ -196,6 +199,7 @@ struct device_driver {
 	const char		*mod_name;	/* used for built-in modules */
 
 	bool suppress_bind_attrs;	/* disables bind/unbind via sysfs */
+	bool async_probe;		/* probe at boot in an async thread */
 
 	const struct of_device_id	*of_match_table;
 
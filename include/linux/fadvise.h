@@ -18,4 +18,8 @@
 #define POSIX_FADV_NOREUSE	5 /* Data will be accessed once.  */
 #endif
 
+/* Linux specific: learn the access pattern of a file and prefetch it */
+#define POSIX_FADV_RA_RECORD	8 /* Log the pages accessed from now on.  */
+#define POSIX_FADV_RA_REPLAY	9 /* Prefetch the pages logged before.  */
+
 #endif	/* FADVISE_H_INCLUDED */
@@ -27,6 +27,13 @@
 #define F_SETPIPE_SZ	(F_LINUX_SPECIFIC_BASE + 7)
 #define F_GETPIPE_SZ	(F_LINUX_SPECIFIC_BASE + 8)
 
+/*
+ * Set and get the number of queued bytes below which writers do not wake
+ * a pipe's readers.
+ */
+#define F_SETPIPE_LOWAT	(F_LINUX_SPECIFIC_BASE + 20)
+#define F_GETPIPE_LOWAT	(F_LINUX_SPECIFIC_BASE + 21)
+
 /*
  * Types of directory notifications that may be requested.
  */
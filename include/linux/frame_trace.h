@@ -0,0 +1,113 @@
+/*
+ * include/linux/frame_trace.h
+ *
+ * Frame-scoped tracing across binder, nvhost, display and cpufreq.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef __LINUX_FRAME_TRACE_H
+#define __LINUX_FRAME_TRACE_H
+
+#include <linux/types.h>
+
+/*
+ * Every flip queued to the display opens a new frame.  Events are tagged
+ * with the frame being built when they fire, i.e. the one the next flip
+ * will close, so binder calls, gpu submits and frequency decisions that
+ * went into a frame share its id.  Gpu work is further keyed by syncpoint
+ * id and threshold, which its completion and the flip that waits on it
+ * report as well.
+ */
+#ifdef CONFIG_TEGRA_FRAME_TRACE
+#include <linux/atomic.h>
+#include <trace/events/frame_trace.h>
+
+extern atomic_t frame_trace_seq;
+
+static inline u32 frame_trace_current(void)
+{
+	return atomic_read(&frame_trace_seq) + 1;
+}
+
+/* Returns the id of the frame closed by the flip being queued */
+static inline u32 frame_trace_flip_queued(void)
+{
+	return atomic_inc_return(&frame_trace_seq);
+}
+
+static inline void frame_trace_binder(int debug_id, int from_pid,
+		int to_pid, unsigned int code, int reply)
+{
+	trace_frame_binder_txn(frame_trace_current(), debug_id, from_pid,
+			       to_pid, code, reply);
+}
+
+static inline void frame_trace_gpu_submit(const char *name, u32 syncpt_id,
+		u32 thresh)
+{
+	trace_frame_gpu_submit(frame_trace_current(), name, syncpt_id, thresh);
+}
+
+static inline void frame_trace_syncpt_done(u32 syncpt_id, u32 value)
+{
+	trace_frame_syncpt_done(frame_trace_current(), syncpt_id, value);
+}
+
+static inline void frame_trace_flip(u32 frame, int dc, u32 syncpt_id,
+		u32 thresh)
+{
+	trace_frame_flip(frame, dc, syncpt_id, thresh);
+}
+
+static inline void frame_trace_scanout(u32 frame, int dc, u32 syncpt_id,
+		u32 thresh)
+{
+	trace_frame_scanout(frame, dc, syncpt_id, thresh);
+}
+
+static inline void frame_trace_cpufreq(unsigned int old_khz,
+		unsigned int new_khz)
+{
+	trace_frame_cpufreq(frame_trace_current(), old_khz, new_khz);
+}
+
+static inline void frame_trace_hotplug(unsigned int cpu, bool up)
+{
+	trace_frame_hotplug(frame_trace_current(), cpu, up);
+}
+#else
+static inline u32 frame_trace_current(void)
+{ return 0; }
+static inline u32 frame_trace_flip_queued(void)
+{ return 0; }
+static inline void frame_trace_binder(int debug_id, int from_pid,
+		int to_pid, unsigned int code, int reply)
+{ }
+static inline void frame_trace_gpu_submit(const char *name, u32 syncpt_id,
+		u32 thresh)
+{ }
+static inline void frame_trace_syncpt_done(u32 syncpt_id, u32 value)
+{ }
+static inline void frame_trace_flip(u32 frame, int dc, u32 syncpt_id,
+		u32 thresh)
+{ }
+static inline void frame_trace_scanout(u32 frame, int dc, u32 syncpt_id,
+		u32 thresh)
+{ }
+static inline void frame_trace_cpufreq(unsigned int old_khz,
+		unsigned int new_khz)
+{ }
+static inline void frame_trace_hotplug(unsigned int cpu, bool up)
+{ }
+#endif
+
+#endif
@@ -68,6 +68,9 @@ struct irq_desc {
 #endif
 	struct module		*owner;
 	const char		*name;
+#ifdef CONFIG_IRQ_TIME_STATS
+	unsigned long		time_ns;	/* in the handler, wraps */
+#endif
 } ____cacheline_internodealigned_in_smp;
 
 #ifndef CONFIG_SPARSE_IRQ
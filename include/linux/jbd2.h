@@ -654,6 +654,12 @@ struct transaction_s
 	 */
 	atomic_t		t_handle_count;
 
+	/*
+	 * How many fsyncs and synchronous handles wait for this transaction
+	 * to commit, i.e. the size of its sync batch [no locking]
+	 */
+	atomic_t		t_sync_count;
+
 	/*
 	 * This transaction is being forced and some process is
 	 * waiting for it to finish.
@@ -680,13 +686,26 @@ struct transaction_run_stats_s {
 	__u32			rs_handle_count;
 	__u32			rs_blocks;
 	__u32			rs_blocks_logged;
+	__u32			rs_sync_count;
 };
 
 struct transaction_stats_s {
 	unsigned long		ts_tid;
+	unsigned long		ts_batch_waits;
 	struct transaction_run_stats_s run;
 };
 
+/* One committed transaction, as shown in /proc/fs/jbd2/<dev>/history */
+struct jbd2_commit_record {
+	tid_t			cr_tid;
+	u32			cr_commit_us;	/* start of commit to done */
+	__u32			cr_sync_count;	/* fsyncs and sync handles */
+	__u32			cr_handle_count;
+	__u32			cr_blocks;
+};
+
+#define JBD2_HISTORY_SIZE	32
+
 static inline unsigned long
 jbd2_time_diff(unsigned long start, unsigned long end)
 {
@@ -993,6 +1012,8 @@ struct journal_s
 	spinlock_t		j_history_lock;
 	struct proc_dir_entry	*j_proc_entry;
 	struct transaction_stats_s j_stats;
+	struct jbd2_commit_record j_history[JBD2_HISTORY_SIZE];
+	unsigned int		j_history_cur;
 
 	/* Failed journal commit ID */
 	unsigned int		j_failed_commit;
@@ -1226,6 +1247,7 @@ int __jbd2_log_space_left(journal_t *); /* Called with journal locked */
 int jbd2_log_start_commit(journal_t *journal, tid_t tid);
 int __jbd2_log_start_commit(journal_t *journal, tid_t tid);
 int jbd2_journal_start_commit(journal_t *journal, tid_t *tid);
+void jbd2_journal_batch_sync(journal_t *journal, tid_t tid);
 int jbd2_journal_force_commit_nested(journal_t *journal);
 int jbd2_log_wait_commit(journal_t *journal, tid_t tid);
 int jbd2_log_do_checkpoint(journal_t *journal);
@@ -0,0 +1,40 @@
+#ifndef __LINUX_LOCK_PROFILE_H
+#define __LINUX_LOCK_PROFILE_H
+
+/*
+ * Sampled lock contention profiling, see kernel/lock_profile.c.
+ *
+ * Only the contended slowpaths call in here: lock_profile_start() when
+ * a lock is first found taken, which returns 0 unless this contention
+ * is sampled, and lock_profile_contended() once the lock is held.
+ */
+
+#include <linux/types.h>
+
+enum lock_profile_type {
+	LOCK_PROFILE_SPIN,
+	LOCK_PROFILE_READ,		/* rwlock_t */
+	LOCK_PROFILE_WRITE,
+	LOCK_PROFILE_MUTEX,
+	LOCK_PROFILE_RWSEM_READ,
+	LOCK_PROFILE_RWSEM_WRITE,
+	LOCK_PROFILE_NR_TYPES,
+};
+
+#ifdef CONFIG_LOCK_PROFILE
+u64 lock_profile_start(void);
+void lock_profile_contended(void *lock, enum lock_profile_type type,
+			    unsigned long ip, u64 start);
+#else
+static inline u64 lock_profile_start(void)
+{
+	return 0;
+}
+
+static inline void lock_profile_contended(void *lock,
+	enum lock_profile_type type, unsigned long ip, u64 start)
+{
+}
+#endif
+
+#endif /* __LINUX_LOCK_PROFILE_H */
@@ -152,6 +152,14 @@ unsigned long mem_cgroup_soft_limit_reclaim(struct zone *zone, int order,
 						unsigned long *total_scanned);
 u64 mem_cgroup_get_limit(struct mem_cgroup *mem);
 
+void mem_cgroup_vmpressure(struct mem_cgroup *mem, unsigned long scanned,
+			   unsigned long reclaimed);
+struct mem_cgroup *mem_cgroup_lmk_victim(void);
+void mem_cgroup_lmk_scan_tasks(struct mem_cgroup *mem,
+			       void (*fn)(struct task_struct *, void *),
+			       void *data);
+void mem_cgroup_lmk_put(struct mem_cgroup *mem);
+
 void mem_cgroup_count_vm_event(struct mm_struct *mm, enum vm_event_item idx);
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 void mem_cgroup_split_huge_fixup(struct page *head, struct page *tail);
@@ -355,6 +363,26 @@ u64 mem_cgroup_get_limit(struct mem_cgroup *mem)
 	return 0;
 }
 
+static inline void mem_cgroup_vmpressure(struct mem_cgroup *mem,
+					 unsigned long scanned,
+					 unsigned long reclaimed)
+{
+}
+
+static inline struct mem_cgroup *mem_cgroup_lmk_victim(void)
+{
+	return NULL;
+}
+
+static inline void mem_cgroup_lmk_scan_tasks(struct mem_cgroup *mem,
+			void (*fn)(struct task_struct *, void *), void *data)
+{
+}
+
+static inline void mem_cgroup_lmk_put(struct mem_cgroup *mem)
+{
+}
+
 static inline void mem_cgroup_split_huge_fixup(struct page *head,
 						struct page *tail)
 {
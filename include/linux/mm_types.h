@@ -365,6 +365,11 @@ struct mm_struct {
 #ifdef CONFIG_ZRAM_FOR_ANDROID
 	int mm_swap_done;
 #endif /* CONFIG_ZRAM_FOR_ANDROID */
+#ifdef CONFIG_KSM
+	/* under ksm_thread_mutex, shown in /proc/<pid>/ksm_stat */
+	unsigned long ksm_merging_pages;	/* mapped from the stable tree */
+	u64 ksm_scan_ns;			/* ksmd time spent on this mm */
+#endif
 };
 
 static inline void mm_init_cpumask(struct mm_struct *mm)
@@ -12,6 +12,10 @@
 
 #include <linux/mmc/core.h>
 #include <linux/mod_devicetable.h>
+#include <linux/workqueue.h>
+#ifdef CONFIG_HAS_EARLYSUSPEND
+#include <linux/earlysuspend.h>
+#endif
 
 struct mmc_cid {
 	unsigned int		manfid;
@@ -84,12 +88,34 @@ struct mmc_ext_csd {
 	u8			out_of_int_time;	/* out of int time */
 	bool			bk_ops;			/* BK ops support bit */
 	bool			bk_ops_en;		/* BK ops enable bit */
+	bool			packed_event_en;	/* Packed event enable bit */
+	u8			max_packed_writes;	/* 500 */
+	u8			max_packed_reads;	/* 501 */
+	unsigned int		cache_size;		/* Units: KB */
+	bool			cache_ctrl;		/* Cache enabled */
 	unsigned int		sec_count;
 
 	unsigned int		feature_support;
 #define MMC_DISCARD_FEATURE	BIT(0)
 };
 
+/*
+ * Background operations scheduling state.  BKOPS are started from the
+ * core while the card is otherwise idle, and interrupted with HPI when
+ * the next request comes in.
+ */
+struct mmc_bkops_info {
+	struct delayed_work	dwork;		/* deferred start */
+	bool			screen_off;	/* start on any outstanding level */
+	unsigned int		nr_urgent;	/* started on the card's request */
+	unsigned int		nr_idle;	/* started after the queue idled */
+	unsigned int		nr_screen_off;	/* started at early suspend */
+	unsigned int		nr_hpi;		/* interrupted by a new request */
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	struct early_suspend	early_suspend;
+#endif
+};
+
 struct sd_scr {
 	unsigned char		sda_vsn;
 	unsigned char		sda_spec3;
@@ -187,9 +213,9 @@ struct mmc_card {
 #define MMC_STATE_BLOCKADDR	(1<<3)		/* card uses block-addressing */
 #define MMC_STATE_HIGHSPEED_DDR (1<<4)		/* card is in high speed mode */
 #define MMC_STATE_ULTRAHIGHSPEED (1<<5)		/* card is in ultra high speed mode */
-#define MMC_STATE_DOING_BKOPS	(1<<6)		/* Card doing bkops */
-#define MMC_STATE_NEED_BKOPS	(1<<7)		/* Card needs to do bkops */
 #define MMC_CARD_SDXC		(1<<6)		/* card is SDXC */
+#define MMC_STATE_DOING_BKOPS	(1<<8)		/* Card doing bkops */
+#define MMC_STATE_NEED_BKOPS	(1<<9)		/* Card needs to do bkops */
 	unsigned int		quirks; 	/* card quirks */
 #define MMC_QUIRK_LENIENT_FN0	(1<<0)		/* allow SDIO FN0 writes outside of the VS CCCR range */
 #define MMC_QUIRK_BLKSZ_FOR_BYTE_MODE (1<<1)	/* use func->cur_blksize */
@@ -228,6 +254,8 @@ struct mmc_card {
 
 	unsigned int		sd_bus_speed;	/* Bus Speed Mode set for the card */
 
+	struct mmc_bkops_info	bkops;		/* eMMC background operations */
+
 	struct dentry		*debugfs_root;
 };
 
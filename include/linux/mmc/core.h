@@ -137,7 +137,11 @@ struct mmc_async_req;
 extern struct mmc_async_req *mmc_start_req(struct mmc_host *,
 					   struct mmc_async_req *, int *);
 extern int mmc_interrupt_hpi(struct mmc_card *);
+extern int mmc_stop_bkops(struct mmc_card *);
 extern int mmc_bkops_start(struct mmc_card *card, bool is_synchronous);
+extern int mmc_send_ext_csd(struct mmc_card *card, u8 *ext_csd);
+extern void mmc_schedule_bkops(struct mmc_card *card);
+extern void mmc_cancel_bkops(struct mmc_card *card);
 
 extern void mmc_wait_for_req(struct mmc_host *, struct mmc_request *);
 extern int mmc_wait_for_cmd(struct mmc_host *, struct mmc_command *, int);
@@ -167,6 +171,8 @@ extern int mmc_erase_group_aligned(struct mmc_card *card, unsigned int from,
 extern unsigned int mmc_calc_max_discard(struct mmc_card *card);
 
 extern int mmc_set_blocklen(struct mmc_card *card, unsigned int blocklen);
+extern int mmc_flush_cache(struct mmc_card *card);
+extern int mmc_cache_ctrl(struct mmc_host *host, u8 enable);
 
 extern void mmc_set_data_timeout(struct mmc_data *, const struct mmc_card *);
 extern unsigned int mmc_align_data_size(struct mmc_card *, unsigned int);
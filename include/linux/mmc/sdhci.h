@@ -15,8 +15,19 @@
 #include <linux/compiler.h>
 #include <linux/types.h>
 #include <linux/io.h>
+#include <linux/workqueue.h>
 #include <linux/mmc/host.h>
 
+struct sdhci_adma_table {
+	u8 *desc;		/* ADMA descriptor table */
+	u8 *align_buffer;	/* Bounce buffer */
+
+	dma_addr_t desc_addr;	/* Mapped ADMA descr. table */
+	dma_addr_t align_addr;	/* Mapped bounce buffer */
+
+	int sg_count;		/* Mapped sg entries */
+};
+
 struct sdhci_host {
 	/* Data set by hardware interface driver */
 	const char *hw_name;	/* Hardware bus name */
@@ -139,16 +150,19 @@ struct sdhci_host {
 	struct sg_mapping_iter sg_miter;	/* SG state for PIO */
 	unsigned int blocks;	/* remaining PIO blocks */
 
-	int sg_count;		/* Mapped sg entries */
-
-	u8 *adma_desc;		/* ADMA descriptor table */
-	u8 *align_buffer;	/* Bounce buffer */
-
-	dma_addr_t adma_addr;	/* Mapped ADMA descr. table */
-	dma_addr_t align_addr;	/* Mapped bounce buffer */
+	/*
+	 * Table 0 serves requests that were not handed to pre_req, the
+	 * others are built ahead of time by pre_req while the previous
+	 * request is still on the bus.
+	 */
+#define SDHCI_ADMA_TABLES	3
+	struct sdhci_adma_table adma[SDHCI_ADMA_TABLES];
+	struct sdhci_adma_table *adma_cur;	/* Table of current request */
+	unsigned long adma_busy;	/* Tables owned by pre_req */
 
 	struct tasklet_struct card_tasklet;	/* Tasklet structures */
 	struct tasklet_struct finish_tasklet;
+	struct work_struct finish_work;	/* finish_tasklet on finish_cpu */
 
 	struct timer_list timer;	/* Timer for timeouts */
 	unsigned int card_int_set;	/* card int status */
@@ -1729,6 +1729,19 @@ static inline int unregister_gifconf(unsigned int family)
 /*
  * Incoming packets are placed on per-cpu queues
  */
+#ifdef CONFIG_NET_FLOW_LIMIT
+#define FLOW_LIMIT_HISTORY	(1 << 7)  /* must be ^2 and !overflow buckets */
+struct sd_flow_limit {
+	u64			count;
+	unsigned int		num_buckets;
+	unsigned int		history_head;
+	u16			history[FLOW_LIMIT_HISTORY];
+	u8			buckets[];
+};
+
+extern int netdev_flow_limit_table_len;
+#endif /* CONFIG_NET_FLOW_LIMIT */
+
 struct softnet_data {
 	struct Qdisc		*output_queue;
 	struct Qdisc		**output_queue_tailp;
@@ -1751,6 +1764,9 @@ struct softnet_data {
 	unsigned int		cpu;
 	unsigned int		input_queue_head;
 	unsigned int		input_queue_tail;
+#endif
+#ifdef CONFIG_NET_FLOW_LIMIT
+	struct sd_flow_limit __rcu *flow_limit;
 #endif
 	unsigned		dropped;
 	struct sk_buff_head	input_pkt_queue;
@@ -2017,12 +2033,21 @@ extern int netif_set_real_num_tx_queues(struct net_device *dev,
 #ifdef CONFIG_RPS
 extern int netif_set_real_num_rx_queues(struct net_device *dev,
 					unsigned int rxq);
+extern int netif_set_rps_cpus(struct net_device *dev,
+			      const struct cpumask *mask,
+			      unsigned int flow_cnt);
 #else
 static inline int netif_set_real_num_rx_queues(struct net_device *dev,
 						unsigned int rxq)
 {
 	return 0;
 }
+static inline int netif_set_rps_cpus(struct net_device *dev,
+				     const struct cpumask *mask,
+				     unsigned int flow_cnt)
+{
+	return 0;
+}
 #endif
 
 static inline int netif_copy_real_num_queues(struct net_device *to_dev,
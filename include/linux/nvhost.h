@@ -25,6 +25,7 @@
 
 #include <linux/device.h>
 #include <linux/types.h>
+#include <linux/ktime.h>
 
 struct nvhost_master;
 
@@ -93,6 +94,8 @@ struct nvhost_device {
 	void (*busy)(struct nvhost_device *);
 	/* Device is idle. */
 	void (*idle)(struct nvhost_device *);
+	/* A job submitted at the given time has completed. */
+	void (*job_done)(struct nvhost_device *, ktime_t submitted);
 	/* Device is going to be suspended */
 	void (*suspend)(struct nvhost_device *);
 	/* Device is initialized */
@@ -0,0 +1,63 @@
+/*
+ * include/linux/nvhost_gr2d.h
+ *
+ * Tegra Graphics 2D in-kernel fill/copy service
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ */
+
+#ifndef __LINUX_NVHOST_GR2D_H
+#define __LINUX_NVHOST_GR2D_H
+
+#include <linux/types.h>
+#include <linux/errno.h>
+
+/*
+ * Surfaces are physically contiguous, linear (pitch) memory addressed by
+ * their physical base.  bpp is 8, 16 or 32.  The fill and copy calls
+ * return a fence that nvhost_gr2d_wait() blocks on; all calls sleep and
+ * return -EWOULDBLOCK when invoked from atomic context, in which case
+ * the caller is expected to fall back to the CPU.
+ */
+#ifdef CONFIG_TEGRA_GR2D_KERNEL
+/* Minimum surface size in bytes worth handing to the engine */
+extern unsigned int nvhost_gr2d_threshold;
+
+int nvhost_gr2d_fill(phys_addr_t base, u32 pitch, u32 bpp,
+		u32 x, u32 y, u32 w, u32 h, u32 color, u32 *fence);
+int nvhost_gr2d_copy(phys_addr_t base, u32 pitch, u32 bpp,
+		u32 sx, u32 sy, u32 dx, u32 dy, u32 w, u32 h, u32 *fence);
+int nvhost_gr2d_wait(u32 fence, u32 timeout_ms);
+/* Zero size bytes at base and wait for completion */
+int nvhost_gr2d_clear(phys_addr_t base, size_t size);
+#else
+#define nvhost_gr2d_threshold	(~0U)
+
+static inline int nvhost_gr2d_fill(phys_addr_t base, u32 pitch, u32 bpp,
+		u32 x, u32 y, u32 w, u32 h, u32 color, u32 *fence)
+{
+	return -ENODEV;
+}
+static inline int nvhost_gr2d_copy(phys_addr_t base, u32 pitch, u32 bpp,
+		u32 sx, u32 sy, u32 dx, u32 dy, u32 w, u32 h, u32 *fence)
+{
+	return -ENODEV;
+}
+static inline int nvhost_gr2d_wait(u32 fence, u32 timeout_ms)
+{
+	return -ENODEV;
+}
+static inline int nvhost_gr2d_clear(phys_addr_t base, size_t size)
+{
+	return -ENODEV;
+}
+#endif
+
+#endif
@@ -112,6 +112,29 @@ struct nvhost_set_priority_args {
 	__u32 priority;
 };
 
+/*
+ * One job of a SUBMIT_MULTI call. The arrays are what would otherwise be
+ * written to the channel after the header, with reloc_shifts only read
+ * for version 2 headers.
+ */
+struct nvhost_submit_multi_job {
+	struct nvhost_submit_hdr_ext hdr;
+	__u64 cmdbufs;		/* struct nvhost_cmdbuf[hdr.num_cmdbufs] */
+	__u64 relocs;		/* struct nvhost_reloc[hdr.num_relocs] */
+	__u64 reloc_shifts;	/* struct nvhost_reloc_shift[hdr.num_relocs] */
+	__u64 waitchks;		/* struct nvhost_waitchk[hdr.num_waitchks] */
+	__u32 syncpt_end;	/* out, fence of this job */
+	__u32 pad;
+};
+
+#define NVHOST_SUBMIT_MULTI_MAX_JOBS	16
+
+struct nvhost_submit_multi_args {
+	__u64 jobs;		/* struct nvhost_submit_multi_job[num_jobs] */
+	__u32 num_jobs;
+	__u32 num_submitted;	/* out, jobs from the start of the array */
+};
+
 #define NVHOST_IOCTL_CHANNEL_FLUSH		\
 	_IOR(NVHOST_IOCTL_MAGIC, 1, struct nvhost_get_param_args)
 #define NVHOST_IOCTL_CHANNEL_GET_SYNCPOINTS	\
@@ -138,8 +161,10 @@ struct nvhost_set_priority_args {
 	_IOR(NVHOST_IOCTL_MAGIC, 12, struct nvhost_get_param_args)
 #define NVHOST_IOCTL_CHANNEL_SET_PRIORITY	\
 	_IOW(NVHOST_IOCTL_MAGIC, 13, struct nvhost_set_priority_args)
+#define NVHOST_IOCTL_CHANNEL_SUBMIT_MULTI	\
+	_IOWR(NVHOST_IOCTL_MAGIC, 14, struct nvhost_submit_multi_args)
 #define NVHOST_IOCTL_CHANNEL_LAST		\
-	_IOC_NR(NVHOST_IOCTL_CHANNEL_SET_PRIORITY)
+	_IOC_NR(NVHOST_IOCTL_CHANNEL_SUBMIT_MULTI)
 #define NVHOST_IOCTL_CHANNEL_MAX_ARG_SIZE sizeof(struct nvhost_submit_hdr_ext)
 
 struct nvhost_ctrl_syncpt_read_args {
@@ -164,6 +189,23 @@ struct nvhost_ctrl_syncpt_waitex_args {
 	__u32 value;
 };
 
+/*
+ * a fence is a file descriptor which polls readable once its sync points
+ * have reached their thresholds. it can be passed to other drivers, such
+ * as the display flip, and closed at any time.
+ */
+struct nvhost_ctrl_fence_create_args {
+	__u32 id;
+	__u32 thresh;
+	__s32 fence_fd;		/* out */
+};
+
+struct nvhost_ctrl_fence_merge_args {
+	__s32 fd1;
+	__s32 fd2;
+	__s32 fence_fd;		/* out, signals once both fd1 and fd2 have */
+};
+
 struct nvhost_ctrl_module_mutex_args {
 	__u32 id;
 	__u32 lock;
@@ -205,8 +247,13 @@ struct nvhost_ctrl_module_regrdwr_args {
 #define NVHOST_IOCTL_CTRL_GET_VERSION	\
 	_IOR(NVHOST_IOCTL_MAGIC, 7, struct nvhost_get_param_args)
 
+#define NVHOST_IOCTL_CTRL_FENCE_CREATE		\
+	_IOWR(NVHOST_IOCTL_MAGIC, 8, struct nvhost_ctrl_fence_create_args)
+#define NVHOST_IOCTL_CTRL_FENCE_MERGE		\
+	_IOWR(NVHOST_IOCTL_MAGIC, 9, struct nvhost_ctrl_fence_merge_args)
+
 #define NVHOST_IOCTL_CTRL_LAST			\
-	_IOC_NR(NVHOST_IOCTL_CTRL_GET_VERSION)
+	_IOC_NR(NVHOST_IOCTL_CTRL_FENCE_MERGE)
 #define NVHOST_IOCTL_CTRL_MAX_ARG_SIZE	\
 	sizeof(struct nvhost_ctrl_module_regrdwr_args)
 
@@ -42,6 +42,26 @@ enum oom_constraint {
 
 extern int test_set_oom_score_adj(int new_val);
 
+/*
+ * The low memory killer keeps thread group leaders bucketed by oom_adj,
+ * so it does not have to walk the tasklist to find its victims.
+ */
+#ifdef CONFIG_ANDROID_LMK_ADJ_BUCKETS
+extern void lowmem_adj_update(struct task_struct *task);
+extern void lowmem_adj_remove(struct task_struct *task);
+#else
+static inline void lowmem_adj_update(struct task_struct *task) {}
+static inline void lowmem_adj_remove(struct task_struct *task) {}
+#endif
+
+#ifdef CONFIG_ANDROID_LMK_PRESSURE
+extern void lowmem_vmpressure(gfp_t gfp_mask, unsigned long scanned,
+			      unsigned long reclaimed);
+#else
+static inline void lowmem_vmpressure(gfp_t gfp_mask, unsigned long scanned,
+				     unsigned long reclaimed) {}
+#endif
+
 extern unsigned int oom_badness(struct task_struct *p, struct mem_cgroup *mem,
 			const nodemask_t *nodemask, unsigned long totalpages);
 extern int try_set_zonelist_oom(struct zonelist *zonelist, gfp_t gfp_flags);
@@ -24,6 +24,7 @@ enum mapping_flags {
 	AS_ENOSPC	= __GFP_BITS_SHIFT + 1,	/* ENOSPC on async write */
 	AS_MM_ALL_LOCKS	= __GFP_BITS_SHIFT + 2,	/* under mm_take_all_locks() */
 	AS_UNEVICTABLE	= __GFP_BITS_SHIFT + 3,	/* e.g., ramdisk, SHM_LOCK */
+	AS_RA_RECORD	= __GFP_BITS_SHIFT + 4,	/* accesses are being logged */
 };
 
 static inline void mapping_set_error(struct address_space *mapping, int error)
@@ -53,6 +54,54 @@ static inline int mapping_unevictable(struct address_space *mapping)
 	return !!mapping;
 }
 
+#ifdef CONFIG_READAHEAD_RECORD
+extern void __readahead_record(struct address_space *mapping, pgoff_t index);
+extern int readahead_record_start(struct file *file);
+extern int readahead_record_replay(struct file *file);
+
+/*
+ * Log a page fault or read of @index, if the file is being recorded for
+ * later replay.
+ */
+static inline void readahead_record(struct address_space *mapping,
+				    pgoff_t index)
+{
+	if (unlikely(test_bit(AS_RA_RECORD, &mapping->flags)))
+		__readahead_record(mapping, index);
+}
+#else
+static inline void readahead_record(struct address_space *mapping,
+				    pgoff_t index)
+{
+}
+
+static inline int readahead_record_start(struct file *file)
+{
+	return -EINVAL;
+}
+
+static inline int readahead_record_replay(struct file *file)
+{
+	return -EINVAL;
+}
+#endif
+
+#ifdef CONFIG_BOOT_PREFETCH
+extern int boot_prefetch_tracing;
+extern void __boot_prefetch_trace(struct file *file, pgoff_t index);
+
+/* Log a page cache miss for the next boot to prefetch */
+static inline void boot_prefetch_trace(struct file *file, pgoff_t index)
+{
+	if (unlikely(boot_prefetch_tracing))
+		__boot_prefetch_trace(file, index);
+}
+#else
+static inline void boot_prefetch_trace(struct file *file, pgoff_t index)
+{
+}
+#endif
+
 static inline gfp_t mapping_gfp_mask(struct address_space * mapping)
 {
 	return (__force gfp_t)mapping->flags & __GFP_BITS_MASK;
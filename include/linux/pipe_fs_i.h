@@ -42,6 +42,10 @@ struct pipe_buffer {
  *	@fasync_writers: writer side fasync
  *	@inode: inode this pipe is attached to
  *	@bufs: the circular array of pipe buffers
+ *	@wake_lowat: queued bytes before writers wake readers, 0 for always
+ *	@r_wakeups: reader wakeups issued by writers
+ *	@w_wakeups: writer wakeups issued by readers
+ *	@r_deferred: reader wakeups held back by @wake_lowat
  **/
 struct pipe_inode_info {
 	wait_queue_head_t wait;
@@ -56,6 +60,10 @@ struct pipe_inode_info {
 	struct fasync_struct *fasync_writers;
 	struct inode *inode;
 	struct pipe_buffer *bufs;
+	unsigned int wake_lowat;
+	unsigned long r_wakeups;
+	unsigned long w_wakeups;
+	unsigned long r_deferred;
 };
 
 /*
@@ -159,7 +167,7 @@ int generic_pipe_buf_confirm(struct pipe_inode_info *, struct pipe_buffer *);
 int generic_pipe_buf_steal(struct pipe_inode_info *, struct pipe_buffer *);
 void generic_pipe_buf_release(struct pipe_inode_info *, struct pipe_buffer *);
 
-/* for F_SETPIPE_SZ and F_GETPIPE_SZ */
+/* for F_SETPIPE_SZ, F_GETPIPE_SZ, F_SETPIPE_LOWAT and F_GETPIPE_LOWAT */
 long pipe_fcntl(struct file *, unsigned int, unsigned long arg);
 struct pipe_inode_info *get_pipe_info(struct file *file);
 
@@ -29,6 +29,7 @@
 #include <linux/wait.h>
 #include <linux/list.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/earlysuspend.h>
@@ -325,6 +326,9 @@ struct rmi_function_device {
  * @fh: The callbacks connected to this function
  * @num_of_irqs: The number of irqs needed by this function
  * @irq_pos: The position in the irq bitfield this function holds
+ * @irq_data_size: Size of the data registers the function reads on each
+ * interrupt, if it wants them read along with the interrupt status
+ * @irq_data: Those registers as read with the interrupt status, or NULL
  * @data: Private data pointer
  *
  */
@@ -340,6 +344,9 @@ struct rmi_function_container {
 	int irq_pos;
 	u8 *irq_mask;
 
+	int irq_data_size;
+	u8 *irq_data;
+
 	void *data;
 };
 #define to_rmi_function_container(d) \
@@ -444,6 +451,7 @@ struct rmi_phys_info {
  * @read: Callback for read
  * @read_block: Callback for reading a block of data
  * @data: Private data pointer
+ * @attn_time: When the last attention interrupt came in
  *
  * The RMI physical device implements the glue between different communication
  * buses such as I2C and SPI.
@@ -466,6 +474,7 @@ struct rmi_phys_device {
 	void *data;
 
 	struct rmi_phys_info info;
+	ktime_t attn_time;
 
 #ifdef CONFIG_RMI4_DEV
 	/* pointer to attention char device and char device */
@@ -137,6 +137,7 @@ extern int nr_threads;
 DECLARE_PER_CPU(unsigned long, process_counts);
 extern int nr_processes(void);
 extern unsigned long nr_running(void);
+extern unsigned long sched_cpu_util(int cpu);
 extern unsigned long nr_uninterruptible(void);
 extern unsigned long nr_iowait(void);
 extern unsigned long nr_iowait_cpu(int cpu);
@@ -630,6 +631,13 @@ struct signal_struct {
 #ifdef CONFIG_TASKSTATS
 	struct taskstats *stats;
 #endif
+#ifdef CONFIG_FUTEX
+	/* futex contention, shown in /proc/<pid>/futex_stat */
+	atomic_long_t futex_spin_acquired;	/* adaptive spin saw a release */
+	atomic_long_t futex_spin_failed;	/* adaptive spin gave up */
+	atomic_long_t futex_sleeps;		/* FUTEX_WAIT* went to sleep */
+	atomic64_t futex_spin_ns;
+#endif
 #ifdef CONFIG_AUDIT
 	unsigned audit_tty;
 	struct tty_audit_buf *tty_audit_buf;
@@ -719,6 +727,10 @@ struct user_struct {
 #ifdef CONFIG_PERF_EVENTS
 	atomic_long_t locked_vm;
 #endif
+#ifdef CONFIG_TASKSTATS
+	/* I/O of this user's exited threads, see taskstats_uid_exit() */
+	struct task_io_accounting ioac;
+#endif
 };
 
 extern int uids_sysfs_init(void);
@@ -1167,6 +1179,16 @@ struct sched_statistics {
 };
 #endif
 
+/*
+ * Decaying average of the time an entity was runnable, in 1024us
+ * periods where each period counts y times the one after it, y^32 = 1/2.
+ */
+struct sched_avg {
+	u32			runnable_avg_sum;
+	u32			runnable_avg_period;
+	u64			last_runnable_update;
+};
+
 struct sched_entity {
 	struct load_weight	load;		/* for load-balancing */
 	struct rb_node		run_node;
@@ -1180,6 +1202,8 @@ struct sched_entity {
 
 	u64			nr_migrations;
 
+	struct sched_avg	avg;
+
 #ifdef CONFIG_SCHEDSTATS
 	struct sched_statistics statistics;
 #endif
@@ -1342,6 +1366,9 @@ struct task_struct {
 	/* PID/PID hash table linkage. */
 	struct pid_link pids[PIDTYPE_MAX];
 	struct list_head thread_group;
+#ifdef CONFIG_ANDROID_LMK_ADJ_BUCKETS
+	struct hlist_node lmk_node;	/* lowmemorykiller adj bucket */
+#endif
 
 	struct completion *vfork_done;		/* for vfork() */
 	int __user *set_child_tid;		/* CLONE_CHILD_SETTID */
@@ -1436,6 +1463,10 @@ struct task_struct {
 	/* mutex deadlock detection */
 	struct mutex_waiter *blocked_on;
 #endif
+#ifdef CONFIG_LOCK_PROFILE
+	/* caller of the last mutex_lock, for the contention profiler */
+	unsigned long lock_profile_ip;
+#endif
 #ifdef CONFIG_TRACE_IRQFLAGS
 	unsigned int irq_events;
 	unsigned long hardirq_enable_ip;
@@ -1529,6 +1560,12 @@ struct task_struct {
 	int make_it_fail;
 #endif
 	struct prop_local_single dirties;
+	/*
+	 * when (nr_dirtied >= nr_dirtied_pause), it's time to call
+	 * balance_dirty_pages() for some dirty throttling pause
+	 */
+	int nr_dirtied;
+	int nr_dirtied_pause;
 #ifdef CONFIG_LATENCYTOP
 	int latency_record_count;
 	struct latency_record latency_record[LT_SAVECOUNT];
@@ -2015,6 +2052,8 @@ extern unsigned int sysctl_sched_nr_migrate;
 extern unsigned int sysctl_sched_time_avg;
 extern unsigned int sysctl_timer_migration;
 extern unsigned int sysctl_sched_shares_window;
+extern unsigned int sysctl_sched_small_task_util;
+extern unsigned int sysctl_sched_pack_util;
 
 int sched_proc_update_handler(struct ctl_table *table, int write,
 		void __user *buffer, size_t *length,
@@ -2072,6 +2111,7 @@ extern bool yield_to(struct task_struct *p, bool preempt);
 extern void set_user_nice(struct task_struct *p, long nice);
 extern int task_prio(const struct task_struct *p);
 extern int task_nice(const struct task_struct *p);
+extern unsigned long sched_task_util(struct task_struct *p);
 extern int can_nice(const struct task_struct *p, const int nice);
 extern int task_curr(const struct task_struct *p);
 extern int idle_cpu(int cpu);
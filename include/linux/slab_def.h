@@ -83,6 +83,12 @@ struct kmem_cache {
 	int obj_size;
 #endif /* CONFIG_DEBUG_SLAB */
 
+	/* fast and slow path counts of cpu arrays already freed */
+	unsigned long alloc_fast;
+	unsigned long alloc_slow;
+	unsigned long free_fast;
+	unsigned long free_slow;
+
 /* 6) per-cpu/per-node data, touched during every alloc/free */
 	/*
 	 * We put array[] at the end of kmem_cache, because we want to size
@@ -91,6 +97,7 @@ struct kmem_cache {
 	 * We still use [NR_CPUS] and not [1] or [0] because cache_cache
 	 * is statically defined, so we reserve the max number of cpus.
 	 */
+	struct array_cache *spare[NR_CPUS];
 	struct kmem_list3 **nodelists;
 	struct array_cache *array[NR_CPUS];
 	/*
@@ -6,6 +6,7 @@
 #include <linux/init.h>
 #include <linux/pm.h>
 #include <linux/mm.h>
+#include <linux/ktime.h>
 #include <asm/errno.h>
 
 #if defined(CONFIG_PM_SLEEP) && defined(CONFIG_VT) && defined(CONFIG_VT_CONSOLE)
@@ -159,6 +160,39 @@ static inline void suspend_set_ops(const struct platform_suspend_ops *ops) {}
 static inline int pm_suspend(suspend_state_t state) { return -ENOSYS; }
 #endif /* !CONFIG_SUSPEND */
 
+/* Phases of a suspend cycle timed by kernel/power/suspend_time.c */
+enum suspend_time_phase {
+	SUSPEND_TIME_FREEZE,		/* freezing tasks */
+	SUSPEND_TIME_SUSPEND,		/* dpm_suspend_start() */
+	SUSPEND_TIME_SUSPEND_NOIRQ,	/* dpm_suspend_noirq() */
+	SUSPEND_TIME_PLATFORM_ENTRY,	/* platform code down to sleep */
+	SUSPEND_TIME_PLATFORM_EXIT,	/* platform code from the wakeup */
+	SUSPEND_TIME_RESUME_NOIRQ,	/* dpm_resume_noirq() */
+	SUSPEND_TIME_RESUME,		/* dpm_resume_end() */
+	SUSPEND_TIME_THAW,		/* thawing tasks */
+	SUSPEND_TIME_NR_PHASES
+};
+
+struct device;
+
+#ifdef CONFIG_SUSPEND_TIME
+extern void suspend_time_begin(void);
+extern void suspend_time_end(int error);
+extern void suspend_time_phase(enum suspend_time_phase phase, ktime_t start);
+extern void suspend_time_phase_us(enum suspend_time_phase phase, u32 us);
+extern void suspend_time_device(struct device *dev, bool resume,
+				ktime_t start);
+#else
+static inline void suspend_time_begin(void) {}
+static inline void suspend_time_end(int error) {}
+static inline void suspend_time_phase(enum suspend_time_phase phase,
+				      ktime_t start) {}
+static inline void suspend_time_phase_us(enum suspend_time_phase phase,
+					 u32 us) {}
+static inline void suspend_time_device(struct device *dev, bool resume,
+				       ktime_t start) {}
+#endif
+
 /* struct pbe is used for creating lists of pages that should be restored
  * atomically during the resume from disk, because the page frames they have
  * occupied before the suspend are in use.
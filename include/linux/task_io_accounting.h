@@ -41,5 +41,25 @@ struct task_io_accounting {
 	 * information loss in doing that.
 	 */
 	u64 cancelled_write_bytes;
+
+	/*
+	 * Page cache lookups on behalf of read() and page faults: pages that
+	 * were found cached, pages that were not, and pages found carrying
+	 * the readahead mark, i.e. the ones that prove readahead right and
+	 * trigger the next window.
+	 */
+	u64 pgcache_hits;
+	u64 pgcache_misses;
+	u64 pgcache_ra_hits;
+
+	/*
+	 * fsync()/fdatasync()/msync() calls and the time spent in them, and
+	 * foreground filesystem garbage collection (f2fs) this task had to
+	 * run before it could write, in nanoseconds.
+	 */
+	u64 fsync_count;
+	u64 fsync_delay_total;
+	u64 fs_gc_count;
+	u64 fs_gc_delay_total;
 #endif /* CONFIG_TASK_IO_ACCOUNTING */
 };
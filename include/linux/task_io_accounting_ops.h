@@ -40,6 +40,33 @@ static inline void task_io_account_cancelled_write(size_t bytes)
 	current->ioac.cancelled_write_bytes += bytes;
 }
 
+static inline void task_io_account_pgcache_hit(void)
+{
+	current->ioac.pgcache_hits++;
+}
+
+static inline void task_io_account_pgcache_miss(void)
+{
+	current->ioac.pgcache_misses++;
+}
+
+static inline void task_io_account_pgcache_ra_hit(void)
+{
+	current->ioac.pgcache_ra_hits++;
+}
+
+static inline void task_io_account_fsync(u64 ns)
+{
+	current->ioac.fsync_count++;
+	current->ioac.fsync_delay_total += ns;
+}
+
+static inline void task_io_account_fs_gc(u64 ns)
+{
+	current->ioac.fs_gc_count++;
+	current->ioac.fs_gc_delay_total += ns;
+}
+
 static inline void task_io_accounting_init(struct task_io_accounting *ioac)
 {
 	memset(ioac, 0, sizeof(*ioac));
@@ -51,6 +78,13 @@ static inline void task_blk_io_accounting_add(struct task_io_accounting *dst,
 	dst->read_bytes += src->read_bytes;
 	dst->write_bytes += src->write_bytes;
 	dst->cancelled_write_bytes += src->cancelled_write_bytes;
+	dst->pgcache_hits += src->pgcache_hits;
+	dst->pgcache_misses += src->pgcache_misses;
+	dst->pgcache_ra_hits += src->pgcache_ra_hits;
+	dst->fsync_count += src->fsync_count;
+	dst->fsync_delay_total += src->fsync_delay_total;
+	dst->fs_gc_count += src->fs_gc_count;
+	dst->fs_gc_delay_total += src->fs_gc_delay_total;
 }
 
 #else
@@ -77,6 +111,26 @@ static inline void task_io_account_cancelled_write(size_t bytes)
 {
 }
 
+static inline void task_io_account_pgcache_hit(void)
+{
+}
+
+static inline void task_io_account_pgcache_miss(void)
+{
+}
+
+static inline void task_io_account_pgcache_ra_hit(void)
+{
+}
+
+static inline void task_io_account_fsync(u64 ns)
+{
+}
+
+static inline void task_io_account_fs_gc(u64 ns)
+{
+}
+
 static inline void task_io_accounting_init(struct task_io_accounting *ioac)
 {
 }
@@ -33,7 +33,7 @@
  */
 
 
-#define TASKSTATS_VERSION	8
+#define TASKSTATS_VERSION	9
 #define TS_COMM_LEN		32	/* should be >= TASK_COMM_LEN
 					 * in linux/sched.h */
 
@@ -163,6 +163,20 @@ struct taskstats {
 	/* Delay waiting for memory reclaim */
 	__u64	freepages_count;
 	__u64	freepages_delay_total;
+	/* Version 8 ends here */
+
+	/* Page cache lookups by read() and faults, in pages */
+	__u64	pgcache_hits;
+	__u64	pgcache_misses;
+	__u64	pgcache_ra_hits;
+
+	/* fsync()/fdatasync()/msync() calls and time spent in them [nsec] */
+	__u64	fsync_count;
+	__u64	fsync_delay_total;
+
+	/* Foreground filesystem GC run before writing (f2fs) [nsec] */
+	__u64	fs_gc_count;
+	__u64	fs_gc_delay_total;
 };
 
 
@@ -189,6 +203,8 @@ enum {
 	TASKSTATS_TYPE_AGGR_PID,	/* contains pid + stats */
 	TASKSTATS_TYPE_AGGR_TGID,	/* contains tgid + stats */
 	TASKSTATS_TYPE_NULL,		/* contains nothing */
+	TASKSTATS_TYPE_UID,		/* User id */
+	TASKSTATS_TYPE_AGGR_UID,	/* contains uid + stats */
 	__TASKSTATS_TYPE_MAX,
 };
 
@@ -200,6 +216,7 @@ enum {
 	TASKSTATS_CMD_ATTR_TGID,
 	TASKSTATS_CMD_ATTR_REGISTER_CPUMASK,
 	TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK,
+	TASKSTATS_CMD_ATTR_UID,
 	__TASKSTATS_CMD_ATTR_MAX,
 };
 
@@ -73,6 +73,21 @@ struct nvavp_clock_stay_on_state_args {
 	enum nvavp_clock_stay_on_state	state;
 };
 
+#define NVAVP_SCHED_PRIORITY_NORMAL		0
+#define NVAVP_SCHED_PRIORITY_INTERACTIVE	2
+#define NVAVP_SCHED_PRIORITY_MAX		3
+
+/*
+ * Submits of a client are held back while clients of higher priority
+ * have work queued on the AVP, for at most deadline_us.  deadline_us is
+ * also the decode latency the client expects; submits that take longer
+ * from submit to completion are counted as missed.  0 means the default.
+ */
+struct nvavp_sched_args {
+	__u32 priority;
+	__u32 deadline_us;
+};
+
 #define NVAVP_IOCTL_MAGIC		'n'
 
 #define NVAVP_IOCTL_SET_NVMAP_FD	_IOW(NVAVP_IOCTL_MAGIC, 0x60, \
@@ -89,8 +104,10 @@ struct nvavp_clock_stay_on_state_args {
 					__u32)
 #define NVAVP_IOCTL_FORCE_CLOCK_STAY_ON	_IOW(NVAVP_IOCTL_MAGIC, 0x67, \
 					struct nvavp_clock_stay_on_state_args)
+#define NVAVP_IOCTL_SET_SCHED		_IOW(NVAVP_IOCTL_MAGIC, 0x68, \
+					struct nvavp_sched_args)
 
 #define NVAVP_IOCTL_MIN_NR		_IOC_NR(NVAVP_IOCTL_SET_NVMAP_FD)
-#define NVAVP_IOCTL_MAX_NR		_IOC_NR(NVAVP_IOCTL_FORCE_CLOCK_STAY_ON)
+#define NVAVP_IOCTL_MAX_NR		_IOC_NR(NVAVP_IOCTL_SET_SCHED)
 
 #endif /* __LINUX_TEGRA_NVAVP_H */
@@ -0,0 +1,51 @@
+/*
+ * include/linux/touch_latency.h
+ *
+ * Touch to display latency accounting.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef __LINUX_TOUCH_LATENCY_H
+#define __LINUX_TOUCH_LATENCY_H
+
+/*
+ * A sample starts at the touch interrupt and ends when the first flip
+ * queued after it is scanned out.  Each stage is timed from the stage
+ * it depends on; the boost hangs off the interrupt, as it reacts to the
+ * first event of a report rather than to the SYN_REPORT.
+ */
+enum touch_lat_stage {
+	TOUCH_LAT_IRQ,		/* touch controller interrupt */
+	TOUCH_LAT_INPUT,	/* SYN_REPORT handed to the input handlers */
+	TOUCH_LAT_BOOST,	/* cpu boost issued for the event */
+	TOUCH_LAT_FLIP,		/* next flip queued to the display */
+	TOUCH_LAT_SCANOUT,	/* that flip latched at vblank */
+	TOUCH_LAT_NR_STAGES,
+};
+
+#include <linux/ktime.h>
+
+#ifdef CONFIG_TEGRA_TOUCH_LATENCY
+void touch_latency_mark(enum touch_lat_stage stage);
+/* @queued identifies the flip, so that its own scanout closes the sample */
+void touch_latency_flip_queued(ktime_t queued);
+void touch_latency_flip_shown(ktime_t queued);
+#else
+static inline void touch_latency_mark(enum touch_lat_stage stage)
+{ }
+static inline void touch_latency_flip_queued(ktime_t queued)
+{ }
+static inline void touch_latency_flip_shown(ktime_t queued)
+{ }
+#endif
+
+#endif
@@ -9,6 +9,8 @@
 
 #include <linux/taskstats.h>
 
+struct task_io_accounting;
+
 #ifdef CONFIG_TASKSTATS
 extern void bacct_add_tsk(struct taskstats *stats, struct task_struct *tsk);
 #else
@@ -18,11 +20,16 @@ static inline void bacct_add_tsk(struct taskstats *stats, struct task_struct *ts
 
 #ifdef CONFIG_TASK_XACCT
 extern void xacct_add_tsk(struct taskstats *stats, struct task_struct *p);
+extern void xacct_add_ioac(struct taskstats *stats,
+			   struct task_io_accounting *ioac);
 extern void acct_update_integrals(struct task_struct *tsk);
 extern void acct_clear_integrals(struct task_struct *tsk);
 #else
 static inline void xacct_add_tsk(struct taskstats *stats, struct task_struct *p)
 {}
+static inline void xacct_add_ioac(struct taskstats *stats,
+				  struct task_io_accounting *ioac)
+{}
 static inline void acct_update_integrals(struct task_struct *tsk)
 {}
 static inline void acct_clear_integrals(struct task_struct *tsk)
@@ -36,9 +36,11 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		KSWAPD_LOW_WMARK_HIT_QUICKLY, KSWAPD_HIGH_WMARK_HIT_QUICKLY,
 		KSWAPD_SKIP_CONGESTION_WAIT,
 		PAGEOUTRUN, ALLOCSTALL, PGROTATED,
+		WORKINGSET_REFAULT, WORKINGSET_ACTIVATE,
 #ifdef CONFIG_COMPACTION
 		COMPACTBLOCKS, COMPACTPAGES, COMPACTPAGEFAILED,
 		COMPACTSTALL, COMPACTFAIL, COMPACTSUCCESS,
+		KCOMPACTD_WAKE,
 #endif
 #ifdef CONFIG_HUGETLB_PAGE
 		HTLB_BUDDY_PGALLOC, HTLB_BUDDY_PGALLOC_FAIL,
@@ -57,6 +59,16 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		THP_COLLAPSE_ALLOC,
 		THP_COLLAPSE_ALLOC_FAILED,
 		THP_SPLIT,
+#endif
+#ifdef CONFIG_SWAP
+		SWAP_RA,		/* pages read ahead on swapin */
+		SWAP_RA_HIT,		/* of those, faulted in later */
+#endif
+#ifdef CONFIG_HIGHMEM
+		PKMAP_FLUSH,		/* TLB flushes of the kmap area */
+		PKMAP_FLUSH_PAGES,	/* entries unmapped by them */
+		PKMAP_FLUSH_ALL,	/* of the flushes, whole TLB ones */
+		PKMAP_WAIT,		/* kmap() slept for a free entry */
 #endif
 		NR_VM_EVENT_ITEMS
 };
@@ -32,6 +32,26 @@ enum {
 	WAKE_LOCK_TYPE_COUNT
 };
 
+/* Active time histogram: bucket 0 is < 1ms, bucket n is < 2^n ms */
+#define WAKE_LOCK_HIST_BUCKETS	16
+
+/* One record of /proc/wakelocks_bin, with the fields of /proc/wakelocks.
+ * Times are in nanoseconds, and the name is truncated to fit.
+ */
+struct wake_lock_stat_record {
+	char		name[48];
+	__u32		count;
+	__u32		expire_count;
+	__u32		wakeup_count;
+	__u32		__pad;
+	__s64		active_since;
+	__s64		total_time;
+	__s64		prevent_suspend_time;
+	__s64		max_time;
+	__s64		last_change;
+	__u32		hist[WAKE_LOCK_HIST_BUCKETS];
+};
+
 struct wake_lock {
 #ifdef CONFIG_HAS_WAKELOCK
 	struct list_head    link;
@@ -47,6 +67,7 @@ struct wake_lock {
 		ktime_t         prevent_suspend_time;
 		ktime_t         max_time;
 		ktime_t         last_time;
+		unsigned int    hist[WAKE_LOCK_HIST_BUCKETS];
 	} stat;
 #endif
 #endif
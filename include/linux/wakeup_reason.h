@@ -18,6 +18,17 @@
 #ifndef _LINUX_WAKEUP_REASON_H
 #define _LINUX_WAKEUP_REASON_H
 
+#include <linux/types.h>
+
 void log_wakeup_reason(int irq);
 
+#ifdef CONFIG_SUSPEND
+bool wakeup_reason_claim(int irq);
+#else
+static inline bool wakeup_reason_claim(int irq)
+{
+	return false;
+}
+#endif
+
 #endif /* _LINUX_WAKEUP_REASON_H */
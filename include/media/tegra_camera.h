@@ -37,6 +37,21 @@ struct tegra_camera_clk_info {
 	uint flag;	/* to inform if any special bits need to enabled/disabled */
 };
 
+/*
+ * Capture buffer allocated into the caller's nvmap client (nvmap_fd).
+ * The returned handle is write-combined and lives in IOVMM or the
+ * generic carveout, so VI can be pointed at it through an nvhost
+ * submit and the same handle can be flipped by tegra_dc_ext or given
+ * to the encoder without a copy or cache maintenance.  It is freed
+ * with NVMAP_IOC_FREE, or when nvmap_fd is closed.
+ */
+struct tegra_camera_buffer {
+	uint id;	/* TEGRA_CAMERA_MODULE_VI */
+	int nvmap_fd;
+	uint size;
+	uint handle;	/* out */
+};
+
 enum StereoCameraMode {
 	Main = 0x0,		/* Sets the default camera to Main */
 	StereoCameraMode_Left = 0x01,	/* the left camera is on. */
@@ -51,5 +66,7 @@ enum StereoCameraMode {
 #define TEGRA_CAMERA_IOCTL_CLK_SET_RATE		\
 	_IOWR('i', 3, struct tegra_camera_clk_info)
 #define TEGRA_CAMERA_IOCTL_RESET		_IOWR('i', 4, uint)
+#define TEGRA_CAMERA_IOCTL_BUFFER_ALLOC		\
+	_IOWR('i', 5, struct tegra_camera_buffer)
 
 #endif
@@ -82,6 +82,68 @@ DEFINE_EVENT(loadeval, cpufreq_interactive_notyet,
 	    TP_ARGS(cpu_id, load, curfreq, targfreq)
 );
 
+TRACE_EVENT(cpufreq_interactive_decision,
+	    TP_PROTO(unsigned long cpu_id, unsigned long load,
+		     unsigned long curfreq, unsigned long targfreq,
+		     unsigned int target_load, int load_idx,
+		     unsigned int hispeed_delay, int delay_idx),
+	    TP_ARGS(cpu_id, load, curfreq, targfreq, target_load, load_idx,
+		    hispeed_delay, delay_idx),
+
+	    TP_STRUCT__entry(
+		    __field(unsigned long, cpu_id        )
+		    __field(unsigned long, load          )
+		    __field(unsigned long, curfreq       )
+		    __field(unsigned long, targfreq      )
+		    __field(unsigned int,  target_load   )
+		    __field(int,           load_idx      )
+		    __field(unsigned int,  hispeed_delay )
+		    __field(int,           delay_idx     )
+	    ),
+
+	    TP_fast_assign(
+		    __entry->cpu_id = cpu_id;
+		    __entry->load = load;
+		    __entry->curfreq = curfreq;
+		    __entry->targfreq = targfreq;
+		    __entry->target_load = target_load;
+		    __entry->load_idx = load_idx;
+		    __entry->hispeed_delay = hispeed_delay;
+		    __entry->delay_idx = delay_idx;
+	    ),
+
+	    TP_printk("cpu=%lu load=%lu cur=%lu targ=%lu target_load=%u[%d] "
+		      "hispeed_delay=%u[%d]",
+		      __entry->cpu_id, __entry->load, __entry->curfreq,
+		      __entry->targfreq, __entry->target_load,
+		      __entry->load_idx, __entry->hispeed_delay,
+		      __entry->delay_idx)
+);
+
+TRACE_EVENT(cpufreq_interactive_load,
+	    TP_PROTO(unsigned long cpu_id, unsigned long load,
+		     unsigned long scaled_load, unsigned long curfreq),
+	    TP_ARGS(cpu_id, load, scaled_load, curfreq),
+
+	    TP_STRUCT__entry(
+		    __field(unsigned long, cpu_id      )
+		    __field(unsigned long, load        )
+		    __field(unsigned long, scaled_load )
+		    __field(unsigned long, curfreq     )
+	    ),
+
+	    TP_fast_assign(
+		    __entry->cpu_id = cpu_id;
+		    __entry->load = load;
+		    __entry->scaled_load = scaled_load;
+		    __entry->curfreq = curfreq;
+	    ),
+
+	    TP_printk("cpu=%lu load=%lu scaled=%lu cur=%lu",
+		      __entry->cpu_id, __entry->load, __entry->scaled_load,
+		      __entry->curfreq)
+);
+
 TRACE_EVENT(cpufreq_interactive_boost,
 	    TP_PROTO(unsigned long freq),
 	    TP_ARGS(freq),
@@ -0,0 +1,58 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM filemap
+
+#if !defined(_TRACE_FILEMAP_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_FILEMAP_H
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+#include <linux/fs.h>
+
+#ifndef _TRACE_FILEMAP_DEF_ONCE
+#define _TRACE_FILEMAP_DEF_ONCE
+#define PGCACHE_HIT		0
+#define PGCACHE_MISS		1
+#define PGCACHE_RA_HIT		2
+#endif
+
+#define show_pgcache_result(result)				\
+	__print_symbolic(result,				\
+		{ PGCACHE_HIT,		"hit" },		\
+		{ PGCACHE_MISS,		"miss" },		\
+		{ PGCACHE_RA_HIT,	"ra_hit" })
+
+/*
+ * One lookup of a page of a file by read() or a page fault.  The task is
+ * in the common fields of the event.
+ */
+TRACE_EVENT(mm_filemap_access,
+
+	TP_PROTO(struct inode *inode, pgoff_t index, int result),
+
+	TP_ARGS(inode, index, result),
+
+	TP_STRUCT__entry(
+		__field(dev_t, dev)
+		__field(unsigned long, ino)
+		__field(pgoff_t, index)
+		__field(int, result)
+	),
+
+	TP_fast_assign(
+		__entry->dev = inode->i_sb->s_dev;
+		__entry->ino = inode->i_ino;
+		__entry->index = index;
+		__entry->result = result;
+	),
+
+	TP_printk("dev=%d:%d ino=%lu index=%lu %s",
+		MAJOR(__entry->dev), MINOR(__entry->dev),
+		__entry->ino,
+		(unsigned long)__entry->index,
+		show_pgcache_result(__entry->result))
+);
+
+#endif /* _TRACE_FILEMAP_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
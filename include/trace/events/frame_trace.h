@@ -0,0 +1,156 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM frame_trace
+
+#if !defined(_TRACE_FRAME_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_FRAME_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(frame_binder_txn,
+	TP_PROTO(u32 frame, int debug_id, int from_pid, int to_pid,
+		 unsigned int code, int reply),
+	TP_ARGS(frame, debug_id, from_pid, to_pid, code, reply),
+
+	TP_STRUCT__entry(
+	    __field(u32, frame)
+	    __field(int, debug_id)
+	    __field(int, from_pid)
+	    __field(int, to_pid)
+	    __field(unsigned int, code)
+	    __field(int, reply)
+	),
+
+	TP_fast_assign(
+	    __entry->frame = frame;
+	    __entry->debug_id = debug_id;
+	    __entry->from_pid = from_pid;
+	    __entry->to_pid = to_pid;
+	    __entry->code = code;
+	    __entry->reply = reply;
+	),
+
+	TP_printk("frame=%u txn=%d from=%d to=%d code=%u reply=%d",
+		  __entry->frame, __entry->debug_id, __entry->from_pid,
+		  __entry->to_pid, __entry->code, __entry->reply)
+);
+
+TRACE_EVENT(frame_gpu_submit,
+	TP_PROTO(u32 frame, const char *name, u32 syncpt_id, u32 thresh),
+	TP_ARGS(frame, name, syncpt_id, thresh),
+
+	TP_STRUCT__entry(
+	    __field(u32, frame)
+	    __field(const char *, name)
+	    __field(u32, syncpt_id)
+	    __field(u32, thresh)
+	),
+
+	TP_fast_assign(
+	    __entry->frame = frame;
+	    __entry->name = name;
+	    __entry->syncpt_id = syncpt_id;
+	    __entry->thresh = thresh;
+	),
+
+	TP_printk("frame=%u name=%s syncpt=%u thresh=%u",
+		  __entry->frame, __entry->name, __entry->syncpt_id,
+		  __entry->thresh)
+);
+
+TRACE_EVENT(frame_syncpt_done,
+	TP_PROTO(u32 frame, u32 syncpt_id, u32 value),
+	TP_ARGS(frame, syncpt_id, value),
+
+	TP_STRUCT__entry(
+	    __field(u32, frame)
+	    __field(u32, syncpt_id)
+	    __field(u32, value)
+	),
+
+	TP_fast_assign(
+	    __entry->frame = frame;
+	    __entry->syncpt_id = syncpt_id;
+	    __entry->value = value;
+	),
+
+	TP_printk("frame=%u syncpt=%u value=%u",
+		  __entry->frame, __entry->syncpt_id, __entry->value)
+);
+
+DECLARE_EVENT_CLASS(frame_flip_class,
+	TP_PROTO(u32 frame, int dc, u32 syncpt_id, u32 thresh),
+	TP_ARGS(frame, dc, syncpt_id, thresh),
+
+	TP_STRUCT__entry(
+	    __field(u32, frame)
+	    __field(int, dc)
+	    __field(u32, syncpt_id)
+	    __field(u32, thresh)
+	),
+
+	TP_fast_assign(
+	    __entry->frame = frame;
+	    __entry->dc = dc;
+	    __entry->syncpt_id = syncpt_id;
+	    __entry->thresh = thresh;
+	),
+
+	TP_printk("frame=%u dc=%d syncpt=%u thresh=%u",
+		  __entry->frame, __entry->dc, __entry->syncpt_id,
+		  __entry->thresh)
+);
+
+DEFINE_EVENT(frame_flip_class, frame_flip,
+	TP_PROTO(u32 frame, int dc, u32 syncpt_id, u32 thresh),
+	TP_ARGS(frame, dc, syncpt_id, thresh)
+);
+
+DEFINE_EVENT(frame_flip_class, frame_scanout,
+	TP_PROTO(u32 frame, int dc, u32 syncpt_id, u32 thresh),
+	TP_ARGS(frame, dc, syncpt_id, thresh)
+);
+
+TRACE_EVENT(frame_cpufreq,
+	TP_PROTO(u32 frame, unsigned int old_khz, unsigned int new_khz),
+	TP_ARGS(frame, old_khz, new_khz),
+
+	TP_STRUCT__entry(
+	    __field(u32, frame)
+	    __field(unsigned int, old_khz)
+	    __field(unsigned int, new_khz)
+	),
+
+	TP_fast_assign(
+	    __entry->frame = frame;
+	    __entry->old_khz = old_khz;
+	    __entry->new_khz = new_khz;
+	),
+
+	TP_printk("frame=%u old=%u new=%u",
+		  __entry->frame, __entry->old_khz, __entry->new_khz)
+);
+
+TRACE_EVENT(frame_hotplug,
+	TP_PROTO(u32 frame, unsigned int cpu, bool up),
+	TP_ARGS(frame, cpu, up),
+
+	TP_STRUCT__entry(
+	    __field(u32, frame)
+	    __field(unsigned int, cpu)
+	    __field(bool, up)
+	),
+
+	TP_fast_assign(
+	    __entry->frame = frame;
+	    __entry->cpu = cpu;
+	    __entry->up = up;
+	),
+
+	TP_printk("frame=%u cpu=%u %s",
+		  __entry->frame, __entry->cpu, __entry->up ? "up" : "down")
+);
+
+#endif /* _TRACE_FRAME_TRACE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -362,6 +362,51 @@ TRACE_EVENT(sched_stat_runtime,
 			(unsigned long long)__entry->vruntime)
 );
 
+/*
+ * Tracepoints for the runnable averages, on every tick: of the task
+ * running, and of the cpu.  util is 0..1024.
+ */
+TRACE_EVENT(sched_task_util,
+
+	TP_PROTO(struct task_struct *tsk, unsigned long util),
+
+	TP_ARGS(tsk, util),
+
+	TP_STRUCT__entry(
+		__array( char,	comm,	TASK_COMM_LEN	)
+		__field( pid_t,	pid			)
+		__field( unsigned long,	util		)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, tsk->comm, TASK_COMM_LEN);
+		__entry->pid		= tsk->pid;
+		__entry->util		= util;
+	),
+
+	TP_printk("comm=%s pid=%d util=%lu",
+			__entry->comm, __entry->pid, __entry->util)
+);
+
+TRACE_EVENT(sched_cpu_util,
+
+	TP_PROTO(int cpu, unsigned long util),
+
+	TP_ARGS(cpu, util),
+
+	TP_STRUCT__entry(
+		__field( int,		cpu		)
+		__field( unsigned long,	util		)
+	),
+
+	TP_fast_assign(
+		__entry->cpu		= cpu;
+		__entry->util		= util;
+	),
+
+	TP_printk("cpu=%d util=%lu", __entry->cpu, __entry->util)
+);
+
 /*
  * Tracepoint for showing priority inheritance modifying a tasks
  * priority.
@@ -0,0 +1,42 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM spi_tegra
+
+#if !defined(_TRACE_SPI_TEGRA_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SPI_TEGRA_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(spi_tegra_message,
+	TP_PROTO(int bus, int cs, unsigned int len, unsigned int xfers,
+		 unsigned int irqs, bool polled, unsigned long us),
+	TP_ARGS(bus, cs, len, xfers, irqs, polled, us),
+
+	TP_STRUCT__entry(
+	    __field(int, bus)
+	    __field(int, cs)
+	    __field(unsigned int, len)
+	    __field(unsigned int, xfers)
+	    __field(unsigned int, irqs)
+	    __field(bool, polled)
+	    __field(unsigned long, us)
+	),
+
+	TP_fast_assign(
+	    __entry->bus = bus;
+	    __entry->cs = cs;
+	    __entry->len = len;
+	    __entry->xfers = xfers;
+	    __entry->irqs = irqs;
+	    __entry->polled = polled;
+	    __entry->us = us;
+	),
+
+	TP_printk("spi%d.%d len=%u xfers=%u irqs=%u polled=%d us=%lu",
+		  __entry->bus, __entry->cs, __entry->len, __entry->xfers,
+		  __entry->irqs, __entry->polled, __entry->us)
+);
+
+#endif /* _TRACE_SPI_TEGRA_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
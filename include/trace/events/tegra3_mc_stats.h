@@ -0,0 +1,43 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tegra3_mc_stats
+
+#if !defined(_TRACE_TEGRA3_MC_STATS_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TEGRA3_MC_STATS_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(mc_bandwidth,
+	TP_PROTO(unsigned long emc_khz, u32 cpu, u32 gpu, u32 display,
+		 u32 video, u32 camera, u32 avp),
+	TP_ARGS(emc_khz, cpu, gpu, display, video, camera, avp),
+
+	TP_STRUCT__entry(
+	    __field(unsigned long, emc_khz)
+	    __field(u32, cpu)
+	    __field(u32, gpu)
+	    __field(u32, display)
+	    __field(u32, video)
+	    __field(u32, camera)
+	    __field(u32, avp)
+	),
+
+	TP_fast_assign(
+	    __entry->emc_khz = emc_khz;
+	    __entry->cpu = cpu;
+	    __entry->gpu = gpu;
+	    __entry->display = display;
+	    __entry->video = video;
+	    __entry->camera = camera;
+	    __entry->avp = avp;
+	),
+
+	TP_printk("emc_khz=%lu cpu=%u gpu=%u display=%u video=%u camera=%u "
+		  "avp=%u", __entry->emc_khz, __entry->cpu, __entry->gpu,
+		  __entry->display, __entry->video, __entry->camera,
+		  __entry->avp)
+);
+
+#endif /* _TRACE_TEGRA3_MC_STATS_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
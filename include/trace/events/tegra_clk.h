@@ -0,0 +1,69 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tegra_clk
+
+#if !defined(_TRACE_TEGRA_CLK_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TEGRA_CLK_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(tegra_clk_state,
+	TP_PROTO(const char *name, unsigned int refcnt, unsigned long caller),
+	TP_ARGS(name, refcnt, caller),
+
+	TP_STRUCT__entry(
+	    __string(name, name)
+	    __field(unsigned int, refcnt)
+	    __field(unsigned long, caller)
+	),
+
+	TP_fast_assign(
+	    __assign_str(name, name);
+	    __entry->refcnt = refcnt;
+	    __entry->caller = caller;
+	),
+
+	TP_printk("%s refcnt=%u caller=%pF", __get_str(name),
+		  __entry->refcnt, (void *)__entry->caller)
+);
+
+DEFINE_EVENT(tegra_clk_state, tegra_clk_enable,
+	TP_PROTO(const char *name, unsigned int refcnt, unsigned long caller),
+	TP_ARGS(name, refcnt, caller)
+);
+
+DEFINE_EVENT(tegra_clk_state, tegra_clk_disable,
+	TP_PROTO(const char *name, unsigned int refcnt, unsigned long caller),
+	TP_ARGS(name, refcnt, caller)
+);
+
+TRACE_EVENT(tegra_clk_set_rate,
+	TP_PROTO(const char *name, unsigned long old_rate,
+		 unsigned long new_rate, unsigned long req_rate,
+		 unsigned long caller),
+	TP_ARGS(name, old_rate, new_rate, req_rate, caller),
+
+	TP_STRUCT__entry(
+	    __string(name, name)
+	    __field(unsigned long, old_rate)
+	    __field(unsigned long, new_rate)
+	    __field(unsigned long, req_rate)
+	    __field(unsigned long, caller)
+	),
+
+	TP_fast_assign(
+	    __assign_str(name, name);
+	    __entry->old_rate = old_rate;
+	    __entry->new_rate = new_rate;
+	    __entry->req_rate = req_rate;
+	    __entry->caller = caller;
+	),
+
+	TP_printk("%s %lu -> %lu (req %lu) caller=%pF", __get_str(name),
+		  __entry->old_rate, __entry->new_rate, __entry->req_rate,
+		  (void *)__entry->caller)
+);
+
+#endif /* _TRACE_TEGRA_CLK_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,44 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tegra_dvfs
+
+#if !defined(_TRACE_TEGRA_DVFS_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TEGRA_DVFS_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(dvfs_rail_voltage,
+	TP_PROTO(const char *rail, int millivolts, unsigned long us),
+	TP_ARGS(rail, millivolts, us),
+
+	TP_STRUCT__entry(
+	    __string(rail, rail)
+	    __field(int, millivolts)
+	    __field(unsigned long, us)
+	),
+
+	TP_fast_assign(
+	    __assign_str(rail, rail);
+	    __entry->millivolts = millivolts;
+	    __entry->us = us;
+	),
+
+	TP_printk("rail=%s mV=%d us=%lu", __get_str(rail),
+		  __entry->millivolts, __entry->us)
+);
+
+/* one regulator write, us is the time until it returned */
+DEFINE_EVENT(dvfs_rail_voltage, tegra_dvfs_rail_set_voltage,
+	TP_PROTO(const char *rail, int millivolts, unsigned long us),
+	TP_ARGS(rail, millivolts, us)
+);
+
+/* speculative raise ahead of a rate change, us covers all the steps */
+DEFINE_EVENT(dvfs_rail_voltage, tegra_dvfs_rail_prepare,
+	TP_PROTO(const char *rail, int millivolts, unsigned long us),
+	TP_ARGS(rail, millivolts, us)
+);
+
+#endif /* _TRACE_TEGRA_DVFS_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
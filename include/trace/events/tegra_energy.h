@@ -0,0 +1,45 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tegra_energy
+
+#if !defined(_TRACE_TEGRA_ENERGY_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TEGRA_ENERGY_H
+
+#include <linux/tracepoint.h>
+
+/* one accounting interval of one core; cpu 4 is the LP core */
+TRACE_EVENT(tegra_energy_interval,
+	TP_PROTO(unsigned int cpu, unsigned int khz, int millivolts,
+		 unsigned long busy_us, unsigned long gated_us,
+		 unsigned long dyn_uj, unsigned long leak_uj),
+	TP_ARGS(cpu, khz, millivolts, busy_us, gated_us, dyn_uj, leak_uj),
+
+	TP_STRUCT__entry(
+	    __field(unsigned int, cpu)
+	    __field(unsigned int, khz)
+	    __field(int, millivolts)
+	    __field(unsigned long, busy_us)
+	    __field(unsigned long, gated_us)
+	    __field(unsigned long, dyn_uj)
+	    __field(unsigned long, leak_uj)
+	),
+
+	TP_fast_assign(
+	    __entry->cpu = cpu;
+	    __entry->khz = khz;
+	    __entry->millivolts = millivolts;
+	    __entry->busy_us = busy_us;
+	    __entry->gated_us = gated_us;
+	    __entry->dyn_uj = dyn_uj;
+	    __entry->leak_uj = leak_uj;
+	),
+
+	TP_printk("cpu=%u kHz=%u mV=%d busy_us=%lu gated_us=%lu dyn_uJ=%lu leak_uJ=%lu",
+		  __entry->cpu, __entry->khz, __entry->millivolts,
+		  __entry->busy_us, __entry->gated_us,
+		  __entry->dyn_uj, __entry->leak_uj)
+);
+
+#endif /* _TRACE_TEGRA_ENERGY_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
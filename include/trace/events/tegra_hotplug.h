@@ -0,0 +1,64 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tegra_hotplug
+
+#if !defined(_TRACE_TEGRA_HOTPLUG_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TEGRA_HOTPLUG_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(hotplug_phase,
+	TP_PROTO(unsigned int cpu, unsigned long us),
+	TP_ARGS(cpu, us),
+
+	TP_STRUCT__entry(
+	    __field(unsigned int, cpu)
+	    __field(unsigned long, us)
+	),
+
+	TP_fast_assign(
+	    __entry->cpu = cpu;
+	    __entry->us = us;
+	),
+
+	TP_printk("cpu=%u us=%lu", __entry->cpu, __entry->us)
+);
+
+DEFINE_EVENT(hotplug_phase, tegra_hotplug_up_prepare,
+	TP_PROTO(unsigned int cpu, unsigned long us),
+	TP_ARGS(cpu, us)
+);
+
+DEFINE_EVENT(hotplug_phase, tegra_hotplug_up_ungate,
+	TP_PROTO(unsigned int cpu, unsigned long us),
+	TP_ARGS(cpu, us)
+);
+
+DEFINE_EVENT(hotplug_phase, tegra_hotplug_up_reset,
+	TP_PROTO(unsigned int cpu, unsigned long us),
+	TP_ARGS(cpu, us)
+);
+
+DEFINE_EVENT(hotplug_phase, tegra_hotplug_up_online,
+	TP_PROTO(unsigned int cpu, unsigned long us),
+	TP_ARGS(cpu, us)
+);
+
+DEFINE_EVENT(hotplug_phase, tegra_hotplug_down_prepare,
+	TP_PROTO(unsigned int cpu, unsigned long us),
+	TP_ARGS(cpu, us)
+);
+
+DEFINE_EVENT(hotplug_phase, tegra_hotplug_down_die,
+	TP_PROTO(unsigned int cpu, unsigned long us),
+	TP_ARGS(cpu, us)
+);
+
+DEFINE_EVENT(hotplug_phase, tegra_hotplug_down_dead,
+	TP_PROTO(unsigned int cpu, unsigned long us),
+	TP_ARGS(cpu, us)
+);
+
+#endif /* _TRACE_TEGRA_HOTPLUG_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
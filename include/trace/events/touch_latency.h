@@ -0,0 +1,54 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM touch_latency
+
+#if !defined(_TRACE_TOUCH_LATENCY_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TOUCH_LATENCY_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(touch_lat_stage,
+	TP_PROTO(unsigned long us, unsigned long total_us),
+	TP_ARGS(us, total_us),
+
+	TP_STRUCT__entry(
+	    __field(unsigned long, us)
+	    __field(unsigned long, total_us)
+	),
+
+	TP_fast_assign(
+	    __entry->us = us;
+	    __entry->total_us = total_us;
+	),
+
+	TP_printk("us=%lu total_us=%lu", __entry->us, __entry->total_us)
+);
+
+DEFINE_EVENT(touch_lat_stage, touch_latency_irq,
+	TP_PROTO(unsigned long us, unsigned long total_us),
+	TP_ARGS(us, total_us)
+);
+
+DEFINE_EVENT(touch_lat_stage, touch_latency_input,
+	TP_PROTO(unsigned long us, unsigned long total_us),
+	TP_ARGS(us, total_us)
+);
+
+DEFINE_EVENT(touch_lat_stage, touch_latency_boost,
+	TP_PROTO(unsigned long us, unsigned long total_us),
+	TP_ARGS(us, total_us)
+);
+
+DEFINE_EVENT(touch_lat_stage, touch_latency_flip,
+	TP_PROTO(unsigned long us, unsigned long total_us),
+	TP_ARGS(us, total_us)
+);
+
+DEFINE_EVENT(touch_lat_stage, touch_latency_scanout,
+	TP_PROTO(unsigned long us, unsigned long total_us),
+	TP_ARGS(us, total_us)
+);
+
+#endif /* _TRACE_TOUCH_LATENCY_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
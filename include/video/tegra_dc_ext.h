@@ -59,6 +59,8 @@
 #define TEGRA_DC_EXT_FLIP_FLAG_INVERT_V	(1 << 1)
 #define TEGRA_DC_EXT_FLIP_FLAG_TILED	(1 << 2)
 #define TEGRA_DC_EXT_FLIP_FLAG_CURSOR	(1 << 3)
+/* wait for pre_fence_fd, an nvhost fence, before showing the buffer */
+#define TEGRA_DC_EXT_FLIP_FLAG_PRE_FENCE	(1 << 4)
 
 struct tegra_dc_ext_flip_windowattr {
 	__s32	index;
@@ -91,8 +93,9 @@ struct tegra_dc_ext_flip_windowattr {
 	__u32	buff_id_u;
 	__u32	buff_id_v;
 	__u32	flags;
+	__s32	pre_fence_fd;
 	/* Leave some wiggle room for future expansion */
-	__u32   pad[5];
+	__u32   pad[4];
 };
 
 #define TEGRA_DC_EXT_FLIP_N_WINDOWS	3
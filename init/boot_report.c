@@ -0,0 +1,180 @@
+/*
+ * init/boot_report.c
+ *
+ * Boot time report.  do_one_initcall() and really_probe() record how long
+ * each initcall and each driver probe took, when it started and in which
+ * thread, until init is started.  The architecture can add stages timed
+ * before the kernel ran with boot_report_stage().  Probes of drivers with
+ * async_probe set run in the async threads and overlap the initcalls that
+ * follow, so the durations add up to more than the time to init.
+ *
+ * debugfs "boot_report" lists them in the order they finished, after a
+ * summary with the time init was started at, which is the number to
+ * compare between boots.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+#include <linux/math64.h>
+#include <linux/device.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/boot_report.h>
+
+#define BOOT_REPORT_MAX		1024
+
+enum { BOOT_REPORT_INITCALL, BOOT_REPORT_PROBE, BOOT_REPORT_STAGE };
+
+struct boot_report_entry {
+	u32 start_us;
+	u32 us;
+	int ret;
+	pid_t pid;
+	int type;
+	char name[44];
+};
+
+static DEFINE_MUTEX(boot_report_lock);
+static struct boot_report_entry *boot_entries;
+static unsigned int boot_nr_entries;
+static unsigned int boot_dropped;
+static bool boot_report_done;
+static u64 boot_init_ns;
+
+static void boot_report_add(struct boot_report_entry *e, u64 start, u64 end)
+{
+	e->start_us = div_u64(start, NSEC_PER_USEC);
+	e->us = div_u64(end - start, NSEC_PER_USEC);
+	e->pid = task_pid_nr(current);
+
+	mutex_lock(&boot_report_lock);
+	if (boot_report_done)
+		goto out;
+	if (!boot_entries)
+		boot_entries = kcalloc(BOOT_REPORT_MAX, sizeof(*e),
+				       GFP_KERNEL);
+	if (boot_entries && boot_nr_entries < BOOT_REPORT_MAX)
+		boot_entries[boot_nr_entries++] = *e;
+	else
+		boot_dropped++;
+out:
+	mutex_unlock(&boot_report_lock);
+}
+
+void boot_report_initcall(initcall_t fn, int ret, u64 start)
+{
+	struct boot_report_entry e;
+
+	if (boot_report_done)
+		return;
+	e.type = BOOT_REPORT_INITCALL;
+	e.ret = ret;
+	snprintf(e.name, sizeof(e.name), "%pf", fn);
+	boot_report_add(&e, start, local_clock());
+}
+
+void boot_report_probe(struct device *dev, struct device_driver *drv,
+		       int ret, u64 start)
+{
+	struct boot_report_entry e;
+
+	if (boot_report_done)
+		return;
+	e.type = BOOT_REPORT_PROBE;
+	e.ret = ret;
+	snprintf(e.name, sizeof(e.name), "%s %s", drv->name, dev_name(dev));
+	boot_report_add(&e, start, local_clock());
+}
+
+/* A stage from @start to @end ns of local_clock(), timed by someone else */
+void boot_report_stage(const char *name, u64 start, u64 end)
+{
+	struct boot_report_entry e;
+
+	if (boot_report_done)
+		return;
+	e.type = BOOT_REPORT_STAGE;
+	e.ret = 0;
+	strlcpy(e.name, name, sizeof(e.name));
+	boot_report_add(&e, start, end);
+}
+
+/* Called once the async probes are done, just before init is run */
+void boot_report_init_started(void)
+{
+	mutex_lock(&boot_report_lock);
+	boot_init_ns = local_clock();
+	boot_report_done = true;
+	mutex_unlock(&boot_report_lock);
+}
+
+#ifdef CONFIG_DEBUG_FS
+
+static int boot_report_show(struct seq_file *s, void *data)
+{
+	u64 us[3] = { 0, 0, 0 };
+	unsigned int n[3] = { 0, 0, 0 };
+	unsigned int other = 0;
+	unsigned int i;
+
+	mutex_lock(&boot_report_lock);
+	for (i = 0; i < boot_nr_entries; i++) {
+		struct boot_report_entry *e = &boot_entries[i];
+
+		us[e->type] += e->us;
+		n[e->type]++;
+		if (e->type == BOOT_REPORT_PROBE && e->pid != 1)
+			other++;
+	}
+
+	seq_printf(s, "init started at %llu ms\n",
+		   div_u64(boot_init_ns, NSEC_PER_MSEC));
+	seq_printf(s, "%u initcalls took %llu ms, %u probes took %llu ms, "
+		   "%u of them outside pid 1\n",
+		   n[BOOT_REPORT_INITCALL],
+		   div_u64(us[BOOT_REPORT_INITCALL], USEC_PER_MSEC),
+		   n[BOOT_REPORT_PROBE],
+		   div_u64(us[BOOT_REPORT_PROBE], USEC_PER_MSEC), other);
+	if (boot_dropped)
+		seq_printf(s, "%u not recorded\n", boot_dropped);
+
+	seq_printf(s, "\n%12s %10s %5s %5s  %s\n", "start_ms", "time_us",
+		   "pid", "ret", "what");
+	for (i = 0; i < boot_nr_entries; i++) {
+		struct boot_report_entry *e = &boot_entries[i];
+
+		seq_printf(s, "%8u.%03u %10u %5d %5d  %s %s\n",
+			   e->start_us / 1000, e->start_us % 1000, e->us,
+			   e->pid, e->ret,
+			   e->type == BOOT_REPORT_PROBE ? "probe" :
+			   e->type == BOOT_REPORT_STAGE ? "stage" : "call ",
+			   e->name);
+	}
+	mutex_unlock(&boot_report_lock);
+	return 0;
+}
+
+static int boot_report_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, boot_report_show, NULL);
+}
+
+static const struct file_operations boot_report_fops = {
+	.open		= boot_report_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init boot_report_debugfs_init(void)
+{
+	if (!debugfs_create_file("boot_report", S_IRUGO, NULL, NULL,
+				 &boot_report_fops))
+		return -ENOMEM;
+	return 0;
+}
+late_initcall(boot_report_debugfs_init);
+
+#endif
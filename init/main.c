@@ -63,6 +63,7 @@
 #include <linux/kgdb.h>
 #include <linux/ftrace.h>
 #include <linux/async.h>
+#include <linux/boot_report.h>
 #include <linux/kmemcheck.h>
 #include <linux/sfi.h>
 #include <linux/shmem_fs.h>
@@ -677,12 +678,14 @@ static int __init_or_module do_one_initcall_debug(initcall_t fn)
 int __init_or_module do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
+	u64 start = boot_report_clock();
 	int ret;
 
 	if (initcall_debug)
 		ret = do_one_initcall_debug(fn);
 	else
 		ret = fn();
+	boot_report_initcall(fn, ret, start);
 
 	msgbuf[0] = 0;
 
@@ -755,6 +758,7 @@ static noinline int init_post(void)
 {
 	/* need to finish all async __init code before freeing the memory */
 	async_synchronize_full();
+	boot_report_init_started();
 	free_initmem();
 	mark_rodata_ro();
 	system_state = SYSTEM_RUNNING;
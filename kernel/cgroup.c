@@ -60,6 +60,7 @@
 #include <linux/eventfd.h>
 #include <linux/poll.h>
 #include <linux/flex_array.h> /* used in cgroup_attach_proc */
+#include <linux/math64.h>
 
 #include <linux/atomic.h>
 
@@ -83,6 +84,20 @@ static struct cgroup_subsys *subsys[CGROUP_SUBSYS_COUNT] = {
  * and may be associated with a superblock to form an active
  * hierarchy
  */
+/*
+ * Latency of writes to "tasks" and "cgroup.procs", from the write until
+ * the threads are in the new cgroup, including the wait for cgroup_mutex.
+ */
+#define CGROUP_ATTACH_BUCKETS	6	/* <10us .. <100ms, >=100ms */
+
+struct cgroup_attach_stats {
+	unsigned long count;
+	unsigned long threads;
+	u64 total_ns;
+	u64 max_ns;
+	unsigned long hist[CGROUP_ATTACH_BUCKETS];
+};
+
 struct cgroupfs_root {
 	struct super_block *sb;
 
@@ -118,6 +133,9 @@ struct cgroupfs_root {
 
 	/* The name for this hierarchy - may be empty */
 	char name[MAX_CGROUP_ROOT_NAMELEN];
+
+	/* Indexed by threadgroup, protected by cgroup_mutex */
+	struct cgroup_attach_stats attach_stats[2];
 };
 
 /*
@@ -2017,6 +2035,7 @@ int cgroup_attach_proc(struct cgroup *cgrp, struct task_struct *leader)
 	 */
 	struct list_head newcg_list;
 	struct cg_list_entry *cg_entry, *temp_nobe;
+	struct css_set *last_cg = NULL;
 
 	/*
 	 * step 0: in order to do expensive, possibly blocking operations for
@@ -2111,14 +2130,22 @@ int cgroup_attach_proc(struct cgroup *cgrp, struct task_struct *leader)
 		oldcg = tsk->cgroups;
 		get_css_set(oldcg);
 		task_unlock(tsk);
-		/* see if the new one for us is already in the list? */
-		if (css_set_check_fetched(cgrp, tsk, oldcg, &newcg_list)) {
-			/* was already there, nothing to do. */
+		/*
+		 * threads nearly always share their css_set, so only look it
+		 * up when it differs from the last one. last_cg keeps its
+		 * reference so that the pointer cannot be reused meanwhile.
+		 */
+		if (oldcg == last_cg) {
 			put_css_set(oldcg);
-		} else {
+			continue;
+		}
+		if (last_cg)
+			put_css_set(last_cg);
+		last_cg = oldcg;
+		/* see if the new one for us is already in the list? */
+		if (!css_set_check_fetched(cgrp, tsk, oldcg, &newcg_list)) {
 			/* we don't already have it. get new one. */
 			retval = css_set_prefetch(cgrp, oldcg, &newcg_list);
-			put_css_set(oldcg);
 			if (retval)
 				goto out_list_teardown;
 		}
@@ -2162,12 +2189,14 @@ int cgroup_attach_proc(struct cgroup *cgrp, struct task_struct *leader)
 	}
 
 	/*
-	 * step 5: success! and cleanup
+	 * step 5: success! and cleanup. no grace period is needed here, the
+	 * old css_sets are freed from call_rcu() once they are unused.
 	 */
-	synchronize_rcu();
 	cgroup_wakeup_rmdir_waiter(cgrp);
 	retval = 0;
 out_list_teardown:
+	if (last_cg)
+		put_css_set(last_cg);
 	/* clean up the list of prefetched css_sets. */
 	list_for_each_entry_safe(cg_entry, temp_nobe, &newcg_list, links) {
 		list_del(&cg_entry->links);
@@ -2215,6 +2244,25 @@ static int cgroup_allow_attach(struct cgroup *cgrp, struct task_struct *tsk)
 	return 0;
 }
 
+/* Call holding cgroup_mutex */
+static void cgroup_account_attach(struct cgroup *cgrp, bool threadgroup,
+				  unsigned int threads, u64 ns)
+{
+	struct cgroup_attach_stats *st;
+	u64 limit = 10 * NSEC_PER_USEC;
+	int b;
+
+	st = &cgrp->root->attach_stats[threadgroup];
+	st->count++;
+	st->threads += threads;
+	st->total_ns += ns;
+	if (ns > st->max_ns)
+		st->max_ns = ns;
+	for (b = 0; b < CGROUP_ATTACH_BUCKETS - 1 && ns >= limit; b++)
+		limit *= 10;
+	st->hist[b]++;
+}
+
 /*
  * Find the task_struct of the task to attach by vpid and pass it along to the
  * function to attach either it or all tasks in its threadgroup. Will take
@@ -2224,6 +2272,8 @@ static int attach_task_by_pid(struct cgroup *cgrp, u64 pid, bool threadgroup)
 {
 	struct task_struct *tsk;
 	const struct cred *cred = current_cred(), *tcred;
+	u64 start = local_clock();
+	unsigned int threads = 1;
 	int ret;
 
 	if (!cgroup_lock_live_group(cgrp))
@@ -2283,12 +2333,16 @@ static int attach_task_by_pid(struct cgroup *cgrp, u64 pid, bool threadgroup)
 
 	if (threadgroup) {
 		threadgroup_fork_write_lock(tsk);
+		threads = get_nr_threads(tsk);
 		ret = cgroup_attach_proc(cgrp, tsk);
 		threadgroup_fork_write_unlock(tsk);
 	} else {
 		ret = cgroup_attach_task(cgrp, tsk);
 	}
 	put_task_struct(tsk);
+	if (!ret)
+		cgroup_account_attach(cgrp, threadgroup, threads,
+				      local_clock() - start);
 	cgroup_unlock();
 	return ret;
 }
@@ -2354,6 +2408,43 @@ static int cgroup_release_agent_show(struct cgroup *cgrp, struct cftype *cft,
 	return 0;
 }
 
+static int cgroup_attach_stats_show(struct cgroup *cgrp, struct cftype *cft,
+				    struct seq_file *seq)
+{
+	static const char * const names[] = { "tasks", "cgroup.procs" };
+	int i, b;
+
+	if (!cgroup_lock_live_group(cgrp))
+		return -ENODEV;
+	seq_printf(seq, "%-12s %8s %8s %8s %8s   %s\n", "file", "writes",
+		   "threads", "avg_us", "max_us",
+		   "<10us <100us <1ms <10ms <100ms >=100ms");
+	for (i = 0; i < 2; i++) {
+		struct cgroup_attach_stats *st = &cgrp->root->attach_stats[i];
+
+		seq_printf(seq, "%-12s %8lu %8lu %8llu %8llu  ", names[i],
+			   st->count, st->threads,
+			   div64_u64(st->total_ns, (u64)(st->count ?: 1) *
+				     NSEC_PER_USEC),
+			   div_u64(st->max_ns, NSEC_PER_USEC));
+		for (b = 0; b < CGROUP_ATTACH_BUCKETS; b++)
+			seq_printf(seq, " %lu", st->hist[b]);
+		seq_putc(seq, '\n');
+	}
+	cgroup_unlock();
+	return 0;
+}
+
+static int cgroup_attach_stats_reset(struct cgroup *cgrp, struct cftype *cft,
+				     u64 val)
+{
+	if (!cgroup_lock_live_group(cgrp))
+		return -ENODEV;
+	memset(cgrp->root->attach_stats, 0, sizeof(cgrp->root->attach_stats));
+	cgroup_unlock();
+	return 0;
+}
+
 /* A buffer size big enough for numbers or short strings */
 #define CGROUP_LOCAL_BUFFER_SIZE 64
 
@@ -3694,6 +3785,12 @@ static struct cftype cft_release_agent = {
 	.max_write_len = PATH_MAX,
 };
 
+static struct cftype cft_attach_stats = {
+	.name = CGROUP_FILE_GENERIC_PREFIX "attach_stats",
+	.read_seq_string = cgroup_attach_stats_show,
+	.write_u64 = cgroup_attach_stats_reset,
+};
+
 static int cgroup_populate_dir(struct cgroup *cgrp)
 {
 	int err;
@@ -3709,6 +3806,9 @@ static int cgroup_populate_dir(struct cgroup *cgrp)
 	if (cgrp == cgrp->top_cgroup) {
 		if ((err = cgroup_add_file(cgrp, NULL, &cft_release_agent)) < 0)
 			return err;
+		err = cgroup_add_file(cgrp, NULL, &cft_attach_stats);
+		if (err < 0)
+			return err;
 	}
 
 	for_each_subsys(cgrp->root, ss) {
@@ -21,6 +21,10 @@
 #include <linux/uaccess.h>
 #include <linux/freezer.h>
 #include <linux/seq_file.h>
+#include <linux/eventfd.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/workqueue.h>
 
 enum freezer_state {
 	CGROUP_THAWED = 0,
@@ -28,10 +32,28 @@ enum freezer_state {
 	CGROUP_FROZEN,
 };
 
+struct freezer_event {
+	struct eventfd_ctx *eventfd;
+	struct list_head list;
+};
+
 struct freezer {
 	struct cgroup_subsys_state css;
 	enum freezer_state state;
 	spinlock_t lock; /* protects _writes_ to state */
+
+	/* FREEZING -> FROZEN once the last task is in the refrigerator */
+	struct work_struct check_work;
+	struct list_head events;	/* signalled on FROZEN */
+	ktime_t freeze_start;
+
+	/* under lock */
+	unsigned long nr_freezes;
+	unsigned long nr_thaws;
+	u64 freeze_total_us;
+	unsigned long freeze_last_us;
+	unsigned long freeze_max_us;
+	unsigned long thaw_max_us;
 };
 
 static inline struct freezer *cgroup_freezer(
@@ -132,7 +154,15 @@ struct cgroup_subsys freezer_subsys;
  *   read_lock css_set_lock (cgroup iterator start)
  *    task->alloc_lock (inside thaw_process(), prevents race with refrigerator())
  *     sighand->siglock
+ *
+ * freezer_check_work() (runs without cgroup_mutex, flushed in destroy):
+ * freezer->lock
+ *  write_lock css_set_lock (cgroup iterator start)
+ *   task->alloc_lock
+ *  read_lock css_set_lock (cgroup iterator start)
  */
+static void freezer_check_work(struct work_struct *work);
+
 static struct cgroup_subsys_state *freezer_create(struct cgroup_subsys *ss,
 						  struct cgroup *cgroup)
 {
@@ -144,13 +174,19 @@ static struct cgroup_subsys_state *freezer_create(struct cgroup_subsys *ss,
 
 	spin_lock_init(&freezer->lock);
 	freezer->state = CGROUP_THAWED;
+	INIT_WORK(&freezer->check_work, freezer_check_work);
+	INIT_LIST_HEAD(&freezer->events);
 	return &freezer->css;
 }
 
 static void freezer_destroy(struct cgroup_subsys *ss,
 			    struct cgroup *cgroup)
 {
-	kfree(cgroup_freezer(cgroup));
+	struct freezer *freezer = cgroup_freezer(cgroup);
+
+	/* the cgroup is empty, so nothing can queue it again */
+	cancel_work_sync(&freezer->check_work);
+	kfree(freezer);
 }
 
 /* task is frozen or will freeze immediately when next it gets woken */
@@ -224,6 +260,27 @@ static void freezer_fork(struct cgroup_subsys *ss, struct task_struct *task)
 	spin_unlock_irq(&freezer->lock);
 }
 
+/*
+ * caller must hold freezer->lock
+ */
+static void freezer_frozen(struct freezer *freezer)
+{
+	struct freezer_event *ev;
+	unsigned long us;
+
+	freezer->state = CGROUP_FROZEN;
+
+	us = ktime_to_us(ktime_sub(ktime_get(), freezer->freeze_start));
+	freezer->nr_freezes++;
+	freezer->freeze_total_us += us;
+	freezer->freeze_last_us = us;
+	if (us > freezer->freeze_max_us)
+		freezer->freeze_max_us = us;
+
+	list_for_each_entry(ev, &freezer->events, list)
+		eventfd_signal(ev->eventfd, 1);
+}
+
 /*
  * caller must hold freezer->lock
  */
@@ -246,7 +303,7 @@ static void update_if_frozen(struct cgroup *cgroup,
 		BUG_ON(nfrozen > 0);
 	} else if (old_state == CGROUP_FREEZING) {
 		if (nfrozen == ntotal)
-			freezer->state = CGROUP_FROZEN;
+			freezer_frozen(freezer);
 	} else { /* old_state == CGROUP_FROZEN */
 		BUG_ON(nfrozen != ntotal);
 	}
@@ -254,6 +311,33 @@ static void update_if_frozen(struct cgroup *cgroup,
 	cgroup_iter_end(cgroup, &it);
 }
 
+static void freezer_check_work(struct work_struct *work)
+{
+	struct freezer *freezer = container_of(work, struct freezer,
+					       check_work);
+
+	spin_lock_irq(&freezer->lock);
+	if (freezer->state == CGROUP_FREEZING)
+		update_if_frozen(freezer->css.cgroup, freezer);
+	spin_unlock_irq(&freezer->lock);
+}
+
+/*
+ * Called by every task entering the refrigerator.  Rather than leave
+ * FREEZING to be noticed by the next read of freezer.state, check the
+ * whole cgroup from a work item; it is queued at most once at a time.
+ */
+void cgroup_freezer_task_frozen(struct task_struct *task)
+{
+	struct freezer *freezer;
+
+	rcu_read_lock();
+	freezer = task_freezer(task);
+	if (freezer->state == CGROUP_FREEZING)
+		schedule_work(&freezer->check_work);
+	rcu_read_unlock();
+}
+
 static int freezer_read(struct cgroup *cgroup, struct cftype *cft,
 			struct seq_file *m)
 {
@@ -286,9 +370,18 @@ static int try_to_freeze_cgroup(struct cgroup *cgroup, struct freezer *freezer)
 	struct task_struct *task;
 	unsigned int num_cant_freeze_now = 0;
 
+	if (freezer->state == CGROUP_THAWED)
+		freezer->freeze_start = ktime_get();
 	freezer->state = CGROUP_FREEZING;
 	cgroup_iter_start(cgroup, &it);
 	while ((task = cgroup_iter_next(cgroup, &it))) {
+		/*
+		 * Already told to freeze: its fake signal stays pending until
+		 * it reaches the refrigerator, so writing FROZEN again while
+		 * FREEZING does not wake every task a second time.
+		 */
+		if (freezing(task))
+			continue;
 		if (!freeze_task(task, true))
 			continue;
 		if (is_task_frozen_enough(task))
@@ -305,6 +398,8 @@ static void unfreeze_cgroup(struct cgroup *cgroup, struct freezer *freezer)
 {
 	struct cgroup_iter it;
 	struct task_struct *task;
+	ktime_t start = ktime_get();
+	unsigned long us;
 
 	cgroup_iter_start(cgroup, &it);
 	while ((task = cgroup_iter_next(cgroup, &it))) {
@@ -313,6 +408,11 @@ static void unfreeze_cgroup(struct cgroup *cgroup, struct freezer *freezer)
 	cgroup_iter_end(cgroup, &it);
 
 	freezer->state = CGROUP_THAWED;
+
+	us = ktime_to_us(ktime_sub(ktime_get(), start));
+	freezer->nr_thaws++;
+	if (us > freezer->thaw_max_us)
+		freezer->thaw_max_us = us;
 }
 
 static int freezer_change_state(struct cgroup *cgroup,
@@ -366,11 +466,83 @@ static int freezer_write(struct cgroup *cgroup,
 	return retval;
 }
 
+/*
+ * Writing "<fd> <freezer.state fd>" to cgroup.event_control signals the
+ * eventfd each time the cgroup reaches FROZEN, so userspace need not
+ * poll freezer.state.
+ */
+static int freezer_register_event(struct cgroup *cgroup, struct cftype *cft,
+				  struct eventfd_ctx *eventfd, const char *args)
+{
+	struct freezer *freezer = cgroup_freezer(cgroup);
+	struct freezer_event *ev;
+
+	ev = kmalloc(sizeof(*ev), GFP_KERNEL);
+	if (!ev)
+		return -ENOMEM;
+	ev->eventfd = eventfd;
+
+	spin_lock_irq(&freezer->lock);
+	list_add(&ev->list, &freezer->events);
+	if (freezer->state == CGROUP_FROZEN)
+		eventfd_signal(eventfd, 1);
+	spin_unlock_irq(&freezer->lock);
+	return 0;
+}
+
+static void freezer_unregister_event(struct cgroup *cgroup, struct cftype *cft,
+				     struct eventfd_ctx *eventfd)
+{
+	struct freezer *freezer = cgroup_freezer(cgroup);
+	struct freezer_event *ev, *tmp;
+
+	spin_lock_irq(&freezer->lock);
+	list_for_each_entry_safe(ev, tmp, &freezer->events, list) {
+		if (ev->eventfd == eventfd) {
+			list_del(&ev->list);
+			kfree(ev);
+		}
+	}
+	spin_unlock_irq(&freezer->lock);
+}
+
+static int freezer_stats_read(struct cgroup *cgroup, struct cftype *cft,
+			      struct cgroup_map_cb *cb)
+{
+	struct freezer *freezer = cgroup_freezer(cgroup);
+	unsigned long nr_freezes, nr_thaws, last_us, max_us, thaw_max_us;
+	u64 total_us;
+
+	spin_lock_irq(&freezer->lock);
+	nr_freezes = freezer->nr_freezes;
+	nr_thaws = freezer->nr_thaws;
+	total_us = freezer->freeze_total_us;
+	last_us = freezer->freeze_last_us;
+	max_us = freezer->freeze_max_us;
+	thaw_max_us = freezer->thaw_max_us;
+	spin_unlock_irq(&freezer->lock);
+
+	cb->fill(cb, "freezes", nr_freezes);
+	cb->fill(cb, "thaws", nr_thaws);
+	cb->fill(cb, "freeze_last_us", last_us);
+	cb->fill(cb, "freeze_avg_us",
+		 nr_freezes ? div_u64(total_us, nr_freezes) : 0);
+	cb->fill(cb, "freeze_max_us", max_us);
+	cb->fill(cb, "thaw_max_us", thaw_max_us);
+	return 0;
+}
+
 static struct cftype files[] = {
 	{
 		.name = "state",
 		.read_seq_string = freezer_read,
 		.write_string = freezer_write,
+		.register_event = freezer_register_event,
+		.unregister_event = freezer_unregister_event,
+	},
+	{
+		.name = "stats",
+		.read_map = freezer_stats_read,
 	},
 };
 
@@ -629,6 +629,10 @@ static DECLARE_BITMAP(cpu_active_bits, CONFIG_NR_CPUS) __read_mostly;
 const struct cpumask *const cpu_active_mask = to_cpumask(cpu_active_bits);
 EXPORT_SYMBOL(cpu_active_mask);
 
+static DECLARE_BITMAP(cpu_parked_bits, CONFIG_NR_CPUS) __read_mostly;
+const struct cpumask *const cpu_parked_mask = to_cpumask(cpu_parked_bits);
+EXPORT_SYMBOL(cpu_parked_mask);
+
 void set_cpu_possible(unsigned int cpu, bool possible)
 {
 	if (possible)
@@ -661,6 +665,14 @@ void set_cpu_active(unsigned int cpu, bool active)
 		cpumask_clear_cpu(cpu, to_cpumask(cpu_active_bits));
 }
 
+void set_cpu_parked(unsigned int cpu, bool parked)
+{
+	if (parked)
+		cpumask_set_cpu(cpu, to_cpumask(cpu_parked_bits));
+	else
+		cpumask_clear_cpu(cpu, to_cpumask(cpu_parked_bits));
+}
+
 void init_cpu_present(const struct cpumask *src)
 {
 	cpumask_copy(to_cpumask(cpu_present_bits), src);
@@ -66,6 +66,10 @@
 
 int __read_mostly futex_cmpxchg_enabled;
 
+/* Upper bound on one FUTEX_WAIT_ADAPTIVE spin, in microseconds */
+static unsigned int futex_spin_max_us = 100;
+module_param_named(spin_max_us, futex_spin_max_us, uint, 0644);
+
 #define FUTEX_HASHBITS (CONFIG_BASE_SMALL ? 4 : 8)
 
 /*
@@ -2009,6 +2013,8 @@ retry:
 	if (ret)
 		goto out;
 
+	atomic_long_inc(&current->signal->futex_sleeps);
+
 	/* queue_me and wait for wakeup, timeout, or a signal. */
 	futex_wait_queue_me(hb, &q, to);
 
@@ -2066,6 +2072,89 @@ static long futex_wait_restart(struct restart_block *restart)
 				restart->futex.val, tp, restart->futex.bitset);
 }
 
+#ifdef CONFIG_SMP
+/*
+ * Spin while the futex still holds @val and its owner is running on
+ * another cpu, the same bet kernel/mutex.c makes for kernel mutexes: a
+ * running owner is likely to release soon, and a sleep/wakeup round trip
+ * costs far more than a short spin.  Gives up on need_resched(), when the
+ * owner is preempted or blocks, or after futex_spin_max_us.
+ *
+ * Returns 1 if the futex value changed, 0 if the caller should sleep.
+ */
+static int futex_spin_on_owner(u32 __user *uaddr, u32 val, pid_t tid)
+{
+	struct task_struct *owner;
+	u64 start, limit;
+	u32 uval;
+	int ret = 0;
+
+	rcu_read_lock();
+	owner = find_task_by_vpid(tid);
+	if (owner)
+		get_task_struct(owner);
+	rcu_read_unlock();
+	if (!owner)
+		return 0;
+	if (owner == current)
+		goto out;
+
+	start = local_clock();
+	limit = (u64)futex_spin_max_us * NSEC_PER_USEC;
+	for (;;) {
+		if (get_futex_value_locked(&uval, uaddr))
+			break;
+		if (uval != val) {
+			ret = 1;
+			break;
+		}
+		if (!owner->on_cpu || need_resched())
+			break;
+		if (local_clock() - start > limit)
+			break;
+		cpu_relax();
+	}
+	atomic64_add(local_clock() - start, &current->signal->futex_spin_ns);
+out:
+	put_task_struct(owner);
+	return ret;
+}
+#else
+static inline int futex_spin_on_owner(u32 __user *uaddr, u32 val, pid_t tid)
+{
+	return 0;
+}
+#endif
+
+/*
+ * FUTEX_WAIT with an adaptive spin in front of it.  @tid names the lock
+ * owner; if zero it is taken from the FUTEX_TID_MASK bits of the futex
+ * word, as for PI futexes.  Like FUTEX_WAIT, returns -EWOULDBLOCK once the
+ * value no longer matches @val, which here means the owner let go while we
+ * spun and userspace should retry the acquire.
+ */
+static int futex_wait_adaptive(u32 __user *uaddr, unsigned int flags, u32 val,
+			       ktime_t *abs_time, u32 tid)
+{
+	struct signal_struct *sig = current->signal;
+
+	if (((unsigned long)uaddr % sizeof(u32)) ||
+	    !access_ok(VERIFY_READ, uaddr, sizeof(u32)))
+		return -EINVAL;
+
+	if (!tid)
+		tid = val & FUTEX_TID_MASK;
+	if (tid && futex_spin_max_us) {
+		if (futex_spin_on_owner(uaddr, val, tid)) {
+			atomic_long_inc(&sig->futex_spin_acquired);
+			return -EWOULDBLOCK;
+		}
+		atomic_long_inc(&sig->futex_spin_failed);
+	}
+
+	return futex_wait(uaddr, flags, val, abs_time, FUTEX_BITSET_MATCH_ANY);
+}
+
 
 /*
  * Userspace tried a 0 -> TID atomic transition of the futex value
@@ -2798,6 +2887,9 @@ long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 	case FUTEX_CMP_REQUEUE_PI:
 		ret = futex_requeue(uaddr, flags, uaddr2, val, val2, &val3, 1);
 		break;
+	case FUTEX_WAIT_ADAPTIVE:
+		ret = futex_wait_adaptive(uaddr, flags, val, timeout, val3);
+		break;
 	default:
 		ret = -ENOSYS;
 	}
@@ -2816,14 +2908,15 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_ADAPTIVE)) {
 		if (copy_from_user(&ts, utime, sizeof(ts)) != 0)
 			return -EFAULT;
 		if (!timespec_valid(&ts))
 			return -EINVAL;
 
 		t = timespec_to_ktime(ts);
-		if (cmd == FUTEX_WAIT)
+		if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_ADAPTIVE)
 			t = ktime_add_safe(ktime_get(), t);
 		tp = &t;
 	}
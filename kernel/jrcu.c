@@ -70,8 +70,10 @@
 #include <linux/preempt.h>
 #include <linux/uaccess.h>
 #include <linux/compiler.h>
+#include <linux/spinlock.h>
 #include <linux/irqflags.h>
 #include <linux/rcupdate.h>
+#include <linux/math64.h>
 
 #include <asm/system.h>
 
@@ -150,6 +152,11 @@ static struct rcu_stats {
        atomic_t nsyncs;        /* #rcu syncs processed */
        s64 ninvoked;           /* #invoked (ie, finished) callbacks */
        unsigned nforced;       /* #forced eobs (should be zero) */
+       unsigned ncbbatches;    /* #eobs that retired callbacks */
+       unsigned maxbatch;      /* most callbacks retired by one eob */
+       s64 gp_ns;              /* summed grace periods of those eobs */
+       s64 gp_max_ns;          /* longest of them */
+       unsigned noffloaded;    /* #eobs handed to the offload thread */
 } rcu_stats;
 
 #define RCU_HZ                 (20)
@@ -161,12 +168,40 @@ static int rcu_hz_delta_us = RCU_HZ_DELTA_US;
 
 static int rcu_hz_precise;
 
+/*
+ * The frame period stretches, doubling on every pass that finds no
+ * callbacks queued, up to rcu_idle_period_us; an idle system then wakes
+ * jrcud a few times a second rather than RCU_HZ times.  Any queued
+ * callback puts it back to rcu_hz_period_us, and synchronize_sched()
+ * also cuts the current sleep short.
+ */
+#define RCU_IDLE_PERIOD_US     (USEC_PER_SEC)
+
+static int rcu_idle_period_us = RCU_IDLE_PERIOD_US;
+static int rcu_cur_period_us = RCU_HZ_PERIOD_US;
+
+/* when the batch in each of ->cblist[] was opened, for the gp stats */
+static ktime_t rcu_batch_start[2];
+
+/*
+ * Callbacks retired by an end-of-batch are handed to jrcuo, which can be
+ * kept off the cpus that run latency sensitive work, instead of being
+ * invoked by whoever drives the frames.
+ */
+static int rcu_offload = 1;
+static int rcu_offload_cpu = -1;       /* -1: any cpu */
+static struct task_struct *rcu_offload_task;
+static struct rcu_list rcu_offload_list;
+static DEFINE_RAW_SPINLOCK(rcu_offload_lock);
+
 int rcu_scheduler_active __read_mostly;
 int rcu_nmi_seen __read_mostly;
 
 static int rcu_wdog_ctr;       /* time since last end-of-batch, in usecs */
 static int rcu_wdog_lim = 10 * USEC_PER_SEC;   /* rcu watchdog interval */
 
+static void rcu_kick(void);
+
 /*
  * Return our CPU id or zero if we are too early in the boot process to
  * know what that is.  For RCU to work correctly, a cpu named '0' must
@@ -241,6 +276,7 @@ void synchronize_sched(void)
 
        init_completion(&rcu.completion);
        call_rcu(&rcu.head, wakeme_after_rcu);
+       rcu_kick();
        wait_for_completion(&rcu.completion);
        atomic_inc(&rcu_stats.nsyncs);
 
@@ -326,6 +362,7 @@ static void __rcu_delimit_batches(struct rcu_list *pending)
 {
        struct rcu_data *rd;
        struct rcu_list *plist;
+       ktime_t now;
        int cpu, eob, prev;
 
        if (!rcu_scheduler_active)
@@ -371,7 +408,7 @@ static void __rcu_delimit_batches(struct rcu_list *pending)
                                        force_cpu_resched(cpu);
                        }
                }
-               rcu_wdog_ctr += rcu_hz_period_us;
+               rcu_wdog_ctr += rcu_cur_period_us;
                return;
        }
 
@@ -413,11 +450,48 @@ static void __rcu_delimit_batches(struct rcu_list *pending)
         */
        xchg(&rcu_which, prev); /* only place where rcu_which is written to */
 
+       now = ktime_get();
+       if (pending->count) {
+               s64 gp = ktime_to_ns(ktime_sub(now, rcu_batch_start[prev]));
+
+               rcu_stats.ncbbatches++;
+               rcu_stats.maxbatch = max_t(unsigned, rcu_stats.maxbatch,
+                                          pending->count);
+               rcu_stats.gp_ns += gp;
+               rcu_stats.gp_max_ns = max(rcu_stats.gp_max_ns, gp);
+       }
+       rcu_batch_start[prev] = now;
+
        rcu_stats.nbatches++;
        rcu_stats.nlast = 0;
        rcu_wdog_ctr = 0;
 }
 
+static int rcu_callbacks_queued(void)
+{
+       int cpu;
+
+       for_each_present_cpu(cpu)
+               if (rcu_data[cpu].cblist[0].count ||
+                   rcu_data[cpu].cblist[1].count)
+                       return 1;
+       return 0;
+}
+
+/* pick the next frame period, see rcu_idle_period_us */
+static void rcu_adapt_period(int retired)
+{
+       int period = rcu_cur_period_us * 2;
+
+       if (retired || rcu_callbacks_queued())
+               period = rcu_hz_period_us;
+       else if (period > rcu_idle_period_us)
+               period = rcu_idle_period_us;
+       if (period < rcu_hz_period_us)
+               period = rcu_hz_period_us;
+       rcu_cur_period_us = period;
+}
+
 static void rcu_delimit_batches(void)
 {
        unsigned long flags;
@@ -432,8 +506,17 @@ static void rcu_delimit_batches(void)
        smp_mb();
        raw_local_irq_restore(flags);
 
-       if (pending.head)
-               rcu_invoke_callbacks(&pending);
+       if (pending.head) {
+               if (rcu_offload && rcu_offload_task) {
+                       raw_spin_lock_irqsave(&rcu_offload_lock, flags);
+                       rcu_list_join(&rcu_offload_list, &pending);
+                       raw_spin_unlock_irqrestore(&rcu_offload_lock, flags);
+                       rcu_stats.noffloaded++;
+                       wake_up_process(rcu_offload_task);
+               } else
+                       rcu_invoke_callbacks(&pending);
+       }
+       rcu_adapt_period(pending.count);
 }
 
 /* ------------------ interrupt driver section ------------------ */
@@ -449,6 +532,7 @@ static void rcu_delimit_batches(void)
 #include <linux/interrupt.h>
 
 #define rcu_hz_period_ns       (rcu_hz_period_us * NSEC_PER_USEC)
+#define rcu_cur_period_ns      (rcu_cur_period_us * NSEC_PER_USEC)
 #define rcu_hz_delta_ns                (rcu_hz_delta_us * NSEC_PER_USEC)
 
 static struct hrtimer rcu_timer;
@@ -464,7 +548,7 @@ static enum hrtimer_restart rcu_timer_func(struct hrtimer *t)
 
        raise_softirq(RCU_SOFTIRQ);
 
-       next = ktime_add_ns(ktime_get(), rcu_hz_period_ns);
+       next = ktime_add_ns(ktime_get(), rcu_cur_period_ns);
        hrtimer_set_expires_range_ns(&rcu_timer, next,
                rcu_hz_precise ? 0 : rcu_hz_delta_ns);
        return HRTIMER_RESTART;
@@ -472,7 +556,7 @@ static enum hrtimer_restart rcu_timer_func(struct hrtimer *t)
 
 static void rcu_timer_start(void)
 {
-       hrtimer_forward_now(&rcu_timer, ns_to_ktime(rcu_hz_period_ns));
+       hrtimer_forward_now(&rcu_timer, ns_to_ktime(rcu_cur_period_ns));
        hrtimer_start_expires(&rcu_timer, HRTIMER_MODE_ABS);
 }
 
@@ -496,10 +580,72 @@ void __init rcu_scheduler_starting(void)
        rcu_timer_init();
 }
 
+/* ------------------ callback offload section ------------------ */
+
+#include <linux/err.h>
+#include <linux/kthread.h>
+
+static int jrcuo_func(void *arg)
+{
+       struct rcu_list list;
+
+       current->flags |= PF_NOFREEZE;
+
+       while (!kthread_should_stop()) {
+               set_current_state(TASK_INTERRUPTIBLE);
+               raw_spin_lock_irq(&rcu_offload_lock);
+               list = rcu_offload_list;
+               rcu_list_init(&rcu_offload_list);
+               raw_spin_unlock_irq(&rcu_offload_lock);
+
+               if (!list.head) {
+                       schedule();
+                       continue;
+               }
+               __set_current_state(TASK_RUNNING);
+
+               /* callbacks may expect the softirq context they get elsewhere */
+               local_bh_disable();
+               rcu_invoke_callbacks(&list);
+               local_bh_enable();
+               cond_resched();
+       }
+       return 0;
+}
+
+static int rcu_offload_set_cpu(int cpu)
+{
+       if (cpu >= 0 && !cpu_online(cpu))
+               return -EINVAL;
+       rcu_offload_cpu = cpu;
+       if (!rcu_offload_task)
+               return 0;
+       return set_cpus_allowed_ptr(rcu_offload_task,
+               cpu < 0 ? cpu_possible_mask : cpumask_of(cpu));
+}
+
+static void __init rcu_offload_start(void)
+{
+       struct task_struct *p;
+
+       rcu_list_init(&rcu_offload_list);
+       p = kthread_run(jrcuo_func, NULL, "jrcuo");
+       if (IS_ERR(p)) {
+               pr_warn("JRCU: no offload thread, invoking callbacks inline\n");
+               return;
+       }
+       rcu_offload_task = p;
+}
+
 #ifndef CONFIG_JRCU_DAEMON
 
+static void rcu_kick(void)
+{
+}
+
 void __init int rcu_start_callback_processing(void)
 {
+       rcu_offload_start();
        rcu_timer_start();
        rcu_scheduler_active = 1;
 
@@ -516,12 +662,23 @@ void __init int rcu_start_callback_processing(void)
  * of JRCU from a kernel daemon, jrcud.  Until then it is driven by
  * an interrupt.
  */
-#include <linux/err.h>
 #include <linux/param.h>
-#include <linux/kthread.h>
 
 static int rcu_priority;
 static struct task_struct *rcu_daemon;
+static int rcu_kicked;
+
+/* start a normal frame now rather than at the end of a stretched one */
+static void rcu_kick(void)
+{
+       struct task_struct *p = ACCESS_ONCE(rcu_daemon);
+
+       if (rcu_cur_period_us == rcu_hz_period_us || !p)
+               return;
+       rcu_cur_period_us = rcu_hz_period_us;
+       rcu_kicked = 1;
+       wake_up_process(p);
+}
 
 static int jrcu_set_priority(int priority)
 {
@@ -550,13 +707,18 @@ static int jrcud_func(void *arg)
        pr_info("JRCU: callback processing via daemon started.\n");
 
        while (!kthread_should_stop()) {
-               if (rcu_hz_precise) {
-                       usleep_range(rcu_hz_period_us,
-                               rcu_hz_period_us);
-               } else {
+               int period = ACCESS_ONCE(rcu_cur_period_us);
+
+               usleep_range(period,
+                       period + (rcu_hz_precise ? 0 : rcu_hz_delta_us));
+               /*
+                * Woken early by rcu_kick(): the previous batch still needs a
+                * full frame to become quiescent, so take a normal one now.
+                */
+               if (xchg(&rcu_kicked, 0))
                        usleep_range(rcu_hz_period_us,
-                               rcu_hz_period_us + rcu_hz_delta_us);
-               }
+                               rcu_hz_period_us +
+                               (rcu_hz_precise ? 0 : rcu_hz_delta_us));
                rcu_delimit_batches();
        }
 
@@ -577,6 +739,7 @@ static __init int rcu_start_callback_processing(void)
                return -ENODEV;
        }
        rcu_daemon = p;
+       rcu_offload_start();
        rcu_scheduler_active = 1;
 
        pr_info("JRCU: callback processing now allowed.\n");
@@ -600,6 +763,7 @@ static int rcu_debugfs_show(struct seq_file *m, void *unused)
 {
        int cpu, q;
        s64 nqueued;
+       unsigned nb = rcu_stats.ncbbatches;
 
        nqueued = 0;
        for_each_present_cpu(cpu)
@@ -609,6 +773,10 @@ static int rcu_debugfs_show(struct seq_file *m, void *unused)
                rcu_hz,
                rcu_hz_precise ? "precise" : "sloppy");
 
+       seq_printf(m, "%14u: idle period (msecs)\n",
+               rcu_idle_period_us / (int)USEC_PER_MSEC);
+       seq_printf(m, "%14u: current period (msecs)\n",
+               rcu_cur_period_us / (int)USEC_PER_MSEC);
        seq_printf(m, "%14u: watchdog (secs)\n", rcu_wdog_lim / (int)USEC_PER_SEC);
        seq_printf(m, "%14d: #secs left on watchdog\n",
                (rcu_wdog_lim - rcu_wdog_ctr) / (int)USEC_PER_SEC);
@@ -619,6 +787,12 @@ static int rcu_debugfs_show(struct seq_file *m, void *unused)
        else
                seq_printf(m, "%14s: daemon priority\n", "none, no daemon");
 #endif
+       if (!rcu_offload || !rcu_offload_task)
+               seq_printf(m, "%14s: offload\n", "off");
+       else if (rcu_offload_cpu < 0)
+               seq_printf(m, "%14s: offload cpu\n", "any");
+       else
+               seq_printf(m, "%14d: offload cpu\n", rcu_offload_cpu);
 
        seq_printf(m, "\n");
        seq_printf(m, "%14u: #passes\n",
@@ -643,6 +817,18 @@ static int rcu_debugfs_show(struct seq_file *m, void *unused)
                rcu_stats.ninvoked);
        seq_printf(m, "%14d: #callbacks left to invoke\n",
                (int)(nqueued - rcu_stats.ninvoked));
+       seq_printf(m, "%14u: #end-of-batches retiring callbacks\n",
+               rcu_stats.ncbbatches);
+       seq_printf(m, "%14u: #end-of-batches offloaded\n",
+               rcu_stats.noffloaded);
+       seq_printf(m, "%14llu: avg callbacks per batch\n",
+               nb ? div_u64(rcu_stats.ninvoked, nb) : 0);
+       seq_printf(m, "%14u: max callbacks per batch\n",
+               rcu_stats.maxbatch);
+       seq_printf(m, "%14llu: avg grace period (usecs)\n",
+               nb ? div_u64(div_u64(rcu_stats.gp_ns, nb), NSEC_PER_USEC) : 0);
+       seq_printf(m, "%14llu: max grace period (usecs)\n",
+               div_u64(rcu_stats.gp_max_ns, NSEC_PER_USEC));
        seq_printf(m, "\n");
 
        for_each_online_cpu(cpu)
@@ -727,6 +913,20 @@ next:
                if (wdog < 3 || wdog > 1000)
                        return -EINVAL;
                rcu_wdog_lim = wdog * USEC_PER_SEC;
+       } else if (!strncmp(token, "idle_ms=", 8)) {
+               int idle_ms = -1;
+               sscanf(&token[8], "%d", &idle_ms);
+               if (idle_ms < 0 || idle_ms > 10000)
+                       return -EINVAL;
+               rcu_idle_period_us = idle_ms * USEC_PER_MSEC;
+       } else if (!strncmp(token, "offload=", 8)) {
+               sscanf(&token[8], "%d", &rcu_offload);
+       } else if (!strncmp(token, "offload_cpu=", 12)) {
+               int ocpu = -2;
+               sscanf(&token[12], "%d", &ocpu);
+               if (ocpu < -1 || ocpu >= nr_cpu_ids ||
+                   rcu_offload_set_cpu(ocpu))
+                       return -EINVAL;
        } else
                return -EINVAL;
        goto next;
@@ -0,0 +1,248 @@
+/*
+ * kernel/lock_profile.c
+ *
+ * Sampled lock contention profiler, cheap enough to leave on.
+ *
+ * lock_stat needs lockdep and hooks every acquisition.  This only hooks
+ * the slowpaths of spinlocks, rwlocks, mutexes and rwsems, which are
+ * reached when the lock was found taken, and of those only one in
+ * lock_profile/sample_period is timed.  A sampled contention is added
+ * to a small per-cpu table keyed by lock, callsite and lock type, with
+ * interrupts off and no locks taken, so it is safe from any context the
+ * lock itself is.
+ *
+ * debugfs lock_profile/contention merges the per-cpu tables and lists
+ * the entries with the most total wait.  Writing to it clears them.
+ * Callsites are symbolized; static locks also are with KALLSYMS_ALL.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/smp.h>
+#include <linux/hash.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+#include <linux/lock_profile.h>
+
+#define LOCK_PROFILE_BITS	7
+#define LOCK_PROFILE_ENTRIES	(1 << LOCK_PROFILE_BITS)
+#define LOCK_PROFILE_BUCKETS	6	/* <1us, <10us, ... , >=10ms */
+#define LOCK_PROFILE_TOP	64
+
+struct lock_profile_entry {
+	void *lock;
+	unsigned long ip;
+	unsigned int type;
+	unsigned int count;
+	u64 wait_ns;
+	u64 max_ns;
+	unsigned int hist[LOCK_PROFILE_BUCKETS];
+};
+
+struct lock_profile_cpu {
+	unsigned int tick;		/* contentions seen, for sampling */
+	unsigned int dropped;		/* samples lost to a full table */
+	struct lock_profile_entry entries[LOCK_PROFILE_ENTRIES];
+};
+
+static DEFINE_PER_CPU(struct lock_profile_cpu, lock_profile_cpu);
+
+/* 0 until debugfs is up, so early boot never gets here */
+static u32 lock_profile_period __read_mostly;
+
+static const char *const lock_profile_names[LOCK_PROFILE_NR_TYPES] = {
+	[LOCK_PROFILE_SPIN]		= "spin",
+	[LOCK_PROFILE_READ]		= "read",
+	[LOCK_PROFILE_WRITE]		= "write",
+	[LOCK_PROFILE_MUTEX]		= "mutex",
+	[LOCK_PROFILE_RWSEM_READ]	= "rwsem_r",
+	[LOCK_PROFILE_RWSEM_WRITE]	= "rwsem_w",
+};
+
+u64 lock_profile_start(void)
+{
+	u32 period = ACCESS_ONCE(lock_profile_period);
+
+	if (!period || this_cpu_inc_return(lock_profile_cpu.tick) % period)
+		return 0;
+	return local_clock() ?: 1;
+}
+
+void lock_profile_contended(void *lock, enum lock_profile_type type,
+			    unsigned long ip, u64 start)
+{
+	struct lock_profile_cpu *pc;
+	struct lock_profile_entry *e;
+	unsigned long h, flags;
+	u64 wait, limit;
+	int i, b;
+
+	if (!start)
+		return;
+	wait = local_clock() - start;
+	h = hash_long((unsigned long)lock ^ ip, LOCK_PROFILE_BITS);
+
+	local_irq_save(flags);
+	pc = &__get_cpu_var(lock_profile_cpu);
+	for (i = 0; i < LOCK_PROFILE_ENTRIES; i++) {
+		e = &pc->entries[(h + i) & (LOCK_PROFILE_ENTRIES - 1)];
+		if (!e->lock || (e->lock == lock && e->ip == ip &&
+				 e->type == type))
+			break;
+	}
+	if (i == LOCK_PROFILE_ENTRIES) {
+		pc->dropped++;
+		goto out;
+	}
+	if (!e->lock) {
+		e->ip = ip;
+		e->type = type;
+		e->lock = lock;
+	}
+
+	limit = NSEC_PER_USEC;
+	for (b = 0; b < LOCK_PROFILE_BUCKETS - 1 && wait >= limit; b++)
+		limit *= 10;
+	e->hist[b]++;
+	e->count++;
+	e->wait_ns += wait;
+	if (wait > e->max_ns)
+		e->max_ns = wait;
+out:
+	local_irq_restore(flags);
+}
+
+static int lock_profile_cmp(const void *a, const void *b)
+{
+	const struct lock_profile_entry *ea = a, *eb = b;
+
+	if (ea->wait_ns == eb->wait_ns)
+		return 0;
+	return ea->wait_ns < eb->wait_ns ? 1 : -1;
+}
+
+static int lock_profile_show(struct seq_file *s, void *unused)
+{
+	struct lock_profile_entry *all, *e, *m;
+	unsigned int dropped = 0;
+	int cpu, i, j, b, n = 0;
+
+	all = vmalloc(num_possible_cpus() * sizeof(*all) *
+		      LOCK_PROFILE_ENTRIES);
+	if (!all)
+		return -ENOMEM;
+
+	/* the other cpus keep updating; a sample in flight may be torn */
+	for_each_possible_cpu(cpu) {
+		struct lock_profile_cpu *pc = &per_cpu(lock_profile_cpu, cpu);
+
+		dropped += pc->dropped;
+		for (i = 0; i < LOCK_PROFILE_ENTRIES; i++) {
+			e = &pc->entries[i];
+			if (!e->lock)
+				continue;
+			for (j = 0; j < n; j++) {
+				m = &all[j];
+				if (m->lock == e->lock && m->ip == e->ip &&
+				    m->type == e->type)
+					break;
+			}
+			m = &all[j];
+			if (j == n) {
+				*m = *e;
+				n++;
+				continue;
+			}
+			m->count += e->count;
+			m->wait_ns += e->wait_ns;
+			m->max_ns = max(m->max_ns, e->max_ns);
+			for (b = 0; b < LOCK_PROFILE_BUCKETS; b++)
+				m->hist[b] += e->hist[b];
+		}
+	}
+
+	sort(all, n, sizeof(*all), lock_profile_cmp, NULL);
+
+	seq_printf(s, "sampling 1 in %u contentions\n", lock_profile_period);
+	seq_printf(s, "%-7s %8s %10s %8s %8s %7s %7s %7s %7s %7s %7s  %s\n",
+		   "type", "samples", "wait_us", "avg_us", "max_us", "<1us",
+		   "<10us", "<100us", "<1ms", "<10ms", ">=10ms",
+		   "lock / callsite");
+	for (i = 0; i < n && i < LOCK_PROFILE_TOP; i++) {
+		e = &all[i];
+		seq_printf(s, "%-7s %8u %10llu %8llu %8llu",
+			   lock_profile_names[e->type], e->count,
+			   div_u64(e->wait_ns, NSEC_PER_USEC),
+			   div_u64(div_u64(e->wait_ns, e->count),
+				   NSEC_PER_USEC),
+			   div_u64(e->max_ns, NSEC_PER_USEC));
+		for (b = 0; b < LOCK_PROFILE_BUCKETS; b++)
+			seq_printf(s, " %7u", e->hist[b]);
+		seq_printf(s, "  %pS / %pS\n", e->lock, (void *)e->ip);
+	}
+	if (dropped)
+		seq_printf(s, "%u samples dropped, per-cpu tables full\n",
+			   dropped);
+
+	vfree(all);
+	return 0;
+}
+
+static void lock_profile_reset_cpu(void *unused)
+{
+	struct lock_profile_cpu *pc = &__get_cpu_var(lock_profile_cpu);
+	unsigned long flags;
+
+	local_irq_save(flags);
+	memset(pc, 0, sizeof(*pc));
+	local_irq_restore(flags);
+}
+
+static ssize_t lock_profile_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	on_each_cpu(lock_profile_reset_cpu, NULL, 1);
+	return count;
+}
+
+static int lock_profile_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lock_profile_show, NULL);
+}
+
+static const struct file_operations lock_profile_fops = {
+	.open		= lock_profile_open,
+	.read		= seq_read,
+	.write		= lock_profile_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init lock_profile_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("lock_profile", NULL);
+	if (!dir)
+		return -ENOMEM;
+	if (!debugfs_create_file("contention", 0644, dir, NULL,
+				 &lock_profile_fops) ||
+	    !debugfs_create_u32("sample_period", 0644, dir,
+				&lock_profile_period)) {
+		debugfs_remove_recursive(dir);
+		return -ENOMEM;
+	}
+
+	lock_profile_period = CONFIG_LOCK_PROFILE_PERIOD;
+	return 0;
+}
+late_initcall(lock_profile_init);
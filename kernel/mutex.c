@@ -23,6 +23,7 @@
 #include <linux/spinlock.h>
 #include <linux/interrupt.h>
 #include <linux/debug_locks.h>
+#include <linux/lock_profile.h>
 
 /*
  * In the DEBUG case we are using the "NULL fastpath" for mutexes,
@@ -36,6 +37,18 @@
 # include <asm/mutex.h>
 #endif
 
+/*
+ * The fastpath calls the slowpath without a frame of its own, so the
+ * profiler takes the caller from the task instead of _RET_IP_:
+ */
+#ifdef CONFIG_LOCK_PROFILE
+# define mutex_profile_set_ip()	(current->lock_profile_ip = _RET_IP_)
+# define mutex_slowpath_ip()	(current->lock_profile_ip)
+#else
+# define mutex_profile_set_ip()	do { } while (0)
+# define mutex_slowpath_ip()	_RET_IP_
+#endif
+
 void
 __mutex_init(struct mutex *lock, const char *name, struct lock_class_key *key)
 {
@@ -83,6 +96,7 @@ __mutex_lock_slowpath(atomic_t *lock_count);
 void __sched mutex_lock(struct mutex *lock)
 {
 	might_sleep();
+	mutex_profile_set_ip();
 	/*
 	 * The locking fastpath is the 1->0 transition from
 	 * 'unlocked' into 'locked' state.
@@ -136,8 +150,10 @@ __mutex_lock_common(struct mutex *lock, long state, unsigned int subclass,
 	struct task_struct *task = current;
 	struct mutex_waiter waiter;
 	unsigned long flags;
+	u64 profile_start;
 
 	preempt_disable();
+	profile_start = lock_profile_start();
 	mutex_acquire_nest(&lock->dep_map, subclass, 0, nest_lock, ip);
 
 #ifdef CONFIG_MUTEX_SPIN_ON_OWNER
@@ -174,6 +190,8 @@ __mutex_lock_common(struct mutex *lock, long state, unsigned int subclass,
 			lock_acquired(&lock->dep_map, ip);
 			mutex_set_owner(lock);
 			preempt_enable();
+			lock_profile_contended(lock, LOCK_PROFILE_MUTEX, ip,
+					       profile_start);
 			return 0;
 		}
 
@@ -260,6 +278,7 @@ done:
 
 	debug_mutex_free_waiter(&waiter);
 	preempt_enable();
+	lock_profile_contended(lock, LOCK_PROFILE_MUTEX, ip, profile_start);
 
 	return 0;
 }
@@ -373,6 +392,7 @@ int __sched mutex_lock_interruptible(struct mutex *lock)
 	int ret;
 
 	might_sleep();
+	mutex_profile_set_ip();
 	ret =  __mutex_fastpath_lock_retval
 			(&lock->count, __mutex_lock_interruptible_slowpath);
 	if (!ret)
@@ -388,6 +408,7 @@ int __sched mutex_lock_killable(struct mutex *lock)
 	int ret;
 
 	might_sleep();
+	mutex_profile_set_ip();
 	ret = __mutex_fastpath_lock_retval
 			(&lock->count, __mutex_lock_killable_slowpath);
 	if (!ret)
@@ -402,7 +423,8 @@ __mutex_lock_slowpath(atomic_t *lock_count)
 {
 	struct mutex *lock = container_of(lock_count, struct mutex, count);
 
-	__mutex_lock_common(lock, TASK_UNINTERRUPTIBLE, 0, NULL, _RET_IP_);
+	__mutex_lock_common(lock, TASK_UNINTERRUPTIBLE, 0, NULL,
+			    mutex_slowpath_ip());
 }
 
 static noinline int __sched
@@ -410,7 +432,8 @@ __mutex_lock_killable_slowpath(atomic_t *lock_count)
 {
 	struct mutex *lock = container_of(lock_count, struct mutex, count);
 
-	return __mutex_lock_common(lock, TASK_KILLABLE, 0, NULL, _RET_IP_);
+	return __mutex_lock_common(lock, TASK_KILLABLE, 0, NULL,
+				   mutex_slowpath_ip());
 }
 
 static noinline int __sched
@@ -418,7 +441,8 @@ __mutex_lock_interruptible_slowpath(atomic_t *lock_count)
 {
 	struct mutex *lock = container_of(lock_count, struct mutex, count);
 
-	return __mutex_lock_common(lock, TASK_INTERRUPTIBLE, 0, NULL, _RET_IP_);
+	return __mutex_lock_common(lock, TASK_INTERRUPTIBLE, 0, NULL,
+				   mutex_slowpath_ip());
 }
 #endif
 
@@ -13,9 +13,12 @@
  *
  */
 
+#include <linux/async.h>
+#include <linux/debugfs.h>
 #include <linux/earlysuspend.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
+#include <linux/seq_file.h>
 #include <linux/rtc.h>
 #include <linux/syscalls.h> /* sys_sync */
 #include <linux/wakelock.h>
@@ -42,8 +45,13 @@ atomic_t optimize_comp_on = ATOMIC_INIT(0);
 EXPORT_SYMBOL(optimize_comp_on);
 #endif /* CONFIG_ZRAM_FOR_ANDROID */
 
+static bool parallel;
+module_param(parallel, bool, S_IRUGO | S_IWUSR | S_IWGRP);
+MODULE_PARM_DESC(parallel, "Run handlers of the same level concurrently");
+
 static DEFINE_MUTEX(early_suspend_lock);
 static LIST_HEAD(early_suspend_handlers);
+static LIST_HEAD(early_suspend_domain);
 static void early_suspend(struct work_struct *work);
 static void late_resume(struct work_struct *work);
 static DECLARE_WORK(early_suspend_work, early_suspend);
@@ -82,11 +90,63 @@ void unregister_early_suspend(struct early_suspend *handler)
 }
 EXPORT_SYMBOL(unregister_early_suspend);
 
+static void call_handler(struct early_suspend *h, bool resume)
+{
+	void (*fn)(struct early_suspend *h) = resume ? h->resume : h->suspend;
+	const char *what = resume ? "late_resume" : "early_suspend";
+	ktime_t start;
+	u32 us;
+
+	if (debug_mask & DEBUG_VERBOSE)
+		pr_info("%s: calling %pf\n", what, fn);
+	start = ktime_get();
+	fn(h);
+	us = ktime_to_us(ktime_sub(ktime_get(), start));
+	if (resume) {
+		h->resume_us = us;
+		h->max_resume_us = max(h->max_resume_us, us);
+	} else {
+		h->suspend_us = us;
+		h->max_suspend_us = max(h->max_suspend_us, us);
+	}
+	if (debug_mask & DEBUG_VERBOSE)
+		pr_info("%s: %pf took %u us\n", what, fn, us);
+}
+
+static void async_suspend_handler(void *data, async_cookie_t cookie)
+{
+	call_handler(data, false);
+}
+
+static void async_resume_handler(void *data, async_cookie_t cookie)
+{
+	call_handler(data, true);
+}
+
+/*
+ * Call a handler, or queue it to run concurrently with the others of its
+ * level.  The caller waits for early_suspend_domain before moving on to the
+ * next level.
+ */
+static void run_handler(struct early_suspend *h, bool resume)
+{
+	if (!(resume ? h->resume : h->suspend))
+		return;
+	if (parallel)
+		async_schedule_domain(resume ? async_resume_handler :
+				      async_suspend_handler, h,
+				      &early_suspend_domain);
+	else
+		call_handler(h, resume);
+}
+
 static void early_suspend(struct work_struct *work)
 {
 	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
+	int level = INT_MIN;
+	ktime_t start;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -108,15 +168,21 @@ static void early_suspend(struct work_struct *work)
 
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("early_suspend: call handlers\n");
+	start = ktime_get();
 	list_for_each_entry(pos, &early_suspend_handlers, link) {
-		if (pos->suspend != NULL) {
-			if (debug_mask & DEBUG_VERBOSE)
-				pr_info("early_suspend: calling %pf\n", pos->suspend);
-			pos->suspend(pos);
+		if (pos->level != level) {
+			async_synchronize_full_domain(&early_suspend_domain);
+			level = pos->level;
 		}
+		run_handler(pos, false);
 	}
+	async_synchronize_full_domain(&early_suspend_domain);
 	mutex_unlock(&early_suspend_lock);
 
+	if (debug_mask & DEBUG_SUSPEND)
+		pr_info("early_suspend: handlers took %lld us\n",
+			ktime_to_us(ktime_sub(ktime_get(), start)));
+
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("early_suspend: sync\n");
 
@@ -133,6 +199,8 @@ static void late_resume(struct work_struct *work)
 	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
+	int level = INT_MAX;
+	ktime_t start;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -152,16 +220,18 @@ static void late_resume(struct work_struct *work)
 	}
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: call handlers\n");
+	start = ktime_get();
 	list_for_each_entry_reverse(pos, &early_suspend_handlers, link) {
-		if (pos->resume != NULL) {
-			if (debug_mask & DEBUG_VERBOSE)
-				pr_info("late_resume: calling %pf\n", pos->resume);
-
-			pos->resume(pos);
+		if (pos->level != level) {
+			async_synchronize_full_domain(&early_suspend_domain);
+			level = pos->level;
 		}
+		run_handler(pos, true);
 	}
+	async_synchronize_full_domain(&early_suspend_domain);
 	if (debug_mask & DEBUG_SUSPEND)
-		pr_info("late_resume: done\n");
+		pr_info("late_resume: done in %lld us\n",
+			ktime_to_us(ktime_sub(ktime_get(), start)));
 abort:
 	mutex_unlock(&early_suspend_lock);
 }
@@ -202,3 +272,42 @@ suspend_state_t get_suspend_state(void)
 {
 	return requested_suspend_state;
 }
+
+#ifdef CONFIG_DEBUG_FS
+static int early_suspend_stats_show(struct seq_file *m, void *unused)
+{
+	struct early_suspend *pos;
+
+	seq_puts(m, "level handler suspend_us max_suspend_us "
+		 "resume_us max_resume_us\n");
+	mutex_lock(&early_suspend_lock);
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		seq_printf(m, "%d %pf %u %u %u %u\n", pos->level,
+			   pos->suspend ? (void *)pos->suspend :
+					  (void *)pos->resume,
+			   pos->suspend_us, pos->max_suspend_us,
+			   pos->resume_us, pos->max_resume_us);
+	mutex_unlock(&early_suspend_lock);
+	return 0;
+}
+
+static int early_suspend_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, early_suspend_stats_show, NULL);
+}
+
+static const struct file_operations early_suspend_stats_fops = {
+	.open		= early_suspend_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init early_suspend_debugfs_init(void)
+{
+	debugfs_create_file("early_suspend", S_IRUGO, NULL, NULL,
+			    &early_suspend_stats_fops);
+	return 0;
+}
+late_initcall(early_suspend_debugfs_init);
+#endif
@@ -91,6 +91,7 @@ static int suspend_test(int level)
  */
 static int suspend_prepare(void)
 {
+	ktime_t start;
 	int error;
 
 	if (!suspend_ops || !suspend_ops->enter)
@@ -106,7 +107,9 @@ static int suspend_prepare(void)
 	if (error)
 		goto Finish;
 
+	start = ktime_get();
 	error = suspend_freeze_processes();
+	suspend_time_phase(SUSPEND_TIME_FREEZE, start);
 	if (!error)
 		return 0;
 
@@ -139,6 +142,7 @@ void __attribute__ ((weak)) arch_suspend_enable_irqs(void)
  */
 static int suspend_enter(suspend_state_t state, bool *wakeup)
 {
+	ktime_t start;
 	int error;
 
 	if (suspend_ops->prepare) {
@@ -147,7 +151,9 @@ static int suspend_enter(suspend_state_t state, bool *wakeup)
 			goto Platform_finish;
 	}
 
+	start = ktime_get();
 	error = dpm_suspend_noirq(PMSG_SUSPEND);
+	suspend_time_phase(SUSPEND_TIME_SUSPEND_NOIRQ, start);
 	if (error) {
 		printk(KERN_ERR "PM: Some devices failed to power down\n");
 		goto Platform_finish;
@@ -189,7 +195,9 @@ static int suspend_enter(suspend_state_t state, bool *wakeup)
 	if (suspend_ops->wake)
 		suspend_ops->wake();
 
+	start = ktime_get();
 	dpm_resume_noirq(PMSG_RESUME);
+	suspend_time_phase(SUSPEND_TIME_RESUME_NOIRQ, start);
 
  Platform_finish:
 	if (suspend_ops->finish)
@@ -205,6 +213,7 @@ static int suspend_enter(suspend_state_t state, bool *wakeup)
  */
 int suspend_devices_and_enter(suspend_state_t state)
 {
+	ktime_t start;
 	int error;
 	bool wakeup = false;
 
@@ -219,7 +228,9 @@ int suspend_devices_and_enter(suspend_state_t state)
 	}
 	suspend_console();
 	suspend_test_start();
+	start = ktime_get();
 	error = dpm_suspend_start(PMSG_SUSPEND);
+	suspend_time_phase(SUSPEND_TIME_SUSPEND, start);
 	if (error) {
 		printk(KERN_ERR "PM: Some devices failed to suspend\n");
 		goto Recover_platform;
@@ -235,7 +246,9 @@ int suspend_devices_and_enter(suspend_state_t state)
 
  Resume_devices:
 	suspend_test_start();
+	start = ktime_get();
 	dpm_resume_end(PMSG_RESUME);
+	suspend_time_phase(SUSPEND_TIME_RESUME, start);
 	suspend_test_finish("resume devices");
 	resume_console();
  Close:
@@ -258,7 +271,10 @@ int suspend_devices_and_enter(suspend_state_t state)
  */
 static void suspend_finish(void)
 {
+	ktime_t start = ktime_get();
+
 	suspend_thaw_processes();
+	suspend_time_phase(SUSPEND_TIME_THAW, start);
 	usermodehelper_enable();
 	pm_notifier_call_chain(PM_POST_SUSPEND);
 	pm_restore_console();
@@ -284,6 +300,8 @@ int enter_state(suspend_state_t state)
 	if (!mutex_trylock(&pm_mutex))
 		return -EBUSY;
 
+	suspend_time_begin();
+
 	printk(KERN_INFO "PM: Syncing filesystems ... ");
 	sys_sync();
 	printk("done.\n");
@@ -305,6 +323,7 @@ int enter_state(suspend_state_t state)
 	pr_debug("PM: Finishing wakeup.\n");
 	suspend_finish();
  Unlock:
+	suspend_time_end(error);
 	mutex_unlock(&pm_mutex);
 	return error;
 }
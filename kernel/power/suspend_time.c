@@ -15,16 +15,124 @@
  */
 
 #include <linux/debugfs.h>
+#include <linux/device.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/suspend.h>
 #include <linux/syscore_ops.h>
 #include <linux/time.h>
 
 static struct timespec suspend_time_before;
 static unsigned int time_in_suspend_bins[32];
 
+/*
+ * The phases of the last SUSPEND_TIME_CYCLES suspend cycles, with the
+ * SUSPEND_TIME_SLOWEST devices that took longest to suspend or resume in
+ * each.  Phases are only timed from the suspending task, with pm_mutex
+ * held, but devices may be handled by async threads, hence the lock.
+ */
+#define SUSPEND_TIME_CYCLES	16
+#define SUSPEND_TIME_SLOWEST	8
+
+struct suspend_time_dev {
+	char name[24];
+	u32 us;
+	bool resume;
+};
+
+struct suspend_time_cycle {
+	struct timespec start;
+	int error;
+	u32 phase_us[SUSPEND_TIME_NR_PHASES];
+	unsigned int nr_devs;
+	struct suspend_time_dev slowest[SUSPEND_TIME_SLOWEST];
+};
+
+static const char * const suspend_time_phase_names[] = {
+	[SUSPEND_TIME_FREEZE]		= "freeze",
+	[SUSPEND_TIME_SUSPEND]		= "suspend",
+	[SUSPEND_TIME_SUSPEND_NOIRQ]	= "suspend_noirq",
+	[SUSPEND_TIME_PLATFORM_ENTRY]	= "platform_entry",
+	[SUSPEND_TIME_PLATFORM_EXIT]	= "platform_exit",
+	[SUSPEND_TIME_RESUME_NOIRQ]	= "resume_noirq",
+	[SUSPEND_TIME_RESUME]		= "resume",
+	[SUSPEND_TIME_THAW]		= "thaw",
+};
+
+static DEFINE_SPINLOCK(suspend_time_lock);
+static struct suspend_time_cycle suspend_time_cycles[SUSPEND_TIME_CYCLES];
+static unsigned int suspend_time_nr_cycles;
+static struct suspend_time_cycle *suspend_time_cur;
+
+void suspend_time_begin(void)
+{
+	struct suspend_time_cycle *c;
+
+	c = &suspend_time_cycles[suspend_time_nr_cycles % SUSPEND_TIME_CYCLES];
+	spin_lock(&suspend_time_lock);
+	memset(c, 0, sizeof(*c));
+	getnstimeofday(&c->start);
+	suspend_time_cur = c;
+	spin_unlock(&suspend_time_lock);
+}
+
+void suspend_time_end(int error)
+{
+	spin_lock(&suspend_time_lock);
+	if (suspend_time_cur) {
+		suspend_time_cur->error = error;
+		suspend_time_cur = NULL;
+		suspend_time_nr_cycles++;
+	}
+	spin_unlock(&suspend_time_lock);
+}
+
+void suspend_time_phase_us(enum suspend_time_phase phase, u32 us)
+{
+	/* phases may repeat in one cycle, with suspend_again */
+	if (suspend_time_cur)
+		suspend_time_cur->phase_us[phase] += us;
+}
+
+void suspend_time_phase(enum suspend_time_phase phase, ktime_t start)
+{
+	suspend_time_phase_us(phase, ktime_us_delta(ktime_get(), start));
+}
+
+void suspend_time_device(struct device *dev, bool resume, ktime_t start)
+{
+	u32 us = ktime_us_delta(ktime_get(), start);
+	struct suspend_time_cycle *c;
+	struct suspend_time_dev *d;
+	unsigned int i;
+
+	spin_lock(&suspend_time_lock);
+	c = suspend_time_cur;
+	if (!c)
+		goto out;
+
+	/* keep slowest[] sorted, slowest first */
+	for (i = 0; i < c->nr_devs; i++)
+		if (us > c->slowest[i].us)
+			break;
+	if (i == SUSPEND_TIME_SLOWEST)
+		goto out;
+	if (c->nr_devs < SUSPEND_TIME_SLOWEST)
+		c->nr_devs++;
+	memmove(&c->slowest[i + 1], &c->slowest[i],
+		(c->nr_devs - i - 1) * sizeof(c->slowest[0]));
+	d = &c->slowest[i];
+	strlcpy(d->name, dev_name(dev), sizeof(d->name));
+	d->us = us;
+	d->resume = resume;
+out:
+	spin_unlock(&suspend_time_lock);
+}
+
 #ifdef CONFIG_DEBUG_FS
 static int suspend_time_debug_show(struct seq_file *s, void *data)
 {
@@ -53,6 +161,44 @@ static const struct file_operations suspend_time_debug_fops = {
 	.release	= single_release,
 };
 
+static int suspend_phases_debug_show(struct seq_file *s, void *data)
+{
+	unsigned int n, i, j;
+
+	spin_lock(&suspend_time_lock);
+	n = min_t(unsigned int, suspend_time_nr_cycles, SUSPEND_TIME_CYCLES);
+	for (i = suspend_time_nr_cycles - n; i != suspend_time_nr_cycles;
+	     i++) {
+		struct suspend_time_cycle *c =
+			&suspend_time_cycles[i % SUSPEND_TIME_CYCLES];
+
+		seq_printf(s, "cycle %u at %ld.%03ld error %d\n", i,
+			   c->start.tv_sec, c->start.tv_nsec / NSEC_PER_MSEC,
+			   c->error);
+		for (j = 0; j < SUSPEND_TIME_NR_PHASES; j++)
+			seq_printf(s, "  %-16s %10u us\n",
+				   suspend_time_phase_names[j], c->phase_us[j]);
+		for (j = 0; j < c->nr_devs; j++)
+			seq_printf(s, "  %-7s %-24s %10u us\n",
+				   c->slowest[j].resume ? "resume" : "suspend",
+				   c->slowest[j].name, c->slowest[j].us);
+	}
+	spin_unlock(&suspend_time_lock);
+	return 0;
+}
+
+static int suspend_phases_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, suspend_phases_debug_show, NULL);
+}
+
+static const struct file_operations suspend_phases_debug_fops = {
+	.open		= suspend_phases_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init suspend_time_debug_init(void)
 {
 	struct dentry *d;
@@ -64,6 +210,13 @@ static int __init suspend_time_debug_init(void)
 		return -ENOMEM;
 	}
 
+	d = debugfs_create_file("suspend_phases", 0444, NULL, NULL,
+		&suspend_phases_debug_fops);
+	if (!d) {
+		pr_err("Failed to create suspend_phases debug file\n");
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
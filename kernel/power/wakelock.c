@@ -87,7 +87,9 @@ int get_expired_time(struct wake_lock *lock, ktime_t *expire_time)
 }
 
 
-static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
+/* Caller must acquire the list_lock spinlock */
+static void get_lock_stat(struct wake_lock *lock,
+			  struct wake_lock_stat_record *rec)
 {
 	int lock_count = lock->stat.count;
 	int expire_count = lock->stat.expire_count;
@@ -115,36 +117,85 @@ static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 			max_time = add_time;
 	}
 
+	memset(rec, 0, sizeof(*rec));
+	strlcpy(rec->name, lock->name, sizeof(rec->name));
+	rec->count = lock_count;
+	rec->expire_count = expire_count;
+	rec->wakeup_count = lock->stat.wakeup_count;
+	rec->active_since = ktime_to_ns(active_time);
+	rec->total_time = ktime_to_ns(total_time);
+	rec->prevent_suspend_time = ktime_to_ns(prevent_suspend_time);
+	rec->max_time = ktime_to_ns(max_time);
+	rec->last_change = ktime_to_ns(lock->stat.last_time);
+	memcpy(rec->hist, lock->stat.hist, sizeof(rec->hist));
+}
+
+static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
+{
+	struct wake_lock_stat_record rec;
+
+	get_lock_stat(lock, &rec);
 	return seq_printf(m,
-		     "\"%s\"\t%d\t%d\t%d\t%lld\t%lld\t%lld\t%lld\t%lld\n",
-		     lock->name, lock_count, expire_count,
-		     lock->stat.wakeup_count, ktime_to_ns(active_time),
-		     ktime_to_ns(total_time),
-		     ktime_to_ns(prevent_suspend_time), ktime_to_ns(max_time),
-		     ktime_to_ns(lock->stat.last_time));
+		     "\"%s\"\t%u\t%u\t%u\t%lld\t%lld\t%lld\t%lld\t%lld\n",
+		     lock->name, rec.count, rec.expire_count,
+		     rec.wakeup_count, rec.active_since, rec.total_time,
+		     rec.prevent_suspend_time, rec.max_time, rec.last_change);
 }
 
-static int wakelock_stats_show(struct seq_file *m, void *unused)
+static int write_lock_stat(struct seq_file *m, struct wake_lock *lock)
+{
+	struct wake_lock_stat_record rec;
+
+	get_lock_stat(lock, &rec);
+	return seq_write(m, &rec, sizeof(rec));
+}
+
+static void for_each_lock_stat(struct seq_file *m,
+		int (*show)(struct seq_file *m, struct wake_lock *lock))
 {
 	unsigned long irqflags;
 	struct wake_lock *lock;
-	int ret;
 	int type;
 
 	spin_lock_irqsave(&list_lock, irqflags);
-
-	ret = seq_puts(m, "name\tcount\texpire_count\twake_count\tactive_since"
-			"\ttotal_time\tsleep_time\tmax_time\tlast_change\n");
 	list_for_each_entry(lock, &inactive_locks, link)
-		ret = print_lock_stat(m, lock);
+		show(m, lock);
 	for (type = 0; type < WAKE_LOCK_TYPE_COUNT; type++) {
 		list_for_each_entry(lock, &active_wake_locks[type], link)
-			ret = print_lock_stat(m, lock);
+			show(m, lock);
 	}
 	spin_unlock_irqrestore(&list_lock, irqflags);
+}
+
+static int wakelock_stats_show(struct seq_file *m, void *unused)
+{
+	seq_puts(m, "name\tcount\texpire_count\twake_count\tactive_since"
+			"\ttotal_time\tsleep_time\tmax_time\tlast_change\n");
+	for_each_lock_stat(m, print_lock_stat);
 	return 0;
 }
 
+/* The same, as an array of struct wake_lock_stat_record */
+static int wakelock_stats_bin_show(struct seq_file *m, void *unused)
+{
+	for_each_lock_stat(m, write_lock_stat);
+	return 0;
+}
+
+static void wake_lock_hist_add(struct wake_lock *lock, ktime_t duration)
+{
+	s64 ms = ktime_to_ms(duration);
+	int bucket;
+
+	if (ms <= 0)
+		bucket = 0;
+	else if (ms >= 1 << (WAKE_LOCK_HIST_BUCKETS - 1))
+		bucket = WAKE_LOCK_HIST_BUCKETS - 1;
+	else
+		bucket = fls((u32)ms);
+	lock->stat.hist[bucket]++;
+}
+
 static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 {
 	ktime_t duration;
@@ -162,7 +213,8 @@ static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 	lock->stat.total_time = ktime_add(lock->stat.total_time, duration);
 	if (ktime_to_ns(duration) > ktime_to_ns(lock->stat.max_time))
 		lock->stat.max_time = duration;
-	lock->stat.last_time = ktime_get();
+	wake_lock_hist_add(lock, duration);
+	lock->stat.last_time = expired ? ktime_get() : now;
 	if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
 		duration = ktime_sub(now, last_sleep_time_update);
 		lock->stat.prevent_suspend_time = ktime_add(
@@ -379,6 +431,7 @@ void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 	lock->stat.prevent_suspend_time = ktime_set(0, 0);
 	lock->stat.max_time = ktime_set(0, 0);
 	lock->stat.last_time = ktime_set(0, 0);
+	memset(lock->stat.hist, 0, sizeof(lock->stat.hist));
 #endif
 	lock->flags = (type & WAKE_LOCK_TYPE_MASK) | WAKE_LOCK_INITIALIZED;
 
@@ -392,6 +445,9 @@ EXPORT_SYMBOL(wake_lock_init);
 void wake_lock_destroy(struct wake_lock *lock)
 {
 	unsigned long irqflags;
+#ifdef CONFIG_WAKELOCK_STAT
+	int i;
+#endif
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_lock_destroy name=%s\n", lock->name);
 	spin_lock_irqsave(&list_lock, irqflags);
@@ -409,6 +465,8 @@ void wake_lock_destroy(struct wake_lock *lock)
 		deleted_wake_locks.stat.max_time =
 			ktime_add(deleted_wake_locks.stat.max_time,
 				  lock->stat.max_time);
+		for (i = 0; i < WAKE_LOCK_HIST_BUCKETS; i++)
+			deleted_wake_locks.stat.hist[i] += lock->stat.hist[i];
 	}
 #endif
 	list_del(&lock->link);
@@ -563,6 +621,19 @@ static const struct file_operations wakelock_stats_fops = {
 	.release = single_release,
 };
 
+static int wakelock_stats_bin_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wakelock_stats_bin_show, NULL);
+}
+
+static const struct file_operations wakelock_stats_bin_fops = {
+	.owner = THIS_MODULE,
+	.open = wakelock_stats_bin_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int __init wakelocks_init(void)
 {
 	int ret;
@@ -600,6 +671,7 @@ static int __init wakelocks_init(void)
 
 #ifdef CONFIG_WAKELOCK_STAT
 	proc_create("wakelocks", S_IRUGO, NULL, &wakelock_stats_fops);
+	proc_create("wakelocks_bin", S_IRUGO, NULL, &wakelock_stats_bin_fops);
 #endif
 
 	return 0;
@@ -621,6 +693,7 @@ err_platform_device_register:
 static void  __exit wakelocks_exit(void)
 {
 #ifdef CONFIG_WAKELOCK_STAT
+	remove_proc_entry("wakelocks_bin", NULL);
 	remove_proc_entry("wakelocks", NULL);
 #endif
 	destroy_workqueue(suspend_work_queue);
@@ -26,11 +26,13 @@
 #include <linux/spinlock.h>
 #include <linux/notifier.h>
 #include <linux/suspend.h>
+#include <linux/module.h>
 
 
 #define MAX_WAKEUP_REASON_IRQS 32
 static int irq_list[MAX_WAKEUP_REASON_IRQS];
 static int irq_count;
+static unsigned long irq_claimed;	/* bit per irq_list entry */
 static struct kobject *wakeup_reason;
 static spinlock_t resume_reason_lock;
 
@@ -39,7 +41,7 @@ static ssize_t last_resume_reason_show(struct kobject *kobj, struct kobj_attribu
 {
 	int irq_no, buf_offset = 0;
 	struct irq_desc *desc;
-	spin_lock(&resume_reason_lock);
+	spin_lock_irq(&resume_reason_lock);
 	for (irq_no = 0; irq_no < irq_count; irq_no++) {
 		desc = irq_to_desc(irq_list[irq_no]);
 		if (desc && desc->action && desc->action->name)
@@ -49,7 +51,7 @@ static ssize_t last_resume_reason_show(struct kobject *kobj, struct kobj_attribu
 			buf_offset += sprintf(buf + buf_offset, "%d\n",
 					irq_list[irq_no]);
 	}
-	spin_unlock(&resume_reason_lock);
+	spin_unlock_irq(&resume_reason_lock);
 	return buf_offset;
 }
 
@@ -82,15 +84,40 @@ void log_wakeup_reason(int irq)
 	spin_unlock(&resume_reason_lock);
 }
 
+/*
+ * Returns true if irq is one of the reasons for the last resume and no
+ * one has claimed it since. Lets a driver count the wakes it caused from
+ * its own interrupt handler, once per resume.
+ */
+bool wakeup_reason_claim(int irq)
+{
+	unsigned long flags;
+	bool ret = false;
+	int irq_no;
+
+	spin_lock_irqsave(&resume_reason_lock, flags);
+	for (irq_no = 0; irq_no < irq_count; irq_no++) {
+		if ((irq_list[irq_no] == irq) &&
+		    !test_and_set_bit(irq_no, &irq_claimed)) {
+			ret = true;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&resume_reason_lock, flags);
+	return ret;
+}
+EXPORT_SYMBOL(wakeup_reason_claim);
+
 /* Detects a suspend and clears all the previous wake up reasons*/
 static int wakeup_reason_pm_event(struct notifier_block *notifier,
 		unsigned long pm_event, void *unused)
 {
 	switch (pm_event) {
 	case PM_SUSPEND_PREPARE:
-		spin_lock(&resume_reason_lock);
+		spin_lock_irq(&resume_reason_lock);
 		irq_count = 0;
-		spin_unlock(&resume_reason_lock);
+		irq_claimed = 0;
+		spin_unlock_irq(&resume_reason_lock);
 		break;
 	default:
 		break;
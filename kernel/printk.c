@@ -41,6 +41,10 @@
 #include <linux/cpu.h>
 #include <linux/notifier.h>
 #include <linux/rculist.h>
+#include <linux/kthread.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/uaccess.h>
 
@@ -122,6 +126,23 @@ static unsigned log_end;	/* Index into log_buf: most-recently-written-char + 1 *
  */
 static struct console *exclusive_console;
 
+/* Writes out what printk() left for it; see printk_defer() */
+static struct task_struct *printk_flush_task;
+
+#define PRINTK_PENDING_WAKEUP	0x01
+#define PRINTK_PENDING_FLUSH	0x02
+
+static DEFINE_PER_CPU(int, printk_pending);
+
+/* Times under console_sem, counts under logbuf_lock */
+static struct {
+	u64 sync_ns;
+	u64 sync_max_ns;
+	u64 async_ns;
+	unsigned long deferred;
+	unsigned long backlogged;
+} printk_stats;
+
 /*
  *	Array of consoles built from command line options (console=)
  */
@@ -752,6 +773,17 @@ static int printk_time = 0;
 #endif
 module_param_named(time, printk_time, bool, S_IRUGO | S_IWUSR);
 
+/*
+ * Once printk_flush_task is running, messages less severe than sync_level
+ * are only stored by printk(), and the thread, woken from the next tick,
+ * writes them to the consoles.  Emergency messages, oopses, shutdown, and
+ * a console more than half a log buffer behind still print right away.
+ */
+static int printk_async = 1;
+module_param_named(async, printk_async, bool, S_IRUGO | S_IWUSR);
+static int printk_sync_level = 3;
+module_param_named(sync_level, printk_sync_level, int, S_IRUGO | S_IWUSR);
+
 /* Check if we have any console registered that can be called early in boot. */
 static int have_callable_console(void)
 {
@@ -858,6 +890,20 @@ static int console_trylock_for_printk(unsigned int cpu)
 		up(&console_sem);
 	return retval;
 }
+/* Called with logbuf_lock held */
+static bool printk_defer(int level)
+{
+	if (!printk_async || !printk_flush_task || level <= printk_sync_level ||
+	    oops_in_progress || system_state != SYSTEM_RUNNING ||
+	    current == printk_flush_task)
+		return false;
+	if (log_end - con_start > log_buf_len / 2) {
+		printk_stats.backlogged++;
+		return false;
+	}
+	return true;
+}
+
 static const char recursion_bug_msg [] =
 		KERN_CRIT "BUG: recent printk recursion!\n";
 static int recursion_bug;
@@ -1011,8 +1057,15 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	 * The console_trylock_for_printk() function
 	 * will release 'logbuf_lock' regardless of whether it
 	 * actually gets the semaphore or not.
+	 *
+	 * Or leave the work to printk_flush_task.
 	 */
-	if (console_trylock_for_printk(this_cpu))
+	if (printk_defer(current_log_level)) {
+		printk_stats.deferred++;
+		printk_cpu = UINT_MAX;
+		spin_unlock(&logbuf_lock);
+		this_cpu_or(printk_pending, PRINTK_PENDING_FLUSH);
+	} else if (console_trylock_for_printk(this_cpu))
 		console_unlock();
 
 	lockdep_on();
@@ -1259,13 +1312,15 @@ int is_console_locked(void)
 	return console_locked;
 }
 
-static DEFINE_PER_CPU(int, printk_pending);
-
 void printk_tick(void)
 {
 	if (__this_cpu_read(printk_pending)) {
-		__this_cpu_write(printk_pending, 0);
-		wake_up_interruptible(&log_wait);
+		int pending = __this_cpu_xchg(printk_pending, 0);
+
+		if (pending & PRINTK_PENDING_WAKEUP)
+			wake_up_interruptible(&log_wait);
+		if (pending & PRINTK_PENDING_FLUSH)
+			wake_up_process(printk_flush_task);
 	}
 }
 
@@ -1279,7 +1334,7 @@ int printk_needs_cpu(int cpu)
 void wake_up_klogd(void)
 {
 	if (waitqueue_active(&log_wait))
-		this_cpu_write(printk_pending, 1);
+		this_cpu_or(printk_pending, PRINTK_PENDING_WAKEUP);
 }
 
 /**
@@ -1301,6 +1356,7 @@ void console_unlock(void)
 	unsigned long flags;
 	unsigned _con_start, _log_end;
 	unsigned wake_klogd = 0, retry = 0;
+	u64 start, ns;
 
 	if (console_suspended) {
 		up(&console_sem);
@@ -1320,9 +1376,19 @@ again:
 		con_start = log_end;		/* Flush */
 		spin_unlock(&logbuf_lock);
 		stop_critical_timings();	/* don't trace print latency */
+		start = local_clock();
 		call_console_drivers(_con_start, _log_end);
+		ns = local_clock() - start;
 		start_critical_timings();
 		local_irq_restore(flags);
+
+		if (current == printk_flush_task) {
+			printk_stats.async_ns += ns;
+		} else {
+			printk_stats.sync_ns += ns;
+			if (ns > printk_stats.sync_max_ns)
+				printk_stats.sync_max_ns = ns;
+		}
 	}
 	console_locked = 0;
 
@@ -1669,6 +1735,75 @@ static int __init printk_late_init(void)
 }
 late_initcall(printk_late_init);
 
+static int printk_flush_thread(void *unused)
+{
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		/* resume_console() flushes what piles up in suspend */
+		if (con_start == log_end || console_suspended) {
+			schedule();
+			continue;
+		}
+		__set_current_state(TASK_RUNNING);
+		console_lock();
+		console_unlock();
+	}
+	return 0;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int printk_stats_show(struct seq_file *s, void *unused)
+{
+	console_lock();
+	seq_printf(s, "sync_us %llu\nsync_max_us %llu\nasync_us %llu\n"
+		   "deferred %lu\nbacklogged %lu\n",
+		   div_u64(printk_stats.sync_ns, NSEC_PER_USEC),
+		   div_u64(printk_stats.sync_max_ns, NSEC_PER_USEC),
+		   div_u64(printk_stats.async_ns, NSEC_PER_USEC),
+		   printk_stats.deferred, printk_stats.backlogged);
+	console_unlock();
+	return 0;
+}
+
+static int printk_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, printk_stats_show, NULL);
+}
+
+static ssize_t printk_stats_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	console_lock();
+	memset(&printk_stats, 0, sizeof(printk_stats));
+	console_unlock();
+	return count;
+}
+
+static const struct file_operations printk_stats_fops = {
+	.open		= printk_stats_open,
+	.read		= seq_read,
+	.write		= printk_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
+static int __init printk_flush_init(void)
+{
+	struct task_struct *task;
+
+	task = kthread_run(printk_flush_thread, NULL, "printk_flush");
+	if (IS_ERR(task))
+		return PTR_ERR(task);
+	printk_flush_task = task;
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("printk_stats", S_IRUGO | S_IWUSR, NULL, NULL,
+			    &printk_stats_fops);
+#endif
+	return 0;
+}
+late_initcall(printk_flush_init);
+
 #if defined CONFIG_PRINTK
 
 /*
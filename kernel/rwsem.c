@@ -9,10 +9,26 @@
 #include <linux/sched.h>
 #include <linux/module.h>
 #include <linux/rwsem.h>
+#include <linux/lock_profile.h>
 
 #include <asm/system.h>
 #include <linux/atomic.h>
 
+#ifdef CONFIG_LOCK_PROFILE
+#define RWSEM_CONTENDED(_sem, try, lock, type)			\
+do {								\
+	if (!try(_sem)) {					\
+		u64 __start = lock_profile_start();		\
+								\
+		lock(_sem);					\
+		lock_profile_contended(_sem, type, _RET_IP_, __start); \
+	}							\
+} while (0)
+#else
+#define RWSEM_CONTENDED(_sem, try, lock, type)			\
+	LOCK_CONTENDED(_sem, try, lock)
+#endif
+
 /*
  * lock for reading
  */
@@ -21,7 +37,8 @@ void __sched down_read(struct rw_semaphore *sem)
 	might_sleep();
 	rwsem_acquire_read(&sem->dep_map, 0, 0, _RET_IP_);
 
-	LOCK_CONTENDED(sem, __down_read_trylock, __down_read);
+	RWSEM_CONTENDED(sem, __down_read_trylock, __down_read,
+			LOCK_PROFILE_RWSEM_READ);
 }
 
 EXPORT_SYMBOL(down_read);
@@ -48,7 +65,8 @@ void __sched down_write(struct rw_semaphore *sem)
 	might_sleep();
 	rwsem_acquire(&sem->dep_map, 0, 0, _RET_IP_);
 
-	LOCK_CONTENDED(sem, __down_write_trylock, __down_write);
+	RWSEM_CONTENDED(sem, __down_write_trylock, __down_write,
+			LOCK_PROFILE_RWSEM_WRITE);
 }
 
 EXPORT_SYMBOL(down_write);
@@ -112,7 +130,8 @@ void down_read_nested(struct rw_semaphore *sem, int subclass)
 	might_sleep();
 	rwsem_acquire_read(&sem->dep_map, subclass, 0, _RET_IP_);
 
-	LOCK_CONTENDED(sem, __down_read_trylock, __down_read);
+	RWSEM_CONTENDED(sem, __down_read_trylock, __down_read,
+			LOCK_PROFILE_RWSEM_READ);
 }
 
 EXPORT_SYMBOL(down_read_nested);
@@ -122,7 +141,8 @@ void down_write_nested(struct rw_semaphore *sem, int subclass)
 	might_sleep();
 	rwsem_acquire(&sem->dep_map, subclass, 0, _RET_IP_);
 
-	LOCK_CONTENDED(sem, __down_write_trylock, __down_write);
+	RWSEM_CONTENDED(sem, __down_write_trylock, __down_write,
+			LOCK_PROFILE_RWSEM_WRITE);
 }
 
 EXPORT_SYMBOL(down_write_nested);
@@ -264,6 +264,10 @@ struct task_group {
 	unsigned long shares;
 
 	atomic_t load_weight;
+
+	/* ns, -1 to follow the sysctls, see cfs_rq_latency() */
+	int sched_latency;
+	int wakeup_gran;
 #endif
 
 #ifdef CONFIG_RT_GROUP_SCHED
@@ -507,6 +511,9 @@ struct rq {
 	u64 clock;
 	u64 clock_task;
 
+	/* runnable average of the cpu, see sched_cpu_util() */
+	struct sched_avg avg;
+
 	atomic_t nr_iowait;
 
 #ifdef CONFIG_SMP
@@ -1781,13 +1788,17 @@ static const struct sched_class rt_sched_class;
 
 #include "sched_stats.h"
 
+static void update_rq_runnable_avg(struct rq *rq);
+
 static void inc_nr_running(struct rq *rq)
 {
+	update_rq_runnable_avg(rq);
 	rq->nr_running++;
 }
 
 static void dec_nr_running(struct rq *rq)
 {
+	update_rq_runnable_avg(rq);
 	rq->nr_running--;
 }
 
@@ -2439,6 +2450,26 @@ static int select_fallback_rq(int cpu, struct task_struct *p)
 	return dest_cpu;
 }
 
+/*
+ * Steer a task away from a parked cpu, preferring an idle one. Tasks that
+ * may only run on parked cpus (per-cpu kthreads) stay where they are.
+ */
+static int select_unparked_rq(int cpu, struct task_struct *p)
+{
+	int dest_cpu, fallback = cpu;
+
+	for_each_cpu_and(dest_cpu, &p->cpus_allowed, cpu_active_mask) {
+		if (cpu_parked(dest_cpu))
+			continue;
+		if (idle_cpu(dest_cpu))
+			return dest_cpu;
+		if (fallback == cpu)
+			fallback = dest_cpu;
+	}
+
+	return fallback;
+}
+
 /*
  * The caller (fork, wakeup) owns p->pi_lock, ->cpus_allowed is stable.
  */
@@ -2461,6 +2492,9 @@ int select_task_rq(struct task_struct *p, int sd_flags, int wake_flags)
 		     !cpu_online(cpu)))
 		cpu = select_fallback_rq(task_cpu(p), p);
 
+	if (unlikely(cpu_parked(cpu)))
+		cpu = select_unparked_rq(cpu, p);
+
 	return cpu;
 }
 
@@ -2855,6 +2889,11 @@ static void __sched_fork(struct task_struct *p)
 	p->se.vruntime			= 0;
 	INIT_LIST_HEAD(&p->se.group_node);
 
+	/* a new task counts as busy until it has some history */
+	p->se.avg.runnable_avg_sum	= 1024;
+	p->se.avg.runnable_avg_period	= 1024;
+	p->se.avg.last_runnable_update	= 0;
+
 #ifdef CONFIG_SCHEDSTATS
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
 #endif
@@ -4360,9 +4399,12 @@ void scheduler_tick(void)
 	raw_spin_lock(&rq->lock);
 	update_rq_clock(rq);
 	update_cpu_load_active(rq);
+	update_rq_runnable_avg(rq);
 	curr->sched_class->task_tick(rq, curr, 0);
 	raw_spin_unlock(&rq->lock);
 
+	trace_sched_cpu_util(cpu, sched_avg_util(&rq->avg));
+
 	perf_event_task_tick();
 
 #ifdef CONFIG_SMP
@@ -8396,6 +8438,8 @@ void __init sched_init(void)
 		init_rt_rq(&rq->rt, rq);
 #ifdef CONFIG_FAIR_GROUP_SCHED
 		root_task_group.shares = root_task_group_load;
+		root_task_group.sched_latency = -1;
+		root_task_group.wakeup_gran = -1;
 		INIT_LIST_HEAD(&rq->leaf_cfs_rq_list);
 		/*
 		 * How much cpu bandwidth does root_task_group get?
@@ -8698,6 +8742,8 @@ int alloc_fair_sched_group(struct task_group *tg, struct task_group *parent)
 		goto err;
 
 	tg->shares = NICE_0_LOAD;
+	tg->sched_latency = -1;
+	tg->wakeup_gran = -1;
 
 	for_each_possible_cpu(i) {
 		cfs_rq = kzalloc_node(sizeof(struct cfs_rq),
@@ -9367,6 +9413,42 @@ static u64 cpu_shares_read_u64(struct cgroup *cgrp, struct cftype *cft)
 
 	return (u64) scale_load_down(tg->shares);
 }
+
+/*
+ * A group's scheduling period and wakeup granularity, -1 for the
+ * sysctls.  With a short latency background tasks run in short slices;
+ * with a wakeup granularity of 0 the group's tasks preempt anything
+ * that has run more than them as soon as they wake.
+ */
+static int cpu_sched_latency_write_s64(struct cgroup *cgrp,
+				       struct cftype *cft, s64 val)
+{
+	if (val != -1 && (val < 100000LL || val > NSEC_PER_SEC))
+		return -EINVAL;
+
+	cgroup_tg(cgrp)->sched_latency = val;
+	return 0;
+}
+
+static s64 cpu_sched_latency_read_s64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return cgroup_tg(cgrp)->sched_latency;
+}
+
+static int cpu_wakeup_gran_write_s64(struct cgroup *cgrp,
+				     struct cftype *cft, s64 val)
+{
+	if (val != -1 && (val < 0 || val > NSEC_PER_SEC))
+		return -EINVAL;
+
+	cgroup_tg(cgrp)->wakeup_gran = val;
+	return 0;
+}
+
+static s64 cpu_wakeup_gran_read_s64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return cgroup_tg(cgrp)->wakeup_gran;
+}
 #endif /* CONFIG_FAIR_GROUP_SCHED */
 
 #ifdef CONFIG_RT_GROUP_SCHED
@@ -9405,6 +9487,16 @@ static struct cftype cpu_files[] = {
 		.read_u64 = cpu_shares_read_u64,
 		.write_u64 = cpu_shares_write_u64,
 	},
+	{
+		.name = "sched_latency_ns",
+		.read_s64 = cpu_sched_latency_read_s64,
+		.write_s64 = cpu_sched_latency_write_s64,
+	},
+	{
+		.name = "wakeup_granularity_ns",
+		.read_s64 = cpu_wakeup_gran_read_s64,
+		.write_s64 = cpu_wakeup_gran_write_s64,
+	},
 #endif
 #ifdef CONFIG_RT_GROUP_SCHED
 	{
@@ -89,6 +89,15 @@ const_debug unsigned int sysctl_sched_migration_cost = 500000UL;
  */
 unsigned int __read_mostly sysctl_sched_shares_window = 10000000UL;
 
+/*
+ * Small task packing, see select_pack_cpu(): tasks runnable less than
+ * sysctl_sched_small_task_util/1024 of the time are woken on the
+ * lowest-numbered cpu that stays under sysctl_sched_pack_util with them.
+ * (default: 20% and 80%)
+ */
+unsigned int __read_mostly sysctl_sched_small_task_util = 205;
+unsigned int __read_mostly sysctl_sched_pack_util = 820;
+
 static const struct sched_class fair_sched_class;
 
 /**************************************************************
@@ -468,6 +477,39 @@ calc_delta_fair(unsigned long delta, struct sched_entity *se)
 	return delta;
 }
 
+#ifdef CONFIG_FAIR_GROUP_SCHED
+/*
+ * Per group overrides of sched_latency_ns and sched_wakeup_granularity_ns,
+ * set through cpu.sched_latency_ns and cpu.wakeup_granularity_ns.  -1
+ * means the sysctl.
+ */
+static inline unsigned int cfs_rq_latency(struct cfs_rq *cfs_rq)
+{
+	int latency = cfs_rq->tg->sched_latency;
+
+	return latency >= 0 ? latency : sysctl_sched_latency;
+}
+
+/* for a group entity, the group it stands for */
+static inline unsigned int entity_wakeup_gran(struct sched_entity *se)
+{
+	struct task_group *tg = se->my_q ? se->my_q->tg : cfs_rq_of(se)->tg;
+
+	return tg->wakeup_gran >= 0 ? tg->wakeup_gran :
+		sysctl_sched_wakeup_granularity;
+}
+#else
+static inline unsigned int cfs_rq_latency(struct cfs_rq *cfs_rq)
+{
+	return sysctl_sched_latency;
+}
+
+static inline unsigned int entity_wakeup_gran(struct sched_entity *se)
+{
+	return sysctl_sched_wakeup_granularity;
+}
+#endif
+
 /*
  * The idea is to set a period in which each task runs once.
  *
@@ -476,11 +518,15 @@ calc_delta_fair(unsigned long delta, struct sched_entity *se)
  *
  * p = (nr <= nl) ? l : l*nr/nl
  */
-static u64 __sched_period(unsigned long nr_running)
+static u64 __sched_period(unsigned long nr_running, unsigned int latency)
 {
-	u64 period = sysctl_sched_latency;
+	u64 period = latency;
 	unsigned long nr_latency = sched_nr_latency;
 
+	if (unlikely(latency != sysctl_sched_latency))
+		nr_latency = DIV_ROUND_UP(latency,
+					  sysctl_sched_min_granularity);
+
 	if (unlikely(nr_running > nr_latency)) {
 		period = sysctl_sched_min_granularity;
 		period *= nr_running;
@@ -497,7 +543,8 @@ static u64 __sched_period(unsigned long nr_running)
  */
 static u64 sched_slice(struct cfs_rq *cfs_rq, struct sched_entity *se)
 {
-	u64 slice = __sched_period(cfs_rq->nr_running + !se->on_rq);
+	u64 slice = __sched_period(cfs_rq->nr_running + !se->on_rq,
+				   cfs_rq_latency(cfs_rq));
 
 	for_each_sched_entity(se) {
 		struct load_weight *load;
@@ -527,6 +574,220 @@ static u64 sched_vslice(struct cfs_rq *cfs_rq, struct sched_entity *se)
 	return calc_delta_fair(sched_slice(cfs_rq, se), se);
 }
 
+/*
+ * Runnable averages.  Time is cut into 1024us periods (2^20ns); the
+ * period p periods ago counts y^p as much as the current one, with
+ * y^32 = 1/2.  runnable_avg_sum is the decayed time spent runnable,
+ * runnable_avg_period the decayed time overall, so their ratio is the
+ * recent share of time runnable, with a half-life of about 32ms.
+ */
+#define LOAD_AVG_PERIOD	32
+#define LOAD_AVG_MAX	47742	/* largest runnable_avg_period */
+#define LOAD_AVG_MAX_N	345	/* periods to reach LOAD_AVG_MAX */
+
+/* 2^32 * y^n */
+static const u32 runnable_avg_yN_inv[] = {
+	0xffffffff, 0xfa83b2da, 0xf5257d14, 0xefe4b99a, 0xeac0c6e6, 0xe5b906e6,
+	0xe0ccdeeb, 0xdbfbb796, 0xd744fcc9, 0xd2a81d91, 0xce248c14, 0xc9b9bd85,
+	0xc5672a10, 0xc12c4cc9, 0xbd08a39e, 0xb8fbaf46, 0xb504f333, 0xb123f581,
+	0xad583ee9, 0xa9a15ab4, 0xa5fed6a9, 0xa2704302, 0x9ef5325f, 0x9b8d39b9,
+	0x9837f050, 0x94f4efa8, 0x91c3d373, 0x8ea4398a, 0x8b95c1e3, 0x88980e80,
+	0x85aac367, 0x82cd8698,
+};
+
+/* 1024 * (y + y^2 + ... + y^n) */
+static const u32 runnable_avg_yN_sum[] = {
+	    0, 1002, 1982, 2941, 3880, 4798, 5697, 6576, 7437, 8279, 9103,
+	 9909, 10698, 11470, 12226, 12966, 13690, 14398, 15091, 15769, 16433,
+	17082, 17718, 18340, 18949, 19545, 20128, 20698, 21256, 21802, 22336,
+	22859, 23371,
+};
+
+/* val * y^n */
+static u64 decay_load(u64 val, u64 n)
+{
+	unsigned int local_n;
+
+	if (!n)
+		return val;
+	if (unlikely(n > LOAD_AVG_PERIOD * 63))
+		return 0;
+
+	local_n = n;
+	if (unlikely(local_n >= LOAD_AVG_PERIOD)) {
+		val >>= local_n / LOAD_AVG_PERIOD;
+		local_n %= LOAD_AVG_PERIOD;
+	}
+
+	val *= runnable_avg_yN_inv[local_n];
+	return val >> 32;
+}
+
+/* 1024 * (y + y^2 + ... + y^n), for n full periods runnable */
+static u32 __compute_runnable_contrib(u64 n)
+{
+	unsigned int local_n = n;
+	u32 contrib = 0;
+
+	if (likely(n <= LOAD_AVG_PERIOD))
+		return runnable_avg_yN_sum[n];
+	if (unlikely(n >= LOAD_AVG_MAX_N))
+		return LOAD_AVG_MAX;
+
+	do {
+		contrib /= 2;
+		contrib += runnable_avg_yN_sum[LOAD_AVG_PERIOD];
+		local_n -= LOAD_AVG_PERIOD;
+	} while (local_n > LOAD_AVG_PERIOD);
+
+	contrib = decay_load(contrib, local_n);
+	return contrib + runnable_avg_yN_sum[local_n];
+}
+
+/*
+ * Account the time since the last update to @sa, as runnable or not.
+ * Only whole microseconds (2^10ns) are consumed.
+ */
+static void __update_runnable_avg(u64 now, struct sched_avg *sa,
+				  int runnable)
+{
+	u64 delta, periods;
+	u32 delta_w;
+
+	if (unlikely(!sa->last_runnable_update)) {
+		sa->last_runnable_update = now;
+		return;
+	}
+
+	delta = now - sa->last_runnable_update;
+	if ((s64)delta < 0) {
+		sa->last_runnable_update = now;
+		return;
+	}
+
+	delta >>= 10;
+	if (!delta)
+		return;
+	sa->last_runnable_update += delta << 10;
+
+	/* the rest of the current period */
+	delta_w = sa->runnable_avg_period % 1024;
+	if (delta + delta_w >= 1024) {
+		delta_w = 1024 - delta_w;
+		if (runnable)
+			sa->runnable_avg_sum += delta_w;
+		sa->runnable_avg_period += delta_w;
+		delta -= delta_w;
+
+		/* decay it and the past, then add the full periods */
+		periods = delta / 1024;
+		delta %= 1024;
+		sa->runnable_avg_sum = decay_load(sa->runnable_avg_sum,
+						  periods + 1);
+		sa->runnable_avg_period = decay_load(sa->runnable_avg_period,
+						     periods + 1);
+		delta_w = __compute_runnable_contrib(periods);
+		if (runnable)
+			sa->runnable_avg_sum += delta_w;
+		sa->runnable_avg_period += delta_w;
+	}
+
+	if (runnable)
+		sa->runnable_avg_sum += delta;
+	sa->runnable_avg_period += delta;
+}
+
+/* 0..1024 */
+static inline unsigned long sched_avg_util(struct sched_avg *sa)
+{
+	return (sa->runnable_avg_sum << 10) / (sa->runnable_avg_period + 1);
+}
+
+/* called with rq->lock held before nr_running changes, and on the tick */
+static void update_rq_runnable_avg(struct rq *rq)
+{
+	__update_runnable_avg(rq->clock, &rq->avg, rq->nr_running > 0);
+}
+
+/* for tasks only, before on_rq changes, and on the tick */
+static inline void update_entity_runnable_avg(struct cfs_rq *cfs_rq,
+					      struct sched_entity *se)
+{
+	if (entity_is_task(se))
+		__update_runnable_avg(rq_of(cfs_rq)->clock, &se->avg,
+				      se->on_rq);
+}
+
+/**
+ * sched_cpu_util - recent share of time @cpu had work, 0..1024
+ * @cpu: the cpu
+ *
+ * A runnable average with a half-life of about 32ms, see
+ * __update_runnable_avg().  Time spent running any class counts.
+ */
+unsigned long sched_cpu_util(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	struct sched_avg sa;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&rq->lock, flags);
+	sa = rq->avg;
+	/* an idle cpu has no tick to decay its average */
+	__update_runnable_avg(sched_clock_cpu(cpu), &sa, rq->nr_running > 0);
+	raw_spin_unlock_irqrestore(&rq->lock, flags);
+
+	return sched_avg_util(&sa);
+}
+EXPORT_SYMBOL_GPL(sched_cpu_util);
+
+/**
+ * sched_task_util - recent share of time @p was runnable, 0..1024
+ * @p: the task
+ *
+ * Waiting for a cpu counts as runnable.  Only fair class tasks are
+ * tracked; for others this is the value from when they last were.
+ */
+unsigned long sched_task_util(struct task_struct *p)
+{
+	struct sched_avg sa;
+	unsigned long flags;
+	struct rq *rq;
+
+	rq = task_rq_lock(p, &flags);
+	sa = p->se.avg;
+	__update_runnable_avg(sched_clock_cpu(cpu_of(rq)), &sa,
+			      p->se.on_rq);
+	task_rq_unlock(rq, p, &flags);
+
+	return sched_avg_util(&sa);
+}
+EXPORT_SYMBOL_GPL(sched_task_util);
+
+#ifdef CONFIG_SMP
+static inline bool task_is_small(struct task_struct *p)
+{
+	return sched_avg_util(&p->se.avg) < sysctl_sched_small_task_util;
+}
+
+/*
+ * Filling the low cores first leaves the high ones idle long enough for
+ * auto_hotplug to take them offline.  The averages of idle cpus are not
+ * decayed here, which only errs towards skipping them.
+ */
+static int select_pack_cpu(struct task_struct *p)
+{
+	unsigned long util = sched_avg_util(&p->se.avg);
+	int cpu;
+
+	for_each_cpu_and(cpu, cpu_active_mask, &p->cpus_allowed)
+		if (sched_avg_util(&cpu_rq(cpu)->avg) + util <=
+		    sysctl_sched_pack_util)
+			return cpu;
+	return -1;
+}
+#endif
+
 static void update_cfs_load(struct cfs_rq *cfs_rq, int global_update);
 static void update_cfs_shares(struct cfs_rq *cfs_rq);
 
@@ -964,6 +1225,7 @@ enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	 * Update run-time statistics of the 'current'.
 	 */
 	update_curr(cfs_rq);
+	update_entity_runnable_avg(cfs_rq, se);
 	update_cfs_load(cfs_rq, 0);
 	account_entity_enqueue(cfs_rq, se);
 	update_cfs_shares(cfs_rq);
@@ -1035,6 +1297,7 @@ dequeue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	 * Update run-time statistics of the 'current'.
 	 */
 	update_curr(cfs_rq);
+	update_entity_runnable_avg(cfs_rq, se);
 
 	update_stats_dequeue(cfs_rq, se);
 	if (flags & DEQUEUE_SLEEP) {
@@ -1210,6 +1473,7 @@ entity_tick(struct cfs_rq *cfs_rq, struct sched_entity *curr, int queued)
 	 * Update run-time statistics of the 'current'.
 	 */
 	update_curr(cfs_rq);
+	update_entity_runnable_avg(cfs_rq, curr);
 
 	/*
 	 * Update share accounting for long-running entities.
@@ -1679,6 +1943,14 @@ select_task_rq_fair(struct task_struct *p, int sd_flag, int wake_flags)
 	int want_sd = 1;
 	int sync = wake_flags & WF_SYNC;
 
+	if (sched_feat(SMALL_TASK_PACKING) && (sd_flag & SD_BALANCE_WAKE) &&
+	    task_is_small(p)) {
+		new_cpu = select_pack_cpu(p);
+		if (new_cpu >= 0)
+			return new_cpu;
+		new_cpu = cpu;
+	}
+
 	if (sd_flag & SD_BALANCE_WAKE) {
 		if (cpumask_test_cpu(cpu, &p->cpus_allowed))
 			want_affine = 1;
@@ -1790,7 +2062,7 @@ unlock:
 static unsigned long
 wakeup_gran(struct sched_entity *curr, struct sched_entity *se)
 {
-	unsigned long gran = sysctl_sched_wakeup_granularity;
+	unsigned long gran = entity_wakeup_gran(se);
 
 	/*
 	 * Since its curr running now, convert the gran from real-time
@@ -2064,6 +2336,12 @@ int can_migrate_task(struct task_struct *p, struct rq *rq, int this_cpu,
 		return 0;
 	}
 
+	/* don't spread what select_pack_cpu() packed while it still fits */
+	if (sched_feat(SMALL_TASK_PACKING) && this_cpu > cpu_of(rq) &&
+	    task_is_small(p) &&
+	    sched_avg_util(&rq->avg) <= sysctl_sched_pack_util)
+		return 0;
+
 	/*
 	 * Aggressive migration if:
 	 * 1) task is cache cold, or
@@ -3520,6 +3798,10 @@ static void idle_balance(int this_cpu, struct rq *this_rq)
 	if (this_rq->avg_idle < sysctl_sched_migration_cost)
 		return;
 
+	/* A parked cpu must not pull work onto itself */
+	if (cpu_parked(this_cpu))
+		return;
+
 	/*
 	 * Drop the rq->lock, but keep IRQ/preempt disabled.
 	 */
@@ -3802,8 +4084,11 @@ static void nohz_balancer_kick(int cpu)
 
 	ilb_cpu = get_nohz_load_balancer();
 
-	if (ilb_cpu >= nr_cpu_ids) {
-		ilb_cpu = cpumask_first(nohz.idle_cpus_mask);
+	if (ilb_cpu >= nr_cpu_ids || cpu_parked(ilb_cpu)) {
+		/* Don't wake a parked cpu just to balance the others */
+		for_each_cpu(ilb_cpu, nohz.idle_cpus_mask)
+			if (!cpu_parked(ilb_cpu))
+				break;
 		if (ilb_cpu >= nr_cpu_ids)
 			return;
 	}
@@ -3923,6 +4208,11 @@ static void rebalance_domains(int cpu, enum cpu_idle_type idle)
 	int update_next_balance = 0;
 	int need_serialize;
 
+	if (cpu_parked(cpu)) {
+		rq->next_balance = jiffies + HZ;
+		return;
+	}
+
 	update_shares(cpu);
 
 	rcu_read_lock();
@@ -4148,6 +4438,8 @@ static void task_tick_fair(struct rq *rq, struct task_struct *curr, int queued)
 		cfs_rq = cfs_rq_of(se);
 		entity_tick(cfs_rq, se, queued);
 	}
+
+	trace_sched_task_util(curr, sched_avg_util(&curr->se.avg));
 }
 
 /*
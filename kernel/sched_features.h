@@ -72,3 +72,9 @@ SCHED_FEAT(NONTASK_POWER, 1)
 SCHED_FEAT(TTWU_QUEUE, 1)
 
 SCHED_FEAT(FORCE_SD_OVERLAP, 0)
+
+/*
+ * Wake tasks with a small runnable average on the lowest-numbered cpu
+ * with room, and keep the load balancer from spreading them out again.
+ */
+SCHED_FEAT(SMALL_TASK_PACKING, 1)
@@ -19,6 +19,7 @@
 #include <linux/spinlock.h>
 #include <linux/interrupt.h>
 #include <linux/debug_locks.h>
+#include <linux/lock_profile.h>
 #include <linux/module.h>
 
 /*
@@ -43,26 +44,34 @@
  * time (making _this_ CPU preemptable if possible), and we also signal
  * towards that other CPU that it should break the lock ASAP.
  */
-#define BUILD_LOCK_OPS(op, locktype)					\
-void __lockfunc __raw_##op##_lock(locktype##_t *lock)			\
+#define BUILD_LOCK_OPS(op, locktype, type)				\
+static __always_inline void __raw_##op##_lock(locktype##_t *lock)	\
 {									\
+	u64 contended = 0, start = 0;					\
+									\
 	for (;;) {							\
 		preempt_disable();					\
 		if (likely(do_raw_##op##_trylock(lock)))		\
 			break;						\
 		preempt_enable();					\
 									\
+		if (!contended++)					\
+			start = lock_profile_start();			\
 		if (!(lock)->break_lock)				\
 			(lock)->break_lock = 1;				\
 		while (!raw_##op##_can_lock(lock) && (lock)->break_lock)\
 			arch_##op##_relax(&lock->raw_lock);		\
 	}								\
 	(lock)->break_lock = 0;						\
+	if (unlikely(start))						\
+		lock_profile_contended(lock, type, _RET_IP_, start);	\
 }									\
 									\
-unsigned long __lockfunc __raw_##op##_lock_irqsave(locktype##_t *lock)	\
+static __always_inline unsigned long					\
+__raw_##op##_lock_irqsave(locktype##_t *lock)				\
 {									\
 	unsigned long flags;						\
+	u64 contended = 0, start = 0;					\
 									\
 	for (;;) {							\
 		preempt_disable();					\
@@ -72,21 +81,25 @@ unsigned long __lockfunc __raw_##op##_lock_irqsave(locktype##_t *lock)	\
 		local_irq_restore(flags);				\
 		preempt_enable();					\
 									\
+		if (!contended++)					\
+			start = lock_profile_start();			\
 		if (!(lock)->break_lock)				\
 			(lock)->break_lock = 1;				\
 		while (!raw_##op##_can_lock(lock) && (lock)->break_lock)\
 			arch_##op##_relax(&lock->raw_lock);		\
 	}								\
 	(lock)->break_lock = 0;						\
+	if (unlikely(start))						\
+		lock_profile_contended(lock, type, _RET_IP_, start);	\
 	return flags;							\
 }									\
 									\
-void __lockfunc __raw_##op##_lock_irq(locktype##_t *lock)		\
+static __always_inline void __raw_##op##_lock_irq(locktype##_t *lock)	\
 {									\
-	_raw_##op##_lock_irqsave(lock);					\
+	__raw_##op##_lock_irqsave(lock);				\
 }									\
 									\
-void __lockfunc __raw_##op##_lock_bh(locktype##_t *lock)		\
+static __always_inline void __raw_##op##_lock_bh(locktype##_t *lock)	\
 {									\
 	unsigned long flags;						\
 									\
@@ -95,7 +108,7 @@ void __lockfunc __raw_##op##_lock_bh(locktype##_t *lock)		\
 	/* irq-disabling. We use the generic preemption-aware	*/	\
 	/* function:						*/	\
 	/**/								\
-	flags = _raw_##op##_lock_irqsave(lock);				\
+	flags = __raw_##op##_lock_irqsave(lock);			\
 	local_bh_disable();						\
 	local_irq_restore(flags);					\
 }									\
@@ -108,10 +121,13 @@ void __lockfunc __raw_##op##_lock_bh(locktype##_t *lock)		\
  *         __[spin|read|write]_lock_irq()
  *         __[spin|read|write]_lock_irqsave()
  *         __[spin|read|write]_lock_bh()
+ *
+ * They are inlined into the _raw_ functions below, so that _RET_IP_
+ * names the caller for the contention profiler.
  */
-BUILD_LOCK_OPS(spin, raw_spinlock);
-BUILD_LOCK_OPS(read, rwlock);
-BUILD_LOCK_OPS(write, rwlock);
+BUILD_LOCK_OPS(spin, raw_spinlock, LOCK_PROFILE_SPIN);
+BUILD_LOCK_OPS(read, rwlock, LOCK_PROFILE_READ);
+BUILD_LOCK_OPS(write, rwlock, LOCK_PROFILE_WRITE);
 
 #endif
 
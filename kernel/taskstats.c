@@ -27,6 +27,8 @@
 #include <linux/cgroup.h>
 #include <linux/fs.h>
 #include <linux/file.h>
+#include <linux/cred.h>
+#include <linux/task_io_accounting_ops.h>
 #include <net/genetlink.h>
 #include <linux/atomic.h>
 
@@ -51,7 +53,8 @@ static const struct nla_policy taskstats_cmd_get_policy[TASKSTATS_CMD_ATTR_MAX+1
 	[TASKSTATS_CMD_ATTR_PID]  = { .type = NLA_U32 },
 	[TASKSTATS_CMD_ATTR_TGID] = { .type = NLA_U32 },
 	[TASKSTATS_CMD_ATTR_REGISTER_CPUMASK] = { .type = NLA_STRING },
-	[TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK] = { .type = NLA_STRING },};
+	[TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK] = { .type = NLA_STRING },
+	[TASKSTATS_CMD_ATTR_UID]  = { .type = NLA_U32 },};
 
 static const struct nla_policy cgroupstats_cmd_get_policy[CGROUPSTATS_CMD_ATTR_MAX+1] = {
 	[CGROUPSTATS_CMD_ATTR_FD] = { .type = NLA_U32 },
@@ -262,6 +265,61 @@ out:
 	return rc;
 }
 
+/* Protects user_struct->ioac */
+static DEFINE_SPINLOCK(taskstats_uid_lock);
+
+/*
+ * Per-uid totals are the I/O of the user's exited threads, kept in its
+ * user_struct, plus that of its live threads.  Threads already past
+ * exit_signals() are left out of the walk, as they fold themselves into
+ * the user_struct on their way out.
+ */
+static int fill_stats_for_uid(uid_t uid, struct taskstats *stats)
+{
+	struct task_io_accounting ioac;
+	struct task_struct *g, *t;
+	struct user_struct *user;
+	bool found = false;
+
+	memset(&ioac, 0, sizeof(ioac));
+
+	user = find_user(uid);
+	if (user) {
+		spin_lock(&taskstats_uid_lock);
+		task_io_accounting_add(&ioac, &user->ioac);
+		spin_unlock(&taskstats_uid_lock);
+		free_uid(user);
+		found = true;
+	}
+
+	rcu_read_lock();
+	do_each_thread(g, t) {
+		if (task_uid(t) != uid || (t->flags & PF_EXITING))
+			continue;
+		task_io_accounting_add(&ioac, &t->ioac);
+		found = true;
+	} while_each_thread(g, t);
+	rcu_read_unlock();
+
+	if (!found)
+		return -ESRCH;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->version = TASKSTATS_VERSION;
+	stats->ac_uid = uid;
+	xacct_add_ioac(stats, &ioac);
+	return 0;
+}
+
+static void taskstats_uid_exit(struct task_struct *tsk)
+{
+	struct user_struct *user = tsk->real_cred->user;
+
+	spin_lock(&taskstats_uid_lock);
+	task_io_accounting_add(&user->ioac, &tsk->ioac);
+	spin_unlock(&taskstats_uid_lock);
+}
+
 static void fill_tgid_exit(struct task_struct *tsk)
 {
 	unsigned long flags;
@@ -364,9 +422,17 @@ static struct taskstats *mk_reply(struct sk_buff *skb, int type, u32 pid)
 	struct nlattr *na, *ret;
 	int aggr;
 
-	aggr = (type == TASKSTATS_TYPE_PID)
-			? TASKSTATS_TYPE_AGGR_PID
-			: TASKSTATS_TYPE_AGGR_TGID;
+	switch (type) {
+	case TASKSTATS_TYPE_PID:
+		aggr = TASKSTATS_TYPE_AGGR_PID;
+		break;
+	case TASKSTATS_TYPE_UID:
+		aggr = TASKSTATS_TYPE_AGGR_UID;
+		break;
+	default:
+		aggr = TASKSTATS_TYPE_AGGR_TGID;
+		break;
+	}
 
 	/*
 	 * The taskstats structure is internally aligned on 8 byte
@@ -554,6 +620,35 @@ err:
 	return rc;
 }
 
+static int cmd_attr_uid(struct genl_info *info)
+{
+	struct taskstats *stats;
+	struct sk_buff *rep_skb;
+	size_t size;
+	u32 uid;
+	int rc;
+
+	size = taskstats_packet_size();
+
+	rc = prepare_reply(info, TASKSTATS_CMD_NEW, &rep_skb, size);
+	if (rc < 0)
+		return rc;
+
+	rc = -EINVAL;
+	uid = nla_get_u32(info->attrs[TASKSTATS_CMD_ATTR_UID]);
+	stats = mk_reply(rep_skb, TASKSTATS_TYPE_UID, uid);
+	if (!stats)
+		goto err;
+
+	rc = fill_stats_for_uid(uid, stats);
+	if (rc < 0)
+		goto err;
+	return send_reply(rep_skb, info);
+err:
+	nlmsg_free(rep_skb);
+	return rc;
+}
+
 static int taskstats_user_cmd(struct sk_buff *skb, struct genl_info *info)
 {
 	if (info->attrs[TASKSTATS_CMD_ATTR_REGISTER_CPUMASK])
@@ -564,6 +659,8 @@ static int taskstats_user_cmd(struct sk_buff *skb, struct genl_info *info)
 		return cmd_attr_pid(info);
 	else if (info->attrs[TASKSTATS_CMD_ATTR_TGID])
 		return cmd_attr_tgid(info);
+	else if (info->attrs[TASKSTATS_CMD_ATTR_UID])
+		return cmd_attr_uid(info);
 	else
 		return -EINVAL;
 }
@@ -602,6 +699,8 @@ void taskstats_exit(struct task_struct *tsk, int group_dead)
 	size_t size;
 	int is_thread_group;
 
+	taskstats_uid_exit(tsk);
+
 	if (!family_registered)
 		return;
 
@@ -96,14 +96,30 @@ void xacct_add_tsk(struct taskstats *stats, struct task_struct *p)
 		stats->hiwater_vm    = get_mm_hiwater_vm(mm)  * PAGE_SIZE / KB;
 		mmput(mm);
 	}
-	stats->read_char	= p->ioac.rchar & KB_MASK;
-	stats->write_char	= p->ioac.wchar & KB_MASK;
-	stats->read_syscalls	= p->ioac.syscr & KB_MASK;
-	stats->write_syscalls	= p->ioac.syscw & KB_MASK;
+	xacct_add_ioac(stats, &p->ioac);
+}
+
+/*
+ * Fill the I/O fields of @stats from @ioac, which may be a single task's
+ * or a sum over several.
+ */
+void xacct_add_ioac(struct taskstats *stats, struct task_io_accounting *ioac)
+{
+	stats->read_char	= ioac->rchar & KB_MASK;
+	stats->write_char	= ioac->wchar & KB_MASK;
+	stats->read_syscalls	= ioac->syscr & KB_MASK;
+	stats->write_syscalls	= ioac->syscw & KB_MASK;
 #ifdef CONFIG_TASK_IO_ACCOUNTING
-	stats->read_bytes	= p->ioac.read_bytes & KB_MASK;
-	stats->write_bytes	= p->ioac.write_bytes & KB_MASK;
-	stats->cancelled_write_bytes = p->ioac.cancelled_write_bytes & KB_MASK;
+	stats->read_bytes	= ioac->read_bytes & KB_MASK;
+	stats->write_bytes	= ioac->write_bytes & KB_MASK;
+	stats->cancelled_write_bytes = ioac->cancelled_write_bytes & KB_MASK;
+	stats->pgcache_hits	= ioac->pgcache_hits;
+	stats->pgcache_misses	= ioac->pgcache_misses;
+	stats->pgcache_ra_hits	= ioac->pgcache_ra_hits;
+	stats->fsync_count	= ioac->fsync_count;
+	stats->fsync_delay_total = ioac->fsync_delay_total;
+	stats->fs_gc_count	= ioac->fs_gc_count;
+	stats->fs_gc_delay_total = ioac->fs_gc_delay_total;
 #else
 	stats->read_bytes	= 0;
 	stats->write_bytes	= 0;
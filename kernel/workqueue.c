@@ -44,6 +44,20 @@
 
 #include "workqueue_sched.h"
 
+#ifdef CONFIG_WORKQUEUE_STATS
+#include <linux/debugfs.h>
+#include <linux/hash.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+
+#define WQ_EXEC_HIST_BUCKETS	6
+#define WQ_FUNC_STATS_BITS	8
+#define WQ_FUNC_STATS_SIZE	(1 << WQ_FUNC_STATS_BITS)
+#define WQ_FUNC_TOP		20
+#endif
+
 enum {
 	/*
 	 * global_cwq flags
@@ -203,8 +217,32 @@ struct cpu_workqueue_struct {
 	int			nr_active;	/* L: nr of active works */
 	int			max_active;	/* L: max active works */
 	struct list_head	delayed_works;	/* L: delayed works */
+#ifdef CONFIG_WORKQUEUE_STATS
+	/* L: wall time of each work, <10us, <100us, ... , >=100ms */
+	unsigned long		exec_hist[WQ_EXEC_HIST_BUCKETS];
+	u64			exec_ns;	/* L: total wall time */
+	u64			max_exec_ns;	/* L: longest work */
+#endif
 };
 
+#ifdef CONFIG_WORKQUEUE_STATS
+/*
+ * Per work function accounting, for the top list in debugfs.  Keyed by
+ * the function only: a function queued on several workqueues is shown
+ * under the first one it ran on.
+ */
+struct wq_func_stats {
+	work_func_t		func;
+	const char		*wq_name;
+	unsigned long		count;
+	u64			cpu_ns;		/* cpu time, sleeps excluded */
+	u64			max_cpu_ns;
+	unsigned long		migrations;	/* runs on another cpu than
+						   the previous run */
+	int			last_cpu;
+};
+#endif
+
 /*
  * Structure used to wait for workqueue flush.
  */
@@ -457,6 +495,21 @@ static inline void debug_work_deactivate(struct work_struct *work) { }
 /* Serializes the accesses to the list of workqueues. */
 static DEFINE_SPINLOCK(workqueue_lock);
 static LIST_HEAD(workqueues);
+
+/*
+ * Work queued with queue_work() runs on the cpu that queued it.  cpu0
+ * takes most of the interrupts here, and is the one core hotplug never
+ * takes down, so with workqueue.avoid_cpu0 set such work is sent to
+ * another online, unparked cpu when there is one.
+ */
+static bool wq_avoid_cpu0;
+module_param_named(avoid_cpu0, wq_avoid_cpu0, bool, 0644);
+
+#ifdef CONFIG_WORKQUEUE_STATS
+static struct wq_func_stats wq_func_stats[WQ_FUNC_STATS_SIZE];
+static unsigned long wq_func_stats_dropped;
+static DEFINE_SPINLOCK(wq_stats_lock);
+#endif
 static bool workqueue_freezing;		/* W: have wqs started freezing? */
 
 /*
@@ -1064,11 +1117,30 @@ static void __queue_work(unsigned int cpu, struct workqueue_struct *wq,
  * We queue the work to the CPU on which it was submitted, but if the CPU dies
  * it can be processed by another CPU.
  */
+/*
+ * Pick the cpu for work queued on @cpu without a cpu of its own, see
+ * wq_avoid_cpu0.  Preemption is disabled by the caller, which keeps the
+ * target from going offline before the work is on its gcwq; whatever is
+ * still queued there when it does go is run by the unbound trustee.
+ */
+static int wq_select_cpu(struct workqueue_struct *wq, int cpu)
+{
+	int target;
+
+	if (likely(!wq_avoid_cpu0 || cpu != 0) || (wq->flags & WQ_UNBOUND))
+		return cpu;
+
+	for_each_online_cpu(target)
+		if (target != cpu && !cpu_parked(target))
+			return target;
+	return cpu;
+}
+
 int queue_work(struct workqueue_struct *wq, struct work_struct *work)
 {
 	int ret;
 
-	ret = queue_work_on(get_cpu(), wq, work);
+	ret = queue_work_on(wq_select_cpu(wq, get_cpu()), wq, work);
 	put_cpu();
 
 	return ret;
@@ -1913,6 +1985,61 @@ static void cwq_dec_nr_in_flight(struct cpu_workqueue_struct *cwq, int color,
 		complete(&cwq->wq->first_flusher->done);
 }
 
+#ifdef CONFIG_WORKQUEUE_STATS
+static void wq_account_func(struct cpu_workqueue_struct *cwq, work_func_t f,
+			    u64 cpu_ns, int cpu)
+{
+	unsigned long h = hash_ptr(f, WQ_FUNC_STATS_BITS);
+	struct wq_func_stats *fs;
+	int i;
+
+	spin_lock(&wq_stats_lock);
+	for (i = 0; i < WQ_FUNC_STATS_SIZE; i++) {
+		fs = &wq_func_stats[(h + i) & (WQ_FUNC_STATS_SIZE - 1)];
+		if (fs->func == f || !fs->func)
+			break;
+	}
+	if (i == WQ_FUNC_STATS_SIZE) {
+		wq_func_stats_dropped++;
+		goto out;
+	}
+	if (!fs->func) {
+		fs->func = f;
+		fs->wq_name = cwq->wq->name;
+		fs->last_cpu = cpu;
+	}
+	fs->count++;
+	fs->cpu_ns += cpu_ns;
+	if (cpu_ns > fs->max_cpu_ns)
+		fs->max_cpu_ns = cpu_ns;
+	if (fs->last_cpu != cpu)
+		fs->migrations++;
+	fs->last_cpu = cpu;
+out:
+	spin_unlock(&wq_stats_lock);
+}
+
+/*
+ * Account one execution of @f.  Called with gcwq->lock held, which
+ * covers the cwq counters.
+ */
+static void wq_account_work(struct cpu_workqueue_struct *cwq, work_func_t f,
+			    u64 exec_ns, u64 cpu_ns, int cpu)
+{
+	u64 limit = 10 * NSEC_PER_USEC;
+	int b;
+
+	for (b = 0; b < WQ_EXEC_HIST_BUCKETS - 1 && exec_ns >= limit; b++)
+		limit *= 10;
+	cwq->exec_hist[b]++;
+	cwq->exec_ns += exec_ns;
+	if (exec_ns > cwq->max_exec_ns)
+		cwq->max_exec_ns = exec_ns;
+
+	wq_account_func(cwq, f, cpu_ns, cpu);
+}
+#endif
+
 /**
  * process_one_work - process single work
  * @worker: self
@@ -1939,6 +2066,9 @@ __acquires(&gcwq->lock)
 	work_func_t f = work->func;
 	int work_color;
 	struct worker *collision;
+#ifdef CONFIG_WORKQUEUE_STATS
+	u64 start_ns, start_cpu_ns;
+#endif
 #ifdef CONFIG_LOCKDEP
 	/*
 	 * It is permissible to free the struct work_struct from
@@ -1995,7 +2125,15 @@ __acquires(&gcwq->lock)
 	lock_map_acquire_read(&cwq->wq->lockdep_map);
 	lock_map_acquire(&lockdep_map);
 	trace_workqueue_execute_start(work);
+#ifdef CONFIG_WORKQUEUE_STATS
+	start_ns = local_clock();
+	start_cpu_ns = task_sched_runtime(current);
+#endif
 	f(work);
+#ifdef CONFIG_WORKQUEUE_STATS
+	start_ns = local_clock() - start_ns;
+	start_cpu_ns = task_sched_runtime(current) - start_cpu_ns;
+#endif
 	/*
 	 * While we must be careful to not use "work" after this, the trace
 	 * point will only record its address.
@@ -2016,6 +2154,10 @@ __acquires(&gcwq->lock)
 
 	spin_lock_irq(&gcwq->lock);
 
+#ifdef CONFIG_WORKQUEUE_STATS
+	wq_account_work(cwq, f, start_ns, start_cpu_ns, raw_smp_processor_id());
+#endif
+
 	/* clear cpu intensive status */
 	if (unlikely(cpu_intensive))
 		worker_clr_flags(worker, WORKER_CPU_INTENSIVE);
@@ -3748,3 +3890,160 @@ static int __init init_workqueues(void)
 }
 early_initcall(init_workqueues);
 
+#ifdef CONFIG_WORKQUEUE_STATS
+static int wq_exec_hist_show(struct seq_file *s, void *unused)
+{
+	struct workqueue_struct *wq;
+	unsigned int cpu;
+	int b;
+
+	seq_printf(s, "%-24s %10s %8s %8s %8s %8s %8s %8s %8s %8s\n",
+		   "workqueue", "works", "avg_us", "max_us", "<10us",
+		   "<100us", "<1ms", "<10ms", "<100ms", ">=100ms");
+
+	spin_lock(&workqueue_lock);
+	list_for_each_entry(wq, &workqueues, list) {
+		unsigned long hist[WQ_EXEC_HIST_BUCKETS] = { 0 };
+		unsigned long n = 0;
+		u64 ns = 0, max_ns = 0;
+
+		for_each_cwq_cpu(cpu, wq) {
+			struct cpu_workqueue_struct *cwq = get_cwq(cpu, wq);
+
+			for (b = 0; b < WQ_EXEC_HIST_BUCKETS; b++) {
+				hist[b] += cwq->exec_hist[b];
+				n += cwq->exec_hist[b];
+			}
+			ns += cwq->exec_ns;
+			max_ns = max(max_ns, cwq->max_exec_ns);
+		}
+		if (!n)
+			continue;
+
+		seq_printf(s, "%-24s %10lu %8llu %8llu", wq->name, n,
+			   div_u64(div_u64(ns, n), NSEC_PER_USEC),
+			   div_u64(max_ns, NSEC_PER_USEC));
+		for (b = 0; b < WQ_EXEC_HIST_BUCKETS; b++)
+			seq_printf(s, " %8lu", hist[b]);
+		seq_printf(s, "\n");
+	}
+	spin_unlock(&workqueue_lock);
+	return 0;
+}
+
+static int wq_func_cmp(const void *a, const void *b)
+{
+	const struct wq_func_stats *fa = a, *fb = b;
+
+	if (fa->cpu_ns == fb->cpu_ns)
+		return 0;
+	return fa->cpu_ns < fb->cpu_ns ? 1 : -1;
+}
+
+static int wq_top_show(struct seq_file *s, void *unused)
+{
+	struct wq_func_stats *top;
+	unsigned long dropped;
+	int i;
+
+	top = vmalloc(sizeof(wq_func_stats));
+	if (!top)
+		return -ENOMEM;
+
+	spin_lock_irq(&wq_stats_lock);
+	memcpy(top, wq_func_stats, sizeof(wq_func_stats));
+	dropped = wq_func_stats_dropped;
+	spin_unlock_irq(&wq_stats_lock);
+
+	sort(top, WQ_FUNC_STATS_SIZE, sizeof(*top), wq_func_cmp, NULL);
+
+	seq_printf(s, "%10s %10s %8s %8s %8s  %-16s %s\n", "cpu_ms",
+		   "runs", "avg_us", "max_us", "migrate", "workqueue",
+		   "function");
+	for (i = 0; i < WQ_FUNC_TOP && top[i].func; i++)
+		seq_printf(s, "%10llu %10lu %8llu %8llu %8lu  %-16s %pf\n",
+			   div_u64(top[i].cpu_ns, NSEC_PER_MSEC), top[i].count,
+			   div_u64(div_u64(top[i].cpu_ns, top[i].count),
+				   NSEC_PER_USEC),
+			   div_u64(top[i].max_cpu_ns, NSEC_PER_USEC),
+			   top[i].migrations, top[i].wq_name, top[i].func);
+	if (dropped)
+		seq_printf(s, "%lu runs of functions not tracked, table full\n",
+			   dropped);
+
+	vfree(top);
+	return 0;
+}
+
+/* any write clears both tables */
+static ssize_t wq_stats_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	struct workqueue_struct *wq;
+	unsigned int cpu;
+
+	spin_lock(&workqueue_lock);
+	list_for_each_entry(wq, &workqueues, list) {
+		for_each_cwq_cpu(cpu, wq) {
+			struct global_cwq *gcwq = get_gcwq(cpu);
+			struct cpu_workqueue_struct *cwq = get_cwq(cpu, wq);
+
+			spin_lock_irq(&gcwq->lock);
+			memset(cwq->exec_hist, 0, sizeof(cwq->exec_hist));
+			cwq->exec_ns = 0;
+			cwq->max_exec_ns = 0;
+			spin_unlock_irq(&gcwq->lock);
+		}
+	}
+	spin_unlock(&workqueue_lock);
+
+	spin_lock_irq(&wq_stats_lock);
+	memset(wq_func_stats, 0, sizeof(wq_func_stats));
+	wq_func_stats_dropped = 0;
+	spin_unlock_irq(&wq_stats_lock);
+	return count;
+}
+
+static int wq_exec_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_exec_hist_show, NULL);
+}
+
+static int wq_top_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_top_show, NULL);
+}
+
+static const struct file_operations wq_exec_hist_fops = {
+	.open		= wq_exec_hist_open,
+	.read		= seq_read,
+	.write		= wq_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static const struct file_operations wq_top_fops = {
+	.open		= wq_top_open,
+	.read		= seq_read,
+	.write		= wq_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init wq_stats_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("workqueue", NULL);
+	if (!dir)
+		return -ENOMEM;
+	if (!debugfs_create_file("exec_hist", 0644, dir, NULL,
+				 &wq_exec_hist_fops) ||
+	    !debugfs_create_file("top", 0644, dir, NULL, &wq_top_fops)) {
+		debugfs_remove_recursive(dir);
+		return -ENOMEM;
+	}
+	return 0;
+}
+late_initcall(wq_stats_debugfs_init);
+#endif /* CONFIG_WORKQUEUE_STATS */
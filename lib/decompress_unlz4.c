@@ -0,0 +1,121 @@
+/*
+ * LZ4 decompressor for the kernel image and for initramfs.
+ *
+ * The input is the lz4 tool's legacy format, as written by "lz4 -l": a
+ * magic number, then blocks of up to 8 MiB of output, each stored as a
+ * little endian 32-bit compressed size followed by an LZ4 block.  The
+ * kernel image build appends the uncompressed size, which the boot
+ * decompressor uses to bound the last block exactly.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifdef STATIC
+#include "lz4/lz4_decompress.c"
+#else
+#include <linux/decompress/unlz4.h>
+#endif
+
+#include <linux/types.h>
+#include <linux/lz4.h>
+#include <linux/decompress/mm.h>
+
+#include <linux/compiler.h>
+#include <asm/unaligned.h>
+
+#define LZ4_LEGACY_MAGIC	0x184c2102
+#define LZ4_LEGACY_BLOCK_SIZE	(8 << 20)
+
+STATIC inline int INIT unlz4(u8 *input, int in_len,
+				int (*fill) (void *, unsigned int),
+				int (*flush) (void *, unsigned int),
+				u8 *output, int *posp,
+				void (*error) (char *x))
+{
+	u8 *in_buf = input;
+	u8 *out_buf;
+	size_t size = in_len;
+	size_t out_left = ~(size_t)0;
+	size_t chunk, out_len;
+	int ret = -1;
+
+	if (!input || fill) {
+		error("NYI: unlz4 only decompresses from memory");
+		goto exit;
+	}
+
+	if (output) {
+		out_buf = output;
+	} else if (!flush) {
+		error("NULL output pointer and no flush function provided");
+		goto exit;
+	} else {
+		out_buf = large_malloc(LZ4_LEGACY_BLOCK_SIZE);
+		if (!out_buf) {
+			error("Could not allocate output buffer");
+			goto exit;
+		}
+	}
+
+	if (size < 4 || get_unaligned_le32(in_buf) != LZ4_LEGACY_MAGIC) {
+		error("invalid header");
+		goto exit_1;
+	}
+	in_buf += 4;
+	size -= 4;
+
+#ifdef STATIC
+	/* a kernel image, which ends in its uncompressed size */
+	if (output) {
+		if (size < 4) {
+			error("file corrupted");
+			goto exit_1;
+		}
+		out_left = get_unaligned_le32(input + in_len - 4);
+	}
+#endif
+
+	/* anything up to 4 bytes left over is padding or that size */
+	while (size > 4) {
+		chunk = get_unaligned_le32(in_buf);
+		in_buf += 4;
+		size -= 4;
+
+		/* streams can be concatenated */
+		if (chunk == LZ4_LEGACY_MAGIC)
+			continue;
+		if (chunk > size) {
+			error("file corrupted");
+			goto exit_1;
+		}
+
+		out_len = LZ4_LEGACY_BLOCK_SIZE;
+		if (out_len > out_left)
+			out_len = out_left;
+		if (lz4_decompress_safe(in_buf, chunk, out_buf, &out_len)) {
+			error("Compressed data violation");
+			goto exit_1;
+		}
+
+		if (flush && flush(out_buf, out_len) != out_len)
+			goto exit_1;
+		if (output)
+			out_buf += out_len;
+		out_left -= out_len;
+		in_buf += chunk;
+		size -= chunk;
+	}
+
+	ret = 0;
+exit_1:
+	if (!output)
+		large_free(out_buf);
+exit:
+	if (posp)
+		*posp = in_buf - input;
+	return ret;
+}
+
+#define decompress unlz4
@@ -0,0 +1,133 @@
+/*
+ *  LZ4 compressor
+ *
+ *  Greedy matcher over a 4-byte hash table of input offsets. Runs of
+ *  unmatched input double the search step every 1 << SKIP_STRENGTH
+ *  misses, so incompressible data is rejected quickly.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+static inline u32 lz4_hash(const unsigned char *p)
+{
+	return (get_unaligned((const u32 *)p) * 2654435761U) >>
+		(32 - LZ4_HASH_LOG);
+}
+
+static inline unsigned char *lz4_put_length(unsigned char *op, size_t len)
+{
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = (unsigned char)len;
+	return op;
+}
+
+int lz4_compress(const unsigned char *in, size_t in_len,
+		unsigned char *out, size_t *out_len, void *wrkmem)
+{
+	const unsigned char * const in_end = in + in_len;
+	const unsigned char * const mflimit = in_end - MFLIMIT;
+	const unsigned char * const matchlimit = in_end - LASTLITERALS;
+	unsigned char * const op_end = out + *out_len;
+	const unsigned char *ip = in, *anchor = in;
+	unsigned char *op = out, *token;
+	u32 *table = wrkmem;
+	unsigned int attempts = 1U << SKIP_STRENGTH;
+	size_t lit, len;
+
+	if (in_len < MFLIMIT + 1)
+		goto last_literals;
+
+	memset(table, 0, LZ4_MEM_COMPRESS);
+
+	while (ip < mflimit) {
+		const unsigned char *ref, *mp, *rp;
+		u32 h = lz4_hash(ip);
+
+		ref = in + table[h];
+		table[h] = ip - in;
+
+		if (ref >= ip || ip - ref > MAX_DISTANCE ||
+		    get_unaligned((const u32 *)ref) !=
+		    get_unaligned((const u32 *)ip)) {
+			ip += attempts++ >> SKIP_STRENGTH;
+			continue;
+		}
+		attempts = 1U << SKIP_STRENGTH;
+
+		/* Catch up with bytes the hash skipped over */
+		while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+
+		mp = ip + MINMATCH;
+		rp = ref + MINMATCH;
+		while (mp < matchlimit && *mp == *rp) {
+			mp++;
+			rp++;
+		}
+
+		lit = ip - anchor;
+		len = mp - ip - MINMATCH;
+
+		if (op + 1 + lit + lit / 255 + 1 + 2 + len / 255 + 1 > op_end)
+			return LZ4_E_OUTPUT_OVERRUN;
+
+		token = op++;
+		if (lit >= RUN_MASK) {
+			*token = RUN_MASK << ML_BITS;
+			op = lz4_put_length(op, lit - RUN_MASK);
+		} else
+			*token = lit << ML_BITS;
+		memcpy(op, anchor, lit);
+		op += lit;
+
+		put_unaligned_le16(ip - ref, op);
+		op += 2;
+
+		if (len >= ML_MASK) {
+			*token |= ML_MASK;
+			op = lz4_put_length(op, len - ML_MASK);
+		} else
+			*token |= len;
+
+		ip = anchor = mp;
+
+		/* Seed the table with the tail of the match */
+		if (ip < mflimit)
+			table[lz4_hash(ip - 2)] = ip - 2 - in;
+	}
+
+last_literals:
+	lit = in_end - anchor;
+	if (op + 1 + lit + lit / 255 + 1 > op_end)
+		return LZ4_E_OUTPUT_OVERRUN;
+
+	token = op++;
+	if (lit >= RUN_MASK) {
+		*token = RUN_MASK << ML_BITS;
+		op = lz4_put_length(op, lit - RUN_MASK);
+	} else
+		*token = lit << ML_BITS;
+	memcpy(op, anchor, lit);
+	op += lit;
+
+	*out_len = op - out;
+	return LZ4_E_OK;
+}
+EXPORT_SYMBOL_GPL(lz4_compress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Compressor");
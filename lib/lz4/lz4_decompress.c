@@ -0,0 +1,113 @@
+/*
+ *  LZ4 decompressor
+ *
+ *  Every length, offset and copy is checked against the input and
+ *  output buffers, so a corrupted stream returns an error instead of
+ *  reading or writing out of bounds.  Away from the ends of both
+ *  buffers, literals and matches at least 8 bytes back are copied 8
+ *  bytes at a time on ARMv7.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#ifndef STATIC
+#include <linux/module.h>
+#include <linux/kernel.h>
+#endif
+
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+static inline int lz4_get_length(const unsigned char **ip,
+		const unsigned char *ip_end, size_t *len)
+{
+	unsigned int s;
+
+	do {
+		if (*ip >= ip_end)
+			return LZ4_E_INPUT_OVERRUN;
+		s = *(*ip)++;
+		*len += s;
+	} while (s == 255);
+
+	return 0;
+}
+
+int lz4_decompress_safe(const unsigned char *in, size_t in_len,
+		unsigned char *out, size_t *out_len)
+{
+	const unsigned char * const ip_end = in + in_len;
+	unsigned char * const op_end = out + *out_len;
+	const unsigned char *ip = in;
+	unsigned char *op = out;
+	size_t len, offset;
+	unsigned int token;
+
+	*out_len = 0;
+
+	while (ip < ip_end) {
+		token = *ip++;
+
+		/* literals */
+		len = token >> ML_BITS;
+		if (len == RUN_MASK && lz4_get_length(&ip, ip_end, &len))
+			return LZ4_E_INPUT_OVERRUN;
+		if (len > (size_t)(ip_end - ip))
+			return LZ4_E_INPUT_OVERRUN;
+		if (len > (size_t)(op_end - op))
+			return LZ4_E_OUTPUT_OVERRUN;
+		if (LZ4_FAST_COPY && len + 8 <= (size_t)(ip_end - ip) &&
+		    len + 8 <= (size_t)(op_end - op))
+			lz4_wild_copy(op, ip, len);
+		else
+			memcpy(op, ip, len);
+		op += len;
+		ip += len;
+
+		/* the last sequence has no match part */
+		if (ip == ip_end)
+			break;
+
+		if (ip_end - ip < 2)
+			return LZ4_E_INPUT_OVERRUN;
+		offset = get_unaligned_le16(ip);
+		ip += 2;
+		if (!offset || offset > (size_t)(op - out))
+			return LZ4_E_LOOKBEHIND_OVERRUN;
+
+		len = token & ML_MASK;
+		if (len == ML_MASK && lz4_get_length(&ip, ip_end, &len))
+			return LZ4_E_INPUT_OVERRUN;
+		len += MINMATCH;
+		if (len > (size_t)(op_end - op))
+			return LZ4_E_OUTPUT_OVERRUN;
+
+		if (LZ4_FAST_COPY && offset >= 8 &&
+		    len + 8 <= (size_t)(op_end - op)) {
+			lz4_wild_copy(op, op - offset, len);
+			op += len;
+		} else if (offset >= len) {
+			memcpy(op, op - offset, len);
+			op += len;
+		} else {
+			/* overlapping copy repeats the last offset bytes */
+			const unsigned char *ref = op - offset;
+
+			while (len--)
+				*op++ = *ref++;
+		}
+	}
+
+	*out_len = op - out;
+	return LZ4_E_OK;
+}
+#ifndef STATIC
+EXPORT_SYMBOL_GPL(lz4_decompress_safe);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Decompressor");
+#endif
@@ -0,0 +1,66 @@
+/*
+ *  lz4defs.h -- common definitions for the LZ4 block format
+ *
+ *  Block layout: a sequence is a token byte holding the literal
+ *  length (high nibble) and the match length minus MINMATCH (low
+ *  nibble), optional extra length bytes for lengths >= 15, the
+ *  literals, and a little endian 16-bit match offset. The last
+ *  sequence only carries literals.
+ */
+
+#define MINMATCH	4
+#define ML_BITS		4
+#define ML_MASK		((1U << ML_BITS) - 1)
+#define RUN_BITS	(8 - ML_BITS)
+#define RUN_MASK	((1U << RUN_BITS) - 1)
+
+#define MAX_DISTANCE	((1 << 16) - 1)
+
+/* The last match must start at least MFLIMIT bytes before the end */
+#define MFLIMIT		12
+/* and the last LASTLITERALS bytes are always literals */
+#define LASTLITERALS	5
+
+/* Miss count after which the compressor starts skipping input */
+#define SKIP_STRENGTH	6
+
+/*
+ * As in lib/lzo: ARMv6 and later do unaligned ldr and str in hardware,
+ * kept in asm so the compiler cannot merge them into ldrd or ldm, which
+ * still fault.  The boot decompressor clears the alignment fault bit
+ * itself before it gets here.
+ */
+#ifdef CONFIG_LZ4_UNALIGNED_COPY
+#define LZ4_FAST_COPY	1
+
+static inline u32 lz4_load32(const void *p)
+{
+	u32 v;
+
+	asm("ldr	%0, %1" : "=r" (v) : "m" (*(const u32 *)p));
+	return v;
+}
+
+static inline void lz4_store32(void *p, u32 v)
+{
+	asm("str	%1, %0" : "=m" (*(u32 *)p) : "r" (v));
+}
+#else
+#define LZ4_FAST_COPY	0
+#define lz4_load32(p)		get_unaligned((const u32 *)(p))
+#define lz4_store32(p, v)	put_unaligned((v), (u32 *)(p))
+#endif
+
+/* Copies 8 bytes at a time, and up to 7 bytes past @d + @len */
+static inline void lz4_wild_copy(unsigned char *d, const unsigned char *s,
+		size_t len)
+{
+	unsigned char * const e = d + len;
+
+	do {
+		lz4_store32(d, lz4_load32(s));
+		lz4_store32(d + 4, lz4_load32(s + 4));
+		d += 8;
+		s += 8;
+	} while (d < e);
+}
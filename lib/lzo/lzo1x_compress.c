@@ -93,9 +93,25 @@ match:
 				}
 				*op++ = tt;
 			}
-			do {
-				*op++ = *ii++;
-			} while (--t > 0);
+			/*
+			 * ip is below ip_end, so the source has slack, and the
+			 * match code written next covers the overrun.
+			 */
+			if (LZO_FAST_COPY) {
+				unsigned char *oe = op + t;
+
+				do {
+					COPY4(op, ii);
+					op += 4;
+					ii += 4;
+				} while (op < oe);
+				op = oe;
+				ii = ip;
+			} else {
+				do {
+					*op++ = *ii++;
+				} while (--t > 0);
+			}
 		}
 
 		ip += 3;
@@ -125,6 +141,21 @@ match:
 			end = in_end;
 			m = m_pos + M2_MAX_LEN + 1;
 
+			if (LZO_FAST_COPY) {
+				while (end - ip >= 4) {
+					u32 x = lzo_load32(m) ^ lzo_load32(ip);
+
+					if (x) {
+						/* little endian */
+						x = __ffs(x) >> 3;
+						m += x;
+						ip += x;
+						break;
+					}
+					m += 4;
+					ip += 4;
+				}
+			}
 			while (ip < end && *m == *ip) {
 				m++;
 				ip++;
@@ -24,9 +24,6 @@
 #define HAVE_OP(x, op_end, op) ((size_t)(op_end - op) < (x))
 #define HAVE_LB(m_pos, out, op) (m_pos < out || m_pos >= op)
 
-#define COPY4(dst, src)	\
-		put_unaligned(get_unaligned((const u32 *)(src)), (u32 *)(dst))
-
 int lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
 			unsigned char *out, size_t *out_len)
 {
@@ -72,6 +69,24 @@ int lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
 		if (HAVE_IP(t + 4, ip_end, ip))
 			goto input_overrun;
 
+		/*
+		 * t + 3 literals.  With 7 bytes of slack on both sides copy
+		 * whole words and let the last one run over.
+		 */
+		if (LZO_FAST_COPY && !HAVE_OP(t + 3 + 7, op_end, op) &&
+		    !HAVE_IP(t + 3 + 7, ip_end, ip)) {
+			unsigned char *oe = op + t + 3;
+
+			do {
+				COPY8(op, ip);
+				op += 8;
+				ip += 8;
+			} while (op < oe);
+			ip -= op - oe;
+			op = oe;
+			goto first_literal_run;
+		}
+
 		COPY4(op, ip);
 		op += 4;
 		ip += 4;
@@ -139,6 +154,8 @@ match:
 					}
 					t += 31 + *ip++;
 				}
+				if (HAVE_IP(2, ip_end, ip))
+					goto input_overrun;
 				m_pos = op - 1;
 				m_pos -= get_unaligned_le16(ip) >> 2;
 				ip += 2;
@@ -158,6 +175,8 @@ match:
 					}
 					t += 7 + *ip++;
 				}
+				if (HAVE_IP(2, ip_end, ip))
+					goto input_overrun;
 				m_pos -= get_unaligned_le16(ip) >> 2;
 				ip += 2;
 				if (m_pos == op)
@@ -183,6 +202,20 @@ match:
 			if (HAVE_OP(t + 3 - 1, op_end, op))
 				goto output_overrun;
 
+			/* t + 2 bytes; a distance of 8 can not overlap */
+			if (LZO_FAST_COPY && (op - m_pos) >= 8 &&
+			    !HAVE_OP(t + 2 + 7, op_end, op)) {
+				unsigned char *oe = op + t + 2;
+
+				do {
+					COPY8(op, m_pos);
+					op += 8;
+					m_pos += 8;
+				} while (op < oe);
+				op = oe;
+				goto match_done;
+			}
+
 			if (t >= 2 * 4 - (3 - 1) && (op - m_pos) >= 4) {
 				COPY4(op, m_pos);
 				op += 4;
@@ -216,11 +249,18 @@ match_next:
 			if (HAVE_IP(t + 1, ip_end, ip))
 				goto input_overrun;
 
-			*op++ = *ip++;
-			if (t > 1) {
+			if (LZO_FAST_COPY && !HAVE_OP(4, op_end, op) &&
+			    !HAVE_IP(4, ip_end, ip)) {
+				COPY4(op, ip);
+				op += t;
+				ip += t;
+			} else {
 				*op++ = *ip++;
-				if (t > 2)
+				if (t > 1) {
 					*op++ = *ip++;
+					if (t > 2)
+						*op++ = *ip++;
+				}
 			}
 
 			t = *ip++;
@@ -38,6 +38,41 @@
 #define D_MASK		((1u << D_BITS) - 1)
 #define D_HIGH		((D_MASK >> 1) + 1)
 
+/*
+ * ARMv6 and later do unaligned ldr and str in hardware, but
+ * get_unaligned() on ARM always goes a byte at a time.  ldrd and ldm
+ * still fault on unaligned addresses, so the word accesses are kept in
+ * asm where the compiler cannot merge them.  The boot decompressor
+ * (STATIC) keeps the portable version.
+ */
+#if defined(CONFIG_LZO_UNALIGNED_COPY) && !defined(STATIC)
+#define LZO_FAST_COPY	1
+
+static inline u32 lzo_load32(const void *p)
+{
+	u32 v;
+
+	asm("ldr	%0, %1" : "=r" (v) : "m" (*(const u32 *)p));
+	return v;
+}
+
+static inline void lzo_store32(void *p, u32 v)
+{
+	asm("str	%1, %0" : "=m" (*(u32 *)p) : "r" (v));
+}
+#else
+#define LZO_FAST_COPY	0
+#define lzo_load32(p)		get_unaligned((const u32 *)(p))
+#define lzo_store32(p, v)	put_unaligned((v), (u32 *)(p))
+#endif
+
+#define COPY4(dst, src)	lzo_store32(dst, lzo_load32(src))
+#define COPY8(dst, src)					\
+	do {						\
+		COPY4(dst, src);			\
+		COPY4((dst) + 4, (src) + 4);		\
+	} while (0)
+
 #define DX2(p, s1, s2)	(((((size_t)((p)[2]) << (s2)) ^ (p)[1]) \
 							<< (s1)) ^ (p)[0])
 #define DX3(p, s1, s2, s3)	((DX2((p)+1, s2, s3) << (s1)) ^ (p)[0])
@@ -0,0 +1,206 @@
+/*
+ * LZO self-test and speed test on captured pages.
+ *
+ * Loading the module copies a sample of pages spread over RAM, which is
+ * roughly what zram and zcache see under memory pressure, plus an all
+ * zero and an incompressible page.  Every page is compressed and
+ * decompressed into a buffer with guard bytes after it, and must come
+ * back unchanged without the guard being touched.  The stream is also
+ * decompressed into a buffer one byte short and with its last byte cut
+ * off, which must fail cleanly.  Then the whole sample is compressed and
+ * decompressed in a loop, and the time per page is printed together with
+ * a cycle estimate from the current cpu frequency.  The load fails on
+ * purpose so the module can be loaded again.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/cpufreq.h>
+#include <linux/highmem.h>
+#include <linux/ktime.h>
+#include <linux/lzo.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#define GUARD		64
+#define GUARD_BYTE	0xa5
+#define COMP_SIZE	lzo1x_worst_compress(PAGE_SIZE)
+
+static unsigned int pages = 256;
+module_param(pages, uint, 0);
+MODULE_PARM_DESC(pages, "Number of pages sampled from RAM");
+
+static unsigned int test_ms = 1000;
+module_param(test_ms, uint, 0);
+MODULE_PARM_DESC(test_ms, "Time spent on each of compression and "
+		 "decompression (ms)");
+
+/*
+ * Copy up to @want pages spread evenly over the pfn range.  Holes and
+ * reserved pages are skipped.  The first two slots are an all zero and
+ * a random page.
+ */
+static unsigned int capture_pages(u8 *buf, unsigned int want)
+{
+	unsigned long pfn = ARCH_PFN_OFFSET;
+	unsigned long end = ARCH_PFN_OFFSET + num_physpages;
+	unsigned long step = max((end - pfn) / want, 1UL);
+	unsigned int n = 2;
+
+	memset(buf, 0, PAGE_SIZE);
+	get_random_bytes(buf + PAGE_SIZE, PAGE_SIZE);
+
+	for (; pfn < end && n < want; pfn += step) {
+		struct page *page;
+		void *p;
+
+		if (!pfn_valid(pfn))
+			continue;
+		page = pfn_to_page(pfn);
+		if (PageReserved(page))
+			continue;
+		p = kmap_atomic(page, KM_USER0);
+		memcpy(buf + n * PAGE_SIZE, p, PAGE_SIZE);
+		kunmap_atomic(p, KM_USER0);
+		n++;
+	}
+	return n;
+}
+
+static bool guard_intact(const u8 *p)
+{
+	int i;
+
+	for (i = 0; i < GUARD; i++)
+		if (p[i] != GUARD_BYTE)
+			return false;
+	return true;
+}
+
+static int check_page(const u8 *src, u8 *comp, u8 *out, void *wrkmem)
+{
+	size_t clen, dlen;
+	int ret;
+
+	ret = lzo1x_1_compress(src, PAGE_SIZE, comp, &clen, wrkmem);
+	if (ret != LZO_E_OK || clen > COMP_SIZE)
+		return -EIO;
+
+	memset(out, GUARD_BYTE, PAGE_SIZE + GUARD);
+	dlen = PAGE_SIZE;
+	ret = lzo1x_decompress_safe(comp, clen, out, &dlen);
+	if (ret != LZO_E_OK || dlen != PAGE_SIZE ||
+	    memcmp(out, src, PAGE_SIZE) || !guard_intact(out + PAGE_SIZE))
+		return -EIO;
+
+	/* one byte short of room: must stop at the end of the buffer */
+	memset(out, GUARD_BYTE, PAGE_SIZE + GUARD);
+	dlen = PAGE_SIZE - 1;
+	ret = lzo1x_decompress_safe(comp, clen, out, &dlen);
+	if (ret == LZO_E_OK || !guard_intact(out + PAGE_SIZE - 1))
+		return -EIO;
+
+	/* truncated stream */
+	dlen = PAGE_SIZE;
+	ret = lzo1x_decompress_safe(comp, clen - 1, out, &dlen);
+	if (ret == LZO_E_OK || !guard_intact(out + PAGE_SIZE))
+		return -EIO;
+
+	return 0;
+}
+
+static void report(const char *what, s64 ns, unsigned int runs,
+		   unsigned int n)
+{
+	unsigned int khz = cpufreq_quick_get(raw_smp_processor_id());
+	u64 ns_page = div64_u64(ns, (u64)runs * n);
+
+	pr_info("test_lzo: %-10s %6llu ns/page, ~%llu cycles/page at %u MHz\n",
+		what, ns_page, div_u64(ns_page * khz, 1000000), khz / 1000);
+}
+
+static int __init test_lzo_speed_init(void)
+{
+	u8 *src, *comp, *out;
+	size_t *clen;
+	void *wrkmem;
+	unsigned int n, i, runs;
+	u64 total = 0;
+	ktime_t start;
+	s64 ns;
+	int ret = -ENOMEM;
+
+	if (pages < 2)
+		pages = 2;
+	src = vmalloc(pages * PAGE_SIZE);
+	comp = vmalloc(pages * COMP_SIZE);
+	out = kmalloc(PAGE_SIZE + GUARD, GFP_KERNEL);
+	clen = kmalloc(pages * sizeof(*clen), GFP_KERNEL);
+	wrkmem = kmalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
+	if (!src || !comp || !out || !clen || !wrkmem)
+		goto out;
+
+	n = capture_pages(src, pages);
+
+	for (i = 0; i < n; i++) {
+		if (check_page(src + i * PAGE_SIZE, comp, out, wrkmem)) {
+			pr_err("test_lzo: round trip failed on page %u\n", i);
+			ret = -EIO;
+			goto out;
+		}
+	}
+	pr_info("test_lzo: %u pages passed\n", n);
+
+	runs = 0;
+	start = ktime_get();
+	do {
+		for (i = 0; i < n; i++)
+			lzo1x_1_compress(src + i * PAGE_SIZE, PAGE_SIZE,
+					 comp + i * COMP_SIZE, &clen[i],
+					 wrkmem);
+		runs++;
+		cond_resched();
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	} while (ns < (s64)test_ms * NSEC_PER_MSEC);
+	report("compress", ns, runs, n);
+
+	for (i = 0; i < n; i++)
+		total += clen[i];
+	pr_info("test_lzo: %u bytes per page on average\n",
+		(unsigned int)div_u64(total, n));
+
+	runs = 0;
+	start = ktime_get();
+	do {
+		for (i = 0; i < n; i++) {
+			size_t dlen = PAGE_SIZE;
+
+			lzo1x_decompress_safe(comp + i * COMP_SIZE, clen[i],
+					      out, &dlen);
+		}
+		runs++;
+		cond_resched();
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	} while (ns < (s64)test_ms * NSEC_PER_MSEC);
+	report("decompress", ns, runs, n);
+
+	ret = -EAGAIN;
+out:
+	kfree(wrkmem);
+	kfree(clen);
+	kfree(out);
+	vfree(comp);
+	vfree(src);
+	return ret;
+}
+module_init(test_lzo_speed_init);
+MODULE_LICENSE("GPL");
@@ -0,0 +1,106 @@
+/*
+ * RCU grace-period and callback speed test.
+ *
+ * Build the same kernel once with JRCU and once with TREE_PREEMPT_RCU and
+ * load this module on each to compare them.  It times synchronize_rcu()
+ * from an idle start, which is what a caller sees after the system has
+ * been quiet, and back to back, then queues a flood of call_rcu()
+ * callbacks and times how long rcu_barrier() takes to see them all run.
+ * Wakeups while idle are not measured here; JRCU counts its frames as
+ * #passes in debugfs rcu/rcudata.  The load fails on purpose so the
+ * module can be loaded again.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/rcupdate.h>
+#include <linux/vmalloc.h>
+
+#ifdef CONFIG_JRCU
+#define RCU_NAME	"jrcu"
+#else
+#define RCU_NAME	"tree"
+#endif
+
+static unsigned int syncs = 20;
+module_param(syncs, uint, 0);
+MODULE_PARM_DESC(syncs, "Number of synchronize_rcu() calls timed");
+
+static unsigned int callbacks = 10000;
+module_param(callbacks, uint, 0);
+MODULE_PARM_DESC(callbacks, "Number of call_rcu() callbacks queued");
+
+static unsigned int idle_ms = 2000;
+module_param(idle_ms, uint, 0);
+MODULE_PARM_DESC(idle_ms, "Sleep before each idle synchronize_rcu() (ms)");
+
+static atomic_t invoked;
+
+static void count_cb(struct rcu_head *head)
+{
+	atomic_inc(&invoked);
+}
+
+static void report(const char *what, s64 total, s64 max, unsigned int n)
+{
+	pr_info("test_rcu: %s %-10s avg %6llu us, max %6llu us over %u\n",
+		RCU_NAME, what, div_u64(div_u64(total, n), NSEC_PER_USEC),
+		div_u64(max, NSEC_PER_USEC), n);
+}
+
+static void time_syncs(const char *what, unsigned int sleep_ms)
+{
+	s64 ns, total = 0, max = 0;
+	unsigned int i;
+	ktime_t start;
+
+	for (i = 0; i < syncs; i++) {
+		if (sleep_ms)
+			msleep(sleep_ms);
+		start = ktime_get();
+		synchronize_rcu();
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		total += ns;
+		max = max(max, ns);
+	}
+	report(what, total, max, syncs);
+}
+
+static int __init test_rcu_speed_init(void)
+{
+	struct rcu_head *heads;
+	unsigned int i;
+	ktime_t start;
+	s64 ns;
+
+	if (!syncs)
+		syncs = 1;
+	heads = vmalloc(callbacks * sizeof(*heads));
+	if (!heads)
+		return -ENOMEM;
+
+	time_syncs("idle sync", idle_ms);
+	time_syncs("busy sync", 0);
+
+	atomic_set(&invoked, 0);
+	start = ktime_get();
+	for (i = 0; i < callbacks; i++)
+		call_rcu(&heads[i], count_cb);
+	rcu_barrier();
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	pr_info("test_rcu: %s %u of %u callbacks run in %llu us\n",
+		RCU_NAME, atomic_read(&invoked), callbacks,
+		div_u64(ns, NSEC_PER_USEC));
+
+	vfree(heads);
+	return -EAGAIN;
+}
+module_init(test_rcu_speed_init);
+MODULE_LICENSE("GPL");
@@ -0,0 +1,130 @@
+/*
+ * Speed test for memcpy(), memset() and copy_page().
+ *
+ * Loading the module prints MB/s for each function over a range of
+ * sizes, from L1 resident to well past the L2, and then fails the load
+ * so the module can be loaded again.  When the architecture has NEON
+ * versions (CONFIG_NEON_STRING_OPS) each size is run with them off and
+ * on.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#ifdef CONFIG_NEON_STRING_OPS
+#include <asm/neon.h>
+#endif
+
+#define BUF_SIZE	(4 << 20)
+
+static unsigned int test_ms = 200;
+module_param(test_ms, uint, 0);
+MODULE_PARM_DESC(test_ms, "Time spent on each size (ms)");
+
+static const unsigned int sizes[] = {
+	64, 256, 1024, 4096, 16384, 65536, 262144, 1 << 20, BUF_SIZE
+};
+
+enum { T_MEMCPY, T_MEMSET, T_COPY_PAGE };
+static const char * const names[] = { "memcpy", "memset", "copy_page" };
+
+static void run_once(int test, char *dst, char *src, unsigned int size)
+{
+	unsigned int off;
+
+	switch (test) {
+	case T_MEMCPY:
+		memcpy(dst, src, size);
+		break;
+	case T_MEMSET:
+		memset(dst, src[0], size);
+		break;
+	case T_COPY_PAGE:
+		for (off = 0; off < size; off += PAGE_SIZE)
+			copy_page(dst + off, src + off);
+		break;
+	}
+}
+
+/* MB/s for one function and size */
+static unsigned int measure(int test, char *dst, char *src,
+			    unsigned int size)
+{
+	ktime_t start, end;
+	u64 bytes = 0;
+	s64 ns;
+
+	/* copy_page works on whole pages */
+	if (test == T_COPY_PAGE)
+		size = round_up(size, PAGE_SIZE);
+
+	run_once(test, dst, src, size);
+	start = ktime_get();
+	do {
+		run_once(test, dst, src, size);
+		bytes += size;
+		end = ktime_get();
+		cond_resched();
+	} while (ktime_to_ms(ktime_sub(end, start)) < test_ms);
+
+	ns = ktime_to_ns(ktime_sub(end, start));
+	return div64_u64(bytes * 1000, ns ? ns : 1);
+}
+
+static void test_string_speed(const char *variant, char *dst, char *src)
+{
+	int test, i;
+
+	for (test = T_MEMCPY; test <= T_COPY_PAGE; test++) {
+		for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+			if (test == T_COPY_PAGE && sizes[i] < PAGE_SIZE)
+				continue;
+			pr_info("%s %-9s %8u bytes: %6u MB/s\n", variant,
+				names[test], sizes[i],
+				measure(test, dst, src, sizes[i]));
+		}
+	}
+}
+
+static int __init test_string_speed_init(void)
+{
+	char *src, *dst;
+
+	src = vmalloc(BUF_SIZE);
+	dst = vmalloc(BUF_SIZE);
+	if (!src || !dst) {
+		vfree(src);
+		vfree(dst);
+		return -ENOMEM;
+	}
+	memset(src, 0x5a, BUF_SIZE);
+	memset(dst, 0, BUF_SIZE);
+
+#ifdef CONFIG_NEON_STRING_OPS
+	if (neon_string_enable) {
+		neon_string_enable = false;
+		test_string_speed("arm ", dst, src);
+		neon_string_enable = true;
+		test_string_speed("neon", dst, src);
+	} else
+		test_string_speed("arm ", dst, src);
+#else
+	test_string_speed("", dst, src);
+#endif
+
+	vfree(src);
+	vfree(dst);
+	return -EAGAIN;
+}
+module_init(test_string_speed_init);
+MODULE_LICENSE("GPL");
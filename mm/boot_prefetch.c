@@ -0,0 +1,534 @@
+/*
+ * mm/boot_prefetch.c - prefetch the files needed during boot
+ *
+ * Most of the page cache misses of a boot are the same from one boot to
+ * the next: the libraries and framework jars under /system.  When
+ * booted with boot_prefetch.trace=1, the first demand miss of every page
+ * that is read or faulted in through the page cache is logged, until
+ * trace_secs after boot.  The log can be read back from
+ * /sys/kernel/debug/boot_prefetch/trace as lines of
+ *
+ *	<path> <first page> <number of pages>
+ *
+ * On the next boot, init writes the path of a saved copy to
+ * /sys/module/boot_prefetch/parameters/start as soon as /system is
+ * mounted.  A kernel thread then opens every file of the list and issues
+ * readahead for its ranges, in the order they were needed, so that
+ * zygote and the early services find them in the page cache.
+ *
+ * eval_secs after the prefetch the thread checks which of the prefetched
+ * pages were used since, and reports it in
+ * /sys/kernel/debug/boot_prefetch/summary.  Paths, not inode numbers,
+ * are recorded since a kernel thread can only find its files by name.
+ */
+
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/pagemap.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/hash.h>
+#include <linux/jiffies.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/delay.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#define BP_TRACE_RANGES		64
+#define BP_TRACE_HASH_BITS	8
+/* Holes up to this many pages are folded into the previous range */
+#define BP_TRACE_GAP		8
+/* Largest list file that is accepted */
+#define BP_LIST_MAX		(1 << 20)
+
+/*
+ * Tracing
+ */
+struct bp_trace_file {
+	struct hlist_node hash;
+	struct list_head list;
+	dev_t dev;
+	unsigned long ino;
+	char *path;
+	unsigned int nr_ranges;
+	struct {
+		pgoff_t start;
+		unsigned long len;
+	} ranges[BP_TRACE_RANGES];
+};
+
+int boot_prefetch_tracing __read_mostly;
+module_param_named(trace, boot_prefetch_tracing, int, 0644);
+MODULE_PARM_DESC(trace, "Log the page cache misses of this boot");
+
+static unsigned int trace_secs = 60;
+module_param(trace_secs, uint, 0644);
+MODULE_PARM_DESC(trace_secs, "Stop tracing this many seconds after boot");
+
+static unsigned int trace_max_files = 2048;
+module_param(trace_max_files, uint, 0644);
+MODULE_PARM_DESC(trace_max_files, "Number of files traced at most");
+
+static DEFINE_SPINLOCK(bp_trace_lock);
+static struct hlist_head bp_trace_hash[1 << BP_TRACE_HASH_BITS];
+static LIST_HEAD(bp_trace_list);
+static unsigned int bp_trace_nr;
+
+static inline struct hlist_head *bp_trace_bucket(dev_t dev, unsigned long ino)
+{
+	return &bp_trace_hash[hash_long(ino ^ dev, BP_TRACE_HASH_BITS)];
+}
+
+/* Called with bp_trace_lock held */
+static struct bp_trace_file *bp_trace_find(struct inode *inode)
+{
+	struct hlist_node *node;
+	struct bp_trace_file *tf;
+
+	hlist_for_each_entry(tf, node,
+			bp_trace_bucket(inode->i_sb->s_dev, inode->i_ino), hash) {
+		if (tf->ino == inode->i_ino && tf->dev == inode->i_sb->s_dev)
+			return tf;
+	}
+	return NULL;
+}
+
+static struct bp_trace_file *bp_trace_alloc(struct file *file)
+{
+	struct inode *inode = file->f_mapping->host;
+	struct bp_trace_file *tf;
+	char *buf, *path;
+
+	buf = __getname();
+	if (!buf)
+		return NULL;
+
+	path = d_path(&file->f_path, buf, PATH_MAX);
+	/* The list is split at white space, don't bother with such names */
+	if (IS_ERR(path) || strpbrk(path, " \t\n")) {
+		tf = NULL;
+		goto out;
+	}
+
+	tf = kzalloc(sizeof(*tf), GFP_KERNEL);
+	if (!tf)
+		goto out;
+	tf->path = kstrdup(path, GFP_KERNEL);
+	if (!tf->path) {
+		kfree(tf);
+		tf = NULL;
+		goto out;
+	}
+	tf->dev = inode->i_sb->s_dev;
+	tf->ino = inode->i_ino;
+out:
+	__putname(buf);
+	return tf;
+}
+
+static void bp_trace_add(struct bp_trace_file *tf, pgoff_t index)
+{
+	unsigned int i;
+
+	if (tf->nr_ranges) {
+		i = tf->nr_ranges - 1;
+		if (index >= tf->ranges[i].start &&
+		    index <= tf->ranges[i].start + tf->ranges[i].len +
+				BP_TRACE_GAP) {
+			tf->ranges[i].len = max(tf->ranges[i].len,
+					index - tf->ranges[i].start + 1);
+			return;
+		}
+	}
+
+	for (i = 0; i < tf->nr_ranges; i++)
+		if (index >= tf->ranges[i].start &&
+		    index < tf->ranges[i].start + tf->ranges[i].len)
+			return;
+
+	if (tf->nr_ranges == BP_TRACE_RANGES)
+		return;
+	tf->ranges[tf->nr_ranges].start = index;
+	tf->ranges[tf->nr_ranges].len = 1;
+	tf->nr_ranges++;
+}
+
+/*
+ * Called on a page cache miss of @index, which the caller is about to
+ * read synchronously.  The caller may sleep.
+ */
+void __boot_prefetch_trace(struct file *file, pgoff_t index)
+{
+	struct inode *inode = file->f_mapping->host;
+	struct bp_trace_file *tf, *new = NULL;
+
+	if (time_after(jiffies, INITIAL_JIFFIES + trace_secs * HZ)) {
+		boot_prefetch_tracing = 0;
+		return;
+	}
+	if (!inode->i_sb->s_bdev)
+		return;
+
+	spin_lock(&bp_trace_lock);
+	tf = bp_trace_find(inode);
+	if (!tf) {
+		if (bp_trace_nr >= trace_max_files)
+			goto out;
+		spin_unlock(&bp_trace_lock);
+		new = bp_trace_alloc(file);
+		if (!new)
+			return;
+		spin_lock(&bp_trace_lock);
+		tf = bp_trace_find(inode);
+		if (!tf) {
+			tf = new;
+			new = NULL;
+			hlist_add_head(&tf->hash,
+				       bp_trace_bucket(tf->dev, tf->ino));
+			list_add_tail(&tf->list, &bp_trace_list);
+			bp_trace_nr++;
+		}
+	}
+	bp_trace_add(tf, index);
+out:
+	spin_unlock(&bp_trace_lock);
+	if (new) {
+		kfree(new->path);
+		kfree(new);
+	}
+}
+
+/*
+ * Prefetching
+ */
+struct bp_entry {
+	struct list_head list;
+	struct file *file;
+	pgoff_t start;
+	unsigned long len;
+};
+
+enum {
+	BP_IDLE,
+	BP_PREFETCHING,
+	BP_WAITING,
+	BP_DONE,
+};
+
+static const char * const bp_state_names[] = {
+	"idle", "prefetching", "waiting", "done",
+};
+
+static unsigned int max_pages = 16384;
+module_param(max_pages, uint, 0644);
+MODULE_PARM_DESC(max_pages, "Pages prefetched at most");
+
+static unsigned int eval_secs = 60;
+module_param(eval_secs, uint, 0644);
+MODULE_PARM_DESC(eval_secs, "Check the use of prefetched pages this much later");
+
+static DEFINE_MUTEX(bp_mutex);
+static int bp_state = BP_IDLE;
+static char *bp_list_path;
+static struct {
+	unsigned int files;
+	unsigned int missing;
+	unsigned long ranges;
+	unsigned long pages_read;
+	unsigned long pages_used;
+	unsigned long pages_unused;
+	unsigned long pages_evicted;
+	s64 prefetch_us;
+} bp_stats;
+
+static void bp_parse(char *buf, struct list_head *entries)
+{
+	char *line, *path, *last_path;
+	unsigned long start, len;
+	unsigned long total = 0;
+	struct file *last = NULL;
+
+	path = __getname();
+	last_path = __getname();
+	if (!path || !last_path)
+		goto out;
+	last_path[0] = '\0';
+
+	while ((line = strsep(&buf, "\n")) != NULL) {
+		struct bp_entry *e;
+		struct file *file;
+
+		if (sscanf(line, "%4095s %lu %lu", path, &start, &len) != 3 ||
+		    !len)
+			continue;
+		if (total >= max_pages)
+			break;
+		len = min(len, max_pages - total);
+
+		/* Lines of one file usually follow each other */
+		if (last && !strcmp(path, last_path)) {
+			get_file(last);
+			file = last;
+		} else {
+			file = filp_open(path, O_RDONLY | O_LARGEFILE, 0);
+			if (IS_ERR(file)) {
+				bp_stats.missing++;
+				continue;
+			}
+			if (!S_ISREG(file->f_path.dentry->d_inode->i_mode) ||
+			    !file->f_mapping->a_ops->readpage) {
+				fput(file);
+				continue;
+			}
+			bp_stats.files++;
+		}
+
+		e = kmalloc(sizeof(*e), GFP_KERNEL);
+		if (!e) {
+			fput(file);
+			break;
+		}
+		e->file = file;
+		e->start = start;
+		e->len = len;
+		list_add_tail(&e->list, entries);
+
+		last = file;
+		strcpy(last_path, path);
+		bp_stats.ranges++;
+		total += len;
+	}
+out:
+	if (last_path)
+		__putname(last_path);
+	if (path)
+		__putname(path);
+}
+
+static char *bp_read_list(const char *path)
+{
+	struct file *file;
+	loff_t size;
+	char *buf;
+	int ret;
+
+	file = filp_open(path, O_RDONLY | O_LARGEFILE, 0);
+	if (IS_ERR(file))
+		return NULL;
+
+	buf = NULL;
+	size = i_size_read(file->f_path.dentry->d_inode);
+	if (size <= 0 || size > BP_LIST_MAX)
+		goto out;
+
+	buf = vmalloc(size + 1);
+	if (!buf)
+		goto out;
+	ret = kernel_read(file, 0, buf, size);
+	if (ret < 0) {
+		vfree(buf);
+		buf = NULL;
+		goto out;
+	}
+	buf[ret] = '\0';
+out:
+	fput(file);
+	return buf;
+}
+
+/* Tell apart the prefetched pages that got used from those that did not */
+static void bp_evaluate(struct bp_entry *e)
+{
+	struct address_space *mapping = e->file->f_mapping;
+	pgoff_t index;
+
+	for (index = e->start; index < e->start + e->len; index++) {
+		struct page *page = find_get_page(mapping, index);
+
+		if (!page) {
+			bp_stats.pages_evicted++;
+			continue;
+		}
+		if (PageReferenced(page) || PageActive(page) ||
+		    page_mapped(page))
+			bp_stats.pages_used++;
+		else
+			bp_stats.pages_unused++;
+		page_cache_release(page);
+		cond_resched();
+	}
+}
+
+static int bp_thread(void *unused)
+{
+	LIST_HEAD(entries);
+	struct bp_entry *e, *tmp;
+	ktime_t start;
+	char *buf;
+
+	buf = bp_read_list(bp_list_path);
+	if (buf) {
+		bp_parse(buf, &entries);
+		vfree(buf);
+	}
+
+	start = ktime_get();
+	list_for_each_entry(e, &entries, list) {
+		int ret = force_page_cache_readahead(e->file->f_mapping,
+				e->file, e->start, e->len);
+		if (ret > 0)
+			bp_stats.pages_read += ret;
+	}
+	bp_stats.prefetch_us = ktime_us_delta(ktime_get(), start);
+
+	mutex_lock(&bp_mutex);
+	bp_state = BP_WAITING;
+	mutex_unlock(&bp_mutex);
+
+	ssleep(eval_secs);
+
+	list_for_each_entry_safe(e, tmp, &entries, list) {
+		bp_evaluate(e);
+		list_del(&e->list);
+		fput(e->file);
+		kfree(e);
+	}
+
+	mutex_lock(&bp_mutex);
+	bp_state = BP_DONE;
+	mutex_unlock(&bp_mutex);
+	return 0;
+}
+
+static int bp_start(const char *val, const struct kernel_param *kp)
+{
+	struct task_struct *task;
+	char *path;
+	int ret = 0;
+
+	path = kstrdup(strstrip((char *)val), GFP_KERNEL);
+	if (!path)
+		return -ENOMEM;
+
+	mutex_lock(&bp_mutex);
+	if (bp_state == BP_PREFETCHING || bp_state == BP_WAITING) {
+		ret = -EBUSY;
+		goto out;
+	}
+	kfree(bp_list_path);
+	bp_list_path = path;
+	path = NULL;
+	memset(&bp_stats, 0, sizeof(bp_stats));
+
+	task = kthread_run(bp_thread, NULL, "boot_prefetch");
+	if (IS_ERR(task))
+		ret = PTR_ERR(task);
+	else
+		bp_state = BP_PREFETCHING;
+out:
+	mutex_unlock(&bp_mutex);
+	kfree(path);
+	return ret;
+}
+
+static struct kernel_param_ops bp_start_ops = {
+	.set = bp_start,
+};
+module_param_cb(start, &bp_start_ops, NULL, 0200);
+MODULE_PARM_DESC(start, "Prefetch the files of this list");
+
+#ifdef CONFIG_DEBUG_FS
+static int bp_trace_show(struct seq_file *m, void *unused)
+{
+	struct bp_trace_file *tf;
+	unsigned int i;
+
+	spin_lock(&bp_trace_lock);
+	list_for_each_entry(tf, &bp_trace_list, list)
+		for (i = 0; i < tf->nr_ranges; i++)
+			seq_printf(m, "%s %lu %lu\n", tf->path,
+				   tf->ranges[i].start, tf->ranges[i].len);
+	spin_unlock(&bp_trace_lock);
+	return 0;
+}
+
+static int bp_summary_show(struct seq_file *m, void *unused)
+{
+	unsigned long saved_ms = 0;
+
+	mutex_lock(&bp_mutex);
+	/*
+	 * The pages used would have been read synchronously otherwise, so
+	 * their share of the prefetch time is what the boot was spared.
+	 */
+	if (bp_state == BP_DONE && bp_stats.pages_read)
+		saved_ms = div_u64(bp_stats.prefetch_us *
+				   min(bp_stats.pages_used,
+				       bp_stats.pages_read),
+				   bp_stats.pages_read * 1000);
+
+	seq_printf(m, "state: %s\n", bp_state_names[bp_state]);
+	seq_printf(m, "list: %s\n", bp_list_path ? bp_list_path : "");
+	seq_printf(m, "files: %u\n", bp_stats.files);
+	seq_printf(m, "ranges_missing: %u\n", bp_stats.missing);
+	seq_printf(m, "ranges: %lu\n", bp_stats.ranges);
+	seq_printf(m, "prefetch_ms: %lld\n", div_s64(bp_stats.prefetch_us,
+						      1000));
+	seq_printf(m, "read_bytes: %lu\n", bp_stats.pages_read << PAGE_SHIFT);
+	if (bp_state == BP_DONE) {
+		seq_printf(m, "used_bytes: %lu\n",
+			   bp_stats.pages_used << PAGE_SHIFT);
+		seq_printf(m, "wasted_bytes: %lu\n",
+			   bp_stats.pages_unused << PAGE_SHIFT);
+		seq_printf(m, "evicted_bytes: %lu\n",
+			   bp_stats.pages_evicted << PAGE_SHIFT);
+		seq_printf(m, "est_saved_ms: %lu\n", saved_ms);
+	}
+	seq_printf(m, "tracing: %d\n", boot_prefetch_tracing);
+	seq_printf(m, "traced_files: %u\n", bp_trace_nr);
+	mutex_unlock(&bp_mutex);
+	return 0;
+}
+
+static int bp_trace_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, bp_trace_show, NULL);
+}
+
+static int bp_summary_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, bp_summary_show, NULL);
+}
+
+static const struct file_operations bp_trace_fops = {
+	.open		= bp_trace_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static const struct file_operations bp_summary_fops = {
+	.open		= bp_summary_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init boot_prefetch_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("boot_prefetch", NULL);
+	if (!dir)
+		return -ENOMEM;
+	debugfs_create_file("trace", 0400, dir, NULL, &bp_trace_fops);
+	debugfs_create_file("summary", 0444, dir, NULL, &bp_summary_fops);
+	return 0;
+}
+late_initcall(boot_prefetch_debugfs_init);
+#endif
@@ -0,0 +1,286 @@
+/*
+ * linux/mm/cma.c
+ *
+ * Contiguous memory regions.  Memory that a device needs physically
+ * contiguous now and then, like a carveout, is reserved at boot as
+ * before, but is then handed to the page allocator as MIGRATE_CMA
+ * pageblocks, which only movable allocations fall back to.  When the
+ * owner claims a range of its region the pages in use there are migrated
+ * out, and released ranges go back to the page allocator.
+ *
+ * The claim latency, which is mostly migration, is kept per region in
+ * debugfs "cma"; writing to the file resets it.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/mm.h>
+#include <linux/gfp.h>
+#include <linux/highmem.h>
+#include <linux/memblock.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/cma.h>
+
+#define MAX_CMA_REGIONS		4
+/* claim latency buckets: <1, <4, <16, <64, <256 and >= 256 ms */
+#define CMA_HIST_BUCKETS	6
+
+struct cma_region {
+	const char *name;
+	unsigned long base_pfn;
+	unsigned long count;
+	bool active;
+
+	unsigned long claimed;		/* pages the owner holds now */
+	unsigned long claims;
+	unsigned long failed;
+	u64 total_ns;
+	u64 max_ns;
+	unsigned long hist[CMA_HIST_BUCKETS];
+};
+
+static struct cma_region cma_regions[MAX_CMA_REGIONS];
+static unsigned int cma_region_count;
+
+/* claims isolate whole pageblocks, which must not overlap between two */
+static DEFINE_MUTEX(cma_mutex);
+
+/**
+ * cma_declare_contiguous() - reserve a contiguous memory region
+ * @base:	physical start, aligned to MAX_ORDER pages
+ * @size:	size in bytes, aligned to MAX_ORDER pages
+ * @name:	shown in debugfs
+ *
+ * Called from the machine's reserve hook, while memblock is in charge.
+ * The region stays reserved until the page allocator is up, and is then
+ * given to it.  On failure the caller still owns the memory and should
+ * take it out of the memory map as it did without CMA.
+ */
+int __init cma_declare_contiguous(phys_addr_t base, phys_addr_t size,
+				  const char *name)
+{
+	phys_addr_t align = PAGE_SIZE << max(MAX_ORDER - 1, pageblock_order);
+	struct cma_region *r;
+
+	if (cma_region_count == ARRAY_SIZE(cma_regions))
+		return -ENOSPC;
+	if (!size || !IS_ALIGNED(base | size, align))
+		return -EINVAL;
+	if (memblock_is_region_reserved(base, size) ||
+	    memblock_reserve(base, size))
+		return -EBUSY;
+
+	r = &cma_regions[cma_region_count++];
+	r->name = name;
+	r->base_pfn = PFN_DOWN(base);
+	r->count = size >> PAGE_SHIFT;
+	pr_info("cma: %s: %lu MiB at %08llx\n", name,
+		(unsigned long)(size >> 20), (unsigned long long)base);
+	return 0;
+}
+
+static int __init cma_activate_region(struct cma_region *r)
+{
+	unsigned long pfn, end = r->base_pfn + r->count;
+	struct zone *zone;
+
+	if (!pfn_valid(r->base_pfn))
+		return -EINVAL;
+	zone = page_zone(pfn_to_page(r->base_pfn));
+	for (pfn = r->base_pfn; pfn < end; pfn++)
+		if (!pfn_valid(pfn) || page_zone(pfn_to_page(pfn)) != zone)
+			return -EINVAL;
+
+	for (pfn = r->base_pfn; pfn < end; pfn += pageblock_nr_pages)
+		init_cma_reserved_pageblock(pfn_to_page(pfn));
+	r->active = true;
+	return 0;
+}
+
+static int __init cma_init_reserved_regions(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < cma_region_count; i++) {
+		struct cma_region *r = &cma_regions[i];
+
+		/* left reserved, the owner uses it as a plain carveout */
+		if (cma_activate_region(r))
+			pr_err("cma: %s: not in a single zone, left reserved\n",
+			       r->name);
+	}
+	return 0;
+}
+core_initcall(cma_init_reserved_regions);
+
+static struct cma_region *cma_find(phys_addr_t base, size_t size)
+{
+	unsigned long pfn = PFN_DOWN(base);
+	unsigned long count = size >> PAGE_SHIFT;
+	unsigned int i;
+
+	for (i = 0; i < cma_region_count; i++) {
+		struct cma_region *r = &cma_regions[i];
+
+		if (r->active && pfn >= r->base_pfn &&
+		    pfn + count <= r->base_pfn + r->count)
+			return r;
+	}
+	return NULL;
+}
+
+bool cma_region_contains(phys_addr_t base, size_t size)
+{
+	return cma_find(base, size) != NULL;
+}
+EXPORT_SYMBOL(cma_region_contains);
+
+static void cma_account(struct cma_region *r, int ret, u64 ns)
+{
+	unsigned int ms = div_u64(ns, NSEC_PER_MSEC);
+	unsigned int bucket = 0;
+
+	if (ret) {
+		r->failed++;
+		return;
+	}
+	while (bucket < CMA_HIST_BUCKETS - 1 && ms >= 1U << (2 * bucket))
+		bucket++;
+	r->hist[bucket]++;
+	r->claims++;
+	r->total_ns += ns;
+	r->max_ns = max(r->max_ns, ns);
+}
+
+/**
+ * cma_claim() - take a range of a region back from the page allocator
+ * @base:	physical start, page aligned
+ * @size:	size in bytes, page aligned
+ *
+ * Migrates the pages in use out of the range, which can sleep for a
+ * while.  Fails with -EBUSY if some of them stay pinned.  The caller
+ * must still clean the caches of whatever the previous owners left.
+ */
+int cma_claim(phys_addr_t base, size_t size)
+{
+	unsigned long pfn = PFN_DOWN(base);
+	unsigned long count = size >> PAGE_SHIFT;
+	struct cma_region *r;
+	ktime_t start;
+	int ret;
+
+	r = cma_find(base, size);
+	if (!r || !count || !IS_ALIGNED(base | size, PAGE_SIZE))
+		return -EINVAL;
+
+	mutex_lock(&cma_mutex);
+	start = ktime_get();
+	ret = alloc_contig_range(pfn, pfn + count, MIGRATE_CMA);
+	if (!ret) {
+		/* unused permanent kmaps of the old pages are aliases */
+		kmap_flush_unused();
+		r->claimed += count;
+	}
+	cma_account(r, ret, ktime_to_ns(ktime_sub(ktime_get(), start)));
+	mutex_unlock(&cma_mutex);
+	return ret;
+}
+EXPORT_SYMBOL(cma_claim);
+
+/**
+ * cma_release() - give a claimed range back to the page allocator
+ * @base:	as passed to cma_claim()
+ * @size:	as passed to cma_claim()
+ */
+void cma_release(phys_addr_t base, size_t size)
+{
+	unsigned long count = size >> PAGE_SHIFT;
+	struct cma_region *r;
+
+	r = cma_find(base, size);
+	if (WARN_ON(!r))
+		return;
+
+	mutex_lock(&cma_mutex);
+	free_contig_range(PFN_DOWN(base), count);
+	r->claimed -= min(r->claimed, count);
+	mutex_unlock(&cma_mutex);
+}
+EXPORT_SYMBOL(cma_release);
+
+#ifdef CONFIG_DEBUG_FS
+
+static int cma_stats_show(struct seq_file *s, void *data)
+{
+	unsigned int i;
+
+	mutex_lock(&cma_mutex);
+	for (i = 0; i < cma_region_count; i++) {
+		struct cma_region *r = &cma_regions[i];
+		u64 avg = r->claims ? div_u64(r->total_ns, r->claims) : 0;
+
+		seq_printf(s, "%s: %lu KiB at %08llx, %s, %lu KiB claimed\n",
+			   r->name, r->count << (PAGE_SHIFT - 10),
+			   (unsigned long long)PFN_PHYS(r->base_pfn),
+			   r->active ? "shared" : "reserved",
+			   r->claimed << (PAGE_SHIFT - 10));
+		seq_printf(s, "  claims %lu failed %lu avg %llu us "
+			   "max %llu us\n", r->claims, r->failed,
+			   div_u64(avg, NSEC_PER_USEC),
+			   div_u64(r->max_ns, NSEC_PER_USEC));
+		seq_printf(s, "  ms <1 %lu <4 %lu <16 %lu <64 %lu <256 %lu "
+			   ">=256 %lu\n", r->hist[0], r->hist[1], r->hist[2],
+			   r->hist[3], r->hist[4], r->hist[5]);
+	}
+	mutex_unlock(&cma_mutex);
+	return 0;
+}
+
+/* any write clears the latency counters */
+static ssize_t cma_stats_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	unsigned int i;
+
+	mutex_lock(&cma_mutex);
+	for (i = 0; i < cma_region_count; i++) {
+		struct cma_region *r = &cma_regions[i];
+
+		r->claims = 0;
+		r->failed = 0;
+		r->total_ns = 0;
+		r->max_ns = 0;
+		memset(r->hist, 0, sizeof(r->hist));
+	}
+	mutex_unlock(&cma_mutex);
+	return count;
+}
+
+static int cma_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cma_stats_show, NULL);
+}
+
+static const struct file_operations cma_stats_fops = {
+	.open		= cma_stats_open,
+	.read		= seq_read,
+	.write		= cma_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init cma_debugfs_init(void)
+{
+	if (!cma_region_count)
+		return 0;
+	if (!debugfs_create_file("cma", S_IRUGO | S_IWUSR, NULL, NULL,
+				 &cma_stats_fops))
+		return -ENOMEM;
+	return 0;
+}
+late_initcall(cma_debugfs_init);
+
+#endif
@@ -14,6 +14,8 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -34,6 +36,7 @@ struct compact_control {
 	unsigned long free_pfn;		/* isolate_freepages search base */
 	unsigned long migrate_pfn;	/* isolate_migratepages search base */
 	bool sync;			/* Synchronous migration */
+	bool background;		/* kcompactd, any free block will do */
 
 	unsigned int order;		/* order a direct compactor needs */
 	int migratetype;		/* MOVABLE, RECLAIMABLE etc */
@@ -446,12 +449,19 @@ static int compact_finished(struct zone *zone,
 		return COMPACT_CONTINUE;
 
 	/* Compaction run is not finished if the watermark is not met */
-	watermark = low_wmark_pages(zone);
+	if (cc->background)
+		watermark = high_wmark_pages(zone);
+	else
+		watermark = low_wmark_pages(zone);
 	watermark += (1 << cc->order);
 
 	if (!zone_watermark_ok(zone, cc->order, watermark, 0, 0))
 		return COMPACT_CONTINUE;
 
+	/* kcompactd does not allocate, the watermark is all it is after */
+	if (cc->background)
+		return COMPACT_PARTIAL;
+
 	/* Direct compactor: Is a suitable page free? */
 	for (order = cc->order; order < MAX_ORDER; order++) {
 		/* Job done if page is free of the right migratetype */
@@ -523,6 +533,10 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 	ret = compaction_suitable(zone, cc->order);
 	switch (ret) {
 	case COMPACT_PARTIAL:
+		/* kcompactd aims above the watermark an allocation needs */
+		if (cc->background)
+			break;
+		/* fall through */
 	case COMPACT_SKIPPED:
 		/* Compaction is likely to fail */
 		return ret;
@@ -649,6 +663,136 @@ unsigned long try_to_compact_pages(struct zonelist *zonelist,
 	return rc;
 }
 
+/*
+ * kcompactd keeps a few free blocks of sysctl_kcompactd_order around, so
+ * that high-order allocations find them without compacting directly.  It
+ * is woken by the allocator once the zone drops below the high watermark
+ * at that order, and only migrates asynchronously.  0 turns it off.
+ */
+int sysctl_kcompactd_order = PAGE_ALLOC_COSTLY_ORDER;
+
+/* a pass that could not bring a zone back is not retried for this long */
+#define KCOMPACTD_RETRY		HZ
+
+static bool kcompactd_zone_ok(struct zone *zone, int order)
+{
+	return zone_watermark_ok(zone, order,
+				 high_wmark_pages(zone) + (1UL << order), 0, 0);
+}
+
+bool kcompactd_running(struct zone *zone)
+{
+	return sysctl_kcompactd_order && zone->zone_pgdat->kcompactd;
+}
+
+/* Called from the allocator, possibly in atomic context */
+void wakeup_kcompactd(struct zone *zone, int order)
+{
+	pg_data_t *pgdat = zone->zone_pgdat;
+	int target = sysctl_kcompactd_order;
+
+	if (!target || !pgdat->kcompactd || order > target)
+		return;
+	if (time_before(jiffies, pgdat->kcompactd_retry))
+		return;
+	if (kcompactd_zone_ok(zone, target))
+		return;
+
+	pgdat->kcompactd_max_order = target;
+	if (pgdat->kcompactd_classzone_idx < zone_idx(zone))
+		pgdat->kcompactd_classzone_idx = zone_idx(zone);
+	if (!waitqueue_active(&pgdat->kcompactd_wait))
+		return;
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+static bool kcompactd_work_requested(pg_data_t *pgdat)
+{
+	return pgdat->kcompactd_max_order > 0 || kthread_should_stop();
+}
+
+static void kcompactd_do_work(pg_data_t *pgdat)
+{
+	int order = pgdat->kcompactd_max_order;
+	enum zone_type classzone_idx = pgdat->kcompactd_classzone_idx;
+	bool missed = false;
+	int zoneid;
+
+	pgdat->kcompactd_max_order = 0;
+	pgdat->kcompactd_classzone_idx = 0;
+	count_vm_event(KCOMPACTD_WAKE);
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+		struct compact_control cc = {
+			.nr_freepages = 0,
+			.nr_migratepages = 0,
+			.order = order,
+			.migratetype = MIGRATE_MOVABLE,
+			.zone = zone,
+			.sync = false,
+			.background = true,
+		};
+
+		if (!populated_zone(zone) || kcompactd_zone_ok(zone, order))
+			continue;
+		if (kthread_should_stop())
+			return;
+
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+		compact_zone(zone, &cc);
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+
+		/* freed pages sit on this cpu's lists until they merge */
+		drain_local_pages(NULL);
+		if (!kcompactd_zone_ok(zone, order))
+			missed = true;
+	}
+
+	if (missed)
+		pgdat->kcompactd_retry = jiffies + KCOMPACTD_RETRY;
+}
+
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = p;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(pgdat->kcompactd_wait,
+				     kcompactd_work_requested(pgdat));
+		if (!kthread_should_stop())
+			kcompactd_do_work(pgdat);
+	}
+	return 0;
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_HIGH_MEMORY) {
+		pg_data_t *pgdat = NODE_DATA(nid);
+		struct task_struct *t;
+
+		pgdat->kcompactd_retry = jiffies;
+		t = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+		if (IS_ERR(t)) {
+			pr_err("Failed to start kcompactd on node %d\n", nid);
+			continue;
+		}
+		pgdat->kcompactd = t;
+	}
+	return 0;
+}
+module_init(kcompactd_init);
 
 /* Compact all zones within a node */
 static int compact_node(int nid)
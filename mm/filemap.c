@@ -34,6 +34,7 @@
 #include <linux/hardirq.h> /* for BUG_ON(!in_atomic()) only */
 #include <linux/memcontrol.h>
 #include <linux/cleancache.h>
+#include <linux/task_io_accounting_ops.h>
 #include "internal.h"
 
 /*
@@ -43,6 +44,9 @@
 
 #include <asm/mman.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/filemap.h>
+
 /*
  * Shared mappings implemented 30.11.1994. It's not fully working yet,
  * though.
@@ -487,8 +491,14 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 	int ret;
 
 	ret = add_to_page_cache(page, mapping, offset, gfp_mask);
-	if (ret == 0)
-		lru_cache_add_file(page);
+	if (ret == 0) {
+		/* evicted recently enough to have stayed, had it been active */
+		if (page_is_file_cache(page) &&
+		    workingset_refault(mapping, page))
+			lru_cache_add_lru(page, LRU_ACTIVE_FILE);
+		else
+			lru_cache_add_file(page);
+	}
 	return ret;
 }
 EXPORT_SYMBOL_GPL(add_to_page_cache_lru);
@@ -1087,6 +1097,28 @@ static void shrink_readahead_size_eio(struct file *filp,
  * This is really ugly. But the goto's actually try to clarify some
  * of the logic when it comes to error handling etc.
  */
+/*
+ * Account the first lookup of a page by read() or a fault to the task, and
+ * trace it against the file.
+ */
+static inline void page_cache_account_access(struct address_space *mapping,
+					     pgoff_t index, struct page *page)
+{
+	int result;
+
+	if (!page) {
+		task_io_account_pgcache_miss();
+		result = PGCACHE_MISS;
+	} else if (PageReadahead(page)) {
+		task_io_account_pgcache_ra_hit();
+		result = PGCACHE_RA_HIT;
+	} else {
+		task_io_account_pgcache_hit();
+		result = PGCACHE_HIT;
+	}
+	trace_mm_filemap_access(mapping->host, index, result);
+}
+
 static void do_generic_file_read(struct file *filp, loff_t *ppos,
 		read_descriptor_t *desc, read_actor_t actor)
 {
@@ -1113,9 +1145,12 @@ static void do_generic_file_read(struct file *filp, loff_t *ppos,
 		unsigned long nr, ret;
 
 		cond_resched();
+		readahead_record(mapping, index);
 find_page:
 		page = find_get_page(mapping, index);
+		page_cache_account_access(mapping, index, page);
 		if (!page) {
+			boot_prefetch_trace(filp, index);
 			page_cache_sync_readahead(mapping,
 					ra, filp,
 					index, last_index - index);
@@ -1654,10 +1689,13 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	if (offset >= size)
 		return VM_FAULT_SIGBUS;
 
+	readahead_record(mapping, offset);
+
 	/*
 	 * Do we have something in the page cache already?
 	 */
 	page = find_get_page(mapping, offset);
+	page_cache_account_access(mapping, offset, page);
 	if (likely(page)) {
 		/*
 		 * We found the page, so try async readahead before
@@ -1666,6 +1704,7 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 		do_async_mmap_readahead(vma, ra, file, page, offset);
 	} else {
 		/* No page in the page cache at all */
+		boot_prefetch_trace(file, offset);
 		do_sync_mmap_readahead(vma, ra, file, offset);
 		count_vm_event(PGMAJFAULT);
 		mem_cgroup_count_vm_event(vma->vm_mm, PGMAJFAULT);
@@ -94,10 +94,16 @@ static DECLARE_WAIT_QUEUE_HEAD(pkmap_map_wait);
 		do { spin_unlock(&kmap_lock); (void)(flags); } while (0)
 #endif
 
+/*
+ * Past this many pages a flush of the kmap area invalidates the whole TLB,
+ * one broadcast operation instead of one per page.
+ */
+#define PKMAP_FLUSH_ALL_PAGES	64
+
 static void flush_all_zero_pkmaps(void)
 {
 	int i;
-	int need_flush = 0;
+	int first = LAST_PKMAP, last = -1, nr = 0;
 
 	flush_cache_kmaps();
 
@@ -129,10 +135,23 @@ static void flush_all_zero_pkmaps(void)
 			  &pkmap_page_table[i]);
 
 		set_page_address(page, NULL);
-		need_flush = 1;
+		first = min(first, i);
+		last = i;
+		nr++;
+	}
+	if (!nr)
+		return;
+
+	/* only the span that was unmapped, often much less than all of it */
+	count_vm_event(PKMAP_FLUSH);
+	count_vm_events(PKMAP_FLUSH_PAGES, nr);
+	if (last - first >= PKMAP_FLUSH_ALL_PAGES) {
+		count_vm_event(PKMAP_FLUSH_ALL);
+		flush_tlb_all();
+	} else {
+		flush_tlb_kernel_range(PKMAP_ADDR(first),
+				       PKMAP_ADDR(last + 1));
 	}
-	if (need_flush)
-		flush_tlb_kernel_range(PKMAP_ADDR(0), PKMAP_ADDR(LAST_PKMAP));
 }
 
 /**
@@ -170,6 +189,7 @@ start:
 		{
 			DECLARE_WAITQUEUE(wait, current);
 
+			count_vm_event(PKMAP_WAIT);
 			__set_current_state(TASK_UNINTERRUPTIBLE);
 			add_wait_queue(&pkmap_map_wait, &wait);
 			unlock_kmap();
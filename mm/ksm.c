@@ -36,6 +36,9 @@
 #include <linux/hash.h>
 #include <linux/freezer.h>
 #include <linux/oom.h>
+#ifdef CONFIG_HAS_EARLYSUSPEND
+#include <linux/earlysuspend.h>
+#endif
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -192,6 +195,21 @@ static unsigned int ksm_thread_sleep_millisecs = 20;
 /* Boolean to indicate whether to use deferred timer or not */
 static bool use_deferred_timer = true;
 
+/*
+ * With adaptive set, every full scan that merges fewer than one page in
+ * a thousand doubles the sleep between batches, up to 32 times; a scan
+ * that merges more, or a new mm to scan, goes back to full speed.
+ */
+static bool ksm_adaptive = true;
+#define KSM_MAX_BACKOFF	5
+static unsigned int ksm_backoff;
+static unsigned long ksm_pass_scanned;
+static unsigned long ksm_pass_merged;
+
+/* Leave scanning to when the screen is off */
+static bool ksm_defer_screen_on = true;
+static bool ksm_screen_on = true;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -456,6 +474,7 @@ static void remove_node_from_stable_tree(struct stable_node *stable_node)
 			ksm_pages_sharing--;
 		else
 			ksm_pages_shared--;
+		rmap_item->mm->ksm_merging_pages--;
 		put_anon_vma(rmap_item->anon_vma);
 		rmap_item->address &= PAGE_MASK;
 		cond_resched();
@@ -543,6 +562,7 @@ static void remove_rmap_item_from_tree(struct rmap_item *rmap_item)
 			ksm_pages_sharing--;
 		else
 			ksm_pages_shared--;
+		rmap_item->mm->ksm_merging_pages--;
 
 		put_anon_vma(rmap_item->anon_vma);
 		rmap_item->address &= PAGE_MASK;
@@ -672,13 +692,35 @@ error:
 }
 #endif /* CONFIG_SYSFS */
 
+/*
+ * The checksum only has to notice that a page changed since the last
+ * scan, the merge itself compares the contents.  Instead of jhash2, whose
+ * rounds depend on each other, run a sum and a sum of sums in four lanes
+ * of independent words, which the cpu can overlap and a vectoriser can
+ * map onto NEON, and mix the lanes at the end.
+ */
 static u32 calc_checksum(struct page *page)
 {
-	u32 checksum;
-	void *addr = kmap_atomic(page, KM_USER0);
-	checksum = jhash2(addr, PAGE_SIZE / 4, 17);
-	kunmap_atomic(addr, KM_USER0);
-	return checksum;
+	const u32 *p = kmap_atomic(page, KM_USER0);
+	u32 s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	u32 t0 = 0, t1 = 0, t2 = 0, t3 = 0;
+	unsigned int i;
+
+	for (i = 0; i < PAGE_SIZE / 4; i += 4) {
+		s0 += p[i];
+		s1 += p[i + 1];
+		s2 += p[i + 2];
+		s3 += p[i + 3];
+		t0 += s0;
+		t1 += s1;
+		t2 += s2;
+		t3 += s3;
+	}
+	kunmap_atomic((void *)p, KM_USER0);
+
+	return jhash_3words(s0 ^ rol32(s1, 8) ^ rol32(s2, 16) ^ rol32(s3, 24),
+			    t0 ^ rol32(t1, 8) ^ rol32(t2, 16) ^ rol32(t3, 24),
+			    0, 17);
 }
 
 static int memcmp_pages(struct page *page1, struct page *page2)
@@ -1160,6 +1202,8 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 		ksm_pages_sharing++;
 	else
 		ksm_pages_shared++;
+	rmap_item->mm->ksm_merging_pages++;
+	ksm_pass_merged++;
 }
 
 /*
@@ -1431,6 +1475,24 @@ static inline int is_page_scanned(struct page *page)
 #endif
 }
 
+/* At the end of a full scan, decide how fast to run the next one */
+static void ksm_pass_done(void)
+{
+	if (!ksm_adaptive)
+		ksm_backoff = 0;
+	else if (ksm_pass_merged * 1000 >= ksm_pass_scanned)
+		ksm_backoff = 0;
+	else if (ksm_backoff < KSM_MAX_BACKOFF)
+		ksm_backoff++;
+	ksm_pass_scanned = 0;
+	ksm_pass_merged = 0;
+}
+
+static unsigned int ksm_sleep_millisecs(void)
+{
+	return ksm_thread_sleep_millisecs << ksm_backoff;
+}
+
 /**
  * ksm_do_scan  - the ksm scanner main worker function.
  * @scan_npages - number of pages we want to scan before we return.
@@ -1441,15 +1503,23 @@ static void ksm_do_scan(unsigned int scan_npages)
 	struct page *uninitialized_var(page);
 
 	while (scan_npages-- && likely(!freezing(current))) {
+		u64 start;
+
 		cond_resched();
+		start = local_clock();
 		rmap_item = scan_get_next_rmap_item(&page);
-		if (!rmap_item)
+		if (!rmap_item) {
+			ksm_pass_done();
 			return;
+		}
+		ksm_pass_scanned++;
 		if (!PageKsm(page) || !in_stable_tree(rmap_item)) {
  				if (!is_page_scanned(page))
 	 			cmp_and_merge_page(page, rmap_item);
 			}
 		put_page(page);
+		/* the mm_slot keeps a reference on rmap_item->mm */
+		rmap_item->mm->ksm_scan_ns += local_clock() - start;
 	}
 }
 
@@ -1490,6 +1560,8 @@ out:
 
 static int ksmd_should_run(void)
 {
+	if (ksm_defer_screen_on && ksm_screen_on)
+		return 0;
 	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
 }
 
@@ -1509,10 +1581,10 @@ static int ksm_scan_thread(void *nothing)
 		if (ksmd_should_run()) {
 			if (use_deferred_timer)
 				deferred_schedule_timeout(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+				msecs_to_jiffies(ksm_sleep_millisecs()));
 			else
 				schedule_timeout_interruptible(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+				msecs_to_jiffies(ksm_sleep_millisecs()));
 		} else {
 			wait_event_freezable(ksm_thread_wait,
 				ksmd_should_run() || kthread_should_stop());
@@ -1589,6 +1661,9 @@ int __ksm_enter(struct mm_struct *mm)
 	set_bit(MMF_VM_MERGEABLE, &mm->flags);
 	atomic_inc(&mm->mm_count);
 
+	/* a freshly forked app is where the merges are */
+	ksm_backoff = 0;
+
 	if (needs_wakeup)
 		wake_up_interruptible(&ksm_thread_wait);
 
@@ -2010,6 +2085,55 @@ static ssize_t deferred_timer_store(struct kobject *kobj,
 }
 KSM_ATTR(deferred_timer);
 
+static ssize_t adaptive_show(struct kobject *kobj,
+			     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", ksm_adaptive);
+}
+
+static ssize_t adaptive_store(struct kobject *kobj,
+			      struct kobj_attribute *attr,
+			      const char *buf, size_t count)
+{
+	unsigned long enable;
+
+	if (kstrtoul(buf, 10, &enable) || enable > 1)
+		return -EINVAL;
+	ksm_adaptive = enable;
+	if (!enable)
+		ksm_backoff = 0;
+	return count;
+}
+KSM_ATTR(adaptive);
+
+static ssize_t current_sleep_millisecs_show(struct kobject *kobj,
+					    struct kobj_attribute *attr,
+					    char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_sleep_millisecs());
+}
+KSM_ATTR_RO(current_sleep_millisecs);
+
+static ssize_t defer_screen_on_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", ksm_defer_screen_on);
+}
+
+static ssize_t defer_screen_on_store(struct kobject *kobj,
+				     struct kobj_attribute *attr,
+				     const char *buf, size_t count)
+{
+	unsigned long enable;
+
+	if (kstrtoul(buf, 10, &enable) || enable > 1)
+		return -EINVAL;
+	ksm_defer_screen_on = enable;
+	wake_up_interruptible(&ksm_thread_wait);
+	return count;
+}
+KSM_ATTR(defer_screen_on);
+
 static ssize_t pages_shared_show(struct kobject *kobj,
 				 struct kobj_attribute *attr, char *buf)
 {
@@ -2065,6 +2189,9 @@ static struct attribute *ksm_attrs[] = {
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
 	&deferred_timer_attr.attr,
+	&adaptive_attr.attr,
+	&current_sleep_millisecs_attr.attr,
+	&defer_screen_on_attr.attr,
 	NULL,
 };
 
@@ -2074,6 +2201,25 @@ static struct attribute_group ksm_attr_group = {
 };
 #endif /* CONFIG_SYSFS */
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void ksm_early_suspend(struct early_suspend *h)
+{
+	ksm_screen_on = false;
+	wake_up_interruptible(&ksm_thread_wait);
+}
+
+static void ksm_late_resume(struct early_suspend *h)
+{
+	ksm_screen_on = true;
+}
+
+static struct early_suspend ksm_early_suspend_desc = {
+	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB,
+	.suspend = ksm_early_suspend,
+	.resume = ksm_late_resume,
+};
+#endif
+
 static int __init ksm_init(void)
 {
 	struct task_struct *ksm_thread;
@@ -2108,6 +2254,11 @@ static int __init ksm_init(void)
 	 * later callbacks could only be taking locks which nest within that.
 	 */
 	hotplug_memory_notifier(ksm_memory_callback, 100);
+#endif
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	register_early_suspend(&ksm_early_suspend_desc);
+#else
+	ksm_screen_on = false;	/* nothing would tell us */
 #endif
 	return 0;
 
@@ -270,6 +270,18 @@ struct mem_cgroup {
 	/* For oom notifier event fd */
 	struct list_head oom_notify;
 
+	/*
+	 * Reclaim pressure on this group from limit and soft limit reclaim,
+	 * see mem_cgroup_vmpressure().  pressure_notify holds the eventfds
+	 * registered on memory.pressure_level.
+	 */
+	spinlock_t pressure_lock;
+	unsigned long pressure_scanned;
+	unsigned long pressure_reclaimed;
+	int pressure_level;
+	unsigned long pressure_stamp;
+	struct list_head pressure_notify;
+
 	/*
 	 * Should we move charges of a task when a task is moved into this
 	 * mem_cgroup ? And what type of charges should we move ?
@@ -346,6 +358,7 @@ enum charge_type {
 #define _MEM			(0)
 #define _MEMSWAP		(1)
 #define _OOM_TYPE		(2)
+#define _PRESSURE_TYPE		(3)
 #define MEMFILE_PRIVATE(x, val)	(((x) << 16) | (val))
 #define MEMFILE_TYPE(val)	(((val) >> 16) & 0xffff)
 #define MEMFILE_ATTR(val)	((val) & 0xffff)
@@ -4632,6 +4645,173 @@ static int mem_cgroup_oom_control_write(struct cgroup *cgrp,
 	return 0;
 }
 
+/*
+ * Per-group reclaim pressure, on the same scale as the lowmemorykiller's
+ * global level: none, low, medium, critical.  Every window of pages
+ * scanned on behalf of the group, the share that could not be reclaimed
+ * gives the level; it falls back to none once the group has not been
+ * reclaimed from for a second.
+ */
+enum {
+	MEM_CGROUP_PRESSURE_NONE,
+	MEM_CGROUP_PRESSURE_LOW,
+	MEM_CGROUP_PRESSURE_MEDIUM,
+	MEM_CGROUP_PRESSURE_CRITICAL,
+};
+
+#define MEM_CGROUP_PRESSURE_WINDOW	(SWAP_CLUSTER_MAX * 16)
+#define MEM_CGROUP_PRESSURE_MEDIUM_PCT	60	/* % not reclaimed */
+#define MEM_CGROUP_PRESSURE_CRITICAL_PCT	95
+#define MEM_CGROUP_PRESSURE_HOLD	HZ
+
+static int mem_cgroup_pressure_level(struct mem_cgroup *mem)
+{
+	if (time_after(jiffies, mem->pressure_stamp +
+				MEM_CGROUP_PRESSURE_HOLD))
+		return MEM_CGROUP_PRESSURE_NONE;
+	return mem->pressure_level;
+}
+
+void mem_cgroup_vmpressure(struct mem_cgroup *mem, unsigned long scanned,
+			   unsigned long reclaimed)
+{
+	struct mem_cgroup_eventfd_list *ev;
+	unsigned long flags;
+	unsigned long pct;
+	int level;
+
+	if (!mem || !scanned)
+		return;
+
+	spin_lock_irqsave(&mem->pressure_lock, flags);
+	mem->pressure_scanned += scanned;
+	mem->pressure_reclaimed += reclaimed;
+	if (mem->pressure_scanned < MEM_CGROUP_PRESSURE_WINDOW)
+		goto out;
+
+	scanned = mem->pressure_scanned;
+	reclaimed = min(mem->pressure_reclaimed, scanned);
+	mem->pressure_scanned = 0;
+	mem->pressure_reclaimed = 0;
+
+	pct = (scanned - reclaimed) * 100 / scanned;
+	if (pct >= MEM_CGROUP_PRESSURE_CRITICAL_PCT)
+		level = MEM_CGROUP_PRESSURE_CRITICAL;
+	else if (pct >= MEM_CGROUP_PRESSURE_MEDIUM_PCT)
+		level = MEM_CGROUP_PRESSURE_MEDIUM;
+	else
+		level = MEM_CGROUP_PRESSURE_LOW;
+
+	if (level != mem_cgroup_pressure_level(mem))
+		list_for_each_entry(ev, &mem->pressure_notify, list)
+			eventfd_signal(ev->eventfd, 1);
+	mem->pressure_level = level;
+	mem->pressure_stamp = jiffies;
+out:
+	spin_unlock_irqrestore(&mem->pressure_lock, flags);
+}
+
+static u64 mem_cgroup_pressure_read(struct cgroup *cgrp, struct cftype *cft)
+{
+	return mem_cgroup_pressure_level(mem_cgroup_from_cont(cgrp));
+}
+
+static int mem_cgroup_pressure_register_event(struct cgroup *cgrp,
+	struct cftype *cft, struct eventfd_ctx *eventfd, const char *args)
+{
+	struct mem_cgroup *mem = mem_cgroup_from_cont(cgrp);
+	struct mem_cgroup_eventfd_list *event;
+
+	BUG_ON(MEMFILE_TYPE(cft->private) != _PRESSURE_TYPE);
+	event = kmalloc(sizeof(*event), GFP_KERNEL);
+	if (!event)
+		return -ENOMEM;
+
+	event->eventfd = eventfd;
+	spin_lock_irq(&mem->pressure_lock);
+	list_add(&event->list, &mem->pressure_notify);
+	spin_unlock_irq(&mem->pressure_lock);
+
+	return 0;
+}
+
+static void mem_cgroup_pressure_unregister_event(struct cgroup *cgrp,
+	struct cftype *cft, struct eventfd_ctx *eventfd)
+{
+	struct mem_cgroup *mem = mem_cgroup_from_cont(cgrp);
+	struct mem_cgroup_eventfd_list *ev, *tmp;
+
+	BUG_ON(MEMFILE_TYPE(cft->private) != _PRESSURE_TYPE);
+
+	spin_lock_irq(&mem->pressure_lock);
+	list_for_each_entry_safe(ev, tmp, &mem->pressure_notify, list) {
+		if (ev->eventfd == eventfd) {
+			list_del(&ev->list);
+			kfree(ev);
+		}
+	}
+	spin_unlock_irq(&mem->pressure_lock);
+}
+
+/*
+ * Victim group for the lowmemorykiller: the leaf group furthest over its
+ * soft limit, the excess weighted by the group's reclaim pressure.  Soft
+ * limit reclaim has already been taking pages from exactly these groups,
+ * so a group still over its limit under pressure is what killing should
+ * relieve first.  Returns the group with a css reference held, or NULL
+ * when no group is over its soft limit.
+ */
+struct mem_cgroup *mem_cgroup_lmk_victim(void)
+{
+	struct mem_cgroup *iter, *victim = NULL;
+	unsigned long best = 0;
+
+	for_each_mem_cgroup_all(iter) {
+		unsigned long excess, score;
+
+		if (mem_cgroup_is_root(iter) ||
+		    !list_empty(&iter->css.cgroup->children))
+			continue;
+
+		excess = res_counter_soft_limit_excess(&iter->res) >> PAGE_SHIFT;
+		if (!excess)
+			continue;
+
+		score = excess * (1 + mem_cgroup_pressure_level(iter));
+		if (score > best) {
+			if (victim)
+				css_put(&victim->css);
+			css_get(&iter->css);
+			victim = iter;
+			best = score;
+		}
+	}
+	return victim;
+}
+EXPORT_SYMBOL_GPL(mem_cgroup_lmk_victim);
+
+/* Calls fn on every task of the group; fn must not sleep. */
+void mem_cgroup_lmk_scan_tasks(struct mem_cgroup *mem,
+			       void (*fn)(struct task_struct *, void *),
+			       void *data)
+{
+	struct cgroup *cgrp = mem->css.cgroup;
+	struct cgroup_iter it;
+	struct task_struct *task;
+
+	cgroup_iter_start(cgrp, &it);
+	while ((task = cgroup_iter_next(cgrp, &it)))
+		fn(task, data);
+	cgroup_iter_end(cgrp, &it);
+}
+EXPORT_SYMBOL_GPL(mem_cgroup_lmk_scan_tasks);
+
+void mem_cgroup_lmk_put(struct mem_cgroup *mem)
+{
+	css_put(&mem->css);
+}
+EXPORT_SYMBOL_GPL(mem_cgroup_lmk_put);
+
 #ifdef CONFIG_NUMA
 static const struct file_operations mem_control_numa_stat_file_operations = {
 	.read = seq_read,
@@ -4711,6 +4891,13 @@ static struct cftype mem_cgroup_files[] = {
 		.unregister_event = mem_cgroup_oom_unregister_event,
 		.private = MEMFILE_PRIVATE(_OOM_TYPE, OOM_CONTROL),
 	},
+	{
+		.name = "pressure_level",
+		.read_u64 = mem_cgroup_pressure_read,
+		.register_event = mem_cgroup_pressure_register_event,
+		.unregister_event = mem_cgroup_pressure_unregister_event,
+		.private = MEMFILE_PRIVATE(_PRESSURE_TYPE, 0),
+	},
 #ifdef CONFIG_NUMA
 	{
 		.name = "numa_stat",
@@ -4975,6 +5162,8 @@ mem_cgroup_create(struct cgroup_subsys *ss, struct cgroup *cont)
 	mem->last_scanned_child = 0;
 	mem->last_scanned_node = MAX_NUMNODES;
 	INIT_LIST_HEAD(&mem->oom_notify);
+	spin_lock_init(&mem->pressure_lock);
+	INIT_LIST_HEAD(&mem->pressure_notify);
 
 	if (parent)
 		mem->swappiness = mem_cgroup_swappiness(parent);
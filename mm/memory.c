@@ -2881,8 +2881,8 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	page = lookup_swap_cache(entry);
 	if (!page) {
 		grab_swap_token(mm); /* Contend for token _before_ read-in */
-		page = swapin_readahead(entry,
-					GFP_HIGHUSER_MOVABLE, vma, address);
+		page = swapin_vma_readahead(entry, GFP_HIGHUSER_MOVABLE,
+					vma, address, pmd);
 		if (!page) {
 			/*
 			 * Back out if somebody else faulted in this pte
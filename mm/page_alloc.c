@@ -57,6 +57,8 @@
 #include <linux/ftrace_event.h>
 #include <linux/memcontrol.h>
 #include <linux/prefetch.h>
+#include <linux/migrate.h>
+#include <linux/mm_inline.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -97,6 +99,7 @@ EXPORT_SYMBOL(node_states);
 unsigned long totalram_pages __read_mostly;
 unsigned long totalreserve_pages __read_mostly;
 int percpu_pagelist_fraction;
+int sysctl_percpu_pagelist_adaptive = 1;
 gfp_t gfp_allowed_mask __read_mostly = GFP_BOOT_MASK;
 
 #ifdef CONFIG_PM_SLEEP
@@ -594,10 +597,36 @@ static inline int free_pages_check(struct page *page)
 	return 0;
 }
 
+/*
+ * The zone lock as taken by the allocator itself, which counts how often
+ * it was taken and how often someone else held it, for /proc/zoneinfo.
+ * The counts are only written with the lock held.
+ */
+static inline void zone_lock(struct zone *zone)
+{
+	if (!spin_trylock(&zone->lock)) {
+		spin_lock(&zone->lock);
+		zone->lock_contended++;
+	}
+	zone->lock_acquired++;
+}
+
+static inline int pcp_index(unsigned int order, int migratetype)
+{
+	return order * MIGRATE_PCPTYPES + migratetype;
+}
+
+/* Pages of higher orders come and go in smaller batches */
+static inline int pcp_batch(struct per_cpu_pages *pcp, unsigned int order)
+{
+	return max(pcp->batch >> order, 1);
+}
+
 /*
  * Frees a number of pages from the PCP lists
- * Assumes all pages on list are in same zone, and of same order.
- * count is the number of pages to free.
+ * Assumes all pages on list are in same zone.
+ * count is the number of pages to free, which may be overshot by the
+ * last higher order page.  Returns the number of pages freed.
  *
  * If the zone was previously in an "all pages pinned" state then look to
  * see if this freeing clears that state.
@@ -605,20 +634,22 @@ static inline int free_pages_check(struct page *page)
  * And clear the zone's pages_scanned counter, to hold off the "all pages are
  * pinned" detection logic.
  */
-static void free_pcppages_bulk(struct zone *zone, int count,
+static int free_pcppages_bulk(struct zone *zone, int count,
 					struct per_cpu_pages *pcp)
 {
-	int migratetype = 0;
+	int index = 0;
 	int batch_free = 0;
 	int to_free = count;
+	int freed = 0;
 
-	spin_lock(&zone->lock);
+	zone_lock(zone);
 	zone->all_unreclaimable = 0;
 	zone->pages_scanned = 0;
 
-	while (to_free) {
+	while (to_free > 0) {
 		struct page *page;
 		struct list_head *list;
+		unsigned int order;
 
 		/*
 		 * Remove pages from lists in a round-robin fashion. A
@@ -629,32 +660,37 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 		 */
 		do {
 			batch_free++;
-			if (++migratetype == MIGRATE_PCPTYPES)
-				migratetype = 0;
-			list = &pcp->lists[migratetype];
+			if (++index == NR_PCP_LISTS)
+				index = 0;
+			list = &pcp->lists[index];
 		} while (list_empty(list));
 
 		/* This is the only non-empty list. Free them all. */
-		if (batch_free == MIGRATE_PCPTYPES)
+		if (batch_free == NR_PCP_LISTS)
 			batch_free = to_free;
 
+		order = index / MIGRATE_PCPTYPES;
 		do {
 			page = list_entry(list->prev, struct page, lru);
 			/* must delete as __free_one_page list manipulates */
 			list_del(&page->lru);
 			/* MIGRATE_MOVABLE list may include MIGRATE_RESERVEs */
-			__free_one_page(page, zone, 0, page_private(page));
-			trace_mm_page_pcpu_drain(page, 0, page_private(page));
-		} while (--to_free && --batch_free && !list_empty(list));
+			__free_one_page(page, zone, order, page_private(page));
+			trace_mm_page_pcpu_drain(page, order,
+						 page_private(page));
+			freed += 1 << order;
+			to_free -= 1 << order;
+		} while (to_free > 0 && --batch_free && !list_empty(list));
 	}
-	__mod_zone_page_state(zone, NR_FREE_PAGES, count);
+	__mod_zone_page_state(zone, NR_FREE_PAGES, freed);
 	spin_unlock(&zone->lock);
+	return freed;
 }
 
 static void free_one_page(struct zone *zone, struct page *page, int order,
 				int migratetype)
 {
-	spin_lock(&zone->lock);
+	zone_lock(zone);
 	zone->all_unreclaimable = 0;
 	zone->pages_scanned = 0;
 
@@ -689,11 +725,19 @@ static bool free_pages_prepare(struct page *page, unsigned int order)
 	return true;
 }
 
+static void free_pcp_page(struct page *page, unsigned int order, int cold);
+
 static void __free_pages_ok(struct page *page, unsigned int order)
 {
 	unsigned long flags;
-	int wasMlocked = __TestClearPageMlocked(page);
+	int wasMlocked;
+
+	if (order < NR_PCP_ORDERS) {
+		free_pcp_page(page, order, 0);
+		return;
+	}
 
+	wasMlocked = __TestClearPageMlocked(page);
 	if (!free_pages_prepare(page, order))
 		return;
 
@@ -842,11 +886,17 @@ struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
  * This array describes the order lists are fallen back to when
  * the free lists for the desirable migrate type are depleted
  */
-static int fallbacks[MIGRATE_TYPES][MIGRATE_TYPES-1] = {
+static int fallbacks[MIGRATE_TYPES][4] = {
 	[MIGRATE_UNMOVABLE]   = { MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE,   MIGRATE_RESERVE },
 	[MIGRATE_RECLAIMABLE] = { MIGRATE_UNMOVABLE,   MIGRATE_MOVABLE,   MIGRATE_RESERVE },
+#ifdef CONFIG_CMA
+	[MIGRATE_MOVABLE]     = { MIGRATE_CMA,         MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE, MIGRATE_RESERVE },
+	[MIGRATE_CMA]         = { MIGRATE_RESERVE }, /* Never used */
+#else
 	[MIGRATE_MOVABLE]     = { MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE, MIGRATE_RESERVE },
-	[MIGRATE_RESERVE]     = { MIGRATE_RESERVE,     MIGRATE_RESERVE,   MIGRATE_RESERVE }, /* Never used */
+#endif
+	[MIGRATE_RESERVE]     = { MIGRATE_RESERVE }, /* Never used */
+	[MIGRATE_ISOLATE]     = { MIGRATE_RESERVE }, /* Never used */
 };
 
 /*
@@ -941,12 +991,12 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 	/* Find the largest possible block of pages in the other list */
 	for (current_order = MAX_ORDER-1; current_order >= order;
 						--current_order) {
-		for (i = 0; i < MIGRATE_TYPES - 1; i++) {
+		for (i = 0;; i++) {
 			migratetype = fallbacks[start_migratetype][i];
 
 			/* MIGRATE_RESERVE handled later if necessary */
 			if (migratetype == MIGRATE_RESERVE)
-				continue;
+				break;
 
 			area = &(zone->free_area[current_order]);
 			if (list_empty(&area->free_list[migratetype]))
@@ -960,11 +1010,14 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 			 * If breaking a large block of pages, move all free
 			 * pages to the preferred allocation list. If falling
 			 * back for a reclaimable kernel allocation, be more
-			 * aggressive about taking ownership of free pages
+			 * aggressive about taking ownership of free pages.
+			 * CMA pageblocks are never taken over, or unmovable
+			 * pages could end up pinned in them.
 			 */
-			if (unlikely(current_order >= (pageblock_order >> 1)) ||
-					start_migratetype == MIGRATE_RECLAIMABLE ||
-					page_group_by_mobility_disabled) {
+			if (!is_migrate_cma(migratetype) &&
+			    (unlikely(current_order >= pageblock_order / 2) ||
+			     start_migratetype == MIGRATE_RECLAIMABLE ||
+			     page_group_by_mobility_disabled)) {
 				unsigned long pages;
 				pages = move_freepages_block(zone, page,
 								start_migratetype);
@@ -983,7 +1036,8 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 			rmv_page_order(page);
 
 			/* Take ownership for orders >= pageblock_order */
-			if (current_order >= pageblock_order)
+			if (current_order >= pageblock_order &&
+			    !is_migrate_cma(migratetype))
 				change_pageblock_range(page, current_order,
 							start_migratetype);
 
@@ -1040,7 +1094,7 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 {
 	int i;
 	
-	spin_lock(&zone->lock);
+	zone_lock(zone);
 	for (i = 0; i < count; ++i) {
 		struct page *page = __rmqueue(zone, order, migratetype);
 		if (unlikely(page == NULL))
@@ -1059,7 +1113,11 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 			list_add(&page->lru, list);
 		else
 			list_add_tail(&page->lru, list);
-		set_page_private(page, migratetype);
+		/* so that a CMA page goes back to the CMA free list */
+		if (is_migrate_cma(get_pageblock_migratetype(page)))
+			set_page_private(page, MIGRATE_CMA);
+		else
+			set_page_private(page, migratetype);
 		list = &page->lru;
 	}
 	__mod_zone_page_state(zone, NR_FREE_PAGES, -(i << order));
@@ -1086,8 +1144,7 @@ void drain_zone_pages(struct zone *zone, struct per_cpu_pages *pcp)
 		to_drain = pcp->batch;
 	else
 		to_drain = pcp->count;
-	free_pcppages_bulk(zone, to_drain, pcp);
-	pcp->count -= to_drain;
+	pcp->count -= free_pcppages_bulk(zone, to_drain, pcp);
 	local_irq_restore(flags);
 }
 #endif
@@ -1112,10 +1169,8 @@ static void drain_pages(unsigned int cpu)
 		pset = per_cpu_ptr(zone->pageset, cpu);
 
 		pcp = &pset->pcp;
-		if (pcp->count) {
-			free_pcppages_bulk(zone, pcp->count, pcp);
-			pcp->count = 0;
-		}
+		if (pcp->count)
+			pcp->count -= free_pcppages_bulk(zone, pcp->count, pcp);
 		local_irq_restore(flags);
 	}
 }
@@ -1136,6 +1191,58 @@ void drain_all_pages(void)
 	on_each_cpu(drain_local_pages, NULL, 1);
 }
 
+/* zone lock trips per retune that grow, or let shrink, a pcp list */
+#define PCP_TRIPS_BUSY		16
+#define PCP_TRIPS_IDLE		2
+#define PCP_HIGH_SCALE		4
+
+/*
+ * Called on each cpu about once a second, from vmstat_update().  A cpu
+ * that kept going to the zone lock since the last call gets a higher high
+ * and batch, one step at a time up to PCP_HIGH_SCALE times the configured
+ * ones, and never so high that all cpus together could hold the zone's low
+ * watermark.  An idle one steps back down and gives back what it holds
+ * over the new high.
+ */
+void refresh_local_pagesets(void)
+{
+	unsigned long flags;
+	struct zone *zone;
+
+	for_each_populated_zone(zone) {
+		struct per_cpu_pages *pcp;
+		int high, max_high;
+
+		local_irq_save(flags);
+		pcp = &this_cpu_ptr(zone->pageset)->pcp;
+		if (!pcp->high_base)
+			goto next;
+
+		max_high = low_wmark_pages(zone) / num_online_cpus();
+		max_high = clamp(max_high, pcp->high_base,
+				 PCP_HIGH_SCALE * pcp->high_base);
+		high = pcp->high;
+		if (!sysctl_percpu_pagelist_adaptive)
+			high = pcp->high_base;
+		else if (pcp->trips >= PCP_TRIPS_BUSY)
+			high = min(high + pcp->high_base, max_high);
+		else if (pcp->trips < PCP_TRIPS_IDLE)
+			high = max(high - pcp->high_base, pcp->high_base);
+		pcp->trips = 0;
+		if (high == pcp->high)
+			goto next;
+
+		pcp->high = high;
+		pcp->batch = min(pcp->batch_base * high / pcp->high_base,
+				 max_t(int, pcp->batch_base, PAGE_SHIFT * 8));
+		if (pcp->count > high)
+			pcp->count -= free_pcppages_bulk(zone,
+						pcp->count - high, pcp);
+next:
+		local_irq_restore(flags);
+	}
+}
+
 #ifdef CONFIG_HIBERNATION
 
 void mark_free_pages(struct zone *zone)
@@ -1173,18 +1280,19 @@ void mark_free_pages(struct zone *zone)
 #endif /* CONFIG_PM */
 
 /*
- * Free a 0-order page
+ * Free a page of an order kept on the pcp lists
  * cold == 1 ? free a cold page : free a hot page
  */
-void free_hot_cold_page(struct page *page, int cold)
+static void free_pcp_page(struct page *page, unsigned int order, int cold)
 {
 	struct zone *zone = page_zone(page);
 	struct per_cpu_pages *pcp;
+	struct list_head *list;
 	unsigned long flags;
 	int migratetype;
 	int wasMlocked = __TestClearPageMlocked(page);
 
-	if (!free_pages_prepare(page, 0))
+	if (!free_pages_prepare(page, order))
 		return;
 
 	migratetype = get_pageblock_migratetype(page);
@@ -1192,38 +1300,49 @@ void free_hot_cold_page(struct page *page, int cold)
 	local_irq_save(flags);
 	if (unlikely(wasMlocked))
 		free_page_mlock(page);
-	__count_vm_event(PGFREE);
+	__count_vm_events(PGFREE, 1 << order);
 
 	/*
 	 * We only track unmovable, reclaimable and movable on pcp lists.
 	 * Free ISOLATE pages back to the allocator because they are being
-	 * offlined but treat RESERVE as movable pages so we can get those
-	 * areas back if necessary. Otherwise, we may have to free
-	 * excessively into the page allocator
+	 * offlined but treat RESERVE and CMA as movable pages so we can get
+	 * those areas back if necessary. Otherwise, we may have to free
+	 * excessively into the page allocator.  page_private still says
+	 * CMA, so the page goes back to its own free list on a drain.
 	 */
 	if (migratetype >= MIGRATE_PCPTYPES) {
 		if (unlikely(migratetype == MIGRATE_ISOLATE)) {
-			free_one_page(zone, page, 0, migratetype);
+			free_one_page(zone, page, order, migratetype);
 			goto out;
 		}
 		migratetype = MIGRATE_MOVABLE;
 	}
 
 	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	list = &pcp->lists[pcp_index(order, migratetype)];
 	if (cold)
-		list_add_tail(&page->lru, &pcp->lists[migratetype]);
+		list_add_tail(&page->lru, list);
 	else
-		list_add(&page->lru, &pcp->lists[migratetype]);
-	pcp->count++;
+		list_add(&page->lru, list);
+	pcp->count += 1 << order;
 	if (pcp->count >= pcp->high) {
-		free_pcppages_bulk(zone, pcp->batch, pcp);
-		pcp->count -= pcp->batch;
+		pcp->count -= free_pcppages_bulk(zone, pcp->batch, pcp);
+		pcp->trips++;
 	}
 
 out:
 	local_irq_restore(flags);
 }
 
+/*
+ * Free a 0-order page
+ * cold == 1 ? free a cold page : free a hot page
+ */
+void free_hot_cold_page(struct page *page, int cold)
+{
+	free_pcp_page(page, 0, cold);
+}
+
 /*
  * Free a list of 0-order pages
  */
@@ -1303,8 +1422,13 @@ int split_free_page(struct page *page)
 
 	if (order >= pageblock_order - 1) {
 		struct page *endpage = page + (1 << order) - 1;
-		for (; page < endpage; page += pageblock_nr_pages)
-			set_pageblock_migratetype(page, MIGRATE_MOVABLE);
+		for (; page < endpage; page += pageblock_nr_pages) {
+			int mt = get_pageblock_migratetype(page);
+
+			if (mt != MIGRATE_ISOLATE && !is_migrate_cma(mt))
+				set_pageblock_migratetype(page,
+							  MIGRATE_MOVABLE);
+		}
 	}
 
 	return 1 << order;
@@ -1324,18 +1448,33 @@ struct page *buffered_rmqueue(struct zone *preferred_zone,
 	struct page *page;
 	int cold = !!(gfp_flags & __GFP_COLD);
 
+	if (unlikely(gfp_flags & __GFP_NOFAIL)) {
+		/*
+		 * __GFP_NOFAIL is not to be used in new code.
+		 *
+		 * All __GFP_NOFAIL callers should be fixed so that they
+		 * properly detect and handle allocation failures.
+		 *
+		 * We most definitely don't want callers attempting to
+		 * allocate greater than order-1 page units with
+		 * __GFP_NOFAIL.
+		 */
+		WARN_ON_ONCE(order > 1);
+	}
+
 again:
-	if (likely(order == 0)) {
+	if (likely(order < NR_PCP_ORDERS)) {
 		struct per_cpu_pages *pcp;
 		struct list_head *list;
 
 		local_irq_save(flags);
 		pcp = &this_cpu_ptr(zone->pageset)->pcp;
-		list = &pcp->lists[migratetype];
+		list = &pcp->lists[pcp_index(order, migratetype)];
 		if (list_empty(list)) {
-			pcp->count += rmqueue_bulk(zone, 0,
-					pcp->batch, list,
-					migratetype, cold);
+			pcp->count += rmqueue_bulk(zone, order,
+					pcp_batch(pcp, order), list,
+					migratetype, cold) << order;
+			pcp->trips++;
 			if (unlikely(list_empty(list)))
 				goto failed;
 		}
@@ -1346,22 +1485,10 @@ again:
 			page = list_entry(list->next, struct page, lru);
 
 		list_del(&page->lru);
-		pcp->count--;
+		pcp->count -= 1 << order;
 	} else {
-		if (unlikely(gfp_flags & __GFP_NOFAIL)) {
-			/*
-			 * __GFP_NOFAIL is not to be used in new code.
-			 *
-			 * All __GFP_NOFAIL callers should be fixed so that they
-			 * properly detect and handle allocation failures.
-			 *
-			 * We most definitely don't want callers attempting to
-			 * allocate greater than order-1 page units with
-			 * __GFP_NOFAIL.
-			 */
-			WARN_ON_ONCE(order > 1);
-		}
-		spin_lock_irqsave(&zone->lock, flags);
+		local_irq_save(flags);
+		zone_lock(zone);
 		page = __rmqueue(zone, order, migratetype);
 		spin_unlock(&zone->lock);
 		if (!page)
@@ -1746,8 +1873,12 @@ zonelist_scan:
 try_this_zone:
 		page = buffered_rmqueue(preferred_zone, zone, order,
 						gfp_mask, migratetype);
-		if (page)
+		if (page) {
+			/* refill the high-order blocks before anyone stalls */
+			if (order)
+				wakeup_kcompactd(zone, order);
 			break;
+		}
 this_zone_full:
 		if (NUMA_BUILD)
 			zlc_mark_zone_full(zonelist, z);
@@ -1915,6 +2046,13 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 	if (!order || compaction_deferred(preferred_zone))
 		return NULL;
 
+	/*
+	 * Callers that do not retry have a fallback and would rather not
+	 * stall; leave the compacting to kcompactd, already woken.
+	 */
+	if ((gfp_mask & __GFP_NORETRY) && kcompactd_running(preferred_zone))
+		return NULL;
+
 	current->flags |= PF_MEMALLOC;
 	*did_some_progress = try_to_compact_pages(zonelist, order, gfp_mask,
 						nodemask, sync_migration);
@@ -2132,6 +2270,8 @@ restart:
 	if (!(gfp_mask & __GFP_NO_KSWAPD))
 		wake_all_kswapd(order, zonelist, high_zoneidx,
 						zone_idx(preferred_zone));
+	if (order)
+		wakeup_kcompactd(preferred_zone, order);
 
 	/*
 	 * OK, we're below the kswapd watermark and have kicked background
@@ -3596,16 +3736,16 @@ static int zone_batchsize(struct zone *zone)
 static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 {
 	struct per_cpu_pages *pcp;
-	int migratetype;
+	int index;
 
 	memset(p, 0, sizeof(*p));
 
 	pcp = &p->pcp;
 	pcp->count = 0;
-	pcp->high = 6 * batch;
-	pcp->batch = max(1UL, 1 * batch);
-	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
-		INIT_LIST_HEAD(&pcp->lists[migratetype]);
+	pcp->high = pcp->high_base = 6 * batch;
+	pcp->batch = pcp->batch_base = max(1UL, 1 * batch);
+	for (index = 0; index < NR_PCP_LISTS; index++)
+		INIT_LIST_HEAD(&pcp->lists[index]);
 }
 
 /*
@@ -3623,6 +3763,8 @@ static void setup_pagelist_highmark(struct per_cpu_pageset *p,
 	pcp->batch = max(1UL, high/4);
 	if ((high/4) > (PAGE_SHIFT * 8))
 		pcp->batch = PAGE_SHIFT * 8;
+	pcp->high_base = pcp->high;
+	pcp->batch_base = pcp->batch;
 }
 
 static void setup_zone_pageset(struct zone *zone)
@@ -4318,6 +4460,9 @@ static void __paginginit free_area_init_core(struct pglist_data *pgdat,
 	pgdat->nr_zones = 0;
 	init_waitqueue_head(&pgdat->kswapd_wait);
 	pgdat->kswapd_max_order = 0;
+#ifdef CONFIG_COMPACTION
+	init_waitqueue_head(&pgdat->kcompactd_wait);
+#endif
 	pgdat_page_cgroup_init(pgdat);
 	
 	for (j = 0; j < MAX_NR_ZONES; j++) {
@@ -4379,6 +4524,8 @@ static void __paginginit free_area_init_core(struct pglist_data *pgdat,
 		zone->reclaim_stat.recent_rotated[1] = 0;
 		zone->reclaim_stat.recent_scanned[0] = 0;
 		zone->reclaim_stat.recent_scanned[1] = 0;
+		zone->reclaim_stat.recent_cost[0] = 0;
+		zone->reclaim_stat.recent_cost[1] = 0;
 		zap_zone_vm_stats(zone);
 		zone->flags = 0;
 		if (!size)
@@ -5588,6 +5735,8 @@ static int
 __count_immobile_pages(struct zone *zone, struct page *page, int count)
 {
 	unsigned long pfn, iter, found;
+	int mt;
+
 	/*
 	 * For avoiding noise data, lru_add_drain_all() should be called
 	 * If ZONE_MOVABLE, the zone never contains immobile pages
@@ -5595,7 +5744,8 @@ __count_immobile_pages(struct zone *zone, struct page *page, int count)
 	if (zone_idx(zone) == ZONE_MOVABLE)
 		return true;
 
-	if (get_pageblock_migratetype(page) == MIGRATE_MOVABLE)
+	mt = get_pageblock_migratetype(page);
+	if (mt == MIGRATE_MOVABLE || is_migrate_cma(mt))
 		return true;
 
 	pfn = page_to_pfn(page);
@@ -5694,7 +5844,7 @@ out:
 	return ret;
 }
 
-void unset_migratetype_isolate(struct page *page)
+void unset_migratetype_isolate(struct page *page, unsigned migratetype)
 {
 	struct zone *zone;
 	unsigned long flags;
@@ -5702,12 +5852,212 @@ void unset_migratetype_isolate(struct page *page)
 	spin_lock_irqsave(&zone->lock, flags);
 	if (get_pageblock_migratetype(page) != MIGRATE_ISOLATE)
 		goto out;
-	set_pageblock_migratetype(page, MIGRATE_MOVABLE);
-	move_freepages_block(zone, page, MIGRATE_MOVABLE);
+	set_pageblock_migratetype(page, migratetype);
+	move_freepages_block(zone, page, migratetype);
 out:
 	spin_unlock_irqrestore(&zone->lock, flags);
 }
 
+#ifdef CONFIG_CMA
+
+/* Hands a pageblock reserved at boot to the allocator as MIGRATE_CMA */
+void __init init_cma_reserved_pageblock(struct page *page)
+{
+	unsigned int i = pageblock_nr_pages;
+	struct page *p = page;
+
+	do {
+		__ClearPageReserved(p);
+		set_page_count(p, 0);
+	} while (++p, --i);
+
+	set_page_refcounted(page);
+	set_pageblock_migratetype(page, MIGRATE_CMA);
+	__free_pages(page, pageblock_order);
+	totalram_pages += pageblock_nr_pages;
+#ifdef CONFIG_HIGHMEM
+	if (PageHighMem(page))
+		totalhigh_pages += pageblock_nr_pages;
+#endif
+}
+
+/* Isolation works on whole pageblocks and on whole MAX_ORDER pages */
+#define CONTIG_ALIGN	max_t(unsigned long, MAX_ORDER_NR_PAGES, \
+			      pageblock_nr_pages)
+#define CONTIG_MIGRATE_BATCH	256
+#define CONTIG_RETRIES		5
+
+static struct page *
+contig_migrate_alloc(struct page *page, unsigned long private, int **x)
+{
+	return alloc_page(GFP_HIGHUSER_MOVABLE);
+}
+
+/*
+ * Migrates the pages on the LRU out of [start, end), which must be
+ * isolated so that the new pages come from elsewhere.  Pages that
+ * cannot be moved are left where they are for the caller to notice.
+ */
+static int contig_migrate_range(unsigned long start, unsigned long end)
+{
+	unsigned long pfn = start;
+	LIST_HEAD(source);
+
+	while (pfn < end) {
+		int nr = 0;
+
+		if (fatal_signal_pending(current)) {
+			putback_lru_pages(&source);
+			return -EINTR;
+		}
+
+		for (; pfn < end && nr < CONTIG_MIGRATE_BATCH; pfn++) {
+			struct page *page;
+
+			if (!pfn_valid_within(pfn))
+				continue;
+			page = pfn_to_page(pfn);
+			if (!PageLRU(page) || !get_page_unless_zero(page))
+				continue;
+			if (!isolate_lru_page(page)) {
+				list_add_tail(&page->lru, &source);
+				inc_zone_page_state(page, NR_ISOLATED_ANON +
+						    page_is_file_cache(page));
+				nr++;
+			}
+			put_page(page);
+		}
+
+		if (list_empty(&source))
+			continue;
+		if (migrate_pages(&source, contig_migrate_alloc, 0,
+				  false, true))
+			putback_lru_pages(&source);
+	}
+	return 0;
+}
+
+/*
+ * Takes the free pages covering [start, end) off the free lists of an
+ * isolated range, as order-0 pages with a reference each.  The first
+ * and last free page may stick out of the range; the pfn just past the
+ * last page taken is returned, or 0 if a page in the range is not free.
+ */
+static unsigned long contig_take_free(struct zone *zone, unsigned long start,
+				      unsigned long end, unsigned long *first)
+{
+	unsigned long pfn, outer_start = start, flags;
+	unsigned int order = 0;
+	struct page *page;
+
+	spin_lock_irqsave(&zone->lock, flags);
+
+	/* find the free page that @start is part of */
+	while (!PageBuddy(pfn_to_page(outer_start))) {
+		if (++order >= MAX_ORDER)
+			goto busy;
+		outer_start &= ~0UL << order;
+	}
+	page = pfn_to_page(outer_start);
+	if (outer_start + (1UL << page_order(page)) <= start)
+		goto busy;
+
+	for (pfn = outer_start; pfn < end; pfn += 1UL << page_order(page)) {
+		page = pfn_to_page(pfn);
+		if (!PageBuddy(page))
+			goto busy;
+	}
+
+	for (pfn = outer_start; pfn < end; pfn += 1UL << order) {
+		page = pfn_to_page(pfn);
+		order = page_order(page);
+		list_del(&page->lru);
+		rmv_page_order(page);
+		zone->free_area[order].nr_free--;
+		__mod_zone_page_state(zone, NR_FREE_PAGES, -(1UL << order));
+		set_page_refcounted(page);
+		split_page(page, order);
+	}
+	spin_unlock_irqrestore(&zone->lock, flags);
+
+	*first = outer_start;
+	return pfn;
+
+busy:
+	spin_unlock_irqrestore(&zone->lock, flags);
+	return 0;
+}
+
+/**
+ * alloc_contig_range() -- tries to allocate given range of pages
+ * @start:	start PFN to allocate
+ * @end:	one-past-the-last PFN to allocate
+ * @migratetype:	migratetype of the underlaying pageblocks (either
+ *			#MIGRATE_MOVABLE or #MIGRATE_CMA).  All pageblocks
+ *			in range must have the same migratetype and it must
+ *			be either of the two.
+ *
+ * The pageblocks around the range are isolated, the pages in use are
+ * migrated out and the range is then taken off the free lists.
+ * Pages that cannot be migrated, pinned for I/O for instance, make it
+ * fail with -EBUSY after a few tries.
+ *
+ * Returns zero on success, and every page in the range then has a
+ * reference that free_contig_range() drops.
+ */
+int alloc_contig_range(unsigned long start, unsigned long end,
+		       unsigned migratetype)
+{
+	unsigned long outer_start = start, outer_end = 0;
+	struct zone *zone = page_zone(pfn_to_page(start));
+	int tries, ret;
+
+	ret = start_isolate_page_range(round_down(start, CONTIG_ALIGN),
+				       round_up(end, CONTIG_ALIGN),
+				       migratetype);
+	if (ret)
+		return ret;
+
+	migrate_prep();
+	for (tries = 0; tries < CONTIG_RETRIES; tries++) {
+		ret = contig_migrate_range(start, end);
+		if (ret < 0)
+			goto done;
+
+		/* bring back what sits on pagevecs and pcp lists */
+		lru_add_drain_all();
+		drain_all_pages();
+
+		outer_end = contig_take_free(zone, start, end, &outer_start);
+		if (outer_end)
+			break;
+	}
+	if (!outer_end) {
+		ret = -EBUSY;
+		goto done;
+	}
+	ret = 0;
+
+	/* free what stuck out of the range, back onto the isolated list */
+	if (start != outer_start)
+		free_contig_range(outer_start, start - outer_start);
+	if (end != outer_end)
+		free_contig_range(end, outer_end - end);
+
+done:
+	undo_isolate_page_range(round_down(start, CONTIG_ALIGN),
+				round_up(end, CONTIG_ALIGN), migratetype);
+	return ret;
+}
+
+void free_contig_range(unsigned long pfn, unsigned long nr_pages)
+{
+	for (; nr_pages--; pfn++)
+		__free_page(pfn_to_page(pfn));
+}
+
+#endif /* CONFIG_CMA */
+
 #ifdef CONFIG_MEMORY_HOTREMOVE
 /*
  * All pages in the range must be isolated before calling this.
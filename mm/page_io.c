@@ -108,6 +108,8 @@ int swap_writepage(struct page *page, struct writeback_control *wbc)
 	if (wbc->sync_mode == WB_SYNC_ALL)
 		rw |= REQ_SYNC;
 	count_vm_event(PSWPOUT);
+	lru_note_cost(page_zone(page), 0,
+		      swap_io_cost((swp_entry_t){ .val = page_private(page) }));
 	set_page_writeback(page);
 	unlock_page(page);
 	submit_bio(rw, bio);
@@ -129,6 +131,8 @@ int swap_readpage(struct page *page)
 		goto out;
 	}
 	count_vm_event(PSWPIN);
+	lru_note_cost(page_zone(page), 0,
+		      swap_io_cost((swp_entry_t){ .val = page_private(page) }));
 	submit_bio(READ, bio);
 out:
 	return ret;
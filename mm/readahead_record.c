@@ -0,0 +1,263 @@
+/*
+ * mm/readahead_record.c - learn and replay the access pattern of files
+ *
+ * App launch faults in pieces of the APK and odex files in an order that
+ * is mostly the same from one launch to the next, but far from sequential,
+ * so ondemand readahead does not help much and most of those faults wait
+ * for the disk.
+ *
+ * POSIX_FADV_RA_RECORD starts logging the pages read or faulted from a
+ * file.  The log is a list of ranges in the order they were first touched.
+ * It ends when the file is replayed, when it is full, or after
+ * record_secs.  POSIX_FADV_RA_REPLAY then submits readahead for every range
+ * logged so far, so the next launch finds them in the page cache.
+ *
+ * Logs are kept by (device, inode number, generation), so they survive
+ * the inode being evicted, and a replaced file starts afresh.  Only the
+ * max_files most recently used logs are kept.
+ */
+
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/pagemap.h>
+#include <linux/slab.h>
+#include <linux/hash.h>
+#include <linux/jiffies.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#define RA_RECORD_RANGES	128
+#define RA_RECORD_HASH_BITS	6
+/* Holes up to this many pages are folded into the previous range */
+#define RA_RECORD_GAP		4
+
+struct ra_range {
+	pgoff_t start;
+	unsigned long len;
+};
+
+struct ra_record {
+	struct hlist_node hash;
+	struct list_head lru;
+	dev_t dev;
+	unsigned long ino;
+	u32 generation;
+	unsigned long until;	/* end of the recording, in jiffies */
+	unsigned int recording:1;
+	unsigned int nr_ranges;
+	struct ra_range ranges[RA_RECORD_RANGES];
+};
+
+static DEFINE_SPINLOCK(ra_record_lock);
+static struct hlist_head ra_record_hash[1 << RA_RECORD_HASH_BITS];
+static LIST_HEAD(ra_record_lru);
+static unsigned int ra_record_nr;
+
+static unsigned int max_files = 256;
+module_param(max_files, uint, 0644);
+MODULE_PARM_DESC(max_files, "Number of files whose pattern is remembered");
+
+static unsigned int record_secs = 10;
+module_param(record_secs, uint, 0644);
+MODULE_PARM_DESC(record_secs, "Longest recording, in seconds");
+
+static unsigned long nr_replays;
+static unsigned long nr_replayed_pages;
+
+static inline struct hlist_head *ra_record_bucket(dev_t dev, unsigned long ino)
+{
+	return &ra_record_hash[hash_long(ino ^ dev, RA_RECORD_HASH_BITS)];
+}
+
+/* Called with ra_record_lock held */
+static struct ra_record *ra_record_find(struct inode *inode)
+{
+	struct hlist_node *node;
+	struct ra_record *rec;
+
+	hlist_for_each_entry(rec, node,
+			ra_record_bucket(inode->i_sb->s_dev, inode->i_ino), hash) {
+		if (rec->ino == inode->i_ino &&
+		    rec->dev == inode->i_sb->s_dev &&
+		    rec->generation == inode->i_generation)
+			return rec;
+	}
+	return NULL;
+}
+
+/* Called with ra_record_lock held */
+static void ra_record_free_oldest(void)
+{
+	struct ra_record *rec;
+
+	rec = list_entry(ra_record_lru.prev, struct ra_record, lru);
+	hlist_del(&rec->hash);
+	list_del(&rec->lru);
+	ra_record_nr--;
+	kfree(rec);
+}
+
+void __readahead_record(struct address_space *mapping, pgoff_t index)
+{
+	struct ra_record *rec;
+	struct ra_range *r;
+	unsigned int i;
+
+	spin_lock(&ra_record_lock);
+	rec = ra_record_find(mapping->host);
+	if (!rec || !rec->recording)
+		goto stop;
+	if (time_after(jiffies, rec->until))
+		goto stop;
+
+	if (rec->nr_ranges) {
+		r = &rec->ranges[rec->nr_ranges - 1];
+		if (index >= r->start &&
+		    index <= r->start + r->len + RA_RECORD_GAP) {
+			r->len = max(r->len, index - r->start + 1);
+			goto out;
+		}
+	}
+
+	for (i = 0; i < rec->nr_ranges; i++) {
+		r = &rec->ranges[i];
+		if (index >= r->start && index < r->start + r->len)
+			goto out;
+	}
+
+	if (rec->nr_ranges == RA_RECORD_RANGES)
+		goto stop;
+
+	r = &rec->ranges[rec->nr_ranges++];
+	r->start = index;
+	r->len = 1;
+out:
+	spin_unlock(&ra_record_lock);
+	return;
+stop:
+	if (rec)
+		rec->recording = 0;
+	clear_bit(AS_RA_RECORD, &mapping->flags);
+	spin_unlock(&ra_record_lock);
+}
+
+int readahead_record_start(struct file *file)
+{
+	struct address_space *mapping = file->f_mapping;
+	struct inode *inode = mapping->host;
+	struct ra_record *rec, *new;
+
+	new = kzalloc(sizeof(*new), GFP_KERNEL);
+	if (!new)
+		return -ENOMEM;
+
+	spin_lock(&ra_record_lock);
+	rec = ra_record_find(inode);
+	if (rec) {
+		kfree(new);
+		list_move(&rec->lru, &ra_record_lru);
+	} else {
+		rec = new;
+		rec->dev = inode->i_sb->s_dev;
+		rec->ino = inode->i_ino;
+		rec->generation = inode->i_generation;
+		hlist_add_head(&rec->hash,
+			       ra_record_bucket(rec->dev, rec->ino));
+		list_add(&rec->lru, &ra_record_lru);
+		if (++ra_record_nr > max(max_files, 1U))
+			ra_record_free_oldest();
+	}
+	rec->nr_ranges = 0;
+	rec->recording = 1;
+	rec->until = jiffies + record_secs * HZ;
+	set_bit(AS_RA_RECORD, &mapping->flags);
+	spin_unlock(&ra_record_lock);
+	return 0;
+}
+
+int readahead_record_replay(struct file *file)
+{
+	struct address_space *mapping = file->f_mapping;
+	struct ra_range *ranges;
+	struct ra_record *rec;
+	unsigned int i, nr = 0;
+	unsigned long pages = 0;
+
+	ranges = kmalloc(sizeof(*ranges) * RA_RECORD_RANGES, GFP_KERNEL);
+	if (!ranges)
+		return -ENOMEM;
+
+	spin_lock(&ra_record_lock);
+	rec = ra_record_find(mapping->host);
+	if (rec) {
+		rec->recording = 0;
+		clear_bit(AS_RA_RECORD, &mapping->flags);
+		list_move(&rec->lru, &ra_record_lru);
+		nr = rec->nr_ranges;
+		memcpy(ranges, rec->ranges, sizeof(*ranges) * nr);
+	}
+	spin_unlock(&ra_record_lock);
+
+	/* In the order the pages were first needed */
+	for (i = 0; i < nr; i++) {
+		int ret = force_page_cache_readahead(mapping, file,
+				ranges[i].start, ranges[i].len);
+		if (ret > 0)
+			pages += ret;
+	}
+	kfree(ranges);
+
+	if (nr) {
+		spin_lock(&ra_record_lock);
+		nr_replays++;
+		nr_replayed_pages += pages;
+		spin_unlock(&ra_record_lock);
+	}
+	return 0;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int ra_record_show(struct seq_file *m, void *unused)
+{
+	struct ra_record *rec;
+
+	spin_lock(&ra_record_lock);
+	seq_printf(m, "files: %u\nreplays: %lu\nreplayed_pages: %lu\n",
+		   ra_record_nr, nr_replays, nr_replayed_pages);
+	list_for_each_entry(rec, &ra_record_lru, lru) {
+		unsigned long pages = 0;
+		unsigned int i;
+
+		for (i = 0; i < rec->nr_ranges; i++)
+			pages += rec->ranges[i].len;
+		seq_printf(m, "%u:%u %lu ranges %u pages %lu%s\n",
+			   MAJOR(rec->dev), MINOR(rec->dev), rec->ino,
+			   rec->nr_ranges, pages,
+			   rec->recording ? " recording" : "");
+	}
+	spin_unlock(&ra_record_lock);
+	return 0;
+}
+
+static int ra_record_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ra_record_show, NULL);
+}
+
+static const struct file_operations ra_record_fops = {
+	.open		= ra_record_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init ra_record_debugfs_init(void)
+{
+	debugfs_create_file("readahead_record", 0444, NULL, NULL,
+			    &ra_record_fops);
+	return 0;
+}
+late_initcall(ra_record_debugfs_init);
+#endif
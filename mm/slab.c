@@ -250,6 +250,11 @@ struct array_cache {
 	unsigned int batchcount;
 	unsigned int touched;
 	spinlock_t lock;
+	/* cpu arrays only: hits, and trips to the list_lock */
+	unsigned long alloc_fast;
+	unsigned long alloc_slow;
+	unsigned long free_fast;
+	unsigned long free_slow;
 	void *entry[];	/*
 			 * Must have this definition in here for the proper
 			 * alignment of array_cache. Also simplifies accessing
@@ -725,6 +730,40 @@ static inline struct array_cache *cpu_cache_get(struct kmem_cache *cachep)
 	return cachep->array[smp_processor_id()];
 }
 
+/*
+ * Each cpu has a second array of the same size, the spare, for caches of
+ * small objects.  When the current array runs empty on alloc or full on
+ * free the two are swapped, so a cpu that allocates and then frees a
+ * burst of up to twice the limit never takes the list_lock.  Both are
+ * only touched by their own cpu with interrupts off.
+ */
+static inline bool cache_wants_spare(struct kmem_cache *cachep, int limit)
+{
+	return cachep->buffer_size <= PAGE_SIZE && limit > 1;
+}
+
+static inline struct array_cache *cpu_cache_swap(struct kmem_cache *cachep)
+{
+	int cpu = smp_processor_id();
+	struct array_cache *ac = cachep->spare[cpu];
+
+	cachep->spare[cpu] = cachep->array[cpu];
+	cachep->array[cpu] = ac;
+	return ac;
+}
+
+/* Keep the counts of a cpu array that is about to be freed */
+static void cache_fold_stats(struct kmem_cache *cachep,
+			     struct array_cache *ac)
+{
+	if (!ac)
+		return;
+	cachep->alloc_fast += ac->alloc_fast;
+	cachep->alloc_slow += ac->alloc_slow;
+	cachep->free_fast += ac->free_fast;
+	cachep->free_slow += ac->free_slow;
+}
+
 static inline struct kmem_cache *__find_general_cachep(size_t size,
 							gfp_t gfpflags)
 {
@@ -931,6 +970,8 @@ static struct array_cache *alloc_arraycache(int node, int entries,
 		nc->limit = entries;
 		nc->batchcount = batchcount;
 		nc->touched = 0;
+		nc->alloc_fast = nc->alloc_slow = 0;
+		nc->free_fast = nc->free_slow = 0;
 		spin_lock_init(&nc->lock);
 	}
 	return nc;
@@ -1177,13 +1218,17 @@ static void __cpuinit cpuup_canceled(long cpu)
 	const struct cpumask *mask = cpumask_of_node(node);
 
 	list_for_each_entry(cachep, &cache_chain, next) {
-		struct array_cache *nc;
+		struct array_cache *nc, *spare;
 		struct array_cache *shared;
 		struct array_cache **alien;
 
 		/* cpu is dead; no one can alloc from it. */
 		nc = cachep->array[cpu];
 		cachep->array[cpu] = NULL;
+		spare = cachep->spare[cpu];
+		cachep->spare[cpu] = NULL;
+		cache_fold_stats(cachep, nc);
+		cache_fold_stats(cachep, spare);
 		l3 = cachep->nodelists[node];
 
 		if (!l3)
@@ -1195,6 +1240,8 @@ static void __cpuinit cpuup_canceled(long cpu)
 		l3->free_limit -= cachep->batchcount;
 		if (nc)
 			free_block(cachep, nc->entry, nc->avail, node);
+		if (spare)
+			free_block(cachep, spare->entry, spare->avail, node);
 
 		if (!cpumask_empty(mask)) {
 			spin_unlock_irq(&l3->list_lock);
@@ -1220,6 +1267,7 @@ static void __cpuinit cpuup_canceled(long cpu)
 		}
 free_array_cache:
 		kfree(nc);
+		kfree(spare);
 	}
 	/*
 	 * In the previous loop, all the objects were freed to
@@ -1256,7 +1304,7 @@ static int __cpuinit cpuup_prepare(long cpu)
 	 * array caches
 	 */
 	list_for_each_entry(cachep, &cache_chain, next) {
-		struct array_cache *nc;
+		struct array_cache *nc, *spare = NULL;
 		struct array_cache *shared = NULL;
 		struct array_cache **alien = NULL;
 
@@ -1264,11 +1312,20 @@ static int __cpuinit cpuup_prepare(long cpu)
 					cachep->batchcount, GFP_KERNEL);
 		if (!nc)
 			goto bad;
+		if (cache_wants_spare(cachep, cachep->limit)) {
+			spare = alloc_arraycache(node, cachep->limit,
+					cachep->batchcount, GFP_KERNEL);
+			if (!spare) {
+				kfree(nc);
+				goto bad;
+			}
+		}
 		if (cachep->shared) {
 			shared = alloc_arraycache(node,
 				cachep->shared * cachep->batchcount,
 				0xbaadf00d, GFP_KERNEL);
 			if (!shared) {
+				kfree(spare);
 				kfree(nc);
 				goto bad;
 			}
@@ -1277,11 +1334,13 @@ static int __cpuinit cpuup_prepare(long cpu)
 			alien = alloc_alien_cache(node, cachep->limit, GFP_KERNEL);
 			if (!alien) {
 				kfree(shared);
+				kfree(spare);
 				kfree(nc);
 				goto bad;
 			}
 		}
 		cachep->array[cpu] = nc;
+		cachep->spare[cpu] = spare;
 		l3 = cachep->nodelists[node];
 		BUG_ON(!l3);
 
@@ -2041,8 +2100,10 @@ static void __kmem_cache_destroy(struct kmem_cache *cachep)
 	int i;
 	struct kmem_list3 *l3;
 
-	for_each_online_cpu(i)
-	    kfree(cachep->array[i]);
+	for_each_online_cpu(i) {
+		kfree(cachep->array[i]);
+		kfree(cachep->spare[i]);
+	}
 
 	/* NUMA: free the list3 structures */
 	for_each_online_node(i) {
@@ -2541,8 +2602,13 @@ static void do_drain(void *arg)
 	ac = cpu_cache_get(cachep);
 	spin_lock(&cachep->nodelists[node]->list_lock);
 	free_block(cachep, ac->entry, ac->avail, node);
-	spin_unlock(&cachep->nodelists[node]->list_lock);
 	ac->avail = 0;
+	ac = cachep->spare[smp_processor_id()];
+	if (ac) {
+		free_block(cachep, ac->entry, ac->avail, node);
+		ac->avail = 0;
+	}
+	spin_unlock(&cachep->nodelists[node]->list_lock);
 }
 
 static void drain_cpu_caches(struct kmem_cache *cachep)
@@ -3235,12 +3301,20 @@ static inline void *____cache_alloc(struct kmem_cache *cachep, gfp_t flags)
 	check_irq_off();
 
 	ac = cpu_cache_get(cachep);
+	if (unlikely(!ac->avail)) {
+		struct array_cache *spare = cachep->spare[smp_processor_id()];
+
+		if (spare && spare->avail)
+			ac = cpu_cache_swap(cachep);
+	}
 	if (likely(ac->avail)) {
 		STATS_INC_ALLOCHIT(cachep);
+		ac->alloc_fast++;
 		ac->touched = 1;
 		objp = ac->entry[--ac->avail];
 	} else {
 		STATS_INC_ALLOCMISS(cachep);
+		ac->alloc_slow++;
 		objp = cache_alloc_refill(cachep, flags);
 		/*
 		 * the 'ac' may be updated by cache_alloc_refill(),
@@ -3679,12 +3753,20 @@ static inline void __cache_free(struct kmem_cache *cachep, void *objp,
 	if (nr_online_nodes > 1 && cache_free_alien(cachep, objp))
 		return;
 
+	if (unlikely(ac->avail >= ac->limit)) {
+		struct array_cache *spare = cachep->spare[smp_processor_id()];
+
+		if (spare && spare->avail < spare->limit)
+			ac = cpu_cache_swap(cachep);
+	}
 	if (likely(ac->avail < ac->limit)) {
 		STATS_INC_FREEHIT(cachep);
+		ac->free_fast++;
 		ac->entry[ac->avail++] = objp;
 		return;
 	} else {
 		STATS_INC_FREEMISS(cachep);
+		ac->free_slow++;
 		cache_flusharray(cachep, ac);
 		ac->entry[ac->avail++] = objp;
 	}
@@ -3994,12 +4076,18 @@ static void do_ccupdate_local(void *info)
 {
 	struct ccupdate_struct *new = info;
 	struct array_cache *old;
+	int cpu = smp_processor_id();
 
 	check_irq_off();
 	old = cpu_cache_get(new->cachep);
 
-	new->cachep->array[smp_processor_id()] = new->new[smp_processor_id()];
-	new->new[smp_processor_id()] = old;
+	new->cachep->array[cpu] = new->new[cpu];
+	new->new[cpu] = old;
+
+	/* spares follow new[nr_cpu_ids] */
+	old = new->cachep->spare[cpu];
+	new->cachep->spare[cpu] = new->new[nr_cpu_ids + cpu];
+	new->new[nr_cpu_ids + cpu] = old;
 }
 
 /* Always called with the cache_chain_mutex held */
@@ -4007,22 +4095,26 @@ static int do_tune_cpucache(struct kmem_cache *cachep, int limit,
 				int batchcount, int shared, gfp_t gfp)
 {
 	struct ccupdate_struct *new;
+	bool spare;
 	int i;
 
-	new = kzalloc(sizeof(*new) + nr_cpu_ids * sizeof(struct array_cache *),
-		      gfp);
+	new = kzalloc(sizeof(*new) +
+		      2 * nr_cpu_ids * sizeof(struct array_cache *), gfp);
 	if (!new)
 		return -ENOMEM;
 
+	spare = cache_wants_spare(cachep, limit);
 	for_each_online_cpu(i) {
 		new->new[i] = alloc_arraycache(cpu_to_mem(i), limit,
 						batchcount, gfp);
-		if (!new->new[i]) {
-			for (i--; i >= 0; i--)
-				kfree(new->new[i]);
-			kfree(new);
-			return -ENOMEM;
-		}
+		if (!new->new[i])
+			goto nomem;
+		if (!spare)
+			continue;
+		new->new[nr_cpu_ids + i] = alloc_arraycache(cpu_to_mem(i),
+						limit, batchcount, gfp);
+		if (!new->new[nr_cpu_ids + i])
+			goto nomem;
 	}
 	new->cachep = cachep;
 
@@ -4033,17 +4125,26 @@ static int do_tune_cpucache(struct kmem_cache *cachep, int limit,
 	cachep->limit = limit;
 	cachep->shared = shared;
 
-	for_each_online_cpu(i) {
+	for (i = 0; i < 2 * nr_cpu_ids; i++) {
 		struct array_cache *ccold = new->new[i];
+		int node = cpu_to_mem(i % nr_cpu_ids);
+
 		if (!ccold)
 			continue;
-		spin_lock_irq(&cachep->nodelists[cpu_to_mem(i)]->list_lock);
-		free_block(cachep, ccold->entry, ccold->avail, cpu_to_mem(i));
-		spin_unlock_irq(&cachep->nodelists[cpu_to_mem(i)]->list_lock);
+		cache_fold_stats(cachep, ccold);
+		spin_lock_irq(&cachep->nodelists[node]->list_lock);
+		free_block(cachep, ccold->entry, ccold->avail, node);
+		spin_unlock_irq(&cachep->nodelists[node]->list_lock);
 		kfree(ccold);
 	}
 	kfree(new);
 	return alloc_kmemlist(cachep, gfp);
+
+nomem:
+	for (i = 0; i < 2 * nr_cpu_ids; i++)
+		kfree(new->new[i]);
+	kfree(new);
+	return -ENOMEM;
 }
 
 /* Called with cache_chain_mutex held always */
@@ -4165,6 +4266,8 @@ static void cache_reap(struct work_struct *w)
 		reap_alien(searchp, l3);
 
 		drain_array(searchp, l3, cpu_cache_get(searchp), 0, node);
+		drain_array(searchp, l3, searchp->spare[smp_processor_id()],
+			    0, node);
 
 		/*
 		 * These are racy checks but it does not matter
@@ -4214,6 +4317,7 @@ static void print_slabinfo_header(struct seq_file *m)
 		 "<objperslab> <pagesperslab>");
 	seq_puts(m, " : tunables <limit> <batchcount> <sharedfactor>");
 	seq_puts(m, " : slabdata <active_slabs> <num_slabs> <sharedavail>");
+	seq_puts(m, " : pathstat <allocfast> <allocslow> <freefast> <freeslow>");
 #if STATS
 	seq_puts(m, " : globalstat <listallocs> <maxobjs> <grown> <reaped> "
 		 "<error> <maxfreeable> <nodeallocs> <remotefrees> <alienoverflow>");
@@ -4307,6 +4411,30 @@ static int s_show(struct seq_file *m, void *p)
 		   cachep->limit, cachep->batchcount, cachep->shared);
 	seq_printf(m, " : slabdata %6lu %6lu %6lu",
 		   active_slabs, num_slabs, shared_avail);
+	{			/* cpu array hits, racy against swaps */
+		unsigned long alloc_fast = cachep->alloc_fast;
+		unsigned long alloc_slow = cachep->alloc_slow;
+		unsigned long free_fast = cachep->free_fast;
+		unsigned long free_slow = cachep->free_slow;
+		int cpu;
+
+		for_each_online_cpu(cpu) {
+			struct array_cache *ac[2] = {
+				cachep->array[cpu], cachep->spare[cpu] };
+			int i;
+
+			for (i = 0; i < 2; i++) {
+				if (!ac[i])
+					continue;
+				alloc_fast += ac[i]->alloc_fast;
+				alloc_slow += ac[i]->alloc_slow;
+				free_fast += ac[i]->free_fast;
+				free_slow += ac[i]->free_slow;
+			}
+		}
+		seq_printf(m, " : pathstat %8lu %6lu %8lu %6lu",
+			   alloc_fast, alloc_slow, free_fast, free_slow);
+	}
 #if STATS
 	{			/* list3 stats */
 		unsigned long high = cachep->high_mark;
@@ -266,8 +266,13 @@ struct page * lookup_swap_cache(swp_entry_t entry)
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		if (unlikely(PageReadahead(page))) {
+			ClearPageReadahead(page);
+			count_vm_event(SWAP_RA_HIT);
+		}
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
@@ -352,6 +357,27 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+/*
+ * Start reading one page ahead.  Pages already in the swap cache are left
+ * alone, new ones are marked so lookup_swap_cache() can count the hits.
+ */
+static bool swap_ra_page(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	struct page *page;
+
+	page = find_get_page(&swapper_space, entry.val);
+	if (!page) {
+		page = read_swap_cache_async(entry, gfp_mask, vma, addr);
+		if (!page)
+			return false;
+		SetPageReadahead(page);
+		count_vm_event(SWAP_RA);
+	}
+	page_cache_release(page);
+	return true;
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -388,13 +414,78 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	 */
 	nr_pages = valid_swaphandles(entry, &offset);
 	for (end_offset = offset + nr_pages; offset < end_offset; offset++) {
+		/* the target is read last, and is no readahead */
+		if (offset == swp_offset(entry))
+			continue;
 		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
-		if (!page)
+		if (!swap_ra_page(swp_entry(swp_type(entry), offset),
+				  gfp_mask, vma, addr))
 			break;
-		page_cache_release(page);
 	}
 	lru_add_drain();	/* Push any new pages onto the LRU now */
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
+
+/* Use swapin_vma_readahead() on devices without slot readahead */
+int sysctl_swap_vma_readahead = 1;
+
+/* at most 16 pages, which never cross a page table */
+#define SWAP_RA_VMA_ORDER	4
+
+/**
+ * swapin_vma_readahead - swap in pages near @addr in hope we need them soon
+ * @entry: swap entry of this memory
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma this address belongs to
+ * @addr: faulting address
+ * @pmd: the pmd mapping @addr
+ *
+ * Returns the struct page for entry and addr, after queueing swapin.
+ *
+ * Where the swap device does no slot readahead, read ahead the swapped
+ * out neighbours of @addr in its vma instead: an aligned block of
+ * (1 << page_cluster) pages around it, so a task that faults through an
+ * array swaps it in a block at a time wherever its slots ended up.
+ * Otherwise this is swapin_readahead().
+ *
+ * Caller must hold down_read on vma->vm_mm.
+ */
+struct page *swapin_vma_readahead(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			pmd_t *pmd)
+{
+	swp_entry_t entries[1 << SWAP_RA_VMA_ORDER];
+	unsigned long win, start, end, a;
+	pte_t *pte, *orig_pte;
+	int nr = 0, i;
+
+	if (!sysctl_swap_vma_readahead || swap_slot_readahead(entry))
+		return swapin_readahead(entry, gfp_mask, vma, addr);
+	if (!page_cluster)
+		return read_swap_cache_async(entry, gfp_mask, vma, addr);
+
+	win = PAGE_SIZE << min(page_cluster, SWAP_RA_VMA_ORDER);
+	start = max(addr & ~(win - 1), vma->vm_start);
+	end = min((addr & ~(win - 1)) + win, vma->vm_end);
+
+	/* entries are hints, a stale one just reads an unrelated page */
+	orig_pte = pte = pte_offset_map(pmd, start);
+	for (a = start; a < end; a += PAGE_SIZE, pte++) {
+		pte_t ptent = *pte;
+		swp_entry_t ent;
+
+		if (a == addr || !is_swap_pte(ptent))
+			continue;
+		ent = pte_to_swp_entry(ptent);
+		if (unlikely(non_swap_entry(ent)))
+			continue;
+		entries[nr++] = ent;
+	}
+	pte_unmap(orig_pte);
+
+	for (i = 0; i < nr; i++)
+		if (!swap_ra_page(entries[i], gfp_mask, vma, addr))
+			break;
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+	return read_swap_cache_async(entry, gfp_mask, vma, addr);
+}
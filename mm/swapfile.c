@@ -2289,6 +2289,29 @@ int swapcache_prepare(swp_entry_t entry)
 	return __swap_duplicate(entry, SWAP_HAS_CACHE);
 }
 
+/*
+ * Neighbouring slots are only worth reading ahead where they are cheap
+ * to read and likely related, as on a disk.  A device turns it off with
+ * read_ahead_kb set to 0; zram, where every extra page is an extra
+ * decompression of something unrelated, does so by default.
+ */
+bool swap_slot_readahead(swp_entry_t entry)
+{
+	struct swap_info_struct *si = swap_info[swp_type(entry)];
+
+	return !si->bdev || blk_get_backing_dev_info(si->bdev)->ra_pages;
+}
+
+/* Half the cost hint of the device, one for each way */
+unsigned int swap_io_cost(swp_entry_t entry)
+{
+	struct swap_info_struct *si = swap_info[swp_type(entry)];
+
+	if (!si->bdev)
+		return BDI_DEFAULT_IO_COST_US / 2;
+	return bdi_io_cost(blk_get_backing_dev_info(si->bdev)) / 2;
+}
+
 /*
  * swap_lock prevents swap_map being freed. Don't grab an extra
  * reference on the swaphandle, it doesn't matter if it becomes unused.
@@ -2303,6 +2326,8 @@ int valid_swaphandles(swp_entry_t entry, unsigned long *offset)
 
 	if (!our_page_cluster)	/* no readahead */
 		return 0;
+	if (!swap_slot_readahead(entry))
+		return 0;
 
 	si = swap_info[swp_type(entry)];
 	target = swp_offset(entry);
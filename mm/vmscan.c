@@ -26,6 +26,7 @@
 #include <linux/buffer_head.h>	/* for try_to_release_page(),
 					buffer_heads_over_limit */
 #include <linux/mm_inline.h>
+#include <linux/hugetlb.h>
 #include <linux/pagevec.h>
 #include <linux/backing-dev.h>
 #include <linux/rmap.h>
@@ -111,6 +112,9 @@ struct scan_control {
 	 * are scanned.
 	 */
 	nodemask_t	*nodemask;
+
+	/* Reclaim pages even if they were recently referenced */
+	int ignore_references;
 };
 
 #define lru_to_page(_head) (list_entry((_head)->prev, struct page, lru))
@@ -570,6 +574,8 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 
 		freepage = mapping->a_ops->freepage;
 
+		if (page_is_file_cache(page))
+			workingset_eviction(mapping, page);
 		__delete_from_page_cache(page);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
@@ -739,10 +745,7 @@ static enum page_references page_check_references(struct page *page,
 /*
  * shrink_page_list() returns the number of reclaimed pages
  */
-#ifndef CONFIG_ZRAM_FOR_ANDROID
-static
-#endif /* CONFIG_ZRAM_FOR_ANDROID */
-unsigned long shrink_page_list(struct list_head *page_list,
+static unsigned long shrink_page_list(struct list_head *page_list,
 				      struct zone *zone,
 				      struct scan_control *sc)
 {
@@ -805,7 +808,10 @@ unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		references = page_check_references(page, sc);
+		if (sc->ignore_references)
+			references = PAGEREF_RECLAIM;
+		else
+			references = page_check_references(page, sc);
 		switch (references) {
 		case PAGEREF_ACTIVATE:
 			goto activate_locked;
@@ -1210,10 +1216,7 @@ static unsigned long isolate_pages_global(unsigned long nr,
  * clear_active_flags() is a helper for shrink_active_list(), clearing
  * any active bits from the pages in the list.
  */
-#ifndef CONFIG_ZRAM_FOR_ANDROID
-static
-#endif /* CONFIG_ZRAM_FOR_ANDROID */
-unsigned long clear_active_flags(struct list_head *page_list,
+static unsigned long clear_active_flags(struct list_head *page_list,
 					unsigned int *count)
 {
 	int nr_active = 0;
@@ -1283,40 +1286,6 @@ int isolate_lru_page(struct page *page)
 	return ret;
 }
 
-#ifdef CONFIG_ZRAM_FOR_ANDROID
-/**
- * isolate_lru_page_compcache - tries to isolate a page for compcache
- * @page: page to isolate from its LRU list
- *
- * Isolates a @page from an LRU list, clears PageLRU,but
- * does not adjusts the vmstat statistic
- * Returns 0 if the page was removed from an LRU list.
- * Returns -EBUSY if the page was not on an LRU list.
- */
-int isolate_lru_page_compcache(struct page *page)
-{
-	int ret = -EBUSY;
-
-	VM_BUG_ON(!page_count(page));
-
-	if (PageLRU(page)) {
-		struct zone *zone = page_zone(page);
-
-		spin_lock_irq(&zone->lru_lock);
-		if (PageLRU(page)) {
-			int lru = page_lru(page);
-			ret = 0;
-			get_page(page);
-			ClearPageLRU(page);
-			list_del(&page->lru);
-			mem_cgroup_del_lru_list(page, lru);
-		}
-		spin_unlock_irq(&zone->lru_lock);
-	}
-	return ret;
-}
-#endif
-
 /*
  * Are there way too many processes in the direct reclaim path already?
  */
@@ -1547,37 +1516,155 @@ shrink_inactive_list(unsigned long nr_to_scan, struct zone *zone,
 	return nr_reclaimed;
 }
 
-#ifdef CONFIG_ZRAM_FOR_ANDROID
-unsigned long
-zone_id_shrink_pagelist(struct zone *zone, struct list_head *page_list)
+#ifdef CONFIG_PROCESS_RECLAIM
+/*
+ * Reclaim a list of pages isolated with isolate_lru_page() and accounted
+ * as NR_ISOLATED_*. The pages may come from any zone. Referenced bits are
+ * ignored: the caller asked for exactly these pages to go. Whatever could
+ * not be reclaimed is put back on the LRU.
+ */
+static unsigned long reclaim_pages_from_list(struct list_head *page_list)
 {
-	unsigned long nr_reclaimed = 0;
-	unsigned long nr_anon;
-	unsigned long nr_file;
-
 	struct scan_control sc = {
-		.gfp_mask = GFP_USER,
+		.gfp_mask = GFP_KERNEL,
 		.may_writepage = 1,
-		.nr_to_reclaim = SWAP_CLUSTER_MAX,
 		.may_unmap = 1,
 		.may_swap = 1,
+		.ignore_references = 1,
+		.nr_to_reclaim = SWAP_CLUSTER_MAX,
 		.order = 0,
 		.mem_cgroup = NULL,
 		.nodemask = NULL,
 	};
+	unsigned long nr_reclaimed = 0;
+	struct page *page, *next;
+	LIST_HEAD(zone_list);
 
-	spin_lock_irq(&zone->lru_lock);
-	update_isolated_counts(zone, &sc, &nr_anon, &nr_file, page_list);
-	spin_unlock_irq(&zone->lru_lock);
+	while (!list_empty(page_list)) {
+		struct zone *zone = page_zone(lru_to_page(page_list));
+		unsigned long nr_isolated[2] = { 0, };
+		unsigned long nr_zone;
 
-	nr_reclaimed = shrink_page_list(page_list, zone, &sc);
-	__count_zone_vm_events(PGSTEAL, zone, nr_reclaimed);
-	putback_lru_pages(zone, &sc, nr_anon, nr_file, page_list);
+		list_for_each_entry_safe(page, next, page_list, lru) {
+			if (page_zone(page) != zone)
+				continue;
+			ClearPageActive(page);
+			nr_isolated[page_is_file_cache(page)]++;
+			list_move(&page->lru, &zone_list);
+		}
+
+		nr_zone = shrink_page_list(&zone_list, zone, &sc);
+		count_vm_events(PGSTEAL_NORMAL - ZONE_NORMAL + zone_idx(zone),
+				nr_zone);
+		nr_reclaimed += nr_zone;
+
+		while (!list_empty(&zone_list)) {
+			page = lru_to_page(&zone_list);
+			list_del(&page->lru);
+			putback_lru_page(page);
+		}
+		mod_zone_page_state(zone, NR_ISOLATED_ANON, -nr_isolated[0]);
+		mod_zone_page_state(zone, NR_ISOLATED_FILE, -nr_isolated[1]);
+	}
 
 	return nr_reclaimed;
 }
-EXPORT_SYMBOL(zone_id_shrink_pagelist);
-#endif /* CONFIG_ZRAM_FOR_ANDROID */
+
+struct reclaim_walk {
+	struct vm_area_struct *vma;
+	enum reclaim_type type;
+	unsigned long nr_reclaimed;
+};
+
+static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
+			     unsigned long end, struct mm_walk *walk)
+{
+	struct reclaim_walk *rw = walk->private;
+	struct vm_area_struct *vma = rw->vma;
+	LIST_HEAD(page_list);
+	pte_t *pte, ptent;
+	spinlock_t *ptl;
+	struct page *page;
+
+	split_huge_page_pmd(walk->mm, pmd);
+
+	pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		ptent = *pte;
+		if (!pte_present(ptent))
+			continue;
+
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page)
+			continue;
+
+		/* Pages shared with other processes are left to kswapd */
+		if (page_mapcount(page) != 1)
+			continue;
+		if (rw->type == RECLAIM_ANON && !PageAnon(page))
+			continue;
+		if (rw->type == RECLAIM_FILE && PageAnon(page))
+			continue;
+
+		if (isolate_lru_page(page))
+			continue;
+		inc_zone_page_state(page, NR_ISOLATED_ANON +
+				    page_is_file_cache(page));
+		list_add(&page->lru, &page_list);
+	}
+	pte_unmap_unlock(pte - 1, ptl);
+
+	if (!list_empty(&page_list))
+		rw->nr_reclaimed += reclaim_pages_from_list(&page_list);
+	cond_resched();
+
+	if (fatal_signal_pending(current))
+		return -EINTR;
+	return 0;
+}
+
+/**
+ * reclaim_mm - reclaim the pages mapped only by one address space
+ * @mm: the address space, with a reference held by the caller
+ * @type: %RECLAIM_ANON, %RECLAIM_FILE or %RECLAIM_ALL
+ *
+ * Walks the page tables of every vma in @mm and pushes its private pages
+ * through shrink_page_list(), writing anonymous pages to swap. Returns
+ * the number of pages freed.
+ */
+unsigned long reclaim_mm(struct mm_struct *mm, enum reclaim_type type)
+{
+	struct vm_area_struct *vma;
+	struct reclaim_walk rw = {
+		.type = type,
+	};
+	struct mm_walk reclaim_walk = {
+		.pmd_entry = reclaim_pte_range,
+		.mm = mm,
+		.private = &rw,
+	};
+
+	down_read(&mm->mmap_sem);
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		if (is_vm_hugetlb_page(vma))
+			continue;
+		if (vma->vm_flags & (VM_LOCKED | VM_PFNMAP | VM_IO))
+			continue;
+		if (type == RECLAIM_ANON && !vma->anon_vma)
+			continue;
+		if (type == RECLAIM_FILE && !vma->vm_file)
+			continue;
+
+		rw.vma = vma;
+		if (walk_page_range(vma->vm_start, vma->vm_end,
+				    &reclaim_walk))
+			break;
+	}
+	up_read(&mm->mmap_sem);
+
+	return rw.nr_reclaimed;
+}
+#endif /* CONFIG_PROCESS_RECLAIM */
 
 /*
  * This moves pages from the active list to the inactive list.
@@ -1844,13 +1931,25 @@ static int vmscan_swappiness(struct scan_control *sc)
  *
  * nr[0] = anon pages to scan; nr[1] = file pages to scan
  */
+/*
+ * Charge @cost us to reclaiming the anon (0) or file (1) lists of @zone.
+ * Called from the swap and page cache paths without the lru_lock, a lost
+ * update does not matter to a rough average.
+ */
+void lru_note_cost(struct zone *zone, int file, unsigned int cost)
+{
+	zone->reclaim_stat.recent_cost[file] += max(cost, 1U);
+}
+
 static void get_scan_count(struct zone *zone, struct scan_control *sc,
 					unsigned long *nr, int priority)
 {
 	unsigned long anon, file, free;
 	unsigned long anon_prio, file_prio;
 	unsigned long ap, fp;
+	unsigned long anon_cost, file_cost, total_cost;
 	struct zone_reclaim_stat *reclaim_stat = get_reclaim_stat(zone, sc);
+	struct zone_reclaim_stat *zone_stat = &zone->reclaim_stat;
 	u64 fraction[2], denominator;
 	enum lru_list l;
 	int noswap = 0;
@@ -1933,6 +2032,24 @@ static void get_scan_count(struct zone *zone, struct scan_control *sc,
 
 	fp = (file_prio + 1) * (reclaim_stat->recent_scanned[1] + 1);
 	fp /= reclaim_stat->recent_rotated[1] + 1;
+
+	/*
+	 * Then shift the pressure toward the list that has been cheaper to
+	 * reclaim lately, by up to a factor of two either way: compressing
+	 * anon pages into zram and faulting them back can cost more than
+	 * reading back the file pages that would have gone instead.
+	 */
+	if (unlikely(zone_stat->recent_cost[0] + zone_stat->recent_cost[1] >
+		     (anon + file) / 4 * BDI_DEFAULT_IO_COST_US)) {
+		zone_stat->recent_cost[0] /= 2;
+		zone_stat->recent_cost[1] /= 2;
+	}
+	total_cost = zone_stat->recent_cost[0] + zone_stat->recent_cost[1];
+	anon_cost = total_cost + zone_stat->recent_cost[0];
+	file_cost = total_cost + zone_stat->recent_cost[1];
+	total_cost = anon_cost + file_cost;
+	ap = div64_u64((u64)ap * (total_cost + 1), anon_cost + 1);
+	fp = div64_u64((u64)fp * (total_cost + 1), file_cost + 1);
 	spin_unlock_irq(&zone->lru_lock);
 
 	fraction[0] = ap;
@@ -2073,6 +2190,13 @@ restart:
 			break;
 	}
 	sc->nr_reclaimed += nr_reclaimed;
+	if (scanning_global_lru(sc))
+		lowmem_vmpressure(sc->gfp_mask, sc->nr_scanned - nr_scanned,
+				  nr_reclaimed);
+	else
+		mem_cgroup_vmpressure(sc->mem_cgroup,
+				      sc->nr_scanned - nr_scanned,
+				      nr_reclaimed);
 
 	/*
 	 * Even if we did not try to evict anon pages at all, we want to
@@ -613,6 +613,9 @@ static char * const migratetype_names[MIGRATE_TYPES] = {
 	"Reclaimable",
 	"Movable",
 	"Reserve",
+#ifdef CONFIG_CMA
+	"CMA",
+#endif
 	"Isolate",
 };
 
@@ -755,6 +758,8 @@ const char * const vmstat_text[] = {
 	"allocstall",
 
 	"pgrotated",
+	"workingset_refault",
+	"workingset_activate",
 
 #ifdef CONFIG_COMPACTION
 	"compact_blocks_moved",
@@ -763,6 +768,7 @@ const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_daemon_wake",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -785,8 +791,23 @@ const char * const vmstat_text[] = {
 	"thp_collapse_alloc_failed",
 	"thp_split",
 #endif
+#ifdef CONFIG_SWAP
+	"swap_ra",
+	"swap_ra_hit",
+#endif
+#ifdef CONFIG_HIGHMEM
+	"pkmap_flush",
+	"pkmap_flush_pages",
+	"pkmap_flush_all",
+	"pkmap_wait",
+#endif
 
 #endif /* CONFIG_VM_EVENTS_COUNTERS */
+
+#ifdef CONFIG_COMPACTION
+	/* at the kcompactd order, x1000, 0 while a block of it is free */
+	TEXTS_FOR_ZONES("compact_frag_index")
+#endif
 };
 #endif /* CONFIG_PROC_FS || CONFIG_SYSFS || CONFIG_NUMA */
 
@@ -1009,6 +1030,10 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			   pageset->pcp.count,
 			   pageset->pcp.high,
 			   pageset->pcp.batch);
+		if (pageset->pcp.high != pageset->pcp.high_base)
+			seq_printf(m, " (tuned from %i/%i)",
+				   pageset->pcp.high_base,
+				   pageset->pcp.batch_base);
 #ifdef CONFIG_SMP
 		seq_printf(m, "\n  vm stats threshold: %d",
 				pageset->stat_threshold);
@@ -1017,10 +1042,14 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 	seq_printf(m,
 		   "\n  all_unreclaimable: %u"
 		   "\n  start_pfn:         %lu"
-		   "\n  inactive_ratio:    %u",
+		   "\n  inactive_ratio:    %u"
+		   "\n  lock_acquired:     %lu"
+		   "\n  lock_contended:    %lu",
 		   zone->all_unreclaimable,
 		   zone->zone_start_pfn,
-		   zone->inactive_ratio);
+		   zone->inactive_ratio,
+		   zone->lock_acquired,
+		   zone->lock_contended);
 	seq_putc(m, '\n');
 }
 
@@ -1060,6 +1089,24 @@ enum writeback_stat_item {
 	NR_VM_WRITEBACK_STAT_ITEMS,
 };
 
+#ifdef CONFIG_COMPACTION
+/* The worst fragmentation index of each zone type over all nodes */
+static void vmstat_frag_index(unsigned long *v)
+{
+	unsigned int order = sysctl_kcompactd_order ?: PAGE_ALLOC_COSTLY_ORDER;
+	struct zone *zone;
+
+	memset(v, 0, MAX_NR_ZONES * sizeof(unsigned long));
+	for_each_populated_zone(zone) {
+		int index = fragmentation_index(zone, order);
+
+		/* -1000: a block of the order is free, nothing to compact */
+		if (index > 0 && index > (long)v[zone_idx(zone)])
+			v[zone_idx(zone)] = index;
+	}
+}
+#endif
+
 static void *vmstat_start(struct seq_file *m, loff_t *pos)
 {
 	unsigned long *v;
@@ -1073,6 +1120,9 @@ static void *vmstat_start(struct seq_file *m, loff_t *pos)
 #ifdef CONFIG_VM_EVENT_COUNTERS
 	stat_items_size += sizeof(struct vm_event_state);
 #endif
+#ifdef CONFIG_COMPACTION
+	stat_items_size += MAX_NR_ZONES * sizeof(unsigned long);
+#endif
 
 	v = kmalloc(stat_items_size, GFP_KERNEL);
 	m->private = v;
@@ -1090,6 +1140,10 @@ static void *vmstat_start(struct seq_file *m, loff_t *pos)
 	all_vm_events(v);
 	v[PGPGIN] /= 2;		/* sectors -> kbytes */
 	v[PGPGOUT] /= 2;
+	v += NR_VM_EVENT_ITEMS;
+#endif
+#ifdef CONFIG_COMPACTION
+	vmstat_frag_index(v);
 #endif
 	return (unsigned long *)m->private + *pos;
 }
@@ -1144,6 +1198,7 @@ int sysctl_stat_interval __read_mostly = HZ;
 static void vmstat_update(struct work_struct *w)
 {
 	refresh_cpu_vm_stats(smp_processor_id());
+	refresh_local_pagesets();
 	schedule_delayed_work(&__get_cpu_var(vmstat_work),
 		round_jiffies_relative(sysctl_stat_interval));
 }
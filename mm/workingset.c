@@ -0,0 +1,96 @@
+/*
+ * linux/mm/workingset.c
+ *
+ * Refault detection for the page cache.  When reclaim evicts a file page
+ * it leaves a cookie of the page's mapping and index, and the value of a
+ * clock that counts evictions, in a hash table that holds one cookie per
+ * slot and no pointers.  When the page is read back in and its cookie is
+ * still there, the difference in clock is how many file pages reclaim
+ * evicted in between.  Had the active list been that much bigger the page
+ * would have stayed, so it goes straight to the active list, and what
+ * reading it back cost is charged to file reclaim; see get_scan_count().
+ *
+ * Slots are simply overwritten, and a cookie with the wrong tag is a miss.
+ * Both lose refaults, neither makes one up except on a 1 in 4096 tag
+ * collision.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/mm.h>
+#include <linux/swap.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
+#include <linux/vmalloc.h>
+#include <linux/backing-dev.h>
+
+#define WS_CLOCK_BITS		20
+#define WS_CLOCK_MASK		((1U << WS_CLOCK_BITS) - 1)
+#define WS_TAG_MASK		((1U << (32 - WS_CLOCK_BITS)) - 1)
+
+static u32 *ws_table;
+static unsigned int ws_bits;
+static atomic_t ws_clock;
+
+static u32 *ws_slot(struct address_space *mapping, pgoff_t index, u32 *tag)
+{
+	u32 h = hash_32(hash_ptr(mapping, 32) ^ (u32)index, 32);
+
+	*tag = h & WS_TAG_MASK;
+	return &ws_table[h >> (32 - ws_bits)];
+}
+
+/* Called with the mapping's tree_lock held, before the page leaves it */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	u32 tag, clock;
+	u32 *slot;
+
+	if (!ws_table)
+		return;
+	slot = ws_slot(mapping, page->index, &tag);
+	clock = atomic_inc_return(&ws_clock);
+	*slot = (tag << WS_CLOCK_BITS) | (clock & WS_CLOCK_MASK);
+}
+
+/*
+ * Called when @page has just been added to @mapping.  Returns true if it
+ * was evicted while it still belonged to the working set, and should be
+ * put on the active list.
+ */
+bool workingset_refault(struct address_space *mapping, struct page *page)
+{
+	u32 tag, entry, distance;
+	u32 *slot;
+
+	if (!ws_table)
+		return false;
+	slot = ws_slot(mapping, page->index, &tag);
+	entry = ACCESS_ONCE(*slot);
+	if (!entry || entry >> WS_CLOCK_BITS != tag)
+		return false;
+	*slot = 0;
+
+	count_vm_event(WORKINGSET_REFAULT);
+	distance = (atomic_read(&ws_clock) - entry) & WS_CLOCK_MASK;
+	if (distance > global_page_state(NR_ACTIVE_FILE))
+		return false;
+
+	count_vm_event(WORKINGSET_ACTIVATE);
+	lru_note_cost(page_zone(page), 1,
+		      bdi_io_cost(mapping->backing_dev_info) / 2);
+	return true;
+}
+
+static int __init workingset_init(void)
+{
+	unsigned long slots;
+
+	/* one slot for every 8 pages, 128k of table per 1G of RAM */
+	slots = roundup_pow_of_two(max(totalram_pages / 8, 4096UL));
+	ws_bits = ilog2(slots);
+	ws_table = vzalloc(slots * sizeof(u32));
+	if (!ws_table)
+		pr_err("workingset: no memory for %lu slots\n", slots);
+	return 0;
+}
+module_init(workingset_init);
@@ -14,6 +14,7 @@
  * Author: Mike Chan (mike@android.com)
  */
 
+#include <linux/jiffies.h>
 #include <linux/proc_fs.h>
 #include <linux/suspend.h>
 #include <net/net_namespace.h>
@@ -30,6 +31,7 @@
 /* Track network activity frequency */
 static unsigned long activity_stats[BUCKET_MAX];
 static ktime_t last_transmit;
+static unsigned long last_transmit_jiffies = INITIAL_JIFFIES - HZ;
 static ktime_t suspend_time;
 static DEFINE_SPINLOCK(activity_lock);
 
@@ -40,6 +42,13 @@ void activity_stats_update(void)
 	ktime_t now;
 	s64 delta;
 
+	/*
+	 * Nothing is counted until a second has passed since the last
+	 * counted transmission; skip the lock on the common, busy path.
+	 */
+	if (time_before(jiffies, ACCESS_ONCE(last_transmit_jiffies) + HZ - 1))
+		return;
+
 	spin_lock_irqsave(&activity_lock, flags);
 	now = ktime_get();
 	delta = ktime_to_ns(ktime_sub(now, last_transmit));
@@ -54,6 +63,7 @@ void activity_stats_update(void)
 
 		activity_stats[i]++;
 		last_transmit = now;
+		last_transmit_jiffies = jiffies;
 		break;
 	}
 	spin_unlock_irqrestore(&activity_lock, flags);
@@ -95,6 +105,8 @@ static int activity_stats_notifier(struct notifier_block *nb,
 		case PM_POST_SUSPEND:
 			suspend_time = ktime_sub(ktime_get_real(), suspend_time);
 			last_transmit = ktime_sub(last_transmit, suspend_time);
+			/* jiffies stood still; take the slow path next time */
+			last_transmit_jiffies = jiffies - HZ;
 	}
 
 	return 0;
@@ -559,37 +559,28 @@ static ssize_t show_rps_map(struct netdev_rx_queue *queue,
 	return len;
 }
 
-static ssize_t store_rps_map(struct netdev_rx_queue *queue,
-		      struct rx_queue_attribute *attribute,
-		      const char *buf, size_t len)
+static DEFINE_SPINLOCK(rps_map_lock);
+static DEFINE_SPINLOCK(rps_dev_flow_lock);
+
+/*
+ * Offline cpus are kept in the map: get_rps_cpu() does not steer to them
+ * while they are down, and cores that are hotplugged on demand get their
+ * share again as soon as they come back.
+ */
+static int rps_set_map(struct netdev_rx_queue *queue,
+		       const struct cpumask *mask)
 {
 	struct rps_map *old_map, *map;
-	cpumask_var_t mask;
-	int err, cpu, i;
-	static DEFINE_SPINLOCK(rps_map_lock);
-
-	if (!capable(CAP_NET_ADMIN))
-		return -EPERM;
-
-	if (!alloc_cpumask_var(&mask, GFP_KERNEL))
-		return -ENOMEM;
-
-	err = bitmap_parse(buf, len, cpumask_bits(mask), nr_cpumask_bits);
-	if (err) {
-		free_cpumask_var(mask);
-		return err;
-	}
+	int cpu, i;
 
 	map = kzalloc(max_t(unsigned,
 	    RPS_MAP_SIZE(cpumask_weight(mask)), L1_CACHE_BYTES),
 	    GFP_KERNEL);
-	if (!map) {
-		free_cpumask_var(mask);
+	if (!map)
 		return -ENOMEM;
-	}
 
 	i = 0;
-	for_each_cpu_and(cpu, mask, cpu_online_mask)
+	for_each_cpu_and(cpu, mask, cpu_possible_mask)
 		map->cpus[i++] = cpu;
 
 	if (i)
@@ -608,8 +599,28 @@ static ssize_t store_rps_map(struct netdev_rx_queue *queue,
 	if (old_map)
 		kfree_rcu(old_map, rcu);
 
+	return 0;
+}
+
+static ssize_t store_rps_map(struct netdev_rx_queue *queue,
+		      struct rx_queue_attribute *attribute,
+		      const char *buf, size_t len)
+{
+	cpumask_var_t mask;
+	int err;
+
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	if (!alloc_cpumask_var(&mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	err = bitmap_parse(buf, len, cpumask_bits(mask), nr_cpumask_bits);
+	if (!err)
+		err = rps_set_map(queue, mask);
+
 	free_cpumask_var(mask);
-	return len;
+	return err ? err : len;
 }
 
 static ssize_t show_rps_dev_flow_table_cnt(struct netdev_rx_queue *queue,
@@ -645,21 +656,9 @@ static void rps_dev_flow_table_release(struct rcu_head *rcu)
 	schedule_work(&table->free_work);
 }
 
-static ssize_t store_rps_dev_flow_table_cnt(struct netdev_rx_queue *queue,
-				     struct rx_queue_attribute *attr,
-				     const char *buf, size_t len)
+static int rps_set_flow_cnt(struct netdev_rx_queue *queue, unsigned int count)
 {
-	unsigned int count;
-	char *endp;
 	struct rps_dev_flow_table *table, *old_table;
-	static DEFINE_SPINLOCK(rps_dev_flow_lock);
-
-	if (!capable(CAP_NET_ADMIN))
-		return -EPERM;
-
-	count = simple_strtoul(buf, &endp, 0);
-	if (endp == buf)
-		return -EINVAL;
 
 	if (count) {
 		int i;
@@ -688,8 +687,54 @@ static ssize_t store_rps_dev_flow_table_cnt(struct netdev_rx_queue *queue,
 	if (old_table)
 		call_rcu(&old_table->rcu, rps_dev_flow_table_release);
 
-	return len;
+	return 0;
+}
+
+static ssize_t store_rps_dev_flow_table_cnt(struct netdev_rx_queue *queue,
+				     struct rx_queue_attribute *attr,
+				     const char *buf, size_t len)
+{
+	unsigned int count;
+	char *endp;
+	int err;
+
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	count = simple_strtoul(buf, &endp, 0);
+	if (endp == buf)
+		return -EINVAL;
+
+	err = rps_set_flow_cnt(queue, count);
+	return err ? err : len;
+}
+
+/**
+ *	netif_set_rps_cpus - set receive steering defaults of a device
+ *	@dev: registered network device
+ *	@mask: cpus that receive processing may be steered to
+ *	@flow_cnt: RFS flow table entries per receive queue, 0 for none
+ *
+ *	For drivers that feed all receive traffic in from one cpu and know
+ *	it pays to spread it. Applies to every receive queue and may be
+ *	changed later through the rps_cpus and rps_flow_cnt sysfs files.
+ */
+int netif_set_rps_cpus(struct net_device *dev, const struct cpumask *mask,
+		       unsigned int flow_cnt)
+{
+	int i, err = 0;
+
+	if (flow_cnt > 1<<30)
+		return -EINVAL;
+
+	for (i = 0; i < dev->num_rx_queues && !err; i++) {
+		err = rps_set_map(&dev->_rx[i], mask);
+		if (!err)
+			err = rps_set_flow_cnt(&dev->_rx[i], flow_cnt);
+	}
+	return err;
 }
+EXPORT_SYMBOL(netif_set_rps_cpus);
 
 static struct rx_queue_attribute rps_cpus_attribute =
 	__ATTR(rps_cpus, S_IRUGO | S_IWUSR, show_rps_map, store_rps_map);
@@ -0,0 +1,103 @@
+/*
+ * TCP Fast Open client cookie cache.
+ *
+ * Remembers, per destination address, the Fast Open cookie and MSS the
+ * server last gave us, and whether SYNs carrying data have been lost on
+ * the way to it. The cache is small and direct mapped; a collision just
+ * replaces the older destination, which then has to request a new cookie.
+ */
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+#include <linux/jhash.h>
+#include <linux/jiffies.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <net/inet_sock.h>
+#include <net/ipv6.h>
+#include <net/tcp.h>
+
+int sysctl_tcp_fastopen __read_mostly = TFO_CLIENT_ENABLE;
+
+#define TCP_FASTOPEN_CACHE_BITS	6
+#define TCP_FASTOPEN_CACHE_SIZE	(1 << TCP_FASTOPEN_CACHE_BITS)
+
+struct tcp_fastopen_entry {
+	__be32				addr[4];
+	unsigned short			family;
+	u16				mss;
+	int				syn_loss;
+	unsigned long			last_syn_loss;
+	struct tcp_fastopen_cookie	cookie;
+};
+
+static struct tcp_fastopen_entry tcp_fastopen_cache[TCP_FASTOPEN_CACHE_SIZE];
+static DEFINE_SPINLOCK(tcp_fastopen_lock);
+
+static unsigned int tcp_fastopen_key(struct sock *sk, __be32 *addr)
+{
+	memset(addr, 0, 4 * sizeof(__be32));
+#if defined(CONFIG_IPV6) || defined(CONFIG_IPV6_MODULE)
+	if (sk->sk_family == AF_INET6) {
+		memcpy(addr, &inet6_sk(sk)->daddr, 4 * sizeof(__be32));
+		return jhash2((u32 *)addr, 4, 0) &
+		       (TCP_FASTOPEN_CACHE_SIZE - 1);
+	}
+#endif
+	addr[0] = inet_sk(sk)->inet_daddr;
+	return jhash_1word((__force u32)addr[0], 0) &
+	       (TCP_FASTOPEN_CACHE_SIZE - 1);
+}
+
+static bool tcp_fastopen_match(struct tcp_fastopen_entry *e,
+			       struct sock *sk, __be32 *addr)
+{
+	return e->family == sk->sk_family &&
+	       !memcmp(e->addr, addr, sizeof(e->addr));
+}
+
+void tcp_fastopen_cache_get(struct sock *sk, u16 *mss,
+			    struct tcp_fastopen_cookie *cookie,
+			    int *syn_loss, unsigned long *last_syn_loss)
+{
+	struct tcp_fastopen_entry *e;
+	__be32 addr[4];
+
+	e = &tcp_fastopen_cache[tcp_fastopen_key(sk, addr)];
+
+	spin_lock_bh(&tcp_fastopen_lock);
+	if (tcp_fastopen_match(e, sk, addr)) {
+		if (e->mss)
+			*mss = e->mss;
+		*cookie = e->cookie;
+		*syn_loss = e->syn_loss;
+		*last_syn_loss = e->syn_loss ? e->last_syn_loss : 0;
+	}
+	spin_unlock_bh(&tcp_fastopen_lock);
+}
+
+void tcp_fastopen_cache_set(struct sock *sk, u16 mss,
+			    struct tcp_fastopen_cookie *cookie, bool syn_lost)
+{
+	struct tcp_fastopen_entry *e;
+	__be32 addr[4];
+
+	e = &tcp_fastopen_cache[tcp_fastopen_key(sk, addr)];
+
+	spin_lock_bh(&tcp_fastopen_lock);
+	if (!tcp_fastopen_match(e, sk, addr)) {
+		memset(e, 0, sizeof(*e));
+		memcpy(e->addr, addr, sizeof(e->addr));
+		e->family = sk->sk_family;
+	}
+	e->mss = mss;
+	if (cookie->len > 0)
+		e->cookie = *cookie;
+	if (syn_lost) {
+		++e->syn_loss;
+		e->last_syn_loss = jiffies;
+	} else {
+		e->syn_loss = 0;
+	}
+	spin_unlock_bh(&tcp_fastopen_lock);
+}
@@ -168,9 +168,26 @@ int tegra30_i2s_startup(struct snd_pcm_substream *substream,
 
 	tegra30_i2s_enable_clocks(i2s);
 
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    i2s->playback_substream) {
+		/* a second stream can only be mixed in by the dam */
+		ret = -EBUSY;
+		if (i2s->is_dam_used && !i2s->mix_substream)
+			ret = tegra30_ahub_allocate_tx_fifo(&i2s->mix_txcif,
+						&i2s->mix_dma_data.addr,
+						&i2s->mix_dma_data.req_sel);
+		if (!ret) {
+			i2s->mix_dma_data.wrap = 4;
+			i2s->mix_dma_data.width = 32;
+			i2s->mix_substream = substream;
+			i2s->playback_ref_count++;
+			dai->playback_dma_data = &i2s->mix_dma_data;
+		}
+	} else if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
 		/* increment the playback ref count */
 		i2s->playback_ref_count++;
+		i2s->playback_substream = substream;
+		dai->playback_dma_data = &i2s->playback_dma_data;
 
 		ret = tegra30_ahub_allocate_tx_fifo(&i2s->txcif,
 					&i2s->playback_dma_data.addr,
@@ -210,7 +227,13 @@ void tegra30_i2s_shutdown(struct snd_pcm_substream *substream,
 				TEGRA30_AHUB_RXCIF_I2S0_RX0 + i2s->id);
 
 		/* free the apbif dma channel*/
-		tegra30_ahub_free_tx_fifo(i2s->txcif);
+		if (substream == i2s->mix_substream) {
+			tegra30_ahub_free_tx_fifo(i2s->mix_txcif);
+			i2s->mix_substream = NULL;
+		} else {
+			tegra30_ahub_free_tx_fifo(i2s->txcif);
+			i2s->playback_substream = NULL;
+		}
 
 		/* decrement the playback ref count */
 		i2s->playback_ref_count--;
@@ -291,6 +314,16 @@ static int tegra30_i2s_hw_params(struct snd_pcm_substream *substream,
 	int ret, sample_size, srate, i2sclock, bitcnt, sym_bitclk;
 	int i2s_client_ch;
 
+	/* the first stream has set up the i2s, the dam adapts this one */
+	if (substream == i2s->mix_substream) {
+		tegra30_i2s_enable_clocks(i2s);
+		tegra30_ahub_set_tx_cif_channels(i2s->mix_txcif,
+						 params_channels(params),
+						 params_channels(params));
+		tegra30_i2s_disable_clocks(i2s);
+		return 0;
+	}
+
 	i2s->reg_ctrl &= ~TEGRA30_I2S_CTRL_BIT_SIZE_MASK;
 	switch (params_format(params)) {
 	case SNDRV_PCM_FORMAT_S16_LE:
@@ -412,23 +445,41 @@ static int tegra30_i2s_hw_params(struct snd_pcm_substream *substream,
 	return 0;
 }
 
-static void tegra30_i2s_start_playback(struct tegra30_i2s *i2s)
+/*
+ * The i2s tx is ours to switch when the only other users of it are pcm
+ * streams, which playback_running counts, and not a voice call.
+ */
+static bool tegra30_i2s_tx_owned(struct tegra30_i2s *i2s)
+{
+	return i2s->playback_ref_count == !!i2s->playback_substream +
+					  !!i2s->mix_substream;
+}
+
+static void tegra30_i2s_start_playback(struct tegra30_i2s *i2s,
+				       struct snd_pcm_substream *substream)
 {
-	tegra30_ahub_enable_tx_fifo(i2s->txcif);
+	if (substream == i2s->mix_substream)
+		tegra30_ahub_enable_tx_fifo(i2s->mix_txcif);
+	else
+		tegra30_ahub_enable_tx_fifo(i2s->txcif);
 	/* if this is the only user of i2s tx then enable it*/
-	if (i2s->playback_ref_count == 1) {
+	if (!i2s->playback_running++ && tegra30_i2s_tx_owned(i2s)) {
 		i2s->reg_ctrl |= TEGRA30_I2S_CTRL_XFER_EN_TX;
 		tegra30_i2s_write(i2s, TEGRA30_I2S_CTRL, i2s->reg_ctrl);
 	}
 }
 
-static void tegra30_i2s_stop_playback(struct tegra30_i2s *i2s)
+static void tegra30_i2s_stop_playback(struct tegra30_i2s *i2s,
+				      struct snd_pcm_substream *substream)
 {
 	int cnt = 10;
 
-	tegra30_ahub_disable_tx_fifo(i2s->txcif);
+	if (substream == i2s->mix_substream)
+		tegra30_ahub_disable_tx_fifo(i2s->mix_txcif);
+	else
+		tegra30_ahub_disable_tx_fifo(i2s->txcif);
 	/* if this is the only user of i2s tx then disable it*/
-	if (i2s->playback_ref_count == 1) {
+	if (!--i2s->playback_running && tegra30_i2s_tx_owned(i2s)) {
 		i2s->reg_ctrl &= ~TEGRA30_I2S_CTRL_XFER_EN_TX;
 		tegra30_i2s_write(i2s, TEGRA30_I2S_CTRL, i2s->reg_ctrl);
 	}
@@ -471,7 +522,7 @@ static int tegra30_i2s_trigger(struct snd_pcm_substream *substream, int cmd,
 	case SNDRV_PCM_TRIGGER_RESUME:
 		tegra30_i2s_enable_clocks(i2s);
 		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-			tegra30_i2s_start_playback(i2s);
+			tegra30_i2s_start_playback(i2s, substream);
 		else
 			tegra30_i2s_start_capture(i2s);
 		break;
@@ -479,7 +530,7 @@ static int tegra30_i2s_trigger(struct snd_pcm_substream *substream, int cmd,
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
 	case SNDRV_PCM_TRIGGER_SUSPEND:
 		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-			tegra30_i2s_stop_playback(i2s);
+			tegra30_i2s_stop_playback(i2s, substream);
 		else
 			tegra30_i2s_stop_capture(i2s);
 		tegra30_i2s_disable_clocks(i2s);
@@ -249,6 +249,15 @@ struct tegra30_i2s {
 	int dam_ch_refcount;
 	int  playback_ref_count;
 	bool is_dam_used;
+	/*
+	 * With a DAM in the path a second playback stream can be opened;
+	 * it gets its own fifo and the DAM mixes it with the first.
+	 */
+	struct snd_pcm_substream *playback_substream;
+	struct snd_pcm_substream *mix_substream;
+	enum tegra30_ahub_txcif mix_txcif;
+	struct tegra_pcm_dma_params mix_dma_data;
+	int playback_running;
 #ifdef CONFIG_PM
 	u32  reg_cache[(TEGRA30_I2S_CIF_TX_CTRL >> 2) + 1];
 #endif
@@ -0,0 +1,136 @@
+/*
+ * tegra_mix_speed.c - cpu cost of mixing and resampling in software.
+ *
+ * The DAM mixes a second playback stream into the first and converts its
+ * sample rate without the cpu touching a sample; the only cost left is
+ * the DMA interrupt per period of each stream.  Loading this module times
+ * the software path it replaces, as AudioFlinger would run it: two 48kHz
+ * 16-bit stereo streams mixed with saturation, and a 16kHz mono stream
+ * resampled to 48kHz stereo by linear interpolation and mixed in.  The
+ * cost is printed per second of audio and as a share of one cpu at the
+ * current frequency.  The load fails on purpose so the module can be
+ * loaded again.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/cpufreq.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/vmalloc.h>
+
+#define OUT_RATE	48000
+#define IN_RATE		16000
+
+static unsigned int test_ms = 1000;
+module_param(test_ms, uint, 0);
+MODULE_PARM_DESC(test_ms, "Time spent on each test (ms)");
+
+static inline s16 sat16(int v)
+{
+	if (v > 32767)
+		return 32767;
+	if (v < -32768)
+		return -32768;
+	return v;
+}
+
+/* dst += src, @n samples */
+static void mix_s16(s16 *dst, const s16 *src, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		dst[i] = sat16(dst[i] + src[i]);
+}
+
+/* mix mono @src at @rate into @frames stereo frames of @dst at OUT_RATE */
+static void resample_mix_s16(s16 *dst, const s16 *src, unsigned int rate,
+			     unsigned int frames)
+{
+	u32 step = ((u64)rate << 16) / OUT_RATE;
+	u32 pos = 0;
+	unsigned int i;
+
+	for (i = 0; i < frames; i++, pos += step) {
+		unsigned int j = pos >> 16;
+		int frac = pos & 0xffff;
+		int v = src[j] + (((src[j + 1] - src[j]) * frac) >> 16);
+
+		dst[2 * i] = sat16(dst[2 * i] + v);
+		dst[2 * i + 1] = sat16(dst[2 * i + 1] + v);
+	}
+}
+
+static void report(const char *what, s64 ns, unsigned int runs)
+{
+	unsigned int khz = cpufreq_quick_get(raw_smp_processor_id());
+	u64 ns_sec = div64_u64(ns, runs);
+
+	/* ns of cpu per second of audio, in thousandths of one cpu */
+	pr_info("test_mix: %-22s %7llu us per second of audio, %llu.%llu%% "
+		"of one cpu at %u MHz\n", what, div_u64(ns_sec, 1000),
+		div_u64(ns_sec, 10000000), div_u64(ns_sec, 1000000) % 10,
+		khz / 1000);
+}
+
+static int __init tegra_mix_speed_init(void)
+{
+	s16 *out, *a, *b, *mono;
+	unsigned int runs;
+	ktime_t start;
+	s64 ns;
+	int ret = -ENOMEM;
+
+	out = vmalloc(OUT_RATE * 2 * sizeof(s16));
+	a = vmalloc(OUT_RATE * 2 * sizeof(s16));
+	b = vmalloc(OUT_RATE * 2 * sizeof(s16));
+	mono = vmalloc((IN_RATE + 1) * sizeof(s16));
+	if (!out || !a || !b || !mono)
+		goto out;
+
+	get_random_bytes(a, OUT_RATE * 2 * sizeof(s16));
+	get_random_bytes(b, OUT_RATE * 2 * sizeof(s16));
+	get_random_bytes(mono, (IN_RATE + 1) * sizeof(s16));
+
+	runs = 0;
+	start = ktime_get();
+	do {
+		memcpy(out, a, OUT_RATE * 2 * sizeof(s16));
+		mix_s16(out, b, OUT_RATE * 2);
+		runs++;
+		cond_resched();
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	} while (ns < (s64)test_ms * NSEC_PER_MSEC);
+	report("mix 2 x 48k stereo", ns, runs);
+
+	runs = 0;
+	start = ktime_get();
+	do {
+		memcpy(out, a, OUT_RATE * 2 * sizeof(s16));
+		resample_mix_s16(out, mono, IN_RATE, OUT_RATE);
+		runs++;
+		cond_resched();
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	} while (ns < (s64)test_ms * NSEC_PER_MSEC);
+	report("resample 16k mono, mix", ns, runs);
+
+	pr_info("test_mix: through the DAM both cost only the period "
+		"interrupts, see debugfs tegra_pcm\n");
+
+	ret = -EAGAIN;
+out:
+	vfree(mono);
+	vfree(b);
+	vfree(a);
+	vfree(out);
+	return ret;
+}
+module_init(tegra_mix_speed_init);
+MODULE_LICENSE("GPL");
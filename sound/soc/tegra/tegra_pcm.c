@@ -33,6 +33,8 @@
 #include <linux/module.h>
 #include <linux/dma-mapping.h>
 #include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <sound/core.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
@@ -43,14 +45,37 @@
 #define DRV_NAME "tegra-pcm-audio"
 
 #define PERIOD_BYTES_MAX	(PAGE_SIZE * 2)
-#define PERIODS_MAX		64
+#define PERIODS_MAX		1024
+#define BUFFER_BYTES_MAX	(PERIOD_BYTES_MAX * 64)
+
+/* largest request the APB DMA takes, TEGRA_DMA_MAX_TRANSFER_SIZE */
+#define RING_BYTES_MAX		0x10000
+
+/*
+ * Deep buffer playback: one period may be a whole DMA request, about
+ * 340ms of 48kHz stereo, in a buffer of deep_buffer_kb.  The next
+ * request is always programmed in the DMA before the current one ends,
+ * and the APBIF FIFO, AHUB and I2S keep running while the cpu is in
+ * LP2, so the period interrupt is the only wakeup playback needs.
+ */
+#define DEEP_PERIOD_BYTES_MAX	RING_BYTES_MAX
+
+static unsigned int deep_buffer_kb = 1024;
+module_param(deep_buffer_kb, uint, 0444);
+MODULE_PARM_DESC(deep_buffer_kb, "Playback buffer preallocated for large "
+		 "periods (KB), 0 to disable");
+
+/* underruns and overruns seen, and dma interrupts, per direction */
+static unsigned int tegra_pcm_xruns[2];
+static unsigned int tegra_pcm_irqs[2];
 
 static const struct snd_pcm_hardware tegra_pcm_hardware = {
 	.info			= SNDRV_PCM_INFO_MMAP |
 				  SNDRV_PCM_INFO_MMAP_VALID |
 				  SNDRV_PCM_INFO_PAUSE |
 				  SNDRV_PCM_INFO_RESUME |
-				  SNDRV_PCM_INFO_INTERLEAVED,
+				  SNDRV_PCM_INFO_INTERLEAVED |
+				  SNDRV_PCM_INFO_NO_PERIOD_WAKEUP,
 	.formats		= SNDRV_PCM_FMTBIT_S16_LE,
 	.channels_min		= 1,
 	.channels_max		= 2,
@@ -58,7 +83,7 @@ static const struct snd_pcm_hardware tegra_pcm_hardware = {
 	.period_bytes_max	= PERIOD_BYTES_MAX,
 	.periods_min		= 2,
 	.periods_max		= PERIODS_MAX,
-	.buffer_bytes_max	= PERIOD_BYTES_MAX * PERIODS_MAX,
+	.buffer_bytes_max	= BUFFER_BYTES_MAX,
 	.fifo_size		= 4,
 };
 
@@ -98,6 +123,12 @@ static void dma_complete_callback(struct tegra_dma_req *req)
 		return;
 	}
 
+	tegra_pcm_irqs[substream->stream]++;
+
+	/* the dma driver stopped and restarted: data was lost */
+	if (req->status != TEGRA_DMA_REQ_SUCCESS)
+		tegra_pcm_xruns[substream->stream]++;
+
 	if (++prtd->period_index >= runtime->periods)
 		prtd->period_index = 0;
 
@@ -108,10 +139,21 @@ static void dma_complete_callback(struct tegra_dma_req *req)
 	snd_pcm_period_elapsed(substream);
 }
 
+/* first half of the ring done; ring mode only */
+static void dma_threshold_callback(struct tegra_dma_req *req)
+{
+	struct tegra_runtime_data *prtd = (struct tegra_runtime_data *)req->dev;
+
+	tegra_pcm_irqs[prtd->substream->stream]++;
+	if (prtd->running)
+		snd_pcm_period_elapsed(prtd->substream);
+}
+
 static void setup_dma_tx_request(struct tegra_dma_req *req,
 					struct tegra_pcm_dma_params * dmap)
 {
 	req->complete = dma_complete_callback;
+	req->threshold = dma_threshold_callback;
 	req->to_memory = false;
 	req->dest_addr = dmap->addr;
 	req->dest_wrap = dmap->wrap;
@@ -125,6 +167,7 @@ static void setup_dma_rx_request(struct tegra_dma_req *req,
 					struct tegra_pcm_dma_params * dmap)
 {
 	req->complete = dma_complete_callback;
+	req->threshold = dma_threshold_callback;
 	req->to_memory = true;
 	req->source_addr = dmap->addr;
 	req->dest_wrap = 0;
@@ -140,6 +183,7 @@ static int tegra_pcm_open(struct snd_pcm_substream *substream)
 	struct tegra_runtime_data *prtd;
 	struct snd_soc_pcm_runtime *rtd = substream->private_data;
 	struct tegra_pcm_dma_params * dmap;
+	struct snd_pcm_hardware hw = tegra_pcm_hardware;
 	int ret = 0;
 
 	prtd = kzalloc(sizeof(struct tegra_runtime_data), GFP_KERNEL);
@@ -151,15 +195,20 @@ static int tegra_pcm_open(struct snd_pcm_substream *substream)
 
 	spin_lock_init(&prtd->lock);
 
+	/*
+	 * The cpu dai may hand out a different fifo to each stream it is
+	 * opened for, so keep the one that is ours now.
+	 */
 	dmap = snd_soc_dai_get_dma_data(rtd->cpu_dai, substream);
+	prtd->dmap = dmap;
 
 	if (dmap) {
 		prtd->dma_req[0].dev = prtd;
 		prtd->dma_req[1].dev = prtd;
 
-		prtd->dma_chan = tegra_dma_allocate_channel(
-					TEGRA_DMA_MODE_CONTINUOUS_SINGLE,
-					"pcm");
+		prtd->dma_mode = TEGRA_DMA_MODE_CONTINUOUS_SINGLE;
+		prtd->dma_chan = tegra_dma_allocate_channel(prtd->dma_mode,
+							    "pcm");
 		if (prtd->dma_chan == NULL) {
 			ret = -ENOMEM;
 			goto err;
@@ -167,7 +216,11 @@ static int tegra_pcm_open(struct snd_pcm_substream *substream)
 	}
 
 	/* Set HW params now that initialization is complete */
-	snd_soc_set_runtime_hwparams(substream, &tegra_pcm_hardware);
+	if (substream->dma_buffer.bytes > BUFFER_BYTES_MAX) {
+		hw.period_bytes_max = DEEP_PERIOD_BYTES_MAX;
+		hw.buffer_bytes_max = substream->dma_buffer.bytes;
+	}
+	snd_soc_set_runtime_hwparams(substream, &hw);
 
 	/* Ensure period size is multiple of 8 */
 	ret = snd_pcm_hw_constraint_step(runtime, 0,
@@ -206,17 +259,49 @@ static int tegra_pcm_close(struct snd_pcm_substream *substream)
 	return 0;
 }
 
+/*
+ * Ring mode: when the application asks for no period wakeups and the
+ * buffer fits in one request, each request covers the whole buffer on a
+ * double buffered channel.  The two requests are queued back to back as
+ * in period mode, but the hardware interrupts only at each half of the
+ * buffer, however small the periods are, and the pointer comes from the
+ * hardware count.
+ */
+static int tegra_pcm_set_dma_mode(struct tegra_runtime_data *prtd, int mode)
+{
+	struct tegra_dma_channel *chan;
+
+	if (!prtd->dma_chan || prtd->dma_mode == mode)
+		return 0;
+
+	chan = tegra_dma_allocate_channel(mode, "pcm");
+	if (!chan)
+		return -ENOMEM;
+	tegra_dma_free_channel(prtd->dma_chan);
+	prtd->dma_chan = chan;
+	prtd->dma_mode = mode;
+	return 0;
+}
+
 static int tegra_pcm_hw_params(struct snd_pcm_substream *substream,
 				struct snd_pcm_hw_params *params)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct tegra_runtime_data *prtd = runtime->private_data;
-	struct snd_soc_pcm_runtime *rtd = substream->private_data;
-	struct tegra_pcm_dma_params * dmap;
+	struct tegra_pcm_dma_params *dmap = prtd->dmap;
+	int ret;
+
+	prtd->ring = (params->info & SNDRV_PCM_INFO_NO_PERIOD_WAKEUP) &&
+		(params->flags & SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP) &&
+		params_buffer_bytes(params) <= RING_BYTES_MAX;
+	ret = tegra_pcm_set_dma_mode(prtd, prtd->ring ?
+				     TEGRA_DMA_MODE_CONTINUOUS_DOUBLE :
+				     TEGRA_DMA_MODE_CONTINUOUS_SINGLE);
+	if (ret)
+		return ret;
 
 	snd_pcm_set_runtime_buffer(substream, &substream->dma_buffer);
 
-	dmap = snd_soc_dai_get_dma_data(rtd->cpu_dai, substream);
 	if (dmap) {
 		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
 			setup_dma_tx_request(&prtd->dma_req[0], dmap);
@@ -226,7 +311,10 @@ static int tegra_pcm_hw_params(struct snd_pcm_substream *substream,
 			setup_dma_rx_request(&prtd->dma_req[1], dmap);
 		}
 	}
-	prtd->dma_req[0].size = params_period_bytes(params);
+	if (prtd->ring)
+		prtd->dma_req[0].size = params_buffer_bytes(params);
+	else
+		prtd->dma_req[0].size = params_period_bytes(params);
 	prtd->dma_req[1].size = prtd->dma_req[0].size;
 
 	return 0;
@@ -279,17 +367,34 @@ static int tegra_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 	return 0;
 }
 
+static int tegra_pcm_prepare(struct snd_pcm_substream *substream)
+{
+	if (substream->runtime->status->state == SNDRV_PCM_STATE_XRUN)
+		tegra_pcm_xruns[substream->stream]++;
+
+	return 0;
+}
+
 static snd_pcm_uframes_t tegra_pcm_pointer(struct snd_pcm_substream *substream)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct tegra_runtime_data *prtd = runtime->private_data;
+	snd_pcm_uframes_t pos;
 	int dma_transfer_count;
 
 	dma_transfer_count = tegra_dma_get_transfer_count(prtd->dma_chan,
 					&prtd->dma_req[prtd->dma_req_idx]);
 
-	return prtd->period_index * runtime->period_size +
-		bytes_to_frames(runtime, dma_transfer_count);
+	/*
+	 * The count runs past the end of the request if it completed and
+	 * the interrupt is still pending; the next request has started at
+	 * the following period, or at the start of the ring.
+	 */
+	pos = bytes_to_frames(runtime, dma_transfer_count);
+	if (!prtd->ring)
+		pos += prtd->period_index * runtime->period_size;
+
+	return pos % runtime->buffer_size;
 }
 
 static int tegra_pcm_mmap(struct snd_pcm_substream *substream,
@@ -309,6 +414,7 @@ static struct snd_pcm_ops tegra_pcm_ops = {
 	.ioctl		= snd_pcm_lib_ioctl,
 	.hw_params	= tegra_pcm_hw_params,
 	.hw_free	= tegra_pcm_hw_free,
+	.prepare	= tegra_pcm_prepare,
 	.trigger	= tegra_pcm_trigger,
 	.pointer	= tegra_pcm_pointer,
 	.mmap		= tegra_pcm_mmap,
@@ -320,11 +426,24 @@ static int tegra_pcm_preallocate_dma_buffer(struct snd_pcm *pcm, int stream)
 	struct snd_dma_buffer *buf = &substream->dma_buffer;
 	size_t size = tegra_pcm_hardware.buffer_bytes_max;
 
+	if (stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    deep_buffer_kb * 1024 > size) {
+		size = PAGE_ALIGN(deep_buffer_kb * 1024);
+		buf->area = dma_alloc_writecombine(pcm->card->dev, size,
+						   &buf->addr, GFP_KERNEL);
+		if (buf->area)
+			goto done;
+		pr_warn("tegra-pcm: no memory for deep buffer, using %uK\n",
+			BUFFER_BYTES_MAX / 1024);
+		size = tegra_pcm_hardware.buffer_bytes_max;
+	}
+
 	buf->area = dma_alloc_writecombine(pcm->card->dev, size,
 						&buf->addr, GFP_KERNEL);
 	if (!buf->area)
 		return -ENOMEM;
 
+done:
 	buf->dev.type = SNDRV_DMA_TYPE_DEV;
 	buf->dev.dev = pcm->card->dev;
 	buf->private_data = NULL;
@@ -428,8 +547,50 @@ static struct platform_driver tegra_pcm_driver = {
 	.remove = __devexit_p(tegra_pcm_platform_remove),
 };
 
+#ifdef CONFIG_DEBUG_FS
+static int tegra_pcm_stats_show(struct seq_file *s, void *data)
+{
+	int i;
+
+	seq_printf(s, "%-8s %8s %8s\n", "", "xruns", "irqs");
+	for (i = SNDRV_PCM_STREAM_PLAYBACK; i <= SNDRV_PCM_STREAM_CAPTURE; i++)
+		seq_printf(s, "%-8s %8u %8u\n", i ? "capture" : "playback",
+			   tegra_pcm_xruns[i], tegra_pcm_irqs[i]);
+	return 0;
+}
+
+static int tegra_pcm_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tegra_pcm_stats_show, inode->i_private);
+}
+
+static const struct file_operations tegra_pcm_stats_fops = {
+	.open		= tegra_pcm_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static struct dentry *tegra_pcm_debugfs;
+
+static void tegra_pcm_debugfs_init(void)
+{
+	tegra_pcm_debugfs = debugfs_create_file("tegra_pcm", S_IRUGO, NULL,
+						NULL, &tegra_pcm_stats_fops);
+}
+
+static void tegra_pcm_debugfs_exit(void)
+{
+	debugfs_remove(tegra_pcm_debugfs);
+}
+#else
+static inline void tegra_pcm_debugfs_init(void) {}
+static inline void tegra_pcm_debugfs_exit(void) {}
+#endif
+
 static int __init snd_tegra_pcm_init(void)
 {
+	tegra_pcm_debugfs_init();
 	return platform_driver_register(&tegra_pcm_driver);
 }
 module_init(snd_tegra_pcm_init);
@@ -437,6 +598,7 @@ module_init(snd_tegra_pcm_init);
 static void __exit snd_tegra_pcm_exit(void)
 {
 	platform_driver_unregister(&tegra_pcm_driver);
+	tegra_pcm_debugfs_exit();
 }
 module_exit(snd_tegra_pcm_exit);
 
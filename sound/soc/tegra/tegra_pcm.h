@@ -48,8 +48,11 @@ struct tegra_runtime_data {
 	int dma_pos_end;
 	int period_index;
 	int dma_req_idx;
+	int ring;
 	struct tegra_dma_req dma_req[2];
 	struct tegra_dma_channel *dma_chan;
+	int dma_mode;
+	struct tegra_pcm_dma_params *dmap;
 };
 
 #endif
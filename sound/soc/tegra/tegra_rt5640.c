@@ -51,6 +51,12 @@
 #include "tegra_pcm.h"
 #include "tegra_asoc_utils.h"
 
+#ifndef CONFIG_ARCH_TEGRA_2x_SOC
+#include "tegra30_ahub.h"
+#include "tegra30_i2s.h"
+#include "tegra30_dam.h"
+#endif
+
 #define DRV_NAME "tegra-snd-rt5640"
 
 #define GPIO_SPKR_EN    BIT(0)
@@ -59,6 +65,13 @@
 #define GPIO_EXT_MIC_EN BIT(3)
 #define GPIO_HP_DET     BIT(4)
 
+#ifndef CONFIG_ARCH_TEGRA_2x_SOC
+static bool dam_mix = true;
+module_param(dam_mix, bool, 0444);
+MODULE_PARM_DESC(dam_mix, "Play through a DAM so that a second stream can "
+		 "be mixed in by hardware");
+#endif
+
 struct tegra_rt5640 {
 	struct tegra_asoc_utils_data util_data;
 	struct tegra_rt5640_platform_data *pdata;
@@ -71,6 +84,12 @@ struct tegra_rt5640 {
 #endif
 	enum snd_soc_bias_level bias_level;
 	volatile int clock_enabled;
+#ifndef CONFIG_ARCH_TEGRA_2x_SOC
+	bool playback_on_dam;
+	int dam_rate;
+	unsigned int mix_rates[3];
+	struct snd_pcm_hw_constraint_list mix_rate_list;
+#endif
 };
 
 static int tegra_rt5640_hw_params(struct snd_pcm_substream *substream,
@@ -123,6 +142,24 @@ static int tegra_rt5640_hw_params(struct snd_pcm_substream *substream,
 		return err;
 	}
 
+#ifndef CONFIG_ARCH_TEGRA_2x_SOC
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    machine->playback_on_dam) {
+		struct tegra30_i2s *i2s = snd_soc_dai_get_drvdata(cpu_dai);
+		int ch = params_channels(params);
+
+		tegra30_dam_set_samplerate(i2s->dam_ifc, TEGRA30_DAM_CHOUT,
+					   srate);
+		tegra30_dam_set_samplerate(i2s->dam_ifc, TEGRA30_DAM_CHIN1,
+					   srate);
+		tegra30_dam_set_acif(i2s->dam_ifc, TEGRA30_DAM_CHIN1,
+				     ch, 16, ch, 16);
+		tegra30_dam_set_acif(i2s->dam_ifc, TEGRA30_DAM_CHOUT,
+				     ch, 16, ch, 16);
+		machine->dam_rate = srate;
+	}
+#endif
+
 	return 0;
 }
 
@@ -236,9 +273,172 @@ static int tegra_hw_free(struct snd_pcm_substream *substream)
 	return 0;
 }
 
+#ifndef CONFIG_ARCH_TEGRA_2x_SOC
+/*
+ * Hardware mixing.  With dam_mix set the main playback stream goes to
+ * the i2s through input 1 of a DAM, and the "RT5640 Mix" pcm feeds
+ * input 0, whose sample rate converter brings it to the rate of the main
+ * stream.  Input 0 only takes 16-bit mono.  When no DAM is free the main
+ * stream is wired to the i2s directly, and the mix pcm then fails to open
+ * with -EBUSY so that the user falls back to mixing in software.
+ */
+static int tegra_rt5640_get_dam(struct tegra30_i2s *i2s, int ch)
+{
+	int ifc = i2s->dam_ifc;
+
+	if (!i2s->dam_ch_refcount) {
+		ifc = tegra30_dam_allocate_controller();
+		if (ifc < 0)
+			return -EBUSY;
+	}
+
+	if (tegra30_dam_allocate_channel(ifc, ch)) {
+		if (!i2s->dam_ch_refcount)
+			tegra30_dam_free_controller(ifc);
+		return -EBUSY;
+	}
+
+	i2s->dam_ifc = ifc;
+	i2s->dam_ch_refcount++;
+	tegra30_dam_enable_clock(ifc);
+	tegra30_dam_set_gain(ifc, ch, 0x1000);
+
+	return 0;
+}
+
+static void tegra_rt5640_put_dam(struct tegra30_i2s *i2s, int ch)
+{
+	tegra30_dam_enable(i2s->dam_ifc, TEGRA30_DAM_DISABLE, ch);
+	tegra30_ahub_unset_rx_cif_source(TEGRA30_AHUB_RXCIF_DAM0_RX0 +
+					 (i2s->dam_ifc * 2) + ch);
+	tegra30_dam_disable_clock(i2s->dam_ifc);
+	tegra30_dam_free_channel(i2s->dam_ifc, ch);
+	i2s->dam_ch_refcount--;
+	if (!i2s->dam_ch_refcount)
+		tegra30_dam_free_controller(i2s->dam_ifc);
+}
+
+static int tegra_rt5640_startup(struct snd_pcm_substream *substream)
+{
+	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	struct tegra_rt5640 *machine = snd_soc_card_get_drvdata(rtd->card);
+	struct tegra30_i2s *i2s = snd_soc_dai_get_drvdata(rtd->cpu_dai);
+
+	if (substream->stream != SNDRV_PCM_STREAM_PLAYBACK ||
+	    !i2s->is_dam_used)
+		return 0;
+
+	if (tegra_rt5640_get_dam(i2s, TEGRA30_DAM_CHIN1)) {
+		if (i2s->playback_ref_count == 1)
+			tegra30_ahub_set_rx_cif_source(
+				TEGRA30_AHUB_RXCIF_I2S0_RX0 + i2s->id,
+				i2s->txcif);
+		return 0;
+	}
+	machine->playback_on_dam = true;
+
+	tegra30_ahub_set_rx_cif_source(TEGRA30_AHUB_RXCIF_DAM0_RX1 +
+			(i2s->dam_ifc * 2), i2s->txcif);
+	if (i2s->playback_ref_count == 1)
+		tegra30_ahub_set_rx_cif_source(
+			TEGRA30_AHUB_RXCIF_I2S0_RX0 + i2s->id,
+			TEGRA30_AHUB_TXCIF_DAM0_TX0 + i2s->dam_ifc);
+	tegra30_dam_enable(i2s->dam_ifc, TEGRA30_DAM_ENABLE,
+			TEGRA30_DAM_CHIN1);
+
+	return 0;
+}
+
+static void tegra_rt5640_shutdown(struct snd_pcm_substream *substream)
+{
+	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	struct tegra_rt5640 *machine = snd_soc_card_get_drvdata(rtd->card);
+	struct tegra30_i2s *i2s = snd_soc_dai_get_drvdata(rtd->cpu_dai);
+
+	if (substream->stream != SNDRV_PCM_STREAM_PLAYBACK ||
+	    !machine->playback_on_dam)
+		return;
+
+	tegra_rt5640_put_dam(i2s, TEGRA30_DAM_CHIN1);
+	machine->playback_on_dam = false;
+}
+
+static int tegra_rt5640_mix_startup(struct snd_pcm_substream *substream)
+{
+	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	struct tegra_rt5640 *machine = snd_soc_card_get_drvdata(rtd->card);
+	struct tegra30_i2s *i2s = snd_soc_dai_get_drvdata(rtd->cpu_dai);
+	int ret;
+
+	/* there must be a main stream going through a DAM to mix into */
+	if (substream != i2s->mix_substream || !machine->playback_on_dam ||
+	    !machine->dam_rate)
+		return -EBUSY;
+
+	ret = tegra_rt5640_get_dam(i2s, TEGRA30_DAM_CHIN0_SRC);
+	if (ret)
+		return ret;
+
+	tegra30_ahub_set_rx_cif_source(TEGRA30_AHUB_RXCIF_DAM0_RX0 +
+			(i2s->dam_ifc * 2), i2s->mix_txcif);
+	tegra30_dam_enable(i2s->dam_ifc, TEGRA30_DAM_ENABLE,
+			TEGRA30_DAM_CHIN0_SRC);
+
+	/* the converter takes 8k or 16k, or the rate of the main stream */
+	machine->mix_rates[0] = TEGRA30_AUDIO_SAMPLERATE_8000;
+	machine->mix_rates[1] = TEGRA30_AUDIO_SAMPLERATE_16000;
+	machine->mix_rates[2] = machine->dam_rate;
+	machine->mix_rate_list.count = ARRAY_SIZE(machine->mix_rates);
+	machine->mix_rate_list.list = machine->mix_rates;
+
+	ret = snd_pcm_hw_constraint_list(substream->runtime, 0,
+					 SNDRV_PCM_HW_PARAM_RATE,
+					 &machine->mix_rate_list);
+	if (!ret)
+		ret = snd_pcm_hw_constraint_minmax(substream->runtime,
+						   SNDRV_PCM_HW_PARAM_CHANNELS,
+						   1, 1);
+	if (ret)
+		tegra_rt5640_put_dam(i2s, TEGRA30_DAM_CHIN0_SRC);
+
+	return ret;
+}
+
+static int tegra_rt5640_mix_hw_params(struct snd_pcm_substream *substream,
+					struct snd_pcm_hw_params *params)
+{
+	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	struct tegra30_i2s *i2s = snd_soc_dai_get_drvdata(rtd->cpu_dai);
+
+	tegra30_dam_set_samplerate(i2s->dam_ifc, TEGRA30_DAM_CHIN0_SRC,
+				   params_rate(params));
+
+	return tegra30_dam_set_acif(i2s->dam_ifc, TEGRA30_DAM_CHIN0_SRC,
+				    1, 16, 1, 16);
+}
+
+static void tegra_rt5640_mix_shutdown(struct snd_pcm_substream *substream)
+{
+	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	struct tegra30_i2s *i2s = snd_soc_dai_get_drvdata(rtd->cpu_dai);
+
+	tegra_rt5640_put_dam(i2s, TEGRA30_DAM_CHIN0_SRC);
+}
+
+static struct snd_soc_ops tegra_rt5640_mix_ops = {
+	.startup = tegra_rt5640_mix_startup,
+	.hw_params = tegra_rt5640_mix_hw_params,
+	.shutdown = tegra_rt5640_mix_shutdown,
+};
+#endif
+
 static struct snd_soc_ops tegra_rt5640_ops = {
 	.hw_params = tegra_rt5640_hw_params,
 	.hw_free = tegra_hw_free,
+#ifndef CONFIG_ARCH_TEGRA_2x_SOC
+	.startup = tegra_rt5640_startup,
+	.shutdown = tegra_rt5640_shutdown,
+#endif
 };
 
 static struct snd_soc_ops tegra_rt5640_bt_sco_ops = {
@@ -471,8 +671,14 @@ static int tegra_rt5640_init(struct snd_soc_pcm_runtime *rtd)
 	struct snd_soc_card *card = codec->card;
 	struct tegra_rt5640 *machine = snd_soc_card_get_drvdata(card);
 	struct tegra_rt5640_platform_data *pdata = machine->pdata;
+#ifndef CONFIG_ARCH_TEGRA_2x_SOC
+	struct tegra30_i2s *i2s = snd_soc_dai_get_drvdata(rtd->cpu_dai);
+#endif
 	int ret;
 
+#ifndef CONFIG_ARCH_TEGRA_2x_SOC
+	i2s->is_dam_used = dam_mix;
+#endif
 
 
 
@@ -538,6 +744,17 @@ static struct snd_soc_dai_link tegra_rt5640_dai[] = {
 		.codec_dai_name = "dit-hifi",
 		.ops = &tegra_rt5640_bt_sco_ops,
 	},
+#ifndef CONFIG_ARCH_TEGRA_2x_SOC
+	{
+		.name = "RT5640 Mix",
+		.stream_name = "RT5640 Mix PCM",
+		.codec_name = "spdif-dit.2",
+		.platform_name = "tegra-pcm-audio",
+		.cpu_dai_name = "tegra30-i2s.1",
+		.codec_dai_name = "dit-hifi",
+		.ops = &tegra_rt5640_mix_ops,
+	},
+#endif
 };
 
 static int tegra_rt5640_set_bias_level(struct snd_soc_card *card,